@@ -222,6 +222,29 @@ static void print_delayacct(struct taskstats *t)
 	       (unsigned long long)t->freepages_count,
 	       (unsigned long long)t->freepages_delay_total,
 	       average_ms(t->freepages_delay_total, t->freepages_count));
+
+	if (t->version >= 9)
+		printf("PGREAD   %12s%15s%15s\n"
+		       "      %15llu%15llu%15llums\n"
+		       "PGWRITE  %12s%15s%15s\n"
+		       "      %15llu%15llu%15llums\n"
+		       "FSYNC    %12s%15s%15s\n"
+		       "      %15llu%15llu%15llums\n",
+		       "count", "delay total", "delay average",
+		       (unsigned long long)t->io_wait_count[TASKSTATS_IO_READ],
+		       (unsigned long long)t->io_wait_delay_total[TASKSTATS_IO_READ],
+		       average_ms(t->io_wait_delay_total[TASKSTATS_IO_READ],
+				  t->io_wait_count[TASKSTATS_IO_READ]),
+		       "count", "delay total", "delay average",
+		       (unsigned long long)t->io_wait_count[TASKSTATS_IO_WRITE],
+		       (unsigned long long)t->io_wait_delay_total[TASKSTATS_IO_WRITE],
+		       average_ms(t->io_wait_delay_total[TASKSTATS_IO_WRITE],
+				  t->io_wait_count[TASKSTATS_IO_WRITE]),
+		       "count", "delay total", "delay average",
+		       (unsigned long long)t->io_wait_count[TASKSTATS_IO_FSYNC],
+		       (unsigned long long)t->io_wait_delay_total[TASKSTATS_IO_FSYNC],
+		       average_ms(t->io_wait_delay_total[TASKSTATS_IO_FSYNC],
+				  t->io_wait_count[TASKSTATS_IO_FSYNC]));
 }
 
 static void task_context_switch_counts(struct taskstats *t)
@@ -58,6 +58,12 @@ EXPORT_SYMBOL(__memset);
 EXPORT_SYMBOL(__memcpy);
 EXPORT_SYMBOL(__memmove);
 EXPORT_SYMBOL(memchr);
+
+#ifdef CONFIG_LZ4_NEON
+asmlinkage void lz4_decompress_neon(u8 **, const u8 *, const u8 *,
+				    const u8 **, const u8 *);
+EXPORT_SYMBOL(lz4_decompress_neon);
+#endif
 EXPORT_SYMBOL(memcmp);
 
 	/* atomic bitops */
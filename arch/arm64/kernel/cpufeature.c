@@ -658,6 +658,37 @@ static bool has_no_hw_prefetch(const struct arm64_cpu_capabilities *entry)
 	return MIDR_IS_CPU_MODEL_RANGE(midr, MIDR_THUNDERX, rv_min, rv_max);
 }
 
+static bool kryo_copy_disabled;
+
+static int __init parse_kryo_copy(char *str)
+{
+	bool enabled;
+	int ret = strtobool(str, &enabled);
+
+	if (ret)
+		return ret;
+
+	kryo_copy_disabled = !enabled;
+	return 0;
+}
+early_param("kryo_copy", parse_kryo_copy);
+
+/*
+ * Kryo 2xx gold and silver clusters always come together, so the boot
+ * CPU is enough to pick the copy loops for the whole system.
+ */
+static bool has_kryo_copy(const struct arm64_cpu_capabilities *entry)
+{
+	u32 midr = read_cpuid_id();
+	u32 rv_max = MIDR_VARIANT_MASK | MIDR_REVISION_MASK;
+
+	if (kryo_copy_disabled)
+		return false;
+
+	return MIDR_IS_CPU_MODEL_RANGE(midr, MIDR_KRYO2XX_GOLD, 0, rv_max) ||
+	       MIDR_IS_CPU_MODEL_RANGE(midr, MIDR_KRYO2XX_SILVER, 0, rv_max);
+}
+
 static bool runs_at_el2(const struct arm64_cpu_capabilities *entry)
 {
 	return is_kernel_in_hyp_mode();
@@ -734,6 +765,11 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.capability = ARM64_HAS_NO_HW_PREFETCH,
 		.matches = has_no_hw_prefetch,
 	},
+	{
+		.desc = "Kryo tuned memory copies",
+		.capability = ARM64_HAS_KRYO_COPY,
+		.matches = has_kryo_copy,
+	},
 #ifdef CONFIG_ARM64_UAO
 	{
 		.desc = "User Access Override",
@@ -1788,6 +1788,7 @@ void bio_endio(struct bio *bio)
 			bio_put(bio);
 			bio = parent;
 		} else {
+			blk_iolatency_done(bio);
 			if (bio->bi_end_io) {
 				blk_update_perf_stats(bio);
 				bio->bi_end_io(bio);
@@ -714,6 +714,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	q->backing_dev_info->capabilities = BDI_CAP_CGROUP_WRITEBACK;
 	q->backing_dev_info->name = "block";
 	q->node = node_id;
+	q->poll_nsec = -1;
 
 	setup_timer(&q->backing_dev_info->laptop_mode_wb_timer,
 		    laptop_mode_timer_fn, (unsigned long) q);
@@ -3854,23 +3855,115 @@ void blk_finish_plug(struct blk_plug *plug)
 }
 EXPORT_SYMBOL(blk_finish_plug);
 
+static unsigned int blk_poll_stat_bucket(struct request *rq)
+{
+	unsigned int bytes = blk_rq_bytes(rq);
+
+	if (bytes <= 4096)
+		return 0;
+	return min_t(unsigned int, ilog2(bytes - 1) - 11,
+		     BLK_POLL_STAT_BUCKETS - 1);
+}
+
+static void blk_poll_stat_add(struct request_queue *q, unsigned int bucket,
+			      u64 ns)
+{
+	struct blk_poll_stat *stat = &q->poll_stat[bucket];
+
+	/* exact mean for the first samples, then decay by 1/8 */
+	if (stat->nr < 8)
+		stat->mean_ns = div_u64(stat->mean_ns * stat->nr + ns,
+					stat->nr + 1);
+	else
+		stat->mean_ns = stat->mean_ns - (stat->mean_ns >> 3) + (ns >> 3);
+	stat->nr++;
+}
+
+/*
+ * Hybrid polling: instead of spinning for the whole completion time, sleep
+ * through the first half of it and only spin for the rest. Returns true if
+ * the task slept.
+ */
+static bool blk_poll_hybrid_sleep(struct request_queue *q, unsigned int bucket)
+{
+	struct hrtimer_sleeper hs;
+	u64 nsecs;
+
+	if (q->poll_nsec < 0)
+		return false;
+
+	if (q->poll_nsec > 0)
+		nsecs = q->poll_nsec;
+	else if (q->poll_stat[bucket].nr)
+		nsecs = q->poll_stat[bucket].mean_ns >> 1;
+	else
+		nsecs = 0;
+	if (!nsecs)
+		return false;
+
+	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_set_expires(&hs.timer, ns_to_ktime(nsecs));
+	hrtimer_init_sleeper(&hs, current);
+
+	/* a completion waking the task ends the sleep early */
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	hrtimer_start_expires(&hs.timer, HRTIMER_MODE_REL);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	__set_current_state(TASK_RUNNING);
+	destroy_hrtimer_on_stack(&hs.timer);
+
+	return true;
+}
+
+/*
+ * Polling burns the CPU the completion interrupt would otherwise have
+ * freed, only do it for reads someone is waiting on interactively.
+ */
+static bool blk_poll_wanted(struct request *rq)
+{
+	if (rq_data_dir(rq) != READ)
+		return false;
+#ifdef CONFIG_CGROUP_SCHEDTUNE
+	if (!schedtune_task_boosted(current))
+		return false;
+#endif
+	return true;
+}
+
 bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 {
+	struct blk_mq_hw_ctx *hctx;
 	struct blk_plug *plug;
+	struct request *rq;
+	unsigned int bucket;
 	long state;
 
 	if (!q->mq_ops || !q->mq_ops->poll || !blk_qc_t_valid(cookie) ||
 	    !test_bit(QUEUE_FLAG_POLL, &q->queue_flags))
 		return false;
 
+	hctx = q->queue_hw_ctx[blk_qc_t_to_queue_num(cookie)];
+	rq = blk_mq_tag_to_rq(hctx->tags, blk_qc_t_to_tag(cookie));
+	if (!blk_poll_wanted(rq))
+		return false;
+
 	plug = current->plug;
 	if (plug)
 		blk_flush_plug_list(plug, false);
 
+	/* the caller loops back here after a sleep until completion */
+	bucket = blk_poll_stat_bucket(rq);
+	if (!(rq->cmd_flags & REQ_POLLED)) {
+		rq->cmd_flags |= REQ_POLLED;
+		rq->poll_start = ktime_get();
+		if (blk_poll_hybrid_sleep(q, bucket))
+			return true;
+	}
+
 	state = current->state;
 	while (!need_resched()) {
-		unsigned int queue_num = blk_qc_t_to_queue_num(cookie);
-		struct blk_mq_hw_ctx *hctx = q->queue_hw_ctx[queue_num];
 		int ret;
 
 		hctx->poll_invoked++;
@@ -3878,6 +3971,8 @@ bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 		ret = q->mq_ops->poll(hctx, blk_qc_t_to_tag(cookie));
 		if (ret > 0) {
 			hctx->poll_success++;
+			blk_poll_stat_add(q, bucket, ktime_to_ns(
+				ktime_sub(ktime_get(), rq->poll_start)));
 			set_current_state(TASK_RUNNING);
 			return true;
 		}
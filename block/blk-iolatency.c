@@ -0,0 +1,409 @@
+/*
+ * Block cgroup I/O latency targets
+ *
+ * Each blkcg may declare the completion latency its I/O should see in
+ * blkio.latency_target. Latency is sampled per group and device over a
+ * window; when a group misses its target, every group on the device with
+ * a looser target, or with none, has the number of bios it may have in
+ * flight halved each window until the protected group recovers, then
+ * doubled back each window. This keeps background writers such as
+ * dex2oat or backups from filling the device queue under the foreground.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/blk-cgroup.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include "blk.h"
+
+/* Latency sampling and depth adjustment window */
+static unsigned int iolat_window_ms = 100;
+module_param_named(window_ms, iolat_window_ms, uint, 0644);
+
+/* Below that many completions a window says nothing about the latency */
+#define IOLAT_MIN_SAMPLES	4
+
+#define IOLAT_DEPTH_MAX		UINT_MAX
+
+static struct blkcg_policy blkcg_policy_iolatency;
+
+struct iolat_cgrp {
+	struct blkcg_policy_data	cpd;
+	/* target completion latency in usecs, 0 for none */
+	u64				target_us;
+};
+
+struct iolat_grp {
+	/* must be the first member */
+	struct blkg_policy_data		pd;
+
+	spinlock_t			lock;
+
+	/* bios in flight and how many may be */
+	atomic_t			inflight;
+	unsigned int			max_depth;
+	unsigned long			depth_stamp;
+	wait_queue_head_t		wait;
+
+	/* current window */
+	unsigned long			win_start;
+	u64				win_lat_sum;
+	unsigned int			win_nr;
+
+	/*
+	 * Queue wide, on the root group only: the tightest target missed
+	 * and when it last was.
+	 */
+	u64				missed_target;
+	unsigned long			missed_stamp;
+
+	/* stats */
+	u64				last_mean;
+	u64				nr_done;
+	u64				nr_missed;
+	u64				nr_throttled;
+};
+
+static inline struct iolat_cgrp *cpd_to_iolat(struct blkcg_policy_data *cpd)
+{
+	return cpd ? container_of(cpd, struct iolat_cgrp, cpd) : NULL;
+}
+
+static inline struct iolat_grp *pd_to_iolat(struct blkg_policy_data *pd)
+{
+	return pd ? container_of(pd, struct iolat_grp, pd) : NULL;
+}
+
+static inline struct iolat_grp *blkg_to_iolat(struct blkcg_gq *blkg)
+{
+	return pd_to_iolat(blkg_to_pd(blkg, &blkcg_policy_iolatency));
+}
+
+static u64 iolat_target_ns(struct blkcg_gq *blkg)
+{
+	struct iolat_cgrp *ic;
+
+	ic = cpd_to_iolat(blkcg_to_cpd(blkg->blkcg, &blkcg_policy_iolatency));
+	return ic ? READ_ONCE(ic->target_us) * NSEC_PER_USEC : 0;
+}
+
+static unsigned long iolat_window(void)
+{
+	return max(msecs_to_jiffies(READ_ONCE(iolat_window_ms)), 1UL);
+}
+
+/*
+ * Whether a group with @target, 0 meaning none, should give way because a
+ * group with a tighter one is missing it.
+ */
+static bool iolat_under_pressure(struct iolat_grp *root, u64 target)
+{
+	unsigned long flags;
+	bool ret;
+
+	spin_lock_irqsave(&root->lock, flags);
+	ret = root->missed_target &&
+	      time_before(jiffies, root->missed_stamp + 2 * iolat_window()) &&
+	      (!target || target > root->missed_target);
+	spin_unlock_irqrestore(&root->lock, flags);
+
+	return ret;
+}
+
+/* Halve or double the allowed depth of @blkg, at most once per window */
+static void iolat_update_depth(struct blkcg_gq *blkg, struct iolat_grp *iolat)
+{
+	struct iolat_grp *root = blkg_to_iolat(blkg->q->root_blkg);
+	unsigned int full = max(blkg->q->nr_requests, 2UL);
+	unsigned long flags;
+	bool pressure;
+
+	if (time_before(jiffies, READ_ONCE(iolat->depth_stamp) + iolat_window()))
+		return;
+
+	pressure = iolat_under_pressure(root, iolat_target_ns(blkg));
+
+	spin_lock_irqsave(&iolat->lock, flags);
+	if (time_before(jiffies, iolat->depth_stamp + iolat_window()))
+		goto out;
+	iolat->depth_stamp = jiffies;
+
+	if (pressure) {
+		if (iolat->max_depth == IOLAT_DEPTH_MAX)
+			iolat->max_depth = full;
+		iolat->max_depth = max(iolat->max_depth / 2, 1U);
+	} else if (iolat->max_depth != IOLAT_DEPTH_MAX) {
+		iolat->max_depth *= 2;
+		if (iolat->max_depth >= full)
+			iolat->max_depth = IOLAT_DEPTH_MAX;
+		wake_up_all(&iolat->wait);
+	}
+out:
+	spin_unlock_irqrestore(&iolat->lock, flags);
+}
+
+static bool iolat_inflight_inc(struct iolat_grp *iolat)
+{
+	unsigned int depth = READ_ONCE(iolat->max_depth);
+	int cur, old;
+
+	if (depth == IOLAT_DEPTH_MAX) {
+		atomic_inc(&iolat->inflight);
+		return true;
+	}
+
+	cur = atomic_read(&iolat->inflight);
+	for (;;) {
+		if (cur >= depth)
+			return false;
+		old = atomic_cmpxchg(&iolat->inflight, cur, cur + 1);
+		if (old == cur)
+			return true;
+		cur = old;
+	}
+}
+
+/**
+ * blk_iolatency_throttle - account and throttle a bio about to be issued
+ * @q: the request queue
+ * @blkg: the group issuing it, with a reference the bio takes over
+ * @bio: the bio
+ *
+ * Waits for the group to be below its allowed depth unless the bio is
+ * metadata, or is issued from within a make_request_fn where waiting
+ * could block on bios this task has yet to submit.
+ */
+void blk_iolatency_throttle(struct request_queue *q, struct blkcg_gq *blkg,
+			    struct bio *bio)
+{
+	struct iolat_grp *iolat = blkg_to_iolat(blkg);
+	DEFINE_WAIT(wait);
+
+	if (!iolat || bio->bi_iolat_blkg || !queue_is_rq_based(q)) {
+		blkg_put(blkg);
+		return;
+	}
+
+	iolat_update_depth(blkg, iolat);
+
+	if (current->bio_list || (bio->bi_rw & (REQ_META | REQ_PRIO))) {
+		atomic_inc(&iolat->inflight);
+	} else if (!iolat_inflight_inc(iolat)) {
+		iolat->nr_throttled++;
+		for (;;) {
+			prepare_to_wait_exclusive(&iolat->wait, &wait,
+						  TASK_UNINTERRUPTIBLE);
+			if (iolat_inflight_inc(iolat))
+				break;
+			io_schedule();
+			iolat_update_depth(blkg, iolat);
+		}
+		finish_wait(&iolat->wait, &wait);
+	}
+
+	bio->bi_iolat_blkg = blkg;
+	bio->bi_iolat_start = ktime_get_ns();
+}
+
+static void iolat_account(struct blkcg_gq *blkg, struct iolat_grp *iolat,
+			  u64 lat, u64 target)
+{
+	struct iolat_grp *root;
+	unsigned long flags;
+	unsigned int nr;
+	u64 mean;
+
+	spin_lock_irqsave(&iolat->lock, flags);
+	iolat->win_lat_sum += lat;
+	iolat->win_nr++;
+	if (time_before(jiffies, iolat->win_start + iolat_window())) {
+		spin_unlock_irqrestore(&iolat->lock, flags);
+		return;
+	}
+
+	nr = iolat->win_nr;
+	mean = div_u64(iolat->win_lat_sum, nr);
+	iolat->last_mean = mean;
+	iolat->win_start = jiffies;
+	iolat->win_lat_sum = 0;
+	iolat->win_nr = 0;
+	if (nr < IOLAT_MIN_SAMPLES || mean <= target) {
+		spin_unlock_irqrestore(&iolat->lock, flags);
+		return;
+	}
+	iolat->nr_missed++;
+	spin_unlock_irqrestore(&iolat->lock, flags);
+
+	root = blkg_to_iolat(blkg->q->root_blkg);
+	spin_lock_irqsave(&root->lock, flags);
+	if (!root->missed_target || target < root->missed_target ||
+	    time_after_eq(jiffies, root->missed_stamp + 2 * iolat_window()))
+		root->missed_target = target;
+	root->missed_stamp = jiffies;
+	spin_unlock_irqrestore(&root->lock, flags);
+}
+
+/* Called from bio_endio() once the bio is done */
+void blk_iolatency_done(struct bio *bio)
+{
+	struct blkcg_gq *blkg = bio->bi_iolat_blkg;
+	struct iolat_grp *iolat;
+	u64 target;
+
+	if (!blkg)
+		return;
+	bio->bi_iolat_blkg = NULL;
+
+	iolat = blkg_to_iolat(blkg);
+	atomic_dec(&iolat->inflight);
+	if (waitqueue_active(&iolat->wait))
+		wake_up(&iolat->wait);
+
+	iolat->nr_done++;
+	target = iolat_target_ns(blkg);
+	if (target)
+		iolat_account(blkg, iolat, ktime_get_ns() - bio->bi_iolat_start,
+			      target);
+
+	blkg_put(blkg);
+}
+
+static u64 iolat_prfill_stat(struct seq_file *sf, struct blkg_policy_data *pd,
+			     int off)
+{
+	struct iolat_grp *iolat = pd_to_iolat(pd);
+	const char *dname = blkg_dev_name(pd->blkg);
+	unsigned int depth = READ_ONCE(iolat->max_depth);
+
+	if (!dname)
+		return 0;
+
+	seq_printf(sf, "%s mean_us=%llu done=%llu missed=%llu throttled=%llu",
+		   dname, div_u64(iolat->last_mean, NSEC_PER_USEC),
+		   iolat->nr_done, iolat->nr_missed, iolat->nr_throttled);
+	if (depth == IOLAT_DEPTH_MAX)
+		seq_puts(sf, " depth=max\n");
+	else
+		seq_printf(sf, " depth=%u\n", depth);
+	return 0;
+}
+
+static int iolat_print_stat(struct seq_file *sf, void *v)
+{
+	blkcg_print_blkgs(sf, css_to_blkcg(seq_css(sf)), iolat_prfill_stat,
+			  &blkcg_policy_iolatency, 0, false);
+	return 0;
+}
+
+static u64 iolat_read_target(struct cgroup_subsys_state *css,
+			     struct cftype *cft)
+{
+	struct blkcg *blkcg = css_to_blkcg(css);
+
+	return cpd_to_iolat(blkcg_to_cpd(blkcg,
+					 &blkcg_policy_iolatency))->target_us;
+}
+
+static int iolat_write_target(struct cgroup_subsys_state *css,
+			      struct cftype *cft, u64 val)
+{
+	struct blkcg *blkcg = css_to_blkcg(css);
+
+	if (val > USEC_PER_SEC * 10)
+		return -EINVAL;
+
+	WRITE_ONCE(cpd_to_iolat(blkcg_to_cpd(blkcg,
+				&blkcg_policy_iolatency))->target_us, val);
+	return 0;
+}
+
+static struct cftype iolat_legacy_files[] = {
+	{
+		.name = "latency_target",
+		.read_u64 = iolat_read_target,
+		.write_u64 = iolat_write_target,
+	},
+	{
+		.name = "latency_stat",
+		.seq_show = iolat_print_stat,
+	},
+	{ }	/* terminate */
+};
+
+static struct blkcg_policy_data *iolat_cpd_alloc(gfp_t gfp)
+{
+	struct iolat_cgrp *ic;
+
+	ic = kzalloc(sizeof(*ic), gfp);
+	if (!ic)
+		return NULL;
+	return &ic->cpd;
+}
+
+static void iolat_cpd_free(struct blkcg_policy_data *cpd)
+{
+	kfree(cpd_to_iolat(cpd));
+}
+
+static struct blkg_policy_data *iolat_pd_alloc(gfp_t gfp, int node)
+{
+	struct iolat_grp *iolat;
+
+	iolat = kzalloc_node(sizeof(*iolat), gfp, node);
+	if (!iolat)
+		return NULL;
+
+	spin_lock_init(&iolat->lock);
+	atomic_set(&iolat->inflight, 0);
+	init_waitqueue_head(&iolat->wait);
+	iolat->max_depth = IOLAT_DEPTH_MAX;
+	iolat->depth_stamp = jiffies;
+	iolat->win_start = jiffies;
+
+	return &iolat->pd;
+}
+
+static void iolat_pd_offline(struct blkg_policy_data *pd)
+{
+	struct iolat_grp *iolat = pd_to_iolat(pd);
+
+	/* nobody adjusts the depth anymore, let the waiters go */
+	iolat->max_depth = IOLAT_DEPTH_MAX;
+	wake_up_all(&iolat->wait);
+}
+
+static void iolat_pd_free(struct blkg_policy_data *pd)
+{
+	kfree(pd_to_iolat(pd));
+}
+
+static struct blkcg_policy blkcg_policy_iolatency = {
+	.legacy_cftypes		= iolat_legacy_files,
+
+	.cpd_alloc_fn		= iolat_cpd_alloc,
+	.cpd_free_fn		= iolat_cpd_free,
+
+	.pd_alloc_fn		= iolat_pd_alloc,
+	.pd_offline_fn		= iolat_pd_offline,
+	.pd_free_fn		= iolat_pd_free,
+};
+
+int blk_iolatency_init(struct request_queue *q)
+{
+	return blkcg_activate_policy(q, &blkcg_policy_iolatency);
+}
+
+void blk_iolatency_exit(struct request_queue *q)
+{
+	blkcg_deactivate_policy(q, &blkcg_policy_iolatency);
+}
+
+static int __init iolatency_init(void)
+{
+	return blkcg_policy_register(&blkcg_policy_iolatency);
+}
+
+module_init(iolatency_init);
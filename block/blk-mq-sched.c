@@ -0,0 +1,213 @@
+/*
+ * blk-mq dispatch ordering schedulers
+ *
+ * A blk-mq queue can have a scheduler attached through the same
+ * queue/scheduler sysfs file legacy queues use to switch elevators, "none"
+ * detaching it again. See struct blk_mq_sched_ops for the hooks.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/blktrace_api.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "blk.h"
+#include "blk-mq.h"
+#include "blk-mq-sched.h"
+
+static LIST_HEAD(mq_sched_list);
+static DEFINE_SPINLOCK(mq_sched_list_lock);
+
+static struct blk_mq_sched_ops *blk_mq_sched_find(const char *name)
+{
+	struct blk_mq_sched_ops *ops;
+
+	list_for_each_entry(ops, &mq_sched_list, list) {
+		if (!strcmp(ops->name, name))
+			return ops;
+	}
+
+	return NULL;
+}
+
+static struct blk_mq_sched_ops *blk_mq_sched_get(const char *name)
+{
+	struct blk_mq_sched_ops *ops;
+
+	spin_lock(&mq_sched_list_lock);
+	ops = blk_mq_sched_find(name);
+	if (ops && !try_module_get(ops->owner))
+		ops = NULL;
+	spin_unlock(&mq_sched_list_lock);
+
+	return ops;
+}
+
+int blk_mq_sched_register(struct blk_mq_sched_ops *ops)
+{
+	int ret = 0;
+
+	spin_lock(&mq_sched_list_lock);
+	if (blk_mq_sched_find(ops->name))
+		ret = -EBUSY;
+	else
+		list_add_tail(&ops->list, &mq_sched_list);
+	spin_unlock(&mq_sched_list_lock);
+
+	if (!ret)
+		pr_info("blk-mq: scheduler %s registered\n", ops->name);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(blk_mq_sched_register);
+
+void blk_mq_sched_unregister(struct blk_mq_sched_ops *ops)
+{
+	spin_lock(&mq_sched_list_lock);
+	list_del_init(&ops->list);
+	spin_unlock(&mq_sched_list_lock);
+}
+EXPORT_SYMBOL_GPL(blk_mq_sched_unregister);
+
+static void blk_mq_sched_exit_hctxs(struct request_queue *q,
+				    struct blk_mq_sched_ops *ops,
+				    unsigned int nr)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (i == nr)
+			break;
+		ops->exit_hctx(hctx);
+		hctx->sched_data = NULL;
+	}
+}
+
+static int blk_mq_sched_init_hctxs(struct request_queue *q,
+				   struct blk_mq_sched_ops *ops)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+	int ret;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		ret = ops->init_hctx(hctx);
+		if (ret) {
+			blk_mq_sched_exit_hctxs(q, ops, i);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Switch with an empty queue: freezing it waits for all the requests a
+ * scheduler may hold to complete, stopping it keeps runs triggered by
+ * other queues sharing the tag set away. Queue runs either happen with
+ * preemption disabled or from the run/delay work.
+ */
+static int blk_mq_sched_switch(struct request_queue *q,
+			       struct blk_mq_sched_ops *new)
+{
+	struct blk_mq_sched_ops *old = q->mq_sched;
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+	int ret = 0;
+
+	blk_mq_freeze_queue(q);
+	blk_mq_stop_hw_queues(q);
+	queue_for_each_hw_ctx(q, hctx, i) {
+		cancel_delayed_work_sync(&hctx->run_work);
+		cancel_delayed_work_sync(&hctx->delay_work);
+	}
+	synchronize_sched();
+
+	if (new) {
+		ret = blk_mq_sched_init_hctxs(q, new);
+		if (ret)
+			goto out;
+	}
+
+	q->mq_sched = new;
+	if (old) {
+		blk_mq_sched_exit_hctxs(q, old, q->nr_hw_queues);
+		module_put(old->owner);
+	}
+
+	blk_add_trace_msg(q, "mq sched switch: %s", new ? new->name : "none");
+out:
+	blk_mq_start_stopped_hw_queues(q, true);
+	blk_mq_unfreeze_queue(q);
+	return ret;
+}
+
+ssize_t blk_mq_sched_store(struct request_queue *q, const char *name,
+			   size_t count)
+{
+	char sched_name[ELV_NAME_MAX];
+	struct blk_mq_sched_ops *ops = NULL;
+	int ret;
+
+	strlcpy(sched_name, name, sizeof(sched_name));
+	strstrip(sched_name);
+
+	if (strcmp(sched_name, "none")) {
+		ops = blk_mq_sched_get(sched_name);
+		if (!ops)
+			return -EINVAL;
+	}
+
+	if (ops == q->mq_sched) {
+		if (ops)
+			module_put(ops->owner);
+		return count;
+	}
+
+	ret = blk_mq_sched_switch(q, ops);
+	if (ret) {
+		if (ops)
+			module_put(ops->owner);
+		pr_err("blk-mq: switch to %s failed\n", sched_name);
+		return ret;
+	}
+
+	return count;
+}
+
+ssize_t blk_mq_sched_show(struct request_queue *q, char *page)
+{
+	struct blk_mq_sched_ops *cur = q->mq_sched;
+	struct blk_mq_sched_ops *ops;
+	int len;
+
+	len = sprintf(page, cur ? "none " : "[none] ");
+
+	spin_lock(&mq_sched_list_lock);
+	list_for_each_entry(ops, &mq_sched_list, list) {
+		if (ops == cur)
+			len += sprintf(page + len, "[%s] ", ops->name);
+		else
+			len += sprintf(page + len, "%s ", ops->name);
+	}
+	spin_unlock(&mq_sched_list_lock);
+
+	len += sprintf(page + len, "\n");
+	return len;
+}
+
+/* Called on queue teardown, once all of its requests are gone */
+void blk_mq_sched_exit(struct request_queue *q)
+{
+	struct blk_mq_sched_ops *ops = q->mq_sched;
+
+	if (!ops)
+		return;
+
+	q->mq_sched = NULL;
+	blk_mq_sched_exit_hctxs(q, ops, q->nr_hw_queues);
+	module_put(ops->owner);
+}
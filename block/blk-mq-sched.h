@@ -0,0 +1,18 @@
+#ifndef INT_BLK_MQ_SCHED_H
+#define INT_BLK_MQ_SCHED_H
+
+#include <linux/blk-mq.h>
+
+ssize_t blk_mq_sched_show(struct request_queue *q, char *page);
+ssize_t blk_mq_sched_store(struct request_queue *q, const char *name,
+			   size_t count);
+void blk_mq_sched_exit(struct request_queue *q);
+
+static inline bool blk_mq_sched_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	struct blk_mq_sched_ops *ops = hctx->queue->mq_sched;
+
+	return ops && ops->has_work(hctx);
+}
+
+#endif
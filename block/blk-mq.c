@@ -29,6 +29,7 @@
 #include "blk.h"
 #include "blk-mq.h"
 #include "blk-mq-tag.h"
+#include "blk-mq-sched.h"
 
 static DEFINE_MUTEX(all_q_mutex);
 static LIST_HEAD(all_q_list);
@@ -743,6 +744,7 @@ static void flush_busy_ctxs(struct blk_mq_hw_ctx *hctx, struct list_head *list)
 static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
 {
 	struct request_queue *q = hctx->queue;
+	struct blk_mq_sched_ops *sched = q->mq_sched;
 	struct request *rq;
 	LIST_HEAD(rq_list);
 	LIST_HEAD(driver_list);
@@ -761,6 +763,13 @@ static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
 	 */
 	flush_busy_ctxs(hctx, &rq_list);
 
+	/*
+	 * With a scheduler attached it decides the order of everything new,
+	 * only the requests the driver bounced before bypass it below.
+	 */
+	if (sched && !list_empty(&rq_list))
+		sched->insert_requests(hctx, &rq_list);
+
 	/*
 	 * If we have previous entries on our dispatch list, grab them
 	 * and stuff them at the front for more fair dispatch.
@@ -782,16 +791,21 @@ static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
 	 * Now process all the entries, sending them to the driver.
 	 */
 	queued = 0;
-	while (!list_empty(&rq_list)) {
+	while (1) {
 		struct blk_mq_queue_data bd;
 		int ret;
 
-		rq = list_first_entry(&rq_list, struct request, queuelist);
-		list_del_init(&rq->queuelist);
+		if (!list_empty(&rq_list)) {
+			rq = list_first_entry(&rq_list, struct request,
+					      queuelist);
+			list_del_init(&rq->queuelist);
+		} else if (!sched || !(rq = sched->dispatch_request(hctx))) {
+			break;
+		}
 
 		bd.rq = rq;
 		bd.list = dptr;
-		bd.last = list_empty(&rq_list);
+		bd.last = list_empty(&rq_list) && !blk_mq_sched_has_work(hctx);
 
 		ret = q->mq_ops->queue_rq(hctx, &bd);
 		switch (ret) {
@@ -900,7 +914,8 @@ void blk_mq_run_hw_queues(struct request_queue *q, bool async)
 
 	queue_for_each_hw_ctx(q, hctx, i) {
 		if ((!blk_mq_hctx_has_pending(hctx) &&
-		    list_empty_careful(&hctx->dispatch)) ||
+		    list_empty_careful(&hctx->dispatch) &&
+		    !blk_mq_sched_has_work(hctx)) ||
 		    test_bit(BLK_MQ_S_STOPPED, &hctx->state))
 			continue;
 
@@ -1299,7 +1314,7 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 	 * CPU this way.
 	 */
 	if (((plug && !blk_queue_nomerges(q)) || is_sync) &&
-	    !(data.hctx->flags & BLK_MQ_F_DEFER_ISSUE)) {
+	    !(data.hctx->flags & BLK_MQ_F_DEFER_ISSUE) && !q->mq_sched) {
 		struct request *old_rq = NULL;
 
 		blk_mq_bio_to_request(rq, bio);
@@ -2112,6 +2127,7 @@ void blk_mq_free_queue(struct request_queue *q)
 
 	blk_mq_del_queue_tag_set(q);
 
+	blk_mq_sched_exit(q);
 	blk_mq_exit_hw_queues(q, set, set->nr_hw_queues);
 	blk_mq_free_hw_queues(q, set);
 }
@@ -468,6 +468,39 @@ static struct queue_sysfs_entry queue_iostats_entry = {
 	.store = queue_store_iostats,
 };
 
+/* In usecs, -1 for classic polling and 0 for the adaptive hybrid mode */
+static ssize_t queue_poll_delay_show(struct request_queue *q, char *page)
+{
+	int val = q->poll_nsec;
+
+	if (val > 0)
+		val /= NSEC_PER_USEC;
+
+	return sprintf(page, "%d\n", val);
+}
+
+static ssize_t queue_poll_delay_store(struct request_queue *q,
+				      const char *page, size_t count)
+{
+	int err, val;
+
+	if (!q->mq_ops || !q->mq_ops->poll)
+		return -EINVAL;
+
+	err = kstrtoint(page, 10, &val);
+	if (err < 0)
+		return err;
+
+	if (val < -1 || val > INT_MAX / NSEC_PER_USEC)
+		return -EINVAL;
+
+	if (val > 0)
+		val *= NSEC_PER_USEC;
+	q->poll_nsec = val;
+
+	return count;
+}
+
 static struct queue_sysfs_entry queue_random_entry = {
 	.attr = {.name = "add_random", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_show_random,
@@ -480,6 +513,12 @@ static struct queue_sysfs_entry queue_poll_entry = {
 	.store = queue_poll_store,
 };
 
+static struct queue_sysfs_entry queue_poll_delay_entry = {
+	.attr = {.name = "io_poll_delay", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_poll_delay_show,
+	.store = queue_poll_delay_store,
+};
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -505,6 +544,7 @@ static struct attribute *default_attrs[] = {
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
 	&queue_poll_entry.attr,
+	&queue_poll_delay_entry.attr,
 	NULL,
 };
 
@@ -310,4 +310,14 @@ static inline int blk_throtl_init(struct request_queue *q) { return 0; }
 static inline void blk_throtl_exit(struct request_queue *q) { }
 #endif /* CONFIG_BLK_DEV_THROTTLING */
 
+#ifdef CONFIG_BLK_CGROUP_IOLATENCY
+extern int blk_iolatency_init(struct request_queue *q);
+extern void blk_iolatency_exit(struct request_queue *q);
+extern void blk_iolatency_done(struct bio *bio);
+#else
+static inline int blk_iolatency_init(struct request_queue *q) { return 0; }
+static inline void blk_iolatency_exit(struct request_queue *q) { }
+static inline void blk_iolatency_done(struct bio *bio) { }
+#endif /* CONFIG_BLK_CGROUP_IOLATENCY */
+
 #endif /* BLK_INTERNAL_H */
@@ -12,6 +12,7 @@
  * expirations when power is suspended to decrease workload.
  */
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/elevator.h>
 #include <linux/bio.h>
 #include <linux/module.h>
@@ -436,16 +437,266 @@ static struct elevator_type iosched_maple = {
 	.elevator_owner = THIS_MODULE,
 };
 
+/*
+ * blk-mq version. The same fifo deadlines, read bias and display state
+ * dependent expiry, applied per hardware queue to the requests blk-mq
+ * pulls from its software queues. There is no elevator directory on mq
+ * queues, so the tunables are module parameters, in ms like the legacy
+ * sysfs entries, shared by all the queues using it.
+ */
+static unsigned int mq_fifo_expire[2][2] = {
+	[ASYNC] = { [READ] = 500, [WRITE] = 2000 },
+	[SYNC] = { [READ] = 250, [WRITE] = 1250 },
+};
+module_param_named(mq_async_read_expire, mq_fifo_expire[ASYNC][READ],
+		   uint, 0644);
+module_param_named(mq_async_write_expire, mq_fifo_expire[ASYNC][WRITE],
+		   uint, 0644);
+module_param_named(mq_sync_read_expire, mq_fifo_expire[SYNC][READ],
+		   uint, 0644);
+module_param_named(mq_sync_write_expire, mq_fifo_expire[SYNC][WRITE],
+		   uint, 0644);
+
+static unsigned int mq_fifo_batch = fifo_batch;
+module_param(mq_fifo_batch, uint, 0644);
+
+static unsigned int mq_writes_starved = writes_starved;
+module_param(mq_writes_starved, uint, 0644);
+
+static unsigned int mq_sleep_latency_multiple = sleep_latency_multiple;
+module_param(mq_sleep_latency_multiple, uint, 0644);
+
+/* Display state for all the mq queues */
+static bool mq_display_on = true;
+
+struct maple_mq_data {
+	spinlock_t lock;
+
+	/* flushes and non fs requests, dispatched first */
+	struct list_head prio_list;
+	struct list_head fifo_list[2][2];
+
+	unsigned int batched;
+	unsigned int starved;
+};
+
+static int maple_mq_init_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	struct maple_mq_data *md;
+
+	md = kzalloc_node(sizeof(*md), GFP_KERNEL, hctx->numa_node);
+	if (!md)
+		return -ENOMEM;
+
+	spin_lock_init(&md->lock);
+	INIT_LIST_HEAD(&md->prio_list);
+	INIT_LIST_HEAD(&md->fifo_list[SYNC][READ]);
+	INIT_LIST_HEAD(&md->fifo_list[SYNC][WRITE]);
+	INIT_LIST_HEAD(&md->fifo_list[ASYNC][READ]);
+	INIT_LIST_HEAD(&md->fifo_list[ASYNC][WRITE]);
+	hctx->sched_data = md;
+
+	return 0;
+}
+
+static void maple_mq_exit_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	kfree(hctx->sched_data);
+}
+
+static void maple_mq_insert_requests(struct blk_mq_hw_ctx *hctx,
+				     struct list_head *list)
+{
+	struct maple_mq_data *md = hctx->sched_data;
+	struct request *rq, *next;
+
+	spin_lock(&md->lock);
+	list_for_each_entry_safe(rq, next, list, queuelist) {
+		const int sync = rq_is_sync(rq);
+		const int dir = rq_data_dir(rq);
+		unsigned long expire;
+
+		if (rq->cmd_type != REQ_TYPE_FS ||
+		    (rq->cmd_flags & (REQ_FLUSH | REQ_FUA))) {
+			list_move_tail(&rq->queuelist, &md->prio_list);
+			continue;
+		}
+
+		/* increase expiration when device is asleep */
+		expire = READ_ONCE(mq_fifo_expire[sync][dir]);
+		if (!READ_ONCE(mq_display_on))
+			expire *= READ_ONCE(mq_sleep_latency_multiple);
+
+		rq->fifo_time = jiffies + msecs_to_jiffies(expire);
+		list_move_tail(&rq->queuelist, &md->fifo_list[sync][dir]);
+	}
+	spin_unlock(&md->lock);
+}
+
+static struct request *maple_mq_expired(struct maple_mq_data *md, int sync,
+					int dir)
+{
+	struct list_head *list = &md->fifo_list[sync][dir];
+	struct request *rq;
+
+	if (list_empty(list))
+		return NULL;
+
+	rq = rq_entry_fifo(list->next);
+	if (time_after_eq(jiffies, rq->fifo_time))
+		return rq;
+
+	return NULL;
+}
+
+/* Of two expired requests of one direction, pick the one expired first */
+static struct request *maple_mq_older(struct request *a, struct request *b)
+{
+	if (!a)
+		return b;
+	if (!b || time_before_eq(a->fifo_time, b->fifo_time))
+		return a;
+	return b;
+}
+
+static struct request *maple_mq_choose_expired(struct maple_mq_data *md)
+{
+	struct request *rq;
+
+	md->batched = 0;
+
+	/* Read requests have priority over write */
+	rq = maple_mq_older(maple_mq_expired(md, SYNC, READ),
+			    maple_mq_expired(md, ASYNC, READ));
+	if (rq)
+		return rq;
+
+	return maple_mq_older(maple_mq_expired(md, SYNC, WRITE),
+			      maple_mq_expired(md, ASYNC, WRITE));
+}
+
+static struct request *maple_mq_choose(struct maple_mq_data *md, int dir)
+{
+	md->batched++;
+
+	/* Sync requests have priority over async, the given direction first */
+	if (!list_empty(&md->fifo_list[SYNC][dir]))
+		return rq_entry_fifo(md->fifo_list[SYNC][dir].next);
+	if (!list_empty(&md->fifo_list[ASYNC][dir]))
+		return rq_entry_fifo(md->fifo_list[ASYNC][dir].next);
+	if (!list_empty(&md->fifo_list[SYNC][!dir]))
+		return rq_entry_fifo(md->fifo_list[SYNC][!dir].next);
+	if (!list_empty(&md->fifo_list[ASYNC][!dir]))
+		return rq_entry_fifo(md->fifo_list[ASYNC][!dir].next);
+
+	return NULL;
+}
+
+static struct request *maple_mq_dispatch_request(struct blk_mq_hw_ctx *hctx)
+{
+	struct maple_mq_data *md = hctx->sched_data;
+	struct request *rq = NULL;
+	int dir = READ;
+
+	spin_lock(&md->lock);
+	if (!list_empty(&md->prio_list)) {
+		rq = rq_entry_fifo(md->prio_list.next);
+		rq_fifo_clear(rq);
+		goto out;
+	}
+
+	/* Retrieve any expired request after a batch of sequential requests */
+	if (md->batched >= READ_ONCE(mq_fifo_batch))
+		rq = maple_mq_choose_expired(md);
+
+	if (!rq) {
+		/* Treat writes fairly while suspended, otherwise starve them */
+		if (md->starved >= (READ_ONCE(mq_display_on) ?
+				    READ_ONCE(mq_writes_starved) : 1))
+			dir = WRITE;
+
+		rq = maple_mq_choose(md, dir);
+		if (!rq)
+			goto out;
+	}
+
+	rq_fifo_clear(rq);
+	if (rq_data_dir(rq))
+		md->starved = 0;
+	else if (!list_empty(&md->fifo_list[SYNC][WRITE]) ||
+		 !list_empty(&md->fifo_list[ASYNC][WRITE]))
+		md->starved++;
+out:
+	spin_unlock(&md->lock);
+	return rq;
+}
+
+static bool maple_mq_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	struct maple_mq_data *md = hctx->sched_data;
+
+	return !list_empty_careful(&md->prio_list) ||
+		!list_empty_careful(&md->fifo_list[SYNC][READ]) ||
+		!list_empty_careful(&md->fifo_list[SYNC][WRITE]) ||
+		!list_empty_careful(&md->fifo_list[ASYNC][READ]) ||
+		!list_empty_careful(&md->fifo_list[ASYNC][WRITE]);
+}
+
+static struct blk_mq_sched_ops mq_sched_maple = {
+	.init_hctx		= maple_mq_init_hctx,
+	.exit_hctx		= maple_mq_exit_hctx,
+	.insert_requests	= maple_mq_insert_requests,
+	.dispatch_request	= maple_mq_dispatch_request,
+	.has_work		= maple_mq_has_work,
+	.name			= "maple",
+	.owner			= THIS_MODULE,
+};
+
+static int mq_fb_notifier_callback(struct notifier_block *self,
+				   unsigned long event, void *data)
+{
+	struct fb_event *evdata = data;
+	int *blank;
+
+	if (evdata && evdata->data && event == FB_EVENT_BLANK) {
+		blank = evdata->data;
+		switch (*blank) {
+		case FB_BLANK_UNBLANK:
+			WRITE_ONCE(mq_display_on, true);
+			break;
+		case FB_BLANK_POWERDOWN:
+		case FB_BLANK_HSYNC_SUSPEND:
+		case FB_BLANK_VSYNC_SUSPEND:
+		case FB_BLANK_NORMAL:
+			WRITE_ONCE(mq_display_on, false);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static struct notifier_block mq_fb_notifier = {
+	.notifier_call = mq_fb_notifier_callback,
+};
+
 static int __init maple_init(void)
 {
 	/* Register elevator */
 	elv_register(&iosched_maple);
 
+	fb_register_client(&mq_fb_notifier);
+	if (blk_mq_sched_register(&mq_sched_maple))
+		pr_err("maple: failed to register the blk-mq scheduler\n");
+
 	return 0;
 }
 
 static void __exit maple_exit(void)
 {
+	blk_mq_sched_unregister(&mq_sched_maple);
+	fb_unregister_client(&mq_fb_notifier);
+
 	/* Unregister elevator */
 	elv_unregister(&iosched_maple);
 }
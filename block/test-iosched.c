@@ -996,6 +996,7 @@ static int test_dispatch_from(struct request_queue *q,
 		spin_unlock_irqrestore(&tios->lock, flags);
 
 		print_req(rq);
+		test_rq->dispatch_time = ktime_get();
 		elv_dispatch_sort(q, rq);
 		tios->test_info.test_byte_count += test_rq->buf_size;
 		ret = 1;
@@ -0,0 +1,183 @@
+/*
+ * Cryptographic API.
+ *
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+#define ZSTD_DEF_LEVEL	3
+
+/*
+ * Compression level used by newly allocated transforms. The workspace of
+ * each transform is sized for the level it was created with, so a change
+ * only takes effect for transforms allocated afterwards, for example when
+ * a zram device is reset and its comp_algorithm is set again.
+ */
+static int compression_level = ZSTD_DEF_LEVEL;
+module_param(compression_level, int, 0644);
+MODULE_PARM_DESC(compression_level, "Compression level (1-22)");
+
+struct zstd_ctx {
+	ZSTD_CCtx *cctx;
+	ZSTD_DCtx *dctx;
+	void *cwksp;
+	void *dwksp;
+	ZSTD_parameters params;
+};
+
+/*
+ * Most users compress one page at a time (zram, zswap), so tune the window
+ * for that. Larger inputs still compress correctly, just with a smaller
+ * match window, while the workspace stays small enough to keep one per CPU.
+ */
+static ZSTD_parameters zstd_params(void)
+{
+	int level = clamp(READ_ONCE(compression_level), 1, ZSTD_maxCLevel());
+
+	return ZSTD_getParams(level, PAGE_SIZE, 0);
+}
+
+static int zstd_comp_init(struct zstd_ctx *ctx)
+{
+	const size_t wksp_size = ZSTD_CCtxWorkspaceBound(ctx->params.cParams);
+
+	ctx->cwksp = vzalloc(wksp_size);
+	if (!ctx->cwksp)
+		return -ENOMEM;
+
+	ctx->cctx = ZSTD_initCCtx(ctx->cwksp, wksp_size);
+	if (!ctx->cctx) {
+		vfree(ctx->cwksp);
+		ctx->cwksp = NULL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int zstd_decomp_init(struct zstd_ctx *ctx)
+{
+	const size_t wksp_size = ZSTD_DCtxWorkspaceBound();
+
+	ctx->dwksp = vzalloc(wksp_size);
+	if (!ctx->dwksp)
+		return -ENOMEM;
+
+	ctx->dctx = ZSTD_initDCtx(ctx->dwksp, wksp_size);
+	if (!ctx->dctx) {
+		vfree(ctx->dwksp);
+		ctx->dwksp = NULL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void zstd_comp_exit(struct zstd_ctx *ctx)
+{
+	vfree(ctx->cwksp);
+	ctx->cwksp = NULL;
+	ctx->cctx = NULL;
+}
+
+static void zstd_decomp_exit(struct zstd_ctx *ctx)
+{
+	vfree(ctx->dwksp);
+	ctx->dwksp = NULL;
+	ctx->dctx = NULL;
+}
+
+static int zstd_init(struct crypto_tfm *tfm)
+{
+	struct zstd_ctx *ctx = crypto_tfm_ctx(tfm);
+	int ret;
+
+	ctx->params = zstd_params();
+
+	ret = zstd_comp_init(ctx);
+	if (ret)
+		return ret;
+	ret = zstd_decomp_init(ctx);
+	if (ret)
+		zstd_comp_exit(ctx);
+	return ret;
+}
+
+static void zstd_exit(struct crypto_tfm *tfm)
+{
+	struct zstd_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	zstd_comp_exit(ctx);
+	zstd_decomp_exit(ctx);
+}
+
+static int zstd_compress(struct crypto_tfm *tfm, const u8 *src,
+			 unsigned int slen, u8 *dst, unsigned int *dlen)
+{
+	struct zstd_ctx *ctx = crypto_tfm_ctx(tfm);
+	size_t out_len;
+
+	out_len = ZSTD_compressCCtx(ctx->cctx, dst, *dlen, src, slen,
+				    ctx->params);
+	if (ZSTD_isError(out_len))
+		return -EINVAL;
+	*dlen = out_len;
+	return 0;
+}
+
+static int zstd_decompress(struct crypto_tfm *tfm, const u8 *src,
+			   unsigned int slen, u8 *dst, unsigned int *dlen)
+{
+	struct zstd_ctx *ctx = crypto_tfm_ctx(tfm);
+	size_t out_len;
+
+	out_len = ZSTD_decompressDCtx(ctx->dctx, dst, *dlen, src, slen);
+	if (ZSTD_isError(out_len))
+		return -EINVAL;
+	*dlen = out_len;
+	return 0;
+}
+
+static struct crypto_alg alg = {
+	.cra_name		= "zstd",
+	.cra_flags		= CRYPTO_ALG_TYPE_COMPRESS,
+	.cra_ctxsize		= sizeof(struct zstd_ctx),
+	.cra_module		= THIS_MODULE,
+	.cra_init		= zstd_init,
+	.cra_exit		= zstd_exit,
+	.cra_u			= { .compress = {
+	.coa_compress		= zstd_compress,
+	.coa_decompress		= zstd_decompress } }
+};
+
+static int __init zstd_mod_init(void)
+{
+	return crypto_register_alg(&alg);
+}
+
+static void __exit zstd_mod_fini(void)
+{
+	crypto_unregister_alg(&alg);
+}
+
+module_init(zstd_mod_init);
+module_exit(zstd_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Zstd Compression Algorithm");
+MODULE_ALIAS_CRYPTO("zstd");
@@ -70,6 +70,9 @@
 #include <linux/pid_namespace.h>
 #include <linux/security.h>
 #include <linux/spinlock.h>
+#include <linux/topology.h>
+#include <linux/percpu.h>
+#include <linux/ktime.h>
 
 #include <uapi/linux/android/binder.h>
 #include "binder_alloc.h"
@@ -143,6 +146,17 @@ module_param_named(debug_mask, binder_debug_mask, uint, 0644);
 static char *binder_devices_param = CONFIG_ANDROID_BINDER_DEVICES;
 module_param_named(devices, binder_devices_param, charp, S_IRUGO);
 
+/*
+ * Prefer waking a looper thread that last ran in the caller's cluster
+ * for synchronous transactions.
+ */
+static bool binder_cluster_affine = true;
+module_param_named(cluster_affine, binder_cluster_affine, bool, 0644);
+
+/* Record transaction latency histograms shown in debugfs "latency" */
+static bool binder_latency_stats = true;
+module_param_named(latency_stats, binder_latency_stats, bool, 0644);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -195,11 +209,31 @@ enum binder_stat_types {
 	BINDER_STAT_COUNT
 };
 
+/*
+ * Transaction latency histograms. Bucket 0 counts samples below 1us and
+ * bucket n counts samples in [2^(n-1), 2^n) us, the last bucket also
+ * collecting everything slower.
+ */
+enum binder_lat_types {
+	BINDER_LAT_QUEUE_WAIT,
+	BINDER_LAT_HANDLING,
+	BINDER_LAT_REPLY,
+	BINDER_LAT_COUNT
+};
+
+#define BINDER_LAT_BUCKETS 20
+
+struct binder_lat_hist {
+	u32 buckets[BINDER_LAT_COUNT][BINDER_LAT_BUCKETS];
+};
+
 struct binder_stats {
 	atomic_t br[_IOC_NR(BR_FAILED_REPLY) + 1];
 	atomic_t bc[_IOC_NR(BC_REPLY_SG) + 1];
 	atomic_t obj_created[BINDER_STAT_COUNT];
 	atomic_t obj_deleted[BINDER_STAT_COUNT];
+	atomic_t select_local;
+	atomic_t select_remote;
 };
 
 static struct binder_stats binder_stats;
@@ -214,6 +248,18 @@ static inline void binder_stats_created(enum binder_stat_types type)
 	atomic_inc(&binder_stats.obj_created[type]);
 }
 
+static inline u64 binder_lat_now(void)
+{
+	return READ_ONCE(binder_latency_stats) ? ktime_get_ns() : 0;
+}
+
+static inline int binder_lat_bucket(u64 start_ns, u64 now_ns)
+{
+	u64 us = div_u64(now_ns - start_ns, NSEC_PER_USEC);
+
+	return min_t(int, fls64(us), BINDER_LAT_BUCKETS - 1);
+}
+
 struct binder_transaction_log_entry {
 	int debug_id;
 	int debug_id_done;
@@ -359,6 +405,9 @@ struct binder_error {
  *                        (invariant after initialized)
  * @async_todo:           list of async work items
  *                        (protected by @proc->inner_lock)
+ * @lat_queue_wait:       histogram of time incoming transactions waited
+ *                        before a thread picked them up
+ *                        (atomics, no lock needed)
  *
  * Bookkeeping structure for binder nodes.
  */
@@ -400,6 +449,7 @@ struct binder_node {
 	};
 	bool has_async_transaction;
 	struct list_head async_todo;
+	atomic_t lat_queue_wait[BINDER_LAT_BUCKETS];
 };
 
 struct binder_ref_death {
@@ -516,6 +566,9 @@ struct binder_priority {
  *                        (protected by @inner_lock)
  * @stats:                per-process binder statistics
  *                        (atomics, no lock needed)
+ * @lat:                  per-cpu transaction latency histograms, may be
+ *                        NULL if allocation failed at open
+ *                        (per-cpu, no lock needed)
  * @delivered_death:      list of delivered death notification
  *                        (protected by @inner_lock)
  * @max_threads:          cap on number of binder threads
@@ -559,6 +612,7 @@ struct binder_proc {
 
 	struct list_head todo;
 	struct binder_stats stats;
+	struct binder_lat_hist __percpu *lat;
 	struct list_head delivered_death;
 	int max_threads;
 	int requested_threads;
@@ -656,6 +710,8 @@ struct binder_transaction {
 	bool    set_priority_called;
 	kuid_t	sender_euid;
 	binder_uintptr_t security_ctx;
+	u64	queued_ns;	/* when queued to the target, 0 if not sampled */
+	u64	received_ns;	/* when a server thread read it */
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -1033,9 +1089,39 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
 	}
 }
 
+/**
+ * binder_select_local_thread_ilocked() - find a waiting thread near current
+ * @proc:	process to select a thread from
+ *
+ * Looks for a thread on @proc->waiting_threads whose task last ran on a
+ * CPU in the same cluster (as used by the HMP scheduler) as the calling
+ * CPU, and accounts whether one was found.
+ *
+ * Return:	the matching thread, or NULL if none is waiting in the cluster
+ */
+static struct binder_thread *
+binder_select_local_thread_ilocked(struct binder_proc *proc)
+{
+	const struct cpumask *cluster = cpu_coregroup_mask(smp_processor_id());
+	struct binder_thread *thread;
+
+	list_for_each_entry(thread, &proc->waiting_threads,
+			    waiting_thread_node) {
+		if (cpumask_test_cpu(task_cpu(thread->task), cluster)) {
+			atomic_inc(&binder_stats.select_local);
+			atomic_inc(&proc->stats.select_local);
+			return thread;
+		}
+	}
+	atomic_inc(&binder_stats.select_remote);
+	atomic_inc(&proc->stats.select_remote);
+	return NULL;
+}
+
 /**
  * binder_select_thread_ilocked() - selects a thread for doing proc work.
  * @proc:	process to select a thread from
+ * @local:	prefer a thread that last ran in the caller's cluster
  *
  * Note that calling this function moves the thread off the waiting_threads
  * list, so it can only be woken up by the caller of this function, or a
@@ -1046,14 +1132,18 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
  *		returns that thread. Otherwise returns NULL.
  */
 static struct binder_thread *
-binder_select_thread_ilocked(struct binder_proc *proc)
+binder_select_thread_ilocked(struct binder_proc *proc, bool local)
 {
-	struct binder_thread *thread;
+	struct binder_thread *thread = NULL;
 
 	assert_spin_locked(&proc->inner_lock);
-	thread = list_first_entry_or_null(&proc->waiting_threads,
-					  struct binder_thread,
-					  waiting_thread_node);
+	if (local && binder_cluster_affine &&
+	    !list_empty(&proc->waiting_threads))
+		thread = binder_select_local_thread_ilocked(proc);
+	if (!thread)
+		thread = list_first_entry_or_null(&proc->waiting_threads,
+						  struct binder_thread,
+						  waiting_thread_node);
 
 	if (thread)
 		list_del_init(&thread->waiting_thread_node);
@@ -1109,7 +1199,7 @@ static void binder_wakeup_thread_ilocked(struct binder_proc *proc,
 
 static void binder_wakeup_proc_ilocked(struct binder_proc *proc)
 {
-	struct binder_thread *thread = binder_select_thread_ilocked(proc);
+	struct binder_thread *thread = binder_select_thread_ilocked(proc, false);
 
 	binder_wakeup_thread_ilocked(proc, thread, /* sync = */false);
 }
@@ -2830,7 +2920,7 @@ static bool binder_proc_transaction(struct binder_transaction *t,
 	}
 
 	if (!thread && !pending_async)
-		thread = binder_select_thread_ilocked(proc);
+		thread = binder_select_thread_ilocked(proc, !oneway);
 
 	if (thread) {
 		binder_transaction_priority(thread->task, t, node_prio,
@@ -3416,6 +3506,11 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	t->work.type = BINDER_WORK_TRANSACTION;
+	t->queued_ns = binder_lat_now();
+	if (reply && t->queued_ns && in_reply_to->received_ns && proc->lat)
+		this_cpu_inc(proc->lat->buckets[BINDER_LAT_HANDLING]
+			     [binder_lat_bucket(in_reply_to->received_ns,
+						t->queued_ns)]);
 
 	if (reply) {
 		binder_enqueue_thread_work(thread, tcomplete);
@@ -4414,6 +4509,25 @@ retry:
 
 		trace_binder_transaction_received(t);
 		binder_stat_br(proc, thread, cmd);
+		if (t->queued_ns) {
+			u64 now = ktime_get_ns();
+			int bucket = binder_lat_bucket(t->queued_ns, now);
+
+			if (cmd == BR_REPLY) {
+				if (proc->lat)
+					this_cpu_inc(proc->lat->buckets
+						     [BINDER_LAT_REPLY][bucket]);
+			} else {
+				if (proc->lat)
+					this_cpu_inc(proc->lat->buckets
+						     [BINDER_LAT_QUEUE_WAIT]
+						     [bucket]);
+				atomic_inc(&t->buffer->target_node->
+					   lat_queue_wait[bucket]);
+				if (!(t->flags & TF_ONE_WAY))
+					t->received_ns = now;
+			}
+		}
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "%d:%d %s %d %d:%d, cmd %d size %zd-%zd ptr %016llx-%016llx\n",
 			     proc->pid, thread->pid,
@@ -4589,6 +4703,7 @@ static void binder_free_proc(struct binder_proc *proc)
 	BUG_ON(!list_empty(&proc->todo));
 	BUG_ON(!list_empty(&proc->delivered_death));
 	binder_alloc_deferred_release(&proc->alloc);
+	free_percpu(proc->lat);
 	put_task_struct(proc->tsk);
 	put_cred(proc->cred);
 	binder_stats_deleted(BINDER_STAT_PROC);
@@ -5109,6 +5224,7 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc = kzalloc(sizeof(*proc), GFP_KERNEL);
 	if (proc == NULL)
 		return -ENOMEM;
+	proc->lat = alloc_percpu(struct binder_lat_hist);
 	spin_lock_init(&proc->inner_lock);
 	spin_lock_init(&proc->outer_lock);
 	atomic_set(&proc->tmp_ref, 0);
@@ -5735,6 +5851,12 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 				created - deleted,
 				created);
 	}
+
+	if (atomic_read(&stats->select_local) ||
+	    atomic_read(&stats->select_remote))
+		seq_printf(m, "%sthread_select: local %d remote %d\n", prefix,
+			   atomic_read(&stats->select_local),
+			   atomic_read(&stats->select_remote));
 }
 
 static void print_binder_proc_stats(struct seq_file *m,
@@ -5857,6 +5979,90 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static const char * const binder_lat_strings[] = {
+	"queue_wait",
+	"handling",
+	"reply",
+};
+
+static void print_binder_lat_buckets(struct seq_file *m, const char *prefix,
+				     const char *name, const u32 *buckets)
+{
+	int i;
+
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		if (buckets[i])
+			break;
+	if (i == BINDER_LAT_BUCKETS)
+		return;
+
+	seq_printf(m, "%s%s:", prefix, name);
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		seq_printf(m, " %u", buckets[i]);
+	seq_puts(m, "\n");
+}
+
+static void print_binder_proc_latency(struct seq_file *m,
+				      struct binder_proc *proc)
+{
+	struct binder_lat_hist sum;
+	u32 node_buckets[BINDER_LAT_BUCKETS];
+	struct rb_node *n;
+	int cpu, type, i;
+
+	memset(&sum, 0, sizeof(sum));
+	if (proc->lat) {
+		for_each_possible_cpu(cpu) {
+			struct binder_lat_hist *hist =
+				per_cpu_ptr(proc->lat, cpu);
+
+			for (type = 0; type < BINDER_LAT_COUNT; type++)
+				for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+					sum.buckets[type][i] +=
+						hist->buckets[type][i];
+		}
+	}
+
+	seq_printf(m, "proc %d\n", proc->pid);
+	seq_printf(m, "context %s\n", proc->context->name);
+	BUILD_BUG_ON(ARRAY_SIZE(binder_lat_strings) != BINDER_LAT_COUNT);
+	for (type = 0; type < BINDER_LAT_COUNT; type++)
+		print_binder_lat_buckets(m, "  ", binder_lat_strings[type],
+					 sum.buckets[type]);
+
+	binder_inner_proc_lock(proc);
+	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+		struct binder_node *node = rb_entry(n, struct binder_node,
+						    rb_node);
+		char name[24];
+
+		for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+			node_buckets[i] = atomic_read(&node->lat_queue_wait[i]);
+		snprintf(name, sizeof(name), "node %d queue_wait",
+			 node->debug_id);
+		print_binder_lat_buckets(m, "  ", name, node_buckets);
+	}
+	binder_inner_proc_unlock(proc);
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	int i;
+
+	seq_puts(m, "binder latency (us):");
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		seq_printf(m, " %s%u", i ? "" : "<", i ? 1U << (i - 1) : 1);
+	seq_puts(m, "\n");
+
+	mutex_lock(&binder_procs_lock);
+	hlist_for_each_entry(proc, &binder_procs, proc_node)
+		print_binder_proc_latency(m, proc);
+	mutex_unlock(&binder_procs_lock);
+
+	return 0;
+}
+
 static int binder_transactions_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
@@ -5947,6 +6153,7 @@ static const struct file_operations binder_fops = {
 
 BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
+BINDER_DEBUG_ENTRY(latency);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
 
@@ -6011,6 +6218,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    NULL,
 				    &binder_stats_fops);
+		debugfs_create_file("latency",
+				    0444,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 		debugfs_create_file("transactions",
 				    0444,
 				    binder_debugfs_dir_entry_root,
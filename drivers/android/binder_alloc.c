@@ -28,6 +28,7 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/list_lru.h>
+#include <linux/workqueue.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
 
@@ -45,6 +46,96 @@ static uint32_t binder_alloc_debug_mask;
 module_param_named(debug_mask, binder_alloc_debug_mask,
 		   uint, S_IWUSR | S_IRUGO);
 
+/*
+ * Use power-of-two segregated free lists for small buffers instead of a
+ * best-fit search of the free_buffers tree. Sampled once per proc at mmap.
+ */
+static bool binder_alloc_segregated;
+module_param_named(segregated, binder_alloc_segregated,
+		   bool, S_IWUSR | S_IRUGO);
+
+/*
+ * Number of pages at the start of each proc's buffer space that are
+ * mapped in the background after mmap, so the first transactions to a
+ * freshly started process do not allocate and map pages inline.
+ */
+static uint32_t binder_alloc_prefill_pages;
+module_param_named(prefill_pages, binder_alloc_prefill_pages,
+		   uint, S_IWUSR | S_IRUGO);
+
+/*
+ * Global pool of zeroed pages that binder_update_page_range() takes from
+ * before falling back to the page allocator. The shrinker drains it before
+ * reclaiming pages from any proc.
+ */
+static uint32_t binder_alloc_pool_pages = 64;
+module_param_named(pool_pages, binder_alloc_pool_pages,
+		   uint, S_IWUSR | S_IRUGO);
+
+static LIST_HEAD(binder_page_pool);
+static DEFINE_SPINLOCK(binder_page_pool_lock);
+static unsigned long binder_page_pool_count;
+
+static void binder_page_pool_refill(struct work_struct *work)
+{
+	struct page *page;
+
+	while (READ_ONCE(binder_page_pool_count) <
+	       READ_ONCE(binder_alloc_pool_pages)) {
+		page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO |
+				  __GFP_NOWARN | __GFP_NORETRY);
+		if (!page)
+			break;
+		spin_lock(&binder_page_pool_lock);
+		list_add(&page->lru, &binder_page_pool);
+		binder_page_pool_count++;
+		spin_unlock(&binder_page_pool_lock);
+	}
+}
+
+static DECLARE_WORK(binder_page_pool_work, binder_page_pool_refill);
+
+static struct page *binder_alloc_get_page(void)
+{
+	struct page *page = NULL;
+	unsigned long count;
+
+	spin_lock(&binder_page_pool_lock);
+	if (!list_empty(&binder_page_pool)) {
+		page = list_first_entry(&binder_page_pool, struct page, lru);
+		list_del(&page->lru);
+		binder_page_pool_count--;
+	}
+	count = binder_page_pool_count;
+	spin_unlock(&binder_page_pool_lock);
+
+	if (count < READ_ONCE(binder_alloc_pool_pages) / 2)
+		queue_work(system_unbound_wq, &binder_page_pool_work);
+	if (page)
+		return page;
+
+	return alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
+}
+
+static unsigned long binder_page_pool_shrink(unsigned long nr_to_scan)
+{
+	struct page *page;
+	unsigned long freed = 0;
+
+	spin_lock(&binder_page_pool_lock);
+	while (freed < nr_to_scan && !list_empty(&binder_page_pool)) {
+		page = list_first_entry(&binder_page_pool, struct page, lru);
+		list_del(&page->lru);
+		binder_page_pool_count--;
+		spin_unlock(&binder_page_pool_lock);
+		__free_page(page);
+		freed++;
+		spin_lock(&binder_page_pool_lock);
+	}
+	spin_unlock(&binder_page_pool_lock);
+	return freed;
+}
+
 #define binder_alloc_debug(mask, x...) \
 	do { \
 		if (binder_alloc_debug_mask & mask) \
@@ -70,6 +161,18 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return (u8 *)binder_buffer_next(buffer)->data - (u8 *)buffer->data;
 }
 
+static int binder_free_class(size_t size)
+{
+	int class = ilog2(size) - BINDER_ALLOC_CLASS_SHIFT;
+
+	return class < 0 ? 0 : class;
+}
+
+static bool binder_use_free_class(struct binder_alloc *alloc, size_t size)
+{
+	return alloc->segregated && size < BINDER_ALLOC_CLASS_LIMIT;
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -87,6 +190,14 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 		     "%d: add free buffer, size %zd, at %pK\n",
 		      alloc->pid, new_buffer_size, new_buffer);
 
+	if (binder_use_free_class(alloc, new_buffer_size)) {
+		int class = binder_free_class(new_buffer_size);
+
+		list_add(&new_buffer->free_entry, &alloc->free_lists[class]);
+		__set_bit(class, alloc->free_classes);
+		return;
+	}
+
 	while (*p) {
 		parent = *p;
 		buffer = rb_entry(parent, struct binder_buffer, rb_node);
@@ -103,6 +214,69 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	rb_insert_color(&new_buffer->rb_node, &alloc->free_buffers);
 }
 
+/*
+ * Must be called while the size of @buffer is still the size it was
+ * inserted with, i.e. before its neighbours in alloc->buffers change.
+ */
+static void binder_remove_free_buffer(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer)
+{
+	size_t buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	int class;
+
+	BUG_ON(!buffer->free);
+
+	if (!binder_use_free_class(alloc, buffer_size)) {
+		rb_erase(&buffer->rb_node, &alloc->free_buffers);
+		return;
+	}
+	class = binder_free_class(buffer_size);
+	list_del_init(&buffer->free_entry);
+	if (list_empty(&alloc->free_lists[class]))
+		__clear_bit(class, alloc->free_classes);
+}
+
+/*
+ * Find a free buffer of at least @size in the segregated free lists.
+ * Every buffer in a class above the one @size falls in is large enough,
+ * so the head of the first non-empty such class is taken. Falls back to a
+ * first-fit scan of @size's own class only when @last_resort is set.
+ */
+static struct binder_buffer *binder_alloc_class_fit(struct binder_alloc *alloc,
+						    size_t size,
+						    bool last_resort)
+{
+	struct binder_buffer *buffer;
+	int class = binder_free_class(size);
+
+	if (size >= BINDER_ALLOC_CLASS_LIMIT)
+		return NULL;
+
+	if (last_resort) {
+		list_for_each_entry(buffer, &alloc->free_lists[class],
+				    free_entry) {
+			if (binder_alloc_buffer_size(alloc, buffer) >= size)
+				return buffer;
+		}
+		return NULL;
+	}
+
+	if (!is_power_of_2(size))
+		class++;
+	for (class = find_next_bit(alloc->free_classes,
+				   BINDER_ALLOC_NR_CLASSES, class);
+	     class < BINDER_ALLOC_NR_CLASSES;
+	     class = find_next_bit(alloc->free_classes,
+				   BINDER_ALLOC_NR_CLASSES, class + 1)) {
+		buffer = list_first_entry(&alloc->free_lists[class],
+					  struct binder_buffer, free_entry);
+		/* Only class 0 can hold buffers below its nominal size */
+		if (binder_alloc_buffer_size(alloc, buffer) >= size)
+			return buffer;
+	}
+	return NULL;
+}
+
 static void binder_insert_allocated_buffer_locked(
 		struct binder_alloc *alloc, struct binder_buffer *new_buffer)
 {
@@ -255,9 +429,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 			goto err_page_ptr_cleared;
 
 		trace_binder_alloc_page_start(alloc, index);
-		page->page_ptr = alloc_page(GFP_KERNEL |
-					    __GFP_HIGHMEM |
-					    __GFP_ZERO);
+		page->page_ptr = binder_alloc_get_page();
 		if (!page->page_ptr) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				alloc->pid, page_addr);
@@ -339,7 +511,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				int is_async)
 {
 	struct rb_node *n = alloc->free_buffers.rb_node;
-	struct binder_buffer *buffer;
+	struct binder_buffer *buffer = NULL;
 	size_t buffer_size;
 	struct rb_node *best_fit = NULL;
 	void *has_page_addr;
@@ -380,10 +552,15 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
-	while (n) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		BUG_ON(!buffer->free);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	if (alloc->segregated)
+		buffer = binder_alloc_class_fit(alloc, size, false);
+
+	while (!buffer && n) {
+		struct binder_buffer *node_buffer;
+
+		node_buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(!node_buffer->free);
+		buffer_size = binder_alloc_buffer_size(alloc, node_buffer);
 
 		if (size < buffer_size) {
 			best_fit = n;
@@ -395,13 +572,18 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			break;
 		}
 	}
-	if (best_fit == NULL) {
+	if (!buffer && best_fit)
+		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
+	if (!buffer && alloc->segregated)
+		buffer = binder_alloc_class_fit(alloc, size, true);
+	if (buffer == NULL) {
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
 		size_t total_alloc_size = 0;
 		size_t free_buffers = 0;
 		size_t largest_free_size = 0;
 		size_t total_free_size = 0;
+		int class;
 
 		for (n = rb_first(&alloc->allocated_buffers); n != NULL;
 		     n = rb_next(n)) {
@@ -421,6 +603,18 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			if (buffer_size > largest_free_size)
 				largest_free_size = buffer_size;
 		}
+		for (class = 0; alloc->segregated &&
+		     class < BINDER_ALLOC_NR_CLASSES; class++) {
+			list_for_each_entry(buffer, &alloc->free_lists[class],
+					    free_entry) {
+				buffer_size = binder_alloc_buffer_size(alloc,
+								       buffer);
+				free_buffers++;
+				total_free_size += buffer_size;
+				if (buffer_size > largest_free_size)
+					largest_free_size = buffer_size;
+			}
+		}
 		pr_err("%d: binder_alloc_buf size %zd failed, no address space\n",
 			alloc->pid, size);
 		pr_err("allocated: %zd (num: %zd largest: %zd), free: %zd (num: %zd largest: %zd)\n",
@@ -428,10 +622,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		       total_free_size, free_buffers, largest_free_size);
 		return ERR_PTR(-ENOSPC);
 	}
-	if (n == NULL) {
-		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-	}
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
@@ -439,7 +630,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	has_page_addr =
 		(void *)(((uintptr_t)buffer->data + buffer_size) & PAGE_MASK);
-	WARN_ON(n && buffer_size != size);
 	end_page_addr =
 		(void *)PAGE_ALIGN((uintptr_t)buffer->data + size);
 	if (end_page_addr > has_page_addr)
@@ -458,13 +648,15 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			       __func__, alloc->pid);
 			goto err_alloc_buf_struct_failed;
 		}
+		binder_remove_free_buffer(alloc, buffer);
 		new_buffer->data = (u8 *)buffer->data + size;
 		list_add(&new_buffer->entry, &buffer->entry);
 		new_buffer->free = 1;
 		binder_insert_free_buffer(alloc, new_buffer);
+	} else {
+		binder_remove_free_buffer(alloc, buffer);
 	}
 
-	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
@@ -615,7 +807,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *next = binder_buffer_next(buffer);
 
 		if (next->free) {
-			rb_erase(&next->rb_node, &alloc->free_buffers);
+			binder_remove_free_buffer(alloc, next);
 			binder_delete_free_buffer(alloc, next);
 		}
 	}
@@ -623,8 +815,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *prev = binder_buffer_prev(buffer);
 
 		if (prev->free) {
+			binder_remove_free_buffer(alloc, prev);
 			binder_delete_free_buffer(alloc, buffer);
-			rb_erase(&prev->rb_node, &alloc->free_buffers);
 			buffer = prev;
 		}
 	}
@@ -646,6 +838,34 @@ void binder_alloc_free_buf(struct binder_alloc *alloc,
 	mutex_unlock(&alloc->mutex);
 }
 
+/*
+ * Map the first binder_alloc_prefill_pages pages of the buffer space and
+ * park them on binder_alloc_lru, exactly as if a buffer covering them had
+ * been allocated and freed. Pages in use are left alone.
+ */
+static void binder_alloc_prefill(struct work_struct *work)
+{
+	struct binder_alloc *alloc =
+		container_of(work, struct binder_alloc, prefill_work);
+	size_t nr_pages, index;
+	void *page_addr;
+
+	mutex_lock(&alloc->mutex);
+	nr_pages = min_t(size_t, READ_ONCE(binder_alloc_prefill_pages),
+			 alloc->buffer_size / PAGE_SIZE);
+	for (index = 0; index < nr_pages && alloc->vma; index++) {
+		if (alloc->pages[index].page_ptr)
+			continue;
+		page_addr = alloc->buffer + index * PAGE_SIZE;
+		if (binder_update_page_range(alloc, 1, page_addr,
+					     page_addr + PAGE_SIZE))
+			break;
+		binder_update_page_range(alloc, 0, page_addr,
+					 page_addr + PAGE_SIZE);
+	}
+	mutex_unlock(&alloc->mutex);
+}
+
 /**
  * binder_alloc_mmap_handler() - map virtual address space for proc
  * @alloc:	alloc structure for this proc
@@ -716,6 +936,7 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 	buffer->data = alloc->buffer;
 	list_add(&buffer->entry, &alloc->buffers);
 	buffer->free = 1;
+	alloc->segregated = READ_ONCE(binder_alloc_segregated);
 	binder_insert_free_buffer(alloc, buffer);
 	alloc->free_async_space = alloc->buffer_size / 2;
 	barrier();
@@ -724,6 +945,9 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 	/* Same as mmgrab() in later kernel versions */
 	atomic_inc(&alloc->vma_vm_mm->mm_count);
 
+	if (READ_ONCE(binder_alloc_prefill_pages))
+		queue_work(system_unbound_wq, &alloc->prefill_work);
+
 	return 0;
 
 err_alloc_buf_struct_failed:
@@ -750,6 +974,8 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 
 	BUG_ON(alloc->vma);
 
+	cancel_work_sync(&alloc->prefill_work);
+
 	buffers = 0;
 	mutex_lock(&alloc->mutex);
 	while ((n = rb_first(&alloc->allocated_buffers))) {
@@ -979,7 +1205,7 @@ static unsigned long
 binder_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 {
 	unsigned long ret = list_lru_count(&binder_alloc_lru);
-	return ret;
+	return ret + READ_ONCE(binder_page_pool_count);
 }
 
 static unsigned long
@@ -987,8 +1213,12 @@ binder_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
 	unsigned long ret;
 
-	ret = list_lru_walk(&binder_alloc_lru, binder_alloc_free_page,
-			    NULL, sc->nr_to_scan);
+	ret = binder_page_pool_shrink(sc->nr_to_scan);
+	if (ret >= sc->nr_to_scan)
+		return ret;
+
+	ret += list_lru_walk(&binder_alloc_lru, binder_alloc_free_page,
+			     NULL, sc->nr_to_scan - ret);
 	return ret;
 }
 
@@ -1007,9 +1237,40 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int class;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	INIT_WORK(&alloc->prefill_work, binder_alloc_prefill);
+	for (class = 0; class < BINDER_ALLOC_NR_CLASSES; class++)
+		INIT_LIST_HEAD(&alloc->free_lists[class]);
+}
+
+/**
+ * binder_alloc_set_segregated() - switch free buffer bookkeeping mode
+ * @alloc:      binder_alloc for this proc
+ * @segregated: true to use size class free lists, false for best-fit only
+ *
+ * Re-files every free buffer of @alloc into the structure used by the new
+ * mode. Used by the selftest to exercise both modes on the same proc.
+ */
+void binder_alloc_set_segregated(struct binder_alloc *alloc, bool segregated)
+{
+	struct binder_buffer *buffer;
+	int class;
+
+	mutex_lock(&alloc->mutex);
+	alloc->free_buffers = RB_ROOT;
+	for (class = 0; class < BINDER_ALLOC_NR_CLASSES; class++)
+		INIT_LIST_HEAD(&alloc->free_lists[class]);
+	bitmap_zero(alloc->free_classes, BINDER_ALLOC_NR_CLASSES);
+	alloc->segregated = segregated;
+	list_for_each_entry(buffer, &alloc->buffers, entry) {
+		if (buffer->free)
+			binder_insert_free_buffer(alloc, buffer);
+	}
+	mutex_unlock(&alloc->mutex);
 }
 
 int binder_alloc_shrinker_init(void)
@@ -1020,6 +1281,8 @@ int binder_alloc_shrinker_init(void)
 		ret = register_shrinker(&binder_shrinker);
 		if (ret)
 			list_lru_destroy(&binder_alloc_lru);
+		else
+			queue_work(system_unbound_wq, &binder_page_pool_work);
 	}
 	return ret;
 }
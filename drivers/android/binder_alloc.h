@@ -22,14 +22,26 @@
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 #include <linux/list_lru.h>
+#include <linux/workqueue.h>
 
 extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
 
+/*
+ * Size classes used by the segregated-fit free lists. Class n holds free
+ * buffers whose size is in [1 << (n + SHIFT), 1 << (n + SHIFT + 1)); free
+ * buffers larger than the last class stay in the free_buffers rb tree.
+ */
+#define BINDER_ALLOC_CLASS_SHIFT	3
+#define BINDER_ALLOC_NR_CLASSES		16
+#define BINDER_ALLOC_CLASS_LIMIT \
+	(1UL << (BINDER_ALLOC_CLASS_SHIFT + BINDER_ALLOC_NR_CLASSES))
+
 /**
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @free_entry:         entry in alloc->free_lists when segregated
  * @free:               true if buffer is free
  * @allow_user_free:    describe the second member of struct blah,
  * @async_transaction:  describe the second member of struct blah,
@@ -47,6 +59,7 @@ struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
 	struct rb_node rb_node; /* free entry by size or allocated entry */
 				/* by address */
+	struct list_head free_entry; /* free entry in size class list */
 	unsigned free:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
@@ -85,6 +98,11 @@ struct binder_lru_page {
  * @buffers:            list of all buffers for this proc
  * @free_buffers:       rb tree of buffers available for allocation
  *                      sorted by size
+ * @free_lists:         per size class lists of free buffers, only used
+ *                      when @segregated is set
+ * @free_classes:       bitmap of non-empty @free_lists
+ * @segregated:         free buffers below BINDER_ALLOC_CLASS_LIMIT are
+ *                      kept in @free_lists instead of @free_buffers
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
@@ -92,6 +110,8 @@ struct binder_lru_page {
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @prefill_work:       maps the first binder_alloc prefill_pages pages
+ *                      in the background after mmap
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -106,6 +126,9 @@ struct binder_alloc {
 	ptrdiff_t user_buffer_offset;
 	struct list_head buffers;
 	struct rb_root free_buffers;
+	struct list_head free_lists[BINDER_ALLOC_NR_CLASSES];
+	DECLARE_BITMAP(free_classes, BINDER_ALLOC_NR_CLASSES);
+	bool segregated;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 	struct binder_lru_page *pages;
@@ -113,6 +136,7 @@ struct binder_alloc {
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	struct work_struct prefill_work;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -129,6 +153,8 @@ extern struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 						  size_t extra_buffers_size,
 						  int is_async);
 extern void binder_alloc_init(struct binder_alloc *alloc);
+extern void binder_alloc_set_segregated(struct binder_alloc *alloc,
+					bool segregated);
 extern int binder_alloc_shrinker_init(void);
 extern void binder_alloc_vma_close(struct binder_alloc *alloc);
 extern struct binder_buffer *
@@ -161,6 +161,47 @@ static void binder_selftest_free_buf(struct binder_alloc *alloc,
 	}
 }
 
+static size_t selftest_buffer_size(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer)
+{
+	if (list_is_last(&buffer->entry, &alloc->buffers))
+		return (u8 *)alloc->buffer +
+			alloc->buffer_size - (u8 *)buffer->data;
+	return (u8 *)list_next_entry(buffer, entry)->data - (u8 *)buffer->data;
+}
+
+/* Check that every free buffer is filed in the class matching its size. */
+static void binder_selftest_check_free_classes(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffer;
+	size_t size;
+	int class;
+
+	if (!alloc->segregated)
+		return;
+
+	for (class = 0; class < BINDER_ALLOC_NR_CLASSES; class++) {
+		if (list_empty(&alloc->free_lists[class]) ==
+		    test_bit(class, alloc->free_classes)) {
+			pr_err("free class %d bitmap out of sync\n", class);
+			binder_selftest_failures++;
+		}
+		list_for_each_entry(buffer, &alloc->free_lists[class],
+				    free_entry) {
+			size = selftest_buffer_size(alloc, buffer);
+			if (!buffer->free || size >= BINDER_ALLOC_CLASS_LIMIT ||
+			    (class && ilog2(size) !=
+			     class + BINDER_ALLOC_CLASS_SHIFT)) {
+				pr_err("buffer %pK size %zu %s in free class %d\n",
+				       buffer->data, size,
+				       buffer->free ? "free" : "allocated",
+				       class);
+				binder_selftest_failures++;
+			}
+		}
+	}
+}
+
 static void binder_selftest_free_page(struct binder_alloc *alloc)
 {
 	int i;
@@ -187,7 +228,9 @@ static void binder_selftest_alloc_free(struct binder_alloc *alloc,
 	struct binder_buffer *buffers[BUFFER_NUM];
 
 	binder_selftest_alloc_buf(alloc, buffers, sizes, seq);
+	binder_selftest_check_free_classes(alloc);
 	binder_selftest_free_buf(alloc, buffers, sizes, seq, end);
+	binder_selftest_check_free_classes(alloc);
 
 	/* Allocate from lru. */
 	binder_selftest_alloc_buf(alloc, buffers, sizes, seq);
@@ -195,6 +238,7 @@ static void binder_selftest_alloc_free(struct binder_alloc *alloc,
 		pr_err("lru list should be empty but is not\n");
 
 	binder_selftest_free_buf(alloc, buffers, sizes, seq, end);
+	binder_selftest_check_free_classes(alloc);
 	binder_selftest_free_page(alloc);
 }
 
@@ -286,11 +330,13 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
  * Allocate BUFFER_NUM buffers to cover all page alignment cases,
  * then free them in all orders possible. Check that pages are
  * correctly allocated, put onto lru when buffers are freed, and
- * are freed when binder_alloc_free_page is called.
+ * are freed when binder_alloc_free_page is called. The whole sequence is
+ * run once with best-fit and once with segregated free lists.
  */
 void binder_selftest_alloc(struct binder_alloc *alloc)
 {
 	size_t end_offset[BUFFER_NUM];
+	bool segregated;
 
 	if (!binder_selftest_run)
 		return;
@@ -298,7 +344,13 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 	if (!binder_selftest_run || !alloc->vma)
 		goto done;
 	pr_info("STARTED\n");
+	/* Background prefill would repopulate pages the test expects free */
+	flush_work(&alloc->prefill_work);
+	segregated = alloc->segregated;
+	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_alloc_set_segregated(alloc, !segregated);
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_alloc_set_segregated(alloc, segregated);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
@@ -9,6 +9,7 @@
 #include <linux/mm.h>
 #include <linux/moduleparam.h>
 #include <linux/oom.h>
+#include <linux/simple_lmk.h>
 #include <linux/sort.h>
 
 /* The minimum number of pages to free per reclaim */
@@ -26,8 +27,21 @@ struct victim_info {
 	unsigned long size;
 };
 
+/*
+ * Every live thread group is kept in a bucket based on its oom_score_adj.
+ * Buckets are indexed by OOM_SCORE_ADJ_MAX - adj so that walking the
+ * bitmap of non-empty buckets upwards visits the least important tasks
+ * first. Thread groups with a negative adj can't be killed and are parked
+ * on a separate list, so an unhashed node always means a dead group. The
+ * buckets are hlists so they are usable before any initcall has run.
+ */
+#define NR_ADJ_BUCKETS (OOM_SCORE_ADJ_MAX + 1)
+
 static struct victim_info victims[MAX_VICTIMS] __cacheline_aligned_in_smp;
-static struct task_struct *task_bucket[SHRT_MAX + 1] __cacheline_aligned;
+static struct hlist_head adj_bucket[NR_ADJ_BUCKETS] __cacheline_aligned;
+static DECLARE_BITMAP(adj_bucket_map, NR_ADJ_BUCKETS);
+static HLIST_HEAD(unkillable_list);
+static __cacheline_aligned_in_smp DEFINE_SPINLOCK(adj_index_lock);
 static DECLARE_WAIT_QUEUE_HEAD(oom_waitq);
 static DECLARE_COMPLETION(reclaim_done);
 static __cacheline_aligned_in_smp DEFINE_RWLOCK(mm_free_lock);
@@ -35,6 +49,74 @@ static int nr_victims;
 static atomic_t needs_reclaim = ATOMIC_INIT(0);
 static atomic_t nr_killed = ATOMIC_INIT(0);
 
+/* Kill cycle timing, from the reclaim trigger until the last victim's mm */
+static ktime_t reclaim_start __read_mostly;
+static ktime_t reclaim_end;
+static unsigned int last_cycle_ms;
+static unsigned int max_cycle_ms;
+static unsigned int nr_cycles;
+static unsigned int nr_timeouts;
+module_param(last_cycle_ms, uint, 0444);
+module_param(max_cycle_ms, uint, 0444);
+module_param(nr_cycles, uint, 0444);
+module_param(nr_timeouts, uint, 0444);
+
+static void adj_index_link(struct signal_struct *sig)
+{
+	short adj = READ_ONCE(sig->oom_score_adj);
+	int idx;
+
+	sig->simple_lmk_adj = adj;
+	if (adj < 0) {
+		hlist_add_head(&sig->simple_lmk_node, &unkillable_list);
+		return;
+	}
+
+	idx = OOM_SCORE_ADJ_MAX - adj;
+	hlist_add_head(&sig->simple_lmk_node, &adj_bucket[idx]);
+	__set_bit(idx, adj_bucket_map);
+}
+
+static void adj_index_unlink(struct signal_struct *sig)
+{
+	int idx = OOM_SCORE_ADJ_MAX - sig->simple_lmk_adj;
+
+	hlist_del_init(&sig->simple_lmk_node);
+
+	/* Clear the bucket's bit when its last entry leaves */
+	if (sig->simple_lmk_adj >= 0 && hlist_empty(&adj_bucket[idx]))
+		__clear_bit(idx, adj_bucket_map);
+}
+
+/* Called from copy_process() for each new thread group */
+void simple_lmk_signal_add(struct signal_struct *sig)
+{
+	spin_lock(&adj_index_lock);
+	adj_index_link(sig);
+	spin_unlock(&adj_index_lock);
+}
+
+/* Called from __unhash_process() when a thread group dies */
+void simple_lmk_signal_del(struct signal_struct *sig)
+{
+	spin_lock(&adj_index_lock);
+	if (!hlist_unhashed(&sig->simple_lmk_node))
+		adj_index_unlink(sig);
+	spin_unlock(&adj_index_lock);
+}
+
+/* Called after oom_score_adj is written to move the group to its bucket */
+void simple_lmk_adj_update(struct signal_struct *sig)
+{
+	spin_lock(&adj_index_lock);
+	if (!hlist_unhashed(&sig->simple_lmk_node) &&
+	    sig->simple_lmk_adj != READ_ONCE(sig->oom_score_adj)) {
+		adj_index_unlink(sig);
+		adj_index_link(sig);
+	}
+	spin_unlock(&adj_index_lock);
+}
+
 static int victim_cmp(const void *lhs_ptr, const void *rhs_ptr)
 {
 	const struct victim_info *lhs = (typeof(lhs))lhs_ptr;
@@ -64,56 +146,36 @@ static unsigned long get_total_mm_pages(struct mm_struct *mm)
 
 static unsigned long find_victims(int *vindex)
 {
-	short i, min_adj = SHRT_MAX, max_adj = 0;
 	unsigned long pages_found = 0;
-	struct task_struct *tsk;
+	int idx;
 
+	/*
+	 * The index lock keeps every signal_struct on the lists alive and
+	 * RCU keeps the tasks found through their leader pids alive. Although
+	 * oom_score_adj can still be changed while this code runs, it doesn't
+	 * really matter; we just need a snapshot of the buckets.
+	 */
+	spin_lock(&adj_index_lock);
 	rcu_read_lock();
-	for_each_process(tsk) {
-		struct signal_struct *sig;
-		short adj;
-
-		/*
-		 * Search for suitable tasks with a positive adj (importance).
-		 * Since only tasks with a positive adj can be targeted, that
-		 * naturally excludes tasks which shouldn't be killed, like init
-		 * and kthreads. Although oom_score_adj can still be changed
-		 * while this code runs, it doesn't really matter; we just need
-		 * a snapshot of the task's adj.
-		 */
-		sig = tsk->signal;
-		adj = READ_ONCE(sig->oom_score_adj);
-		if (adj < 0 ||
-		    sig->flags & (SIGNAL_GROUP_EXIT | SIGNAL_GROUP_COREDUMP) ||
-		    (thread_group_empty(tsk) && tsk->flags & PF_EXITING))
-			continue;
-
-		/* Store the task in a linked-list bucket based on its adj */
-		tsk->simple_lmk_next = task_bucket[adj];
-		task_bucket[adj] = tsk;
-
-		/* Track the min and max adjs to speed up the loop below */
-		if (adj > max_adj)
-			max_adj = adj;
-		if (adj < min_adj)
-			min_adj = adj;
-	}
 
 	/* Start searching for victims from the highest adj (least important) */
-	for (i = max_adj; i >= min_adj; i--) {
+	for_each_set_bit(idx, adj_bucket_map, NR_ADJ_BUCKETS) {
+		struct signal_struct *sig;
 		int old_vindex;
 
-		tsk = task_bucket[i];
-		if (!tsk)
-			continue;
+		/* Iterate through every thread group with this adj */
+		old_vindex = *vindex;
+		hlist_for_each_entry(sig, &adj_bucket[idx], simple_lmk_node) {
+			struct task_struct *tsk, *vtsk;
 
-		/* Clear out this bucket for the next time reclaim is done */
-		task_bucket[i] = NULL;
+			if (sig->flags & (SIGNAL_GROUP_EXIT |
+					  SIGNAL_GROUP_COREDUMP))
+				continue;
 
-		/* Iterate through every task with this adj */
-		old_vindex = *vindex;
-		do {
-			struct task_struct *vtsk;
+			tsk = pid_task(sig->leader_pid, PIDTYPE_PID);
+			if (!tsk ||
+			    (thread_group_empty(tsk) && tsk->flags & PF_EXITING))
+				continue;
 
 			vtsk = find_lock_task_mm(tsk);
 			if (!vtsk)
@@ -130,7 +192,7 @@ static unsigned long find_victims(int *vindex)
 			/* Make sure there's space left in the victim array */
 			if (++*vindex == MAX_VICTIMS)
 				break;
-		} while ((tsk = tsk->simple_lmk_next));
+		}
 
 		/* Go to the next bucket if nothing was found */
 		if (*vindex == old_vindex)
@@ -144,15 +206,11 @@ static unsigned long find_victims(int *vindex)
 		     sizeof(*victims), victim_cmp, victim_swap);
 
 		/* Stop when we are out of space or have enough pages found */
-		if (*vindex == MAX_VICTIMS || pages_found >= MIN_FREE_PAGES) {
-			/* Zero out any remaining buckets we didn't touch */
-			if (i > min_adj)
-				memset(&task_bucket[min_adj], 0,
-				       (i - min_adj) * sizeof(*task_bucket));
+		if (*vindex == MAX_VICTIMS || pages_found >= MIN_FREE_PAGES)
 			break;
-		}
 	}
 	rcu_read_unlock();
+	spin_unlock(&adj_index_lock);
 
 	return pages_found;
 }
@@ -250,12 +308,19 @@ static void scan_and_kill(unsigned long pages_needed)
 	}
 
 	/* Wait until all the victims die or until the timeout is reached */
-	wait_for_completion_timeout(&reclaim_done, RECLAIM_EXPIRES);
+	if (!wait_for_completion_timeout(&reclaim_done, RECLAIM_EXPIRES)) {
+		nr_timeouts++;
+		reclaim_end = ktime_get();
+	}
 	write_lock(&mm_free_lock);
 	reinit_completion(&reclaim_done);
 	nr_victims = 0;
 	nr_killed = (atomic_t)ATOMIC_INIT(0);
 	write_unlock(&mm_free_lock);
+
+	last_cycle_ms = ktime_ms_delta(reclaim_end, reclaim_start);
+	max_cycle_ms = max(max_cycle_ms, last_cycle_ms);
+	nr_cycles++;
 }
 
 static int simple_lmk_reclaim_thread(void *data)
@@ -278,8 +343,10 @@ static int simple_lmk_reclaim_thread(void *data)
 void simple_lmk_decide_reclaim(int kswapd_priority)
 {
 	if (kswapd_priority == CONFIG_ANDROID_SIMPLE_LMK_AGGRESSION &&
-	    !atomic_cmpxchg_acquire(&needs_reclaim, 0, 1))
+	    !atomic_cmpxchg_acquire(&needs_reclaim, 0, 1)) {
+		reclaim_start = ktime_get();
 		wake_up(&oom_waitq);
+	}
 }
 
 void simple_lmk_mm_freed(struct mm_struct *mm)
@@ -293,8 +360,10 @@ void simple_lmk_mm_freed(struct mm_struct *mm)
 	for (i = 0; i < nr_victims; i++) {
 		if (victims[i].mm == mm) {
 			victims[i].mm = NULL;
-			if (atomic_inc_return_relaxed(&nr_killed) == nr_victims)
+			if (atomic_inc_return_relaxed(&nr_killed) == nr_victims) {
+				reclaim_end = ktime_get();
 				complete(&reclaim_done);
+			}
 			break;
 		}
 	}
@@ -386,7 +386,7 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, char *info)
 {
-	ktime_t calltime;
+	ktime_t calltime, starttime;
 	int error;
 
 	if (!cb)
@@ -396,7 +396,11 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
+	starttime = ktime_get();
 	error = cb(dev);
+	if (state.event == PM_EVENT_RESUME)
+		log_device_resume_time(dev, info,
+			ktime_to_us(ktime_sub(ktime_get(), starttime)));
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
@@ -832,6 +836,20 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	return error;
 }
 
+/*
+ * With pm_async_resume_all set every device is resumed from an async thread
+ * in the "resume" phase, not only those that opted in with async_suspend.
+ * The only ordering kept is the one against the parent, which
+ * device_resume() waits for, so this is a debug/tuning knob for platforms
+ * whose drivers are known to get their other dependencies right.
+ */
+static bool is_async_resume(struct device *dev)
+{
+	return is_async(dev) ||
+		(pm_async_resume_all && pm_async_enabled &&
+		 !pm_trace_is_enabled());
+}
+
 static void async_resume(void *data, async_cookie_t cookie)
 {
 	struct device *dev = (struct device *)data;
@@ -864,7 +882,7 @@ void dpm_resume(pm_message_t state)
 
 	list_for_each_entry(dev, &dpm_suspended_list, power.entry) {
 		reinit_completion(&dev->power.completion);
-		if (is_async(dev)) {
+		if (is_async_resume(dev)) {
 			get_device(dev);
 			async_schedule(async_resume, dev);
 		}
@@ -873,7 +891,7 @@ void dpm_resume(pm_message_t state)
 	while (!list_empty(&dpm_suspended_list)) {
 		dev = to_device(dpm_suspended_list.next);
 		get_device(dev);
-		if (!is_async(dev)) {
+		if (!is_async_resume(dev)) {
 			int error;
 
 			mutex_unlock(&dpm_list_mtx);
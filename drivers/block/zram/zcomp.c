@@ -8,6 +8,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/string.h>
 #include <linux/err.h>
 #include <linux/slab.h>
@@ -88,6 +89,7 @@ bool zcomp_available_algorithm(const char *comp)
 	 */
 	return crypto_has_comp(comp, 0, 0) == 1;
 }
+EXPORT_SYMBOL_GPL(zcomp_available_algorithm);
 
 /* show available compressors */
 ssize_t zcomp_available_show(const char *comp, char *buf)
@@ -123,11 +125,13 @@ struct zcomp_strm *zcomp_stream_get(struct zcomp *comp)
 {
 	return *get_cpu_ptr(comp->stream);
 }
+EXPORT_SYMBOL_GPL(zcomp_stream_get);
 
 void zcomp_stream_put(struct zcomp *comp)
 {
 	put_cpu_ptr(comp->stream);
 }
+EXPORT_SYMBOL_GPL(zcomp_stream_put);
 
 int zcomp_compress(struct zcomp_strm *zstrm,
 		const void *src, unsigned int *dst_len)
@@ -152,6 +156,7 @@ int zcomp_compress(struct zcomp_strm *zstrm,
 			src, PAGE_SIZE,
 			zstrm->buffer, dst_len);
 }
+EXPORT_SYMBOL_GPL(zcomp_compress);
 
 int zcomp_decompress(struct zcomp_strm *zstrm,
 		const void *src, unsigned int src_len, void *dst)
@@ -162,6 +167,7 @@ int zcomp_decompress(struct zcomp_strm *zstrm,
 			src, src_len,
 			dst, &dst_len);
 }
+EXPORT_SYMBOL_GPL(zcomp_decompress);
 
 static int __zcomp_cpu_notifier(struct zcomp *comp,
 		unsigned long action, unsigned long cpu)
@@ -242,6 +248,7 @@ void zcomp_destroy(struct zcomp *comp)
 	free_percpu(comp->stream);
 	kfree(comp);
 }
+EXPORT_SYMBOL_GPL(zcomp_destroy);
 
 /*
  * search available compressors for requested algorithm.
@@ -271,3 +278,4 @@ struct zcomp *zcomp_create(const char *compress)
 	}
 	return comp;
 }
+EXPORT_SYMBOL_GPL(zcomp_create);
@@ -0,0 +1,422 @@
+/*
+ * zram store/load benchmark
+ *
+ * Loads a corpus of page snapshots from a file, then stores every page
+ * into a zsmalloc pool and loads it back the way zram's bvec write and
+ * read paths do, from a number of threads at once. Reports throughput,
+ * latency percentiles, compression ratio and pool usage. The pool and
+ * its zsmalloc debugfs entry, which has the per size class statistics
+ * with CONFIG_ZSMALLOC_STAT, are kept until the module is removed.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/completion.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/zsmalloc.h>
+
+#include "zcomp.h"
+
+static char *corpus;
+module_param(corpus, charp, 0444);
+MODULE_PARM_DESC(corpus, "File of page sized anonymous memory snapshots");
+
+static char *comp = "lzo";
+module_param(comp, charp, 0444);
+MODULE_PARM_DESC(comp, "Compression algorithm");
+
+static unsigned int threads = 1;
+module_param(threads, uint, 0444);
+MODULE_PARM_DESC(threads, "Number of threads storing and loading pages");
+
+static unsigned int max_pages = 65536;
+module_param(max_pages, uint, 0444);
+MODULE_PARM_DESC(max_pages, "Most pages of the corpus to use");
+
+enum zram_bench_op {
+	ZRAM_BENCH_STORE,
+	ZRAM_BENCH_LOAD,
+};
+
+static const char * const zram_bench_op_names[] = {
+	[ZRAM_BENCH_STORE]	= "store",
+	[ZRAM_BENCH_LOAD]	= "load",
+};
+
+struct zram_bench_page {
+	unsigned long handle;
+	unsigned long element;
+	unsigned int len;
+	bool same;
+};
+
+static struct zcomp *zram_bench_comp;
+static struct zs_pool *zram_bench_pool;
+static size_t zram_bench_huge_size;
+static struct zram_bench_page *zram_bench_pages;
+static u8 *zram_bench_data;
+static unsigned int zram_bench_nr_pages;
+static u32 *zram_bench_lat;
+
+struct zram_bench_worker {
+	enum zram_bench_op op;
+	unsigned int idx;
+	u8 *buf;
+	int ret;
+	unsigned long mismatches;
+	atomic_t *running;
+	struct completion *done;
+};
+
+static bool zram_bench_same_filled(const void *ptr)
+{
+	const unsigned long *page = ptr;
+	unsigned int pos;
+
+	for (pos = 1; pos < PAGE_SIZE / sizeof(*page); pos++)
+		if (page[pos] != page[0])
+			return false;
+	return true;
+}
+
+/* compress and store one page, as __zram_bvec_write() */
+static int zram_bench_store(struct zram_bench_page *zp, const u8 *src)
+{
+	unsigned long handle = 0;
+	struct zcomp_strm *zstrm;
+	unsigned int len;
+	void *dst;
+	int ret;
+
+	if (zram_bench_same_filled(src)) {
+		zp->element = *(const unsigned long *)src;
+		zp->same = true;
+		return 0;
+	}
+
+again:
+	zstrm = zcomp_stream_get(zram_bench_comp);
+	ret = zcomp_compress(zstrm, src, &len);
+	if (ret) {
+		zcomp_stream_put(zram_bench_comp);
+		zs_free(zram_bench_pool, handle);
+		return ret;
+	}
+	if (len >= zram_bench_huge_size)
+		len = PAGE_SIZE;
+
+	if (!handle)
+		handle = zs_malloc(zram_bench_pool, len,
+				   __GFP_KSWAPD_RECLAIM | __GFP_NOWARN |
+				   __GFP_HIGHMEM | __GFP_MOVABLE);
+	if (!handle) {
+		zcomp_stream_put(zram_bench_comp);
+		handle = zs_malloc(zram_bench_pool, len,
+				   GFP_NOIO | __GFP_HIGHMEM | __GFP_MOVABLE);
+		if (handle)
+			goto again;
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram_bench_pool, handle, ZS_MM_WO);
+	memcpy(dst, len == PAGE_SIZE ? src : zstrm->buffer, len);
+	zs_unmap_object(zram_bench_pool, handle);
+	zcomp_stream_put(zram_bench_comp);
+
+	zp->handle = handle;
+	zp->len = len;
+	return 0;
+}
+
+/* load and decompress one page, as __zram_bvec_read() */
+static int zram_bench_load(struct zram_bench_page *zp, u8 *dst)
+{
+	struct zcomp_strm *zstrm;
+	void *src;
+	int ret = 0;
+
+	if (zp->same) {
+		unsigned long *page = (unsigned long *)dst;
+		unsigned int pos;
+
+		for (pos = 0; pos < PAGE_SIZE / sizeof(*page); pos++)
+			page[pos] = zp->element;
+		return 0;
+	}
+
+	src = zs_map_object(zram_bench_pool, zp->handle, ZS_MM_RO);
+	if (zp->len == PAGE_SIZE) {
+		memcpy(dst, src, PAGE_SIZE);
+	} else {
+		zstrm = zcomp_stream_get(zram_bench_comp);
+		ret = zcomp_decompress(zstrm, src, zp->len, dst);
+		zcomp_stream_put(zram_bench_comp);
+	}
+	zs_unmap_object(zram_bench_pool, zp->handle);
+	return ret;
+}
+
+static int zram_bench_thread(void *data)
+{
+	struct zram_bench_worker *w = data;
+	unsigned int i;
+	ktime_t start;
+
+	for (i = w->idx; i < zram_bench_nr_pages; i += threads) {
+		struct zram_bench_page *zp = &zram_bench_pages[i];
+		const u8 *orig = zram_bench_data + (size_t)i * PAGE_SIZE;
+
+		start = ktime_get();
+		if (w->op == ZRAM_BENCH_STORE)
+			w->ret = zram_bench_store(zp, orig);
+		else
+			w->ret = zram_bench_load(zp, w->buf);
+		zram_bench_lat[i] = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (w->ret)
+			break;
+
+		if (w->op == ZRAM_BENCH_LOAD && memcmp(w->buf, orig, PAGE_SIZE))
+			w->mismatches++;
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(w->running))
+		complete(w->done);
+	return 0;
+}
+
+static int zram_bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int zram_bench_run(enum zram_bench_op op)
+{
+	struct zram_bench_worker *workers;
+	DECLARE_COMPLETION_ONSTACK(done);
+	unsigned int i, n = zram_bench_nr_pages;
+	unsigned long mismatches = 0;
+	atomic_t running;
+	u64 ns, sum = 0;
+	ktime_t start;
+	int ret = 0;
+
+	workers = kcalloc(threads, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return -ENOMEM;
+
+	atomic_set(&running, threads);
+	for (i = 0; i < threads; i++) {
+		workers[i].op = op;
+		workers[i].idx = i;
+		workers[i].running = &running;
+		workers[i].done = &done;
+		workers[i].buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!workers[i].buf)
+			ret = -ENOMEM;
+	}
+	if (ret)
+		goto out;
+
+	start = ktime_get();
+	for (i = 0; i < threads; i++) {
+		struct task_struct *task;
+
+		task = kthread_run(zram_bench_thread, &workers[i],
+				   "zram_bench/%u", i);
+		if (IS_ERR(task)) {
+			/* account for the threads that never ran */
+			ret = PTR_ERR(task);
+			if (atomic_sub_and_test(threads - i, &running))
+				complete(&done);
+			break;
+		}
+	}
+	wait_for_completion(&done);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (ret)
+		goto out;
+
+	for (i = 0; i < threads; i++) {
+		mismatches += workers[i].mismatches;
+		if (workers[i].ret)
+			ret = workers[i].ret;
+	}
+	if (ret) {
+		pr_err("%s failed: %d\n", zram_bench_op_names[op], ret);
+		goto out;
+	}
+	if (mismatches) {
+		pr_err("%lu pages loaded back wrong\n", mismatches);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	sort(zram_bench_lat, n, sizeof(*zram_bench_lat), zram_bench_cmp_u32,
+	     NULL);
+	for (i = 0; i < n; i++)
+		sum += zram_bench_lat[i];
+
+	pr_info("%-5s %u threads %6llu MB/s ns avg %llu p50 %u p90 %u p99 %u max %u\n",
+		zram_bench_op_names[op], threads,
+		ns ? div64_u64((u64)n * PAGE_SIZE * 1000, ns) : 0,
+		div_u64(sum, n), zram_bench_lat[n / 2],
+		zram_bench_lat[n * 9 / 10], zram_bench_lat[n * 99 / 100],
+		zram_bench_lat[n - 1]);
+out:
+	for (i = 0; i < threads; i++)
+		kfree(workers[i].buf);
+	kfree(workers);
+	return ret;
+}
+
+static int zram_bench_load_corpus(void)
+{
+	struct file *file;
+	loff_t size;
+	size_t len, off = 0;
+	int ret = 0;
+
+	file = filp_open(corpus, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(file)) {
+		pr_err("cannot open %s\n", corpus);
+		return PTR_ERR(file);
+	}
+
+	size = i_size_read(file_inode(file));
+	zram_bench_nr_pages = min_t(loff_t, size >> PAGE_SHIFT, max_pages);
+	if (!zram_bench_nr_pages) {
+		pr_err("%s holds no whole page\n", corpus);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	len = (size_t)zram_bench_nr_pages * PAGE_SIZE;
+	zram_bench_data = vmalloc(len);
+	if (!zram_bench_data) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	while (off < len) {
+		int n = kernel_read(file, off, zram_bench_data + off,
+				    min_t(size_t, len - off, SZ_1M));
+
+		if (n <= 0) {
+			pr_err("short read of %s\n", corpus);
+			ret = n < 0 ? n : -EIO;
+			goto out;
+		}
+		off += n;
+	}
+out:
+	fput(file);
+	return ret;
+}
+
+static void zram_bench_free(void)
+{
+	unsigned int i;
+
+	if (zram_bench_pages)
+		for (i = 0; i < zram_bench_nr_pages; i++)
+			if (zram_bench_pages[i].handle)
+				zs_free(zram_bench_pool,
+					zram_bench_pages[i].handle);
+	if (zram_bench_pool)
+		zs_destroy_pool(zram_bench_pool);
+	if (!IS_ERR_OR_NULL(zram_bench_comp))
+		zcomp_destroy(zram_bench_comp);
+	vfree(zram_bench_pages);
+	vfree(zram_bench_lat);
+	vfree(zram_bench_data);
+}
+
+static int __init zram_bench_init(void)
+{
+	u64 comp_bytes = 0, pool_bytes;
+	unsigned int i, same = 0, huge = 0;
+	int ret;
+
+	if (!corpus || !threads)
+		return -EINVAL;
+
+	ret = zram_bench_load_corpus();
+	if (ret)
+		goto err;
+
+	ret = -ENOMEM;
+	zram_bench_pages = vzalloc(zram_bench_nr_pages *
+				   sizeof(*zram_bench_pages));
+	zram_bench_lat = vmalloc(zram_bench_nr_pages *
+				 sizeof(*zram_bench_lat));
+	zram_bench_pool = zs_create_pool("zram_bench");
+	if (!zram_bench_pages || !zram_bench_lat || !zram_bench_pool)
+		goto err;
+	zram_bench_huge_size = zs_huge_class_size(zram_bench_pool);
+
+	zram_bench_comp = zcomp_create(comp);
+	if (IS_ERR(zram_bench_comp)) {
+		pr_err("cannot initialise %s compressor\n", comp);
+		ret = PTR_ERR(zram_bench_comp);
+		goto err;
+	}
+
+	pr_info("%u pages from %s, %s\n", zram_bench_nr_pages, corpus, comp);
+
+	ret = zram_bench_run(ZRAM_BENCH_STORE);
+	if (ret)
+		goto err;
+	ret = zram_bench_run(ZRAM_BENCH_LOAD);
+	if (ret)
+		goto err;
+
+	for (i = 0; i < zram_bench_nr_pages; i++) {
+		if (zram_bench_pages[i].same)
+			same++;
+		else if (zram_bench_pages[i].len == PAGE_SIZE)
+			huge++;
+		comp_bytes += zram_bench_pages[i].len;
+	}
+	pool_bytes = (u64)zs_get_total_pages(zram_bench_pool) << PAGE_SHIFT;
+
+	pr_info("same %u huge %u compressed %llu%% pool %llu kB, %llu%% used\n",
+		same, huge,
+		div64_u64(comp_bytes * 100,
+			  (u64)zram_bench_nr_pages * PAGE_SIZE),
+		pool_bytes >> 10,
+		pool_bytes ? div64_u64(comp_bytes * 100, pool_bytes) : 0);
+	return 0;
+
+err:
+	zram_bench_free();
+	return ret;
+}
+
+static void __exit zram_bench_exit(void)
+{
+	zram_bench_free();
+}
+
+module_init(zram_bench_init);
+module_exit(zram_bench_exit);
+
+MODULE_DESCRIPTION("zram store and load benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,180 @@
+/*
+ * Same content page deduplication for zram
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/highmem.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/xxhash.h>
+
+#include "zram_drv.h"
+
+/*
+ * A zsmalloc object shared by every slot that stores the same page. The
+ * entries live in an rbtree keyed by the checksum of the uncompressed
+ * page; checksum collisions are allowed and resolved by comparing the
+ * contents.
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u64 checksum;
+	unsigned long refcount;
+	unsigned long handle;
+	unsigned int len;
+};
+
+u64 zram_dedup_checksum(struct page *page)
+{
+	void *mem;
+	u64 checksum;
+
+	mem = kmap_atomic(page);
+	checksum = xxh64(mem, PAGE_SIZE, 0);
+	kunmap_atomic(mem);
+
+	return checksum;
+}
+
+unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return entry->handle;
+}
+
+unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return entry->len;
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				struct page *page)
+{
+	struct zcomp_strm *zstrm;
+	void *src, *mem;
+	bool match;
+
+	zstrm = zcomp_stream_get(zram->comp);
+	src = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	mem = kmap_atomic(page);
+	if (entry->len == PAGE_SIZE) {
+		match = !memcmp(mem, src, PAGE_SIZE);
+	} else {
+		/* Decompressing is a lot cheaper than compressing the page */
+		match = !zcomp_decompress(zstrm, src, entry->len,
+					  zstrm->buffer) &&
+			!memcmp(mem, zstrm->buffer, PAGE_SIZE);
+	}
+	kunmap_atomic(mem);
+	zs_unmap_object(zram->mem_pool, entry->handle);
+	zcomp_stream_put(zram->comp);
+
+	return match;
+}
+
+/*
+ * Look for an already stored copy of @page. On success a reference on the
+ * returned entry is handed to the caller.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, struct page *page,
+				u64 checksum)
+{
+	struct rb_node *node;
+	struct zram_entry *entry = NULL;
+
+	spin_lock(&zram->dedup_lock);
+	node = zram->dedup_root.rb_node;
+	while (node) {
+		struct zram_entry *cur;
+
+		cur = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum == cur->checksum) {
+			entry = cur;
+			entry->refcount++;
+			break;
+		}
+		node = checksum < cur->checksum ? node->rb_left :
+						  node->rb_right;
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	if (!entry)
+		return NULL;
+
+	/* Every reference but the last one accounts as duplicate data */
+	atomic64_add(entry->len, &zram->stats.dup_data_size);
+	if (zram_dedup_match(zram, entry, page))
+		return entry;
+
+	/* Checksum collision; keep the page unshared */
+	zram_dedup_put(zram, entry);
+	return NULL;
+}
+
+/*
+ * Make a freshly stored object shareable. Returns NULL if no entry could
+ * be allocated, in which case the caller keeps the plain handle.
+ */
+struct zram_entry *zram_dedup_add(struct zram *zram, unsigned long handle,
+				unsigned int len, u64 checksum)
+{
+	struct rb_node **p, *parent = NULL;
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	entry->handle = handle;
+	entry->len = len;
+
+	spin_lock(&zram->dedup_lock);
+	p = &zram->dedup_root.rb_node;
+	while (*p) {
+		struct zram_entry *cur;
+
+		parent = *p;
+		cur = rb_entry(parent, struct zram_entry, rb_node);
+		p = checksum < cur->checksum ? &parent->rb_left :
+					       &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, p);
+	rb_insert_color(&entry->rb_node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/* Drop a reference and free the object once the last slot lets go */
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	unsigned long refcount;
+
+	spin_lock(&zram->dedup_lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	zs_free(zram->mem_pool, entry->handle);
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kfree(entry);
+}
+
+void zram_dedup_init(struct zram *zram)
+{
+	spin_lock_init(&zram->dedup_lock);
+	zram->dedup_root = RB_ROOT;
+}
@@ -0,0 +1,48 @@
+/*
+ * Same content page deduplication for zram
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_entry;
+
+#ifdef CONFIG_ZRAM_DEDUP
+u64 zram_dedup_checksum(struct page *page);
+struct zram_entry *zram_dedup_find(struct zram *zram, struct page *page,
+				u64 checksum);
+struct zram_entry *zram_dedup_add(struct zram *zram, unsigned long handle,
+				unsigned int len, u64 checksum);
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+unsigned long zram_dedup_handle(struct zram_entry *entry);
+unsigned int zram_dedup_len(struct zram_entry *entry);
+void zram_dedup_init(struct zram *zram);
+#else
+static inline u64 zram_dedup_checksum(struct page *page) { return 0; }
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		struct page *page, u64 checksum) { return NULL; }
+static inline struct zram_entry *zram_dedup_add(struct zram *zram,
+		unsigned long handle, unsigned int len, u64 checksum)
+{
+	return NULL;
+}
+static inline void zram_dedup_put(struct zram *zram,
+		struct zram_entry *entry) { }
+static inline unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline void zram_dedup_init(struct zram *zram) { }
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
@@ -32,6 +32,10 @@
 #include <linux/idr.h>
 #include <linux/sysfs.h>
 #include <linux/debugfs.h>
+#include <linux/freezer.h>
+#include <linux/kthread.h>
+#include <linux/workqueue.h>
+#include <linux/cpumask.h>
 
 #include "zram_drv.h"
 
@@ -53,8 +57,25 @@ static unsigned int num_devices = 1;
  * uncompressed in memory.
  */
 static size_t huge_class_size;
+/*
+ * The recompression thread scans this many slots every recomp_interval
+ * seconds. A slot that wasn't accessed for a whole sweep of the device
+ * is considered cold and recompressed with the secondary algorithm.
+ */
+static unsigned int recomp_batch = 1024;
+static unsigned int recomp_interval = 10;
+/*
+ * Spread the pages of multi-page write bios over the online CPUs so that
+ * compression doesn't serialize on the submitter (typically kswapd).
+ */
+static bool parallel_write;
+static struct workqueue_struct *zram_write_wq;
 
 static void zram_free_page(struct zram *zram, size_t index);
+static void __zram_free_page(struct zram *zram, size_t index,
+			     struct zram_free_batch *batch);
+static void zram_free_batch_flush(struct zram *zram,
+				  struct zram_free_batch *batch);
 
 static void zram_slot_lock(struct zram *zram, u32 index)
 {
@@ -288,6 +309,40 @@ static ssize_t mem_used_max_store(struct device *dev,
 	return len;
 }
 
+/*
+ * Writing "all" marks every stored slot idle. The mark is dropped again
+ * the next time the slot is read or written, so slots that are still idle
+ * later on are known to be cold.
+ */
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages, index;
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (zram_allocated(zram, index) &&
+		    !zram_test_flag(zram, index, ZRAM_WB))
+			zram_set_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
 #ifdef CONFIG_ZRAM_WRITEBACK
 static bool zram_wb_enabled(struct zram *zram)
 {
@@ -466,6 +521,66 @@ static unsigned long get_entry_bdev(struct zram *zram)
 	return entry;
 }
 
+/*
+ * Allocate @nr contiguous blocks on the backing device so they can be
+ * written with a single bio. Returns the first block or 0 on failure.
+ */
+static unsigned long get_entries_bdev(struct zram *zram, unsigned int nr)
+{
+	unsigned long entry;
+
+	spin_lock(&zram->bitmap_lock);
+	/* skip 0 bit to confuse zram.handle = 0 */
+	entry = bitmap_find_next_zero_area(zram->bitmap, zram->nr_pages, 1,
+					   nr, 0);
+	if (entry >= zram->nr_pages) {
+		spin_unlock(&zram->bitmap_lock);
+		return 0;
+	}
+
+	bitmap_set(zram->bitmap, entry, nr);
+	spin_unlock(&zram->bitmap_lock);
+
+	return entry;
+}
+
+/*
+ * Charge @nr page writes against the daily writeback budget that protects
+ * the endurance of the backing flash. Returns how many may be written.
+ */
+static unsigned int zram_wb_budget(struct zram *zram, unsigned int nr)
+{
+	unsigned long limit = READ_ONCE(zram->wb_limit_pages);
+
+	if (!limit)
+		return nr;
+
+	spin_lock(&zram->bitmap_lock);
+	if (time_after_eq(jiffies, zram->wb_limit_start + 24 * 3600 * HZ)) {
+		zram->wb_limit_start = jiffies;
+		zram->wb_pages_today = 0;
+	}
+	if (zram->wb_pages_today >= limit)
+		nr = 0;
+	else
+		nr = min_t(unsigned long, nr, limit - zram->wb_pages_today);
+	zram->wb_pages_today += nr;
+	spin_unlock(&zram->bitmap_lock);
+
+	return nr;
+}
+
+/* Give back budget charged for writes that did not happen */
+static void zram_wb_refund(struct zram *zram, unsigned int nr)
+{
+	if (!READ_ONCE(zram->wb_limit_pages) || !nr)
+		return;
+
+	spin_lock(&zram->bitmap_lock);
+	zram->wb_pages_today -= min_t(unsigned long, nr, zram->wb_pages_today);
+	spin_unlock(&zram->bitmap_lock);
+}
+
 static void put_entry_bdev(struct zram *zram, unsigned long entry)
 {
 	int was_set;
@@ -567,6 +682,7 @@ static int read_from_bdev_sync(struct zram *zram, struct bio_vec *bvec,
 static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
 			unsigned long entry, struct bio *parent, bool sync)
 {
+	atomic64_inc(&zram->stats.bd_reads);
 	if (sync)
 		return read_from_bdev_sync(zram, bvec, entry, parent);
 	else
@@ -580,13 +696,19 @@ static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
 	struct bio *bio;
 	unsigned long entry;
 
+	if (!zram_wb_budget(zram, 1))
+		return -ENOSPC;
+
 	bio = bio_alloc(GFP_ATOMIC, 1);
-	if (!bio)
+	if (!bio) {
+		zram_wb_refund(zram, 1);
 		return -ENOMEM;
+	}
 
 	entry = get_entry_bdev(zram);
 	if (!entry) {
 		bio_put(bio);
+		zram_wb_refund(zram, 1);
 		return -ENOSPC;
 	}
 
@@ -596,6 +718,7 @@ static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
 					bvec->bv_offset)) {
 		bio_put(bio);
 		put_entry_bdev(zram, entry);
+		zram_wb_refund(zram, 1);
 		return -EIO;
 	}
 
@@ -609,6 +732,8 @@ static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
 
 	submit_bio(WRITE, bio);
 	*pentry = entry;
+	atomic64_inc(&zram->stats.bd_writes);
+	atomic64_inc(&zram->stats.bd_count);
 
 	return 0;
 }
@@ -621,6 +746,7 @@ static void zram_wb_clear(struct zram *zram, u32 index)
 	entry = zram_get_element(zram, index);
 	zram_set_element(zram, index, 0);
 	put_entry_bdev(zram, entry);
+	atomic64_dec(&zram->stats.bd_count);
 }
 
 #else
@@ -703,12 +829,15 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 
 		ts = ktime_to_timespec64(zram->table[index].ac_time);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
-			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.');
+			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.',
+			zram_test_flag(zram, index, ZRAM_RECOMP) ? 'r' : '.',
+			zram_test_flag(zram, index, ZRAM_DEDUP) ? 'd' : '.');
 
 		if (count < copied) {
 			zram_slot_unlock(zram, index);
@@ -821,6 +950,88 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recompressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+/*
+ * Selects the denser algorithm cold pages get recompressed with in the
+ * background. An empty string or "none" disables recompression.
+ */
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recompressor)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!strcmp(compressor, "none"))
+		compressor[0] = 0x00;
+	else if (compressor[0] && !zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recompressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -877,7 +1088,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -885,7 +1096,26 @@ static ssize_t mm_stat_show(struct device *dev,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			atomic_long_read(&pool_stats.pages_compacted),
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			(u64)atomic64_read(&zram->stats.huge_pages),
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+static ssize_t recomp_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.recomp_pages),
+			(u64)atomic64_read(&zram->stats.recomp_saved),
+			(u64)atomic64_read(&zram->stats.recomp_failed));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -911,15 +1141,18 @@ static ssize_t debug_stat_show(struct device *dev,
 static DEVICE_ATTR_RO(io_stat);
 static DEVICE_ATTR_RO(mm_stat);
 static DEVICE_ATTR_RO(debug_stat);
+static DEVICE_ATTR_RO(recomp_stat);
 
 static void zram_meta_free(struct zram *zram, u64 disksize)
 {
 	size_t num_pages = disksize >> PAGE_SHIFT;
+	struct zram_free_batch batch = { .nr = 0 };
 	size_t index;
 
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < num_pages; index++)
-		zram_free_page(zram, index);
+		__zram_free_page(zram, index, &batch);
+	zram_free_batch_flush(zram, &batch);
 
 	zs_destroy_pool(zram->mem_pool);
 	vfree(zram->table);
@@ -945,17 +1178,39 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 	return true;
 }
 
+static void zram_free_batch_flush(struct zram *zram,
+				  struct zram_free_batch *batch)
+{
+	if (!batch->nr)
+		return;
+
+	zs_free_bulk(zram->mem_pool, batch->handles, batch->nr);
+	batch->nr = 0;
+}
+
 /*
  * To protect concurrent access to the same index entry,
  * caller should hold this table index entry's bit_spinlock to
  * indicate this index entry is accessing.
+ *
+ * With a @batch, the zsmalloc object is queued there instead of being
+ * released right away; the slot itself is cleared either way, so the
+ * caller may drop the slot lock before flushing the batch.
  */
-static void zram_free_page(struct zram *zram, size_t index)
+static void __zram_free_page(struct zram *zram, size_t index,
+			     struct zram_free_batch *batch)
 {
 	unsigned long handle;
 
 	zram_reset_access(zram, index);
 
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_flag(zram, index, ZRAM_RECOMP_SKIP);
+	if (zram_test_flag(zram, index, ZRAM_RECOMP)) {
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+		atomic64_dec(&zram->stats.recomp_pages);
+	}
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
 		atomic64_dec(&zram->stats.huge_pages);
@@ -983,7 +1238,22 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
-	zs_free(zram->mem_pool, handle);
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		zram_dedup_put(zram, (struct zram_entry *)handle);
+		atomic64_dec(&zram->stats.pages_stored);
+		zram_set_handle(zram, index, 0);
+		zram_set_obj_size(zram, index, 0);
+		return;
+	}
+
+	if (batch) {
+		batch->handles[batch->nr++] = handle;
+		if (batch->nr == ZRAM_FREE_BATCH)
+			zram_free_batch_flush(zram, batch);
+	} else {
+		zs_free(zram->mem_pool, handle);
+	}
 
 	atomic64_sub(zram_get_obj_size(zram, index),
 			&zram->stats.compr_data_size);
@@ -993,6 +1263,19 @@ static void zram_free_page(struct zram *zram, size_t index)
 	zram_set_obj_size(zram, index, 0);
 }
 
+static void zram_free_page(struct zram *zram, size_t index)
+{
+	__zram_free_page(zram, index, NULL);
+}
+
+/* Which compressor the slot was stored with; slot lock must be held */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+	return zram->comp;
+}
+
 static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 				struct bio *bio, bool partial_io)
 {
@@ -1033,6 +1316,8 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	}
 
 	size = zram_get_obj_size(zram, index);
+	if (zram_test_flag(zram, index, ZRAM_DEDUP))
+		handle = zram_dedup_handle((struct zram_entry *)handle);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1041,12 +1326,13 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		kunmap_atomic(dst);
 		ret = 0;
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram_slot_comp(zram, index);
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
 
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
 	zram_slot_unlock(zram, index);
@@ -1104,6 +1390,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
 	bool allow_wb = true;
+	struct zram_entry *entry;
+	u64 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1115,6 +1403,17 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	}
 	kunmap_atomic(mem);
 
+	if (zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(page);
+		entry = zram_dedup_find(zram, page, checksum);
+		if (entry) {
+			comp_len = zram_dedup_len(entry);
+			flags = ZRAM_DEDUP;
+			element = (unsigned long)entry;
+			goto out;
+		}
+	}
+
 compress_again:
 	zstrm = zcomp_stream_get(zram->comp);
 	src = kmap_atomic(page);
@@ -1194,6 +1493,14 @@ compress_again:
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	if (zram_dedup_enabled(zram)) {
+		entry = zram_dedup_add(zram, handle, comp_len, checksum);
+		if (entry) {
+			flags = ZRAM_DEDUP;
+			element = (unsigned long)entry;
+		}
+	}
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1210,6 +1517,8 @@ out:
 	if (flags) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
+		if (flags == ZRAM_DEDUP)
+			zram_set_obj_size(zram, index, comp_len);
 	}  else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
@@ -1262,6 +1571,403 @@ out:
 	return ret;
 }
 
+/*
+ * Recompress one cold slot with the secondary algorithm. Everything is
+ * done under the slot lock so the slot can't change underneath us, which
+ * means nothing here may sleep. @page is scratch space for the data.
+ */
+static void zram_recompress_slot(struct zram *zram, u32 index,
+				 struct page *page)
+{
+	unsigned long handle, new_handle;
+	unsigned int size, comp_len;
+	struct zcomp_strm *zstrm;
+	void *src, *dst;
+	int ret;
+
+	handle = zram_get_handle(zram, index);
+	size = zram_get_obj_size(zram, index);
+
+	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	dst = kmap_atomic(page);
+	if (size == PAGE_SIZE) {
+		memcpy(dst, src, PAGE_SIZE);
+		ret = 0;
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		ret = zcomp_decompress(zstrm, src, size, dst);
+		zcomp_stream_put(zram->comp);
+	}
+	kunmap_atomic(dst);
+	zs_unmap_object(zram->mem_pool, handle);
+	if (unlikely(ret))
+		return;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+
+	/* Not worth it, remember that so the slot isn't tried again */
+	if (ret || comp_len >= size || comp_len >= huge_class_size) {
+		zcomp_stream_put(zram->recomp);
+		zram_set_flag(zram, index, ZRAM_RECOMP_SKIP);
+		atomic64_inc(&zram->stats.recomp_failed);
+		return;
+	}
+
+	new_handle = zs_malloc(zram->mem_pool, comp_len,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!new_handle) {
+		zcomp_stream_put(zram->recomp);
+		return;
+	}
+
+	dst = zs_map_object(zram->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, new_handle);
+
+	zs_free(zram->mem_pool, handle);
+	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
+		zram_clear_flag(zram, index, ZRAM_HUGE);
+		atomic64_dec(&zram->stats.huge_pages);
+	}
+	zram_set_handle(zram, index, new_handle);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+
+	atomic64_sub(size - comp_len, &zram->stats.compr_data_size);
+	atomic64_add(size - comp_len, &zram->stats.recomp_saved);
+	atomic64_inc(&zram->stats.recomp_pages);
+}
+
+/*
+ * Scan the next batch of slots. Slots that are not idle yet get marked
+ * idle, and any access clears the mark again, so a slot that is still
+ * idle when the scan comes back around has been cold for a full sweep.
+ */
+static void zram_recompress_pass(struct zram *zram, struct page *page)
+{
+	unsigned long nr_pages, index;
+	unsigned int i, batch = READ_ONCE(recomp_batch);
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return;
+	}
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	index = zram->recomp_index;
+	for (i = 0; i < batch && !kthread_should_stop(); i++) {
+		if (++index >= nr_pages)
+			index = 0;
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_RECOMP) ||
+		    zram_test_flag(zram, index, ZRAM_RECOMP_SKIP) ||
+		    zram_test_flag(zram, index, ZRAM_DEDUP))
+			goto next;
+
+		if (!zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_set_flag(zram, index, ZRAM_IDLE);
+			goto next;
+		}
+
+		zram_recompress_slot(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+	zram->recomp_index = index;
+	up_read(&zram->init_lock);
+}
+
+static int zram_recomp_thread(void *data)
+{
+	struct zram *zram = data;
+	struct page *page = NULL;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		if (!page)
+			page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
+		if (page)
+			zram_recompress_pass(zram, page);
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			freezable_schedule_timeout(
+				READ_ONCE(recomp_interval) * HZ);
+		__set_current_state(TASK_RUNNING);
+	}
+
+	if (page)
+		__free_page(page);
+	return 0;
+}
+
+/* Must be called with init_lock held for write */
+static void zram_recomp_start(struct zram *zram)
+{
+	static const struct sched_param param = {
+		.sched_priority = 0,
+	};
+	struct task_struct *task;
+
+	if (!zram->recomp)
+		return;
+
+	zram->recomp_index = 0;
+	task = kthread_create(zram_recomp_thread, zram, "%s_recomp",
+			      zram->disk->disk_name);
+	if (IS_ERR(task)) {
+		pr_err("Failed to start recompression for %s\n",
+		       zram->disk->disk_name);
+		return;
+	}
+
+	/* Only ever run when the CPU would otherwise be idle */
+	sched_setscheduler_nocheck(task, SCHED_IDLE, &param);
+	zram->recomp_task = task;
+	wake_up_process(task);
+}
+
+static void zram_recomp_stop(struct zram *zram)
+{
+	if (zram->recomp_task) {
+		kthread_stop(zram->recomp_task);
+		zram->recomp_task = NULL;
+	}
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* Pages written back to the backing device per bio */
+#define ZRAM_WB_BATCH	32
+
+/*
+ * Write one batch of slots to contiguous blocks with a single bio. The
+ * slots are marked idle while their data is read, and any access in the
+ * meantime clears the mark, so a slot that is no longer idle when the
+ * write completes has changed and keeps its in-memory copy.
+ */
+static int zram_writeback_batch(struct zram *zram, struct page **pages,
+				u32 *indexes, unsigned int nr)
+{
+	unsigned long entry = 0;
+	unsigned int i, allowed;
+	struct bio *bio;
+	int ret;
+
+	allowed = zram_wb_budget(zram, nr);
+	if (!allowed)
+		return -ENOSPC;
+
+	/* Fall back to smaller runs on a fragmented backing device */
+	for (; allowed; allowed >>= 1) {
+		entry = get_entries_bdev(zram, allowed);
+		if (entry)
+			break;
+	}
+	zram_wb_refund(zram, nr - allowed);
+	if (!entry)
+		return -ENOSPC;
+
+	bio = bio_alloc(GFP_KERNEL, allowed);
+	bio->bi_iter.bi_sector = entry * (PAGE_SIZE >> 9);
+	bio->bi_bdev = zram->bdev;
+	for (i = 0; i < allowed; i++)
+		bio_add_page(bio, pages[i], PAGE_SIZE, 0);
+
+	ret = submit_bio_wait(WRITE | REQ_SYNC, bio);
+	bio_put(bio);
+	if (ret) {
+		for (i = 0; i < allowed; i++)
+			put_entry_bdev(zram, entry + i);
+		zram_wb_refund(zram, allowed);
+		return ret;
+	}
+	atomic64_add(allowed, &zram->stats.bd_writes);
+
+	for (i = 0; i < allowed; i++) {
+		u32 index = indexes[i];
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+		    !zram_test_flag(zram, index, ZRAM_IDLE) ||
+		    zram_test_flag(zram, index, ZRAM_WB)) {
+			zram_slot_unlock(zram, index);
+			put_entry_bdev(zram, entry + i);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, entry + i);
+		atomic64_inc(&zram->stats.pages_stored);
+		atomic64_inc(&zram->stats.bd_count);
+		zram_slot_unlock(zram, index);
+	}
+
+	/* Slots left out by a short run get picked up by the next batch */
+	return allowed;
+}
+
+/*
+ * "idle" writes back every slot still marked idle, "huge" every
+ * incompressible slot, and "idle_huge" slots that are both.
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct page *pages[ZRAM_WB_BATCH] = { NULL };
+	u32 indexes[ZRAM_WB_BATCH];
+	unsigned long nr_pages, index;
+	bool want_idle, want_huge;
+	unsigned int i, nr = 0;
+	ssize_t ret = len;
+	int err;
+
+	if (sysfs_streq(buf, "idle")) {
+		want_idle = true;
+		want_huge = false;
+	} else if (sysfs_streq(buf, "huge")) {
+		want_idle = false;
+		want_huge = true;
+	} else if (sysfs_streq(buf, "idle_huge")) {
+		want_idle = true;
+		want_huge = true;
+	} else {
+		return -EINVAL;
+	}
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if (!zram_wb_enabled(zram)) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	for (i = 0; i < ZRAM_WB_BATCH; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i]) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+		    zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    (want_idle && !zram_test_flag(zram, index, ZRAM_IDLE)) ||
+		    (want_huge && !zram_test_flag(zram, index, ZRAM_HUGE))) {
+			zram_slot_unlock(zram, index);
+			continue;
+		}
+		zram_set_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+
+		if (__zram_bvec_read(zram, pages[nr], index, NULL, false))
+			continue;
+		indexes[nr++] = index;
+		if (nr < ZRAM_WB_BATCH)
+			continue;
+
+		err = zram_writeback_batch(zram, pages, indexes, nr);
+		if (err < 0) {
+			ret = err;
+			nr = 0;
+			break;
+		}
+		/* Move what a short run left over to the front */
+		nr -= err;
+		for (i = 0; i < nr; i++) {
+			swap(pages[i], pages[err + i]);
+			indexes[i] = indexes[err + i];
+		}
+		cond_resched();
+	}
+
+	while (nr) {
+		err = zram_writeback_batch(zram, pages, indexes, nr);
+		if (err < 0) {
+			ret = err;
+			break;
+		}
+		nr -= err;
+		for (i = 0; i < nr; i++) {
+			swap(pages[i], pages[err + i]);
+			indexes[i] = indexes[err + i];
+		}
+	}
+out:
+	up_read(&zram->init_lock);
+	for (i = 0; i < ZRAM_WB_BATCH; i++)
+		if (pages[i])
+			__free_page(pages[i]);
+
+	return ret;
+}
+
+static ssize_t writeback_limit_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n",
+			 READ_ONCE(zram->wb_limit_pages));
+}
+
+/* Maximum number of pages written to the backing device per day */
+static ssize_t writeback_limit_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long val;
+
+	if (kstrtoul(buf, 10, &val))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	WRITE_ONCE(zram->wb_limit_pages, val);
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu %8llu %8lu\n",
+			(u64)atomic64_read(&zram->stats.bd_count),
+			(u64)atomic64_read(&zram->stats.bd_reads),
+			(u64)atomic64_read(&zram->stats.bd_writes),
+			zram_wb_enabled(zram) ? zram->wb_pages_today : 0);
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1271,6 +1977,7 @@ static void zram_bio_discard(struct zram *zram, u32 index,
 			     int offset, struct bio *bio)
 {
 	size_t n = bio->bi_iter.bi_size;
+	struct zram_free_batch batch = { .nr = 0 };
 
 	/*
 	 * zram manages data in physical block size units. Because logical block
@@ -1292,12 +1999,13 @@ static void zram_bio_discard(struct zram *zram, u32 index,
 
 	while (n >= PAGE_SIZE) {
 		zram_slot_lock(zram, index);
-		zram_free_page(zram, index);
+		__zram_free_page(zram, index, &batch);
 		zram_slot_unlock(zram, index);
 		atomic64_inc(&zram->stats.notify_free);
 		index++;
 		n -= PAGE_SIZE;
 	}
+	zram_free_batch_flush(zram, &batch);
 }
 
 /*
@@ -1327,6 +2035,7 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 
 	zram_slot_lock(zram, index);
 	zram_accessed(zram, index);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
 	zram_slot_unlock(zram, index);
 
 	if (unlikely(ret < 0)) {
@@ -1339,6 +2048,106 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+struct zram_write_ctx;
+
+struct zram_write_work {
+	struct work_struct work;
+	struct zram_write_ctx *ctx;
+	struct bio_vec bvec;
+	u32 index;
+};
+
+/* One per bio handled by zram_write_parallel() */
+struct zram_write_ctx {
+	struct zram *zram;
+	struct bio *bio;
+	atomic_t pending;
+	bool failed;
+	struct zram_write_work works[];
+};
+
+static void zram_write_one(struct zram_write_work *w)
+{
+	struct zram_write_ctx *ctx = w->ctx;
+
+	if (zram_bvec_rw(ctx->zram, &w->bvec, w->index, 0, WRITE,
+			 ctx->bio) < 0)
+		ctx->failed = true;
+
+	if (atomic_dec_and_test(&ctx->pending)) {
+		if (ctx->failed)
+			bio_io_error(ctx->bio);
+		else
+			bio_endio(ctx->bio);
+		kfree(ctx);
+	}
+}
+
+static void zram_write_work_fn(struct work_struct *work)
+{
+	zram_write_one(container_of(work, struct zram_write_work, work));
+}
+
+/*
+ * Compress the pages of a write bio on several CPUs and complete the bio
+ * once all of them are stored. Only page aligned bios made of whole pages,
+ * which is what swap-out submits, are handled; returns false if @bio must
+ * go through the synchronous path instead.
+ */
+static bool zram_write_parallel(struct zram *zram, struct bio *bio,
+				u32 index)
+{
+	struct zram_write_ctx *ctx;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	unsigned short nr;
+	int i = 0, cpu;
+
+	if (!READ_ONCE(parallel_write) || !zram_write_wq)
+		return false;
+
+	nr = bio_segments(bio);
+	if (nr < 2 || num_online_cpus() < 2)
+		return false;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		if (bvec.bv_offset || bvec.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	ctx = kmalloc(sizeof(*ctx) + nr * sizeof(ctx->works[0]),
+		      GFP_NOIO | __GFP_NOWARN);
+	if (!ctx)
+		return false;
+
+	ctx->zram = zram;
+	ctx->bio = bio;
+	ctx->failed = false;
+	atomic_set(&ctx->pending, nr);
+
+	bio_for_each_segment(bvec, bio, iter) {
+		struct zram_write_work *w = &ctx->works[i];
+
+		w->ctx = ctx;
+		w->bvec = bvec;
+		w->index = index + i;
+		INIT_WORK(&w->work, zram_write_work_fn);
+		i++;
+	}
+
+	/* The submitter compresses the first page itself */
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < nr; i++) {
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		queue_work_on(cpu, zram_write_wq, &ctx->works[i].work);
+	}
+	zram_write_one(&ctx->works[0]);
+
+	return true;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset, rw;
@@ -1357,6 +2166,9 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 	}
 
 	rw = bio_data_dir(bio);
+	if (rw == WRITE && !offset && zram_write_parallel(zram, bio, index))
+		return;
+
 	bio_for_each_segment(bvec, bio, iter) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
@@ -1486,10 +2298,15 @@ static void zram_reset_device(struct zram *zram)
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+	zram_recomp_stop(zram);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+	if (zram->recomp) {
+		zcomp_destroy(zram->recomp);
+		zram->recomp = NULL;
+	}
 	reset_bdev(zram);
 }
 
@@ -1526,9 +2343,22 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recompressor[0]) {
+		zram->recomp = zcomp_create(zram->recompressor);
+		if (IS_ERR(zram->recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recompressor);
+			err = PTR_ERR(zram->recomp);
+			zram->recomp = NULL;
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+	}
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
+	zram_recomp_start(zram);
 
 	revalidate_disk(zram->disk);
 	up_write(&zram->init_lock);
@@ -1617,8 +2447,16 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(idle);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
+static DEVICE_ATTR_WO(writeback);
+static DEVICE_ATTR_RW(writeback_limit);
+static DEVICE_ATTR_RO(bd_stat);
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -1630,12 +2468,21 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_idle.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_writeback_limit.attr,
+	&dev_attr_bd_stat.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
 	&dev_attr_debug_stat.attr,
+	&dev_attr_recomp_stat.attr,
 	NULL,
 };
 
@@ -1668,6 +2515,7 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	zram_dedup_init(zram);
 
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
@@ -1859,6 +2707,8 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+	if (zram_write_wq)
+		destroy_workqueue(zram_write_wq);
 }
 
 static int __init zram_init(void)
@@ -1871,11 +2721,17 @@ static int __init zram_init(void)
 		return ret;
 	}
 
+	/* Not fatal, writes are then always compressed by the submitter */
+	zram_write_wq = alloc_workqueue("zram_write",
+					WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+
 	zram_debugfs_create();
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
+		if (zram_write_wq)
+			destroy_workqueue(zram_write_wq);
 		return -EBUSY;
 	}
 
@@ -1905,6 +2761,12 @@ module_exit(zram_exit);
 
 module_param(num_devices, uint, 0);
 MODULE_PARM_DESC(num_devices, "Number of pre-created zram devices");
+module_param(recomp_batch, uint, 0644);
+MODULE_PARM_DESC(recomp_batch, "Slots scanned per recompression pass");
+module_param(recomp_interval, uint, 0644);
+MODULE_PARM_DESC(recomp_interval, "Seconds between recompression passes");
+module_param(parallel_write, bool, 0644);
+MODULE_PARM_DESC(parallel_write, "Compress multi-page write bios on all CPUs");
 
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_AUTHOR("Nitin Gupta <ngupta@vflare.org>");
@@ -16,10 +16,12 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/rwsem.h>
+#include <linux/rbtree.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
@@ -48,6 +50,10 @@ enum zram_pageflags {
 	ZRAM_SAME,	/* Page consists the same element */
 	ZRAM_WB,	/* page is stored on backing_device */
 	ZRAM_HUGE,	/* Incompressible page */
+	ZRAM_IDLE,	/* not accessed since it was last marked idle */
+	ZRAM_RECOMP,	/* stored with the secondary compressor */
+	ZRAM_RECOMP_SKIP,	/* secondary compressor did not help */
+	ZRAM_DEDUP,	/* handle points to a shared zram_entry */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -66,6 +72,14 @@ struct zram_table_entry {
 #endif
 };
 
+/* zsmalloc handles queued for zs_free_bulk() by discard and reset */
+#define ZRAM_FREE_BATCH	32
+
+struct zram_free_batch {
+	unsigned long handles[ZRAM_FREE_BATCH];
+	unsigned int nr;
+};
+
 struct zram_stats {
 	atomic64_t compr_data_size;	/* compressed size of pages stored */
 	atomic64_t num_reads;	/* failed + successful */
@@ -79,12 +93,25 @@ struct zram_stats {
 	atomic64_t pages_stored;	/* no. of pages currently stored */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
+	atomic64_t recomp_pages;	/* no. of pages stored recompressed */
+	atomic64_t recomp_saved;	/* bytes saved by recompression */
+	atomic64_t recomp_failed;	/* no. of pages that didn't shrink */
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes to backing device */
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+	atomic64_t meta_data_size;	/* dedup metadata in bytes */
 };
 
 struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
 	struct zcomp *comp;
+	/* secondary compressor used for cold pages, may be NULL */
+	struct zcomp *recomp;
+	struct task_struct *recomp_task;
+	/* next slot the recompression thread looks at */
+	unsigned long recomp_index;
 	struct gendisk *disk;
 	/* Prevent concurrent execution of device init */
 	struct rw_semaphore init_lock;
@@ -100,6 +127,7 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+	char recompressor[CRYPTO_MAX_ALG_NAME];
 	/*
 	 * zram is claimed so open request will be failed
 	 */
@@ -111,9 +139,27 @@ struct zram {
 	unsigned long *bitmap;
 	unsigned long nr_pages;
 	spinlock_t bitmap_lock;
+	/* writes to the backing device allowed per day, 0 is no limit */
+	unsigned long wb_limit_pages;
+	unsigned long wb_limit_start;	/* jiffies the current day began */
+	unsigned long wb_pages_today;	/* protected by bitmap_lock */
 #endif
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+	spinlock_t dedup_lock;
+	struct rb_root dedup_root;
+#endif
 };
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+#ifdef CONFIG_ZRAM_DEDUP
+	return zram->use_dedup;
+#else
+	return false;
+#endif
+}
 #endif
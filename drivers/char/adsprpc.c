@@ -42,6 +42,8 @@
 #include <linux/qcom_iommu.h>
 #include <linux/kref.h>
 #include <linux/sort.h>
+#include <linux/shrinker.h>
+#include <linux/poll.h>
 #include <linux/msm_dma_iommu_mapping.h>
 #include <asm/dma-iommu.h>
 #include <soc/qcom/scm.h>
@@ -49,6 +51,9 @@
 #include "adsprpc_shared.h"
 #include <soc/qcom/ramdump.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 
 #define TZ_PIL_PROTECT_MEM_SUBSYS_ID 0x0C
 #define TZ_PIL_CLEAR_PROTECT_MEM_SUBSYS_ID 0x0D
@@ -71,6 +76,12 @@
 #define NUM_SESSIONS	9		/*8 compute, 1 cpz*/
 #define FASTRPC_CTX_MAGIC (0xbeeddeed)
 #define FASTRPC_CTX_MAX (256)
+/* async jobs one file may have in flight, out of FASTRPC_CTX_MAX */
+#define FASTRPC_ASYNC_MAX (64)
+
+/* log2 microsecond buckets, the last one also counts anything slower */
+#define FASTRPC_LAT_BUCKETS (20)
+#define FASTRPC_LAT_METHODS (32)
 #define FASTRPC_CTXID_MASK (0xFF0)
 #define NUM_DEVICES   2 /* adsprpc-smd, adsprpc-smd-secure */
 #define MINOR_NUM_DEV 0
@@ -111,9 +122,53 @@
 		} \
 	}
 
+/* Always on, unlike PERF: adds the time taken by ff to the ns counter lat */
+#define PERF_LAT(enb, cnt, lat, ff) \
+	{\
+		ktime_t latT = ktime_get();\
+		PERF(enb, cnt, ff);\
+		lat += ktime_to_ns(ktime_sub(ktime_get(), latT));\
+	}
+
+enum fastrpc_lat_stage {
+	FASTRPC_LAT_MAP,
+	FASTRPC_LAT_CACHE,
+	FASTRPC_LAT_GETARGS,
+	FASTRPC_LAT_LINK,
+	FASTRPC_LAT_DSP,
+	FASTRPC_LAT_PUTARGS,
+	FASTRPC_LAT_INVOKE,
+	FASTRPC_LAT_STAGES,
+};
+
+static const char * const fastrpc_lat_names[FASTRPC_LAT_STAGES] = {
+	[FASTRPC_LAT_MAP] = "map",
+	[FASTRPC_LAT_CACHE] = "cache",
+	[FASTRPC_LAT_GETARGS] = "getargs",
+	[FASTRPC_LAT_LINK] = "link",
+	[FASTRPC_LAT_DSP] = "dsp",
+	[FASTRPC_LAT_PUTARGS] = "putargs",
+	[FASTRPC_LAT_INVOKE] = "invoke",
+};
+
+struct fastrpc_lat_hist {
+	uint32_t count[FASTRPC_LAT_STAGES][FASTRPC_LAT_BUCKETS];
+};
+
 static int fastrpc_glink_open(int cid);
 static void fastrpc_glink_close(void *chan, int cid);
 static struct dentry *debugfs_root;
+
+/*
+ * Invoke argument mappings are kept mapped after the call for reuse by the
+ * next invoke on the same buffer, up to map_cache_max per file.
+ */
+static unsigned int map_cache_max = 16;
+module_param(map_cache_max, uint, 0644);
+MODULE_PARM_DESC(map_cache_max, "Unused argument mappings kept per file");
+
+/* Serializes the map cache shrinker against file release */
+static DEFINE_MUTEX(map_cache_mutex);
 static struct dentry *debugfs_global_file;
 
 static inline uint64_t buf_page_start(uint64_t buf)
@@ -203,6 +258,15 @@ struct smq_invoke_ctx {
 	struct smq_msg msg;
 	unsigned int magic;
 	uint64_t ctxid;
+	/* async jobs: queued on fl->async_done once the dsp responds */
+	int async;
+	int sent;
+	struct list_head async_node;
+	remote_arg_t *upra;
+	ktime_t submit_ts;
+	ktime_t send_ts;
+	ktime_t resp_ts;
+	int64_t lat[FASTRPC_LAT_STAGES];
 };
 
 struct fastrpc_ctx_lst {
@@ -257,6 +321,8 @@ struct fastrpc_channel_ctx {
 	struct fastrpc_glink_info link;
 	/* Indicates, if channel is restricted to secure node only */
 	int secure;
+	/* FASTRPC_LAT_METHODS histograms, indexed by scalars method */
+	struct fastrpc_lat_hist *lat;
 };
 
 struct fastrpc_apps {
@@ -297,6 +363,7 @@ struct fastrpc_mmap {
 	int uncached;
 	int secure;
 	uintptr_t attr;
+	int cache;
 };
 
 struct fastrpc_perf {
@@ -317,6 +384,16 @@ struct fastrpc_file {
 	struct hlist_head maps;
 	struct hlist_head cached_bufs;
 	struct hlist_head remote_bufs;
+	struct hlist_head cached_maps;
+	int cached_maps_cnt;
+	uint32_t map_cache_hits;
+	uint32_t map_cache_misses;
+	uint32_t map_cache_evicts;
+	spinlock_t async_lock;
+	struct list_head async_done;
+	wait_queue_head_t async_wq;
+	int async_inflight;
+	uint32_t async_jobs;
 	struct fastrpc_ctx_lst clst;
 	struct fastrpc_session_ctx *sctx;
 	struct fastrpc_buf *init_mem;
@@ -587,6 +664,181 @@ static int fastrpc_mmap_remove(struct fastrpc_file *fl, uintptr_t va,
 	return -ENOTTY;
 }
 
+static void fastrpc_mmap_free(struct fastrpc_mmap *map);
+
+/*
+ * Cached maps hold the only remaining reference to their dma_buf once
+ * the client has closed and unmapped the buffer; those are dropped
+ * instead of being kept for reuse.
+ */
+static bool fastrpc_mmap_cache_stale(struct fastrpc_mmap *map)
+{
+	return file_count(map->buf->file) == 1;
+}
+
+/*
+ * Drop cached maps until at most @keep are left, least recently used and
+ * stale ones first. Called with map_cache_mutex held, or from the file's
+ * own context.
+ */
+static void fastrpc_mmap_cache_trim(struct fastrpc_file *fl, int keep)
+{
+	struct fastrpc_mmap *map, *last;
+	struct hlist_node *n;
+	HLIST_HEAD(victims);
+
+	spin_lock(&fl->hlock);
+	hlist_for_each_entry_safe(map, n, &fl->cached_maps, hn) {
+		if (fastrpc_mmap_cache_stale(map)) {
+			hlist_del_init(&map->hn);
+			hlist_add_head(&map->hn, &victims);
+			fl->cached_maps_cnt--;
+		}
+	}
+	while (fl->cached_maps_cnt > keep) {
+		last = NULL;
+		hlist_for_each_entry(map, &fl->cached_maps, hn)
+			last = map;
+		hlist_del_init(&last->hn);
+		hlist_add_head(&last->hn, &victims);
+		fl->cached_maps_cnt--;
+		fl->map_cache_evicts++;
+	}
+	spin_unlock(&fl->hlock);
+
+	hlist_for_each_entry_safe(map, n, &victims, hn) {
+		hlist_del_init(&map->hn);
+		map->cache = 0;
+		map->refs = 1;
+		fastrpc_mmap_free(map);
+	}
+}
+
+/*
+ * Park an unused argument map in the file's map cache instead of unmapping
+ * it. Returns false if the map has to be freed.
+ */
+static bool fastrpc_mmap_cache_put(struct fastrpc_file *fl,
+				   struct fastrpc_mmap *map)
+{
+	int max = READ_ONCE(map_cache_max);
+
+	if (!max || map->secure || fl->apps->channel[fl->cid].vmid ||
+	    IS_ERR_OR_NULL(map->buf) || fastrpc_mmap_cache_stale(map))
+		return false;
+
+	spin_lock(&fl->hlock);
+	if (fl->file_close) {
+		spin_unlock(&fl->hlock);
+		return false;
+	}
+	hlist_add_head(&map->hn, &fl->cached_maps);
+	fl->cached_maps_cnt++;
+	spin_unlock(&fl->hlock);
+
+	if (fl->cached_maps_cnt > max)
+		fastrpc_mmap_cache_trim(fl, max);
+	return true;
+}
+
+/*
+ * Look up a cached map of the same dma_buf covering @va/@len. The fd
+ * number alone can't be trusted here, it may have been closed and reused
+ * for another buffer while the map sat in the cache.
+ */
+static int fastrpc_mmap_cache_get(struct fastrpc_file *fl, int fd,
+				  unsigned attr, uintptr_t va, size_t len,
+				  struct fastrpc_mmap **ppmap)
+{
+	struct fastrpc_mmap *match = NULL, *map;
+	struct dma_buf *buf;
+
+	if (hlist_empty(&fl->cached_maps))
+		return -ENOTTY;
+	buf = dma_buf_get(fd);
+	if (IS_ERR_OR_NULL(buf))
+		return -ENOTTY;
+
+	spin_lock(&fl->hlock);
+	hlist_for_each_entry(map, &fl->cached_maps, hn) {
+		if (map->buf == buf && map->attr == attr &&
+			va >= map->va && va + len <= map->va + map->len) {
+			hlist_del_init(&map->hn);
+			fl->cached_maps_cnt--;
+			match = map;
+			break;
+		}
+	}
+	if (match)
+		fl->map_cache_hits++;
+	else
+		fl->map_cache_misses++;
+	spin_unlock(&fl->hlock);
+	dma_buf_put(buf);
+
+	if (!match)
+		return -ENOTTY;
+	match->fd = fd;
+	match->refs = 1;
+	fastrpc_mmap_add(match);
+	*ppmap = match;
+	return 0;
+}
+
+static unsigned long fastrpc_map_shrink_count(struct shrinker *shrink,
+					      struct shrink_control *sc)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl;
+	unsigned long cnt = 0;
+
+	spin_lock(&me->hlock);
+	hlist_for_each_entry(fl, &me->drivers, hn)
+		cnt += fl->cached_maps_cnt;
+	spin_unlock(&me->hlock);
+	return cnt;
+}
+
+static unsigned long fastrpc_map_shrink_scan(struct shrinker *shrink,
+					     struct shrink_control *sc)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl, *victim;
+	unsigned long freed = 0;
+	int cnt;
+
+	if (!mutex_trylock(&map_cache_mutex))
+		return SHRINK_STOP;
+	/*
+	 * A file found on the list can't be freed before map_cache_mutex is
+	 * dropped, fastrpc_file_free() takes it to flush the cache.
+	 */
+	while (freed < sc->nr_to_scan) {
+		victim = NULL;
+		cnt = 0;
+		spin_lock(&me->hlock);
+		hlist_for_each_entry(fl, &me->drivers, hn) {
+			if (fl->cached_maps_cnt > cnt) {
+				cnt = fl->cached_maps_cnt;
+				victim = fl;
+			}
+		}
+		spin_unlock(&me->hlock);
+		if (!victim)
+			break;
+		fastrpc_mmap_cache_trim(victim, cnt / 2);
+		freed += cnt - cnt / 2;
+	}
+	mutex_unlock(&map_cache_mutex);
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker fastrpc_map_shrinker = {
+	.count_objects = fastrpc_map_shrink_count,
+	.scan_objects = fastrpc_map_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static void fastrpc_mmap_free(struct fastrpc_mmap *map)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -624,6 +876,8 @@ static void fastrpc_mmap_free(struct fastrpc_mmap *map)
 	}
 	if (map->refs > 0)
 		return;
+	if (map->cache && fastrpc_mmap_cache_put(fl, map))
+		return;
 	if (map->flags == ADSP_MMAP_HEAP_ADDR ||
 				map->flags == ADSP_MMAP_REMOTE_HEAP_ADDR) {
 		DEFINE_DMA_ATTRS(attrs);
@@ -701,6 +955,8 @@ static int fastrpc_mmap_create(struct fastrpc_file *fl, int fd, unsigned attr,
 	chan = &apps->channel[cid];
 	if (!fastrpc_mmap_find(fl, fd, va, len, mflags, ppmap))
 		return 0;
+	if (!mflags && !fastrpc_mmap_cache_get(fl, fd, attr, va, len, ppmap))
+		return 0;
 	map = kzalloc(sizeof(*map), GFP_KERNEL);
 	VERIFY(err, !IS_ERR_OR_NULL(map));
 	if (err)
@@ -1043,6 +1299,7 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 
 	INIT_HLIST_NODE(&ctx->hn);
 	hlist_add_fake(&ctx->hn);
+	INIT_LIST_HEAD(&ctx->async_node);
 	ctx->fl = fl;
 	ctx->maps = (struct fastrpc_mmap **)(&ctx[1]);
 	ctx->lpra = (remote_arg_t *)(&ctx->maps[bufs]);
@@ -1125,9 +1382,17 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	struct fastrpc_apps *me = &gfa;
 	int nbufs = REMOTE_SCALARS_INBUFS(ctx->sc) +
 		    REMOTE_SCALARS_OUTBUFS(ctx->sc);
+	unsigned long flags;
+
 	spin_lock(&ctx->fl->hlock);
 	hlist_del_init(&ctx->hn);
 	spin_unlock(&ctx->fl->hlock);
+	if (ctx->async) {
+		spin_lock_irqsave(&ctx->fl->async_lock, flags);
+		list_del_init(&ctx->async_node);
+		ctx->fl->async_inflight--;
+		spin_unlock_irqrestore(&ctx->fl->async_lock, flags);
+	}
 	for (i = 0; i < nbufs; ++i)
 		fastrpc_mmap_free(ctx->maps[i]);
 	fastrpc_buf_free(ctx->buf, 1);
@@ -1147,9 +1412,27 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	kfree(ctx);
 }
 
+static void context_async_done(struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	unsigned long flags;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	if (list_empty(&ctx->async_node)) {
+		if (!ktime_to_ns(ctx->resp_ts))
+			ctx->resp_ts = ktime_get();
+		list_add_tail(&ctx->async_node, &fl->async_done);
+	}
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	wake_up_interruptible(&fl->async_wq);
+}
+
 static void context_notify_user(struct smq_invoke_ctx *ctx, int retval)
 {
 	ctx->retval = retval;
+	ctx->resp_ts = ktime_get();
+	if (ctx->async)
+		context_async_done(ctx);
 	complete(&ctx->work);
 }
 
@@ -1160,6 +1443,8 @@ static void fastrpc_notify_users(struct fastrpc_file *me)
 
 	spin_lock(&me->hlock);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
+		if (ictx->async)
+			context_async_done(ictx);
 		complete(&ictx->work);
 	}
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
@@ -1269,10 +1554,15 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 		uintptr_t buf = (uintptr_t)lpra[i].buf.pv;
 		size_t len = lpra[i].buf.len;
 
-		if (ctx->fds[i] && (ctx->fds[i] != -1))
+		if (ctx->fds[i] && (ctx->fds[i] != -1)) {
 			fastrpc_mmap_create(ctx->fl, ctx->fds[i],
 					ctx->attrs[i], buf, len,
 					mflags, &ctx->maps[i]);
+			/* only mappings made for this call may be cached */
+			if (ctx->maps[i] && ctx->maps[i]->refs == 1 &&
+			    !ctx->maps[i]->raddr)
+				ctx->maps[i]->cache = 1;
+		}
 		ipage += 1;
 	}
 	metalen = copylen = (size_t)&ipage[0];
@@ -1347,7 +1637,7 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 		ipage++;
 	}
 	/* map ion buffers */
-	PERF(ctx->fl->profile, ctx->fl->perf.map,
+	PERF_LAT(ctx->fl->profile, ctx->fl->perf.map, ctx->lat[FASTRPC_LAT_MAP],
 	for (i = 0; rpra && lrpra && i < inbufs + outbufs; ++i) {
 		struct fastrpc_mmap *map = ctx->maps[i];
 		uint64_t buf = ptr_to_uint64(lpra[i].buf.pv);
@@ -1428,7 +1718,8 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 	}
 	PERF_END);
 
-	PERF(ctx->fl->profile, ctx->fl->perf.flush,
+	PERF_LAT(ctx->fl->profile, ctx->fl->perf.flush,
+		 ctx->lat[FASTRPC_LAT_CACHE],
 	for (oix = 0; oix < inbufs + outbufs; ++oix) {
 		int i = ctx->overps[oix]->raix;
 		struct fastrpc_mmap *map = ctx->maps[i];
@@ -1728,6 +2019,68 @@ static void fastrpc_init(struct fastrpc_apps *me)
 
 static int fastrpc_release_current_dsp_process(struct fastrpc_file *fl);
 
+static void fastrpc_lat_commit(struct smq_invoke_ctx *ctx, ktime_t start)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	struct fastrpc_lat_hist *hist = fl->apps->channel[fl->cid].lat;
+	uint64_t us;
+	int i, b;
+
+	if (!hist)
+		return;
+	hist += REMOTE_SCALARS_METHOD(ctx->sc);
+	if (ktime_after(ctx->resp_ts, ctx->send_ts))
+		ctx->lat[FASTRPC_LAT_DSP] = ktime_to_ns(ktime_sub(ctx->resp_ts,
+							ctx->send_ts));
+	ctx->lat[FASTRPC_LAT_INVOKE] = ktime_to_ns(ktime_sub(ktime_get(),
+							start));
+	/* stages that did not run for this call stay out of the histogram */
+	for (i = 0; i < FASTRPC_LAT_STAGES; i++) {
+		if (ctx->lat[i] <= 0)
+			continue;
+		us = div_u64(ctx->lat[i], NSEC_PER_USEC);
+		b = us < 2 ? 0 : min_t(int, ilog2(us), FASTRPC_LAT_BUCKETS - 1);
+		hist->count[i][b]++;
+	}
+}
+
+static int fastrpc_invoke_submit(struct fastrpc_file *fl, uint32_t mode,
+				 uint32_t kernel, struct smq_invoke_ctx *ctx,
+				 struct fastrpc_ioctl_invoke *invoke)
+{
+	int err = 0;
+
+	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
+		PERF_LAT(fl->profile, fl->perf.getargs,
+			 ctx->lat[FASTRPC_LAT_GETARGS],
+		VERIFY(err, 0 == get_args(kernel, ctx));
+		PERF_END);
+		if (err)
+			goto bail;
+	}
+
+	PERF_LAT(fl->profile, fl->perf.invargs, ctx->lat[FASTRPC_LAT_CACHE],
+	inv_args_pre(ctx);
+	if (mode == FASTRPC_MODE_SERIAL)
+		inv_args(ctx);
+	PERF_END);
+
+	PERF_LAT(fl->profile, fl->perf.link, ctx->lat[FASTRPC_LAT_LINK],
+	VERIFY(err, 0 == fastrpc_invoke_send(ctx, kernel, invoke->handle));
+	PERF_END);
+	ctx->send_ts = ktime_get();
+
+	if (err)
+		goto bail;
+
+	PERF_LAT(fl->profile, fl->perf.invargs, ctx->lat[FASTRPC_LAT_CACHE],
+	if (mode == FASTRPC_MODE_PARALLEL)
+		inv_args(ctx);
+	PERF_END);
+bail:
+	return err;
+}
+
 static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 				   uint32_t kernel,
 				   struct fastrpc_ioctl_invoke_attrs *inv)
@@ -1736,6 +2089,7 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	struct fastrpc_ioctl_invoke *invoke = &inv->inv;
 	int err = 0, cid = -1, interrupted = 0;
 	struct timespec invoket = {0};
+	ktime_t start = ktime_get();
 
 	cid = fl->cid;
 	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
@@ -1778,31 +2132,9 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	if (err)
 		goto bail;
 
-	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
-		PERF(fl->profile, fl->perf.getargs,
-		VERIFY(err, 0 == get_args(kernel, ctx));
-		PERF_END);
-		if (err)
-			goto bail;
-	}
-
-	PERF(fl->profile, fl->perf.invargs,
-	inv_args_pre(ctx);
-	if (mode == FASTRPC_MODE_SERIAL)
-		inv_args(ctx);
-	PERF_END);
-
-	PERF(fl->profile, fl->perf.link,
-	VERIFY(err, 0 == fastrpc_invoke_send(ctx, kernel, invoke->handle));
-	PERF_END);
-
+	err = fastrpc_invoke_submit(fl, mode, kernel, ctx, invoke);
 	if (err)
 		goto bail;
-
-	PERF(fl->profile, fl->perf.invargs,
-	if (mode == FASTRPC_MODE_PARALLEL)
-		inv_args(ctx);
-	PERF_END);
  wait:
 	if (kernel)
 		wait_for_completion(&ctx->work);
@@ -1816,11 +2148,12 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	if (err)
 		goto bail;
 
-	PERF(fl->profile, fl->perf.putargs,
+	PERF_LAT(fl->profile, fl->perf.putargs, ctx->lat[FASTRPC_LAT_PUTARGS],
 	VERIFY(err, 0 == put_args(kernel, ctx, invoke->pra));
 	PERF_END);
 	if (err)
 		goto bail;
+	fastrpc_lat_commit(ctx, start);
  bail:
 	if (ctx && interrupted == -ERESTARTSYS)
 		context_save_interrupted(ctx);
@@ -1839,6 +2172,162 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	return err;
 }
 
+/*
+ * Sends the invoke without waiting for the response. The context stays
+ * on the pending list until the caller collects it with
+ * fastrpc_internal_async_wait(), which copies the output arguments back
+ * and frees it.
+ */
+static int fastrpc_internal_invoke_async(struct fastrpc_file *fl,
+				uint32_t mode,
+				struct fastrpc_ioctl_invoke_async *inva)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	struct fastrpc_ioctl_invoke *invoke = &inva->inv.inv;
+	ktime_t submit_ts = ktime_get();
+	unsigned long flags;
+	int err = 0, cid = fl->cid, ready;
+
+	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
+	if (err) {
+		err = -ECHRNG;
+		goto bail;
+	}
+	VERIFY(err, fl->sctx != NULL);
+	if (err) {
+		err = -EBADR;
+		goto bail;
+	}
+	/* static handles, the listener included, stay synchronous */
+	VERIFY(err, invoke->handle > FASTRPC_STATIC_HANDLE_MAX);
+	if (err) {
+		err = -EINVAL;
+		goto bail;
+	}
+	if (fl->sctx->smmu.faults) {
+		err = FASTRPC_ENOSUCH;
+		goto bail;
+	}
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	if (fl->async_inflight < FASTRPC_ASYNC_MAX)
+		fl->async_inflight++;
+	else
+		err = -EBUSY;
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (err)
+		goto bail;
+
+	VERIFY(err, 0 == context_alloc(fl, 0, &inva->inv, &ctx));
+	if (err) {
+		spin_lock_irqsave(&fl->async_lock, flags);
+		fl->async_inflight--;
+		spin_unlock_irqrestore(&fl->async_lock, flags);
+		goto bail;
+	}
+	ctx->async = 1;
+	ctx->upra = invoke->pra;
+	ctx->submit_ts = submit_ts;
+
+	err = fastrpc_invoke_submit(fl, mode, 0, ctx, invoke);
+	if (err)
+		goto bail;
+
+	/*
+	 * The response may already be queued, but it cannot be collected
+	 * until the submit side is done with the context.
+	 */
+	inva->job = ctx->ctxid;
+	spin_lock_irqsave(&fl->async_lock, flags);
+	ctx->sent = 1;
+	ready = !list_empty(&ctx->async_node);
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (ready)
+		wake_up_interruptible(&fl->async_wq);
+	ctx = NULL;
+	fl->async_jobs++;
+	if (fl->profile)
+		fl->perf.count++;
+bail:
+	if (ctx)
+		context_free(ctx);
+	return err;
+}
+
+static struct smq_invoke_ctx *fastrpc_async_first(struct fastrpc_file *fl)
+{
+	struct smq_invoke_ctx *ictx;
+
+	list_for_each_entry(ictx, &fl->async_done, async_node) {
+		if (ictx->sent)
+			return ictx;
+	}
+	return NULL;
+}
+
+static int fastrpc_async_ready(struct fastrpc_file *fl)
+{
+	unsigned long flags;
+	int ready;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	ready = fastrpc_async_first(fl) != NULL;
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	return ready;
+}
+
+static int fastrpc_internal_async_wait(struct fastrpc_file *fl, int nonblock,
+				struct fastrpc_ioctl_async_result *res)
+{
+	struct smq_invoke_ctx *ctx;
+	unsigned long flags;
+	int err = 0;
+
+	for (;;) {
+		spin_lock_irqsave(&fl->async_lock, flags);
+		ctx = fastrpc_async_first(fl);
+		if (ctx)
+			list_del_init(&ctx->async_node);
+		else if (!fl->async_inflight)
+			err = -ENOENT;
+		spin_unlock_irqrestore(&fl->async_lock, flags);
+		if (ctx || err)
+			break;
+		if (nonblock)
+			return -EAGAIN;
+		err = wait_event_interruptible(fl->async_wq,
+					       fastrpc_async_ready(fl));
+		if (err)
+			return err;
+	}
+	if (err)
+		return err;
+
+	memset(res, 0, sizeof(*res));
+	res->job = ctx->ctxid;
+	res->result = ctx->retval;
+	res->prep_ns = ktime_to_ns(ktime_sub(ctx->send_ts, ctx->submit_ts));
+	if (ktime_after(ctx->resp_ts, ctx->send_ts))
+		res->dsp_ns = ktime_to_ns(ktime_sub(ctx->resp_ts,
+						    ctx->send_ts));
+	res->queue_ns = ktime_to_ns(ktime_sub(ktime_get(), ctx->resp_ts));
+
+	if (!ctx->retval) {
+		PERF_LAT(fl->profile, fl->perf.putargs,
+			 ctx->lat[FASTRPC_LAT_PUTARGS],
+		VERIFY(err, 0 == put_args(0, ctx, ctx->upra));
+		PERF_END);
+		if (err)
+			res->result = err;
+		else
+			fastrpc_lat_commit(ctx, ctx->submit_ts);
+	}
+	context_free(ctx);
+	if (fl->ssrcount != fl->apps->channel[fl->cid].ssrcount)
+		res->result = ECONNRESET;
+	return 0;
+}
+
 static int fastrpc_channel_open(struct fastrpc_file *fl);
 static int fastrpc_init_process(struct fastrpc_file *fl,
 				struct fastrpc_ioctl_init_attrs *uproc)
@@ -2591,6 +3080,9 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 		fastrpc_buf_free(fl->init_mem, 0);
 	fastrpc_context_list_dtor(fl);
 	fastrpc_cached_buf_list_free(fl);
+	mutex_lock(&map_cache_mutex);
+	fastrpc_mmap_cache_trim(fl, 0);
+	mutex_unlock(&map_cache_mutex);
 	hlist_for_each_entry_safe(map, n, &fl->maps, hn) {
 		fastrpc_mmap_free(map);
 	}
@@ -2721,6 +3213,7 @@ static int fastrpc_glink_open(int cid)
 	cfg->notify_tx_done = fastrpc_glink_notify_tx_done;
 	cfg->notify_state = fastrpc_glink_notify_state;
 	cfg->notify_rx_intent_req = fastrpc_glink_notify_rx_intent_req;
+	cfg->options |= GLINK_OPT_RX_INTENT_POOL | GLINK_OPT_LOW_LATENCY;
 	handle = glink_open(cfg);
 	VERIFY(err, !IS_ERR_OR_NULL(handle));
 	if (err)
@@ -2845,6 +3338,14 @@ static ssize_t fastrpc_debugfs_read(struct file *filp, char __user *buffer,
 			"%s %6s %d\n", "file_close", ":", fl->file_close);
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
 			"%s %9s %d\n", "profile", ":", fl->profile);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%s %6s %d hits %u misses %u evicts %u\n",
+			"map_cache", ":", fl->cached_maps_cnt,
+			fl->map_cache_hits, fl->map_cache_misses,
+			fl->map_cache_evicts);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%s %10s %d jobs %u\n", "async", ":",
+			fl->async_inflight, fl->async_jobs);
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
 			"%s %3s %d\n", "smmu.coherent", ":",
 			fl->sctx->smmu.coherent);
@@ -2954,6 +3455,64 @@ static const struct file_operations debugfs_fops = {
 	.open = fastrpc_debugfs_open,
 	.read = fastrpc_debugfs_read,
 };
+
+static int fastrpc_lat_show(struct seq_file *s, void *unused)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_lat_hist *hist;
+	int i, m, st, b;
+
+	seq_puts(s, "bucket n counts calls taking 2^n to 2^(n+1) us\n");
+	for (i = 0; i < NUM_CHANNELS; i++) {
+		if (!me->channel[i].lat)
+			continue;
+		for (m = 0; m < FASTRPC_LAT_METHODS; m++) {
+			hist = &me->channel[i].lat[m];
+			for (st = 0; st < FASTRPC_LAT_STAGES; st++) {
+				for (b = 0; b < FASTRPC_LAT_BUCKETS; b++)
+					if (hist->count[st][b])
+						break;
+				if (b == FASTRPC_LAT_BUCKETS)
+					continue;
+				seq_printf(s, "%s method %2d %-8s",
+					   gcinfo[i].name, m,
+					   fastrpc_lat_names[st]);
+				for (b = 0; b < FASTRPC_LAT_BUCKETS; b++)
+					seq_printf(s, " %u", hist->count[st][b]);
+				seq_putc(s, '\n');
+			}
+		}
+	}
+	return 0;
+}
+
+static int fastrpc_lat_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, fastrpc_lat_show, inode->i_private);
+}
+
+/* any write clears all histograms */
+static ssize_t fastrpc_lat_write(struct file *filp, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct fastrpc_apps *me = &gfa;
+	int i;
+
+	for (i = 0; i < NUM_CHANNELS; i++) {
+		if (me->channel[i].lat)
+			memset(me->channel[i].lat, 0, FASTRPC_LAT_METHODS *
+			       sizeof(*me->channel[i].lat));
+	}
+	return count;
+}
+
+static const struct file_operations debugfs_lat_fops = {
+	.open = fastrpc_lat_open,
+	.read = seq_read,
+	.write = fastrpc_lat_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 static int fastrpc_channel_open(struct fastrpc_file *fl)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -3072,6 +3631,10 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	INIT_HLIST_HEAD(&fl->maps);
 	INIT_HLIST_HEAD(&fl->cached_bufs);
 	INIT_HLIST_HEAD(&fl->remote_bufs);
+	INIT_HLIST_HEAD(&fl->cached_maps);
+	spin_lock_init(&fl->async_lock);
+	INIT_LIST_HEAD(&fl->async_done);
+	init_waitqueue_head(&fl->async_wq);
 	INIT_HLIST_NODE(&fl->hn);
 	fl->tgid = current->tgid;
 	fl->apps = me;
@@ -3168,6 +3731,8 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		struct fastrpc_ioctl_init_attrs init;
 		struct fastrpc_ioctl_perf perf;
 		struct fastrpc_ioctl_control cp;
+		struct fastrpc_ioctl_invoke_async inva;
+		struct fastrpc_ioctl_async_result ares;
 	} p;
 	void *param = (char *)ioctl_param;
 	struct fastrpc_file *fl = (struct fastrpc_file *)file->private_data;
@@ -3203,6 +3768,27 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		if (err)
 			goto bail;
 		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		K_COPY_FROM_USER(err, 0, &p.inva, param, sizeof(p.inva));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_async(fl,
+						fl->mode, &p.inva)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.inva, sizeof(p.inva));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_ASYNC_WAIT:
+		VERIFY(err, 0 == (err = fastrpc_internal_async_wait(fl,
+				file->f_flags & O_NONBLOCK, &p.ares)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.ares, sizeof(p.ares));
+		if (err)
+			goto bail;
+		break;
 	case FASTRPC_IOCTL_MMAP:
 		K_COPY_FROM_USER(err, 0, &p.mmap, param,
 						sizeof(p.mmap));
@@ -3393,9 +3979,20 @@ static int fastrpc_smmu_fault_handler(struct iommu_domain *domain,
 	return 0;
 }
 
+static unsigned int fastrpc_device_poll(struct file *filp, poll_table *wait)
+{
+	struct fastrpc_file *fl = (struct fastrpc_file *)filp->private_data;
+
+	poll_wait(filp, &fl->async_wq, wait);
+	if (fastrpc_async_ready(fl))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
 static const struct file_operations fops = {
 	.open = fastrpc_device_open,
 	.release = fastrpc_device_release,
+	.poll = fastrpc_device_poll,
 	.unlocked_ioctl = fastrpc_device_ioctl,
 	.compat_ioctl = compat_fastrpc_device_ioctl,
 };
@@ -3640,6 +4237,8 @@ static void fastrpc_deinit(void)
 				fastrpc_channel_close, &me->smd_mutex);
 			chan->chan = NULL;
 		}
+		vfree(chan->lat);
+		chan->lat = NULL;
 		for (j = 0; j < NUM_SESSIONS; j++) {
 			struct fastrpc_session_ctx *sess = &chan->session[j];
 
@@ -3721,6 +4320,9 @@ static int __init fastrpc_device_init(void)
 		me->channel[i].issubsystemup = 1;
 		me->channel[i].ramdumpenabled = 0;
 		me->channel[i].remoteheap_ramdump_dev = NULL;
+		/* histograms are optional, calls are not failed for them */
+		me->channel[i].lat = vzalloc(FASTRPC_LAT_METHODS *
+					     sizeof(*me->channel[i].lat));
 		me->channel[i].nb.notifier_call = fastrpc_restart_notifier_cb;
 		me->channel[i].handle = subsys_notif_register_notifier(
 							gcinfo[i].subsys,
@@ -3731,6 +4333,9 @@ static int __init fastrpc_device_init(void)
 	if (err)
 		goto device_create_bail;
 
+	register_shrinker(&fastrpc_map_shrinker);
+	debugfs_create_file("latency", 0644, debugfs_root, NULL,
+			    &debugfs_lat_fops);
 	return 0;
 device_create_bail:
 	for (i = 0; i < NUM_CHANNELS; i++) {
@@ -3760,6 +4365,7 @@ static void __exit fastrpc_device_exit(void)
 	struct fastrpc_apps *me = &gfa;
 	int i;
 
+	unregister_shrinker(&fastrpc_map_shrinker);
 	fastrpc_file_list_dtor(me);
 	fastrpc_deinit();
 	for (i = 0; i < NUM_CHANNELS; i++) {
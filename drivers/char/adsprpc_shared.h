@@ -30,6 +30,10 @@
 #define FASTRPC_IOCTL_GETPERF	_IOWR('R', 9, struct fastrpc_ioctl_perf)
 #define FASTRPC_IOCTL_INIT_ATTRS _IOWR('R', 10, struct fastrpc_ioctl_init_attrs)
 #define FASTRPC_IOCTL_CONTROL	_IOWR('R', 12, struct fastrpc_ioctl_control)
+#define FASTRPC_IOCTL_INVOKE_ASYNC \
+				_IOWR('R', 16, struct fastrpc_ioctl_invoke_async)
+#define FASTRPC_IOCTL_ASYNC_WAIT \
+				_IOWR('R', 17, struct fastrpc_ioctl_async_result)
 
 #define FASTRPC_GLINK_GUID "fastrpcglink-apps-dsp"
 #define FASTRPC_SMD_GUID "fastrpcsmd-apps-dsp"
@@ -71,6 +75,9 @@
 /* Retrives number of output handles from the scalars parameter */
 #define REMOTE_SCALARS_OUTHANDLES(sc)    ((sc) & 0x0f)
 
+/* Retrives method id from the scalars parameter */
+#define REMOTE_SCALARS_METHOD(sc)        (((sc) >> 24) & 0x1f)
+
 #define REMOTE_SCALARS_LENGTH(sc)	(REMOTE_SCALARS_INBUFS(sc) +\
 					REMOTE_SCALARS_OUTBUFS(sc) +\
 					REMOTE_SCALARS_INHANDLES(sc) +\
@@ -154,6 +161,20 @@ struct fastrpc_ioctl_invoke_attrs {
 	unsigned *attrs;	/* attribute list */
 };
 
+struct fastrpc_ioctl_invoke_async {
+	struct fastrpc_ioctl_invoke_attrs inv;
+	uint64_t job;		/* returned handle identifying the job */
+};
+
+struct fastrpc_ioctl_async_result {
+	uint64_t job;		/* handle returned by INVOKE_ASYNC */
+	int result;		/* remote return value */
+	uint32_t reserved;
+	uint64_t prep_ns;	/* submit until message sent to dsp */
+	uint64_t dsp_ns;	/* message sent until dsp response */
+	uint64_t queue_ns;	/* dsp response until collected */
+};
+
 struct fastrpc_ioctl_init {
 	uint32_t flags;		/* one of FASTRPC_INIT_* macros */
 	uintptr_t file;		/* pointer to elf file */
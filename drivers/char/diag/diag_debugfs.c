@@ -16,8 +16,13 @@
 #include <linux/debugfs.h>
 #include <linux/atomic.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
 #include "diagchar.h"
 #include "diagfwd.h"
+#include "diagchar_hdlc.h"
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 #include "diagfwd_bridge.h"
 #endif
@@ -38,6 +43,8 @@
 #include "diag_ipc_logging.h"
 
 #define DEBUG_BUF_SIZE	4096
+#define DIAG_HDLC_BENCH_LEN	(64 * 1024)
+#define DIAG_HDLC_BENCH_LOOPS	64
 static struct dentry *diag_dbgfs_dent;
 static int diag_dbgfs_table_index;
 static int diag_dbgfs_mempool_index;
@@ -261,6 +268,90 @@ static ssize_t diag_dbgfs_read_power(struct file *file, char __user *ubuf,
 	return ret;
 }
 
+static u64 diag_dbgfs_hdlc_run(bool fast, const uint8_t *src, uint8_t *dst,
+			       int *out_len)
+{
+	struct diag_send_desc_type send;
+	struct diag_hdlc_dest_type enc;
+	ktime_t start;
+	int i;
+
+	diag_hdlc_fast = fast;
+	start = ktime_get();
+	for (i = 0; i < DIAG_HDLC_BENCH_LOOPS; i++) {
+		send.pkt = src;
+		send.last = src + DIAG_HDLC_BENCH_LEN - 1;
+		send.state = DIAG_STATE_START;
+		send.terminate = 1;
+		enc.dest = dst;
+		enc.dest_last = dst + 2 * DIAG_HDLC_BENCH_LEN + 7;
+		enc.crc = 0;
+		diag_hdlc_encode(&send, &enc);
+	}
+	*out_len = (uint8_t *)enc.dest - dst;
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/*
+ * Encodes a log-like buffer, about one byte in 64 needing an escape,
+ * with the byte at a time encoder and the run copying one, and checks
+ * they agree.
+ */
+static ssize_t diag_dbgfs_read_hdlc_bench(struct file *file,
+					  char __user *ubuf, size_t count,
+					  loff_t *ppos)
+{
+	uint8_t *src = NULL, *ref = NULL, *dst = NULL;
+	u64 slow_ns, fast_ns;
+	int ref_len, fast_len, i, ret;
+	char *buf = NULL;
+	unsigned int buf_size;
+
+	if (*ppos)
+		return 0;
+
+	src = vmalloc(DIAG_HDLC_BENCH_LEN);
+	ref = vmalloc(2 * DIAG_HDLC_BENCH_LEN + 8);
+	dst = vmalloc(2 * DIAG_HDLC_BENCH_LEN + 8);
+	buf = kzalloc(DEBUG_BUF_SIZE, GFP_KERNEL);
+	if (!src || !ref || !dst || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	get_random_bytes(src, DIAG_HDLC_BENCH_LEN);
+	for (i = 0; i < DIAG_HDLC_BENCH_LEN; i++) {
+		if ((src[i] & 0x3F) == 0)
+			src[i] = (src[i] & 0x40) ? CONTROL_CHAR : ESC_CHAR;
+		else if (src[i] == CONTROL_CHAR || src[i] == ESC_CHAR)
+			src[i] = 0;
+	}
+
+	slow_ns = diag_dbgfs_hdlc_run(false, src, ref, &ref_len);
+	fast_ns = diag_dbgfs_hdlc_run(true, src, dst, &fast_len);
+
+	buf_size = ksize(buf);
+	ret = scnprintf(buf, buf_size,
+		"bytes per pass: %d, passes: %d\n"
+		"byte at a time: %llu ns/KB\n"
+		"run copying: %llu ns/KB\n"
+		"output: %s\n",
+		DIAG_HDLC_BENCH_LEN, DIAG_HDLC_BENCH_LOOPS,
+		div_u64(slow_ns, DIAG_HDLC_BENCH_LOOPS *
+			(DIAG_HDLC_BENCH_LEN / 1024)),
+		div_u64(fast_ns, DIAG_HDLC_BENCH_LOOPS *
+			(DIAG_HDLC_BENCH_LEN / 1024)),
+		(ref_len == fast_len && !memcmp(ref, dst, ref_len)) ?
+		"match" : "MISMATCH");
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, ret);
+out:
+	diag_hdlc_fast = true;
+	kfree(buf);
+	vfree(dst);
+	vfree(ref);
+	vfree(src);
+	return ret;
+}
+
 static ssize_t diag_dbgfs_read_table(struct file *file, char __user *ubuf,
 				     size_t count, loff_t *ppos)
 {
@@ -1089,6 +1180,10 @@ const struct file_operations diag_dbgfs_power_ops = {
 	.read = diag_dbgfs_read_power,
 };
 
+const struct file_operations diag_dbgfs_hdlc_bench_ops = {
+	.read = diag_dbgfs_read_hdlc_bench,
+};
+
 #ifdef CONFIG_IPC_LOGGING
 const struct file_operations diag_dbgfs_debug_ops = {
 	.write = diag_dbgfs_write_debug
@@ -1148,6 +1243,11 @@ int diag_debugfs_init(void)
 	if (!entry)
 		goto err;
 
+	entry = debugfs_create_file("hdlc_bench", 0444, diag_dbgfs_dent, 0,
+				    &diag_dbgfs_hdlc_bench_ops);
+	if (!entry)
+		goto err;
+
 #ifdef CONFIG_IPC_LOGGING
 	entry = debugfs_create_file("debug", 0444, diag_dbgfs_dent, 0,
 				    &diag_dbgfs_debug_ops);
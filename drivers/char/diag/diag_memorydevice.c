@@ -22,6 +22,8 @@
 #include <linux/delay.h>
 #include <linux/kmemleak.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include "diagchar.h"
 #include "diag_memorydevice.h"
 #include "diagfwd_bridge.h"
@@ -31,6 +33,9 @@
 #include "diagfwd_peripheral.h"
 #include "diag_ipc_logging.h"
 
+#define DIAG_MD_RING_MAX_SIZE	(8 * 1024 * 1024)
+#define DIAG_MD_RING_FLUSH_MS	10
+
 struct diag_md_info diag_md[NUM_DIAG_MD_DEV] = {
 	{
 		.id = DIAG_MD_LOCAL,
@@ -137,6 +142,166 @@ void diag_md_close_all(void)
 	diag_ws_reset(DIAG_WS_MUX);
 }
 
+static void diag_md_ring_flush(unsigned long data)
+{
+	wake_up_interruptible(&driver->wait_q);
+}
+
+struct diag_md_ring *diag_md_ring_create(size_t map_len)
+{
+	struct diag_md_ring *ring = NULL;
+	size_t size = map_len - PAGE_SIZE;
+
+	if (map_len <= PAGE_SIZE || size < PAGE_SIZE ||
+	    size > DIAG_MD_RING_MAX_SIZE || !is_power_of_2(size))
+		return ERR_PTR(-EINVAL);
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return ERR_PTR(-ENOMEM);
+	ring->hdr = vmalloc_user(map_len);
+	if (!ring->hdr) {
+		kfree(ring);
+		return ERR_PTR(-ENOMEM);
+	}
+	kref_init(&ring->kref);
+	spin_lock_init(&ring->lock);
+	setup_timer(&ring->timer, diag_md_ring_flush, 0);
+	ring->data = (unsigned char *)ring->hdr + PAGE_SIZE;
+	ring->size = size;
+	ring->hdr->size = size;
+	ring->hdr->data_offset = PAGE_SIZE;
+	ring->hdr->watermark = size / 8;
+	return ring;
+}
+
+static void diag_md_ring_release(struct kref *kref)
+{
+	struct diag_md_ring *ring = container_of(kref, struct diag_md_ring,
+						 kref);
+
+	del_timer_sync(&ring->timer);
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+void diag_md_ring_put(struct diag_md_ring *ring)
+{
+	if (ring)
+		kref_put(&ring->kref, diag_md_ring_release);
+}
+
+static void diag_md_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct diag_md_ring *ring = vma->vm_private_data;
+
+	kref_get(&ring->kref);
+}
+
+static void diag_md_ring_vm_close(struct vm_area_struct *vma)
+{
+	diag_md_ring_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct diag_md_ring_vm_ops = {
+	.open = diag_md_ring_vm_open,
+	.close = diag_md_ring_vm_close,
+};
+
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma)
+{
+	int err;
+
+	err = remap_vmalloc_range(vma, ring->hdr, 0);
+	if (err)
+		return err;
+	vma->vm_private_data = ring;
+	vma->vm_ops = &diag_md_ring_vm_ops;
+	kref_get(&ring->kref);
+	return 0;
+}
+
+/* Called with ring->lock held. tail is client memory, do not trust it */
+static uint32_t diag_md_ring_used(struct diag_md_ring *ring)
+{
+	return min_t(uint32_t, ring->head - READ_ONCE(ring->hdr->tail),
+		     ring->size);
+}
+
+static uint32_t diag_md_ring_mark(struct diag_md_ring *ring)
+{
+	return clamp_t(uint32_t, READ_ONCE(ring->hdr->watermark), 1,
+		       ring->size / 2);
+}
+
+int diag_md_ring_ready(struct diag_md_ring *ring)
+{
+	unsigned long flags;
+	uint32_t used;
+	int ready;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	used = diag_md_ring_used(ring);
+	ready = used >= diag_md_ring_mark(ring) ||
+		(used && time_after_eq(jiffies, ring->oldest +
+				msecs_to_jiffies(DIAG_MD_RING_FLUSH_MS)));
+	spin_unlock_irqrestore(&ring->lock, flags);
+	return ready;
+}
+
+/*
+ * Appends one packet to the ring. Readers are only woken when the
+ * watermark is crossed; the timer armed when the ring goes non-empty
+ * takes care of slow traffic.
+ */
+static void diag_md_ring_write(struct diag_md_ring *ring, int token,
+			       unsigned char *buf, int len)
+{
+	struct diag_md_ring_rec *rec = NULL;
+	uint32_t need, off, pad, used, mark;
+	unsigned long flags;
+	int wake;
+
+	need = ALIGN(sizeof(*rec) + len, 8);
+	spin_lock_irqsave(&ring->lock, flags);
+	used = diag_md_ring_used(ring);
+	off = ring->head & (ring->size - 1);
+	pad = (ring->size - off < need) ? ring->size - off : 0;
+	if (need + pad > ring->size - used) {
+		ring->hdr->dropped++;
+		spin_unlock_irqrestore(&ring->lock, flags);
+		pr_err_ratelimited("diag: md ring full, dropping packet of len: %d\n",
+				   len);
+		return;
+	}
+	if (pad) {
+		rec = (struct diag_md_ring_rec *)(ring->data + off);
+		rec->len = DIAG_MD_RING_WRAP;
+		rec->token = 0;
+		off = 0;
+	}
+	rec = (struct diag_md_ring_rec *)(ring->data + off);
+	rec->len = len;
+	rec->token = token;
+	memcpy(rec + 1, buf, len);
+	ring->head += pad + need;
+	/* the records must be visible before the head covering them */
+	smp_wmb();
+	WRITE_ONCE(ring->hdr->head, ring->head);
+
+	if (!used) {
+		ring->oldest = jiffies;
+		mod_timer(&ring->timer, jiffies +
+			  msecs_to_jiffies(DIAG_MD_RING_FLUSH_MS));
+	}
+	mark = diag_md_ring_mark(ring);
+	wake = used < mark && used + pad + need >= mark;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	if (wake)
+		wake_up_interruptible(&driver->wait_q);
+}
+
 int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 {
 	int i, pid = 0;
@@ -171,6 +336,24 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 		return -EINVAL;
 	}
 
+	/*
+	 * Clients with a mapped ring get the packet copied straight in, and
+	 * the buffer goes back to its owner right away. A full ring drops
+	 * the packet, which is counted in the ring header.
+	 */
+	if (session_info->ring) {
+		diag_md_ring_write(session_info->ring,
+				   id > 0 ? diag_get_remote(id) : 0, buf, len);
+		mutex_unlock(&driver->md_session_lock);
+		spin_lock_irqsave(&ch->lock, flags);
+		if (ch->ops && ch->ops->write_done)
+			ch->ops->write_done(buf, len, ctx,
+					    DIAG_MEMORY_DEVICE_MODE);
+		spin_unlock_irqrestore(&ch->lock, flags);
+		diag_ws_release();
+		return 0;
+	}
+
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
 		if (ch->tbl[i].buf != buf)
@@ -13,6 +13,10 @@
 #ifndef DIAG_MEMORYDEVICE_H
 #define DIAG_MEMORYDEVICE_H
 
+#include <linux/kref.h>
+#include <linux/mm.h>
+#include <linux/timer.h>
+
 #define DIAG_MD_LOCAL		0
 #define DIAG_MD_LOCAL_LAST	1
 #define DIAG_MD_BRIDGE_BASE	DIAG_MD_LOCAL_LAST
@@ -33,6 +37,22 @@ struct diag_buf_tbl_t {
 	int ctx;
 };
 
+/*
+ * Kernel side of a client's mmap'd ring, see struct diag_md_ring_hdr.
+ * head is kept here as well as in the shared header so that a client
+ * scribbling over the header page cannot move the kernel's writes.
+ */
+struct diag_md_ring {
+	struct kref kref;
+	spinlock_t lock;
+	struct diag_md_ring_hdr *hdr;
+	unsigned char *data;
+	uint32_t size;
+	uint32_t head;
+	unsigned long oldest;
+	struct timer_list timer;
+};
+
 struct diag_md_info {
 	int id;
 	int ctx;
@@ -57,4 +77,8 @@ int diag_md_close_peripheral(int id, uint8_t peripheral);
 int diag_md_write(int id, unsigned char *buf, int len, int ctx);
 int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			 struct diag_md_session_t *info);
+struct diag_md_ring *diag_md_ring_create(size_t map_len);
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma);
+void diag_md_ring_put(struct diag_md_ring *ring);
+int diag_md_ring_ready(struct diag_md_ring *ring);
 #endif
@@ -438,6 +438,8 @@ struct diag_logging_mode_param_t {
 	uint8_t mode_param;
 } __packed;
 
+struct diag_md_ring;
+
 struct diag_md_session_t {
 	int pid;
 	int peripheral_mask;
@@ -449,6 +451,7 @@ struct diag_md_session_t {
 	struct diag_mask_info *event_mask;
 	struct thread_info *md_client_thread_info;
 	struct task_struct *task;
+	struct diag_md_ring *ring;
 };
 
 /*
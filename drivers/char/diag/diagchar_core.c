@@ -22,6 +22,7 @@
 #include <linux/sched.h>
 #include <linux/ratelimit.h>
 #include <linux/timer.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/platform_device.h>
 #include <linux/msm_mhi.h>
@@ -1454,6 +1455,8 @@ static void diag_md_session_close(int pid)
 	kfree(session_info->event_mask);
 	session_info->event_mask = NULL;
 	del_timer(&session_info->hdlc_reset_timer);
+	diag_md_ring_put(session_info->ring);
+	session_info->ring = NULL;
 
 	for (i = 0; i < NUM_MD_SESSIONS && !found; i++) {
 		if (driver->md_session_map[i] != NULL)
@@ -3712,10 +3715,79 @@ static int diag_real_time_info_init(void)
 	return 0;
 }
 
+/*
+ * Maps a ring for the calling memory device client, see
+ * struct diag_md_ring_hdr. Log packets then go to the ring instead of
+ * through read().
+ */
+static int diagchar_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct diag_md_session_t *session_info = NULL;
+	struct diag_md_ring *ring = NULL;
+	int err = 0;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (!session_info) {
+		err = -EINVAL;
+		goto out;
+	}
+	if (session_info->ring) {
+		err = -EBUSY;
+		goto out;
+	}
+	ring = diag_md_ring_create(vma->vm_end - vma->vm_start);
+	if (IS_ERR(ring)) {
+		err = PTR_ERR(ring);
+		goto out;
+	}
+	err = diag_md_ring_mmap(ring, vma);
+	if (err) {
+		diag_md_ring_put(ring);
+		goto out;
+	}
+	session_info->ring = ring;
+	DIAG_LOG(DIAG_DEBUG_USERSPACE, "mapped md ring of %u bytes for pid %d\n",
+		 ring->size, session_info->pid);
+out:
+	mutex_unlock(&driver->md_session_lock);
+	return err;
+}
+
+static unsigned int diagchar_poll(struct file *file, poll_table *wait)
+{
+	struct diag_md_session_t *session_info = NULL;
+	unsigned int mask = 0;
+	int i;
+
+	poll_wait(file, &driver->wait_q, wait);
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (session_info && session_info->ring &&
+	    diag_md_ring_ready(session_info->ring))
+		mask |= POLLIN | POLLRDNORM;
+	mutex_unlock(&driver->md_session_lock);
+
+	mutex_lock(&driver->diagchar_mutex);
+	for (i = 0; i < driver->num_clients; i++) {
+		if (driver->client_map[i].pid == current->tgid &&
+		    atomic_read(&driver->data_ready_notif[i]) > 0)
+			mask |= POLLIN | POLLRDNORM;
+	}
+	mutex_unlock(&driver->diagchar_mutex);
+	return mask;
+}
+
 static const struct file_operations diagcharfops = {
 	.owner = THIS_MODULE,
 	.read = diagchar_read,
 	.write = diagchar_write,
+	.mmap = diagchar_mmap,
+	.poll = diagchar_poll,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = diagchar_compat_ioctl,
 #endif
@@ -3884,6 +3956,7 @@ static int __init diagchar_init(void)
 
 	pr_debug("diagfwd initializing ..\n");
 	ret = 0;
+	diag_hdlc_init();
 	driver = kzalloc(sizeof(struct diagchar_dev) + 5, GFP_KERNEL);
 	if (!driver)
 		return -ENOMEM;
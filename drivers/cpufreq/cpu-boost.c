@@ -43,6 +43,14 @@ module_param(sched_boost_on_input, bool, 0644);
 
 static bool sched_boost_active;
 
+/*
+ * Apply the boost as a time-bounded floor inside schedutil instead of
+ * raising policy->min, which needs a full policy update on both boost and
+ * removal.
+ */
+static bool input_boost_sched_util;
+module_param(input_boost_sched_util, bool, 0644);
+
 static struct delayed_work input_boost_rem;
 static u64 last_input_time;
 #define MIN_INPUT_INTERVAL (150 * USEC_PER_MSEC)
@@ -173,16 +181,21 @@ static void do_input_boost_rem(struct work_struct *work)
 {
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
+	bool changed = false;
 
 	/* Reset the input_boost_min for all CPUs in the system */
 	pr_debug("Resetting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = 0;
+		if (i_sync_info->input_boost_min) {
+			i_sync_info->input_boost_min = 0;
+			changed = true;
+		}
 	}
 
 	/* Update policies for all online CPUs */
-	update_policy_online();
+	if (changed)
+		update_policy_online();
 
 	if (sched_boost_active) {
 		ret = sched_set_boost(0);
@@ -203,15 +216,19 @@ static void do_input_boost(struct work_struct *work)
 		sched_boost_active = false;
 	}
 
-	/* Set the input_boost_min for all CPUs in the system */
-	pr_debug("Setting input boost min for all CPUs\n");
-	for_each_possible_cpu(i) {
-		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
-	}
+	/* The schedutil floor was already set from the input event */
+	if (!input_boost_sched_util) {
+		/* Set the input_boost_min for all CPUs in the system */
+		pr_debug("Setting input boost min for all CPUs\n");
+		for_each_possible_cpu(i) {
+			i_sync_info = &per_cpu(sync_info, i);
+			i_sync_info->input_boost_min =
+				i_sync_info->input_boost_freq;
+		}
 
-	/* Update policies for all online CPUs */
-	update_policy_online();
+		/* Update policies for all online CPUs */
+		update_policy_online();
+	}
 
 	/* Enable scheduler boost to migrate tasks to big cluster */
 	if (sched_boost_on_input) {
@@ -241,6 +258,17 @@ static void cpuboost_input_event(struct input_handle *handle,
 	if (work_pending(&input_boost_work))
 		return;
 
+	if (input_boost_sched_util) {
+		unsigned long expires = jiffies +
+					msecs_to_jiffies(input_boost_ms);
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			sugov_set_input_boost(cpu,
+				per_cpu(sync_info, cpu).input_boost_freq,
+				expires);
+	}
+
 	queue_work(cpu_boost_wq, &input_boost_work);
 	last_input_time = ktime_to_us(ktime_get());
 }
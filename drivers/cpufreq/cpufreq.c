@@ -376,6 +376,7 @@ static void adjust_jiffies(unsigned long val, struct cpufreq_freqs *ci)
 
 static DEFINE_PER_CPU(unsigned long, freq_scale) = SCHED_CAPACITY_SCALE;
 static DEFINE_PER_CPU(unsigned long, max_freq_scale) = SCHED_CAPACITY_SCALE;
+static DEFINE_PER_CPU(unsigned long, thermal_cap_scale) = SCHED_CAPACITY_SCALE;
 
 static void
 scale_freq_capacity(struct cpufreq_policy *policy, struct cpufreq_freqs *freqs)
@@ -411,9 +412,44 @@ unsigned long cpufreq_scale_freq_capacity(struct sched_domain *sd, int cpu)
 
 unsigned long cpufreq_scale_max_freq_capacity(int cpu)
 {
-	return per_cpu(max_freq_scale, cpu);
+	return min(per_cpu(max_freq_scale, cpu),
+		   per_cpu(thermal_cap_scale, cpu));
 }
 
+/**
+ * cpufreq_update_thermal_cap - Report a frequency cap applied outside cpufreq
+ * @cpus: CPUs the cap applies to.
+ * @max_freq: Capped frequency in kHz, 0 or >= cpuinfo.max_freq to remove it.
+ *
+ * Hardware limits management can clamp the CPU clock without touching the
+ * cpufreq policy. Fold such a cap into the maximum frequency capacity, so
+ * that the scheduler's view of capacity_orig follows the silicon and energy
+ * aware placement stops favouring a clamped cluster. Safe to call from
+ * atomic context.
+ */
+void cpufreq_update_thermal_cap(const struct cpumask *cpus,
+				unsigned long max_freq)
+{
+	struct cpufreq_policy *policy;
+	unsigned long scale = SCHED_CAPACITY_SCALE;
+	int cpu;
+
+	policy = cpufreq_cpu_get_raw(cpumask_first(cpus));
+	if (!policy || !policy->cpuinfo.max_freq)
+		return;
+
+	if (max_freq && max_freq < policy->cpuinfo.max_freq)
+		scale = (max_freq << SCHED_CAPACITY_SHIFT) /
+			policy->cpuinfo.max_freq;
+
+	pr_debug("cpus %*pbl thermal cap %lu kHz scale %lu\n",
+		 cpumask_pr_args(cpus), max_freq, scale);
+
+	for_each_cpu(cpu, cpus)
+		per_cpu(thermal_cap_scale, cpu) = scale;
+}
+EXPORT_SYMBOL_GPL(cpufreq_update_thermal_cap);
+
 static void __cpufreq_notify_transition(struct cpufreq_policy *policy,
 		struct cpufreq_freqs *freqs, unsigned int state)
 {
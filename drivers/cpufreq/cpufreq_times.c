@@ -16,8 +16,10 @@
 #include <linux/cpufreq.h>
 #include <linux/cpufreq_times.h>
 #include <linux/cputime.h>
+#include <linux/hash.h>
 #include <linux/hashtable.h>
 #include <linux/init.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
@@ -26,23 +28,45 @@
 #include <linux/threads.h>
 
 #define UID_HASH_BITS 10
+#define TASK_LOCK_BITS 6
 
 DECLARE_HASHTABLE(uid_hash_table, UID_HASH_BITS);
 
-static DEFINE_SPINLOCK(task_time_in_state_lock); /* task->time_in_state */
+/*
+ * task->time_in_state is protected by one of a small array of locks picked
+ * by task address, so that ticks on different CPUs don't all serialize on
+ * a single lock.
+ */
+static spinlock_t task_time_in_state_locks[1 << TASK_LOCK_BITS] = {
+	[0 ... (1 << TASK_LOCK_BITS) - 1] =
+		__SPIN_LOCK_UNLOCKED(task_time_in_state_locks),
+};
 static DEFINE_SPINLOCK(uid_lock); /* uid_hash_table */
 
+#define UID_TIME_IN_STATE_BIN_VERSION 1
+
+static inline spinlock_t *task_time_in_state_lock(struct task_struct *p)
+{
+	return &task_time_in_state_locks[hash_ptr(p, TASK_LOCK_BITS)];
+}
+
 struct concurrent_times {
 	atomic64_t active[NR_CPUS];
 	atomic64_t policy[NR_CPUS];
 };
 
+/*
+ * Ticks are accumulated without locking into the per-cpu cpu_time_in_state
+ * array and folded with time_in_state only when read. time_in_state holds
+ * time carried over from a previous, smaller entry of the same uid.
+ */
 struct uid_entry {
 	uid_t uid;
 	unsigned int max_state;
 	struct hlist_node hash;
 	struct rcu_head rcu;
 	struct concurrent_times *concurrent_times;
+	u64 __percpu *cpu_time_in_state;
 	u64 time_in_state[0];
 };
 
@@ -65,6 +89,44 @@ static struct cpu_freqs *all_freqs[NR_CPUS];
 static unsigned int next_offset;
 
 
+/* Caller must hold rcu_read_lock() or uid lock */
+static u64 uid_entry_time(struct uid_entry *uid_entry, unsigned int state)
+{
+	u64 time = uid_entry->time_in_state[state];
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		time += per_cpu_ptr(uid_entry->cpu_time_in_state, cpu)[state];
+
+	return time;
+}
+
+static struct uid_entry *alloc_uid_entry(unsigned int max_state)
+{
+	struct uid_entry *uid_entry;
+
+	uid_entry = kzalloc(sizeof(*uid_entry) + max_state *
+			    sizeof(uid_entry->time_in_state[0]), GFP_ATOMIC);
+	if (!uid_entry)
+		return NULL;
+	uid_entry->cpu_time_in_state = __alloc_percpu_gfp(
+		max_state * sizeof(u64), sizeof(u64), GFP_ATOMIC);
+	if (!uid_entry->cpu_time_in_state) {
+		kfree(uid_entry);
+		return NULL;
+	}
+	uid_entry->max_state = max_state;
+	return uid_entry;
+}
+
+static void uid_entry_free_rcu(struct rcu_head *rcu)
+{
+	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
+
+	free_percpu(uid_entry->cpu_time_in_state);
+	kfree(uid_entry);
+}
+
 /* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_uid_entry_rcu(uid_t uid)
 {
@@ -95,41 +157,39 @@ static struct uid_entry *find_or_register_uid_locked(uid_t uid)
 	struct uid_entry *uid_entry, *temp;
 	struct concurrent_times *times;
 	unsigned int max_state = READ_ONCE(next_offset);
-	size_t alloc_size = sizeof(*uid_entry) + max_state *
-		sizeof(uid_entry->time_in_state[0]);
+	unsigned int i;
 
 	uid_entry = find_uid_entry_locked(uid);
 	if (uid_entry) {
 		if (uid_entry->max_state == max_state)
 			return uid_entry;
 		/* uid_entry->time_in_state is too small to track all freqs, so
-		 * expand it.
+		 * replace it with a larger entry carrying the folded times.
+		 * This only happens while cpufreq policies are being created.
 		 */
-		temp = __krealloc(uid_entry, alloc_size, GFP_ATOMIC);
+		temp = alloc_uid_entry(max_state);
 		if (!temp)
 			return uid_entry;
-		temp->max_state = max_state;
-		memset(temp->time_in_state + uid_entry->max_state, 0,
-		       (max_state - uid_entry->max_state) *
-		       sizeof(uid_entry->time_in_state[0]));
-		if (temp != uid_entry) {
-			hlist_replace_rcu(&uid_entry->hash, &temp->hash);
-			kfree_rcu(uid_entry, rcu);
-		}
+		temp->uid = uid;
+		temp->concurrent_times = uid_entry->concurrent_times;
+		for (i = 0; i < uid_entry->max_state; i++)
+			temp->time_in_state[i] = uid_entry_time(uid_entry, i);
+		hlist_replace_rcu(&uid_entry->hash, &temp->hash);
+		call_rcu(&uid_entry->rcu, uid_entry_free_rcu);
 		return temp;
 	}
 
-	uid_entry = kzalloc(alloc_size, GFP_ATOMIC);
+	uid_entry = alloc_uid_entry(max_state);
 	if (!uid_entry)
 		return NULL;
 	times = kzalloc(sizeof(*times), GFP_ATOMIC);
 	if (!times) {
+		free_percpu(uid_entry->cpu_time_in_state);
 		kfree(uid_entry);
 		return NULL;
 	}
 
 	uid_entry->uid = uid;
-	uid_entry->max_state = max_state;
 	uid_entry->concurrent_times = times;
 
 	hash_add_rcu(uid_hash_table, &uid_entry->hash, uid);
@@ -174,7 +234,7 @@ static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 	for (i = 0; i < uid_entry->max_state; ++i) {
 		if (freq_index_invalid(i))
 			continue;
-		time = cputime_to_clock_t(uid_entry->time_in_state[i]);
+		time = cputime_to_clock_t(uid_entry_time(uid_entry, i));
 		seq_write(m, &time, sizeof(time));
 	}
 
@@ -240,7 +300,7 @@ static int uid_time_in_state_seq_show(struct seq_file *m, void *v)
 			u64 time;
 			if (freq_index_invalid(i))
 				continue;
-			time = cputime_to_clock_t(uid_entry->time_in_state[i]);
+			time = cputime_to_clock_t(uid_entry_time(uid_entry, i));
 			seq_put_decimal_ull(m, " ", time);
 		}
 		if (uid_entry->max_state)
@@ -251,6 +311,71 @@ static int uid_time_in_state_seq_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+/*
+ * Binary variant of uid_time_in_state for periodic sampling. All values
+ * are native endian. The file starts with a header:
+ *
+ *	u32 version, u32 nr_freqs, u32 freqs[nr_freqs]
+ *
+ * followed by one record per uid:
+ *
+ *	u32 uid, u32 reserved, u64 times[nr_freqs]
+ *
+ * with the times in clock_t, in the same order as the header frequencies.
+ */
+static int uid_time_in_state_bin_seq_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	unsigned int max_state = READ_ONCE(next_offset);
+	unsigned int i;
+	u32 val;
+	u64 time;
+
+	if (v == uid_hash_table) {
+		struct cpu_freqs *freqs, *last_freqs = NULL;
+		int cpu;
+
+		val = UID_TIME_IN_STATE_BIN_VERSION;
+		seq_write(m, &val, sizeof(val));
+		val = 0;
+		for (i = 0; i < max_state; i++)
+			val += !freq_index_invalid(i);
+		seq_write(m, &val, sizeof(val));
+
+		for_each_possible_cpu(cpu) {
+			freqs = all_freqs[cpu];
+			if (!freqs || freqs == last_freqs)
+				continue;
+			last_freqs = freqs;
+			for (i = 0; i < freqs->max_state; i++) {
+				val = freqs->freq_table[i];
+				if (val == CPUFREQ_ENTRY_INVALID)
+					continue;
+				seq_write(m, &val, sizeof(val));
+			}
+		}
+	}
+
+	rcu_read_lock();
+
+	hlist_for_each_entry_rcu(uid_entry, (struct hlist_head *)v, hash) {
+		val = uid_entry->uid;
+		seq_write(m, &val, sizeof(val));
+		val = 0;
+		seq_write(m, &val, sizeof(val));
+		for (i = 0; i < max_state; i++) {
+			if (freq_index_invalid(i))
+				continue;
+			time = i < uid_entry->max_state ?
+				cputime_to_clock_t(uid_entry_time(uid_entry, i)) : 0;
+			seq_write(m, &time, sizeof(time));
+		}
+	}
+
+	rcu_read_unlock();
+	return 0;
+}
+
 static int concurrent_time_seq_show(struct seq_file *m, void *v,
 	atomic64_t *(*get_times)(struct concurrent_times *))
 {
@@ -333,17 +458,19 @@ static int concurrent_policy_time_seq_show(struct seq_file *m, void *v)
 
 void cpufreq_task_times_init(struct task_struct *p)
 {
+	spinlock_t *lock = task_time_in_state_lock(p);
 	unsigned long flags;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(lock, flags);
 	p->time_in_state = NULL;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 	p->max_state = 0;
 }
 
 void cpufreq_task_times_alloc(struct task_struct *p)
 {
 	void *temp;
+	spinlock_t *lock = task_time_in_state_lock(p);
 	unsigned long flags;
 	unsigned int max_state = READ_ONCE(next_offset);
 
@@ -352,13 +479,13 @@ void cpufreq_task_times_alloc(struct task_struct *p)
 	if (!temp)
 		return;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(lock, flags);
 	p->time_in_state = temp;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 	p->max_state = max_state;
 }
 
-/* Caller must hold task_time_in_state_lock */
+/* Caller must hold task_time_in_state_lock(p) */
 static int cpufreq_task_times_realloc_locked(struct task_struct *p)
 {
 	void *temp;
@@ -376,16 +503,17 @@ static int cpufreq_task_times_realloc_locked(struct task_struct *p)
 
 void cpufreq_task_times_exit(struct task_struct *p)
 {
+	spinlock_t *lock = task_time_in_state_lock(p);
 	unsigned long flags;
 	void *temp;
 
 	if (!p->time_in_state)
 		return;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(lock, flags);
 	temp = p->time_in_state;
 	p->time_in_state = NULL;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 	kfree(temp);
 }
 
@@ -394,11 +522,12 @@ int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 {
 	unsigned int cpu, i;
 	cputime_t cputime;
+	spinlock_t *lock = task_time_in_state_lock(p);
 	unsigned long flags;
 	struct cpu_freqs *freqs;
 	struct cpu_freqs *last_freqs = NULL;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(lock, flags);
 	for_each_possible_cpu(cpu) {
 		freqs = all_freqs[cpu];
 		if (!freqs || freqs == last_freqs)
@@ -417,12 +546,13 @@ int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 				   (unsigned long)cputime_to_clock_t(cputime));
 		}
 	}
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 	return 0;
 }
 
 void cpufreq_acct_update_power(struct task_struct *p, cputime_t cputime)
 {
+	spinlock_t *lock = task_time_in_state_lock(p);
 	unsigned long flags;
 	unsigned int state;
 	unsigned int active_cpu_cnt = 0;
@@ -439,24 +569,26 @@ void cpufreq_acct_update_power(struct task_struct *p, cputime_t cputime)
 
 	state = freqs->offset + READ_ONCE(freqs->last_index);
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(lock, flags);
 	if ((state < p->max_state || !cpufreq_task_times_realloc_locked(p)) &&
 	    p->time_in_state)
 		p->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
-
-	spin_lock_irqsave(&uid_lock, flags);
-	uid_entry = find_or_register_uid_locked(uid);
-	if (uid_entry && state < uid_entry->max_state)
-		uid_entry->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&uid_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 
 	rcu_read_lock();
 	uid_entry = find_uid_entry_rcu(uid);
+	if (!uid_entry || state >= uid_entry->max_state) {
+		/* Slow path: first tick of this uid or new freqs to track */
+		spin_lock_irqsave(&uid_lock, flags);
+		uid_entry = find_or_register_uid_locked(uid);
+		spin_unlock_irqrestore(&uid_lock, flags);
+	}
 	if (!uid_entry) {
 		rcu_read_unlock();
 		return;
 	}
+	if (state < uid_entry->max_state)
+		this_cpu_add(uid_entry->cpu_time_in_state[state], cputime);
 
 	for_each_possible_cpu(cpu)
 		if (!idle_cpu(cpu))
@@ -532,6 +664,7 @@ static void uid_entry_reclaim(struct rcu_head *rcu)
 	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
 
 	kfree(uid_entry->concurrent_times);
+	free_percpu(uid_entry->cpu_time_in_state);
 	kfree(uid_entry);
 }
 
@@ -601,6 +734,25 @@ static const struct file_operations uid_time_in_state_fops = {
 	.release	= seq_release,
 };
 
+static const struct seq_operations uid_time_in_state_bin_seq_ops = {
+	.start = uid_seq_start,
+	.next = uid_seq_next,
+	.stop = uid_seq_stop,
+	.show = uid_time_in_state_bin_seq_show,
+};
+
+static int uid_time_in_state_bin_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &uid_time_in_state_bin_seq_ops);
+}
+
+static const struct file_operations uid_time_in_state_bin_fops = {
+	.open		= uid_time_in_state_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static const struct seq_operations concurrent_active_time_seq_ops = {
 	.start = uid_seq_start,
 	.next = uid_seq_next,
@@ -644,6 +796,9 @@ static int __init cpufreq_times_init(void)
 	proc_create_data("uid_time_in_state", 0444, NULL,
 			 &uid_time_in_state_fops, NULL);
 
+	proc_create_data("uid_time_in_state_bin", 0444, NULL,
+			 &uid_time_in_state_bin_fops, NULL);
+
 	proc_create_data("uid_concurrent_active_time", 0444, NULL,
 			 &concurrent_active_time_fops, NULL);
 
@@ -27,12 +27,14 @@
 #include <linux/err.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
+#include <linux/cpu_cooling.h>
 #include <trace/events/power.h>
 
 static DEFINE_MUTEX(l2bw_lock);
 
 static struct clk *cpu_clk[NR_CPUS];
 static struct clk *l2_clk;
+static struct thermal_cooling_device *cdev[NR_CPUS];
 static DEFINE_PER_CPU(struct cpufreq_frequency_table *, freq_table);
 static bool hotplug_ready;
 
@@ -174,6 +176,35 @@ static int msm_cpufreq_init(struct cpufreq_policy *policy)
 	return 0;
 }
 
+/*
+ * Clusters whose cpu node is a cooling device get one with power
+ * extensions from the energy model, for the power allocator governor.
+ */
+static void msm_cpufreq_ready(struct cpufreq_policy *policy)
+{
+	struct device_node *np;
+	struct thermal_cooling_device *c;
+
+	if (cdev[policy->cpu])
+		return;
+
+	np = of_get_cpu_node(policy->cpu, NULL);
+	if (!np)
+		return;
+
+	if (of_find_property(np, "#cooling-cells", NULL)) {
+		c = of_cpufreq_energy_cooling_register(np,
+						       policy->related_cpus);
+		if (IS_ERR(c))
+			pr_warn("cpufreq: cpu%d no cooling device: %ld\n",
+				policy->cpu, PTR_ERR(c));
+		else
+			cdev[policy->cpu] = c;
+	}
+
+	of_node_put(np);
+}
+
 static int msm_cpufreq_cpu_callback(struct notifier_block *nfb,
 		unsigned long action, void *hcpu)
 {
@@ -313,6 +344,7 @@ static struct cpufreq_driver msm_cpufreq_driver = {
 	.verify		= msm_cpufreq_verify,
 	.target		= msm_cpufreq_target,
 	.get		= msm_cpufreq_get_freq,
+	.ready		= msm_cpufreq_ready,
 	.name		= "msm",
 	.attr		= msm_freq_attr,
 };
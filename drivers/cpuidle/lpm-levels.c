@@ -35,6 +35,7 @@
 #include <linux/coresight-cti.h>
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
+#include <linux/kernel_stat.h>
 #include <linux/cpu_pm.h>
 #include <linux/arm-smccc.h>
 #include <soc/qcom/spm.h>
@@ -117,6 +118,46 @@ struct lpm_history {
 
 static DEFINE_PER_CPU(struct lpm_history, hist);
 
+/*
+ * Source based prediction: each wakeup is classified as the expected timer,
+ * a device interrupt or an IPI, and binned by the deepest level its
+ * residency would have paid for. Timer wakeups are already known from the
+ * next event, so only IPI and device interrupt wakeups are counted against
+ * a level. This keeps periodic hrtimer driven workloads in deep levels.
+ */
+static bool src_prediction;
+module_param_named(src_prediction,
+	src_prediction, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
+/* Restrict a level when this share of recent wakeups would exit early */
+static uint32_t src_fail_pct = 30;
+module_param_named(
+	src_fail_pct, src_fail_pct, uint, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+#define SRC_MIN_SAMPLES	16
+#define SRC_DECAY_SAMPLES	128
+
+enum lpm_wakeup_src {
+	LPM_WAKE_TIMER,
+	LPM_WAKE_IPI,
+	LPM_WAKE_IRQ,
+	LPM_WAKE_NR,
+};
+
+struct lpm_src_history {
+	uint16_t hist[LPM_WAKE_NR][NR_LPM_LEVELS];
+	uint32_t nsamp;
+	uint32_t sleep_us;
+	unsigned long irqs;
+	int64_t stime;
+};
+
+static DEFINE_PER_CPU(struct lpm_src_history, src_hist);
+/* Expiry of the next timer, sampled when the cpu selected its level */
+static DEFINE_PER_CPU(int64_t, next_timer_ns);
+static DEFINE_PER_CPU(struct lpm_pred_stats [NR_LPM_LEVELS], cpu_pred_stats);
+
 static DEFINE_PER_CPU(struct lpm_cluster*, cpu_cluster);
 static bool suspend_in_progress;
 static struct hrtimer lpm_hrtimer;
@@ -686,6 +727,144 @@ static void clear_predict_history(void)
 	}
 }
 
+static int lpm_src_predict(struct cpuidle_device *dev, struct lpm_cpu *cpu,
+		uint32_t next_wakeup_us, uint32_t *idx_restrict_time)
+{
+	struct lpm_src_history *sh = &per_cpu(src_hist, dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t *min_residency = get_per_cpu_min_residency(dev->cpu);
+	uint32_t early = 0;
+	int i;
+
+	sh->sleep_us = next_wakeup_us;
+	sh->irqs = kstat_cpu_irqs_sum(dev->cpu);
+	sh->stime = 0;
+
+	/* The previous restriction was too strict, don't apply it again */
+	if (history->hinvalid) {
+		history->hinvalid = 0;
+		return cpu->nlevels + 1;
+	}
+
+	if (sh->nsamp < SRC_MIN_SAMPLES)
+		return cpu->nlevels + 1;
+
+	for (i = 1; i < cpu->nlevels; i++) {
+		early += sh->hist[LPM_WAKE_IPI][i - 1] +
+			 sh->hist[LPM_WAKE_IRQ][i - 1];
+		if (early * 100 > sh->nsamp * src_fail_pct) {
+			*idx_restrict_time = min_residency[i];
+			sh->stime = ktime_to_us(ktime_get()) + min_residency[i];
+			return i;
+		}
+	}
+
+	return cpu->nlevels + 1;
+}
+
+static void update_src_history(struct cpuidle_device *dev,
+		struct lpm_cpu *cpu, int idx)
+{
+	struct lpm_src_history *sh = &per_cpu(src_hist, dev->cpu);
+	uint32_t *min_residency = get_per_cpu_min_residency(dev->cpu);
+	uint32_t residency = dev->last_residency;
+	enum lpm_wakeup_src src;
+	int i, j, fit = 0;
+
+	if (!src_prediction)
+		return;
+
+	/* Woken by our own prediction timer: not a sample of the workload */
+	if (per_cpu(hist, dev->cpu).hinvalid)
+		return;
+
+	if (residency + tmr_add >= sh->sleep_us)
+		src = LPM_WAKE_TIMER;
+	else if (kstat_cpu_irqs_sum(dev->cpu) != sh->irqs)
+		src = LPM_WAKE_IRQ;
+	else
+		src = LPM_WAKE_IPI;
+
+	for (i = 1; i < cpu->nlevels; i++) {
+		if (residency < min_residency[i])
+			break;
+		fit = i;
+	}
+
+	if (++sh->nsamp > SRC_DECAY_SAMPLES) {
+		sh->nsamp = 0;
+		for (i = 0; i < LPM_WAKE_NR; i++) {
+			for (j = 0; j < cpu->nlevels; j++) {
+				sh->hist[i][j] >>= 1;
+				sh->nsamp += sh->hist[i][j];
+			}
+		}
+		sh->nsamp++;
+	}
+	sh->hist[src][fit]++;
+}
+
+static void update_pred_stats(struct lpm_pred_stats *stats, int idx,
+		int nlevels, uint32_t residency, uint32_t min_residency,
+		uint32_t next_min_residency)
+{
+	if (idx && residency < min_residency)
+		stats[idx].early++;
+	else if (idx < nlevels - 1 && residency >= next_min_residency)
+		stats[idx].late++;
+	else
+		stats[idx].hit++;
+}
+
+static int get_pred_stats(char *buf, const struct kernel_param *kp)
+{
+	struct lpm_cluster *cluster = lpm_root_node;
+	struct lpm_pred_stats *stats;
+	struct list_head *list;
+	int cpu, i, cnt = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct lpm_cluster *cl = per_cpu(cpu_cluster, cpu);
+
+		if (!cl)
+			continue;
+		stats = per_cpu(cpu_pred_stats, cpu);
+		for (i = 0; i < cl->cpu->nlevels; i++)
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				"cpu%d %s hit=%u early=%u late=%u\n", cpu,
+				cl->cpu->levels[i].name, stats[i].hit,
+				stats[i].early, stats[i].late);
+	}
+
+	if (!cluster)
+		return cnt;
+
+	for (i = 0; i < cluster->nlevels; i++)
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+			"%s %s hit=%u early=%u late=%u\n",
+			cluster->cluster_name, cluster->levels[i].level_name,
+			cluster->pred_stats[i].hit, cluster->pred_stats[i].early,
+			cluster->pred_stats[i].late);
+
+	list_for_each(list, &cluster->child) {
+		struct lpm_cluster *n = list_entry(list, typeof(*n), list);
+
+		for (i = 0; i < n->nlevels; i++)
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				"%s %s hit=%u early=%u late=%u\n",
+				n->cluster_name, n->levels[i].level_name,
+				n->pred_stats[i].hit, n->pred_stats[i].early,
+				n->pred_stats[i].late);
+	}
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_pred_stats = {
+	.get = get_pred_stats,
+};
+module_param_cb(prediction_stats, &param_ops_pred_stats, NULL, S_IRUGO);
+
 static void update_history(struct cpuidle_device *dev, int idx);
 
 static int cpu_power_select(struct cpuidle_device *dev,
@@ -711,6 +890,9 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	if ((sleep_disabled && !cpu_isolated(dev->cpu)) || sleep_us  < 0)
 		return 0;
 
+	per_cpu(next_timer_ns, dev->cpu) = ktime_to_ns(ktime_get()) +
+						sleep_us * NSEC_PER_USEC;
+
 	idx_restrict = cpu->nlevels + 1;
 
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
@@ -740,7 +922,10 @@ static int cpu_power_select(struct cpuidle_device *dev,
 				next_wakeup_us = next_event_us - lvl_latency_us;
 		}
 
-		if (!i) {
+		if (!i && src_prediction) {
+			idx_restrict = lpm_src_predict(dev, cpu, next_wakeup_us,
+					&idx_restrict_time);
+		} else if (!i) {
 			/*
 			 * If the next_wake_us itself is not sufficient for
 			 * deeper low power modes than clock gating do not
@@ -835,7 +1020,12 @@ static uint64_t get_cluster_sleep_time(struct lpm_cluster *cluster,
 			next_cpu = cpu;
 		}
 
-		if (from_idle && lpm_prediction) {
+		if (from_idle && src_prediction) {
+			int64_t stime = per_cpu(src_hist, cpu).stime;
+
+			if (stime && (stime < prediction))
+				prediction = stime;
+		} else if (from_idle && lpm_prediction) {
 			history = &per_cpu(hist, cpu);
 			if (history->stime && (history->stime < prediction))
 				prediction = history->stime;
@@ -845,7 +1035,7 @@ static uint64_t get_cluster_sleep_time(struct lpm_cluster *cluster,
 	if (mask)
 		cpumask_copy(mask, cpumask_of(next_cpu));
 
-	if (from_idle && lpm_prediction) {
+	if (from_idle && (lpm_prediction || src_prediction)) {
 		if (prediction > ktime_to_us(ktime_get()))
 			*pred_time = prediction - ktime_to_us(ktime_get());
 	}
@@ -948,6 +1138,11 @@ static void update_cluster_history(struct cluster_history *history, int idx)
 	} else
 		return;
 
+	update_pred_stats(cluster->pred_stats, idx, cluster->nlevels, residency,
+		cluster->levels[idx].pwr.min_residency,
+		idx < cluster->nlevels - 1 ?
+		cluster->levels[idx + 1].pwr.min_residency : 0);
+
 	if (history->htmr_wkup) {
 		if (!history->hptr)
 			history->hptr = MAXSAMPLES-1;
@@ -1031,7 +1226,11 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle,
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, NULL,
 						from_idle, &cpupred_us);
 
-	if (from_idle) {
+	if (from_idle && src_prediction) {
+		/* Per-CPU source predictions already cover the cluster */
+		pred_mode = cpupred_us ? 1 : 0;
+		pred_us = cpupred_us;
+	} else if (from_idle) {
 		pred_mode = cluster_predict(cluster, &pred_us);
 
 		if (cpupred_us && pred_mode && (cpupred_us < pred_us))
@@ -1612,6 +1811,13 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 exit:
 	end_time = ktime_to_ns(ktime_get());
 	lpm_stats_cpu_exit(idx, end_time, success);
+	if (success) {
+		int64_t expiry = per_cpu(next_timer_ns, dev->cpu);
+
+		lpm_stats_cpu_residency(idx,
+			get_per_cpu_min_residency(dev->cpu)[idx],
+			end_time >= expiry ? end_time - expiry : -1);
+	}
 
 	cluster_unprepare(cluster, cpumask, idx, true, end_time);
 	cpu_unprepare(cluster, idx, true);
@@ -1619,6 +1825,12 @@ exit:
 	end_time = ktime_to_ns(ktime_get()) - start_time;
 	do_div(end_time, 1000);
 	dev->last_residency = end_time;
+	update_pred_stats(per_cpu(cpu_pred_stats, dev->cpu), idx,
+		cluster->cpu->nlevels, end_time,
+		get_per_cpu_min_residency(dev->cpu)[idx],
+		idx < cluster->cpu->nlevels - 1 ?
+		get_per_cpu_min_residency(dev->cpu)[idx + 1] : 0);
+	update_src_history(dev, cluster->cpu, idx);
 	update_history(dev, idx);
 	trace_cpu_idle_exit(idx, success);
 	local_irq_enable();
@@ -87,6 +87,13 @@ struct low_power_ops {
 	enum msm_pm_l2_scm_flag tz_flag;
 };
 
+/* Outcome of each entry into a level, compared to its residency window */
+struct lpm_pred_stats {
+	uint32_t hit;
+	uint32_t early;
+	uint32_t late;
+};
+
 struct cluster_history {
 	uint32_t resi[MAXSAMPLES];
 	int mode[MAXSAMPLES];
@@ -126,6 +133,7 @@ struct lpm_cluster {
 	bool no_saw_devices;
 	struct cluster_history history;
 	struct hrtimer histtimer;
+	struct lpm_pred_stats pred_stats[NR_LPM_LEVELS];
 };
 
 int set_l2_mode(struct low_power_ops *ops, int mode, bool notify_rpm);
@@ -148,6 +148,7 @@ struct qce_device {
 	struct dummy_request dummyreq;
 	unsigned int mode;
 	unsigned int intr_cadence;
+	const void *last_key_ctx;
 	unsigned int dev_no;
 	struct qce_driver_stats qce_stats;
 	atomic_t bunch_cmd_seq;
@@ -162,6 +163,16 @@ static int qce_dummy_req(struct qce_device *pce_dev);
 
 static int _qce50_disp_stats;
 
+/*
+ * In bunch mode, requests using the same key as the one queued before
+ * them are chained without their own completion interrupt, up to this
+ * many in a row. 0 keeps the size based interrupt cadence only.
+ */
+static unsigned int batch_max_req = SET_INTR_AT_REQ;
+module_param(batch_max_req, uint, 0644);
+MODULE_PARM_DESC(batch_max_req,
+		 "Max same-key requests completed by one interrupt");
+
 /* Standard initialization vector for SHA-1, source: FIPS 180-2 */
 static uint32_t  _std_init_vector_sha1[] =   {
 	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
@@ -3100,6 +3111,8 @@ void qce_get_driver_stats(void *handle)
 			pce_dev->qce_stats.no_of_timeouts);
 	pr_info("Engine %d dummy request inserted %d\n", pce_dev->dev_no,
 			pce_dev->qce_stats.no_of_dummy_reqs);
+	pr_info("Engine %d batched request %d\n", pce_dev->dev_no,
+			pce_dev->qce_stats.no_of_batched_reqs);
 	if (pce_dev->mode)
 		pr_info("Engine %d is in BUNCH MODE\n", pce_dev->dev_no);
 	else
@@ -3115,6 +3128,7 @@ void qce_clear_driver_stats(void *handle)
 
 	pce_dev->qce_stats.no_of_timeouts = 0;
 	pce_dev->qce_stats.no_of_dummy_reqs = 0;
+	pce_dev->qce_stats.no_of_batched_reqs = 0;
 }
 EXPORT_SYMBOL(qce_clear_driver_stats);
 
@@ -4631,6 +4645,23 @@ static int qce_dummy_req(struct qce_device *pce_dev)
 	return ret;
 }
 
+/*
+ * A request with the same key as the previous one joins its batch: it
+ * gets no interrupt of its own and completes from the interrupt of a
+ * later request, or from the bunch mode timer's dummy request. Leave
+ * room in the request ring so the batch always ends with an interrupt.
+ */
+static bool qce_batch_req(struct qce_device *pce_dev,
+		struct ce_request_info *preq_info)
+{
+	unsigned int max = min_t(unsigned int, READ_ONCE(batch_max_req),
+				 MAX_QCE_BAM_REQ - 1);
+
+	return preq_info->key_ctx &&
+		preq_info->key_ctx == pce_dev->last_key_ctx &&
+		pce_dev->intr_cadence < max;
+}
+
 static int select_mode(struct qce_device *pce_dev,
 		struct ce_request_info *preq_info)
 {
@@ -4669,6 +4700,10 @@ again:
 			_qce_set_flag(&pce_sps_data->out_transfer,
 					SPS_IOVEC_FLAG_INT);
 		}
+	} else if (qce_batch_req(pce_dev, preq_info)) {
+		pce_dev->intr_cadence++;
+		pce_dev->qce_stats.no_of_batched_reqs++;
+		atomic_inc(&pce_dev->bunch_cmd_seq);
 	} else {
 		pce_dev->intr_cadence++;
 		cadence = (preq_info->req_len >> 7) + 1;
@@ -4686,6 +4721,7 @@ again:
 			pce_dev->cadence_flag = ~pce_dev->cadence_flag;
 		}
 	}
+	pce_dev->last_key_ctx = preq_info->key_ctx;
 
 	return 0;
 }
@@ -4804,6 +4840,7 @@ static int _qce_aead_ccm_req(void *handle, struct qce_req *q_req)
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_AEAD;
 	preq_info->req_len = totallen_in;
+	preq_info->key_ctx = q_req->enckey;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 
@@ -5038,6 +5075,7 @@ int qce_aead_req(void *handle, struct qce_req *q_req)
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_AEAD;
 	preq_info->req_len = totallen;
+	preq_info->key_ctx = q_req->enckey;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 
@@ -5197,6 +5235,7 @@ int qce_ablk_cipher_req(void *handle, struct qce_req *c_req)
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_CIPHERING;
 	preq_info->req_len = areq->nbytes;
+	preq_info->key_ctx = c_req->enckey;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 	if (pce_dev->support_cmd_dscr)
@@ -5302,6 +5341,7 @@ int qce_process_sha_req(void *handle, struct qce_sha_req *sreq)
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_HASHING;
 	preq_info->req_len = sreq->size;
+	preq_info->key_ctx = NULL;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 
@@ -5426,6 +5466,7 @@ int qce_f8_req(void *handle, struct qce_f8_req *req,
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_F8;
 	preq_info->req_len = req->data_len;
+	preq_info->key_ctx = NULL;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 
@@ -5542,6 +5583,7 @@ int qce_f8_multi_pkt_req(void *handle, struct qce_f8_multi_pkt_req *mreq,
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_F8;
 	preq_info->req_len = total;
+	preq_info->key_ctx = NULL;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 
@@ -5629,6 +5671,7 @@ int qce_f9_req(void *handle, struct qce_f9_req *req, void *cookie,
 	/* setup xfer type for producer callback handling */
 	preq_info->xfer_type = QCE_XFER_F9;
 	preq_info->req_len = req->msize;
+	preq_info->key_ctx = NULL;
 
 	_qce_sps_iovec_count_init(pce_dev, req_info);
 	if (pce_dev->support_cmd_dscr)
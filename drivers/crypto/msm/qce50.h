@@ -233,11 +233,13 @@ struct ce_request_info {
 	dma_addr_t phy_ota_dst;
 	unsigned int ota_size;
 	unsigned int req_len;
+	const void *key_ctx;	/* cipher key of the request, if any */
 };
 
 struct qce_driver_stats {
 	int no_of_timeouts;
 	int no_of_dummy_reqs;
+	int no_of_batched_reqs;
 	int current_mode;
 	int outstanding_reqs;
 };
@@ -62,6 +62,11 @@
 
 #define QCRYPTO_HIGH_BANDWIDTH_TIMEOUT 1000
 
+static unsigned int sw_fallback_bytes;
+module_param(sw_fallback_bytes, uint, 0644);
+MODULE_PARM_DESC(sw_fallback_bytes,
+	"AES ECB/CBC/CTR requests smaller than this run in software, 0 disables");
+
 
 
 /* Status of response workq */
@@ -114,6 +119,7 @@ struct crypto_stat {
 	u64 ablk_cipher_3des_dec;
 	u64 ablk_cipher_op_success;
 	u64 ablk_cipher_op_fail;
+	u64 ablk_cipher_sw_fallback;
 	u64 sha1_digest;
 	u64 sha256_digest;
 	u64 sha1_hmac_digest;
@@ -421,6 +427,7 @@ struct qcrypto_cipher_ctx {
 	u8 ccm4309_nonce[QCRYPTO_CCM4309_NONCE_LEN];
 
 	struct crypto_ablkcipher *cipher_aes192_fb;
+	bool cipher_fb_keyed;	/* fallback holds the AES key of any length */
 
 	struct crypto_ahash *ahash_aead_aes192_fb;
 };
@@ -1149,6 +1156,9 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER operation fail          : %llu\n",
 					pstat->ablk_cipher_op_fail);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER SW fallback             : %llu\n",
+					pstat->ablk_cipher_sw_fallback);
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"\n");
 
@@ -1416,6 +1426,10 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 		if (!(ctx->flags & QCRYPTO_CTX_USE_PIPE_KEY))  {
 			if (key != NULL) {
 				memcpy(ctx->enc_key, key, len);
+				if (ctx->cipher_aes192_fb)
+					ctx->cipher_fb_keyed =
+						!crypto_ablkcipher_setkey(
+						ctx->cipher_aes192_fb, key, len);
 			} else {
 				pr_err("%s Inavlid key pointer\n", __func__);
 				return -EINVAL;
@@ -2470,6 +2484,24 @@ static int _qcrypto_dec_aes_192_fallback(struct ablkcipher_request *req)
 	return err;
 }
 
+/*
+ * For small requests descriptor setup and the completion interrupt cost
+ * more than the cipher itself, run them on the software (ARMv8 CE)
+ * implementation the AES-192 fallback already provides.
+ */
+static bool _qcrypto_aes_sw_fallback(struct qcrypto_cipher_ctx *ctx,
+				     unsigned int nbytes)
+{
+	unsigned int threshold = READ_ONCE(sw_fallback_bytes);
+
+	if (!threshold || nbytes >= threshold || !ctx->cipher_fb_keyed ||
+	    (ctx->flags & (QCRYPTO_CTX_USE_HW_KEY | QCRYPTO_CTX_USE_PIPE_KEY)))
+		return false;
+
+	_qcrypto_stat.ablk_cipher_sw_fallback++;
+	return true;
+}
+
 
 static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 {
@@ -2491,6 +2523,9 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_enc_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2521,6 +2556,9 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_enc_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2551,6 +2589,9 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_enc_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_enc_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2739,6 +2780,9 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_dec_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2769,6 +2813,9 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_dec_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2799,6 +2846,9 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 				ctx->cipher_aes192_fb)
 		return _qcrypto_dec_aes_192_fallback(req);
 
+	if (_qcrypto_aes_sw_fallback(ctx, req->nbytes))
+		return _qcrypto_dec_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -36,11 +36,13 @@ enum ev_index {
 	INST_IDX,
 	L2DM_IDX,
 	CYC_IDX,
+	STALL_IDX,
 	NUM_EVENTS
 };
 #define INST_EV		0x08
 #define L2DM_EV		0x17
 #define CYC_EV		0x11
+#define STALL_BACK_EV	0x24
 
 struct event_data {
 	struct perf_event *pevent;
@@ -84,6 +86,9 @@ static inline unsigned long read_event(struct event_data *event)
 	unsigned long ev_count;
 	u64 total, enabled, running;
 
+	if (!event->pevent)
+		return 0;
+
 	total = perf_event_read_value(event->pevent, &enabled, &running);
 	if (total >= event->prev_count)
 		ev_count = total - event->prev_count;
@@ -113,7 +118,11 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 	hw->core_stats[cpu_idx].mem_count =
 			read_event(&hw_data->events[L2DM_IDX]);
 
+	hw->core_stats[cpu_idx].stall_count =
+			read_event(&hw_data->events[STALL_IDX]);
+
 	cyc_cnt = read_event(&hw_data->events[CYC_IDX]);
+	hw->core_stats[cpu_idx].cyc_count = cyc_cnt;
 	hw->core_stats[cpu_idx].freq = compute_freq(hw_data, cyc_cnt);
 }
 
@@ -135,7 +144,10 @@ static void delete_events(struct memlat_hwmon_data *hw_data)
 
 	for (i = 0; i < NUM_EVENTS; i++) {
 		hw_data->events[i].prev_count = 0;
+		if (!hw_data->events[i].pevent)
+			continue;
 		perf_event_release_kernel(hw_data->events[i].pevent);
+		hw_data->events[i].pevent = NULL;
 	}
 }
 
@@ -158,6 +170,8 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 		idx = cpu - cpumask_first(&cpu_grp->cpus);
 		hw->core_stats[idx].inst_count = 0;
 		hw->core_stats[idx].mem_count = 0;
+		hw->core_stats[idx].stall_count = 0;
+		hw->core_stats[idx].cyc_count = 0;
 		hw->core_stats[idx].freq = 0;
 	}
 	put_online_cpus();
@@ -213,6 +227,19 @@ static int set_events(struct memlat_hwmon_data *hw_data, int cpu)
 	hw_data->events[CYC_IDX].pevent = pevent;
 	perf_event_enable(hw_data->events[CYC_IDX].pevent);
 
+	/*
+	 * Backend stall cycles are only a hint to the governor; not every
+	 * core implements the event, so carry on without it.
+	 */
+	attr->config = STALL_BACK_EV;
+	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
+	if (IS_ERR(pevent)) {
+		hw_data->events[STALL_IDX].pevent = NULL;
+	} else {
+		hw_data->events[STALL_IDX].pevent = pevent;
+		perf_event_enable(pevent);
+	}
+
 	kfree(attr);
 	return 0;
 
@@ -20,6 +20,8 @@
 #include <linux/stat.h>
 #include <linux/pm_opp.h>
 #include <linux/devfreq.h>
+#include <linux/devfreq_cooling.h>
+#include <linux/of.h>
 #include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/list.h>
@@ -453,6 +455,57 @@ static void devfreq_dev_release(struct device *dev)
 	_remove_devfreq(devfreq);
 }
 
+#ifdef CONFIG_DEVFREQ_THERMAL
+/*
+ * A device node with "#cooling-cells" and "dynamic-power-coefficient"
+ * (mW/MHz/mV^2) gets a devfreq cooling device with power extensions, so
+ * devices like the GPU can share a power allocator budget with the cpus.
+ */
+static void devfreq_cooling_init(struct devfreq *devfreq)
+{
+	struct device *dev = devfreq->dev.parent;
+	struct devfreq_cooling_power *power;
+	struct thermal_cooling_device *cdev;
+	u32 coeff;
+
+	if (!dev->of_node ||
+	    !of_find_property(dev->of_node, "#cooling-cells", NULL) ||
+	    of_property_read_u32(dev->of_node, "dynamic-power-coefficient",
+				 &coeff))
+		return;
+
+	power = devm_kzalloc(dev, sizeof(*power), GFP_KERNEL);
+	if (!power)
+		return;
+	power->dyn_power_coeff = coeff;
+
+	cdev = of_devfreq_cooling_register_power(dev->of_node, devfreq, power);
+	if (IS_ERR(cdev)) {
+		dev_warn(dev, "No devfreq cooling device: %ld\n",
+			 PTR_ERR(cdev));
+		devm_kfree(dev, power);
+		return;
+	}
+
+	devfreq->cdev = cdev;
+}
+
+static void devfreq_cooling_exit(struct devfreq *devfreq)
+{
+	if (devfreq->cdev)
+		devfreq_cooling_unregister(devfreq->cdev);
+	devfreq->cdev = NULL;
+}
+#else
+static inline void devfreq_cooling_init(struct devfreq *devfreq)
+{
+}
+
+static inline void devfreq_cooling_exit(struct devfreq *devfreq)
+{
+}
+#endif
+
 /**
  * devfreq_add_device() - Add devfreq feature to the device
  * @dev:	the device to add devfreq feature.
@@ -542,6 +595,8 @@ struct devfreq *devfreq_add_device(struct device *dev,
 		goto err_init;
 	}
 
+	devfreq_cooling_init(devfreq);
+
 	return devfreq;
 
 err_init:
@@ -564,6 +619,7 @@ int devfreq_remove_device(struct devfreq *devfreq)
 	if (!devfreq)
 		return -EINVAL;
 
+	devfreq_cooling_exit(devfreq);
 	device_unregister(&devfreq->dev);
 
 	return 0;
@@ -5,20 +5,24 @@
 
 #define pr_fmt(fmt) "devfreq_boost: " fmt
 
+#include <linux/debugfs.h>
 #include <linux/devfreq_boost.h>
 #include <linux/fb.h>
 #include <linux/input.h>
 #include <linux/kthread.h>
+#include <linux/seq_file.h>
 
 enum {
 	SCREEN_OFF,
 	INPUT_BOOST,
+	FRAME_BOOST,
 	MAX_BOOST
 };
 
 struct boost_dev {
 	struct devfreq *df;
 	struct delayed_work input_unboost;
+	struct delayed_work frame_unboost;
 	struct delayed_work max_unboost;
 	wait_queue_head_t boost_waitq;
 	atomic_long_t max_boost_expires;
@@ -26,18 +30,30 @@ struct boost_dev {
 	unsigned long state;
 };
 
+struct frame_boost_stats {
+	atomic_long_t frames;
+	atomic_long_t near_deadline;
+	atomic_long_t missed;
+	atomic_long_t boosts;
+};
+
 struct df_boost_drv {
 	struct boost_dev devices[DEVFREQ_MAX];
 	struct notifier_block fb_notif;
+	struct frame_boost_stats frame_stats;
 };
 
 static void devfreq_input_unboost(struct work_struct *work);
+static void devfreq_frame_unboost(struct work_struct *work);
 static void devfreq_max_unboost(struct work_struct *work);
 
 #define BOOST_DEV_INIT(b, dev, freq) .devices[dev] = {				\
 	.input_unboost =							\
 		__DELAYED_WORK_INITIALIZER((b).devices[dev].input_unboost,	\
 					   devfreq_input_unboost, 0),		\
+	.frame_unboost =							\
+		__DELAYED_WORK_INITIALIZER((b).devices[dev].frame_unboost,	\
+					   devfreq_frame_unboost, 0),		\
 	.max_unboost =								\
 		__DELAYED_WORK_INITIALIZER((b).devices[dev].max_unboost,	\
 					   devfreq_max_unboost, 0),		\
@@ -69,6 +85,49 @@ void devfreq_boost_kick(enum df_device device)
 	__devfreq_boost_kick(d->devices + device);
 }
 
+static void __devfreq_boost_kick_frame(struct boost_dev *b,
+				       unsigned int period_us)
+{
+	set_bit(FRAME_BOOST, &b->state);
+	if (!mod_delayed_work(system_unbound_wq, &b->frame_unboost,
+			      usecs_to_jiffies(period_us)))
+		wake_up(&b->boost_waitq);
+}
+
+/*
+ * Called by the display driver when a frame is done, with the time from
+ * its kickoff and the vsync period. A frame that came close to missing
+ * its vsync boosts every device for the next frame only.
+ */
+void devfreq_boost_frame(unsigned int frame_us, unsigned int period_us)
+{
+	struct df_boost_drv *d = &df_boost_drv_g;
+	struct frame_boost_stats *s = &d->frame_stats;
+	int i;
+
+	if (!period_us)
+		return;
+
+	atomic_long_inc(&s->frames);
+	if (frame_us >= period_us)
+		atomic_long_inc(&s->missed);
+
+	if ((u64)frame_us * 100 <
+	    (u64)period_us * CONFIG_DEVFREQ_FRAME_BOOST_THRESHOLD)
+		return;
+
+	atomic_long_inc(&s->near_deadline);
+	for (i = 0; i < DEVFREQ_MAX; i++) {
+		struct boost_dev *b = d->devices + i;
+
+		if (!READ_ONCE(b->df) || test_bit(SCREEN_OFF, &b->state))
+			continue;
+
+		__devfreq_boost_kick_frame(b, period_us);
+		atomic_long_inc(&s->boosts);
+	}
+}
+
 static void __devfreq_boost_kick_max(struct boost_dev *b,
 				     unsigned int duration_ms)
 {
@@ -120,6 +179,15 @@ static void devfreq_input_unboost(struct work_struct *work)
 	wake_up(&b->boost_waitq);
 }
 
+static void devfreq_frame_unboost(struct work_struct *work)
+{
+	struct boost_dev *b = container_of(to_delayed_work(work),
+					   typeof(*b), frame_unboost);
+
+	clear_bit(FRAME_BOOST, &b->state);
+	wake_up(&b->boost_waitq);
+}
+
 static void devfreq_max_unboost(struct work_struct *work)
 {
 	struct boost_dev *b = container_of(to_delayed_work(work),
@@ -138,7 +206,8 @@ static void devfreq_update_boosts(struct boost_dev *b, unsigned long state)
 		df->min_freq = df->profile->freq_table[0];
 		df->max_boost = false;
 	} else {
-		df->min_freq = test_bit(INPUT_BOOST, &state) ?
+		df->min_freq = (test_bit(INPUT_BOOST, &state) ||
+				test_bit(FRAME_BOOST, &state)) ?
 			       min(b->boost_freq, df->max_freq) :
 			       df->profile->freq_table[0];
 		df->max_boost = test_bit(MAX_BOOST, &state);
@@ -286,6 +355,30 @@ static struct input_handler devfreq_boost_input_handler = {
 	.id_table	= devfreq_boost_ids
 };
 
+static int frame_stats_show(struct seq_file *m, void *unused)
+{
+	struct frame_boost_stats *s = m->private;
+
+	seq_printf(m, "frames: %ld\n", atomic_long_read(&s->frames));
+	seq_printf(m, "near_deadline: %ld\n",
+		   atomic_long_read(&s->near_deadline));
+	seq_printf(m, "missed: %ld\n", atomic_long_read(&s->missed));
+	seq_printf(m, "boosts: %ld\n", atomic_long_read(&s->boosts));
+	return 0;
+}
+
+static int frame_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, frame_stats_show, inode->i_private);
+}
+
+static const struct file_operations frame_stats_fops = {
+	.open		= frame_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init devfreq_boost_init(void)
 {
 	struct df_boost_drv *d = &df_boost_drv_g;
@@ -319,6 +412,9 @@ static int __init devfreq_boost_init(void)
 		goto unregister_handler;
 	}
 
+	debugfs_create_file("devfreq_boost_frame_stats", 0444, NULL,
+			    &d->frame_stats, &frame_stats_fops);
+
 	return 0;
 
 unregister_handler:
@@ -26,6 +26,8 @@
 #include <linux/mutex.h>
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
@@ -34,6 +36,34 @@
 #include "governor_bw_hwmon.h"
 
 #define NUM_MBPS_ZONES		10
+/*
+ * Predictor for frame periodic traffic (display, camera). It times the
+ * start of each burst, and once enough bursts in a row came a steady
+ * period apart, it votes for the last burst's peak a little before the
+ * next one is due. A pre-vote that doesn't see a burst in time drops the
+ * confidence and the governor goes back to reacting to the monitor.
+ */
+struct bw_pred {
+	struct hrtimer timer;
+	struct work_struct work;
+	ktime_t last_start;
+	ktime_t vote_ts;
+	ktime_t vote_until;
+	unsigned long idle_mbps;
+	unsigned long burst_mbps;
+	unsigned long peak_mbps;
+	unsigned int period_us;
+	unsigned int conf;
+	bool in_burst;
+	bool pre_voted;
+
+	unsigned long bursts;
+	unsigned long prevotes;
+	unsigned long hits;
+	unsigned long misses;
+	u64 lead_us_sum;
+};
+
 struct hwmon_node {
 	unsigned int guard_band_mbps;
 	unsigned int decay_rate;
@@ -49,6 +79,10 @@ struct hwmon_node {
 	unsigned int hyst_length;
 	unsigned int idle_mbps;
 	unsigned int mbps_zones[NUM_MBPS_ZONES];
+	unsigned int pred_conf;
+	unsigned int pred_tol;
+	unsigned int pred_lead_us;
+	struct bw_pred pred;
 
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
@@ -56,6 +90,7 @@ struct hwmon_node {
 	unsigned long resume_ab;
 	unsigned long bytes;
 	unsigned long max_mbps;
+	unsigned long last_mbps;
 	unsigned long hist_max_mbps;
 	unsigned long hist_mem;
 	unsigned long hyst_peak;
@@ -208,6 +243,7 @@ static int __bw_hwmon_sw_sample_end(struct bw_hwmon *hwmon)
 
 	mbps = bytes_to_mbps(bytes, us);
 	node->max_mbps = max(node->max_mbps, mbps);
+	node->last_mbps = mbps;
 
 	/*
 	 * If the measured bandwidth in a micro sample is greater than the
@@ -256,6 +292,7 @@ static int __bw_hwmon_hw_sample_end(struct bw_hwmon *hwmon)
 	bytes = hwmon->get_bytes_and_clear(hwmon);
 	mbps = bytes_to_mbps(bytes, node->sample_ms * USEC_PER_MSEC);
 	node->max_mbps = mbps;
+	node->last_mbps = mbps;
 
 	if (mbps > node->hw->up_wake_mbps)
 		wake = UP_WAKE;
@@ -306,6 +343,133 @@ unsigned long to_mbps_zone(struct hwmon_node *node, unsigned long mbps)
 
 #define MIN_MBPS	500UL
 #define HIST_PEAK_TOL	60
+
+#define PRED_MIN_US	4000U
+#define PRED_MAX_US	100000U
+#define PRED_CONF_MAX	32U
+
+/*
+ * Called with irq_lock held at the end of each decision window. Returns
+ * the bandwidth the predictor wants voted in this window, 0 if none.
+ */
+static unsigned long bw_pred_sample(struct hwmon_node *node,
+				    unsigned long meas_mbps)
+{
+	struct bw_pred *p = &node->pred;
+	unsigned int tol, delay_us;
+	ktime_t now;
+	s64 interval;
+
+	if (!node->pred_conf)
+		return 0;
+
+	now = ktime_get();
+
+	if (p->pre_voted && ktime_after(now, p->vote_until)) {
+		p->misses++;
+		p->pre_voted = false;
+		p->conf = 0;
+	}
+
+	if (p->in_burst) {
+		p->burst_mbps = max(p->burst_mbps, meas_mbps);
+		if (meas_mbps < (p->burst_mbps * HIST_PEAK_TOL) / 100) {
+			p->in_burst = false;
+			p->peak_mbps = p->burst_mbps;
+		}
+	} else if (meas_mbps > MIN_MBPS && meas_mbps > 2 * p->idle_mbps) {
+		/* Start of a burst */
+		p->bursts++;
+		if (p->pre_voted) {
+			p->hits++;
+			p->lead_us_sum += ktime_us_delta(now, p->vote_ts);
+			p->pre_voted = false;
+		}
+
+		interval = ktime_us_delta(now, p->last_start);
+		tol = (p->period_us * node->pred_tol) / 100;
+		if (interval < PRED_MIN_US || interval > PRED_MAX_US) {
+			p->period_us = 0;
+			p->conf = 0;
+		} else if (p->period_us && interval + tol >= p->period_us &&
+			   interval <= p->period_us + tol) {
+			p->period_us = (3 * p->period_us + interval) / 4;
+			p->conf = min(p->conf + 1, PRED_CONF_MAX);
+		} else {
+			p->period_us = interval;
+			p->conf = 0;
+		}
+
+		p->last_start = now;
+		p->in_burst = true;
+		p->burst_mbps = meas_mbps;
+
+		if (p->conf >= node->pred_conf && p->peak_mbps) {
+			delay_us = p->period_us - min(node->pred_lead_us,
+						      p->period_us / 2);
+			hrtimer_start(&p->timer, ns_to_ktime(delay_us *
+						NSEC_PER_USEC),
+				      HRTIMER_MODE_REL);
+		}
+	} else {
+		p->idle_mbps = (3 * p->idle_mbps + meas_mbps) / 4;
+	}
+
+	return p->pre_voted ? p->peak_mbps : 0;
+}
+
+static enum hrtimer_restart bw_pred_timer_fn(struct hrtimer *timer)
+{
+	struct bw_pred *p = container_of(timer, struct bw_pred, timer);
+
+	queue_work(system_highpri_wq, &p->work);
+
+	return HRTIMER_NORESTART;
+}
+
+static void bw_pred_work_fn(struct work_struct *work)
+{
+	struct bw_pred *p = container_of(work, struct bw_pred, work);
+	struct hwmon_node *node = container_of(p, struct hwmon_node, pred);
+	unsigned long flags;
+	unsigned int window_us;
+	bool vote = false;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	if (node->mon_started && node->pred_conf &&
+	    p->conf >= node->pred_conf && !p->in_burst) {
+		window_us = node->pred_lead_us +
+			    (p->period_us * node->pred_tol) / 100;
+		p->vote_ts = ktime_get();
+		p->vote_until = ktime_add_us(p->vote_ts, window_us);
+		p->pre_voted = true;
+		p->prevotes++;
+		vote = true;
+	}
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	if (!vote)
+		return;
+
+	mutex_lock(&sync_lock);
+	update_bw_hwmon(node->hw);
+	mutex_unlock(&sync_lock);
+}
+
+static void bw_pred_reset(struct hwmon_node *node)
+{
+	struct bw_pred *p = &node->pred;
+
+	p->last_start = ktime_set(0, 0);
+	p->idle_mbps = 0;
+	p->burst_mbps = 0;
+	p->peak_mbps = 0;
+	p->period_us = 0;
+	p->conf = 0;
+	p->in_burst = false;
+	p->pre_voted = false;
+}
+
 static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 					unsigned long *freq, unsigned long *ab)
 {
@@ -417,6 +581,8 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 			req_mbps = max(req_mbps, node->hyst_mbps);
 	}
 
+	req_mbps = max(req_mbps, bw_pred_sample(node, meas_mbps));
+
 	/* Stretch the short sample window size, if the traffic is too low */
 	if (meas_mbps < MIN_MBPS) {
 		hw->up_wake_mbps = (max(MIN_MBPS, req_mbps)
@@ -496,6 +662,31 @@ static struct hwmon_node *find_hwmon_node(struct devfreq *df)
 	return found;
 }
 
+/*
+ * Latest bandwidth measured by the monitor of the device at of_node, for
+ * governors such as mem_latency that want to know whether a workload is
+ * bandwidth bound. Returns 0 if no such monitor is active.
+ */
+unsigned long bw_hwmon_get_meas_mbps(struct device_node *of_node)
+{
+	struct hwmon_node *node;
+	unsigned long flags, mbps = 0;
+
+	mutex_lock(&list_lock);
+	list_for_each_entry(node, &hwmon_list, list) {
+		if (node->hw->of_node != of_node)
+			continue;
+		spin_lock_irqsave(&irq_lock, flags);
+		if (node->mon_started)
+			mbps = node->last_mbps;
+		spin_unlock_irqrestore(&irq_lock, flags);
+		break;
+	}
+	mutex_unlock(&list_lock);
+
+	return mbps;
+}
+
 int update_bw_hwmon(struct bw_hwmon *hwmon)
 {
 	struct devfreq *df;
@@ -539,6 +730,8 @@ static int start_monitor(struct devfreq *df, bool init)
 
 	node->prev_ts = ktime_get();
 
+	bw_pred_reset(node);
+
 	if (init) {
 		node->prev_ab = 0;
 		node->resume_freq = 0;
@@ -574,6 +767,9 @@ static void stop_monitor(struct devfreq *df, bool init)
 
 	node->mon_started = false;
 
+	hrtimer_cancel(&node->pred.timer);
+	cancel_work_sync(&node->pred.work);
+
 	if (init) {
 		devfreq_monitor_stop(df);
 		hw->stop_hwmon(hw);
@@ -758,6 +954,37 @@ static ssize_t show_throttle_adj(struct device *dev,
 static DEVICE_ATTR(throttle_adj, 0644, show_throttle_adj,
 						store_throttle_adj);
 
+static ssize_t show_pred_stats(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	struct bw_pred *p = &node->pred;
+	unsigned long flags, bursts, prevotes, hits, misses;
+	unsigned int period_us, conf;
+	u64 lead_us = 0;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	bursts = p->bursts;
+	prevotes = p->prevotes;
+	hits = p->hits;
+	misses = p->misses;
+	period_us = p->period_us;
+	conf = p->conf;
+	if (hits)
+		lead_us = div64_u64(p->lead_us_sum, hits);
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	return snprintf(buf, PAGE_SIZE,
+			"period_us: %u\nconfidence: %u\nbursts: %lu\n"
+			"prevotes: %lu\nhits: %lu\nmisses: %lu\n"
+			"avg_lead_us: %llu\n",
+			period_us, conf, bursts, prevotes, hits, misses,
+			lead_us);
+}
+
+static DEVICE_ATTR(pred_stats, 0444, show_pred_stats, NULL);
+
 gov_attr(guard_band_mbps, 0U, 2000U);
 gov_attr(decay_rate, 0U, 100U);
 gov_attr(io_percent, 1U, 100U);
@@ -772,6 +999,9 @@ gov_attr(hyst_trigger_count, 0U, 90U);
 gov_attr(hyst_length, 0U, 90U);
 gov_attr(idle_mbps, 0U, 2000U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
+gov_attr(pred_conf, 0U, PRED_CONF_MAX);
+gov_attr(pred_tol, 1U, 50U);
+gov_attr(pred_lead_us, 0U, 20000U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_guard_band_mbps.attr,
@@ -789,6 +1019,10 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_idle_mbps.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
+	&dev_attr_pred_conf.attr,
+	&dev_attr_pred_tol.attr,
+	&dev_attr_pred_lead_us.attr,
+	&dev_attr_pred_stats.attr,
 	NULL,
 };
 
@@ -930,6 +1164,12 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->hyst_length = 0;
 	node->idle_mbps = 400;
 	node->mbps_zones[0] = 0;
+	node->pred_conf = 0;
+	node->pred_tol = 15;
+	node->pred_lead_us = 2000;
+	hrtimer_init(&node->pred.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	node->pred.timer.function = bw_pred_timer_fn;
+	INIT_WORK(&node->pred.work, bw_pred_work_fn);
 	node->hw = hwmon;
 
 	mutex_lock(&list_lock);
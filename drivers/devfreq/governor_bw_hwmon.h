@@ -69,6 +69,7 @@ struct bw_hwmon {
 int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon);
 int update_bw_hwmon(struct bw_hwmon *hwmon);
 int bw_hwmon_sample_end(struct bw_hwmon *hwmon);
+unsigned long bw_hwmon_get_meas_mbps(struct device_node *of_node);
 #else
 static inline int register_bw_hwmon(struct device *dev,
 					struct bw_hwmon *hwmon)
@@ -83,6 +84,10 @@ static inline int bw_hwmon_sample_end(struct bw_hwmon *hwmon)
 {
 	return 0;
 }
+static inline unsigned long bw_hwmon_get_meas_mbps(struct device_node *of_node)
+{
+	return 0;
+}
 #endif
 
 #endif /* _GOVERNOR_BW_HWMON_H */
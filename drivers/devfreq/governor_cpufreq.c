@@ -21,6 +21,7 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/module.h>
+#include <linux/jiffies.h>
 #include "governor.h"
 
 struct cpu_state {
@@ -29,10 +30,21 @@ struct cpu_state {
 	unsigned int max_freq;
 	bool on;
 	unsigned int first_cpu;
+	/* busy % of the busiest CPU in the cluster over the last window */
+	unsigned int util;
 };
 static struct cpu_state *state[NR_CPUS];
 static int cpufreq_cnt;
 
+struct cpu_load {
+	u64 prev_wall;
+	u64 prev_idle;
+};
+static DEFINE_PER_CPU(struct cpu_load, cpu_load);
+
+/* Shorter windows make the busy % too noisy to weight votes with */
+#define UTIL_WINDOW_US	10000
+
 struct freq_map {
 	unsigned int cpu_khz;
 	unsigned int target_freq;
@@ -50,6 +62,16 @@ struct devfreq_node {
 	struct delayed_work dwork;
 	bool drop;
 	unsigned long prev_tgt;
+	unsigned int interpolate;
+	unsigned int util_weight;
+	unsigned int rate_limit_ms;
+	unsigned long last_update;
+	struct delayed_work rate_work;
+	/* last mapped vote of each cluster, indexed by its first CPU */
+	unsigned int cluster_tgt[NR_CPUS];
+	unsigned long evals;
+	unsigned long cache_hits;
+	unsigned long deferred;
 };
 static LIST_HEAD(devfreq_list);
 static DEFINE_MUTEX(state_lock);
@@ -105,6 +127,8 @@ static int update_node(struct devfreq_node *node)
 		goto out;
 	}
 
+	node->last_update = jiffies;
+
 	if (!node->timeout)
 		goto out;
 
@@ -139,6 +163,18 @@ static void do_timeout(struct work_struct *work)
 	mutex_unlock(&df->lock);
 }
 
+static void do_rate_limit(struct work_struct *work)
+{
+	struct devfreq_node *node = container_of(to_delayed_work(work),
+						struct devfreq_node, rate_work);
+
+	mutex_lock(&state_lock);
+	update_node(node);
+	mutex_unlock(&state_lock);
+}
+
+static unsigned int cpu_to_dev_freq(struct devfreq *df, unsigned int cpu);
+
 static struct devfreq_node *find_devfreq_node(struct device *dev)
 {
 	struct devfreq_node *node;
@@ -170,6 +206,7 @@ static void add_policy(struct cpufreq_policy *policy)
 		new_state->min_freq = policy->cpuinfo.min_freq;
 		new_state->max_freq = policy->cpuinfo.max_freq;
 		new_state->on = true;
+		new_state->util = 100;
 
 		for_each_cpu(cpu, policy->related_cpus)
 			state[cpu] = new_state;
@@ -206,6 +243,81 @@ static struct notifier_block cpufreq_policy_nb = {
 	.notifier_call = cpufreq_policy_notifier
 };
 
+static bool util_weight_used(void)
+{
+	struct devfreq_node *node;
+
+	list_for_each_entry(node, &devfreq_list, list)
+		if (node->df && node->util_weight)
+			return true;
+	return false;
+}
+
+static void update_cluster_util(struct cpu_state *s)
+{
+	struct cpu_load *load;
+	unsigned int cpu, busy, util = 0;
+	u64 wall, idle;
+	bool valid = false;
+
+	for_each_online_cpu(cpu) {
+		if (state[cpu] != s)
+			continue;
+
+		load = &per_cpu(cpu_load, cpu);
+		idle = get_cpu_idle_time(cpu, &wall, 0);
+		if (wall - load->prev_wall < UTIL_WINDOW_US)
+			return;
+
+		busy = 0;
+		if (wall - load->prev_wall > idle - load->prev_idle)
+			busy = div64_u64(100 * (wall - load->prev_wall -
+						(idle - load->prev_idle)),
+					 wall - load->prev_wall);
+		load->prev_wall = wall;
+		load->prev_idle = idle;
+		util = max(util, busy);
+		valid = true;
+	}
+
+	if (valid)
+		s->util = util;
+}
+
+/*
+ * Re-map only the cluster that changed. If its vote is what this node
+ * last saw, the aggregate vote cannot have changed either and the bus
+ * is left alone. Nodes with a timeout still get every transition, since
+ * a transition is what restores their vote after a drop.
+ */
+static void cluster_changed(struct devfreq_node *node, struct cpu_state *s)
+{
+	unsigned int cpu = s->first_cpu, tgt;
+	unsigned long next;
+
+	if (!node->df)
+		return;
+
+	tgt = cpu_to_dev_freq(node->df, cpu);
+	node->evals++;
+	if (tgt == node->cluster_tgt[cpu] && !node->timeout) {
+		node->cache_hits++;
+		return;
+	}
+	node->cluster_tgt[cpu] = tgt;
+
+	next = node->last_update + msecs_to_jiffies(node->rate_limit_ms);
+	if (node->rate_limit_ms && time_before(jiffies, next)) {
+		if (!delayed_work_pending(&node->rate_work))
+			schedule_delayed_work(&node->rate_work,
+					      next - jiffies);
+		node->deferred++;
+		return;
+	}
+
+	update_node(node);
+}
+
 static int cpufreq_trans_notifier(struct notifier_block *nb,
 		unsigned long event, void *data)
 {
@@ -222,8 +334,13 @@ static int cpufreq_trans_notifier(struct notifier_block *nb,
 		goto out;
 
 	if (s->freq != freq->new) {
+		struct devfreq_node *node;
+
 		s->freq = freq->new;
-		update_all_devfreqs();
+		if (util_weight_used())
+			update_cluster_util(s);
+		list_for_each_entry(node, &devfreq_list, list)
+			cluster_changed(node, s);
 	}
 
 out:
@@ -307,12 +424,12 @@ out:
 
 /* ==================== devfreq part ==================== */
 
-static unsigned int interpolate_freq(struct devfreq *df, unsigned int cpu)
+static unsigned int interpolate_freq(struct devfreq *df, unsigned int cpu,
+				     unsigned int cpu_freq)
 {
 	unsigned int *freq_table = df->profile->freq_table;
 	unsigned int cpu_min = state[cpu]->min_freq;
 	unsigned int cpu_max = state[cpu]->max_freq;
-	unsigned int cpu_freq = state[cpu]->freq;
 	unsigned int dev_min, dev_max, cpu_percent;
 
 	if (freq_table) {
@@ -331,7 +448,7 @@ static unsigned int interpolate_freq(struct devfreq *df, unsigned int cpu)
 
 static unsigned int cpu_to_dev_freq(struct devfreq *df, unsigned int cpu)
 {
-	struct freq_map *map = NULL;
+	struct freq_map *map = NULL, *first;
 	unsigned int cpu_khz = 0, freq;
 	struct devfreq_node *n = df->data;
 
@@ -347,17 +464,37 @@ static unsigned int cpu_to_dev_freq(struct devfreq *df, unsigned int cpu)
 
 	cpu_khz = state[cpu]->freq;
 
+	/*
+	 * A cluster running fast but mostly idle, e.g. after a schedutil
+	 * spike, needs less bandwidth than its clock suggests.
+	 */
+	if (n->util_weight)
+		cpu_khz = max(mult_frac(cpu_khz, state[cpu]->util, 100),
+			      state[cpu]->min_freq);
+
 	if (!map) {
-		freq = interpolate_freq(df, cpu);
+		freq = interpolate_freq(df, cpu, cpu_khz);
 		goto out;
 	}
 
+	first = map;
 	while (map->cpu_khz && map->cpu_khz < cpu_khz)
 		map++;
 	if (!map->cpu_khz)
 		map--;
 	freq = map->target_freq;
 
+	/* between two rows, scale linearly instead of rounding up */
+	if (n->interpolate && map != first && map->cpu_khz > cpu_khz) {
+		struct freq_map *prev = map - 1;
+
+		if (map->target_freq > prev->target_freq)
+			freq = prev->target_freq +
+				mult_frac(map->target_freq - prev->target_freq,
+					  cpu_khz - prev->cpu_khz,
+					  map->cpu_khz - prev->cpu_khz);
+	}
+
 out:
 	dev_dbg(df->dev.parent, "CPU%u: %d -> dev: %u\n", cpu, cpu_khz, freq);
 	return freq;
@@ -381,8 +518,10 @@ static int devfreq_cpufreq_get_freq(struct devfreq *df,
 		return 0;
 	}
 
-	for_each_possible_cpu(cpu)
-		tgt_freq = max(tgt_freq, cpu_to_dev_freq(df, cpu));
+	for_each_possible_cpu(cpu) {
+		node->cluster_tgt[cpu] = cpu_to_dev_freq(df, cpu);
+		tgt_freq = max(tgt_freq, node->cluster_tgt[cpu]);
+	}
 
 	if (node->timeout && tgt_freq < node->prev_tgt)
 		*freq = 0;
@@ -448,12 +587,31 @@ static ssize_t show_map(struct device *dev, struct device_attribute *attr,
 	return cnt;
 }
 
+static ssize_t show_eval_stats(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct devfreq_node *n = df->data;
+
+	return snprintf(buf, PAGE_SIZE, "evals: %lu\ncache_hits: %lu\n"
+			"deferred: %lu\n", n->evals, n->cache_hits,
+			n->deferred);
+}
+
 static DEVICE_ATTR(freq_map, 0444, show_map, NULL);
+static DEVICE_ATTR(eval_stats, 0444, show_eval_stats, NULL);
 gov_attr(timeout, 0U, 100U);
+gov_attr(interpolate, 0U, 1U);
+gov_attr(util_weight, 0U, 1U);
+gov_attr(rate_limit_ms, 0U, 100U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_freq_map.attr,
 	&dev_attr_timeout.attr,
+	&dev_attr_interpolate.attr,
+	&dev_attr_util_weight.attr,
+	&dev_attr_rate_limit_ms.attr,
+	&dev_attr_eval_stats.attr,
 	NULL,
 };
 
@@ -494,6 +652,7 @@ static int devfreq_cpufreq_gov_start(struct devfreq *devfreq)
 	}
 
 	INIT_DELAYED_WORK(&node->dwork, do_timeout);
+	INIT_DELAYED_WORK(&node->rate_work, do_rate_limit);
 
 	node->df = devfreq;
 	node->orig_data = devfreq->data;
@@ -523,6 +682,7 @@ static void devfreq_cpufreq_gov_stop(struct devfreq *devfreq)
 {
 	struct devfreq_node *node = devfreq->data;
 
+	cancel_delayed_work_sync(&node->rate_work);
 	cancel_delayed_work_sync(&node->dwork);
 
 	mutex_lock(&state_lock);
@@ -30,11 +30,44 @@
 #include <linux/devfreq.h>
 #include "governor.h"
 #include "governor_memlat.h"
+#include "governor_bw_hwmon.h"
 
 #include <trace/events/power.h>
 
+/*
+ * Why each sample ended up with the vote it did:
+ * @lat_bound:		a core was memory latency bound
+ * @stall_skip:		a core passed ratio_ceil but stalled less than
+ *			stall_floor, so it was not counted
+ * @bw_bound:		a core was latency bound but the bandwidth monitor
+ *			was above bw_ceil_mbps, so the vote was left to it
+ * @burst:		misses jumped above burst_pct of their average and
+ *			the vote went straight to the target
+ * @ramp_up:		the vote went up
+ * @decay:		the vote went down
+ * @idle:		the vote was 0
+ */
+struct memlat_stats {
+	unsigned long lat_bound;
+	unsigned long stall_skip;
+	unsigned long bw_bound;
+	unsigned long burst;
+	unsigned long ramp_up;
+	unsigned long decay;
+	unsigned long idle;
+};
+
 struct memlat_node {
 	unsigned int ratio_ceil;
+	unsigned int stall_floor;
+	unsigned int bw_ceil_mbps;
+	unsigned int burst_pct;
+	unsigned int up_rate;
+	unsigned int decay_rate;
+	struct device_node *bwmon_of_node;
+	unsigned long mem_avg;
+	unsigned long prev_vote;
+	struct memlat_stats stats;
 	bool mon_started;
 	struct list_head list;
 	void *orig_data;
@@ -105,6 +138,22 @@ static ssize_t show_map(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR(freq_map, 0444, show_map, NULL);
 
+static ssize_t show_decision_stats(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	struct memlat_stats *s = &n->stats;
+
+	return snprintf(buf, PAGE_SIZE,
+			"lat_bound: %lu\nstall_skip: %lu\nbw_bound: %lu\n"
+			"burst: %lu\nramp_up: %lu\ndecay: %lu\nidle: %lu\n",
+			s->lat_bound, s->stall_skip, s->bw_bound, s->burst,
+			s->ramp_up, s->decay, s->idle);
+}
+
+static DEVICE_ATTR(decision_stats, 0444, show_decision_stats, NULL);
+
 static unsigned long core_to_dev_freq(struct memlat_node *node,
 		unsigned long coref)
 {
@@ -192,6 +241,10 @@ static int gov_start(struct devfreq *df)
 	node->orig_data = df->data;
 	df->data = node;
 
+	node->mem_avg = 0;
+	node->prev_vote = 0;
+	memset(&node->stats, 0, sizeof(node->stats));
+
 	ret = start_monitor(df);
 	if (ret)
 		goto err_start;
@@ -257,6 +310,54 @@ static void gov_stop(struct devfreq *df)
 	hw->df = NULL;
 }
 
+#define MEM_AVG_SHIFT	3
+
+/*
+ * Move the vote from the previous sample towards target. A sudden rise in
+ * misses over their long term average means a burst has started, and the
+ * vote goes straight to target; otherwise up_rate and decay_rate limit how
+ * much of the gap is covered in one sample.
+ */
+static unsigned long memlat_ramp(struct devfreq *df, unsigned long target,
+				 unsigned long total_mem, unsigned long mbps,
+				 bool bw_bound)
+{
+	struct memlat_node *node = df->data;
+	unsigned long prev = node->prev_vote, vote, step;
+	bool burst;
+
+	burst = node->mem_avg && (u64)total_mem * 100 >
+			(u64)node->mem_avg * node->burst_pct;
+	if (node->mem_avg)
+		node->mem_avg += (total_mem >> MEM_AVG_SHIFT) -
+				 (node->mem_avg >> MEM_AVG_SHIFT);
+	else
+		node->mem_avg = total_mem;
+
+	vote = target;
+	if (target > prev) {
+		step = (target - prev) * node->up_rate / 100;
+		if (burst)
+			node->stats.burst++;
+		else if (step)
+			vote = prev + step;
+		node->stats.ramp_up++;
+	} else if (target < prev) {
+		step = (prev - target) * node->decay_rate / 100;
+		if (step)
+			vote = prev - step;
+		node->stats.decay++;
+	}
+
+	if (!vote)
+		node->stats.idle++;
+	node->prev_vote = vote;
+
+	trace_memlat_dev_decision(dev_name(df->dev.parent), target, vote,
+				  mbps, burst, bw_bound);
+	return vote;
+}
+
 static int devfreq_memlat_get_freq(struct devfreq *df,
 					unsigned long *freq,
 					u32 *flag)
@@ -264,8 +365,9 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 	int i, lat_dev;
 	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
-	unsigned long max_freq = 0;
-	unsigned int ratio;
+	unsigned long max_freq = 0, total_mem = 0, mbps = 0;
+	unsigned int ratio, stall_pct;
+	bool bw_bound = false;
 
 	/*
 	 * node->resume_freq is set to 0 at the end of resume (after the update)
@@ -281,6 +383,11 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 
 	hw->get_cnt(hw);
 
+	if (node->bw_ceil_mbps && node->bwmon_of_node) {
+		mbps = bw_hwmon_get_meas_mbps(node->bwmon_of_node);
+		bw_bound = mbps >= node->bw_ceil_mbps;
+	}
+
 	for (i = 0; i < hw->num_cores; i++) {
 		ratio = hw->core_stats[i].inst_count;
 
@@ -293,14 +400,44 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					hw->core_stats[i].mem_count,
 					hw->core_stats[i].freq, ratio);
 
-		if (ratio && ratio <= node->ratio_ceil
-		    && hw->core_stats[i].freq > max_freq) {
+		total_mem += hw->core_stats[i].mem_count;
+
+		if (!ratio || ratio > node->ratio_ceil)
+			continue;
+
+		/*
+		 * Misses that the core doesn't stall on (prefetched streams,
+		 * say) don't need a faster memory. Cores that can't count
+		 * backend stalls report 0 and are let through.
+		 */
+		if (node->stall_floor && hw->core_stats[i].stall_count &&
+		    hw->core_stats[i].cyc_count) {
+			stall_pct = mult_frac(hw->core_stats[i].stall_count,
+					      100, hw->core_stats[i].cyc_count);
+			if (stall_pct < node->stall_floor) {
+				node->stats.stall_skip++;
+				continue;
+			}
+		}
+
+		if (hw->core_stats[i].freq > max_freq) {
 			lat_dev = i;
 			max_freq = hw->core_stats[i].freq;
 		}
 	}
 
+	/*
+	 * When the bandwidth monitor says the bus is already busy, the misses
+	 * are down to bandwidth rather than latency, and the bw_hwmon vote
+	 * covers them.
+	 */
+	if (max_freq && bw_bound) {
+		node->stats.bw_bound++;
+		max_freq = 0;
+	}
+
 	if (max_freq) {
+		node->stats.lat_bound++;
 		max_freq = core_to_dev_freq(node, max_freq);
 		trace_memlat_dev_update(dev_name(df->dev.parent),
 					hw->core_stats[lat_dev].id,
@@ -310,15 +447,26 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					max_freq);
 	}
 
-	*freq = max_freq;
+	*freq = memlat_ramp(df, max_freq, total_mem, mbps, bw_bound);
 	return 0;
 }
 
 gov_attr(ratio_ceil, 1U, 20000U);
+gov_attr(stall_floor, 0U, 100U);
+gov_attr(bw_ceil_mbps, 0U, UINT_MAX);
+gov_attr(burst_pct, 100U, 1000U);
+gov_attr(up_rate, 1U, 100U);
+gov_attr(decay_rate, 1U, 100U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
+	&dev_attr_stall_floor.attr,
+	&dev_attr_bw_ceil_mbps.attr,
+	&dev_attr_burst_pct.attr,
+	&dev_attr_up_rate.attr,
+	&dev_attr_decay_rate.attr,
 	&dev_attr_freq_map.attr,
+	&dev_attr_decision_stats.attr,
 	NULL,
 };
 
@@ -455,6 +603,16 @@ int register_memlat(struct device *dev, struct memlat_hwmon *hw)
 	node->attr_grp = &dev_attr_group;
 
 	node->ratio_ceil = 10;
+	node->burst_pct = 200;
+	node->up_rate = 100;
+	node->decay_rate = 100;
+	of_property_read_u32(dev->of_node, "qcom,stall-floor",
+			     &node->stall_floor);
+	node->bwmon_of_node = of_parse_phandle(dev->of_node,
+					       "qcom,bwmon-dev", 0);
+	if (node->bwmon_of_node)
+		of_property_read_u32(dev->of_node, "qcom,bw-ceil-mbps",
+				     &node->bw_ceil_mbps);
 	node->hw = hw;
 
 	hw->freq_map = init_core_dev_map(dev, "qcom,core-dev-table");
@@ -11,8 +11,8 @@
  * GNU General Public License for more details.
  */
 
-#ifndef _GOVERNOR_BW_HWMON_H
-#define _GOVERNOR_BW_HWMON_H
+#ifndef _GOVERNOR_MEMLAT_H
+#define _GOVERNOR_MEMLAT_H
 
 #include <linux/kernel.h>
 #include <linux/devfreq.h>
@@ -21,6 +21,9 @@
  * struct dev_stats - Device stats
  * @inst_count:			Number of instructions executed.
  * @mem_count:			Number of memory accesses made.
+ * @stall_count:		Number of cycles the core's backend was stalled,
+ *				0 if the core can't count them.
+ * @cyc_count:			Number of cycles the core was running.
  * @freq:			Effective frequency of the device in the
  *				last interval.
  */
@@ -28,6 +31,8 @@ struct dev_stats {
 	int id;
 	unsigned long inst_count;
 	unsigned long mem_count;
+	unsigned long stall_count;
+	unsigned long cyc_count;
 	unsigned long freq;
 };
 
@@ -86,4 +91,4 @@ static inline int update_memlat(struct memlat_hwmon *hw)
 }
 #endif
 
-#endif /* _GOVERNOR_BW_HWMON_H */
+#endif /* _GOVERNOR_MEMLAT_H */
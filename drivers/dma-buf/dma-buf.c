@@ -33,6 +33,9 @@
 #include <linux/seq_file.h>
 #include <linux/poll.h>
 #include <linux/reservation.h>
+#include <linux/uaccess.h>
+
+#include <uapi/linux/dma-buf.h>
 
 static inline int is_dma_buf_file(struct file *);
 
@@ -251,11 +254,76 @@ out:
 	return events;
 }
 
+static long dma_buf_sync(struct dma_buf *dmabuf, u64 flags, u64 offset,
+			 u64 len)
+{
+	enum dma_data_direction direction;
+
+	if (flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
+		return -EINVAL;
+
+	if (!len || offset > dmabuf->size || len > dmabuf->size - offset)
+		return -EINVAL;
+
+	switch (flags & DMA_BUF_SYNC_RW) {
+	case DMA_BUF_SYNC_READ:
+		direction = DMA_FROM_DEVICE;
+		break;
+	case DMA_BUF_SYNC_WRITE:
+		direction = DMA_TO_DEVICE;
+		break;
+	case DMA_BUF_SYNC_RW:
+		direction = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (flags & DMA_BUF_SYNC_END)
+		dma_buf_end_cpu_access(dmabuf, offset, len, direction);
+	else
+		return dma_buf_begin_cpu_access(dmabuf, offset, len,
+						direction);
+
+	return 0;
+}
+
+static long dma_buf_ioctl(struct file *file,
+			  unsigned int cmd, unsigned long arg)
+{
+	struct dma_buf *dmabuf;
+	struct dma_buf_sync sync;
+	struct dma_buf_sync_partial sync_p;
+
+	dmabuf = file->private_data;
+
+	switch (cmd) {
+	case DMA_BUF_IOCTL_SYNC:
+		if (copy_from_user(&sync, (void __user *) arg, sizeof(sync)))
+			return -EFAULT;
+
+		return dma_buf_sync(dmabuf, sync.flags, 0, dmabuf->size);
+	case DMA_BUF_IOCTL_SYNC_PARTIAL:
+		if (copy_from_user(&sync_p, (void __user *) arg,
+				   sizeof(sync_p)))
+			return -EFAULT;
+
+		return dma_buf_sync(dmabuf, sync_p.flags, sync_p.offset,
+				    sync_p.len);
+	default:
+		return -ENOTTY;
+	}
+}
+
 static const struct file_operations dma_buf_fops = {
 	.release	= dma_buf_release,
 	.mmap		= dma_buf_mmap_internal,
 	.llseek		= dma_buf_llseek,
 	.poll		= dma_buf_poll,
+	.unlocked_ioctl	= dma_buf_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl	= dma_buf_ioctl,
+#endif
 };
 
 /*
@@ -115,6 +115,49 @@ static int smp2p_get_value(struct gpio_chip *cp,
 	return ret;
 }
 
+/**
+ * smp2p_out_update - Applies a bit update to the outbound entry.
+ *
+ * @chip:       GPIO chip device
+ * @data_set:   Bits to set
+ * @data_clear: Bits to clear
+ * @send_irq:   Interrupt the remote processor
+ * @returns: 0 for success; < 0 for failure
+ *
+ * Updates made before the entry is open are kept in the shadow value and
+ * written with the first update after it opens.
+ */
+static int smp2p_out_update(struct smp2p_chip_dev *chip, uint32_t data_set,
+		uint32_t data_clear, bool send_irq)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&chip->shadow_lock, flags);
+	if (!chip->is_open) {
+		chip->in_shadow = true;
+		chip->shadow_value &= ~data_clear;
+		chip->shadow_value |= data_set;
+		spin_unlock_irqrestore(&chip->shadow_lock, flags);
+		return 0;
+	}
+
+	if (chip->in_shadow) {
+		chip->in_shadow = false;
+		chip->shadow_value &= ~data_clear;
+		chip->shadow_value |= data_set;
+		ret = msm_smp2p_out_modify(chip->out_handle,
+				chip->shadow_value, 0x0, send_irq);
+		chip->shadow_value = 0x0;
+	} else {
+		ret = msm_smp2p_out_modify(chip->out_handle,
+				data_set, data_clear, send_irq);
+	}
+	spin_unlock_irqrestore(&chip->shadow_lock, flags);
+
+	return ret;
+}
+
 /**
  * smp2p_set_value - Sets GPIO value.
  *
@@ -129,7 +172,6 @@ static void smp2p_set_value(struct gpio_chip *cp, unsigned offset, int value)
 	uint32_t data_clear;
 	bool send_irq;
 	int ret;
-	unsigned long flags;
 
 	if (!cp)
 		return;
@@ -158,28 +200,7 @@ static void smp2p_set_value(struct gpio_chip *cp, unsigned offset, int value)
 		data_clear = 1 << offset;
 	}
 
-	spin_lock_irqsave(&chip->shadow_lock, flags);
-	if (!chip->is_open) {
-		chip->in_shadow = true;
-		chip->shadow_value &= ~data_clear;
-		chip->shadow_value |= data_set;
-		spin_unlock_irqrestore(&chip->shadow_lock, flags);
-		return;
-	}
-
-	if (chip->in_shadow) {
-		chip->in_shadow = false;
-		chip->shadow_value &= ~data_clear;
-		chip->shadow_value |= data_set;
-		ret = msm_smp2p_out_modify(chip->out_handle,
-				chip->shadow_value, 0x0, send_irq);
-		chip->shadow_value = 0x0;
-	} else {
-		ret = msm_smp2p_out_modify(chip->out_handle,
-				data_set, data_clear, send_irq);
-	}
-	spin_unlock_irqrestore(&chip->shadow_lock, flags);
-
+	ret = smp2p_out_update(chip, data_set, data_clear, send_irq);
 	if (ret)
 		SMP2P_GPIO("'%s':%d gpio %d set to %d failed (%d)\n",
 			chip->name, chip->remote_pid,
@@ -190,6 +211,46 @@ static void smp2p_set_value(struct gpio_chip *cp, unsigned offset, int value)
 			chip->gpio.base + offset, value);
 }
 
+/**
+ * smp2p_set_multiple - Sets several GPIO values with one interrupt.
+ *
+ * @cp:   GPIO chip pointer
+ * @mask: Pins to update
+ * @bits: New values of the pins in @mask
+ */
+static void smp2p_set_multiple(struct gpio_chip *cp, unsigned long *mask,
+		unsigned long *bits)
+{
+	struct smp2p_chip_dev *chip;
+	uint32_t data_set;
+	uint32_t data_clear;
+	int ret;
+
+	if (!cp)
+		return;
+
+	chip = container_of(cp, struct smp2p_chip_dev, gpio);
+
+	if (chip->is_inbound) {
+		SMP2P_INFO("%s: '%s':%d invalid operation\n",
+			__func__, chip->name, chip->remote_pid);
+		return;
+	}
+
+	data_set = *mask & *bits;
+	data_clear = *mask & ~*bits;
+
+	ret = smp2p_out_update(chip, data_set, data_clear, true);
+	if (ret)
+		SMP2P_GPIO("'%s':%d gpio mask %08x set to %08x failed (%d)\n",
+			chip->name, chip->remote_pid, (uint32_t)*mask,
+			data_set, ret);
+	else
+		SMP2P_GPIO("'%s':%d gpio mask %08x set to %08x\n",
+			chip->name, chip->remote_pid, (uint32_t)*mask,
+			data_set);
+}
+
 /**
  * smp2p_direction_input - Sets GPIO direction to input.
  *
@@ -659,6 +720,7 @@ static int smp2p_gpio_probe(struct platform_device *pdev)
 	chip->gpio.get = smp2p_get_value;
 	chip->gpio.direction_output = smp2p_direction_output,
 	chip->gpio.set = smp2p_set_value;
+	chip->gpio.set_multiple = smp2p_set_multiple;
 	chip->gpio.to_irq = smp2p_gpio_to_irq,
 	chip->gpio.base = -1;	/* use dynamic GPIO pin allocation */
 	chip->gpio.ngpio = SMP2P_BITS_PER_ENTRY;
@@ -29,6 +29,7 @@ struct msm_commit {
 	uint32_t crtc_mask;
 	uint32_t plane_mask;
 	struct kthread_work commit_work;
+	struct work_struct free_work;
 };
 
 /* block until specified crtcs are no longer pending update, and
@@ -451,12 +452,44 @@ static void complete_commit(struct msm_commit *commit)
 static int msm_atomic_commit_dispatch(struct drm_device *dev,
 		struct drm_atomic_state *state, struct msm_commit *commit);
 
+static void commit_free_work(struct work_struct *work)
+{
+	struct msm_commit *commit =
+			container_of(work, struct msm_commit, free_work);
+
+	drm_atomic_state_free(commit->state);
+	commit_destroy(commit);
+}
+
+/* may run from fence signal or timer context */
+static void input_fences_ready(void *data)
+{
+	struct msm_commit *commit = data;
+	struct msm_drm_private *priv = commit->dev->dev_private;
+
+	if (msm_atomic_commit_dispatch(commit->dev, commit->state, commit)) {
+		DRM_ERROR("%s: atomic commit failed\n", __func__);
+		queue_work(priv->wq, &commit->free_work);
+	}
+}
+
 static void fence_cb(struct msm_fence_cb *cb)
 {
 	struct msm_commit *commit =
 			container_of(cb, struct msm_commit, fence_cb);
+	struct msm_drm_private *priv = commit->dev->dev_private;
+	struct msm_kms *kms = priv->kms;
 	int ret = -EINVAL;
 
+	/*
+	 * Rather than blocking the commit thread on the planes' input
+	 * fences, queue the commit to it once the last one signals.
+	 */
+	if (kms->funcs->wait_input_fences_async &&
+			!kms->funcs->wait_input_fences_async(kms,
+				commit->state, input_fences_ready, commit))
+		return;
+
 	ret = msm_atomic_commit_dispatch(commit->dev, commit->state, commit);
 	if (ret) {
 		DRM_ERROR("%s: atomic commit failed\n", __func__);
@@ -499,6 +532,7 @@ static struct msm_commit *commit_init(struct drm_atomic_state *state)
 	 */
 	INIT_FENCE_CB(&commit->fence_cb, fence_cb);
 	init_kthread_work(&commit->commit_work, _msm_drm_commit_work_cb);
+	INIT_WORK(&commit->free_work, commit_free_work);
 
 	return commit;
 }
@@ -74,6 +74,10 @@ struct msm_kms_funcs {
 			struct drm_atomic_state *state);
 	void (*prepare_commit)(struct msm_kms *kms,
 			struct drm_atomic_state *state);
+	/* defer an async commit until its input fences have signaled */
+	int (*wait_input_fences_async)(struct msm_kms *kms,
+			struct drm_atomic_state *state,
+			void (*ready)(void *data), void *data);
 	void (*commit)(struct msm_kms *kms, struct drm_atomic_state *state);
 	void (*complete_commit)(struct msm_kms *kms,
 			struct drm_atomic_state *state);
@@ -18,6 +18,9 @@
 #include <linux/sort.h>
 #include <linux/clk.h>
 #include <linux/bitmap.h>
+#include <linux/jhash.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
 
 #include "msm_prop.h"
 
@@ -100,6 +103,55 @@ static void _sde_core_perf_calc_crtc(struct drm_crtc *crtc,
 			  perf->max_per_pipe_ib, perf->bw_ctl);
 }
 
+/*
+ * Fingerprint everything the perf vote of a crtc is derived from: the perf
+ * properties, the tuning floors and the attached planes' formats and
+ * geometry. Zero is kept to mean "no configuration".
+ */
+static u32 _sde_core_perf_crtc_fingerprint(struct sde_kms *kms,
+		struct drm_crtc_state *state)
+{
+	struct sde_crtc_state *sde_cstate = to_sde_crtc_state(state);
+	const struct drm_plane_state *pstate;
+	struct drm_plane *plane;
+	u64 key[6];
+	u32 fp, pkey[10];
+
+	key[0] = sde_crtc_get_property(sde_cstate, CRTC_PROP_CORE_AB);
+	key[1] = sde_crtc_get_property(sde_cstate, CRTC_PROP_CORE_IB);
+	key[2] = sde_crtc_get_property(sde_cstate, CRTC_PROP_CORE_CLK);
+	key[3] = kms->perf.perf_tune.min_core_clk;
+	key[4] = kms->perf.perf_tune.min_bus_vote;
+	key[5] = state->plane_mask;
+	fp = jhash(key, sizeof(key), 0);
+
+	if (!state->state)
+		goto out;
+
+	drm_atomic_crtc_state_for_each_plane(plane, state) {
+		pstate = drm_atomic_get_existing_plane_state(state->state,
+				plane);
+		if (!pstate)
+			pstate = plane->state;
+		if (!pstate)
+			continue;
+
+		pkey[0] = plane->base.id;
+		pkey[1] = pstate->fb ? pstate->fb->pixel_format : 0;
+		pkey[2] = pstate->src_x;
+		pkey[3] = pstate->src_y;
+		pkey[4] = pstate->src_w;
+		pkey[5] = pstate->src_h;
+		pkey[6] = pstate->crtc_x;
+		pkey[7] = pstate->crtc_y;
+		pkey[8] = pstate->crtc_w;
+		pkey[9] = pstate->crtc_h;
+		fp = jhash(pkey, sizeof(pkey), fp);
+	}
+out:
+	return fp ? fp : 1;
+}
+
 int sde_core_perf_crtc_check(struct drm_crtc *crtc,
 		struct drm_crtc_state *state)
 {
@@ -127,7 +179,15 @@ int sde_core_perf_crtc_check(struct drm_crtc *crtc,
 
 	sde_cstate = to_sde_crtc_state(state);
 
-	_sde_core_perf_calc_crtc(crtc, state, &sde_cstate->new_perf);
+	/* an identical configuration to the current state needs no recalc */
+	sde_cstate->perf_fp = _sde_core_perf_crtc_fingerprint(kms, state);
+	if (crtc->state && crtc->state != state &&
+	    to_sde_crtc_state(crtc->state)->perf_fp == sde_cstate->perf_fp)
+		memcpy(&sde_cstate->new_perf,
+			&to_sde_crtc_state(crtc->state)->new_perf,
+			sizeof(struct sde_core_perf_params));
+	else
+		_sde_core_perf_calc_crtc(crtc, state, &sde_cstate->new_perf);
 
 	bw_sum_of_intfs = sde_cstate->new_perf.bw_ctl;
 
@@ -203,6 +263,7 @@ static void _sde_core_perf_crtc_update_client_vote(struct sde_kms *kms,
 	bus_ib_quota = params->max_per_pipe_ib;
 
 	SDE_ATRACE_INT("bus_quota", bus_ib_quota);
+	kms->perf.stats.bus_votes++;
 	sde_power_data_bus_set_quota(&priv->phandle, kms->core_client,
 		nrt_client ? SDE_POWER_HANDLE_DATA_BUS_CLIENT_NRT :
 				SDE_POWER_HANDLE_DATA_BUS_CLIENT_RT,
@@ -293,6 +354,8 @@ void sde_core_perf_crtc_release_bw(struct drm_crtc *crtc)
 	if (kms->perf.enable_bw_release) {
 		trace_sde_cmd_release_bw(crtc->base.id);
 		sde_crtc->cur_perf.bw_ctl = 0;
+		/* the next commit must vote again, even if unchanged */
+		sde_crtc->perf_fp = 0;
 		SDE_DEBUG("Release BW crtc=%d\n", crtc->base.id);
 		_sde_core_perf_crtc_update_bus(kms, crtc, 0);
 	}
@@ -366,6 +429,17 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 	SDE_DEBUG("crtc:%d stop_req:%d core_clk:%u\n",
 			crtc->base.id, stop_req, kms->perf.core_clk_rate);
 
+	/*
+	 * A commit identical to the one the current votes were made for
+	 * cannot change them; skip the recalculation altogether.
+	 */
+	if (params_changed && !stop_req && sde_cstate->perf_fp &&
+	    sde_cstate->perf_fp == sde_crtc->perf_fp &&
+	    _sde_core_perf_crtc_is_power_on(crtc)) {
+		kms->perf.stats.fp_hits++;
+		return;
+	}
+
 	SDE_ATRACE_BEGIN(__func__);
 
 	/*
@@ -374,13 +448,30 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 	 * perf update that happens post kickoff.
 	 */
 
-	if (params_changed)
+	if (params_changed) {
 		memcpy(&sde_crtc->new_perf, &sde_cstate->new_perf,
 			   sizeof(struct sde_core_perf_params));
+		sde_crtc->perf_fp = sde_cstate->perf_fp;
+		sde_crtc->perf_stable_frames = 0;
+	}
 
 	old = &sde_crtc->cur_perf;
 	new = &sde_crtc->new_perf;
 
+	/*
+	 * Hold back lowering the votes until the new configuration has
+	 * been stable for lower_delay_frames frames, so alternating frames
+	 * settle on the higher vote instead of toggling it.
+	 */
+	if (!params_changed && !stop_req && kms->perf.lower_delay_frames &&
+	    (new->bw_ctl < old->bw_ctl ||
+	     new->core_clk_rate < old->core_clk_rate) &&
+	    _sde_core_perf_crtc_is_power_on(crtc) &&
+	    ++sde_crtc->perf_stable_frames <= kms->perf.lower_delay_frames) {
+		kms->perf.stats.lower_deferred++;
+		goto end;
+	}
+
 	if (_sde_core_perf_crtc_is_power_on(crtc) && !stop_req) {
 		/*
 		 * cases for bus bandwidth update.
@@ -410,6 +501,7 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 		SDE_DEBUG("crtc=%d disable\n", crtc->base.id);
 		memset(old, 0, sizeof(*old));
 		memset(new, 0, sizeof(*new));
+		sde_crtc->perf_fp = 0;
 		update_bus = 1;
 		update_clk = 1;
 	}
@@ -443,6 +535,7 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 		}
 
 		kms->perf.core_clk_rate = clk_rate;
+		kms->perf.stats.clk_votes++;
 		SDE_DEBUG("update clk rate = %d HZ\n", clk_rate);
 	}
 
@@ -559,6 +652,16 @@ static int sde_debugfs_core_perf_init(struct sde_core_perf *perf,
 			(u32 *)&catalog->perf.max_bw_high);
 	debugfs_create_file("perf_mode", 0644, perf->debugfs_root,
 			(u32 *)perf, &sde_core_perf_mode_fops);
+	debugfs_create_u32("lower_delay_frames", 0644, perf->debugfs_root,
+			&perf->lower_delay_frames);
+	debugfs_create_u32("bus_votes", 0444, perf->debugfs_root,
+			&perf->stats.bus_votes);
+	debugfs_create_u32("clk_votes", 0444, perf->debugfs_root,
+			&perf->stats.clk_votes);
+	debugfs_create_u32("fp_hits", 0444, perf->debugfs_root,
+			&perf->stats.fp_hits);
+	debugfs_create_u32("lower_deferred", 0444, perf->debugfs_root,
+			&perf->stats.lower_deferred);
 
 	return 0;
 }
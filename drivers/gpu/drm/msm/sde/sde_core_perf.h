@@ -43,6 +43,20 @@ struct sde_core_perf_tune {
 	u64 min_bus_vote;
 };
 
+/**
+ * struct sde_core_perf_stats - vote update accounting
+ * @bus_votes: number of data bus vote updates
+ * @clk_votes: number of core clock rate updates
+ * @fp_hits: commits skipped because their fingerprint was unchanged
+ * @lower_deferred: vote decreases held back waiting for stable frames
+ */
+struct sde_core_perf_stats {
+	u32 bus_votes;
+	u32 clk_votes;
+	u32 fp_hits;
+	u32 lower_deferred;
+};
+
 /**
  * struct sde_core_perf - definition of core performance context
  * @dev: Pointer to drm device
@@ -57,6 +71,8 @@ struct sde_core_perf_tune {
  * @max_core_clk_rate: maximum allowable core clock rate
  * @perf_tune: debug control for performance tuning
  * @enable_bw_release: debug control for bandwidth release
+ * @lower_delay_frames: frames a lower vote must be stable before applying
+ * @stats: vote update accounting
  */
 struct sde_core_perf {
 	struct drm_device *dev;
@@ -71,6 +87,8 @@ struct sde_core_perf {
 	u64 max_core_clk_rate;
 	struct sde_core_perf_tune perf_tune;
 	u32 enable_bw_release;
+	u32 lower_delay_frames;
+	struct sde_core_perf_stats stats;
 };
 
 /**
@@ -20,6 +20,7 @@
 #include <linux/sort.h>
 #include <linux/debugfs.h>
 #include <linux/ktime.h>
+#include <linux/devfreq_boost.h>
 #include <uapi/drm/sde_drm.h>
 #include <drm/drm_mode.h>
 #include <drm/drm_crtc.h>
@@ -37,6 +38,7 @@
 #include "sde_power_handle.h"
 #include "sde_core_perf.h"
 #include "sde_trace.h"
+#include <trace/events/input.h>
 
 /* default input fence timeout, in ms */
 #define SDE_CRTC_INPUT_FENCE_TIMEOUT    10000
@@ -72,15 +74,53 @@ static inline struct sde_kms *_sde_crtc_get_kms(struct drm_crtc *crtc)
 	return to_sde_kms(priv->kms);
 }
 
+/* ktime in ns of the last event batch from a touchscreen */
+static atomic64_t sde_crtc_touch_ts = ATOMIC64_INIT(0);
+static int sde_crtc_touch_users;
+
+#if IS_REACHABLE(CONFIG_INPUT)
+static void _sde_crtc_touch_probe(void *data, struct input_dev *dev,
+		unsigned int count, ktime_t ts)
+{
+	if (test_bit(INPUT_PROP_DIRECT, dev->propbit))
+		atomic64_set(&sde_crtc_touch_ts, ktime_to_ns(ts));
+}
+
+static void _sde_crtc_touch_register(void)
+{
+	if (!sde_crtc_touch_users++)
+		register_trace_input_frame(_sde_crtc_touch_probe, NULL);
+}
+
+static void _sde_crtc_touch_unregister(void)
+{
+	if (--sde_crtc_touch_users)
+		return;
+
+	unregister_trace_input_frame(_sde_crtc_touch_probe, NULL);
+	tracepoint_synchronize_unregister();
+}
+#else
+static inline void _sde_crtc_touch_register(void) {}
+static inline void _sde_crtc_touch_unregister(void) {}
+#endif
+
 static void sde_crtc_destroy(struct drm_crtc *crtc)
 {
 	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	int i;
 
 	SDE_DEBUG("\n");
 
 	if (!crtc)
 		return;
 
+	hrtimer_cancel(&sde_crtc->fence_timer);
+	for (i = 0; i < ARRAY_SIZE(sde_crtc->fence_waiters); i++) {
+		sde_sync_cancel_async(sde_crtc->fence_waiters[i]);
+		sde_sync_waiter_destroy(sde_crtc->fence_waiters[i]);
+	}
+
 	if (sde_crtc->blob_info)
 		drm_property_unreference_blob(sde_crtc->blob_info);
 	msm_property_destroy(&sde_crtc->property_info);
@@ -88,6 +128,7 @@ static void sde_crtc_destroy(struct drm_crtc *crtc)
 
 	debugfs_remove_recursive(sde_crtc->debugfs_root);
 	sde_fence_deinit(&sde_crtc->output_fence);
+	_sde_crtc_touch_unregister();
 
 	drm_crtc_cleanup(crtc);
 	mutex_destroy(&sde_crtc->crtc_lock);
@@ -503,6 +544,131 @@ static void sde_crtc_vblank_cb(void *data)
 	SDE_EVT32_IRQ(DRMID(crtc));
 }
 
+/**
+ * _sde_crtc_frame_hist_add - account a duration in a frame histogram
+ * @hist: Histogram of SDE_CRTC_FRAME_HIST_SIZE log2 millisecond buckets
+ * @us: Duration in microseconds
+ */
+static inline void _sde_crtc_frame_hist_add(u32 *hist, u32 us)
+{
+	hist[min_t(u32, fls(us >> 10), SDE_CRTC_FRAME_HIST_SIZE - 1)]++;
+}
+
+/**
+ * _sde_crtc_touch_kickoff - pick up the latest touch event batch
+ * @sde_crtc: Pointer to sde crtc structure
+ *
+ * Each touch event batch is charged to the first commit kicked off
+ * after it, later commits without new input are not counted.
+ */
+static void _sde_crtc_touch_kickoff(struct sde_crtc *sde_crtc)
+{
+	s64 ts = atomic64_read(&sde_crtc_touch_ts);
+
+	if (ts > sde_crtc->touch_last)
+		sde_crtc->touch_last = ts;
+	else
+		ts = 0;
+
+	sde_crtc->touch_ts[sde_crtc->touch_kickoff++ %
+			SDE_CRTC_TOUCH_TS_SIZE] = ts;
+}
+
+/**
+ * _sde_crtc_touch_account - update touch to frame done statistics
+ * @crtc: Pointer to drm crtc structure
+ * @event: Frame event, SDE_ENCODER_FRAME_EVENT_DONE or _ERROR
+ * @ts: ktime of the frame event
+ */
+static void _sde_crtc_touch_account(struct drm_crtc *crtc, u32 event,
+		ktime_t ts)
+{
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	struct sde_crtc_frame_stats *stats = &sde_crtc->frame_stats;
+	s64 touch_ts;
+	u32 touch_us;
+
+	/* spurious frame event without a commit in flight */
+	if (sde_crtc->touch_done == sde_crtc->touch_kickoff)
+		return;
+
+	touch_ts = sde_crtc->touch_ts[sde_crtc->touch_done++ %
+			SDE_CRTC_TOUCH_TS_SIZE];
+	if (!touch_ts || event != SDE_ENCODER_FRAME_EVENT_DONE)
+		return;
+
+	touch_us = ktime_us_delta(ts, ns_to_ktime(touch_ts));
+	stats->touch_frames++;
+	stats->max_touch_us = max(stats->max_touch_us, touch_us);
+	_sde_crtc_frame_hist_add(stats->touch_hist, touch_us);
+	trace_sde_crtc_touch_latency(DRMID(crtc), touch_ts, touch_us);
+}
+
+/**
+ * _sde_crtc_frame_account - update frame timing statistics
+ * @crtc: Pointer to drm crtc structure
+ * @event: Frame event, SDE_ENCODER_FRAME_EVENT_DONE or _ERROR
+ * @ts: ktime of the frame event
+ *
+ * A frame taking more than one vsync period from kickoff to done is
+ * late, and each further whole period it took is a missed vsync.
+ */
+static void _sde_crtc_frame_account(struct drm_crtc *crtc, u32 event,
+		ktime_t ts)
+{
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	struct sde_crtc_frame_stats *stats = &sde_crtc->frame_stats;
+	int vrefresh = crtc->state->adjusted_mode.vrefresh;
+	u32 frame_us, period_us;
+
+	_sde_crtc_touch_account(crtc, event, ts);
+
+	if (event == SDE_ENCODER_FRAME_EVENT_ERROR) {
+		stats->errors++;
+		return;
+	}
+
+	frame_us = ktime_us_delta(ts, sde_crtc->kickoff_ts);
+	stats->frames++;
+	stats->max_frame_us = max(stats->max_frame_us, frame_us);
+	_sde_crtc_frame_hist_add(stats->frame_hist, frame_us);
+
+	if (vrefresh <= 0)
+		return;
+
+	period_us = USEC_PER_SEC / vrefresh;
+	if (frame_us > period_us) {
+		stats->late_frames++;
+		stats->missed_vsyncs += frame_us / period_us;
+	}
+}
+
+/**
+ * _sde_crtc_frame_boost - report frame time to devfreq boost
+ * @crtc: Pointer to drm crtc structure
+ * @ts: ktime of the frame done event
+ *
+ * A frame queued behind another one is counted as taking the whole
+ * vsync period, since the pipeline is already running late.
+ */
+static void _sde_crtc_frame_boost(struct drm_crtc *crtc, ktime_t ts)
+{
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	int vrefresh = crtc->state->adjusted_mode.vrefresh;
+	unsigned int period_us, frame_us;
+
+	if (vrefresh <= 0)
+		return;
+
+	period_us = USEC_PER_SEC / vrefresh;
+	if (atomic_read(&sde_crtc->frame_pending) > 1)
+		frame_us = period_us;
+	else
+		frame_us = ktime_us_delta(ts, sde_crtc->kickoff_ts);
+
+	devfreq_boost_frame(frame_us, period_us);
+}
+
 static void sde_crtc_frame_event_work(struct kthread_work *work)
 {
 	struct msm_drm_private *priv;
@@ -541,6 +707,10 @@ static void sde_crtc_frame_event_work(struct kthread_work *work)
 	if (fevent->event == SDE_ENCODER_FRAME_EVENT_DONE ||
 			fevent->event == SDE_ENCODER_FRAME_EVENT_ERROR) {
 
+		if (fevent->event == SDE_ENCODER_FRAME_EVENT_DONE)
+			_sde_crtc_frame_boost(crtc, fevent->ts);
+		_sde_crtc_frame_account(crtc, fevent->event, fevent->ts);
+
 		if (atomic_read(&sde_crtc->frame_pending) < 1) {
 			/* this should not happen */
 			SDE_ERROR("crtc%d ts:%lld invalid frame_pending:%d\n",
@@ -676,6 +846,106 @@ static void _sde_crtc_set_input_fence_timeout(struct sde_crtc_state *cstate)
 	cstate->input_fence_timeout_ns *= NSEC_PER_MSEC;
 }
 
+static void _sde_crtc_fences_ready(struct sde_crtc *sde_crtc, bool timeout)
+{
+	if (atomic_xchg(&sde_crtc->fences_fired, 1))
+		return;
+
+	sde_crtc->fence_ready_ts = ktime_get();
+	if (timeout)
+		sde_crtc->fence_stats.timeouts++;
+	else
+		hrtimer_try_to_cancel(&sde_crtc->fence_timer);
+
+	sde_crtc->fence_ready(sde_crtc->fence_ready_data);
+}
+
+static void _sde_crtc_input_fence_cb(void *data)
+{
+	struct sde_crtc *sde_crtc = data;
+
+	if (atomic_dec_and_test(&sde_crtc->fences_pending))
+		_sde_crtc_fences_ready(sde_crtc, false);
+}
+
+static enum hrtimer_restart _sde_crtc_fence_timeout(struct hrtimer *timer)
+{
+	struct sde_crtc *sde_crtc = container_of(timer, struct sde_crtc,
+			fence_timer);
+
+	SDE_EVT32(DRMID(&sde_crtc->base),
+			atomic_read(&sde_crtc->fences_pending));
+	_sde_crtc_fences_ready(sde_crtc, true);
+	return HRTIMER_NORESTART;
+}
+
+int sde_crtc_wait_input_fences_async(struct drm_crtc *crtc,
+		void (*ready)(void *data), void *data)
+{
+	struct sde_crtc *sde_crtc;
+	struct sde_plane_state *pstate;
+	struct drm_plane *plane;
+	int i = 0, rc;
+
+	if (!crtc || !crtc->state || !ready)
+		return -EINVAL;
+
+	sde_crtc = to_sde_crtc(crtc);
+	if (!sde_crtc->fence_waiters[0])
+		return -ENODEV;
+
+	drm_atomic_crtc_for_each_plane(plane, crtc)
+		if (plane->state && ++i > ARRAY_SIZE(sde_crtc->fence_waiters))
+			return -E2BIG;
+
+	sde_crtc->fence_ready = ready;
+	sde_crtc->fence_ready_data = data;
+	sde_crtc->fence_arm_ts = ktime_get();
+	sde_crtc->fence_async = true;
+	atomic_set(&sde_crtc->fences_fired, 0);
+	/* bias, so fences signaling while arming cannot fire ready early */
+	atomic_set(&sde_crtc->fences_pending, 1);
+
+	i = 0;
+	drm_atomic_crtc_for_each_plane(plane, crtc) {
+		if (!plane->state)
+			continue;
+		pstate = to_sde_plane_state(plane->state);
+		if (!pstate->input_fence)
+			continue;
+
+		atomic_inc(&sde_crtc->fences_pending);
+		rc = sde_sync_wait_async(pstate->input_fence,
+				sde_crtc->fence_waiters[i++]);
+		if (rc)
+			/* already signaled, or in error: the flush reports it */
+			atomic_dec(&sde_crtc->fences_pending);
+	}
+
+	hrtimer_start(&sde_crtc->fence_timer,
+			ns_to_ktime(to_sde_crtc_state(crtc->state)->
+				input_fence_timeout_ns), HRTIMER_MODE_REL);
+
+	SDE_EVT32(DRMID(crtc), i, atomic_read(&sde_crtc->fences_pending));
+	_sde_crtc_input_fence_cb(sde_crtc);
+	return 0;
+}
+
+static void _sde_crtc_update_fence_stats(struct sde_crtc *sde_crtc,
+		ktime_t start, ktime_t end)
+{
+	struct sde_crtc_fence_stats *stats = &sde_crtc->fence_stats;
+	u32 wait_us = ktime_us_delta(end, start);
+
+	stats->commits++;
+	if (sde_crtc->fence_async)
+		stats->async_commits++;
+	stats->last_wait_us = wait_us;
+	stats->max_wait_us = max(stats->max_wait_us, wait_us);
+	stats->total_wait_us += wait_us;
+	_sde_crtc_frame_hist_add(sde_crtc->frame_stats.fence_hist, wait_us);
+}
+
 /**
  * _sde_crtc_wait_for_fences - wait for incoming framebuffer sync fences
  * @crtc: Pointer to CRTC object
@@ -683,8 +953,10 @@ static void _sde_crtc_set_input_fence_timeout(struct sde_crtc_state *cstate)
 static void _sde_crtc_wait_for_fences(struct drm_crtc *crtc)
 {
 	struct drm_plane *plane = NULL;
+	struct sde_crtc *sde_crtc;
 	uint32_t wait_ms = 1;
-	ktime_t kt_end, kt_wait;
+	ktime_t kt_start, kt_end, kt_wait;
+	int i;
 
 	SDE_DEBUG("\n");
 
@@ -693,6 +965,9 @@ static void _sde_crtc_wait_for_fences(struct drm_crtc *crtc)
 		return;
 	}
 
+	sde_crtc = to_sde_crtc(crtc);
+	kt_start = ktime_get();
+
 	/* use monotonic timer to limit total fence wait time */
 	kt_end = ktime_add_ns(ktime_get(),
 		to_sde_crtc_state(crtc->state)->input_fence_timeout_ns);
@@ -719,6 +994,25 @@ static void _sde_crtc_wait_for_fences(struct drm_crtc *crtc)
 		sde_plane_wait_input_fence(plane, wait_ms);
 	}
 	SDE_ATRACE_END("plane_wait_input_fence");
+
+	/*
+	 * With an asynchronous wait the fences normally signaled before the
+	 * commit was queued, and the loop above only collects their status.
+	 * Otherwise it timed out, and late callbacks are cancelled here so
+	 * the waiters are idle for the next commit.
+	 */
+	if (sde_crtc->fence_async) {
+		hrtimer_cancel(&sde_crtc->fence_timer);
+		for (i = 0; i < ARRAY_SIZE(sde_crtc->fence_waiters); i++)
+			sde_sync_cancel_async(sde_crtc->fence_waiters[i]);
+		_sde_crtc_update_fence_stats(sde_crtc, sde_crtc->fence_arm_ts,
+				sde_crtc->fence_ready_ts);
+	} else {
+		sde_crtc->fence_ready_ts = ktime_get();
+		_sde_crtc_update_fence_stats(sde_crtc, kt_start,
+				sde_crtc->fence_ready_ts);
+	}
+	sde_crtc->fence_async = false;
 }
 
 static void _sde_crtc_setup_mixer_for_encoder(
@@ -988,6 +1282,19 @@ void sde_crtc_commit_kickoff(struct drm_crtc *crtc)
 
 
 	SDE_ATRACE_BEGIN("crtc_commit");
+	sde_crtc->kickoff_ts = ktime_get();
+	if (ktime_to_ns(sde_crtc->fence_ready_ts)) {
+		struct sde_crtc_fence_stats *stats = &sde_crtc->fence_stats;
+		u32 kickoff_us = ktime_us_delta(sde_crtc->kickoff_ts,
+				sde_crtc->fence_ready_ts);
+
+		stats->last_kickoff_us = kickoff_us;
+		stats->max_kickoff_us = max(stats->max_kickoff_us, kickoff_us);
+		stats->total_kickoff_us += kickoff_us;
+		_sde_crtc_frame_hist_add(sde_crtc->frame_stats.prog_hist,
+				kickoff_us);
+		sde_crtc->fence_ready_ts = ktime_set(0, 0);
+	}
 	list_for_each_entry(encoder, &dev->mode_config.encoder_list, head) {
 		if (encoder->crtc != crtc)
 			continue;
@@ -1015,6 +1322,7 @@ void sde_crtc_commit_kickoff(struct drm_crtc *crtc)
 		SDE_DEBUG("crtc%d commit\n", crtc->base.id);
 		SDE_EVT32(DRMID(crtc), 2);
 	}
+	_sde_crtc_touch_kickoff(sde_crtc);
 
 	list_for_each_entry(encoder, &dev->mode_config.encoder_list, head) {
 		if (encoder->crtc != crtc)
@@ -1266,6 +1574,7 @@ static void sde_crtc_disable(struct drm_crtc *crtc)
 				sde_kms->core_client, false);
 		sde_core_perf_crtc_release_bw(crtc);
 		atomic_set(&sde_crtc->frame_pending, 0);
+		sde_crtc->touch_done = sde_crtc->touch_kickoff;
 	}
 
 	sde_core_perf_crtc_update(crtc, 0, true);
@@ -2051,6 +2360,89 @@ static int sde_crtc_debugfs_state_show(struct seq_file *s, void *v)
 }
 DEFINE_SDE_DEBUGFS_SEQ_FOPS(sde_crtc_debugfs_state);
 
+static int sde_crtc_debugfs_fence_stats_show(struct seq_file *s, void *v)
+{
+	struct sde_crtc *sde_crtc = s->private;
+	struct sde_crtc_fence_stats *stats = &sde_crtc->fence_stats;
+
+	seq_printf(s, "commits: %u\n", stats->commits);
+	seq_printf(s, "async_commits: %u\n", stats->async_commits);
+	seq_printf(s, "timeouts: %u\n", stats->timeouts);
+	seq_printf(s, "wait_us: last %u max %u avg %llu\n",
+			stats->last_wait_us, stats->max_wait_us,
+			stats->commits ? div_u64(stats->total_wait_us,
+				stats->commits) : 0);
+	seq_printf(s, "kickoff_us: last %u max %u avg %llu\n",
+			stats->last_kickoff_us, stats->max_kickoff_us,
+			stats->commits ? div_u64(stats->total_kickoff_us,
+				stats->commits) : 0);
+
+	return 0;
+}
+DEFINE_SDE_DEBUGFS_SEQ_FOPS(sde_crtc_debugfs_fence_stats);
+
+static void _sde_crtc_print_frame_hist(struct seq_file *s, const char *name,
+		const u32 *hist)
+{
+	int i;
+
+	seq_printf(s, "%-8s", name);
+	for (i = 0; i < SDE_CRTC_FRAME_HIST_SIZE; i++)
+		seq_printf(s, " %8u", hist[i]);
+	seq_puts(s, "\n");
+}
+
+static int sde_crtc_debugfs_frame_stats_show(struct seq_file *s, void *v)
+{
+	struct sde_crtc *sde_crtc = s->private;
+	struct sde_crtc_frame_stats *stats = &sde_crtc->frame_stats;
+
+	seq_printf(s, "frames: %u\n", stats->frames);
+	seq_printf(s, "errors: %u\n", stats->errors);
+	seq_printf(s, "late_frames: %u\n", stats->late_frames);
+	seq_printf(s, "missed_vsyncs: %u\n", stats->missed_vsyncs);
+	seq_printf(s, "max_frame_us: %u\n", stats->max_frame_us);
+	seq_printf(s, "touch_frames: %u\n", stats->touch_frames);
+	seq_printf(s, "max_touch_us: %u\n", stats->max_touch_us);
+	seq_printf(s, "%-8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "ms",
+			"<1", "1-2", "2-4", "4-8", "8-16", "16-32", "32-64",
+			">=64");
+	_sde_crtc_print_frame_hist(s, "frame", stats->frame_hist);
+	_sde_crtc_print_frame_hist(s, "fence", stats->fence_hist);
+	_sde_crtc_print_frame_hist(s, "program", stats->prog_hist);
+	_sde_crtc_print_frame_hist(s, "touch", stats->touch_hist);
+
+	return 0;
+}
+
+static int sde_crtc_debugfs_frame_stats_open(struct inode *inode,
+		struct file *file)
+{
+	return single_open(file, sde_crtc_debugfs_frame_stats_show,
+			inode->i_private);
+}
+
+static ssize_t sde_crtc_debugfs_frame_stats_write(struct file *file,
+		const char __user *user_buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct sde_crtc *sde_crtc = s->private;
+
+	/* any write clears the statistics */
+	memset(&sde_crtc->frame_stats, 0, sizeof(sde_crtc->frame_stats));
+
+	return count;
+}
+
+static const struct file_operations sde_crtc_debugfs_frame_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = sde_crtc_debugfs_frame_stats_open,
+	.release = single_release,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.write = sde_crtc_debugfs_frame_stats_write,
+};
+
 static void _sde_crtc_init_debugfs(struct sde_crtc *sde_crtc,
 		struct sde_kms *sde_kms)
 {
@@ -2073,6 +2465,12 @@ static void _sde_crtc_init_debugfs(struct sde_crtc *sde_crtc,
 					sde_crtc->debugfs_root,
 					&sde_crtc->base,
 					&sde_crtc_debugfs_state_fops);
+			debugfs_create_file("fence_stats", S_IRUGO,
+					sde_crtc->debugfs_root, sde_crtc,
+					&sde_crtc_debugfs_fence_stats_fops);
+			debugfs_create_file("frame_stats", S_IRUGO | S_IWUSR,
+					sde_crtc->debugfs_root, sde_crtc,
+					&sde_crtc_debugfs_frame_stats_fops);
 		}
 	}
 }
@@ -2127,6 +2525,16 @@ struct drm_crtc *sde_crtc_init(struct drm_device *dev,
 	spin_lock_init(&sde_crtc->spin_lock);
 	atomic_set(&sde_crtc->frame_pending, 0);
 
+	hrtimer_init(&sde_crtc->fence_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sde_crtc->fence_timer.function = _sde_crtc_fence_timeout;
+	for (i = 0; i < ARRAY_SIZE(sde_crtc->fence_waiters); i++) {
+		sde_crtc->fence_waiters[i] = sde_sync_waiter_create(
+				_sde_crtc_input_fence_cb, sde_crtc);
+		/* without waiters commits wait in the flush as before */
+		if (!sde_crtc->fence_waiters[i])
+			break;
+	}
+
 	INIT_LIST_HEAD(&sde_crtc->frame_event_list);
 	for (i = 0; i < ARRAY_SIZE(sde_crtc->frame_events); i++) {
 		INIT_LIST_HEAD(&sde_crtc->frame_events[i].list);
@@ -2149,6 +2557,7 @@ struct drm_crtc *sde_crtc_init(struct drm_device *dev,
 
 	/* initialize debugfs support */
 	_sde_crtc_init_debugfs(sde_crtc, kms);
+	_sde_crtc_touch_register();
 
 	/* create CRTC properties */
 	msm_property_init(&sde_crtc->property_info, &crtc->base, dev,
@@ -19,6 +19,7 @@
 #ifndef _SDE_CRTC_H_
 #define _SDE_CRTC_H_
 
+#include <linux/hrtimer.h>
 #include "drm_crtc.h"
 #include "msm_prop.h"
 #include "sde_fence.h"
@@ -30,6 +31,68 @@
 /* define the maximum number of in-flight frame events */
 #define SDE_CRTC_FRAME_EVENT_SIZE	2
 
+/* input fences waited for asynchronously, one per possible plane */
+#define SDE_CRTC_MAX_INPUT_FENCES	(SDE_STAGE_MAX * 2)
+
+/**
+ * struct sde_crtc_fence_stats - input fence wait and kickoff latency
+ * @commits       : Number of commits that waited for input fences
+ * @async_commits : Commits whose fences were waited for by callback
+ * @timeouts      : Commits dispatched on input fence timeout
+ * @last_wait_us  : Input fence wait time of the last commit
+ * @max_wait_us   : Longest input fence wait time
+ * @total_wait_us : Sum of input fence wait times
+ * @last_kickoff_us : Time from last fence signal to kickoff, last commit
+ * @max_kickoff_us  : Longest time from last fence signal to kickoff
+ * @total_kickoff_us : Sum of times from last fence signal to kickoff
+ */
+struct sde_crtc_fence_stats {
+	u32 commits;
+	u32 async_commits;
+	u32 timeouts;
+	u32 last_wait_us;
+	u32 max_wait_us;
+	u64 total_wait_us;
+	u32 last_kickoff_us;
+	u32 max_kickoff_us;
+	u64 total_kickoff_us;
+};
+
+/* log2 millisecond buckets: <1ms, 1-2ms, 2-4ms, ... , >=64ms */
+#define SDE_CRTC_FRAME_HIST_SIZE	8
+
+/**
+ * struct sde_crtc_frame_stats - frame timing and missed frame statistics
+ * @frames        : Number of frame done events
+ * @errors        : Number of frame error events, e.g. ping-pong timeouts
+ * @late_frames   : Frames that took longer than one vsync period
+ * @missed_vsyncs : Vsync periods missed by late frames
+ * @max_frame_us  : Longest time from kickoff to frame done
+ * @frame_hist    : Histogram of time from kickoff to frame done
+ * @fence_hist    : Histogram of input fence wait time
+ * @prog_hist     : Histogram of time from last input fence to kickoff,
+ *                  i.e. the time spent programming the hardware
+ * @touch_frames  : Frames that picked up a new touch event batch
+ * @max_touch_us  : Longest time from touch event batch to frame done
+ * @touch_hist    : Histogram of time from touch event batch to frame done
+ */
+struct sde_crtc_frame_stats {
+	u32 frames;
+	u32 errors;
+	u32 late_frames;
+	u32 missed_vsyncs;
+	u32 max_frame_us;
+	u32 frame_hist[SDE_CRTC_FRAME_HIST_SIZE];
+	u32 fence_hist[SDE_CRTC_FRAME_HIST_SIZE];
+	u32 prog_hist[SDE_CRTC_FRAME_HIST_SIZE];
+	u32 touch_frames;
+	u32 max_touch_us;
+	u32 touch_hist[SDE_CRTC_FRAME_HIST_SIZE];
+};
+
+/* commits in flight: one outstanding, the current one and one spare */
+#define SDE_CRTC_TOUCH_TS_SIZE		4
+
 /**
  * struct sde_crtc_mixer: stores the map for each virtual pipeline in the CRTC
  * @hw_lm:	LM HW Driver context
@@ -91,12 +154,31 @@ struct sde_crtc_frame_event {
  * @dirty_list    : list of color processing features are dirty
  * @crtc_lock     : crtc lock around create, destroy and access.
  * @frame_pending : Whether or not an update is pending
+ * @kickoff_ts    : ktime of the last commit kickoff, for frame boosting
  * @frame_events  : static allocation of in-flight frame events
  * @frame_event_list : available frame event list
  * @pending       : Whether any page-flip events are pending signal
  * @spin_lock     : spin lock for frame event, transaction status, etc...
  * @cur_perf      : current performance committed to clock/bandwidth driver
  * @new_perf      : new performance committed to clock/bandwidth driver
+ * @perf_fp       : fingerprint of the configuration cur_perf was set for
+ * @perf_stable_frames : frames completed since perf_fp last changed
+ * @fence_waiters : asynchronous waiters for the planes' input fences
+ * @fence_ready   : callback run once all input fences signaled or timed out
+ * @fence_ready_data : argument for @fence_ready
+ * @fences_pending : input fences not signaled yet, plus one while arming
+ * @fences_fired  : whether @fence_ready has run for the armed commit
+ * @fence_timer   : input fence timeout for the asynchronous wait
+ * @fence_async   : whether the current commit's fences are waited by callback
+ * @fence_arm_ts  : ktime the input fence wait started
+ * @fence_ready_ts : ktime the last input fence signaled
+ * @fence_stats   : input fence wait and kickoff latency statistics
+ * @frame_stats   : frame timing histograms and missed frame counters
+ * @touch_ts      : touch event batch time picked up by each commit in flight,
+ *                  0 if the commit did not follow new input
+ * @touch_kickoff : commits kicked off, indexes @touch_ts
+ * @touch_done    : frame events seen, indexes @touch_ts
+ * @touch_last    : newest touch event batch time already picked up
  */
 struct sde_crtc {
 	struct drm_crtc base;
@@ -133,12 +215,31 @@ struct sde_crtc {
 	struct mutex crtc_lock;
 
 	atomic_t frame_pending;
+	ktime_t kickoff_ts;
 	struct sde_crtc_frame_event frame_events[SDE_CRTC_FRAME_EVENT_SIZE];
 	struct list_head frame_event_list;
 	spinlock_t spin_lock;
 
 	struct sde_core_perf_params cur_perf;
 	struct sde_core_perf_params new_perf;
+	u32 perf_fp;
+	u32 perf_stable_frames;
+
+	struct sde_sync_waiter *fence_waiters[SDE_CRTC_MAX_INPUT_FENCES];
+	void (*fence_ready)(void *data);
+	void *fence_ready_data;
+	atomic_t fences_pending;
+	atomic_t fences_fired;
+	struct hrtimer fence_timer;
+	bool fence_async;
+	ktime_t fence_arm_ts;
+	ktime_t fence_ready_ts;
+	struct sde_crtc_fence_stats fence_stats;
+	struct sde_crtc_frame_stats frame_stats;
+	s64 touch_ts[SDE_CRTC_TOUCH_TS_SIZE];
+	u32 touch_kickoff;
+	u32 touch_done;
+	s64 touch_last;
 };
 
 #define to_sde_crtc(x) container_of(x, struct sde_crtc, base)
@@ -154,6 +255,7 @@ struct sde_crtc {
  * @input_fence_timeout_ns : Cached input fence timeout, in ns
  * @property_blobs: Reference pointers for blob properties
  * @new_perf: new performance state being requested
+ * @perf_fp: fingerprint of the plane configuration and perf properties
  * @is_shared: connector is shared
  * @shared_roi: roi of the shared display
  */
@@ -170,6 +272,7 @@ struct sde_crtc_state {
 	struct drm_property_blob *property_blobs[CRTC_PROP_COUNT];
 
 	struct sde_core_perf_params new_perf;
+	u32 perf_fp;
 	bool is_shared;
 	struct sde_rect shared_roi;
 };
@@ -222,6 +325,21 @@ int sde_crtc_vblank(struct drm_crtc *crtc, bool en);
  */
 void sde_crtc_commit_kickoff(struct drm_crtc *crtc);
 
+/**
+ * sde_crtc_wait_input_fences_async - wait for input fences by callback
+ * @crtc: Pointer to drm crtc object, with its new state swapped in
+ * @ready: Callback run once every plane's input fence has signaled, or the
+ *         input fence timeout expired. Called from fence signal, timer or
+ *         the caller's context, so it must not sleep.
+ * @data: Argument for @ready
+ *
+ * Lets the caller queue the commit to the commit thread only when it can
+ * be programmed, instead of blocking the thread in the flush.
+ * Return: Zero if @ready will be or has been called, error code otherwise
+ */
+int sde_crtc_wait_input_fences_async(struct drm_crtc *crtc,
+		void (*ready)(void *data), void *data);
+
 /**
  * sde_crtc_prepare_commit - callback to prepare for output fences
  * @crtc: Pointer to drm crtc object
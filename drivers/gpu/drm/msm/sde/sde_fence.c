@@ -35,6 +35,69 @@ int sde_sync_wait(void *fence, long timeout_ms)
 	return sync_fence_wait(fence, timeout_ms);
 }
 
+struct sde_sync_waiter {
+	struct sync_fence_waiter waiter;
+	struct sync_fence *fence;
+	void (*cb)(void *data);
+	void *data;
+};
+
+static void _sde_sync_waiter_cb(struct sync_fence *fence,
+		struct sync_fence_waiter *waiter)
+{
+	struct sde_sync_waiter *w = container_of(waiter,
+			struct sde_sync_waiter, waiter);
+
+	w->cb(w->data);
+}
+
+struct sde_sync_waiter *sde_sync_waiter_create(void (*cb)(void *data),
+		void *data)
+{
+	struct sde_sync_waiter *w;
+
+	if (!cb)
+		return NULL;
+
+	w = kzalloc(sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return NULL;
+
+	sync_fence_waiter_init(&w->waiter, _sde_sync_waiter_cb);
+	w->cb = cb;
+	w->data = data;
+	return w;
+}
+
+void sde_sync_waiter_destroy(struct sde_sync_waiter *waiter)
+{
+	kfree(waiter);
+}
+
+int sde_sync_wait_async(void *fence, struct sde_sync_waiter *waiter)
+{
+	int rc;
+
+	if (!fence || !waiter)
+		return -EINVAL;
+
+	waiter->fence = fence;
+	rc = sync_fence_wait_async(fence, &waiter->waiter);
+	if (rc)
+		waiter->fence = NULL;
+	return rc;
+}
+
+void sde_sync_cancel_async(struct sde_sync_waiter *waiter)
+{
+	if (!waiter || !waiter->fence)
+		return;
+
+	/* fails harmlessly if the fence already ran the callback */
+	sync_fence_cancel_async(waiter->fence, &waiter->waiter);
+	waiter->fence = NULL;
+}
+
 uint32_t sde_sync_get_name_prefix(void *fence)
 {
 	char *name;
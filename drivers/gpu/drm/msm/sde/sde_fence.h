@@ -21,6 +21,8 @@
 #define CHAR_BIT 8 /* define this if limits.h not available */
 #endif
 
+struct sde_sync_waiter;
+
 #ifdef CONFIG_SYNC
 /**
  * sde_sync_get - Query sync fence object from a file handle
@@ -61,6 +63,40 @@ int sde_sync_wait(void *fence, long timeout_ms);
  *         big-endian notation
  */
 uint32_t sde_sync_get_name_prefix(void *fence);
+
+/**
+ * sde_sync_waiter_create - allocate an asynchronous fence waiter
+ * @cb: Callback to run when the waited fence signals, may be atomic context
+ * @data: Argument for @cb
+ *
+ * Return: Pointer to waiter, or NULL
+ */
+struct sde_sync_waiter *sde_sync_waiter_create(void (*cb)(void *data),
+		void *data);
+
+/**
+ * sde_sync_waiter_destroy - free a waiter allocated by sde_sync_waiter_create
+ * @waiter: Pointer to waiter, must not be waiting
+ */
+void sde_sync_waiter_destroy(struct sde_sync_waiter *waiter);
+
+/**
+ * sde_sync_wait_async - run the waiter's callback when a fence signals
+ * @fence: Pointer to sync fence
+ * @waiter: Pointer to idle waiter
+ *
+ * Return: Zero if the callback will run, 1 if the fence has already
+ *         signaled, or negative error code
+ */
+int sde_sync_wait_async(void *fence, struct sde_sync_waiter *waiter);
+
+/**
+ * sde_sync_cancel_async - cancel a wait started by sde_sync_wait_async
+ * @waiter: Pointer to waiter
+ *
+ * Once this returns the waiter's callback is not running and will not run.
+ */
+void sde_sync_cancel_async(struct sde_sync_waiter *waiter);
 #else
 static inline void *sde_sync_get(uint64_t fd)
 {
@@ -80,6 +116,26 @@ static inline uint32_t sde_sync_get_name_prefix(void *fence)
 {
 	return 0x0;
 }
+
+static inline struct sde_sync_waiter *sde_sync_waiter_create(
+		void (*cb)(void *data), void *data)
+{
+	return NULL;
+}
+
+static inline void sde_sync_waiter_destroy(struct sde_sync_waiter *waiter)
+{
+}
+
+static inline int sde_sync_wait_async(void *fence,
+		struct sde_sync_waiter *waiter)
+{
+	return 1;
+}
+
+static inline void sde_sync_cancel_async(struct sde_sync_waiter *waiter)
+{
+}
 #endif
 
 /**
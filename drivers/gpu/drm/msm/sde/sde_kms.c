@@ -477,6 +477,29 @@ retry:
 		sde_crtc_prepare_commit(crtc, old_crtc_state);
 }
 
+static int sde_kms_wait_input_fences_async(struct msm_kms *kms,
+		struct drm_atomic_state *state,
+		void (*ready)(void *data), void *data)
+{
+	struct drm_crtc *crtc, *commit_crtc = NULL;
+	struct drm_crtc_state *crtc_state;
+	int i;
+
+	if (!kms || !state)
+		return -EINVAL;
+
+	/* the commit thread is per crtc, so is the asynchronous wait */
+	for_each_crtc_in_state(state, crtc, crtc_state, i) {
+		if (commit_crtc)
+			return -EINVAL;
+		commit_crtc = crtc;
+	}
+	if (!commit_crtc || !commit_crtc->state->active)
+		return -EINVAL;
+
+	return sde_crtc_wait_input_fences_async(commit_crtc, ready, data);
+}
+
 /**
  * _sde_kms_get_displays - query for underlying display handles and cache them
  * @sde_kms:    Pointer to sde kms structure
@@ -1197,6 +1220,7 @@ static const struct msm_kms_funcs kms_funcs = {
 	.preclose        = sde_kms_preclose,
 	.prepare_fence   = sde_kms_prepare_fence,
 	.prepare_commit  = sde_kms_prepare_commit,
+	.wait_input_fences_async = sde_kms_wait_input_fences_async,
 	.commit          = sde_kms_commit,
 	.complete_commit = sde_kms_complete_commit,
 	.wait_for_crtc_commit_done = sde_kms_wait_for_commit_done,
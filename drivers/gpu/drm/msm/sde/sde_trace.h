@@ -141,6 +141,23 @@ TRACE_EVENT(sde_encoder_underrun,
 		__entry->underrun_cnt)
 );
 
+TRACE_EVENT(sde_crtc_touch_latency,
+	TP_PROTO(u32 crtc_id, s64 input_ts, u32 latency_us),
+	TP_ARGS(crtc_id, input_ts, latency_us),
+	TP_STRUCT__entry(
+			__field(u32, crtc_id)
+			__field(s64, input_ts)
+			__field(u32, latency_us)
+	),
+	TP_fast_assign(
+			__entry->crtc_id = crtc_id;
+			__entry->input_ts = input_ts;
+			__entry->latency_us = latency_us;
+	),
+	TP_printk("crtc:%d input_ts:%lld latency_us:%u", __entry->crtc_id,
+		__entry->input_ts, __entry->latency_us)
+);
+
 TRACE_EVENT(sde_mark_write,
 	TP_PROTO(int pid, const char *name, bool trace_begin),
 	TP_ARGS(pid, name, trace_begin),
@@ -29,6 +29,11 @@
 #include <linux/rcupdate.h>
 #include "input-compat.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/input.h>
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(input_frame);
+
 MODULE_AUTHOR("Vojtech Pavlik <vojtech@suse.cz>");
 MODULE_DESCRIPTION("Input core");
 MODULE_LICENSE("GPL");
@@ -398,8 +403,12 @@ static void input_handle_event(struct input_dev *dev,
 	}
 
 	if (disposition & INPUT_FLUSH) {
-		if (dev->num_vals >= 2)
+		if (dev->num_vals >= 2) {
+			if (trace_input_frame_enabled())
+				trace_input_frame(dev, dev->num_vals,
+						  ktime_get());
 			input_pass_values(dev, dev->vals, dev->num_vals);
+		}
 		dev->num_vals = 0;
 	} else if (dev->num_vals >= dev->max_vals - 2) {
 		dev->vals[dev->num_vals++] = input_value_sync;
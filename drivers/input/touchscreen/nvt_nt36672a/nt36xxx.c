@@ -24,6 +24,7 @@
 #include <linux/proc_fs.h>
 #include <asm/uaccess.h>
 #include <linux/input/mt.h>
+#include <linux/ktime.h>
 #include <linux/wakelock.h>
 #include <linux/of_gpio.h>
 #include <linux/of_irq.h>
@@ -705,6 +706,43 @@ exit:
 }
 #endif
 
+#if NVT_REPORT_LATENCY
+static ssize_t smx3_report_latency_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	ssize_t len = 0;
+	int32_t i;
+
+	mutex_lock(&ts->lock);
+	for (i = 0; i < NVT_LATENCY_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "<%uus: %u\n",
+			250 << i, ts->latency_hist[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, ">=%uus: %u\n",
+		250 << (NVT_LATENCY_BUCKETS - 2), ts->latency_hist[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+		"count: %u avg: %lluus max: %uus\n", ts->latency_cnt,
+		ts->latency_cnt ?
+		div_u64(ts->latency_sum_us, ts->latency_cnt) : 0,
+		ts->latency_max_us);
+	mutex_unlock(&ts->lock);
+
+	return len;
+}
+
+static ssize_t smx3_report_latency_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	mutex_lock(&ts->lock);
+	memset(ts->latency_hist, 0, sizeof(ts->latency_hist));
+	ts->latency_cnt = 0;
+	ts->latency_max_us = 0;
+	ts->latency_sum_us = 0;
+	mutex_unlock(&ts->lock);
+
+	return count;
+}
+#endif
+
 static inline ssize_t smx3_tpnode_store_error(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count)
 {
@@ -756,6 +794,11 @@ static struct device_attribute attrs[] = {
 			smx3_module_pid_show,
 			smx3_tpnode_store_error),
 #endif
+#if NVT_REPORT_LATENCY
+	__ATTR(report_latency, (S_IRUGO | S_IWUSR | S_IWGRP),
+			smx3_report_latency_show,
+			smx3_report_latency_store),
+#endif
 };
 /* sysfs device node end */
 /*---For SMx3 use end---*/
@@ -1505,7 +1548,24 @@ static void nvt_esd_check_func(struct work_struct *work)
 }
 #endif /* #if NVT_TOUCH_ESD_PROTECT */
 
-#define POINT_DATA_LEN 65
+#if NVT_REPORT_LATENCY
+/*
+ * Irq to input_sync() latency, bucket n counts reports that took less
+ * than 250us << n, the last one everything slower.
+ */
+static void nvt_report_latency_update(void)
+{
+	uint32_t us = ktime_us_delta(ktime_get(), ts->irq_time);
+	int32_t bucket = min(fls(us / 250), NVT_LATENCY_BUCKETS - 1);
+
+	ts->latency_hist[bucket]++;
+	ts->latency_cnt++;
+	ts->latency_sum_us += us;
+	if (us > ts->latency_max_us)
+		ts->latency_max_us = us;
+}
+#endif
+
 /*******************************************************
 Description:
 	Novatek touchscreen work function.
@@ -1516,7 +1576,7 @@ return:
 static void nvt_ts_work_func(struct work_struct *work)
 {
 	int32_t ret = -1;
-	uint8_t point_data[POINT_DATA_LEN + 1] = {0};
+	uint8_t *point_data = ts->point_data;
 	uint32_t position = 0;
 	uint32_t input_x = 0;
 	uint32_t input_y = 0;
@@ -1531,6 +1591,8 @@ static void nvt_ts_work_func(struct work_struct *work)
 
 	mutex_lock(&ts->lock);
 
+	/* buf[0] is the register address, the report starts at 0 */
+	point_data[0] = 0;
 	ret = CTP_I2C_READ(ts->client, I2C_FW_Address, point_data, POINT_DATA_LEN + 1);
 	if (ret < 0) {
 		TP_LOGE("CTP_I2C_READ failed.(%d)", ret);
@@ -1669,6 +1731,9 @@ static void nvt_ts_work_func(struct work_struct *work)
 #endif
 
 	input_sync(ts->input_dev);
+#if NVT_REPORT_LATENCY
+	nvt_report_latency_update();
+#endif
 
 XFER_ERROR:
 	enable_irq(ts->client->irq);
@@ -1686,6 +1751,10 @@ return:
 static irqreturn_t nvt_ts_irq_handler(int32_t irq, void *dev_id)
 {
 	disable_irq_nosync(ts->client->irq);
+#if NVT_REPORT_LATENCY
+	/* the irq stays off until the work has reported, no overwrite */
+	ts->irq_time = ktime_get();
+#endif
 
 #if WAKEUP_GESTURE
 	if (bTouchIsAwake == 0) {
@@ -1880,7 +1949,7 @@ static int32_t nvt_ts_probe(struct i2c_client *client, const struct i2c_device_i
 	TP_LOGI("probe start");
 	TP_LOGP("probe start");
 
-	ts = kmalloc(sizeof(struct nvt_ts_data), GFP_KERNEL);
+	ts = kzalloc(sizeof(struct nvt_ts_data), GFP_KERNEL);
 	if (ts == NULL) {
 		TP_LOGE("failed to allocated memory for nvt ts data");
 		TP_LOGP("failed to allocated nvt_ts_data");
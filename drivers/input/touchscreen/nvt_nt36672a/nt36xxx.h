@@ -115,6 +115,7 @@ extern int32_t nvt_read_project_info(void);
 extern const uint16_t touch_key_array[TOUCH_KEY_NUM];
 #endif
 #define TOUCH_FORCE_NUM 1000
+#define POINT_DATA_LEN 65
 
 /* Enable only when module have tp reset pin and connected to host */
 #define NVT_TOUCH_SUPPORT_HW_RST 0
@@ -129,6 +130,8 @@ extern const uint16_t touch_key_array[TOUCH_KEY_NUM];
 extern const uint16_t gesture_key_array[];
 #endif
 #define BOOT_UPDATE_FIRMWARE 1
+#define NVT_REPORT_LATENCY 1
+#define NVT_LATENCY_BUCKETS 8
 #define BOOT_UPDATE_FIRMWARE_NAME "novatek_ts_fw.bin"
 
 /* for DP */
@@ -184,6 +187,15 @@ struct nvt_ts_data {
 	uint8_t sw_fw_ver;
 #endif
 /*---For SMx3 use end---*/
+#if NVT_REPORT_LATENCY
+	ktime_t irq_time;
+	uint32_t latency_hist[NVT_LATENCY_BUCKETS];
+	uint32_t latency_cnt;
+	uint32_t latency_max_us;
+	uint64_t latency_sum_us;
+#endif
+	/* report read buffer, i2c controllers may DMA into it */
+	uint8_t point_data[POINT_DATA_LEN + 1] ____cacheline_aligned;
 };
 
 #if NVT_TOUCH_PROC
@@ -10,10 +10,14 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/dma-contiguous.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-mapping-fast.h>
 #include <linux/io-pgtable-fast.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
 #include <linux/vmalloc.h>
 #include <asm/cacheflush.h>
 #include <asm/dma-iommu.h>
@@ -33,6 +37,23 @@
 #define FAST_PTE_SH_OS             (((av8l_fast_iopte)2) << FAST_PTE_SH_SHIFT)
 #define FAST_PTE_SH_IS             (((av8l_fast_iopte)3) << FAST_PTE_SH_SHIFT)
 
+static bool iova_cache;
+module_param(iova_cache, bool, 0644);
+MODULE_PARM_DESC(iova_cache,
+	"Per-cpu iova caches for mappings attached from now on");
+
+static struct dentry *fast_smmu_debugfs_top;
+
+static void __fast_smmu_lock(struct dma_fast_smmu_mapping *mapping,
+			     unsigned long *flags)
+{
+	if (spin_trylock_irqsave(&mapping->lock, *flags))
+		return;
+
+	atomic_long_inc(&mapping->lock_contended);
+	spin_lock_irqsave(&mapping->lock, *flags);
+}
+
 static pgprot_t __get_dma_pgprot(struct dma_attrs *attrs, pgprot_t prot,
 				 bool coherent)
 {
@@ -187,6 +208,7 @@ static dma_addr_t __fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
 		bool skip_sync = dma_get_attr(DMA_ATTR_SKIP_CPU_SYNC, attrs);
 
 		iommu_tlbiall(mapping->domain);
+		mapping->stale_tlb_flushes++;
 		mapping->have_stale_tlbs = false;
 		av8l_fast_clear_stale_ptes(mapping->pgtbl_pmds,
 				mapping->domain->geometry.aperture_start,
@@ -304,6 +326,130 @@ static void __fast_smmu_free_iova(struct dma_fast_smmu_mapping *mapping,
 	mapping->have_stale_tlbs = true;
 }
 
+/*
+ * Per-cpu iova caches
+ *
+ * Map and unmap of 4K, 8K and 16K buffers take and return iovas through
+ * per-cpu magazines, and only take the mapping lock to move half a
+ * magazine at a time to or from the bitmap.  Cached iovas stay set in
+ * the bitmap, so nobody else can map them and their ptes can be written
+ * without the mapping lock.  Clean iovas came out of
+ * __fast_smmu_alloc_iova(), which already did any TLB invalidation they
+ * needed.  Dirty iovas are never handed out again before going through
+ * __fast_smmu_free_iova(), so the lazy TLB invalidation still sees every
+ * unmapped iova before it can be reused.
+ */
+static int __fast_smmu_cache_order(size_t len)
+{
+	int order = get_order(len);
+
+	if (order >= FAST_IOVA_CACHE_ORDERS || len != FAST_PAGE_SIZE << order)
+		return -1;
+
+	return order;
+}
+
+/* Frees magazine entries above @keep to the bitmap, mapping lock held */
+static void __fast_smmu_mag_free(struct dma_fast_smmu_mapping *mapping,
+				 struct dma_fast_smmu_mag *mag, int order,
+				 bool dirty, unsigned int keep)
+{
+	size_t len = FAST_PAGE_SIZE << order;
+	dma_addr_t iova;
+
+	while (mag->nr > keep) {
+		iova = mag->iovas[--mag->nr];
+		if (dirty)
+			__fast_smmu_free_iova(mapping, iova, len);
+		else
+			bitmap_clear(mapping->bitmap,
+				     (iova - mapping->base) >> FAST_PAGE_SHIFT,
+				     1 << order);
+	}
+}
+
+/* Gives every cached iova back, when the bitmap ran out of space */
+static void __fast_smmu_drain_caches(struct dma_fast_smmu_mapping *mapping)
+{
+	struct dma_fast_smmu_cache *cache;
+	unsigned long flags, cache_flags;
+	int cpu, order;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(mapping->caches, cpu);
+		spin_lock_irqsave(&cache->lock, cache_flags);
+		__fast_smmu_lock(mapping, &flags);
+		for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+			__fast_smmu_mag_free(mapping, &cache->clean[order],
+					     order, false, 0);
+			__fast_smmu_mag_free(mapping, &cache->dirty[order],
+					     order, true, 0);
+		}
+		spin_unlock_irqrestore(&mapping->lock, flags);
+		spin_unlock_irqrestore(&cache->lock, cache_flags);
+	}
+}
+
+static dma_addr_t __fast_smmu_cache_alloc(
+	struct dma_fast_smmu_mapping *mapping, struct dma_attrs *attrs,
+	size_t len)
+{
+	struct dma_fast_smmu_cache *cache;
+	struct dma_fast_smmu_mag *mag;
+	unsigned long flags, cache_flags;
+	dma_addr_t iova = DMA_ERROR_CODE;
+	int order = __fast_smmu_cache_order(len);
+
+	if (order < 0)
+		return DMA_ERROR_CODE;
+
+	cache = raw_cpu_ptr(mapping->caches);
+	spin_lock_irqsave(&cache->lock, cache_flags);
+	mag = &cache->clean[order];
+	if (mag->nr) {
+		cache->hits++;
+	} else {
+		cache->misses++;
+		__fast_smmu_lock(mapping, &flags);
+		while (mag->nr < FAST_IOVA_MAG_SIZE / 2) {
+			iova = __fast_smmu_alloc_iova(mapping, attrs, len);
+			if (iova == DMA_ERROR_CODE)
+				break;
+			mag->iovas[mag->nr++] = iova;
+		}
+		spin_unlock_irqrestore(&mapping->lock, flags);
+	}
+	iova = mag->nr ? mag->iovas[--mag->nr] : DMA_ERROR_CODE;
+	spin_unlock_irqrestore(&cache->lock, cache_flags);
+
+	/* let the caller retry the bitmap with nothing held in caches */
+	if (iova == DMA_ERROR_CODE)
+		__fast_smmu_drain_caches(mapping);
+
+	return iova;
+}
+
+static void __fast_smmu_cache_free(struct dma_fast_smmu_mapping *mapping,
+				   dma_addr_t iova, size_t len)
+{
+	struct dma_fast_smmu_cache *cache;
+	struct dma_fast_smmu_mag *mag;
+	unsigned long flags, cache_flags;
+	int order = __fast_smmu_cache_order(len);
+
+	cache = raw_cpu_ptr(mapping->caches);
+	spin_lock_irqsave(&cache->lock, cache_flags);
+	mag = &cache->dirty[order];
+	if (mag->nr == FAST_IOVA_MAG_SIZE) {
+		__fast_smmu_lock(mapping, &flags);
+		__fast_smmu_mag_free(mapping, mag, order, true,
+				     FAST_IOVA_MAG_SIZE / 2);
+		spin_unlock_irqrestore(&mapping->lock, flags);
+	}
+	mag->iovas[mag->nr++] = iova;
+	spin_unlock_irqrestore(&cache->lock, cache_flags);
+}
+
 
 static void __fast_dma_page_cpu_to_dev(struct page *page, unsigned long off,
 				       size_t size, enum dma_data_direction dir)
@@ -362,7 +508,23 @@ static dma_addr_t fast_smmu_map_page(struct device *dev, struct page *page,
 		__fast_dma_page_cpu_to_dev(phys_to_page(phys_to_map),
 					   offset_from_phys_to_map, size, dir);
 
-	spin_lock_irqsave(&mapping->lock, flags);
+	if (mapping->caches) {
+		iova = __fast_smmu_cache_alloc(mapping, attrs, len);
+		if (iova != DMA_ERROR_CODE) {
+			pmd = iopte_pmd_offset(mapping->pgtbl_pmds,
+				mapping->domain->geometry.aperture_start,
+				iova);
+			if (unlikely(av8l_fast_map_public(pmd, phys_to_map,
+							  len, prot))) {
+				__fast_smmu_cache_free(mapping, iova, len);
+				return DMA_ERROR_CODE;
+			}
+			fast_dmac_clean_range(mapping, pmd, pmd + nptes);
+			return iova + offset_from_phys_to_map;
+		}
+	}
+
+	__fast_smmu_lock(mapping, &flags);
 
 	iova = __fast_smmu_alloc_iova(mapping, attrs, len);
 
@@ -406,7 +568,15 @@ static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
 	if (!skip_sync && !is_coherent)
 		__fast_dma_page_dev_to_cpu(page, offset, size, dir);
 
-	spin_lock_irqsave(&mapping->lock, flags);
+	if (mapping->caches && __fast_smmu_cache_order(len) >= 0) {
+		/* the iova stays allocated until its magazine is drained */
+		av8l_fast_unmap_public(pmd, len);
+		fast_dmac_clean_range(mapping, pmd, pmd + nptes);
+		__fast_smmu_cache_free(mapping, iova - offset, len);
+		return;
+	}
+
+	__fast_smmu_lock(mapping, &flags);
 	av8l_fast_unmap_public(pmd, len);
 	fast_dmac_clean_range(mapping, pmd, pmd + nptes);
 	__fast_smmu_free_iova(mapping, iova, len);
@@ -558,7 +728,7 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 		sg_miter_stop(&miter);
 	}
 
-	spin_lock_irqsave(&mapping->lock, flags);
+	__fast_smmu_lock(mapping, &flags);
 	dma_addr = __fast_smmu_alloc_iova(mapping, attrs, size);
 	if (dma_addr == DMA_ERROR_CODE) {
 		dev_err(dev, "no iova\n");
@@ -600,7 +770,7 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 
 out_unmap:
 	/* need to take the lock again for page tables and iova */
-	spin_lock_irqsave(&mapping->lock, flags);
+	__fast_smmu_lock(mapping, &flags);
 	ptep = iopte_pmd_offset(mapping->pgtbl_pmds,
 		mapping->domain->geometry.aperture_start,
 		dma_addr);
@@ -637,7 +807,7 @@ static void fast_smmu_free(struct device *dev, size_t size,
 	dma_common_free_remap(vaddr, size, VM_USERMAP, false);
 	ptep = iopte_pmd_offset(mapping->pgtbl_pmds,
 		mapping->domain->geometry.aperture_start, dma_handle);
-	spin_lock_irqsave(&mapping->lock, flags);
+	__fast_smmu_lock(mapping, &flags);
 	av8l_fast_unmap_public(ptep, size);
 	fast_dmac_clean_range(mapping, ptep, ptep + count);
 	__fast_smmu_free_iova(mapping, dma_handle, size);
@@ -733,6 +903,57 @@ static const struct dma_map_ops fast_smmu_dma_ops = {
 	.mapping_error = fast_smmu_mapping_error,
 };
 
+static int fast_smmu_stats_show(struct seq_file *s, void *unused)
+{
+	struct dma_fast_smmu_mapping *mapping = s->private;
+	struct dma_fast_smmu_cache *cache;
+	unsigned long hits = 0, misses = 0;
+	int cpu;
+
+	if (mapping->caches) {
+		for_each_possible_cpu(cpu) {
+			cache = per_cpu_ptr(mapping->caches, cpu);
+			hits += READ_ONCE(cache->hits);
+			misses += READ_ONCE(cache->misses);
+		}
+	}
+
+	seq_printf(s, "stale_tlb_flushes: %lu\n",
+		   READ_ONCE(mapping->stale_tlb_flushes));
+	seq_printf(s, "lock_contended: %ld\n",
+		   atomic_long_read(&mapping->lock_contended));
+	seq_printf(s, "iova_cache: %s\n", mapping->caches ? "on" : "off");
+	seq_printf(s, "iova_cache_hits: %lu\n", hits);
+	seq_printf(s, "iova_cache_misses: %lu\n", misses);
+	return 0;
+}
+
+static int fast_smmu_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fast_smmu_stats_show, inode->i_private);
+}
+
+static const struct file_operations fast_smmu_stats_fops = {
+	.open = fast_smmu_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __fast_smmu_init_caches(struct dma_fast_smmu_mapping *fast)
+{
+	int cpu;
+
+	fast->caches = alloc_percpu(struct dma_fast_smmu_cache);
+	if (!fast->caches)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(fast->caches, cpu)->lock);
+
+	return 0;
+}
+
 /**
  * __fast_smmu_create_mapping_sized
  * @base: bottom of the VA range
@@ -768,8 +989,17 @@ static struct dma_fast_smmu_mapping *__fast_smmu_create_mapping_sized(
 		goto err2;
 
 	spin_lock_init(&fast->lock);
+	atomic_long_set(&fast->lock_contended, 0);
+
+	/* stale pte tracking needs the ptes written under the mapping lock */
+	if (iova_cache &&
+	    !IS_ENABLED(CONFIG_IOMMU_IO_PGTABLE_FAST_PROVE_TLB) &&
+	    __fast_smmu_init_caches(fast))
+		goto err3;
 
 	return fast;
+err3:
+	kvfree(fast->bitmap);
 err2:
 	kfree(fast);
 err:
@@ -833,6 +1063,11 @@ int fast_smmu_attach_device(struct device *dev,
 	mapping->fast->notifier.notifier_call = fast_smmu_notify;
 	av8l_register_notify(&mapping->fast->notifier);
 
+	if (fast_smmu_debugfs_top)
+		mapping->fast->debugfs = debugfs_create_file(dev_name(dev),
+			0400, fast_smmu_debugfs_top, mapping->fast,
+			&fast_smmu_stats_fops);
+
 	dev->archdata.mapping = mapping;
 	set_dma_ops(dev, &fast_smmu_dma_ops);
 
@@ -854,7 +1089,17 @@ void fast_smmu_detach_device(struct device *dev,
 	dev->archdata.mapping = NULL;
 	set_dma_ops(dev, NULL);
 
+	debugfs_remove(mapping->fast->debugfs);
+	free_percpu(mapping->fast->caches);
 	kvfree(mapping->fast->bitmap);
 	kfree(mapping->fast);
 }
 EXPORT_SYMBOL(fast_smmu_detach_device);
+
+static int __init fast_smmu_debugfs_init(void)
+{
+	fast_smmu_debugfs_top = debugfs_create_dir("dma-mapping-fast",
+						   iommu_debugfs_top);
+	return 0;
+}
+arch_initcall(fast_smmu_debugfs_init);
@@ -851,10 +851,12 @@ static size_t arm_lpae_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 	size_t unmapped = 0;
 	struct arm_lpae_io_pgtable *data = io_pgtable_ops_to_data(ops);
 	struct io_pgtable *iop = &data->iop;
+	struct io_pgtable_gather gather;
 	arm_lpae_iopte *ptep;
 	int lvl = ARM_LPAE_START_LVL(data);
 
 	ptep = arm_lpae_get_table(data, iova);
+	io_pgtable_gather_init(&gather);
 
 	while (unmapped < size) {
 		size_t ret, size_to_unmap, remaining;
@@ -868,11 +870,11 @@ static size_t arm_lpae_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 				       NULL);
 		if (ret == 0)
 			break;
+		io_pgtable_gather_add(&gather, iova, ret);
 		unmapped += ret;
 		iova += ret;
 	}
-	if (unmapped)
-		iop->cfg.tlb->tlb_flush_all(iop->cookie);
+	io_pgtable_tlb_flush_gather(iop, &gather, 1UL << data->pg_shift);
 
 	return unmapped;
 }
@@ -266,10 +266,13 @@ static size_t av8l_fast_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 	struct io_pgtable *iop = &data->iop;
 	av8l_fast_iopte *ptep = iopte_pmd_offset(data->pmds, data->base, iova);
 	unsigned long nptes = size >> AV8L_FAST_PAGE_SHIFT;
+	struct io_pgtable_gather gather;
 
 	__av8l_fast_unmap(ptep, size, false);
 	dmac_clean_range(ptep, ptep + nptes);
-	iop->cfg.tlb->tlb_flush_all(iop->cookie);
+	io_pgtable_gather_init(&gather);
+	io_pgtable_gather_add(&gather, iova, size);
+	io_pgtable_tlb_flush_gather(iop, &gather, 1UL << AV8L_FAST_PAGE_SHIFT);
 
 	return size;
 }
@@ -98,6 +98,31 @@ void free_io_pgtable_ops(struct io_pgtable_ops *ops)
 
 static atomic_t pages_allocated;
 
+/* 0 keeps invalidating the whole context on every unmap */
+static u32 tlbi_va_max_pages;
+
+void io_pgtable_tlb_flush_gather(struct io_pgtable *iop,
+				 struct io_pgtable_gather *gather,
+				 size_t granule)
+{
+	const struct iommu_gather_ops *tlb = iop->cfg.tlb;
+	unsigned long iova;
+
+	if (gather->end <= gather->start)
+		return;
+
+	if ((gather->end - gather->start) / granule >
+	    READ_ONCE(tlbi_va_max_pages)) {
+		tlb->tlb_flush_all(iop->cookie);
+	} else {
+		for (iova = gather->start; iova < gather->end; iova += granule)
+			tlb->tlb_add_flush(iova, granule, false, iop->cookie);
+		tlb->tlb_sync(iop->cookie);
+	}
+
+	io_pgtable_gather_init(gather);
+}
+
 void *io_pgtable_alloc_pages_exact(struct io_pgtable_cfg *cfg, void *cookie,
 				   size_t size, gfp_t gfp_mask)
 {
@@ -138,6 +163,12 @@ static int io_pgtable_init(void)
 		return -ENODEV;
 	}
 
+	if (!debugfs_create_u32("tlbi_va_max_pages", 0600,
+				io_pgtable_top, &tlbi_va_max_pages)) {
+		debugfs_remove_recursive(io_pgtable_top);
+		return -ENODEV;
+	}
+
 	return 0;
 }
 
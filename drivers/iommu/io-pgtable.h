@@ -174,6 +174,48 @@ struct io_pgtable {
 	struct io_pgtable_ops	ops;
 };
 
+/**
+ * struct io_pgtable_gather - TLB invalidation accumulated over an unmap.
+ *
+ * @start: Lowest iova unmapped so far.
+ * @end:   End of the highest range unmapped so far.
+ *
+ * Page table implementations add every range they clear and invalidate
+ * it all, followed by a single sync, with io_pgtable_tlb_flush_gather().
+ */
+struct io_pgtable_gather {
+	unsigned long		start;
+	unsigned long		end;
+};
+
+static inline void io_pgtable_gather_init(struct io_pgtable_gather *gather)
+{
+	gather->start = ULONG_MAX;
+	gather->end = 0;
+}
+
+static inline void io_pgtable_gather_add(struct io_pgtable_gather *gather,
+					 unsigned long iova, size_t size)
+{
+	gather->start = min(gather->start, iova);
+	gather->end = max(gather->end, iova + size);
+}
+
+/**
+ * io_pgtable_tlb_flush_gather() - Invalidate the range in @gather and reset
+ *                                 it. Ranges of up to the tlbi_va_max_pages
+ *                                 debugfs limit are invalidated by VA, one
+ *                                 @granule at a time, larger ones with
+ *                                 tlb_flush_all.
+ *
+ * @iop:     The page tables the range was unmapped from.
+ * @gather:  The accumulated range.
+ * @granule: Smallest page size of the page tables.
+ */
+void io_pgtable_tlb_flush_gather(struct io_pgtable *iop,
+				 struct io_pgtable_gather *gather,
+				 size_t granule);
+
 /**
  * struct io_pgtable_init_fns - Alloc/free a set of page tables for a
  *                              particular format.
@@ -26,6 +26,9 @@
 #include <linux/scatterlist.h>
 #include <linux/device-mapper.h>
 #include <linux/printk.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
 
 #include <asm/page.h>
 #include <asm/unaligned.h>
@@ -93,13 +96,37 @@ unsigned int num_engines_pfe, pfe_cursor;
 struct crypto_engine_entry *fde_eng, *pfe_eng;
 DEFINE_MUTEX(engine_list_mutex);
 
+/*
+ * Crypto operations in flight on each engine of fde_eng/pfe_eng. Writes go
+ * to the least loaded engine and every operation waits for its engine to
+ * be below engine_budget, so that one engine does not build up a backlog
+ * while the others are idle.
+ */
+static atomic_t *fde_inflight, *pfe_inflight;
+static DECLARE_WAIT_QUEUE_HEAD(engine_wait);
+
+static unsigned int engine_budget = 8;
+module_param(engine_budget, uint, 0644);
+MODULE_PARM_DESC(engine_budget,
+		 "Crypto operations in flight per engine, 0 for no limit");
+
+/* Request latency from map to completion, per data direction */
+struct req_crypt_lat_stats {
+	u64 count;
+	u64 total_us;
+	u64 max_us;
+};
+
+static struct req_crypt_lat_stats req_crypt_stats[2];
+static DEFINE_SPINLOCK(req_crypt_stats_lock);
+
 struct req_dm_crypt_io {
 	struct ice_crypto_setting ice_settings;
 	struct work_struct work;
 	struct request *cloned_request;
 	int error;
 	atomic_t pending;
-	struct timespec start_time;
+	ktime_t start_time;
 	bool should_encrypt;
 	bool should_decrypt;
 	u32 key_id;
@@ -110,6 +137,7 @@ struct req_dm_split_req_io {
 	struct scatterlist *req_split_sg_read;
 	struct req_crypt_result result;
 	struct crypto_engine_entry *engine;
+	atomic_t *inflight;
 	u8 IV[AES_XTS_IV_LEN];
 	int size;
 	struct request *clone;
@@ -188,6 +216,60 @@ static  bool req_crypt_should_deccrypt(struct req_dm_crypt_io *req)
 	return should_deccrypt;
 }
 
+static bool req_crypt_try_claim_engine(atomic_t *inflight)
+{
+	unsigned int budget = READ_ONCE(engine_budget);
+
+	if (atomic_inc_return(inflight) <= budget || !budget)
+		return true;
+
+	atomic_dec(inflight);
+	return false;
+}
+
+static unsigned int req_crypt_least_loaded(atomic_t *inflight,
+					   unsigned int total)
+{
+	unsigned int i, best = 0;
+
+	for (i = 1; i < total; i++)
+		if (atomic_read(&inflight[i]) < atomic_read(&inflight[best]))
+			best = i;
+
+	return best;
+}
+
+/* Returns the index of the claimed engine, or -1 if all are busy */
+static int req_crypt_claim_any_engine(atomic_t *inflight, unsigned int total)
+{
+	unsigned int i = req_crypt_least_loaded(inflight, total);
+
+	return req_crypt_try_claim_engine(&inflight[i]) ? i : -1;
+}
+
+static void req_crypt_release_engine(atomic_t *inflight)
+{
+	atomic_dec(inflight);
+	wake_up(&engine_wait);
+}
+
+static void req_crypt_account(struct req_dm_crypt_io *io)
+{
+	struct req_crypt_lat_stats *stats;
+	unsigned long flags;
+	u64 us;
+
+	us = ktime_us_delta(ktime_get(), io->start_time);
+	stats = &req_crypt_stats[rq_data_dir(io->cloned_request)];
+
+	spin_lock_irqsave(&req_crypt_stats_lock, flags);
+	stats->count++;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+	spin_unlock_irqrestore(&req_crypt_stats_lock, flags);
+}
+
 static void req_crypt_inc_pending(struct req_dm_crypt_io *io)
 {
 	atomic_inc(&io->pending);
@@ -258,6 +340,7 @@ static void req_crypt_dec_pending_decrypt(struct req_dm_crypt_io *io)
 	}
 
 	/* Should never get here if io or Clone is NULL */
+	req_crypt_account(io);
 	dm_end_request(clone, error);
 	atomic_dec(&io->pending);
 	mempool_free(io, req_io_pool);
@@ -277,6 +360,7 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 
 	unsigned int engine_list_total = 0;
 	struct crypto_engine_entry *curr_engine_list = NULL;
+	atomic_t *curr_inflight = NULL;
 	bool split_transfers = 0;
 	sector_t tempiv;
 	struct req_dm_split_req_io *split_io = NULL;
@@ -310,8 +394,19 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 						   (io->key_id == PFE_KEY_ID ?
 							pfe_eng : NULL));
 
+	curr_inflight = (io->key_id == FDE_KEY_ID ? fde_inflight :
+						(io->key_id == PFE_KEY_ID ?
+						pfe_inflight : NULL));
+
 	mutex_unlock(&engine_list_mutex);
 
+	if ((engine_list_total < 1) || (NULL == curr_engine_list)
+	   || (NULL == curr_inflight)) {
+		DMERR("%s Unknown Key ID!\n", __func__);
+		error = DM_REQ_CRYPT_ERROR;
+		goto submit_request;
+	}
+
 	req_sg_read = (struct scatterlist *)mempool_alloc(req_scatterlist_pool,
 								GFP_KERNEL);
 	if (!req_sg_read) {
@@ -370,6 +465,7 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 				sg = sg_next(sg);
 			}
 			split_io[i].engine = &curr_engine_list[i];
+			split_io[i].inflight = &curr_inflight[i];
 			init_completion(&split_io[i].result.completion);
 			memset(&split_io[i].IV, 0, AES_XTS_IV_LEN);
 			tempiv = clone->__sector + (temp_size / SECTOR_SIZE);
@@ -386,7 +482,9 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 			error = DM_REQ_CRYPT_ERROR;
 			goto ablkcipher_req_alloc_failure;
 		}
-		split_io->engine = &curr_engine_list[0];
+		i = req_crypt_least_loaded(curr_inflight, engine_list_total);
+		split_io->engine = &curr_engine_list[i];
+		split_io->inflight = &curr_inflight[i];
 		init_completion(&split_io->result.completion);
 		memcpy(split_io->IV, &clone->__sector, sizeof(sector_t));
 		split_io->req_split_sg_read = req_sg_read;
@@ -442,6 +540,7 @@ static void req_cryptd_crypt_read_plain(struct req_dm_crypt_io *io)
 
 	clone = io->cloned_request;
 
+	req_crypt_account(io);
 	dm_end_request(clone, error);
 	mempool_free(io, req_io_pool);
 }
@@ -471,7 +570,8 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 	struct crypto_engine_entry engine;
 	unsigned int engine_list_total = 0;
 	struct crypto_engine_entry *curr_engine_list = NULL;
-	unsigned int *engine_cursor = NULL;
+	atomic_t *curr_inflight = NULL;
+	int engine_idx = -1;
 
 
 	if (io) {
@@ -512,31 +612,30 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 						(io->key_id == PFE_KEY_ID ?
 						pfe_eng : NULL));
 
-	engine_cursor = (io->key_id == FDE_KEY_ID ? &fde_cursor :
-					(io->key_id == PFE_KEY_ID ? &pfe_cursor
+	curr_inflight = (io->key_id == FDE_KEY_ID ? fde_inflight :
+					(io->key_id == PFE_KEY_ID ? pfe_inflight
 					: NULL));
+	mutex_unlock(&engine_list_mutex);
+
 	if ((engine_list_total < 1) || (NULL == curr_engine_list)
-	   || (NULL == engine_cursor)) {
+	   || (NULL == curr_inflight)) {
 		DMERR("%s Unknown Key ID!\n",
 						   __func__);
 		error = DM_REQ_CRYPT_ERROR;
-		mutex_unlock(&engine_list_mutex);
 		goto ablkcipher_req_alloc_failure;
 	}
 
-	engine = curr_engine_list[*engine_cursor];
-	(*engine_cursor)++;
-	(*engine_cursor) %= engine_list_total;
+	wait_event(engine_wait, (engine_idx = req_crypt_claim_any_engine(
+				curr_inflight, engine_list_total)) >= 0);
+	engine = curr_engine_list[engine_idx];
 
 	err = (dm_qcrypto_func.cipher_set)(req, engine.ce_device,
 				   engine.hw_instance);
 	if (err) {
 		DMERR("%s qcrypto_cipher_set_device_hw failed with err %d\n",
 				__func__, err);
-		mutex_unlock(&engine_list_mutex);
 		goto ablkcipher_req_alloc_failure;
 	}
-	mutex_unlock(&engine_list_mutex);
 
 	init_completion(&result.completion);
 
@@ -659,6 +758,8 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 	blk_recalc_rq_segments(clone);
 
 ablkcipher_req_alloc_failure:
+	if (engine_idx >= 0)
+		req_crypt_release_engine(&curr_inflight[engine_idx]);
 	if (req)
 		ablkcipher_request_free(req);
 
@@ -728,8 +829,10 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 	struct req_crypt_result result;
 	int err = 0;
 	struct crypto_engine_entry *engine = NULL;
+	bool claimed = false;
 
-	if ((!io) || (!io->req_split_sg_read) || (!io->engine)) {
+	if ((!io) || (!io->req_split_sg_read) || (!io->engine) ||
+	    (!io->inflight)) {
 		DMERR("%s Input invalid\n",
 			 __func__);
 		err = DM_REQ_CRYPT_ERROR;
@@ -747,6 +850,8 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 					req_crypt_cipher_complete, &result);
 
 	engine = io->engine;
+	wait_event(engine_wait, req_crypt_try_claim_engine(io->inflight));
+	claimed = true;
 
 	err = (dm_qcrypto_func.cipher_set)(req, engine->ce_device,
 			engine->hw_instance);
@@ -791,6 +896,8 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 	}
 	err = 0;
 ablkcipher_req_alloc_failure:
+	if (claimed)
+		req_crypt_release_engine(io->inflight);
 	if (req)
 		ablkcipher_request_free(req);
 
@@ -871,6 +978,7 @@ static int req_crypt_endio(struct dm_target *ti, struct request *clone,
 
 	/* If it is for ICE, free up req_io and return */
 	if (encryption_mode == DM_REQ_CRYPT_ENCRYPTION_MODE_TRANSPARENT) {
+		req_crypt_account(req_io);
 		mempool_free(req_io, req_io_pool);
 		err = error;
 		goto submit_request;
@@ -884,6 +992,7 @@ static int req_crypt_endio(struct dm_target *ti, struct request *clone,
 			} else
 				bvec.bv_page = NULL;
 		}
+		req_crypt_account(req_io);
 		mempool_free(req_io, req_io_pool);
 		goto submit_request;
 	} else if (rq_data_dir(clone) == READ) {
@@ -928,6 +1037,7 @@ static int req_crypt_map(struct dm_target *ti, struct request *clone,
 	 * queue will get the req_io
 	 */
 	req_io->cloned_request = clone;
+	req_io->start_time = ktime_get();
 	map_context->ptr = req_io;
 	atomic_set(&req_io->pending, 0);
 
@@ -1027,6 +1137,10 @@ static void deconfigure_qcrypto(void)
 	pfe_eng = NULL;
 	kfree(fde_eng);
 	fde_eng = NULL;
+	kfree(pfe_inflight);
+	pfe_inflight = NULL;
+	kfree(fde_inflight);
+	fde_inflight = NULL;
 	mutex_unlock(&engine_list_mutex);
 
 	if (tfm) {
@@ -1121,6 +1235,17 @@ static int configure_qcrypto(void)
 		goto exit_err;
 	}
 
+	fde_inflight = kcalloc(num_engines_fde, sizeof(*fde_inflight),
+			       GFP_KERNEL);
+	pfe_inflight = kcalloc(num_engines_pfe, sizeof(*pfe_inflight),
+			       GFP_KERNEL);
+	if ((num_engines_fde && !fde_inflight) ||
+	    (num_engines_pfe && !pfe_inflight)) {
+		DMERR("%s engine budget allocation failed\n", __func__);
+		mutex_unlock(&engine_list_mutex);
+		goto exit_err;
+	}
+
 	fde_cursor = 0;
 	pfe_cursor = 0;
 
@@ -1308,6 +1433,35 @@ ctr_exit:
 	return err;
 }
 
+static void req_crypt_status(struct dm_target *ti, status_type_t type,
+			     unsigned status_flags, char *result,
+			     unsigned maxlen)
+{
+	struct req_crypt_lat_stats stats[2];
+	unsigned int sz = 0;
+	int i;
+
+	switch (type) {
+	case STATUSTYPE_INFO:
+		spin_lock_irq(&req_crypt_stats_lock);
+		memcpy(stats, req_crypt_stats, sizeof(stats));
+		spin_unlock_irq(&req_crypt_stats_lock);
+
+		/* <count> <avg us> <max us> for reads, then for writes */
+		for (i = READ; i <= WRITE; i++)
+			DMEMIT("%s%llu %llu %llu", i == READ ? "" : " ",
+			       stats[i].count,
+			       stats[i].count ?
+			       div64_u64(stats[i].total_us, stats[i].count) : 0,
+			       stats[i].max_us);
+		break;
+
+	case STATUSTYPE_TABLE:
+		result[0] = '\0';
+		break;
+	}
+}
+
 static int req_crypt_iterate_devices(struct dm_target *ti,
 				 iterate_devices_callout_fn fn, void *data)
 {
@@ -1327,12 +1481,13 @@ EXPORT_SYMBOL(set_qcrypto_func_dm);
 
 static struct target_type req_crypt_target = {
 	.name   = "req-crypt",
-	.version = {1, 0, 0},
+	.version = {1, 1, 0},
 	.module = THIS_MODULE,
 	.ctr    = req_crypt_ctr,
 	.dtr    = req_crypt_dtr,
 	.map_rq = req_crypt_map,
 	.rq_end_io = req_crypt_endio,
+	.status = req_crypt_status,
 	.iterate_devices = req_crypt_iterate_devices,
 };
 
@@ -27,6 +27,8 @@
 #define DM_VERITY_ENV_VAR_NAME		"DM_VERITY_ERR_BLOCK_NR"
 
 #define DM_VERITY_DEFAULT_PREFETCH_SIZE	262144
+#define DM_VERITY_DEFAULT_PARALLEL_BLOCKS	32
+#define DM_VERITY_PREFETCH_SCALE		8	/* max x prefetch_cluster */
 
 #define DM_VERITY_MAX_CORRUPTED_ERRS	100
 
@@ -41,11 +43,28 @@ static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * An io of at least twice this many blocks is split into parts of about
+ * this many blocks, hashed on as many CPUs at once. 0 hashes serially.
+ */
+static unsigned dm_verity_parallel_blocks = DM_VERITY_DEFAULT_PARALLEL_BLOCKS;
+
+module_param_named(parallel_blocks, dm_verity_parallel_blocks, uint, S_IRUGO | S_IWUSR);
+
+struct dm_verity_part {
+	struct work_struct work;
+	atomic_t *pending;
+	struct completion *done;
+	int r;
+	struct dm_verity_io io;	/* must be last, hash_desc etc. follow it */
+};
+
 struct dm_verity_prefetch_work {
 	struct work_struct work;
 	struct dm_verity *v;
 	sector_t block;
 	unsigned n_blocks;
+	unsigned cluster;
 };
 
 /*
@@ -198,6 +217,24 @@ static void verity_hash_at_level(struct dm_verity *v, sector_t block, int level,
 		*offset = idx << (v->hash_dev_block_bits - v->hash_per_block_bits);
 }
 
+/*
+ * With check_at_most_once, hash blocks verified once are trusted once read
+ * back after dm-bufio evicted them, as data blocks are. Blocks repaired by
+ * FEC are not recorded, the device still holds the corrupted copy.
+ */
+static bool verity_hash_block_verified(struct dm_verity *v, sector_t hash_block)
+{
+	return v->verified_hash_blocks &&
+		test_bit(hash_block - v->hash_start, v->verified_hash_blocks);
+}
+
+static void verity_set_hash_block_verified(struct dm_verity *v,
+					   sector_t hash_block)
+{
+	if (v->verified_hash_blocks)
+		set_bit(hash_block - v->hash_start, v->verified_hash_blocks);
+}
+
 /*
  * Handle verification errors.
  */
@@ -283,6 +320,9 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 
 	aux = dm_bufio_get_aux_data(buf);
 
+	if (!aux->hash_verified && verity_hash_block_verified(v, hash_block))
+		aux->hash_verified = 1;
+
 	if (!aux->hash_verified) {
 		if (skip_unverified) {
 			r = 1;
@@ -296,9 +336,13 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 			goto release_ret_r;
 
 		if (likely(memcmp(verity_io_real_digest(v, io), want_digest,
-				  v->digest_size) == 0))
+				  v->digest_size) == 0)) {
 			aux->hash_verified = 1;
-		else if (verity_fec_decode(v, io,
+			verity_set_hash_block_verified(v, hash_block);
+		} else if (io->in_part) {
+			r = -EAGAIN;
+			goto release_ret_r;
+		} else if (verity_fec_decode(v, io,
 					   DM_VERITY_BLOCK_TYPE_METADATA,
 					   hash_block, data, NULL) == 0)
 			aux->hash_verified = 1;
@@ -368,7 +412,7 @@ int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
 				       size_t len))
 {
 	unsigned todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_bio_data_size);
+	struct bio *bio = io->bio;
 
 	do {
 		int r;
@@ -415,9 +459,7 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 					struct dm_verity_io *io,
 					struct bvec_iter *iter)
 {
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_bio_data_size);
-
-	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
+	bio_advance_iter(io->bio, iter, 1 << v->data_dev_block_bits);
 }
 
 /*
@@ -479,6 +521,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 				set_bit(cur_block, v->validated_blocks);
 			continue;
 		}
+		else if (io->in_part)
+			return -EAGAIN;
 		else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
 					   cur_block, NULL, &start) == 0)
 			continue;
@@ -506,11 +550,100 @@ static void verity_finish_io(struct dm_verity_io *io, int error)
 	bio_endio(bio);
 }
 
+static void verity_part_work(struct work_struct *w)
+{
+	struct dm_verity_part *part = container_of(w, struct dm_verity_part,
+						   work);
+
+	part->r = verity_verify_io(&part->io);
+	if (atomic_dec_and_test(part->pending))
+		complete(part->done);
+}
+
+/*
+ * Hash a large io on several CPUs, the first part on this one. The tree
+ * levels leading to the first block are verified here first, so the
+ * parts find the hash blocks they share verified and only hash data.
+ * Returns nonzero if the io has to be verified serially instead, which
+ * also takes care of any mismatch through FEC or the error mode.
+ */
+static int verity_verify_parallel(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	unsigned per = READ_ONCE(dm_verity_parallel_blocks);
+	struct completion done;
+	struct bvec_iter iter;
+	atomic_t pending;
+	size_t part_size;
+	unsigned nr, i, b;
+	bool is_zero;
+	char *parts;
+	int r;
+
+	if (!per || io->n_blocks < 2 * per)
+		return -EAGAIN;
+	nr = min(io->n_blocks / per, num_online_cpus());
+	if (nr < 2)
+		return -EAGAIN;
+	per = DIV_ROUND_UP(io->n_blocks, nr);
+	nr = DIV_ROUND_UP(io->n_blocks, per);
+
+	/* a mismatch is handled once, by the serial pass */
+	io->in_part = true;
+	r = verity_hash_for_block(v, io, io->block,
+				  verity_io_want_digest(v, io), &is_zero);
+	io->in_part = false;
+	if (r)
+		return r;
+
+	part_size = roundup(sizeof(struct dm_verity_part) +
+			    v->shash_descsize + v->digest_size * 2,
+			    __alignof__(struct dm_verity_part));
+	parts = kmalloc_array(nr, part_size, GFP_NOIO);
+	if (!parts)
+		return -ENOMEM;
+
+	atomic_set(&pending, nr - 1);
+	init_completion(&done);
+	iter = io->iter;
+	for (i = 0, b = 0; i < nr; i++, b += per) {
+		struct dm_verity_part *part = (void *)(parts + i * part_size);
+
+		part->pending = &pending;
+		part->done = &done;
+		part->io.v = v;
+		part->io.bio = io->bio;
+		part->io.block = io->block + b;
+		part->io.n_blocks = min(per, io->n_blocks - b);
+		part->io.iter = iter;
+		part->io.in_part = true;
+		bio_advance_iter(io->bio, &iter,
+				 part->io.n_blocks << v->data_dev_block_bits);
+		if (i) {
+			INIT_WORK(&part->work, verity_part_work);
+			queue_work(v->part_wq, &part->work);
+		}
+	}
+
+	r = verity_verify_io(&((struct dm_verity_part *)parts)->io);
+	wait_for_completion(&done);
+	for (i = 1; i < nr && !r; i++)
+		r = ((struct dm_verity_part *)(parts + i * part_size))->r;
+
+	kfree(parts);
+	return r;
+}
+
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
+	int r;
+
+	r = verity_verify_parallel(io);
+	if (r)
+		r = verity_verify_io(io);
 
-	verity_finish_io(io, verity_verify_io(io));
+	verity_finish_io(io, r);
 }
 
 static void verity_end_io(struct bio *bio)
@@ -545,7 +678,7 @@ static void verity_prefetch_io(struct work_struct *work)
 		verity_hash_at_level(v, pw->block, i, &hash_block_start, NULL);
 		verity_hash_at_level(v, pw->block + pw->n_blocks - 1, i, &hash_block_end, NULL);
 		if (!i) {
-			unsigned cluster = ACCESS_ONCE(dm_verity_prefetch_cluster);
+			unsigned cluster = pw->cluster;
 
 			cluster >>= v->data_dev_block_bits;
 			if (unlikely(!cluster))
@@ -567,9 +700,33 @@ no_prefetch_cluster:
 	kfree(pw);
 }
 
+/*
+ * Sequential ios double the prefetch cluster, up to DM_VERITY_PREFETCH_SCALE
+ * times prefetch_cluster, random ones halve it until only the hash blocks
+ * of the io itself are read. The update races between ios, which at worst
+ * takes one more io to adjust.
+ */
+static unsigned verity_prefetch_cluster(struct dm_verity *v,
+					struct dm_verity_io *io)
+{
+	unsigned base = ACCESS_ONCE(dm_verity_prefetch_cluster);
+	unsigned cluster = ACCESS_ONCE(v->prefetch_cluster);
+
+	if (io->block == ACCESS_ONCE(v->prefetch_next))
+		cluster = min_t(unsigned, max(cluster * 2, base),
+				base * DM_VERITY_PREFETCH_SCALE);
+	else
+		cluster /= 2;
+
+	ACCESS_ONCE(v->prefetch_cluster) = cluster;
+	ACCESS_ONCE(v->prefetch_next) = io->block + io->n_blocks;
+	return cluster;
+}
+
 static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 {
 	struct dm_verity_prefetch_work *pw;
+	unsigned cluster = verity_prefetch_cluster(v, io);
 
 	pw = kmalloc(sizeof(struct dm_verity_prefetch_work),
 		GFP_NOIO | __GFP_NORETRY | __GFP_NOMEMALLOC | __GFP_NOWARN);
@@ -581,6 +738,7 @@ static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 	pw->v = v;
 	pw->block = io->block;
 	pw->n_blocks = io->n_blocks;
+	pw->cluster = cluster;
 	queue_work(v->verify_wq, &pw->work);
 }
 
@@ -614,6 +772,8 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 	io = dm_per_bio_data(bio, ti->per_bio_data_size);
 	io->v = v;
 	io->orig_bi_end_io = bio->bi_end_io;
+	io->bio = bio;
+	io->in_part = false;
 	io->block = bio->bi_iter.bi_sector >> (v->data_dev_block_bits - SECTOR_SHIFT);
 	io->n_blocks = bio->bi_iter.bi_size >> v->data_dev_block_bits;
 
@@ -743,10 +903,14 @@ void verity_dtr(struct dm_target *ti)
 	if (v->verify_wq)
 		destroy_workqueue(v->verify_wq);
 
+	if (v->part_wq)
+		destroy_workqueue(v->part_wq);
+
 	if (v->bufio)
 		dm_bufio_client_destroy(v->bufio);
 
 	vfree(v->validated_blocks);
+	vfree(v->verified_hash_blocks);
 	kfree(v->salt);
 	kfree(v->root_digest);
 	kfree(v->zero_digest);
@@ -1094,6 +1258,19 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 	}
 	v->hash_blocks = hash_position;
 
+	if (v->validated_blocks) {
+		v->verified_hash_blocks = vzalloc(BITS_TO_LONGS(v->hash_blocks -
+						v->hash_start) * sizeof(unsigned long));
+		if (!v->verified_hash_blocks) {
+			ti->error = "failed to allocate bitset for check_at_most_once";
+			r = -ENOMEM;
+			goto bad;
+		}
+	}
+
+	v->prefetch_cluster = dm_verity_prefetch_cluster;
+	v->prefetch_next = 0;
+
 	v->bufio = dm_bufio_client_create(v->hash_dev->bdev,
 		1 << v->hash_dev_block_bits, 1, sizeof(struct buffer_aux),
 		dm_bufio_alloc_callback, NULL);
@@ -1118,6 +1295,14 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	/* parts never wait, so they can't starve the kverityd work */
+	v->part_wq = alloc_workqueue("kverityd_part", WQ_CPU_INTENSIVE | WQ_MEM_RECLAIM | WQ_UNBOUND, num_online_cpus());
+	if (!v->part_wq) {
+		ti->error = "Cannot allocate workqueue";
+		r = -ENOMEM;
+		goto bad;
+	}
+
 	ti->per_bio_data_size = sizeof(struct dm_verity_io) +
 				v->shash_descsize + v->digest_size * 2;
 
@@ -58,12 +58,18 @@ struct dm_verity {
 	unsigned corrupted_errs;/* Number of errors for corrupted blocks */
 
 	struct workqueue_struct *verify_wq;
+	struct workqueue_struct *part_wq;	/* parallel hashing of an io */
 
 	/* starting blocks for each tree level. 0 is the lowest level. */
 	sector_t hash_level_block[DM_VERITY_MAX_LEVELS];
 
 	struct dm_verity_fec *fec;	/* forward error correction */
 	unsigned long *validated_blocks; /* bitset blocks validated */
+	unsigned long *verified_hash_blocks; /* same, for hash blocks */
+
+	/* prefetch cluster in bytes, grows with sequential ios */
+	unsigned prefetch_cluster;
+	sector_t prefetch_next;	/* block following the last io */
 };
 
 struct dm_verity_io {
@@ -71,9 +77,12 @@ struct dm_verity_io {
 
 	/* original value of bio->bi_end_io */
 	bio_end_io_t *orig_bi_end_io;
+	struct bio *bio;
 
 	sector_t block;
 	unsigned n_blocks;
+	/* part of an io hashed by a helper worker, leaves errors to the io */
+	bool in_part;
 
 	struct bvec_iter iter;
 
@@ -254,6 +254,26 @@ static int32_t msm_isp_stats_buf_divert(struct vfe_device *vfe_dev,
 	return rc;
 }
 
+static void msm_isp_stats_ring_record(struct vfe_device *vfe_dev,
+	struct msm_isp_event_data *buf_event, struct msm_isp_timestamp *ts)
+{
+	struct isp_kstate *isp_page = vfe_dev->isp_page;
+	struct msm_isp_stats_ring_entry *entry;
+	uint32_t head = isp_page->stats_ring_head;
+
+	entry = &isp_page->stats_ring[head % MSM_ISP_STATS_RING_SIZE];
+	entry->frame_id = buf_event->frame_id;
+	entry->stats_mask = buf_event->u.stats.stats_mask;
+	entry->ts_sec = ts->buf_time.tv_sec;
+	entry->ts_usec = ts->buf_time.tv_usec;
+	memcpy(entry->stats_buf_idxs, buf_event->u.stats.stats_buf_idxs,
+		sizeof(entry->stats_buf_idxs));
+	entry->pd_stats_idx = buf_event->u.stats.pd_stats_idx;
+	/* entry must be visible before the reader sees the new head */
+	smp_wmb();
+	WRITE_ONCE(isp_page->stats_ring_head, head + 1);
+}
+
 static int32_t msm_isp_stats_configure(struct vfe_device *vfe_dev,
 	uint32_t stats_irq_mask, struct msm_isp_timestamp *ts,
 	uint32_t pingpong_status, bool is_composite)
@@ -299,6 +319,8 @@ static int32_t msm_isp_stats_configure(struct vfe_device *vfe_dev,
 		stats_event->stats_mask = comp_stats_type_mask;
 		msm_isp_send_event(vfe_dev,
 			ISP_EVENT_COMP_STATS_NOTIFY, &buf_event);
+		if (READ_ONCE(vfe_dev->isp_page->stats_ring_enable))
+			msm_isp_stats_ring_record(vfe_dev, &buf_event, ts);
 		comp_stats_type_mask = 0;
 	}
 	return result;
@@ -325,6 +347,21 @@ void msm_isp_process_stats_irq(struct vfe_device *vfe_dev,
 	ISP_DBG("%s: vfe %d status: 0x%x\n", __func__, vfe_dev->pdev->id,
 		irq_status0);
 
+	/*
+	 * In stats ring mode all stats done in this irq belong to the same
+	 * frame, report them with one composite event and ring entry.
+	 */
+	if (READ_ONCE(vfe_dev->isp_page->stats_ring_enable)) {
+		for (j = 0; j < num_stats_comp_mask; j++) {
+			if (stats_comp_mask & (1 << j))
+				stats_irq_mask |= atomic_read(
+				&vfe_dev->stats_data.stats_comp_mask[j]);
+		}
+		msm_isp_stats_configure(vfe_dev, stats_irq_mask, ts,
+			pingpong_status, true);
+		return;
+	}
+
 	/* Clear composite mask irq bits, they will be restored by comp mask */
 	for (j = 0; j < num_stats_comp_mask; j++) {
 		stats_irq_mask &= ~atomic_read(
@@ -11,6 +11,9 @@
  */
 #define pr_fmt(fmt) "CAM-BUFMGR %s:%d " fmt, __func__, __LINE__
 
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/seq_file.h>
 #include "msm_generic_buf_mgr.h"
 
 static struct msm_buf_mngr_device *msm_buf_mngr_dev;
@@ -49,35 +52,94 @@ static int32_t msm_buf_mngr_hdl_cont_get_buf(struct msm_buf_mngr_device *dev,
 	return 0;
 }
 
-static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
-	void __user *argp)
+static struct msm_buf_mngr_queue *msm_buf_mngr_get_queue(
+	struct msm_buf_mngr_device *dev, uint32_t session_id,
+	uint32_t stream_id)
 {
-	unsigned long flags;
-	int32_t rc = 0;
-	struct msm_buf_mngr_info *buf_info =
-		(struct msm_buf_mngr_info *)argp;
-	struct msm_get_bufs *new_entry =
-		kzalloc(sizeof(struct msm_get_bufs), GFP_KERNEL);
+	return &dev->queues[hash_32((session_id << 16) ^ stream_id,
+		MSM_BUF_MNGR_QUEUE_BITS)];
+}
 
-	if (!new_entry) {
-		pr_err("%s:No mem\n", __func__);
-		return -ENOMEM;
+/* Called with the queue lock held */
+static struct msm_buf_mngr_stream_stats *msm_buf_mngr_get_stats(
+	struct msm_buf_mngr_queue *q, uint32_t session_id,
+	uint32_t stream_id, bool create)
+{
+	struct msm_buf_mngr_stream_stats *stats;
+
+	list_for_each_entry(stats, &q->streams, entry) {
+		if ((stats->session_id == session_id) &&
+			(stats->stream_id == stream_id))
+			return stats;
 	}
-	INIT_LIST_HEAD(&new_entry->entry);
-	new_entry->vb2_v4l2_buf = dev->vb2_ops.get_buf(buf_info->session_id,
-		buf_info->stream_id);
-	if (!new_entry->vb2_v4l2_buf) {
-		pr_debug("%s:Get buf is null\n", __func__);
-		kfree(new_entry);
-		return -EINVAL;
+	if (!create)
+		return NULL;
+
+	stats = kzalloc(sizeof(*stats), GFP_ATOMIC);
+	if (stats) {
+		stats->session_id = session_id;
+		stats->stream_id = stream_id;
+		list_add_tail(&stats->entry, &q->streams);
 	}
+	return stats;
+}
+
+/* Called with the queue lock held, returns the entry's stream stats */
+static struct msm_buf_mngr_stream_stats *msm_buf_mngr_release_entry(
+	struct msm_buf_mngr_device *dev, struct msm_buf_mngr_queue *q,
+	struct msm_get_bufs *bufs)
+{
+	struct msm_buf_mngr_stream_stats *stats;
+	uint32_t hold_us;
+
+	stats = msm_buf_mngr_get_stats(q, bufs->session_id,
+		bufs->stream_id, false);
+	if (stats) {
+		hold_us = ktime_us_delta(ktime_get(), bufs->get_ts);
+		stats->hold_us_total += hold_us;
+		stats->hold_us_max = max(stats->hold_us_max, hold_us);
+	}
+	list_del_init(&bufs->entry);
+	kmem_cache_free(dev->buf_cache, bufs);
+	return stats;
+}
+
+/* Called with the queue lock held */
+static struct msm_get_bufs *msm_buf_mngr_find_buf(
+	struct msm_buf_mngr_queue *q, struct msm_buf_mngr_info *buf_info)
+{
+	struct msm_get_bufs *bufs;
+
+	list_for_each_entry(bufs, &q->bufs, entry) {
+		if ((bufs->session_id == buf_info->session_id) &&
+			(bufs->stream_id == buf_info->stream_id) &&
+			(bufs->index == buf_info->index))
+			return bufs;
+	}
+	return NULL;
+}
+
+static int32_t msm_buf_mngr_add_buf(struct msm_buf_mngr_device *dev,
+	struct msm_buf_mngr_info *buf_info, struct msm_get_bufs *new_entry)
+{
+	unsigned long flags;
+	int32_t rc = 0;
+	struct msm_buf_mngr_queue *q;
+	struct msm_buf_mngr_stream_stats *stats;
+
 	new_entry->session_id = buf_info->session_id;
 	new_entry->stream_id = buf_info->stream_id;
 	new_entry->index = new_entry->vb2_v4l2_buf->vb2_buf.index;
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	list_add_tail(&new_entry->entry, &dev->buf_qhead);
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
-	buf_info->index = new_entry->vb2_v4l2_buf->vb2_buf.index;
+	new_entry->get_ts = ktime_get();
+	q = msm_buf_mngr_get_queue(dev, buf_info->session_id,
+		buf_info->stream_id);
+	spin_lock_irqsave(&q->lock, flags);
+	list_add_tail(&new_entry->entry, &q->bufs);
+	stats = msm_buf_mngr_get_stats(q, buf_info->session_id,
+		buf_info->stream_id, true);
+	if (stats)
+		stats->gets++;
+	spin_unlock_irqrestore(&q->lock, flags);
 	if (buf_info->type == MSM_CAMERA_BUF_MNGR_BUF_USER) {
 		mutex_lock(&dev->cont_mutex);
 		if (!list_empty(&dev->cont_qhead)) {
@@ -92,21 +154,43 @@ static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
 	return rc;
 }
 
+static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
+	void __user *argp)
+{
+	struct msm_buf_mngr_info *buf_info =
+		(struct msm_buf_mngr_info *)argp;
+	struct msm_get_bufs *new_entry =
+		kmem_cache_zalloc(dev->buf_cache, GFP_KERNEL);
+
+	if (!new_entry) {
+		pr_err("%s:No mem\n", __func__);
+		return -ENOMEM;
+	}
+	INIT_LIST_HEAD(&new_entry->entry);
+	new_entry->vb2_v4l2_buf = dev->vb2_ops.get_buf(buf_info->session_id,
+		buf_info->stream_id);
+	if (!new_entry->vb2_v4l2_buf) {
+		pr_debug("%s:Get buf is null\n", __func__);
+		kmem_cache_free(dev->buf_cache, new_entry);
+		return -EINVAL;
+	}
+	buf_info->index = new_entry->vb2_v4l2_buf->vb2_buf.index;
+	return msm_buf_mngr_add_buf(dev, buf_info, new_entry);
+}
+
 static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 	void *argp)
 {
-	unsigned long flags;
-	int32_t rc = 0;
 	struct msm_buf_mngr_info *buf_info =
 		(struct msm_buf_mngr_info *)argp;
 	struct msm_get_bufs *new_entry =
-		kzalloc(sizeof(struct msm_get_bufs), GFP_KERNEL);
+		kmem_cache_zalloc(dev->buf_cache, GFP_KERNEL);
 
 	if (!new_entry)
 		return -ENOMEM;
 
 	if (!buf_info) {
-		kfree(new_entry);
+		kmem_cache_free(dev->buf_cache, new_entry);
 		return -EIO;
 	}
 
@@ -115,54 +199,38 @@ static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 		buf_info->session_id, buf_info->stream_id, buf_info->index);
 	if (!new_entry->vb2_v4l2_buf) {
 		pr_debug("%s:Get buf is null\n", __func__);
-		kfree(new_entry);
+		kmem_cache_free(dev->buf_cache, new_entry);
 		return -EINVAL;
 	}
-	new_entry->session_id = buf_info->session_id;
-	new_entry->stream_id = buf_info->stream_id;
-	new_entry->index = new_entry->vb2_v4l2_buf->vb2_buf.index;
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	list_add_tail(&new_entry->entry, &dev->buf_qhead);
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
-	if (buf_info->type == MSM_CAMERA_BUF_MNGR_BUF_USER) {
-		mutex_lock(&dev->cont_mutex);
-		if (!list_empty(&dev->cont_qhead)) {
-			rc = msm_buf_mngr_hdl_cont_get_buf(dev, buf_info);
-		} else {
-			pr_err("Nothing mapped in user buf for %d,%d\n",
-				buf_info->session_id, buf_info->stream_id);
-			rc = -EINVAL;
-		}
-		mutex_unlock(&dev->cont_mutex);
-	}
-	return rc;
+	return msm_buf_mngr_add_buf(dev, buf_info, new_entry);
 }
 
 static int32_t msm_buf_mngr_buf_done(struct msm_buf_mngr_device *buf_mngr_dev,
 	struct msm_buf_mngr_info *buf_info)
 {
 	unsigned long flags;
-	struct msm_get_bufs *bufs, *save;
+	struct msm_get_bufs *bufs;
+	struct msm_buf_mngr_queue *q;
+	struct msm_buf_mngr_stream_stats *stats;
 	int32_t ret = -EINVAL;
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
-		if ((bufs->session_id == buf_info->session_id) &&
-			(bufs->stream_id == buf_info->stream_id) &&
-			(bufs->index == buf_info->index)) {
-			ret = buf_mngr_dev->vb2_ops.buf_done
-					(bufs->vb2_v4l2_buf,
-						buf_info->session_id,
-						buf_info->stream_id,
-						buf_info->frame_id,
-						&buf_info->timestamp,
-						buf_info->reserved);
-			list_del_init(&bufs->entry);
-			kfree(bufs);
-			break;
-		}
+	q = msm_buf_mngr_get_queue(buf_mngr_dev, buf_info->session_id,
+		buf_info->stream_id);
+	spin_lock_irqsave(&q->lock, flags);
+	bufs = msm_buf_mngr_find_buf(q, buf_info);
+	if (bufs) {
+		ret = buf_mngr_dev->vb2_ops.buf_done
+				(bufs->vb2_v4l2_buf,
+					buf_info->session_id,
+					buf_info->stream_id,
+					buf_info->frame_id,
+					&buf_info->timestamp,
+					buf_info->reserved);
+		stats = msm_buf_mngr_release_entry(buf_mngr_dev, q, bufs);
+		if (stats)
+			stats->dones++;
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&q->lock, flags);
 	return ret;
 }
 
@@ -170,27 +238,28 @@ static int32_t msm_buf_mngr_buf_error(struct msm_buf_mngr_device *buf_mngr_dev,
 	struct msm_buf_mngr_info *buf_info)
 {
 	unsigned long flags;
-	struct msm_get_bufs *bufs, *save;
+	struct msm_get_bufs *bufs;
+	struct msm_buf_mngr_queue *q;
+	struct msm_buf_mngr_stream_stats *stats;
 	int32_t ret = -EINVAL;
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
-		if ((bufs->session_id == buf_info->session_id) &&
-			(bufs->stream_id == buf_info->stream_id) &&
-			(bufs->index == buf_info->index)) {
-			ret = buf_mngr_dev->vb2_ops.buf_error
-					(bufs->vb2_v4l2_buf,
-						buf_info->session_id,
-						buf_info->stream_id,
-						buf_info->frame_id,
-						&buf_info->timestamp,
-						buf_info->reserved);
-			list_del_init(&bufs->entry);
-			kfree(bufs);
-			break;
-		}
+	q = msm_buf_mngr_get_queue(buf_mngr_dev, buf_info->session_id,
+		buf_info->stream_id);
+	spin_lock_irqsave(&q->lock, flags);
+	bufs = msm_buf_mngr_find_buf(q, buf_info);
+	if (bufs) {
+		ret = buf_mngr_dev->vb2_ops.buf_error
+				(bufs->vb2_v4l2_buf,
+					buf_info->session_id,
+					buf_info->stream_id,
+					buf_info->frame_id,
+					&buf_info->timestamp,
+					buf_info->reserved);
+		stats = msm_buf_mngr_release_entry(buf_mngr_dev, q, bufs);
+		if (stats)
+			stats->errors++;
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&q->lock, flags);
 	return ret;
 }
 
@@ -198,22 +267,23 @@ static int32_t msm_buf_mngr_put_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 	struct msm_buf_mngr_info *buf_info)
 {
 	unsigned long flags;
-	struct msm_get_bufs *bufs, *save;
+	struct msm_get_bufs *bufs;
+	struct msm_buf_mngr_queue *q;
+	struct msm_buf_mngr_stream_stats *stats;
 	int32_t ret = -EINVAL;
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
-		if ((bufs->session_id == buf_info->session_id) &&
-			(bufs->stream_id == buf_info->stream_id) &&
-			(bufs->index == buf_info->index)) {
-			ret = buf_mngr_dev->vb2_ops.put_buf(bufs->vb2_v4l2_buf,
-				buf_info->session_id, buf_info->stream_id);
-			list_del_init(&bufs->entry);
-			kfree(bufs);
-			break;
-		}
+	q = msm_buf_mngr_get_queue(buf_mngr_dev, buf_info->session_id,
+		buf_info->stream_id);
+	spin_lock_irqsave(&q->lock, flags);
+	bufs = msm_buf_mngr_find_buf(q, buf_info);
+	if (bufs) {
+		ret = buf_mngr_dev->vb2_ops.put_buf(bufs->vb2_v4l2_buf,
+			buf_info->session_id, buf_info->stream_id);
+		stats = msm_buf_mngr_release_entry(buf_mngr_dev, q, bufs);
+		if (stats)
+			stats->puts++;
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&q->lock, flags);
 	return ret;
 }
 
@@ -223,15 +293,18 @@ static int32_t msm_generic_buf_mngr_flush(
 {
 	unsigned long flags;
 	struct msm_get_bufs *bufs, *save;
+	struct msm_buf_mngr_queue *q;
 	int32_t ret = -EINVAL;
 	struct timeval ts;
 
-	spin_lock_irqsave(&buf_mngr_dev->buf_q_spinlock, flags);
+	q = msm_buf_mngr_get_queue(buf_mngr_dev, buf_info->session_id,
+		buf_info->stream_id);
+	spin_lock_irqsave(&q->lock, flags);
 	/*
 	 * Sanity check on client buf list, remove buf mgr
 	 * queue entries in case any
 	 */
-	list_for_each_entry_safe(bufs, save, &buf_mngr_dev->buf_qhead, entry) {
+	list_for_each_entry_safe(bufs, save, &q->bufs, entry) {
 		if ((bufs->session_id == buf_info->session_id) &&
 			(bufs->stream_id == buf_info->stream_id)) {
 			ret = buf_mngr_dev->vb2_ops.buf_done(bufs->vb2_v4l2_buf,
@@ -240,17 +313,53 @@ static int32_t msm_generic_buf_mngr_flush(
 			pr_err("Bufs not flushed: str_id = %d buf_index = %d ret = %d\n",
 			buf_info->stream_id, bufs->index,
 			ret);
-			list_del_init(&bufs->entry);
-			kfree(bufs);
+			msm_buf_mngr_release_entry(buf_mngr_dev, q, bufs);
 		}
 	}
-	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
+	spin_unlock_irqrestore(&q->lock, flags);
 	/* Flush the remaining vb2 buffers in stream list */
 	ret = buf_mngr_dev->vb2_ops.flush_buf(buf_info->session_id,
 			buf_info->stream_id);
 	return ret;
 }
 
+/*
+ * Runs one buffer manager command on several buffers. Stops at the
+ * first failure and reports in num_bufs how many were processed; a get
+ * batch returning fewer buffers than asked for is not an error.
+ */
+static int32_t msm_buf_mngr_batch(struct msm_buf_mngr_device *dev,
+	struct msm_buf_mngr_batch_info *batch)
+{
+	uint32_t i;
+	int32_t rc = 0;
+
+	if ((batch->num_bufs > MSM_CAMERA_BUF_MNGR_BATCH_MAX) ||
+		(batch->cmd >= MSM_CAMERA_BUF_MNGR_BATCH_CMD_MAX))
+		return -EINVAL;
+
+	for (i = 0; i < batch->num_bufs; i++) {
+		switch (batch->cmd) {
+		case MSM_CAMERA_BUF_MNGR_BATCH_GET:
+			rc = msm_buf_mngr_get_buf(dev,
+				(void __user *)&batch->bufs[i]);
+			break;
+		case MSM_CAMERA_BUF_MNGR_BATCH_PUT:
+			rc = msm_buf_mngr_put_buf(dev, &batch->bufs[i]);
+			break;
+		default:
+			rc = msm_buf_mngr_buf_done(dev, &batch->bufs[i]);
+			break;
+		}
+		if (rc)
+			break;
+	}
+	batch->num_bufs = i;
+	if (batch->cmd == MSM_CAMERA_BUF_MNGR_BATCH_GET && i)
+		rc = 0;
+	return rc;
+}
+
 static int32_t msm_buf_mngr_find_cont_stream(struct msm_buf_mngr_device *dev,
 					     uint32_t *cnt, uint32_t *tstream,
 					     struct msm_sd_close_ioctl *session)
@@ -315,25 +424,35 @@ static void msm_buf_mngr_sd_shutdown(struct msm_buf_mngr_device *dev,
 {
 	unsigned long flags;
 	struct msm_get_bufs *bufs, *save;
+	struct msm_buf_mngr_stream_stats *stats, *stats_save;
+	struct msm_buf_mngr_queue *q;
+	int i;
 
 	BUG_ON(!dev);
 	BUG_ON(!session);
 
-	spin_lock_irqsave(&dev->buf_q_spinlock, flags);
-	if (!list_empty(&dev->buf_qhead)) {
-		list_for_each_entry_safe(bufs,
-			save, &dev->buf_qhead, entry) {
+	for (i = 0; i < MSM_BUF_MNGR_NUM_QUEUES; i++) {
+		q = &dev->queues[i];
+		spin_lock_irqsave(&q->lock, flags);
+		list_for_each_entry_safe(bufs, save, &q->bufs, entry) {
 			pr_info("%s: Delete invalid bufs =%pK, session_id=%u, bufs->ses_id=%d, str_id=%d, idx=%d\n",
 				__func__, (void *)bufs, session->session,
 				bufs->session_id, bufs->stream_id,
 				bufs->index);
 			if (session->session == bufs->session_id) {
 				list_del_init(&bufs->entry);
-				kfree(bufs);
+				kmem_cache_free(dev->buf_cache, bufs);
 			}
 		}
+		list_for_each_entry_safe(stats, stats_save, &q->streams,
+			entry) {
+			if (session->session == stats->session_id) {
+				list_del(&stats->entry);
+				kfree(stats);
+			}
+		}
+		spin_unlock_irqrestore(&q->lock, flags);
 	}
-	spin_unlock_irqrestore(&dev->buf_q_spinlock, flags);
 	mutex_lock(&dev->cont_mutex);
 	if (!list_empty(&dev->cont_qhead))
 		msm_buf_mngr_contq_cleanup(dev, session);
@@ -524,6 +643,20 @@ int msm_cam_buf_mgr_ops(unsigned int cmd, void *argp)
 				tmp);
 			}
 			break;
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_BATCH: {
+			struct msm_buf_mngr_batch_info *tmp = NULL;
+
+			if (!k_ioctl->ioctl_ptr)
+				return -EINVAL;
+			if (k_ioctl->size !=
+				sizeof(struct msm_buf_mngr_batch_info))
+				return -EINVAL;
+
+			MSM_CAM_GET_IOCTL_ARG_PTR(&tmp, &k_ioctl->ioctl_ptr,
+				sizeof(tmp));
+			rc = msm_buf_mngr_batch(msm_buf_mngr_dev, tmp);
+			}
+			break;
 		default:
 			pr_debug("unimplemented id %d", k_ioctl->id);
 			return -EINVAL;
@@ -590,6 +723,35 @@ static long msm_buf_mngr_subdev_ioctl(struct v4l2_subdev *sd,
 			rc = msm_cam_buf_mgr_ops(cmd, argp);
 			}
 			break;
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_BATCH: {
+			struct msm_buf_mngr_batch_info *batch, *tmp = NULL;
+
+			if (k_ioctl.size !=
+				sizeof(struct msm_buf_mngr_batch_info))
+				return -EINVAL;
+			if (!k_ioctl.ioctl_ptr)
+				return -EINVAL;
+			/* 32 bit clients are refused by the compat handler */
+			batch = kmalloc(sizeof(*batch), GFP_KERNEL);
+			if (!batch)
+				return -ENOMEM;
+			MSM_CAM_GET_IOCTL_ARG_PTR(&tmp,
+				&k_ioctl.ioctl_ptr, sizeof(tmp));
+			if (copy_from_user(batch, (void __user *)tmp,
+				sizeof(*batch))) {
+				kfree(batch);
+				return -EFAULT;
+			}
+			k_ioctl.ioctl_ptr = (uintptr_t)batch;
+
+			argp = &k_ioctl;
+			rc = msm_cam_buf_mgr_ops(cmd, argp);
+			if (copy_to_user((void __user *)tmp, batch,
+				sizeof(*batch)))
+				rc = -EFAULT;
+			kfree(batch);
+			}
+			break;
 		default:
 			pr_debug("unimplemented id %d", k_ioctl.id);
 			return -EINVAL;
@@ -824,6 +986,64 @@ static long msm_bmgr_subdev_fops_compat_ioctl(struct file *file,
 }
 #endif
 
+#ifdef CONFIG_DEBUG_FS
+static int msm_buf_mngr_stats_show(struct seq_file *s, void *unused)
+{
+	struct msm_buf_mngr_device *dev = s->private;
+	struct msm_buf_mngr_stream_stats *stats;
+	struct msm_buf_mngr_queue *q;
+	unsigned long flags;
+	int i;
+
+	seq_puts(s, "session stream     gets    dones   errors     puts avg_hold_us max_hold_us\n");
+	for (i = 0; i < MSM_BUF_MNGR_NUM_QUEUES; i++) {
+		q = &dev->queues[i];
+		spin_lock_irqsave(&q->lock, flags);
+		list_for_each_entry(stats, &q->streams, entry) {
+			uint32_t released = stats->dones + stats->errors +
+				stats->puts;
+
+			seq_printf(s, "%7u %6u %8u %8u %8u %8u %11llu %11u\n",
+				stats->session_id, stats->stream_id,
+				stats->gets, stats->dones, stats->errors,
+				stats->puts, released ?
+				div_u64(stats->hold_us_total, released) : 0,
+				stats->hold_us_max);
+		}
+		spin_unlock_irqrestore(&q->lock, flags);
+	}
+	return 0;
+}
+
+static int msm_buf_mngr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_buf_mngr_stats_show, inode->i_private);
+}
+
+static const struct file_operations msm_buf_mngr_stats_fops = {
+	.open = msm_buf_mngr_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void msm_buf_mngr_debugfs_init(struct msm_buf_mngr_device *dev)
+{
+	dev->debugfs_root = debugfs_create_dir("msm_buf_mngr", NULL);
+	if (IS_ERR_OR_NULL(dev->debugfs_root)) {
+		dev->debugfs_root = NULL;
+		return;
+	}
+	if (!debugfs_create_file("stream_stats", S_IRUGO, dev->debugfs_root,
+		dev, &msm_buf_mngr_stats_fops))
+		pr_warn("NON-FATAL: failed to create stream_stats file\n");
+}
+#else
+static void msm_buf_mngr_debugfs_init(struct msm_buf_mngr_device *dev)
+{
+}
+#endif
+
 static struct v4l2_subdev_core_ops msm_buf_mngr_subdev_core_ops = {
 	.ioctl = msm_buf_mngr_subdev_ioctl,
 };
@@ -864,6 +1084,8 @@ static long msm_buf_subdev_fops_ioctl(struct file *file, unsigned int cmd,
 static int32_t __init msm_buf_mngr_init(void)
 {
 	int32_t rc = 0;
+	int i;
+
 	msm_buf_mngr_dev = kzalloc(sizeof(*msm_buf_mngr_dev),
 		GFP_KERNEL);
 	if (WARN_ON(!msm_buf_mngr_dev)) {
@@ -902,8 +1124,18 @@ static int32_t __init msm_buf_mngr_init(void)
 	v4l2_subdev_notify(&msm_buf_mngr_dev->subdev.sd, MSM_SD_NOTIFY_REQ_CB,
 		&msm_buf_mngr_dev->vb2_ops);
 
-	INIT_LIST_HEAD(&msm_buf_mngr_dev->buf_qhead);
-	spin_lock_init(&msm_buf_mngr_dev->buf_q_spinlock);
+	for (i = 0; i < MSM_BUF_MNGR_NUM_QUEUES; i++) {
+		spin_lock_init(&msm_buf_mngr_dev->queues[i].lock);
+		INIT_LIST_HEAD(&msm_buf_mngr_dev->queues[i].bufs);
+		INIT_LIST_HEAD(&msm_buf_mngr_dev->queues[i].streams);
+	}
+	msm_buf_mngr_dev->buf_cache = KMEM_CACHE(msm_get_bufs, 0);
+	if (!msm_buf_mngr_dev->buf_cache) {
+		pr_err("%s: Failed to create buf cache\n", __func__);
+		rc = -ENOMEM;
+		goto end;
+	}
+	msm_buf_mngr_debugfs_init(msm_buf_mngr_dev);
 
 	mutex_init(&msm_buf_mngr_dev->cont_mutex);
 	INIT_LIST_HEAD(&msm_buf_mngr_dev->cont_qhead);
@@ -921,6 +1153,8 @@ end:
 static void __exit msm_buf_mngr_exit(void)
 {
 	msm_sd_unregister(&msm_buf_mngr_dev->subdev);
+	debugfs_remove_recursive(msm_buf_mngr_dev->debugfs_root);
+	kmem_cache_destroy(msm_buf_mngr_dev->buf_cache);
 	mutex_destroy(&msm_buf_mngr_dev->cont_mutex);
 	kfree(msm_buf_mngr_dev);
 }
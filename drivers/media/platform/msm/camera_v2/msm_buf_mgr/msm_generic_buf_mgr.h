@@ -14,6 +14,7 @@
 #define __MSM_BUF_GENERIC_MNGR_H__
 
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
@@ -24,17 +25,46 @@
 #include "msm.h"
 #include "msm_sd.h"
 
+#define MSM_BUF_MNGR_QUEUE_BITS 4
+#define MSM_BUF_MNGR_NUM_QUEUES (1 << MSM_BUF_MNGR_QUEUE_BITS)
+
 struct msm_get_bufs {
 	struct list_head entry;
 	struct vb2_v4l2_buffer *vb2_v4l2_buf;
 	uint32_t session_id;
 	uint32_t stream_id;
 	uint32_t index;
+	ktime_t get_ts;
+};
+
+/* Per stream counters, hold time is from get to done, error or put */
+struct msm_buf_mngr_stream_stats {
+	struct list_head entry;
+	uint32_t session_id;
+	uint32_t stream_id;
+	uint32_t gets;
+	uint32_t dones;
+	uint32_t errors;
+	uint32_t puts;
+	uint64_t hold_us_total;
+	uint32_t hold_us_max;
+};
+
+/*
+ * Buffers handed out to clients, for the streams hashing to this queue.
+ * Each stream always uses the same queue, so streams only contend for a
+ * lock, and walk each other's buffers, when their ids collide.
+ */
+struct msm_buf_mngr_queue {
+	spinlock_t lock;
+	struct list_head bufs;
+	struct list_head streams;
 };
 
 struct msm_buf_mngr_device {
-	struct list_head buf_qhead;
-	spinlock_t buf_q_spinlock;
+	struct msm_buf_mngr_queue queues[MSM_BUF_MNGR_NUM_QUEUES];
+	struct kmem_cache *buf_cache;
+	struct dentry *debugfs_root;
 	struct ion_client *ion_client;
 	struct msm_sd_subdev subdev;
 	struct msm_sd_req_vb2_q vb2_ops;
@@ -70,6 +70,9 @@
  */
 #define ROT_MAX_HW_BLOCKS 2
 
+/* vote decreases are held back for a frame period at this rate if unknown */
+#define ROT_DEFAULT_FPS 30
+
 #define SDE_REG_BUS_VECTOR_ENTRY(ab_val, ib_val)	\
 	{						\
 		.src = MSM_BUS_MASTER_AMPSS_M0,		\
@@ -93,6 +96,22 @@ static struct msm_bus_scale_pdata rot_reg_bus_scale_table = {
 	.active_only = 1,
 };
 
+static void sde_rotator_count_vote(struct sde_rot_mgr *mgr, u32 *counter)
+{
+	struct sde_rot_vote_stats *stats = &mgr->vote_stats;
+	unsigned long now = jiffies;
+
+	if (time_after_eq(now, stats->window_start + HZ)) {
+		stats->changes_per_sec = time_before(now,
+				stats->window_start + 2 * HZ) ?
+				stats->window_changes : 0;
+		stats->window_changes = 0;
+		stats->window_start = now;
+	}
+	stats->window_changes++;
+	(*counter)++;
+}
+
 static int sde_rotator_bus_scale_set_quota(struct sde_rot_bus_data_type *bus,
 		u64 quota)
 {
@@ -266,18 +285,27 @@ static void sde_rotator_set_clk_rate(struct sde_rot_mgr *mgr,
 	}
 }
 
+static unsigned long sde_rotator_total_clk(struct sde_rot_mgr *mgr)
+{
+	struct sde_rot_file_private *priv;
+	unsigned long total_clk_rate = 0;
+
+	list_for_each_entry(priv, &mgr->file_list, list)
+		total_clk_rate += sde_rotator_clk_rate_calc(mgr, priv);
+
+	return total_clk_rate;
+}
+
 /*
  * Update clock according to all open files on rotator block.
  */
 static int sde_rotator_update_clk(struct sde_rot_mgr *mgr)
 {
-	struct sde_rot_file_private *priv;
-	unsigned long clk_rate, total_clk_rate;
+	unsigned long total_clk_rate = sde_rotator_total_clk(mgr);
 
-	total_clk_rate = 0;
-	list_for_each_entry(priv, &mgr->file_list, list) {
-		clk_rate = sde_rotator_clk_rate_calc(mgr, priv);
-		total_clk_rate += clk_rate;
+	if (total_clk_rate != mgr->clk_vote) {
+		sde_rotator_count_vote(mgr, &mgr->vote_stats.clk_changes);
+		mgr->clk_vote = total_clk_rate;
 	}
 
 	SDEROT_DBG("core_clk %lu\n", total_clk_rate);
@@ -506,7 +534,8 @@ static int sde_rotator_signal_output(struct sde_rot_entry *entry)
 }
 
 static int sde_rotator_import_buffer(struct sde_layer_buffer *buffer,
-	struct sde_mdp_data *data, u32 flags, struct device *dev, bool input)
+	struct sde_mdp_data *data, u32 flags, struct device *dev, bool input,
+	struct sde_mdp_map_cache *cache)
 {
 	int i, ret = 0;
 	struct sde_fb_data planes[SDE_ROT_MAX_PLANES];
@@ -531,7 +560,8 @@ static int sde_rotator_import_buffer(struct sde_layer_buffer *buffer,
 	}
 
 	ret =  sde_mdp_data_get_and_validate_size(data, planes,
-			buffer->plane_count, flags, dev, true, dir, buffer);
+			buffer->plane_count, flags, dev, true, dir, buffer,
+			cache);
 
 	return ret;
 }
@@ -787,7 +817,8 @@ static int sde_rotator_import_data(struct sde_rot_mgr *mgr,
 		flag |= SDE_SECURE_CAMERA_SESSION;
 
 	ret = sde_rotator_import_buffer(input, &entry->src_buf, flag,
-				&mgr->pdev->dev, true);
+				&mgr->pdev->dev, true,
+				&entry->private->map_cache);
 	if (ret) {
 		SDEROT_ERR("fail to import input buffer ret=%d\n", ret);
 		return ret;
@@ -798,7 +829,8 @@ static int sde_rotator_import_data(struct sde_rot_mgr *mgr,
 	 * immediately
 	 */
 	ret = sde_rotator_import_buffer(output, &entry->dst_buf, flag,
-				&mgr->pdev->dev, false);
+				&mgr->pdev->dev, false,
+				&entry->private->map_cache);
 	if (ret) {
 		SDEROT_ERR("fail to import output buffer ret=%d\n", ret);
 		return ret;
@@ -1108,7 +1140,17 @@ static int sde_rotator_assign_queue(struct sde_rot_mgr *mgr,
 
 	entry->doneq = &mgr->doneq[wb_idx];
 	entry->commitq = &mgr->commitq[wb_idx];
-	queue = mgr->commitq;
+
+	/*
+	 * By default all entries share the first commit queue and its hw
+	 * resource. With multi_queue each priority commits from its own
+	 * thread into its own hw queue, so a high priority job is not
+	 * stuck behind the setup of a low priority one.
+	 */
+	if (mgr->multi_queue)
+		queue = entry->commitq;
+	else
+		queue = mgr->commitq;
 
 	if (!queue->hw) {
 		hw = mgr->ops_hw_alloc(mgr, pipe_idx, wb_idx);
@@ -1190,6 +1232,7 @@ void sde_rotator_queue_request(struct sde_rot_mgr *mgr,
 		entry = req->entries + i;
 		queue = entry->commitq;
 		entry->output_fence = NULL;
+		entry->queue_ts = ktime_get();
 
 		if (entry->item.ts)
 			entry->item.ts[SDE_ROTATOR_TS_QUEUE] = ktime_get();
@@ -1322,7 +1365,7 @@ static int sde_rotator_calc_perf(struct sde_rot_mgr *mgr,
 	return 0;
 }
 
-static int sde_rotator_update_perf(struct sde_rot_mgr *mgr)
+static u64 sde_rotator_total_bw(struct sde_rot_mgr *mgr)
 {
 	struct sde_rot_file_private *priv;
 	struct sde_rot_perf *perf;
@@ -1339,7 +1382,16 @@ static int sde_rotator_update_perf(struct sde_rot_mgr *mgr)
 		}
 	}
 
-	total_bw += mgr->pending_close_bw_vote;
+	return total_bw + mgr->pending_close_bw_vote;
+}
+
+static int sde_rotator_update_perf(struct sde_rot_mgr *mgr)
+{
+	u64 total_bw = sde_rotator_total_bw(mgr);
+
+	if (total_bw != mgr->data_bus.curr_quota_val)
+		sde_rotator_count_vote(mgr, &mgr->vote_stats.bw_changes);
+
 	sde_rotator_enable_reg_bus(mgr, total_bw);
 	ATRACE_INT("bus_quota", total_bw);
 	sde_rotator_bus_scale_set_quota(&mgr->data_bus, total_bw);
@@ -1347,6 +1399,73 @@ static int sde_rotator_update_perf(struct sde_rot_mgr *mgr)
 	return 0;
 }
 
+/*
+ * Every session is sized for the highest frame rate of all sessions.
+ * When that rate changes, recalculate the sessions already configured
+ * so they all predict the same load, rather than each one keeping the
+ * rate that was current when it was last configured.
+ */
+static void sde_rotator_recalc_sessions(struct sde_rot_mgr *mgr)
+{
+	struct sde_rot_file_private *priv;
+	struct sde_rot_perf *perf;
+	int max_fps = sde_rotator_find_max_fps(mgr);
+
+	if (max_fps == mgr->perf_max_fps)
+		return;
+	mgr->perf_max_fps = max_fps;
+
+	list_for_each_entry(priv, &mgr->file_list, list)
+		list_for_each_entry(perf, &priv->perf_list, list)
+			if (perf->bw || perf->clk_rate)
+				sde_rotator_calc_perf(mgr, perf);
+}
+
+/*
+ * Apply vote increases at once, so a frame is never processed underclocked,
+ * but hold decreases back for one frame period at the session frame rate.
+ * Reconfigurations that bounce between two operating points within a frame
+ * then settle on the higher one instead of toggling clock and bus votes.
+ */
+static int sde_rotator_coalesce_perf(struct sde_rot_mgr *mgr)
+{
+	bool defer = false;
+	int fps, ret = 0;
+
+	if (sde_rotator_total_bw(mgr) >= mgr->data_bus.curr_quota_val)
+		ret = sde_rotator_update_perf(mgr);
+	else
+		defer = true;
+
+	if (sde_rotator_total_clk(mgr) >= mgr->clk_vote)
+		ret = ret ? ret : sde_rotator_update_clk(mgr);
+	else
+		defer = true;
+
+	if (defer) {
+		fps = mgr->perf_max_fps > 0 ? mgr->perf_max_fps :
+				ROT_DEFAULT_FPS;
+		mgr->vote_stats.coalesced++;
+		if (!delayed_work_pending(&mgr->perf_work))
+			schedule_delayed_work(&mgr->perf_work,
+				msecs_to_jiffies(DIV_ROUND_UP(MSEC_PER_SEC,
+							      fps)));
+	}
+
+	return ret;
+}
+
+static void sde_rotator_perf_work(struct work_struct *work)
+{
+	struct sde_rot_mgr *mgr = container_of(to_delayed_work(work),
+			struct sde_rot_mgr, perf_work);
+
+	sde_rot_mgr_lock(mgr);
+	sde_rotator_update_perf(mgr);
+	sde_rotator_update_clk(mgr);
+	sde_rot_mgr_unlock(mgr);
+}
+
 static void sde_rotator_release_from_work_distribution(
 		struct sde_rot_mgr *mgr,
 		struct sde_rot_entry *entry)
@@ -1408,10 +1527,15 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 {
 	struct sde_rot_entry *entry;
 	struct sde_rot_entry_container *request;
-	struct sde_rot_hw_resource *hw;
+	struct sde_rot_hw_resource *hw = NULL;
+	struct sde_rot_queue_stats *stats;
+	struct sde_rot_data_type *mdata = sde_rot_get_mdata();
 	struct sde_rot_mgr *mgr;
 	struct sched_param param = { .sched_priority = 5 };
-	int ret;
+	bool secure, premapped = false;
+	ktime_t start;
+	u32 wait_us;
+	int active, ret;
 
 	entry = container_of(work, struct sde_rot_entry, commit_work);
 	request = entry->request;
@@ -1449,11 +1573,43 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 		entry->dnsc_factor_w, entry->dnsc_factor_h);
 
 	sde_rot_mgr_lock(mgr);
+	stats = &entry->commitq->stats;
+
+	ATRACE_INT("sde_smmu_ctrl", 0);
+	ret = sde_smmu_ctrl(1);
+	if (IS_ERR_VALUE(ret)) {
+		SDEROT_ERR("IOMMU attach failed\n");
+		goto smmu_error;
+	}
+	ATRACE_INT("sde_smmu_ctrl", 1);
+
+	/*
+	 * Map the buffers while the previous jobs are still running, so
+	 * the setup of this job overlaps their execution. A secure mode
+	 * switch must wait until the hw is ours, so map after in that case.
+	 */
+	secure = (entry->item.flags & SDE_ROTATION_SECURE_CAMERA) ?
+			true : false;
+	if (secure == !!mdata->sec_cam_en) {
+		ret = sde_rotator_map_and_check_data(entry);
+		if (ret) {
+			SDEROT_ERR("fail to prepare input/output data %d\n",
+					ret);
+			goto map_error;
+		}
+		premapped = true;
+	}
 
+	start = ktime_get();
 	hw = sde_rotator_get_hw_resource(entry->commitq, entry);
 	if (!hw) {
 		SDEROT_ERR("no hw for the queue\n");
-		goto get_hw_res_err;
+		goto map_error;
+	}
+	wait_us = ktime_us_delta(ktime_get(), start);
+	if (wait_us >= jiffies_to_usecs(1)) {
+		stats->hw_waits++;
+		stats->max_hw_wait_us = max(stats->max_hw_wait_us, wait_us);
 	}
 
 	if (entry->item.ts)
@@ -1471,18 +1627,13 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 		entry->item.dst_rect.x, entry->item.dst_rect.y,
 		entry->item.dst_rect.w, entry->item.dst_rect.h);
 
-	ATRACE_INT("sde_smmu_ctrl", 0);
-	ret = sde_smmu_ctrl(1);
-	if (IS_ERR_VALUE(ret)) {
-		SDEROT_ERR("IOMMU attach failed\n");
-		goto smmu_error;
-	}
-	ATRACE_INT("sde_smmu_ctrl", 1);
-
-	ret = sde_rotator_map_and_check_data(entry);
-	if (ret) {
-		SDEROT_ERR("fail to prepare input/output data %d\n", ret);
-		goto error;
+	if (!premapped) {
+		ret = sde_rotator_map_and_check_data(entry);
+		if (ret) {
+			SDEROT_ERR("fail to prepare input/output data %d\n",
+					ret);
+			goto error;
+		}
 	}
 
 	ret = mgr->ops_config_hw(hw, entry);
@@ -1500,14 +1651,20 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 	if (entry->item.ts)
 		entry->item.ts[SDE_ROTATOR_TS_FLUSH] = ktime_get();
 
+	active = atomic_read(&hw->num_active);
+	stats->jobs++;
+	stats->peak_active = max_t(u32, stats->peak_active, active);
+	stats->total_active += active;
+
 	queue_kthread_work(&entry->doneq->rot_kw, &entry->done_work);
 	sde_rot_mgr_unlock(mgr);
 	return;
 error:
+	sde_rotator_put_hw_resource(entry->commitq, entry, hw);
+map_error:
 	sde_smmu_ctrl(0);
 smmu_error:
-	sde_rotator_put_hw_resource(entry->commitq, entry, hw);
-get_hw_res_err:
+	stats->failed++;
 	sde_rotator_signal_output(entry);
 	sde_rotator_release_entry(mgr, entry);
 	atomic_dec(&request->pending_count);
@@ -1517,6 +1674,26 @@ get_hw_res_err:
 	sde_rot_mgr_unlock(mgr);
 }
 
+/*
+ * sde_rotator_update_queue_stats - account a completed job to its queue
+ * @entry: Pointer to rotation entry
+ * @err: result of waiting for the job
+ *
+ * Caller holds the manager lock.
+ */
+static void sde_rotator_update_queue_stats(struct sde_rot_entry *entry,
+		int err)
+{
+	struct sde_rot_queue_stats *stats = &entry->commitq->stats;
+	u32 latency_us = ktime_us_delta(ktime_get(), entry->queue_ts);
+
+	if (err)
+		stats->failed++;
+	stats->last_latency_us = latency_us;
+	stats->max_latency_us = max(stats->max_latency_us, latency_us);
+	stats->total_latency_us += latency_us;
+}
+
 /*
  * sde_rotator_done_handler - Done workqueue handler.
  * @file: Pointer to work struct.
@@ -1580,6 +1757,7 @@ static void sde_rotator_done_handler(struct kthread_work *work)
 		entry->item.dst_rect.w, entry->item.dst_rect.h);
 
 	sde_rot_mgr_lock(mgr);
+	sde_rotator_update_queue_stats(entry, ret);
 	sde_rotator_put_hw_resource(entry->commitq, entry, entry->commitq->hw);
 	sde_rotator_signal_output(entry);
 	ATRACE_INT("sde_rot_done", 1);
@@ -2199,6 +2377,7 @@ static int sde_rotator_close_session(struct sde_rot_mgr *mgr,
 		offload_release_work = true;
 	}
 	list_del_init(&perf->list);
+	sde_rotator_recalc_sessions(mgr);
 
 	if (offload_release_work)
 		goto done;
@@ -2241,19 +2420,14 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 		SDEROT_ERR("error in configuring the session %d\n", ret);
 		goto done;
 	}
+	sde_rotator_recalc_sessions(mgr);
 
-	ret = sde_rotator_update_perf(mgr);
+	ret = sde_rotator_coalesce_perf(mgr);
 	if (ret) {
 		SDEROT_ERR("error in updating perf: %d\n", ret);
 		goto done;
 	}
 
-	ret = sde_rotator_update_clk(mgr);
-	if (ret) {
-		SDEROT_ERR("error in updating the rotator clk: %d\n", ret);
-		goto done;
-	}
-
 	SDEROT_DBG(
 		"reconfig session id=%u in{%u,%u}f:%u out{%u,%u}f:%u fps:%d clk:%lu, bw:%llu\n",
 		config->session_id, config->input.width, config->input.height,
@@ -2343,6 +2517,7 @@ static int sde_rotator_open(struct sde_rot_mgr *mgr,
 	INIT_LIST_HEAD(&private->req_list);
 	INIT_LIST_HEAD(&private->perf_list);
 	INIT_LIST_HEAD(&private->list);
+	sde_mdp_map_cache_init(&private->map_cache);
 
 	list_add(&private->list, &mgr->file_list);
 
@@ -2384,6 +2559,7 @@ static int sde_rotator_close(struct sde_rot_mgr *mgr,
 	 */
 	sde_rotator_secure_session_ctrl(false);
 	sde_rotator_release_rotator_perf_session(mgr, private);
+	sde_mdp_map_cache_flush(&private->map_cache, NULL);
 
 	list_del_init(&private->list);
 	devm_kfree(&mgr->pdev->dev, private);
@@ -2436,6 +2612,24 @@ static ssize_t sde_rotator_show_state(struct device *dev,
 	SPRINT("footswitch_cnt=%d\n", mgr->res_ref_cnt);
 	SPRINT("regulator_enable=%d\n", mgr->regulator_enable);
 	SPRINT("enable_clk_cnt=%d\n", mgr->rot_enable_clk_cnt);
+	SPRINT("clk_vote_changes=%u\n", mgr->vote_stats.clk_changes);
+	SPRINT("bw_vote_changes=%u\n", mgr->vote_stats.bw_changes);
+	SPRINT("vote_changes_per_sec=%u\n", mgr->vote_stats.changes_per_sec);
+	SPRINT("votes_coalesced=%u\n", mgr->vote_stats.coalesced);
+	SPRINT("multi_queue=%u\n", mgr->multi_queue);
+	for (i = 0; mgr->commitq && i < mgr->queue_count; i++) {
+		struct sde_rot_queue_stats *stats = &mgr->commitq[i].stats;
+
+		SPRINT("commitq%d: jobs=%u failed=%u peak_active=%u avg_active=%llu hw_waits=%u max_hw_wait_us=%u\n",
+			i, stats->jobs, stats->failed, stats->peak_active,
+			stats->jobs ? div_u64(stats->total_active,
+				stats->jobs) : 0,
+			stats->hw_waits, stats->max_hw_wait_us);
+		SPRINT("commitq%d: latency_us last=%u max=%u avg=%llu\n",
+			i, stats->last_latency_us, stats->max_latency_us,
+			stats->jobs ? div_u64(stats->total_latency_us,
+				stats->jobs) : 0);
+	}
 	for (i = 0; i < mgr->num_rot_clk; i++)
 		if (mgr->rot_clk[i].clk)
 			SPRINT("%s=%lu\n", mgr->rot_clk[i].clk_name,
@@ -2786,6 +2980,8 @@ int sde_rotator_core_init(struct sde_rot_mgr **pmgr,
 	mutex_init(&mgr->lock);
 	atomic_set(&mgr->device_suspended, 0);
 	INIT_LIST_HEAD(&mgr->file_list);
+	INIT_DELAYED_WORK(&mgr->perf_work, sde_rotator_perf_work);
+	mgr->vote_stats.window_start = jiffies;
 
 	ret = sysfs_create_group(&mgr->device->kobj,
 			&sde_rotator_fs_attr_group);
@@ -2879,6 +3075,7 @@ void sde_rotator_core_destroy(struct sde_rot_mgr *mgr)
 	}
 
 	dev = mgr->device;
+	cancel_delayed_work_sync(&mgr->perf_work);
 	sde_rotator_deinit_queue(mgr);
 	mgr->ops_hw_destroy(mgr);
 	sde_rotator_release_all(mgr);
@@ -3123,6 +3320,21 @@ void sde_rotator_session_close(struct sde_rot_mgr *mgr,
 	SDEROT_DBG("session closed s:%d\n", session_id);
 }
 
+/*
+ * sde_rotator_session_release_buffer - client is done with a buffer
+ *
+ * Drops the session's cached attachments of the buffer, so it is not
+ * kept alive after the client released it.
+ */
+void sde_rotator_session_release_buffer(struct sde_rot_file_private *private,
+	struct dma_buf *buffer)
+{
+	if (!private || !buffer)
+		return;
+
+	sde_mdp_map_cache_flush(&private->map_cache, buffer);
+}
+
 /*
  * sde_rotator_session_config - external wrapper for config function
  */
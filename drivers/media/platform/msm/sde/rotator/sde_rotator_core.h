@@ -22,6 +22,7 @@
 #include <linux/cdev.h>
 #include <linux/pm_runtime.h>
 #include <linux/kthread.h>
+#include <linux/workqueue.h>
 
 #include "sde_rotator_base.h"
 #include "sde_rotator_util.h"
@@ -184,11 +185,36 @@ struct sde_rot_hw_resource {
 	wait_queue_head_t wait_queue;
 };
 
+/*
+ * struct sde_rot_queue_stats - commit queue occupancy and job latency
+ * @jobs: number of jobs kicked off to hw from this queue
+ * @failed: number of jobs that failed to commit or complete
+ * @peak_active: highest number of jobs active in hw at kickoff
+ * @total_active: sum of jobs active in hw at each kickoff
+ * @hw_waits: number of jobs that had to wait for a free hw slot
+ * @max_hw_wait_us: longest wait for a free hw slot
+ * @last_latency_us: time from queuing to done of the last job
+ * @max_latency_us: longest time from queuing to done
+ * @total_latency_us: sum of times from queuing to done
+ */
+struct sde_rot_queue_stats {
+	u32 jobs;
+	u32 failed;
+	u32 peak_active;
+	u64 total_active;
+	u32 hw_waits;
+	u32 max_hw_wait_us;
+	u32 last_latency_us;
+	u32 max_latency_us;
+	u64 total_latency_us;
+};
+
 struct sde_rot_queue {
 	struct kthread_worker rot_kw;
 	struct task_struct *rot_thread;
 	struct sde_rot_timeline *timeline;
 	struct sde_rot_hw_resource *hw;
+	struct sde_rot_queue_stats stats;
 };
 
 struct sde_rot_entry_container {
@@ -227,6 +253,7 @@ struct sde_rot_entry {
 
 	struct sde_rot_perf *perf;
 	bool work_assigned; /* Used when cleaning up work_distribution */
+	ktime_t queue_ts; /* time the entry was queued for commit */
 	struct sde_rot_file_private *private;
 };
 
@@ -248,6 +275,7 @@ struct sde_rot_file_private {
 	struct list_head perf_list;
 	struct sde_rot_mgr *mgr;
 	struct sde_rot_queue *fenceq;
+	struct sde_mdp_map_cache map_cache;
 };
 
 struct sde_rot_bus_data_type {
@@ -257,6 +285,24 @@ struct sde_rot_bus_data_type {
 	u64 curr_quota_val;
 };
 
+/*
+ * struct sde_rot_vote_stats - clock and bus vote change accounting
+ * @clk_changes: number of core clock vote changes
+ * @bw_changes: number of data bus vote changes
+ * @coalesced: number of vote decreases deferred to the end of a frame
+ * @window_start: start of the current one second window, in jiffies
+ * @window_changes: vote changes in the current window
+ * @changes_per_sec: vote changes in the last complete window
+ */
+struct sde_rot_vote_stats {
+	u32 clk_changes;
+	u32 bw_changes;
+	u32 coalesced;
+	unsigned long window_start;
+	u32 window_changes;
+	u32 changes_per_sec;
+};
+
 struct sde_rot_mgr {
 	struct mutex lock;
 	atomic_t device_suspended;
@@ -293,10 +339,17 @@ struct sde_rot_mgr {
 	u32 wrot_limit;
 
 	u32 hwacquire_timeout;
+	u32 multi_queue; /* commit each priority on its own hw queue */
 	struct sde_mult_factor pixel_per_clk;
 	struct sde_mult_factor fudge_factor;
 	struct sde_mult_factor overhead;
 
+	/* frame rate all session perf was last calculated with */
+	int perf_max_fps;
+	unsigned long clk_vote;
+	struct delayed_work perf_work;
+	struct sde_rot_vote_stats vote_stats;
+
 	int (*ops_config_hw)(struct sde_rot_hw_resource *hw,
 			struct sde_rot_entry *entry);
 	int (*ops_kickoff_entry)(struct sde_rot_hw_resource *hw,
@@ -392,6 +445,9 @@ int sde_rotator_session_open(struct sde_rot_mgr *mgr,
 void sde_rotator_session_close(struct sde_rot_mgr *mgr,
 	struct sde_rot_file_private *private, int session_id);
 
+void sde_rotator_session_release_buffer(struct sde_rot_file_private *private,
+	struct dma_buf *buffer);
+
 int sde_rotator_session_config(struct sde_rot_mgr *mgr,
 	struct sde_rot_file_private *private,
 	struct sde_rotation_config *config);
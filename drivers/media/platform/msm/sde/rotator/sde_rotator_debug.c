@@ -861,6 +861,12 @@ static int sde_rotator_core_create_debugfs(
 		return -EINVAL;
 	}
 
+	if (!debugfs_create_u32("multi_queue", S_IRUGO | S_IWUSR,
+			debugfs_root, &mgr->multi_queue)) {
+		SDEROT_WARN("failed to create debugfs multi queue\n");
+		return -EINVAL;
+	}
+
 	if (!debugfs_create_u32("ppc_numer", S_IRUGO | S_IWUSR,
 			debugfs_root, &mgr->pixel_per_clk.numer)) {
 		SDEROT_WARN("failed to create debugfs ppc numerator\n");
@@ -604,6 +604,8 @@ static void sde_rotator_put_userptr(void *buf_priv)
 			buf->fd, &buf->buffer);
 
 	if (buf->buffer) {
+		sde_rotator_session_release_buffer(buf->ctx->private,
+				buf->buffer);
 		dma_buf_put(buf->buffer);
 		buf->buffer = NULL;
 	}
@@ -769,6 +771,12 @@ static ssize_t sde_rotator_ctx_show(struct kobject *kobj,
 		sde_rotator_get_timeline_commit_ts(ctx->work_queue.timeline));
 	SPRINT("timestamp=%u\n",
 		sde_rotator_get_timeline_retire_ts(ctx->work_queue.timeline));
+	if (ctx->private)
+		SPRINT("map_cache=%u hits=%u misses=%u evictions=%u\n",
+			ctx->private->map_cache.count,
+			ctx->private->map_cache.hits,
+			ctx->private->map_cache.misses,
+			ctx->private->map_cache.evictions);
 	return cnt;
 }
 
@@ -1051,6 +1059,7 @@ static int sde_rotator_release(struct file *file)
 	SDEDEV_DBG(rot_dev->dev, "release session s:%d\n", session_id);
 	sde_rot_mgr_lock(rot_dev->mgr);
 	sde_rotator_session_close(rot_dev->mgr, ctx->private, session_id);
+	ctx->private = NULL;
 	sde_rot_mgr_unlock(rot_dev->mgr);
 	SDEDEV_DBG(rot_dev->dev, "release retire work s:%d\n", session_id);
 	mutex_lock(&rot_dev->lock);
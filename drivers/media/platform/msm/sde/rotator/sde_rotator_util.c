@@ -43,6 +43,34 @@
 #define TILEWIDTH_SIZE  64
 #define TILEHEIGHT_SIZE 4
 
+/*
+ * struct sde_mdp_map_cache_entry - cached attachment of a dma-buf
+ * @list: node on the session's cache lru
+ * @dma_buf: attached buffer, referenced for as long as the entry lives
+ * @attachment: attachment to the rotator smmu device
+ * @table: mapped attachment
+ * @domain: smmu domain the buffer was attached for
+ * @dir: dma direction the attachment was mapped with
+ * @users: planes of in-flight requests using the attachment
+ * @stale: entry was dropped from the cache while in use
+ */
+struct sde_mdp_map_cache_entry {
+	struct list_head list;
+	struct dma_buf *dma_buf;
+	struct dma_buf_attachment *attachment;
+	struct sg_table *table;
+	int domain;
+	int dir;
+	int users;
+	bool stale;
+};
+
+/*
+ * Protects all session caches, so that an attachment still in use when
+ * its session goes away can be released without the session.
+ */
+static DEFINE_MUTEX(sde_mdp_map_cache_lock);
+
 void sde_mdp_get_v_h_subsample_rate(u8 chroma_sample,
 		u8 *v_sample, u8 *h_sample)
 {
@@ -710,6 +738,151 @@ static int sde_smmu_get_domain_type(u32 flags, bool rotator)
 	return type;
 }
 
+static void sde_mdp_map_cache_free(struct sde_mdp_map_cache_entry *ce)
+{
+	dma_buf_unmap_attachment(ce->attachment, ce->table,
+			sde_smmu_set_dma_direction(ce->dir));
+	dma_buf_detach(ce->dma_buf, ce->attachment);
+	dma_buf_put(ce->dma_buf);
+	kfree(ce);
+}
+
+/*
+ * sde_mdp_map_cache_drop - remove an entry from its session cache
+ * @cache: Pointer to the session cache
+ * @ce: Pointer to the entry to remove
+ *
+ * The entry is released now if idle, else by its last user.
+ * Caller holds sde_mdp_map_cache_lock.
+ */
+static void sde_mdp_map_cache_drop(struct sde_mdp_map_cache *cache,
+		struct sde_mdp_map_cache_entry *ce)
+{
+	list_del_init(&ce->list);
+	cache->count--;
+	if (ce->users)
+		ce->stale = true;
+	else
+		sde_mdp_map_cache_free(ce);
+}
+
+/*
+ * sde_mdp_map_cache_get - get a cached attachment for an image plane
+ * @cache: Pointer to the session cache
+ * @data: Pointer to the image plane, with srcp_dma_buf set
+ * @dev: Device to attach the buffer to
+ * @domain: smmu domain of the plane
+ * @dir: dma direction of the plane
+ *
+ * Attaching and mapping is done once per buffer, direction and domain;
+ * later requests with the same buffer reuse the attachment until it is
+ * evicted or its buffer is released by the client.
+ */
+static int sde_mdp_map_cache_get(struct sde_mdp_map_cache *cache,
+		struct sde_mdp_img_data *data, struct device *dev,
+		int domain, int dir)
+{
+	struct sde_mdp_map_cache_entry *ce, *victim, *next;
+	int ret = 0;
+
+	mutex_lock(&sde_mdp_map_cache_lock);
+	list_for_each_entry(ce, &cache->lru, list) {
+		if (ce->dma_buf == data->srcp_dma_buf &&
+				ce->domain == domain && ce->dir == dir) {
+			list_move(&ce->list, &cache->lru);
+			ce->users++;
+			cache->hits++;
+			goto found;
+		}
+	}
+
+	cache->misses++;
+	ce = kzalloc(sizeof(*ce), GFP_KERNEL);
+	if (!ce) {
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	ce->attachment = sde_smmu_dma_buf_attach(data->srcp_dma_buf, dev,
+			domain);
+	if (IS_ERR(ce->attachment)) {
+		SDEROT_ERR("%d Failed to attach dma buf\n", __LINE__);
+		ret = PTR_ERR(ce->attachment);
+		goto err_free;
+	}
+
+	ce->table = dma_buf_map_attachment(ce->attachment,
+			sde_smmu_set_dma_direction(dir));
+	if (IS_ERR(ce->table)) {
+		SDEROT_ERR("%d Failed to map attachment\n", __LINE__);
+		ret = PTR_ERR(ce->table);
+		goto err_detach;
+	}
+
+	get_dma_buf(data->srcp_dma_buf);
+	ce->dma_buf = data->srcp_dma_buf;
+	ce->domain = domain;
+	ce->dir = dir;
+	ce->users = 1;
+	list_add(&ce->list, &cache->lru);
+	cache->count++;
+
+	/* evict idle attachments from the tail */
+	list_for_each_entry_safe_reverse(victim, next, &cache->lru, list) {
+		if (cache->count <= SDE_MDP_MAP_CACHE_SIZE)
+			break;
+		if (victim->users)
+			continue;
+		sde_mdp_map_cache_drop(cache, victim);
+		cache->evictions++;
+	}
+found:
+	data->srcp_attachment = ce->attachment;
+	data->srcp_table = ce->table;
+	data->cached = ce;
+	data->skip_detach = true;
+	goto done;
+
+err_detach:
+	dma_buf_detach(data->srcp_dma_buf, ce->attachment);
+err_free:
+	kfree(ce);
+done:
+	mutex_unlock(&sde_mdp_map_cache_lock);
+	return ret;
+}
+
+static void sde_mdp_map_cache_put(struct sde_mdp_map_cache_entry *ce)
+{
+	mutex_lock(&sde_mdp_map_cache_lock);
+	if (!--ce->users && ce->stale)
+		sde_mdp_map_cache_free(ce);
+	mutex_unlock(&sde_mdp_map_cache_lock);
+}
+
+void sde_mdp_map_cache_init(struct sde_mdp_map_cache *cache)
+{
+	memset(cache, 0, sizeof(*cache));
+	INIT_LIST_HEAD(&cache->lru);
+}
+
+/*
+ * sde_mdp_map_cache_flush - drop cached attachments of a session
+ * @cache: Pointer to the session cache
+ * @dma_buf: Buffer whose attachments are dropped, or NULL for all
+ */
+void sde_mdp_map_cache_flush(struct sde_mdp_map_cache *cache,
+		struct dma_buf *dma_buf)
+{
+	struct sde_mdp_map_cache_entry *ce, *tmp;
+
+	mutex_lock(&sde_mdp_map_cache_lock);
+	list_for_each_entry_safe(ce, tmp, &cache->lru, list)
+		if (!dma_buf || ce->dma_buf == dma_buf)
+			sde_mdp_map_cache_drop(cache, ce);
+	mutex_unlock(&sde_mdp_map_cache_lock);
+}
+
 static int sde_mdp_put_img(struct sde_mdp_img_data *data, bool rotator,
 		int dir)
 {
@@ -728,7 +901,11 @@ static int sde_mdp_put_img(struct sde_mdp_img_data *data, bool rotator,
 			SDEROT_DBG("unmap %pad/%lx d:%u f:%x\n", &data->addr,
 					data->len, domain, data->flags);
 		}
-		if (!data->skip_detach) {
+		if (data->cached) {
+			sde_mdp_map_cache_put(data->cached);
+			data->cached = NULL;
+			data->skip_detach = false;
+		} else if (!data->skip_detach) {
 			dma_buf_unmap_attachment(data->srcp_attachment,
 				data->srcp_table,
 				sde_smmu_set_dma_direction(dir));
@@ -755,7 +932,7 @@ static int sde_mdp_is_map_needed(struct sde_mdp_img_data *data)
 
 static int sde_mdp_get_img(struct sde_fb_data *img,
 		struct sde_mdp_img_data *data, struct device *dev,
-		bool rotator, int dir)
+		bool rotator, int dir, struct sde_mdp_map_cache *cache)
 {
 	int ret = -EINVAL;
 	unsigned long *len;
@@ -789,6 +966,15 @@ static int sde_mdp_get_img(struct sde_fb_data *img,
 
 		SDEROT_DBG("%d domain=%d ihndl=%p\n",
 				__LINE__, domain, data->srcp_dma_buf);
+		data->addr = 0;
+		data->len = 0;
+		data->mapped = false;
+
+		/* client owned buffers can stay attached across requests */
+		if (cache && (data->flags & SDE_ROT_EXT_DMA_BUF))
+			return sde_mdp_map_cache_get(cache, data, dev, domain,
+					dir);
+
 		data->srcp_attachment =
 			sde_smmu_dma_buf_attach(data->srcp_dma_buf, dev,
 					domain);
@@ -938,7 +1124,8 @@ err_unmap:
 
 static int sde_mdp_data_get(struct sde_mdp_data *data,
 		struct sde_fb_data *planes, int num_planes, u32 flags,
-		struct device *dev, bool rotator, int dir)
+		struct device *dev, bool rotator, int dir,
+		struct sde_mdp_map_cache *cache)
 {
 	int i, rc = 0;
 
@@ -948,7 +1135,7 @@ static int sde_mdp_data_get(struct sde_mdp_data *data,
 	for (i = 0; i < num_planes; i++) {
 		data->p[i].flags = flags;
 		rc = sde_mdp_get_img(&planes[i], &data->p[i], dev, rotator,
-				dir);
+				dir, cache);
 		if (rc) {
 			SDEROT_ERR("failed to get buf p=%d flags=%x\n",
 					i, flags);
@@ -1002,7 +1189,7 @@ void sde_mdp_data_free(struct sde_mdp_data *data, bool rotator, int dir)
 int sde_mdp_data_get_and_validate_size(struct sde_mdp_data *data,
 	struct sde_fb_data *planes, int num_planes, u32 flags,
 	struct device *dev, bool rotator, int dir,
-	struct sde_layer_buffer *buffer)
+	struct sde_layer_buffer *buffer, struct sde_mdp_map_cache *cache)
 {
 	struct sde_mdp_format_params *fmt;
 	struct sde_mdp_plane_sizes ps;
@@ -1016,7 +1203,7 @@ int sde_mdp_data_get_and_validate_size(struct sde_mdp_data *data,
 	}
 
 	ret = sde_mdp_data_get(data, planes, num_planes,
-		flags, dev, rotator, dir);
+		flags, dev, rotator, dir, cache);
 	if (ret)
 		return ret;
 
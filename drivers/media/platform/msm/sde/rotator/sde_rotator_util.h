@@ -19,6 +19,7 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/dma-buf.h>
+#include <linux/list.h>
 #include <linux/msm_ion.h>
 
 #include "sde_rotator_hwio.h"
@@ -138,6 +139,27 @@ struct sde_mdp_plane_sizes {
 	u32 rau_h[2];
 };
 
+/* maximum number of cached dma-buf attachments per session */
+#define SDE_MDP_MAP_CACHE_SIZE		8
+
+struct sde_mdp_map_cache_entry;
+
+/*
+ * struct sde_mdp_map_cache - per session LRU of dma-buf attachments
+ * @lru: cached attachments, most recently used first
+ * @count: number of attachments on @lru
+ * @hits: lookups served from the cache
+ * @misses: lookups that had to attach and map the buffer
+ * @evictions: idle attachments dropped to make room for a new one
+ */
+struct sde_mdp_map_cache {
+	struct list_head lru;
+	u32 count;
+	u32 hits;
+	u32 misses;
+	u32 evictions;
+};
+
 struct sde_mdp_img_data {
 	dma_addr_t addr;
 	unsigned long len;
@@ -149,6 +171,7 @@ struct sde_mdp_img_data {
 	struct dma_buf *srcp_dma_buf;
 	struct dma_buf_attachment *srcp_attachment;
 	struct sg_table *srcp_table;
+	struct sde_mdp_map_cache_entry *cached;
 };
 
 enum sde_data_state {
@@ -186,7 +209,12 @@ int sde_validate_offset_for_ubwc_format(
 int sde_mdp_data_get_and_validate_size(struct sde_mdp_data *data,
 	struct sde_fb_data *planes, int num_planes, u32 flags,
 	struct device *dev, bool rotator, int dir,
-	struct sde_layer_buffer *buffer);
+	struct sde_layer_buffer *buffer, struct sde_mdp_map_cache *cache);
+
+void sde_mdp_map_cache_init(struct sde_mdp_map_cache *cache);
+
+void sde_mdp_map_cache_flush(struct sde_mdp_map_cache *cache,
+	struct dma_buf *dma_buf);
 
 int sde_mdp_get_plane_sizes(struct sde_mdp_format_params *fmt, u32 w, u32 h,
 	struct sde_mdp_plane_sizes *ps, u32 bwc_mode,
@@ -18,10 +18,12 @@
 #include <linux/iommu.h>
 #include <linux/msm_dma_iommu_mapping.h>
 #include <linux/msm_ion.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include "media/msm_vidc.h"
 #include "msm_vidc_debug.h"
+#include "msm_vidc_internal.h"
 #include "msm_vidc_resources.h"
 
 struct smem_client {
@@ -31,6 +33,34 @@ struct smem_client {
 	enum session_type session_type;
 };
 
+#define SMEM_POOL_BUFFER_TYPES (HAL_BUFFER_INTERNAL_SCRATCH | \
+		HAL_BUFFER_INTERNAL_SCRATCH_1 | HAL_BUFFER_INTERNAL_SCRATCH_2 | \
+		HAL_BUFFER_INTERNAL_PERSIST | HAL_BUFFER_INTERNAL_PERSIST_1)
+
+struct smem_pool_entry {
+	struct list_head list;
+	struct msm_smem mem;
+};
+
+/*
+ * Recycle pool for internal buffers. Scratch and persist buffers of a
+ * closed session stay allocated and mapped, so the next session asking
+ * for the same size skips the ION allocation and SMMU mapping. Pooled
+ * buffers are allocated from an ION client owned by the pool, as the
+ * session's client and its handles go away when the session closes.
+ */
+static struct {
+	struct mutex lock;
+	struct list_head entries;	/* oldest first */
+	struct smem_client client;
+	size_t bytes;
+	u32 count;
+	u32 hits;
+	u32 misses;
+	u32 shrunk;
+	struct shrinker shrinker;
+} smem_pool;
+
 static int get_device_address(struct smem_client *smem_client,
 		struct ion_handle *hndl, unsigned long align,
 		ion_phys_addr_t *iova, unsigned long *buffer_size,
@@ -426,6 +456,166 @@ static void free_ion_mem(struct smem_client *client, struct msm_smem *mem)
 	}
 }
 
+static void *ion_new_client(void);
+
+static bool smem_pool_eligible(struct smem_client *client, u32 align,
+		u32 flags, enum hal_buffer buffer_type, int map_kernel)
+{
+	return msm_vidc_smem_pool_kb && client->mem_type == SMEM_ION &&
+		is_iommu_present(client->res) &&
+		(buffer_type & SMEM_POOL_BUFFER_TYPES) &&
+		!(flags & SMEM_SECURE) && !map_kernel && align <= SZ_4K;
+}
+
+/* Returns -ENOENT if the buffer cannot come from the pool */
+static int smem_pool_alloc(struct smem_client *client, size_t size,
+		u32 align, u32 flags, enum hal_buffer buffer_type,
+		struct msm_smem *mem, int map_kernel)
+{
+	struct smem_pool_entry *entry;
+	int rc;
+
+	if (!smem_pool_eligible(client, align, flags, buffer_type,
+				map_kernel))
+		return -ENOENT;
+
+	size = ALIGN(size, SZ_4K);
+
+	mutex_lock(&smem_pool.lock);
+	list_for_each_entry(entry, &smem_pool.entries, list) {
+		if (entry->mem.size != size ||
+			entry->mem.buffer_type != buffer_type ||
+			entry->mem.flags != flags)
+			continue;
+
+		list_del(&entry->list);
+		smem_pool.bytes -= size;
+		smem_pool.count--;
+		smem_pool.hits++;
+		mutex_unlock(&smem_pool.lock);
+
+		*mem = entry->mem;
+		kfree(entry);
+		dprintk(VIDC_DBG, "%s: reusing %#zx bytes at %pa, type %#x\n",
+			__func__, size, &mem->device_addr, buffer_type);
+		return 0;
+	}
+
+	smem_pool.misses++;
+	if (!smem_pool.client.clnt) {
+		smem_pool.client.clnt = ion_new_client();
+		smem_pool.client.mem_type = SMEM_ION;
+		smem_pool.client.res = client->res;
+		smem_pool.client.session_type = client->session_type;
+	}
+	mutex_unlock(&smem_pool.lock);
+
+	if (!smem_pool.client.clnt)
+		return -ENOENT;
+
+	rc = alloc_ion_mem(&smem_pool.client, size, align, flags, buffer_type,
+			mem, map_kernel);
+	if (!rc)
+		mem->pooled = true;
+	return rc;
+}
+
+/* Called with the pool lock held */
+static void smem_pool_evict_oldest(void)
+{
+	struct smem_pool_entry *entry;
+
+	entry = list_first_entry(&smem_pool.entries,
+			struct smem_pool_entry, list);
+	list_del(&entry->list);
+	smem_pool.bytes -= entry->mem.size;
+	smem_pool.count--;
+	free_ion_mem(&smem_pool.client, &entry->mem);
+	kfree(entry);
+}
+
+static void smem_pool_free(struct msm_smem *mem)
+{
+	struct smem_pool_entry *entry;
+	size_t limit = (size_t)msm_vidc_smem_pool_kb * SZ_1K;
+
+	entry = mem->size <= limit ?
+		kzalloc(sizeof(*entry), GFP_KERNEL) : NULL;
+	if (!entry) {
+		free_ion_mem(&smem_pool.client, mem);
+		return;
+	}
+
+	entry->mem = *mem;
+	mutex_lock(&smem_pool.lock);
+	list_add_tail(&entry->list, &smem_pool.entries);
+	smem_pool.bytes += mem->size;
+	smem_pool.count++;
+	while (smem_pool.bytes > limit)
+		smem_pool_evict_oldest();
+	mutex_unlock(&smem_pool.lock);
+}
+
+static unsigned long smem_pool_count_objects(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	return smem_pool.count;
+}
+
+static unsigned long smem_pool_scan_objects(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+
+	/* unmapping may allocate, don't wait on an allocating pool user */
+	if (!mutex_trylock(&smem_pool.lock))
+		return SHRINK_STOP;
+
+	while (freed < sc->nr_to_scan && !list_empty(&smem_pool.entries)) {
+		smem_pool_evict_oldest();
+		freed++;
+	}
+	smem_pool.shrunk += freed;
+	mutex_unlock(&smem_pool.lock);
+
+	return freed;
+}
+
+void msm_smem_pool_init(void)
+{
+	mutex_init(&smem_pool.lock);
+	INIT_LIST_HEAD(&smem_pool.entries);
+	smem_pool.shrinker.count_objects = smem_pool_count_objects;
+	smem_pool.shrinker.scan_objects = smem_pool_scan_objects;
+	smem_pool.shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&smem_pool.shrinker))
+		dprintk(VIDC_WARN, "Failed to register smem pool shrinker\n");
+}
+
+void msm_smem_pool_deinit(void)
+{
+	unregister_shrinker(&smem_pool.shrinker);
+
+	mutex_lock(&smem_pool.lock);
+	while (!list_empty(&smem_pool.entries))
+		smem_pool_evict_oldest();
+	if (smem_pool.client.clnt)
+		ion_client_destroy(smem_pool.client.clnt);
+	smem_pool.client.clnt = NULL;
+	mutex_unlock(&smem_pool.lock);
+}
+
+void msm_smem_get_pool_stats(struct msm_smem_pool_stats *stats)
+{
+	mutex_lock(&smem_pool.lock);
+	stats->bytes = smem_pool.bytes;
+	stats->count = smem_pool.count;
+	stats->hits = smem_pool.hits;
+	stats->misses = smem_pool.misses;
+	stats->shrunk = smem_pool.shrunk;
+	mutex_unlock(&smem_pool.lock);
+}
+
 static void *ion_new_client(void)
 {
 	struct ion_client *client = NULL;
@@ -620,8 +810,11 @@ struct msm_smem *msm_smem_alloc(void *clt, size_t size, u32 align, u32 flags,
 	}
 	switch (client->mem_type) {
 	case SMEM_ION:
-		rc = alloc_ion_mem(client, size, align, flags, buffer_type,
+		rc = smem_pool_alloc(client, size, align, flags, buffer_type,
 					mem, map_kernel);
+		if (rc == -ENOENT)
+			rc = alloc_ion_mem(client, size, align, flags,
+					buffer_type, mem, map_kernel);
 		break;
 	default:
 		dprintk(VIDC_ERR, "Mem type not supported\n");
@@ -645,7 +838,10 @@ void msm_smem_free(void *clt, struct msm_smem *mem)
 	}
 	switch (client->mem_type) {
 	case SMEM_ION:
-		free_ion_mem(client, mem);
+		if (mem->pooled)
+			smem_pool_free(mem);
+		else
+			free_ion_mem(client, mem);
 		break;
 	default:
 		dprintk(VIDC_ERR, "Mem type not supported\n");
@@ -769,6 +769,7 @@ static int __init msm_vidc_init(void)
 
 	INIT_LIST_HEAD(&vidc_driver->cores);
 	mutex_init(&vidc_driver->lock);
+	msm_smem_pool_init();
 	vidc_driver->debugfs_root = msm_vidc_debugfs_init_drv();
 	if (!vidc_driver->debugfs_root)
 		dprintk(VIDC_ERR,
@@ -779,6 +780,7 @@ static int __init msm_vidc_init(void)
 		dprintk(VIDC_ERR,
 			"Failed to register platform driver\n");
 		debugfs_remove_recursive(vidc_driver->debugfs_root);
+		msm_smem_pool_deinit();
 		kfree(vidc_driver);
 		vidc_driver = NULL;
 	}
@@ -790,6 +792,7 @@ static void __exit msm_vidc_exit(void)
 {
 	platform_driver_unregister(&msm_vidc_driver);
 	debugfs_remove_recursive(vidc_driver->debugfs_root);
+	msm_smem_pool_deinit();
 	mutex_destroy(&vidc_driver->lock);
 	kfree(vidc_driver);
 	vidc_driver = NULL;
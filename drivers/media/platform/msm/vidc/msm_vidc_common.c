@@ -324,6 +324,10 @@ int msm_comm_get_inst_load(struct msm_vidc_inst *inst,
 	if (msm_comm_turbo_session(inst)) {
 		if (!(quirks & LOAD_CALC_IGNORE_TURBO_LOAD))
 			load = inst->core->resources.max_load;
+	} else if ((quirks & LOAD_CALC_DCVS_DEADLINE) &&
+			inst->dcvs.deadline_load) {
+		/* clock need measured from firmware processing time */
+		load = inst->dcvs.deadline_load;
 	}
 
 	/*  Clock and Load calculations for REALTIME/NON-REALTIME
@@ -849,6 +853,8 @@ static void handle_sys_release_res_done(
 static void change_inst_state(struct msm_vidc_inst *inst,
 	enum instance_state state)
 {
+	u32 open_us = 0;
+
 	if (!inst) {
 		dprintk(VIDC_ERR, "Invalid parameter %s\n", __func__);
 		return;
@@ -863,8 +869,24 @@ static void change_inst_state(struct msm_vidc_inst *inst,
 	dprintk(VIDC_DBG, "Moved inst: %pK from state: %d to state: %d\n",
 		   inst, inst->state, state);
 	inst->state = state;
+	if (state == MSM_VIDC_START_DONE && !inst->debug.open_latency_us) {
+		open_us = max_t(s64, ktime_us_delta(ktime_get(),
+				inst->debug.open_ts), 1);
+		inst->debug.open_latency_us = open_us;
+	}
 exit:
 	mutex_unlock(&inst->lock);
+
+	if (open_us) {
+		struct msm_vidc_core *core = inst->core;
+
+		mutex_lock(&core->lock);
+		core->open_count++;
+		core->open_latency_sum_us += open_us;
+		core->open_latency_max_us =
+			max(core->open_latency_max_us, open_us);
+		mutex_unlock(&core->lock);
+	}
 }
 
 static int signal_session_msg_receipt(enum hal_command_response cmd,
@@ -1913,6 +1935,7 @@ static void handle_ebd(enum hal_command_response cmd, void *data)
 		vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
 		mutex_unlock(&inst->bufq[OUTPUT_PORT].lock);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_EBD);
+		msm_dcvs_deadline_ebd(inst);
 	}
 
 	put_inst(inst);
@@ -2353,11 +2376,13 @@ void handle_cmd_response(enum hal_command_response cmd, void *data)
 int msm_comm_scale_clocks(struct msm_vidc_core *core)
 {
 	int num_mbs_per_sec, enc_mbs_per_sec, dec_mbs_per_sec;
+	enum load_calc_quirks quirks = msm_vidc_dcvs_deadline_mode ?
+		LOAD_CALC_DCVS_DEADLINE : LOAD_CALC_NO_QUIRKS;
 
 	enc_mbs_per_sec =
-		msm_comm_get_load(core, MSM_VIDC_ENCODER, LOAD_CALC_NO_QUIRKS);
+		msm_comm_get_load(core, MSM_VIDC_ENCODER, quirks);
 	dec_mbs_per_sec	=
-		msm_comm_get_load(core, MSM_VIDC_DECODER, LOAD_CALC_NO_QUIRKS);
+		msm_comm_get_load(core, MSM_VIDC_DECODER, quirks);
 
 	if (enc_mbs_per_sec >= dec_mbs_per_sec) {
 	/*
@@ -2376,8 +2401,7 @@ int msm_comm_scale_clocks(struct msm_vidc_core *core)
 		num_mbs_per_sec = enc_mbs_per_sec + dec_mbs_per_sec;
 	}
 
-	return msm_comm_scale_clocks_load(core, num_mbs_per_sec,
-			LOAD_CALC_NO_QUIRKS);
+	return msm_comm_scale_clocks_load(core, num_mbs_per_sec, quirks);
 }
 
 int msm_comm_scale_clocks_load(struct msm_vidc_core *core,
@@ -3753,6 +3777,7 @@ static void log_frame(struct msm_vidc_inst *inst, struct vidc_frame_data *data,
 				&data->device_addr, data->filled_len,
 				data->timestamp, data->flags);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_ETB);
+		msm_dcvs_deadline_etb(inst, data->filled_len);
 
 		if (msm_vidc_bitrate_clock_scaling &&
 			inst->session_type == MSM_VIDC_DECODER &&
@@ -3967,6 +3992,52 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 		}
 	}
 
+	/*
+	 * Several buffers released at once (stream on, or deferred by the
+	 * client to group a frame): write them all before one doorbell.
+	 */
+	if (!batch_mode && msm_vidc_hfi_batch_doorbell &&
+		etbs.count + ftbs.count > 1) {
+		int ftb_index = 0, c = 0;
+
+		for (c = 0; atomic_read(&inst->seq_hdr_reqs) > 0 &&
+				c < ftbs.count; ++c) {
+			rc = request_seq_header(inst, &ftbs.data[c]);
+			if (rc) {
+				dprintk(VIDC_ERR,
+						"Failed requesting sequence header: %d\n",
+						rc);
+				goto err_bad_input;
+			}
+
+			atomic_dec(&inst->seq_hdr_reqs);
+		}
+
+		ftb_index = c;
+		rc = call_hfi_op(hdev, session_queue_frames, inst->session,
+				etbs.count, etbs.data,
+				ftbs.count - ftb_index, &ftbs.data[ftb_index]);
+		if (rc) {
+			dprintk(VIDC_ERR,
+				"Failed to queue %d ETBs and %d FTBs\n",
+				etbs.count, ftbs.count);
+			goto err_bad_input;
+		}
+		inst->debug.batched_submits++;
+
+		for (c = 0; c < etbs.count; ++c) {
+			log_frame(inst, &etbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		}
+
+		for (c = ftb_index; c < ftbs.count; ++c) {
+			log_frame(inst, &ftbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+		}
+
+		etbs.count = ftbs.count = 0;
+	}
+
 	if (!batch_mode && etbs.count) {
 		int c = 0;
 
@@ -227,6 +227,10 @@ void msm_dcvs_init_load(struct msm_vidc_inst *inst)
 	res = &core->resources;
 	dcvs->load = msm_comm_get_inst_load(inst, LOAD_CALC_IGNORE_TURBO_LOAD);
 
+	/* resolution or rate changed, relearn the per frame cost */
+	dcvs->deadline_samples = 0;
+	dcvs->deadline_load = 0;
+
 	num_rows = res->dcvs_tbl_size;
 	table = res->dcvs_tbl;
 
@@ -571,6 +575,12 @@ static bool msm_dcvs_check_supported(struct msm_vidc_inst *inst)
 		res->dcvs_limit[inst->session_type].fps;
 	inst->dcvs.extra_buffer_count = 0;
 
+	/* deadline mode replaces the buffer occupancy based decision */
+	if (msm_vidc_dcvs_deadline_mode) {
+		is_dcvs_supported = false;
+		goto dcvs_decision_done;
+	}
+
 	if (!IS_VALID_DCVS_SESSION(num_mbs_per_frame,
 		res->dcvs_limit[inst->session_type].min_mbpf) ||
 		(inst->flags & VIDC_THUMBNAIL)) {
@@ -637,6 +647,126 @@ dcvs_decision_done:
 	return is_dcvs_supported;
 }
 
+void msm_dcvs_deadline_etb(struct msm_vidc_inst *inst, u32 filled_len)
+{
+	struct dcvs_stats *dcvs;
+	int idx;
+
+	if (!inst || !msm_vidc_dcvs_deadline_mode)
+		return;
+
+	dcvs = &inst->dcvs;
+	mutex_lock(&inst->lock);
+	if (inst->count.etb > 0) {
+		idx = (inst->count.etb - 1) % DCVS_DEADLINE_WINDOW;
+		dcvs->etb_ts[idx] = ktime_get();
+		dcvs->etb_bytes[idx] = filled_len;
+	}
+	mutex_unlock(&inst->lock);
+}
+
+/*
+ * Deadline mode: firmware processing time of each input buffer, from
+ * ETB (or the previous EBD, when it was queued behind another frame) to
+ * its EBD, gives the cycles a frame costs at the current core clock.
+ * The clock needed to finish the next frames on time is that average
+ * cost, scaled by the size of the frames already queued relative to the
+ * average frame size, at the session frame rate plus some headroom. It
+ * is voted as a load so the existing per session aggregation and clock
+ * tables still apply; the vote is updated on the next qbuf.
+ */
+void msm_dcvs_deadline_ebd(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_core *core;
+	struct hfi_device *hdev;
+	struct dcvs_stats *dcvs;
+	unsigned long freq;
+	ktime_t now, start;
+	u64 cycles, required, ratio;
+	u32 busy_us, period_us, bytes, pending_bytes = 0;
+	int nominal, mbpf, fps, load, idx, pending, i;
+
+	if (!inst || !inst->core || !inst->core->device ||
+		!msm_vidc_dcvs_deadline_mode ||
+		(inst->flags & VIDC_THUMBNAIL))
+		return;
+
+	core = inst->core;
+	hdev = core->device;
+	dcvs = &inst->dcvs;
+	now = ktime_get();
+
+	freq = call_hfi_op(hdev, get_core_clock_rate,
+			hdev->hfi_device_data, false);
+	nominal = msm_comm_get_inst_load(inst, LOAD_CALC_NO_QUIRKS);
+	mbpf = msm_dcvs_get_mbs_per_frame(inst);
+	fps = mbpf ? nominal / mbpf : 0;
+	if (!freq || !nominal || fps <= 0)
+		return;
+
+	mutex_lock(&inst->lock);
+	pending = inst->count.etb - inst->count.ebd;
+	if (inst->count.ebd <= 0 || pending < 0 ||
+		pending >= DCVS_DEADLINE_WINDOW)
+		goto exit;
+
+	idx = (inst->count.ebd - 1) % DCVS_DEADLINE_WINDOW;
+	start = ktime_compare(dcvs->etb_ts[idx], dcvs->last_ebd_ts) > 0 ?
+		dcvs->etb_ts[idx] : dcvs->last_ebd_ts;
+	dcvs->last_ebd_ts = now;
+
+	/* decoder stalled waiting for output buffers, not processing */
+	if (inst->session_type == MSM_VIDC_DECODER &&
+		inst->count.ftb == inst->count.fbd)
+		goto exit;
+
+	busy_us = ktime_us_delta(now, start);
+	period_us = USEC_PER_SEC / fps;
+	bytes = dcvs->etb_bytes[idx];
+	dcvs->deadline_frames++;
+	if (busy_us > period_us)
+		dcvs->deadline_misses++;
+
+	cycles = div_u64((u64)busy_us * freq, USEC_PER_SEC);
+	if (!dcvs->deadline_samples) {
+		dcvs->avg_cycles = cycles;
+		dcvs->avg_bytes = bytes;
+	} else {
+		dcvs->avg_cycles = (dcvs->avg_cycles * 7 + cycles) >> 3;
+		dcvs->avg_bytes = (dcvs->avg_bytes * 7 + bytes) >> 3;
+	}
+	if (++dcvs->deadline_samples < DCVS_DEADLINE_WINDOW)
+		goto exit;
+
+	required = dcvs->avg_cycles;
+	for (i = 0; i < pending; i++)
+		pending_bytes += dcvs->etb_bytes[
+			(inst->count.ebd + i) % DCVS_DEADLINE_WINDOW];
+	if (pending && dcvs->avg_bytes) {
+		ratio = div_u64((u64)pending_bytes * 100,
+				pending * dcvs->avg_bytes);
+		ratio = clamp_t(u64, ratio, DCVS_DEADLINE_BITRATE_MIN,
+				DCVS_DEADLINE_BITRATE_MAX);
+		required = div_u64(required * ratio, 100);
+	}
+	required = div_u64(required * fps * (100 + DCVS_DEADLINE_HEADROOM),
+			100);
+
+	load = div64_u64((u64)nominal * required, freq);
+	load = clamp_t(int, load, 1, core->resources.max_load);
+
+	/* hysteresis, unless a deadline was just missed */
+	if (busy_us > period_us || !dcvs->deadline_load ||
+		abs(load - dcvs->deadline_load) > dcvs->deadline_load / 8) {
+		dprintk(VIDC_PROF,
+			"DCVS deadline: load %d -> %d, busy %u us, period %u us\n",
+			dcvs->deadline_load, load, busy_us, period_us);
+		dcvs->deadline_load = load;
+	}
+exit:
+	mutex_unlock(&inst->lock);
+}
+
 int msm_dcvs_get_extra_buff_count(struct msm_vidc_inst *inst)
 {
 	if (!inst) {
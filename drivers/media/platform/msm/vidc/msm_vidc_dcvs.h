@@ -31,10 +31,18 @@
 /* Considering one safeguard buffer */
 #define DCVS_BUFFER_SAFEGUARD (DCVS_DEC_EXTRA_OUTPUT_BUFFERS - 1)
 
+/* Clock headroom over the measured need in deadline mode, in percent */
+#define DCVS_DEADLINE_HEADROOM 20
+/* Bounds, in percent, on scaling the clock need by pending bitrate */
+#define DCVS_DEADLINE_BITRATE_MIN 50
+#define DCVS_DEADLINE_BITRATE_MAX 200
+
 void msm_dcvs_init(struct msm_vidc_inst *inst);
 void msm_dcvs_init_load(struct msm_vidc_inst *inst);
 void msm_dcvs_monitor_buffer(struct msm_vidc_inst *inst);
 void msm_dcvs_check_and_scale_clocks(struct msm_vidc_inst *inst, bool is_etb);
 int  msm_dcvs_get_extra_buff_count(struct msm_vidc_inst *inst);
 int msm_dcvs_try_enable(struct msm_vidc_inst *inst);
+void msm_dcvs_deadline_etb(struct msm_vidc_inst *inst, u32 filled_len);
+void msm_dcvs_deadline_ebd(struct msm_vidc_inst *inst);
 #endif
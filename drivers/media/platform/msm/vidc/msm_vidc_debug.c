@@ -34,6 +34,10 @@ bool msm_vidc_sys_idle_indicator = false;
 int msm_vidc_firmware_unload_delay = 15000;
 bool msm_vidc_thermal_mitigation_disabled = false;
 bool msm_vidc_bitrate_clock_scaling = true;
+bool msm_vidc_dcvs_deadline_mode = false;
+bool msm_vidc_hfi_batch_doorbell = false;
+int msm_vidc_hfi_irq_coalesce_us = 0;
+int msm_vidc_smem_pool_kb = 0;
 bool msm_vidc_debug_timeout = false;
 
 #define MAX_DBG_BUF_SIZE 4096
@@ -71,6 +75,7 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	struct msm_vidc_core *core = file->private_data;
 	struct hfi_device *hdev;
 	struct hal_fw_info fw_info = { {0} };
+	struct msm_smem_pool_stats pool;
 	char *dbuf, *cur, *end;
 	int i = 0, rc = 0;
 	ssize_t len = 0;
@@ -115,6 +120,18 @@ err_fw_info:
 			completion_done(&core->completions[SYS_MSG_INDEX(i)]) ?
 			"pending" : "done");
 	}
+
+	mutex_lock(&core->lock);
+	cur += write_str(cur, end - cur,
+		"session open latency avg: %llu us max: %u us sessions: %u\n",
+		core->open_count ? div_u64(core->open_latency_sum_us,
+			core->open_count) : 0,
+		core->open_latency_max_us, core->open_count);
+	mutex_unlock(&core->lock);
+	msm_smem_get_pool_stats(&pool);
+	cur += write_str(cur, end - cur,
+		"smem pool: %u buffers %zu bytes, hits: %u misses: %u shrunk: %u\n",
+		pool.count, pool.bytes, pool.hits, pool.misses, pool.shrunk);
 	len = simple_read_from_buffer(buf, count, ppos,
 			dbuf, cur - dbuf);
 
@@ -211,6 +228,13 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 			&msm_vidc_thermal_mitigation_disabled) &&
 	__debugfs_create(bool, "bitrate_clock_scaling",
 			&msm_vidc_bitrate_clock_scaling) &&
+	__debugfs_create(bool, "dcvs_deadline_mode",
+			&msm_vidc_dcvs_deadline_mode) &&
+	__debugfs_create(bool, "hfi_batch_doorbell",
+			&msm_vidc_hfi_batch_doorbell) &&
+	__debugfs_create(u32, "hfi_irq_coalesce_us",
+			&msm_vidc_hfi_irq_coalesce_us) &&
+	__debugfs_create(u32, "smem_pool_kb", &msm_vidc_smem_pool_kb) &&
 	__debugfs_create(bool, "debug_timeout",
 			&msm_vidc_debug_timeout);
 
@@ -410,6 +434,21 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "EBD Count: %d\n", inst->count.ebd);
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
+	cur += write_str(cur, end - cur,
+		"DCVS deadline load: %d cycles/frame: %llu bytes/frame: %u\n",
+		inst->dcvs.deadline_load, inst->dcvs.avg_cycles,
+		inst->dcvs.avg_bytes);
+	cur += write_str(cur, end - cur,
+		"DCVS deadline frames: %u missed: %u\n",
+		inst->dcvs.deadline_frames, inst->dcvs.deadline_misses);
+	cur += write_str(cur, end - cur,
+		"ETB->EBD latency avg: %llu us max: %u us batched submits: %u\n",
+		inst->debug.ebd_latency_samples ?
+		div_u64(inst->debug.ebd_latency_sum_us,
+			inst->debug.ebd_latency_samples) : 0,
+		inst->debug.ebd_latency_max_us, inst->debug.batched_submits);
+	cur += write_str(cur, end - cur, "Open latency: %u us\n",
+		inst->debug.open_latency_us);
 
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
@@ -508,6 +547,8 @@ void msm_vidc_debugfs_update(struct msm_vidc_inst *inst,
 	case MSM_VIDC_DEBUGFS_EVENT_ETB:
 		mutex_lock(&inst->lock);
 		inst->count.etb++;
+		d->etb_ts[(inst->count.etb - 1) % MSM_VIDC_LATENCY_WINDOW] =
+			ktime_get();
 		mutex_unlock(&inst->lock);
 		if (inst->count.ebd && inst->count.ftb > inst->count.fbd) {
 			d->pdata[FRAME_PROCESSING].name[0] = '\0';
@@ -517,6 +558,18 @@ void msm_vidc_debugfs_update(struct msm_vidc_inst *inst,
 	case MSM_VIDC_DEBUGFS_EVENT_EBD:
 		mutex_lock(&inst->lock);
 		inst->count.ebd++;
+		/* input buffers complete in order, unless history wrapped */
+		if (inst->count.etb >= inst->count.ebd &&
+			inst->count.etb - inst->count.ebd <
+				MSM_VIDC_LATENCY_WINDOW) {
+			u32 us = ktime_us_delta(ktime_get(), d->etb_ts[
+				(inst->count.ebd - 1) %
+				MSM_VIDC_LATENCY_WINDOW]);
+
+			d->ebd_latency_sum_us += us;
+			d->ebd_latency_max_us = max(d->ebd_latency_max_us, us);
+			d->ebd_latency_samples++;
+		}
 		mutex_unlock(&inst->lock);
 		if (inst->count.ebd && inst->count.ebd == inst->count.etb) {
 			toc(inst, FRAME_PROCESSING);
@@ -63,6 +63,10 @@ extern bool msm_vidc_fw_coverage;
 extern bool msm_vidc_vpe_csc_601_to_709;
 extern bool msm_vidc_dec_dcvs_mode;
 extern bool msm_vidc_enc_dcvs_mode;
+extern bool msm_vidc_dcvs_deadline_mode;
+extern bool msm_vidc_hfi_batch_doorbell;
+extern int msm_vidc_hfi_irq_coalesce_us;
+extern int msm_vidc_smem_pool_kb;
 extern bool msm_vidc_sys_idle_indicator;
 extern int msm_vidc_firmware_unload_delay;
 extern bool msm_vidc_thermal_mitigation_disabled;
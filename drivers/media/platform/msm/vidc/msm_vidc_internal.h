@@ -49,6 +49,9 @@
 /* Maintains the number of FTB's between each FBD over a window */
 #define DCVS_FTB_WINDOW 32
 
+/* Frames of ETB history kept for deadline based DCVS */
+#define DCVS_DEADLINE_WINDOW 16
+
 #define V4L2_EVENT_VIDC_BASE  10
 
 #define SYS_MSG_START HAL_SYS_INIT_DONE
@@ -209,6 +212,16 @@ struct dcvs_stats {
 	bool is_power_save_mode;
 	unsigned int extra_buffer_count;
 	u32 supported_codecs;
+	/* deadline mode, see msm_dcvs_deadline_ebd() */
+	ktime_t etb_ts[DCVS_DEADLINE_WINDOW];
+	u32 etb_bytes[DCVS_DEADLINE_WINDOW];
+	ktime_t last_ebd_ts;
+	u64 avg_cycles;
+	u32 avg_bytes;
+	u32 deadline_samples;
+	int deadline_load;
+	u32 deadline_frames;
+	u32 deadline_misses;
 };
 
 struct profile_data {
@@ -220,10 +233,20 @@ struct profile_data {
 	int average;
 };
 
+/* Input buffers tracked for ETB to EBD queue latency */
+#define MSM_VIDC_LATENCY_WINDOW 32
+
 struct msm_vidc_debug {
 	struct profile_data pdata[MAX_PROFILING_POINTS];
 	int profile;
 	int samples;
+	ktime_t open_ts;
+	u32 open_latency_us;
+	ktime_t etb_ts[MSM_VIDC_LATENCY_WINDOW];
+	u64 ebd_latency_sum_us;
+	u32 ebd_latency_max_us;
+	u32 ebd_latency_samples;
+	u32 batched_submits;
 };
 
 enum msm_vidc_modes {
@@ -253,6 +276,10 @@ struct msm_vidc_core {
 	struct msm_vidc_capability *capabilities;
 	struct delayed_work fw_unload_work;
 	bool smmu_fault_handled;
+	/* open to first START_DONE, see change_inst_state() */
+	u32 open_count;
+	u64 open_latency_sum_us;
+	u32 open_latency_max_us;
 };
 
 struct msm_vidc_inst {
@@ -386,6 +413,18 @@ struct context_bank_info *msm_smem_get_context_bank(void *clt,
 		bool is_secure, enum hal_buffer buffer_type);
 void msm_vidc_fw_unload_handler(struct work_struct *work);
 bool msm_smem_compare_buffers(void *clt, int fd, void *priv);
+
+struct msm_smem_pool_stats {
+	size_t bytes;
+	u32 count;
+	u32 hits;
+	u32 misses;
+	u32 shrunk;
+};
+
+void msm_smem_pool_init(void);
+void msm_smem_pool_deinit(void);
+void msm_smem_get_pool_stats(struct msm_smem_pool_stats *stats);
 /* XXX: normally should be in msm_vidc.h, but that's meant for public APIs,
  * whereas this is private */
 int msm_vidc_destroy(struct msm_vidc_inst *inst);
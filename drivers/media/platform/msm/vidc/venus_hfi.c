@@ -59,6 +59,8 @@ struct tzbsp_resp {
 
 /* Poll interval in uS */
 #define POLL_INTERVAL_US 50
+/* Bound on extra response queue drains per interrupt when coalescing */
+#define MAX_COALESCE_PASSES 4
 
 enum tzbsp_video_state {
 	TZBSP_VIDEO_STATE_SUSPEND = 0,
@@ -1736,6 +1738,18 @@ static int __iface_cmdq_write(struct venus_hfi_device *device, void *pkt)
 	return rc;
 }
 
+/* Raises one interrupt for packets written by __iface_cmdq_write_relaxed() */
+static void __iface_cmdq_doorbell(struct venus_hfi_device *device)
+{
+	struct hfi_queue_header *queue;
+
+	queue = (struct hfi_queue_header *)
+		device->iface_queues[VIDC_IFACEQ_CMDQ_IDX].q_hdr;
+	if (queue && queue->qhdr_rx_req == 1)
+		__write_register(device, VIDC_CPU_IC_SOFTINT,
+				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+}
+
 static int __iface_msgq_read(struct venus_hfi_device *device, void *pkt)
 {
 	u32 tx_req_is_set = 0;
@@ -3064,6 +3078,49 @@ err_etbs_and_ftbs:
 	return rc;
 }
 
+/*
+ * Same packets as individual ETBs and FTBs, without the sync process
+ * packet that firmware batch mode needs, and one doorbell for all.
+ */
+static int venus_hfi_session_queue_frames(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[])
+{
+	int rc = 0, c = 0;
+	struct hal_session *session = sess;
+	struct venus_hfi_device *device;
+
+	if (!session || !session->device) {
+		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
+		return -EINVAL;
+	}
+
+	device = session->device;
+
+	mutex_lock(&device->lock);
+	for (c = 0; c < num_etbs; ++c) {
+		rc = __session_etb(session, &etbs[c], true);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue etb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+	for (c = 0; c < num_ftbs; ++c) {
+		rc = __session_ftb(session, &ftbs[c], true);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue ftb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+err_etbs_and_ftbs:
+	/* packets already written must not be left without a doorbell */
+	__iface_cmdq_doorbell(device);
+	mutex_unlock(&device->lock);
+	return rc;
+}
+
 static int venus_hfi_session_parse_seq_hdr(void *sess,
 					struct vidc_seq_hdr *seq_hdr)
 {
@@ -3670,9 +3727,11 @@ static void venus_hfi_core_work_handler(struct work_struct *work)
 {
 	struct venus_hfi_device *device = list_first_entry(
 		&hal_ctxt.dev_head, struct venus_hfi_device, list);
-	int num_responses = 0, i = 0;
+	int num_responses = 0, i = 0, passes = 0;
 	u32 intr_status;
 
+drain:
+	num_responses = 0;
 	mutex_lock(&device->lock);
 
 	dprintk(VIDC_INFO, "Handling interrupt\n");
@@ -3719,6 +3778,19 @@ err_no_work:
 		device->callback(r->response_type, &r->response);
 	}
 
+	/*
+	 * Interrupt coalescing: while responses keep arriving, leave the
+	 * irq masked and drain the queue again after a short wait, so a
+	 * burst of EBDs and FBDs costs one interrupt instead of one each.
+	 */
+	if (msm_vidc_hfi_irq_coalesce_us > 0 && num_responses &&
+		!(intr_status & VIDC_WRAPPER_INTR_STATUS_A2HWD_BMSK) &&
+		++passes <= MAX_COALESCE_PASSES) {
+		usleep_range(msm_vidc_hfi_irq_coalesce_us,
+			msm_vidc_hfi_irq_coalesce_us + POLL_INTERVAL_US);
+		goto drain;
+	}
+
 	/* We need re-enable the irq which was disabled in ISR handler */
 	if (!(intr_status & VIDC_WRAPPER_INTR_STATUS_A2HWD_BMSK))
 		enable_irq(device->hal_data->irq);
@@ -4777,6 +4849,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
 	hdev->session_process_batch = venus_hfi_session_process_batch;
+	hdev->session_queue_frames = venus_hfi_session_queue_frames;
 	hdev->session_parse_seq_hdr = venus_hfi_session_parse_seq_hdr;
 	hdev->session_get_seq_hdr = venus_hfi_session_get_seq_hdr;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
@@ -3642,8 +3642,11 @@ void mmc_blk_cmdq_complete_rq(struct request *rq)
 	else
 		BUG_ON(!test_and_clear_bit(cmdq_req->tag,
 					 &ctx_info->data_active_reqs));
-	if (!is_dcmd)
+	if (!is_dcmd) {
 		mmc_cmdq_post_req(host, cmdq_req->tag, err);
+		if (!err)
+			mmc_cmdq_account_lat(host, cmdq_req);
+	}
 	if (cmdq_req->cmdq_req_flags & DCMD) {
 		clear_bit(CMDQ_STATE_DCMD_ACTIVE, &ctx_info->curr_state);
 		blk_end_request_all(rq, err);
@@ -32,6 +32,7 @@
 #include <linux/of.h>
 #include <linux/pm.h>
 #include <linux/jiffies.h>
+#include <linux/sizes.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/mmc.h>
@@ -1747,10 +1748,64 @@ int mmc_cmdq_start_req(struct mmc_host *host, struct mmc_cmdq_req *cmdq_req)
 		mrq->cmd->error = -ENOMEDIUM;
 		return -ENOMEDIUM;
 	}
+	mrq->io_start = ktime_get();
 	return mmc_start_cmdq_request(host, mrq);
 }
 EXPORT_SYMBOL(mmc_cmdq_start_req);
 
+static int mmc_cmdq_lat_bucket(ktime_t start, ktime_t end)
+{
+	s64 us = ktime_us_delta(end, start);
+
+	if (us <= 0)
+		return 0;
+	return min_t(int, fls64(us), MMC_CMDQ_LAT_BUCKETS - 1);
+}
+
+/**
+ *	mmc_cmdq_account_lat - account a completed data request in cmdq_lat
+ *	@host: host instance
+ *	@cmdq_req: the request, with doorbell and complete set by the host
+ *
+ *	Called from the request completion path, after post processing.
+ */
+void mmc_cmdq_account_lat(struct mmc_host *host,
+			  struct mmc_cmdq_req *cmdq_req)
+{
+	struct mmc_cmdq_lat_stats *stats = &host->cmdq_lat;
+	unsigned int bytes = cmdq_req->data.blocks * cmdq_req->data.blksz;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	u32 *hist;
+	int dir, size;
+
+	/* hosts that don't timestamp requests are not accounted */
+	if (!ktime_to_ns(cmdq_req->doorbell) ||
+	    !ktime_to_ns(cmdq_req->complete))
+		return;
+
+	dir = (cmdq_req->cmdq_req_flags & DIR) ? READ : WRITE;
+	if (bytes <= SZ_4K)
+		size = MMC_CMDQ_LAT_4K;
+	else if (bytes <= SZ_16K)
+		size = MMC_CMDQ_LAT_16K;
+	else if (bytes <= SZ_64K)
+		size = MMC_CMDQ_LAT_64K;
+	else
+		size = MMC_CMDQ_LAT_LARGE;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	hist = stats->hist[dir][size][MMC_CMDQ_LAT_QUEUE];
+	hist[mmc_cmdq_lat_bucket(cmdq_req->mrq.io_start,
+				 cmdq_req->doorbell)]++;
+	hist = stats->hist[dir][size][MMC_CMDQ_LAT_DEVICE];
+	hist[mmc_cmdq_lat_bucket(cmdq_req->doorbell, cmdq_req->complete)]++;
+	hist = stats->hist[dir][size][MMC_CMDQ_LAT_COMPLETION];
+	hist[mmc_cmdq_lat_bucket(cmdq_req->complete, now)]++;
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+EXPORT_SYMBOL(mmc_cmdq_account_lat);
+
 static void mmc_cmdq_dcmd_req_done(struct mmc_request *mrq)
 {
 	mmc_host_clk_release(mrq->host);
@@ -52,6 +52,76 @@ static const struct file_operations mmc_ring_buffer_fops = {
 	.release	= single_release,
 };
 
+static int mmc_cmdq_lat_show(struct seq_file *s, void *data)
+{
+	static const char * const dir_names[] = { "read", "write" };
+	static const char * const size_names[MMC_CMDQ_LAT_SIZES] = {
+		"4k", "16k", "64k", "large",
+	};
+	static const char * const stage_names[MMC_CMDQ_LAT_STAGES] = {
+		"queue", "device", "completion",
+	};
+	struct mmc_host *host = s->private;
+	u32 hist[MMC_CMDQ_LAT_BUCKETS];
+	u64 total;
+	int dir, size, stage, i;
+
+	seq_puts(s, "dir   size  stage     ");
+	for (i = 0; i < MMC_CMDQ_LAT_BUCKETS - 1; i++)
+		seq_printf(s, " <%lu", 1UL << i);
+	seq_puts(s, " more\n");
+
+	for (dir = READ; dir <= WRITE; dir++) {
+		for (size = 0; size < MMC_CMDQ_LAT_SIZES; size++) {
+			for (stage = 0; stage < MMC_CMDQ_LAT_STAGES; stage++) {
+				spin_lock_irq(&host->cmdq_lat.lock);
+				memcpy(hist, host->cmdq_lat.hist[dir][size][stage],
+				       sizeof(hist));
+				spin_unlock_irq(&host->cmdq_lat.lock);
+
+				for (total = 0, i = 0; i < ARRAY_SIZE(hist); i++)
+					total += hist[i];
+				if (!total)
+					continue;
+
+				seq_printf(s, "%-5s %-5s %-10s", dir_names[dir],
+					   size_names[size], stage_names[stage]);
+				for (i = 0; i < ARRAY_SIZE(hist); i++)
+					seq_printf(s, " %u", hist[i]);
+				seq_puts(s, "\n");
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int mmc_cmdq_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_cmdq_lat_show, inode->i_private);
+}
+
+/* Any write clears the histograms */
+static ssize_t mmc_cmdq_lat_write(struct file *filp, const char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	struct mmc_host *host = filp->f_mapping->host->i_private;
+
+	spin_lock_irq(&host->cmdq_lat.lock);
+	memset(host->cmdq_lat.hist, 0, sizeof(host->cmdq_lat.hist));
+	spin_unlock_irq(&host->cmdq_lat.lock);
+
+	return cnt;
+}
+
+static const struct file_operations mmc_cmdq_lat_fops = {
+	.open		= mmc_cmdq_lat_open,
+	.read		= seq_read,
+	.write		= mmc_cmdq_lat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int mmc_ios_show(struct seq_file *s, void *data)
 {
 	static const char *vdd_str[] = {
@@ -420,6 +490,11 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 		&host->cmdq_thist_enabled))
 		goto err_node;
 
+	if ((host->caps2 & MMC_CAP2_CMD_QUEUE) &&
+	    !debugfs_create_file("cmdq_latency", S_IRUSR | S_IWUSR, root,
+				 host, &mmc_cmdq_lat_fops))
+		goto err_node;
+
 #ifdef CONFIG_MMC_RING_BUFFER
 	if (!debugfs_create_file("ring_buffer", S_IRUSR,
 				root, host, &mmc_ring_buffer_fops))
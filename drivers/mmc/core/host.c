@@ -629,6 +629,7 @@ struct mmc_host *mmc_alloc_host(int extra, struct device *dev)
 	mmc_host_clk_init(host);
 
 	spin_lock_init(&host->lock);
+	spin_lock_init(&host->cmdq_lat.lock);
 	init_waitqueue_head(&host->wq);
 	INIT_DELAYED_WORK(&host->detect, mmc_rescan);
 #ifdef CONFIG_PM
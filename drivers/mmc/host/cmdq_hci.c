@@ -842,6 +842,7 @@ ring_doorbell:
 		BUG_ON(1);
 	}
 	MMC_TRACE(mmc, "%s: tag: %d\n", __func__, tag);
+	mrq->cmdq_req->doorbell = ktime_get();
 	cmdq_writel(cq_host, 1 << tag, CQTDBR);
 	/* Commit the doorbell write immediately */
 	wmb();
@@ -876,6 +877,7 @@ static void cmdq_finish_data(struct mmc_host *mmc, unsigned int tag)
 	if (cq_host->offset_changed)
 		offset = CQ_V5_VENDOR_CFG;
 	mrq = get_req_by_tag(cq_host, tag);
+	mrq->cmdq_req->complete = ktime_get();
 	if (tag == cq_host->dcmd_slot)
 		mrq->cmd->resp[0] = cmdq_readl(cq_host, CQCRDCT);
 
@@ -256,6 +256,9 @@ int ecm_ipa_init(struct ecm_ipa_params *params)
 	snprintf(net->name, sizeof(net->name), "%s%%d", "ecm");
 	net->netdev_ops = &ecm_ipa_netdev_ops;
 	net->watchdog_timeo = TX_TIMEOUT;
+	/* IPA takes paged skbs, let the stack skip linearizing them */
+	net->hw_features |= NETIF_F_SG;
+	net->features |= NETIF_F_SG;
 	ECM_IPA_DEBUG("internal data structures were intialized\n");
 
 	if (!params->device_ready_notify)
@@ -171,6 +171,12 @@ enum rndis_ipa_operation {
  * state is changed to RNDIS_IPA_CONNECTED_AND_UP
  * @xmit_error_delayed_work: work item for cases where IPA driver Tx fails
  * @state_lock: used to protect the state variable.
+ * @rx_xfers: number of USB transfers received with SW deaggregation
+ * @rx_deaggr_pkts: number of packets found in those transfers
+ * @rx_deaggr_errors: number of transfers with a malformed RNDIS message
+ * @tx_sg_pkts: number of Tx packets sent without linearizing their frags
+ * @tx_hdr_expand: number of Tx packets that needed their head reallocated
+ *  to fit the RNDIS header
  */
 struct rndis_ipa_dev {
 	struct net_device *net;
@@ -199,6 +205,11 @@ struct rndis_ipa_dev {
 	void (*device_ready_notify)(void);
 	struct delayed_work xmit_error_delayed_work;
 	spinlock_t state_lock; /* Spinlock for the state variable.*/
+	u32 rx_xfers;
+	u32 rx_deaggr_pkts;
+	u32 rx_deaggr_errors;
+	u32 tx_sg_pkts;
+	u32 tx_hdr_expand;
 };
 
 /**
@@ -226,6 +237,10 @@ static void rndis_ipa_tx_timeout(struct net_device *net);
 static int rndis_ipa_stop(struct net_device *net);
 static void rndis_ipa_enable_data_path(struct rndis_ipa_dev *rndis_ipa_ctx);
 static struct sk_buff *rndis_encapsulate_skb(struct sk_buff *skb);
+static void rndis_ipa_rx_deaggregate(struct rndis_ipa_dev *rndis_ipa_ctx,
+		struct sk_buff *skb);
+static void rndis_ipa_rx_deliver(struct rndis_ipa_dev *rndis_ipa_ctx,
+		struct sk_buff *skb);
 static void rndis_ipa_xmit_error(struct sk_buff *skb);
 static void rndis_ipa_xmit_error_aftercare_wq(struct work_struct *work);
 static void rndis_ipa_prepare_header_insertion(int eth_type,
@@ -256,6 +271,8 @@ static ssize_t rndis_ipa_debugfs_aggr_write(struct file *file,
 		const char __user *buf, size_t count, loff_t *ppos);
 static ssize_t rndis_ipa_debugfs_atomic_read(struct file *file,
 		char __user *ubuf, size_t count, loff_t *ppos);
+static ssize_t rndis_ipa_debugfs_aggr_stats_read(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos);
 static void rndis_ipa_dump_skb(struct sk_buff *skb);
 static void rndis_ipa_debugfs_init(struct rndis_ipa_dev *rndis_ipa_ctx);
 static void rndis_ipa_debugfs_destroy(struct rndis_ipa_dev *rndis_ipa_ctx);
@@ -293,6 +310,11 @@ const struct file_operations rndis_ipa_aggr_ops = {
 		.write = rndis_ipa_debugfs_aggr_write,
 };
 
+const struct file_operations rndis_ipa_aggr_stats_ops = {
+		.open = rndis_ipa_debugfs_aggr_open,
+		.read = rndis_ipa_debugfs_aggr_stats_read,
+};
+
 static struct ipa_ep_cfg ipa_to_usb_ep_cfg = {
 	.mode = {
 		.mode = IPA_BASIC,
@@ -551,6 +573,10 @@ int rndis_ipa_init(struct ipa_usb_init_params *params)
 	RNDIS_IPA_DEBUG("Needed headroom for RNDIS header set to %d\n",
 		net->needed_headroom);
 
+	/* IPA takes paged skbs, let the stack skip linearizing them */
+	net->hw_features |= NETIF_F_SG;
+	net->features |= NETIF_F_SG;
+
 	rndis_ipa_debugfs_init(rndis_ipa_ctx);
 
 	result = rndis_ipa_set_device_ethernet_addr(net->dev_addr,
@@ -906,6 +932,8 @@ static netdev_tx_t rndis_ipa_start_xmit(struct sk_buff *skb,
 		goto out;
 	}
 
+	if (skb_is_nonlinear(skb))
+		rndis_ipa_ctx->tx_sg_pkts++;
 	skb = rndis_encapsulate_skb(skb);
 	trace_rndis_tx_dp(skb->protocol);
 	ret = ipa_tx_dp(IPA_TO_USB_CLIENT, skb, NULL);
@@ -1077,6 +1105,10 @@ static void rndis_ipa_rm_notify(void *user_data, enum ipa_rm_event event,
  *     in  promisc mode.
  *   - Set the skb protocol field based on the EtherType field
  *
+ * When IPA HW deaggregation is disabled the skb holds a whole USB transfer,
+ * which may carry several RNDIS messages; they are split in place by
+ * rndis_ipa_rx_deaggregate().
+ *
  * Netdev status fields shall be updated based on the current Rx packet
  */
 static void rndis_ipa_packet_receive_notify(void *private,
@@ -1085,8 +1117,6 @@ static void rndis_ipa_packet_receive_notify(void *private,
 {
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct rndis_ipa_dev *rndis_ipa_ctx = private;
-	int result;
-	unsigned int packet_len = skb->len;
 
 	RNDIS_IPA_DEBUG("packet Rx, len=%d\n",
 		skb->len);
@@ -1106,8 +1136,87 @@ static void rndis_ipa_packet_receive_notify(void *private,
 		return;
 	}
 
-	if (!rndis_ipa_ctx->deaggregation_enable)
-		skb_pull(skb, sizeof(struct rndis_pkt_hdr));
+	if (!rndis_ipa_ctx->deaggregation_enable) {
+		rndis_ipa_rx_deaggregate(rndis_ipa_ctx, skb);
+		return;
+	}
+
+	rndis_ipa_rx_deliver(rndis_ipa_ctx, skb);
+}
+
+/**
+ * rndis_ipa_rx_deaggregate() - split a USB transfer into its RNDIS messages
+ * @rndis_ipa_ctx: main driver context
+ * @skb: the whole transfer, starting with an RNDIS header
+ *
+ * Every message but the last gets a clone of the transfer skb, so the
+ * payload is never copied; each skb is then narrowed down to the Ethernet
+ * frame described by its RNDIS header. Parsing stops at the first
+ * malformed message and the rest of the transfer is dropped.
+ */
+static void rndis_ipa_rx_deaggregate(struct rndis_ipa_dev *rndis_ipa_ctx,
+		struct sk_buff *skb)
+{
+	struct rndis_pkt_hdr *rndis_hdr;
+	struct sk_buff *pkt;
+	u32 msg_len, data_ofst, data_len;
+
+	rndis_ipa_ctx->rx_xfers++;
+
+	while (skb->len) {
+		if (!pskb_may_pull(skb, sizeof(*rndis_hdr)))
+			goto fail_malformed;
+		rndis_hdr = (struct rndis_pkt_hdr *)skb->data;
+		msg_len = le32_to_cpu(rndis_hdr->msg_len);
+		data_ofst = le32_to_cpu(rndis_hdr->data_ofst) +
+			RNDIS_HDR_OFST(data_ofst);
+		data_len = le32_to_cpu(rndis_hdr->data_len);
+		if (le32_to_cpu(rndis_hdr->msg_type) != RNDIS_IPA_PKT_TYPE ||
+		    msg_len > skb->len || data_ofst < sizeof(*rndis_hdr) ||
+		    data_len < ETH_HLEN || data_ofst + data_len > msg_len)
+			goto fail_malformed;
+
+		if (msg_len == skb->len) {
+			pkt = skb;
+		} else {
+			pkt = skb_clone(skb, GFP_ATOMIC);
+			if (!pkt) {
+				RNDIS_IPA_ERROR("no memory for rx clone\n");
+				rndis_ipa_ctx->rx_dropped++;
+				dev_kfree_skb_any(skb);
+				return;
+			}
+			skb_pull(skb, msg_len);
+		}
+		skb_pull(pkt, data_ofst);
+		skb_trim(pkt, data_len);
+
+		rndis_ipa_ctx->rx_deaggr_pkts++;
+		rndis_ipa_rx_deliver(rndis_ipa_ctx, pkt);
+		if (pkt == skb)
+			return;
+	}
+	dev_kfree_skb_any(skb);
+	return;
+
+fail_malformed:
+	RNDIS_IPA_DEBUG("malformed RNDIS message, %d bytes dropped\n",
+		skb->len);
+	rndis_ipa_ctx->rx_deaggr_errors++;
+	rndis_ipa_ctx->rx_dropped++;
+	dev_kfree_skb_any(skb);
+}
+
+/**
+ * rndis_ipa_rx_deliver() - send one Ethernet frame up the network stack
+ * @rndis_ipa_ctx: main driver context
+ * @skb: skb whose data points to the Ethernet header
+ */
+static void rndis_ipa_rx_deliver(struct rndis_ipa_dev *rndis_ipa_ctx,
+		struct sk_buff *skb)
+{
+	unsigned int packet_len = skb->len;
+	int result;
 
 	skb->dev = rndis_ipa_ctx->net;
 	skb->protocol = eth_type_trans(skb, rndis_ipa_ctx->net);
@@ -1887,17 +1996,20 @@ static struct sk_buff *rndis_encapsulate_skb(struct sk_buff *skb)
 	struct rndis_pkt_hdr *rndis_hdr;
 	int payload_byte_len = skb->len;
 
-	/* if there is no room in this skb, allocate a new one */
-	if (unlikely(skb_headroom(skb) < sizeof(rndis_template_hdr))) {
-		struct sk_buff *new_skb = skb_copy_expand(skb,
-			sizeof(rndis_template_hdr), 0, GFP_ATOMIC);
-		if (!new_skb) {
+	/*
+	 * If there is no room in this skb, or its head is shared, reallocate
+	 * the head only; paged frags are kept as they are.
+	 */
+	if (unlikely(skb_headroom(skb) < sizeof(rndis_template_hdr) ||
+		     skb_header_cloned(skb))) {
+		struct rndis_ipa_dev *rndis_ipa_ctx = netdev_priv(skb->dev);
+
+		if (skb_cow_head(skb, sizeof(rndis_template_hdr))) {
 			RNDIS_IPA_ERROR("no memory for skb expand\n");
 			return skb;
 		}
-		RNDIS_IPA_DEBUG("skb expanded. old %p new %p\n", skb, new_skb);
-		dev_kfree_skb_any(skb);
-		skb = new_skb;
+		RNDIS_IPA_DEBUG("skb head expanded %p\n", skb);
+		rndis_ipa_ctx->tx_hdr_expand++;
 	}
 
 	/* make room at the head of the SKB to put the RNDIS header */
@@ -2317,6 +2429,14 @@ static void rndis_ipa_debugfs_init(struct rndis_ipa_dev *rndis_ipa_ctx)
 		goto fail_file;
 	}
 
+	file = debugfs_create_file("aggr_stats", flags_read_only,
+				aggr_directory,
+				rndis_ipa_ctx, &rndis_ipa_aggr_stats_ops);
+	if (!file) {
+		RNDIS_IPA_ERROR("could not create aggr_stats file\n");
+		goto fail_file;
+	}
+
 	file = debugfs_create_bool("tx_dump_enable", flags_read_write,
 			rndis_ipa_ctx->directory,
 			&rndis_ipa_ctx->tx_dump_enable);
@@ -2406,6 +2526,31 @@ static ssize_t rndis_ipa_debugfs_aggr_write(struct file *file,
 	return count;
 }
 
+static ssize_t rndis_ipa_debugfs_aggr_stats_read(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct rndis_ipa_dev *rndis_ipa_ctx = file->private_data;
+	char buf[256];
+	u32 xfers = rndis_ipa_ctx->rx_xfers;
+	u32 pkts = rndis_ipa_ctx->rx_deaggr_pkts;
+	u32 ratio = xfers ? (u32)div_u64((u64)pkts * 100, xfers) : 0;
+	int nbytes;
+
+	nbytes = scnprintf(buf, sizeof(buf),
+		"rx_xfers: %u\n"
+		"rx_deaggr_pkts: %u\n"
+		"rx_pkts_per_xfer: %u.%02u\n"
+		"rx_deaggr_errors: %u\n"
+		"tx_sg_pkts: %u\n"
+		"tx_hdr_expand: %u\n",
+		xfers, pkts, ratio / 100, ratio % 100,
+		rndis_ipa_ctx->rx_deaggr_errors,
+		rndis_ipa_ctx->tx_sg_pkts,
+		rndis_ipa_ctx->tx_hdr_expand);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, nbytes);
+}
+
 static int rndis_ipa_debugfs_atomic_open(struct inode *inode, struct file *file)
 {
 	struct rndis_ipa_dev *rndis_ipa_ctx = inode->i_private;
@@ -17,6 +17,9 @@
 #include <linux/wcnss_wlan.h>
 #include <linux/spinlock.h>
 #include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/log2.h>
+#include <linux/workqueue.h>
 #include <net/cnss_prealloc.h>
 #ifdef	CONFIG_WCNSS_SKB_PRE_ALLOC
 #include <linux/skbuff.h>
@@ -31,98 +34,108 @@ static DEFINE_SPINLOCK(alloc_lock);
 #define PRE_ALLOC_DEBUGFS_DIR		"cnss-prealloc"
 #define PRE_ALLOC_DEBUGFS_FILE_OBJ	"status"
 
+/* size classes are powers of two from 8Kb up */
+#define WCNSS_PREALLOC_MIN_SHIFT	13
+#define WCNSS_PREALLOC_HASH_BITS	7
+
 static struct dentry *debug_base;
 
+static unsigned int prealloc_max_mult = 2;
+module_param(prealloc_max_mult, uint, 0644);
+MODULE_PARM_DESC(prealloc_max_mult,
+		 "Max buffers per size class, as a multiple of the boot count");
+
 struct wcnss_prealloc {
 	int occupied;
 	size_t size;
 	void *ptr;
+	struct list_head list;
+	struct hlist_node node;
 #ifdef CONFIG_SLUB_DEBUG
 	unsigned long stack_trace[WCNSS_MAX_STACK_TRACE];
 	struct stack_trace trace;
 #endif
 };
 
+/**
+ * struct wcnss_prealloc_class - pool of same sized buffers
+ * @size: buffer size of this class
+ * @nr_init: number of buffers allocated at boot
+ * @nr_total: number of buffers currently owned by the pool
+ * @nr_used: number of buffers handed out
+ * @hwm: most buffers ever wanted at once, including requests that missed
+ * @hits: requests served from this class
+ * @borrowed: hits that had to take a buffer from a larger class
+ * @misses: requests for this class that found no free buffer at all
+ * @free_list: free buffers
+ */
+struct wcnss_prealloc_class {
+	size_t size;
+	unsigned int nr_init;
+	unsigned int nr_total;
+	unsigned int nr_used;
+	unsigned int hwm;
+	unsigned long hits;
+	unsigned long borrowed;
+	unsigned long misses;
+	struct list_head free_list;
+};
+
 /* pre-alloced mem for WLAN driver */
-static struct wcnss_prealloc wcnss_allocs[] = {
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 128 * 1024, NULL},
-	{0, 128 * 1024, NULL},
+static struct wcnss_prealloc_class wcnss_classes[] = {
+	{ .size = 8 * 1024, .nr_init = 8 },
+	{ .size = 16 * 1024, .nr_init = 42 },
+	{ .size = 32 * 1024, .nr_init = 10 },
+	{ .size = 64 * 1024, .nr_init = 5 },
+	{ .size = 128 * 1024, .nr_init = 2 },
 };
 
+/* all buffers, looked up by address on put */
+static DEFINE_HASHTABLE(wcnss_allocs, WCNSS_PREALLOC_HASH_BITS);
+
+static void wcnss_prealloc_grow_work(struct work_struct *work);
+static DECLARE_WORK(grow_work, wcnss_prealloc_grow_work);
+
+static int wcnss_prealloc_class_idx(size_t size)
+{
+	if (size <= (1UL << WCNSS_PREALLOC_MIN_SHIFT))
+		return 0;
+	return order_base_2(size) - WCNSS_PREALLOC_MIN_SHIFT;
+}
+
+static int wcnss_prealloc_add(struct wcnss_prealloc_class *class, gfp_t gfp)
+{
+	struct wcnss_prealloc *entry;
+	unsigned long flags;
+
+	entry = kzalloc(sizeof(*entry), gfp);
+	if (!entry)
+		return -ENOMEM;
+	entry->size = class->size;
+	entry->ptr = kmalloc(class->size, gfp);
+	if (!entry->ptr) {
+		kfree(entry);
+		return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&alloc_lock, flags);
+	hash_add(wcnss_allocs, &entry->node, (unsigned long)entry->ptr);
+	list_add(&entry->list, &class->free_list);
+	class->nr_total++;
+	spin_unlock_irqrestore(&alloc_lock, flags);
+
+	return 0;
+}
+
 int wcnss_prealloc_init(void)
 {
-	int i;
+	int i, j;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		wcnss_allocs[i].occupied = 0;
-		wcnss_allocs[i].ptr = kmalloc(wcnss_allocs[i].size, GFP_KERNEL);
-		if (wcnss_allocs[i].ptr == NULL)
-			return -ENOMEM;
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		INIT_LIST_HEAD(&wcnss_classes[i].free_list);
+		for (j = 0; j < wcnss_classes[i].nr_init; j++)
+			if (wcnss_prealloc_add(&wcnss_classes[i], GFP_KERNEL))
+				return -ENOMEM;
 	}
 
 	return 0;
@@ -130,11 +143,50 @@ int wcnss_prealloc_init(void)
 
 void wcnss_prealloc_deinit(void)
 {
-	int i = 0;
+	struct wcnss_prealloc *entry;
+	struct hlist_node *tmp;
+	int i;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		kfree(wcnss_allocs[i].ptr);
-		wcnss_allocs[i].ptr = NULL;
+	cancel_work_sync(&grow_work);
+	hash_for_each_safe(wcnss_allocs, i, tmp, entry, node) {
+		hash_del(&entry->node);
+		kfree(entry->ptr);
+		kfree(entry);
+	}
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		INIT_LIST_HEAD(&wcnss_classes[i].free_list);
+		wcnss_classes[i].nr_total = 0;
+		wcnss_classes[i].nr_used = 0;
+	}
+}
+
+/*
+ * Top every class up to one buffer above its high-water mark, so that
+ * a driver reload or recovery finds the pool as large as it last needed
+ * it instead of falling back to atomic allocations.
+ */
+static void wcnss_prealloc_grow_work(struct work_struct *work)
+{
+	struct wcnss_prealloc_class *class;
+	unsigned long flags;
+	unsigned int want;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		class = &wcnss_classes[i];
+		for (;;) {
+			spin_lock_irqsave(&alloc_lock, flags);
+			want = min(class->hwm + 1,
+				   class->nr_init * prealloc_max_mult);
+			spin_unlock_irqrestore(&alloc_lock, flags);
+			if (class->nr_total >= want)
+				break;
+			if (wcnss_prealloc_add(class, GFP_KERNEL)) {
+				pr_err("wcnss: %s: could not grow %zu Kb pool\n",
+				       __func__, class->size / 1024);
+				return;
+			}
+		}
 	}
 }
 
@@ -162,24 +214,47 @@ static inline void wcnss_prealloc_save_stack_trace(struct wcnss_prealloc *entry)
 
 void *wcnss_prealloc_get(size_t size)
 {
-	int i = 0;
+	struct wcnss_prealloc_class *class;
+	struct wcnss_prealloc *entry;
 	unsigned long flags;
+	int idx, i;
+
+	idx = wcnss_prealloc_class_idx(size);
+	if (idx >= ARRAY_SIZE(wcnss_classes))
+		goto fail;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].occupied)
+	class = &wcnss_classes[idx];
+	/* the smallest class with a free buffer that fits */
+	for (i = idx; i < ARRAY_SIZE(wcnss_classes); i++) {
+		entry = list_first_entry_or_null(&wcnss_classes[i].free_list,
+						 struct wcnss_prealloc, list);
+		if (!entry)
 			continue;
 
-		if (wcnss_allocs[i].size >= size) {
-			/* we found the slot */
-			wcnss_allocs[i].occupied = 1;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
-			return wcnss_allocs[i].ptr;
+		list_del(&entry->list);
+		entry->occupied = 1;
+		wcnss_classes[i].nr_used++;
+		class->hits++;
+		if (i != idx) {
+			class->borrowed++;
+			class->hwm = max(class->hwm, class->nr_total + 1);
+		} else {
+			class->hwm = max(class->hwm, class->nr_used);
 		}
+		if (class->nr_total <= class->hwm &&
+		    class->nr_total < class->nr_init * prealloc_max_mult)
+			schedule_work(&grow_work);
+		spin_unlock_irqrestore(&alloc_lock, flags);
+		wcnss_prealloc_save_stack_trace(entry);
+		return entry->ptr;
 	}
+	class->misses++;
+	class->hwm = max(class->hwm, class->nr_used + 1);
+	schedule_work(&grow_work);
 	spin_unlock_irqrestore(&alloc_lock, flags);
 
+fail:
 	pr_err("wcnss: %s: prealloc not available for size: %zu\n",
 	       __func__, size);
 
@@ -187,15 +262,25 @@ void *wcnss_prealloc_get(size_t size)
 }
 EXPORT_SYMBOL(wcnss_prealloc_get);
 
+static void wcnss_prealloc_release(struct wcnss_prealloc *entry)
+{
+	struct wcnss_prealloc_class *class =
+		&wcnss_classes[wcnss_prealloc_class_idx(entry->size)];
+
+	entry->occupied = 0;
+	class->nr_used--;
+	list_add(&entry->list, &class->free_list);
+}
+
 int wcnss_prealloc_put(void *ptr)
 {
-	int i = 0;
+	struct wcnss_prealloc *entry;
 	unsigned long flags;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].ptr == ptr) {
-			wcnss_allocs[i].occupied = 0;
+	hash_for_each_possible(wcnss_allocs, entry, node, (unsigned long)ptr) {
+		if (entry->ptr == ptr && entry->occupied) {
+			wcnss_prealloc_release(entry);
 			spin_unlock_irqrestore(&alloc_lock, flags);
 			return 1;
 		}
@@ -209,10 +294,11 @@ EXPORT_SYMBOL(wcnss_prealloc_put);
 #ifdef CONFIG_SLUB_DEBUG
 void wcnss_prealloc_check_memory_leak(void)
 {
+	struct wcnss_prealloc *entry;
 	int i, j = 0;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
+	hash_for_each(wcnss_allocs, i, entry, node) {
+		if (!entry->occupied)
 			continue;
 
 		if (j == 0) {
@@ -221,8 +307,8 @@ void wcnss_prealloc_check_memory_leak(void)
 		}
 
 		pr_err("Size: %zu, addr: %pK, backtrace:\n",
-		       wcnss_allocs[i].size, wcnss_allocs[i].ptr);
-		print_stack_trace(&wcnss_allocs[i].trace, 1);
+		       entry->size, entry->ptr);
+		print_stack_trace(&entry->trace, 1);
 	}
 
 }
@@ -233,15 +319,19 @@ EXPORT_SYMBOL(wcnss_prealloc_check_memory_leak);
 
 int wcnss_pre_alloc_reset(void)
 {
+	struct wcnss_prealloc *entry;
+	unsigned long flags;
 	int i, n = 0;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
+	spin_lock_irqsave(&alloc_lock, flags);
+	hash_for_each(wcnss_allocs, i, entry, node) {
+		if (!entry->occupied)
 			continue;
 
-		wcnss_allocs[i].occupied = 0;
+		wcnss_prealloc_release(entry);
 		n++;
 	}
+	spin_unlock_irqrestore(&alloc_lock, flags);
 
 	return n;
 }
@@ -249,42 +339,29 @@ EXPORT_SYMBOL(wcnss_pre_alloc_reset);
 
 int prealloc_memory_stats_show(struct seq_file *fp, void *data)
 {
-	int i = 0;
-	int used_slots = 0, free_slots = 0;
-	unsigned int tsize = 0, tused = 0, size = 0;
-
-	seq_puts(fp, "\nSlot_Size(Kb)\t\t[Used : Free]\n");
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		tsize += wcnss_allocs[i].size;
-		if (size != wcnss_allocs[i].size) {
-			if (size) {
-				seq_printf(
-					fp, "[%d : %d]\n",
-					used_slots, free_slots);
-			}
-
-			size = wcnss_allocs[i].size;
-			used_slots = 0;
-			free_slots = 0;
-			seq_printf(fp, "%d Kb\t\t\t", size / 1024);
-		}
+	struct wcnss_prealloc_class *class;
+	unsigned long tsize = 0, tused = 0;
+	unsigned long flags;
+	int i;
 
-		if (wcnss_allocs[i].occupied) {
-			tused += wcnss_allocs[i].size;
-			++used_slots;
-		} else {
-			++free_slots;
-		}
+	seq_puts(fp, "\nSlot_Size(Kb)\t\t[Used : Free]\tHWM\tHits\tBorrowed\tMisses\n");
+	spin_lock_irqsave(&alloc_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		class = &wcnss_classes[i];
+		tsize += class->nr_total * class->size;
+		tused += class->nr_used * class->size;
+		seq_printf(fp, "%zu Kb\t\t\t[%u : %u]\t%u\t%lu\t%lu\t\t%lu\n",
+			   class->size / 1024, class->nr_used,
+			   class->nr_total - class->nr_used, class->hwm,
+			   class->hits, class->borrowed, class->misses);
 	}
-	seq_printf(fp, "[%d : %d]\n", used_slots, free_slots);
+	spin_unlock_irqrestore(&alloc_lock, flags);
 
 	/* Convert byte to Kb */
-	if (tsize)
-		tsize = tsize / 1024;
-	if (tused)
-		tused = tused / 1024;
-	seq_printf(fp, "\nMemory Status:\nTotal Memory: %dKb\n", tsize);
-	seq_printf(fp, "Used: %dKb\nFree: %dKb\n", tused, tsize - tused);
+	tsize = tsize / 1024;
+	tused = tused / 1024;
+	seq_printf(fp, "\nMemory Status:\nTotal Memory: %luKb\n", tsize);
+	seq_printf(fp, "Used: %luKb\nFree: %luKb\n", tused, tsize - tused);
 
 	return 0;
 }
@@ -30,6 +30,16 @@
 
 #define GSI_RESET_WA_MIN_SLEEP 1000
 #define GSI_RESET_WA_MAX_SLEEP 2000
+
+/*
+ * Completions per poll are averaged in 1/16ths with a weight of 1/4.
+ * Entering poll mode primes the average to 4, so a channel goes back to
+ * callback mode after about 5 empty polls in a row, once the average
+ * has dropped below one completion per poll.
+ */
+#define GSI_POLL_RATE_SHIFT 4
+#define GSI_POLL_RATE_INIT (4 << GSI_POLL_RATE_SHIFT)
+#define GSI_POLL_RATE_EXIT (1 << GSI_POLL_RATE_SHIFT)
 static const struct of_device_id msm_gsi_match[] = {
 	{ .compatible = "qcom,msm_gsi", },
 	{ },
@@ -2515,6 +2525,82 @@ int gsi_poll_channel(unsigned long chan_hdl,
 }
 EXPORT_SYMBOL(gsi_poll_channel);
 
+int gsi_poll_channel_multi(unsigned long chan_hdl, uint16_t expected_num,
+		uint16_t *actual_num, struct gsi_chan_xfer_notify *notify)
+{
+	struct gsi_chan_ctx *ctx;
+	uint64_t rp;
+	int ee;
+	unsigned long flags;
+	uint16_t n = 0;
+	unsigned int rate;
+
+	if (!gsi_ctx) {
+		pr_err("%s:%d gsi context not allocated\n", __func__, __LINE__);
+		return -GSI_STATUS_NODEV;
+	}
+	ee = gsi_ctx->per.ee;
+
+	if (chan_hdl >= gsi_ctx->max_ch || !notify || !actual_num ||
+			!expected_num) {
+		GSIERR("bad params chan_hdl=%lu notify=%p actual_num=%p\n",
+				chan_hdl, notify, actual_num);
+		return -GSI_STATUS_INVALID_PARAMS;
+	}
+	*actual_num = 0;
+
+	ctx = &gsi_ctx->chan[chan_hdl];
+
+	if (ctx->props.prot != GSI_CHAN_PROT_GPI) {
+		GSIERR("op not supported for protocol %u\n", ctx->props.prot);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	if (!ctx->evtr) {
+		GSIERR("no event ring associated chan_hdl=%lu\n", chan_hdl);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	spin_lock_irqsave(&ctx->evtr->ring.slock, flags);
+	rp = gsi_readl(gsi_ctx->base +
+		GSI_EE_n_EV_CH_k_CNTXT_4_OFFS(ctx->evtr->id, ee));
+	rp |= ((uint64_t)gsi_readl(gsi_ctx->base +
+		GSI_EE_n_EV_CH_k_CNTXT_5_OFFS(ctx->evtr->id, ee))) << 32;
+	ctx->evtr->ring.rp = rp;
+
+	while (n < expected_num && ctx->evtr->ring.rp_local != rp)
+		gsi_process_evt_re(ctx->evtr, &notify[n++], false);
+
+	/* one doorbell recycles the whole batch of event elements */
+	if (n)
+		gsi_ring_evt_doorbell(ctx->evtr);
+
+	rate = ctx->poll_rate;
+	rate += ((n << GSI_POLL_RATE_SHIFT) >> 2) - (rate >> 2);
+	ctx->poll_rate = rate;
+	spin_unlock_irqrestore(&ctx->evtr->ring.slock, flags);
+
+	*actual_num = n;
+	if (n) {
+		ctx->stats.poll_ok++;
+		ctx->stats.poll_batched += n;
+		return GSI_STATUS_SUCCESS;
+	}
+
+	ctx->stats.poll_empty++;
+
+	/*
+	 * While completions are still coming at a high enough rate, tell a
+	 * client in poll mode to carry on polling rather than paying for an
+	 * interrupt on the next transfer.
+	 */
+	if (atomic_read(&ctx->poll_mode) && rate >= GSI_POLL_RATE_EXIT)
+		return GSI_STATUS_AGAIN;
+
+	return GSI_STATUS_POLL_EMPTY;
+}
+EXPORT_SYMBOL(gsi_poll_channel_multi);
+
 int gsi_config_channel_mode(unsigned long chan_hdl, enum gsi_chan_mode mode)
 {
 	struct gsi_chan_ctx *ctx;
@@ -2559,6 +2645,7 @@ int gsi_config_channel_mode(unsigned long chan_hdl, enum gsi_chan_mode mode)
 	if (curr == GSI_CHAN_MODE_CALLBACK &&
 			mode == GSI_CHAN_MODE_POLL) {
 		__gsi_config_ieob_irq(gsi_ctx->per.ee, 1 << ctx->evtr->id, 0);
+		ctx->poll_rate = GSI_POLL_RATE_INIT;
 		ctx->stats.callback_to_poll++;
 	}
 
@@ -115,6 +115,7 @@ struct gsi_chan_stats {
 	unsigned long invalid_tre_error;
 	unsigned long poll_ok;
 	unsigned long poll_empty;
+	unsigned long poll_batched;
 	struct gsi_chan_dp_stats dp;
 };
 
@@ -128,6 +129,7 @@ struct gsi_chan_ctx {
 	struct completion compl;
 	bool allocated;
 	atomic_t poll_mode;
+	unsigned int poll_rate;
 	union __packed gsi_channel_scratch scratch;
 	struct gsi_chan_stats stats;
 	bool enable_dp_stats;
@@ -275,8 +275,9 @@ static void gsi_dump_ch_stats(struct gsi_chan_ctx *ctx)
 		ctx->stats.poll_to_callback);
 	PRT_STAT("invalid_tre_error=%lu\n",
 		ctx->stats.invalid_tre_error);
-	PRT_STAT("poll_ok=%lu poll_empty=%lu\n",
-		ctx->stats.poll_ok, ctx->stats.poll_empty);
+	PRT_STAT("poll_ok=%lu poll_empty=%lu poll_batched=%lu\n",
+		ctx->stats.poll_ok, ctx->stats.poll_empty,
+		ctx->stats.poll_batched);
 	if (ctx->evtr)
 		PRT_STAT("compl_evt=%lu\n",
 			ctx->evtr->stats.completed);
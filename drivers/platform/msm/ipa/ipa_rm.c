@@ -1032,8 +1032,18 @@ int ipa_rm_stat(char *buf, int size)
 	result = cnt;
 bail:
 	spin_unlock_irqrestore(&ipa_rm_ctx->ipa_rm_lock, flags);
+	if (result < 0)
+		return result;
 
-	return result;
+	/*
+	 * Timer locks nest outside ipa_rm_lock (the timer releases under
+	 * its own lock), so print the timers after dropping it.
+	 */
+	for (i = 0; i < IPA_RM_RESOURCE_PROD_MAX; ++i)
+		cnt += ipa_rm_inactivity_timer_print_stat(i, buf + cnt,
+							  size - cnt);
+
+	return cnt;
 }
 
 /**
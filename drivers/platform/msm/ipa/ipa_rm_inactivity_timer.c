@@ -20,6 +20,32 @@
 #include <linux/ipa.h>
 #include "ipa_rm_i.h"
 
+/*
+ * The release delay stretches up to this multiple of the configured
+ * timeout while the resource keeps being re-requested shortly after
+ * it was released, and decays back once traffic goes quiet.
+ */
+#define IPA_RM_IT_MAX_MULT	8
+#define IPA_RM_IT_GAP_WEIGHT	3
+
+/**
+ * struct ipa_rm_it_stats - IPA RM Inactivity Timer vote statistics
+ * @requests: calls to ipa_rm_inactivity_timer_request_resource()
+ * @releases: calls to ipa_rm_inactivity_timer_release_resource()
+ * @release_votes: timer expiries which actually released the resource
+ * @saved_votes: requests which arrived while the release was pending
+ * @churn: requests which arrived within the maximal delay after the
+ *	resource was released, i.e. release/request pairs the timer
+ *	could have absorbed
+ */
+struct ipa_rm_it_stats {
+	u32 requests;
+	u32 releases;
+	u32 release_votes;
+	u32 saved_votes;
+	u32 churn;
+};
+
 /**
  * struct ipa_rm_it_private - IPA RM Inactivity Timer private
  *	data
@@ -32,7 +58,13 @@
  * @reschedule_work: boolean flag indicates to not release and to
  *	reschedule the release work.
  * @work_in_progress: boolean flag indicates is release work was scheduled.
- * @jiffies: number of jiffies for timeout
+ * @jiffies: number of jiffies for timeout, adapted to traffic
+ * @base_jiffies: timeout set by ipa_rm_inactivity_timer_init()
+ * @max_jiffies: upper bound for @jiffies
+ * @release_ts: jiffies of the last release done by the timer
+ * @released: resource was released by the timer and not requested since
+ * @gap_avg: moving average of the release to request gap, in jiffies
+ * @stats: vote statistics
  *
  * WWAN private - holds all relevant info about WWAN driver
  */
@@ -45,10 +77,47 @@ struct ipa_rm_it_private {
 	bool reschedule_work;
 	bool work_in_progress;
 	unsigned long jiffies;
+	unsigned long base_jiffies;
+	unsigned long max_jiffies;
+	unsigned long release_ts;
+	bool released;
+	unsigned long gap_avg;
+	struct ipa_rm_it_stats stats;
 };
 
 static struct ipa_rm_it_private ipa_rm_it_handles[IPA_RM_RESOURCE_MAX];
 
+/**
+ * ipa_rm_inactivity_timer_adapt() - adapt the release delay to the time
+ * passed between the last release and the current request.
+ *
+ * A request shortly after the release means the clocks were voted off
+ * and on again for nothing, so the delay is stretched to twice the
+ * average gap. Long gaps pull the delay back towards the configured
+ * timeout. Called with the handle lock held.
+ */
+static void ipa_rm_inactivity_timer_adapt(struct ipa_rm_it_private *me)
+{
+	unsigned long gap = jiffies - me->release_ts;
+
+	me->released = false;
+	if (gap >= me->max_jiffies) {
+		me->gap_avg = 0;
+		me->jiffies = max(me->base_jiffies,
+			me->jiffies - ((me->jiffies - me->base_jiffies) >> 1));
+		return;
+	}
+
+	me->stats.churn++;
+	if (me->gap_avg)
+		me->gap_avg += ((long)gap - (long)me->gap_avg) >>
+			IPA_RM_IT_GAP_WEIGHT;
+	else
+		me->gap_avg = gap;
+	me->jiffies = clamp(me->gap_avg * 2 + 1, me->base_jiffies,
+		me->max_jiffies);
+}
+
 /**
  * ipa_rm_inactivity_timer_func() - called when timer expired in
  * the context of the shared workqueue. Checks internally if
@@ -89,6 +158,9 @@ static void ipa_rm_inactivity_timer_func(struct work_struct *work)
 			__func__, me->resource_name);
 		ipa_rm_release_resource(me->resource_name);
 		ipa_rm_it_handles[me->resource_name].work_in_progress = false;
+		ipa_rm_it_handles[me->resource_name].released = true;
+		ipa_rm_it_handles[me->resource_name].release_ts = jiffies;
+		ipa_rm_it_handles[me->resource_name].stats.release_votes++;
 	}
 	spin_unlock_irqrestore(
 		&ipa_rm_it_handles[me->resource_name].lock, flags);
@@ -127,6 +199,14 @@ int ipa_rm_inactivity_timer_init(enum ipa_rm_resource_name resource_name,
 	spin_lock_init(&ipa_rm_it_handles[resource_name].lock);
 	ipa_rm_it_handles[resource_name].resource_name = resource_name;
 	ipa_rm_it_handles[resource_name].jiffies = msecs_to_jiffies(msecs);
+	ipa_rm_it_handles[resource_name].base_jiffies =
+		ipa_rm_it_handles[resource_name].jiffies;
+	ipa_rm_it_handles[resource_name].max_jiffies =
+		ipa_rm_it_handles[resource_name].jiffies * IPA_RM_IT_MAX_MULT;
+	ipa_rm_it_handles[resource_name].released = false;
+	ipa_rm_it_handles[resource_name].gap_avg = 0;
+	memset(&ipa_rm_it_handles[resource_name].stats, 0,
+	       sizeof(ipa_rm_it_handles[resource_name].stats));
 	ipa_rm_it_handles[resource_name].resource_requested = false;
 	ipa_rm_it_handles[resource_name].reschedule_work = false;
 	ipa_rm_it_handles[resource_name].work_in_progress = false;
@@ -207,6 +287,12 @@ int ipa_rm_inactivity_timer_request_resource(
 
 	spin_lock_irqsave(&ipa_rm_it_handles[resource_name].lock, flags);
 	ipa_rm_it_handles[resource_name].resource_requested = true;
+	ipa_rm_it_handles[resource_name].stats.requests++;
+	if (ipa_rm_it_handles[resource_name].work_in_progress)
+		ipa_rm_it_handles[resource_name].stats.saved_votes++;
+	else if (ipa_rm_it_handles[resource_name].released)
+		ipa_rm_inactivity_timer_adapt(
+			&ipa_rm_it_handles[resource_name]);
 	spin_unlock_irqrestore(&ipa_rm_it_handles[resource_name].lock, flags);
 	ret = ipa_rm_request_resource(resource_name);
 	IPA_RM_DBG_LOW("%s: resource %d: returning %d\n", __func__,
@@ -251,6 +337,7 @@ int ipa_rm_inactivity_timer_release_resource(
 
 	spin_lock_irqsave(&ipa_rm_it_handles[resource_name].lock, flags);
 	ipa_rm_it_handles[resource_name].resource_requested = false;
+	ipa_rm_it_handles[resource_name].stats.releases++;
 	if (ipa_rm_it_handles[resource_name].work_in_progress) {
 		IPA_RM_DBG_LOW("%s: Timer already set, no sched again %d\n",
 		    __func__, resource_name);
@@ -271,3 +358,42 @@ int ipa_rm_inactivity_timer_release_resource(
 }
 EXPORT_SYMBOL(ipa_rm_inactivity_timer_release_resource);
 
+
+/**
+ * ipa_rm_inactivity_timer_print_stat() - print the vote statistics and
+ * current release delay of an inactivity timer
+ *
+ * @resource_name: Resource name. @see ipa_rm.h
+ * @buf: [in] The buf used to print
+ * @size: [in] Buf size
+ *
+ * Returns: number of bytes used, 0 if the timer is not initialized
+ */
+int ipa_rm_inactivity_timer_print_stat(enum ipa_rm_resource_name resource_name,
+				       char *buf, int size)
+{
+	struct ipa_rm_it_private *me;
+	unsigned long flags;
+	int cnt;
+
+	if (resource_name < 0 || resource_name >= IPA_RM_RESOURCE_MAX ||
+	    !buf || size < 0)
+		return -EINVAL;
+
+	me = &ipa_rm_it_handles[resource_name];
+	if (!me->initied)
+		return 0;
+
+	spin_lock_irqsave(&me->lock, flags);
+	cnt = scnprintf(buf, size,
+		"%s timer: delay %u ms (base %u), req %u, rel %u, rel votes %u, saved %u, churn %u\n",
+		ipa_rm_resource_str(resource_name),
+		jiffies_to_msecs(me->jiffies),
+		jiffies_to_msecs(me->base_jiffies),
+		me->stats.requests, me->stats.releases,
+		me->stats.release_votes, me->stats.saved_votes,
+		me->stats.churn);
+	spin_unlock_irqrestore(&me->lock, flags);
+
+	return cnt;
+}
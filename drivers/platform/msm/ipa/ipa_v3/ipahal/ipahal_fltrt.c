@@ -12,6 +12,9 @@
 
 #include <linux/ipc_logging.h>
 #include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/ktime.h>
 #include <linux/ipa.h>
 #include "ipahal.h"
 #include "ipahal_fltrt.h"
@@ -162,6 +165,7 @@ static int ipa_rt_parse_hw_rule(u8 *addr,
 		struct ipahal_rt_rule_entry *rule);
 static int ipa_flt_parse_hw_rule(u8 *addr,
 		struct ipahal_flt_rule_entry *rule);
+static void ipahal_fltrt_cache_flush(void);
 
 #define IPA_IS_RAN_OUT_OF_EQ(__eq_array, __eq_index) \
 	(ARRAY_SIZE(__eq_array) <= (__eq_index))
@@ -2711,6 +2715,8 @@ void ipahal_fltrt_destroy(void)
 {
 	IPAHAL_DBG("Entry\n");
 
+	ipahal_fltrt_cache_flush();
+
 	if (ipahal_ctx && ipahal_ctx->empty_fltrt_tbl.base)
 		dma_free_coherent(ipahal_ctx->ipa_pdev,
 			ipahal_ctx->empty_fltrt_tbl.size,
@@ -2799,6 +2805,242 @@ u32 ipahal_get_low_rule_id(void)
 	return  ipahal_fltrt_objs[ipahal_ctx->hw_type].low_rule_id;
 }
 
+/*
+ * Generated H/W rules are cached by the content of their generation
+ *  params. A commit rebuilds whole table images rule by rule, and with
+ *  the cache only the rules that changed since the previous commit go
+ *  through the rule generator (and ipa_flt_generate_eq()). The others
+ *  are copied from the cached image.
+ */
+#define IPAHAL_FLTRT_CACHE_HASH_BITS 8
+#define IPAHAL_FLTRT_CACHE_MAX 512
+
+/*
+ * struct ipahal_fltrt_cache_key - All the input the generators depend on
+ *  Zeroed before being filled so that padding compares equal.
+ */
+struct ipahal_fltrt_cache_key {
+	bool is_flt;
+	enum ipa_ip_type ipt;
+	u32 priority;
+	u32 id;
+	union {
+		struct {
+			u32 rt_tbl_idx;
+			struct ipa_flt_rule rule;
+		} flt;
+		struct {
+			int dst_pipe_idx;
+			enum ipahal_rt_rule_hdr_type hdr_type;
+			bool hdr_lcl;
+			u32 hdr_ofst;
+			struct ipa_rt_rule rule;
+		} rt;
+	} u;
+};
+
+/*
+ * struct ipahal_fltrt_cache_entry - Cached H/W rule
+ * @data: key_len bytes of key followed by hw_len bytes of H/W rule
+ */
+struct ipahal_fltrt_cache_entry {
+	struct hlist_node node;
+	struct list_head lru;
+	u32 hash;
+	u32 key_len;
+	u32 hw_len;
+	u8 data[0];
+};
+
+static struct ipahal_fltrt_cache {
+	struct mutex lock;
+	DECLARE_HASHTABLE(tbl, IPAHAL_FLTRT_CACHE_HASH_BITS);
+	struct list_head lru;
+	u32 cnt;
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 gen_cnt;
+	u64 gen_total_ns;
+	u64 gen_max_ns;
+} ipahal_fltrt_cache = {
+	.lock = __MUTEX_INITIALIZER(ipahal_fltrt_cache.lock),
+	.lru = LIST_HEAD_INIT(ipahal_fltrt_cache.lru),
+};
+
+static void ipahal_fltrt_cache_flt_key(struct ipahal_fltrt_cache_key *key,
+	u32 *key_len, const struct ipahal_flt_rule_gen_params *params)
+{
+	memset(key, 0, sizeof(*key));
+	key->is_flt = true;
+	key->ipt = params->ipt;
+	key->priority = params->priority;
+	key->id = params->id;
+	key->u.flt.rt_tbl_idx = params->rt_tbl_idx;
+	key->u.flt.rule = *params->rule;
+	*key_len = offsetof(struct ipahal_fltrt_cache_key, u) +
+		sizeof(key->u.flt);
+}
+
+static void ipahal_fltrt_cache_rt_key(struct ipahal_fltrt_cache_key *key,
+	u32 *key_len, const struct ipahal_rt_rule_gen_params *params)
+{
+	memset(key, 0, sizeof(*key));
+	key->ipt = params->ipt;
+	key->priority = params->priority;
+	key->id = params->id;
+	key->u.rt.dst_pipe_idx = params->dst_pipe_idx;
+	key->u.rt.hdr_type = params->hdr_type;
+	key->u.rt.hdr_lcl = params->hdr_lcl;
+	key->u.rt.hdr_ofst = params->hdr_ofst;
+	key->u.rt.rule = *params->rule;
+	*key_len = offsetof(struct ipahal_fltrt_cache_key, u) +
+		sizeof(key->u.rt);
+}
+
+/*
+ * ipahal_fltrt_cache_get() - Look up a cached H/W rule
+ *  On a hit, the rule length is returned in @hw_len and the rule is
+ *  copied to @buf unless it is NULL. A caller passing a non zero @hw_len
+ *  that differs from the cached one misses, leaving the length check and
+ *  the error to the generator.
+ */
+static bool ipahal_fltrt_cache_get(const struct ipahal_fltrt_cache_key *key,
+	u32 key_len, u32 hash, u32 *hw_len, u8 *buf)
+{
+	struct ipahal_fltrt_cache *cache = &ipahal_fltrt_cache;
+	struct ipahal_fltrt_cache_entry *entry;
+
+	hash_for_each_possible(cache->tbl, entry, node, hash) {
+		if (entry->hash != hash || entry->key_len != key_len ||
+			memcmp(entry->data, key, key_len))
+			continue;
+		if (*hw_len && *hw_len != entry->hw_len)
+			return false;
+
+		*hw_len = entry->hw_len;
+		if (buf)
+			memcpy(buf, entry->data + key_len, entry->hw_len);
+		list_move(&entry->lru, &cache->lru);
+		cache->hits++;
+		return true;
+	}
+
+	cache->misses++;
+	return false;
+}
+
+static void ipahal_fltrt_cache_put(const struct ipahal_fltrt_cache_key *key,
+	u32 key_len, u32 hash, u32 hw_len, const u8 *buf)
+{
+	struct ipahal_fltrt_cache *cache = &ipahal_fltrt_cache;
+	struct ipahal_fltrt_cache_entry *entry;
+
+	if (cache->cnt >= IPAHAL_FLTRT_CACHE_MAX) {
+		entry = list_last_entry(&cache->lru,
+			struct ipahal_fltrt_cache_entry, lru);
+		hash_del(&entry->node);
+		list_del(&entry->lru);
+		kfree(entry);
+		cache->cnt--;
+		cache->evictions++;
+	}
+
+	entry = kmalloc(sizeof(*entry) + key_len + hw_len, GFP_KERNEL);
+	if (!entry)
+		return;
+
+	entry->hash = hash;
+	entry->key_len = key_len;
+	entry->hw_len = hw_len;
+	memcpy(entry->data, key, key_len);
+	memcpy(entry->data + key_len, buf, hw_len);
+	hash_add(cache->tbl, &entry->node, hash);
+	list_add(&entry->lru, &cache->lru);
+	cache->cnt++;
+}
+
+static void ipahal_fltrt_cache_account(ktime_t start)
+{
+	struct ipahal_fltrt_cache *cache = &ipahal_fltrt_cache;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	cache->gen_cnt++;
+	cache->gen_total_ns += ns;
+	if (ns > cache->gen_max_ns)
+		cache->gen_max_ns = ns;
+}
+
+static void ipahal_fltrt_cache_flush(void)
+{
+	struct ipahal_fltrt_cache *cache = &ipahal_fltrt_cache;
+	struct ipahal_fltrt_cache_entry *entry, *next;
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry_safe(entry, next, &cache->lru, lru) {
+		hash_del(&entry->node);
+		list_del(&entry->lru);
+		kfree(entry);
+	}
+	cache->cnt = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->gen_cnt = 0;
+	cache->gen_total_ns = 0;
+	cache->gen_max_ns = 0;
+	mutex_unlock(&cache->lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static ssize_t ipahal_fltrt_cache_read(struct file *file, char __user *ubuf,
+	size_t count, loff_t *ppos)
+{
+	struct ipahal_fltrt_cache *cache = &ipahal_fltrt_cache;
+	char buf[384];
+	int nbytes;
+
+	mutex_lock(&cache->lock);
+	nbytes = scnprintf(buf, sizeof(buf),
+		"entries=%u/%u hits=%llu misses=%llu evictions=%llu\n"
+		"rules generated=%llu avg_ns=%llu max_ns=%llu\n",
+		cache->cnt, IPAHAL_FLTRT_CACHE_MAX, cache->hits,
+		cache->misses, cache->evictions, cache->gen_cnt,
+		cache->gen_cnt ?
+			div64_u64(cache->gen_total_ns, cache->gen_cnt) : 0,
+		cache->gen_max_ns);
+	mutex_unlock(&cache->lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, nbytes);
+}
+
+static ssize_t ipahal_fltrt_cache_write(struct file *file,
+	const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	ipahal_fltrt_cache_flush();
+
+	return count;
+}
+
+static const struct file_operations ipahal_fltrt_cache_ops = {
+	.read = ipahal_fltrt_cache_read,
+	.write = ipahal_fltrt_cache_write,
+};
+
+/*
+ * ipahal_fltrt_debugfs_init() - Add the rule cache stats under @dent
+ *  Reading the file gives the cache counters and the time spent per
+ *  generated rule, hit or miss. Writing to it flushes the cache and
+ *  clears the counters.
+ */
+void ipahal_fltrt_debugfs_init(struct dentry *dent)
+{
+	if (!debugfs_create_file("fltrt_cache", 0600, dent, NULL,
+		&ipahal_fltrt_cache_ops))
+		IPAHAL_ERR("fail to create fltrt_cache debugfs file\n");
+}
+#endif /* CONFIG_DEBUG_FS */
+
 /*
  * ipahal_rt_generate_empty_img() - Generate empty route image
  *  Creates routing header buffer for the given tables number.
@@ -3285,7 +3527,11 @@ int ipahal_fltrt_read_addr_from_hdr(void *hdr_base, u32 hdr_idx, u64 *addr,
 int ipahal_rt_generate_hw_rule(struct ipahal_rt_rule_gen_params *params,
 	u32 *hw_len, u8 *buf)
 {
+	struct ipahal_fltrt_cache_key key;
 	struct ipahal_fltrt_obj *obj;
+	ktime_t start;
+	u32 key_len;
+	u32 hash;
 	u8 *tmp = NULL;
 	int rc;
 
@@ -3306,26 +3552,45 @@ int ipahal_rt_generate_hw_rule(struct ipahal_rt_rule_gen_params *params,
 
 	obj = &ipahal_fltrt_objs[ipahal_ctx->hw_type];
 
+	if (buf && ((long)buf & obj->rule_start_alignment)) {
+		IPAHAL_ERR("buff is not rule rule start aligned\n");
+		return -EPERM;
+	}
+
+	start = ktime_get();
+	ipahal_fltrt_cache_rt_key(&key, &key_len, params);
+	hash = jhash(&key, key_len, 0);
+
+	mutex_lock(&ipahal_fltrt_cache.lock);
+	if (ipahal_fltrt_cache_get(&key, key_len, hash, hw_len, buf)) {
+		rc = 0;
+		goto out;
+	}
+
 	if (buf == NULL) {
 		tmp = kzalloc(obj->rule_buf_size, GFP_KERNEL);
 		if (!tmp) {
 			IPAHAL_ERR("failed to alloc %u bytes\n",
 				obj->rule_buf_size);
-			return -ENOMEM;
+			rc = -ENOMEM;
+			goto unlock;
 		}
 		buf = tmp;
-	} else
-		if ((long)buf & obj->rule_start_alignment) {
-			IPAHAL_ERR("buff is not rule rule start aligned\n");
-			return -EPERM;
-		}
+	}
 
 	rc = ipahal_fltrt_objs[ipahal_ctx->hw_type].rt_generate_hw_rule(
 		params, hw_len, buf);
+	if (!rc)
+		ipahal_fltrt_cache_put(&key, key_len, hash, *hw_len, buf);
+
+out:
 	if (!tmp && !rc) {
 		/* write the rule-set terminator */
 		memset(buf + *hw_len, 0, obj->tbl_width);
 	}
+	ipahal_fltrt_cache_account(start);
+unlock:
+	mutex_unlock(&ipahal_fltrt_cache.lock);
 
 	kfree(tmp);
 
@@ -3343,7 +3608,11 @@ int ipahal_rt_generate_hw_rule(struct ipahal_rt_rule_gen_params *params,
 int ipahal_flt_generate_hw_rule(struct ipahal_flt_rule_gen_params *params,
 	u32 *hw_len, u8 *buf)
 {
+	struct ipahal_fltrt_cache_key key;
 	struct ipahal_fltrt_obj *obj;
+	ktime_t start;
+	u32 key_len;
+	u32 hash;
 	u8 *tmp = NULL;
 	int rc;
 
@@ -3364,26 +3633,45 @@ int ipahal_flt_generate_hw_rule(struct ipahal_flt_rule_gen_params *params,
 
 	obj = &ipahal_fltrt_objs[ipahal_ctx->hw_type];
 
+	if (buf && ((long)buf & obj->rule_start_alignment)) {
+		IPAHAL_ERR("buff is not rule rule start aligned\n");
+		return -EPERM;
+	}
+
+	start = ktime_get();
+	ipahal_fltrt_cache_flt_key(&key, &key_len, params);
+	hash = jhash(&key, key_len, 0);
+
+	mutex_lock(&ipahal_fltrt_cache.lock);
+	if (ipahal_fltrt_cache_get(&key, key_len, hash, hw_len, buf)) {
+		rc = 0;
+		goto out;
+	}
+
 	if (buf == NULL) {
 		tmp = kzalloc(obj->rule_buf_size, GFP_KERNEL);
 		if (!tmp) {
 			IPAHAL_ERR("failed to alloc %u bytes\n",
 				obj->rule_buf_size);
-			return -ENOMEM;
+			rc = -ENOMEM;
+			goto unlock;
 		}
 		buf = tmp;
-	} else
-		if ((long)buf & obj->rule_start_alignment) {
-			IPAHAL_ERR("buff is not rule rule start aligned\n");
-			return -EPERM;
-		}
+	}
 
 	rc = ipahal_fltrt_objs[ipahal_ctx->hw_type].flt_generate_hw_rule(
 		params, hw_len, buf);
+	if (!rc)
+		ipahal_fltrt_cache_put(&key, key_len, hash, *hw_len, buf);
+
+out:
 	if (!tmp && !rc) {
 		/* write the rule-set terminator */
 		memset(buf + *hw_len, 0, obj->tbl_width);
 	}
+	ipahal_fltrt_cache_account(start);
+unlock:
+	mutex_unlock(&ipahal_fltrt_cache.lock);
 
 	kfree(tmp);
 
@@ -334,6 +334,11 @@ struct db_mode {
 	void (*process_db)(struct mhi_device_ctxt *mhi_dev_ctxt,
 			   void __iomem *io_addr, unsigned int chan,
 			   dma_addr_t val);
+	/* software doorbell batching, see mhi_set_db_burst() */
+	u32 burst_max;
+	u32 burst_timeout_us;
+	u32 burst_pending;
+	struct hrtimer burst_timer;
 };
 
 struct mhi_ring {
@@ -667,10 +672,18 @@ int delete_element(struct mhi_ring *ring, void **rp,
 			 void **wp, void **assigned_addr);
 int ctxt_add_element(struct mhi_ring *ring, void **assigned_addr);
 int ctxt_del_element(struct mhi_ring *ring, void **assigned_addr);
+int ctxt_add_elements(struct mhi_ring *ring, u32 nr_el,
+		      void **assigned_addr);
+int ctxt_del_elements(struct mhi_ring *ring, u32 nr_el,
+		      void **assigned_addr);
 int get_element_index(struct mhi_ring *ring, void *address,
 							uintptr_t *index);
 int recycle_trb_and_ring(struct mhi_device_ctxt *mhi_dev_ctxt,
 	struct mhi_ring *ring, enum MHI_RING_TYPE ring_type, u32 ring_index);
+int recycle_trbs_and_ring(struct mhi_device_ctxt *mhi_dev_ctxt,
+	struct mhi_ring *ring, enum MHI_RING_TYPE ring_type, u32 ring_index,
+	u32 nr_el);
+enum hrtimer_restart mhi_db_burst_timer(struct hrtimer *timer);
 int parse_xfer_event(struct mhi_device_ctxt *ctxt,
 				union mhi_event_pkt *event, u32 event_id);
 enum MHI_EVENT_CCS get_cmd_pkt(struct mhi_device_ctxt *mhi_dev_ctxt,
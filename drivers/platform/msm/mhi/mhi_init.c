@@ -33,6 +33,11 @@ static int mhi_init_sync(struct mhi_device_ctxt *mhi_dev_ctxt)
 		mutex_init(&mhi_dev_ctxt->mhi_chan_cfg[i].chan_lock);
 		spin_lock_init(&mhi_dev_ctxt->mhi_chan_cfg[i].event_lock);
 		spin_lock_init(&ring->ring_lock);
+		ring->mhi_dev_ctxt = mhi_dev_ctxt;
+		ring->index = i;
+		hrtimer_init(&ring->db_mode.burst_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		ring->db_mode.burst_timer.function = mhi_db_burst_timer;
 	}
 
 	for (i = 0; i < NR_OF_CMD_RINGS; i++) {
@@ -438,6 +443,8 @@ int mhi_init_chan_ctxt(struct mhi_chan_ctxt *cc_list,
 	ring->db_mode.db_mode = 1;
 	ring->db_mode.preserve_db_state = (preserve_db_state) ? 1 : 0;
 	ring->db_mode.brstmode = brstmode;
+	ring->db_mode.burst_max = 0;
+	ring->db_mode.burst_pending = 0;
 
 	switch (ring->db_mode.brstmode) {
 	case MHI_BRSTMODE_ENABLE:
@@ -24,6 +24,7 @@ static int mhi_process_event_ring(
 	union mhi_event_pkt *device_rp = NULL;
 	union mhi_event_pkt event_to_process;
 	int count = 0;
+	u32 nr_consumed = 0;
 	struct mhi_event_ctxt *ev_ctxt = NULL;
 	unsigned long flags;
 	struct mhi_ring *local_ev_ctxt =
@@ -58,10 +59,19 @@ static int mhi_process_event_ring(
 
 		spin_lock_irqsave(&local_ev_ctxt->ring_lock, flags);
 		event_to_process = *local_rp;
-		recycle_trb_and_ring(mhi_dev_ctxt,
-				     local_ev_ctxt,
-				     MHI_RING_TYPE_EVENT_RING,
-				     ev_index);
+		/*
+		 * Hand the elements back to the device in batches, one
+		 * event doorbell every MHI_EV_DB_INTERVAL events.
+		 */
+		ctxt_del_element(local_ev_ctxt, NULL);
+		if (++nr_consumed >= MHI_EV_DB_INTERVAL) {
+			recycle_trbs_and_ring(mhi_dev_ctxt,
+					      local_ev_ctxt,
+					      MHI_RING_TYPE_EVENT_RING,
+					      ev_index,
+					      nr_consumed);
+			nr_consumed = 0;
+		}
 		spin_unlock_irqrestore(&local_ev_ctxt->ring_lock, flags);
 
 		switch (MHI_TRB_READ_INFO(EV_TRB_TYPE, &event_to_process)) {
@@ -238,6 +248,15 @@ static int mhi_process_event_ring(
 		spin_unlock_irqrestore(&local_ev_ctxt->ring_lock, flags);
 		count++;
 	}
+	if (nr_consumed) {
+		spin_lock_irqsave(&local_ev_ctxt->ring_lock, flags);
+		recycle_trbs_and_ring(mhi_dev_ctxt,
+				      local_ev_ctxt,
+				      MHI_RING_TYPE_EVENT_RING,
+				      ev_index,
+				      nr_consumed);
+		spin_unlock_irqrestore(&local_ev_ctxt->ring_lock, flags);
+	}
 	read_lock_bh(&mhi_dev_ctxt->pm_xfer_lock);
 	mhi_dev_ctxt->deassert_wake(mhi_dev_ctxt);
 	read_unlock_bh(&mhi_dev_ctxt->pm_xfer_lock);
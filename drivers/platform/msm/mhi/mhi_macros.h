@@ -46,7 +46,11 @@
 
 #define MHI_M2_DEBOUNCE_TMR_US 10000
 
-#define MHI_EV_DB_INTERVAL 1
+/* Events processed before the event ring doorbell is rung */
+#define MHI_EV_DB_INTERVAL 16
+
+/* Upper bound on how long a transfer doorbell may be deferred */
+#define MHI_DB_BURST_MAX_TIMEOUT_US 1000
 
 #define MHI_DEV_WAKE_DB 127
 
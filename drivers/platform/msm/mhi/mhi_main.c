@@ -730,8 +730,21 @@ static inline int mhi_queue_tre(struct mhi_device_ctxt
 	if (likely(type == MHI_RING_TYPE_XFER_RING)) {
 		struct mhi_ring *mhi_ring =
 			&mhi_dev_ctxt->mhi_local_chan_ctxt[chan];
+		struct db_mode *db_mode = &mhi_ring->db_mode;
+
 		spin_lock_irqsave(&mhi_ring->ring_lock, flags);
-		mhi_update_chan_db(mhi_dev_ctxt, chan);
+		if (db_mode->burst_max > 1 &&
+		    ++db_mode->burst_pending < db_mode->burst_max) {
+			/* defer the doorbell, the timer bounds the latency */
+			if (!hrtimer_active(&db_mode->burst_timer))
+				hrtimer_start(&db_mode->burst_timer,
+				    ns_to_ktime(db_mode->burst_timeout_us *
+						NSEC_PER_USEC),
+				    HRTIMER_MODE_REL);
+		} else {
+			db_mode->burst_pending = 0;
+			mhi_update_chan_db(mhi_dev_ctxt, chan);
+		}
 		spin_unlock_irqrestore(&mhi_ring->ring_lock, flags);
 	} else {
 		struct mhi_ring *cmd_ring = &mhi_dev_ctxt->
@@ -1432,6 +1445,74 @@ int recycle_trb_and_ring(struct mhi_device_ctxt *mhi_dev_ctxt,
 
 }
 
+/**
+ * recycle_trbs_and_ring - Give nr_el elements already consumed with
+ * ctxt_del_element back to the device and ring the doorbell once.
+ */
+int recycle_trbs_and_ring(struct mhi_device_ctxt *mhi_dev_ctxt,
+		struct mhi_ring *ring,
+		enum MHI_RING_TYPE ring_type,
+		u32 ring_index,
+		u32 nr_el)
+{
+	int ret_val = 0;
+	u64 db_value = 0;
+	unsigned long flags;
+	struct mhi_ring *mhi_ring = &mhi_dev_ctxt->
+		mhi_local_event_ctxt[ring_index];
+
+	ret_val = ctxt_add_elements(ring, nr_el, NULL);
+	if (ret_val) {
+		mhi_log(mhi_dev_ctxt, MHI_MSG_ERROR,
+			"Could not add %u elements to ring\n", nr_el);
+		return ret_val;
+	}
+
+	if (!MHI_DB_ACCESS_VALID(mhi_dev_ctxt->mhi_pm_state))
+		return -EACCES;
+
+	read_lock_irqsave(&mhi_dev_ctxt->pm_xfer_lock, flags);
+	db_value = mhi_v2p_addr(mhi_dev_ctxt,
+				ring_type,
+				ring_index,
+				(uintptr_t) ring->wp);
+	mhi_ring->db_mode.process_db(mhi_dev_ctxt,
+				     mhi_dev_ctxt->mmio_info.event_db_addr,
+				     ring_index, db_value);
+	read_unlock_irqrestore(&mhi_dev_ctxt->pm_xfer_lock, flags);
+
+	return 0;
+}
+
+/**
+ * mhi_db_burst_timer - Ring a transfer doorbell deferred by burst mode
+ * once the batch did not fill up within burst_timeout_us.
+ */
+enum hrtimer_restart mhi_db_burst_timer(struct hrtimer *timer)
+{
+	struct mhi_ring *ring = container_of(timer, struct mhi_ring,
+					     db_mode.burst_timer);
+	struct mhi_device_ctxt *mhi_dev_ctxt = ring->mhi_dev_ctxt;
+	unsigned long flags;
+
+	read_lock_irqsave(&mhi_dev_ctxt->pm_xfer_lock, flags);
+	/* in M2/M3 the doorbells are rung again on the way back to M0 */
+	if (MHI_DB_ACCESS_VALID(mhi_dev_ctxt->mhi_pm_state)) {
+		mhi_dev_ctxt->assert_wake(mhi_dev_ctxt, false);
+		spin_lock(&ring->ring_lock);
+		if (ring->db_mode.burst_pending &&
+		    ring->ch_state == MHI_CHAN_STATE_ENABLED) {
+			ring->db_mode.burst_pending = 0;
+			mhi_update_chan_db(mhi_dev_ctxt, ring->index);
+		}
+		spin_unlock(&ring->ring_lock);
+		mhi_dev_ctxt->deassert_wake(mhi_dev_ctxt);
+	}
+	read_unlock_irqrestore(&mhi_dev_ctxt->pm_xfer_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 void mhi_reset_chan(struct mhi_device_ctxt *mhi_dev_ctxt, int chan)
 {
 	struct mhi_ring *local_chan_ctxt;
@@ -1447,6 +1528,8 @@ void mhi_reset_chan(struct mhi_device_ctxt *mhi_dev_ctxt, int chan)
 	chan_ctxt = &mhi_dev_ctxt->dev_space.ring_ctxt.cc_list[chan];
 	ev_ring = &mhi_dev_ctxt->
 		mhi_local_event_ctxt[chan_ctxt->mhi_event_ring_index];
+	hrtimer_cancel(&local_chan_ctxt->db_mode.burst_timer);
+	local_chan_ctxt->db_mode.burst_pending = 0;
 	ev_ctxt = &mhi_dev_ctxt->
 		dev_space.ring_ctxt.ec_list[chan_ctxt->mhi_event_ring_index];
 	mhi_log(mhi_dev_ctxt, MHI_MSG_INFO,
@@ -1743,6 +1826,48 @@ int mhi_set_lpm(struct mhi_client_handle *client_handle, bool enable_lpm)
 }
 EXPORT_SYMBOL(mhi_set_lpm);
 
+int mhi_set_db_burst(struct mhi_client_handle *client_handle,
+		     u32 max_pending, u32 timeout_us)
+{
+	struct mhi_client_config *client_config;
+	struct mhi_device_ctxt *mhi_dev_ctxt;
+	struct mhi_ring *ring;
+	unsigned long flags;
+	u32 chan, max_desc;
+
+	if (!client_handle)
+		return -EINVAL;
+	client_config = client_handle->client_config;
+	mhi_dev_ctxt = client_config->mhi_dev_ctxt;
+	chan = client_config->chan_info.chan_nr;
+	ring = &mhi_dev_ctxt->mhi_local_chan_ctxt[chan];
+
+	if (!IS_HARDWARE_CHANNEL(chan) ||
+	    ring->db_mode.brstmode == MHI_BRSTMODE_ENABLE)
+		return -EOPNOTSUPP;
+	max_desc = client_config->chan_info.max_desc;
+	if (max_pending > 1 &&
+	    (!timeout_us || timeout_us > MHI_DB_BURST_MAX_TIMEOUT_US ||
+	     max_pending >= max_desc))
+		return -EINVAL;
+
+	spin_lock_irqsave(&ring->ring_lock, flags);
+	ring->db_mode.burst_max = max_pending;
+	ring->db_mode.burst_timeout_us = timeout_us;
+	spin_unlock_irqrestore(&ring->ring_lock, flags);
+
+	/* flush whatever is still deferred when turning burst mode off */
+	if (max_pending <= 1 &&
+	    hrtimer_try_to_cancel(&ring->db_mode.burst_timer) > 0)
+		mhi_db_burst_timer(&ring->db_mode.burst_timer);
+
+	mhi_log(mhi_dev_ctxt, MHI_MSG_INFO,
+		"chan %u db burst %u timeout %u us\n",
+		chan, max_pending, timeout_us);
+	return 0;
+}
+EXPORT_SYMBOL(mhi_set_db_burst);
+
 int mhi_set_bus_request(struct mhi_device_ctxt *mhi_dev_ctxt,
 				int index)
 {
@@ -62,6 +62,89 @@ inline int ctxt_del_element(struct mhi_ring *ring,
 	return delete_element(ring, &ring->rp, &ring->wp, assigned_addr);
 }
 
+/**
+ * ctxt_add_elements - Moves the write pointer of the ring forward by
+ * nr_el elements in one step.
+ *
+ * @ring location of local ring data structure
+ * @nr_el number of elements to add
+ * @assigned_addr location of the first element added
+ *
+ * Unlike ctxt_add_element, never overwrites: fails with -ENOSPC unless
+ * all nr_el elements fit.
+ */
+int ctxt_add_elements(struct mhi_ring *ring, u32 nr_el,
+		      void **assigned_addr)
+{
+	uintptr_t d_wp = 0, ring_size = 0;
+	u32 nr_used = 0;
+	int r;
+
+	if (NULL == ring || 0 == ring->el_size
+		|| NULL == ring->base || 0 == ring->len)
+		return -EINVAL;
+
+	ring_size = ring->len / ring->el_size;
+	r = get_nr_enclosed_el(ring, ring->rp, ring->wp, &nr_used);
+	if (r)
+		return r;
+	if (nr_el > ring_size - nr_used - 1)
+		return -ENOSPC;
+	r = get_element_index(ring, ring->wp, &d_wp);
+	if (r)
+		return r;
+
+	if (NULL != assigned_addr)
+		*assigned_addr = ring->wp;
+	ring->wp = (void *)(((d_wp + nr_el) % ring_size) * ring->el_size +
+						(uintptr_t)ring->base);
+
+	/* force update visible to other cores */
+	smp_wmb();
+	return 0;
+}
+
+/**
+ * ctxt_del_elements - Moves the read pointer of the ring forward by
+ * nr_el elements in one step.
+ *
+ * @ring location of local ring data structure
+ * @nr_el number of elements to delete
+ * @assigned_addr location of the first element deleted
+ *
+ * Fails with -ENODATA unless the ring holds at least nr_el elements.
+ */
+int ctxt_del_elements(struct mhi_ring *ring, u32 nr_el,
+		      void **assigned_addr)
+{
+	uintptr_t d_rp = 0, ring_size = 0;
+	u32 nr_used = 0;
+	int r;
+
+	if (NULL == ring || 0 == ring->el_size ||
+		NULL == ring->base || 0 == ring->len)
+		return -EINVAL;
+
+	ring_size = ring->len / ring->el_size;
+	r = get_nr_enclosed_el(ring, ring->rp, ring->wp, &nr_used);
+	if (r)
+		return r;
+	if (nr_el > nr_used)
+		return -ENODATA;
+	r = get_element_index(ring, ring->rp, &d_rp);
+	if (r)
+		return r;
+
+	if (NULL != assigned_addr)
+		*assigned_addr = ring->rp;
+	ring->rp = (void *)(((d_rp + nr_el) % ring_size) * ring->el_size +
+						(uintptr_t)ring->base);
+
+	/* force update visible to other cores */
+	smp_wmb();
+	return 0;
+}
+
 /**
  * delete_element - Moves the read pointer of the transfer ring to
  * the next element of the transfer ring,
@@ -1684,6 +1684,83 @@ int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 }
 EXPORT_SYMBOL(sps_transfer_one);
 
+/**
+ * Perform a batch of DMA transfers on an SPS connection end point
+ *
+ */
+int sps_transfer_multi(struct sps_pipe *h, struct sps_iovec *iovec,
+		       void **user, u32 count)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+	int i;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec list is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (count == 0) {
+		SPS_ERR(sps, "sps:%s:iovec list is empty.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (iovec[i].size > SPS_IOVEC_MAX_SIZE) {
+			SPS_ERR(sps,
+				"sps:%s:iovec size is invalid.\n", __func__);
+			return SPS_ERROR;
+		}
+
+		if (sps_check_iovec_flags(iovec[i].flags))
+			return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	SPS_DBG(bam, "sps:%s.\n", __func__);
+
+	result = sps_bam_pipe_transfer_multi(bam, pipe->pipe_index, iovec,
+					     user, count);
+
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_transfer_multi);
+
+/**
+ * Configure interrupt coalescing on an SPS connection end point
+ *
+ */
+int sps_set_irq_coalescing(struct sps_pipe *h, u32 count, u32 timeout_us)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	result = sps_bam_pipe_set_coalescing(bam, pipe->pipe_index, count,
+					     timeout_us);
+
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_set_irq_coalescing);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -1101,6 +1101,8 @@ int sps_bam_pipe_disconnect(struct sps_bam *dev, u32 pipe_index)
 			spin_unlock_irqrestore(&dev->isr_lock, flags);
 		}
 		dev->pipe_remote_mask &= ~(1UL << pipe_index);
+		if (pipe->sys.coal_timer_init)
+			hrtimer_cancel(&pipe->sys.coal_timer);
 		if (pipe->connect.options & SPS_O_NO_DISABLE)
 			SPS_DBG2(dev, "sps:BAM %pa pipe %d exits.\n",
 				BAM_ID(dev), pipe_index);
@@ -1409,6 +1411,7 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 	struct sps_pipe *pipe = dev->pipes[pipe_index];
 	struct sps_iovec *desc;
 	struct sps_iovec iovec;
+	struct sps_iovec hw_desc;
 	u32 next_write;
 	static int show_recom;
 
@@ -1503,9 +1506,29 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 		pipe->sys.eot_flags++;
 #endif /* SPS_BAM_STATISTICS */
 
+	/*
+	 * With coalescing, only every coal_count-th descriptor asking for
+	 * an INT interrupt gets one from the hardware, and a timer picks
+	 * up the others. The cached copy keeps the flags the client asked
+	 * for, so consumer pipes still report each descriptor.
+	 */
+	hw_desc = *desc;
+	if (pipe->sys.coal_count > 1 && (hw_desc.flags & SPS_IOVEC_FLAG_INT)) {
+		if (++pipe->sys.coal_pending < pipe->sys.coal_count) {
+			hw_desc.flags &= ~SPS_IOVEC_FLAG_INT;
+			if (!hrtimer_is_queued(&pipe->sys.coal_timer))
+				hrtimer_start(&pipe->sys.coal_timer,
+					ns_to_ktime((u64)pipe->sys.coal_timeout_us
+						* NSEC_PER_USEC),
+					HRTIMER_MODE_REL);
+		} else {
+			pipe->sys.coal_pending = 0;
+		}
+	}
+
 	/* Update hardware descriptor FIFO - should result in burst */
 	*((struct sps_iovec *) (pipe->sys.desc_buf + pipe->sys.desc_offset))
-	= *desc;
+	= hw_desc;
 
 	/* Record user pointer value */
 	if (!pipe->sys.no_queue) {
@@ -1598,6 +1621,126 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Submit a batch of transfers to a BAM pipe
+ *
+ */
+int sps_bam_pipe_transfer_multi(struct sps_bam *dev, u32 pipe_index,
+				struct sps_iovec *iovec, void **user,
+				u32 count)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 free;
+	u32 n;
+	int result;
+
+	if (count == 0) {
+		SPS_ERR(dev, "sps:iovec count zero: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (!pipe->sys.ack_xfers && pipe->polled) {
+		sps_bam_pipe_get_unused_desc_num(dev, pipe_index, &free);
+		free = pipe->desc_size / sizeof(struct sps_iovec) - free - 1;
+	} else
+		sps_bam_get_free_count(dev, pipe_index, &free);
+
+	if (free < count) {
+		SPS_ERR(dev,
+			"sps:Insufficient free desc: BAM %pa pipe %d: %d\n",
+			BAM_ID(dev), pipe_index, free);
+		return SPS_ERROR;
+	}
+
+	for (n = 0; n < count; n++, iovec++) {
+		result = sps_bam_pipe_transfer_one(dev, pipe_index,
+				iovec->addr, iovec->size,
+				user ? user[n] : NULL,
+				iovec->flags | SPS_IOVEC_FLAG_NO_SUBMIT);
+		if (result)
+			break;
+	}
+
+	/* Notify pipe once for whatever made it into the FIFO */
+	if (n) {
+		wmb(); /* Memory Barrier */
+		bam_pipe_set_desc_write_offset(&dev->base, pipe_index,
+					       pipe->sys.desc_offset);
+	}
+
+	return n == count ? 0 : SPS_ERROR;
+}
+
+static enum hrtimer_restart pipe_coal_timer_fn(struct hrtimer *timer)
+{
+	struct sps_pipe *pipe = container_of(timer, struct sps_pipe,
+					     sys.coal_timer);
+	struct sps_bam *dev = pipe->bam;
+	unsigned long flags;
+	u32 retired;
+
+	spin_lock_irqsave(&dev->isr_lock, flags);
+	if (pipe->disconnecting) {
+		spin_unlock_irqrestore(&dev->isr_lock, flags);
+		return HRTIMER_NORESTART;
+	}
+
+	pipe_handler_eot(dev, pipe);
+	retired = pipe->sys.ack_xfers ? pipe->sys.cache_offset :
+		pipe->sys.acked_offset;
+	spin_unlock_irqrestore(&dev->isr_lock, flags);
+
+	/* keep polling until the hardware caught up with the submits */
+	if (retired == pipe->sys.desc_offset)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer, ns_to_ktime((u64)pipe->sys.coal_timeout_us *
+					       NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * Configure interrupt coalescing for a BAM pipe
+ *
+ */
+int sps_bam_pipe_set_coalescing(struct sps_bam *dev, u32 pipe_index,
+				u32 count, u32 timeout_us)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_REMOTE)) ||
+	    pipe->sys.no_queue) {
+		SPS_ERR(dev,
+			"sps:Coalescing needs a queued system pipe: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	/* without a timeout the last descriptors could wait forever */
+	if (count > 1 && timeout_us == 0) {
+		SPS_ERR(dev, "sps:Coalescing timeout zero: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (!pipe->sys.coal_timer_init) {
+		hrtimer_init(&pipe->sys.coal_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		pipe->sys.coal_timer.function = pipe_coal_timer_fn;
+		pipe->sys.coal_timer_init = true;
+	}
+
+	pipe->sys.coal_count = count;
+	pipe->sys.coal_timeout_us = timeout_us;
+	pipe->sys.coal_pending = 0;
+
+	SPS_DBG2(dev, "sps:BAM %pa pipe %d coalescing %d desc / %d us\n",
+		BAM_ID(dev), pipe_index, count, timeout_us);
+
+	return 0;
+}
+
 int sps_bam_pipe_inject_zlt(struct sps_bam *dev, u32 pipe_index)
 {
 	struct sps_pipe *pipe = dev->pipes[pipe_index];
@@ -20,6 +20,7 @@
 
 #include <linux/types.h>
 #include <linux/completion.h>
+#include <linux/hrtimer.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
@@ -146,6 +147,13 @@ struct sps_bam_sys_mode {
 	int ack_xfers;	/* Whether client must ACK all descriptors */
 	int handler_eot; /* Whether EOT handling is in progress (debug) */
 
+	/* Interrupt coalescing (see sps_bam_pipe_set_coalescing()) */
+	u32 coal_count;	/* INT flag kept on every coal_count-th descriptor */
+	u32 coal_timeout_us; /* Poll for completions this long after submit */
+	u32 coal_pending; /* Descriptors submitted since the last INT flag */
+	bool coal_timer_init;
+	struct hrtimer coal_timer;
+
 	/* Statistics */
 #ifdef SPS_BAM_STATISTICS
 	u32 desc_wr_count;
@@ -461,6 +469,50 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev, u32 pipe_index, u32 addr,
 int sps_bam_pipe_transfer(struct sps_bam *dev, u32 pipe_index,
 			 struct sps_transfer *transfer);
 
+/**
+ * Submit a batch of transfers to a BAM pipe
+ *
+ * This function writes all descriptors of the batch to the descriptor
+ * FIFO and updates the pipe write offset once.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of descriptors to submit
+ *
+ * @user - array of user pointers, one per descriptor, or NULL
+ *
+ * @count - number of descriptors
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_transfer_multi(struct sps_bam *dev, u32 pipe_index,
+				struct sps_iovec *iovec, void **user,
+				u32 count);
+
+/**
+ * Configure interrupt coalescing for a BAM pipe
+ *
+ * This function sets how many descriptors requesting an INT interrupt
+ * share one, and how long after a submit completions are polled for
+ * when the descriptor carrying the INT flag has not been submitted yet.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @count - descriptors per interrupt, 0 or 1 to disable coalescing
+ *
+ * @timeout_us - completion poll delay in microseconds
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_set_coalescing(struct sps_bam *dev, u32 pipe_index,
+				u32 count, u32 timeout_us);
+
 /**
  * Get a BAM pipe event
  *
@@ -28,6 +28,8 @@
 
 #define MAX_STR_LEN 256
 #define MAX_TIME_LEN 20
+/* Actual over target residency, in percent: <25, <50, <100, <200, <400, more */
+#define RATIO_BUCKET_COUNT 6
 const char *lpm_stats_reset = "reset";
 const char *lpm_stats_suspend = "suspend";
 
@@ -47,6 +49,12 @@ struct level_stats {
 	int failed_count;
 	int64_t total_time;
 	uint64_t enter_time;
+	/* residency telemetry, cpu levels only */
+	int premature_count;
+	int ratio_bucket[RATIO_BUCKET_COUNT];
+	int exit_lat_count;
+	int64_t exit_lat_total;
+	int64_t exit_lat_max;
 };
 
 static struct level_stats suspend_time_stats;
@@ -144,6 +152,28 @@ static void level_stats_print(struct seq_file *m, struct level_stats *stats)
 		stats->min_time[i],
 		stats->max_time[i]);
 	seq_puts(m, seqs);
+
+	if (!stats->owner->is_cpu)
+		return;
+
+	snprintf(seqs, MAX_STR_LEN,
+		"  premature wake count: %7d\n"
+		"  residency/target: <25%%: %d <50%%: %d <100%%: %d"
+		" <200%%: %d <400%%: %d >=400%%: %d\n",
+		stats->premature_count,
+		stats->ratio_bucket[0], stats->ratio_bucket[1],
+		stats->ratio_bucket[2], stats->ratio_bucket[3],
+		stats->ratio_bucket[4], stats->ratio_bucket[5]);
+	seq_puts(m, seqs);
+
+	if (stats->exit_lat_count) {
+		s = stats->exit_lat_total;
+		do_div(s, stats->exit_lat_count);
+		snprintf(seqs, MAX_STR_LEN,
+			"  exit latency (ns): count: %d avg: %lld max: %lld\n",
+			stats->exit_lat_count, s, stats->exit_lat_max);
+		seq_puts(m, seqs);
+	}
 }
 
 static int level_stats_file_show(struct seq_file *m, void *v)
@@ -191,6 +221,11 @@ static void level_stats_reset(struct level_stats *stats)
 	stats->success_count = 0;
 	stats->failed_count = 0;
 	stats->total_time = 0;
+	stats->premature_count = 0;
+	memset(stats->ratio_bucket, 0, sizeof(stats->ratio_bucket));
+	stats->exit_lat_count = 0;
+	stats->exit_lat_total = 0;
+	stats->exit_lat_max = 0;
 }
 
 static void level_stats_reset_all(struct lpm_stats *stats)
@@ -843,6 +878,53 @@ void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success)
 }
 EXPORT_SYMBOL(lpm_stats_cpu_exit);
 
+/**
+ * lpm_stats_cpu_residency() - API to record how the last cpu low power
+ * mode compared to its target.
+ *
+ * @index:	cpu's lpm level index.
+ * @target_us:	Minimum residency of the level, from DT.
+ * @exit_latency: Time from the expected timer expiry to the cpu running
+ *		again, in ns, or a negative value if the cpu was not woken
+ *		by its timer.
+ *
+ * Must be called after lpm_stats_cpu_exit() for a successful exit.
+ */
+void lpm_stats_cpu_residency(uint32_t index, uint32_t target_us,
+				int64_t exit_latency)
+{
+	struct lpm_stats *stats = &(*this_cpu_ptr(&(cpu_stats)));
+	struct level_stats *level;
+	uint64_t residency_us, ratio;
+	int i;
+
+	if (!stats->time_stats || index >= stats->num_levels)
+		return;
+
+	level = &stats->time_stats[index];
+	residency_us = stats->sleep_time;
+	do_div(residency_us, NSEC_PER_USEC);
+
+	if (target_us) {
+		if (residency_us < target_us)
+			level->premature_count++;
+		ratio = residency_us * 100;
+		do_div(ratio, target_us);
+		for (i = 0; i < RATIO_BUCKET_COUNT - 1; i++)
+			if (ratio < (25ULL << i))
+				break;
+		level->ratio_bucket[i]++;
+	}
+
+	if (exit_latency >= 0) {
+		level->exit_lat_count++;
+		level->exit_lat_total += exit_latency;
+		if (exit_latency > level->exit_lat_max)
+			level->exit_lat_max = exit_latency;
+	}
+}
+EXPORT_SYMBOL(lpm_stats_cpu_residency);
+
 /**
  * lpm_stats_suspend_enter() - API to communicate system entering suspend.
  *
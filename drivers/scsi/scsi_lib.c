@@ -2058,6 +2058,17 @@ static enum blk_eh_timer_return scsi_timeout(struct request *req,
 	return scsi_times_out(req);
 }
 
+static int scsi_mq_poll(struct blk_mq_hw_ctx *hctx, unsigned int tag)
+{
+	struct request_queue *q = hctx->queue;
+	struct scsi_device *sdev = q->queuedata;
+	struct Scsi_Host *shost = sdev->host;
+
+	if (!shost->hostt->mq_poll)
+		return -EOPNOTSUPP;
+	return shost->hostt->mq_poll(shost, tag);
+}
+
 static int scsi_init_request(void *data, struct request *rq,
 		unsigned int hctx_idx, unsigned int request_idx,
 		unsigned int numa_node)
@@ -2170,6 +2181,7 @@ static struct blk_mq_ops scsi_mq_ops = {
 	.queue_rq	= scsi_queue_rq,
 	.complete	= scsi_softirq_done,
 	.timeout	= scsi_timeout,
+	.poll		= scsi_mq_poll,
 	.init_request	= scsi_init_request,
 	.exit_request	= scsi_exit_request,
 };
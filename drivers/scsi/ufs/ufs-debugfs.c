@@ -21,6 +21,7 @@
 #include "ufs-debugfs.h"
 #include "unipro.h"
 #include "ufshci.h"
+#include "ufshpb.h"
 
 enum field_width {
 	BYTE	= 1,
@@ -1395,6 +1396,76 @@ static const struct file_operations ufsdbg_req_stats_desc = {
 	.write		= ufsdbg_req_stats_write,
 };
 
+static int ufsdbg_intr_aggr_stats_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_intr_aggr stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	stats = hba->intr_aggr;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	seq_printf(file, "allowed: %d\n", ufshcd_is_intr_aggr_allowed(hba));
+	seq_printf(file, "counter threshold: %u\n", stats.cnt);
+	seq_printf(file, "timeout: %u\n", stats.tmout);
+	seq_printf(file, "interrupts: %llu\n", stats.irqs);
+	seq_printf(file, "completions: %llu\n", stats.completions);
+	seq_printf(file, "completions per interrupt: %llu\n",
+		   stats.irqs ? div64_u64(stats.completions, stats.irqs) : 0);
+	seq_printf(file, "immediate (QD1): %llu\n", stats.immediate);
+	seq_printf(file, "reconfigurations: %llu\n", stats.reconfigs);
+	seq_printf(file, "polled completions: %llu\n", stats.polled);
+
+	return 0;
+}
+
+static int ufsdbg_intr_aggr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_intr_aggr_stats_show, inode->i_private);
+}
+
+static ssize_t ufsdbg_intr_aggr_stats_write(struct file *filp,
+				       const char __user *ubuf, size_t cnt,
+				       loff_t *ppos)
+{
+	struct ufs_hba *hba = filp->f_mapping->host->i_private;
+	unsigned long flags;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->intr_aggr.irqs = 0;
+	hba->intr_aggr.completions = 0;
+	hba->intr_aggr.immediate = 0;
+	hba->intr_aggr.reconfigs = 0;
+	hba->intr_aggr.polled = 0;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return cnt;
+}
+
+static const struct file_operations ufsdbg_intr_aggr_stats_fops = {
+	.open		= ufsdbg_intr_aggr_stats_open,
+	.read		= seq_read,
+	.write		= ufsdbg_intr_aggr_stats_write,
+};
+
+#ifdef CONFIG_SCSI_UFS_HPB
+static int ufsdbg_hpb_stats_show(struct seq_file *file, void *data)
+{
+	ufshpb_stats_show((struct ufs_hba *)file->private, file);
+	return 0;
+}
+
+static int ufsdbg_hpb_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_hpb_stats_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_hpb_stats_fops = {
+	.open		= ufsdbg_hpb_stats_open,
+	.read		= seq_read,
+};
+#endif
 
 static int ufsdbg_reset_controller_show(struct seq_file *file, void *data)
 {
@@ -1628,6 +1699,30 @@ void ufsdbg_add_debugfs(struct ufs_hba *hba)
 		goto err;
 	}
 
+	hba->debugfs_files.intr_aggr_stats =
+		debugfs_create_file("intr_aggr_stats", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.stats_folder, hba,
+			&ufsdbg_intr_aggr_stats_fops);
+	if (!hba->debugfs_files.intr_aggr_stats) {
+		dev_err(hba->dev,
+			"%s:  failed create intr_aggr_stats debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+#ifdef CONFIG_SCSI_UFS_HPB
+	hba->debugfs_files.hpb_stats =
+		debugfs_create_file("hpb_stats", S_IRUSR,
+			hba->debugfs_files.stats_folder, hba,
+			&ufsdbg_hpb_stats_fops);
+	if (!hba->debugfs_files.hpb_stats) {
+		dev_err(hba->dev,
+			"%s:  failed create hpb_stats debugfs entry\n",
+			__func__);
+		goto err;
+	}
+#endif
+
 	hba->debugfs_files.reset_controller =
 		debugfs_create_file("reset_controller", S_IRUSR | S_IWUSR,
 			hba->debugfs_files.debugfs_root, hba,
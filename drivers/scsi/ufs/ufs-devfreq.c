@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/devfreq.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include "governor.h"
+#include "ufs-devfreq.h"
+
+/*
+ * Busy time alone scales up too late for short bursts of app launch I/O
+ * and keeps the gear up for long running background writeback. Instead
+ * look at the queue depth and size of the requests issued in the window
+ * and at whether a boosted (top-app) task issued any of them:
+ *
+ * - boosted I/O scales up as soon as it queues up or keeps the link
+ *   busy for a small part of the window,
+ * - other I/O scales up when deep enough with small requests, or when
+ *   the link is nearly saturated,
+ * - scaling down needs the link to be mostly idle and shallow for a
+ *   number of consecutive windows, and never happens for boosted I/O.
+ */
+static unsigned int boosted_up_qd = 2;
+module_param(boosted_up_qd, uint, 0644);
+MODULE_PARM_DESC(boosted_up_qd, "Queue depth of boosted I/O to scale up");
+
+static unsigned int boosted_up_busy = 20;
+module_param(boosted_up_busy, uint, 0644);
+MODULE_PARM_DESC(boosted_up_busy, "Busy % of boosted I/O to scale up");
+
+static unsigned int up_qd = 6;
+module_param(up_qd, uint, 0644);
+MODULE_PARM_DESC(up_qd, "Queue depth of small requests to scale up");
+
+static unsigned int up_busy = 80;
+module_param(up_busy, uint, 0644);
+MODULE_PARM_DESC(up_busy, "Busy % to scale up");
+
+static unsigned int large_req_kb = 128;
+module_param(large_req_kb, uint, 0644);
+MODULE_PARM_DESC(large_req_kb,
+		 "Average request size above which queue depth is ignored");
+
+static unsigned int down_qd = 1;
+module_param(down_qd, uint, 0644);
+MODULE_PARM_DESC(down_qd, "Queue depth at or below which to scale down");
+
+static unsigned int down_busy = 30;
+module_param(down_busy, uint, 0644);
+MODULE_PARM_DESC(down_busy, "Busy % below which to scale down");
+
+static unsigned int up_windows = 1;
+module_param(up_windows, uint, 0644);
+MODULE_PARM_DESC(up_windows, "Consecutive windows needed to scale up");
+
+static unsigned int down_windows = 5;
+module_param(down_windows, uint, 0644);
+MODULE_PARM_DESC(down_windows, "Consecutive windows needed to scale down");
+
+/**
+ * ufs_devfreq_account - account one issued request
+ * @load: load of the current window
+ * @qd: number of outstanding requests, this one included
+ * @bytes: data length of the request
+ * @boosted: whether the issuing task is boosted
+ *
+ * Called with the host lock held. Returns true if the request warrants
+ * scaling up right away instead of waiting for the end of the window.
+ */
+bool ufs_devfreq_account(struct ufs_devfreq_load *load, unsigned int qd,
+			 unsigned int bytes, bool boosted)
+{
+	load->reqs++;
+	load->qd_sum += qd;
+	load->bytes += bytes;
+	if (!boosted)
+		return false;
+
+	load->boosted_reqs++;
+	return qd >= READ_ONCE(boosted_up_qd);
+}
+
+static int ufs_devfreq_gov_func(struct devfreq *df, unsigned long *freq,
+				u32 *flag)
+{
+	struct ufs_devfreq_gov_data *data = df->data;
+	struct devfreq_dev_status *stat;
+	struct ufs_devfreq_load *load;
+	unsigned long max = (df->max_freq) ? df->max_freq : UINT_MAX;
+	unsigned long min = (df->min_freq) ? df->min_freq : 0;
+	unsigned int busy = 0, avg_qd = 0, avg_kb = 0;
+	bool want_up, want_down;
+	int err;
+
+	err = devfreq_update_stats(df);
+	if (err)
+		return err;
+
+	stat = &df->last_status;
+	load = stat->private_data;
+	if (!data || !load) {
+		*freq = max;
+		return 0;
+	}
+
+	if (stat->total_time)
+		busy = div64_u64((u64)stat->busy_time * 100, stat->total_time);
+	if (load->reqs) {
+		avg_qd = DIV_ROUND_UP_ULL(load->qd_sum, load->reqs);
+		avg_kb = div_u64(load->bytes >> 10, load->reqs);
+	}
+
+	if (load->boosted_reqs) {
+		want_up = avg_qd >= boosted_up_qd || busy >= boosted_up_busy;
+		want_down = false;
+	} else {
+		want_up = busy >= up_busy ||
+			  (avg_qd >= up_qd && avg_kb < large_req_kb);
+		want_down = avg_qd <= down_qd && busy < down_busy;
+	}
+
+	*freq = df->previous_freq;
+	if (want_up) {
+		data->down_cnt = 0;
+		if (++data->up_cnt >= up_windows)
+			*freq = max;
+	} else if (want_down) {
+		data->up_cnt = 0;
+		if (++data->down_cnt >= down_windows)
+			*freq = min;
+	} else {
+		data->up_cnt = 0;
+		data->down_cnt = 0;
+	}
+
+	return 0;
+}
+
+static int ufs_devfreq_gov_handler(struct devfreq *devfreq,
+				   unsigned int event, void *data)
+{
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		devfreq_monitor_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		devfreq_monitor_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_INTERVAL:
+		devfreq_interval_update(devfreq, (unsigned int *)data);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		devfreq_monitor_suspend(devfreq);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+		devfreq_monitor_resume(devfreq);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static struct devfreq_governor ufs_devfreq_gov = {
+	.name = UFS_DEVFREQ_GOV_NAME,
+	.get_target_freq = ufs_devfreq_gov_func,
+	.event_handler = ufs_devfreq_gov_handler,
+};
+
+static int __init ufs_devfreq_gov_init(void)
+{
+	return devfreq_add_governor(&ufs_devfreq_gov);
+}
+subsys_initcall(ufs_devfreq_gov_init);
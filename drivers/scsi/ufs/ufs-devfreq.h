@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * UFS clock scaling devfreq governor - scale on queue depth, request
+ * size and on whether the issuing tasks are boosted, instead of on the
+ * busy time alone.
+ */
+
+#ifndef _UFS_DEVFREQ_H
+#define _UFS_DEVFREQ_H
+
+#include <linux/devfreq.h>
+#include <linux/types.h>
+
+#define UFS_DEVFREQ_GOV_NAME	"ufs_qd"
+
+/**
+ * struct ufs_devfreq_load - requests issued during one polling window
+ * @reqs: number of requests issued
+ * @boosted_reqs: requests issued by schedtune boosted tasks
+ * @qd_sum: sum of the queue depths seen by each request on issue
+ * @bytes: data transferred by the requests
+ *
+ * Handed to the governor as devfreq_dev_status::private_data.
+ */
+struct ufs_devfreq_load {
+	u32 reqs;
+	u32 boosted_reqs;
+	u64 qd_sum;
+	u64 bytes;
+};
+
+/**
+ * struct ufs_devfreq_gov_data - per device data of the ufs_qd governor
+ * @ondemand: simple_ondemand tunables, must stay first so the device can
+ * still be switched to simple_ondemand through the devfreq sysfs
+ * @up_cnt: consecutive windows asking to scale up
+ * @down_cnt: consecutive windows asking to scale down
+ */
+struct ufs_devfreq_gov_data {
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_SIMPLE_ONDEMAND)
+	struct devfreq_simple_ondemand_data ondemand;
+#endif
+	unsigned int up_cnt;
+	unsigned int down_cnt;
+};
+
+#ifdef CONFIG_SCSI_UFS_DEVFREQ_GOV
+bool ufs_devfreq_account(struct ufs_devfreq_load *load, unsigned int qd,
+			 unsigned int bytes, bool boosted);
+#else
+static inline bool ufs_devfreq_account(struct ufs_devfreq_load *load,
+				       unsigned int qd, unsigned int bytes,
+				       bool boosted)
+{
+	return false;
+}
+#endif
+
+#endif /* End of Header */
@@ -178,6 +178,20 @@ enum unit_desc_param {
 	UNIT_DESC_PARAM_PHY_MEM_RSRC_CNT	= 0x18,
 	UNIT_DESC_PARAM_CTX_CAPABILITIES	= 0x20,
 	UNIT_DESC_PARAM_LARGE_UNIT_SIZE_M1	= 0x22,
+	/* HPB extension, beyond the UFS 2.1 unit descriptor */
+	UNIT_DESC_PARAM_HPB_LU_MAX_ACTIVE_RGNS	= 0x23,
+	UNIT_DESC_PARAM_HPB_PIN_RGN_START_OFF	= 0x25,
+	UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS	= 0x27,
+	/* WriteBooster extension */
+	UNIT_DESC_PARAM_WB_BUF_ALLOC_UNITS	= 0x29,
+};
+
+/* Geometry descriptor parameters offsets in bytes, HPB extension */
+enum geometry_desc_param {
+	GEOMETRY_DESC_PARAM_HPB_REGION_SIZE	= 0x48,
+	GEOMETRY_DESC_PARAM_HPB_NUMBER_LU	= 0x49,
+	GEOMETRY_DESC_PARAM_HPB_SUBREGION_SIZE	= 0x4A,
+	GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_RGNS	= 0x4B,
 };
 
 /* Device descriptor parameters offsets in bytes*/
@@ -209,8 +223,31 @@ enum device_desc_param {
 	DEVICE_DESC_PARAM_UD_LEN		= 0x1B,
 	DEVICE_DESC_PARAM_RTT_CAP		= 0x1C,
 	DEVICE_DESC_PARAM_FRQ_RTC		= 0x1D,
+	DEVICE_DESC_PARAM_UFS_FEAT		= 0x1F,
+	/* HPB extension, beyond the UFS 2.1 device descriptor */
+	DEVICE_DESC_PARAM_HPB_VER		= 0x40,
+	/* WriteBooster extension */
+	DEVICE_DESC_PARAM_EXT_UFS_FEATURE_SUP	= 0x4F,
+	DEVICE_DESC_PARAM_WB_PRESRV_USRSPC_EN	= 0x53,
+	DEVICE_DESC_PARAM_WB_TYPE		= 0x54,
+	DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS	= 0x55,
+};
+
+/* bUFSFeaturesSupport bits */
+#define UFS_DEV_HPB_SUPPORT		0x80
+
+/* dExtendedUFSFeaturesSupport bits */
+#define UFS_DEV_WRITE_BOOSTER_SUP	0x100
+
+/* bWriteBoosterBufferType */
+enum {
+	WB_BUF_MODE_LU_DEDICATED	= 0x0,
+	WB_BUF_MODE_SHARED		= 0x1,
 };
 
+/* bAvailableWriteBoosterBufferSize is in 10% units */
+#define WB_BUF_AVAIL_UNIT_PERCENT	10
+
 /* Health descriptor parameters offsets in bytes*/
 enum health_desc_param {
 	HEALTH_DESC_PARAM_LEN			= 0x0,
@@ -307,6 +344,7 @@ enum {
 	MASK_QUERY_DATA_SEG_LEN         = 0xFFFF,
 	MASK_RSP_UPIU_DATA_SEG_LEN	= 0xFFFF,
 	MASK_RSP_EXCEPTION_EVENT        = 0x10000,
+	MASK_RSP_HPB_UPDATE_ALERT	= 0x20000,
 };
 
 /* Task management service response */
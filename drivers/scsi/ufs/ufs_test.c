@@ -17,6 +17,7 @@
 #include <linux/blkdev.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/test-iosched.h>
 #include <scsi/scsi.h>
@@ -98,9 +99,64 @@ enum ufs_test_testcases {
 	UFS_TEST_PARALLEL_READ_AND_WRITE,
 	UFS_TEST_LUN_DEPTH,
 
+	UFS_TEST_BENCH_RAND_READ_QD1,
+	UFS_TEST_BENCH_RAND_READ_QD32,
+	UFS_TEST_BENCH_SEQ_READ,
+	UFS_TEST_BENCH_SEQ_WRITE,
+	UFS_TEST_BENCH_FSYNC,
+	UFS_TEST_BENCH_DISCARD,
+
 	NUM_TESTS,
 };
 
+#define UFS_TEST_FIRST_BENCH	UFS_TEST_BENCH_RAND_READ_QD1
+#define NUM_BENCH_TESTS		(NUM_TESTS - UFS_TEST_FIRST_BENCH)
+
+/**
+ * struct ufs_test_bench_mix - I/O pattern of a benchmark testcase
+ * @name: name reported in bench_results
+ * @direction: READ or WRITE
+ * @nr_bios: request size in TEST_BIO_SIZE units
+ * @random: random LBAs instead of sequential ones
+ * @fsync: follow every write with a cache flush
+ * @discard: issue discards of @nr_bios instead of data requests
+ * @qd: default number of outstanding requests
+ * @num_reqs: default number of requests to issue
+ */
+struct ufs_test_bench_mix {
+	const char *name;
+	int direction;
+	unsigned int nr_bios;
+	bool random;
+	bool fsync;
+	bool discard;
+	unsigned int qd;
+	unsigned int num_reqs;
+};
+
+static const struct ufs_test_bench_mix bench_mixes[NUM_BENCH_TESTS] = {
+	{"rand_read_4k_qd1", READ, 1, true, false, false, 1, 4096},
+	{"rand_read_4k_qd32", READ, 1, true, false, false, 32, 16384},
+	{"seq_read_512k", READ, TEST_MAX_BIOS_PER_REQ, false, false, false,
+	 32, 1024},
+	{"seq_write_512k", WRITE, TEST_MAX_BIOS_PER_REQ, false, false, false,
+	 32, 1024},
+	{"fsync_4k", WRITE, 1, false, true, false, 1, 2048},
+	{"discard_64k", WRITE, 16, true, false, true, 32, 4096},
+};
+
+struct ufs_test_bench_result {
+	unsigned int qd;
+	u32 ios;
+	u32 errors;
+	u64 duration_us;
+	u64 bytes;
+	u64 p50_us;
+	u64 p99_us;
+	u64 p999_us;
+	u64 max_us;
+};
+
 enum ufs_test_stage {
 	DEFAULT,
 	UFS_TEST_ERROR,
@@ -150,6 +206,15 @@ struct ufs_test_data {
 	/* total number of requests to be submitted in long test */
 	u32 long_test_num_reqs;
 
+	/* benchmark knobs, 0 picks the testcase default */
+	u32 bench_num_reqs;
+	u32 bench_queue_depth;
+	/* latency histogram and results of the benchmark testcases */
+	u32 bench_hist[UFS_LAT_BUCKETS];
+	u64 bench_lat_max;
+	u32 bench_errors;
+	struct ufs_test_bench_result bench_results[NUM_BENCH_TESTS];
+
 	struct test_iosched *test_iosched;
 };
 
@@ -253,6 +318,18 @@ static char *ufs_test_get_test_case_str(int testcase)
 		return "UFS parallel read and write test";
 	case UFS_TEST_LUN_DEPTH:
 		return "UFS LUN depth test";
+	case UFS_TEST_BENCH_RAND_READ_QD1:
+		return "UFS benchmark 4KB random read QD1";
+	case UFS_TEST_BENCH_RAND_READ_QD32:
+		return "UFS benchmark 4KB random read QD32";
+	case UFS_TEST_BENCH_SEQ_READ:
+		return "UFS benchmark 512KB sequential read";
+	case UFS_TEST_BENCH_SEQ_WRITE:
+		return "UFS benchmark 512KB sequential write";
+	case UFS_TEST_BENCH_FSYNC:
+		return "UFS benchmark 4KB write and flush";
+	case UFS_TEST_BENCH_DISCARD:
+		return "UFS benchmark 64KB random discard";
 	}
 	return "Unknown test";
 }
@@ -440,6 +517,25 @@ static int ufs_test_show(struct seq_file *file, int test_case)
 		 "The test will test for each iteration once only reads and "
 		 "once only writes.\n";
 		break;
+	case UFS_TEST_BENCH_RAND_READ_QD1:
+	case UFS_TEST_BENCH_RAND_READ_QD32:
+	case UFS_TEST_BENCH_SEQ_READ:
+	case UFS_TEST_BENCH_SEQ_WRITE:
+	case UFS_TEST_BENCH_FSYNC:
+	case UFS_TEST_BENCH_DISCARD:
+		test_description = "\nufs_bench\n"
+		 "=========\n"
+		 "Description:\n"
+		 "Benchmark testcases issuing a fixed I/O mix while keeping "
+		 "a bounded number of requests outstanding: 4KB random reads "
+		 "at depth 1 and 32, 512KB sequential reads and writes, 4KB "
+		 "writes each followed by a cache flush, and 64KB random "
+		 "discards. The number of requests and the depth can be "
+		 "overridden through bench_num_reqs and bench_queue_depth.\n"
+		 "IOPS, bandwidth and latency percentiles of the last run of "
+		 "each testcase are reported in bench_results. Latencies are "
+		 "measured from dispatch to the driver to completion.\n";
+		break;
 	default:
 		test_description = "Unknown test";
 	}
@@ -1185,6 +1281,181 @@ static int long_seq_test_calc_throughput(struct test_iosched *test_iosched)
 	return ufs_test_post(test_iosched);
 }
 
+static void bench_end_io_fn(struct request *rq, int err)
+{
+	struct test_request *test_rq;
+	struct test_iosched *test_iosched = rq->q->elevator->elevator_data;
+	struct ufs_test_data *utd = test_iosched->blk_dev_test_data;
+	unsigned long flags;
+	u64 us;
+
+	test_rq = (struct test_request *)rq->elv.priv[0];
+	BUG_ON(!test_rq);
+
+	us = ktime_us_delta(ktime_get(), test_rq->dispatch_time);
+
+	spin_lock_irqsave(&test_iosched->lock, flags);
+	test_iosched->dispatched_count--;
+	list_del_init(&test_rq->queuelist);
+	__blk_put_request(test_iosched->req_q, test_rq->rq);
+	utd->bench_hist[ufshcd_lat_bucket(us)]++;
+	if (us > utd->bench_lat_max)
+		utd->bench_lat_max = us;
+	if (err)
+		utd->bench_errors++;
+	spin_unlock_irqrestore(&test_iosched->lock, flags);
+
+	if (err)
+		pr_err("%s: request %d completed, err=%d", __func__,
+			test_rq->req_id, err);
+
+	test_iosched_free_test_req_data_buffer(test_rq);
+	kfree(test_rq);
+	utd->completed_req_count++;
+	wake_up(&utd->wait_q);
+
+	check_test_completion(test_iosched);
+}
+
+/* Random block aligned start sector of a request of @nr_bios */
+static unsigned int bench_rnd_sector(struct ufs_test_data *utd,
+				     unsigned int nr_bios)
+{
+	u32 min_sec = utd->test_iosched->start_sector;
+	u32 max_sec = min_sec + utd->sector_range -
+		nr_bios * (TEST_BIO_SIZE / SECTOR_SIZE);
+	unsigned int sector;
+
+	do {
+		sector = ufs_test_pseudo_random_seed(&utd->random_test_seed,
+						     1, max_sec);
+		sector &= ~SECTOR_TO_BLOCK_MASK;
+	} while (sector < min_sec);
+
+	return sector;
+}
+
+/**
+ * run_bench_test - issue the I/O mix of a benchmark testcase
+ * @test_iosched: test specific data
+ *
+ * Unlike the long tests, which keep the queue full, only as many
+ * requests as the queue depth of the mix are kept outstanding, new ones
+ * being added as earlier ones complete.
+ */
+static int run_bench_test(struct test_iosched *test_iosched)
+{
+	struct ufs_test_data *utd = test_iosched->blk_dev_test_data;
+	const struct ufs_test_bench_mix *mix;
+	unsigned int qd, issued, sector, seq_sector_delta;
+	int ret = 0;
+
+	mix = &bench_mixes[test_iosched->test_info.testcase -
+			   UFS_TEST_FIRST_BENCH];
+	qd = utd->bench_queue_depth ? utd->bench_queue_depth : mix->qd;
+	qd = min_t(unsigned int, qd, QUEUE_MAX_REQUESTS);
+	utd->long_test_num_reqs = utd->bench_num_reqs ? utd->bench_num_reqs :
+		mix->num_reqs;
+	if (test_iosched->sector_range)
+		utd->sector_range = test_iosched->sector_range;
+	else
+		utd->sector_range = TEST_DEFAULT_SECTOR_RANGE;
+
+	test_iosched->test_count = 0;
+	utd->completed_req_count = 0;
+	utd->bench_lat_max = 0;
+	utd->bench_errors = 0;
+	memset(utd->bench_hist, 0, sizeof(utd->bench_hist));
+	utd->bench_results[mix - bench_mixes].qd = qd;
+
+	seq_sector_delta = mix->nr_bios * (TEST_BIO_SIZE / SECTOR_SIZE);
+	sector = test_iosched->start_sector;
+
+	pr_info("%s: %s: adding %d requests at depth %u", __func__, mix->name,
+		utd->long_test_num_reqs, qd);
+
+	for (issued = 0; issued < utd->long_test_num_reqs; issued++) {
+		/* a flush only covers the writes that already completed */
+		bool flush = mix->fsync && (issued & 1);
+		unsigned int depth = flush ? 1 : qd;
+
+		if (!wait_event_timeout(utd->wait_q,
+			    issued - READ_ONCE(utd->completed_req_count) < depth,
+			    THREADS_COMPLETION_TIMOUT)) {
+			pr_err("%s: timed out waiting for completions",
+				__func__);
+			return -ETIMEDOUT;
+		}
+
+		if (flush) {
+			ret = test_iosched_add_unique_test_req(test_iosched, 0,
+				REQ_UNIQUE_FLUSH, 0, 0, bench_end_io_fn);
+			goto issue;
+		}
+
+		if (mix->random) {
+			sector = bench_rnd_sector(utd, mix->nr_bios);
+		} else if (issued) {
+			sector += seq_sector_delta;
+			if (sector + seq_sector_delta >
+			    test_iosched->start_sector + utd->sector_range)
+				sector = test_iosched->start_sector;
+		}
+
+		if (mix->discard)
+			ret = test_iosched_add_unique_test_req(test_iosched, 0,
+				REQ_UNIQUE_DISCARD, sector, seq_sector_delta,
+				bench_end_io_fn);
+		else
+			ret = test_iosched_add_wr_rd_test_req(test_iosched, 0,
+				mix->direction, sector, mix->nr_bios,
+				TEST_PATTERN_5A, bench_end_io_fn);
+issue:
+		if (ret) {
+			pr_err("%s: failed to create request", __func__);
+			break;
+		}
+		blk_run_queue(test_iosched->req_q);
+	}
+
+	return ret;
+}
+
+static int bench_test_calc_results(struct test_iosched *test_iosched)
+{
+	struct ufs_test_data *utd = test_iosched->blk_dev_test_data;
+	int bench = utd->test_info.testcase - UFS_TEST_FIRST_BENCH;
+	struct ufs_test_bench_result *res = &utd->bench_results[bench];
+	u64 total = utd->completed_req_count;
+
+	res->ios = utd->completed_req_count;
+	res->errors = utd->bench_errors;
+	res->duration_us = ktime_to_us(utd->test_info.test_duration);
+	res->bytes = utd->test_info.test_byte_count;
+	res->max_us = utd->bench_lat_max;
+	if (total) {
+		res->p50_us = ufshcd_lat_percentile(utd->bench_hist, total,
+						    500);
+		res->p99_us = ufshcd_lat_percentile(utd->bench_hist, total,
+						    990);
+		res->p999_us = ufshcd_lat_percentile(utd->bench_hist, total,
+						     999);
+	}
+
+	pr_info("%s: %s: %u IOs in %llu us, p50 %llu us, p99 %llu us",
+		__func__, bench_mixes[bench].name, res->ios, res->duration_us,
+		res->p50_us, res->p99_us);
+
+	return ufs_test_post(test_iosched);
+}
+
+static bool bench_test_check_completion(struct test_iosched *test_iosched)
+{
+	struct ufs_test_data *utd = test_iosched->blk_dev_test_data;
+
+	return utd->completed_req_count >= utd->long_test_num_reqs;
+}
+
 static bool ufs_data_integrity_completion(struct test_iosched *test_iosched)
 {
 	struct ufs_test_data *utd = test_iosched->blk_dev_test_data;
@@ -1354,6 +1625,17 @@ static ssize_t ufs_test_write(struct file *file, const char __user *buf,
 	case UFS_TEST_LUN_DEPTH:
 		utd->test_info.run_test_fn = ufs_test_run_lun_depth_test;
 		break;
+	case UFS_TEST_BENCH_RAND_READ_QD1:
+	case UFS_TEST_BENCH_RAND_READ_QD32:
+	case UFS_TEST_BENCH_SEQ_READ:
+	case UFS_TEST_BENCH_SEQ_WRITE:
+	case UFS_TEST_BENCH_FSYNC:
+	case UFS_TEST_BENCH_DISCARD:
+		utd->test_info.run_test_fn = run_bench_test;
+		utd->test_info.post_test_fn = bench_test_calc_results;
+		utd->test_info.check_test_completion_fn =
+			bench_test_check_completion;
+		break;
 	default:
 		pr_err("%s: Unknown test-case: %d", __func__, test_case);
 		WARN_ON(true);
@@ -1391,6 +1673,56 @@ TEST_OPS(long_sequential_write, LONG_SEQUENTIAL_WRITE);
 TEST_OPS(long_sequential_mixed, LONG_SEQUENTIAL_MIXED);
 TEST_OPS(parallel_read_and_write, PARALLEL_READ_AND_WRITE);
 TEST_OPS(lun_depth, LUN_DEPTH);
+TEST_OPS(bench_rand_read_qd1, BENCH_RAND_READ_QD1);
+TEST_OPS(bench_rand_read_qd32, BENCH_RAND_READ_QD32);
+TEST_OPS(bench_seq_read, BENCH_SEQ_READ);
+TEST_OPS(bench_seq_write, BENCH_SEQ_WRITE);
+TEST_OPS(bench_fsync, BENCH_FSYNC);
+TEST_OPS(bench_discard, BENCH_DISCARD);
+
+/* Results of the last run of each benchmark testcase */
+static int ufs_test_bench_results_show(struct seq_file *file, void *data)
+{
+	struct ufs_test_data *utd = file->private;
+	struct ufs_test_bench_result *res;
+	u64 iops, kbps;
+	int i;
+
+	seq_printf(file, "%-18s %4s %8s %6s %8s %10s %8s %8s %8s %8s\n",
+		   "mix", "qd", "ios", "errors", "iops", "KiB/s", "p50",
+		   "p99", "p99.9", "max");
+	for (i = 0; i < NUM_BENCH_TESTS; i++) {
+		res = &utd->bench_results[i];
+		if (!res->ios || !res->duration_us)
+			continue;
+
+		iops = div64_u64((u64)res->ios * USEC_PER_SEC,
+				 res->duration_us);
+		kbps = div64_u64(res->bytes * USEC_PER_SEC,
+				 res->duration_us) >> 10;
+		seq_printf(file,
+			   "%-18s %4u %8u %6u %8llu %10llu %8llu %8llu %8llu %8llu\n",
+			   bench_mixes[i].name, res->qd, res->ios, res->errors,
+			   iops, kbps, res->p50_us, res->p99_us, res->p999_us,
+			   res->max_us);
+	}
+
+	return 0;
+}
+
+static int ufs_test_bench_results_open(struct inode *inode,
+				       struct file *file)
+{
+	return single_open(file, ufs_test_bench_results_show,
+			   inode->i_private);
+}
+
+static const struct file_operations ufs_test_bench_results_ops = {
+	.open = ufs_test_bench_results_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
 static void ufs_test_debugfs_cleanup(struct test_iosched *test_iosched)
 {
@@ -1461,6 +1793,36 @@ static int ufs_test_debugfs_init(struct ufs_test_data *utd)
 	add_test(utd, lun_depth, LUN_DEPTH);
 	if (ret)
 		goto exit_err;
+	ret = add_test(utd, bench_rand_read_qd1, BENCH_RAND_READ_QD1);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, bench_rand_read_qd32, BENCH_RAND_READ_QD32);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, bench_seq_read, BENCH_SEQ_READ);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, bench_seq_write, BENCH_SEQ_WRITE);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, bench_fsync, BENCH_FSYNC);
+	if (ret)
+		goto exit_err;
+	ret = add_test(utd, bench_discard, BENCH_DISCARD);
+	if (ret)
+		goto exit_err;
+
+	if (!debugfs_create_u32("bench_num_reqs", S_IRUGO | S_IWUSR,
+				utils_root, &utd->bench_num_reqs) ||
+	    !debugfs_create_u32("bench_queue_depth", S_IRUGO | S_IWUSR,
+				utils_root, &utd->bench_queue_depth) ||
+	    !debugfs_create_file("bench_results", S_IRUGO, utils_root, utd,
+				 &ufs_test_bench_results_ops)) {
+		pr_err("%s: Could not create debugfs benchmark files.",
+				__func__);
+		ret = -ENOMEM;
+		goto exit_err;
+	}
 
 	goto exit;
 
@@ -43,6 +43,8 @@
 #include <linux/nls.h>
 #include <linux/of.h>
 #include <linux/blkdev.h>
+#include <linux/fb.h>
+#include <linux/vmalloc.h>
 #include <asm/unaligned.h>
 
 #include "ufshcd.h"
@@ -50,10 +52,30 @@
 #include "ufs_quirks.h"
 #include "ufs-debugfs.h"
 #include "ufs-qcom.h"
+#include "ufshpb.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/ufs.h>
 
+/*
+ * Run the UFS host on scsi-mq regardless of scsi_mod.use_blk_mq. Requests
+ * then go through per-CPU software queues onto a single hardware queue,
+ * i.e. the UTRL doorbell, with the host-wide tag set sized to nutrs.
+ */
+static bool use_blk_mq;
+module_param(use_blk_mq, bool, 0444);
+MODULE_PARM_DESC(use_blk_mq, "use scsi-mq for the UFS host");
+
+/*
+ * Retune the transfer completion interrupt aggregation thresholds from the
+ * queue depth seen at issue time. Commands issued to an idle queue request
+ * an immediate interrupt so that QD1 latency is not paid in aggregation
+ * timeout.
+ */
+static bool intr_aggr_adaptive;
+module_param(intr_aggr_adaptive, bool, 0644);
+MODULE_PARM_DESC(intr_aggr_adaptive, "adapt interrupt aggregation to queue depth");
+
 #ifdef CONFIG_DEBUG_FS
 
 static int ufshcd_tag_req_type(struct request *rq)
@@ -394,9 +416,21 @@ static struct devfreq_simple_ondemand_data ufshcd_ondemand_data = {
 	.simple_scaling = 1,
 };
 
-static void *gov_data = &ufshcd_ondemand_data;
+#endif
+
+/*
+ * The ufs_qd governor data starts with the simple_ondemand tunables, so
+ * either governor can be selected at run time through the devfreq sysfs.
+ */
+#ifdef CONFIG_SCSI_UFS_DEVFREQ_GOV
+#define UFSHCD_DEVFREQ_GOV	UFS_DEVFREQ_GOV_NAME
+#define ufshcd_devfreq_gov_data(hba)	(&(hba)->clk_scaling.gov_data)
+#elif IS_ENABLED(CONFIG_DEVFREQ_GOV_SIMPLE_ONDEMAND)
+#define UFSHCD_DEVFREQ_GOV	"simple_ondemand"
+#define ufshcd_devfreq_gov_data(hba)	(&ufshcd_ondemand_data)
 #else
-static void *gov_data;
+#define UFSHCD_DEVFREQ_GOV	"simple_ondemand"
+#define ufshcd_devfreq_gov_data(hba)	(NULL)
 #endif
 
 static struct devfreq_dev_profile ufs_devfreq_profile = {
@@ -1215,6 +1249,36 @@ ufshcd_config_intr_aggr(struct ufs_hba *hba, u8 cnt, u8 tmout)
 		      REG_UTP_TRANSFER_REQ_INT_AGG_CONTROL);
 }
 
+/**
+ * ufshcd_adapt_intr_aggr - Retune interrupt aggregation for the queue depth
+ * @hba: per adapter instance
+ * @qd: number of requests outstanding including the one being issued
+ *
+ * Aggregate roughly half the queue before raising an interrupt and shorten
+ * the timeout for shallow queues, where waiting for more completions costs
+ * more latency than the interrupt it saves. UTRIACR is only written when
+ * the thresholds change. Must be called with host_lock held.
+ */
+static void ufshcd_adapt_intr_aggr(struct ufs_hba *hba, int qd)
+{
+	u8 cnt = hba->nutrs - 1;
+	u8 tmout = INT_AGGR_DEF_TO;
+
+	if (READ_ONCE(intr_aggr_adaptive)) {
+		cnt = clamp(qd / 2, 1, hba->nutrs - 1);
+		if (qd <= 4)
+			tmout = 1;
+	}
+
+	if (cnt == hba->intr_aggr.cnt && tmout == hba->intr_aggr.tmout)
+		return;
+
+	ufshcd_config_intr_aggr(hba, cnt, tmout);
+	hba->intr_aggr.cnt = cnt;
+	hba->intr_aggr.tmout = tmout;
+	hba->intr_aggr.reconfigs++;
+}
+
 /**
  * ufshcd_disable_intr_aggr - Disables interrupt aggregation.
  * @hba: per adapter instance
@@ -2319,6 +2383,31 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 	}
 }
 
+/* Must be called with host lock acquired, after setting the doorbell bit */
+static void ufshcd_clk_scaling_account(struct ufs_hba *hba,
+				       struct ufshcd_lrb *lrbp)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	unsigned int bytes = lrbp->cmd ? scsi_bufflen(lrbp->cmd) : 0;
+	bool boosted;
+
+	if (!IS_ENABLED(CONFIG_SCSI_UFS_DEVFREQ_GOV) ||
+	    !ufshcd_is_clkscaling_supported(hba))
+		return;
+
+	/*
+	 * Requests are issued from the context of the submitting task for
+	 * synchronous I/O, which is what matters for launch latency.
+	 */
+	boosted = lrbp->cmd && schedtune_task_boosted(current);
+	if (ufs_devfreq_account(&scaling->load,
+				hweight_long(hba->outstanding_reqs),
+				bytes, boosted) &&
+	    !scaling->is_scaled_up && scaling->is_allowed &&
+	    !scaling->is_suspended && !hba->pm_op_in_progress)
+		queue_work(scaling->workq, &scaling->boost_work);
+}
+
 static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 {
 	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
@@ -2348,6 +2437,7 @@ int ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag)
 	hba->lrb[task_tag].complete_time_stamp = ktime_set(0, 0);
 	ufshcd_clk_scaling_start_busy(hba);
 	__set_bit(task_tag, &hba->outstanding_reqs);
+	ufshcd_clk_scaling_account(hba, &hba->lrb[task_tag]);
 	ufshcd_writel(hba, 1 << task_tag, REG_UTP_TRANSFER_REQ_DOOR_BELL);
 	/* Make sure that doorbell is committed immediately */
 	wmb();
@@ -2962,6 +3052,90 @@ static inline void ufshcd_put_read_lock(struct ufs_hba *hba)
 	up_read(&hba->lock);
 }
 
+/*
+ * Link and clock state seen by a request on arrival, before it holds the
+ * clocks and brings the link out of hibern8.
+ */
+static u8 ufshcd_lat_pm_state(struct ufs_hba *hba)
+{
+	if (ufshcd_is_clkgating_allowed(hba) &&
+	    (hba->clk_gating.state == CLKS_OFF ||
+	     hba->clk_gating.state == REQ_CLKS_ON))
+		return UFS_LAT_CLK_GATED;
+
+	if (ufshcd_is_link_hibern8(hba) ||
+	    (ufshcd_is_hibern8_on_idle_allowed(hba) &&
+	     (hba->hibern8_on_idle.state == HIBERN8_ENTERED ||
+	      hba->hibern8_on_idle.state == REQ_HIBERN8_EXIT)))
+		return UFS_LAT_HIBERN8;
+
+	return UFS_LAT_ACTIVE;
+}
+
+static int ufshcd_lat_op(u8 opcode)
+{
+	switch (opcode) {
+	case READ_6:
+	case READ_10:
+	case READ_16:
+	case UFSHPB_READ:
+		return UFS_LAT_READ;
+	case WRITE_6:
+	case WRITE_10:
+	case WRITE_16:
+		return UFS_LAT_WRITE;
+	case UNMAP:
+		return UFS_LAT_UNMAP;
+	case SYNCHRONIZE_CACHE:
+		return UFS_LAT_SYNC;
+	default:
+		return -EINVAL;
+	}
+}
+
+int ufshcd_lat_bucket(u64 us)
+{
+	int msb;
+
+	if (us < (1 << UFS_LAT_SUB_BITS))
+		return us;
+
+	msb = fls64(us) - 1;
+	if (msb >= UFS_LAT_MAX_SHIFT)
+		return UFS_LAT_BUCKETS - 1;
+
+	return (msb << UFS_LAT_SUB_BITS) |
+		((us >> (msb - UFS_LAT_SUB_BITS)) &
+		 ((1 << UFS_LAT_SUB_BITS) - 1));
+}
+EXPORT_SYMBOL(ufshcd_lat_bucket);
+
+/* Largest latency, in us, that falls into @bucket */
+static u64 ufshcd_lat_bucket_max(int bucket)
+{
+	int msb = bucket >> UFS_LAT_SUB_BITS;
+	int sub = bucket & ((1 << UFS_LAT_SUB_BITS) - 1);
+
+	if (bucket < (1 << UFS_LAT_SUB_BITS))
+		return bucket;
+
+	return ((1ULL << msb) | ((u64)(sub + 1) << (msb - UFS_LAT_SUB_BITS)))
+		- 1;
+}
+
+/* Called with host_lock held */
+static void ufshcd_update_lat_pct(struct ufs_hba *hba,
+				  struct ufshcd_lrb *lrbp, u64 delta_us)
+{
+	int op = ufshcd_lat_op(lrbp->cmd->cmnd[0]);
+
+	if (!hba->lat_pct || op < 0 || lrbp->lun >= UFS_UPIU_MAX_GENERAL_LUN)
+		return;
+
+	hba->lat_pct->hist[lrbp->lun][op][lrbp->lat_pm_state]
+		[ufshcd_lat_bucket(delta_us)]++;
+}
+
 /**
  * ufshcd_queuecommand - main entry point for SCSI requests
  * @cmd: command from SCSI Midlayer
@@ -2977,6 +3151,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	int tag;
 	int err = 0;
 	bool has_read_lock = false;
+	u8 lat_pm_state;
 
 	hba = shost_priv(host);
 
@@ -3045,6 +3220,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		goto out;
 	}
 
+	lat_pm_state = ufshcd_lat_pm_state(hba);
 	hba->ufs_stats.clk_hold.ctx = QUEUE_CMD;
 	err = ufshcd_hold(hba, true);
 	if (err) {
@@ -3089,8 +3265,14 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->task_tag = tag;
 	lrbp->lun = ufshcd_scsi_to_upiu_lun(cmd->device->lun);
 	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ? true : false;
+	if (!lrbp->intr_cmd && READ_ONCE(intr_aggr_adaptive) &&
+	    !READ_ONCE(hba->outstanding_reqs))
+		lrbp->intr_cmd = true;
 	lrbp->command_type = UTP_CMD_TYPE_SCSI;
 	lrbp->req_abort_skip = false;
+	lrbp->lat_pm_state = lat_pm_state;
+
+	ufshpb_prep(hba, lrbp);
 
 	/* form UPIU before issuing the command */
 	err = ufshcd_compose_upiu(hba, lrbp);
@@ -3138,6 +3320,14 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	/* issue command to the controller */
 	spin_lock_irqsave(hba->host->host_lock, flags);
 
+	if (ufshcd_is_intr_aggr_allowed(hba)) {
+		if (lrbp->intr_cmd)
+			hba->intr_aggr.immediate++;
+		else
+			ufshcd_adapt_intr_aggr(hba,
+				hweight_long(hba->outstanding_reqs) + 1);
+	}
+
 	err = ufshcd_send_command(hba, tag);
 	if (err) {
 		spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -3450,20 +3640,21 @@ static int ufshcd_query_flag_retry(struct ufs_hba *hba,
 }
 
 /**
- * ufshcd_query_flag() - API function for sending flag query requests
+ * ufshcd_query_flag_index() - API function for sending flag query requests
  * hba: per-adapter instance
  * query_opcode: flag query to perform
  * idn: flag idn to access
+ * index: index field
  * flag_res: the flag value after the query request completes
  *
  * Returns 0 for success, non-zero in case of failure
  */
-int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
-			enum flag_idn idn, bool *flag_res)
+int ufshcd_query_flag_index(struct ufs_hba *hba, enum query_opcode opcode,
+			enum flag_idn idn, u8 index, bool *flag_res)
 {
 	struct ufs_query_req *request = NULL;
 	struct ufs_query_res *response = NULL;
-	int err, index = 0, selector = 0;
+	int err, selector = 0;
 	int timeout = QUERY_REQ_TIMEOUT;
 
 	BUG_ON(!hba);
@@ -3515,6 +3706,22 @@ out_unlock:
 	ufshcd_release_all(hba);
 	return err;
 }
+EXPORT_SYMBOL(ufshcd_query_flag_index);
+
+/**
+ * ufshcd_query_flag() - API function for sending flag query requests
+ * hba: per-adapter instance
+ * query_opcode: flag query to perform
+ * idn: flag idn to access
+ * flag_res: the flag value after the query request completes
+ *
+ * Returns 0 for success, non-zero in case of failure
+ */
+int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
+			enum flag_idn idn, bool *flag_res)
+{
+	return ufshcd_query_flag_index(hba, opcode, idn, 0, flag_res);
+}
 EXPORT_SYMBOL(ufshcd_query_flag);
 
 /**
@@ -3717,6 +3924,36 @@ int ufshcd_query_descriptor(struct ufs_hba *hba,
 }
 EXPORT_SYMBOL(ufshcd_query_descriptor);
 
+/**
+ * ufshcd_read_desc_ext - read a descriptor including its extensions
+ * @hba: Pointer to adapter instance
+ * @idn: descriptor idn value
+ * @index: descriptor index
+ * @buf: buffer of QUERY_DESC_MAX_SIZE bytes
+ * @len: on return, the length of the descriptor read
+ *
+ * Unlike ufshcd_read_desc_param() the length is not checked against the
+ * UFS 2.1 descriptor sizes, so that fields added by later revisions and
+ * extensions such as HPB and WriteBooster can be read when present.
+ *
+ * Return 0 in case of success, non-zero otherwise
+ */
+int ufshcd_read_desc_ext(struct ufs_hba *hba, enum desc_idn idn, int index,
+			 u8 *buf, int *len)
+{
+	int err;
+
+	*len = QUERY_DESC_MAX_SIZE;
+	err = ufshcd_query_descriptor(hba, UPIU_QUERY_OPCODE_READ_DESC,
+				      idn, index, 0, buf, len);
+	if (!err && buf[QUERY_DESC_DESC_TYPE_OFFSET] != idn)
+		err = -EINVAL;
+	if (!err)
+		*len = min_t(int, *len, buf[QUERY_DESC_LENGTH_OFFSET]);
+
+	return err;
+}
+
 /**
  * ufshcd_read_desc_param - read the specified descriptor parameter
  * @hba: Pointer to adapter instance
@@ -4832,9 +5069,11 @@ static int ufshcd_make_hba_operational(struct ufs_hba *hba)
 	ufshcd_enable_intr(hba, UFSHCD_ENABLE_INTRS);
 
 	/* Configure interrupt aggregation */
-	if (ufshcd_is_intr_aggr_allowed(hba))
+	if (ufshcd_is_intr_aggr_allowed(hba)) {
 		ufshcd_config_intr_aggr(hba, hba->nutrs - 1, INT_AGGR_DEF_TO);
-	else
+		hba->intr_aggr.cnt = hba->nutrs - 1;
+		hba->intr_aggr.tmout = INT_AGGR_DEF_TO;
+	} else
 		ufshcd_disable_intr_aggr(hba);
 
 	/* Configure UTRL and UTMRL base address registers */
@@ -5268,6 +5507,27 @@ static int ufshcd_slave_configure(struct scsi_device *sdev)
 	sdev->autosuspend_delay = UFSHCD_AUTO_SUSPEND_DELAY_MS;
 	sdev->use_rpm_auto = 1;
 
+	/*
+	 * The block layer does no runtime PM accounting for blk-mq queues
+	 * yet, so nothing would keep the LU resumed while it has requests
+	 * in flight. Keep it active: clock gating and hibern8 still save
+	 * power while idle, only the runtime link-off state is given up.
+	 */
+	if (shost_use_blk_mq(sdev->host))
+		pm_runtime_get_noresume(&sdev->sdev_gendev);
+
+	/*
+	 * Let blk_poll() pick up completions of the sync reads top-app tasks
+	 * wait on, sleeping through half of their usual completion time
+	 * before it starts spinning on the doorbell.
+	 */
+	if (q->mq_ops) {
+		queue_flag_set_unlocked(QUEUE_FLAG_POLL, q);
+		q->poll_nsec = 0;
+	}
+
+	ufshpb_init_lu(shost_priv(sdev->host), sdev);
+
 	return 0;
 }
 
@@ -5280,6 +5540,9 @@ static void ufshcd_slave_destroy(struct scsi_device *sdev)
 	struct ufs_hba *hba;
 
 	hba = shost_priv(sdev->host);
+	ufshpb_destroy_lu(hba, sdev);
+	if (shost_use_blk_mq(sdev->host))
+		pm_runtime_put_noidle(&sdev->sdev_gendev);
 	/* Drop the reference as it won't be needed anymore */
 	if (ufshcd_scsi_to_upiu_lun(sdev->lun) == UFS_UPIU_UFS_DEVICE_WLUN) {
 		unsigned long flags;
@@ -5401,6 +5664,8 @@ ufshcd_transfer_rsp_status(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
 			scsi_status = result & MASK_SCSI_STATUS;
 			result = ufshcd_scsi_cmd_status(lrbp, scsi_status);
 
+			ufshpb_rsp_upiu(hba, lrbp);
+
 			/*
 			 * Currently we are only supporting BKOPs exception
 			 * events hence we can ignore BKOPs exception event
@@ -5644,6 +5909,8 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 						(rq_data_dir(req) == READ) ?
 						&hba->io_lat_read :
 						&hba->io_lat_write, delta_us);
+					ufshcd_update_lat_pct(hba, lrbp,
+							      delta_us);
 				}
 			}
 			/* Do not touch lrbp after scsi done */
@@ -5695,6 +5962,8 @@ static irqreturn_t ufshcd_transfer_req_compl(struct ufs_hba *hba)
 	completed_reqs = tr_doorbell ^ hba->outstanding_reqs;
 
 	if (completed_reqs) {
+		hba->intr_aggr.irqs++;
+		hba->intr_aggr.completions += hweight_long(completed_reqs);
 		__ufshcd_transfer_req_compl(hba, completed_reqs);
 		return IRQ_HANDLED;
 	} else {
@@ -5702,6 +5971,49 @@ static irqreturn_t ufshcd_transfer_req_compl(struct ufs_hba *hba)
 	}
 }
 
+/**
+ * ufshcd_mq_poll - look for the completion of a transfer request
+ * @host: SCSI host
+ * @tag: block layer tag of the request, also its UTRL slot
+ *
+ * Completes whatever the doorbell shows done, like the interrupt handler
+ * would. The completion interrupt status is cleared before reading the
+ * doorbell so that requests completing after the read still raise one.
+ *
+ * Returns 1 once the request is done, 0 while it is outstanding.
+ */
+static int ufshcd_mq_poll(struct Scsi_Host *host, unsigned int tag)
+{
+	struct ufs_hba *hba = shost_priv(host);
+	unsigned long completed_reqs;
+	unsigned long flags;
+	u32 tr_doorbell;
+	int ret = 1;
+
+	if (tag >= hba->nutrs)
+		return -EINVAL;
+
+	spin_lock_irqsave(host->host_lock, flags);
+	if (!test_bit(tag, &hba->outstanding_reqs))
+		goto out;
+
+	ufshcd_writel(hba, UTP_TRANSFER_REQ_COMPL, REG_INTERRUPT_STATUS);
+	if (ufshcd_is_intr_aggr_allowed(hba))
+		ufshcd_reset_intr_aggr(hba);
+
+	tr_doorbell = ufshcd_readl(hba, REG_UTP_TRANSFER_REQ_DOOR_BELL);
+	completed_reqs = tr_doorbell ^ hba->outstanding_reqs;
+	if (completed_reqs) {
+		hba->intr_aggr.polled += hweight_long(completed_reqs);
+		hba->intr_aggr.poll_raced = true;
+		__ufshcd_transfer_req_compl(hba, completed_reqs);
+	}
+	ret = test_bit(tag, &completed_reqs) ? 1 : 0;
+out:
+	spin_unlock_irqrestore(host->host_lock, flags);
+	return ret;
+}
+
 /**
  * ufshcd_disable_ee - disable exception event
  * @hba: per-adapter instance
@@ -5863,6 +6175,210 @@ static void ufshcd_force_reset_auto_bkops(struct ufs_hba *hba)
 	}
 }
 
+static int ufshcd_wb_set_flag(struct ufs_hba *hba, enum flag_idn idn,
+			      bool set)
+{
+	enum query_opcode opcode = set ? UPIU_QUERY_OPCODE_SET_FLAG :
+					 UPIU_QUERY_OPCODE_CLEAR_FLAG;
+	int err, retries;
+
+	for (retries = 0; retries < QUERY_REQ_RETRIES; retries++) {
+		err = ufshcd_query_flag_index(hba, opcode, idn, hba->wb.index,
+					      NULL);
+		if (!err)
+			break;
+	}
+	if (err)
+		dev_err(hba->dev, "%s: %s flag idn %d failed %d\n", __func__,
+			set ? "set" : "clear", idn, err);
+	return err;
+}
+
+/**
+ * ufshcd_wb_ctrl - enable or disable the WriteBooster buffer
+ * @hba: per-adapter instance
+ * @enable: new state
+ *
+ * Returns zero on success, non-zero on failure.
+ */
+static int ufshcd_wb_ctrl(struct ufs_hba *hba, bool enable)
+{
+	int err;
+
+	if (!hba->wb.supported || hba->wb.enabled == enable)
+		return 0;
+
+	err = ufshcd_wb_set_flag(hba, QUERY_FLAG_IDN_WB_EN, enable);
+	if (!err)
+		hba->wb.enabled = enable;
+	return err;
+}
+
+static int ufshcd_wb_flush_during_h8_ctrl(struct ufs_hba *hba, bool enable)
+{
+	int err;
+
+	if (!hba->wb.supported)
+		return 0;
+
+	err = ufshcd_wb_set_flag(hba,
+			QUERY_FLAG_IDN_WB_BUFF_FLUSH_DURING_HIBERN8, enable);
+	if (!err)
+		hba->wb.flush_during_h8 = enable;
+	return err;
+}
+
+static inline int ufshcd_wb_read_attr(struct ufs_hba *hba, enum attr_idn idn,
+				      u32 *val)
+{
+	return ufshcd_query_attr_retry(hba, UPIU_QUERY_OPCODE_READ_ATTR, idn,
+				       hba->wb.index, 0, val);
+}
+
+/**
+ * ufshcd_wb_need_flush - check whether the WriteBooster buffer needs flushing
+ * @hba: per-adapter instance
+ *
+ * The device only flushes the buffer in hibern8 while it stays powered,
+ * so runtime suspend uses this to keep it in active power mode when the
+ * available buffer has run low.
+ */
+static bool ufshcd_wb_need_flush(struct ufs_hba *hba)
+{
+	u32 avail;
+
+	if (!hba->wb.supported || !hba->wb.flush_during_h8)
+		return false;
+
+	if (ufshcd_wb_read_attr(hba, QUERY_ATTR_IDN_AVAIL_WB_BUFF_SIZE, &avail))
+		return false;
+
+	return avail <= hba->wb.flush_thresh;
+}
+
+/**
+ * ufshcd_wb_config - restore the WriteBooster flags
+ * @hba: per-adapter instance
+ *
+ * The flags go back to their defaults across a device reset or power
+ * cycle. Called on every probe, after the device is initialized.
+ */
+static void ufshcd_wb_config(struct ufs_hba *hba)
+{
+	if (!hba->wb.supported)
+		return;
+
+	hba->wb.enabled = !hba->wb.want_on;
+	ufshcd_wb_ctrl(hba, hba->wb.want_on);
+	ufshcd_wb_flush_during_h8_ctrl(hba, hba->wb.flush_during_h8);
+}
+
+static void ufshcd_wb_toggle_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   wb.toggle_work);
+
+	pm_runtime_get_sync(hba->dev);
+	ufshcd_wb_ctrl(hba, READ_ONCE(hba->wb.want_on));
+	pm_runtime_put_sync(hba->dev);
+}
+
+#ifdef CONFIG_FB
+static int ufshcd_wb_fb_notifier_cb(struct notifier_block *nb,
+				    unsigned long action, void *data)
+{
+	struct ufs_hba *hba = container_of(nb, struct ufs_hba, wb.fb_notif);
+	int *blank = ((struct fb_event *)data)->data;
+
+	if (action != FB_EARLY_EVENT_BLANK)
+		return NOTIFY_OK;
+
+	/*
+	 * Burst writes happen while the screen is on. With the screen off
+	 * the writes go to normal storage and the buffer gets flushed.
+	 */
+	WRITE_ONCE(hba->wb.want_on, *blank == FB_BLANK_UNBLANK);
+	schedule_work(&hba->wb.toggle_work);
+
+	return NOTIFY_OK;
+}
+
+static void ufshcd_wb_register_fb_notifier(struct ufs_hba *hba)
+{
+	hba->wb.fb_notif.notifier_call = ufshcd_wb_fb_notifier_cb;
+	if (fb_register_client(&hba->wb.fb_notif))
+		dev_err(hba->dev, "%s: failed to register fb notifier\n",
+			__func__);
+}
+
+static void ufshcd_wb_unregister_fb_notifier(struct ufs_hba *hba)
+{
+	if (hba->wb.fb_notif.notifier_call)
+		fb_unregister_client(&hba->wb.fb_notif);
+}
+#else
+static inline void ufshcd_wb_register_fb_notifier(struct ufs_hba *hba)
+{
+}
+
+static inline void ufshcd_wb_unregister_fb_notifier(struct ufs_hba *hba)
+{
+}
+#endif
+
+/**
+ * ufshcd_wb_probe - detect the WriteBooster buffer of the device
+ * @hba: per-adapter instance
+ */
+static void ufshcd_wb_probe(struct ufs_hba *hba)
+{
+	bool shared;
+	u8 *desc;
+	int len, lun;
+
+	desc = kzalloc(QUERY_DESC_MAX_SIZE, GFP_KERNEL);
+	if (!desc)
+		return;
+
+	if (ufshcd_read_desc_ext(hba, QUERY_DESC_IDN_DEVICE, 0, desc, &len) ||
+	    len < DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS + 4 ||
+	    !(get_unaligned_be32(&desc[DEVICE_DESC_PARAM_EXT_UFS_FEATURE_SUP]) &
+	      UFS_DEV_WRITE_BOOSTER_SUP))
+		goto out;
+
+	shared = desc[DEVICE_DESC_PARAM_WB_TYPE] == WB_BUF_MODE_SHARED;
+	if (shared) {
+		if (!get_unaligned_be32(
+			&desc[DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS]))
+			goto out;
+		hba->wb.index = 0;
+	} else {
+		for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+			if (ufshcd_read_desc_ext(hba, QUERY_DESC_IDN_UNIT, lun,
+						 desc, &len) ||
+			    len < UNIT_DESC_PARAM_WB_BUF_ALLOC_UNITS + 4)
+				continue;
+			if (get_unaligned_be32(
+				&desc[UNIT_DESC_PARAM_WB_BUF_ALLOC_UNITS]))
+				break;
+		}
+		if (lun == UFS_UPIU_MAX_GENERAL_LUN)
+			goto out;
+		hba->wb.index = lun;
+	}
+
+	hba->wb.supported = true;
+	hba->wb.want_on = true;
+	hba->wb.flush_during_h8 = true;
+	hba->wb.flush_thresh = 4;
+	INIT_WORK(&hba->wb.toggle_work, ufshcd_wb_toggle_work);
+	ufshcd_wb_register_fb_notifier(hba);
+	dev_info(hba->dev, "WriteBooster supported, %s buffer\n",
+		 shared ? "shared" : "LU dedicated");
+out:
+	kfree(desc);
+}
+
 static inline int ufshcd_get_bkops_status(struct ufs_hba *hba, u32 *status)
 {
 	return ufshcd_query_attr_retry(hba, UPIU_QUERY_OPCODE_READ_ATTR,
@@ -6594,6 +7110,11 @@ static irqreturn_t ufshcd_intr(int irq, void *__hba)
 		intr_status = ufshcd_readl(hba, REG_INTERRUPT_STATUS);
 	} while (intr_status && --retries);
 
+	/* the requests it was raised for may have been polled already */
+	if (retval == IRQ_NONE && hba->intr_aggr.poll_raced)
+		retval = IRQ_HANDLED;
+	hba->intr_aggr.poll_raced = false;
+
 	if (retval == IRQ_NONE) {
 		dev_err(hba->dev, "%s: Unhandled interrupt 0x%08x\n",
 					__func__, intr_status);
@@ -7055,6 +7576,9 @@ static int ufshcd_reset_and_restore(struct ufs_hba *hba)
 	ufshcd_tmc_handler(hba);
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 
+	/* the device dropped its active HPB regions with the reset */
+	ufshpb_reset(hba);
+
 	return err;
 }
 
@@ -7551,6 +8075,9 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 	/* UFS device is also active now */
 	ufshcd_set_ufs_dev_active(hba);
 	ufshcd_force_reset_auto_bkops(hba);
+	if (!hba->is_init_prefetch)
+		ufshcd_wb_probe(hba);
+	ufshcd_wb_config(hba);
 	hba->wlun_dev_clr_ua = true;
 
 	if (ufshcd_get_max_pwr_mode(hba)) {
@@ -7584,6 +8111,8 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 		if (!hba->is_init_prefetch)
 			ufshcd_init_icc_levels(hba);
 
+		ufshpb_init(hba);
+
 		/* Add required well known logical units to scsi mid layer */
 		ret = ufshcd_scsi_add_wlus(hba);
 		if (ret)
@@ -7597,9 +8126,9 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 			hba->clk_scaling.is_scaled_up = true;
 			if (!hba->devfreq) {
 				hba->devfreq = devfreq_add_device(hba->dev,
-							&ufs_devfreq_profile,
-							"simple_ondemand",
-							gov_data);
+						&ufs_devfreq_profile,
+						UFSHCD_DEVFREQ_GOV,
+						ufshcd_devfreq_gov_data(hba));
 				if (IS_ERR(hba->devfreq)) {
 					ret = PTR_ERR(hba->devfreq);
 					dev_err(hba->dev, "Unable to register with devfreq %d\n",
@@ -7946,6 +8475,7 @@ static struct scsi_host_template ufshcd_driver_template = {
 	.name			= UFSHCD,
 	.proc_name		= UFSHCD,
 	.queuecommand		= ufshcd_queuecommand,
+	.mq_poll		= ufshcd_mq_poll,
 	.slave_alloc		= ufshcd_slave_alloc,
 	.slave_configure	= ufshcd_slave_configure,
 	.slave_destroy		= ufshcd_slave_destroy,
@@ -8757,6 +9287,17 @@ static int ufshcd_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 		ufshcd_suspend_clkscaling(hba);
 	}
 
+	/*
+	 * Keep the device powered with the link in hibern8 so that it can
+	 * flush a nearly full WriteBooster buffer while idle.
+	 */
+	if (ufshcd_is_runtime_pm(pm_op) &&
+	    req_link_state != UIC_LINK_ACTIVE_STATE &&
+	    ufshcd_is_link_active(hba) && ufshcd_wb_need_flush(hba)) {
+		req_dev_pwr_mode = UFS_ACTIVE_PWR_MODE;
+		req_link_state = UIC_LINK_HIBERN8_STATE;
+	}
+
 	if (req_dev_pwr_mode == UFS_ACTIVE_PWR_MODE &&
 			req_link_state == UIC_LINK_ACTIVE_STATE) {
 		goto disable_clks;
@@ -9329,8 +9870,120 @@ static const struct attribute_group ufs_sysfs_health_descriptor_group = {
 	.attrs = ufs_sysfs_health_descriptor,
 };
 
+static ssize_t wb_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	if (!hba->wb.supported)
+		return -EOPNOTSUPP;
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->wb.enabled);
+}
+
+static ssize_t wb_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	bool enable;
+	int err;
+
+	if (!hba->wb.supported)
+		return -EOPNOTSUPP;
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	WRITE_ONCE(hba->wb.want_on, enable);
+	pm_runtime_get_sync(hba->dev);
+	err = ufshcd_wb_ctrl(hba, enable);
+	pm_runtime_put_sync(hba->dev);
+
+	return err ? err : count;
+}
+static struct device_attribute dev_attr_wb_enable =
+	__ATTR(enable, S_IRUGO | S_IWUSR, wb_enable_show, wb_enable_store);
+
+static ssize_t flush_during_hibern8_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	if (!hba->wb.supported)
+		return -EOPNOTSUPP;
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->wb.flush_during_h8);
+}
+
+static ssize_t flush_during_hibern8_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	bool enable;
+	int err;
+
+	if (!hba->wb.supported)
+		return -EOPNOTSUPP;
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	pm_runtime_get_sync(hba->dev);
+	err = ufshcd_wb_flush_during_h8_ctrl(hba, enable);
+	pm_runtime_put_sync(hba->dev);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(flush_during_hibern8);
+
+static ssize_t ufs_sysfs_read_wb_attr(struct ufs_hba *hba,
+		enum attr_idn idn, u32 mult, char *buf)
+{
+	u32 val;
+	int err;
+
+	if (!hba->wb.supported)
+		return -EOPNOTSUPP;
+
+	pm_runtime_get_sync(hba->dev);
+	err = ufshcd_wb_read_attr(hba, idn, &val);
+	pm_runtime_put_sync(hba->dev);
+	if (err)
+		return -EINVAL;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", val * mult);
+}
+
+#define UFS_WB_ATTR(_name, _idn, _mult)					\
+static ssize_t _name##_show(struct device *dev,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct ufs_hba *hba = dev_get_drvdata(dev);			\
+	return ufs_sysfs_read_wb_attr(hba, QUERY_ATTR_IDN_##_idn,	\
+				      _mult, buf);			\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+UFS_WB_ATTR(available_buffer_percent, AVAIL_WB_BUFF_SIZE,
+	    WB_BUF_AVAIL_UNIT_PERCENT);
+UFS_WB_ATTR(current_buffer_size, CURR_WB_BUFF_SIZE, 1);
+UFS_WB_ATTR(life_time_estimation, WB_BUFF_LIFE_TIME_EST, 1);
+UFS_WB_ATTR(flush_status, WB_FLUSH_STATUS, 1);
+
+static struct attribute *ufs_sysfs_write_booster[] = {
+	&dev_attr_wb_enable.attr,
+	&dev_attr_flush_during_hibern8.attr,
+	&dev_attr_available_buffer_percent.attr,
+	&dev_attr_current_buffer_size.attr,
+	&dev_attr_life_time_estimation.attr,
+	&dev_attr_flush_status.attr,
+	NULL,
+};
+
+static const struct attribute_group ufs_sysfs_write_booster_group = {
+	.name = "write_booster",
+	.attrs = ufs_sysfs_write_booster,
+};
+
 static const struct attribute_group *ufs_sysfs_groups[] = {
 	&ufs_sysfs_health_descriptor_group,
+	&ufs_sysfs_write_booster_group,
 	NULL,
 };
 
@@ -9373,6 +10026,7 @@ static void ufshcd_shutdown_clkscaling(struct ufs_hba *hba)
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
 		cancel_work_sync(&hba->clk_scaling.suspend_work);
 		cancel_work_sync(&hba->clk_scaling.resume_work);
+		cancel_work_sync(&hba->clk_scaling.boost_work);
 		if (suspend)
 			ufshcd_suspend_clkscaling(hba);
 	}
@@ -9446,9 +10100,26 @@ latency_hist_store(struct device *dev, struct device_attribute *attr,
 	if (value == BLK_IO_LAT_HIST_ZERO) {
 		memset(&hba->io_lat_read, 0, sizeof(hba->io_lat_read));
 		memset(&hba->io_lat_write, 0, sizeof(hba->io_lat_write));
+		if (hba->lat_pct)
+			memset(hba->lat_pct, 0, sizeof(*hba->lat_pct));
 	} else if (value == BLK_IO_LAT_HIST_ENABLE ||
-		 value == BLK_IO_LAT_HIST_DISABLE)
+		 value == BLK_IO_LAT_HIST_DISABLE) {
+		/* the percentile tables are only allocated once needed */
+		if (value == BLK_IO_LAT_HIST_ENABLE && !hba->lat_pct) {
+			struct ufs_lat_pct *lat_pct;
+			unsigned long flags;
+
+			lat_pct = vzalloc(sizeof(*lat_pct));
+			spin_lock_irqsave(hba->host->host_lock, flags);
+			if (!hba->lat_pct) {
+				hba->lat_pct = lat_pct;
+				lat_pct = NULL;
+			}
+			spin_unlock_irqrestore(hba->host->host_lock, flags);
+			vfree(lat_pct);
+		}
 		hba->latency_hist_enabled = value;
+	}
 	return count;
 }
 
@@ -9470,17 +10141,101 @@ latency_hist_show(struct device *dev, struct device_attribute *attr,
 static DEVICE_ATTR(latency_hist, S_IRUGO | S_IWUSR,
 		   latency_hist_show, latency_hist_store);
 
+u64 ufshcd_lat_percentile(u32 *hist, u64 total, int permille)
+{
+	u64 target = DIV_ROUND_UP_ULL(total * permille, 1000);
+	u64 sum = 0;
+	int i;
+
+	for (i = 0; i < UFS_LAT_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum >= target)
+			return ufshcd_lat_bucket_max(i);
+	}
+
+	return ufshcd_lat_bucket_max(UFS_LAT_BUCKETS - 1);
+}
+EXPORT_SYMBOL(ufshcd_lat_percentile);
+
+/*
+ * Latency percentiles in us per LUN, opcode and the link/clock state the
+ * requests found on arrival. Each value is the upper bound of the
+ * histogram bucket the percentile falls in. Enabled and cleared through
+ * latency_hist.
+ */
+static ssize_t
+latency_pct_show(struct device *dev, struct device_attribute *attr,
+		 char *buf)
+{
+	static const char * const op_names[UFS_LAT_OP_MAX] = {
+		"read", "write", "unmap", "sync",
+	};
+	static const char * const pm_names[UFS_LAT_PM_MAX] = {
+		"active", "hibern8", "clk_gated",
+	};
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 *hist;
+	u64 total;
+	int lun, op, pm, i;
+	ssize_t len;
+
+	if (!hba->lat_pct)
+		return snprintf(buf, PAGE_SIZE, "disabled\n");
+
+	hist = kmalloc(sizeof(u32) * UFS_LAT_BUCKETS, GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	len = scnprintf(buf, PAGE_SIZE, "%-4s %-6s %-10s %10s %8s %8s %8s\n",
+			"lun", "op", "state", "count", "p50", "p99", "p99.9");
+	for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+		for (op = 0; op < UFS_LAT_OP_MAX; op++) {
+			for (pm = 0; pm < UFS_LAT_PM_MAX; pm++) {
+				unsigned long flags;
+
+				spin_lock_irqsave(hba->host->host_lock, flags);
+				memcpy(hist, hba->lat_pct->hist[lun][op][pm],
+				       sizeof(u32) * UFS_LAT_BUCKETS);
+				spin_unlock_irqrestore(hba->host->host_lock,
+						       flags);
+
+				for (total = 0, i = 0; i < UFS_LAT_BUCKETS; i++)
+					total += hist[i];
+				if (!total)
+					continue;
+
+				len += scnprintf(buf + len, PAGE_SIZE - len,
+					"%-4d %-6s %-10s %10llu %8llu %8llu %8llu\n",
+					lun, op_names[op], pm_names[pm], total,
+					ufshcd_lat_percentile(hist, total, 500),
+					ufshcd_lat_percentile(hist, total, 990),
+					ufshcd_lat_percentile(hist, total, 999));
+			}
+		}
+	}
+
+	kfree(hist);
+	return len;
+}
+
+static DEVICE_ATTR_RO(latency_pct);
+
 static void
 ufshcd_init_latency_hist(struct ufs_hba *hba)
 {
 	if (device_create_file(hba->dev, &dev_attr_latency_hist))
 		dev_err(hba->dev, "Failed to create latency_hist sysfs entry\n");
+	if (device_create_file(hba->dev, &dev_attr_latency_pct))
+		dev_err(hba->dev, "Failed to create latency_pct sysfs entry\n");
 }
 
 static void
 ufshcd_exit_latency_hist(struct ufs_hba *hba)
 {
 	device_create_file(hba->dev, &dev_attr_latency_hist);
+	device_remove_file(hba->dev, &dev_attr_latency_pct);
+	vfree(hba->lat_pct);
+	hba->lat_pct = NULL;
 }
 
 /**
@@ -9490,6 +10245,10 @@ ufshcd_exit_latency_hist(struct ufs_hba *hba)
  */
 void ufshcd_remove(struct ufs_hba *hba)
 {
+	if (hba->wb.supported) {
+		ufshcd_wb_unregister_fb_notifier(hba);
+		cancel_work_sync(&hba->wb.toggle_work);
+	}
 	scsi_remove_host(hba->host);
 	/* disable interrupts */
 	ufshcd_disable_intr(hba, hba->intr_mask);
@@ -9500,10 +10259,12 @@ void ufshcd_remove(struct ufs_hba *hba)
 	if (ufshcd_is_clkscaling_supported(hba)) {
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
 		ufshcd_exit_latency_hist(hba);
+		cancel_work_sync(&hba->clk_scaling.boost_work);
 		devfreq_remove_device(hba->devfreq);
 	}
 	ufshcd_hba_exit(hba);
 	ufsdbg_remove_debugfs(hba);
+	ufshpb_remove(hba);
 }
 EXPORT_SYMBOL_GPL(ufshcd_remove);
 
@@ -9559,6 +10320,8 @@ int ufshcd_alloc_host(struct device *dev, struct ufs_hba **hba_handle)
 		err = -ENOMEM;
 		goto out_error;
 	}
+	if (use_blk_mq)
+		host->use_blk_mq = true;
 	hba = shost_priv(host);
 	hba->host = host;
 	hba->dev = dev;
@@ -9917,6 +10680,21 @@ static void ufshcd_clk_scaling_resume_work(struct work_struct *work)
 	devfreq_resume_device(hba->devfreq);
 }
 
+static void ufshcd_clk_scaling_boost_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   clk_scaling.boost_work);
+	struct devfreq *devfreq = hba->devfreq;
+
+	if (!devfreq || hba->clk_scaling.is_scaled_up ||
+	    hba->clk_scaling.is_suspended)
+		return;
+
+	mutex_lock(&devfreq->lock);
+	update_devfreq(devfreq);
+	mutex_unlock(&devfreq->lock);
+}
+
 static int ufshcd_devfreq_target(struct device *dev,
 				unsigned long *freq, u32 flags)
 {
@@ -9988,7 +10766,10 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 	stat->total_time = jiffies_to_usecs((long)jiffies -
 				(long)scaling->window_start_t);
 	stat->busy_time = scaling->tot_busy_t;
+	scaling->last_load = scaling->load;
+	stat->private_data = &scaling->last_load;
 start_window:
+	memset(&scaling->load, 0, sizeof(scaling->load));
 	scaling->window_start_t = jiffies;
 	scaling->tot_busy_t = 0;
 
@@ -10181,6 +10962,11 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 			  ufshcd_clk_scaling_suspend_work);
 		INIT_WORK(&hba->clk_scaling.resume_work,
 			  ufshcd_clk_scaling_resume_work);
+		INIT_WORK(&hba->clk_scaling.boost_work,
+			  ufshcd_clk_scaling_boost_work);
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_SIMPLE_ONDEMAND)
+		hba->clk_scaling.gov_data.ondemand = ufshcd_ondemand_data;
+#endif
 
 		snprintf(wq_name, ARRAY_SIZE(wq_name), "ufs_clkscaling_%d",
 			 host->host_no);
@@ -71,6 +71,7 @@
 #include <linux/fault-inject.h>
 #include "ufs.h"
 #include "ufshci.h"
+#include "ufs-devfreq.h"
 
 #define UFSHCD "ufshcd"
 #define UFSHCD_DRIVER_VERSION "0.3"
@@ -79,6 +80,7 @@
 #define UFS_MASK(x, y)	(x << ((y) % BITS_PER_LONG))
 
 struct ufs_hba;
+struct ufshpb;
 
 enum dev_cmd_type {
 	DEV_CMD_TYPE_NOP		= 0x0,
@@ -194,6 +196,7 @@ struct ufs_pm_lvl_states {
  * @issue_time_stamp: time stamp for debug purposes
  * @complete_time_stamp: time stamp for statistics
  * @req_abort_skip: skip request abort task flag
+ * @lat_pm_state: link/clock state when the request arrived, enum ufs_lat_pm
  */
 struct ufshcd_lrb {
 	struct utp_transfer_req_desc *utr_descriptor_ptr;
@@ -219,6 +222,7 @@ struct ufshcd_lrb {
 	ktime_t complete_time_stamp;
 
 	bool req_abort_skip;
+	u8 lat_pm_state;
 };
 
 /**
@@ -489,6 +493,10 @@ struct ufs_saved_pwr_info {
  * @workq: workqueue to schedule devfreq suspend/resume work
  * @suspend_work: worker to suspend devfreq
  * @resume_work: worker to resume devfreq
+ * @boost_work: worker to re-evaluate devfreq right away on boosted I/O
+ * @load: requests issued in the current polling window
+ * @last_load: @load of the last window, handed to the governor
+ * @gov_data: per device data of the ufs_qd governor
  * @is_allowed: tracks if scaling is currently allowed or not
  * @is_busy_started: tracks if busy period has started or not
  * @is_suspended: tracks if devfreq is suspended or not
@@ -504,6 +512,10 @@ struct ufs_clk_scaling {
 	struct workqueue_struct *workq;
 	struct work_struct suspend_work;
 	struct work_struct resume_work;
+	struct work_struct boost_work;
+	struct ufs_devfreq_load load;
+	struct ufs_devfreq_load last_load;
+	struct ufs_devfreq_gov_data gov_data;
 	bool is_allowed;
 	bool is_busy_started;
 	bool is_suspended;
@@ -547,6 +559,10 @@ struct debugfs_files {
 	struct dentry *dbg_print_en;
 	struct dentry *req_stats;
 	struct dentry *query_stats;
+	struct dentry *intr_aggr_stats;
+#ifdef CONFIG_SCSI_UFS_HPB
+	struct dentry *hpb_stats;
+#endif
 	u32 dme_local_attr_id;
 	u32 dme_peer_attr_id;
 	struct dentry *reset_controller;
@@ -646,6 +662,84 @@ struct ufs_stats {
 	struct ufs_uic_err_reg_hist dme_err;
 };
 
+/**
+ * struct ufs_intr_aggr - adaptive transfer completion interrupt aggregation
+ * @cnt: counter threshold currently programmed in UTRIACR
+ * @tmout: timeout value currently programmed in UTRIACR, in 40us units
+ * @irqs: transfer completion interrupts handled
+ * @completions: transfer requests completed by those interrupts
+ * @immediate: commands issued at QD1 that bypassed aggregation
+ * @reconfigs: writes to UTRIACR made to retune the thresholds
+ * @polled: transfer requests completed by blk_poll() instead
+ * @poll_raced: polling consumed completions whose interrupt may still fire
+ */
+struct ufs_intr_aggr {
+	u8 cnt;
+	u8 tmout;
+	u64 irqs;
+	u64 completions;
+	u64 immediate;
+	u64 reconfigs;
+	u64 polled;
+	bool poll_raced;
+};
+
+/**
+ * struct ufs_wb_info - WriteBooster state
+ * @supported: device has a WriteBooster buffer configured
+ * @enabled: fWriteBoosterEn as last written to the device
+ * @want_on: WriteBooster requested, follows the screen state by default
+ * @flush_during_h8: fWriteBoosterBufferFlushDuringHibernate requested
+ * @index: query index, the LU owning the buffer in LU dedicated mode
+ * @flush_thresh: available buffer, in 10% units, at or below which
+ *	runtime suspend keeps the device powered in hibern8 to flush it
+ * @toggle_work: applies @want_on from contexts that can't query
+ * @fb_notif: screen state notifier
+ */
+struct ufs_wb_info {
+	bool supported;
+	bool enabled;
+	bool want_on;
+	bool flush_during_h8;
+	u8 index;
+	u8 flush_thresh;
+	struct work_struct toggle_work;
+	struct notifier_block fb_notif;
+};
+
+/* Per LUN, per opcode latency percentiles */
+enum ufs_lat_op {
+	UFS_LAT_READ,
+	UFS_LAT_WRITE,
+	UFS_LAT_UNMAP,
+	UFS_LAT_SYNC,
+	UFS_LAT_OP_MAX,
+};
+
+enum ufs_lat_pm {
+	UFS_LAT_ACTIVE,
+	UFS_LAT_HIBERN8,
+	UFS_LAT_CLK_GATED,
+	UFS_LAT_PM_MAX,
+};
+
+/*
+ * Log-scale buckets in microseconds: values below 4us get their own
+ * bucket, above that each power of two is split into 4 sub-buckets, up
+ * to 2^26us.
+ */
+#define UFS_LAT_SUB_BITS	2
+#define UFS_LAT_MAX_SHIFT	26
+#define UFS_LAT_BUCKETS		(UFS_LAT_MAX_SHIFT << UFS_LAT_SUB_BITS)
+
+struct ufs_lat_pct {
+	u32 hist[UFS_UPIU_MAX_GENERAL_LUN][UFS_LAT_OP_MAX][UFS_LAT_PM_MAX]
+		[UFS_LAT_BUCKETS];
+};
+
+int ufshcd_lat_bucket(u64 us);
+u64 ufshcd_lat_percentile(u32 *hist, u64 total, int permille);
+
 /* UFS Host Controller debug print bitmask */
 #define UFSHCD_DBG_PRINT_CLK_FREQ_EN		UFS_BIT(0)
 #define UFSHCD_DBG_PRINT_UIC_ERR_HIST_EN	UFS_BIT(1)
@@ -874,8 +968,13 @@ struct ufs_hba {
 	/* Keeps information of the UFS device connected to this host */
 	struct ufs_dev_info dev_info;
 	bool auto_bkops_enabled;
+	struct ufs_wb_info wb;
 
 	struct ufs_stats ufs_stats;
+	struct ufs_intr_aggr intr_aggr;
+#ifdef CONFIG_SCSI_UFS_HPB
+	struct ufshpb *hpb;
+#endif
 #ifdef CONFIG_DEBUG_FS
 	struct debugfs_files debugfs_files;
 #endif
@@ -956,6 +1055,7 @@ struct ufs_hba {
 	int			latency_hist_enabled;
 	struct io_latency_state io_lat_read;
 	struct io_latency_state io_lat_write;
+	struct ufs_lat_pct *lat_pct;
 	bool restore_needed;
 };
 
@@ -1185,10 +1285,14 @@ int ufshcd_read_string_desc(struct ufs_hba *hba, int desc_index, u8 *buf,
 /* Expose Query-Request API */
 int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
 	enum flag_idn idn, bool *flag_res);
+int ufshcd_query_flag_index(struct ufs_hba *hba, enum query_opcode opcode,
+	enum flag_idn idn, u8 index, bool *flag_res);
 int ufshcd_query_attr(struct ufs_hba *hba, enum query_opcode opcode,
 	enum attr_idn idn, u8 index, u8 selector, u32 *attr_val);
 int ufshcd_query_descriptor(struct ufs_hba *hba, enum query_opcode opcode,
 	enum desc_idn idn, u8 index, u8 selector, u8 *desc_buf, int *buf_len);
+int ufshcd_read_desc_ext(struct ufs_hba *hba, enum desc_idn idn, int index,
+	u8 *buf, int *len);
 
 int ufshcd_hold(struct ufs_hba *hba, bool async);
 void ufshcd_release(struct ufs_hba *hba, bool no_sched);
@@ -0,0 +1,738 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * UFS Host Performance Booster, device control mode.
+ *
+ * The device recommends regions to activate or inactivate in the sense
+ * data of its responses. For every active subregion the host reads the
+ * L2P map with HPB READ BUFFER and keeps it until the region falls off
+ * the LRU or the device asks for it to be dropped. Single block reads
+ * that hit a clean cached entry are sent as HPB READ carrying the
+ * physical page number, which saves the device its own map lookup.
+ * Writes and discards mark the entries they touch dirty so that those
+ * blocks are read normally until the device recommends the subregion
+ * again.
+ */
+
+#include <linux/blkdev.h>
+#include <linux/vmalloc.h>
+#include <asm/unaligned.h>
+#include <scsi/scsi_device.h>
+
+#include "ufshpb.h"
+
+#define UFSHPB_MAP_REQ_TIMEOUT		(30 * HZ)
+#define UFSHPB_MAP_REQ_RETRIES		3
+
+/*
+ * Host memory available for the L2P maps of all HPB LUs, split evenly
+ * between them. Pinned regions are always cached and are not counted.
+ */
+static unsigned int max_mem_kb = 16384;
+module_param(max_mem_kb, uint, 0444);
+MODULE_PARM_DESC(max_mem_kb, "memory cap for cached HPB L2P maps, in KB");
+
+static inline struct ufshpb_lu *ufshpb_get_lu(struct ufs_hba *hba, int lun)
+{
+	if (!hba->hpb || lun >= UFS_UPIU_MAX_GENERAL_LUN)
+		return NULL;
+	return READ_ONCE(hba->hpb->lu[lun]);
+}
+
+static inline size_t ufshpb_map_size(struct ufshpb_lu *hpb)
+{
+	return PAGE_SIZE << hpb->map_order;
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_drop_srgn(struct ufshpb_lu *hpb,
+			     struct ufshpb_subregion *srgn)
+{
+	if (srgn->state == HPB_SRGN_VALID) {
+		free_pages((unsigned long)srgn->map, hpb->map_order);
+		kfree(srgn->dirty);
+		srgn->map = NULL;
+		srgn->dirty = NULL;
+		hpb->valid_srgns--;
+	}
+	list_del_init(&srgn->list);
+	srgn->state = HPB_SRGN_INVALID;
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_queue_srgn(struct ufshpb_lu *hpb,
+			      struct ufshpb_subregion *srgn)
+{
+	if (srgn->state == HPB_SRGN_PENDING ||
+	    srgn->state == HPB_SRGN_ISSUED)
+		return;
+
+	/* the device map changed, the cached copy is of no further use */
+	ufshpb_drop_srgn(hpb, srgn);
+	srgn->state = HPB_SRGN_PENDING;
+	list_add_tail(&srgn->list, &hpb->fetch_list);
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_evict_rgn(struct ufshpb_lu *hpb, struct ufshpb_region *rgn)
+{
+	int i;
+
+	if (rgn->state != HPB_RGN_ACTIVE)
+		return;
+
+	for (i = 0; i < rgn->srgn_cnt; i++)
+		ufshpb_drop_srgn(hpb, &rgn->srgn_tbl[i]);
+
+	list_del_init(&rgn->lru);
+	rgn->state = HPB_RGN_INACTIVE;
+	hpb->active_rgns--;
+	hpb->stats.evict++;
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_activate_srgn(struct ufshpb_lu *hpb, int rgn_idx,
+				 int srgn_idx)
+{
+	struct ufshpb_region *rgn;
+
+	if (rgn_idx >= hpb->rgn_cnt)
+		return;
+	rgn = &hpb->rgn_tbl[rgn_idx];
+	if (srgn_idx >= rgn->srgn_cnt)
+		return;
+
+	switch (rgn->state) {
+	case HPB_RGN_INACTIVE:
+		if (hpb->max_active_rgns <= 0)
+			return;
+		if (hpb->active_rgns >= hpb->max_active_rgns)
+			ufshpb_evict_rgn(hpb, list_first_entry(&hpb->lru,
+					 struct ufshpb_region, lru));
+		rgn->state = HPB_RGN_ACTIVE;
+		list_add_tail(&rgn->lru, &hpb->lru);
+		hpb->active_rgns++;
+		break;
+	case HPB_RGN_ACTIVE:
+		list_move_tail(&rgn->lru, &hpb->lru);
+		break;
+	}
+
+	ufshpb_queue_srgn(hpb, &rgn->srgn_tbl[srgn_idx]);
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_reset_lu(struct ufshpb_lu *hpb)
+{
+	struct ufshpb_region *rgn;
+	int i, j;
+
+	for (i = 0; i < hpb->rgn_cnt; i++) {
+		rgn = &hpb->rgn_tbl[i];
+		if (rgn->state == HPB_RGN_ACTIVE) {
+			ufshpb_evict_rgn(hpb, rgn);
+		} else if (rgn->state == HPB_RGN_PINNED) {
+			for (j = 0; j < rgn->srgn_cnt; j++) {
+				ufshpb_drop_srgn(hpb, &rgn->srgn_tbl[j]);
+				ufshpb_queue_srgn(hpb, &rgn->srgn_tbl[j]);
+			}
+		}
+	}
+}
+
+static int ufshpb_read_buffer(struct ufshpb_lu *hpb,
+			      struct ufshpb_subregion *srgn, void *map)
+{
+	struct request_queue *q = hpb->sdev->request_queue;
+	size_t len = HPB_ENTRY_SIZE << hpb->srgn_shift;
+	struct request *rq;
+	int ret;
+
+	rq = blk_get_request(q, READ, GFP_NOIO);
+	if (IS_ERR(rq))
+		return PTR_ERR(rq);
+	blk_rq_set_block_pc(rq);
+
+	ret = blk_rq_map_kern(q, rq, map, len, GFP_NOIO);
+	if (ret)
+		goto out;
+
+	rq->cmd_len = 10;
+	memset(rq->cmd, 0, BLK_MAX_CDB);
+	rq->cmd[0] = UFSHPB_READ_BUFFER;
+	rq->cmd[1] = UFSHPB_READ_BUFFER_ID;
+	put_unaligned_be16(srgn->rgn_idx, &rq->cmd[2]);
+	put_unaligned_be16(srgn->srgn_idx, &rq->cmd[4]);
+	rq->cmd[6] = (len >> 16) & 0xff;
+	rq->cmd[7] = (len >> 8) & 0xff;
+	rq->cmd[8] = len & 0xff;
+	rq->timeout = UFSHPB_MAP_REQ_TIMEOUT;
+	rq->retries = UFSHPB_MAP_REQ_RETRIES;
+	rq->cmd_flags |= REQ_QUIET;
+
+	ret = blk_execute_rq(q, NULL, rq, 1);
+out:
+	blk_put_request(rq);
+	return ret;
+}
+
+static void ufshpb_fetch_srgn(struct ufshpb_lu *hpb,
+			      struct ufshpb_subregion *srgn)
+{
+	unsigned int entries = 1 << hpb->srgn_shift;
+	unsigned long *dirty;
+	unsigned long flags;
+	void *map;
+	int ret = -ENOMEM;
+
+	map = (void *)__get_free_pages(GFP_NOIO | __GFP_NOWARN,
+				       hpb->map_order);
+	dirty = kcalloc(BITS_TO_LONGS(entries), sizeof(long), GFP_NOIO);
+	if (map && dirty)
+		ret = ufshpb_read_buffer(hpb, srgn, map);
+
+	spin_lock_irqsave(&hpb->lock, flags);
+	hpb->stats.map_req++;
+	if (ret)
+		hpb->stats.map_fail++;
+	if (srgn->state == HPB_SRGN_ISSUED) {
+		if (!ret && !srgn->stale) {
+			srgn->map = map;
+			srgn->dirty = dirty;
+			srgn->state = HPB_SRGN_VALID;
+			hpb->valid_srgns++;
+			map = NULL;
+			dirty = NULL;
+		} else {
+			srgn->state = HPB_SRGN_INVALID;
+		}
+	}
+	spin_unlock_irqrestore(&hpb->lock, flags);
+
+	if (map)
+		free_pages((unsigned long)map, hpb->map_order);
+	kfree(dirty);
+}
+
+static void ufshpb_map_work_handler(struct work_struct *work)
+{
+	struct ufshpb_lu *hpb = container_of(work, struct ufshpb_lu, map_work);
+	struct ufshpb_subregion *srgn;
+	unsigned long flags;
+
+	for (;;) {
+		spin_lock_irqsave(&hpb->lock, flags);
+		srgn = list_first_entry_or_null(&hpb->fetch_list,
+						struct ufshpb_subregion, list);
+		if (!srgn) {
+			spin_unlock_irqrestore(&hpb->lock, flags);
+			break;
+		}
+		list_del_init(&srgn->list);
+		srgn->state = HPB_SRGN_ISSUED;
+		srgn->stale = false;
+		spin_unlock_irqrestore(&hpb->lock, flags);
+
+		ufshpb_fetch_srgn(hpb, srgn);
+	}
+}
+
+/* Called with hpb->lock held */
+static struct ufshpb_subregion *ufshpb_lba_to_srgn(struct ufshpb_lu *hpb,
+						   sector_t lba)
+{
+	struct ufshpb_region *rgn;
+	sector_t rgn_idx = lba >> hpb->rgn_shift;
+	int srgn_idx;
+
+	if (rgn_idx >= hpb->rgn_cnt)
+		return NULL;
+	rgn = &hpb->rgn_tbl[rgn_idx];
+	srgn_idx = (lba >> hpb->srgn_shift) & (hpb->srgns_per_rgn - 1);
+	if (srgn_idx >= rgn->srgn_cnt)
+		return NULL;
+
+	return &rgn->srgn_tbl[srgn_idx];
+}
+
+static void ufshpb_set_dirty(struct ufshpb_lu *hpb, sector_t lba,
+			     unsigned int cnt)
+{
+	unsigned int srgn_entries = 1 << hpb->srgn_shift;
+	struct ufshpb_subregion *srgn;
+	unsigned int off, len;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hpb->lock, flags);
+	while (cnt) {
+		srgn = ufshpb_lba_to_srgn(hpb, lba);
+		if (!srgn)
+			break;
+		off = lba & (srgn_entries - 1);
+		len = min(cnt, srgn_entries - off);
+		if (srgn->state == HPB_SRGN_VALID)
+			bitmap_set(srgn->dirty, off, len);
+		else if (srgn->state == HPB_SRGN_ISSUED)
+			srgn->stale = true;
+		lba += len;
+		cnt -= len;
+	}
+	spin_unlock_irqrestore(&hpb->lock, flags);
+}
+
+/**
+ * ufshpb_prep - turn a cached single block read into HPB READ
+ * @hba: per adapter instance
+ * @lrbp: local reference block of the command being queued
+ *
+ * Called from queuecommand before the UPIU is composed. Writes and
+ * discards only dirty the cached entries they cover.
+ */
+void ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
+{
+	struct scsi_cmnd *cmd = lrbp->cmd;
+	struct request *rq = cmd->request;
+	struct ufshpb_subregion *srgn;
+	struct ufshpb_region *rgn;
+	struct ufshpb_lu *hpb;
+	unsigned long flags;
+	unsigned int cnt, off;
+	sector_t lba;
+	u8 ppn[HPB_ENTRY_SIZE];
+	bool hit = false;
+	u8 *cdb;
+
+	hpb = ufshpb_get_lu(hba, lrbp->lun);
+	if (!hpb || rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	lba = blk_rq_pos(rq) >> hpb->blk_shift;
+	cnt = blk_rq_sectors(rq) >> hpb->blk_shift;
+
+	if (rq_data_dir(rq) == WRITE || (rq->cmd_flags & REQ_DISCARD)) {
+		ufshpb_set_dirty(hpb, lba, cnt);
+		return;
+	}
+
+	/* HPB READ covers a single logical block */
+	if (cmd->cmnd[0] != READ_10 || cnt != 1)
+		return;
+
+	spin_lock_irqsave(&hpb->lock, flags);
+	srgn = ufshpb_lba_to_srgn(hpb, lba);
+	if (srgn && srgn->state == HPB_SRGN_VALID) {
+		off = lba & ((1 << hpb->srgn_shift) - 1);
+		if (!test_bit(off, srgn->dirty)) {
+			memcpy(ppn, srgn->map + off * HPB_ENTRY_SIZE,
+			       HPB_ENTRY_SIZE);
+			rgn = &hpb->rgn_tbl[srgn->rgn_idx];
+			if (rgn->state == HPB_RGN_ACTIVE)
+				list_move_tail(&rgn->lru, &hpb->lru);
+			hit = true;
+		}
+	}
+	if (hit)
+		hpb->stats.hit++;
+	else
+		hpb->stats.miss++;
+	spin_unlock_irqrestore(&hpb->lock, flags);
+
+	if (!hit)
+		return;
+
+	/* keep the LBA and the DPO/FUA bits of the READ(10) */
+	cdb = cmd->cmnd;
+	cdb[0] = UFSHPB_READ;
+	memcpy(&cdb[6], ppn, HPB_ENTRY_SIZE);
+	cdb[14] = 1;
+	cdb[15] = 0;
+	cmd->cmd_len = MAX_CDB_SIZE;
+}
+
+/**
+ * ufshpb_rsp_upiu - handle the HPB recommendation of a response UPIU
+ * @hba: per adapter instance
+ * @lrbp: local reference block of the completed command
+ *
+ * Called with host_lock held from the completion path.
+ */
+void ufshpb_rsp_upiu(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
+{
+	struct ufshpb_rsp_field *rsp;
+	struct ufshpb_lu *hpb;
+	int i, cnt;
+
+	if (!hba->hpb || !(be32_to_cpu(lrbp->ucd_rsp_ptr->header.dword_2) &
+			   MASK_RSP_HPB_UPDATE_ALERT))
+		return;
+
+	rsp = (struct ufshpb_rsp_field *)&lrbp->ucd_rsp_ptr->sr.sense_data_len;
+	if (be16_to_cpu(rsp->sense_data_len) != HPB_RSP_SENSE_DATA_LEN ||
+	    rsp->desc_type != HPB_RSP_DESC_TYPE ||
+	    rsp->additional_len != HPB_RSP_ADDITIONAL_LEN)
+		return;
+
+	hpb = ufshpb_get_lu(hba, rsp->lun);
+	if (!hpb)
+		return;
+
+	spin_lock(&hpb->lock);
+	switch (rsp->hpb_op) {
+	case HPB_RSP_REQ_REGION_UPDATE:
+		cnt = min_t(int, rsp->inactive_rgn_cnt, HPB_RSP_MAX_RGNS);
+		for (i = 0; i < cnt; i++) {
+			int rgn_idx = be16_to_cpu(rsp->inactive_rgn[i]);
+
+			if (rgn_idx < hpb->rgn_cnt)
+				ufshpb_evict_rgn(hpb, &hpb->rgn_tbl[rgn_idx]);
+			hpb->stats.rb_inactive++;
+		}
+		cnt = min_t(int, rsp->active_rgn_cnt, HPB_RSP_MAX_RGNS);
+		for (i = 0; i < cnt; i++) {
+			ufshpb_activate_srgn(hpb,
+				be16_to_cpu(rsp->active[i].rgn),
+				be16_to_cpu(rsp->active[i].srgn));
+			hpb->stats.rb_active++;
+		}
+		break;
+	case HPB_RSP_DEV_RESET:
+		ufshpb_reset_lu(hpb);
+		hpb->stats.rb_reset++;
+		break;
+	}
+	if (!list_empty(&hpb->fetch_list))
+		queue_work(hba->hpb->wq, &hpb->map_work);
+	spin_unlock(&hpb->lock);
+}
+
+/**
+ * ufshpb_reset - drop the cached maps after a device reset
+ * @hba: per adapter instance
+ *
+ * The device forgets its active regions when it is reset, so start over
+ * from the pinned regions.
+ */
+void ufshpb_reset(struct ufs_hba *hba)
+{
+	struct ufshpb_lu *hpb;
+	unsigned long flags;
+	int lun;
+
+	for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+		hpb = ufshpb_get_lu(hba, lun);
+		if (!hpb)
+			continue;
+		spin_lock_irqsave(&hpb->lock, flags);
+		ufshpb_reset_lu(hpb);
+		if (!list_empty(&hpb->fetch_list))
+			queue_work(hba->hpb->wq, &hpb->map_work);
+		spin_unlock_irqrestore(&hpb->lock, flags);
+	}
+}
+
+static int ufshpb_alloc_tables(struct ufshpb_lu *hpb, u64 blk_cnt)
+{
+	struct ufshpb_subregion *srgn_tbl;
+	struct ufshpb_region *rgn;
+	u64 rgn_blks = 1ULL << hpb->rgn_shift;
+	u64 last_blks;
+	int i, j;
+
+	hpb->rgn_cnt = DIV_ROUND_UP_ULL(blk_cnt, rgn_blks);
+	hpb->rgn_tbl = vzalloc(hpb->rgn_cnt * sizeof(*hpb->rgn_tbl));
+	if (!hpb->rgn_tbl)
+		return -ENOMEM;
+
+	srgn_tbl = vzalloc((size_t)hpb->rgn_cnt * hpb->srgns_per_rgn *
+			   sizeof(*srgn_tbl));
+	if (!srgn_tbl) {
+		vfree(hpb->rgn_tbl);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < hpb->rgn_cnt; i++) {
+		rgn = &hpb->rgn_tbl[i];
+		rgn->srgn_tbl = &srgn_tbl[i * hpb->srgns_per_rgn];
+		rgn->srgn_cnt = hpb->srgns_per_rgn;
+		rgn->state = HPB_RGN_INACTIVE;
+		INIT_LIST_HEAD(&rgn->lru);
+		for (j = 0; j < rgn->srgn_cnt; j++) {
+			rgn->srgn_tbl[j].rgn_idx = i;
+			rgn->srgn_tbl[j].srgn_idx = j;
+			INIT_LIST_HEAD(&rgn->srgn_tbl[j].list);
+		}
+	}
+
+	last_blks = blk_cnt - (u64)(hpb->rgn_cnt - 1) * rgn_blks;
+	hpb->rgn_tbl[hpb->rgn_cnt - 1].srgn_cnt =
+		DIV_ROUND_UP_ULL(last_blks, 1ULL << hpb->srgn_shift);
+
+	return 0;
+}
+
+static void ufshpb_free_tables(struct ufshpb_lu *hpb)
+{
+	int i, j;
+
+	for (i = 0; i < hpb->rgn_cnt; i++)
+		for (j = 0; j < hpb->rgn_tbl[i].srgn_cnt; j++)
+			ufshpb_drop_srgn(hpb, &hpb->rgn_tbl[i].srgn_tbl[j]);
+
+	vfree(hpb->rgn_tbl[0].srgn_tbl);
+	vfree(hpb->rgn_tbl);
+}
+
+/**
+ * ufshpb_init_lu - set up HPB for a LU that has it enabled
+ * @hba: per adapter instance
+ * @sdev: SCSI device of the LU
+ */
+void ufshpb_init_lu(struct ufs_hba *hba, struct scsi_device *sdev)
+{
+	struct ufshpb *ufshpb = hba->hpb;
+	struct ufshpb_lu *hpb;
+	u16 lu_max_active, pin_start, pin_cnt;
+	unsigned long flags;
+	u64 blk_cnt, cap;
+	int lun = sdev->lun;
+	int len, i, j;
+	u8 *desc;
+
+	if (!ufshpb || lun >= UFS_UPIU_MAX_GENERAL_LUN || ufshpb->lu[lun])
+		return;
+
+	desc = kzalloc(QUERY_DESC_MAX_SIZE, GFP_KERNEL);
+	if (!desc)
+		return;
+
+	if (ufshcd_read_desc_ext(hba, QUERY_DESC_IDN_UNIT, lun, desc, &len) ||
+	    len < UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS + 2 ||
+	    desc[UNIT_DESC_PARAM_LU_ENABLE] != LU_HPB_ENABLE)
+		goto out;
+
+	/* HPB entries map 4KB logical blocks */
+	if ((1 << desc[UNIT_DESC_PARAM_LOGICAL_BLK_SIZE]) !=
+	    HPB_ENTRY_BLOCK_SIZE) {
+		dev_warn(hba->dev, "%s: LU %d: unsupported block size\n",
+			 __func__, lun);
+		goto out;
+	}
+
+	blk_cnt = get_unaligned_be64(&desc[UNIT_DESC_PARAM_LOGICAL_BLK_COUNT]);
+	lu_max_active = get_unaligned_be16(
+			&desc[UNIT_DESC_PARAM_HPB_LU_MAX_ACTIVE_RGNS]);
+	pin_start = get_unaligned_be16(
+			&desc[UNIT_DESC_PARAM_HPB_PIN_RGN_START_OFF]);
+	pin_cnt = get_unaligned_be16(&desc[UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS]);
+	if (!blk_cnt)
+		goto out;
+
+	hpb = kzalloc(sizeof(*hpb), GFP_KERNEL);
+	if (!hpb)
+		goto out;
+
+	hpb->hba = hba;
+	hpb->sdev = sdev;
+	hpb->lun = lun;
+	spin_lock_init(&hpb->lock);
+	INIT_LIST_HEAD(&hpb->lru);
+	INIT_LIST_HEAD(&hpb->fetch_list);
+	INIT_WORK(&hpb->map_work, ufshpb_map_work_handler);
+
+	/* region sizes are in 512 byte units, entries in 4KB blocks */
+	hpb->blk_shift = ilog2(HPB_ENTRY_BLOCK_SIZE) - 9;
+	hpb->rgn_shift = ufshpb->rgn_size - hpb->blk_shift;
+	hpb->srgn_shift = ufshpb->srgn_size - hpb->blk_shift;
+	hpb->srgns_per_rgn = 1 << (hpb->rgn_shift - hpb->srgn_shift);
+	hpb->map_order = get_order(HPB_ENTRY_SIZE << hpb->srgn_shift);
+
+	if (ufshpb_alloc_tables(hpb, blk_cnt)) {
+		kfree(hpb);
+		goto out;
+	}
+
+	if (!lu_max_active)
+		lu_max_active = ufshpb->max_active_rgns;
+	cap = (u64)max_mem_kb * 1024 / ufshpb->num_lu;
+	cap = div64_u64(cap, ufshpb_map_size(hpb) * hpb->srgns_per_rgn);
+	hpb->max_active_rgns = min_t(u64, lu_max_active, cap);
+
+	for (i = pin_start; i < pin_start + pin_cnt && i < hpb->rgn_cnt; i++) {
+		hpb->rgn_tbl[i].state = HPB_RGN_PINNED;
+		for (j = 0; j < hpb->rgn_tbl[i].srgn_cnt; j++)
+			ufshpb_queue_srgn(hpb, &hpb->rgn_tbl[i].srgn_tbl[j]);
+		hpb->pinned_rgns++;
+	}
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	ufshpb->lu[lun] = hpb;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	if (hpb->pinned_rgns)
+		queue_work(ufshpb->wq, &hpb->map_work);
+
+	dev_info(hba->dev, "HPB LU %d: %d regions, %d active max, %d pinned\n",
+		 lun, hpb->rgn_cnt, hpb->max_active_rgns, hpb->pinned_rgns);
+out:
+	kfree(desc);
+}
+
+/**
+ * ufshpb_destroy_lu - tear down HPB for a LU being removed
+ * @hba: per adapter instance
+ * @sdev: SCSI device of the LU
+ */
+void ufshpb_destroy_lu(struct ufs_hba *hba, struct scsi_device *sdev)
+{
+	struct ufshpb_lu *hpb = ufshpb_get_lu(hba, sdev->lun);
+	unsigned long flags;
+
+	if (!hpb || hpb->sdev != sdev)
+		return;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->hpb->lu[hpb->lun] = NULL;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	cancel_work_sync(&hpb->map_work);
+	ufshpb_free_tables(hpb);
+	kfree(hpb);
+}
+
+/**
+ * ufshpb_init - read the HPB capabilities of the device
+ * @hba: per adapter instance
+ *
+ * Called once the device is initialized and before its LUs are scanned.
+ */
+void ufshpb_init(struct ufs_hba *hba)
+{
+	struct ufshpb *ufshpb;
+	u8 *desc;
+	int len;
+
+	if (hba->hpb)
+		return;
+
+	desc = kzalloc(QUERY_DESC_MAX_SIZE, GFP_KERNEL);
+	if (!desc)
+		return;
+
+	if (ufshcd_read_desc_ext(hba, QUERY_DESC_IDN_DEVICE, 0, desc, &len) ||
+	    len < DEVICE_DESC_PARAM_HPB_VER + 2 ||
+	    !(desc[DEVICE_DESC_PARAM_UFS_FEAT] & UFS_DEV_HPB_SUPPORT))
+		goto out;
+
+	ufshpb = kzalloc(sizeof(*ufshpb), GFP_KERNEL);
+	if (!ufshpb)
+		goto out;
+	ufshpb->version = get_unaligned_be16(&desc[DEVICE_DESC_PARAM_HPB_VER]);
+
+	if (ufshcd_read_desc_ext(hba, QUERY_DESC_IDN_GEOMETRY, 0, desc, &len) ||
+	    len < GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_RGNS + 2)
+		goto out_free;
+
+	ufshpb->rgn_size = desc[GEOMETRY_DESC_PARAM_HPB_REGION_SIZE];
+	ufshpb->srgn_size = desc[GEOMETRY_DESC_PARAM_HPB_SUBREGION_SIZE];
+	ufshpb->num_lu = desc[GEOMETRY_DESC_PARAM_HPB_NUMBER_LU];
+	ufshpb->max_active_rgns = get_unaligned_be16(
+			&desc[GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_RGNS]);
+
+	if (!ufshpb->num_lu || ufshpb->srgn_size > ufshpb->rgn_size ||
+	    ufshpb->srgn_size < ilog2(HPB_ENTRY_BLOCK_SIZE) - 9 ||
+	    ufshpb->rgn_size >= 32) {
+		dev_warn(hba->dev, "%s: invalid HPB geometry\n", __func__);
+		goto out_free;
+	}
+
+	ufshpb->wq = alloc_workqueue("ufshpb", WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!ufshpb->wq)
+		goto out_free;
+
+	hba->hpb = ufshpb;
+	dev_info(hba->dev, "HPB %x.%02x, region %u KB, subregion %u KB\n",
+		 ufshpb->version >> 8, ufshpb->version & 0xff,
+		 1 << (ufshpb->rgn_size - 1), 1 << (ufshpb->srgn_size - 1));
+	goto out;
+
+out_free:
+	kfree(ufshpb);
+out:
+	kfree(desc);
+}
+
+/**
+ * ufshpb_remove - free the HPB state once all LUs are gone
+ * @hba: per adapter instance
+ */
+void ufshpb_remove(struct ufs_hba *hba)
+{
+	if (!hba->hpb)
+		return;
+
+	destroy_workqueue(hba->hpb->wq);
+	kfree(hba->hpb);
+	hba->hpb = NULL;
+}
+
+/**
+ * ufshpb_stats_show - print the per LU HPB statistics
+ * @hba: per adapter instance
+ * @file: seq_file to print to
+ */
+void ufshpb_stats_show(struct ufs_hba *hba, struct seq_file *file)
+{
+	struct ufshpb_stats stats;
+	struct ufshpb_lu *hpb;
+	unsigned long flags;
+	int active, pinned, valid, max_active;
+	size_t map_size;
+	u64 lookups;
+	int lun;
+
+	if (!hba->hpb) {
+		seq_puts(file, "HPB not supported\n");
+		return;
+	}
+
+	for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+		spin_lock_irqsave(hba->host->host_lock, flags);
+		hpb = hba->hpb->lu[lun];
+		if (!hpb) {
+			spin_unlock_irqrestore(hba->host->host_lock, flags);
+			continue;
+		}
+		spin_lock(&hpb->lock);
+		stats = hpb->stats;
+		active = hpb->active_rgns;
+		max_active = hpb->max_active_rgns;
+		pinned = hpb->pinned_rgns;
+		valid = hpb->valid_srgns;
+		map_size = ufshpb_map_size(hpb);
+		spin_unlock(&hpb->lock);
+		spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+		lookups = stats.hit + stats.miss;
+		seq_printf(file, "LU %d:\n", lun);
+		seq_printf(file, "\thit: %llu miss: %llu hit rate: %llu%%\n",
+			   stats.hit, stats.miss,
+			   lookups ? div64_u64(stats.hit * 100, lookups) : 0);
+		seq_printf(file, "\trecommended active: %llu inactive: %llu reset: %llu\n",
+			   stats.rb_active, stats.rb_inactive, stats.rb_reset);
+		seq_printf(file, "\tmap reads: %llu failed: %llu evictions: %llu\n",
+			   stats.map_req, stats.map_fail, stats.evict);
+		seq_printf(file, "\tregions active: %d/%d pinned: %d\n",
+			   active, max_active, pinned);
+		seq_printf(file, "\tsubregions cached: %d (%zu KB)\n",
+			   valid, valid * map_size / 1024);
+	}
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * UFS Host Performance Booster - cache the device L2P map of the
+ * regions the device recommends in host memory and send the physical
+ * page number along with single block reads.
+ */
+
+#ifndef _UFSHPB_H
+#define _UFSHPB_H
+
+#include <linux/seq_file.h>
+#include "ufshcd.h"
+
+/* HPB vendor commands */
+#define UFSHPB_READ			0xF8
+#define UFSHPB_READ_BUFFER		0xF9
+#define UFSHPB_READ_BUFFER_ID		0x01
+
+/* One 8 byte L2P entry for every 4KB logical block */
+#define HPB_ENTRY_SIZE			8
+#define HPB_ENTRY_BLOCK_SIZE		4096
+
+/* bLUEnable value of a LU with HPB enabled */
+#define LU_HPB_ENABLE			0x02
+
+/* HPB recommendation carried in the sense data of a response UPIU */
+#define HPB_RSP_SENSE_DATA_LEN		0x12
+#define HPB_RSP_DESC_TYPE		0x80
+#define HPB_RSP_ADDITIONAL_LEN		0x10
+#define HPB_RSP_MAX_RGNS		2
+
+enum ufshpb_rsp_op {
+	HPB_RSP_NONE			= 0,
+	HPB_RSP_REQ_REGION_UPDATE	= 1,
+	HPB_RSP_DEV_RESET		= 2,
+};
+
+struct ufshpb_active_field {
+	__be16 rgn;
+	__be16 srgn;
+} __packed;
+
+struct ufshpb_rsp_field {
+	__be16 sense_data_len;
+	u8 desc_type;
+	u8 additional_len;
+	u8 hpb_op;
+	u8 lun;
+	u8 active_rgn_cnt;
+	u8 inactive_rgn_cnt;
+	struct ufshpb_active_field active[HPB_RSP_MAX_RGNS];
+	__be16 inactive_rgn[HPB_RSP_MAX_RGNS];
+} __packed;
+
+enum ufshpb_rgn_state {
+	HPB_RGN_INACTIVE,
+	HPB_RGN_ACTIVE,
+	HPB_RGN_PINNED,
+};
+
+enum ufshpb_srgn_state {
+	HPB_SRGN_INVALID,
+	HPB_SRGN_PENDING,
+	HPB_SRGN_ISSUED,
+	HPB_SRGN_VALID,
+};
+
+/**
+ * struct ufshpb_subregion - L2P map of one HPB subregion
+ * @map: HPB entries read from the device, only set while VALID
+ * @dirty: entries written or discarded since @map was read
+ * @list: entry in the LU fetch list while PENDING
+ * @rgn_idx: region this subregion belongs to
+ * @srgn_idx: index of the subregion within its region
+ * @state: one of enum ufshpb_srgn_state
+ * @stale: written to while the map read was in flight
+ */
+struct ufshpb_subregion {
+	void *map;
+	unsigned long *dirty;
+	struct list_head list;
+	u16 rgn_idx;
+	u16 srgn_idx;
+	u8 state;
+	bool stale;
+};
+
+/**
+ * struct ufshpb_region - HPB region
+ * @srgn_tbl: subregions of this region
+ * @lru: entry in the LU LRU list while ACTIVE
+ * @srgn_cnt: number of subregions, the last region may be short
+ * @state: one of enum ufshpb_rgn_state
+ */
+struct ufshpb_region {
+	struct ufshpb_subregion *srgn_tbl;
+	struct list_head lru;
+	u16 srgn_cnt;
+	u8 state;
+};
+
+struct ufshpb_stats {
+	u64 hit;
+	u64 miss;
+	u64 rb_active;
+	u64 rb_inactive;
+	u64 rb_reset;
+	u64 map_req;
+	u64 map_fail;
+	u64 evict;
+};
+
+/**
+ * struct ufshpb_lu - per LU HPB state
+ * @lock: protects the region/subregion tables, the lists and the stats
+ * @rgn_tbl: all regions of the LU
+ * @lru: active, not pinned, regions in least recently used order
+ * @fetch_list: subregions waiting for their map to be read
+ * @map_work: reads the maps of the subregions on @fetch_list
+ * @blk_shift: logical block size to 512 byte sector shift
+ * @rgn_shift: logical blocks per region, log2
+ * @srgn_shift: logical blocks per subregion, log2
+ * @map_order: page order of one subregion map
+ * @max_active_rgns: active region cap, from the device and the memory cap
+ */
+struct ufshpb_lu {
+	struct ufs_hba *hba;
+	struct scsi_device *sdev;
+	int lun;
+
+	spinlock_t lock;
+	struct ufshpb_region *rgn_tbl;
+	int rgn_cnt;
+	struct list_head lru;
+	struct list_head fetch_list;
+	struct work_struct map_work;
+
+	unsigned int blk_shift;
+	unsigned int rgn_shift;
+	unsigned int srgn_shift;
+	unsigned int map_order;
+	int srgns_per_rgn;
+	int max_active_rgns;
+	int active_rgns;
+	int pinned_rgns;
+	int valid_srgns;
+
+	struct ufshpb_stats stats;
+};
+
+/**
+ * struct ufshpb - per host HPB state
+ * @version: wHPBVersion of the device
+ * @rgn_size: bHPBRegionSize, in 512 byte units, log2
+ * @srgn_size: bHPBSubRegionSize, in 512 byte units, log2
+ * @num_lu: bHPBNumberLU
+ * @max_active_rgns: wDeviceMaxActiveHPBRegions
+ * @wq: workqueue for the map reads
+ * @lu: HPB LUs, NULL for LUs without HPB
+ */
+struct ufshpb {
+	u16 version;
+	u8 rgn_size;
+	u8 srgn_size;
+	u8 num_lu;
+	u16 max_active_rgns;
+	struct workqueue_struct *wq;
+	struct ufshpb_lu *lu[UFS_UPIU_MAX_GENERAL_LUN];
+};
+
+#ifdef CONFIG_SCSI_UFS_HPB
+void ufshpb_init(struct ufs_hba *hba);
+void ufshpb_remove(struct ufs_hba *hba);
+void ufshpb_init_lu(struct ufs_hba *hba, struct scsi_device *sdev);
+void ufshpb_destroy_lu(struct ufs_hba *hba, struct scsi_device *sdev);
+void ufshpb_reset(struct ufs_hba *hba);
+void ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp);
+void ufshpb_rsp_upiu(struct ufs_hba *hba, struct ufshcd_lrb *lrbp);
+void ufshpb_stats_show(struct ufs_hba *hba, struct seq_file *file);
+#else
+static inline void ufshpb_init(struct ufs_hba *hba)
+{
+}
+static inline void ufshpb_remove(struct ufs_hba *hba)
+{
+}
+static inline void ufshpb_init_lu(struct ufs_hba *hba,
+				  struct scsi_device *sdev)
+{
+}
+static inline void ufshpb_destroy_lu(struct ufs_hba *hba,
+				     struct scsi_device *sdev)
+{
+}
+static inline void ufshpb_reset(struct ufs_hba *hba)
+{
+}
+static inline void ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
+{
+}
+static inline void ufshpb_rsp_upiu(struct ufs_hba *hba,
+				   struct ufshcd_lrb *lrbp)
+{
+}
+static inline void ufshpb_stats_show(struct ufs_hba *hba,
+				     struct seq_file *file)
+{
+}
+#endif
+
+#endif /* End of Header */
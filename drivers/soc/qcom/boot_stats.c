@@ -135,6 +135,30 @@ phys_addr_t msm_timer_get_pa(void)
 	return mpm_counter_pa;
 }
 
+/**
+ * boot_stats_subsys() - Report the boot time breakdown of a subsystem
+ * @name: subsystem name
+ * @stages: names of the boot stages
+ * @ms: time spent in each stage, in milliseconds
+ * @nr: number of stages
+ *
+ * Called on every boot of the subsystem, so it covers subsystem restart
+ * recovery as well as the first boot.
+ */
+void boot_stats_subsys(const char *name, const char * const *stages,
+		const u64 *ms, int nr)
+{
+	char marker[40];
+	int i;
+
+	for (i = 0; i < nr; i++)
+		pr_info("KPI: %s %s = %llu ms\n", name, stages[i], ms[i]);
+
+	snprintf(marker, sizeof(marker), "M - %s Loaded", name);
+	place_marker(marker);
+}
+EXPORT_SYMBOL(boot_stats_subsys);
+
 int boot_stats_init(void)
 {
 	int ret;
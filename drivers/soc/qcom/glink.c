@@ -14,11 +14,14 @@
 #include <linux/ipc_logging.h>
 #include <linux/kthread.h>
 #include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/spinlock.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/sched.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/workqueue.h>
@@ -39,6 +42,17 @@
 
 #define GLINK_KTHREAD_PRIO 1
 
+/*
+ * Local RX intent pool for channels opened with GLINK_OPT_RX_INTENT_POOL.
+ * Intents larger than GLINK_RX_POOL_MAX_SIZE are left to intent requests
+ * so the pool doesn't pin large buffers.
+ */
+#define GLINK_RX_POOL_MIN_SIZE		64
+#define GLINK_RX_POOL_MAX_SIZE		SZ_16K
+#define GLINK_RX_POOL_INIT_CNT		2
+#define GLINK_RX_POOL_MAX_CNT		16
+#define GLINK_RX_POOL_WINDOW		64
+
 /**
  * struct glink_qos_priority_bin - Packet Scheduler's priority bucket
  * @max_rate_kBps:	Maximum rate supported by the priority bucket.
@@ -232,6 +246,19 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @tx_cnt:				Packets to be picked by tx scheduler.
  * @rt_vote_on:				Number of times RT vote on is called.
  * @rt_vote_off:			Number of times RT vote off is called.
+ * @tx_intent_reqs:			Intents requested from the remote side.
+ * @rx_intent_reqs:			Intents requested by the remote side.
+ *
+ * @low_latency:			Packets bypass interrupt coalescing.
+ * @rx_pool:				Core keeps local RX intents queued.
+ * @rx_pool_work:			Tops up the local RX intent pool.
+ * @rx_pool_size:			Size of the intents queued by the pool.
+ * @rx_pool_target:			Pool intents to keep queued.
+ * @rx_pool_max_seen:			Largest packet in the current window.
+ * @rx_pool_pkts:			Packets received in the current window.
+ * @rx_pool_misses:			Intent requests in the current window.
+ * @rx_pool_queued:			Intents queued by the pool.
+ * @rx_pool_reused:			Pool intents reused on rx_done.
 */
 struct channel_ctx {
 	struct rwref_lock ch_state_lhb2;
@@ -314,6 +341,23 @@ struct channel_ctx {
 
 	uint32_t rt_vote_on;
 	uint32_t rt_vote_off;
+	uint32_t tx_intent_reqs;
+	uint32_t rx_intent_reqs;
+	bool low_latency;
+
+	bool rx_pool;
+	struct work_struct rx_pool_work;
+	size_t rx_pool_size;
+	uint32_t rx_pool_target;
+	size_t rx_pool_max_seen;
+	uint32_t rx_pool_pkts;
+	uint32_t rx_pool_misses;
+	uint32_t rx_pool_queued;
+	uint32_t rx_pool_reused;
+
+	uint32_t lat_seq;
+	uint32_t lat_hist[GLINK_LAT_NR][GLINK_LAT_BUCKETS];
+	uint32_t lat_max_us[GLINK_LAT_NR];
 };
 
 static struct glink_core_if core_impl;
@@ -326,6 +370,11 @@ static unsigned glink_pm_qos;
 module_param_named(pm_qos_enable, glink_pm_qos,
 		   uint, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/* time one in every latency_sample packets of each channel, 0 disables */
+static unsigned glink_lat_sample;
+module_param_named(latency_sample, glink_lat_sample,
+		   uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
 
 static LIST_HEAD(transport_list);
 
@@ -435,6 +484,8 @@ static bool ch_update_local_state(struct channel_ctx *ctx,
 static bool ch_update_rmt_state(struct channel_ctx *ctx, bool rstate);
 static void glink_core_deinit_xprt_qos_cfg(
 			struct glink_core_xprt_ctx *xprt_ptr);
+static void glink_rx_pool_worker(struct work_struct *work);
+static void glink_rx_pool_kick(struct channel_ctx *ctx);
 
 #define glink_prio_to_power_state(xprt_ctx, priority) \
 		((xprt_ctx)->prio_bin[priority].power_state)
@@ -1374,6 +1425,7 @@ struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 	intent->write_offset = 0;
 	intent->pkt_size = 0;
 	intent->bounce_buf = NULL;
+	intent->pool = false;
 
 	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
 	list_add_tail(&intent->list, &ctx->local_rx_intent_list);
@@ -1909,6 +1961,7 @@ static struct channel_ctx *ch_name_to_ch_ctx_create(
 	spin_lock_init(&ctx->tx_pending_rmt_done_lock_lhc4);
 	INIT_LIST_HEAD(&ctx->tx_pending_remote_done);
 	spin_lock_init(&ctx->tx_lists_lock_lhc3);
+	INIT_WORK(&ctx->rx_pool_work, glink_rx_pool_worker);
 
 check_ctx:
 	rwref_write_get(&xprt_ctx->xprt_state_lhb0);
@@ -2689,6 +2742,14 @@ void *glink_open(const struct glink_open_config *cfg)
 	if (!ctx->rx_intent_req_timeout_jiffies)
 		ctx->rx_intent_req_timeout_jiffies = MAX_SCHEDULE_TIMEOUT;
 
+	ctx->low_latency = cfg->options & GLINK_OPT_LOW_LATENCY;
+	ctx->rx_pool = cfg->options & GLINK_OPT_RX_INTENT_POOL;
+	ctx->rx_pool_size = GLINK_RX_POOL_MIN_SIZE;
+	ctx->rx_pool_target = GLINK_RX_POOL_INIT_CNT;
+	ctx->rx_pool_max_seen = 0;
+	ctx->rx_pool_pkts = 0;
+	ctx->rx_pool_misses = 0;
+
 	ctx->local_xprt_req = best_id;
 	ctx->no_migrate = cfg->transport &&
 				!(cfg->options & GLINK_OPT_INITIAL_XPORT);
@@ -3000,6 +3061,7 @@ static int glink_tx_common(void *handle, void *pkt_priv,
 
 		/* request intent of correct size */
 		reinit_completion(&ctx->int_req_ack_complete);
+		ctx->tx_intent_reqs++;
 		ret = ctx->transport_ptr->ops->tx_cmd_rx_intent_req(
 				ctx->transport_ptr->ops, ctx->lcid, size);
 		if (ret) {
@@ -3086,11 +3148,14 @@ static int glink_tx_common(void *handle, void *pkt_priv,
 	tx_info->size = size;
 	tx_info->size_remaining = size;
 	tx_info->tracer_pkt = tx_flags & GLINK_TX_TRACER_PKT ? true : false;
+	tx_info->flush = ctx->low_latency;
 	tx_info->iovec = iovec ? iovec : (void *)tx_info;
 	tx_info->vprovider = vbuf_provider;
 	tx_info->pprovider = pbuf_provider;
 	tx_info->intent_size = intent_size;
 	tx_info->cookie = cookie;
+	if (glink_lat_sample && !(ctx->lat_seq++ % glink_lat_sample))
+		tx_info->lat_queue_ts = arch_counter_get_cntvct();
 
 	/* schedule packet for transmit */
 	if ((tx_flags & GLINK_TX_SINGLE_THREADED) &&
@@ -3135,29 +3200,25 @@ int glink_tx(void *handle, void *pkt_priv, void *data, size_t size,
 EXPORT_SYMBOL(glink_tx);
 
 /**
- * glink_queue_rx_intent() - Register an intent to receive data.
- *
- * @handle:	handle returned by glink_open()
+ * glink_queue_rx_intent_common() - queue a local intent and advertise it
+ * @ctx:	Local channel context, referenced by the caller
  * @pkt_priv:	opaque data type that is returned when a packet is received
- * size:	maximum size of data to receive
+ * @size:	maximum size of data to receive
+ * @pool:	intent is owned by the channel's RX intent pool
  *
  * Return: 0 for success; standard Linux error code for failure case
  */
-int glink_queue_rx_intent(void *handle, const void *pkt_priv, size_t size)
+static int glink_queue_rx_intent_common(struct channel_ctx *ctx,
+					const void *pkt_priv, size_t size,
+					bool pool)
 {
-	struct channel_ctx *ctx = (struct channel_ctx *)handle;
 	struct glink_core_rx_intent *intent_ptr;
 	int ret = 0;
 
-	ret = glink_get_ch_ctx(ctx);
-	if (ret)
-		return ret;
-
 	if (!ch_is_fully_opened(ctx)) {
 		/* Can only queue rx intents if channel is fully opened */
 		GLINK_ERR_CH(ctx, "%s: Channel is not fully opened\n",
 			__func__);
-		glink_put_ch_ctx(ctx);
 		return -EBUSY;
 	}
 
@@ -3166,16 +3227,14 @@ int glink_queue_rx_intent(void *handle, const void *pkt_priv, size_t size)
 		GLINK_ERR_CH(ctx,
 			"%s: Intent pointer allocation failed size[%zu]\n",
 			__func__, size);
-		glink_put_ch_ctx(ctx);
 		return -ENOMEM;
 	}
+	intent_ptr->pool = pool;
 	GLINK_DBG_CH(ctx, "%s: L[%u]:%zu\n", __func__, intent_ptr->id,
 			intent_ptr->intent_size);
 
-	if (ctx->transport_ptr->capabilities & GCAP_INTENTLESS) {
-		glink_put_ch_ctx(ctx);
+	if (ctx->transport_ptr->capabilities & GCAP_INTENTLESS)
 		return ret;
-	}
 
 	/* notify remote side of rx intent */
 	ret = ctx->transport_ptr->ops->tx_cmd_local_rx_intent(
@@ -3183,11 +3242,156 @@ int glink_queue_rx_intent(void *handle, const void *pkt_priv, size_t size)
 	if (ret)
 		/* unable to transmit, dequeue intent */
 		ch_remove_local_rx_intent(ctx, intent_ptr->id);
+	return ret;
+}
+
+/**
+ * glink_queue_rx_intent() - Register an intent to receive data.
+ *
+ * @handle:	handle returned by glink_open()
+ * @pkt_priv:	opaque data type that is returned when a packet is received
+ * size:	maximum size of data to receive
+ *
+ * Return: 0 for success; standard Linux error code for failure case
+ */
+int glink_queue_rx_intent(void *handle, const void *pkt_priv, size_t size)
+{
+	struct channel_ctx *ctx = (struct channel_ctx *)handle;
+	int ret = 0;
+
+	ret = glink_get_ch_ctx(ctx);
+	if (ret)
+		return ret;
+
+	ret = glink_queue_rx_intent_common(ctx, pkt_priv, size, false);
 	glink_put_ch_ctx(ctx);
 	return ret;
 }
 EXPORT_SYMBOL(glink_queue_rx_intent);
 
+/**
+ * glink_rx_pool_count() - count the pool intents still waiting for data
+ * @ctx:	Local channel context
+ *
+ * Return: number of queued pool intents of at least the current pool size
+ */
+static uint32_t glink_rx_pool_count(struct channel_ctx *ctx)
+{
+	struct glink_core_rx_intent *intent;
+	unsigned long flags;
+	uint32_t cnt = 0;
+
+	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	list_for_each_entry(intent, &ctx->local_rx_intent_list, list)
+		if (intent->pool && intent->intent_size >= ctx->rx_pool_size)
+			cnt++;
+	spin_unlock_irqrestore(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	return cnt;
+}
+
+/**
+ * glink_rx_pool_worker() - queue pool intents up to the pool target
+ * @work:	Work item embedded in the channel context
+ *
+ * Runs with a channel reference taken by glink_rx_pool_kick().
+ */
+static void glink_rx_pool_worker(struct work_struct *work)
+{
+	struct channel_ctx *ctx = container_of(work, struct channel_ctx,
+					       rx_pool_work);
+	int i;
+
+	for (i = 0; i < GLINK_RX_POOL_MAX_CNT && ch_is_fully_opened(ctx) &&
+	     glink_rx_pool_count(ctx) < ctx->rx_pool_target; i++) {
+		if (glink_queue_rx_intent_common(ctx, NULL, ctx->rx_pool_size,
+						 true))
+			break;
+		ctx->rx_pool_queued++;
+	}
+	glink_put_ch_ctx(ctx);
+}
+
+/**
+ * glink_rx_pool_kick() - schedule a pool top-up for the channel
+ * @ctx:	Local channel context
+ *
+ * Safe to call from atomic context.
+ */
+static void glink_rx_pool_kick(struct channel_ctx *ctx)
+{
+	if (!ctx->rx_pool ||
+	    (ctx->transport_ptr->capabilities & GCAP_INTENTLESS))
+		return;
+
+	rwref_get(&ctx->ch_state_lhb2);
+	if (!queue_work(system_unbound_wq, &ctx->rx_pool_work))
+		rwref_put(&ctx->ch_state_lhb2);
+}
+
+/**
+ * glink_rx_pool_account() - learn the packet sizes seen by the channel
+ * @ctx:	Local channel context
+ * @intent:	Intent which received the packet
+ *
+ * Every GLINK_RX_POOL_WINDOW packets the pool intent size is set to cover
+ * the largest packet of the window, and the pool shrinks by one intent if
+ * the remote side did not have to request any.
+ */
+static void glink_rx_pool_account(struct channel_ctx *ctx,
+				  struct glink_core_rx_intent *intent)
+{
+	bool kick = intent->pool;
+
+	ctx->rx_pool_max_seen = max(ctx->rx_pool_max_seen, intent->pkt_size);
+	if (++ctx->rx_pool_pkts >= GLINK_RX_POOL_WINDOW) {
+		ctx->rx_pool_size = clamp_t(size_t,
+				roundup_pow_of_two(ctx->rx_pool_max_seen),
+				GLINK_RX_POOL_MIN_SIZE, GLINK_RX_POOL_MAX_SIZE);
+		if (!ctx->rx_pool_misses &&
+		    ctx->rx_pool_target > GLINK_RX_POOL_INIT_CNT)
+			ctx->rx_pool_target--;
+		ctx->rx_pool_max_seen = 0;
+		ctx->rx_pool_pkts = 0;
+		ctx->rx_pool_misses = 0;
+		kick = true;
+	}
+	if (kick)
+		glink_rx_pool_kick(ctx);
+}
+
+/**
+ * glink_rx_pool_miss() - grow the pool after a remote intent request
+ * @ctx:	Local channel context
+ * @size:	Size the remote side asked for
+ */
+static void glink_rx_pool_miss(struct channel_ctx *ctx, size_t size)
+{
+	ctx->rx_pool_misses++;
+	if (ctx->rx_pool_target < GLINK_RX_POOL_MAX_CNT)
+		ctx->rx_pool_target++;
+	if (size > ctx->rx_pool_size && size <= GLINK_RX_POOL_MAX_SIZE)
+		ctx->rx_pool_size = max_t(size_t, roundup_pow_of_two(size),
+					  GLINK_RX_POOL_MIN_SIZE);
+	glink_rx_pool_kick(ctx);
+}
+
+/**
+ * glink_rx_pool_reuse() - decide whether a pool intent goes back in the pool
+ * @ctx:	Local channel context
+ * @intent:	Pool intent returned through glink_rx_done()
+ *
+ * Return: true if the intent still matches the pool size and the pool is
+ *	   below its target
+ */
+static bool glink_rx_pool_reuse(struct channel_ctx *ctx,
+				struct glink_core_rx_intent *intent)
+{
+	if (intent->intent_size < ctx->rx_pool_size ||
+	    intent->intent_size > 2 * ctx->rx_pool_size)
+		return false;
+	return glink_rx_pool_count(ctx) < ctx->rx_pool_target;
+}
+
 /**
  * glink_rx_intent_exists() - Check if an intent exists.
  *
@@ -3256,6 +3460,11 @@ int glink_rx_done(void *handle, const void *ptr, bool reuse)
 	GLINK_INFO_PERF_CH(ctx, "%s: L[%u]: data[%p]. TID %u\n",
 			__func__, liid_ptr->id, ptr, current->pid);
 	id = liid_ptr->id;
+	if (liid_ptr->pool && !reuse && ctx->rx_pool &&
+	    glink_rx_pool_reuse(ctx, liid_ptr)) {
+		reuse = true;
+		ctx->rx_pool_reused++;
+	}
 	if (reuse) {
 		ret = ctx->transport_ptr->ops->reuse_rx_intent(
 					ctx->transport_ptr->ops, liid_ptr);
@@ -4808,6 +5017,7 @@ static bool ch_migrate(struct channel_ctx *l_ctx, struct channel_ctx *r_ctx)
 	mutex_unlock(&l_ctx->transport_ptr->xprt_dbgfs_lock_lhb4);
 
 	memcpy(ctx_clone, l_ctx, sizeof(*ctx_clone));
+	ctx_clone->rx_pool = false;
 	ctx_clone->local_xprt_req = 0;
 	ctx_clone->local_xprt_resp = 0;
 	ctx_clone->remote_xprt_req = 0;
@@ -4980,8 +5190,10 @@ static void glink_core_rx_cmd_ch_remote_open(struct glink_transport_if *if_ptr,
 			__func__, req_xprt, xprt_resp);
 
 	if_ptr->tx_cmd_ch_remote_open_ack(if_ptr, rcid, xprt_resp);
-	if (!do_migrate && ch_is_fully_opened(ctx))
+	if (!do_migrate && ch_is_fully_opened(ctx)) {
 		ctx->notify_state(ctx, ctx->user_priv, GLINK_CONNECTED);
+		glink_rx_pool_kick(ctx);
+	}
 
 
 	if (do_migrate)
@@ -5033,6 +5245,7 @@ static void glink_core_rx_cmd_ch_open_ack(struct glink_transport_if *if_ptr,
 			GLINK_INFO_PERF_CH(ctx,
 					"%s: notify state: GLINK_CONNECTED\n",
 					__func__);
+			glink_rx_pool_kick(ctx);
 		}
 	}
 	rwref_put(&ctx->ch_state_lhb2);
@@ -5209,6 +5422,10 @@ static void glink_core_rx_cmd_remote_rx_intent_req(
 		return;
 	}
 
+	ctx->rx_intent_reqs++;
+	if (ctx->rx_pool)
+		glink_rx_pool_miss(ctx, size);
+
 	cb_ret = ctx->notify_rx_intent_req(ctx, ctx->user_priv, size);
 	if_ptr->tx_cmd_remote_rx_intent_req_ack(if_ptr, ctx->lcid, cb_ret);
 	rwref_put(&ctx->ch_state_lhb2);
@@ -5281,6 +5498,29 @@ static struct glink_core_rx_intent *glink_core_rx_get_pkt_ctx(
 	return intent_ptr;
 }
 
+/**
+ * glink_lat_account() - add a latency sample to a channel histogram
+ * @ctx:	Channel the sample was taken on.
+ * @hop:	Part of the path the sample covers.
+ * @ticks:	Latency in arch timer ticks.
+ *
+ * Bucket 0 holds samples under 1us, bucket n those in [2^(n-1), 2^n) us
+ * and the last one everything above.
+ */
+static void glink_lat_account(struct channel_ctx *ctx, enum glink_lat_hop hop,
+			      uint64_t ticks)
+{
+	uint32_t us = div_u64(ticks * USEC_PER_SEC, arch_timer_get_rate());
+	unsigned int bucket = 0;
+
+	if (us)
+		bucket = min_t(unsigned int, ilog2(us) + 1,
+			       GLINK_LAT_BUCKETS - 1);
+	ctx->lat_hist[hop][bucket]++;
+	if (us > ctx->lat_max_us[hop])
+		ctx->lat_max_us[hop] = us;
+}
+
 /**
  * glink_core_rx_put_pkt_ctx() - lookup RX intent structure
  *
@@ -5296,6 +5536,7 @@ void glink_core_rx_put_pkt_ctx(struct glink_transport_if *if_ptr,
 	uint32_t rcid, struct glink_core_rx_intent *intent_ptr, bool complete)
 {
 	struct channel_ctx *ctx;
+	uint64_t base_ts, now;
 
 	if (!complete) {
 		GLINK_DBG_XPRT(if_ptr->glink_core_priv,
@@ -5318,6 +5559,11 @@ void glink_core_rx_put_pkt_ctx(struct glink_transport_if *if_ptr,
 
 	if (unlikely(intent_ptr->tracer_pkt)) {
 		tracer_pkt_log_event(intent_ptr->data, GLINK_CORE_RX);
+		base_ts = tracer_pkt_get_base_ts(intent_ptr->data);
+		now = arch_counter_get_cntvct();
+		if (base_ts && now > base_ts)
+			glink_lat_account(ctx, GLINK_LAT_TRACER_RX,
+					  now - base_ts);
 		ch_set_local_rx_intent_notified(ctx, intent_ptr);
 		if (ctx->notify_rx_tracer_pkt)
 			ctx->notify_rx_tracer_pkt(ctx, ctx->user_priv,
@@ -5347,6 +5593,9 @@ void glink_core_rx_put_pkt_ctx(struct glink_transport_if *if_ptr,
 		}
 	}
 
+	if (ctx->rx_pool)
+		glink_rx_pool_account(ctx, intent_ptr);
+
 	ch_set_local_rx_intent_notified(ctx, intent_ptr);
 	if (ctx->notify_rx && (intent_ptr->data || intent_ptr->bounce_buf)) {
 		ctx->notify_rx(ctx, ctx->user_priv, intent_ptr->pkt_priv,
@@ -5408,6 +5657,14 @@ void glink_core_rx_cmd_tx_done(struct glink_transport_if *if_ptr,
 		return;
 	}
 
+	if (tx_pkt->lat_queue_ts && tx_pkt->lat_xprt_ts) {
+		glink_lat_account(ctx, GLINK_LAT_LOCAL,
+				  tx_pkt->lat_xprt_ts - tx_pkt->lat_queue_ts);
+		glink_lat_account(ctx, GLINK_LAT_REMOTE,
+				  arch_counter_get_cntvct() -
+				  tx_pkt->lat_xprt_ts);
+	}
+
 	/* notify client */
 	ctx->notify_tx_done(ctx, ctx->user_priv, tx_pkt->pkt_priv,
 			    tx_pkt->data ? tx_pkt->data : tx_pkt->iovec);
@@ -5478,6 +5735,8 @@ static int xprt_single_threaded_tx(struct glink_core_xprt_ctx *xprt_ptr,
 	unsigned long flags;
 
 	spin_lock_irqsave(&ch_ptr->tx_pending_rmt_done_lock_lhc4, flags);
+	if (tx_info->lat_queue_ts)
+		tx_info->lat_xprt_ts = arch_counter_get_cntvct();
 	do {
 		ret = xprt_ptr->ops->tx(ch_ptr->transport_ptr->ops,
 					ch_ptr->lcid, tx_info);
@@ -5575,6 +5834,10 @@ static int glink_scheduler_tx(struct channel_ctx *ctx,
 		spin_unlock(&ctx->tx_pending_rmt_done_lock_lhc4);
 		spin_unlock_irqrestore(&ctx->tx_lists_lock_lhc3, flags);
 
+		/* the remote cannot be done with it before the last write */
+		if (tx_info->lat_queue_ts)
+			tx_info->lat_xprt_ts = arch_counter_get_cntvct();
+
 		if (unlikely(tx_info->tracer_pkt)) {
 			tracer_pkt_log_event((void *)(tx_info->data),
 					      GLINK_SCHEDULER_TX);
@@ -6240,6 +6503,70 @@ int glink_get_ch_lintents_queued(struct channel_ctx *ch_ctx)
 }
 EXPORT_SYMBOL(glink_get_ch_lintents_queued);
 
+/**
+ * glink_get_ch_intent_req_count() - get the number of intent requests
+ * @ch_ctx:	pointer to the channel context.
+ * @remote:	count the requests made by the remote side instead of the
+ *		local side
+ *
+ * Each request costs the sender a round trip to the receiver before the
+ * packet can be sent.
+ *
+ * Return: number of intent requests, -EINVAL in case of invalid input
+ */
+int glink_get_ch_intent_req_count(struct channel_ctx *ch_ctx, bool remote)
+{
+	if (ch_ctx == NULL)
+		return -EINVAL;
+
+	return remote ? ch_ctx->rx_intent_reqs : ch_ctx->tx_intent_reqs;
+}
+EXPORT_SYMBOL(glink_get_ch_intent_req_count);
+
+/**
+ * glink_get_ch_rx_pool_info() - get the local RX intent pool state
+ * @ch_ctx:	pointer to the channel context.
+ * @size:	size of the intents queued by the pool
+ * @target:	number of pool intents kept queued
+ * @reused:	number of pool intents reused on rx_done
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input or if the
+ *	   channel has no pool
+ */
+int glink_get_ch_rx_pool_info(struct channel_ctx *ch_ctx, size_t *size,
+			      uint32_t *target, uint32_t *reused)
+{
+	if (ch_ctx == NULL || !ch_ctx->rx_pool)
+		return -EINVAL;
+
+	*size = ch_ctx->rx_pool_size;
+	*target = ch_ctx->rx_pool_target;
+	*reused = ch_ctx->rx_pool_reused;
+	return 0;
+}
+EXPORT_SYMBOL(glink_get_ch_rx_pool_info);
+
+/**
+ * glink_get_ch_latency() - get the sampled latency of one hop of a channel
+ * @ch_ctx:	pointer to the channel context.
+ * @hop:	which part of the path, one of enum glink_lat_hop
+ * @hist:	GLINK_LAT_BUCKETS counts of log2 microsecond buckets
+ * @max_us:	largest latency seen, in microseconds
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input
+ */
+int glink_get_ch_latency(struct channel_ctx *ch_ctx, unsigned int hop,
+			 uint32_t *hist, uint32_t *max_us)
+{
+	if (ch_ctx == NULL || hop >= GLINK_LAT_NR)
+		return -EINVAL;
+
+	memcpy(hist, ch_ctx->lat_hist[hop], sizeof(ch_ctx->lat_hist[hop]));
+	*max_us = ch_ctx->lat_max_us[hop];
+	return 0;
+}
+EXPORT_SYMBOL(glink_get_ch_latency);
+
 /**
  * glink_get_ch_rintents_queued() - get the total number of intents queued
  *				from remote side
@@ -69,6 +69,7 @@ struct glink_core_version {
  * pkt_priv:	G-Link core owned packet-private data
  * list:	G-Link core owned list node
  * bounce_buf:	Pointer to the temporary/internal bounce buffer
+ * pool:	Intent was queued by the channel's RX intent pool
  */
 struct glink_core_rx_intent {
 	void *data;
@@ -86,6 +87,7 @@ struct glink_core_rx_intent {
 	struct list_head list;
 	const void *pkt_priv;
 	void *bounce_buf;
+	bool pool;
 };
 
 /**
@@ -298,8 +298,82 @@ static void glink_dfs_update_ch_intent(struct seq_file *s)
  */
 static void glink_dfs_update_ch_stats(struct seq_file *s)
 {
-	/* FUTURE:  add channel statistics */
-	seq_puts(s, "not yet implemented\n");
+	struct glink_dbgfs_data *dfs_d;
+	struct channel_ctx *ch_ctx;
+	size_t pool_size;
+	uint32_t pool_target, pool_reused;
+
+	dfs_d = s->private;
+	ch_ctx = dfs_d->priv_data;
+	if (ch_ctx == NULL)
+		return;
+
+	seq_printf(s, "%-24s %d\n", "tx intent requests",
+			glink_get_ch_intent_req_count(ch_ctx, false));
+	seq_printf(s, "%-24s %d\n", "rx intent requests",
+			glink_get_ch_intent_req_count(ch_ctx, true));
+	if (glink_get_ch_rx_pool_info(ch_ctx, &pool_size, &pool_target,
+				      &pool_reused))
+		return;
+	seq_printf(s, "%-24s %zu\n", "rx pool intent size", pool_size);
+	seq_printf(s, "%-24s %u\n", "rx pool target", pool_target);
+	seq_printf(s, "%-24s %u\n", "rx pool reused", pool_reused);
+}
+
+/**
+ * glink_dfs_update_ch_latency() - writes the sampled latency histograms of
+ *				   a specific channel to its debugfs file
+ * @s:		pointer to the sequential file
+ *
+ * One column per hop, one row per log2 microsecond bucket. Nothing is
+ * sampled on tx unless the glink latency_sample parameter is set.
+ */
+static void glink_dfs_update_ch_latency(struct seq_file *s)
+{
+	static const char * const hop_names[GLINK_LAT_NR] = {
+		[GLINK_LAT_LOCAL] = "local",
+		[GLINK_LAT_REMOTE] = "remote",
+		[GLINK_LAT_TRACER_RX] = "tracer_rx",
+	};
+	uint32_t hist[GLINK_LAT_NR][GLINK_LAT_BUCKETS];
+	uint32_t max_us[GLINK_LAT_NR];
+	struct glink_dbgfs_data *dfs_d;
+	struct channel_ctx *ch_ctx;
+	char range[16];
+	int hop, i;
+
+	dfs_d = s->private;
+	ch_ctx = dfs_d->priv_data;
+	if (ch_ctx == NULL)
+		return;
+
+	for (hop = 0; hop < GLINK_LAT_NR; hop++)
+		if (glink_get_ch_latency(ch_ctx, hop, hist[hop], &max_us[hop]))
+			return;
+
+	seq_printf(s, "%-12s", "us");
+	for (hop = 0; hop < GLINK_LAT_NR; hop++)
+		seq_printf(s, " %10s", hop_names[hop]);
+	seq_putc(s, '\n');
+
+	for (i = 0; i < GLINK_LAT_BUCKETS; i++) {
+		if (!i)
+			snprintf(range, sizeof(range), "<1");
+		else if (i == GLINK_LAT_BUCKETS - 1)
+			snprintf(range, sizeof(range), ">=%u", 1U << (i - 1));
+		else
+			snprintf(range, sizeof(range), "%u-%u", 1U << (i - 1),
+				 1U << i);
+		seq_printf(s, "%-12s", range);
+		for (hop = 0; hop < GLINK_LAT_NR; hop++)
+			seq_printf(s, " %10u", hist[hop][i]);
+		seq_putc(s, '\n');
+	}
+
+	seq_printf(s, "%-12s", "max");
+	for (hop = 0; hop < GLINK_LAT_NR; hop++)
+		seq_printf(s, " %10u", max_us[hop]);
+	seq_putc(s, '\n');
 }
 
 /**
@@ -380,6 +454,8 @@ void glink_debugfs_add_channel(struct channel_ctx *ch_ctx,
 				&ch_dbgfs, (void *)ch_ctx, false);
 	glink_debugfs_create("intents", glink_dfs_update_ch_intent,
 			&ch_dbgfs, (void *)ch_ctx, false);
+	glink_debugfs_create("latency", glink_dfs_update_ch_latency,
+			&ch_dbgfs, (void *)ch_ctx, false);
 }
 EXPORT_SYMBOL(glink_debugfs_add_channel);
 
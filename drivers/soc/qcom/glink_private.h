@@ -94,6 +94,16 @@ struct glink_ch_intent_info {
 	struct list_head *ri_list;
 };
 
+/* Parts of the path timed by the latency sampling, see latency_sample */
+enum glink_lat_hop {
+	GLINK_LAT_LOCAL,	/* glink_tx() to the last write to the xprt */
+	GLINK_LAT_REMOTE,	/* last write to the remote's tx_done */
+	GLINK_LAT_TRACER_RX,	/* tracer packet init on remote to core rx */
+	GLINK_LAT_NR,
+};
+
+#define GLINK_LAT_BUCKETS	16
+
 /* Tracer Packet Event IDs for G-Link */
 enum glink_tracer_pkt_events {
 	GLINK_CORE_TX = 1,
@@ -664,6 +674,41 @@ int glink_get_ch_lintents_queued(struct channel_ctx *ch_ctx);
  */
 int glink_get_ch_rintents_queued(struct channel_ctx *ch_ctx);
 
+/**
+ * glink_get_ch_intent_req_count() - get the number of intent requests
+ * @ch_ctx:	pointer to the channel context.
+ * @remote:	count the requests made by the remote side instead of the
+ *		local side
+ *
+ * Return: number of intent requests, -EINVAL in case of invalid input
+ */
+int glink_get_ch_intent_req_count(struct channel_ctx *ch_ctx, bool remote);
+
+/**
+ * glink_get_ch_rx_pool_info() - get the local RX intent pool state
+ * @ch_ctx:	pointer to the channel context.
+ * @size:	size of the intents queued by the pool
+ * @target:	number of pool intents kept queued
+ * @reused:	number of pool intents reused on rx_done
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input or if the
+ *	   channel has no pool
+ */
+int glink_get_ch_rx_pool_info(struct channel_ctx *ch_ctx, size_t *size,
+			      uint32_t *target, uint32_t *reused);
+
+/**
+ * glink_get_ch_latency() - get the sampled latency of one hop of a channel
+ * @ch_ctx:	pointer to the channel context.
+ * @hop:	which part of the path, one of enum glink_lat_hop
+ * @hist:	GLINK_LAT_BUCKETS counts of log2 microsecond buckets
+ * @max_us:	largest latency seen, in microseconds
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input
+ */
+int glink_get_ch_latency(struct channel_ctx *ch_ctx, unsigned int hop,
+			 uint32_t *hist, uint32_t *max_us);
+
 /**
  * glink_get_ch_intent_info() - get the intent details of a channel
  * @ch_ctx:	pointer to the channel context.
@@ -13,6 +13,7 @@
 #include <linux/err.h>
 #include <linux/fs.h>
 #include <linux/gfp.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/ipc_logging.h>
@@ -149,6 +150,11 @@ struct mailbox_config_info {
  *				correct irq.
  * @irq_line:			The incoming interrupt line.
  * @tx_irq_count:		Number of interrupts triggered.
+ * @irq_coalesce:		Small writes may share one outgoing interrupt.
+ * @irq_pending:		An outgoing interrupt is held back by
+ *				@irq_coalesce_timer.  Protected by @write_lock.
+ * @irq_coalesce_timer:		Raises the held back outgoing interrupt.
+ * @irq_coalesced:		Number of writes signalled by a shared interrupt.
  * @rx_irq_count:		Number of interrupts received.
  * @tx_ch_desc:			Reference to the channel description structure
  *				for tx in SMEM for this edge.
@@ -199,6 +205,10 @@ struct edge_info {
 	uint32_t out_irq_mask;
 	uint32_t irq_line;
 	uint32_t tx_irq_count;
+	bool irq_coalesce;
+	bool irq_pending;
+	struct hrtimer irq_coalesce_timer;
+	uint32_t irq_coalesced;
 	uint32_t rx_irq_count;
 	struct channel_desc *tx_ch_desc;
 	struct channel_desc *rx_ch_desc;
@@ -253,6 +263,19 @@ static uint32_t negotiate_features_v1(struct glink_transport_if *if_ptr,
 static void register_debugfs_info(struct edge_info *einfo);
 
 static struct edge_info *edge_infos[NUM_SMEM_SUBSYSTEMS];
+
+/*
+ * Outgoing interrupt coalescing: writes of at most irq_coalesce_bytes are
+ * signalled to the remote side up to irq_coalesce_us after the first of
+ * them, with a single interrupt.  0 disables coalescing.
+ */
+static unsigned int irq_coalesce_us;
+module_param(irq_coalesce_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_coalesce_us, "Max delay of a coalesced tx interrupt");
+
+static unsigned int irq_coalesce_bytes = 256;
+module_param(irq_coalesce_bytes, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_coalesce_bytes, "Largest write that may be coalesced");
 static DEFINE_MUTEX(probe_lock);
 static struct glink_core_version versions[] = {
 	{1, TRACER_PKT_FEATURE, negotiate_features_v1},
@@ -274,6 +297,42 @@ static void send_irq(struct edge_info *einfo)
 	einfo->tx_irq_count++;
 }
 
+/**
+ * irq_coalesce_expire() - raise an outgoing interrupt held back by coalescing
+ * @timer:	The edge's irq_coalesce_timer.
+ *
+ * Return: HRTIMER_NORESTART
+ */
+static enum hrtimer_restart irq_coalesce_expire(struct hrtimer *timer)
+{
+	struct edge_info *einfo = container_of(timer, struct edge_info,
+					       irq_coalesce_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&einfo->write_lock, flags);
+	if (einfo->irq_pending) {
+		einfo->irq_pending = false;
+		send_irq(einfo);
+	}
+	spin_unlock_irqrestore(&einfo->write_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * init_irq_coalesce() - set up outgoing interrupt coalescing for an edge
+ * @einfo:	The edge to set up.
+ * @enable:	Allow coalescing on this edge.
+ */
+static void init_irq_coalesce(struct edge_info *einfo, bool enable)
+{
+	einfo->irq_coalesce = enable;
+	einfo->irq_pending = false;
+	hrtimer_init(&einfo->irq_coalesce_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	einfo->irq_coalesce_timer.function = irq_coalesce_expire;
+}
+
 /**
  * read_from_fifo() - memcpy from fifo memory
  * @dest:	Destination address.
@@ -524,6 +583,40 @@ static uint32_t fifo_write_body(struct edge_info *einfo, const void *_data,
 	return len;
 }
 
+/**
+ * signal_write() - signal the remote side that data was written
+ * @einfo:	The edge the data was written to.
+ * @len:	Number of bytes written.
+ * @flush:	Signal the remote side without coalescing.
+ *
+ * When coalescing is enabled, small writes hold the interrupt back for up
+ * to irq_coalesce_us, and every write made meanwhile shares it.  Large
+ * writes, flushes and a fifo more than half full raise the interrupt right
+ * away, including any held back one.  Must be called with write_lock held.
+ */
+static void signal_write(struct edge_info *einfo, int len, bool flush)
+{
+	if (!einfo->irq_coalesce || !irq_coalesce_us || flush ||
+	    len > irq_coalesce_bytes ||
+	    fifo_write_avail(einfo) < einfo->tx_fifo_size / 2) {
+		if (einfo->irq_pending) {
+			einfo->irq_pending = false;
+			hrtimer_try_to_cancel(&einfo->irq_coalesce_timer);
+		}
+		send_irq(einfo);
+		return;
+	}
+
+	if (einfo->irq_pending) {
+		einfo->irq_coalesced++;
+		return;
+	}
+	einfo->irq_pending = true;
+	hrtimer_start(&einfo->irq_coalesce_timer,
+		      ns_to_ktime((u64)irq_coalesce_us * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+}
+
 /**
  * fifo_write() - Write data into an edge
  * @einfo:	The concerned edge to write to.
@@ -537,7 +630,8 @@ static uint32_t fifo_write_body(struct edge_info *einfo, const void *_data,
  *
  * Return: Number of bytes written to the edge.
  */
-static int fifo_write(struct edge_info *einfo, const void *data, int len)
+static int fifo_write(struct edge_info *einfo, const void *data, int len,
+		      bool flush)
 {
 	int orig_len = len;
 	uint32_t write_index = einfo->tx_ch_desc->write_index;
@@ -550,7 +644,7 @@ static int fifo_write(struct edge_info *einfo, const void *data, int len)
 	 */
 	wmb();
 	einfo->tx_ch_desc->write_index = write_index;
-	send_irq(einfo);
+	signal_write(einfo, orig_len, flush);
 
 	return orig_len - len;
 }
@@ -564,6 +658,7 @@ static int fifo_write(struct edge_info *einfo, const void *data, int len)
  * @len2:	The length of the second buffer in bytes.
  * @data3:	The thirs buffer of data to write.
  * @len3:	The length of the third buffer in bytes.
+ * @flush:	Signal the remote side without coalescing.
  *
  * A variant of fifo_write() which optimizes the usecase found in tx().  The
  * remote side expects all or none of the transmitted data to be available.
@@ -576,7 +671,7 @@ static int fifo_write(struct edge_info *einfo, const void *data, int len)
 static int fifo_write_complex(struct edge_info *einfo,
 			      const void *data1, int len1,
 			      const void *data2, int len2,
-			      const void *data3, int len3)
+			      const void *data3, int len3, bool flush)
 {
 	int orig_len = len1 + len2 + len3;
 	uint32_t write_index = einfo->tx_ch_desc->write_index;
@@ -591,7 +686,7 @@ static int fifo_write_complex(struct edge_info *einfo,
 	 */
 	wmb();
 	einfo->tx_ch_desc->write_index = write_index;
-	send_irq(einfo);
+	signal_write(einfo, orig_len, flush);
 
 	return orig_len - len1 - len2 - len3;
 }
@@ -623,7 +718,8 @@ static void send_tx_blocked_signal(struct edge_info *einfo)
 
 	if (!einfo->tx_blocked_signal_sent) {
 		einfo->tx_blocked_signal_sent = true;
-		fifo_write(einfo, &read_notif_req, sizeof(read_notif_req));
+		fifo_write(einfo, &read_notif_req, sizeof(read_notif_req),
+			   true);
 	}
 }
 
@@ -632,6 +728,7 @@ static void send_tx_blocked_signal(struct edge_info *einfo)
  * @einfo:	The concerned edge to transmit on.
  * @data:	Buffer of data to transmit.
  * @len:	Length of data to transmit in bytes.
+ * @flush:	Signal the remote side without interrupt coalescing.
  *
  * This helper function is the preferred interface to fifo_write() and should
  * be used in the normal case for transmitting entities.  fifo_tx() will block
@@ -641,7 +738,8 @@ static void send_tx_blocked_signal(struct edge_info *einfo)
  *
  * Return: Number of bytes transmitted.
  */
-static int fifo_tx(struct edge_info *einfo, const void *data, int len)
+static int fifo_tx(struct edge_info *einfo, const void *data, int len,
+		   bool flush)
 {
 	unsigned long flags;
 	int ret;
@@ -663,7 +761,7 @@ static int fifo_tx(struct edge_info *einfo, const void *data, int len)
 			return -EFAULT;
 		}
 	}
-	ret = fifo_write(einfo, data, len);
+	ret = fifo_write(einfo, data, len, flush);
 	spin_unlock_irqrestore(&einfo->write_lock, flags);
 
 	return ret;
@@ -1258,7 +1356,7 @@ static void tx_cmd_version(struct glink_transport_if *if_ptr, uint32_t version,
 	cmd.version = version;
 	cmd.features = features;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 }
 
@@ -1293,7 +1391,7 @@ static void tx_cmd_version_ack(struct glink_transport_if *if_ptr,
 	cmd.version = version;
 	cmd.features = features;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 }
 
@@ -1377,7 +1475,7 @@ static int tx_cmd_ch_open(struct glink_transport_if *if_ptr, uint32_t lcid,
 	memcpy(buf, &cmd, sizeof(cmd));
 	memcpy(buf + sizeof(cmd), name, cmd.length);
 
-	fifo_tx(einfo, buf, buf_size);
+	fifo_tx(einfo, buf, buf_size, false);
 
 	kfree(buf);
 
@@ -1415,7 +1513,7 @@ static int tx_cmd_ch_close(struct glink_transport_if *if_ptr, uint32_t lcid)
 	cmd.lcid = lcid;
 	cmd.reserved = 0;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return 0;
@@ -1452,7 +1550,7 @@ static void tx_cmd_ch_remote_open_ack(struct glink_transport_if *if_ptr,
 	cmd.rcid = rcid;
 	cmd.reserved = 0;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 }
 
@@ -1486,7 +1584,7 @@ static void tx_cmd_ch_remote_close_ack(struct glink_transport_if *if_ptr,
 	cmd.rcid = rcid;
 	cmd.reserved = 0;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 }
 
@@ -1527,6 +1625,8 @@ static int ssr(struct glink_transport_if *if_ptr)
 	wake_up_all(&einfo->tx_blocked_queue);
 
 	synchronize_srcu(&einfo->use_ref);
+	hrtimer_cancel(&einfo->irq_coalesce_timer);
+	einfo->irq_pending = false;
 
 	while (!list_empty(&einfo->deferred_cmds)) {
 		cmd = list_first_entry(&einfo->deferred_cmds,
@@ -1664,7 +1764,7 @@ static int tx_cmd_local_rx_intent(struct glink_transport_if *if_ptr,
 	cmd.size = size;
 	cmd.liid = liid;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return 0;
@@ -1704,7 +1804,7 @@ static void tx_cmd_local_rx_done(struct glink_transport_if *if_ptr,
 	cmd.lcid = lcid;
 	cmd.liid = liid;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 }
 
@@ -1749,7 +1849,7 @@ static int tx_cmd_rx_intent_req(struct glink_transport_if *if_ptr,
 	cmd.lcid = lcid;
 	cmd.size = size;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), true);
 
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return 0;
@@ -1794,7 +1894,7 @@ static int tx_cmd_remote_rx_intent_req_ack(struct glink_transport_if *if_ptr,
 	else
 		cmd.response = 0;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), true);
 
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return 0;
@@ -1832,7 +1932,7 @@ static int tx_cmd_set_sigs(struct glink_transport_if *if_ptr, uint32_t lcid,
 	cmd.lcid = lcid;
 	cmd.sigs = sigs;
 
-	fifo_tx(einfo, &cmd, sizeof(cmd));
+	fifo_tx(einfo, &cmd, sizeof(cmd), false);
 
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return 0;
@@ -2021,7 +2121,7 @@ static int tx_data(struct glink_transport_if *if_ptr, uint16_t cmd_id,
 		tracer_pkt_log_event((void *)(pctx->data), GLINK_XPRT_TX);
 
 	fifo_write_complex(einfo, &cmd, sizeof(cmd), data_start, size, zeros,
-								zeros_size);
+						zeros_size, pctx->flush);
 	GLINK_DBG("%s %s: lcid[%u] riid[%u] cmd[%d], size[%d], size_left[%d]\n",
 		"<SMEM>", __func__, cmd.lcid, cmd.riid, cmd.id, cmd.size,
 		cmd.size_left);
@@ -2395,6 +2495,7 @@ static int glink_smem_native_probe(struct platform_device *pdev)
 	init_xprt_if(einfo);
 	spin_lock_init(&einfo->write_lock);
 	init_waitqueue_head(&einfo->tx_blocked_queue);
+	init_irq_coalesce(einfo, true);
 	init_kthread_work(&einfo->kwork, rx_worker);
 	init_kthread_worker(&einfo->kworker);
 	einfo->read_from_fifo = read_from_fifo;
@@ -2597,6 +2698,7 @@ static int glink_rpm_native_probe(struct platform_device *pdev)
 	init_xprt_if(einfo);
 	spin_lock_init(&einfo->write_lock);
 	init_waitqueue_head(&einfo->tx_blocked_queue);
+	init_irq_coalesce(einfo, false);
 	init_kthread_work(&einfo->kwork, rx_worker);
 	init_kthread_worker(&einfo->kworker);
 	einfo->intentless = true;
@@ -2886,6 +2988,7 @@ static int glink_mailbox_probe(struct platform_device *pdev)
 	init_xprt_if(einfo);
 	spin_lock_init(&einfo->write_lock);
 	init_waitqueue_head(&einfo->tx_blocked_queue);
+	init_irq_coalesce(einfo, false);
 	init_kthread_work(&einfo->kwork, rx_worker);
 	init_kthread_worker(&einfo->kworker);
 	einfo->read_from_fifo = read_from_fifo;
@@ -3083,11 +3186,13 @@ ID|EDGE      |TX READ   |TX WRITE  |TX SIZE   |RX READ   |RX WRITE  |RX SIZE
 						einfo->rx_fifo_size);
 
 	seq_puts(s, "\nInterrupt information:\n");
-	seq_printf(s, "%-10s|%-10s|%-10s\n", "EDGE", "TX INT", "RX INT");
-	seq_puts(s, "--------------------------------\n");
-	seq_printf(s, "%-10s|0x%08X|0x%08X\n", einfo->xprt_cfg.edge,
+	seq_printf(s, "%-10s|%-10s|%-10s|%-10s\n", "EDGE", "TX INT", "RX INT",
+								"COALESCED");
+	seq_puts(s, "-------------------------------------------\n");
+	seq_printf(s, "%-10s|0x%08X|0x%08X|0x%08X\n", einfo->xprt_cfg.edge,
 						einfo->tx_irq_count,
-						einfo->rx_irq_count);
+						einfo->rx_irq_count,
+						einfo->irq_coalesced);
 }
 
 /**
@@ -54,6 +54,7 @@ enum xprt_ids {
  * @size_remaining:	Remaining size of the data in the packet.
  * @intent_size:	Receive intent size queued by the remote side.
  * @tracer_pkt:		Flag to indicate if the packet is a tracer packet.
+ * @flush:		Signal the remote side without interrupt coalescing.
  * @iovec:		Pointer to the vector buffer packet.
  * @vprovider:		Packet-specific virtual buffer provider function.
  * @pprovider:		Packet-specific physical buffer provider function.
@@ -72,11 +73,14 @@ struct glink_core_tx_pkt {
 	uint32_t size_remaining;
 	size_t intent_size;
 	bool tracer_pkt;
+	bool flush;
 	void *iovec;
 	void * (*vprovider)(void *iovec, size_t offset, size_t *size);
 	void * (*pprovider)(void *iovec, size_t offset, size_t *size);
 	void *cookie;
 	struct rwref_lock pkt_ref;
+	uint64_t lat_queue_ts;
+	uint64_t lat_xprt_ts;
 };
 
 /**
@@ -608,6 +608,11 @@ long hab_vchan_send(struct uhab_context *ctx,
 
 		schedule();
 	}
+
+	if (!ret) {
+		vchan->tx_msgs++;
+		vchan->tx_bytes += sizebytes;
+	}
 err:
 	if (vchan)
 		hab_vchan_put(vchan);
@@ -648,6 +653,9 @@ int hab_vchan_recv(struct uhab_context *ctx,
 			ret = -ENODEV;
 		else if (ret == -ERESTARTSYS)
 			ret = -EINTR;
+	} else if (!ret) {
+		vchan->rx_msgs++;
+		vchan->rx_bytes += (*message)->sizebytes;
 	}
 
 	hab_vchan_put(vchan);
@@ -63,6 +63,7 @@ enum hab_payload_type {
 	HAB_PAYLOAD_TYPE_SCHE_MSG_ACK,
 	HAB_PAYLOAD_TYPE_SCHE_RESULT_REQ,
 	HAB_PAYLOAD_TYPE_SCHE_RESULT_RSP,
+	HAB_PAYLOAD_TYPE_POOL_DESC,
 	HAB_PAYLOAD_TYPE_MAX,
 };
 #define LOOPBACK_DOM 0xFF
@@ -391,6 +392,17 @@ struct virtual_channel {
 	 */
 	int closed;
 	int forked; /* if fork is detected and assume only once */
+
+	/* throughput stats, pool bytes are referenced rather than copied */
+	unsigned long stat_start; /* jiffies */
+	uint64_t tx_msgs;
+	uint64_t tx_bytes;
+	uint64_t rx_msgs;
+	uint64_t rx_bytes;
+	uint64_t pool_tx_descs;
+	uint64_t pool_tx_bytes;
+	uint64_t pool_rx_descs;
+	uint64_t pool_rx_bytes;
 };
 
 /*
@@ -450,6 +462,12 @@ int hab_mem_unexport(struct uhab_context *ctx,
 		struct hab_unexport *param, int kernel);
 int hab_mem_unimport(struct uhab_context *ctx,
 		struct hab_unimport *param, int kernel);
+int hab_mem_pool_send(struct uhab_context *ctx, int32_t vcid,
+		struct habmm_pool_desc *descs, uint32_t count,
+		unsigned int flags);
+int hab_mem_pool_recv(struct uhab_context *ctx, int32_t vcid,
+		struct habmm_pool_desc *descs, uint32_t *count,
+		void **bufs, unsigned int flags);
 
 void habmem_remove_export(struct export_desc *exp);
 
@@ -597,6 +615,7 @@ int hab_stat_deinit(struct hab_driver *drv);
 int hab_stat_show_vchan(struct hab_driver *drv, char *buf, int sz);
 int hab_stat_show_ctx(struct hab_driver *drv, char *buf, int sz);
 int hab_stat_show_expimp(struct hab_driver *drv, int pid, char *buf, int sz);
+int hab_stat_show_tput(struct hab_driver *drv, char *buf, int sz);
 
 int hab_stat_init_sub(struct hab_driver *drv);
 int hab_stat_deinit_sub(struct hab_driver *drv);
@@ -466,3 +466,190 @@ int hab_mem_unimport(struct uhab_context *ctx,
 
 	return ret;
 }
+
+/*
+ * Buffer pools: an exported buffer stays granted to the remote side and
+ * only descriptors naming a range of it are sent through the pipe, so
+ * the payload is neither copied nor remapped per frame. One message
+ * carries up to HABMM_POOL_BATCH_MAX descriptors and rings the remote
+ * doorbell once.
+ */
+static int hab_pool_check_range(struct export_desc *exp,
+		struct habmm_pool_desc *desc)
+{
+	uint64_t size = (uint64_t)exp->payload_count << PAGE_SHIFT;
+
+	if (!desc->size || desc->offset >= size ||
+		desc->size > size - desc->offset)
+		return -ERANGE;
+
+	return 0;
+}
+
+static int hab_pool_find_export(struct uhab_context *ctx,
+		struct virtual_channel *vchan, struct habmm_pool_desc *desc)
+{
+	struct export_desc *exp = NULL;
+	int ret = -EINVAL;
+
+	read_lock(&ctx->exp_lock);
+	list_for_each_entry(exp, &ctx->exp_whse, node) {
+		if (exp->export_id == desc->export_id &&
+			exp->pchan == vchan->pchan &&
+			exp->vcid_local == vchan->id) {
+			ret = hab_pool_check_range(exp, desc);
+			break;
+		}
+	}
+	read_unlock(&ctx->exp_lock);
+
+	return ret;
+}
+
+static int hab_pool_find_import(struct uhab_context *ctx,
+		struct virtual_channel *vchan, struct habmm_pool_desc *desc,
+		void **buf)
+{
+	struct export_desc *exp = NULL;
+	int ret = -EINVAL;
+
+	spin_lock_bh(&ctx->imp_lock);
+	list_for_each_entry(exp, &ctx->imp_whse, node) {
+		if (exp->export_id == desc->export_id &&
+			exp->pchan == vchan->pchan &&
+			exp->vcid_local == vchan->id) {
+			if (!exp->kva) {
+				ret = -ENOENT; /* not imported yet */
+				break;
+			}
+			ret = hab_pool_check_range(exp, desc);
+			if (!ret && buf)
+				*buf = (char *)exp->kva + desc->offset;
+			break;
+		}
+	}
+	spin_unlock_bh(&ctx->imp_lock);
+
+	return ret;
+}
+
+int hab_mem_pool_send(struct uhab_context *ctx, int32_t vcid,
+		struct habmm_pool_desc *descs, uint32_t count,
+		unsigned int flags)
+{
+	struct virtual_channel *vchan = NULL;
+	struct hab_header header = HAB_HEADER_INITIALIZER;
+	int nonblocking_flag = flags & HABMM_SOCKET_SEND_FLAGS_NON_BLOCKING;
+	uint32_t sizebytes = count * sizeof(*descs);
+	uint64_t bytes = 0;
+	int ret = 0, i;
+
+	if (!ctx || !descs || !count || count > HABMM_POOL_BATCH_MAX)
+		return -EINVAL;
+
+	vchan = hab_get_vchan_fromvcid(vcid, ctx, 0);
+	if (!vchan || vchan->otherend_closed) {
+		ret = -ENODEV;
+		goto err;
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = hab_pool_find_export(ctx, vchan, &descs[i]);
+		if (ret) {
+			pr_err("vcid %x bad pool desc exp %d off %x size %x\n",
+				vcid, descs[i].export_id, descs[i].offset,
+				descs[i].size);
+			goto err;
+		}
+		bytes += descs[i].size;
+	}
+
+	HAB_HEADER_SET_SIZE(header, sizebytes);
+	HAB_HEADER_SET_TYPE(header, HAB_PAYLOAD_TYPE_POOL_DESC);
+	HAB_HEADER_SET_ID(header, vchan->otherend_id);
+	HAB_HEADER_SET_SESSION_ID(header, vchan->session_id);
+
+	while (1) {
+		ret = physical_channel_send(vchan->pchan, &header, descs);
+
+		if (vchan->otherend_closed || nonblocking_flag ||
+			ret != -EAGAIN)
+			break;
+
+		schedule();
+	}
+
+	if (!ret) {
+		vchan->tx_msgs++;
+		vchan->tx_bytes += sizebytes;
+		vchan->pool_tx_descs += count;
+		vchan->pool_tx_bytes += bytes;
+	}
+err:
+	if (vchan)
+		hab_vchan_put(vchan);
+
+	return ret;
+}
+
+int hab_mem_pool_recv(struct uhab_context *ctx, int32_t vcid,
+		struct habmm_pool_desc *descs, uint32_t *count,
+		void **bufs, unsigned int flags)
+{
+	struct virtual_channel *vchan = NULL;
+	struct hab_message *msg = NULL;
+	int rsize, ret = 0, i, n;
+	uint64_t bytes = 0;
+
+	if (!ctx || !descs || !count || !*count)
+		return -EINVAL;
+
+	rsize = min_t(uint32_t, *count, HABMM_POOL_BATCH_MAX) * sizeof(*descs);
+	ret = hab_vchan_recv(ctx, &msg, vcid, &rsize, flags);
+	if (ret || !msg) {
+		if (ret == -EOVERFLOW)
+			*count = rsize / sizeof(*descs);
+		else
+			*count = 0;
+		if (msg)
+			hab_msg_free(msg);
+		return ret;
+	}
+
+	if (!msg->sizebytes || msg->sizebytes % sizeof(*descs)) {
+		pr_err("vcid %x not a pool message, %zd bytes\n",
+			vcid, msg->sizebytes);
+		hab_msg_free(msg);
+		*count = 0;
+		return -EBADMSG;
+	}
+
+	n = msg->sizebytes / sizeof(*descs);
+	memcpy(descs, msg->data, msg->sizebytes);
+	hab_msg_free(msg);
+	*count = n;
+
+	vchan = hab_get_vchan_fromvcid(vcid, ctx, 1);
+	if (!vchan)
+		return -ENODEV;
+
+	for (i = 0; i < n; i++) {
+		ret = hab_pool_find_import(ctx, vchan, &descs[i],
+				bufs ? &bufs[i] : NULL);
+		if (ret) {
+			pr_err("vcid %x bad pool desc exp %d off %x size %x\n",
+				vcid, descs[i].export_id, descs[i].offset,
+				descs[i].size);
+			break;
+		}
+		bytes += descs[i].size;
+	}
+
+	if (!ret) {
+		vchan->pool_rx_descs += n;
+		vchan->pool_rx_bytes += bytes;
+	}
+
+	hab_vchan_put(vchan);
+	return ret;
+}
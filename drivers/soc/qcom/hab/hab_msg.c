@@ -266,6 +266,7 @@ int hab_msg_recv(struct physical_channel *pchan,
 
 	switch (payload_type) {
 	case HAB_PAYLOAD_TYPE_MSG:
+	case HAB_PAYLOAD_TYPE_POOL_DESC:
 	case HAB_PAYLOAD_TYPE_SCHE_RESULT_REQ:
 	case HAB_PAYLOAD_TYPE_SCHE_RESULT_RSP:
 		message = hab_msg_alloc(pchan, sizebytes);
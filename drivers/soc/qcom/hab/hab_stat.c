@@ -82,6 +82,45 @@ int hab_stat_show_vchan(struct hab_driver *driver,
 	return ret;
 }
 
+int hab_stat_show_tput(struct hab_driver *driver,
+		char *buf, int size)
+{
+	int i = 0, ret = 0;
+	unsigned int ms;
+
+	ret = (int)strlcpy(buf, "", size);
+	for (i = 0; i < driver->ndevices; i++) {
+		struct hab_device *dev = &driver->devp[i];
+		struct physical_channel *pchan = NULL;
+		struct virtual_channel *vc = NULL;
+
+		spin_lock_bh(&dev->pchan_lock);
+		list_for_each_entry(pchan, &dev->pchannels, node) {
+			read_lock(&pchan->vchans_lock);
+			list_for_each_entry(vc, &pchan->vchannels, pnode) {
+				ms = jiffies_to_msecs(jiffies - vc->stat_start);
+				ret = hab_stat_buffer_print(buf, size,
+					"%08X %s ms %u tx %llu %llu rx %llu %llu\n",
+					vc->id, pchan->name, ms,
+					vc->tx_msgs, vc->tx_bytes,
+					vc->rx_msgs, vc->rx_bytes);
+				ret = hab_stat_buffer_print(buf, size,
+					"  pool tx %llu %llu rx %llu %llu KB/s %llu\n",
+					vc->pool_tx_descs, vc->pool_tx_bytes,
+					vc->pool_rx_descs, vc->pool_rx_bytes,
+					ms ? div_u64(vc->tx_bytes +
+						vc->rx_bytes +
+						vc->pool_tx_bytes +
+						vc->pool_rx_bytes, ms) : 0);
+			}
+			read_unlock(&pchan->vchans_lock);
+		}
+		spin_unlock_bh(&dev->pchan_lock);
+	}
+
+	return ret;
+}
+
 int hab_stat_show_ctx(struct hab_driver *driver,
 		char *buf, int size)
 {
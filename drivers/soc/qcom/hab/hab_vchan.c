@@ -57,6 +57,7 @@ hab_vchan_alloc(struct uhab_context *ctx, struct physical_channel *pchan,
 	spin_lock_init(&vchan->rx_lock);
 	INIT_LIST_HEAD(&vchan->rx_list);
 	init_waitqueue_head(&vchan->rx_queue);
+	vchan->stat_start = jiffies;
 
 	kref_init(&vchan->refcount);
 
@@ -135,6 +135,21 @@ int32_t habmm_unimport(int32_t handle,
 }
 EXPORT_SYMBOL(habmm_unimport);
 
+int32_t habmm_pool_send(int32_t handle, struct habmm_pool_desc *descs,
+		uint32_t count, uint32_t flags)
+{
+	return hab_mem_pool_send(hab_driver.kctx, handle, descs, count, flags);
+}
+EXPORT_SYMBOL(habmm_pool_send);
+
+int32_t habmm_pool_recv(int32_t handle, struct habmm_pool_desc *descs,
+		uint32_t *count, void **bufs, uint32_t timeout, uint32_t flags)
+{
+	return hab_mem_pool_recv(hab_driver.kctx, handle, descs, count, bufs,
+			flags);
+}
+EXPORT_SYMBOL(habmm_pool_recv);
+
 int32_t habmm_socket_query(int32_t handle,
 		struct hab_socket_info *info,
 		uint32_t flags)
@@ -18,6 +18,13 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/irqdesc.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
+#include <linux/topology.h>
 #include <soc/qcom/irq-helper.h>
 
 struct irq_helper {
@@ -139,6 +146,170 @@ int irq_blacklist_off(void)
 }
 EXPORT_SYMBOL(irq_blacklist_off);
 
+/*
+ * IRQ placement: every placement_ms the interrupt rates are sampled and
+ * the IRQs above rate_thresh (per second) are spread over the online,
+ * non-isolated CPUs of the cluster they currently target. The cluster is
+ * kept so that an IRQ stays next to the threads its driver placed there;
+ * threaded handlers follow the IRQ affinity on their own. IRQs with an
+ * affinity hint, per-cpu or no-balancing IRQs are never touched, and the
+ * service stands down while irq_blacklist_on() is in effect.
+ */
+static unsigned int placement_ms;
+static unsigned int rate_thresh = 1000;
+module_param(rate_thresh, uint, 0644);
+
+#define PLACEMENT_MAX_IRQS	16
+
+static unsigned int *irq_last_count;
+static unsigned long last_sample;
+static void irq_placement_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_placement_work, irq_placement_work_fn);
+
+struct irq_rate {
+	unsigned int irq;
+	unsigned int rate;
+	int cpu;
+};
+
+static bool irq_placement_allowed(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_data *d;
+
+	if (!desc || !desc->action || desc->affinity_hint)
+		return false;
+
+	d = irq_desc_get_irq_data(desc);
+	return irqd_can_balance(d) && !irqd_is_per_cpu(d) &&
+		irq_can_set_affinity(irq);
+}
+
+static void irq_place(struct irq_rate *ir, unsigned long *load)
+{
+	struct cpumask candidates;
+	int cpu, target = -1;
+
+	cpumask_andnot(&candidates, cpu_online_mask, cpu_isolated_mask);
+	if (cpumask_empty(&candidates))
+		return;
+	if (ir->cpu < nr_cpu_ids &&
+	    cpumask_intersects(topology_core_cpumask(ir->cpu), &candidates))
+		cpumask_and(&candidates, &candidates,
+			    topology_core_cpumask(ir->cpu));
+
+	if (ir->cpu < nr_cpu_ids && cpumask_test_cpu(ir->cpu, &candidates))
+		load[ir->cpu] -= ir->rate;
+
+	for_each_cpu(cpu, &candidates)
+		if (target < 0 || load[cpu] < load[target])
+			target = cpu;
+
+	/* Stay put unless the current CPU is unusable or clearly busier */
+	if (ir->cpu < nr_cpu_ids && cpumask_test_cpu(ir->cpu, &candidates) &&
+	    load[ir->cpu] <= load[target] + ir->rate / 2)
+		target = ir->cpu;
+
+	load[target] += ir->rate;
+	if (target != ir->cpu)
+		irq_set_affinity(ir->irq, cpumask_of(target));
+}
+
+static void irq_placement_work_fn(struct work_struct *work)
+{
+	struct irq_rate top[PLACEMENT_MAX_IRQS];
+	unsigned long load[NR_CPUS] = { 0 };
+	unsigned int irq, count, rate;
+	unsigned long now = jiffies, elapsed;
+	int i, n = 0;
+
+	elapsed = jiffies_to_msecs(now - last_sample);
+	last_sample = now;
+
+	get_online_cpus();
+	for (irq = 0; irq < nr_irqs; irq++) {
+		struct irq_data *d;
+		struct irq_rate ir;
+
+		count = kstat_irqs_usr(irq);
+		rate = elapsed ? (count - irq_last_count[irq]) * 1000ULL /
+			elapsed : 0;
+		irq_last_count[irq] = count;
+		if (!rate || !irq_placement_allowed(irq))
+			continue;
+
+		d = irq_get_irq_data(irq);
+		if (!d)
+			continue;
+		ir.irq = irq;
+		ir.rate = rate;
+		ir.cpu = cpumask_first_and(irq_data_get_affinity_mask(d),
+					   cpu_online_mask);
+		if (ir.cpu < nr_cpu_ids)
+			load[ir.cpu] += rate;
+		if (rate < rate_thresh)
+			continue;
+
+		/* Keep the highest rates, sorted in descending order */
+		if (n == PLACEMENT_MAX_IRQS) {
+			if (rate <= top[n - 1].rate)
+				continue;
+			n--;
+		}
+		for (i = n++; i > 0 && top[i - 1].rate < rate; i--)
+			top[i] = top[i - 1];
+		top[i] = ir;
+	}
+
+	if (!irq_h || !irq_h->deploy)
+		for (i = 0; i < n; i++)
+			irq_place(&top[i], load);
+	put_online_cpus();
+
+	if (READ_ONCE(placement_ms))
+		queue_delayed_work(system_power_efficient_wq,
+				   &irq_placement_work,
+				   msecs_to_jiffies(placement_ms));
+}
+
+/*
+ * Re-run the placement right away, e.g. after core_ctl changed the set of
+ * isolated CPUs.
+ */
+void irq_placement_kick(void)
+{
+	if (READ_ONCE(placement_ms) && irq_last_count)
+		mod_delayed_work(system_power_efficient_wq,
+				 &irq_placement_work, 0);
+}
+EXPORT_SYMBOL(irq_placement_kick);
+
+static int set_placement_ms(const char *buf, const struct kernel_param *kp)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+	if (val && !irq_last_count)
+		return -ENOMEM;
+
+	placement_ms = val;
+	if (val) {
+		last_sample = jiffies;
+		mod_delayed_work(system_power_efficient_wq,
+				 &irq_placement_work, msecs_to_jiffies(val));
+	}
+	return 0;
+}
+
+static const struct kernel_param_ops placement_ms_ops = {
+	.set = set_placement_ms,
+	.get = param_get_uint,
+};
+module_param_cb(placement_ms, &placement_ms_ops, &placement_ms, 0644);
+
 static int __init irq_helper_init(void)
 {
 	int ret;
@@ -164,6 +335,11 @@ static int __init irq_helper_init(void)
 	spin_lock_init(&irq_h->lock);
 	irq_h->count = 0;
 	irq_h->enable = true;
+
+	irq_last_count = kcalloc(nr_irqs, sizeof(*irq_last_count),
+				 GFP_KERNEL);
+	if (!irq_last_count)
+		pr_err("%s: IRQ placement unavailable\n", __func__);
 	return 0;
 out_put_kobj:
 	kobject_put(&irq_h->kobj);
@@ -175,6 +351,9 @@ module_init(irq_helper_init);
 
 static void __exit irq_helper_exit(void)
 {
+	placement_ms = 0;
+	cancel_delayed_work_sync(&irq_placement_work);
+	kfree(irq_last_count);
 	sysfs_remove_file(&irq_h->kobj, &irq_helper_irq_blacklist_on.attr);
 	kobject_del(&irq_h->kobj);
 	kobject_put(&irq_h->kobj);
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Per task CPU PMU counts. One pinned kernel counter per cpu and event
+ * is read at every context switch and the delta since the previous
+ * switch is charged to the task being switched out and to the cpu.
+ *
+ * /proc/kryo_counters shows the per cluster totals and takes 1 or 0 to
+ * start or stop counting; /proc/<pid>/kryo_counters and
+ * /proc/<pid>/task/<tid>/kryo_counters show the per task counts.
+ */
+
+#define pr_fmt(fmt) "kryo-task-counters: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/kernel.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
+#include <linux/tracepoint.h>
+#include <linux/uaccess.h>
+#include <trace/events/sched.h>
+#include <soc/qcom/kryo_task_counters.h>
+
+/*
+ * Raw event numbers, in the perf_event_kryo encoding: architected
+ * events as is, Kryo events as NRCCG. Read when counting is enabled.
+ */
+static unsigned int events[KRYO_TC_NR_EVENTS] = {
+	0x11,	/* CPU_CYCLES */
+	0x08,	/* INST_RETIRED */
+	0x03,	/* L1D_CACHE_REFILL */
+	0x17,	/* L2D_CACHE_REFILL */
+};
+static int nr_events = KRYO_TC_NR_EVENTS;
+module_param_array(events, uint, &nr_events, 0644);
+MODULE_PARM_DESC(events, "Raw PMU events counted per task");
+
+struct kryo_tc_cpu {
+	struct perf_event *pevent[KRYO_TC_NR_EVENTS];
+	u64 last[KRYO_TC_NR_EVENTS];
+	u64 total[KRYO_TC_NR_EVENTS];
+};
+
+static DEFINE_PER_CPU(struct kryo_tc_cpu, kryo_tc_cpu);
+static DEFINE_MUTEX(kryo_tc_lock);
+static bool kryo_tc_enabled;
+static unsigned int kryo_tc_nr;
+static unsigned int kryo_tc_config[KRYO_TC_NR_EVENTS];
+
+/* called with the rq lock held and interrupts off */
+static void kryo_tc_sched_switch(void *data, bool preempt,
+				 struct task_struct *prev,
+				 struct task_struct *next)
+{
+	struct kryo_tc_cpu *tc = this_cpu_ptr(&kryo_tc_cpu);
+	unsigned int i;
+	u64 val, delta;
+
+	for (i = 0; i < kryo_tc_nr; i++) {
+		if (!tc->pevent[i])
+			continue;
+		val = perf_event_read_local(tc->pevent[i]);
+		delta = val - tc->last[i];
+		tc->last[i] = val;
+		tc->total[i] += delta;
+		prev->kryo_counts[i] += delta;
+	}
+}
+
+static void kryo_tc_release(void)
+{
+	struct kryo_tc_cpu *tc;
+	unsigned int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		tc = per_cpu_ptr(&kryo_tc_cpu, cpu);
+		for (i = 0; i < KRYO_TC_NR_EVENTS; i++) {
+			if (tc->pevent[i])
+				perf_event_release_kernel(tc->pevent[i]);
+			tc->pevent[i] = NULL;
+		}
+	}
+}
+
+static int kryo_tc_enable(void)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_RAW,
+		.size = sizeof(attr),
+		.pinned = 1,
+	};
+	struct perf_event *pevent;
+	struct kryo_tc_cpu *tc;
+	u64 enabled, running;
+	unsigned int cpu, i;
+	int ret;
+
+	kryo_tc_nr = nr_events;
+	memcpy(kryo_tc_config, events, sizeof(kryo_tc_config));
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		tc = per_cpu_ptr(&kryo_tc_cpu, cpu);
+		memset(tc->total, 0, sizeof(tc->total));
+		for (i = 0; i < kryo_tc_nr; i++) {
+			attr.config = kryo_tc_config[i];
+			pevent = perf_event_create_kernel_counter(&attr, cpu,
+							NULL, NULL, NULL);
+			if (IS_ERR(pevent)) {
+				pr_err("event 0x%x on cpu%u: %ld\n",
+				       kryo_tc_config[i], cpu, PTR_ERR(pevent));
+				ret = PTR_ERR(pevent);
+				put_online_cpus();
+				goto err;
+			}
+			tc->last[i] = perf_event_read_value(pevent, &enabled,
+							    &running);
+			tc->pevent[i] = pevent;
+		}
+	}
+	put_online_cpus();
+
+	ret = register_trace_sched_switch(kryo_tc_sched_switch, NULL);
+	if (!ret)
+		return 0;
+err:
+	kryo_tc_release();
+	return ret;
+}
+
+static void kryo_tc_disable(void)
+{
+	unregister_trace_sched_switch(kryo_tc_sched_switch, NULL);
+	tracepoint_synchronize_unregister();
+	kryo_tc_release();
+}
+
+static void kryo_tc_show_counts(struct seq_file *m, const u64 *counts)
+{
+	unsigned int i;
+
+	for (i = 0; i < KRYO_TC_NR_EVENTS; i++)
+		seq_printf(m, "%s%llu", i ? " " : "", counts[i]);
+	seq_putc(m, '\n');
+}
+
+int proc_pid_kryo_counters(struct seq_file *m, struct pid_namespace *ns,
+			   struct pid *pid, struct task_struct *task)
+{
+	kryo_tc_show_counts(m, task->kryo_counts);
+	return 0;
+}
+
+/* sums the live threads; counts of threads that exited are lost */
+int proc_tgid_kryo_counters(struct seq_file *m, struct pid_namespace *ns,
+			    struct pid *pid, struct task_struct *task)
+{
+	u64 counts[KRYO_TC_NR_EVENTS] = { 0 };
+	struct task_struct *t;
+	unsigned long flags;
+	unsigned int i;
+
+	if (lock_task_sighand(task, &flags)) {
+		for_each_thread(task, t)
+			for (i = 0; i < KRYO_TC_NR_EVENTS; i++)
+				counts[i] += READ_ONCE(t->kryo_counts[i]);
+		unlock_task_sighand(task, &flags);
+	}
+	kryo_tc_show_counts(m, counts);
+	return 0;
+}
+
+static int kryo_tc_proc_show(struct seq_file *m, void *v)
+{
+	u64 counts[KRYO_TC_NR_EVENTS];
+	struct kryo_tc_cpu *tc;
+	cpumask_var_t done;
+	unsigned int cpu, sib, i;
+
+	if (!zalloc_cpumask_var(&done, GFP_KERNEL))
+		return -ENOMEM;
+
+	mutex_lock(&kryo_tc_lock);
+	seq_printf(m, "enabled: %d\nevents:", kryo_tc_enabled);
+	for (i = 0; i < kryo_tc_nr; i++)
+		seq_printf(m, " 0x%x", kryo_tc_config[i]);
+	seq_putc(m, '\n');
+
+	for_each_possible_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, done))
+			continue;
+		memset(counts, 0, sizeof(counts));
+		for_each_cpu(sib, topology_core_cpumask(cpu)) {
+			tc = per_cpu_ptr(&kryo_tc_cpu, sib);
+			for (i = 0; i < KRYO_TC_NR_EVENTS; i++)
+				counts[i] += READ_ONCE(tc->total[i]);
+		}
+		cpumask_or(done, done, topology_core_cpumask(cpu));
+		cpumask_set_cpu(cpu, done);
+		seq_printf(m, "cluster%d %*pbl: ",
+			   topology_physical_package_id(cpu),
+			   cpumask_pr_args(topology_core_cpumask(cpu)));
+		kryo_tc_show_counts(m, counts);
+	}
+	mutex_unlock(&kryo_tc_lock);
+
+	free_cpumask_var(done);
+	return 0;
+}
+
+static ssize_t kryo_tc_proc_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&kryo_tc_lock);
+	if (enable && !kryo_tc_enabled) {
+		ret = kryo_tc_enable();
+		if (!ret)
+			kryo_tc_enabled = true;
+	} else if (!enable && kryo_tc_enabled) {
+		kryo_tc_disable();
+		kryo_tc_enabled = false;
+	}
+	mutex_unlock(&kryo_tc_lock);
+
+	return ret ? ret : count;
+}
+
+static int kryo_tc_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kryo_tc_proc_show, NULL);
+}
+
+static const struct file_operations kryo_tc_proc_fops = {
+	.open		= kryo_tc_proc_open,
+	.read		= seq_read,
+	.write		= kryo_tc_proc_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init kryo_tc_init(void)
+{
+	BUILD_BUG_ON(ARRAY_SIZE(current->kryo_counts) != KRYO_TC_NR_EVENTS);
+
+	if (!proc_create("kryo_counters", 0644, NULL, &kryo_tc_proc_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(kryo_tc_init);
@@ -15,12 +15,15 @@
 
 #include <linux/types.h>
 #include <linux/device.h>
+#include <linux/ktime.h>
+#include <linux/rtmutex.h>
 #include <linux/msm-bus-board.h>
 #include <linux/msm-bus.h>
 #include <linux/msm_bus_rules.h>
 #include "msm_bus_core.h"
 
 struct msm_bus_node_device_type;
+struct seq_file;
 struct link_node {
 	uint64_t lnode_ib[NUM_CTX];
 	uint64_t lnode_ab[NUM_CTX];
@@ -58,6 +61,34 @@ struct nodebw {
 	const char *max_ib_cl_name;
 };
 
+#define MSM_BUS_RES_LEVELS	16
+#define MSM_BUS_RES_VOTERS	16
+#define MSM_BUS_RES_NAME	32
+
+/* Time spent at one clock rate, the last level also takes any overflow */
+struct msm_bus_res_level {
+	uint64_t rate;
+	uint64_t time_ns;
+	uint32_t entries;
+};
+
+/* Time a client held the largest ib vote on a fabric */
+struct msm_bus_res_voter {
+	char name[MSM_BUS_RES_NAME];
+	uint64_t time_ns[NUM_CTX];
+};
+
+struct msm_bus_residency {
+	ktime_t since[NUM_CTX];
+	int cur_level[NUM_CTX];
+	int num_levels[NUM_CTX];
+	struct msm_bus_res_level levels[NUM_CTX][MSM_BUS_RES_LEVELS];
+	ktime_t voter_since[NUM_CTX];
+	int cur_voter[NUM_CTX];
+	int num_voters;
+	struct msm_bus_res_voter voters[MSM_BUS_RES_VOTERS];
+};
+
 struct msm_bus_fab_device_type {
 	void __iomem *qos_base;
 	phys_addr_t pqos_base;
@@ -142,6 +173,7 @@ struct msm_bus_node_device_type {
 	bool dirty;
 	struct list_head dev_link;
 	struct list_head devlist;
+	struct msm_bus_residency *res;
 };
 
 static inline struct msm_bus_node_device_type *to_msm_bus_node(struct device *d)
@@ -153,12 +185,16 @@ static inline struct msm_bus_node_device_type *to_msm_bus_node(struct device *d)
 int msm_bus_enable_limiter(struct msm_bus_node_device_type *nodedev,
 				int throttle_en, uint64_t lim_bw);
 int msm_bus_commit_data(struct list_head *clist);
+void msm_bus_residency_show(struct seq_file *m);
+void msm_bus_residency_reset(void);
 void *msm_bus_realloc_devmem(struct device *dev, void *p, size_t old_size,
 					size_t new_size, gfp_t flags);
 
 extern struct msm_bus_device_node_registration
 	*msm_bus_of_to_pdata(struct platform_device *pdev);
 extern void msm_bus_arb_setops_adhoc(struct msm_bus_arb_ops *arb_ops);
+extern void msm_bus_arb_adhoc_stats_show(struct seq_file *m);
+extern struct rt_mutex msm_bus_adhoc_lock;
 extern int msm_bus_bimc_set_ops(struct msm_bus_node_device_type *bus_dev);
 extern int msm_bus_noc_set_ops(struct msm_bus_node_device_type *bus_dev);
 extern int msm_bus_of_get_static_rules(struct platform_device *pdev,
@@ -16,6 +16,10 @@
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
 #include <linux/clk.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 #include <linux/msm-bus.h>
 #include "msm_bus_core.h"
 #include "msm_bus_adhoc.h"
@@ -24,6 +28,7 @@
 #define NUM_CL_HANDLES	50
 #define NUM_LNODES	3
 #define MAX_STR_CL	50
+#define NUM_PATH_CACHE	32
 
 struct bus_search_type {
 	struct list_head link;
@@ -35,13 +40,53 @@ struct handle_type {
 	struct msm_bus_client **cl_list;
 };
 
+/*
+ * Routes found by getpath(), keyed by (src, dest). The topology does not
+ * change once the fabrics have probed, so clients that register again
+ * or share a route skip the breadth first search.
+ */
+struct path_cache_type {
+	struct list_head link;
+	int src;
+	int dest;
+	int num_hops;
+	struct device **hops;
+};
+
+struct arb_stats_type {
+	u64 commits;
+	u64 deferred;
+	u64 agg_delta;
+	u64 agg_full;
+	u64 path_hits;
+	u64 path_misses;
+};
+
 static struct handle_type handle_list;
+static LIST_HEAD(handle_cl_list);
 static LIST_HEAD(input_list);
 static LIST_HEAD(apply_list);
 static LIST_HEAD(commit_list);
+static LIST_HEAD(path_cache);
+static int num_path_cache;
+static bool commit_pending;
+static struct arb_stats_type arb_stats;
+
+/*
+ * Requests that only lower bandwidth are held back for this long so
+ * that bursts of votes go out in one commit. Raising a vote commits
+ * right away, together with anything held back.
+ */
+static unsigned int commit_coalesce_ms = 2;
+module_param(commit_coalesce_ms, uint, 0644);
+MODULE_PARM_DESC(commit_coalesce_ms, "Delay for committing lowered votes");
 
 DEFINE_RT_MUTEX(msm_bus_adhoc_lock);
 
+static void commit_data(void);
+static void msm_bus_commit_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(commit_work, msm_bus_commit_work);
+
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
 	struct msm_bus_node_device_type *bus_node = NULL;
@@ -299,7 +344,7 @@ static void setup_bl_list(struct msm_bus_node_device_type *node,
 	}
 }
 
-static int getpath(struct device *src_dev, int dest, const char *cl_name)
+static int search_path(struct device *src_dev, int dest, const char *cl_name)
 {
 	struct list_head traverse_list;
 	struct list_head edge_list;
@@ -395,6 +440,129 @@ exit_getpath:
 	return first_hop;
 }
 
+static struct path_cache_type *path_cache_find(int src, int dest)
+{
+	struct path_cache_type *entry;
+
+	list_for_each_entry(entry, &path_cache, link) {
+		if (entry->src == src && entry->dest == dest) {
+			list_move(&entry->link, &path_cache);
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void path_cache_add(struct device *src_dev, int first_hop, int src,
+								int dest)
+{
+	struct path_cache_type *entry;
+	struct msm_bus_node_device_type *dev_info;
+	struct device *dev = src_dev;
+	int idx = first_hop;
+	int num_hops = 0;
+
+	while (dev && idx >= 0) {
+		dev_info = to_msm_bus_node(dev);
+		dev = dev_info->lnode_list[idx].next_dev;
+		idx = dev_info->lnode_list[idx].next;
+		num_hops++;
+	}
+
+	if (num_path_cache >= NUM_PATH_CACHE) {
+		entry = list_last_entry(&path_cache, struct path_cache_type,
+									link);
+		list_del(&entry->link);
+		kfree(entry->hops);
+		kfree(entry);
+		num_path_cache--;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return;
+
+	entry->hops = kcalloc(num_hops, sizeof(struct device *), GFP_KERNEL);
+	if (!entry->hops) {
+		kfree(entry);
+		return;
+	}
+
+	entry->src = src;
+	entry->dest = dest;
+	entry->num_hops = num_hops;
+	dev = src_dev;
+	idx = first_hop;
+	for (num_hops = 0; num_hops < entry->num_hops; num_hops++) {
+		dev_info = to_msm_bus_node(dev);
+		entry->hops[num_hops] = dev;
+		dev = dev_info->lnode_list[idx].next_dev;
+		idx = dev_info->lnode_list[idx].next;
+	}
+	list_add(&entry->link, &path_cache);
+	num_path_cache++;
+}
+
+/* Same link nodes prune_path() would have set up, dest back to src */
+static int path_cache_gen_lnodes(struct path_cache_type *entry,
+							const char *cl_name)
+{
+	struct msm_bus_node_device_type *next_node;
+	int lnode_hop = -1;
+	int next_hop = entry->dest;
+	int i;
+
+	for (i = entry->num_hops - 1; i >= 0; i--) {
+		lnode_hop = gen_lnode(entry->hops[i], next_hop, lnode_hop,
+								cl_name);
+		if (lnode_hop < 0)
+			break;
+		next_node = to_msm_bus_node(entry->hops[i]);
+		next_hop = next_node->node_info->id;
+	}
+
+	return lnode_hop;
+}
+
+static int getpath(struct device *src_dev, int dest, const char *cl_name)
+{
+	struct path_cache_type *entry;
+	struct msm_bus_node_device_type *src_node;
+	int first_hop;
+
+	if (!src_dev) {
+		MSM_BUS_ERR("%s: Cannot locate src dev ", __func__);
+		return -ENODEV;
+	}
+	src_node = to_msm_bus_node(src_dev);
+
+	entry = path_cache_find(src_node->node_info->id, dest);
+	if (entry) {
+		arb_stats.path_hits++;
+		return path_cache_gen_lnodes(entry, cl_name);
+	}
+
+	/*
+	 * The search threads the nodes through their link field, which
+	 * also keeps them on the commit list, so send out any held back
+	 * commit first.
+	 */
+	if (commit_pending) {
+		commit_pending = false;
+		cancel_delayed_work(&commit_work);
+		commit_data();
+		arb_stats.commits++;
+	}
+
+	arb_stats.path_misses++;
+	first_hop = search_path(src_dev, dest, cl_name);
+	if (first_hop >= 0)
+		path_cache_add(src_dev, first_hop, src_node->node_info->id,
+									dest);
+
+	return first_hop;
+}
+
 static uint64_t scheme1_agg_scheme(struct msm_bus_node_device_type *bus_dev,
 			struct msm_bus_node_device_type *fab_dev, int ctx)
 {
@@ -541,8 +709,43 @@ static uint64_t legacy_agg_scheme(struct msm_bus_node_device_type *bus_dev,
 	return bw_max_hz;
 }
 
+/*
+ * Fold one link node's change into the node totals. The sum is always
+ * exact; a maximum can only be updated in place when it grew or belonged
+ * to someone else, otherwise the caller has to rescan all link nodes.
+ */
+static bool aggregate_lnode_delta(struct msm_bus_node_device_type *bus_dev,
+			struct link_node *lnode, uint64_t old_ib,
+			uint64_t old_ab, int ctx)
+{
+	struct nodebw *node_bw = &bus_dev->node_bw[ctx];
+	uint64_t new_ib = lnode->lnode_ib[ctx];
+	uint64_t new_ab = lnode->lnode_ab[ctx];
+
+	/* Fabric devices have their maximums rewritten on every commit */
+	if (bus_dev->node_info->is_fab_dev)
+		return false;
+
+	if ((new_ib < old_ib && old_ib == node_bw->max_ib) ||
+			(new_ab < old_ab && old_ab == node_bw->max_ab))
+		return false;
+
+	node_bw->sum_ab = node_bw->sum_ab - old_ab + new_ab;
+	if (new_ib > node_bw->max_ib) {
+		node_bw->max_ib = new_ib;
+		node_bw->max_ib_cl_name = lnode->cl_name;
+	}
+	if (new_ab > node_bw->max_ab) {
+		node_bw->max_ab = new_ab;
+		node_bw->max_ab_cl_name = lnode->cl_name;
+	}
+
+	return true;
+}
+
 static uint64_t aggregate_bus_req(struct msm_bus_node_device_type *bus_dev,
-									int ctx)
+			struct link_node *lnode, uint64_t old_ib,
+			uint64_t old_ab, int ctx)
 {
 	uint64_t bw_hz = 0;
 	int i;
@@ -557,9 +760,16 @@ static uint64_t aggregate_bus_req(struct msm_bus_node_device_type *bus_dev,
 		goto exit_agg_bus_req;
 	}
 
+	fab_dev = to_msm_bus_node(bus_dev->node_info->bus_device);
+	if (lnode && aggregate_lnode_delta(bus_dev, lnode, old_ib, old_ab,
+									ctx)) {
+		arb_stats.agg_delta++;
+		goto apply_agg_scheme;
+	}
+
+	arb_stats.agg_full++;
 	bus_dev->node_bw[ctx].max_ib_cl_name = NULL;
 	bus_dev->node_bw[ctx].max_ab_cl_name = NULL;
-	fab_dev = to_msm_bus_node(bus_dev->node_info->bus_device);
 	for (i = 0; i < bus_dev->num_lnodes; i++) {
 		if (bus_dev->lnode_list[i].lnode_ib[ctx] > max_ib)
 			bus_dev->node_bw[ctx].max_ib_cl_name =
@@ -577,6 +787,7 @@ static uint64_t aggregate_bus_req(struct msm_bus_node_device_type *bus_dev,
 	bus_dev->node_bw[ctx].max_ib = max_ib;
 	bus_dev->node_bw[ctx].max_ab = max_ab;
 
+apply_agg_scheme:
 	if (bus_dev->node_info->agg_params.agg_scheme != AGG_SCHEME_NONE)
 		agg_scheme = bus_dev->node_info->agg_params.agg_scheme;
 	else
@@ -670,6 +881,97 @@ static void commit_data(void)
 	INIT_LIST_HEAD(&commit_list);
 }
 
+/*
+ * Commit the dirty nodes, or when the request only lowered bandwidth,
+ * leave them on the commit list for the coalescing work to pick up.
+ */
+static void commit_or_defer(bool lowered)
+{
+	if (lowered && commit_coalesce_ms) {
+		if (!commit_pending) {
+			commit_pending = true;
+			schedule_delayed_work(&commit_work,
+				msecs_to_jiffies(commit_coalesce_ms));
+		}
+		arb_stats.deferred++;
+		return;
+	}
+
+	if (commit_pending) {
+		commit_pending = false;
+		cancel_delayed_work(&commit_work);
+	}
+	commit_data();
+	arb_stats.commits++;
+}
+
+static void msm_bus_commit_work(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (commit_pending) {
+		commit_pending = false;
+		commit_data();
+		arb_stats.commits++;
+	}
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static void update_vote_stats(struct msm_bus_vote_stats *stats,
+							ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->num_votes++;
+	stats->arb_ns += ns;
+	if (ns > stats->max_arb_ns)
+		stats->max_arb_ns = ns;
+}
+
+static void show_vote_stats(struct seq_file *m, const char *name,
+				struct msm_bus_vote_stats *stats)
+{
+	unsigned long age = max_t(unsigned long,
+				jiffies - stats->reg_jiffies, 1);
+
+	seq_printf(m, "%-32s %10llu %8llu %10llu %10llu\n", name,
+		stats->num_votes, div64_u64(stats->num_votes * HZ, age),
+		stats->num_votes ?
+			div64_u64(stats->arb_ns, stats->num_votes) : 0,
+		stats->max_arb_ns);
+}
+
+/**
+ * msm_bus_arb_adhoc_stats_show() - Print arbitration statistics
+ * @m: seq_file to print to
+ */
+void msm_bus_arb_adhoc_stats_show(struct seq_file *m)
+{
+	struct msm_bus_client_handle *cl;
+	struct msm_bus_client *client;
+	int i;
+
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	seq_printf(m, "commits %llu deferred %llu\n",
+		arb_stats.commits, arb_stats.deferred);
+	seq_printf(m, "aggregation delta %llu full %llu\n",
+		arb_stats.agg_delta, arb_stats.agg_full);
+	seq_printf(m, "path cache hits %llu misses %llu entries %d\n",
+		arb_stats.path_hits, arb_stats.path_misses, num_path_cache);
+	seq_printf(m, "\n%-32s %10s %8s %10s %10s\n", "client", "votes",
+		"votes/s", "avg_ns", "max_ns");
+
+	for (i = 0; i < handle_list.num_entries; i++) {
+		client = handle_list.cl_list[i];
+		if (client && client->pdata && client->pdata->name)
+			show_vote_stats(m, client->pdata->name,
+						&client->stats);
+	}
+
+	list_for_each_entry(cl, &handle_cl_list, link)
+		show_vote_stats(m, cl->name, &cl->stats);
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
 static void add_node_to_clist(struct msm_bus_node_device_type *node)
 {
 	struct msm_bus_node_device_type *node_parent =
@@ -698,6 +1000,7 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 	int ret = 0;
 	struct rule_update_path_info *rule_node;
 	bool rules_registered = msm_rule_are_rules_registered();
+	uint64_t old_ib[NUM_CTX], old_ab[NUM_CTX];
 
 	if (IS_ERR_OR_NULL(src_dev)) {
 		MSM_BUS_ERR("%s: No source device", __func__);
@@ -732,6 +1035,8 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 			ret = -ENXIO;
 			goto exit_update_path;
 		}
+		memcpy(old_ib, lnode->lnode_ib, sizeof(old_ib));
+		memcpy(old_ab, lnode->lnode_ab, sizeof(old_ab));
 		lnode->lnode_ib[ACTIVE_CTX] = act_req_ib;
 		lnode->lnode_ab[ACTIVE_CTX] = act_req_bw;
 		lnode->lnode_ib[DUAL_CTX] = slp_req_ib;
@@ -739,7 +1044,8 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 
 		for (i = 0; i < NUM_CTX; i++)
 			dev_info->node_bw[i].cur_clk_hz =
-					aggregate_bus_req(dev_info, i);
+					aggregate_bus_req(dev_info, lnode,
+						old_ib[i], old_ab[i], i);
 
 		add_node_to_clist(dev_info);
 
@@ -899,7 +1205,7 @@ static void unregister_client_adhoc(uint32_t cl)
 		remove_path(src_dev, dest, cur_clk, cur_bw, lnode,
 						pdata->active_only);
 	}
-	commit_data();
+	commit_or_defer(true);
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
 	kfree(client->src_pnode);
 	kfree(client->src_devs);
@@ -1006,6 +1312,7 @@ static uint32_t register_client_adhoc(struct msm_bus_scale_pdata *pdata)
 		goto exit_src_dev_malloc_fail;
 	}
 	client->curr = -1;
+	client->stats.reg_jiffies = jiffies;
 
 	for (i = 0; i < pdata->usecase->num_paths; i++) {
 		src = pdata->usecase->vectors[i].src;
@@ -1053,7 +1360,7 @@ exit_register_client:
 }
 
 static int update_client_paths(struct msm_bus_client *client, bool log_trns,
-							unsigned int idx)
+					unsigned int idx, bool lowered)
 {
 	int lnode, src, dest, cur_idx;
 	uint64_t req_clk, req_bw, curr_clk, curr_bw, slp_clk, slp_bw;
@@ -1076,6 +1383,8 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 
 	cur_idx = client->curr;
 	client->curr = idx;
+	if (cur_idx < 0)
+		lowered = false;
 	for (i = 0; i < pdata->usecase->num_paths; i++) {
 		src = pdata->usecase[idx].vectors[i].src;
 		dest = pdata->usecase[idx].vectors[i].dst;
@@ -1094,6 +1403,8 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 			MSM_BUS_DBG("%s:ab: %llu ib: %llu\n", __func__,
 					curr_bw, curr_clk);
 		}
+		if (req_clk > curr_clk || req_bw > curr_bw)
+			lowered = false;
 
 		if (pdata->active_only) {
 			slp_clk = 0;
@@ -1115,7 +1426,7 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 		if (log_trns)
 			getpath_debug(src, lnode, pdata->active_only);
 	}
-	commit_data();
+	commit_or_defer(lowered);
 exit_update_client_paths:
 	return ret;
 }
@@ -1125,9 +1436,11 @@ static int update_context(uint32_t cl, bool active_only,
 {
 	int ret = 0;
 	struct msm_bus_scale_pdata *pdata;
-	struct msm_bus_client *client;
+	struct msm_bus_client *client = NULL;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %d", __func__, cl);
 		ret = -ENXIO;
@@ -1162,7 +1475,8 @@ static int update_context(uint32_t cl, bool active_only,
 	pdata->active_only = active_only;
 
 	msm_bus_dbg_client_data(client->pdata, ctx_idx , cl);
-	ret = update_client_paths(client, false, ctx_idx);
+	/* Going active only drops the sleep votes, the reverse adds them */
+	ret = update_client_paths(client, false, ctx_idx, active_only);
 	if (ret) {
 		pr_err("%s: Err updating path\n", __func__);
 		goto exit_update_context;
@@ -1171,6 +1485,8 @@ static int update_context(uint32_t cl, bool active_only,
 	trace_bus_update_request_end(pdata->name);
 
 exit_update_context:
+	if (client)
+		update_vote_stats(&client->stats, start);
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
 	return ret;
 }
@@ -1179,11 +1495,13 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 {
 	int ret = 0;
 	struct msm_bus_scale_pdata *pdata;
-	struct msm_bus_client *client;
+	struct msm_bus_client *client = NULL;
 	const char *test_cl = "Null";
 	bool log_transaction = false;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %d", __func__, cl);
@@ -1225,7 +1543,7 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	MSM_BUS_DBG("%s: cl: %u index: %d curr: %d num_paths: %d\n", __func__,
 		cl, index, client->curr, client->pdata->usecase->num_paths);
 	msm_bus_dbg_client_data(client->pdata, index , cl);
-	ret = update_client_paths(client, log_transaction, index);
+	ret = update_client_paths(client, log_transaction, index, true);
 	if (ret) {
 		pr_err("%s: Err updating path\n", __func__);
 		goto exit_update_request;
@@ -1234,6 +1552,8 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	trace_bus_update_request_end(pdata->name);
 
 exit_update_request:
+	if (client)
+		update_vote_stats(&client->stats, start);
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
 	return ret;
 }
@@ -1253,8 +1573,11 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	char *test_cl = "test-client";
 	bool log_transaction = false;
 	u64 slp_ib, slp_ab;
+	bool lowered;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %p", __func__, cl);
@@ -1289,7 +1612,8 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		goto exit_update_request;
 	}
 
-	commit_data();
+	lowered = ib <= cl->cur_act_ib && ab <= cl->cur_act_ab;
+	commit_or_defer(lowered);
 	cl->cur_act_ib = ib;
 	cl->cur_act_ab = ab;
 	cl->cur_slp_ib = slp_ib;
@@ -1299,6 +1623,8 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		getpath_debug(cl->mas, cl->first_hop, cl->active_only);
 	trace_bus_update_request_end(cl->name);
 exit_update_request:
+	if (cl)
+		update_vote_stats(&cl->stats, start);
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
 
 	return ret;
@@ -1308,8 +1634,11 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				u64 act_ib, u64 slp_ib, u64 slp_ab)
 {
 	int ret = 0;
+	bool lowered;
+	ktime_t start;
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
+	start = ktime_get();
 	if (!cl) {
 		MSM_BUS_ERR("Invalid client handle %p", cl);
 		ret = -ENXIO;
@@ -1335,13 +1664,17 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				__func__, ret, cl->active_only);
 		goto exit_change_context;
 	}
-	commit_data();
+	lowered = act_ib <= cl->cur_act_ib && act_ab <= cl->cur_act_ab &&
+		slp_ib <= cl->cur_slp_ib && slp_ab <= cl->cur_slp_ab;
+	commit_or_defer(lowered);
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_slp_ib = slp_ib;
 	cl->cur_slp_ab = slp_ab;
 	trace_bus_update_request_end(cl->name);
 exit_change_context:
+	if (cl)
+		update_vote_stats(&cl->stats, start);
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
 	return ret;
 }
@@ -1359,7 +1692,8 @@ static void unregister_adhoc(struct msm_bus_client_handle *cl)
 
 	remove_path(cl->mas_dev, cl->slv, cl->cur_act_ib, cl->cur_act_ab,
 				cl->first_hop, cl->active_only);
-	commit_data();
+	commit_or_defer(true);
+	list_del(&cl->link);
 	msm_bus_dbg_remove_client(cl);
 	kfree(cl->name);
 	kfree(cl);
@@ -1421,6 +1755,8 @@ register_adhoc(uint32_t mas, uint32_t slv, char *name, bool active_only)
 
 	MSM_BUS_DBG("%s:Client handle %p %s", __func__, client,
 						client->name);
+	client->stats.reg_jiffies = jiffies;
+	list_add_tail(&client->link, &handle_cl_list);
 	msm_bus_dbg_add_client(client);
 exit_register:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
@@ -281,6 +281,7 @@ struct msm_bus_client {
 	int *src_pnode;
 	int curr;
 	struct device **src_devs;
+	struct msm_bus_vote_stats stats;
 };
 
 uint64_t msm_bus_div64(unsigned int width, uint64_t bw);
@@ -806,6 +806,51 @@ static const struct file_operations msm_bus_dbg_dump_clients_fops = {
 	.read		= msm_bus_dbg_dump_clients_read,
 };
 
+static int msm_bus_dbg_arb_stats_show(struct seq_file *m, void *unused)
+{
+	msm_bus_arb_adhoc_stats_show(m);
+	return 0;
+}
+
+static int msm_bus_dbg_arb_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_bus_dbg_arb_stats_show, NULL);
+}
+
+static int msm_bus_dbg_residency_show(struct seq_file *m, void *unused)
+{
+	msm_bus_residency_show(m);
+	return 0;
+}
+
+static int msm_bus_dbg_residency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_bus_dbg_residency_show, NULL);
+}
+
+/* Any write restarts the accounting */
+static ssize_t msm_bus_dbg_residency_write(struct file *file,
+	const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	msm_bus_residency_reset();
+	return cnt;
+}
+
+static const struct file_operations msm_bus_dbg_residency_fops = {
+	.open		= msm_bus_dbg_residency_open,
+	.read		= seq_read,
+	.write		= msm_bus_dbg_residency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations msm_bus_dbg_arb_stats_fops = {
+	.open		= msm_bus_dbg_arb_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * msm_bus_dbg_client_data() - Add debug data for clients
  * @pdata: Platform data of the client
@@ -947,6 +992,14 @@ static int __init msm_bus_debugfs_init(void)
 		clients, NULL, &msm_bus_dbg_dump_clients_fops) == NULL)
 		goto err;
 
+	if (debugfs_create_file("arb_stats", S_IRUGO, clients, NULL,
+		&msm_bus_dbg_arb_stats_fops) == NULL)
+		goto err;
+
+	if (debugfs_create_file("residency", S_IRUGO | S_IWUSR, dir, NULL,
+		&msm_bus_dbg_residency_fops) == NULL)
+		goto err;
+
 	mutex_lock(&msm_bus_dbg_fablist_lock);
 	list_for_each_entry(fablist, &fabdata_list, list) {
 		fablist->file = debugfs_create_file(fablist->name, S_IRUGO,
@@ -15,8 +15,11 @@
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/string.h>
 #include <soc/qcom/rpm-smd.h>
 #include <trace/events/trace_msm_bus.h>
 #include "msm_bus_core.h"
@@ -223,9 +226,11 @@ static int setrate_nodeclk(struct nodeclk *nclk, long rate)
 static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 {
 	int ret = 0;
-	int rsc_type;
 	struct msm_rpm_kvp rpm_kvp;
+	struct msm_rpm_message msgs[2];
+	int num_msgs = 0;
 	int rpm_ctx;
+	int i;
 
 	if (!ndev) {
 		MSM_BUS_ERR("%s: Error getting node info.", __func__);
@@ -244,38 +249,37 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 	rpm_kvp.data = (uint8_t *)&ndev->node_bw[ctx].sum_ab;
 
 	if (ndev->node_info->mas_rpm_id != -1) {
-		rsc_type = RPM_BUS_MASTER_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
-			ndev->node_info->mas_rpm_id, &rpm_kvp, 1);
-		if (ret) {
-			MSM_BUS_ERR("%s: Failed to send RPM message:",
-					__func__);
-			MSM_BUS_ERR("%s:Node Id %d RPM id %d",
-			__func__, ndev->node_info->id,
-				 ndev->node_info->mas_rpm_id);
-			goto exit_send_rpm_msg;
-		}
-		trace_bus_agg_bw(ndev->node_info->id,
-			ndev->node_info->mas_rpm_id, rpm_ctx,
-			ndev->node_bw[ctx].sum_ab);
+		msgs[num_msgs].rsc_type = RPM_BUS_MASTER_REQ;
+		msgs[num_msgs++].rsc_id = ndev->node_info->mas_rpm_id;
 	}
 
 	if (ndev->node_info->slv_rpm_id != -1) {
-		rsc_type = RPM_BUS_SLAVE_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
-			ndev->node_info->slv_rpm_id, &rpm_kvp, 1);
-		if (ret) {
-			MSM_BUS_ERR("%s: Failed to send RPM message:",
-						__func__);
-			MSM_BUS_ERR("%s: Node Id %d RPM id %d",
-			__func__, ndev->node_info->id,
-				ndev->node_info->slv_rpm_id);
-			goto exit_send_rpm_msg;
-		}
-		trace_bus_agg_bw(ndev->node_info->id,
-			ndev->node_info->slv_rpm_id, rpm_ctx,
-			ndev->node_bw[ctx].sum_ab);
+		msgs[num_msgs].rsc_type = RPM_BUS_SLAVE_REQ;
+		msgs[num_msgs++].rsc_id = ndev->node_info->slv_rpm_id;
 	}
+
+	if (!num_msgs)
+		goto exit_send_rpm_msg;
+
+	for (i = 0; i < num_msgs; i++) {
+		msgs[i].set = rpm_ctx;
+		msgs[i].kvp = &rpm_kvp;
+		msgs[i].nelems = 1;
+	}
+
+	/* Master and slave votes go out together, with one wait for acks */
+	ret = msm_rpm_send_messages(msgs, num_msgs);
+	if (ret) {
+		MSM_BUS_ERR("%s: Failed to send RPM message:", __func__);
+		MSM_BUS_ERR("%s: Node Id %d RPM ids %d %d", __func__,
+			ndev->node_info->id, ndev->node_info->mas_rpm_id,
+			ndev->node_info->slv_rpm_id);
+		goto exit_send_rpm_msg;
+	}
+
+	for (i = 0; i < num_msgs; i++)
+		trace_bus_agg_bw(ndev->node_info->id, msgs[i].rsc_id,
+				rpm_ctx, ndev->node_bw[ctx].sum_ab);
 exit_send_rpm_msg:
 	return ret;
 }
@@ -328,6 +332,238 @@ exit_flush_bw_data:
 
 }
 
+#define MSM_BUS_RES_OTHER	ULLONG_MAX
+
+static void msm_bus_res_init(struct msm_bus_residency *res, uint64_t *rate,
+						const char **voter)
+{
+	ktime_t now = ktime_get();
+	int ctx, i;
+
+	memset(res, 0, sizeof(*res));
+	for (ctx = 0; ctx < NUM_CTX; ctx++) {
+		res->since[ctx] = now;
+		res->voter_since[ctx] = now;
+		res->num_levels[ctx] = 1;
+		res->levels[ctx][0].rate = rate ? rate[ctx] : 0;
+		res->levels[ctx][0].entries = 1;
+		res->cur_voter[ctx] = -1;
+		if (!voter || !voter[ctx])
+			continue;
+
+		for (i = 0; i < res->num_voters; i++)
+			if (!strcmp(res->voters[i].name, voter[ctx]))
+				break;
+		if (i == res->num_voters)
+			strlcpy(res->voters[res->num_voters++].name,
+					voter[ctx], MSM_BUS_RES_NAME);
+		res->cur_voter[ctx] = i;
+	}
+}
+
+static struct msm_bus_residency *msm_bus_res_get(
+				struct msm_bus_node_device_type *node)
+{
+	if (!node->res) {
+		node->res = devm_kzalloc(&node->dev, sizeof(*node->res),
+								GFP_KERNEL);
+		if (node->res)
+			msm_bus_res_init(node->res, NULL, NULL);
+	}
+	return node->res;
+}
+
+/* Account the time at the old clock rate and move to the new one */
+static void msm_bus_res_set_rate(struct msm_bus_node_device_type *node,
+						int ctx, uint64_t rate)
+{
+	struct msm_bus_residency *res = msm_bus_res_get(node);
+	struct msm_bus_res_level *levels;
+	ktime_t now = ktime_get();
+	int i;
+
+	if (!res)
+		return;
+
+	levels = res->levels[ctx];
+	levels[res->cur_level[ctx]].time_ns +=
+			ktime_to_ns(ktime_sub(now, res->since[ctx]));
+	res->since[ctx] = now;
+
+	for (i = 0; i < res->num_levels[ctx]; i++)
+		if (levels[i].rate == rate)
+			break;
+
+	if (i == res->num_levels[ctx]) {
+		if (i < MSM_BUS_RES_LEVELS - 1) {
+			levels[i].rate = rate;
+			res->num_levels[ctx]++;
+		} else {
+			i = MSM_BUS_RES_LEVELS - 1;
+			levels[i].rate = MSM_BUS_RES_OTHER;
+			res->num_levels[ctx] = MSM_BUS_RES_LEVELS;
+		}
+	}
+	res->cur_level[ctx] = i;
+	levels[i].entries++;
+}
+
+/* Account the time for the old dominant voter and switch to @name */
+static void msm_bus_res_set_voter(struct msm_bus_node_device_type *node,
+						int ctx, const char *name)
+{
+	struct msm_bus_residency *res = msm_bus_res_get(node);
+	ktime_t now = ktime_get();
+	int cur, i;
+
+	if (!res)
+		return;
+
+	cur = res->cur_voter[ctx];
+	if (cur < 0 && !name)
+		return;
+	if (cur >= 0 && name && !strncmp(res->voters[cur].name, name,
+						MSM_BUS_RES_NAME - 1))
+		return;
+
+	if (cur >= 0)
+		res->voters[cur].time_ns[ctx] +=
+			ktime_to_ns(ktime_sub(now, res->voter_since[ctx]));
+	res->voter_since[ctx] = now;
+	res->cur_voter[ctx] = -1;
+	if (!name)
+		return;
+
+	for (i = 0; i < res->num_voters; i++)
+		if (!strncmp(res->voters[i].name, name, MSM_BUS_RES_NAME - 1))
+			break;
+
+	if (i == res->num_voters) {
+		if (i < MSM_BUS_RES_VOTERS - 1) {
+			strlcpy(res->voters[i].name, name, MSM_BUS_RES_NAME);
+			res->num_voters++;
+		} else {
+			i = MSM_BUS_RES_VOTERS - 1;
+			strlcpy(res->voters[i].name, "other",
+							MSM_BUS_RES_NAME);
+			res->num_voters = MSM_BUS_RES_VOTERS;
+		}
+	}
+	res->cur_voter[ctx] = i;
+}
+
+static int msm_bus_res_show_node(struct device *dev, void *data)
+{
+	struct msm_bus_node_device_type *node = to_msm_bus_node(dev);
+	struct msm_bus_residency *res = node->res;
+	struct seq_file *m = data;
+	ktime_t now = ktime_get();
+	uint64_t ns[NUM_CTX], total;
+	char rate[24];
+	int ctx, i;
+
+	if (!res)
+		return 0;
+
+	seq_printf(m, "%s (%d)\n", node->node_info->name,
+						node->node_info->id);
+	for (ctx = 0; ctx < NUM_CTX; ctx++) {
+		struct msm_bus_res_level *levels = res->levels[ctx];
+		uint64_t cur_ns = ktime_to_ns(ktime_sub(now,
+							res->since[ctx]));
+
+		total = cur_ns;
+		for (i = 0; i < res->num_levels[ctx]; i++)
+			total += levels[i].time_ns;
+
+		seq_printf(m, "  %s\n", ctx == ACTIVE_CTX ? "active" : "sleep");
+		for (i = 0; i < res->num_levels[ctx]; i++) {
+			ns[0] = levels[i].time_ns;
+			if (i == res->cur_level[ctx])
+				ns[0] += cur_ns;
+			if (levels[i].rate == MSM_BUS_RES_OTHER)
+				strlcpy(rate, "other", sizeof(rate));
+			else
+				scnprintf(rate, sizeof(rate), "%llu",
+							levels[i].rate);
+			seq_printf(m, "    %12s Hz %12llu ms %3llu%% %8u%s\n",
+				rate, div64_u64(ns[0], NSEC_PER_MSEC),
+				total ? div64_u64(ns[0] * 100, total) : 0,
+				levels[i].entries,
+				i == res->cur_level[ctx] ? " *" : "");
+		}
+	}
+
+	if (!res->num_voters)
+		return 0;
+
+	seq_printf(m, "  %-32s %12s %12s\n", "dominant ib voter", "active ms",
+								"sleep ms");
+	for (i = 0; i < res->num_voters; i++) {
+		for (ctx = 0; ctx < NUM_CTX; ctx++) {
+			ns[ctx] = res->voters[i].time_ns[ctx];
+			if (res->cur_voter[ctx] == i)
+				ns[ctx] += ktime_to_ns(ktime_sub(now,
+						res->voter_since[ctx]));
+		}
+		seq_printf(m, "  %-32s %12llu %12llu\n",
+			res->voters[i].name,
+			div64_u64(ns[ACTIVE_CTX], NSEC_PER_MSEC),
+			div64_u64(ns[DUAL_CTX], NSEC_PER_MSEC));
+	}
+	return 0;
+}
+
+/**
+ * msm_bus_residency_show() - Print clock level and dominant voter residency
+ * @m: seq_file to print to
+ *
+ * Only nodes whose clocks or votes have changed since boot, or since the
+ * last reset, are listed. The current level is marked with a '*'.
+ */
+void msm_bus_residency_show(struct seq_file *m)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	bus_for_each_dev(&msm_bus_type, NULL, m, msm_bus_res_show_node);
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static int msm_bus_res_reset_node(struct device *dev, void *data)
+{
+	struct msm_bus_node_device_type *node = to_msm_bus_node(dev);
+	struct msm_bus_residency *res = node->res;
+	const char *voter[NUM_CTX];
+	char names[NUM_CTX][MSM_BUS_RES_NAME];
+	uint64_t rate[NUM_CTX];
+	int ctx;
+
+	if (!res)
+		return 0;
+
+	for (ctx = 0; ctx < NUM_CTX; ctx++) {
+		rate[ctx] = res->levels[ctx][res->cur_level[ctx]].rate;
+		voter[ctx] = NULL;
+		if (res->cur_voter[ctx] >= 0) {
+			strlcpy(names[ctx],
+				res->voters[res->cur_voter[ctx]].name,
+				MSM_BUS_RES_NAME);
+			voter[ctx] = names[ctx];
+		}
+	}
+	msm_bus_res_init(res, rate, voter);
+	return 0;
+}
+
+/**
+ * msm_bus_residency_reset() - Restart residency accounting from now
+ */
+void msm_bus_residency_reset(void)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	bus_for_each_dev(&msm_bus_type, NULL, NULL, msm_bus_res_reset_node);
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
 static int flush_clk_data(struct msm_bus_node_device_type *node, int ctx)
 {
 	struct nodeclk *nodeclk = NULL;
@@ -345,7 +581,7 @@ static int flush_clk_data(struct msm_bus_node_device_type *node, int ctx)
 		goto exit_flush_clk_data;
 
 	if (nodeclk->rate != node->node_bw[ctx].cur_clk_hz) {
-		long rounded_rate;
+		long rounded_rate = 0;
 
 		nodeclk->rate = node->node_bw[ctx].cur_clk_hz;
 		nodeclk->dirty = true;
@@ -386,6 +622,8 @@ static int flush_clk_data(struct msm_bus_node_device_type *node, int ctx)
 		}
 		MSM_BUS_DBG("%s: Updated %d clk to %llu", __func__,
 				node->node_info->id, nodeclk->rate);
+		msm_bus_res_set_rate(node, ctx,
+				rounded_rate > 0 ? rounded_rate : 0);
 	}
 exit_flush_clk_data:
 	/* Reset the aggregated clock rate for fab devices*/
@@ -458,6 +696,10 @@ static void msm_bus_log_fab_max_votes(struct msm_bus_node_device_type *bus_dev)
 		}
 	}
 
+	for (ctx = 0; ctx < NUM_CTX; ctx++)
+		msm_bus_res_set_voter(bus_dev, ctx,
+				bus_dev->node_bw[ctx].max_ib_cl_name);
+
 	ts = ktime_to_timespec(ktime_get());
 	for (ctx = 0; ctx < NUM_CTX; ctx++) {
 		trace_bus_max_votes((int)ts.tv_sec, (int)ts.tv_nsec,
@@ -25,6 +25,7 @@
 #include <linux/module.h>
 #include <linux/input.h>
 #include <linux/kthread.h>
+#include <linux/irq_work.h>
 
 static unsigned int use_input_evts_with_hi_slvt_detect;
 static struct mutex managed_cpus_lock;
@@ -160,6 +161,21 @@ static unsigned int aggr_mode;
 
 static struct task_struct *notify_thread;
 
+/*
+ * With window_detect set, loads are sampled from the scheduler's window
+ * rollover instead of the governor load notifier, so no CPU is woken up
+ * just to sample it. Rollover runs with the rq lock held, so the notify
+ * thread is kicked through irq_work.
+ */
+static bool window_detect = true;
+module_param(window_detect, bool, 0644);
+
+static struct irq_work notify_irq_work;
+/* sched_clock() of the oldest change not yet notified, 0 if none */
+static atomic64_t notify_req_ts = ATOMIC64_INIT(0);
+static u64 notify_last_lat_ns;
+static u64 notify_max_lat_ns;
+
 static struct input_handler *handler;
 
 /* CPU workload detection related */
@@ -1539,9 +1555,20 @@ static ssize_t show_aggr_iobusy(struct kobject *kobj,
 static struct kobj_attribute aggr_iobusy_attr =
 __ATTR(aggr_iobusy, 0444, show_aggr_iobusy, NULL);
 
+static ssize_t show_notify_latency_us(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "last=%llu max=%llu\n",
+			div64_u64(READ_ONCE(notify_last_lat_ns), NSEC_PER_USEC),
+			div64_u64(READ_ONCE(notify_max_lat_ns), NSEC_PER_USEC));
+}
+static struct kobj_attribute notify_latency_us_attr =
+__ATTR(notify_latency_us, 0444, show_notify_latency_us, NULL);
+
 static struct attribute *attrs[] = {
 	&aggr_mode_attr.attr,
 	&aggr_iobusy_attr.attr,
+	&notify_latency_us_attr.attr,
 	NULL,
 };
 
@@ -1640,9 +1667,22 @@ static bool check_notify_status(void)
 	return any_change;
 }
 
+static void notify_irq_work_fn(struct irq_work *work)
+{
+	wake_up_process(notify_thread);
+}
+
+static void kick_notify_thread(void)
+{
+	atomic64_cmpxchg(&notify_req_ts, 0, sched_clock());
+	irq_work_queue(&notify_irq_work);
+}
+
 static int notify_userspace(void *data)
 {
 	unsigned int i, io, cpu_mode, perf_cl_peak_mode;
+	bool notified;
+	u64 req_ts, lat;
 
 	while (1) {
 		set_current_state(TASK_INTERRUPTIBLE);
@@ -1654,6 +1694,8 @@ static int notify_userspace(void *data)
 		}
 		set_current_state(TASK_RUNNING);
 
+		req_ts = atomic64_xchg(&notify_req_ts, 0);
+		notified = false;
 		io = 0;
 		cpu_mode = 0;
 		perf_cl_peak_mode = 0;
@@ -1665,12 +1707,14 @@ static int notify_userspace(void *data)
 		if (io != aggr_iobusy) {
 			aggr_iobusy = io;
 			sysfs_notify(mode_kobj, NULL, "aggr_iobusy");
+			notified = true;
 			pr_debug("msm_perf: Notifying IO: %u\n", aggr_iobusy);
 		}
 		if ((aggr_mode & (SINGLE | MULTI)) != cpu_mode) {
 			aggr_mode &= ~(SINGLE | MULTI);
 			aggr_mode |= cpu_mode;
 			sysfs_notify(mode_kobj, NULL, "aggr_mode");
+			notified = true;
 			pr_debug("msm_perf: Notifying CPU mode:%u\n",
 								aggr_mode);
 		}
@@ -1678,9 +1722,16 @@ static int notify_userspace(void *data)
 			aggr_mode &= ~(PERF_CL_PEAK);
 			aggr_mode |= perf_cl_peak_mode;
 			sysfs_notify(mode_kobj, NULL, "aggr_mode");
+			notified = true;
 			pr_debug("msm_perf: Notifying Gaming mode:%u\n",
 								aggr_mode);
 		}
+		if (notified && req_ts) {
+			lat = sched_clock() - req_ts;
+			WRITE_ONCE(notify_last_lat_ns, lat);
+			if (lat > notify_max_lat_ns)
+				WRITE_ONCE(notify_max_lat_ns, lat);
+		}
 	}
 
 	return 0;
@@ -1794,7 +1845,7 @@ static void check_cluster_iowait(struct cluster *cl, u64 now)
 
 	spin_unlock_irqrestore(&cl->iowait_lock, flags);
 	if (cl->io_change)
-		wake_up_process(notify_thread);
+		kick_notify_thread();
 }
 
 static void disable_timer(struct cluster *cl)
@@ -2081,7 +2132,7 @@ static void check_perf_cl_peak_load(struct cluster *cl, u64 now)
 	spin_unlock_irqrestore(&cl->perf_cl_peak_lock, flags);
 
 	if (cl->perf_cl_detect_state_change)
-		wake_up_process(notify_thread);
+		kick_notify_thread();
 
 }
 
@@ -2189,7 +2240,7 @@ static void check_cpu_load(struct cluster *cl, u64 now)
 	spin_unlock_irqrestore(&cl->mode_lock, flags);
 
 	if (cl->mode_change)
-		wake_up_process(notify_thread);
+		kick_notify_thread();
 }
 
 static void check_workload_stats(unsigned int cpu, unsigned int rate, u64 now)
@@ -2220,7 +2271,7 @@ static int perf_govinfo_notify(struct notifier_block *nb, unsigned long val,
 	struct load_stats *cpu_st = &per_cpu(cpu_load_stats, cpu);
 	u64 now, cur_iowait, time_diff, iowait_diff;
 
-	if (!clusters_inited || !workload_detect)
+	if (!clusters_inited || !workload_detect || window_detect)
 		return NOTIFY_OK;
 
 	cur_iowait = get_cpu_iowait_time_us(cpu, &now);
@@ -2293,6 +2344,51 @@ static int perf_cputrans_notify(struct notifier_block *nb, unsigned long val,
 	return NOTIFY_OK;
 }
 
+#ifdef CONFIG_SCHED_HMP
+static int perf_window_notify(struct notifier_block *nb, unsigned long val,
+								void *data)
+{
+	struct sched_window_stats *stats = data;
+	unsigned int cpu = stats->cpu;
+	struct load_stats *cpu_st = &per_cpu(cpu_load_stats, cpu);
+	u64 now, cur_iowait, time_diff, iowait_diff;
+
+	if (!clusters_inited || !workload_detect || !window_detect)
+		return NOTIFY_OK;
+
+	cur_iowait = get_cpu_iowait_time_us(cpu, &now);
+	if (cur_iowait >= cpu_st->last_iowait)
+		iowait_diff = cur_iowait - cpu_st->last_iowait;
+	else
+		iowait_diff = 0;
+
+	if (now > cpu_st->last_wallclock)
+		time_diff = now - cpu_st->last_wallclock;
+	else
+		return NOTIFY_OK;
+
+	if (iowait_diff <= time_diff) {
+		iowait_diff *= 100;
+		cpu_st->last_iopercent = div64_u64(iowait_diff, time_diff);
+	} else {
+		cpu_st->last_iopercent = 100;
+	}
+
+	cpu_st->last_wallclock = now;
+	cpu_st->last_iowait = cur_iowait;
+	cpu_st->cpu_load = min_t(u64, 100, div64_u64(stats->prev_busy * 100,
+						     stats->window_size));
+
+	check_workload_stats(cpu, stats->window_size / NSEC_PER_USEC, now);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block perf_window_nb = {
+	.notifier_call = perf_window_notify,
+};
+#endif
+
 static struct notifier_block perf_govinfo_nb = {
 	.notifier_call = perf_govinfo_notify,
 };
@@ -2588,7 +2684,7 @@ static void single_mod_exit_timer(unsigned long data)
 			i_cl->timer_rate, i_cl->mode);
 	}
 	spin_unlock_irqrestore(&i_cl->mode_lock, flags);
-	wake_up_process(notify_thread);
+	kick_notify_thread();
 }
 
 static void perf_cl_peak_mod_exit_timer(unsigned long data)
@@ -2619,7 +2715,7 @@ static void perf_cl_peak_mod_exit_timer(unsigned long data)
 		i_cl->perf_cl_peak_exit_cycle_cnt = 0;
 	}
 	spin_unlock_irqrestore(&i_cl->perf_cl_peak_lock, flags);
-	wake_up_process(notify_thread);
+	kick_notify_thread();
 }
 
 static int init_cluster_control(void)
@@ -2782,6 +2878,11 @@ static int __init msm_performance_init(void)
 	cpufreq_register_notifier(&perf_govinfo_nb, CPUFREQ_GOVINFO_NOTIFIER);
 	cpufreq_register_notifier(&perf_cputransitions_nb,
 					CPUFREQ_TRANSITION_NOTIFIER);
+	init_irq_work(&notify_irq_work, notify_irq_work_fn);
+#ifdef CONFIG_SCHED_HMP
+	atomic_notifier_chain_register(&sched_window_notifier_head,
+				       &perf_window_nb);
+#endif
 
 	for_each_present_cpu(cpu)
 		per_cpu(cpu_stats, cpu).max = UINT_MAX;
@@ -32,6 +32,8 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <soc/qcom/boot_stats.h>
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/secure_buffer.h>
@@ -69,6 +71,16 @@ static void __iomem *pil_minidump_base;
 static int proxy_timeout_ms = -1;
 module_param(proxy_timeout_ms, int, S_IRUGO | S_IWUSR);
 
+/**
+ * load_threads - Number of segments read from the filesystem at once
+ * 0 or 1: Load segments one after another
+ * >1: Read segments in parallel, verification still runs in order
+ */
+static unsigned int load_threads = 4;
+module_param(load_threads, uint, S_IRUGO);
+
+static struct workqueue_struct *pil_load_wq;
+
 static bool disable_timeouts;
 static const char firmware_error_msg[] = "firmware_error\n";
 /**
@@ -101,6 +113,10 @@ struct boot_minidump_smem_region {
  * @filesz: size of segment on disk
  * @num: segment number
  * @relocated: true if segment is relocated, false otherwise
+ * @desc: descriptor the segment is loaded for
+ * @work: work item reading the segment on pil_load_wq
+ * @done: completed once @work has finished
+ * @ret: result of reading the segment
  *
  * Loosely based on an elf program header. Contains all necessary information
  * to load and initialize a segment of the image in memory.
@@ -112,6 +128,27 @@ struct pil_seg {
 	int num;
 	struct list_head list;
 	bool relocated;
+	struct pil_desc *desc;
+	struct work_struct work;
+	struct completion done;
+	int ret;
+};
+
+enum pil_boot_stage {
+	PIL_STAGE_MDT,
+	PIL_STAGE_INIT,
+	PIL_STAGE_LOAD,
+	PIL_STAGE_AUTH,
+	PIL_STAGE_TOTAL,
+	PIL_STAGE_NR,
+};
+
+static const char * const pil_stage_names[PIL_STAGE_NR] = {
+	[PIL_STAGE_MDT]		= "mdt",
+	[PIL_STAGE_INIT]	= "init",
+	[PIL_STAGE_LOAD]	= "load",
+	[PIL_STAGE_AUTH]	= "auth",
+	[PIL_STAGE_TOTAL]	= "total",
 };
 
 /**
@@ -794,7 +831,7 @@ static void unmap_fw_mem(void *vaddr, size_t size, void *data)
 	dma_unremap(info->dev, vaddr, size);
 }
 
-static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
+static int pil_load_seg_data(struct pil_desc *desc, struct pil_seg *seg)
 {
 	int ret = 0, count;
 	phys_addr_t paddr;
@@ -851,6 +888,14 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		paddr += size;
 	}
 
+	return 0;
+}
+
+static int pil_verify_seg(struct pil_desc *desc, struct pil_seg *seg)
+{
+	int ret = 0;
+	int num = seg->num;
+
 	if (desc->ops->verify_blob) {
 		ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
 		if (ret) {
@@ -863,6 +908,54 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 	return ret;
 }
 
+static void pil_load_seg_work(struct work_struct *work)
+{
+	struct pil_seg *seg = container_of(work, struct pil_seg, work);
+
+	seg->ret = pil_load_seg_data(seg->desc, seg);
+	complete(&seg->done);
+}
+
+/*
+ * Read all segments in parallel on pil_load_wq. verify_blob() tells the
+ * authenticator about segments in order, so it runs here as each segment
+ * lands, overlapping with the reads of the segments after it.
+ */
+static int pil_load_segs(struct pil_desc *desc)
+{
+	struct pil_seg *seg;
+	int ret = 0;
+
+	if (!pil_load_wq) {
+		list_for_each_entry(seg, &desc->priv->segs, list) {
+			ret = pil_load_seg_data(desc, seg);
+			if (!ret)
+				ret = pil_verify_seg(desc, seg);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	list_for_each_entry(seg, &desc->priv->segs, list) {
+		seg->desc = desc;
+		init_completion(&seg->done);
+		INIT_WORK(&seg->work, pil_load_seg_work);
+		queue_work(pil_load_wq, &seg->work);
+	}
+
+	/* Wait for every segment even after an error, they write to memory */
+	list_for_each_entry(seg, &desc->priv->segs, list) {
+		wait_for_completion(&seg->done);
+		if (!ret)
+			ret = seg->ret;
+		if (!ret)
+			ret = pil_verify_seg(desc, seg);
+	}
+
+	return ret;
+}
+
 static int pil_parse_devicetree(struct pil_desc *desc)
 {
 	struct device_node *ofnode = desc->dev->of_node;
@@ -921,7 +1014,11 @@ int pil_boot(struct pil_desc *desc)
 	struct pil_priv *priv = desc->priv;
 	bool mem_protect = false;
 	bool hyp_assign = false;
+	u64 stage_ms[PIL_STAGE_NR];
+	ktime_t start, stage;
+	int nsegs = 0;
 
+	start = stage = ktime_get();
 	if (desc->shutdown_fail)
 		pil_err(desc, "Subsystem shutdown failed previously!\n");
 
@@ -970,6 +1067,8 @@ int pil_boot(struct pil_desc *desc)
 	ret = pil_init_mmap(desc, mdt);
 	if (ret)
 		goto release_fw;
+	stage_ms[PIL_STAGE_MDT] = ktime_ms_delta(ktime_get(), stage);
+	stage = ktime_get();
 
 	desc->priv->unvoted_flag = 0;
 	ret = pil_proxy_vote(desc);
@@ -1010,12 +1109,15 @@ int pil_boot(struct pil_desc *desc)
 		hyp_assign = true;
 	}
 
+	stage_ms[PIL_STAGE_INIT] = ktime_ms_delta(ktime_get(), stage);
+	stage = ktime_get();
+
 	trace_pil_event("before_load_seg", desc);
-	list_for_each_entry(seg, &desc->priv->segs, list) {
-		ret = pil_load_seg(desc, seg);
-		if (ret)
-			goto err_deinit_image;
-	}
+	ret = pil_load_segs(desc);
+	if (ret)
+		goto err_deinit_image;
+	stage_ms[PIL_STAGE_LOAD] = ktime_ms_delta(ktime_get(), stage);
+	stage = ktime_get();
 
 	if (desc->subsys_vmid > 0) {
 		trace_pil_event("before_reclaim_mem", desc);
@@ -1040,6 +1142,17 @@ int pil_boot(struct pil_desc *desc)
 	trace_pil_event("reset_done", desc);
 	pil_info(desc, "Brought out of reset\n");
 	desc->modem_ssr = false;
+
+	stage_ms[PIL_STAGE_AUTH] = ktime_ms_delta(ktime_get(), stage);
+	stage_ms[PIL_STAGE_TOTAL] = ktime_ms_delta(ktime_get(), start);
+	list_for_each_entry(seg, &desc->priv->segs, list)
+		nsegs++;
+	pil_info(desc, "Boot took %llu ms (mdt %llu, init %llu, load %llu for %d segments, auth %llu)\n",
+		stage_ms[PIL_STAGE_TOTAL], stage_ms[PIL_STAGE_MDT],
+		stage_ms[PIL_STAGE_INIT], stage_ms[PIL_STAGE_LOAD], nsegs,
+		stage_ms[PIL_STAGE_AUTH]);
+	boot_stats_subsys(desc->name, pil_stage_names, stage_ms,
+							PIL_STAGE_NR);
 err_auth_and_reset:
 	if (ret && desc->subsys_vmid > 0) {
 		pil_assign_mem_to_linux(desc, priv->region_start,
@@ -1318,6 +1431,12 @@ static int __init msm_pil_init(void)
 		writel_relaxed(0, pil_minidump_base + (i * sizeof(u32)));
 	writel_relaxed(1, pil_minidump_base);
 out:
+	if (load_threads > 1) {
+		pil_load_wq = alloc_workqueue("pil_load",
+				WQ_UNBOUND | WQ_HIGHPRI, load_threads);
+		if (!pil_load_wq)
+			pr_warn("pil: loading segments serially\n");
+	}
 	return register_pm_notifier(&pil_pm_notifier);
 }
 device_initcall(msm_pil_init);
@@ -1325,6 +1444,8 @@ device_initcall(msm_pil_init);
 static void __exit msm_pil_exit(void)
 {
 	unregister_pm_notifier(&pil_pm_notifier);
+	if (pil_load_wq)
+		destroy_workqueue(pil_load_wq);
 	if (pil_info_base)
 		iounmap(pil_info_base);
 	if (pil_minidump_base)
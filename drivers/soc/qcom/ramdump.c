@@ -24,6 +24,8 @@
 #include <linux/uaccess.h>
 #include <linux/elf.h>
 #include <linux/wait.h>
+#include <linux/lz4.h>
+#include <linux/vmalloc.h>
 #include <soc/qcom/ramdump.h>
 #include <linux/dma-mapping.h>
 #include <linux/of.h>
@@ -32,6 +34,43 @@
 #define MAX_STRTBL_SIZE 512
 #define MAX_NAME_LENGTH 16
 
+#define RAMDUMP_LZ4_CHUNK	SZ_1M
+#define RAMDUMP_LZ4_MAX_SLOTS	8
+
+static bool compress;
+module_param(compress, bool, 0644);
+MODULE_PARM_DESC(compress, "LZ4 compress the segments of ELF ramdumps");
+
+struct ramdump_device;
+
+/*
+ * One chunk of segment data in flight: copied out of device memory and
+ * compressed by a worker, then handed to the reader in order.
+ */
+struct ramdump_lz4_slot {
+	struct ramdump_device *rd_dev;
+	struct work_struct work;
+	struct completion done;
+	u64 raw_off;
+	size_t raw_len;
+	char *raw;
+	char *out;
+	void *wrkmem;
+	size_t len;
+	size_t off;
+	int ret;
+};
+
+struct ramdump_lz4 {
+	int nslots;
+	u64 raw_size;
+	u64 comp_size;
+	unsigned long nchunks;
+	unsigned long next_read;
+	loff_t pos;
+	struct ramdump_lz4_slot slots[RAMDUMP_LZ4_MAX_SLOTS];
+};
+
 struct ramdump_device {
 	char name[256];
 
@@ -49,6 +88,7 @@ struct ramdump_device {
 	char *elfcore_buf;
 	struct dma_attrs attrs;
 	bool complete_ramdump;
+	struct ramdump_lz4 *lz4;
 };
 
 static int ramdump_open(struct inode *inode, struct file *filep)
@@ -104,17 +144,246 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
+static void ramdump_copy_aligned(unsigned char *dst, void *device_mem,
+				 size_t size)
+{
+	unsigned long bytes_before, bytes_after;
+
+	if ((unsigned long)device_mem & 0x7) {
+		bytes_before = 8 - ((unsigned long)device_mem & 0x7);
+		bytes_before = min_t(unsigned long, bytes_before, size);
+		memcpy_fromio(dst, device_mem, bytes_before);
+		device_mem += bytes_before;
+		dst += bytes_before;
+		size -= bytes_before;
+	}
+
+	if (size & 0x7) {
+		bytes_after = size & 0x7;
+		memcpy(dst, device_mem, size - bytes_after);
+		device_mem += size - bytes_after;
+		dst += (size - bytes_after);
+		memcpy_fromio(dst, device_mem, bytes_after);
+	} else
+		memcpy(dst, device_mem, size);
+}
+
+/* Copy len bytes of segment data, starting at offset, into buf */
+static int ramdump_copy_segments(struct ramdump_device *rd_dev, u64 offset,
+				 char *buf, size_t len)
+{
+	unsigned long addr, data_left;
+	void *vaddr, *device_mem;
+	size_t copy_size;
+
+	while (len) {
+		addr = offset_translate(offset, rd_dev, &data_left, &vaddr);
+		if (!data_left)
+			return -EINVAL;
+
+		copy_size = min_t(size_t, len, data_left);
+		copy_size = min_t(size_t, copy_size, MAX_IOREMAP_SIZE);
+		device_mem = vaddr ?: dma_remap(rd_dev->device.parent, NULL,
+					addr, copy_size, &rd_dev->attrs);
+		if (!device_mem) {
+			pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %zd\n",
+				rd_dev->name, addr, copy_size);
+			return -ENOMEM;
+		}
+
+		ramdump_copy_aligned(buf, device_mem, copy_size);
+
+		if (!vaddr)
+			dma_unremap(rd_dev->device.parent, device_mem,
+				    copy_size);
+
+		offset += copy_size;
+		buf += copy_size;
+		len -= copy_size;
+	}
+
+	return 0;
+}
+
+static void ramdump_lz4_work(struct work_struct *work)
+{
+	struct ramdump_lz4_slot *slot = container_of(work,
+				struct ramdump_lz4_slot, work);
+	struct ramdump_lz4_block *blk = (struct ramdump_lz4_block *)slot->out;
+	int comp_len;
+
+	slot->ret = ramdump_copy_segments(slot->rd_dev, slot->raw_off,
+					  slot->raw, slot->raw_len);
+	if (slot->ret)
+		goto done;
+
+	comp_len = LZ4_compress_default(slot->raw, (char *)(blk + 1),
+			slot->raw_len, LZ4_COMPRESSBOUND(RAMDUMP_LZ4_CHUNK),
+			slot->wrkmem);
+
+	/* Chunks that do not shrink are stored as they are */
+	if (comp_len <= 0 || comp_len >= slot->raw_len) {
+		comp_len = slot->raw_len;
+		memcpy(blk + 1, slot->raw, comp_len);
+	}
+
+	blk->magic = cpu_to_le32(RAMDUMP_LZ4_MAGIC);
+	blk->comp_len = cpu_to_le32(comp_len);
+	blk->raw_len = cpu_to_le32(slot->raw_len);
+	blk->reserved = 0;
+	slot->len = sizeof(*blk) + comp_len;
+	slot->off = 0;
+done:
+	complete_all(&slot->done);
+}
+
+static void ramdump_lz4_queue(struct ramdump_lz4 *lz4,
+			      struct ramdump_lz4_slot *slot,
+			      unsigned long chunk)
+{
+	slot->raw_off = (u64)chunk * RAMDUMP_LZ4_CHUNK;
+	slot->raw_len = min_t(u64, RAMDUMP_LZ4_CHUNK,
+			      lz4->raw_size - slot->raw_off);
+	reinit_completion(&slot->done);
+	queue_work(system_unbound_wq, &slot->work);
+}
+
+static void ramdump_lz4_stop(struct ramdump_device *rd_dev)
+{
+	struct ramdump_lz4 *lz4 = rd_dev->lz4;
+	int i;
+
+	if (!lz4)
+		return;
+
+	for (i = 0; i < lz4->nslots; i++) {
+		flush_work(&lz4->slots[i].work);
+		vfree(lz4->slots[i].raw);
+		vfree(lz4->slots[i].out);
+		vfree(lz4->slots[i].wrkmem);
+	}
+
+	if (lz4->next_read == lz4->nchunks)
+		pr_info("Ramdump(%s): compressed %llu bytes to %llu\n",
+			rd_dev->name, lz4->raw_size, lz4->comp_size);
+
+	kfree(lz4);
+	rd_dev->lz4 = NULL;
+}
+
+/*
+ * Set up compression of the segments, and get the first chunks going on
+ * as many CPUs as there are slots before userspace starts reading.
+ */
+static int ramdump_lz4_start(struct ramdump_device *rd_dev)
+{
+	struct ramdump_lz4 *lz4;
+	struct ramdump_lz4_slot *slot;
+	int i, nslots;
+
+	lz4 = kzalloc(sizeof(*lz4), GFP_KERNEL);
+	if (!lz4)
+		return -ENOMEM;
+	rd_dev->lz4 = lz4;
+
+	for (i = 0; i < rd_dev->nsegments; i++)
+		lz4->raw_size += rd_dev->segments[i].size;
+	lz4->nchunks = DIV_ROUND_UP_ULL(lz4->raw_size, RAMDUMP_LZ4_CHUNK);
+	lz4->pos = rd_dev->elfcore_size;
+
+	nslots = clamp_t(int, num_online_cpus(), 1, RAMDUMP_LZ4_MAX_SLOTS);
+	nslots = min_t(unsigned long, nslots, lz4->nchunks);
+
+	init_dma_attrs(&rd_dev->attrs);
+	dma_set_attr(DMA_ATTR_SKIP_ZEROING, &rd_dev->attrs);
+
+	for (i = 0; i < nslots; i++) {
+		slot = &lz4->slots[i];
+		slot->rd_dev = rd_dev;
+		INIT_WORK(&slot->work, ramdump_lz4_work);
+		init_completion(&slot->done);
+		lz4->nslots++;
+
+		slot->raw = vmalloc(RAMDUMP_LZ4_CHUNK);
+		slot->out = vmalloc(sizeof(struct ramdump_lz4_block) +
+				    LZ4_COMPRESSBOUND(RAMDUMP_LZ4_CHUNK));
+		slot->wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+		if (!slot->raw || !slot->out || !slot->wrkmem) {
+			ramdump_lz4_stop(rd_dev);
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < lz4->nslots; i++)
+		ramdump_lz4_queue(lz4, &lz4->slots[i], i);
+
+	return 0;
+}
+
+static ssize_t ramdump_lz4_read(struct ramdump_device *rd_dev,
+				char __user *buf, size_t count, loff_t *pos)
+{
+	struct ramdump_lz4 *lz4 = rd_dev->lz4;
+	struct ramdump_lz4_slot *slot;
+	unsigned long chunk;
+	size_t copy_size;
+
+	/* Block boundaries are only known to the reader, so no seeking */
+	if (*pos != lz4->pos) {
+		pr_err("Ramdump(%s): Compressed dump must be read in order\n",
+			rd_dev->name);
+		rd_dev->ramdump_status = -1;
+		return -EINVAL;
+	}
+
+	/* EOF check */
+	if (lz4->next_read == lz4->nchunks) {
+		pr_debug("Ramdump(%s): Ramdump complete. %lld bytes read.",
+			rd_dev->name, *pos);
+		rd_dev->ramdump_status = 0;
+		return 0;
+	}
+
+	slot = &lz4->slots[lz4->next_read % lz4->nslots];
+	wait_for_completion(&slot->done);
+	if (slot->ret) {
+		rd_dev->ramdump_status = -1;
+		return slot->ret;
+	}
+
+	copy_size = min(count, slot->len - slot->off);
+	if (copy_to_user(buf, slot->out + slot->off, copy_size)) {
+		pr_err("Ramdump(%s): Couldn't copy all data to user.",
+			rd_dev->name);
+		rd_dev->ramdump_status = -1;
+		return -EFAULT;
+	}
+	slot->off += copy_size;
+	*pos += copy_size;
+	lz4->pos = *pos;
+
+	/* Chunk fully read, reuse the slot for the next one not queued */
+	if (slot->off == slot->len) {
+		lz4->comp_size += slot->len;
+		chunk = lz4->next_read++ + lz4->nslots;
+		if (chunk < lz4->nchunks)
+			ramdump_lz4_queue(lz4, slot, chunk);
+	}
+
+	return copy_size;
+}
+
 static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 			loff_t *pos)
 {
 	struct ramdump_device *rd_dev = container_of(filep->private_data,
 				struct ramdump_device, device);
 	void *device_mem = NULL, *origdevice_mem = NULL, *vaddr = NULL;
-	unsigned long data_left = 0, bytes_before, bytes_after;
+	unsigned long data_left = 0;
 	unsigned long addr = 0;
-	size_t copy_size = 0, alignsize;
-	unsigned char *alignbuf = NULL, *finalbuf = NULL;
-	int ret = 0;
+	size_t copy_size = 0;
+	unsigned char *finalbuf = NULL;
+	ssize_t ret = 0;
 	loff_t orig_pos = *pos;
 
 	if ((filep->f_flags & O_NONBLOCK) && !rd_dev->data_ready)
@@ -139,6 +408,13 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 			return copy_size;
 	}
 
+	if (rd_dev->lz4) {
+		ret = ramdump_lz4_read(rd_dev, buf, count, pos);
+		if (ret > 0)
+			return *pos - orig_pos;
+		goto ramdump_done;
+	}
+
 	addr = offset_translate(*pos - rd_dev->elfcore_size, rd_dev,
 				&data_left, &vaddr);
 
@@ -168,8 +444,8 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 		goto ramdump_done;
 	}
 
-	alignbuf = kzalloc(copy_size, GFP_KERNEL);
-	if (!alignbuf) {
+	finalbuf = kzalloc(copy_size, GFP_KERNEL);
+	if (!finalbuf) {
 		pr_err("Ramdump(%s): Unable to alloc mem for aligned buf\n",
 				rd_dev->name);
 		rd_dev->ramdump_status = -1;
@@ -177,26 +453,7 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 		goto ramdump_done;
 	}
 
-	finalbuf = alignbuf;
-	alignsize = copy_size;
-
-	if ((unsigned long)device_mem & 0x7) {
-		bytes_before = 8 - ((unsigned long)device_mem & 0x7);
-		memcpy_fromio(alignbuf, device_mem, bytes_before);
-		device_mem += bytes_before;
-		alignbuf += bytes_before;
-		alignsize -= bytes_before;
-	}
-
-	if (alignsize & 0x7) {
-		bytes_after = alignsize & 0x7;
-		memcpy(alignbuf, device_mem, alignsize - bytes_after);
-		device_mem += alignsize - bytes_after;
-		alignbuf += (alignsize - bytes_after);
-		alignsize = bytes_after;
-		memcpy_fromio(alignbuf, device_mem, alignsize);
-	} else
-		memcpy(alignbuf, device_mem, alignsize);
+	ramdump_copy_aligned(finalbuf, device_mem, copy_size);
 
 	if (copy_to_user(buf, finalbuf, copy_size)) {
 		pr_err("Ramdump(%s): Couldn't copy all data to user.",
@@ -364,6 +621,10 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 			phdr->p_flags = PF_R | PF_W | PF_X;
 			offset += phdr->p_filesz;
 		}
+
+		if (compress && ramdump_lz4_start(rd_dev))
+			pr_warn("Ramdump(%s): No memory to compress, dumping raw segments\n",
+				rd_dev->name);
 	}
 
 	rd_dev->data_ready = 1;
@@ -386,6 +647,7 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 
 	rd_dev->data_ready = 0;
+	ramdump_lz4_stop(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
@@ -200,6 +200,9 @@ struct slp_buf {
 	char ubuf[MAX_SLEEP_BUFFER];
 	char *buf;
 	bool valid;
+	/* KVPs the RPM already holds for this resource */
+	char sent[MAX_SLEEP_BUFFER];
+	uint32_t sent_len;
 };
 
 enum rpm_msg_fmts {
@@ -774,6 +777,17 @@ static int msm_rpm_flush_requests(bool print)
 		if (!s->valid)
 			continue;
 
+		/*
+		 * The RPM keeps the sleep set between flushes, so skip
+		 * resources that were changed and then changed back.
+		 */
+		if (s->sent_len && s->sent_len == get_data_len(s->buf) &&
+				!memcmp(s->sent, get_first_kvp(s->buf),
+							s->sent_len)) {
+			s->valid = false;
+			continue;
+		}
+
 		set_msg_id(s->buf, msm_rpm_get_next_msg_id());
 
 		if (!glink_enabled)
@@ -786,6 +800,11 @@ static int msm_rpm_flush_requests(bool print)
 		WARN_ON(ret != get_buf_len(s->buf));
 		trace_rpm_smd_send_sleep_set(get_msg_id(s->buf), type, id);
 
+		s->sent_len = 0;
+		if (ret == get_buf_len(s->buf)) {
+			s->sent_len = get_data_len(s->buf);
+			memcpy(s->sent, get_first_kvp(s->buf), s->sent_len);
+		}
 		s->valid = false;
 		count++;
 
@@ -1520,10 +1539,11 @@ static int msm_rpm_send_data(struct msm_rpm_request *cdata,
 	return ret;
 }
 
+static DEFINE_MUTEX(send_mtx);
+
 static int _msm_rpm_send_request(struct msm_rpm_request *handle, bool noack)
 {
 	int ret;
-	static DEFINE_MUTEX(send_mtx);
 
 	mutex_lock(&send_mtx);
 	ret = msm_rpm_send_data(handle, MSM_RPM_MSG_REQUEST_TYPE, false, noack);
@@ -1554,6 +1574,46 @@ void *msm_rpm_send_request_noack(struct msm_rpm_request *handle)
 }
 EXPORT_SYMBOL(msm_rpm_send_request_noack);
 
+int msm_rpm_send_request_batch(struct msm_rpm_request **handles, int count)
+{
+	uint32_t *msg_ids;
+	int i, ret, rc = 0;
+
+	if (count <= 0)
+		return 0;
+
+	msg_ids = kcalloc(count, sizeof(*msg_ids), GFP_KERNEL);
+	if (!msg_ids)
+		return -ENOMEM;
+
+	/*
+	 * Queue every message before waiting on any of them, so that the
+	 * RPM works through the whole batch in one round trip.
+	 */
+	mutex_lock(&send_mtx);
+	for (i = 0; i < count; i++) {
+		ret = msm_rpm_send_data(handles[i], MSM_RPM_MSG_REQUEST_TYPE,
+							false, false);
+		if (ret <= 0) {
+			rc = ret ? ret : -EIO;
+			break;
+		}
+		msg_ids[i] = ret;
+	}
+	mutex_unlock(&send_mtx);
+
+	count = i;
+	for (i = 0; i < count; i++) {
+		ret = msm_rpm_wait_for_ack(msg_ids[i]);
+		if (ret && !rc)
+			rc = ret;
+	}
+
+	kfree(msg_ids);
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_send_request_batch);
+
 int msm_rpm_wait_for_ack(uint32_t msg_id)
 {
 	struct msm_rpm_wait_data *elem;
@@ -1730,6 +1790,69 @@ bail:
 }
 EXPORT_SYMBOL(msm_rpm_send_message);
 
+int msm_rpm_send_messages(struct msm_rpm_message *msgs, int count)
+{
+	struct msm_rpm_request **reqs;
+	int *grp, *nelems;
+	int i, j, nreqs = 0, rc = 0;
+
+	if (count <= 0)
+		return 0;
+
+	reqs = kcalloc(count, sizeof(*reqs), GFP_KERNEL);
+	grp = kcalloc(count, sizeof(*grp), GFP_KERNEL);
+	nelems = kcalloc(count, sizeof(*nelems), GFP_KERNEL);
+	if (!reqs || !grp || !nelems) {
+		rc = -ENOMEM;
+		goto bail;
+	}
+
+	/* Updates to the same resource go out in one message */
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < i; j++)
+			if (msgs[j].set == msgs[i].set &&
+					msgs[j].rsc_type == msgs[i].rsc_type &&
+					msgs[j].rsc_id == msgs[i].rsc_id)
+				break;
+		grp[i] = j < i ? grp[j] : nreqs++;
+		nelems[grp[i]] += msgs[i].nelems;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct msm_rpm_request *req = reqs[grp[i]];
+
+		if (!req) {
+			req = msm_rpm_create_request(msgs[i].set,
+					msgs[i].rsc_type, msgs[i].rsc_id,
+					nelems[grp[i]]);
+			if (IS_ERR_OR_NULL(req)) {
+				rc = req ? PTR_ERR(req) : -ENOMEM;
+				goto bail;
+			}
+			reqs[grp[i]] = req;
+		}
+
+		for (j = 0; j < msgs[i].nelems; j++) {
+			rc = msm_rpm_add_kvp_data(req, msgs[i].kvp[j].key,
+					msgs[i].kvp[j].data,
+					msgs[i].kvp[j].length);
+			if (rc)
+				goto bail;
+		}
+	}
+
+	rc = msm_rpm_send_request_batch(reqs, nreqs);
+bail:
+	if (reqs)
+		for (i = 0; i < nreqs; i++)
+			msm_rpm_free_request(reqs[i]);
+	kfree(nelems);
+	kfree(grp);
+	kfree(reqs);
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_send_messages);
+
 int msm_rpm_send_message_noirq(enum msm_rpm_set set, uint32_t rsc_type,
 		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems)
 {
@@ -21,6 +21,8 @@
 #include <linux/interrupt.h>
 #include <linux/ipc_logging.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <soc/qcom/smem.h>
 #include "smp2p_private_api.h"
 #include "smp2p_private.h"
@@ -1389,6 +1391,75 @@ int msm_smp2p_out_modify(struct msm_smp2p_out *handle, uint32_t set_mask,
 }
 EXPORT_SYMBOL(msm_smp2p_out_modify);
 
+/**
+ * msm_smp2p_out_modify_multi - Modifies several entries with one interrupt.
+ *
+ * @updates: Entries to modify, all on the same remote processor.
+ * @count: Number of elements in @updates.
+ * @returns: 0 on success, standard Linux error code otherwise.
+ *
+ * Each update is applied as msm_smp2p_out_modify() would without sending
+ * an interrupt, in order and under the edge lock so no other local update
+ * lands in between, and the remote processor is then interrupted once.
+ * Nothing is modified unless every entry is open. A write of a whole
+ * entry is a modify with a @clear_mask of ~0.
+ */
+int msm_smp2p_out_modify_multi(struct msm_smp2p_out_update *updates,
+			       int count)
+{
+	struct smp2p_out_list_item *out_item;
+	unsigned long flags;
+	int remote_pid;
+	int ret = 0;
+	int i;
+
+	if (!updates || count <= 0 || !updates[0].handle)
+		return -EINVAL;
+
+	remote_pid = updates[0].handle->remote_pid;
+	for (i = 1; i < count; i++)
+		if (!updates[i].handle ||
+		    updates[i].handle->remote_pid != remote_pid)
+			return -EINVAL;
+
+	if ((remote_pid != SMP2P_REMOTE_MOCK_PROC) &&
+			!smp2p_int_cfgs[remote_pid].is_configured) {
+		SMP2P_INFO("%s before msm_smp2p_init(): pid[%d]\n",
+			__func__, remote_pid);
+		return -EPROBE_DEFER;
+	}
+
+	out_item = &out_list[remote_pid];
+	spin_lock_irqsave(&out_item->out_item_lock_lha1, flags);
+
+	for (i = 0; i < count; i++) {
+		if (!updates[i].handle->l_smp2p_entry) {
+			SMP2P_ERR("%s: '%s':%d not yet OPEN\n", __func__,
+				updates[i].handle->name, remote_pid);
+			ret = -ENODEV;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = out_item->ops_ptr->modify_entry(updates[i].handle,
+				updates[i].set_mask, updates[i].clear_mask,
+				false);
+		if (ret)
+			break;
+	}
+
+	/* the remote must still see the updates that went through */
+	if (i) {
+		smp2p_send_interrupt(remote_pid);
+		smp2p_int_cfgs[remote_pid].out_coalesced_count += i - 1;
+	}
+out:
+	spin_unlock_irqrestore(&out_item->out_item_lock_lha1, flags);
+	return ret;
+}
+EXPORT_SYMBOL(msm_smp2p_out_modify_multi);
+
 /**
  * msm_smp2p_in_read - Read an entry on a remote processor.
  *
@@ -1616,10 +1687,33 @@ static void smp2p_send_interrupt(int remote_pid)
 	}
 }
 
+/**
+ * smp2p_in_lat_account - Adds an inbound latency sample to a histogram.
+ *
+ * @hist: SMP2P_LAT_BUCKETS buckets, the first for samples under 1us, then
+ *        [2^(n-1), 2^n) us, the last one open ended.
+ * @max_us: Largest sample seen, updated.
+ * @ns: Sample in nanoseconds.
+ *
+ * Must be called with in_item_lock_lhb1 locked.
+ */
+static void smp2p_in_lat_account(unsigned *hist, unsigned *max_us, s64 ns)
+{
+	unsigned us = ns > 0 ? div_u64(ns, NSEC_PER_USEC) : 0;
+	unsigned bucket = 0;
+
+	if (us)
+		bucket = min_t(unsigned, ilog2(us) + 1, SMP2P_LAT_BUCKETS - 1);
+	hist[bucket]++;
+	if (us > *max_us)
+		*max_us = us;
+}
+
 /**
  * smp2p_in_edge_notify - Notifies the entry changed on remote processor.
  *
  * @pid: Processor ID of the remote processor.
+ * @irq_ts: Time the interrupt that triggered the scan was taken.
  *
  * This function is invoked on an incoming interrupt, it scans
  * the list of the clients registered for the entries on the remote
@@ -1628,8 +1722,10 @@ static void smp2p_send_interrupt(int remote_pid)
  * Note:  Edge state must be OPENED to avoid a race condition with
  *        out_list[pid].ops_ptr->find_entry.
  */
-static void smp2p_in_edge_notify(int pid)
+static void smp2p_in_edge_notify(int pid, ktime_t irq_ts)
 {
+	struct smp2p_interrupt_config *int_cfg = &smp2p_int_cfgs[pid];
+	ktime_t cb_ts;
 	struct smp2p_in *pos;
 	uint32_t *entry_ptr;
 	unsigned long flags;
@@ -1671,9 +1767,17 @@ static void smp2p_in_edge_notify(int pid)
 				data.previous_value = pos->prev_entry_val;
 				data.current_value = curr_data;
 				pos->prev_entry_val = curr_data;
+				cb_ts = ktime_get();
+				smp2p_in_lat_account(int_cfg->in_notify_hist,
+					&int_cfg->in_notify_max_us,
+					ktime_to_ns(ktime_sub(cb_ts, irq_ts)));
 				raw_notifier_call_chain(
 					&pos->in_notifier_list,
 					SMP2P_ENTRY_UPDATE, (void *)&data);
+				smp2p_in_lat_account(int_cfg->in_cb_hist,
+					&int_cfg->in_cb_max_us,
+					ktime_to_ns(ktime_sub(ktime_get(),
+							      cb_ts)));
 			}
 		}
 	}
@@ -1691,6 +1795,7 @@ static irqreturn_t smp2p_interrupt_handler(int irq, void *data)
 {
 	unsigned long flags;
 	uint32_t remote_pid = (uint32_t)(uintptr_t)data;
+	ktime_t irq_ts = ktime_get();
 
 	if (remote_pid >= SMP2P_NUM_PROCS) {
 		SMP2P_ERR("%s: invalid interrupt pid %d\n",
@@ -1729,7 +1834,7 @@ static irqreturn_t smp2p_interrupt_handler(int irq, void *data)
 		spin_unlock_irqrestore(&out_list[remote_pid].out_item_lock_lha1,
 			flags);
 
-		smp2p_in_edge_notify(remote_pid);
+		smp2p_in_edge_notify(remote_pid, irq_ts);
 
 		if (do_restart_ack) {
 			spin_lock_irqsave(
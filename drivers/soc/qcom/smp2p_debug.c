@@ -51,6 +51,66 @@ static void smp2p_int_stats(struct seq_file *s)
 	}
 }
 
+/**
+ * Dump one inbound latency histogram.
+ *
+ * @s:     pointer to output file
+ * @label: histogram name
+ * @hist:  SMP2P_LAT_BUCKETS buckets
+ * @max:   largest sample in microseconds
+ */
+static void smp2p_lat_hist(struct seq_file *s, const char *label,
+	const unsigned *hist, unsigned max)
+{
+	int i;
+
+	seq_printf(s, "  %-6s max %uus\n", label, max);
+	for (i = 0; i < SMP2P_LAT_BUCKETS; ++i) {
+		if (!hist[i])
+			continue;
+		if (i == 0)
+			seq_puts(s, "    <1us");
+		else if (i == SMP2P_LAT_BUCKETS - 1)
+			seq_printf(s, "    >=%uus", 1U << (i - 1));
+		else
+			seq_printf(s, "    %u-%uus", 1U << (i - 1),
+				(1U << i) - 1);
+		seq_printf(s, ": %u\n", hist[i]);
+	}
+}
+
+/**
+ * Dump inbound latency and outbound coalescing statistics.
+ *
+ * "notify" is the time from the interrupt to the start of an entry's
+ * notifier chain, "cb" is the time spent in that chain.
+ *
+ * @s:   pointer to output file
+ */
+static void smp2p_latency(struct seq_file *s)
+{
+	struct smp2p_interrupt_config *int_cfg;
+	int pid;
+
+	int_cfg = smp2p_get_interrupt_config();
+	if (!int_cfg)
+		return;
+
+	for (pid = 0; pid < SMP2P_NUM_PROCS; ++pid) {
+		if (!int_cfg[pid].is_configured &&
+				pid != SMP2P_REMOTE_MOCK_PROC)
+			continue;
+
+		seq_printf(s, "%s (%d): coalesced out interrupts %u\n",
+			int_cfg[pid].name, pid,
+			int_cfg[pid].out_coalesced_count);
+		smp2p_lat_hist(s, "notify", int_cfg[pid].in_notify_hist,
+			int_cfg[pid].in_notify_max_us);
+		smp2p_lat_hist(s, "cb", int_cfg[pid].in_cb_hist,
+			int_cfg[pid].in_cb_max_us);
+	}
+}
+
 /**
  * Dump item header line 1.
  *
@@ -327,6 +387,7 @@ static int __init smp2p_debugfs_init(void)
 
 	debug_create("int_stats", smp2p_int_stats);
 	debug_create("items", smp2p_items);
+	debug_create("latency", smp2p_latency);
 
 	return 0;
 }
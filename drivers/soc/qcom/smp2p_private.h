@@ -232,6 +232,9 @@ int msm_smp2p_deinit_rmt_lpb_proc(int remote_pid);
 void *smp2p_get_log_ctx(void);
 int smp2p_get_debug_mask(void);
 
+/* Buckets of the inbound latency histograms, see smp2p_in_lat_account() */
+#define SMP2P_LAT_BUCKETS 12
+
 /* Inbound / outbound Interrupt configuration. */
 struct smp2p_interrupt_config {
 	bool is_configured;
@@ -243,6 +246,13 @@ struct smp2p_interrupt_config {
 	/* interrupt stats */
 	unsigned in_interrupt_count;
 	unsigned out_interrupt_count;
+	unsigned out_coalesced_count;
+
+	/* inbound latency, log2 microsecond buckets */
+	unsigned in_notify_hist[SMP2P_LAT_BUCKETS];
+	unsigned in_notify_max_us;
+	unsigned in_cb_hist[SMP2P_LAT_BUCKETS];
+	unsigned in_cb_max_us;
 };
 
 struct smp2p_interrupt_config *smp2p_get_interrupt_config(void);
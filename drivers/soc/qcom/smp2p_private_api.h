@@ -63,6 +63,19 @@ struct msm_smp2p_update_notif {
 	uint32_t current_value;
 };
 
+/**
+ * One entry update of msm_smp2p_out_modify_multi().
+ *
+ * @handle:      entry to modify
+ * @set_mask:    bits to set, applied after @clear_mask
+ * @clear_mask:  bits to clear
+ */
+struct msm_smp2p_out_update {
+	struct msm_smp2p_out *handle;
+	uint32_t set_mask;
+	uint32_t clear_mask;
+};
+
 int msm_smp2p_out_open(int remote_pid, const char *entry,
 	struct notifier_block *open_notifier,
 	struct msm_smp2p_out **handle);
@@ -71,6 +84,8 @@ int msm_smp2p_out_read(struct msm_smp2p_out *handle, uint32_t *data);
 int msm_smp2p_out_write(struct msm_smp2p_out *handle, uint32_t data);
 int msm_smp2p_out_modify(struct msm_smp2p_out *handle, uint32_t set_mask,
 	uint32_t clear_mask, bool send_irq);
+int msm_smp2p_out_modify_multi(struct msm_smp2p_out_update *updates,
+	int count);
 int msm_smp2p_in_read(int remote_pid, const char *entry, uint32_t *data);
 int msm_smp2p_in_register(int remote_pid, const char *entry,
 	struct notifier_block *in_notifier);
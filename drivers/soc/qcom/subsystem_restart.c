@@ -22,6 +22,7 @@
 #include <linux/io.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/suspend.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
@@ -49,6 +50,13 @@ module_param(disable_restart_work, uint, S_IRUGO | S_IWUSR);
 static int enable_debug;
 module_param(enable_debug, int, S_IRUGO | S_IWUSR);
 
+/*
+ * If set, subsystems of a restart order are shut down and powered up
+ * concurrently, honouring depends_on between them.
+ */
+static bool parallel_ssr;
+module_param(parallel_ssr, bool, S_IRUGO | S_IWUSR);
+
 /* The maximum shutdown timeout is the product of MAX_LOOPS and DELAY_MS. */
 #define SHUTDOWN_ACK_MAX_LOOPS	100
 #define SHUTDOWN_ACK_DELAY_MS	100
@@ -127,6 +135,31 @@ struct subsys_soc_restart_order {
 	struct list_head list;
 };
 
+/**
+ * enum ssr_phase - timed phases of a restart sequence
+ * @SSR_PHASE_SHUTDOWN: shutdown of every subsystem in the order
+ * @SSR_PHASE_RAMDUMP: ramdump collection
+ * @SSR_PHASE_FREE_MEMORY: release of subsystem memory
+ * @SSR_PHASE_POWERUP: powerup of every subsystem in the order
+ * @SSR_PHASE_TOTAL: whole sequence including notifications
+ */
+enum ssr_phase {
+	SSR_PHASE_SHUTDOWN,
+	SSR_PHASE_RAMDUMP,
+	SSR_PHASE_FREE_MEMORY,
+	SSR_PHASE_POWERUP,
+	SSR_PHASE_TOTAL,
+	SSR_PHASE_MAX,
+};
+
+static const char * const ssr_phases[] = {
+	[SSR_PHASE_SHUTDOWN] = "shutdown",
+	[SSR_PHASE_RAMDUMP] = "ramdump",
+	[SSR_PHASE_FREE_MEMORY] = "free_memory",
+	[SSR_PHASE_POWERUP] = "powerup",
+	[SSR_PHASE_TOTAL] = "total",
+};
+
 struct restart_log {
 	struct timeval time;
 	struct subsys_device *dev;
@@ -153,6 +186,9 @@ struct restart_log {
  * @err_ready: completion variable to record error ready from subsystem
  * @crashed: indicates if subsystem has crashed
  * @notif_state: current state of subsystem in terms of subsys notifications
+ * @phase_us: duration of each phase of the last restart this device started
+ * @shutdown_us: duration of this device's last shutdown
+ * @powerup_us: duration of this device's last powerup
  */
 struct subsys_device {
 	struct subsys_desc *desc;
@@ -178,6 +214,9 @@ struct subsys_device {
 	enum crash_status crashed;
 	int notif_state;
 	struct list_head list;
+	s64 phase_us[SSR_PHASE_MAX];
+	s64 shutdown_us;
+	s64 powerup_us;
 };
 
 static struct subsys_device *to_subsys(struct device *d)
@@ -304,6 +343,22 @@ static ssize_t system_debug_store(struct device *dev,
 	return orig_count;
 }
 
+static ssize_t restart_timing_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct subsys_device *subsys = to_subsys(dev);
+	int i, len = 0;
+
+	for (i = 0; i < SSR_PHASE_MAX; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %lld\n",
+				ssr_phases[i], subsys->phase_us[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "self_shutdown %lld\n",
+			subsys->shutdown_us);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "self_powerup %lld\n",
+			subsys->powerup_us);
+	return len;
+}
+
 int subsys_get_restart_level(struct subsys_device *dev)
 {
 	return dev->restart_level;
@@ -353,6 +408,7 @@ static struct device_attribute subsys_attrs[] = {
 	__ATTR(restart_level, 0644, restart_level_show, restart_level_store),
 	__ATTR(firmware_name, 0644, firmware_name_show, firmware_name_store),
 	__ATTR(system_debug, 0644, system_debug_show, system_debug_store),
+	__ATTR_RO(restart_timing),
 	__ATTR_NULL,
 };
 
@@ -504,6 +560,102 @@ static int for_each_subsys_device(struct subsys_device **list, unsigned count,
 	return 0;
 }
 
+struct subsys_parallel_work {
+	struct work_struct work;
+	struct subsys_device *dev;
+	void *data;
+	int (*fn)(struct subsys_device *, void *);
+	int level;
+	int ret;
+};
+
+static void subsys_parallel_work_fn(struct work_struct *work)
+{
+	struct subsys_parallel_work *pw = container_of(work,
+					struct subsys_parallel_work, work);
+
+	pw->ret = pw->fn(pw->dev, pw->data);
+}
+
+/*
+ * Number of depends_on links from @dev that stay within @list. Links to
+ * subsystems outside the list do not constrain the order, and a loop is
+ * cut off after @count steps.
+ */
+static int subsys_dep_level(struct subsys_device **list, unsigned count,
+		struct subsys_device *dev)
+{
+	int level = 0;
+	unsigned i;
+
+	while (dev->desc->depends_on && level < count) {
+		for (i = 0; i < count; i++)
+			if (list[i] && !strcmp(list[i]->desc->name,
+					       dev->desc->depends_on))
+				break;
+		if (i == count)
+			break;
+		dev = list[i];
+		level++;
+	}
+	return level;
+}
+
+/*
+ * Like for_each_subsys_device(), but with parallel_ssr set runs @fn for
+ * all subsystems of the same dependency level at once. Levels run in
+ * increasing order, so a subsystem starts after what it depends on, or
+ * in decreasing order if @reverse, so it stops first. Every subsystem of
+ * a level is waited for before the first error in list order is returned.
+ */
+static int for_each_subsys_device_parallel(struct subsys_device **list,
+		unsigned count, void *data,
+		int (*fn)(struct subsys_device *, void *), bool reverse)
+{
+	struct subsys_parallel_work *works;
+	int max_level = 0;
+	int wave, level;
+	int ret = 0;
+	unsigned i;
+
+	if (!parallel_ssr || count < 2)
+		return for_each_subsys_device(list, count, data, fn);
+
+	works = kcalloc(count, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return for_each_subsys_device(list, count, data, fn);
+
+	for (i = 0; i < count; i++) {
+		if (!list[i]) {
+			works[i].level = -1;
+			continue;
+		}
+		INIT_WORK(&works[i].work, subsys_parallel_work_fn);
+		works[i].dev = list[i];
+		works[i].data = data;
+		works[i].fn = fn;
+		works[i].level = subsys_dep_level(list, count, list[i]);
+		max_level = max(max_level, works[i].level);
+	}
+
+	for (wave = 0; wave <= max_level && !ret; wave++) {
+		level = reverse ? max_level - wave : wave;
+		for (i = 0; i < count; i++)
+			if (works[i].level == level)
+				queue_work(system_unbound_wq, &works[i].work);
+		for (i = 0; i < count; i++) {
+			if (works[i].level != level)
+				continue;
+			flush_work(&works[i].work);
+			if (!ret)
+				ret = works[i].ret;
+		}
+	}
+
+	kfree(works);
+	return ret;
+}
+
 static void notify_each_subsys_device(struct subsys_device **list,
 		unsigned count,
 		enum subsys_notif_type notif, void *data)
@@ -608,11 +760,13 @@ static int wait_for_err_ready(struct subsys_device *subsys)
 static int subsystem_shutdown(struct subsys_device *dev, void *data)
 {
 	const char *name = dev->desc->name;
+	ktime_t start = ktime_get();
 	int ret;
 
 	pr_info("[%s:%d]: Shutting down %s\n",
 			current->comm, current->pid, name);
 	ret = dev->desc->shutdown(dev->desc, true);
+	dev->shutdown_us = ktime_us_delta(ktime_get(), start);
 	if (ret < 0) {
 		if (!dev->desc->ignore_ssr_failure) {
 			panic("subsys-restart: [%s:%d]: Failed to shutdown %s!",
@@ -651,6 +805,7 @@ static int subsystem_free_memory(struct subsys_device *dev, void *data)
 static int subsystem_powerup(struct subsys_device *dev, void *data)
 {
 	const char *name = dev->desc->name;
+	ktime_t start = ktime_get();
 	int ret;
 
 	pr_info("[%s:%d]: Powering up %s\n", current->comm, current->pid, name);
@@ -682,6 +837,7 @@ static int subsystem_powerup(struct subsys_device *dev, void *data)
 	}
 	subsys_set_state(dev, SUBSYS_ONLINE);
 	subsys_set_crash_status(dev, CRASH_STATUS_NO_CRASH);
+	dev->powerup_us = ktime_us_delta(ktime_get(), start);
 
 	return 0;
 }
@@ -945,6 +1101,7 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	struct subsys_tracking *track;
 	unsigned count;
 	unsigned long flags;
+	ktime_t start, phase;
 	int ret;
 
 	/*
@@ -992,8 +1149,13 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 
 	pr_debug("[%s:%d]: Starting restart sequence for %s\n",
 			current->comm, current->pid, desc->name);
+	memset(dev->phase_us, 0, sizeof(dev->phase_us));
+	start = ktime_get();
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_SHUTDOWN, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_shutdown);
+	phase = ktime_get();
+	ret = for_each_subsys_device_parallel(list, count, NULL,
+					      subsystem_shutdown, true);
+	dev->phase_us[SSR_PHASE_SHUTDOWN] = ktime_us_delta(ktime_get(), phase);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_SHUTDOWN, NULL);
@@ -1006,15 +1168,24 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	spin_unlock_irqrestore(&track->s_lock, flags);
 
 	/* Collect ram dumps for all subsystems in order here */
+	phase = ktime_get();
 	for_each_subsys_device(list, count, NULL, subsystem_ramdump);
+	dev->phase_us[SSR_PHASE_RAMDUMP] = ktime_us_delta(ktime_get(), phase);
 
+	phase = ktime_get();
 	for_each_subsys_device(list, count, NULL, subsystem_free_memory);
+	dev->phase_us[SSR_PHASE_FREE_MEMORY] =
+			ktime_us_delta(ktime_get(), phase);
 
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_POWERUP, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_powerup);
+	phase = ktime_get();
+	ret = for_each_subsys_device_parallel(list, count, NULL,
+					      subsystem_powerup, false);
+	dev->phase_us[SSR_PHASE_POWERUP] = ktime_us_delta(ktime_get(), phase);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_POWERUP, NULL);
+	dev->phase_us[SSR_PHASE_TOTAL] = ktime_us_delta(ktime_get(), start);
 
 	pr_info("[%s:%d]: Restart sequence for %s completed.\n",
 			current->comm, current->pid, desc->name);
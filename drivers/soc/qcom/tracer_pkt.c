@@ -187,6 +187,32 @@ int tracer_pkt_log_event(void *data, uint32_t event_id)
 }
 EXPORT_SYMBOL(tracer_pkt_log_event);
 
+/**
+ * tracer_pkt_get_base_ts() - get the time the tracer packet was initialized
+ * @data:	Pointer to the buffer containing tracer packet.
+ *
+ * The base timestamp is taken from the arch timer by whoever initialized
+ * the packet, local or remote, so it can be compared against the local
+ * arch timer to get the one way latency of the packet.
+ *
+ * Return: the base timestamp in arch timer ticks, 0 if @data is not a
+ *	   tracer packet.
+ */
+u64 tracer_pkt_get_base_ts(void *data)
+{
+	struct tracer_pkt_hdr *pkt_hdr;
+
+	if (!data)
+		return 0;
+
+	pkt_hdr = (struct tracer_pkt_hdr *)data;
+	if (unlikely(pkt_hdr->version != TRACER_PKT_VERSION))
+		return 0;
+
+	return pkt_hdr->base_ts;
+}
+EXPORT_SYMBOL(tracer_pkt_get_base_ts);
+
 /**
  * tracer_pkt_calc_hex_dump_size() - calculate the hex dump size of a tracer
  *				     packet
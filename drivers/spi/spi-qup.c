@@ -12,14 +12,19 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/pm_runtime.h>
 #include <linux/spi/spi.h>
 #include <linux/dmaengine.h>
@@ -127,6 +132,38 @@
 #define SPI_DELAY_THRESHOLD		1
 #define SPI_DELAY_RETRY			10
 
+/* re-measure the mode that lost the last adaptive decision this often */
+#define SPI_QUP_PROBE_INTERVAL		64
+
+/*
+ * If set, a transfer that could use either DMA or block mode PIO uses
+ * whichever has been cheaper per byte for its spi_device so far.
+ */
+static bool adaptive_dma;
+module_param(adaptive_dma, bool, 0644);
+MODULE_PARM_DESC(adaptive_dma, "Pick DMA or PIO per device from measured cost");
+
+enum spi_qup_xfer_mode {
+	SPI_QUP_PIO,
+	SPI_QUP_DMA,
+	SPI_QUP_NR_MODES,
+};
+
+/*
+ * Per spi_device transfer statistics, kept in spi->controller_state.
+ * ns_per_byte is a running average in 1/16 ns units, one per mode.
+ */
+struct spi_qup_dev_stats {
+	struct list_head	list;
+	struct spi_device	*spi;
+	u64			xfers[SPI_QUP_NR_MODES];
+	u64			bytes[SPI_QUP_NR_MODES];
+	u64			total_ns[SPI_QUP_NR_MODES];
+	u32			max_us[SPI_QUP_NR_MODES];
+	u32			ns_per_byte[SPI_QUP_NR_MODES];
+	u32			decisions;
+};
+
 struct spi_qup {
 	void __iomem		*base;
 	struct device		*dev;
@@ -152,6 +189,12 @@ struct spi_qup {
 	int			use_dma;
 	struct dma_slave_config	rx_conf;
 	struct dma_slave_config	tx_conf;
+
+	u32			speed_hz;	/* last core clock rate set */
+
+	struct mutex		stats_lock;	/* protects dev_stats */
+	struct list_head	dev_stats;
+	struct dentry		*debugfs;
 };
 
 
@@ -479,11 +522,16 @@ static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer)
 		return -EIO;
 	}
 
-	ret = clk_set_rate(controller->cclk, xfer->speed_hz);
-	if (ret) {
-		dev_err(controller->dev, "fail to set frequency %d",
-			xfer->speed_hz);
-		return -EIO;
+	/* back to back transfers to one device mostly share a rate */
+	if (xfer->speed_hz != controller->speed_hz) {
+		ret = clk_set_rate(controller->cclk, xfer->speed_hz);
+		if (ret) {
+			controller->speed_hz = 0;
+			dev_err(controller->dev, "fail to set frequency %d",
+				xfer->speed_hz);
+			return -EIO;
+		}
+		controller->speed_hz = xfer->speed_hz;
 	}
 
 	if (spi_qup_set_state(controller, QUP_STATE_RESET)) {
@@ -608,14 +656,46 @@ static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer)
 	return 0;
 }
 
+static void spi_qup_account(struct spi_device *spi, struct spi_transfer *xfer,
+			    int mode, s64 ns)
+{
+	struct spi_qup_dev_stats *st = spi->controller_state;
+	u32 cost, us;
+
+	if (!st || !xfer->len)
+		return;
+
+	st->xfers[mode]++;
+	st->bytes[mode] += xfer->len;
+	st->total_ns[mode] += ns;
+	us = div_u64(ns, NSEC_PER_USEC);
+	if (us > st->max_us[mode])
+		st->max_us[mode] = us;
+
+	cost = min_t(u64, div_u64(ns * 16, xfer->len), U32_MAX);
+	if (!st->ns_per_byte[mode])
+		st->ns_per_byte[mode] = cost;
+	else
+		st->ns_per_byte[mode] += ((s64)cost - st->ns_per_byte[mode]) / 8;
+}
+
 static int spi_qup_transfer_one(struct spi_master *master,
 			      struct spi_device *spi,
 			      struct spi_transfer *xfer)
 {
 	struct spi_qup *controller = spi_master_get_devdata(master);
 	unsigned long timeout, flags;
+	ktime_t start = ktime_get();
 	int ret = -EIO;
 
+	/*
+	 * can_dma() runs for every transfer of the message when it is
+	 * mapped, so use_dma is only right for the last one. The transfer
+	 * was mapped exactly when it is meant to go through DMA.
+	 */
+	controller->use_dma = master->cur_msg_mapped &&
+			      (xfer->tx_sg.nents || xfer->rx_sg.nents);
+
 	ret = spi_qup_io_config(spi, xfer);
 	if (ret)
 		return ret;
@@ -659,10 +739,40 @@ exit:
 
 	if (ret && controller->use_dma)
 		spi_qup_dma_terminate(master, xfer);
+	else if (!ret)
+		spi_qup_account(spi, xfer,
+				controller->use_dma ? SPI_QUP_DMA : SPI_QUP_PIO,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	return ret;
 }
 
+/*
+ * Adaptive choice between DMA and block mode PIO for a transfer that can
+ * use either: try each mode once, then take the one with the lower cost
+ * per byte, re-trying the other every SPI_QUP_PROBE_INTERVAL decisions
+ * so a change in the workload is noticed.
+ */
+static bool spi_qup_prefer_dma(struct spi_device *spi)
+{
+	struct spi_qup_dev_stats *st = spi->controller_state;
+	bool dma;
+
+	if (!adaptive_dma || !st)
+		return true;
+
+	if (!st->ns_per_byte[SPI_QUP_DMA])
+		return true;
+	if (!st->ns_per_byte[SPI_QUP_PIO])
+		return false;
+
+	dma = st->ns_per_byte[SPI_QUP_DMA] < st->ns_per_byte[SPI_QUP_PIO];
+	if (!(++st->decisions % SPI_QUP_PROBE_INTERVAL))
+		dma = !dma;
+
+	return dma;
+}
+
 static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 			    struct spi_transfer *xfer)
 {
@@ -670,6 +780,13 @@ static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 	size_t dma_align = dma_get_cache_alignment();
 	u32 mode;
 
+	/*
+	 * Called again when the message is unmapped; a mapped transfer has
+	 * to stay DMA even if the adaptive choice has changed since.
+	 */
+	if (xfer->tx_sg.orig_nents || xfer->rx_sg.orig_nents)
+		return true;
+
 	qup->use_dma = 0;
 
 	if (xfer->rx_buf && (xfer->len % qup->in_blk_sz ||
@@ -686,11 +803,124 @@ static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 	if (mode == QUP_IO_M_MODE_FIFO)
 		return false;
 
+	if (!spi_qup_prefer_dma(spi))
+		return false;
+
 	qup->use_dma = 1;
 
 	return true;
 }
 
+static int spi_qup_setup(struct spi_device *spi)
+{
+	struct spi_qup *controller = spi_master_get_devdata(spi->master);
+	struct spi_qup_dev_stats *st = spi->controller_state;
+
+	if (st)
+		return 0;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	st->spi = spi;
+	mutex_lock(&controller->stats_lock);
+	list_add_tail(&st->list, &controller->dev_stats);
+	mutex_unlock(&controller->stats_lock);
+	spi->controller_state = st;
+
+	return 0;
+}
+
+static void spi_qup_cleanup(struct spi_device *spi)
+{
+	struct spi_qup *controller = spi_master_get_devdata(spi->master);
+	struct spi_qup_dev_stats *st = spi->controller_state;
+
+	if (!st)
+		return;
+
+	mutex_lock(&controller->stats_lock);
+	list_del(&st->list);
+	mutex_unlock(&controller->stats_lock);
+	spi->controller_state = NULL;
+	kfree(st);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int spi_qup_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const names[] = {
+		[SPI_QUP_PIO] = "pio",
+		[SPI_QUP_DMA] = "dma",
+	};
+	struct spi_qup *controller = s->private;
+	struct spi_qup_dev_stats *st;
+	int mode;
+
+	seq_printf(s, "adaptive_dma: %d\n", adaptive_dma);
+	mutex_lock(&controller->stats_lock);
+	list_for_each_entry(st, &controller->dev_stats, list) {
+		seq_printf(s, "%s cs %d:\n", dev_name(&st->spi->dev),
+			   st->spi->chip_select);
+		for (mode = 0; mode < SPI_QUP_NR_MODES; mode++) {
+			u64 xfers = st->xfers[mode];
+
+			seq_printf(s, "  %s: xfers %llu bytes %llu avg_size %llu avg_us %llu max_us %u ns_per_byte %u\n",
+				   names[mode], xfers, st->bytes[mode],
+				   xfers ? div64_u64(st->bytes[mode], xfers) : 0,
+				   xfers ? div64_u64(st->total_ns[mode],
+						     xfers * NSEC_PER_USEC) : 0,
+				   st->max_us[mode],
+				   st->ns_per_byte[mode] / 16);
+		}
+	}
+	mutex_unlock(&controller->stats_lock);
+
+	return 0;
+}
+
+static int spi_qup_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, spi_qup_stats_show, inode->i_private);
+}
+
+static const struct file_operations spi_qup_stats_ops = {
+	.owner		= THIS_MODULE,
+	.open		= spi_qup_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void spi_qup_debugfs_init(struct spi_master *master)
+{
+	struct spi_qup *controller = spi_master_get_devdata(master);
+	char name[128];
+
+	snprintf(name, sizeof(name), "spi_qup-%s", dev_name(&master->dev));
+	controller->debugfs = debugfs_create_dir(name, NULL);
+	if (!controller->debugfs)
+		return;
+
+	debugfs_create_file("stats", S_IRUGO, controller->debugfs,
+			    controller, &spi_qup_stats_ops);
+}
+
+static void spi_qup_debugfs_remove(struct spi_qup *controller)
+{
+	debugfs_remove_recursive(controller->debugfs);
+}
+#else
+static inline void spi_qup_debugfs_init(struct spi_master *master)
+{
+}
+
+static inline void spi_qup_debugfs_remove(struct spi_qup *controller)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
 static void spi_qup_release_dma(struct spi_master *master)
 {
 	if (!IS_ERR_OR_NULL(master->dma_rx))
@@ -821,6 +1051,8 @@ static int spi_qup_probe(struct platform_device *pdev)
 	master->bits_per_word_mask = SPI_BPW_RANGE_MASK(4, 32);
 	master->max_speed_hz = max_freq;
 	master->transfer_one = spi_qup_transfer_one;
+	master->setup = spi_qup_setup;
+	master->cleanup = spi_qup_cleanup;
 	master->dev.of_node = pdev->dev.of_node;
 	master->auto_runtime_pm = true;
 	master->dma_alignment = dma_get_cache_alignment();
@@ -848,6 +1080,8 @@ static int spi_qup_probe(struct platform_device *pdev)
 
 	spin_lock_init(&controller->lock);
 	init_completion(&controller->done);
+	mutex_init(&controller->stats_lock);
+	INIT_LIST_HEAD(&controller->dev_stats);
 
 	iomode = readl_relaxed(base + QUP_IO_M_MODES);
 
@@ -913,6 +1147,8 @@ static int spi_qup_probe(struct platform_device *pdev)
 	if (ret)
 		goto disable_pm;
 
+	spi_qup_debugfs_init(master);
+
 	return 0;
 
 disable_pm:
@@ -1015,6 +1251,7 @@ static int spi_qup_remove(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	spi_qup_debugfs_remove(controller);
 	spi_qup_release_dma(master);
 
 	clk_disable_unprepare(controller->cclk);
@@ -32,6 +32,7 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
+#include <linux/wait.h>
 #include "ashmem.h"
 
 #define ASHMEM_NAME_PREFIX "dev/ashmem/"
@@ -45,6 +46,7 @@
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
+ * @purging:		Ranges being purged by the shrinker outside ashmem_mutex
  *
  * The lifecycle of this structure is from our parent file's open() until
  * its release(). It is also protected by 'ashmem_mutex'
@@ -57,6 +59,7 @@ struct ashmem_area {
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
+	atomic_t purging;
 };
 
 /**
@@ -97,6 +100,26 @@ static unsigned long lru_count;
  */
 static DEFINE_MUTEX(ashmem_mutex);
 
+/* woken when the last in-flight purge of an area completes */
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_purge_wait);
+
+/* ranges taken off the LRU per hold of ashmem_mutex by the shrinker */
+#define ASHMEM_SHRINK_BATCH	16
+
+/**
+ * struct ashmem_purge - A range taken off the LRU, to be punched out
+ * @asma:	The area the range belongs to
+ * @file:	Reference to the area's backing file
+ * @start:	The starting byte
+ * @len:	The length in bytes
+ */
+struct ashmem_purge {
+	struct ashmem_area *asma;
+	struct file *file;
+	loff_t start;
+	loff_t len;
+};
+
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
@@ -122,6 +145,9 @@ static struct kmem_cache *ashmem_range_cachep __read_mostly;
 #define range_before_page(range, page) \
 	((range)->pgend < (page))
 
+#define range_adjacent(range, start, end) \
+	(((range)->pgend + 1 == (start)) || ((end) + 1 == (range)->pgstart))
+
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
 /**
@@ -245,6 +271,7 @@ static int ashmem_open(struct inode *inode, struct file *file)
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&asma->unpinned_list);
+	atomic_set(&asma->purging, 0);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -270,6 +297,9 @@ static int ashmem_release(struct inode *ignored, struct file *file)
 		range_del(range);
 	mutex_unlock(&ashmem_mutex);
 
+	/* the shrinker may still be punching out ranges it took */
+	wait_event(ashmem_purge_wait, !atomic_read(&asma->purging));
+
 	if (asma->file)
 		fput(asma->file);
 	kmem_cache_free(ashmem_area_cachep, asma);
@@ -454,37 +484,62 @@ out:
  * proceed without risk of deadlock (due to gfp_mask).
  *
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
- * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * chunks of ashmem regions LRU-wise until we hit 'nr_to_scan' ranges.
+ *
+ * Ranges are taken off the LRU and marked purged up to ASHMEM_SHRINK_BATCH
+ * at a time under ashmem_mutex, and punched out after dropping it, so that
+ * pin and unpin of other areas do not wait for the hole punching. Pinning
+ * an area with ranges in flight waits for those to be punched out before
+ * returning ASHMEM_WAS_PURGED, so new contents are never thrown away.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
+	struct ashmem_purge batch[ASHMEM_SHRINK_BATCH];
 	struct ashmem_range *range, *next;
 	unsigned long freed = 0;
+	int i, n;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&ashmem_mutex))
-		return -1;
+	do {
+		if (!mutex_trylock(&ashmem_mutex))
+			return freed ? freed : SHRINK_STOP;
 
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+		n = 0;
+		list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
+			struct ashmem_purge *purge = &batch[n++];
 
-		range->asma->file->f_op->fallocate(range->asma->file,
-				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-				start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+			purge->asma = range->asma;
+			purge->file = get_file(range->asma->file);
+			purge->start = range->pgstart * PAGE_SIZE;
+			purge->len = range_size(range) * PAGE_SIZE;
+			atomic_inc(&range->asma->purging);
+
+			range->purged = ASHMEM_WAS_PURGED;
+			lru_del(range);
+
+			freed += range_size(range);
+			if (--sc->nr_to_scan <= 0 || n == ASHMEM_SHRINK_BATCH)
+				break;
+		}
+		mutex_unlock(&ashmem_mutex);
+
+		for (i = 0; i < n; i++) {
+			struct ashmem_purge *purge = &batch[i];
+
+			purge->file->f_op->fallocate(purge->file,
+					FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+					purge->start, purge->len);
+			fput(purge->file);
+			/* the area may be released as soon as this drops */
+			if (atomic_dec_and_test(&purge->asma->purging))
+				wake_up_all(&ashmem_purge_wait);
+		}
+	} while (n == ASHMEM_SHRINK_BATCH && sc->nr_to_scan > 0);
 
-		freed += range_size(range);
-		if (--sc->nr_to_scan <= 0)
-			break;
-	}
-	mutex_unlock(&ashmem_mutex);
 	return freed;
 }
 
@@ -669,6 +724,10 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
+ * Ranges overlapping the new one are merged into it. So are adjacent ones,
+ * as long as neither side was purged, which keeps the number of ranges the
+ * shrinker has to walk down for areas unpinned piece by piece.
+ *
  * Caller must hold ashmem_mutex.
  */
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
@@ -678,23 +737,25 @@ static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 
 restart:
 	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
 		/*
 		 * The user can ask us to unpin pages that are already entirely
 		 * or partially pinned. We handle those two cases here.
 		 */
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
+		if (page_range_in_range(range, pgstart, pgend) ||
+		    (purged == ASHMEM_NOT_PURGED && range_on_lru(range) &&
+		     range_adjacent(range, pgstart, pgend))) {
 			pgstart = min_t(size_t, range->pgstart, pgstart);
 			pgend = max_t(size_t, range->pgend, pgend);
 			purged |= range->purged;
 			range_del(range);
 			goto restart;
 		}
+
+		/* short circuit: this is our insertion point */
+		if (range_before_page(range, pgstart))
+			break;
 	}
 
 	return range_alloc(asma, range, purged, pgstart, pgend);
@@ -770,6 +831,10 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 out_unlock:
 	mutex_unlock(&ashmem_mutex);
 
+	/* don't let the caller write pages the shrinker is punching out */
+	if (cmd == ASHMEM_PIN)
+		wait_event(ashmem_purge_wait, !atomic_read(&asma->purging));
+
 	return ret;
 }
 
@@ -81,6 +81,8 @@ struct ion_device {
  * @display_name:	used for debugging (unique version of @name)
  * @display_serial:	used for debugging (to make display_name unique)
  * @task:		used for debugging
+ * @size:		bytes currently referenced through this client's handles
+ * @peak_size:		high watermark of @size
  *
  * A client represents a list of buffers this client may access.
  * The mutex stored here is used to protect both handles tree
@@ -98,6 +100,8 @@ struct ion_client {
 	struct task_struct *task;
 	pid_t pid;
 	struct dentry *debug_root;
+	size_t size;
+	size_t peak_size;
 };
 
 /**
@@ -179,6 +183,14 @@ static void ion_buffer_add(struct ion_device *dev,
 	rb_insert_color(&buffer->node, &dev->buffers);
 }
 
+static void ion_heap_account_latency(struct ion_heap *heap, ktime_t start)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+	int bucket = min_t(int, fls64(us), ION_ALLOC_LAT_BUCKETS - 1);
+
+	atomic_long_inc(&heap->alloc_lat[bucket]);
+}
+
 /* this function should only be called while dev->lock is held */
 static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 				     struct ion_device *dev,
@@ -189,6 +201,7 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	struct ion_buffer *buffer;
 	struct sg_table *table;
 	struct scatterlist *sg;
+	ktime_t start;
 	int i, ret;
 
 	buffer = kzalloc(sizeof(struct ion_buffer), GFP_KERNEL);
@@ -199,18 +212,20 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	buffer->flags = flags;
 	kref_init(&buffer->ref);
 
+	start = ktime_get();
 	ret = heap->ops->allocate(heap, buffer, len, align, flags);
 
 	if (ret) {
 		if (!(heap->flags & ION_HEAP_FLAG_DEFER_FREE))
-			goto err2;
+			goto err_stat;
 
 		ion_heap_freelist_drain(heap, 0);
 		ret = heap->ops->allocate(heap, buffer, len, align,
 					  flags);
 		if (ret)
-			goto err2;
+			goto err_stat;
 	}
+	ion_heap_account_latency(heap, start);
 
 	buffer->dev = dev;
 	buffer->size = len;
@@ -271,6 +286,9 @@ err:
 	heap->ops->unmap_dma(heap, buffer);
 err1:
 	heap->ops->free(buffer);
+	goto err2;
+err_stat:
+	atomic_long_inc(&heap->alloc_fail);
 err2:
 	kfree(buffer);
 	return ERR_PTR(ret);
@@ -383,8 +401,10 @@ static void ion_handle_destroy(struct kref *kref)
 	mutex_unlock(&buffer->lock);
 
 	idr_remove(&client->idr, handle->id);
-	if (!RB_EMPTY_NODE(&handle->node))
+	if (!RB_EMPTY_NODE(&handle->node)) {
 		rb_erase(&handle->node, &client->handles);
+		client->size -= buffer->size;
+	}
 
 	ion_buffer_remove_from_handle(buffer);
 	ion_buffer_put(buffer);
@@ -539,6 +559,8 @@ static int ion_handle_add(struct ion_client *client, struct ion_handle *handle)
 	rb_link_node(&handle->node, parent, p);
 	rb_insert_color(&handle->node, &client->handles);
 
+	client->size += handle->buffer->size;
+	client->peak_size = max(client->peak_size, client->size);
 	return 0;
 }
 
@@ -896,6 +918,8 @@ static int ion_debug_client_show(struct seq_file *s, void *unused)
 			"buffer");
 
 	mutex_lock(&client->lock);
+	seq_printf(s, "%16.16s: %16zx : peak %zx\n", "total", client->size,
+		   client->peak_size);
 	for (n = rb_first(&client->handles); n; n = rb_next(n)) {
 		struct ion_handle *handle = rb_entry(n, struct ion_handle,
 						     node);
@@ -1402,10 +1426,59 @@ static void ion_dma_buf_kunmap(struct dma_buf *dmabuf, unsigned long offset,
 	}
 }
 
+/*
+ * Cache maintenance limited to [start, start + len) of the buffer, so cpu
+ * access to a header or ROI does not clean or invalidate all of it.
+ */
+static void ion_buffer_sync_range(struct ion_buffer *buffer, size_t start,
+				  size_t len, enum dma_data_direction dir,
+				  bool for_cpu)
+{
+	struct sg_table *table = buffer->sg_table;
+	struct scatterlist *sg, range;
+	size_t pos = 0, end = start + len;
+	int i;
+
+	if (!ION_IS_CACHED(buffer->flags) ||
+	    get_secure_vmid(buffer->flags) > 0)
+		return;
+
+	if (IS_ERR_OR_NULL(table))
+		return;
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		size_t sg_start = pos, off, n;
+
+		pos += sg->length;
+		if (pos <= start)
+			continue;
+		if (sg_start >= end)
+			break;
+
+		off = max(start, sg_start) - sg_start;
+		n = min(end, pos) - sg_start - off;
+
+		sg_init_table(&range, 1);
+		sg_set_page(&range, sg_page(sg), n, sg->offset + off);
+		/* same assumption as ion_pages_sync_for_device() */
+		sg_dma_address(&range) = sg_phys(sg) + off;
+		if (for_cpu)
+			dma_sync_sg_for_cpu(NULL, &range, 1, dir);
+		else
+			dma_sync_sg_for_device(NULL, &range, 1, dir);
+	}
+}
+
 static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf, size_t start,
 					size_t len,
 					enum dma_data_direction direction)
 {
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	if (start > buffer->size || len > buffer->size - start)
+		return -EINVAL;
+
+	ion_buffer_sync_range(buffer, start, len, direction, true);
 	return 0;
 }
 
@@ -1413,6 +1486,12 @@ static void ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf, size_t start,
 				       size_t len,
 				       enum dma_data_direction direction)
 {
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	if (start > buffer->size || len > buffer->size - start)
+		return;
+
+	ion_buffer_sync_range(buffer, start, len, direction, false);
 }
 
 static struct dma_buf_ops dma_buf_ops = {
@@ -1915,6 +1994,24 @@ static void ion_heap_print_debug(struct seq_file *s, struct ion_heap *heap)
 	}
 }
 
+static void ion_debug_heap_latency_show(struct seq_file *s,
+					struct ion_heap *heap)
+{
+	int i;
+
+	seq_puts(s, "allocation latency (us):\n");
+	for (i = 0; i < ION_ALLOC_LAT_BUCKETS; i++) {
+		long count = atomic_long_read(&heap->alloc_lat[i]);
+
+		if (!count)
+			continue;
+		seq_printf(s, "%15s%-5u %16ld\n", "<", 1U << i, count);
+	}
+	seq_printf(s, "%16s %16ld\n", "failed",
+		   atomic_long_read(&heap->alloc_fail));
+	seq_puts(s, "----------------------------------------------------\n");
+}
+
 static int ion_debug_heap_show(struct seq_file *s, void *unused)
 {
 	struct ion_heap *heap = s->private;
@@ -1973,6 +2070,7 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16s %16zu\n", "deferred free",
 				heap->free_list_size);
 	seq_puts(s, "----------------------------------------------------\n");
+	ion_debug_heap_latency_show(s, heap);
 
 	if (heap->debug_show)
 		heap->debug_show(heap, s, unused);
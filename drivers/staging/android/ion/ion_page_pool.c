@@ -20,11 +20,29 @@
 #include <linux/fs.h>
 #include <linux/list.h>
 #include <linux/init.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/vmalloc.h>
 #include "ion_priv.h"
 
+/* pages handed out from a pool, and pages the pools had to allocate */
+static DEFINE_PER_CPU(unsigned long, ion_page_pool_hits);
+static DEFINE_PER_CPU(unsigned long, ion_page_pool_misses);
+
+void ion_page_pool_hit_stats(unsigned long *hits, unsigned long *misses)
+{
+	int cpu;
+
+	*hits = 0;
+	*misses = 0;
+	for_each_possible_cpu(cpu) {
+		*hits += per_cpu(ion_page_pool_hits, cpu);
+		*misses += per_cpu(ion_page_pool_misses, cpu);
+	}
+}
+EXPORT_SYMBOL(ion_page_pool_hit_stats);
+
 static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
 	struct page *page;
@@ -54,9 +72,17 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+static void ion_page_pool_account(struct ion_page_pool *pool,
+				  struct page *page, bool add)
+{
+	long bytes = 1L << (PAGE_SHIFT + pool->order);
+
+	mod_zone_page_state(page_zone(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
+			    add ? bytes : -bytes);
+}
+
+static void __ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 {
-	mutex_lock(&pool->mutex);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -64,14 +90,19 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
+}
 
-	mod_zone_page_state(page_zone(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    (1 << (PAGE_SHIFT + pool->order)));
+static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+{
+	mutex_lock(&pool->mutex);
+	__ion_page_pool_add(pool, page);
+	ion_page_pool_account(pool, page, true);
 	mutex_unlock(&pool->mutex);
 	return 0;
 }
 
-static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+static struct page *__ion_page_pool_remove(struct ion_page_pool *pool,
+					   bool high)
 {
 	struct page *page;
 
@@ -86,11 +117,112 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 	}
 
 	list_del(&page->lru);
-	mod_zone_page_state(page_zone(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    -(1 << (PAGE_SHIFT + pool->order)));
 	return page;
 }
 
+static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+{
+	struct page *page = __ion_page_pool_remove(pool, high);
+
+	ion_page_pool_account(pool, page, false);
+	return page;
+}
+
+/*
+ * Per-cpu magazines sit in front of the lowmem list so that the common
+ * alloc and free paths only touch the local cpu's magazine. Pages are
+ * moved between a magazine and the shared list mag_batch at a time with
+ * pool->mutex taken once. Pages in magazines remain accounted as pool
+ * pages. Lock order is pool->mutex, then mag->lock.
+ */
+static struct page *ion_page_pool_mag_pop(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_mag *mag;
+	struct page *page = NULL;
+
+	if (!pool->mags)
+		return NULL;
+
+	mag = raw_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+	if (mag->count)
+		page = mag->pages[--mag->count];
+	spin_unlock(&mag->lock);
+	return page;
+}
+
+static bool ion_page_pool_mag_push(struct ion_page_pool *pool,
+				   struct page *page)
+{
+	struct ion_page_pool_mag *mag;
+	bool pushed = false;
+
+	if (!pool->mags || PageHighMem(page))
+		return false;
+
+	mag = raw_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+	if (mag->count < pool->mag_size) {
+		mag->pages[mag->count++] = page;
+		pushed = true;
+	}
+	spin_unlock(&mag->lock);
+	return pushed;
+}
+
+/* Refill the local magazine from the lowmem list. Called with mutex held. */
+static void ion_page_pool_mag_refill_locked(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_mag *mag;
+	int n;
+
+	if (!pool->mags)
+		return;
+
+	mag = raw_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+	for (n = 0; n < pool->mag_batch && pool->low_count &&
+	     mag->count < pool->mag_size; n++)
+		mag->pages[mag->count++] = __ion_page_pool_remove(pool, false);
+	spin_unlock(&mag->lock);
+}
+
+/* Move up to @nr pages of @mag to the lowmem list. Called with mutex held. */
+static void ion_page_pool_mag_drain_locked(struct ion_page_pool *pool,
+					   struct ion_page_pool_mag *mag,
+					   int nr)
+{
+	spin_lock(&mag->lock);
+	while (nr-- > 0 && mag->count)
+		__ion_page_pool_add(pool, mag->pages[--mag->count]);
+	spin_unlock(&mag->lock);
+}
+
+static void ion_page_pool_mag_drain_all_locked(struct ion_page_pool *pool)
+{
+	int cpu;
+
+	if (!pool->mags)
+		return;
+
+	for_each_possible_cpu(cpu)
+		ion_page_pool_mag_drain_locked(pool,
+					       per_cpu_ptr(pool->mags, cpu),
+					       pool->mag_size);
+}
+
+static int ion_page_pool_mag_count(struct ion_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	if (!pool->mags)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->mags, cpu)->count);
+	return count;
+}
+
 void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 {
 	struct page *page = NULL;
@@ -99,16 +231,28 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 
 	*from_pool = true;
 
+	page = ion_page_pool_mag_pop(pool);
+	if (page) {
+		ion_page_pool_account(pool, page, false);
+		this_cpu_inc(ion_page_pool_hits);
+		return page;
+	}
+
 	if (mutex_trylock(&pool->mutex)) {
-		if (pool->high_count)
+		if (pool->high_count) {
 			page = ion_page_pool_remove(pool, true);
-		else if (pool->low_count)
+		} else if (pool->low_count) {
 			page = ion_page_pool_remove(pool, false);
+			ion_page_pool_mag_refill_locked(pool);
+		}
 		mutex_unlock(&pool->mutex);
 	}
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
+		this_cpu_inc(ion_page_pool_misses);
+	} else {
+		this_cpu_inc(ion_page_pool_hits);
 	}
 	return page;
 }
@@ -122,6 +266,13 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 
 	BUG_ON(!pool);
 
+	page = ion_page_pool_mag_pop(pool);
+	if (page) {
+		ion_page_pool_account(pool, page, false);
+		this_cpu_inc(ion_page_pool_hits);
+		return page;
+	}
+
 	if (mutex_trylock(&pool->mutex)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true);
@@ -130,6 +281,8 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 		mutex_unlock(&pool->mutex);
 	}
 
+	if (page)
+		this_cpu_inc(ion_page_pool_hits);
 	return page;
 }
 
@@ -137,11 +290,45 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
 	int ret;
 
+	if (ion_page_pool_mag_push(pool, page)) {
+		ion_page_pool_account(pool, page, true);
+		return;
+	}
+
+	if (pool->mags && !PageHighMem(page)) {
+		/* Local magazine is full, spill a batch along with @page */
+		mutex_lock(&pool->mutex);
+		ion_page_pool_mag_drain_locked(pool, raw_cpu_ptr(pool->mags),
+					       pool->mag_batch);
+		__ion_page_pool_add(pool, page);
+		ion_page_pool_account(pool, page, true);
+		mutex_unlock(&pool->mutex);
+		return;
+	}
+
 	ret = ion_page_pool_add(pool, page);
 	if (ret)
 		ion_page_pool_free_pages(pool, page);
 }
 
+/*
+ * Return every page on @pages (linked through page->lru) to the pool
+ * under a single hold of the pool mutex. @pages is empty on return.
+ */
+void ion_page_pool_free_list(struct ion_page_pool *pool,
+			     struct list_head *pages)
+{
+	struct page *page, *tmp;
+
+	mutex_lock(&pool->mutex);
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		list_del(&page->lru);
+		__ion_page_pool_add(pool, page);
+		ion_page_pool_account(pool, page, true);
+	}
+	mutex_unlock(&pool->mutex);
+}
+
 void ion_page_pool_free_immediate(struct ion_page_pool *pool, struct page *page)
 {
 	ion_page_pool_free_pages(pool, page);
@@ -149,7 +336,7 @@ void ion_page_pool_free_immediate(struct ion_page_pool *pool, struct page *page)
 
 int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + ion_page_pool_mag_count(pool);
 
 	if (high)
 		count += pool->high_count;
@@ -171,6 +358,10 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	mutex_lock(&pool->mutex);
+	ion_page_pool_mag_drain_all_locked(pool);
+	mutex_unlock(&pool->mutex);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -208,11 +399,37 @@ struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
 
+	pool->mag_size = max(ION_PAGE_POOL_MAG_SIZE >> order, 1);
+	pool->mag_batch = max(pool->mag_size / 2, 1);
+	pool->mags = alloc_percpu(struct ion_page_pool_mag);
+	if (pool->mags) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(pool->mags, cpu)->lock);
+	}
+
 	return pool;
 }
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	if (pool->mags) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct ion_page_pool_mag *mag =
+				per_cpu_ptr(pool->mags, cpu);
+
+			while (mag->count) {
+				struct page *page = mag->pages[--mag->count];
+
+				ion_page_pool_account(pool, page, false);
+				ion_page_pool_free_pages(pool, page);
+			}
+		}
+	}
+	free_percpu(pool->mags);
 	kfree(pool);
 }
 
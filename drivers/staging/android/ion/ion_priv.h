@@ -157,6 +157,8 @@ struct ion_heap_ops {
  */
 #define ION_PRIV_FLAG_SHRINKER_FREE (1 << 0)
 
+#define ION_ALLOC_LAT_BUCKETS	16
+
 /**
  * struct ion_heap - represents a heap in the system
  * @node:		rb node to put the heap on the device's tree of heaps
@@ -177,6 +179,9 @@ struct ion_heap_ops {
  * @task:		task struct of deferred free thread
  * @debug_show:		called when heap debug file is read to add any
  *			heap specific debug info to output
+ * @alloc_lat:		histogram of ops->allocate latency, bucket n counts
+ *			allocations that took less than 2^n microseconds
+ * @alloc_fail:		number of allocations the heap could not satisfy
  *
  * Represents a pool of memory from which buffers can be made.  In some
  * systems the only heap is regular system memory allocated via vmalloc.
@@ -202,6 +207,8 @@ struct ion_heap {
 	int (*debug_show)(struct ion_heap *heap, struct seq_file *, void *);
 	atomic_long_t total_allocated;
 	atomic_long_t total_handles;
+	atomic_long_t alloc_lat[ION_ALLOC_LAT_BUCKETS];
+	atomic_long_t alloc_fail;
 };
 
 /**
@@ -411,6 +418,21 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * many systems
  */
 
+#define ION_PAGE_POOL_MAG_SIZE	32
+
+/**
+ * struct ion_page_pool_mag - per-cpu cache of lowmem pool pages
+ * @lock:		protects @count and @pages, only contended when the
+ *			pool is being shrunk
+ * @count:		number of pages in @pages
+ * @pages:		cached pages, used as a stack
+ */
+struct ion_page_pool_mag {
+	spinlock_t lock;
+	int count;
+	struct page *pages[ION_PAGE_POOL_MAG_SIZE];
+};
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -422,6 +444,10 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @mags:		per-cpu magazines in front of @low_items, may be NULL
+ * @mag_size:		number of pages a magazine holds for this order
+ * @mag_batch:		number of pages moved between a magazine and
+ *			@low_items under one @mutex hold
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -438,6 +464,9 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_mag __percpu *mags;
+	int mag_size;
+	int mag_batch;
 };
 
 struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
@@ -446,8 +475,11 @@ void ion_page_pool_destroy(struct ion_page_pool *);
 void *ion_page_pool_alloc(struct ion_page_pool *, bool *from_pool);
 void *ion_page_pool_alloc_pool_only(struct ion_page_pool *);
 void ion_page_pool_free(struct ion_page_pool *, struct page *);
+void ion_page_pool_free_list(struct ion_page_pool *pool,
+			     struct list_head *pages);
 void ion_page_pool_free_immediate(struct ion_page_pool *, struct page *);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+void ion_page_pool_hit_stats(unsigned long *hits, unsigned long *misses);
 size_t ion_system_heap_secure_page_pool_total(struct ion_heap *heap, int vmid);
 
 #ifdef CONFIG_ION_POOL_CACHE_POLICY
@@ -15,11 +15,15 @@
  *
  */
 
+#include <asm/cacheflush.h>
 #include <asm/page.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/msm_ion.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
@@ -38,10 +42,32 @@ static gfp_t low_order_gfp_flags  = (GFP_HIGHUSER | __GFP_NOWARN);
 
 #ifndef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 static const unsigned int orders[] = {9, 8, 4, 0};
+/*
+ * Number of pages of each order above that the refill thread keeps in
+ * every uncached and cached pool. Zero disables refilling that order.
+ */
+static unsigned int pool_watermark[] = {0, 2, 16, 128};
 #else
 static const unsigned int orders[] = {0};
+static unsigned int pool_watermark[] = {512};
 #endif
 
+module_param_array(pool_watermark, uint, NULL, 0644);
+
+/*
+ * In deferred free mode freed buffers are collected and zeroed, cleaned
+ * and returned to the pools in batches by the refill thread. A batch is
+ * flushed from the freeing context once it exceeds free_batch_kb.
+ */
+static bool deferred_free;
+module_param(deferred_free, bool, 0644);
+static unsigned int free_batch_kb = 16384;
+module_param(free_batch_kb, uint, 0644);
+
+/* The background refill thread never enters direct reclaim */
+static gfp_t refill_gfp_flags = (GFP_HIGHUSER | __GFP_NOWARN |
+				 __GFP_NORETRY) & ~__GFP_DIRECT_RECLAIM;
+
 static const int num_orders = ARRAY_SIZE(orders);
 static int order_to_index(unsigned int order)
 {
@@ -58,6 +84,22 @@ static unsigned int order_to_size(int order)
 	return PAGE_SIZE << order;
 }
 
+/*
+ * Allocation counters, indexed by order index where it applies. These are
+ * only ever incremented and are cheap enough to keep enabled everywhere.
+ */
+struct ion_system_heap_stats {
+	/* Chunks served from, or missing in, the pool of that order */
+	atomic_long_t pool_hit[ARRAY_SIZE(orders)];
+	atomic_long_t pool_miss[ARRAY_SIZE(orders)];
+	/* Buddy allocation failed, retried with the next lower order */
+	atomic_long_t order_fallback[ARRAY_SIZE(orders)];
+	/* Secure pool pages split to satisfy an order-0 request */
+	atomic_long_t secure_split[ARRAY_SIZE(orders)];
+	/* Secure pools were empty and the chunk came from buddy */
+	atomic_long_t secure_buddy_fallback;
+};
+
 struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool **uncached_pools;
@@ -65,6 +107,21 @@ struct ion_system_heap {
 	struct ion_page_pool **secure_pools[VMID_LAST];
 	/* Prevents unnecessary page splitting */
 	struct mutex split_page_mutex;
+	struct task_struct *refill_task;
+	wait_queue_head_t refill_wait;
+	atomic_t refill_pending;
+	/* Buffers waiting to go back to the pools in deferred free mode */
+	spinlock_t free_batch_lock;
+	struct list_head free_batch;
+	size_t free_batch_size;
+	struct ion_system_heap_stats stats;
+};
+
+struct free_batch_info {
+	struct list_head list;
+	struct sg_table *table;
+	size_t size;
+	bool cached;
 };
 
 struct page_info {
@@ -104,6 +161,255 @@ static int ion_heap_is_system_heap_type(enum ion_heap_type type)
 	return type == ((enum ion_heap_type)ION_HEAP_TYPE_SYSTEM);
 }
 
+static bool ion_system_heap_pool_low(struct ion_page_pool *pool, int idx)
+{
+	return (ion_page_pool_total(pool, true) >> pool->order) <
+		READ_ONCE(pool_watermark[idx]);
+}
+
+static void ion_system_heap_kick_refill(struct ion_system_heap *heap)
+{
+	if (heap->refill_task && !atomic_xchg(&heap->refill_pending, 1))
+		wake_up(&heap->refill_wait);
+}
+
+/*
+ * Top up every pool in @pools to its watermark with zeroed pages that have
+ * already been cleaned from the cache, so that they can be handed out
+ * without any further maintenance. Stops as soon as the page allocator
+ * cannot satisfy a request without reclaim.
+ */
+static void ion_system_heap_refill_pools(struct ion_system_heap *heap,
+					 struct ion_page_pool **pools)
+{
+	struct device *dev = heap->heap.priv;
+	struct ion_page_pool *pool;
+	struct page *page;
+	int i;
+
+	for (i = 0; i < num_orders; i++) {
+		pool = pools[i];
+		while (ion_system_heap_pool_low(pool, i)) {
+			if (kthread_should_stop())
+				return;
+
+			page = alloc_pages(refill_gfp_flags, pool->order);
+			if (!page)
+				break;
+			if (msm_ion_heap_high_order_page_zero(dev, page,
+							      pool->order)) {
+				__free_pages(page, pool->order);
+				break;
+			}
+			ion_page_pool_free(pool, page);
+			cond_resched();
+		}
+	}
+}
+
+static void free_batch_release(struct free_batch_info *info)
+{
+	sg_free_table(info->table);
+	kfree(info->table);
+	kfree(info);
+}
+
+/*
+ * Zero all pages of a batch through as few vmaps as possible and clean
+ * them with one ranged flush per mapping instead of a sync per sg entry.
+ */
+static int free_batch_zero(struct page **pages, int num_pages)
+{
+	int i, npages_to_vmap;
+	void *ptr;
+
+	npages_to_vmap = ((VMALLOC_END - VMALLOC_START) / 8) >> PAGE_SHIFT;
+	for (i = 0; i < num_pages; i += npages_to_vmap) {
+		npages_to_vmap = min(npages_to_vmap, num_pages - i);
+		ptr = NULL;
+		while (npages_to_vmap) {
+			ptr = vmap(&pages[i], npages_to_vmap, VM_IOREMAP,
+				   PAGE_KERNEL);
+			if (ptr)
+				break;
+			npages_to_vmap >>= 1;
+		}
+		if (!ptr)
+			return -ENOMEM;
+
+		memset(ptr, 0, npages_to_vmap * PAGE_SIZE);
+		dmac_flush_range(ptr, ptr + npages_to_vmap * PAGE_SIZE);
+		vunmap(ptr);
+	}
+
+	return 0;
+}
+
+/*
+ * Return the pages of every buffer on @batch to the pools, one pool mutex
+ * hold per order. With @to_buddy the pages are instead handed straight
+ * back to the page allocator without being zeroed.
+ */
+static void free_batch_return(struct ion_system_heap *heap,
+			      struct list_head *batch, bool to_buddy)
+{
+	struct list_head pages[2][ARRAY_SIZE(orders)];
+	struct free_batch_info *info, *tmp;
+	struct ion_page_pool *pool;
+	struct scatterlist *sg;
+	int i, j;
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < num_orders; j++)
+			INIT_LIST_HEAD(&pages[i][j]);
+
+	list_for_each_entry_safe(info, tmp, batch, list) {
+		for_each_sg(info->table->sgl, sg, info->table->nents, i) {
+			struct page *page = sg_page(sg);
+			unsigned int order = get_order(sg->length);
+
+			if (to_buddy) {
+				pool = info->cached ?
+					heap->cached_pools[order_to_index(order)] :
+					heap->uncached_pools[order_to_index(order)];
+				ion_page_pool_free_immediate(pool, page);
+				continue;
+			}
+			list_add_tail(&page->lru,
+				      &pages[info->cached][order_to_index(order)]);
+		}
+		list_del(&info->list);
+		free_batch_release(info);
+	}
+
+	for (j = 0; j < num_orders; j++) {
+		if (!list_empty(&pages[0][j]))
+			ion_page_pool_free_list(heap->uncached_pools[j],
+						&pages[0][j]);
+		if (!list_empty(&pages[1][j]))
+			ion_page_pool_free_list(heap->cached_pools[j],
+						&pages[1][j]);
+	}
+}
+
+static size_t ion_system_heap_flush_free_batch(struct ion_system_heap *heap,
+					       bool to_buddy)
+{
+	struct device *dev = heap->heap.priv;
+	struct free_batch_info *info, *tmp;
+	struct pages_mem pages_mem;
+	struct scatterlist *sg;
+	LIST_HEAD(batch);
+	size_t size;
+	int i, j, npages = 0;
+
+	spin_lock(&heap->free_batch_lock);
+	list_splice_init(&heap->free_batch, &batch);
+	size = heap->free_batch_size;
+	heap->free_batch_size = 0;
+	spin_unlock(&heap->free_batch_lock);
+
+	if (list_empty(&batch) || to_buddy)
+		goto out;
+
+	pages_mem.size = size;
+	if (msm_ion_heap_alloc_pages_mem(&pages_mem))
+		goto slow;
+
+	list_for_each_entry(info, &batch, list) {
+		for_each_sg(info->table->sgl, sg, info->table->nents, i) {
+			for (j = 0; j < sg->length / PAGE_SIZE; j++)
+				pages_mem.pages[npages++] = sg_page(sg) + j;
+		}
+	}
+	i = free_batch_zero(pages_mem.pages, npages);
+	msm_ion_heap_free_pages_mem(&pages_mem);
+	if (!i)
+		goto out;
+
+slow:
+	/* Could not map the batch, fall back to zeroing buffer by buffer */
+	list_for_each_entry_safe(info, tmp, &batch, list) {
+		if (msm_ion_heap_sg_table_zero(dev, info->table, info->size)) {
+			LIST_HEAD(one);
+
+			list_move(&info->list, &one);
+			free_batch_return(heap, &one, true);
+		}
+	}
+out:
+	free_batch_return(heap, &batch, to_buddy);
+	return size;
+}
+
+static bool ion_system_heap_defer_free(struct ion_system_heap *heap,
+				       struct ion_buffer *buffer)
+{
+	struct free_batch_info *info;
+	bool flush;
+
+	info = kmalloc(sizeof(*info), GFP_KERNEL | __GFP_NOWARN);
+	if (!info)
+		return false;
+
+	info->table = buffer->priv_virt;
+	info->size = PAGE_ALIGN(buffer->size);
+	info->cached = ion_buffer_cached(buffer);
+
+	spin_lock(&heap->free_batch_lock);
+	list_add_tail(&info->list, &heap->free_batch);
+	heap->free_batch_size += info->size;
+	flush = heap->free_batch_size >
+		(size_t)READ_ONCE(free_batch_kb) * SZ_1K;
+	spin_unlock(&heap->free_batch_lock);
+
+	if (flush)
+		ion_system_heap_flush_free_batch(heap, false);
+	else
+		ion_system_heap_kick_refill(heap);
+	return true;
+}
+
+static int ion_system_heap_refill_thread(void *data)
+{
+	struct ion_system_heap *heap = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->refill_wait,
+				     atomic_read(&heap->refill_pending) ||
+				     kthread_should_stop());
+		atomic_set(&heap->refill_pending, 0);
+
+		ion_system_heap_flush_free_batch(heap, false);
+
+		ion_system_heap_refill_pools(heap, heap->uncached_pools);
+		ion_system_heap_refill_pools(heap, heap->cached_pools);
+	}
+
+	return 0;
+}
+
+static int ion_system_heap_init_refill(struct ion_system_heap *heap)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	init_waitqueue_head(&heap->refill_wait);
+	atomic_set(&heap->refill_pending, 0);
+	spin_lock_init(&heap->free_batch_lock);
+	INIT_LIST_HEAD(&heap->free_batch);
+	heap->refill_task = kthread_run(ion_system_heap_refill_thread, heap,
+					"ion_pool_refill");
+	if (IS_ERR(heap->refill_task)) {
+		pr_err("%s: creating thread for pool refill failed\n",
+		       __func__);
+		heap->refill_task = NULL;
+		return -ENOMEM;
+	}
+	sched_setscheduler(heap->refill_task, SCHED_IDLE, &param);
+	return 0;
+}
+
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long order,
@@ -124,6 +430,13 @@ static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 			pool = heap->cached_pools[order_to_index(order)];
 
 		page = ion_page_pool_alloc(pool, from_pool);
+		if (page)
+			atomic_long_inc(*from_pool ?
+				&heap->stats.pool_hit[order_to_index(order)] :
+				&heap->stats.pool_miss[order_to_index(order)]);
+		if (vmid <= 0 &&
+		    ion_system_heap_pool_low(pool, order_to_index(order)))
+			ion_system_heap_kick_refill(heap);
 	} else {
 		gfp_t gfp_mask = low_order_gfp_flags;
 		if (order)
@@ -209,6 +522,7 @@ static struct page *split_page_from_secure_pool(struct ion_system_heap *heap,
 			continue;
 
 		split_page(page, order);
+		atomic_long_inc(&heap->stats.secure_split[i]);
 		break;
 	}
 	/*
@@ -248,8 +562,10 @@ static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 			continue;
 		from_pool = !(buffer->flags & ION_FLAG_POOL_FORCE_ALLOC);
 		page = alloc_buffer_page(heap, buffer, orders[i], &from_pool);
-		if (!page)
+		if (!page) {
+			atomic_long_inc(&heap->stats.order_fallback[i]);
 			continue;
+		}
 
 		info->page = page;
 		info->order = orders[i];
@@ -304,6 +620,7 @@ static struct page_info *alloc_from_pool_preferred(
 	}
 
 	kfree(info);
+	atomic_long_inc(&heap->stats.secure_buddy_fallback);
 force_alloc:
 	return alloc_largest_available(heap, buffer, size, max_order);
 }
@@ -525,6 +842,10 @@ void ion_system_heap_free(struct ion_buffer *buffer)
 
 	if (!(buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE) &&
 	    !(buffer->flags & ION_FLAG_POOL_FORCE_ALLOC)) {
+		if (vmid < 0 && READ_ONCE(deferred_free) &&
+		    sys_heap->refill_task &&
+		    ion_system_heap_defer_free(sys_heap, buffer))
+			return;
 		if (vmid < 0)
 			msm_ion_heap_sg_table_zero(dev, table, buffer->size);
 	} else if (vmid > 0) {
@@ -624,8 +945,18 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 
 	sys_heap = container_of(heap, struct ion_system_heap, heap);
 
-	if (!nr_to_scan)
+	if (!nr_to_scan) {
 		only_scan = 1;
+		nr_total = READ_ONCE(sys_heap->free_batch_size) >> PAGE_SHIFT;
+	} else {
+		/* Pending deferred frees go straight back to buddy */
+		nr_freed = ion_system_heap_flush_free_batch(sys_heap, true) >>
+			   PAGE_SHIFT;
+		nr_total += nr_freed;
+		nr_to_scan -= nr_freed;
+		if (nr_to_scan <= 0)
+			return nr_total;
+	}
 
 	for (i = 0; i < num_orders; i++) {
 		nr_freed = 0;
@@ -665,6 +996,25 @@ static struct ion_heap_ops system_heap_ops = {
 	.shrink = ion_system_heap_shrink,
 };
 
+static void ion_system_heap_stats_show(struct ion_system_heap *sys_heap,
+				       struct seq_file *s)
+{
+	struct ion_system_heap_stats *stats = &sys_heap->stats;
+	int i;
+
+	seq_printf(s, "%8s %12s %12s %12s %12s\n", "order", "pool hit",
+		   "pool miss", "fallback", "secure split");
+	for (i = 0; i < num_orders; i++)
+		seq_printf(s, "%8u %12ld %12ld %12ld %12ld\n", orders[i],
+			   atomic_long_read(&stats->pool_hit[i]),
+			   atomic_long_read(&stats->pool_miss[i]),
+			   atomic_long_read(&stats->order_fallback[i]),
+			   atomic_long_read(&stats->secure_split[i]));
+	seq_printf(s, "secure buddy fallback = %ld\n",
+		   atomic_long_read(&stats->secure_buddy_fallback));
+	seq_puts(s, "--------------------------------------------\n");
+}
+
 static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				      void *unused)
 {
@@ -753,6 +1103,7 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 		seq_printf(s, "pool total (uncached + cached + secure) = %lu\n",
 			   uncached_total + cached_total + secure_total);
 		seq_puts(s, "--------------------------------------------\n");
+		ion_system_heap_stats_show(sys_heap, s);
 	} else {
 		pr_info("-------------------------------------------------\n");
 		pr_info("uncached pool = %lu cached pool = %lu secure pool = %lu\n",
@@ -845,6 +1196,9 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *data)
 
 	mutex_init(&heap->split_page_mutex);
 
+	/* The heap still works without a refill thread, only slower */
+	ion_system_heap_init_refill(heap);
+
 	heap->heap.debug_show = ion_system_heap_debug_show;
 	return &heap->heap;
 
@@ -873,6 +1227,10 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							heap);
 	int i, j;
 
+	if (sys_heap->refill_task)
+		kthread_stop(sys_heap->refill_task);
+	ion_system_heap_flush_free_batch(sys_heap, true);
+
 	for (i = 0; i < VMID_LAST; i++) {
 		if (!is_secure_vmid_valid(i))
 			continue;
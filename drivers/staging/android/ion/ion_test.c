@@ -17,21 +17,37 @@
 
 #include <linux/dma-buf.h>
 #include <linux/dma-direction.h>
+#include <linux/dma-mapping.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/msm_ion.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 
 #include "ion.h"
+#include "ion_priv.h"
 #include "../uapi/ion_test.h"
 
 #define u64_to_uptr(x) ((void __user *)(unsigned long)(x))
 
+#define ION_TEST_BENCH_MAX_ITERATIONS	100000
+
+enum ion_test_bench_step {
+	ION_TEST_BENCH_ALLOC,
+	ION_TEST_BENCH_FREE,
+	ION_TEST_BENCH_MAP,
+	ION_TEST_BENCH_SYNC,
+	ION_TEST_BENCH_STEPS,
+};
+
 struct ion_test_device {
 	struct miscdevice misc;
 };
@@ -143,6 +159,186 @@ err:
 	return ret;
 }
 
+static int ion_test_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void ion_test_bench_stats(struct ion_test_bench_stats *stats,
+		u64 *ns, u32 n)
+{
+	u64 sum = 0;
+	u32 i;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!n)
+		return;
+
+	sort(ns, n, sizeof(*ns), ion_test_cmp_u64, NULL);
+	for (i = 0; i < n; i++)
+		sum += ns[i];
+
+	stats->avg_ns = div_u64(sum, n);
+	stats->p50_ns = ns[n / 2];
+	stats->p90_ns = ns[n * 9 / 10];
+	stats->p99_ns = ns[n * 99 / 100];
+	stats->max_ns = ns[n - 1];
+}
+
+/*
+ * Take @mb megabytes of order-0 pages so that the heaps allocate with
+ * less free memory, and have to reclaim or compact for high orders.
+ */
+static void ion_test_bench_pressure(struct list_head *pages, u32 mb)
+{
+	unsigned long nr = (unsigned long)mb << (20 - PAGE_SHIFT);
+	struct page *page;
+
+	while (nr--) {
+		page = alloc_page(GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+		if (!page)
+			break;
+		list_add(&page->lru, pages);
+		if (!(nr & 1023))
+			cond_resched();
+	}
+}
+
+static void ion_test_bench_release(struct list_head *pages)
+{
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
+/* attach, map and sync one buffer as a device would */
+static int ion_test_bench_map(struct device *dev, struct dma_buf *dma_buf,
+		size_t len, u64 *map_ns, u64 *sync_ns)
+{
+	struct dma_buf_attachment *attach;
+	struct sg_table *table;
+	ktime_t start;
+	int ret;
+
+	start = ktime_get();
+	attach = dma_buf_attach(dma_buf, dev);
+	if (IS_ERR(attach))
+		return PTR_ERR(attach);
+
+	table = dma_buf_map_attachment(attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR(table)) {
+		dma_buf_detach(dma_buf, attach);
+		return PTR_ERR(table);
+	}
+	*map_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	ret = dma_buf_begin_cpu_access(dma_buf, 0, len, DMA_BIDIRECTIONAL);
+	if (!ret)
+		dma_buf_end_cpu_access(dma_buf, 0, len, DMA_BIDIRECTIONAL);
+	*sync_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	dma_buf_unmap_attachment(attach, table, DMA_BIDIRECTIONAL);
+	dma_buf_detach(dma_buf, attach);
+	return ret;
+}
+
+static int ion_test_alloc_bench(struct device *dev,
+		struct ion_test_alloc_bench *bench)
+{
+	unsigned long hits, misses, hits_end, misses_end;
+	struct ion_client *client;
+	LIST_HEAD(pressure);
+	u64 *ns[ION_TEST_BENCH_STEPS];
+	ktime_t start;
+	u32 i, n = 0;
+	int ret = 0;
+
+	if (!bench->len || !bench->iterations ||
+	    bench->iterations > ION_TEST_BENCH_MAX_ITERATIONS)
+		return -EINVAL;
+
+	client = msm_ion_client_create("ion-test-bench");
+	if (IS_ERR(client))
+		return PTR_ERR(client);
+
+	for (i = 0; i < ION_TEST_BENCH_STEPS; i++) {
+		ns[i] = vzalloc(bench->iterations * sizeof(u64));
+		if (!ns[i])
+			ret = -ENOMEM;
+	}
+	if (ret)
+		goto out;
+
+	ion_test_bench_pressure(&pressure, bench->pressure_mb);
+	ion_page_pool_hit_stats(&hits, &misses);
+
+	for (n = 0; n < bench->iterations; n++) {
+		struct ion_handle *handle;
+		struct dma_buf *dma_buf = NULL;
+
+		start = ktime_get();
+		handle = ion_alloc(client, bench->len, PAGE_SIZE,
+				   bench->heap_id_mask, bench->flags);
+		ns[ION_TEST_BENCH_ALLOC][n] =
+			ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (IS_ERR(handle)) {
+			ret = PTR_ERR(handle);
+			break;
+		}
+
+		if (bench->map_dma) {
+			dma_buf = ion_share_dma_buf(client, handle);
+			if (IS_ERR(dma_buf)) {
+				ret = PTR_ERR(dma_buf);
+				ion_free(client, handle);
+				break;
+			}
+			ret = ion_test_bench_map(dev, dma_buf, bench->len,
+						 &ns[ION_TEST_BENCH_MAP][n],
+						 &ns[ION_TEST_BENCH_SYNC][n]);
+		}
+
+		/* the buffer goes away with the last of the two references */
+		start = ktime_get();
+		ion_free(client, handle);
+		if (dma_buf)
+			dma_buf_put(dma_buf);
+		ns[ION_TEST_BENCH_FREE][n] =
+			ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (ret)
+			break;
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+		cond_resched();
+	}
+
+	ion_page_pool_hit_stats(&hits_end, &misses_end);
+	ion_test_bench_release(&pressure);
+
+	bench->pool_hits = hits_end - hits;
+	bench->pool_misses = misses_end - misses;
+	ion_test_bench_stats(&bench->alloc, ns[ION_TEST_BENCH_ALLOC], n);
+	ion_test_bench_stats(&bench->free, ns[ION_TEST_BENCH_FREE], n);
+	ion_test_bench_stats(&bench->map, ns[ION_TEST_BENCH_MAP],
+			     bench->map_dma ? n : 0);
+	ion_test_bench_stats(&bench->sync, ns[ION_TEST_BENCH_SYNC],
+			     bench->map_dma ? n : 0);
+out:
+	for (i = 0; i < ION_TEST_BENCH_STEPS; i++)
+		vfree(ns[i]);
+	ion_client_destroy(client);
+	return ret;
+}
+
 static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 						unsigned long arg)
 {
@@ -151,6 +347,7 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 
 	union {
 		struct ion_test_rw_data test_rw;
+		struct ion_test_alloc_bench alloc_bench;
 	} data;
 
 	if (_IOC_SIZE(cmd) > sizeof(data))
@@ -192,12 +389,17 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 					data.test_rw.write);
 		break;
 	}
+	case ION_IOC_TEST_ALLOC_BENCH:
+	{
+		ret = ion_test_alloc_bench(test_data->dev, &data.alloc_bench);
+		break;
+	}
 	default:
 		return -ENOTTY;
 	}
 
 	if (_IOC_DIR(cmd) & _IOC_READ) {
-		if (copy_to_user((void __user *)arg, &data, sizeof(data)))
+		if (copy_to_user((void __user *)arg, &data, _IOC_SIZE(cmd)))
 			return -EFAULT;
 	}
 	return ret;
@@ -35,6 +35,8 @@
 static const struct fence_ops android_fence_ops;
 static const struct file_operations sync_fence_fops;
 
+struct sync_fence_stats sync_fence_stats;
+
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
 {
@@ -169,6 +171,7 @@ static struct sync_fence *sync_fence_alloc(int size, const char *name)
 
 	init_waitqueue_head(&fence->wq);
 
+	atomic_long_inc(&sync_fence_stats.fences);
 	return fence;
 
 err:
@@ -206,6 +209,7 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt)
 			       fence_check_cb_func))
 		atomic_dec(&fence->status);
 
+	atomic_long_inc(&sync_fence_stats.pts);
 	sync_fence_debug_add(fence);
 
 	return fence;
@@ -254,19 +258,50 @@ static void sync_fence_add_pt(struct sync_fence *fence,
 	}
 }
 
+/*
+ * Step through a and b in context order, returning the later of the two
+ * points when both have one on the same timeline and counting those in
+ * @deduped if it is not NULL.
+ */
+static struct fence *sync_fence_merge_next(struct sync_fence *a, int *i_a,
+					   struct sync_fence *b, int *i_b,
+					   int *deduped)
+{
+	struct fence *pt_a, *pt_b;
+
+	if (*i_a == a->num_fences && *i_b == b->num_fences)
+		return NULL;
+	if (*i_a == a->num_fences)
+		return b->cbs[(*i_b)++].sync_pt;
+	if (*i_b == b->num_fences)
+		return a->cbs[(*i_a)++].sync_pt;
+
+	pt_a = a->cbs[*i_a].sync_pt;
+	pt_b = b->cbs[*i_b].sync_pt;
+
+	if (pt_a->context < pt_b->context) {
+		(*i_a)++;
+		return pt_a;
+	}
+	if (pt_a->context > pt_b->context) {
+		(*i_b)++;
+		return pt_b;
+	}
+
+	(*i_a)++;
+	(*i_b)++;
+	if (deduped)
+		(*deduped)++;
+	return pt_a->seqno - pt_b->seqno <= INT_MAX ? pt_a : pt_b;
+}
+
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b)
 {
-	int num_fences = a->num_fences + b->num_fences;
+	int num_fences = 0, signaled = 0, deduped = 0;
 	struct sync_fence *fence;
+	struct fence *pt;
 	int i, i_a, i_b;
-	unsigned long size = offsetof(struct sync_fence, cbs[num_fences]);
-
-	fence = sync_fence_alloc(size, name);
-	if (fence == NULL)
-		return NULL;
-
-	atomic_set(&fence->status, num_fences);
 
 	/*
 	 * Assume sync_fence a and b are both ordered and have no
@@ -274,40 +309,42 @@ struct sync_fence *sync_fence_merge(const char *name,
 	 *
 	 * If a sync_fence can only be created with sync_fence_merge
 	 * and sync_fence_create, this is a reasonable assumption.
+	 *
+	 * Points that have already signaled are dropped, so fences merged
+	 * every frame do not keep growing. Size the fence for what is left;
+	 * a point that signals between the two passes is dropped as well.
 	 */
-	for (i = i_a = i_b = 0; i_a < a->num_fences && i_b < b->num_fences; ) {
-		struct fence *pt_a = a->cbs[i_a].sync_pt;
-		struct fence *pt_b = b->cbs[i_b].sync_pt;
-
-		if (pt_a->context < pt_b->context) {
-			sync_fence_add_pt(fence, &i, pt_a);
-
-			i_a++;
-		} else if (pt_a->context > pt_b->context) {
-			sync_fence_add_pt(fence, &i, pt_b);
-
-			i_b++;
-		} else {
-			if (pt_a->seqno - pt_b->seqno <= INT_MAX)
-				sync_fence_add_pt(fence, &i, pt_a);
-			else
-				sync_fence_add_pt(fence, &i, pt_b);
-
-			i_a++;
-			i_b++;
-		}
+	i_a = i_b = 0;
+	while ((pt = sync_fence_merge_next(a, &i_a, b, &i_b, &deduped))) {
+		if (fence_is_signaled(pt))
+			signaled++;
+		else
+			num_fences++;
 	}
 
-	for (; i_a < a->num_fences; i_a++)
-		sync_fence_add_pt(fence, &i, a->cbs[i_a].sync_pt);
+	fence = sync_fence_alloc(offsetof(struct sync_fence, cbs[num_fences]),
+				 name);
+	if (fence == NULL)
+		return NULL;
+
+	atomic_set(&fence->status, num_fences);
 
-	for (; i_b < b->num_fences; i_b++)
-		sync_fence_add_pt(fence, &i, b->cbs[i_b].sync_pt);
+	i = i_a = i_b = 0;
+	while (i < num_fences &&
+	       (pt = sync_fence_merge_next(a, &i_a, b, &i_b, NULL)))
+		sync_fence_add_pt(fence, &i, pt);
 
 	if (num_fences > i)
 		atomic_sub(num_fences - i, &fence->status);
 	fence->num_fences = i;
 
+	atomic_long_inc(&sync_fence_stats.merges);
+	atomic_long_add(a->num_fences + b->num_fences,
+			&sync_fence_stats.merge_pts_in);
+	atomic_long_add(signaled, &sync_fence_stats.merge_signaled);
+	atomic_long_add(deduped, &sync_fence_stats.merge_deduped);
+	atomic_long_add(i, &sync_fence_stats.pts);
+
 	sync_fence_debug_add(fence);
 	return fence;
 }
@@ -539,6 +576,8 @@ static void sync_fence_free(struct kref *kref)
 		fence_put(fence->cbs[i].sync_pt);
 	}
 
+	atomic_long_sub(fence->num_fences, &sync_fence_stats.pts);
+	atomic_long_dec(&sync_fence_stats.fences);
 	kfree(fence);
 }
 
@@ -335,6 +335,27 @@ int sync_fence_cancel_async(struct sync_fence *fence,
  */
 int sync_fence_wait(struct sync_fence *fence, long timeout);
 
+/**
+ * struct sync_fence_stats - fence counts, shown in debugfs sync_stats
+ * @fences:		live sync_fences
+ * @pts:		sync_pt references held by live sync_fences
+ * @merges:		calls to sync_fence_merge()
+ * @merge_pts_in:	points in the merged fences
+ * @merge_signaled:	signaled points dropped by merges
+ * @merge_deduped:	points dropped by merges for a later point on the
+ *			same timeline
+ */
+struct sync_fence_stats {
+	atomic_long_t fences;
+	atomic_long_t pts;
+	atomic_long_t merges;
+	atomic_long_t merge_pts_in;
+	atomic_long_t merge_signaled;
+	atomic_long_t merge_deduped;
+};
+
+extern struct sync_fence_stats sync_fence_stats;
+
 #ifdef CONFIG_DEBUG_FS
 
 void sync_timeline_debug_add(struct sync_timeline *obj);
@@ -218,9 +218,39 @@ static const struct file_operations sync_debugfs_fops = {
 	.release        = single_release,
 };
 
+static int sync_stats_show(struct seq_file *s, void *unused)
+{
+	struct sync_fence_stats *st = &sync_fence_stats;
+
+	seq_printf(s, "fences: %ld\n", atomic_long_read(&st->fences));
+	seq_printf(s, "pts: %ld\n", atomic_long_read(&st->pts));
+	seq_printf(s, "merges: %ld\n", atomic_long_read(&st->merges));
+	seq_printf(s, "merge_pts_in: %ld\n",
+		   atomic_long_read(&st->merge_pts_in));
+	seq_printf(s, "merge_signaled: %ld\n",
+		   atomic_long_read(&st->merge_signaled));
+	seq_printf(s, "merge_deduped: %ld\n",
+		   atomic_long_read(&st->merge_deduped));
+	return 0;
+}
+
+static int sync_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sync_stats_show, inode->i_private);
+}
+
+static const struct file_operations sync_stats_fops = {
+	.open           = sync_stats_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static __init int sync_debugfs_init(void)
 {
 	debugfs_create_file("sync", S_IRUGO, NULL, NULL, &sync_debugfs_fops);
+	debugfs_create_file("sync_stats", S_IRUGO, NULL, NULL,
+			    &sync_stats_fops);
 	return 0;
 }
 late_initcall(sync_debugfs_init);
@@ -35,6 +35,53 @@ struct ion_test_rw_data {
 	int __padding;
 };
 
+/**
+ * struct ion_test_bench_stats - latency of one step of the alloc benchmark
+ * @avg_ns:	mean
+ * @p50_ns:	median
+ * @p90_ns:	90th percentile
+ * @p99_ns:	99th percentile
+ * @max_ns:	slowest iteration
+ */
+struct ion_test_bench_stats {
+	__u64 avg_ns;
+	__u64 p50_ns;
+	__u64 p90_ns;
+	__u64 p99_ns;
+	__u64 max_ns;
+};
+
+/**
+ * struct ion_test_alloc_bench - parameters and results of the alloc benchmark
+ * @len:		size of each buffer
+ * @heap_id_mask:	heaps to allocate from
+ * @flags:		ion allocation flags
+ * @iterations:		buffers to allocate and free, one at a time
+ * @pressure_mb:	memory taken from the page allocator for the run
+ * @map_dma:		1 to also map each buffer for DMA and sync it
+ * @alloc:		returned ion_alloc() latency
+ * @free:		returned latency of freeing the buffer
+ * @map:		returned attach and map latency, if @map_dma
+ * @sync:		returned cache maintenance latency, if @map_dma
+ * @pool_hits:		returned pages taken from the ion page pools
+ * @pool_misses:	returned pages the pools had to allocate
+ */
+struct ion_test_alloc_bench {
+	__u64 len;
+	__u32 heap_id_mask;
+	__u32 flags;
+	__u32 iterations;
+	__u32 pressure_mb;
+	__u32 map_dma;
+	__u32 __padding;
+	struct ion_test_bench_stats alloc;
+	struct ion_test_bench_stats free;
+	struct ion_test_bench_stats map;
+	struct ion_test_bench_stats sync;
+	__u64 pool_hits;
+	__u64 pool_misses;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -66,5 +113,16 @@ struct ion_test_rw_data {
 #define ION_IOC_TEST_KERNEL_MAPPING \
 			_IOW(ION_IOC_MAGIC, 0xf2, struct ion_test_rw_data)
 
+/**
+ * DOC: ION_IOC_TEST_ALLOC_BENCH - time allocating and freeing buffers
+ *
+ * Allocates and frees @iterations buffers from the given heaps, optionally
+ * with part of memory taken away first, and returns latency percentiles of
+ * each step along with the page pool hit and miss counts for the run. The
+ * pool counts are system wide, so other ion users show up in them.
+ */
+#define ION_IOC_TEST_ALLOC_BENCH \
+			_IOWR(ION_IOC_MAGIC, 0xf3, struct ion_test_alloc_bench)
+
 
 #endif /* _UAPI_LINUX_ION_H */
@@ -143,6 +143,18 @@ struct qca_napi_info {
 	/* will only be present for data rx CE's */
 	void (*offld_flush_cb)(void *arg);
 	void                 *offld_ctx;
+	/* load steering: running totals, kept by hif_napi_poll */
+	uint64_t             steer_pkts;
+	uint64_t             steer_ns;
+	/* load steering: sampled by the steering work */
+	uint64_t             steer_last_pkts;
+	uint64_t             steer_last_ns;
+	uint32_t             steer_rate;  /* packets/s */
+	uint32_t             steer_load;  /* % of a CPU spent in poll */
+	uint32_t             steer_moves;
+	int                  steer_target; /* cluster head voted for */
+	int                  steer_votes;
+	unsigned long        steer_stamp; /* jiffies of the last move */
 };
 
 /**
@@ -155,6 +167,9 @@ struct qca_napi_info {
  *               same for all cpus of the same core.
  * @napis:       bitmap of napi instances on this core
  * cluster_nxt:  chain to link cores within the same cluster
+ * @load:        busy % of the core over the last steering period
+ * @last_wall:   wall time at the last load sample (us)
+ * @last_idle:   idle time at the last load sample (us)
  *
  * This structure represents a single entry in the napi cpu
  * table. The table is part of struct qca_napi_data.
@@ -181,6 +196,9 @@ struct qca_napi_cpu {
 	unsigned int		max_freq;
 	uint32_t		napis;
 	int			cluster_nxt;  /* index, not pointer */
+	uint32_t		load;
+	uint64_t		last_wall;
+	uint64_t		last_idle;
 };
 
 /**
@@ -202,6 +220,8 @@ struct qca_napi_data {
 	enum qca_napi_tput_state napi_mode;
 	struct qdf_cpuhp_handler *cpuhp_handler;
 	uint8_t              flags;
+	struct delayed_work  steer_work;
+	int                  rx_cpu; /* where the rx socket reader runs */
 };
 
 /**
@@ -551,6 +571,8 @@ QDF_STATUS hif_send_head(struct hif_opaque_softc *hif_ctx, uint8_t PipeID,
 				  qdf_nbuf_t wbuf, uint32_t data_attr);
 void hif_send_complete_check(struct hif_opaque_softc *hif_ctx, uint8_t PipeID,
 			     int force);
+void hif_send_batch_begin(struct hif_opaque_softc *hif_ctx, uint8_t pipe);
+void hif_send_batch_end(struct hif_opaque_softc *hif_ctx, uint8_t pipe);
 void hif_shut_down_device(struct hif_opaque_softc *hif_ctx);
 void hif_get_default_pipe(struct hif_opaque_softc *hif_ctx, uint8_t *ULPipe,
 			  uint8_t *DLPipe);
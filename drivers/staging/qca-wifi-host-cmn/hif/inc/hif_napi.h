@@ -190,6 +190,9 @@ static inline int hif_napi_cpu_deinit(struct hif_opaque_softc *hif)
 
 static inline int hif_napi_serialize(struct hif_opaque_softc *hif, int is_on)
 { return -EPERM; }
+
+static inline void hif_napi_rx_cpu_hint(struct hif_opaque_softc *hif, int cpu)
+{ }
 #else /* HELIUMPLUS - NAPI CPU symbols are valid */
 
 /*
@@ -201,6 +204,9 @@ int hif_napi_cpu_deinit(struct hif_opaque_softc *hif);
 int hif_napi_cpu_migrate(struct qca_napi_data *napid, int cpu, int action);
 int hif_napi_serialize(struct hif_opaque_softc *hif, int is_on);
 
+/* called by hdd with the cpu the rx socket reader last ran on */
+void hif_napi_rx_cpu_hint(struct hif_opaque_softc *hif, int cpu);
+
 #endif /* HELIUMPLUS */
 
 #else /* ! defined(FEATURE_NAPI) */
@@ -257,6 +263,9 @@ static inline int hif_napi_poll(struct napi_struct *napi, int budget)
 
 static inline void hif_napi_stats(struct qca_napi_data *napid) { }
 
+static inline void hif_napi_rx_cpu_hint(struct hif_opaque_softc *hif, int cpu)
+{ }
+
 #endif /* FEATURE_NAPI */
 
 /**
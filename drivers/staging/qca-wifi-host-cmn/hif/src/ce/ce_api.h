@@ -157,6 +157,13 @@ extern int ce_send_single(struct CE_handle *ce_tx_hdl,
 		qdf_nbuf_t msdu,
 		uint32_t transfer_id,
 		uint32_t len);
+/*
+ * Hold back the source ring write index updates of a burst of sends,
+ * see ce_send_batch_begin().
+ */
+void ce_send_batch_begin(struct CE_handle *copyeng);
+void ce_send_batch_end(struct CE_handle *copyeng);
+
 /*
  * Register a Send Callback function.
  * This function is called as soon as the contents of a Send
@@ -144,6 +144,11 @@ struct CE_state {
 	bool htt_rx_data;
 	void (*lro_flush_cb)(void *);
 	void *lro_data;
+
+	/* source write index updates held back by ce_send_batch_begin() */
+	uint8_t tx_batch;
+	uint16_t tx_batch_pending;
+	uint64_t tx_batch_start;
 };
 
 /* Descriptor rings must be aligned to this boundary */
@@ -1425,6 +1425,41 @@ hif_send_head(struct hif_opaque_softc *hif_ctx,
 	return status;
 }
 
+/**
+ * hif_send_batch_begin() - start batching the sends on a pipe
+ * @hif_ctx: HIF context
+ * @pipe: upload pipe
+ *
+ * Frames sent on @pipe until hif_send_batch_end() are posted to the
+ * copy engine in order, as usual, but share the doorbell writes.
+ *
+ * Return: none
+ */
+void hif_send_batch_begin(struct hif_opaque_softc *hif_ctx, uint8_t pipe)
+{
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct CE_handle *ce_hdl = hif_state->pipe_info[pipe].ce_hdl;
+
+	if (ce_hdl)
+		ce_send_batch_begin(ce_hdl);
+}
+
+/**
+ * hif_send_batch_end() - end the send batch on a pipe, ring the doorbell
+ * @hif_ctx: HIF context
+ * @pipe: upload pipe
+ *
+ * Return: none
+ */
+void hif_send_batch_end(struct hif_opaque_softc *hif_ctx, uint8_t pipe)
+{
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct CE_handle *ce_hdl = hif_state->pipe_info[pipe].ce_hdl;
+
+	if (ce_hdl)
+		ce_send_batch_end(ce_hdl);
+}
+
 void hif_send_complete_check(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
 								int force)
 {
@@ -27,6 +27,7 @@
 #include "hif_main.h"
 #include "hif_debug.h"
 #include "hif_napi.h"
+#include "qdf_time.h"
 
 #ifdef IPA_OFFLOAD
 #ifdef QCA_WIFI_3_0
@@ -322,6 +323,37 @@ static void ce_validate_nbytes(uint32_t nbytes, struct CE_state *ce_state)
 }
 #endif
 
+/*
+ * Within a send batch, the source ring write index is written once for
+ * up to CE_TX_BATCH_MAX_PENDING descriptors, or for whatever has been
+ * posted CE_TX_BATCH_LATENCY_US after the first held back descriptor,
+ * whichever comes first. The rest is written when the batch ends.
+ */
+#define CE_TX_BATCH_MAX_PENDING 16
+#define CE_TX_BATCH_LATENCY_US  500
+
+/**
+ * ce_tx_batch_defer() - check whether a write index update can wait
+ * @CE_state: copy engine, with ce_index_lock held
+ *
+ * Return: true if the update is left to a later send or the batch end
+ */
+static inline bool ce_tx_batch_defer(struct CE_state *CE_state)
+{
+	if (!CE_state->tx_batch)
+		return false;
+
+	if (!CE_state->tx_batch_pending)
+		CE_state->tx_batch_start = qdf_get_monotonic_boottime();
+	else if (CE_state->tx_batch_pending >= CE_TX_BATCH_MAX_PENDING ||
+		 qdf_get_monotonic_boottime() - CE_state->tx_batch_start >
+		 CE_TX_BATCH_LATENCY_US)
+		return false;
+
+	CE_state->tx_batch_pending++;
+	return true;
+}
+
 static int
 ce_send_nolock(struct CE_handle *copyeng,
 			   void *per_transfer_context,
@@ -402,8 +434,11 @@ ce_send_nolock(struct CE_handle *copyeng,
 		} else if (qdf_unlikely(CE_state->state != CE_RUNNING)) {
 			event_type = HIF_TX_DESC_SOFTWARE_POST;
 			CE_state->state = CE_PENDING;
+		} else if (ce_tx_batch_defer(CE_state)) {
+			event_type = HIF_TX_DESC_SOFTWARE_POST;
 		} else {
 			event_type = HIF_TX_DESC_POST;
+			CE_state->tx_batch_pending = 0;
 			war_ce_src_ring_write_idx_set(scn, ctrl_addr,
 						      write_index);
 		}
@@ -442,6 +477,63 @@ ce_send(struct CE_handle *copyeng,
 	return status;
 }
 
+/**
+ * ce_send_batch_begin() - start holding back source ring doorbells
+ * @copyeng: copy engine handle
+ *
+ * Sends on @copyeng still post their descriptors in order, but the
+ * write index register is only updated as described above, and when
+ * the outermost ce_send_batch_end() is called. Batches may nest.
+ *
+ * Return: none
+ */
+void ce_send_batch_begin(struct CE_handle *copyeng)
+{
+	struct CE_state *CE_state = (struct CE_state *)copyeng;
+
+	qdf_spin_lock_bh(&CE_state->ce_index_lock);
+	CE_state->tx_batch++;
+	qdf_spin_unlock_bh(&CE_state->ce_index_lock);
+}
+
+/**
+ * ce_send_batch_end() - end a send batch
+ * @copyeng: copy engine handle
+ *
+ * Writes the source ring write index once for everything posted since
+ * the last update, when the outermost batch ends.
+ *
+ * Return: none
+ */
+void ce_send_batch_end(struct CE_handle *copyeng)
+{
+	struct CE_state *CE_state = (struct CE_state *)copyeng;
+	struct hif_softc *scn = CE_state->scn;
+	unsigned int write_index;
+
+	qdf_spin_lock_bh(&CE_state->ce_index_lock);
+	if (!CE_state->tx_batch || --CE_state->tx_batch ||
+	    !CE_state->tx_batch_pending)
+		goto out;
+
+	CE_state->tx_batch_pending = 0;
+	/* a CE paused meanwhile picks up the write index on resume */
+	if (CE_state->state != CE_RUNNING) {
+		CE_state->state = CE_PENDING;
+		goto out;
+	}
+	if (Q_TARGET_ACCESS_BEGIN(scn) < 0)
+		goto out;
+
+	write_index = CE_state->src_ring->write_index;
+	war_ce_src_ring_write_idx_set(scn, CE_state->ctrl_addr, write_index);
+	hif_record_ce_desc_event(scn, CE_state->id, HIF_TX_DESC_POST,
+				 NULL, NULL, write_index);
+	Q_TARGET_ACCESS_END(scn);
+out:
+	qdf_spin_unlock_bh(&CE_state->ce_index_lock);
+}
+
 unsigned int ce_sendlist_sizeof(void)
 {
 	return sizeof(struct ce_sendlist);
@@ -59,6 +59,7 @@ static inline int hif_get_irq_for_ce(struct device *dev, int ce_id)
 {
 	return pld_get_irq(dev, ce_id);
 }
+static void hnc_steer_start(struct qca_napi_data *napid);
 #else /* HELIUMPLUS */
 static inline int hif_get_irq_for_ce(struct device *dev, int ce_id)
 {
@@ -75,6 +76,10 @@ int hif_napi_cpu_blacklist(struct qca_napi_data *napid,
 {
 	return 0;
 }
+
+static inline void hnc_steer_start(struct qca_napi_data *napid)
+{
+}
 #endif /* HELIUMPLUS */
 
 /**
@@ -599,6 +604,9 @@ int hif_napi_event(struct hif_opaque_softc *hif_ctx, enum qca_napi_event event,
 						  HNC_ACT_DISPERSE);
 
 			blacklist_pending = BLACKLIST_ON_PENDING;
+			/* then follow the load instance by instance */
+			if (napid->napi_mode != QCA_NAPI_TPUT_HI)
+				hnc_steer_start(napid);
 		}
 		napid->napi_mode = tput_mode;
 		break;
@@ -837,6 +845,7 @@ int hif_napi_poll(struct hif_opaque_softc *hif_ctx,
 	int    normalized = 0;
 	int    bucket;
 	int    cpu = smp_processor_id();
+	unsigned long long poll_start = sched_clock();
 	bool poll_on_right_cpu;
 	struct hif_softc      *hif = HIF_GET_SOFTC(hif_ctx);
 	struct qca_napi_info *napi_info;
@@ -866,6 +875,9 @@ int hif_napi_poll(struct hif_opaque_softc *hif_ctx,
 	if (napi_info->offld_flush_cb)
 		napi_info->offld_flush_cb(napi_info->offld_ctx);
 
+	napi_info->steer_pkts += rc;
+	napi_info->steer_ns += sched_clock() - poll_start;
+
 	/* do not return 0, if there was some work done,
 	 * even if it is below the scale
 	 */
@@ -1033,6 +1045,21 @@ void hif_napi_stats(struct qca_napi_data *napid)
 			  cpu[i].max_freq, cpu[i].napis,
 			  cpu[i].cluster_nxt);
 	}
+
+	qdf_debug("NAPI STEERING (rx_cpu=%d)", napid->rx_cpu);
+	for (i = 0; i < NR_CPUS; i++)
+		if (cpu[i].state == QCA_NAPI_CPU_UP)
+			qdf_debug("CPU[%02d]: load:%u%%", i, cpu[i].load);
+	for (i = 0; i < CE_COUNT_MAX; i++) {
+		struct qca_napi_info *napii = napid->napis[i];
+
+		if (!napii)
+			continue;
+		qdf_debug("NAPI[%02d]: cpu:%d pkts:%llu rate:%u/s load:%u%% moves:%u votes:%d",
+			  i, napii->cpu, napii->steer_pkts, napii->steer_rate,
+			  napii->steer_load, napii->steer_moves,
+			  napii->steer_votes);
+	}
 }
 
 #ifdef FEATURE_NAPI_DEBUG
@@ -1314,6 +1341,8 @@ int hif_napi_cpu_init(struct hif_opaque_softc *hif)
 		cpus[i].napis       = 0x0;
 		cpus[i].cluster_nxt = -1; /* invalid */
 	}
+	napid->rx_cpu = -1;
+	INIT_DELAYED_WORK(&napid->steer_work, hnc_steer_work);
 
 	/* link clusters together */
 	rc = hnc_link_clusters(napid);
@@ -1361,6 +1390,8 @@ int hif_napi_cpu_deinit(struct hif_opaque_softc *hif)
 	/* uninstall hotplug notifier */
 	hnc_hotplug_unregister(HIF_GET_SOFTC(hif));
 
+	cancel_delayed_work_sync(&napid->steer_work);
+
 	/* clear the topology table */
 	memset(napid->napi_cpu, 0, sizeof(struct qca_napi_cpu) * NR_CPUS);
 
@@ -1552,6 +1583,245 @@ hncm_return:
 	return rc;
 }
 
+/*
+ * Load steering
+ *
+ * In TPUT_HI mode, after the initial dispersal, a periodic work samples the
+ * load of each NAPI instance (packets, and the time spent in hif_napi_poll)
+ * and the busy time of each CPU, and moves instances between clusters:
+ * - an instance which would take more than HNC_STEER_UP_LOAD % of a LITTLE
+ *   core goes to the big cluster,
+ * - an instance which would take less than HNC_STEER_DOWN_LOAD % of a LITTLE
+ *   core goes to the little cluster, so it does not keep gold cores awake,
+ * - in between, it follows the cluster of the rx socket reader (see
+ *   hif_napi_rx_cpu_hint()), to keep the data in a shared cache,
+ * and, within the chosen cluster, off a CPU that is more than
+ * HNC_STEER_CPU_BUSY % busy.
+ * A move needs HNC_STEER_VOTES periods in a row wanting the same cluster,
+ * and at least HNC_STEER_DWELL_MS since the instance last moved.
+ */
+#define HNC_STEER_PERIOD_MS	200
+#define HNC_STEER_DWELL_MS	1000
+#define HNC_STEER_VOTES		3
+#define HNC_STEER_UP_LOAD	70
+#define HNC_STEER_DOWN_LOAD	35
+#define HNC_STEER_CPU_BUSY	85
+
+static inline bool hnc_same_cluster(struct qca_napi_data *napid, int a, int b)
+{
+	return napid->napi_cpu[a].cluster_id == napid->napi_cpu[b].cluster_id;
+}
+
+/**
+ * hnc_steer_sample() - updates the per-NAPI and per-CPU load figures
+ * @napid: pointer to NAPI block
+ * @period_us: time since the last sample
+ *
+ * Return: None
+ */
+static void hnc_steer_sample(struct qca_napi_data *napid, uint64_t period_us)
+{
+	struct qca_napi_cpu *cpus = napid->napi_cpu;
+	struct qca_napi_info *napii;
+	uint64_t wall, idle, pkts, ns;
+	int i;
+
+	for_each_online_cpu(i) {
+		idle = get_cpu_idle_time(i, &wall, 0);
+		if (wall > cpus[i].last_wall && cpus[i].last_wall)
+			cpus[i].load = 100 - min_t(uint64_t, 100,
+				div64_u64((idle - cpus[i].last_idle) * 100,
+					  wall - cpus[i].last_wall));
+		cpus[i].last_wall = wall;
+		cpus[i].last_idle = idle;
+	}
+
+	for (i = 0; i < CE_COUNT_MAX; i++) {
+		napii = napid->napis[i];
+		if (!napii)
+			continue;
+		pkts = READ_ONCE(napii->steer_pkts);
+		ns = READ_ONCE(napii->steer_ns);
+		napii->steer_rate = div64_u64((pkts - napii->steer_last_pkts) *
+					      USEC_PER_SEC, period_us);
+		napii->steer_load = min_t(uint64_t, 100,
+					  div64_u64((ns - napii->steer_last_ns) *
+						    100, period_us * 1000));
+		napii->steer_last_pkts = pkts;
+		napii->steer_last_ns = ns;
+	}
+}
+
+/**
+ * hnc_steer_dest() - finds the least loaded CPU of a cluster
+ * @napid: pointer to NAPI block
+ * @head : index of the first CPU of the cluster
+ *
+ * Skips the CPU of the rx socket reader, unless it is the only choice.
+ *
+ * Return: >=0 : index in the cpu topology table
+ *       : < 0 : no CPU of the cluster is up
+ */
+static int hnc_steer_dest(struct qca_napi_data *napid, int head)
+{
+	struct qca_napi_cpu *cpus = napid->napi_cpu;
+	int i, dest = -1;
+	unsigned int score, best = UINT_MAX;
+
+	for (i = head; i >= 0; i = cpus[i].cluster_nxt) {
+		if (cpus[i].state != QCA_NAPI_CPU_UP)
+			continue;
+		/* every NAPI already there will add to its load */
+		score = cpus[i].load + 10 * hweight32(cpus[i].napis);
+		if (i == napid->rx_cpu)
+			score += 100;
+		if (score < best) {
+			best = score;
+			dest = i;
+		}
+	}
+	return dest;
+}
+
+/**
+ * hnc_steer() - moves NAPI instances according to their load
+ * @napid: pointer to NAPI block
+ *
+ * Called with napid->lock held.
+ *
+ * Return: None
+ */
+static void hnc_steer(struct qca_napi_data *napid)
+{
+	struct qca_napi_cpu *cpus = napid->napi_cpu;
+	struct qca_napi_info *napii;
+	unsigned int lilfrq, load;
+	int i, cpu, target, dest;
+
+	if (napid->lilcl_head < 0 || napid->bigcl_head < 0)
+		return;
+	lilfrq = cpus[napid->lilcl_head].max_freq;
+
+	for (i = 0; i < CE_COUNT_MAX; i++) {
+		napii = napid->napis[i];
+		if (!napii || !(napid->ce_map & (0x01 << i)))
+			continue;
+		cpu = napii->cpu;
+
+		/* the load this instance would put on a LITTLE core */
+		load = napii->steer_load;
+		if (lilfrq && cpus[cpu].max_freq > lilfrq)
+			load = load * cpus[cpu].max_freq / lilfrq;
+
+		if (load > HNC_STEER_UP_LOAD)
+			target = napid->bigcl_head;
+		else if (load < HNC_STEER_DOWN_LOAD)
+			target = napid->lilcl_head;
+		else if (napid->rx_cpu >= 0 &&
+			 hnc_same_cluster(napid, napid->rx_cpu,
+					  napid->bigcl_head))
+			target = napid->bigcl_head;
+		else if (napid->rx_cpu >= 0)
+			target = napid->lilcl_head;
+		else if (hnc_same_cluster(napid, cpu, napid->bigcl_head))
+			target = napid->bigcl_head;
+		else
+			target = napid->lilcl_head;
+
+		if (hnc_same_cluster(napid, cpu, target) &&
+		    cpus[cpu].load < HNC_STEER_CPU_BUSY) {
+			napii->steer_votes = 0;
+			continue;
+		}
+
+		if (napii->steer_target != target) {
+			napii->steer_target = target;
+			napii->steer_votes = 0;
+		}
+		if (++napii->steer_votes < HNC_STEER_VOTES ||
+		    time_before(jiffies, napii->steer_stamp +
+				msecs_to_jiffies(HNC_STEER_DWELL_MS)))
+			continue;
+
+		dest = hnc_steer_dest(napid, target);
+		if (dest < 0 || dest == cpu)
+			continue;
+
+		NAPI_DEBUG("%s: steering NAPI ce%d (load %u%%) from %d to %d",
+			   __func__, i, load, cpu, dest);
+		if (hncm_migrate_to(napid, i, dest) == 0) {
+			napii->steer_moves++;
+			napii->steer_stamp = jiffies;
+		}
+		napii->steer_votes = 0;
+	}
+}
+
+static void hnc_steer_work(struct work_struct *work)
+{
+	struct qca_napi_data *napid = container_of(to_delayed_work(work),
+						   struct qca_napi_data,
+						   steer_work);
+	bool again;
+
+	qdf_spin_lock_bh(&napid->lock);
+	again = (napid->napi_mode == QCA_NAPI_TPUT_HI) && napid->ce_map;
+	if (again) {
+		hnc_steer_sample(napid, HNC_STEER_PERIOD_MS * USEC_PER_MSEC);
+		hnc_steer(napid);
+	}
+	qdf_spin_unlock_bh(&napid->lock);
+
+	if (again)
+		schedule_delayed_work(&napid->steer_work,
+				      msecs_to_jiffies(HNC_STEER_PERIOD_MS));
+}
+
+/**
+ * hnc_steer_start() - starts load steering
+ * @napid: pointer to NAPI block
+ *
+ * Called on entering TPUT_HI mode, with napid->lock held. The work stops by
+ * itself once the mode changes.
+ *
+ * Return: None
+ */
+static void hnc_steer_start(struct qca_napi_data *napid)
+{
+	int i;
+
+	/* the first period only takes the baseline */
+	for (i = 0; i < NR_CPUS; i++)
+		napid->napi_cpu[i].last_wall = 0;
+	for (i = 0; i < CE_COUNT_MAX; i++)
+		if (napid->napis[i]) {
+			napid->napis[i]->steer_target = -1;
+			napid->napis[i]->steer_votes = 0;
+			/* just dispersed: the dwell time starts now */
+			napid->napis[i]->steer_stamp = jiffies;
+		}
+	schedule_delayed_work(&napid->steer_work,
+			      msecs_to_jiffies(HNC_STEER_PERIOD_MS));
+}
+
+/**
+ * hif_napi_rx_cpu_hint() - tells NAPI where the rx socket reader runs
+ * @hif: hif context
+ * @cpu: the CPU the reader last ran on, or -1 if unknown
+ *
+ * Load steering keeps moderately loaded instances on the reader's cluster.
+ *
+ * Return: None
+ */
+void hif_napi_rx_cpu_hint(struct hif_opaque_softc *hif, int cpu)
+{
+	struct qca_napi_data *napid = &HIF_GET_SOFTC(hif)->napi_data;
+
+	if (cpu >= nr_cpu_ids)
+		cpu = -1;
+	WRITE_ONCE(napid->rx_cpu, cpu);
+}
+
 
 /**
  * hif_napi_bl_irq() - calls irq_modify_status to enable/disable blacklisting
@@ -115,6 +115,15 @@ QDF_STATUS hif_send_head(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
 				nbytes, buf);
 }
 
+/* SDIO writes each buffer on its own, there is no doorbell to share */
+void hif_send_batch_begin(struct hif_opaque_softc *hif_ctx, uint8_t pipe)
+{
+}
+
+void hif_send_batch_end(struct hif_opaque_softc *hif_ctx, uint8_t pipe)
+{
+}
+
 /**
  * hif_map_service_to_pipe() - maps ul/dl pipe to service id.
  * @hif_ctx: HIF hdl
@@ -284,6 +284,15 @@ QDF_STATUS hif_send_head(struct hif_opaque_softc *scn, uint8_t pipe_id,
 	return status;
 }
 
+/* each URB is submitted on its own, there is no doorbell to share */
+void hif_send_batch_begin(struct hif_opaque_softc *scn, uint8_t pipe_id)
+{
+}
+
+void hif_send_batch_end(struct hif_opaque_softc *scn, uint8_t pipe_id)
+{
+}
+
 /**
  * hif_get_free_queue_number() - get # of free TX resources in a given HIF pipe
  * @scn: pointer to hif_opaque_softc structure
@@ -93,6 +93,7 @@ typedef union {
  *   @rx.tcp_seq_num     : TCP sequence number
  *   @rx.tcp_ack_num     : TCP ACK number
  *   @rx.flow_id_toeplitz: 32-bit 5-tuple Toeplitz hash
+ *   @rx.pool_off        : data offset of an rx pool buffer, 0 if not pooled
  * @tx.extra_frag  : represent HTC/HTT header
  * @tx.efrag.vaddr       : virtual address of ~
  * @tx.efrag.paddr       : physical/DMA address of ~
@@ -147,7 +148,8 @@ struct qdf_nbuf_cb {
 				uint8_t dp_trace:1,
 						rsrvd:7;
 			} trace;
-		} rx; /* 20 bytes */
+			uint16_t pool_off;
+		} rx; /* 28 bytes */
 
 		/* Note: MAX: 40 bytes */
 		struct {
@@ -245,6 +247,8 @@ struct qdf_nbuf_cb {
 	(((struct qdf_nbuf_cb *)((skb)->cb))->u.rx.flow_id_toeplitz)
 #define QDF_NBUF_CB_RX_DP_TRACE(skb) \
 	(((struct qdf_nbuf_cb *)((skb)->cb))->u.rx.trace.dp_trace)
+#define QDF_NBUF_CB_RX_POOL_OFF(skb) \
+	(((struct qdf_nbuf_cb *)((skb)->cb))->u.rx.pool_off)
 
 #define QDF_NBUF_CB_TX_EXTRA_FRAG_VADDR(skb) \
 	(((struct qdf_nbuf_cb *)((skb)->cb))->u.tx.extra_frag.vaddr)
@@ -472,6 +476,21 @@ void __qdf_nbuf_unmap_single(__qdf_device_t osdev,
 void __qdf_nbuf_reg_trace_cb(qdf_nbuf_trace_update_t cb_func_ptr);
 void __qdf_nbuf_reg_free_cb(qdf_nbuf_free_t cb_func_ptr);
 
+/* rx buffer recycling, one pool per pdev; buffers stay dma mapped */
+typedef struct __qdf_nbuf_rx_pool *__qdf_nbuf_rx_pool_t;
+
+__qdf_nbuf_rx_pool_t __qdf_nbuf_rx_pool_create(__qdf_device_t osdev,
+					       size_t size, int reserve,
+					       int align, uint32_t cap);
+void __qdf_nbuf_rx_pool_destroy(__qdf_nbuf_rx_pool_t pool);
+struct sk_buff *__qdf_nbuf_rx_pool_alloc(__qdf_nbuf_rx_pool_t pool);
+void __qdf_nbuf_rx_pool_sync_for_cpu(__qdf_nbuf_rx_pool_t pool,
+				     struct sk_buff *skb);
+void __qdf_nbuf_rx_pool_detach(__qdf_nbuf_rx_pool_t pool,
+			       struct sk_buff *skb);
+void __qdf_nbuf_rx_pool_free(__qdf_nbuf_rx_pool_t pool, struct sk_buff *skb);
+void __qdf_nbuf_rx_pool_stats(__qdf_nbuf_rx_pool_t pool);
+
 QDF_STATUS __qdf_nbuf_dmamap_create(qdf_device_t osdev, __qdf_dma_map_t *dmap);
 void __qdf_nbuf_dmamap_destroy(qdf_device_t osdev, __qdf_dma_map_t dmap);
 void __qdf_nbuf_dmamap_set_cb(__qdf_dma_map_t dmap, void *cb, void *arg);
@@ -299,7 +299,14 @@ struct sk_buff *__qdf_nbuf_alloc(qdf_device_t osdev, size_t size, int reserve,
 #endif
 	}
 
-	skb = __netdev_alloc_skb(NULL, size, flags);
+	/*
+	 * RX ring refill runs from the tasklet; use the per-CPU NAPI caches
+	 * there so the skb head is taken from a bulk refilled cache.
+	 */
+	if (in_serving_softirq())
+		skb = __napi_alloc_skb(NULL, size, flags);
+	else
+		skb = __netdev_alloc_skb(NULL, size, flags);
 
 	if (skb)
 		goto skb_alloc;
@@ -363,6 +370,392 @@ void __qdf_nbuf_free(struct sk_buff *skb)
 }
 qdf_export_symbol(__qdf_nbuf_free);
 
+/*
+ * RX buffer recycling
+ *
+ * A pool keeps rx buffers which the driver consumed itself (HTT messages,
+ * dropped frames) for the next ring refill, still dma mapped, so the refill
+ * skips the skb allocation, the free and the dma map and unmap. Buffers
+ * handed to the stack leave the pool through __qdf_nbuf_rx_pool_detach().
+ * The pool holds up to @cap buffers, and gives them back to the page
+ * allocator on memory pressure through a shrinker.
+ *
+ * A pool buffer is mapped from its data offset at allocation time, kept in
+ * QDF_NBUF_CB_RX_POOL_OFF(), to the end of the buffer, like
+ * __qdf_nbuf_map_single() would map it.
+ */
+struct __qdf_nbuf_rx_pool {
+	qdf_device_t osdev;
+	spinlock_t lock;
+	struct sk_buff_head bufs;
+	size_t size;
+	int reserve;
+	int align;
+	uint32_t cap;
+	struct shrinker shrinker;
+	/* stats */
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t recycled;
+	uint32_t rejected;
+	uint32_t overflows;
+	uint32_t shrunk;
+};
+
+static inline size_t __qdf_nbuf_rx_pool_map_len(struct sk_buff *skb)
+{
+	return skb_end_offset(skb) - QDF_NBUF_CB_RX_POOL_OFF(skb);
+}
+
+#if defined(A_SIMOS_DEVHOST) || defined(HIF_USB)
+static inline void
+__qdf_nbuf_rx_pool_unmap(struct __qdf_nbuf_rx_pool *pool, struct sk_buff *skb)
+{
+}
+
+static inline void
+__qdf_nbuf_rx_pool_sync_for_device(struct __qdf_nbuf_rx_pool *pool,
+				   struct sk_buff *skb)
+{
+}
+#else
+static inline void
+__qdf_nbuf_rx_pool_unmap(struct __qdf_nbuf_rx_pool *pool, struct sk_buff *skb)
+{
+	dma_unmap_single(pool->osdev->dev, QDF_NBUF_CB_PADDR(skb),
+			 __qdf_nbuf_rx_pool_map_len(skb), DMA_FROM_DEVICE);
+}
+
+static inline void
+__qdf_nbuf_rx_pool_sync_for_device(struct __qdf_nbuf_rx_pool *pool,
+				   struct sk_buff *skb)
+{
+	dma_sync_single_for_device(pool->osdev->dev, QDF_NBUF_CB_PADDR(skb),
+				   __qdf_nbuf_rx_pool_map_len(skb),
+				   DMA_FROM_DEVICE);
+}
+#endif
+
+/**
+ * __qdf_nbuf_rx_pool_reusable() - check that a buffer can go back to the pool
+ * @skb: Pointer to network buffer
+ *
+ * The buffer must be the only reference to its data, linear, and hold
+ * nothing that a free would have to release.
+ *
+ * Return: true if the buffer can be reset and reused
+ */
+static bool __qdf_nbuf_rx_pool_reusable(struct sk_buff *skb)
+{
+	if (skb_cloned(skb) || skb_shared(skb) || skb_is_nonlinear(skb) ||
+	    skb_has_frag_list(skb))
+		return false;
+	if (skb->destructor || skb->sk || skb_dst(skb))
+		return false;
+#ifdef CONFIG_XFRM
+	if (skb->sp)
+		return false;
+#endif
+#if IS_ENABLED(CONFIG_NF_CONNTRACK)
+	if (skb->nfct)
+		return false;
+#endif
+	return true;
+}
+
+/**
+ * __qdf_nbuf_rx_pool_reset() - bring a consumed buffer back to its alloc state
+ * @skb: Pointer to network buffer
+ *
+ * Return: none
+ */
+static void __qdf_nbuf_rx_pool_reset(struct sk_buff *skb)
+{
+	struct skb_shared_info *shinfo = skb_shinfo(skb);
+	qdf_dma_addr_t paddr = QDF_NBUF_CB_PADDR(skb);
+	uint16_t off = QDF_NBUF_CB_RX_POOL_OFF(skb);
+	uint8_t head_frag = skb->head_frag;
+	uint8_t pfmemalloc = skb->pfmemalloc;
+
+	memset(skb, 0, offsetof(struct sk_buff, tail));
+	skb->head_frag = head_frag;
+	skb->pfmemalloc = pfmemalloc;
+	skb->mac_header = (typeof(skb->mac_header))~0U;
+	skb->transport_header = (typeof(skb->transport_header))~0U;
+	skb->data = skb->head + off;
+	skb_reset_tail_pointer(skb);
+
+	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
+	atomic_set(&shinfo->dataref, 1);
+
+	QDF_NBUF_CB_PADDR(skb) = paddr;
+	QDF_NBUF_CB_RX_POOL_OFF(skb) = off;
+	QDF_NBUF_CB_TX_EXTRA_FRAG_WORDSTR_EFRAG(skb) = 1;
+	QDF_NBUF_CB_TX_EXTRA_FRAG_WORDSTR_NBUF(skb) = 1;
+}
+
+static unsigned long
+__qdf_nbuf_rx_pool_shrink_count(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	struct __qdf_nbuf_rx_pool *pool =
+		container_of(shrinker, struct __qdf_nbuf_rx_pool, shrinker);
+
+	return skb_queue_len(&pool->bufs);
+}
+
+/**
+ * __qdf_nbuf_rx_pool_drain() - unmap and free up to @nr pooled buffers
+ * @pool: rx buffer pool
+ * @nr: number of buffers to free
+ *
+ * Return: number of buffers freed
+ */
+static unsigned long __qdf_nbuf_rx_pool_drain(struct __qdf_nbuf_rx_pool *pool,
+					      unsigned long nr)
+{
+	struct sk_buff_head list;
+	struct sk_buff *skb;
+	unsigned long flags, freed = 0;
+
+	__skb_queue_head_init(&list);
+	spin_lock_irqsave(&pool->lock, flags);
+	while (freed < nr && (skb = __skb_dequeue(&pool->bufs))) {
+		__skb_queue_tail(&list, skb);
+		freed++;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	while ((skb = __skb_dequeue(&list))) {
+		__qdf_nbuf_rx_pool_unmap(pool, skb);
+		__qdf_nbuf_free(skb);
+	}
+	return freed;
+}
+
+static unsigned long
+__qdf_nbuf_rx_pool_shrink_scan(struct shrinker *shrinker,
+			       struct shrink_control *sc)
+{
+	struct __qdf_nbuf_rx_pool *pool =
+		container_of(shrinker, struct __qdf_nbuf_rx_pool, shrinker);
+	unsigned long freed;
+
+	freed = __qdf_nbuf_rx_pool_drain(pool, sc->nr_to_scan);
+	pool->shrunk += freed;
+	return freed ? freed : SHRINK_STOP;
+}
+
+/**
+ * __qdf_nbuf_rx_pool_create() - create an rx buffer recycling pool
+ * @osdev: OS device the buffers are mapped for
+ * @size: rx buffer size, as for __qdf_nbuf_alloc()
+ * @reserve: headroom, as for __qdf_nbuf_alloc()
+ * @align: alignment, as for __qdf_nbuf_alloc()
+ * @cap: maximum number of buffers kept in the pool
+ *
+ * Return: pool handle or %NULL if no memory
+ */
+__qdf_nbuf_rx_pool_t __qdf_nbuf_rx_pool_create(qdf_device_t osdev,
+					       size_t size, int reserve,
+					       int align, uint32_t cap)
+{
+	struct __qdf_nbuf_rx_pool *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	pool->osdev = osdev;
+	spin_lock_init(&pool->lock);
+	__skb_queue_head_init(&pool->bufs);
+	pool->size = size;
+	pool->reserve = reserve;
+	pool->align = align;
+	pool->cap = cap;
+
+	pool->shrinker.count_objects = __qdf_nbuf_rx_pool_shrink_count;
+	pool->shrinker.scan_objects = __qdf_nbuf_rx_pool_shrink_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&pool->shrinker)) {
+		kfree(pool);
+		return NULL;
+	}
+	return pool;
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_create);
+
+/**
+ * __qdf_nbuf_rx_pool_destroy() - free a pool and the buffers it holds
+ * @pool: rx buffer pool
+ *
+ * Buffers still out of the pool must have been detached or freed before.
+ *
+ * Return: none
+ */
+void __qdf_nbuf_rx_pool_destroy(__qdf_nbuf_rx_pool_t pool)
+{
+	if (!pool)
+		return;
+
+	unregister_shrinker(&pool->shrinker);
+	__qdf_nbuf_rx_pool_drain(pool, ULONG_MAX);
+	kfree(pool);
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_destroy);
+
+/**
+ * __qdf_nbuf_rx_pool_alloc() - get a dma mapped rx buffer
+ * @pool: rx buffer pool
+ *
+ * Takes a recycled buffer if there is one, or allocates and maps a new one.
+ * QDF_NBUF_CB_PADDR() holds the dma address of the buffer data.
+ *
+ * Return: nbuf or %NULL if no memory
+ */
+struct sk_buff *__qdf_nbuf_rx_pool_alloc(__qdf_nbuf_rx_pool_t pool)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	skb = __skb_dequeue(&pool->bufs);
+	if (skb)
+		pool->hits++;
+	else
+		pool->misses++;
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (skb)
+		return skb;
+
+	skb = __qdf_nbuf_alloc(pool->osdev, pool->size, pool->reserve,
+			       pool->align, 0);
+	if (!skb)
+		return NULL;
+
+	if (__qdf_nbuf_map_single(pool->osdev, skb, QDF_DMA_FROM_DEVICE) !=
+	    QDF_STATUS_SUCCESS) {
+		__qdf_nbuf_free(skb);
+		return NULL;
+	}
+	QDF_NBUF_CB_RX_POOL_OFF(skb) = skb_headroom(skb);
+	return skb;
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_alloc);
+
+/**
+ * __qdf_nbuf_rx_pool_sync_for_cpu() - make the device's data visible
+ * @pool: rx buffer pool
+ * @skb: Pointer to network buffer
+ *
+ * Replaces the unmap on ring reap, for buffers which may be recycled.
+ *
+ * Return: none
+ */
+#if defined(A_SIMOS_DEVHOST) || defined(HIF_USB)
+void __qdf_nbuf_rx_pool_sync_for_cpu(__qdf_nbuf_rx_pool_t pool,
+				     struct sk_buff *skb)
+{
+}
+#else
+void __qdf_nbuf_rx_pool_sync_for_cpu(__qdf_nbuf_rx_pool_t pool,
+				     struct sk_buff *skb)
+{
+	dma_sync_single_for_cpu(pool->osdev->dev, QDF_NBUF_CB_PADDR(skb),
+				__qdf_nbuf_rx_pool_map_len(skb),
+				DMA_FROM_DEVICE);
+}
+#endif
+qdf_export_symbol(__qdf_nbuf_rx_pool_sync_for_cpu);
+
+/**
+ * __qdf_nbuf_rx_pool_detach() - take a buffer out of the pool for good
+ * @pool: rx buffer pool
+ * @skb: Pointer to network buffer
+ *
+ * Unmaps the buffer, before it is handed to the network stack.
+ *
+ * Return: none
+ */
+void __qdf_nbuf_rx_pool_detach(__qdf_nbuf_rx_pool_t pool, struct sk_buff *skb)
+{
+	if (!QDF_NBUF_CB_RX_POOL_OFF(skb))
+		return;
+
+	__qdf_nbuf_rx_pool_unmap(pool, skb);
+	QDF_NBUF_CB_PADDR(skb) = 0;
+	QDF_NBUF_CB_RX_POOL_OFF(skb) = 0;
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_detach);
+
+/**
+ * __qdf_nbuf_rx_pool_free() - return a consumed rx buffer
+ * @pool: rx buffer pool
+ * @skb: Pointer to network buffer
+ *
+ * Keeps the buffer, still mapped, for the next __qdf_nbuf_rx_pool_alloc(),
+ * unless it was cloned or otherwise cannot be reset, or the pool is full; it
+ * is then unmapped and freed.
+ *
+ * Return: none
+ */
+void __qdf_nbuf_rx_pool_free(__qdf_nbuf_rx_pool_t pool, struct sk_buff *skb)
+{
+	unsigned long flags;
+
+	if (!QDF_NBUF_CB_RX_POOL_OFF(skb)) {
+		__qdf_nbuf_free(skb);
+		return;
+	}
+
+	if (!__qdf_nbuf_rx_pool_reusable(skb)) {
+		pool->rejected++;
+		__qdf_nbuf_rx_pool_detach(pool, skb);
+		__qdf_nbuf_free(skb);
+		return;
+	}
+
+	__qdf_nbuf_rx_pool_reset(skb);
+	__qdf_nbuf_rx_pool_sync_for_device(pool, skb);
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (skb_queue_len(&pool->bufs) < pool->cap) {
+		__skb_queue_head(&pool->bufs, skb);
+		pool->recycled++;
+		skb = NULL;
+	} else {
+		pool->overflows++;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (skb) {
+		__qdf_nbuf_rx_pool_detach(pool, skb);
+		__qdf_nbuf_free(skb);
+	}
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_free);
+
+/**
+ * __qdf_nbuf_rx_pool_stats() - print the pool statistics
+ * @pool: rx buffer pool
+ *
+ * Return: none
+ */
+void __qdf_nbuf_rx_pool_stats(__qdf_nbuf_rx_pool_t pool)
+{
+	uint32_t allocs = pool->hits + pool->misses;
+
+	qdf_print("RX pool: %u of %u buffers, hits %u misses %u (%u%% hit)",
+		  skb_queue_len(&pool->bufs), pool->cap, pool->hits,
+		  pool->misses, allocs ? (uint32_t)
+		  div_u64((uint64_t)pool->hits * 100, allocs) : 0);
+	qdf_print("RX pool: recycled %u rejected %u overflows %u shrunk %u",
+		  pool->recycled, pool->rejected, pool->overflows,
+		  pool->shrunk);
+}
+qdf_export_symbol(__qdf_nbuf_rx_pool_stats);
+
 #ifdef MEMORY_DEBUG
 enum qdf_nbuf_event_type {
 	QDF_NBUF_ALLOC,
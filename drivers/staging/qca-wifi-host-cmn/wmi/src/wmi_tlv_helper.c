@@ -52,6 +52,119 @@ A_UINT32 evt_attr_list[] = {
 	WMITLV_ALL_EVT_LIST(WMITLV_GET_CMD_EVT_ATTRB_LIST)
 };
 
+/*
+ * Build time descriptors of the attribute lists above, so that finding
+ * the attributes of a command/event does not walk the whole list.
+ *
+ * The layout structs mirror cmd_attr_list/evt_attr_list with one member
+ * per command/event, sized like its run of entries, so offsetof() gives
+ * the index of its first entry.
+ */
+#define WMITLV_ATTRB_LAYOUT_MEMBER(id) \
+	A_UINT32 attr_##id[1 + WMITLV_GET_TAG_NUM_TLV_ATTRIB(id)];
+
+struct wmitlv_cmd_attr_layout {
+	WMITLV_ALL_CMD_LIST(WMITLV_ATTRB_LAYOUT_MEMBER)
+};
+
+struct wmitlv_evt_attr_layout {
+	WMITLV_ALL_EVT_LIST(WMITLV_ATTRB_LAYOUT_MEMBER)
+};
+
+/* length of a TLV, header included, when it has its defined size */
+#define WMITLV_FIXED_TLV_LEN(tag, struc_size, arr_size) \
+	(((tag) >= WMITLV_TAG_FIRST_ARRAY_ENUM && \
+	  (tag) <= WMITLV_TAG_LAST_ARRAY_ENUM) ? \
+	 (WMI_TLV_HDR_SIZE + ((tag) == WMITLV_TAG_ARRAY_BYTE ? \
+	  (((struc_size) * (arr_size) + 3) & ~3) : \
+	  (struc_size) * (arr_size))) : \
+	 (struc_size))
+
+#define WMITLV_OP_VARIED_macro(param_ptr, param_len, wmi_cmd_event_id, \
+	elem_tlv_tag, elem_struc_type, elem_name, var_len, arr_size)  \
+	| (var_len)
+
+#define WMITLV_OP_FIXED_LEN_macro(param_ptr, param_len, wmi_cmd_event_id, \
+	elem_tlv_tag, elem_struc_type, elem_name, var_len, arr_size)  \
+	+ WMITLV_FIXED_TLV_LEN(elem_tlv_tag, sizeof(elem_struc_type), arr_size)
+
+/**
+ * struct wmitlv_attr_desc - layout of one command/event
+ * @id: command/event id
+ * @base: index of its first entry in cmd_attr_list/evt_attr_list
+ * @num_tlvs: number of TLVs
+ * @fixed: no TLV is variable sized
+ * @fixed_len: total length of the TLVs, valid if @fixed
+ */
+struct wmitlv_attr_desc {
+	A_UINT32 id;
+	A_UINT16 base;
+	A_UINT8 num_tlvs;
+	A_UINT8 fixed;
+	A_UINT32 fixed_len;
+};
+
+#define WMITLV_ATTRB_DESC(layout, cmd_evt_id) \
+	{ \
+		.id = cmd_evt_id, \
+		.base = offsetof(struct layout, attr_##cmd_evt_id) / \
+			sizeof(A_UINT32), \
+		.num_tlvs = WMITLV_GET_TAG_NUM_TLV_ATTRIB(cmd_evt_id), \
+		.fixed = !(0 WMITLV_TABLE(cmd_evt_id, VARIED, NULL, 0)), \
+		.fixed_len = 0 WMITLV_TABLE(cmd_evt_id, FIXED_LEN, NULL, 0), \
+	},
+#define WMITLV_CMD_ATTRB_DESC(id) WMITLV_ATTRB_DESC(wmitlv_cmd_attr_layout, id)
+#define WMITLV_EVT_ATTRB_DESC(id) WMITLV_ATTRB_DESC(wmitlv_evt_attr_layout, id)
+
+static const struct wmitlv_attr_desc cmd_attr_desc[] = {
+	WMITLV_ALL_CMD_LIST(WMITLV_CMD_ATTRB_DESC)
+};
+
+static const struct wmitlv_attr_desc evt_attr_desc[] = {
+	WMITLV_ALL_EVT_LIST(WMITLV_EVT_ATTRB_DESC)
+};
+
+/**
+ * wmitlv_get_desc() - find the layout descriptor of a command/event
+ * @is_cmd_id: boolean for command attribute
+ * @cmd_event_id: command event id
+ *
+ * The walkers look up the same id once per TLV, so the last hit is
+ * remembered. Racing lookups just miss the cache, the id is checked.
+ *
+ * Return: the descriptor, or NULL if the id has no definitions
+ */
+static const struct wmitlv_attr_desc *
+wmitlv_get_desc(A_UINT32 is_cmd_id, A_UINT32 cmd_event_id)
+{
+	static const struct wmitlv_attr_desc *last_cmd_desc, *last_evt_desc;
+	const struct wmitlv_attr_desc **last, *desc;
+	A_UINT32 i, num_entries;
+
+	cmd_event_id = WMITLV_GET_CMDID(cmd_event_id);
+	if (is_cmd_id) {
+		last = &last_cmd_desc;
+		desc = cmd_attr_desc;
+		num_entries = QDF_ARRAY_SIZE(cmd_attr_desc);
+	} else {
+		last = &last_evt_desc;
+		desc = evt_attr_desc;
+		num_entries = QDF_ARRAY_SIZE(evt_attr_desc);
+	}
+
+	if (*last && (*last)->id == cmd_event_id)
+		return *last;
+
+	for (i = 0; i < num_entries; i++, desc++) {
+		if (WMITLV_GET_CMDID(desc->id) == cmd_event_id) {
+			*last = desc;
+			return desc;
+		}
+	}
+
+	return NULL;
+}
+
 #ifdef NO_DYNAMIC_MEM_ALLOC
 static wmitlv_cmd_param_info *g_wmi_static_cmd_param_info_buf;
 A_UINT32 g_wmi_static_max_cmd_param_tlvs;
@@ -104,73 +217,57 @@ A_UINT32 wmitlv_get_attributes(A_UINT32 is_cmd_id, A_UINT32 cmd_event_id,
 			       A_UINT32 curr_tlv_order,
 			       wmitlv_attributes_struc *tlv_attr_ptr)
 {
-	A_UINT32 i, base_index, num_tlvs, num_entries;
+	A_UINT32 base_index, num_tlvs, attr;
 	A_UINT32 *pAttrArrayList;
+	const struct wmitlv_attr_desc *desc;
 
-	if (is_cmd_id) {
-		pAttrArrayList = &cmd_attr_list[0];
-		num_entries = QDF_ARRAY_SIZE(cmd_attr_list);
-	} else {
-		pAttrArrayList = &evt_attr_list[0];
-		num_entries = QDF_ARRAY_SIZE(evt_attr_list);
+	desc = wmitlv_get_desc(is_cmd_id, cmd_event_id);
+	if (!desc) {
+		wmi_tlv_print_error
+			("%s: ERROR: Didn't found WMI TLV attribute definitions for %s:0x%x\n",
+			__func__, (is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
+		return 1;
 	}
 
-	for (i = 0; i < num_entries; i++) {
-		num_tlvs = WMITLV_GET_NUM_TLVS(pAttrArrayList[i]);
-		if (WMITLV_GET_CMDID(cmd_event_id) ==
-		    WMITLV_GET_CMDID(pAttrArrayList[i])) {
-			tlv_attr_ptr->cmd_num_tlv = num_tlvs;
-			/* Return success from here when only number of TLVS for
-			 * this command/event is required */
-			if (curr_tlv_order == WMITLV_GET_ATTRIB_NUM_TLVS) {
-				wmi_tlv_print_verbose
-					("%s: WMI TLV attribute definitions for %s:0x%x found; num_of_tlvs:%d\n",
-					__func__, (is_cmd_id ? "Cmd" : "Evt"),
-					cmd_event_id, num_tlvs);
-				return 0;
-			}
+	if (is_cmd_id)
+		pAttrArrayList = &cmd_attr_list[0];
+	else
+		pAttrArrayList = &evt_attr_list[0];
 
-			/* Return failure if tlv_order is more than the expected
-			 * number of TLVs */
-			if (curr_tlv_order >= num_tlvs) {
-				wmi_tlv_print_error
-					("%s: ERROR: TLV order %d greater than num_of_tlvs:%d for %s:0x%x\n",
-					__func__, curr_tlv_order, num_tlvs,
-					(is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
-				return 1;
-			}
+	num_tlvs = desc->num_tlvs;
+	tlv_attr_ptr->cmd_num_tlv = num_tlvs;
+	/* Return success from here when only number of TLVS for
+	 * this command/event is required */
+	if (curr_tlv_order == WMITLV_GET_ATTRIB_NUM_TLVS) {
+		wmi_tlv_print_verbose
+			("%s: WMI TLV attribute definitions for %s:0x%x found; num_of_tlvs:%d\n",
+			__func__, (is_cmd_id ? "Cmd" : "Evt"),
+			cmd_event_id, num_tlvs);
+		return 0;
+	}
 
-			base_index = i + 1;     /* index to first TLV attributes */
-			wmi_tlv_print_verbose
-				("%s: WMI TLV attributes for %s:0x%x tlv[%d]:0x%x\n",
-				__func__, (is_cmd_id ? "Cmd" : "Evt"),
-				cmd_event_id, curr_tlv_order,
-				pAttrArrayList[(base_index + curr_tlv_order)]);
-			tlv_attr_ptr->tag_order = curr_tlv_order;
-			tlv_attr_ptr->tag_id =
-				WMITLV_GET_TAGID(pAttrArrayList
-						 [(base_index + curr_tlv_order)]);
-			tlv_attr_ptr->tag_struct_size =
-				WMITLV_GET_TAG_STRUCT_SIZE(pAttrArrayList
-							   [(base_index +
-							     curr_tlv_order)]);
-			tlv_attr_ptr->tag_varied_size =
-				WMITLV_GET_TAG_VARIED(pAttrArrayList
-						      [(base_index +
-							curr_tlv_order)]);
-			tlv_attr_ptr->tag_array_size =
-				WMITLV_GET_TAG_ARRAY_SIZE(pAttrArrayList
-							  [(base_index +
-							    curr_tlv_order)]);
-			return 0;
-		}
-		i += num_tlvs;
+	/* Return failure if tlv_order is more than the expected
+	 * number of TLVs */
+	if (curr_tlv_order >= num_tlvs) {
+		wmi_tlv_print_error
+			("%s: ERROR: TLV order %d greater than num_of_tlvs:%d for %s:0x%x\n",
+			__func__, curr_tlv_order, num_tlvs,
+			(is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
+		return 1;
 	}
 
-	wmi_tlv_print_error
-		("%s: ERROR: Didn't found WMI TLV attribute definitions for %s:0x%x\n",
-		__func__, (is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
-	return 1;
+	base_index = desc->base + 1;     /* index to first TLV attributes */
+	attr = pAttrArrayList[base_index + curr_tlv_order];
+	wmi_tlv_print_verbose
+		("%s: WMI TLV attributes for %s:0x%x tlv[%d]:0x%x\n",
+		__func__, (is_cmd_id ? "Cmd" : "Evt"),
+		cmd_event_id, curr_tlv_order, attr);
+	tlv_attr_ptr->tag_order = curr_tlv_order;
+	tlv_attr_ptr->tag_id = WMITLV_GET_TAGID(attr);
+	tlv_attr_ptr->tag_struct_size = WMITLV_GET_TAG_STRUCT_SIZE(attr);
+	tlv_attr_ptr->tag_varied_size = WMITLV_GET_TAG_VARIED(attr);
+	tlv_attr_ptr->tag_array_size = WMITLV_GET_TAG_ARRAY_SIZE(attr);
+	return 0;
 }
 
 /**
@@ -467,6 +564,68 @@ wmitlv_check_command_tlv_params(void *os_handle, void *param_struc_ptr,
 			wmi_cmd_event_id);
 }
 
+/**
+ * wmitlv_fixed_layout_tlvs() - fast path for fixed layout TLVs
+ * @is_cmd_id: boolean for command attribute
+ * @wmi_cmd_event_id: command event id
+ * @buf_ptr: pointer to the first TLV
+ * @param_buf_len: length of the TLVs
+ * @cmd_param_tlvs_ptr: zeroed wmi_cmd_event_id##_param_tlvs structure
+ *
+ * When no TLV of the command/event is variable sized and the buffer
+ * has exactly the defined length, every TLV can be used in place.
+ * Only the headers are checked against the attributes, and the generic
+ * walk with its padding cases is skipped.
+ *
+ * Return: 0 if the TLVs were taken, < 0 if the generic walk must run
+ */
+static int
+wmitlv_fixed_layout_tlvs(A_UINT32 is_cmd_id, A_UINT32 wmi_cmd_event_id,
+			 A_UINT8 *buf_ptr, A_UINT32 param_buf_len,
+			 wmitlv_cmd_param_info *cmd_param_tlvs_ptr)
+{
+	const struct wmitlv_attr_desc *desc;
+	A_UINT32 *attr_list;
+	A_UINT32 i;
+
+	desc = wmitlv_get_desc(is_cmd_id, wmi_cmd_event_id);
+	if (!desc || !desc->fixed || desc->fixed_len != param_buf_len)
+		return -1;
+
+	attr_list = is_cmd_id ? cmd_attr_list : evt_attr_list;
+	attr_list += desc->base + 1;
+	for (i = 0; i < desc->num_tlvs; i++) {
+		A_UINT32 tag = WMITLV_GET_TAGID(attr_list[i]);
+		A_UINT32 arr_size = WMITLV_GET_TAG_ARRAY_SIZE(attr_list[i]);
+		A_UINT32 len = WMITLV_FIXED_TLV_LEN(tag,
+				WMITLV_GET_TAG_STRUCT_SIZE(attr_list[i]),
+				arr_size);
+		A_UINT32 hdr = WMITLV_GET_HDR(buf_ptr);
+
+		if (WMITLV_GET_TLVTAG(hdr) != tag ||
+		    WMITLV_GET_TLVLEN(hdr) + WMI_TLV_HDR_SIZE != len) {
+			wmi_tlv_OS_MEMZERO(cmd_param_tlvs_ptr,
+					   desc->num_tlvs *
+					   sizeof(wmitlv_cmd_param_info));
+			return -1;
+		}
+
+		if (tag >= WMITLV_TAG_FIRST_ARRAY_ENUM &&
+		    tag <= WMITLV_TAG_LAST_ARRAY_ENUM) {
+			cmd_param_tlvs_ptr[i].tlv_ptr =
+				buf_ptr + WMI_TLV_HDR_SIZE;
+			cmd_param_tlvs_ptr[i].num_elements = arr_size;
+		} else {
+			cmd_param_tlvs_ptr[i].tlv_ptr = buf_ptr;
+			cmd_param_tlvs_ptr[i].num_elements =
+				len > WMI_TLV_HDR_SIZE ? 1 : 0;
+		}
+		buf_ptr += len;
+	}
+
+	return 0;
+}
+
 /**
  * wmitlv_check_and_pad_tlvs() - tlv helper function
  * @os_handle: os context handle
@@ -551,6 +710,10 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 	wmi_tlv_OS_MEMZERO(cmd_param_tlvs_ptr, len_wmi_cmd_struct_buf);
 	remaining_expected_tlvs = attr_struct_ptr.cmd_num_tlv;
 
+	if (!wmitlv_fixed_layout_tlvs(is_cmd_id, wmi_cmd_event_id, buf_ptr,
+				      param_buf_len, cmd_param_tlvs_ptr))
+		return 0;
+
 	while (((buf_idx + WMI_TLV_HDR_SIZE) <= param_buf_len)
 	       && (remaining_expected_tlvs)) {
 		A_UINT32 curr_tlv_tag =
@@ -21,6 +21,7 @@
  */
 #include "htc_api.h"
 #include "htc_api.h"
+#include "hif.h"
 #include "wmi_unified_priv.h"
 
 #include <linux/debugfs.h>
@@ -1437,6 +1438,66 @@ QDF_STATUS wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf,
 	return QDF_STATUS_SUCCESS;
 }
 
+/**
+ * wmi_unified_cmd_batch_pipe() - find the HIF pipe WMI commands go out on
+ * @wmi_handle: handle to wmi
+ * @hif: filled with the HIF context
+ * @pipe: filled with the upload pipe
+ *
+ * Return: true if the pipe was found
+ */
+static bool wmi_unified_cmd_batch_pipe(wmi_unified_t wmi_handle,
+				       struct hif_opaque_softc **hif,
+				       uint8_t *pipe)
+{
+	uint8_t dl_pipe;
+	int ul_polled, dl_polled;
+
+	*hif = htc_get_hif_device(wmi_handle->htc_handle);
+	if (!*hif)
+		return false;
+
+	return !hif_map_service_to_pipe(*hif, WMI_CONTROL_SVC, pipe,
+					&dl_pipe, &ul_polled, &dl_polled);
+}
+
+/**
+ * wmi_unified_cmd_batch_begin() - start a burst of WMI commands
+ * @wmi_handle: handle to wmi
+ *
+ * Commands sent with wmi_unified_cmd_send() until the matching
+ * wmi_unified_cmd_batch_end() still go through HTC one by one and in
+ * order, but the copy engine doorbell is written once for the burst
+ * rather than once per command. The copy engine still rings it early
+ * when too many descriptors, or too old ones, are held back, so a long
+ * burst does not delay the first commands much. Batches may nest.
+ *
+ * Return: none
+ */
+void wmi_unified_cmd_batch_begin(wmi_unified_t wmi_handle)
+{
+	struct hif_opaque_softc *hif;
+	uint8_t pipe;
+
+	if (wmi_unified_cmd_batch_pipe(wmi_handle, &hif, &pipe))
+		hif_send_batch_begin(hif, pipe);
+}
+
+/**
+ * wmi_unified_cmd_batch_end() - end a burst of WMI commands
+ * @wmi_handle: handle to wmi
+ *
+ * Return: none
+ */
+void wmi_unified_cmd_batch_end(wmi_unified_t wmi_handle)
+{
+	struct hif_opaque_softc *hif;
+	uint8_t pipe;
+
+	if (wmi_unified_cmd_batch_pipe(wmi_handle, &hif, &pipe))
+		hif_send_batch_end(hif, pipe);
+}
+
 /**
  * wmi_unified_get_event_handler_ix() - gives event handler's index
  * @wmi_handle: handle to wmi
@@ -524,6 +524,37 @@ QDF_STATUS wmi_unified_sta_ps_cmd_send(void *wmi_hdl,
 	return QDF_STATUS_E_FAILURE;
 }
 
+/**
+ * wmi_unified_sta_ps_params_send() - set several sta powersave parameters
+ * @wmi_hdl: wmi handle
+ * @params: sta_ps parameters, sent in this order
+ * @num: number of entries in @params
+ *
+ * Sends the parameters as one command batch, stopping at the first
+ * one that fails.
+ *
+ * Return: QDF_STATUS_SUCCESS on success and QDF_STATUS_E_FAILURE for failure
+ */
+QDF_STATUS wmi_unified_sta_ps_params_send(void *wmi_hdl,
+					  struct sta_ps_params *params,
+					  uint32_t num)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) wmi_hdl;
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
+	uint32_t i;
+
+	if (!wmi_handle->ops->send_set_sta_ps_param_cmd)
+		return QDF_STATUS_E_FAILURE;
+
+	wmi_unified_cmd_batch_begin(wmi_handle);
+	for (i = 0; i < num && QDF_IS_STATUS_SUCCESS(status); i++)
+		status = wmi_handle->ops->send_set_sta_ps_param_cmd(wmi_handle,
+				  &params[i]);
+	wmi_unified_cmd_batch_end(wmi_handle);
+
+	return status;
+}
+
 /**
  * wmi_crash_inject() - inject fw crash
  * @wma_handle: wma handle
@@ -4658,13 +4658,17 @@ QDF_STATUS send_set_passpoint_network_list_cmd_tlv(wmi_unified_t wmi_handle,
 	wmi_buf_t buf;
 	uint32_t len;
 	int ret;
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
 
 	len = sizeof(*cmd);
+	/* one command per network, share the doorbell */
+	wmi_unified_cmd_batch_begin(wmi_handle);
 	for (i = 0; i < req->num_networks; i++) {
 		buf = wmi_buf_alloc(wmi_handle, len);
 		if (!buf) {
 			WMI_LOGE("%s: Failed allocate wmi buffer", __func__);
-			return QDF_STATUS_E_NOMEM;
+			status = QDF_STATUS_E_NOMEM;
+			break;
 		}
 
 		cmd = (wmi_passpoint_config_cmd_fixed_param *)
@@ -4700,11 +4704,13 @@ QDF_STATUS send_set_passpoint_network_list_cmd_tlv(wmi_unified_t wmi_handle,
 			WMI_LOGE("%s: Failed to send set passpoint network list wmi cmd",
 				 __func__);
 			wmi_buf_free(buf);
-			return QDF_STATUS_E_FAILURE;
+			status = QDF_STATUS_E_FAILURE;
+			break;
 		}
 	}
+	wmi_unified_cmd_batch_end(wmi_handle);
 
-	return QDF_STATUS_SUCCESS;
+	return status;
 }
 
 #if defined(WLAN_FEATURE_FILS_SK) && defined(WLAN_FEATURE_ROAM_OFFLOAD)
@@ -12634,6 +12640,7 @@ QDF_STATUS send_get_buf_extscan_hotlist_cmd_tlv(wmi_unified_t wmi_handle,
 	int min_entries = 0;
 	uint32_t numap = photlist->numAp;
 	int len = sizeof(*cmd);
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
 
 	len += WMI_TLV_HDR_SIZE;
 	cmd_len = len;
@@ -12652,13 +12659,15 @@ QDF_STATUS send_get_buf_extscan_hotlist_cmd_tlv(wmi_unified_t wmi_handle,
 	/* Split the hot list entry pages and send multiple command
 	 * requests if the buffer reaches the maximum request size
 	 */
+	wmi_unified_cmd_batch_begin(wmi_handle);
 	while (index < numap) {
 		min_entries = QDF_MIN(num_entries, numap);
 		len += min_entries * sizeof(wmi_extscan_hotlist_entry);
 		buf = wmi_buf_alloc(wmi_handle, len);
 		if (!buf) {
 			WMI_LOGP("%s: wmi_buf_alloc failed", __func__);
-			return QDF_STATUS_E_FAILURE;
+			status = QDF_STATUS_E_FAILURE;
+			break;
 		}
 		buf_ptr = (uint8_t *) wmi_buf_data(buf);
 		cmd = (wmi_extscan_configure_hotlist_monitor_cmd_fixed_param *)
@@ -12721,13 +12730,16 @@ QDF_STATUS send_get_buf_extscan_hotlist_cmd_tlv(wmi_unified_t wmi_handle,
 					 WMI_EXTSCAN_CONFIGURE_HOTLIST_MONITOR_CMDID)) {
 			WMI_LOGE("%s: failed to send command", __func__);
 			wmi_buf_free(buf);
-			return QDF_STATUS_E_FAILURE;
+			status = QDF_STATUS_E_FAILURE;
+			break;
 		}
 		index = index + min_entries;
 		num_entries = numap - min_entries;
 		len = cmd_len;
 	}
-	return QDF_STATUS_SUCCESS;
+	wmi_unified_cmd_batch_end(wmi_handle);
+
+	return status;
 }
 
 /**
@@ -429,6 +429,7 @@ ol_rx_reorder_flush_frag(htt_pdev_handle htt_pdev,
 		ol_rx_frames_free(htt_pdev, rx_reorder_array_elem->head);
 		rx_reorder_array_elem->head = NULL;
 		rx_reorder_array_elem->tail = NULL;
+		ol_rx_reorder_occupied_update(&peer->tids_rx_reorder[tid], seq);
 	}
 }
 
@@ -531,6 +532,7 @@ ol_rx_reorder_store_frag(ol_txrx_pdev_handle pdev,
 			now_ms + pdev->rx.defrag.timeout_ms;
 		ol_rx_defrag_waitlist_add(peer, tid);
 	}
+	ol_rx_reorder_occupied_update(&peer->tids_rx_reorder[tid], seq);
 }
 
 /*
@@ -22,6 +22,7 @@
 #include <qdf_mem.h>         /* qdf_mem_malloc */
 
 #include <linux/ieee80211.h>          /* IEEE80211_SEQ_MAX */
+#include <linux/bitops.h>             /* find_next_bit */
 
 /* external interfaces */
 #include <ol_txrx_api.h>        /* ol_txrx_pdev_handle */
@@ -69,6 +70,35 @@
 		}							\
 	} while (0)
 
+/**
+ * ol_rx_reorder_next_occupied() - find the next slot holding frames
+ * @rx_reorder: rx reorder state of the peer-TID
+ * @idx: first slot to look at, already masked
+ * @idx_end: slot to stop at (exclusive), already masked
+ *
+ * Looks through the slots from @idx up to @idx_end, wrapping around the
+ * end of the window, using the occupied bitmap rather than the array.
+ *
+ * Return: index of the first occupied slot, or @idx_end if there is none
+ */
+static unsigned int
+ol_rx_reorder_next_occupied(struct ol_rx_reorder_t *rx_reorder,
+			    unsigned int idx, unsigned int idx_end)
+{
+	unsigned int win_sz = rx_reorder->win_sz_mask + 1;
+	unsigned int found;
+
+	if (idx == idx_end)
+		return idx_end;
+	if (idx < idx_end)
+		return find_next_bit(rx_reorder->occupied, idx_end, idx);
+
+	found = find_next_bit(rx_reorder->occupied, win_sz, idx);
+	if (found < win_sz)
+		return found;
+	return find_next_bit(rx_reorder->occupied, idx_end, 0);
+}
+
 /* functions called by txrx components */
 
 void ol_rx_reorder_init(struct ol_rx_reorder_t *rx_reorder, uint8_t tid)
@@ -77,6 +107,7 @@ void ol_rx_reorder_init(struct ol_rx_reorder_t *rx_reorder, uint8_t tid)
 	rx_reorder->win_sz_mask = 0;
 	rx_reorder->array = &rx_reorder->base;
 	rx_reorder->base.head = rx_reorder->base.tail = NULL;
+	bitmap_zero(rx_reorder->occupied, OL_RX_REORDER_WIN_SZ_MAX);
 	rx_reorder->tid = tid;
 	rx_reorder->defrag_timeout_ms = 0;
 
@@ -215,6 +246,7 @@ ol_rx_reorder_store(struct ol_txrx_pdev_t *pdev,
 		qdf_nbuf_set_next(rx_reorder_array_elem->tail, head_msdu);
 	} else {
 		rx_reorder_array_elem->head = head_msdu;
+		__set_bit(idx, peer->tids_rx_reorder[tid].occupied);
 		OL_RX_REORDER_MPDU_CNT_INCR(&peer->tids_rx_reorder[tid], 1);
 	}
 	rx_reorder_array_elem->tail = tail_msdu;
@@ -228,6 +260,7 @@ ol_rx_reorder_release(struct ol_txrx_vdev_t *vdev,
 {
 	unsigned int idx;
 	unsigned int win_sz, win_sz_mask;
+	struct ol_rx_reorder_t *rx_reorder = &peer->tids_rx_reorder[tid];
 	struct ol_rx_reorder_array_elem_t *rx_reorder_array_elem;
 	qdf_nbuf_t head_msdu;
 	qdf_nbuf_t tail_msdu;
@@ -245,24 +278,30 @@ ol_rx_reorder_release(struct ol_txrx_vdev_t *vdev,
 	head_msdu = rx_reorder_array_elem->head;
 	tail_msdu = rx_reorder_array_elem->tail;
 	rx_reorder_array_elem->head = rx_reorder_array_elem->tail = NULL;
+	__clear_bit(idx_start, rx_reorder->occupied);
 	if (head_msdu)
-		OL_RX_REORDER_MPDU_CNT_DECR(&peer->tids_rx_reorder[tid], 1);
+		OL_RX_REORDER_MPDU_CNT_DECR(rx_reorder, 1);
 
+	/* chain the occupied slots up to idx_end, skipping the empty ones */
 	idx = (idx_start + 1);
 	OL_RX_REORDER_IDX_WRAP(idx, win_sz, win_sz_mask);
+	idx = ol_rx_reorder_next_occupied(rx_reorder, idx, idx_end);
 	while (idx != idx_end) {
-		rx_reorder_array_elem = &peer->tids_rx_reorder[tid].array[idx];
-		if (rx_reorder_array_elem->head) {
-			OL_RX_REORDER_MPDU_CNT_DECR(&peer->tids_rx_reorder[tid],
-						    1);
+		rx_reorder_array_elem = &rx_reorder->array[idx];
+		OL_RX_REORDER_MPDU_CNT_DECR(rx_reorder, 1);
+		if (head_msdu) {
 			OL_RX_REORDER_LIST_APPEND(head_msdu, tail_msdu,
 						  rx_reorder_array_elem);
-			tail_msdu = rx_reorder_array_elem->tail;
+		} else {
+			head_msdu = rx_reorder_array_elem->head;
 		}
+		tail_msdu = rx_reorder_array_elem->tail;
 		rx_reorder_array_elem->head = rx_reorder_array_elem->tail =
 						      NULL;
+		__clear_bit(idx, rx_reorder->occupied);
 		idx++;
 		OL_RX_REORDER_IDX_WRAP(idx, win_sz, win_sz_mask);
+		idx = ol_rx_reorder_next_occupied(rx_reorder, idx, idx_end);
 	}
 	if (head_msdu) {
 		uint16_t seq_num;
@@ -308,6 +347,7 @@ ol_rx_reorder_flush(struct ol_txrx_vdev_t *vdev,
 	struct ol_txrx_pdev_t *pdev;
 	unsigned int win_sz;
 	uint8_t win_sz_mask;
+	struct ol_rx_reorder_t *rx_reorder = &peer->tids_rx_reorder[tid];
 	struct ol_rx_reorder_array_elem_t *rx_reorder_array_elem;
 	qdf_nbuf_t head_msdu = NULL;
 	qdf_nbuf_t tail_msdu = NULL;
@@ -337,15 +377,20 @@ ol_rx_reorder_flush(struct ol_txrx_vdev_t *vdev,
 	idx_start &= win_sz_mask;
 	idx_end &= win_sz_mask;
 
+	/*
+	 * Visit idx_start, then the occupied slots after it up to idx_end,
+	 * all of the window if they are equal.
+	 */
 	do {
-		rx_reorder_array_elem =
-			&peer->tids_rx_reorder[tid].array[idx_start];
+		rx_reorder_array_elem = &rx_reorder->array[idx_start];
+		__clear_bit(idx_start, rx_reorder->occupied);
 		idx_start = (idx_start + 1);
 		OL_RX_REORDER_IDX_WRAP(idx_start, win_sz, win_sz_mask);
+		idx_start = ol_rx_reorder_next_occupied(rx_reorder, idx_start,
+							idx_end);
 
 		if (rx_reorder_array_elem->head) {
-			OL_RX_REORDER_MPDU_CNT_DECR(&peer->tids_rx_reorder[tid],
-						    1);
+			OL_RX_REORDER_MPDU_CNT_DECR(rx_reorder, 1);
 			if (head_msdu == NULL) {
 				head_msdu = rx_reorder_array_elem->head;
 				tail_msdu = rx_reorder_array_elem->tail;
@@ -403,22 +448,19 @@ ol_rx_reorder_first_hole(struct ol_txrx_peer_t *peer,
 {
 	unsigned int win_sz, win_sz_mask;
 	unsigned int idx_start = 0, tmp_idx = 0;
+	struct ol_rx_reorder_t *rx_reorder = &peer->tids_rx_reorder[tid];
 
-	win_sz = peer->tids_rx_reorder[tid].win_sz;
-	win_sz_mask = peer->tids_rx_reorder[tid].win_sz_mask;
+	win_sz = rx_reorder->win_sz;
+	win_sz_mask = rx_reorder->win_sz_mask;
 
 	OL_RX_REORDER_IDX_START_SELF_SELECT(peer, tid, &idx_start);
 	tmp_idx++;
 	OL_RX_REORDER_IDX_WRAP(tmp_idx, win_sz, win_sz_mask);
 	/* bypass the initial hole */
-	while (tmp_idx != idx_start &&
-	       !peer->tids_rx_reorder[tid].array[tmp_idx].head) {
-		tmp_idx++;
-		OL_RX_REORDER_IDX_WRAP(tmp_idx, win_sz, win_sz_mask);
-	}
+	tmp_idx = ol_rx_reorder_next_occupied(rx_reorder, tmp_idx, idx_start);
 	/* bypass the present frames following the initial hole */
 	while (tmp_idx != idx_start &&
-	       peer->tids_rx_reorder[tid].array[tmp_idx].head) {
+	       test_bit(tmp_idx, rx_reorder->occupied)) {
 		tmp_idx++;
 		OL_RX_REORDER_IDX_WRAP(tmp_idx, win_sz, win_sz_mask);
 	}
@@ -573,6 +615,7 @@ ol_rx_pn_ind_handler(ol_txrx_pdev_handle pdev,
 	struct ol_txrx_vdev_t *vdev = NULL;
 	void *rx_desc;
 	struct ol_txrx_peer_t *peer;
+	struct ol_rx_reorder_t *rx_reorder;
 	struct ol_rx_reorder_array_elem_t *rx_reorder_array_elem;
 	unsigned int win_sz_mask;
 	qdf_nbuf_t head_msdu = NULL;
@@ -604,7 +647,8 @@ ol_rx_pn_ind_handler(ol_txrx_pdev_handle pdev,
 
 	qdf_atomic_set(&peer->fw_pn_check, 1);
 	/*TODO: Fragmentation case */
-	win_sz_mask = peer->tids_rx_reorder[tid].win_sz_mask;
+	rx_reorder = &peer->tids_rx_reorder[tid];
+	win_sz_mask = rx_reorder->win_sz_mask;
 	seq_num_start &= win_sz_mask;
 	seq_num_end &= win_sz_mask;
 	seq_num = seq_num_start;
@@ -709,8 +753,12 @@ ol_rx_pn_ind_handler(ol_txrx_pdev_handle pdev,
 			}
 			rx_reorder_array_elem->head = NULL;
 			rx_reorder_array_elem->tail = NULL;
+			__clear_bit(seq_num, rx_reorder->occupied);
 		}
-		seq_num = (seq_num + 1) & win_sz_mask;
+		seq_num = ol_rx_reorder_next_occupied(rx_reorder,
+						      (seq_num + 1) &
+						      win_sz_mask,
+						      seq_num_end);
 	} while (seq_num != seq_num_end);
 
 	if (head_msdu) {
@@ -64,6 +64,25 @@ ol_rx_reorder_peer_cleanup(struct ol_txrx_vdev_t *vdev,
 
 void ol_rx_reorder_init(struct ol_rx_reorder_t *rx_reorder, uint8_t tid);
 
+/**
+ * ol_rx_reorder_occupied_update() - sync a slot's bit with the slot
+ * @rx_reorder: rx reorder state of the peer-TID
+ * @idx: slot index, already masked
+ *
+ * For code outside ol_rx_reorder.c which sets or clears array[idx].head.
+ *
+ * Return: None
+ */
+static inline void
+ol_rx_reorder_occupied_update(struct ol_rx_reorder_t *rx_reorder,
+			      unsigned int idx)
+{
+	if (rx_reorder->array[idx].head)
+		__set_bit(idx, rx_reorder->occupied);
+	else
+		__clear_bit(idx, rx_reorder->occupied);
+}
+
 enum htt_rx_status
 ol_rx_seq_num_check(struct ol_txrx_pdev_t *pdev,
 			    struct ol_txrx_peer_t *peer,
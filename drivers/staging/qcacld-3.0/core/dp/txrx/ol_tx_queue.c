@@ -953,17 +953,24 @@ ol_txrx_peer_link_status_handler(
 		return;
 	}
 
-	/* Check if bad peer tx flow CL is enabled */
-	if (pdev->tx_peer_bal.enabled != ol_tx_peer_bal_enable) {
+	/* Check peer_num is reasonable */
+	if (peer_num > MAX_NO_PEERS_IN_LIMIT) {
 		TX_SCHED_DEBUG_PRINT_ALWAYS(
-			"Bad peer tx flow CL is not enabled, ignore it\n");
+			"%s: Bad peer_num %d\n", __func__, peer_num);
 		return;
 	}
 
-	/* Check peer_num is reasonable */
-	if (peer_num > MAX_NO_PEERS_IN_LIMIT) {
+	/* the tx scheduler's airtime accounting uses the rates either way */
+	for (i = 0; i < peer_num; i++) {
+		peer = ol_txrx_peer_find_by_id(pdev, peer_link_status[i].id);
+		if (peer)
+			peer->tx_airtime.rate = peer_link_status[i].rate;
+	}
+
+	/* Check if bad peer tx flow CL is enabled */
+	if (pdev->tx_peer_bal.enabled != ol_tx_peer_bal_enable) {
 		TX_SCHED_DEBUG_PRINT_ALWAYS(
-			"%s: Bad peer_num %d\n", __func__, peer_num);
+			"Bad peer tx flow CL is not enabled, ignore it\n");
 		return;
 	}
 
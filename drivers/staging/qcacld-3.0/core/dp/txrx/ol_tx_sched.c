@@ -30,6 +30,7 @@
 #include <ol_txrx.h>
 #include <qdf_types.h>
 #include <qdf_mem.h>         /* qdf_os_mem_alloc_consistent et al */
+#include <qdf_module.h>      /* qdf_declare_param */
 
 #if defined(CONFIG_HL_SUPPORT)
 
@@ -548,6 +549,25 @@ OL_TX_SCHED_WRR_ADV_CAT_CFG_SPEC(MCAST_DATA,  10,     16,     4,     1,  4);
 OL_TX_SCHED_WRR_ADV_CAT_CFG_SPEC(MCAST_MGMT,   1,      1,     4,     0,  1);
 #endif
 
+#ifdef QCA_BAD_PEER_TX_FLOW_CL
+/*
+ * Airtime fairness:
+ * With frame based turns, a peer at a low PHY rate gets the same number
+ * of frames per turn as a fast one, and so takes most of the airtime.
+ * When ol_tx_sched_airtime is set, the peer tx queues within a category
+ * are served deficit round robin instead: each peer gets an airtime
+ * quantum per round, and is charged the airtime of the frames it
+ * downloads, estimated from the tx rate the target last reported for it.
+ * A peer that has used up its quantum waits for the next round.
+ */
+#define OL_TX_SCHED_AIRTIME_QUANTUM_US 4000
+/* rate (Mbps) assumed until the target reports one for the peer */
+#define OL_TX_SCHED_AIRTIME_DEF_RATE   54
+
+static int ol_tx_sched_airtime;
+qdf_declare_param(ol_tx_sched_airtime, int);
+#endif
+
 #ifdef DEBUG_HL_LOGGING
 
 #define OL_TX_SCHED_WRR_ADV_CAT_STAT_INIT(category, scheduler)               \
@@ -731,6 +751,133 @@ ol_tx_sched_wrr_adv_credit_sanity_check(struct ol_txrx_pdev_t *pdev,
 	qdf_assert(okay);
 }
 
+#ifdef QCA_BAD_PEER_TX_FLOW_CL
+/**
+ * ol_tx_sched_airtime_defer() - check whether a peer tx queue must wait
+ * @txq: tx queue at the head of its category
+ *
+ * Return: true if the queue's peer has no airtime left in this round,
+ *	in which case it is given the quantum for the next round
+ */
+static inline bool
+ol_tx_sched_airtime_defer(struct ol_tx_frms_queue_t *txq)
+{
+	struct ol_txrx_peer_t *peer = txq->peer;
+
+	if (!ol_tx_sched_airtime || !peer ||
+	    peer->tx_airtime.deficit > 0)
+		return false;
+
+	peer->tx_airtime.deficit += OL_TX_SCHED_AIRTIME_QUANTUM_US;
+	peer->tx_airtime.rounds++;
+	return true;
+}
+
+/**
+ * ol_tx_sched_airtime_charge() - account the airtime of a download
+ * @txq: tx queue the frames were taken from
+ * @frames: number of frames downloaded
+ * @bytes: number of bytes downloaded
+ *
+ * Return: none
+ */
+static inline void
+ol_tx_sched_airtime_charge(struct ol_tx_frms_queue_t *txq,
+			   int frames, int bytes)
+{
+	struct ol_txrx_peer_t *peer = txq->peer;
+	u_int32_t rate, usec;
+
+	if (!peer || !frames)
+		return;
+
+	rate = peer->tx_airtime.rate ?
+		peer->tx_airtime.rate : OL_TX_SCHED_AIRTIME_DEF_RATE;
+	usec = (u_int32_t)bytes * 8 / rate;
+	peer->tx_airtime.usec += usec;
+	peer->tx_airtime.frms += frames;
+	if (!ol_tx_sched_airtime)
+		return;
+
+	peer->tx_airtime.deficit -= usec;
+	/* a peer going idle must not bank airtime for later */
+	if (!txq->frms &&
+	    peer->tx_airtime.deficit > OL_TX_SCHED_AIRTIME_QUANTUM_US)
+		peer->tx_airtime.deficit = OL_TX_SCHED_AIRTIME_QUANTUM_US;
+}
+
+/**
+ * ol_tx_sched_airtime_display() - print the per-peer airtime stats
+ * @pdev: Pointer to the PDEV structure.
+ *
+ * Return: none.
+ */
+static void ol_tx_sched_airtime_display(struct ol_txrx_pdev_t *pdev)
+{
+	struct ol_txrx_vdev_t *vdev;
+	struct ol_txrx_peer_t *peer;
+
+	QDF_TRACE(QDF_MODULE_ID_TXRX, QDF_TRACE_LEVEL_ERROR,
+		  "Airtime fairness %s, quantum %d usec",
+		  ol_tx_sched_airtime ? "on" : "off",
+		  OL_TX_SCHED_AIRTIME_QUANTUM_US);
+	qdf_spin_lock_bh(&pdev->peer_ref_mutex);
+	TAILQ_FOREACH(vdev, &pdev->vdev_list, vdev_list_elem) {
+		TAILQ_FOREACH(peer, &vdev->peer_list, peer_list_elem) {
+			QDF_TRACE(QDF_MODULE_ID_TXRX, QDF_TRACE_LEVEL_ERROR,
+				  "peer %pM rate %u Mbps airtime %llu usec frms %u deficit %d rounds %u",
+				  peer->mac_addr.raw, peer->tx_airtime.rate,
+				  peer->tx_airtime.usec, peer->tx_airtime.frms,
+				  peer->tx_airtime.deficit,
+				  peer->tx_airtime.rounds);
+		}
+	}
+	qdf_spin_unlock_bh(&pdev->peer_ref_mutex);
+}
+
+/**
+ * ol_tx_sched_airtime_clear() - reset the per-peer airtime stats
+ * @pdev: Pointer to the PDEV structure.
+ *
+ * Return: none.
+ */
+static void ol_tx_sched_airtime_clear(struct ol_txrx_pdev_t *pdev)
+{
+	struct ol_txrx_vdev_t *vdev;
+	struct ol_txrx_peer_t *peer;
+
+	qdf_spin_lock_bh(&pdev->peer_ref_mutex);
+	TAILQ_FOREACH(vdev, &pdev->vdev_list, vdev_list_elem) {
+		TAILQ_FOREACH(peer, &vdev->peer_list, peer_list_elem) {
+			peer->tx_airtime.usec = 0;
+			peer->tx_airtime.frms = 0;
+			peer->tx_airtime.rounds = 0;
+		}
+	}
+	qdf_spin_unlock_bh(&pdev->peer_ref_mutex);
+}
+#else
+static inline bool
+ol_tx_sched_airtime_defer(struct ol_tx_frms_queue_t *txq)
+{
+	return false;
+}
+
+static inline void
+ol_tx_sched_airtime_charge(struct ol_tx_frms_queue_t *txq,
+			   int frames, int bytes)
+{
+}
+
+static inline void ol_tx_sched_airtime_display(struct ol_txrx_pdev_t *pdev)
+{
+}
+
+static inline void ol_tx_sched_airtime_clear(struct ol_txrx_pdev_t *pdev)
+{
+}
+#endif /* QCA_BAD_PEER_TX_FLOW_CL */
+
 /*
  * The scheduler sync spinlock has been acquired outside this function,
  * so there is no need to worry about mutex within this function.
@@ -819,6 +966,17 @@ ol_tx_sched_select_batch_wrr_adv(
 	 */
 	txq = TAILQ_FIRST(&category->state.head);
 
+	/*
+	 * In airtime mode, peers that have used up their airtime go to the
+	 * back of the category with a fresh quantum. Every pass tops up
+	 * some peer, so an eligible queue is found.
+	 */
+	while (txq && ol_tx_sched_airtime_defer(txq)) {
+		TAILQ_REMOVE(&category->state.head, txq, list_elem);
+		TAILQ_INSERT_TAIL(&category->state.head, txq, list_elem);
+		txq = TAILQ_FIRST(&category->state.head);
+	}
+
 	if (txq) {
 		TAILQ_REMOVE(&category->state.head, txq, list_elem);
 		credit = ol_tx_txq_group_credit_limit(pdev, txq, credit);
@@ -839,6 +997,7 @@ ol_tx_sched_select_batch_wrr_adv(
 			ol_tx_bad_peer_update_tx_limit(pdev, txq,
 						       frames,
 						       tx_limit_flag);
+			ol_tx_sched_airtime_charge(txq, frames, bytes);
 
 			OL_TX_SCHED_WRR_ADV_CAT_STAT_INC_DISPATCHED(category,
 								    frames);
@@ -1188,6 +1347,7 @@ ol_txrx_set_wmm_param(ol_txrx_pdev_handle data_pdev,
 void ol_tx_sched_stats_display(struct ol_txrx_pdev_t *pdev)
 {
 	OL_TX_SCHED_WRR_ADV_CAT_STAT_DUMP(pdev->tx_sched.scheduler);
+	ol_tx_sched_airtime_display(pdev);
 }
 
 /**
@@ -1210,6 +1370,7 @@ void ol_tx_sched_cur_state_display(struct ol_txrx_pdev_t *pdev)
 void ol_tx_sched_stats_clear(struct ol_txrx_pdev_t *pdev)
 {
 	OL_TX_SCHED_WRR_ADV_CAT_STAT_CLEAR(pdev->tx_sched.scheduler);
+	ol_tx_sched_airtime_clear(pdev);
 }
 
 #endif /* OL_TX_SCHED == OL_TX_SCHED_WRR_ADV */
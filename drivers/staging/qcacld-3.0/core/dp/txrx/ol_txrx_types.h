@@ -1217,11 +1217,16 @@ struct ol_rx_reorder_array_elem_t {
 	qdf_nbuf_t tail;
 };
 
+/* win_sz_mask is 8 bits, so the window is at most 256 slots */
+#define OL_RX_REORDER_WIN_SZ_MAX 256
+
 struct ol_rx_reorder_t {
 	uint8_t win_sz;
 	uint8_t win_sz_mask;
 	uint8_t num_mpdus;
 	struct ol_rx_reorder_array_elem_t *array;
+	/* bit n set: array[n] holds frames */
+	unsigned long occupied[BITS_TO_LONGS(OL_RX_REORDER_WIN_SZ_MAX)];
 	/* base - single rx reorder element used for non-aggr cases */
 	struct ol_rx_reorder_array_elem_t base;
 #if defined(QCA_SUPPORT_OL_RX_REORDER_TIMEOUT)
@@ -1383,6 +1388,19 @@ struct ol_txrx_peer_t {
 	u_int16_t tx_limit;
 	u_int16_t tx_limit_flag;
 	u_int16_t tx_pause_flag;
+	/*
+	 * tx_airtime -
+	 * airtime accounting for the tx scheduler: the last rate (Mbps)
+	 * the target reported for this peer, the DRR deficit (usec) and
+	 * the airtime charged for the frames downloaded so far
+	 */
+	struct {
+		u_int32_t rate;
+		int32_t deficit;
+		u_int64_t usec;
+		u_int32_t frms;
+		u_int32_t rounds;
+	} tx_airtime;
 #endif
 	qdf_time_t last_assoc_rcvd;
 	qdf_time_t last_disassoc_deauth_rcvd;
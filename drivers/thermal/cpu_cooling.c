@@ -30,6 +30,7 @@
 #include <linux/slab.h>
 #include <linux/cpu.h>
 #include <linux/cpu_cooling.h>
+#include <linux/sched_energy.h>
 
 #include <trace/events/thermal.h>
 
@@ -83,6 +84,8 @@ struct power_table {
  * @dyn_power_table_entries: number of entries in the @dyn_power_table array
  * @cpu_dev: the first cpu_device from @allowed_cpus that has OPPs registered
  * @plat_get_static_power: callback to calculate the static power
+ * @energy_model: @dyn_power_table comes from the scheduler's energy model,
+ *	and the requested power follows the cpus' performance request
  *
  * This structure is required for keeping information of each registered
  * cpufreq_cooling_device.
@@ -104,6 +107,7 @@ struct cpufreq_cooling_device {
 	struct device *cpu_dev;
 	get_static_t plat_get_static_power;
 	struct cpu_cooling_ops *plat_ops;
+	bool energy_model;
 };
 static DEFINE_IDR(cpufreq_idr);
 static DEFINE_MUTEX(cooling_cpufreq_lock);
@@ -350,6 +354,74 @@ free_power_table:
 	return ret;
 }
 
+static unsigned long em_power_at(const struct sched_group_energy *sge,
+				 unsigned long cap)
+{
+	int i;
+
+	for (i = 0; i < sge->nr_cap_states - 1; i++)
+		if (sge->cap_states[i].cap >= cap)
+			break;
+
+	return sge->cap_states[i].power;
+}
+
+/**
+ * build_energy_power_table() - create a power table from the energy model
+ * @cpufreq_device:	&struct cpufreq_cooling_device with its freq_table
+ *			already filled in
+ *
+ * Instead of estimating the power from a capacitance and the OPP voltages,
+ * use the per-core and per-cluster busy costs that the scheduler's energy
+ * model reads from "sched-energy-costs" in DT, so thermal and EAS agree
+ * on what each frequency costs. Frequencies are mapped to capacities
+ * linearly, the way the scheduler does, and the cluster cost is shared
+ * evenly between its cpus. The costs are taken to be in mW.
+ *
+ * Return: 0 on success, -ENODEV if there is no energy model for these cpus,
+ * -ENOMEM if we run out of memory.
+ */
+static int build_energy_power_table(struct cpufreq_cooling_device *cpufreq_device)
+{
+	const struct sched_group_energy *core, *cluster;
+	struct power_table *power_table;
+	unsigned int num_freqs = cpufreq_device->max_level + 1;
+	unsigned int ncpus = cpumask_weight(&cpufreq_device->allowed_cpus);
+	unsigned int max_freq = cpufreq_device->freq_table[0];
+	unsigned long max_cap, cap, power;
+	int cpu, i;
+
+	cpu = cpumask_first(&cpufreq_device->allowed_cpus);
+	core = sge_array[cpu][SD_LEVEL0];
+	cluster = sge_array[cpu][SD_LEVEL1];
+	if (!core || !core->nr_cap_states || !max_freq)
+		return -ENODEV;
+
+	power_table = kcalloc(num_freqs, sizeof(*power_table), GFP_KERNEL);
+	if (!power_table)
+		return -ENOMEM;
+
+	max_cap = core->cap_states[core->nr_cap_states - 1].cap;
+
+	/* freq_table is in descending order, the power table ascending */
+	for (i = 0; i < num_freqs; i++) {
+		unsigned int freq = cpufreq_device->freq_table[num_freqs - 1 - i];
+
+		cap = DIV_ROUND_UP((u64)freq * max_cap, max_freq);
+		power = em_power_at(core, cap);
+		if (cluster && cluster->nr_cap_states)
+			power += em_power_at(cluster, cap) / ncpus;
+
+		power_table[i].frequency = freq;
+		power_table[i].power = power;
+	}
+
+	cpufreq_device->dyn_power_table = power_table;
+	cpufreq_device->dyn_power_table_entries = num_freqs;
+
+	return 0;
+}
+
 static u32 cpu_freq_to_power(struct cpufreq_cooling_device *cpufreq_device,
 			     u32 freq)
 {
@@ -589,9 +661,9 @@ static int cpufreq_get_requested_power(struct thermal_cooling_device *cdev,
 				       struct thermal_zone_device *tz,
 				       u32 *power)
 {
-	unsigned long freq;
+	unsigned long freq, req_freq;
 	int i = 0, cpu, ret;
-	u32 static_power, dynamic_power, total_load = 0;
+	u32 static_power, dynamic_power, total_load = 0, max_load = 0;
 	struct cpufreq_cooling_device *cpufreq_device = cdev->devdata;
 	u32 *load_cpu = NULL;
 
@@ -623,6 +695,7 @@ static int cpufreq_get_requested_power(struct thermal_cooling_device *cdev,
 			load = 0;
 
 		total_load += load;
+		max_load = max(max_load, load);
 		if (load_cpu)
 			load_cpu[i] = load;
 
@@ -631,7 +704,18 @@ static int cpufreq_get_requested_power(struct thermal_cooling_device *cdev,
 
 	cpufreq_device->last_load = total_load;
 
-	dynamic_power = get_dynamic_power(cpufreq_device, freq);
+	/*
+	 * A clipped cluster only ever shows the power it is allowed, which
+	 * would keep its share of the budget from growing again. Ask for
+	 * what the busiest cpu would want instead, with the same 25%
+	 * headroom schedutil uses to pick a frequency.
+	 */
+	req_freq = freq;
+	if (cpufreq_device->energy_model)
+		req_freq = clamp_t(unsigned long, freq * max_load / 80, freq,
+				   cpufreq_device->freq_table[0]);
+
+	dynamic_power = get_dynamic_power(cpufreq_device, req_freq);
 	ret = get_static_power(cpufreq_device, tz, freq, &static_power);
 	if (ret) {
 		kfree(load_cpu);
@@ -807,7 +891,7 @@ static struct thermal_cooling_device *
 __cpufreq_cooling_register(struct device_node *np,
 			const struct cpumask *clip_cpus, u32 capacitance,
 			get_static_t plat_static_func,
-			struct cpu_cooling_ops *plat_ops)
+			struct cpu_cooling_ops *plat_ops, bool energy_model)
 {
 	struct thermal_cooling_device *cool_dev;
 	struct cpufreq_cooling_device *cpufreq_dev;
@@ -859,13 +943,15 @@ __cpufreq_cooling_register(struct device_node *np,
 
 	cpumask_copy(&cpufreq_dev->allowed_cpus, clip_cpus);
 
-	if (capacitance) {
+	if (capacitance || energy_model) {
 		cpufreq_cooling_ops.get_requested_power =
 			cpufreq_get_requested_power;
 		cpufreq_cooling_ops.state2power = cpufreq_state2power;
 		cpufreq_cooling_ops.power2state = cpufreq_power2state;
 		cpufreq_dev->plat_get_static_power = plat_static_func;
+	}
 
+	if (capacitance) {
 		ret = build_dyn_power_table(cpufreq_dev, capacitance);
 		if (ret) {
 			cool_dev = ERR_PTR(ret);
@@ -893,6 +979,15 @@ __cpufreq_cooling_register(struct device_node *np,
 			pr_debug("%s: freq:%u KHz\n", __func__, freq);
 	}
 
+	if (energy_model) {
+		ret = build_energy_power_table(cpufreq_dev);
+		if (ret) {
+			cool_dev = ERR_PTR(ret);
+			goto remove_idr;
+		}
+		cpufreq_dev->energy_model = true;
+	}
+
 	snprintf(dev_name, sizeof(dev_name), "thermal-cpufreq-%d",
 		 cpufreq_dev->id);
 
@@ -948,7 +1043,8 @@ free_cdev:
 struct thermal_cooling_device *
 cpufreq_cooling_register(const struct cpumask *clip_cpus)
 {
-	return __cpufreq_cooling_register(NULL, clip_cpus, 0, NULL, NULL);
+	return __cpufreq_cooling_register(NULL, clip_cpus, 0, NULL, NULL,
+					  false);
 }
 EXPORT_SYMBOL_GPL(cpufreq_cooling_register);
 
@@ -972,7 +1068,7 @@ of_cpufreq_cooling_register(struct device_node *np,
 	if (!np)
 		return ERR_PTR(-EINVAL);
 
-	return __cpufreq_cooling_register(np, clip_cpus, 0, NULL, NULL);
+	return __cpufreq_cooling_register(np, clip_cpus, 0, NULL, NULL, false);
 }
 EXPORT_SYMBOL_GPL(of_cpufreq_cooling_register);
 
@@ -1002,7 +1098,7 @@ cpufreq_power_cooling_register(const struct cpumask *clip_cpus, u32 capacitance,
 			       get_static_t plat_static_func)
 {
 	return __cpufreq_cooling_register(NULL, clip_cpus, capacitance,
-				plat_static_func, NULL);
+				plat_static_func, NULL, false);
 }
 EXPORT_SYMBOL(cpufreq_power_cooling_register);
 
@@ -1022,7 +1118,7 @@ cpufreq_platform_cooling_register(const struct cpumask *clip_cpus,
 				struct cpu_cooling_ops *plat_ops)
 {
 	return __cpufreq_cooling_register(NULL, clip_cpus, 0, NULL,
-						plat_ops);
+						plat_ops, false);
 }
 EXPORT_SYMBOL(cpufreq_platform_cooling_register);
 
@@ -1059,10 +1155,37 @@ of_cpufreq_power_cooling_register(struct device_node *np,
 		return ERR_PTR(-EINVAL);
 
 	return __cpufreq_cooling_register(np, clip_cpus, capacitance,
-				plat_static_func, NULL);
+				plat_static_func, NULL, false);
 }
 EXPORT_SYMBOL(of_cpufreq_power_cooling_register);
 
+/**
+ * of_cpufreq_energy_cooling_register() - create cpufreq cooling device with
+ * power extensions taken from the scheduler's energy model
+ * @np:	a valid struct device_node to the cooling device device tree node
+ * @clip_cpus:	cpumask of cpus where the frequency constraints will happen
+ *
+ * Like of_cpufreq_power_cooling_register(), but the power of each
+ * frequency comes from the "sched-energy-costs" of these cpus rather than
+ * from a capacitance and the OPP voltages, so the cpus need no OPPs. The
+ * requested power is based on the frequency the busiest cpu would ask for,
+ * so that the power allocator hands out its budget according to each
+ * cluster's performance request.
+ *
+ * Return: a valid struct thermal_cooling_device pointer on success,
+ * on failure, it returns a corresponding ERR_PTR().
+ */
+struct thermal_cooling_device *
+of_cpufreq_energy_cooling_register(struct device_node *np,
+				   const struct cpumask *clip_cpus)
+{
+	if (!np)
+		return ERR_PTR(-EINVAL);
+
+	return __cpufreq_cooling_register(np, clip_cpus, 0, NULL, NULL, true);
+}
+EXPORT_SYMBOL(of_cpufreq_energy_cooling_register);
+
 /**
  * cpufreq_cooling_unregister - function to remove cpufreq cooling device.
  * @cdev: thermal cooling device pointer.
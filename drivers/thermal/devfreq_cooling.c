@@ -289,8 +289,13 @@ static int devfreq_cooling_get_requested_power(struct thermal_cooling_device *cd
 
 	dyn_power = dfc->power_table[state];
 
-	/* Scale dynamic power for utilization */
-	dyn_power = (dyn_power * status->busy_time) / status->total_time;
+	/*
+	 * Scale dynamic power for utilization. Governors that don't fill in
+	 * last_status leave total_time at 0; count those as fully busy.
+	 */
+	if (status->total_time)
+		dyn_power = (dyn_power * status->busy_time) /
+			    status->total_time;
 
 	/* Get static power */
 	static_power = get_static_power(dfc, freq);
@@ -342,7 +347,8 @@ static int devfreq_cooling_power2state(struct thermal_cooling_device *cdev,
 
 	/* Scale dynamic power for utilization */
 	busy_time = status->busy_time ?: 1;
-	dyn_power = (dyn_power * status->total_time) / busy_time;
+	if (status->total_time)
+		dyn_power = (dyn_power * status->total_time) / busy_time;
 
 	/*
 	 * Find the first cooling state that is within the power
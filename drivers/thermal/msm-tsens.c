@@ -27,6 +27,8 @@
 #include <linux/of.h>
 #include <linux/debugfs.h>
 #include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 #include <asm/arch_timer.h>
 
 #define CREATE_TRACE_POINTS
@@ -181,6 +183,14 @@ static uint32_t tsens_sec_to_msec_value = 1000;
 static uint32_t tsens_completion_timeout_hz = HZ/2;
 static uint32_t tsens_poll_check = 1;
 
+/*
+ * Reads of any sensor within this many milliseconds of the last read of
+ * the controller are served from the values of that read. A miss reads
+ * every sensor of the controller in one pass. 0 reads on every request.
+ */
+static uint tsens_cache_ms;
+module_param(tsens_cache_ms, uint, S_IRUGO | S_IWUSR);
+
 /* Trips: warm and cool */
 enum tsens_trip_type {
 	TSENS_TRIP_WARM = 0,
@@ -230,6 +240,8 @@ struct tsens_tm_device_sensor {
 	int				dbg_adc_code;
 	u32				wa_temp1_calib_offset_factor;
 	u32				wa_temp2_calib_offset_factor;
+	int				cached_temp;
+	int				cached_rc;
 };
 
 struct tsens_dbg_counter {
@@ -297,6 +309,11 @@ struct tsens_tm_device {
 	u64				qtimer_val_last_detection_interrupt;
 	u64				qtimer_val_last_polling_check;
 	bool				tsens_critical_poll;
+	spinlock_t			tsens_cache_lock;
+	bool				cache_valid;
+	ktime_t				cache_ts;
+	unsigned long			cache_hit_cnt;
+	unsigned long			cache_refresh_cnt;
 	struct tsens_tm_device_sensor	sensor[0];
 };
 
@@ -731,7 +748,8 @@ static int tsens_tz_degc_to_code(int degc, int idx,
 	return code;
 }
 
-static int msm_tsens_get_temp(int sensor_client_id, int *temp)
+static int tsens_read_temp(struct tsens_tm_device *tmdev,
+		uint32_t sensor_hw_num, int sensor_client_id, int *temp)
 {
 	unsigned int code;
 	void __iomem *sensor_addr;
@@ -740,23 +758,6 @@ static int msm_tsens_get_temp(int sensor_client_id, int *temp)
 	int last_temp3 = 0, last_temp_mask, valid_status_mask, code_mask = 0;
 	bool last_temp_valid = false, last_temp2_valid = false;
 	bool last_temp3_valid = false;
-	struct tsens_tm_device *tmdev = NULL;
-	uint32_t sensor_hw_num = 0;
-
-	tmdev = get_tsens_controller_for_client_id(sensor_client_id);
-	if (tmdev == NULL) {
-		pr_err("TSENS early init not done\n");
-		return -EPROBE_DEFER;
-	}
-
-	pr_debug("sensor_client_id:%d\n", sensor_client_id);
-
-	sensor_hw_num = get_tsens_sensor_for_client_id(tmdev, sensor_client_id);
-	if (sensor_hw_num < 0) {
-		pr_err("cannot read the temperature\n");
-		return sensor_hw_num;
-	}
-	pr_debug("sensor_hw_num:%d\n", sensor_hw_num);
 
 	if (tmdev->tsens_type == TSENS_TYPE2) {
 		trdy_addr = TSENS2_TRDY_ADDR(tmdev->tsens_addr);
@@ -850,6 +851,91 @@ static int msm_tsens_get_temp(int sensor_client_id, int *temp)
 	return 0;
 }
 
+/* Makes the next read of any sensor of @tmdev go to the hardware. */
+static void tsens_cache_invalidate(struct tsens_tm_device *tmdev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&tmdev->tsens_cache_lock, flags);
+	tmdev->cache_valid = false;
+	spin_unlock_irqrestore(&tmdev->tsens_cache_lock, flags);
+}
+
+/*
+ * Returns the cached temperature of the sensor at index @idx, reading
+ * all the sensors of @tmdev first if the cache is older than
+ * tsens_cache_ms. The registers are read outside the lock, so two racing
+ * misses both read the hardware and the later one wins.
+ */
+static int tsens_get_temp_cached(struct tsens_tm_device *tmdev, int idx,
+		int *temp)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	int i, rc, t = 0;
+
+	spin_lock_irqsave(&tmdev->tsens_cache_lock, flags);
+	if (tmdev->cache_valid &&
+		ktime_ms_delta(now, tmdev->cache_ts) < tsens_cache_ms) {
+		*temp = tmdev->sensor[idx].cached_temp;
+		rc = tmdev->sensor[idx].cached_rc;
+		tmdev->cache_hit_cnt++;
+		spin_unlock_irqrestore(&tmdev->tsens_cache_lock, flags);
+		return rc;
+	}
+	spin_unlock_irqrestore(&tmdev->tsens_cache_lock, flags);
+
+	for (i = 0; i < tmdev->tsens_num_sensor; i++) {
+		rc = tsens_read_temp(tmdev, tmdev->sensor[i].sensor_hw_num,
+				tmdev->sensor[i].sensor_client_id, &t);
+		spin_lock_irqsave(&tmdev->tsens_cache_lock, flags);
+		tmdev->sensor[i].cached_temp = t;
+		tmdev->sensor[i].cached_rc = rc;
+		spin_unlock_irqrestore(&tmdev->tsens_cache_lock, flags);
+	}
+
+	spin_lock_irqsave(&tmdev->tsens_cache_lock, flags);
+	tmdev->cache_ts = now;
+	tmdev->cache_valid = true;
+	tmdev->cache_refresh_cnt++;
+	*temp = tmdev->sensor[idx].cached_temp;
+	rc = tmdev->sensor[idx].cached_rc;
+	spin_unlock_irqrestore(&tmdev->tsens_cache_lock, flags);
+
+	return rc;
+}
+
+static int msm_tsens_get_temp(int sensor_client_id, int *temp)
+{
+	struct tsens_tm_device *tmdev = NULL;
+	uint32_t sensor_hw_num = 0;
+	int i;
+
+	tmdev = get_tsens_controller_for_client_id(sensor_client_id);
+	if (tmdev == NULL) {
+		pr_err("TSENS early init not done\n");
+		return -EPROBE_DEFER;
+	}
+
+	pr_debug("sensor_client_id:%d\n", sensor_client_id);
+
+	sensor_hw_num = get_tsens_sensor_for_client_id(tmdev, sensor_client_id);
+	if (sensor_hw_num < 0) {
+		pr_err("cannot read the temperature\n");
+		return sensor_hw_num;
+	}
+	pr_debug("sensor_hw_num:%d\n", sensor_hw_num);
+
+	if (tsens_cache_ms) {
+		for (i = 0; i < tmdev->tsens_num_sensor; i++)
+			if (tmdev->sensor[i].sensor_client_id ==
+							sensor_client_id)
+				return tsens_get_temp_cached(tmdev, i, temp);
+	}
+
+	return tsens_read_temp(tmdev, sensor_hw_num, sensor_client_id, temp);
+}
+
 static int tsens_tz_get_temp(struct thermal_zone_device *thermal,
 			     int *temp)
 {
@@ -1819,6 +1905,8 @@ static irqreturn_t tsens_tm_critical_irq_thread(int irq, void *data)
 		}
 	}
 
+	tsens_cache_invalidate(tm);
+
 	for (i = 0; i < tm->tsens_num_sensor; i++) {
 		bool critical_thr = false;
 		int int_mask, int_mask_val;
@@ -1891,6 +1979,9 @@ static irqreturn_t tsens_tm_irq_thread(int irq, void *data)
 	int sensor_sw_id = -EINVAL, rc = 0;
 	uint32_t addr_offset;
 
+	/* Threshold crossings must report the current temperature */
+	tsens_cache_invalidate(tm);
+
 	sensor_status_addr = TSENS_TM_SN_STATUS(tm->tsens_addr);
 	sensor_int_mask_addr =
 		TSENS_TM_UPPER_LOWER_INT_MASK(tm->tsens_addr);
@@ -2003,6 +2094,9 @@ static irqreturn_t tsens_irq_thread(int irq, void *data)
 	int sensor_sw_id = -EINVAL;
 	uint32_t idx = 0;
 
+	/* Threshold crossings must report the current temperature */
+	tsens_cache_invalidate(tm);
+
 	if ((tm->tsens_type == TSENS_TYPE2) ||
 			(tm->tsens_type == TSENS_TYPE4))
 		sensor_status_addr = TSENS2_SN_STATUS_ADDR(tm->tsens_addr);
@@ -2441,6 +2535,7 @@ static int tsens_tm_probe(struct platform_device *pdev)
 
 	spin_lock_init(&tmdev->tsens_crit_lock);
 	spin_lock_init(&tmdev->tsens_upp_low_lock);
+	spin_lock_init(&tmdev->tsens_cache_lock);
 	tmdev->is_ready = true;
 
 	list_add_tail(&tmdev->list, &tsens_device_list);
@@ -2482,6 +2577,12 @@ static ssize_t tsens_debugfs_read(struct file *file, char __user *ubuf,
 		nbytes += scnprintf(dbg_buff + nbytes, 1024 - nbytes,
 			"TSENS Lower count: %d\n",
 			tmdev->tsens_lower_irq_cnt);
+		nbytes += scnprintf(dbg_buff + nbytes, 1024 - nbytes,
+			"TSENS Cache hit count: %lu\n",
+			tmdev->cache_hit_cnt);
+		nbytes += scnprintf(dbg_buff + nbytes, 1024 - nbytes,
+			"TSENS Cache refresh count: %lu\n",
+			tmdev->cache_refresh_cnt);
 
 	}
 
@@ -27,6 +27,11 @@
 #include <linux/cpu_cooling.h>
 #include <linux/bitmap.h>
 #include <linux/msm_thermal.h>
+#include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 
 #include <asm/smp_plat.h>
 #include <asm/cacheflush.h>
@@ -77,6 +82,19 @@ enum lmh_hw_trips {
 	LIMITS_TRIP_MAX,
 };
 
+/* Lower bound, in percent of max_freq, of each time-at-limit bucket */
+static const unsigned int lmh_stats_pct[] = { 100, 85, 70, 50, 0 };
+#define LMH_STATS_BUCKETS ARRAY_SIZE(lmh_stats_pct)
+
+struct lmh_dcvs_stats {
+	spinlock_t lock;
+	ktime_t last_update;
+	unsigned int bucket;
+	u64 time_ns[LMH_STATS_BUCKETS];
+	unsigned long throttle_events;
+	uint32_t min_limit;
+};
+
 struct msm_lmh_dcvs_hw {
 	char sensor_name[THERMAL_NAME_LENGTH];
 	uint32_t affinity;
@@ -92,9 +110,111 @@ struct msm_lmh_dcvs_hw {
 	uint32_t hw_freq_limit;
 	struct list_head list;
 	DECLARE_BITMAP(is_irq_enabled, 1);
+	struct lmh_dcvs_stats stats;
 };
 
 LIST_HEAD(lmh_dcvs_hw_list);
+static struct dentry *lmh_dcvs_debugfs;
+
+static unsigned int lmh_dcvs_stats_bucket(struct msm_lmh_dcvs_hw *hw,
+					  uint32_t limit)
+{
+	unsigned int i, pct;
+
+	if (!hw->max_freq || hw->max_freq == UINT_MAX ||
+	    limit >= hw->max_freq)
+		return 0;
+
+	pct = div_u64((u64)limit * 100, hw->max_freq);
+	for (i = 1; i < LMH_STATS_BUCKETS - 1; i++)
+		if (pct >= lmh_stats_pct[i])
+			break;
+	return i;
+}
+
+/* Close the running bucket and account the new hardware limit */
+static void lmh_dcvs_stats_update(struct msm_lmh_dcvs_hw *hw, uint32_t limit)
+{
+	struct lmh_dcvs_stats *st = &hw->stats;
+	unsigned long flags;
+	unsigned int bucket;
+	ktime_t now = ktime_get();
+
+	bucket = lmh_dcvs_stats_bucket(hw, limit);
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->time_ns[st->bucket] += ktime_to_ns(ktime_sub(now,
+							 st->last_update));
+	st->last_update = now;
+	if (bucket && !st->bucket)
+		st->throttle_events++;
+	if (bucket && limit < st->min_limit)
+		st->min_limit = limit;
+	st->bucket = bucket;
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
+static int lmh_dcvs_stats_show(struct seq_file *s, void *unused)
+{
+	struct msm_lmh_dcvs_hw *hw = s->private;
+	struct lmh_dcvs_stats *st = &hw->stats;
+	u64 time_ns[LMH_STATS_BUCKETS];
+	unsigned long flags, events;
+	uint32_t min_limit;
+	unsigned int i;
+	ktime_t now = ktime_get();
+
+	spin_lock_irqsave(&st->lock, flags);
+	memcpy(time_ns, st->time_ns, sizeof(time_ns));
+	time_ns[st->bucket] += ktime_to_ns(ktime_sub(now, st->last_update));
+	events = st->throttle_events;
+	min_limit = st->min_limit;
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	seq_printf(s, "cpus: %*pbl\n", cpumask_pr_args(&hw->core_map));
+	seq_printf(s, "max_freq: %u\n", hw->max_freq);
+	seq_printf(s, "cur_limit: %u\n", hw->hw_freq_limit);
+	seq_printf(s, "min_limit: %u\n",
+		   min_limit == UINT_MAX ? hw->max_freq : min_limit);
+	seq_printf(s, "throttle_events: %lu\n", events);
+	seq_puts(s, "time_at_limit_ms:\n");
+	for (i = 0; i < LMH_STATS_BUCKETS; i++) {
+		if (!i)
+			seq_puts(s, "  unthrottled");
+		else
+			seq_printf(s, "  %3u-%3u%%   ", lmh_stats_pct[i],
+				   lmh_stats_pct[i - 1] - 1);
+		seq_printf(s, " %llu\n", div_u64(time_ns[i], NSEC_PER_MSEC));
+	}
+	return 0;
+}
+
+static int lmh_dcvs_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lmh_dcvs_stats_show, inode->i_private);
+}
+
+static const struct file_operations lmh_dcvs_stats_fops = {
+	.open		= lmh_dcvs_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void lmh_dcvs_stats_init(struct msm_lmh_dcvs_hw *hw)
+{
+	struct lmh_dcvs_stats *st = &hw->stats;
+
+	spin_lock_init(&st->lock);
+	st->last_update = ktime_get();
+	st->min_limit = UINT_MAX;
+
+	if (!lmh_dcvs_debugfs)
+		lmh_dcvs_debugfs = debugfs_create_dir("lmh_dcvs", NULL);
+	if (!IS_ERR_OR_NULL(lmh_dcvs_debugfs))
+		debugfs_create_file(hw->sensor_name, 0444, lmh_dcvs_debugfs,
+				    hw, &lmh_dcvs_stats_fops);
+}
 
 static void msm_lmh_dcvs_get_max_freq(uint32_t cpu, uint32_t *max_freq)
 {
@@ -148,9 +268,13 @@ static uint32_t msm_lmh_mitigation_notify(struct msm_lmh_dcvs_hw *hw)
 	max_limit = FREQ_HZ_TO_KHZ(freq_val);
 
 	sched_update_cpu_freq_min_max(&hw->core_map, 0, max_limit);
+	/* let capacity_orig follow the clamp, not just the policy max */
+	cpufreq_update_thermal_cap(&hw->core_map,
+			max_limit >= hw->max_freq ? 0 : max_limit);
 	trace_lmh_dcvs_freq(cpumask_first(&hw->core_map), max_limit);
 
 notify_exit:
+	lmh_dcvs_stats_update(hw, max_limit);
 	hw->hw_freq_limit = max_limit;
 	return max_limit;
 }
@@ -517,6 +641,7 @@ static int msm_lmh_dcvs_probe(struct platform_device *pdev)
 	}
 
 	hw->hw_freq_limit = hw->max_freq = max_freq;
+	lmh_dcvs_stats_init(hw);
 
 	switch (affinity) {
 	case 0:
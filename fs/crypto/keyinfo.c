@@ -173,6 +173,10 @@ static struct fscrypt_mode {
 		.cipher_str = "cts(cbc(aes))",
 		.keysize = 16,
 	},
+	[FS_ENCRYPTION_MODE_PRIVATE] = {
+		.friendly_name = "ICE",
+		.keysize = 64,
+	},
 };
 
 static struct fscrypt_mode *
@@ -204,6 +208,7 @@ static void put_crypt_info(struct fscrypt_info *ci)
 
 	crypto_free_skcipher(ci->ci_ctfm);
 	crypto_free_cipher(ci->ci_essiv_tfm);
+	memzero_explicit(ci->ci_raw_key, sizeof(ci->ci_raw_key));
 	kmem_cache_free(fscrypt_info_cachep, ci);
 }
 
@@ -342,6 +347,16 @@ int fscrypt_get_encryption_info(struct inode *inode)
 	if (res)
 		goto out;
 
+	/*
+	 * The inline crypto engine encrypts the contents when the bios reach
+	 * the storage controller, so only keep the key around for it.
+	 */
+	if (S_ISREG(inode->i_mode) &&
+	    crypt_info->ci_data_mode == FS_ENCRYPTION_MODE_PRIVATE) {
+		memcpy(crypt_info->ci_raw_key, raw_key, mode->keysize);
+		goto install;
+	}
+
 	ctfm = crypto_alloc_skcipher(mode->cipher_str, 0, 0);
 	if (IS_ERR(ctfm)) {
 		res = PTR_ERR(ctfm);
@@ -379,6 +394,7 @@ int fscrypt_get_encryption_info(struct inode *inode)
 			goto out;
 		}
 	}
+install:
 	if (cmpxchg(&inode->i_crypt_info, NULL, crypt_info) == NULL)
 		crypt_info = NULL;
 out:
@@ -406,3 +422,49 @@ void fscrypt_put_encryption_info(struct inode *inode, struct fscrypt_info *ci)
 	put_crypt_info(ci);
 }
 EXPORT_SYMBOL(fscrypt_put_encryption_info);
+
+/**
+ * fscrypt_using_hardware_encryption() - whether an inode's contents are
+ * encrypted by the inline crypto engine
+ * @inode: the inode to check
+ *
+ * The key of such an inode is handed to the storage driver through PFK;
+ * its pages must go to the disk as they are instead of through bounce pages.
+ */
+bool fscrypt_using_hardware_encryption(const struct inode *inode)
+{
+	struct fscrypt_info *ci = inode->i_crypt_info;
+
+	return S_ISREG(inode->i_mode) && ci &&
+		ci->ci_data_mode == FS_ENCRYPTION_MODE_PRIVATE;
+}
+EXPORT_SYMBOL(fscrypt_using_hardware_encryption);
+
+/**
+ * fscrypt_policy_uses_hardware_encryption() - whether the policy of an
+ * inode asks for the inline crypto engine
+ * @inode: the inode to check
+ *
+ * Unlike fscrypt_using_hardware_encryption() this also works while the key
+ * of the inode isn't set up, by reading its encryption context. Errors
+ * reading the context are reported as hardware encryption, so callers that
+ * would otherwise move the ciphertext around leave it alone.
+ */
+bool fscrypt_policy_uses_hardware_encryption(struct inode *inode)
+{
+	struct fscrypt_context ctx;
+	int res;
+
+	if (!S_ISREG(inode->i_mode) || !IS_ENCRYPTED(inode))
+		return false;
+
+	if (inode->i_crypt_info)
+		return fscrypt_using_hardware_encryption(inode);
+
+	res = inode->i_sb->s_cop->get_context(inode, &ctx, sizeof(ctx));
+	if (res != sizeof(ctx))
+		return true;
+
+	return ctx.contents_encryption_mode == FS_ENCRYPTION_MODE_PRIVATE;
+}
+EXPORT_SYMBOL(fscrypt_policy_uses_hardware_encryption);
@@ -1371,6 +1371,11 @@ struct ext4_sb_info {
 	unsigned short *s_mb_offsets;
 	unsigned int *s_mb_maxs;
 	unsigned int s_group_info_size;
+	/* groups by order of their largest free extent and average fragment */
+	struct list_head *s_mb_largest_free_orders;
+	rwlock_t *s_mb_largest_free_orders_locks;
+	struct list_head *s_mb_avg_fragment_size;
+	rwlock_t *s_mb_avg_fragment_size_locks;
 
 	/* tunables */
 	unsigned long s_stripe;
@@ -1380,6 +1385,7 @@ struct ext4_sb_info {
 	unsigned int s_mb_stats;
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
+	unsigned int s_mb_optimize_scan;
 	unsigned int s_max_dir_size_kb;
 	/* where last allocation was done - for stream allocation */
 	unsigned long s_mb_last_group;
@@ -1393,6 +1399,9 @@ struct ext4_sb_info {
 	atomic_t s_bal_goals;	/* goal hits */
 	atomic_t s_bal_breaks;	/* too long searches */
 	atomic_t s_bal_2orders;	/* 2^order hits */
+	atomic_t s_bal_groups_scanned;	/* groups whose buddy was scanned */
+	atomic_t s_bal_cX_groups_considered[4];	/* groups checked per cr */
+	atomic_t s_bal_cX_hits[4];	/* allocations done at each cr */
 	spinlock_t s_bal_lock;
 	unsigned long s_mb_buddies_generated;
 	unsigned long long s_mb_generation_time;
@@ -2480,6 +2489,7 @@ extern void ext4_end_bitmap_read(struct buffer_head *bh, int uptodate);
 
 /* mballoc.c */
 extern const struct file_operations ext4_seq_mb_groups_fops;
+extern int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset);
 extern long ext4_mb_stats;
 extern long ext4_mb_max_to_scan;
 extern int ext4_mb_init(struct super_block *);
@@ -2941,7 +2951,11 @@ struct ext4_group_info {
 	ext4_grpblk_t	bb_free;	/* total free blocks */
 	ext4_grpblk_t	bb_fragments;	/* nr of freespace fragments */
 	ext4_grpblk_t	bb_largest_free_order;/* order of largest frag in BG */
+	ext4_grpblk_t	bb_avg_fragment_size_order;	/* order of avg frag */
+	ext4_group_t	bb_group;	/* group number */
 	struct          list_head bb_prealloc_list;
+	struct          list_head bb_largest_free_order_node;
+	struct          list_head bb_avg_fragment_size_node;
 #ifdef DOUBLE_CHECK
 	void            *bb_bitmap;
 #endif
@@ -705,18 +705,75 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	int i;
-	int bits;
-
-	grp->bb_largest_free_order = -1; /* uninit */
 
-	bits = sb->s_blocksize_bits + 1;
-	for (i = bits; i >= 0; i--) {
-		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+	for (i = MB_NUM_ORDERS(sb) - 1; i >= 0; i--)
+		if (grp->bb_counters[i] > 0)
 			break;
-		}
+
+	/* Still on the right list */
+	if (i == grp->bb_largest_free_order)
+		return;
+
+	if (grp->bb_largest_free_order >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
 	}
+	grp->bb_largest_free_order = i; /* -1 if uninit or full */
+	if (i >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[i]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+}
+
+/* Order of the fragment size, 2^(order + 1) <= len < 2^(order + 2) */
+static int mb_avg_fragment_size_order(struct super_block *sb, ext4_grpblk_t len)
+{
+	int order = fls(len) - 2;
+
+	if (order < 0)
+		return 0;
+	if (order >= MB_NUM_ORDERS(sb))
+		return MB_NUM_ORDERS(sb) - 1;
+	return order;
+}
+
+/*
+ * Keep the group on the list of its average free fragment size, a full
+ * group is left where it was as ext4_mb_good_group() skips it anyway.
+ */
+static void
+mb_update_avg_fragment_size(struct super_block *sb, struct ext4_group_info *grp)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int new_order;
+
+	if (grp->bb_fragments == 0)
+		return;
+
+	new_order = mb_avg_fragment_size_order(sb,
+					grp->bb_free / grp->bb_fragments);
+	if (new_order == grp->bb_avg_fragment_size_order)
+		return;
+
+	if (grp->bb_avg_fragment_size_order != -1) {
+		write_lock(&sbi->s_mb_avg_fragment_size_locks[
+					grp->bb_avg_fragment_size_order]);
+		list_del(&grp->bb_avg_fragment_size_node);
+		write_unlock(&sbi->s_mb_avg_fragment_size_locks[
+					grp->bb_avg_fragment_size_order]);
+	}
+	grp->bb_avg_fragment_size_order = new_order;
+	write_lock(&sbi->s_mb_avg_fragment_size_locks[new_order]);
+	list_add_tail(&grp->bb_avg_fragment_size_node,
+		      &sbi->s_mb_avg_fragment_size[new_order]);
+	write_unlock(&sbi->s_mb_avg_fragment_size_locks[new_order]);
 }
 
 static noinline_for_stack
@@ -768,6 +825,7 @@ void ext4_mb_generate_buddy(struct super_block *sb,
 		set_bit(EXT4_GROUP_INFO_BBITMAP_CORRUPT_BIT, &grp->bb_state);
 	}
 	mb_set_largest_free_order(sb, grp);
+	mb_update_avg_fragment_size(sb, grp);
 
 	clear_bit(EXT4_GROUP_INFO_NEED_INIT_BIT, &(grp->bb_state));
 
@@ -1505,6 +1563,7 @@ static void mb_free_blocks(struct inode *inode, struct ext4_buddy *e4b,
 
 done:
 	mb_set_largest_free_order(sb, e4b->bd_info);
+	mb_update_avg_fragment_size(sb, e4b->bd_info);
 	mb_check_buddy(e4b);
 }
 
@@ -1629,6 +1688,7 @@ static int mb_mark_used(struct ext4_buddy *e4b, struct ext4_free_extent *ex)
 		e4b->bd_info->bb_counters[ord]++;
 	}
 	mb_set_largest_free_order(e4b->bd_sb, e4b->bd_info);
+	mb_update_avg_fragment_size(e4b->bd_sb, e4b->bd_info);
 
 	ext4_set_bits(e4b->bd_bitmap, ex->fe_start, len0);
 	mb_check_buddy(e4b);
@@ -2101,6 +2161,67 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * With mb_optimize_scan, cr 0 takes groups from the lists by order of the
+ * largest free extent, starting at the order of the request, and cr 1 from
+ * the lists by average fragment size, starting at the order of the goal
+ * length, instead of loading the buddy of every group on the way. The
+ * lists aren't sorted within an order, so the good groups handed out
+ * already at this cr are skipped to not retry them.
+ */
+static bool ext4_mb_choose_next_group(struct ext4_allocation_context *ac,
+				      int cr, ext4_group_t ngroups,
+				      ext4_group_t *group)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct list_head *lists;
+	rwlock_t *locks;
+	struct ext4_group_info *grp;
+	struct list_head *pos;
+	ext4_group_t count = 0;
+	int order;
+
+	if (cr == 0) {
+		lists = sbi->s_mb_largest_free_orders;
+		locks = sbi->s_mb_largest_free_orders_locks;
+		order = ac->ac_2order;
+	} else {
+		lists = sbi->s_mb_avg_fragment_size;
+		locks = sbi->s_mb_avg_fragment_size_locks;
+		order = mb_avg_fragment_size_order(sb, ac->ac_g_ex.fe_len);
+	}
+
+	for (; order < MB_NUM_ORDERS(sb); order++) {
+		if (list_empty(&lists[order]))
+			continue;
+
+		read_lock(&locks[order]);
+		list_for_each(pos, &lists[order]) {
+			if (cr == 0)
+				grp = list_entry(pos, struct ext4_group_info,
+						 bb_largest_free_order_node);
+			else
+				grp = list_entry(pos, struct ext4_group_info,
+						 bb_avg_fragment_size_node);
+			/* listed groups have a buddy, so this won't sleep */
+			if (grp->bb_group >= ngroups ||
+			    EXT4_MB_GRP_NEED_INIT(grp) ||
+			    ext4_mb_good_group(ac, grp->bb_group, cr) <= 0)
+				continue;
+			if (count++ < ac->ac_groups_tried)
+				continue;
+			read_unlock(&locks[order]);
+			ac->ac_groups_tried++;
+			*group = grp->bb_group;
+			return true;
+		}
+		read_unlock(&locks[order]);
+	}
+
+	return false;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -2168,7 +2289,10 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	 */
 repeat:
 	for (; cr < 4 && ac->ac_status == AC_STATUS_CONTINUE; cr++) {
+		bool optimized = sbi->s_mb_optimize_scan && cr < 2;
+
 		ac->ac_criteria = cr;
+		ac->ac_groups_tried = 0;
 		/*
 		 * searching for the right group start
 		 * from the goal value specified
@@ -2178,6 +2302,9 @@ repeat:
 		for (i = 0; i < ngroups; group++, i++) {
 			int ret = 0;
 			cond_resched();
+			if (optimized &&
+			    !ext4_mb_choose_next_group(ac, cr, ngroups, &group))
+				break;
 			/*
 			 * Artificially restricted ngroups for non-extent
 			 * files makes group > ngroups possible on first loop.
@@ -2185,6 +2312,9 @@ repeat:
 			if (group >= ngroups)
 				group = 0;
 
+			if (sbi->s_mb_stats)
+				atomic_inc(&sbi->s_bal_cX_groups_considered[cr]);
+
 			/* This now checks without needing the buddy page */
 			ret = ext4_mb_good_group(ac, group, cr);
 			if (ret <= 0) {
@@ -2363,6 +2493,44 @@ const struct file_operations ext4_seq_mb_groups_fops = {
 	.release	= seq_release,
 };
 
+int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	unsigned int reqs = atomic_read(&sbi->s_bal_reqs);
+	unsigned int scanned = atomic_read(&sbi->s_bal_groups_scanned);
+	int cr;
+
+	seq_puts(seq, "mballoc:\n");
+	if (!sbi->s_mb_stats) {
+		seq_puts(seq, "\tmb stats collection turned off.\n");
+		seq_puts(seq, "\tTo enable, please write \"1\" to sysfs file mb_stats.\n");
+		return 0;
+	}
+	seq_printf(seq, "\treqs: %u\n", reqs);
+	seq_printf(seq, "\tsuccess: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "\tgroups_scanned: %u\n", scanned);
+	seq_printf(seq, "\tgroups_scanned_per_req: %u\n",
+		   reqs ? scanned / reqs : 0);
+	seq_printf(seq, "\toptimize_scan: %u\n", sbi->s_mb_optimize_scan);
+	for (cr = 0; cr < 4; cr++) {
+		seq_printf(seq, "\tcr%d_stats:\n", cr);
+		seq_printf(seq, "\t\thits: %u\n",
+			   atomic_read(&sbi->s_bal_cX_hits[cr]));
+		seq_printf(seq, "\t\tgroups_considered: %u\n",
+			   atomic_read(&sbi->s_bal_cX_groups_considered[cr]));
+	}
+	seq_printf(seq, "\textents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "\tgoal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "\t2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "\tbreaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "\tlost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "\tbuddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	return 0;
+}
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2466,6 +2634,10 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_avg_fragment_size_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_avg_fragment_size_node);
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2626,6 +2798,29 @@ int ext4_mb_init(struct super_block *sb)
 		goto out;
 	}
 
+	i = MB_NUM_ORDERS(sb);
+	sbi->s_mb_largest_free_orders = kmalloc_array(i,
+					sizeof(struct list_head), GFP_KERNEL);
+	sbi->s_mb_largest_free_orders_locks = kmalloc_array(i,
+					sizeof(rwlock_t), GFP_KERNEL);
+	sbi->s_mb_avg_fragment_size = kmalloc_array(i,
+					sizeof(struct list_head), GFP_KERNEL);
+	sbi->s_mb_avg_fragment_size_locks = kmalloc_array(i,
+					sizeof(rwlock_t), GFP_KERNEL);
+	if (!sbi->s_mb_largest_free_orders ||
+	    !sbi->s_mb_largest_free_orders_locks ||
+	    !sbi->s_mb_avg_fragment_size ||
+	    !sbi->s_mb_avg_fragment_size_locks) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+		INIT_LIST_HEAD(&sbi->s_mb_avg_fragment_size[i]);
+		rwlock_init(&sbi->s_mb_avg_fragment_size_locks[i]);
+	}
+
 	ret = ext4_groupinfo_create_slab(sb->s_blocksize);
 	if (ret < 0)
 		goto out;
@@ -2655,6 +2850,7 @@ int ext4_mb_init(struct super_block *sb)
 	sbi->s_mb_stats = MB_DEFAULT_STATS;
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
+	sbi->s_mb_optimize_scan = MB_DEFAULT_OPTIMIZE_SCAN;
 	/*
 	 * The default group preallocation is 512, which for 4k block
 	 * sizes translates to 2 megabytes.  However for bigalloc file
@@ -2707,6 +2903,14 @@ out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
 out:
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
+	kfree(sbi->s_mb_avg_fragment_size);
+	sbi->s_mb_avg_fragment_size = NULL;
+	kfree(sbi->s_mb_avg_fragment_size_locks);
+	sbi->s_mb_avg_fragment_size_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2762,6 +2966,10 @@ int ext4_mb_release(struct super_block *sb)
 		kvfree(group_info);
 		rcu_read_unlock();
 	}
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	kfree(sbi->s_mb_avg_fragment_size);
+	kfree(sbi->s_mb_avg_fragment_size_locks);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	iput(sbi->s_buddy_cache);
@@ -2779,6 +2987,14 @@ int ext4_mb_release(struct super_block *sb)
 				atomic_read(&sbi->s_bal_2orders),
 				atomic_read(&sbi->s_bal_breaks),
 				atomic_read(&sbi->s_mb_lost_chunks));
+		ext4_msg(sb, KERN_INFO,
+		      "mballoc: %u groups scanned, cr0/1/2/3 hits "
+				"%u/%u/%u/%u",
+				atomic_read(&sbi->s_bal_groups_scanned),
+				atomic_read(&sbi->s_bal_cX_hits[0]),
+				atomic_read(&sbi->s_bal_cX_hits[1]),
+				atomic_read(&sbi->s_bal_cX_hits[2]),
+				atomic_read(&sbi->s_bal_cX_hits[3]));
 		ext4_msg(sb, KERN_INFO,
 		       "mballoc: %lu generated and it took %Lu",
 				sbi->s_mb_buddies_generated,
@@ -3277,6 +3493,11 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
+		/* criteria 10 and 20 are inode and group preallocations */
+		if (ac->ac_status == AC_STATUS_FOUND && ac->ac_groups_scanned &&
+		    ac->ac_criteria < 4)
+			atomic_inc(&sbi->s_bal_cX_hits[ac->ac_criteria]);
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -70,6 +70,15 @@ extern ushort ext4_mballoc_debug;
  */
 #define MB_DEFAULT_STATS		0
 
+/*
+ * Pick groups from the lists of groups by largest free order and average
+ * fragment size instead of scanning them one by one
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
+/* Number of buddy orders, bb_counters[] size */
+#define MB_NUM_ORDERS(sb)		((sb)->s_blocksize_bits + 2)
+
 /*
  * files smaller than MB_DEFAULT_STREAM_THRESHOLD are served
  * by the stream allocator, which purpose is to pack requests
@@ -175,6 +184,8 @@ struct ext4_allocation_context {
 	/* copy of the best found extent taken before preallocation efforts */
 	struct ext4_free_extent ac_f_ex;
 
+	/* groups handed out of the order lists at the current criteria */
+	ext4_group_t ac_groups_tried;
 	__u16 ac_groups_scanned;
 	__u16 ac_found;
 	__u16 ac_tail;
@@ -0,0 +1,1076 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * fs/f2fs/compress.c
+ *
+ * Transparent compression of regular files, in clusters of
+ * 2^i_log_cluster_size pages. The block address slots of a compressed
+ * cluster hold COMPRESS_ADDR first, then the blocks storing the compressed
+ * data (starting with a struct compress_data header), then NULL_ADDR.
+ * Clusters that would not save a block, or that are not complete, are
+ * written as plain blocks.
+ */
+#include <linux/fs.h>
+#include <linux/f2fs_fs.h>
+#include <linux/writeback.h>
+#include <linux/backing-dev.h>
+#include <linux/pagemap.h>
+#include <linux/vmalloc.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
+
+#include "f2fs.h"
+#include "node.h"
+#include "segment.h"
+
+struct compress_data {
+	__le32 clen;			/* compressed data size */
+	__le32 chksum;			/* reserved for checksum, zero */
+	__le32 reserved[4];		/* reserved */
+	u8 cdata[];			/* compressed data */
+};
+
+#define COMPRESS_HEADER_SIZE	(sizeof(struct compress_data))
+
+/* for writing one compressed cluster, see f2fs_write_compressed_cluster() */
+struct compress_io_ctx {
+	u32 magic;			/* magic number to indicate page is compressed */
+	struct inode *inode;		/* inode the context belong to */
+	struct page **rpages;		/* pages of the cluster, after the context */
+	unsigned int nr_rpages;		/* page count in cluster */
+	atomic_t pending_pages;		/* in-flight compressed page count */
+};
+
+struct f2fs_compress_ops {
+	/* returns -EAGAIN if the data does not fit in *dst_len */
+	int (*compress)(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t *dst_len);
+	int (*decompress)(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t dst_len);
+};
+
+#ifdef CONFIG_F2FS_FS_LZ4
+static int lz4_compress_pages(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t *dst_len)
+{
+	void *workspace;
+	int len;
+
+	workspace = f2fs_kvmalloc(sbi, LZ4_MEM_COMPRESS, GFP_NOFS);
+	if (!workspace)
+		return -ENOMEM;
+
+	len = LZ4_compress_default(src, dst, src_len, *dst_len, workspace);
+	kvfree(workspace);
+	if (!len)
+		return -EAGAIN;
+
+	*dst_len = len;
+	return 0;
+}
+
+static int lz4_decompress_pages(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t dst_len)
+{
+	int len;
+
+	len = LZ4_decompress_safe(src, dst, src_len, dst_len);
+	if (len != dst_len)
+		return -EIO;
+	return 0;
+}
+
+static const struct f2fs_compress_ops f2fs_lz4_ops = {
+	.compress	= lz4_compress_pages,
+	.decompress	= lz4_decompress_pages,
+};
+#endif
+
+#ifdef CONFIG_F2FS_FS_ZSTD
+#define F2FS_ZSTD_DEFAULT_CLEVEL	1
+
+static int zstd_compress_pages(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t *dst_len)
+{
+	ZSTD_parameters params;
+	ZSTD_CCtx *ctx;
+	void *workspace;
+	size_t wsize, len;
+
+	params = ZSTD_getParams(F2FS_ZSTD_DEFAULT_CLEVEL, src_len, 0);
+	wsize = ZSTD_CCtxWorkspaceBound(params.cParams);
+	workspace = f2fs_kvmalloc(sbi, wsize, GFP_NOFS);
+	if (!workspace)
+		return -ENOMEM;
+
+	ctx = ZSTD_initCCtx(workspace, wsize);
+	if (!ctx) {
+		kvfree(workspace);
+		return -EINVAL;
+	}
+
+	len = ZSTD_compressCCtx(ctx, dst, *dst_len, src, src_len, params);
+	kvfree(workspace);
+	if (ZSTD_isError(len))
+		return -EAGAIN;
+
+	*dst_len = len;
+	return 0;
+}
+
+static int zstd_decompress_pages(struct f2fs_sb_info *sbi, const void *src,
+				size_t src_len, void *dst, size_t dst_len)
+{
+	ZSTD_DCtx *ctx;
+	void *workspace;
+	size_t wsize, len;
+
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = f2fs_kvmalloc(sbi, wsize, GFP_NOFS);
+	if (!workspace)
+		return -ENOMEM;
+
+	ctx = ZSTD_initDCtx(workspace, wsize);
+	if (!ctx) {
+		kvfree(workspace);
+		return -EINVAL;
+	}
+
+	len = ZSTD_decompressDCtx(ctx, dst, dst_len, src, src_len);
+	kvfree(workspace);
+	if (ZSTD_isError(len) || len != dst_len)
+		return -EIO;
+	return 0;
+}
+
+static const struct f2fs_compress_ops f2fs_zstd_ops = {
+	.compress	= zstd_compress_pages,
+	.decompress	= zstd_decompress_pages,
+};
+#endif
+
+static const struct f2fs_compress_ops *f2fs_cops[COMPRESS_MAX] = {
+#ifdef CONFIG_F2FS_FS_LZ4
+	[COMPRESS_LZ4]	= &f2fs_lz4_ops,
+#endif
+#ifdef CONFIG_F2FS_FS_ZSTD
+	[COMPRESS_ZSTD]	= &f2fs_zstd_ops,
+#endif
+};
+
+bool f2fs_compress_algorithm_supported(unsigned char algorithm)
+{
+	return algorithm < COMPRESS_MAX && f2fs_cops[algorithm];
+}
+
+bool f2fs_is_compressed_page(struct page *page)
+{
+	if (page->mapping || !PagePrivate(page) || !page_private(page))
+		return false;
+	if (IS_ATOMIC_WRITTEN_PAGE(page) || IS_DUMMY_WRITTEN_PAGE(page))
+		return false;
+	return *((u32 *)page_private(page)) == F2FS_COMPRESSED_PAGE_MAGIC;
+}
+
+/* page cache page standing for a compressed page in a write bio */
+struct page *f2fs_compress_control_page(struct page *page)
+{
+	struct compress_io_ctx *cic = (struct compress_io_ctx *)page_private(page);
+
+	return cic->rpages[0];
+}
+
+static void f2fs_set_compressed_page(struct page *page, void *ctx)
+{
+	SetPagePrivate(page);
+	set_page_private(page, (unsigned long)ctx);
+}
+
+static void f2fs_put_compressed_page(struct page *page)
+{
+	set_page_private(page, (unsigned long)NULL);
+	ClearPagePrivate(page);
+	put_page(page);
+}
+
+bool f2fs_may_compress(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+
+	if (!f2fs_sb_has_compression(sbi) || !S_ISREG(inode->i_mode) ||
+			IS_NOQUOTA(inode) || IS_SWAPFILE(inode) ||
+			f2fs_encrypted_inode(inode) ||
+			f2fs_is_atomic_file(inode) ||
+			f2fs_is_volatile_file(inode) ||
+			f2fs_is_pinned_file(inode))
+		return false;
+
+	/* inodes made before compression support may lack the fields */
+	if (!f2fs_has_extra_attr(inode) ||
+			!F2FS_FITS_IN_INODE((struct f2fs_inode *)NULL,
+				F2FS_I(inode)->i_extra_isize, i_log_cluster_size))
+		return false;
+
+	return f2fs_compress_algorithm_supported(
+				F2FS_OPTION(sbi).compress_algorithm);
+}
+
+void f2fs_set_compress_context(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	fi->i_compress_algorithm = F2FS_OPTION(sbi).compress_algorithm;
+	fi->i_log_cluster_size = F2FS_OPTION(sbi).compress_log_size;
+	fi->i_cluster_size = 1 << fi->i_log_cluster_size;
+	fi->i_flags |= F2FS_COMPR_FL;
+	set_inode_flag(inode, FI_COMPRESSED_FILE);
+	stat_inc_compr_inode(inode);
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+void f2fs_clear_compress_context(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	fi->i_flags &= ~F2FS_COMPR_FL;
+	clear_inode_flag(inode, FI_COMPRESSED_FILE);
+	fi->i_compress_algorithm = 0;
+	fi->i_log_cluster_size = 0;
+	fi->i_cluster_size = 0;
+	atomic_set(&fi->i_compr_blocks, 0);
+	stat_dec_compr_inode(inode);
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+/*
+ * Returns the number of blocks storing the compressed data of the cluster
+ * starting at @start, filling @blkaddrs with their addresses if set, or 0
+ * if the cluster is not compressed.
+ */
+static int f2fs_compressed_blocks(struct inode *inode, pgoff_t start,
+							block_t *blkaddrs)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	struct dnode_of_data dn;
+	int i, ret;
+
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	ret = f2fs_get_dnode_of_data(&dn, start, LOOKUP_NODE);
+	if (ret)
+		return ret == -ENOENT ? 0 : ret;
+
+	if (dn.data_blkaddr != COMPRESS_ADDR) {
+		ret = 0;
+		goto out;
+	}
+
+	for (i = 1; i < cluster_size; i++) {
+		block_t blkaddr = datablock_addr(dn.inode, dn.node_page,
+							dn.ofs_in_node + i);
+
+		if (!__is_valid_data_blkaddr(blkaddr))
+			break;
+		if (!f2fs_is_valid_blkaddr(sbi, blkaddr,
+					DATA_GENERIC_ENHANCE_READ)) {
+			ret = -EFSCORRUPTED;
+			goto out;
+		}
+		if (blkaddrs)
+			blkaddrs[i - 1] = blkaddr;
+	}
+
+	ret = i - 1;
+	if (!ret) {
+		set_sbi_flag(sbi, SBI_NEED_FSCK);
+		ret = -EFSCORRUPTED;
+	}
+out:
+	f2fs_put_dnode(&dn);
+	return ret;
+}
+
+/*
+ * Returns NULL if the cluster starting at @start is not compressed. The
+ * page, address and compressed page arrays are carved out of the same
+ * allocation as the context.
+ */
+static struct decompress_io_ctx *f2fs_alloc_dic(struct inode *inode,
+							pgoff_t start)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	struct decompress_io_ctx *dic;
+	int ret;
+
+	dic = f2fs_kzalloc(sbi, sizeof(*dic) + cluster_size *
+			(2 * sizeof(struct page *) + sizeof(block_t)),
+			GFP_NOFS);
+	if (!dic)
+		return ERR_PTR(-ENOMEM);
+
+	dic->rpages = (struct page **)(dic + 1);
+	dic->cpages = dic->rpages + cluster_size;
+	dic->cblkaddrs = (block_t *)(dic->cpages + cluster_size);
+
+	ret = f2fs_compressed_blocks(inode, start, dic->cblkaddrs);
+	if (ret <= 0)
+		goto out_free;
+
+	if (!f2fs_compress_algorithm_supported(
+				F2FS_I(inode)->i_compress_algorithm)) {
+		ret = -EOPNOTSUPP;
+		goto out_free;
+	}
+
+	dic->magic = F2FS_COMPRESSED_PAGE_MAGIC;
+	dic->inode = inode;
+	dic->cluster_idx = start;
+	dic->cluster_size = cluster_size;
+	dic->nr_cpages = ret;
+	return dic;
+
+out_free:
+	kvfree(dic);
+	return ret ? ERR_PTR(ret) : NULL;
+}
+
+static int f2fs_alloc_dic_cpages(struct decompress_io_ctx *dic)
+{
+	unsigned int i;
+
+	for (i = 0; i < dic->nr_cpages; i++) {
+		struct page *cpage = alloc_page(GFP_NOFS);
+
+		if (!cpage)
+			return -ENOMEM;
+		f2fs_set_compressed_page(cpage, dic);
+		dic->cpages[i] = cpage;
+	}
+	return 0;
+}
+
+static void f2fs_free_dic(struct decompress_io_ctx *dic)
+{
+	unsigned int i;
+
+	for (i = 0; i < dic->nr_cpages; i++)
+		if (dic->cpages[i])
+			f2fs_put_compressed_page(dic->cpages[i]);
+	kvfree(dic);
+}
+
+static int f2fs_decompress_dic(struct decompress_io_ctx *dic)
+{
+	struct inode *inode = dic->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	const struct f2fs_compress_ops *cops =
+			f2fs_cops[F2FS_I(inode)->i_compress_algorithm];
+	struct compress_data *cdata;
+	struct page **tpages;
+	void *rbuf = NULL, *cbuf = NULL;
+	unsigned int clen, i;
+	ktime_t start;
+	int ret = -ENOMEM;
+
+	/* decompress the whole cluster, into spare pages where not wanted */
+	tpages = f2fs_kzalloc(sbi, sizeof(struct page *) * dic->cluster_size,
+								GFP_NOFS);
+	if (!tpages)
+		return -ENOMEM;
+
+	for (i = 0; i < dic->cluster_size; i++) {
+		tpages[i] = dic->rpages[i];
+		if (!tpages[i])
+			tpages[i] = alloc_page(GFP_NOFS);
+		if (!tpages[i])
+			goto out;
+	}
+
+	rbuf = vmap(tpages, dic->cluster_size, VM_MAP, PAGE_KERNEL);
+	if (!rbuf)
+		goto out;
+	cbuf = vmap(dic->cpages, dic->nr_cpages, VM_MAP, PAGE_KERNEL);
+	if (!cbuf)
+		goto out;
+
+	cdata = cbuf;
+	clen = le32_to_cpu(cdata->clen);
+	if (clen > dic->nr_cpages * PAGE_SIZE - COMPRESS_HEADER_SIZE) {
+		set_sbi_flag(sbi, SBI_NEED_FSCK);
+		ret = -EFSCORRUPTED;
+		goto out;
+	}
+
+	start = ktime_get();
+	ret = cops->decompress(sbi, cdata->cdata, clen, rbuf,
+					dic->cluster_size << PAGE_SHIFT);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+						&sbi->decompr_time);
+	atomic64_inc(&sbi->decompr_clusters);
+	if (ret)
+		f2fs_err(sbi, "Failed to decompress cluster %lu of ino %lu: %d",
+			 dic->cluster_idx, inode->i_ino, ret);
+out:
+	if (cbuf)
+		vunmap(cbuf);
+	if (rbuf)
+		vunmap(rbuf);
+	for (i = 0; i < dic->cluster_size; i++)
+		if (tpages[i] && !dic->rpages[i])
+			__free_page(tpages[i]);
+	kvfree(tpages);
+	return ret;
+}
+
+static void f2fs_finish_dic(struct decompress_io_ctx *dic)
+{
+	unsigned int i;
+	int err;
+
+	err = READ_ONCE(dic->failed) ? -EIO : f2fs_decompress_dic(dic);
+
+	for (i = 0; i < dic->cluster_size; i++) {
+		struct page *rpage = dic->rpages[i];
+
+		if (!rpage)
+			continue;
+		if (err)
+			ClearPageUptodate(rpage);
+		else
+			SetPageUptodate(rpage);
+		if (dic->sync)
+			continue;
+		unlock_page(rpage);
+		if (rpage != dic->caller_page)
+			put_page(rpage);
+	}
+
+	if (dic->sync) {
+		dic->err = err;
+		complete(&dic->done);
+		return;
+	}
+	f2fs_free_dic(dic);
+}
+
+/*
+ * Called from read bio completion, in process context unless the bio
+ * failed; the last compressed page of a cluster decompresses it.
+ */
+void f2fs_end_read_compressed_page(struct page *page, bool failed)
+{
+	struct decompress_io_ctx *dic =
+			(struct decompress_io_ctx *)page_private(page);
+
+	if (failed)
+		WRITE_ONCE(dic->failed, true);
+
+	dec_page_count(F2FS_I_SB(dic->inode), F2FS_RD_DATA);
+
+	if (atomic_dec_and_test(&dic->pending_pages))
+		f2fs_finish_dic(dic);
+}
+
+/*
+ * Start reading the cluster of locked @page if it is compressed. The other
+ * pages of the cluster get filled as well if they can be taken without
+ * waiting. Returns 1 if @page is under read and gets unlocked once done,
+ * 0 if the cluster is not compressed, or an error leaving @page locked.
+ */
+int f2fs_read_compressed_cluster(struct inode *inode, struct page *page,
+							bool is_readahead)
+{
+	struct address_space *mapping = inode->i_mapping;
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t start = round_down(page->index, cluster_size);
+	pgoff_t end_index = DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE);
+	struct decompress_io_ctx *dic;
+	unsigned int i;
+	int ret;
+
+	if (page->index >= end_index)
+		return 0;
+
+	dic = f2fs_alloc_dic(inode, start);
+	if (IS_ERR_OR_NULL(dic))
+		return PTR_ERR_OR_ZERO(dic);
+
+	dic->caller_page = page;
+	for (i = 0; i < cluster_size && start + i < end_index; i++) {
+		struct page *rpage;
+
+		if (start + i == page->index) {
+			dic->rpages[i] = page;
+			continue;
+		}
+
+		rpage = pagecache_get_page(mapping, start + i,
+				FGP_LOCK | FGP_NOWAIT | FGP_CREAT, GFP_NOFS);
+		if (!rpage)
+			continue;
+		if (PageUptodate(rpage)) {
+			f2fs_put_page(rpage, 1);
+			continue;
+		}
+		dic->rpages[i] = rpage;
+	}
+
+	ret = f2fs_alloc_dic_cpages(dic);
+	if (ret)
+		goto out_put;
+
+	f2fs_submit_compressed_read(dic, is_readahead);
+	return 1;
+
+out_put:
+	for (i = 0; i < cluster_size; i++)
+		if (dic->rpages[i] && dic->rpages[i] != page)
+			f2fs_put_page(dic->rpages[i], 1);
+	f2fs_free_dic(dic);
+	return ret;
+}
+
+/* Fill the locked @rpages of a compressed cluster which are not uptodate */
+static int f2fs_read_cluster_sync(struct inode *inode, pgoff_t start,
+						struct page **rpages)
+{
+	struct decompress_io_ctx *dic;
+	unsigned int i;
+	bool need_read = false;
+	int ret;
+
+	dic = f2fs_alloc_dic(inode, start);
+	if (IS_ERR_OR_NULL(dic))
+		return PTR_ERR_OR_ZERO(dic);
+
+	for (i = 0; i < dic->cluster_size; i++) {
+		if (!rpages[i] || PageUptodate(rpages[i]))
+			continue;
+		dic->rpages[i] = rpages[i];
+		need_read = true;
+	}
+	if (!need_read) {
+		ret = 0;
+		goto out;
+	}
+
+	ret = f2fs_alloc_dic_cpages(dic);
+	if (ret)
+		goto out;
+
+	dic->sync = true;
+	init_completion(&dic->done);
+	f2fs_submit_compressed_read(dic, false);
+	wait_for_completion_io(&dic->done);
+	ret = dic->err;
+out:
+	f2fs_free_dic(dic);
+	return ret;
+}
+
+/*
+ * Compress the whole cluster in @rpages, saving at least one block. On
+ * success @cpages gets the pages to write, with the unused ones freed.
+ */
+static int f2fs_compress_pages(struct inode *inode, struct page **rpages,
+				struct page **cpages, unsigned int *nr_cpages)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	const struct f2fs_compress_ops *cops;
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	unsigned int max_cpages = cluster_size - 1;
+	struct compress_data *cdata;
+	void *rbuf = NULL, *cbuf = NULL;
+	size_t clen;
+	unsigned int i;
+	int ret = -ENOMEM;
+
+	if (!f2fs_compress_algorithm_supported(
+				F2FS_I(inode)->i_compress_algorithm))
+		return -EOPNOTSUPP;
+	cops = f2fs_cops[F2FS_I(inode)->i_compress_algorithm];
+
+	for (i = 0; i < max_cpages; i++) {
+		cpages[i] = alloc_page(GFP_NOFS);
+		if (!cpages[i])
+			goto out;
+	}
+
+	rbuf = vmap(rpages, cluster_size, VM_MAP, PAGE_KERNEL);
+	if (!rbuf)
+		goto out;
+	cbuf = vmap(cpages, max_cpages, VM_MAP, PAGE_KERNEL);
+	if (!cbuf)
+		goto out;
+
+	cdata = cbuf;
+	clen = max_cpages * PAGE_SIZE - COMPRESS_HEADER_SIZE;
+	ret = cops->compress(sbi, rbuf, cluster_size << PAGE_SHIFT,
+						cdata->cdata, &clen);
+	if (ret)
+		goto out;
+
+	*nr_cpages = DIV_ROUND_UP(clen + COMPRESS_HEADER_SIZE, PAGE_SIZE);
+	cdata->clen = cpu_to_le32(clen);
+	cdata->chksum = 0;
+	memset(cdata->reserved, 0, sizeof(cdata->reserved));
+	memset(&cdata->cdata[clen], 0,
+		*nr_cpages * PAGE_SIZE - COMPRESS_HEADER_SIZE - clen);
+out:
+	if (cbuf)
+		vunmap(cbuf);
+	if (rbuf)
+		vunmap(rbuf);
+	for (i = ret ? 0 : *nr_cpages; i < max_cpages; i++) {
+		if (cpages[i])
+			__free_page(cpages[i]);
+		cpages[i] = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Set the block address slots of the cluster at @dn for @nr_blocks blocks,
+ * following COMPRESS_ADDR if @compress. Slots kept get NEW_ADDR unless they
+ * already have a block, which the write then replaces.
+ */
+static int f2fs_reshape_cluster(struct dnode_of_data *dn,
+				unsigned int cluster_size,
+				unsigned int nr_blocks, bool compress)
+{
+	struct inode *inode = dn->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int base = dn->ofs_in_node;
+	unsigned int first = compress ? 1 : 0;
+	unsigned int old_cnt = 0, i;
+
+	for (i = 0; i < cluster_size; i++) {
+		block_t blkaddr = datablock_addr(inode, dn->node_page, base + i);
+
+		if (blkaddr == NEW_ADDR || __is_valid_data_blkaddr(blkaddr))
+			old_cnt++;
+	}
+
+	if (nr_blocks > old_cnt) {
+		blkcnt_t want = nr_blocks - old_cnt, count = want;
+		int err;
+
+		err = inc_valid_block_count(sbi, inode, &count);
+		if (err)
+			return err;
+		if (count < want) {
+			dec_valid_block_count(sbi, inode, count);
+			return -ENOSPC;
+		}
+	}
+
+	for (i = 0; i < cluster_size; i++) {
+		block_t blkaddr = datablock_addr(inode, dn->node_page, base + i);
+		block_t new_blkaddr;
+
+		if (compress && i == 0)
+			new_blkaddr = COMPRESS_ADDR;
+		else if (i < first || i >= first + nr_blocks)
+			new_blkaddr = NULL_ADDR;
+		else if (blkaddr == NEW_ADDR || __is_valid_data_blkaddr(blkaddr))
+			continue;
+		else
+			new_blkaddr = NEW_ADDR;
+
+		if (new_blkaddr == blkaddr)
+			continue;
+		if (__is_valid_data_blkaddr(blkaddr))
+			f2fs_invalidate_blocks(sbi, blkaddr);
+		dn->ofs_in_node = base + i;
+		dn->data_blkaddr = new_blkaddr;
+		f2fs_set_data_blkaddr(dn);
+	}
+	dn->ofs_in_node = base;
+
+	if (nr_blocks < old_cnt)
+		dec_valid_block_count(sbi, inode, old_cnt - nr_blocks);
+	return 0;
+}
+
+/* Blocks the cluster at @dn saves, for i_compr_blocks */
+static unsigned int f2fs_cluster_saved_blocks(struct dnode_of_data *dn,
+						unsigned int cluster_size)
+{
+	unsigned int i;
+
+	if (datablock_addr(dn->inode, dn->node_page,
+				dn->ofs_in_node) != COMPRESS_ADDR)
+		return 0;
+
+	for (i = 1; i < cluster_size; i++)
+		if (!__is_valid_data_blkaddr(datablock_addr(dn->inode,
+					dn->node_page, dn->ofs_in_node + i)))
+			break;
+	return cluster_size - (i - 1);
+}
+
+void f2fs_i_compr_blocks_update(struct inode *inode, int diff)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (!diff)
+		return;
+	if (diff < 0 && atomic_read(&fi->i_compr_blocks) < -diff)
+		atomic_set(&fi->i_compr_blocks, 0);
+	else
+		atomic_add(diff, &fi->i_compr_blocks);
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+/*
+ * Write all the locked and uptodate @rpages of the cluster at @start,
+ * compressed into @cpages if @nr_cpages is set, or one block per page.
+ * @page has been cleared dirty by the caller, the other pages are cleared
+ * here; all of them are unlocked on success.
+ */
+static int f2fs_write_cluster(struct inode *inode, struct page *page,
+				pgoff_t start, struct page **rpages,
+				unsigned int nr_pages, struct page **cpages,
+				unsigned int nr_cpages,
+				struct compress_io_ctx *cic,
+				struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	unsigned int nr_blocks = nr_cpages ? nr_cpages : nr_pages;
+	struct f2fs_io_info fio = {
+		.sbi = sbi,
+		.ino = inode->i_ino,
+		.type = DATA,
+		.op = REQ_OP_WRITE,
+		.op_flags = wbc_to_write_flags(wbc),
+		.old_blkaddr = NULL_ADDR,
+		.encrypted_page = NULL,
+		.submitted = false,
+		.need_lock = LOCK_DONE,
+		.io_type = io_type,
+		.io_wbc = wbc,
+	};
+	struct dnode_of_data dn;
+	struct node_info ni;
+	loff_t psize = (loff_t)(start + nr_pages) << PAGE_SHIFT;
+	unsigned int base, first = nr_cpages ? 1 : 0;
+	int saved_before, saved_after, i, err;
+
+	/* Deadlock due to between page->lock and f2fs_lock_op */
+	if (!f2fs_trylock_op(sbi))
+		return -EAGAIN;
+
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	err = f2fs_get_dnode_of_data(&dn, start, LOOKUP_NODE);
+	if (err)
+		goto out_unlock;
+
+	err = f2fs_get_node_info(sbi, dn.nid, &ni);
+	if (err)
+		goto out_put_dnode;
+	fio.version = ni.version;
+
+	saved_before = f2fs_cluster_saved_blocks(&dn, cluster_size);
+	err = f2fs_reshape_cluster(&dn, cluster_size, nr_blocks, nr_cpages);
+	if (err)
+		goto out_put_dnode;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (rpages[i] == page || clear_page_dirty_for_io(rpages[i]))
+			inode_dec_dirty_pages(inode);
+		set_page_writeback(rpages[i]);
+		ClearPageError(rpages[i]);
+	}
+
+	if (nr_cpages) {
+		cic->magic = F2FS_COMPRESSED_PAGE_MAGIC;
+		cic->inode = inode;
+		cic->rpages = (struct page **)(cic + 1);
+		memcpy(cic->rpages, rpages, sizeof(struct page *) * nr_pages);
+		cic->nr_rpages = nr_pages;
+		atomic_set(&cic->pending_pages, nr_cpages);
+		for (i = 0; i < nr_cpages; i++)
+			f2fs_set_compressed_page(cpages[i], cic);
+	}
+
+	base = dn.ofs_in_node;
+	for (i = 0; i < nr_blocks; i++) {
+		dn.ofs_in_node = base + first + i;
+		dn.data_blkaddr = datablock_addr(dn.inode, dn.node_page,
+							dn.ofs_in_node);
+		fio.page = rpages[i];
+		fio.encrypted_page = nr_cpages ? cpages[i] : NULL;
+		fio.old_blkaddr = dn.data_blkaddr;
+		f2fs_outplace_write_data(&dn, &fio);
+	}
+	dn.ofs_in_node = base;
+
+	saved_after = nr_cpages ? cluster_size - nr_cpages : 0;
+	f2fs_i_compr_blocks_update(inode, saved_after - saved_before);
+	if (nr_cpages) {
+		atomic64_add(nr_cpages, &sbi->compr_written_block);
+		atomic64_add(saved_after, &sbi->compr_saved_block);
+	}
+
+	set_inode_flag(inode, FI_APPEND_WRITE);
+	f2fs_put_dnode(&dn);
+	f2fs_unlock_op(sbi);
+
+	down_write(&F2FS_I(inode)->i_sem);
+	if (F2FS_I(inode)->last_disk_size < psize)
+		F2FS_I(inode)->last_disk_size = psize;
+	up_write(&F2FS_I(inode)->i_sem);
+
+	for (i = 0; i < nr_pages; i++)
+		unlock_page(rpages[i]);
+	return 0;
+
+out_put_dnode:
+	f2fs_put_dnode(&dn);
+out_unlock:
+	f2fs_unlock_op(sbi);
+	return err;
+}
+
+void f2fs_compress_write_end_io(struct bio *bio, struct page *page)
+{
+	struct compress_io_ctx *cic =
+			(struct compress_io_ctx *)page_private(page);
+	unsigned int i;
+
+	if (unlikely(bio->bi_error))
+		mapping_set_error(cic->inode->i_mapping, -EIO);
+
+	f2fs_put_compressed_page(page);
+
+	if (!atomic_dec_and_test(&cic->pending_pages))
+		return;
+
+	for (i = 0; i < cic->nr_rpages; i++) {
+		clear_cold_data(cic->rpages[i]);
+		end_page_writeback(cic->rpages[i]);
+	}
+	kfree(cic);
+}
+
+static void f2fs_put_rpages(struct page **rpages, unsigned int nr_pages,
+							struct page *page)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_pages; i++)
+		if (rpages[i] && rpages[i] != page)
+			f2fs_put_page(rpages[i], 1);
+}
+
+/*
+ * Writeback of a page of a compressed file: takes the other pages of its
+ * cluster and writes the cluster compressed if it is complete, as plain
+ * blocks otherwise. Same calling convention as f2fs_write_single_data_page().
+ */
+int f2fs_write_compressed_cluster(struct page *page, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	struct address_space *mapping = page->mapping;
+	struct inode *inode = mapping->host;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t start = round_down(page->index, cluster_size);
+	loff_t i_size = i_size_read(inode);
+	pgoff_t end_index = DIV_ROUND_UP(i_size, PAGE_SIZE);
+	struct page *cpages[1 << MAX_COMPRESS_LOG_SIZE];
+	struct compress_io_ctx *cic = NULL;
+	struct page **rpages;
+	unsigned int nr_pages, nr_cpages = 0, i;
+	bool full = true;
+	int compressed, ret;
+
+	/* leave EOF, shutdown and recovery handling to the plain path */
+	if (page->index >= end_index || f2fs_cp_error(sbi) ||
+			is_sbi_flag_set(sbi, SBI_POR_DOING))
+		return f2fs_write_single_data_page(page, submitted, bio,
+					last_block, wbc, io_type);
+
+	nr_pages = min_t(pgoff_t, cluster_size, end_index - start);
+	rpages = f2fs_kzalloc(sbi, sizeof(struct page *) * cluster_size,
+								GFP_NOFS);
+	if (!rpages) {
+		ret = -ENOMEM;
+		goto redirty_out;
+	}
+
+	/*
+	 * Pages below @page are locked in the other order by writers of the
+	 * cluster holding one of them, so only try those.
+	 */
+	rpages[page->index - start] = page;
+	for (i = 0; i < nr_pages; i++) {
+		pgoff_t index = start + i;
+		struct page *rpage;
+
+		if (rpages[i])
+			continue;
+		rpage = find_get_page(mapping, index);
+		if (!rpage)
+			continue;
+		if (index < page->index) {
+			if (!trylock_page(rpage)) {
+				put_page(rpage);
+				ret = -EAGAIN;
+				goto out_put;
+			}
+		} else {
+			lock_page(rpage);
+		}
+		if (rpage->mapping != mapping) {
+			f2fs_put_page(rpage, 1);
+			continue;
+		}
+		f2fs_wait_on_page_writeback(rpage, DATA, true, true);
+		rpages[i] = rpage;
+	}
+
+	compressed = f2fs_compressed_blocks(inode, start, NULL);
+	if (compressed < 0) {
+		ret = compressed;
+		goto out_put;
+	}
+
+	if (compressed) {
+		/* a compressed cluster can only be rewritten as a whole */
+		for (i = 0; i < nr_pages; i++) {
+			pgoff_t index = start + i;
+
+			if (rpages[i])
+				continue;
+			rpages[i] = pagecache_get_page(mapping, index,
+					FGP_LOCK | FGP_CREAT |
+					(index < page->index ? FGP_NOWAIT : 0),
+					GFP_NOFS);
+			if (!rpages[i]) {
+				ret = index < page->index ? -EAGAIN : -ENOMEM;
+				goto out_put;
+			}
+		}
+		ret = f2fs_read_cluster_sync(inode, start, rpages);
+		if (ret)
+			goto out_put;
+	}
+
+	for (i = 0; i < cluster_size; i++) {
+		if (i >= nr_pages || !rpages[i] || !PageUptodate(rpages[i])) {
+			full = false;
+			continue;
+		}
+		if (start + i == i_size >> PAGE_SHIFT)
+			zero_user_segment(rpages[i], i_size & (PAGE_SIZE - 1),
+								PAGE_SIZE);
+	}
+
+	if (full && !f2fs_compress_pages(inode, rpages, cpages, &nr_cpages)) {
+		cic = kzalloc(sizeof(*cic) + sizeof(struct page *) *
+						cluster_size, GFP_NOFS);
+		if (!cic) {
+			for (i = 0; i < nr_cpages; i++)
+				__free_page(cpages[i]);
+			nr_cpages = 0;
+		}
+	}
+
+	if (!nr_cpages && !compressed) {
+		bool page_submitted = false;
+
+		/* write the dirty pages of the plain cluster one by one */
+		for (i = 0; i < nr_pages; i++) {
+			struct page *rpage = rpages[i];
+			int err;
+
+			if (!rpage)
+				continue;
+			if (rpage != page && !clear_page_dirty_for_io(rpage)) {
+				f2fs_put_page(rpage, 1);
+				continue;
+			}
+			err = f2fs_write_single_data_page(rpage,
+					&page_submitted, bio, last_block,
+					wbc, io_type);
+			if (submitted && page_submitted)
+				*submitted = true;
+			if (rpage == page) {
+				ret = err;
+				continue;
+			}
+			if (err == AOP_WRITEPAGE_ACTIVATE)
+				unlock_page(rpage);
+			put_page(rpage);
+		}
+		kvfree(rpages);
+		return ret;
+	}
+
+	ret = f2fs_write_cluster(inode, page, start, rpages, nr_pages,
+				cpages, nr_cpages, cic, wbc, io_type);
+	if (ret) {
+		for (i = 0; i < nr_cpages; i++)
+			__free_page(cpages[i]);
+		kfree(cic);
+		goto out_put;
+	}
+
+	for (i = 0; i < nr_pages; i++)
+		if (rpages[i] != page)
+			put_page(rpages[i]);
+	kvfree(rpages);
+
+	if (submitted)
+		*submitted = true;
+	if (!F2FS_I(inode)->cp_task)
+		f2fs_balance_fs(sbi, true);
+	return 0;
+
+out_put:
+	f2fs_put_rpages(rpages, cluster_size, page);
+	kvfree(rpages);
+redirty_out:
+	redirty_page_for_writepage(wbc, page);
+	unlock_page(page);
+	return ret;
+}
+
+/*
+ * Truncating into a compressed cluster: have writeback turn what is left of
+ * it into plain blocks, so that the blocks beyond can be freed one by one.
+ */
+int f2fs_truncate_partial_cluster(struct inode *inode, u64 from)
+{
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t free_from = (from + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	pgoff_t start = round_down(free_from, cluster_size);
+	pgoff_t index;
+	int ret;
+
+	if (start == free_from)
+		return 0;
+
+	ret = f2fs_compressed_blocks(inode, start, NULL);
+	if (ret <= 0)
+		return ret;
+
+	for (index = start; index < free_from; index++) {
+		struct page *page = f2fs_get_lock_data_page(inode, index, true);
+
+		if (IS_ERR(page))
+			return PTR_ERR(page);
+		set_page_dirty(page);
+		f2fs_put_page(page, 1);
+	}
+
+	return filemap_write_and_wait_range(inode->i_mapping,
+				(loff_t)start << PAGE_SHIFT,
+				((loff_t)free_from << PAGE_SHIFT) - 1);
+}
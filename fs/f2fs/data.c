@@ -74,6 +74,7 @@ static enum count_type __read_io_type(struct page *page)
 enum bio_post_read_step {
 	STEP_INITIAL = 0,
 	STEP_DECRYPT,
+	STEP_DECOMPRESS,
 };
 
 struct bio_post_read_ctx {
@@ -92,6 +93,12 @@ static void __read_end_io(struct bio *bio)
 	bio_for_each_segment_all(bv, bio, i) {
 		page = bv->bv_page;
 
+		if (f2fs_is_compressed_page(page)) {
+			f2fs_end_read_compressed_page(page,
+					bio->bi_error || PageError(page));
+			continue;
+		}
+
 		/* PG_error was set if any post_read step failed */
 		if (bio->bi_error || PageError(page)) {
 			ClearPageUptodate(page);
@@ -120,6 +127,19 @@ static void decrypt_work(struct work_struct *work)
 	bio_post_read_processing(ctx);
 }
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+static struct workqueue_struct *f2fs_post_read_wq;
+
+/* clusters get decompressed by __read_end_io(), out of bio completion */
+static void decompress_work(struct work_struct *work)
+{
+	struct bio_post_read_ctx *ctx =
+		container_of(work, struct bio_post_read_ctx, work);
+
+	bio_post_read_processing(ctx);
+}
+#endif
+
 static void bio_post_read_processing(struct bio_post_read_ctx *ctx)
 {
 	switch (++ctx->cur_step) {
@@ -131,6 +151,16 @@ static void bio_post_read_processing(struct bio_post_read_ctx *ctx)
 		}
 		ctx->cur_step++;
 		/* fall-through */
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	case STEP_DECOMPRESS:
+		if (ctx->enabled_steps & (1 << STEP_DECOMPRESS)) {
+			INIT_WORK(&ctx->work, decompress_work);
+			queue_work(f2fs_post_read_wq, &ctx->work);
+			return;
+		}
+		ctx->cur_step++;
+		/* fall-through */
+#endif
 	default:
 		__read_end_io(ctx->bio);
 	}
@@ -145,7 +175,8 @@ static void f2fs_read_end_io(struct bio *bio)
 {
 	struct page *first_page = bio->bi_io_vec[0].bv_page;
 
-	if (time_to_inject(F2FS_P_SB(bio->bi_io_vec->bv_page), FAULT_READ_IO)) {
+	if (!f2fs_is_compressed_page(first_page) &&
+			time_to_inject(F2FS_P_SB(first_page), FAULT_READ_IO)) {
 		f2fs_show_injection_info(FAULT_READ_IO);
 		bio->bi_error = -EIO;
 	}
@@ -158,7 +189,7 @@ static void f2fs_read_end_io(struct bio *bio)
 		return;
 	}
 
-	if (first_page != NULL &&
+	if (first_page != NULL && first_page->mapping &&
 		__read_io_type(first_page) == F2FS_RD_DATA) {
 		trace_android_fs_dataread_end(first_page->mapping->host,
 						page_offset(first_page),
@@ -194,6 +225,12 @@ static void f2fs_write_end_io(struct bio *bio)
 			continue;
 		}
 
+		if (f2fs_is_compressed_page(page)) {
+			f2fs_compress_write_end_io(bio, page);
+			dec_page_count(sbi, type);
+			continue;
+		}
+
 		fscrypt_pullback_bio_page(&page, true);
 
 		if (unlikely(bio->bi_error)) {
@@ -330,6 +367,11 @@ static inline void __submit_bio(struct f2fs_sb_info *sbi,
 			set_sbi_flag(sbi, SBI_NEED_CP);
 	}
 submit_io:
+	/* I/O which has to share the device with background discards */
+	if (SM_I(sbi) && SM_I(sbi)->dcc_info &&
+			atomic_read(&SM_I(sbi)->dcc_info->queued_discard))
+		atomic_inc(&SM_I(sbi)->dcc_info->discard_collided);
+
 	if (is_read_io(bio_op(bio)))
 		trace_f2fs_submit_read_bio(sbi->sb, type, bio);
 	else
@@ -343,7 +385,7 @@ static void __f2fs_submit_read_bio(struct f2fs_sb_info *sbi,
 	if (trace_android_fs_dataread_start_enabled() && (type == DATA)) {
 		struct page *first_page = bio->bi_io_vec[0].bv_page;
 
-		if (first_page != NULL &&
+		if (first_page != NULL && first_page->mapping &&
 			__read_io_type(first_page) == F2FS_RD_DATA) {
 			char *path, pathbuf[MAX_TRACE_PATHBUF_LEN];
 
@@ -398,6 +440,8 @@ static bool __has_merged_page(struct bio *bio, struct inode *inode,
 
 		if (bvec->bv_page->mapping)
 			target = bvec->bv_page;
+		else if (f2fs_is_compressed_page(bvec->bv_page))
+			target = f2fs_compress_control_page(bvec->bv_page);
 		else
 			target = fscrypt_control_page(bvec->bv_page);
 
@@ -570,6 +614,28 @@ static void f2fs_submit_ipu_bio(struct f2fs_sb_info *sbi, struct bio **bio,
 	*bio = NULL;
 }
 
+static struct inode *f2fs_hw_crypt_inode(struct page *page)
+{
+	struct inode *inode = page->mapping ? page->mapping->host : NULL;
+
+	return inode && f2fs_hw_encrypted_file(inode) ? inode : NULL;
+}
+
+/*
+ * The inline crypto engine takes a single key per request, keep pages of
+ * files with different keys, or not using it at all, in different bios.
+ */
+static bool f2fs_crypt_mergeable_bio(struct bio *bio, struct page *page)
+{
+	struct inode *inode1 = f2fs_hw_crypt_inode(bio->bi_io_vec[0].bv_page);
+	struct inode *inode2 = f2fs_hw_crypt_inode(page);
+
+	if (!inode1 || !inode2)
+		return inode1 == inode2;
+
+	return fscrypt_is_ice_encryption_info_equal(inode1, inode2);
+}
+
 void f2fs_submit_page_write(struct f2fs_io_info *fio)
 {
 	struct f2fs_sb_info *sbi = fio->sbi;
@@ -604,7 +670,8 @@ next:
 
 	if (io->bio && (io->last_block_in_bio != fio->new_blkaddr - 1 ||
 	    (io->fio.op != fio->op || io->fio.op_flags != fio->op_flags) ||
-			!__same_bdev(sbi, fio->new_blkaddr, io->bio)))
+			!__same_bdev(sbi, fio->new_blkaddr, io->bio) ||
+			!f2fs_crypt_mergeable_bio(io->bio, bio_page)))
 		__submit_merged_bio(io);
 alloc_new:
 	if (io->bio == NULL) {
@@ -643,7 +710,8 @@ out:
 }
 
 static struct bio *f2fs_grab_read_bio(struct inode *inode, block_t blkaddr,
-					unsigned nr_pages, unsigned op_flag)
+					unsigned nr_pages, unsigned op_flag,
+					bool for_compress)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	struct bio *bio;
@@ -657,8 +725,10 @@ static struct bio *f2fs_grab_read_bio(struct inode *inode, block_t blkaddr,
 	bio->bi_end_io = f2fs_read_end_io;
 	bio_set_op_attrs(bio, REQ_OP_READ, op_flag);
 
-	if (f2fs_encrypted_file(inode))
+	if (f2fs_encrypted_file(inode) && !f2fs_hw_encrypted_file(inode))
 		post_read_steps |= 1 << STEP_DECRYPT;
+	if (for_compress)
+		post_read_steps |= 1 << STEP_DECOMPRESS;
 	if (post_read_steps) {
 		ctx = mempool_alloc(bio_post_read_ctx_pool, GFP_NOFS);
 		if (!ctx) {
@@ -680,7 +750,7 @@ static int f2fs_submit_page_read(struct inode *inode, struct page *page,
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	struct bio *bio;
 
-	bio = f2fs_grab_read_bio(inode, blkaddr, 1, 0);
+	bio = f2fs_grab_read_bio(inode, blkaddr, 1, 0, false);
 	if (IS_ERR(bio))
 		return PTR_ERR(bio);
 
@@ -819,6 +889,18 @@ struct page *f2fs_get_read_data_page(struct inode *inode, pgoff_t index,
 	if (!page)
 		return ERR_PTR(-ENOMEM);
 
+	if (f2fs_compressed_file(inode)) {
+		if (PageUptodate(page)) {
+			unlock_page(page);
+			return page;
+		}
+		err = f2fs_read_compressed_cluster(inode, page, false);
+		if (err < 0)
+			goto put_err;
+		if (err)
+			return page;
+	}
+
 	if (f2fs_lookup_extent_cache(inode, index, &ei)) {
 		dn.data_blkaddr = ei.blk + index - ei.fofs;
 		if (!f2fs_is_valid_blkaddr(F2FS_I_SB(inode), dn.data_blkaddr,
@@ -1105,6 +1187,20 @@ void __do_map_lock(struct f2fs_sb_info *sbi, int flag, bool lock)
 	}
 }
 
+/*
+ * Mappings read from dnodes by readers are put in the extent cache while the
+ * dnode is still locked, so that later random reads in the same range don't
+ * need the node pages again.
+ */
+static bool __cache_mapped_extent(struct f2fs_map_blocks *map, int flag)
+{
+	if (flag == F2FS_GET_BLOCK_PRECACHE)
+		return true;
+
+	return !map->m_may_create && (flag == F2FS_GET_BLOCK_DEFAULT ||
+					flag == F2FS_GET_BLOCK_DIO);
+}
+
 /*
  * f2fs_map_blocks() now supported readahead/bmap/rw direct_IO with
  * f2fs_map_blocks structure.
@@ -1295,7 +1391,7 @@ skip:
 	else if (dn.ofs_in_node < end_offset)
 		goto next_block;
 
-	if (flag == F2FS_GET_BLOCK_PRECACHE) {
+	if (__cache_mapped_extent(map, flag)) {
 		if (map->m_flags & F2FS_MAP_MAPPED) {
 			unsigned int ofs = start_pgofs - map->m_lblk;
 
@@ -1320,7 +1416,7 @@ sync_out:
 		f2fs_wait_on_block_writeback_range(inode,
 						map->m_pblk, map->m_len);
 
-	if (flag == F2FS_GET_BLOCK_PRECACHE) {
+	if (__cache_mapped_extent(map, flag)) {
 		if (map->m_flags & F2FS_MAP_MAPPED) {
 			unsigned int ofs = start_pgofs - map->m_lblk;
 
@@ -1328,6 +1424,9 @@ sync_out:
 				start_pgofs, map->m_pblk + ofs,
 				map->m_len - ofs);
 		}
+	}
+
+	if (flag == F2FS_GET_BLOCK_PRECACHE) {
 		if (map->m_next_extent)
 			*map->m_next_extent = pgofs + 1;
 	}
@@ -1530,6 +1629,10 @@ int f2fs_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo,
 	if (ret)
 		return ret;
 
+	/* block mappings of compressed clusters are not file offsets */
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	inode_lock(inode);
 
 	if (fieinfo->fi_flags & FIEMAP_FLAG_XATTR) {
@@ -1684,7 +1787,7 @@ submit_and_realloc:
 	}
 	if (bio == NULL) {
 		bio = f2fs_grab_read_bio(inode, block_nr, nr_pages,
-				is_readahead ? REQ_RAHEAD : 0);
+				is_readahead ? REQ_RAHEAD : 0, false);
 		if (IS_ERR(bio)) {
 			ret = PTR_ERR(bio);
 			bio = NULL;
@@ -1716,6 +1819,59 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+/*
+ * Submit the reads of the compressed pages of @dic. The pages it fills get
+ * unlocked, or the sync caller woken, once the cluster is decompressed.
+ */
+void f2fs_submit_compressed_read(struct decompress_io_ctx *dic,
+							bool is_readahead)
+{
+	struct inode *inode = dic->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct bio *bio = NULL;
+	unsigned int i;
+
+	atomic_set(&dic->pending_pages, dic->nr_cpages);
+
+	for (i = 0; i < dic->nr_cpages; i++) {
+		block_t blkaddr = dic->cblkaddrs[i];
+
+		if (bio && (blkaddr != dic->cblkaddrs[i - 1] + 1 ||
+				!__same_bdev(sbi, blkaddr, bio))) {
+submit_and_realloc:
+			__f2fs_submit_read_bio(sbi, bio, DATA);
+			bio = NULL;
+		}
+		if (!bio) {
+			bio = f2fs_grab_read_bio(inode, blkaddr,
+					dic->nr_cpages - i,
+					is_readahead ? REQ_RAHEAD : 0, true);
+			if (IS_ERR(bio)) {
+				bio = NULL;
+				break;
+			}
+		}
+
+		f2fs_wait_on_block_writeback(inode, blkaddr);
+
+		if (bio_add_page(bio, dic->cpages[i], PAGE_SIZE, 0) < PAGE_SIZE)
+			goto submit_and_realloc;
+
+		inc_page_count(sbi, F2FS_RD_DATA);
+	}
+
+	if (bio)
+		__f2fs_submit_read_bio(sbi, bio, DATA);
+
+	/* fail the pages we could not read, the last one ends the cluster */
+	for (; i < dic->nr_cpages; i++) {
+		inc_page_count(sbi, F2FS_RD_DATA);
+		f2fs_end_read_compressed_page(dic->cpages[i], true);
+	}
+}
+#endif
+
 /*
  * This function was originally taken from fs/mpage.c, and customized for f2fs.
  * Major change was from block_size == page_size in f2fs by default.
@@ -1755,9 +1911,21 @@ static int f2fs_mpage_readpages(struct address_space *mapping,
 				goto next_page;
 		}
 
+		if (f2fs_compressed_file(inode)) {
+			ret = f2fs_read_compressed_cluster(inode, page,
+							is_readahead);
+			if (ret > 0) {
+				ret = 0;
+				goto next_page;
+			}
+			if (ret)
+				goto set_error_page;
+		}
+
 		ret = f2fs_read_single_page(inode, page, nr_pages, &map, &bio,
 					&last_block_in_bio, is_readahead);
 		if (ret) {
+set_error_page:
 			SetPageError(page);
 			zero_user_segment(page, 0, PAGE_SIZE);
 			unlock_page(page);
@@ -1810,7 +1978,7 @@ static int encrypt_one_page(struct f2fs_io_info *fio)
 	struct page *mpage;
 	gfp_t gfp_flags = GFP_NOFS;
 
-	if (!f2fs_encrypted_file(inode))
+	if (!f2fs_encrypted_file(inode) || f2fs_hw_encrypted_file(inode))
 		return 0;
 
 	/* wait for GCed page writeback via META_MAPPING */
@@ -1989,7 +2157,7 @@ got_it:
 			f2fs_unlock_op(fio->sbi);
 		err = f2fs_inplace_write_data(fio);
 		if (err) {
-			if (f2fs_encrypted_file(inode))
+			if (fio->encrypted_page)
 				fscrypt_pullback_bio_page(&fio->encrypted_page,
 									true);
 			if (PageWriteback(page))
@@ -2036,7 +2204,7 @@ out:
 	return err;
 }
 
-static int __write_data_page(struct page *page, bool *submitted,
+int f2fs_write_single_data_page(struct page *page, bool *submitted,
 				struct bio **bio,
 				sector_t *last_block,
 				struct writeback_control *wbc,
@@ -2197,7 +2365,16 @@ redirty_out:
 static int f2fs_write_data_page(struct page *page,
 					struct writeback_control *wbc)
 {
-	return __write_data_page(page, NULL, NULL, NULL, wbc, FS_DATA_IO);
+	struct inode *inode = page->mapping->host;
+
+	/* a compressed cluster is written as a whole from writepages */
+	if (f2fs_compressed_file(inode)) {
+		redirty_page_for_writepage(wbc, page);
+		return AOP_WRITEPAGE_ACTIVATE;
+	}
+
+	return f2fs_write_single_data_page(page, NULL, NULL, NULL, wbc,
+								FS_DATA_IO);
 }
 
 /*
@@ -2303,8 +2480,14 @@ continue_unlock:
 			if (!clear_page_dirty_for_io(page))
 				goto continue_unlock;
 
-			ret = __write_data_page(page, &submitted, &bio,
-					&last_block, wbc, io_type);
+			if (f2fs_compressed_file(mapping->host))
+				ret = f2fs_write_compressed_cluster(page,
+						&submitted, &bio, &last_block,
+						wbc, io_type);
+			else
+				ret = f2fs_write_single_data_page(page,
+						&submitted, &bio, &last_block,
+						wbc, io_type);
 			if (unlikely(ret)) {
 				/*
 				 * keep nr_to_write, since vfs uses this to
@@ -2644,6 +2827,24 @@ repeat:
 		return 0;
 	}
 
+	if (f2fs_compressed_file(inode)) {
+		err = f2fs_read_compressed_cluster(inode, page, false);
+		if (err < 0)
+			goto fail;
+		if (err) {
+			lock_page(page);
+			if (unlikely(page->mapping != mapping)) {
+				f2fs_put_page(page, 1);
+				goto repeat;
+			}
+			if (unlikely(!PageUptodate(page))) {
+				err = -EIO;
+				goto fail;
+			}
+			return 0;
+		}
+	}
+
 	if (blkaddr == NEW_ADDR) {
 		zero_user_segment(page, 0, PAGE_SIZE);
 		SetPageUptodate(page);
@@ -2959,7 +3160,7 @@ static sector_t f2fs_bmap(struct address_space *mapping, sector_t block)
 {
 	struct inode *inode = mapping->host;
 
-	if (f2fs_has_inline_data(inode))
+	if (f2fs_has_inline_data(inode) || f2fs_compressed_file(inode))
 		return 0;
 
 	/* make sure allocating whole blocks */
@@ -3104,7 +3305,7 @@ static int f2fs_swap_activate(struct swap_info_struct *sis, struct file *file,
 	struct inode *inode = file_inode(file);
 	int ret;
 
-	if (!S_ISREG(inode->i_mode))
+	if (!S_ISREG(inode->i_mode) || f2fs_compressed_file(inode))
 		return -EINVAL;
 
 	if (f2fs_readonly(F2FS_I_SB(inode)->sb))
@@ -3182,8 +3383,18 @@ int __init f2fs_init_post_read_processing(void)
 					 bio_post_read_ctx_cache);
 	if (!bio_post_read_ctx_pool)
 		goto fail_free_cache;
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	f2fs_post_read_wq = alloc_workqueue("f2fs_post_read",
+					WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!f2fs_post_read_wq)
+		goto fail_free_pool;
+#endif
 	return 0;
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+fail_free_pool:
+	mempool_destroy(bio_post_read_ctx_pool);
+#endif
 fail_free_cache:
 	kmem_cache_destroy(bio_post_read_ctx_cache);
 fail:
@@ -3192,6 +3403,9 @@ fail:
 
 void __exit f2fs_destroy_post_read_processing(void)
 {
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	destroy_workqueue(f2fs_post_read_wq);
+#endif
 	mempool_destroy(bio_post_read_ctx_pool);
 	kmem_cache_destroy(bio_post_read_ctx_cache);
 }
@@ -83,6 +83,14 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 		si->nr_discard_cmd =
 			atomic_read(&SM_I(sbi)->dcc_info->discard_cmd_cnt);
 		si->undiscard_blks = SM_I(sbi)->dcc_info->undiscard_blks;
+		si->nr_discard_interrupted =
+			atomic_read(&SM_I(sbi)->dcc_info->discard_interrupted);
+		si->nr_discard_collided =
+			atomic_read(&SM_I(sbi)->dcc_info->discard_collided);
+		si->discard_avg_lat = !SM_I(sbi)->dcc_info->discard_lat_cnt ? 0 :
+			div_u64(SM_I(sbi)->dcc_info->discard_lat_total,
+				SM_I(sbi)->dcc_info->discard_lat_cnt);
+		si->discard_max_lat = SM_I(sbi)->dcc_info->discard_lat_max;
 	}
 	si->total_count = (int)sbi->user_block_count / sbi->blocks_per_seg;
 	si->rsvd_segs = reserved_segments(sbi);
@@ -94,6 +102,10 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->inline_xattr = atomic_read(&sbi->inline_xattr);
 	si->inline_inode = atomic_read(&sbi->inline_inode);
 	si->inline_dir = atomic_read(&sbi->inline_dir);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	si->compr_inode = atomic_read(&sbi->compr_inode);
+	si->compr_saved_block = atomic64_read(&sbi->compr_saved_block);
+#endif
 	si->append = sbi->im[APPEND_INO].ino_num;
 	si->update = sbi->im[UPDATE_INO].ino_num;
 	si->orphans = sbi->im[ORPHAN_INO].ino_num;
@@ -117,6 +129,22 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->bg_gc = sbi->bg_gc;
 	si->io_skip_bggc = sbi->io_skip_bggc;
 	si->other_skip_bggc = sbi->other_skip_bggc;
+	if (DIRTY_I(sbi)->vindex) {
+		struct victim_index *vi = DIRTY_I(sbi)->vindex;
+
+		spin_lock(&vi->lock);
+		si->victim_lookups = vi->lookups;
+		si->victim_scanned = vi->scanned;
+		si->victim_vblocks = vi->vblocks;
+		spin_unlock(&vi->lock);
+	}
+	if (sbi->gc_thread) {
+		struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+		si->gc_prefetch_secs = atomic64_read(&gc_th->prefetch_sections);
+		si->gc_prefetch_time = atomic64_read(&gc_th->prefetch_time);
+		si->gc_prefetch_active = READ_ONCE(gc_th->prefetch_active);
+	}
 	si->skipped_atomic_files[BG_GC] = sbi->skipped_atomic_files[BG_GC];
 	si->skipped_atomic_files[FG_GC] = sbi->skipped_atomic_files[FG_GC];
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
@@ -315,6 +343,8 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->inline_inode);
 		seq_printf(s, "  - Inline_dentry Inode: %u\n",
 			   si->inline_dir);
+		seq_printf(s, "  - Compressed Inode: %u, Saved Blocks: %llu\n",
+			   si->compr_inode, si->compr_saved_block);
 		seq_printf(s, "  - Orphan/Append/Update Inode: %u, %u, %u\n",
 			   si->orphans, si->append, si->update);
 		seq_printf(s, "\nMain area: %d segs, %d secs %d zones\n",
@@ -377,6 +407,18 @@ static int stat_show(struct seq_file *s, void *v)
 				si->skipped_atomic_files[BG_GC]);
 		seq_printf(s, "BG skip : IO: %u, Other: %u\n",
 				si->io_skip_bggc, si->other_skip_bggc);
+		seq_printf(s, "Victim index : lookups %llu, scanned/lookup %llu, "
+			   "valid blocks/victim %llu of %u\n", si->victim_lookups,
+			   si->victim_lookups ? div64_u64(si->victim_scanned,
+							si->victim_lookups) : 0,
+			   si->victim_lookups ? div64_u64(si->victim_vblocks,
+							si->victim_lookups) : 0,
+			   BLKS_PER_SEC(si->sbi));
+		seq_printf(s, "Rapid GC prefetch : sections %llu, ms/section %llu, "
+			   "workers %u\n", si->gc_prefetch_secs,
+			   si->gc_prefetch_secs ? div64_u64(si->gc_prefetch_time,
+						si->gc_prefetch_secs) : 0,
+			   si->gc_prefetch_active);
 		seq_puts(s, "\nExtent Cache:\n");
 		seq_printf(s, "  - Hit Count: L1-1:%llu L1-2:%llu L2:%llu\n",
 				si->hit_largest, si->hit_cached,
@@ -385,8 +427,12 @@ static int stat_show(struct seq_file *s, void *v)
 				!si->total_ext ? 0 :
 				div64_u64(si->hit_total * 100, si->total_ext),
 				si->hit_total, si->total_ext);
-		seq_printf(s, "  - Inner Struct Count: tree: %d(%d), node: %d\n",
-				si->ext_tree, si->zombie_tree, si->ext_node);
+		seq_printf(s, "  - Miss Count: %llu\n",
+				si->total_ext - si->hit_total);
+		seq_printf(s, "  - Inner Struct Count: tree: %d(%d), node: %d "
+				"(Max. %u)\n",
+				si->ext_tree, si->zombie_tree, si->ext_node,
+				si->sbi->max_extent_node);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - DIO (R: %4d, W: %4d)\n",
 			   si->nr_dio_read, si->nr_dio_write);
@@ -399,6 +445,10 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->flush_list_empty,
 			   si->nr_discarding, si->nr_discarded,
 			   si->nr_discard_cmd, si->undiscard_blks);
+		seq_printf(s, "  - Discard impact: interrupted: %4d, "
+			"collided IOs: %4d, lat (us): avg %u max %u\n",
+			   si->nr_discard_interrupted, si->nr_discard_collided,
+			   si->discard_avg_lat, si->discard_max_lat);
 		seq_printf(s, "  - inmem: %4d, atomic IO: %4d (Max. %4d), "
 			"volatile IO: %4d (Max. %4d)\n",
 			   si->inmem_pages, si->aw_cnt, si->max_aw_cnt,
@@ -102,6 +102,7 @@ extern const char *f2fs_fault_name[FAULT_MAX];
 #define F2FS_MOUNT_INLINE_XATTR_SIZE	0x00800000
 #define F2FS_MOUNT_RESERVE_ROOT		0x01000000
 #define F2FS_MOUNT_DISABLE_CHECKPOINT	0x02000000
+#define F2FS_MOUNT_MERGE_CHECKPOINT	0x04000000
 
 #define F2FS_OPTION(sbi)	((sbi)->mount_opt)
 #define clear_opt(sbi, option)	(F2FS_OPTION(sbi).opt &= ~F2FS_MOUNT_##option)
@@ -142,6 +143,10 @@ struct f2fs_mount_info {
 	block_t unusable_cap;		/* Amount of space allowed to be
 					 * unusable when disabling checkpoint
 					 */
+
+	/* For compression */
+	unsigned char compress_algorithm;	/* algorithm type */
+	unsigned char compress_log_size;	/* cluster log size */
 };
 
 #define F2FS_FEATURE_ENCRYPT		0x0001
@@ -156,6 +161,8 @@ struct f2fs_mount_info {
 #define F2FS_FEATURE_LOST_FOUND		0x0200
 #define F2FS_FEATURE_VERITY		0x0400	/* reserved */
 #define F2FS_FEATURE_SB_CHKSUM		0x0800
+#define F2FS_FEATURE_CASEFOLD		0x1000	/* reserved */
+#define F2FS_FEATURE_COMPRESSION	0x2000
 
 #define __F2FS_HAS_FEATURE(raw_super, mask)				\
 	((raw_super->feature & cpu_to_le32(mask)) != 0)
@@ -255,6 +262,9 @@ enum {
 #define DEF_MAX_DISCARD_ISSUE_TIME	60000	/* 60 s, if no candidates */
 #define DEF_DISCARD_URGENT_UTIL		80	/* do more discard over 80% */
 #define DEF_MAX_DISCARD_URGENT_ISSUE_TIME	10000	/* 10 s, if no candidates on high utilization */
+#define DEF_DISCARD_SCALE_SEGS		64	/* issue more per round for every 64 undiscarded segments */
+#define DEF_MAX_DISCARD_SCALE		8	/* up to 8 times the requests per round */
+#define DEF_MAX_DISCARD_BACKOFF		4	/* wait up to 16 times longer if I/O keeps coming */
 #define DEF_CP_INTERVAL			3000	/* 30 secs */
 #define DEF_IDLE_INTERVAL		5	/* 5 secs */
 #define DEF_DISABLE_INTERVAL		5	/* 5 secs */
@@ -363,6 +373,8 @@ struct discard_cmd {
 	unsigned char state;		/* state */
 	unsigned char queued;		/* queued discard */
 	int error;			/* bio error */
+	ktime_t submit_time;		/* time the first bio got submitted */
+	unsigned int lat;		/* submission to completion, in us */
 	spinlock_t lock;		/* for state/bio_ref updating */
 	unsigned short bio_ref;		/* bio reference count */
 };
@@ -408,6 +420,13 @@ struct discard_cmd_control {
 	atomic_t discard_cmd_cnt;		/* # of cached cmd count */
 	struct rb_root root;			/* root of discard rb-tree */
 	bool rbtree_check;			/* config for consistence check */
+	unsigned long disk_busy_stamp;		/* last time others used the disk */
+	unsigned int backoff;			/* # of rounds in a row cut by I/O */
+	atomic_t discard_interrupted;		/* # of rounds cut by I/O */
+	atomic_t discard_collided;		/* # of bios issued over discards */
+	unsigned long long discard_lat_total;	/* total discard latency, in us */
+	unsigned int discard_lat_max;		/* max. discard latency, in us */
+	unsigned int discard_lat_cnt;		/* # of discards in the total */
 };
 
 /* for the list of fsync inodes, used only during recovery */
@@ -481,6 +500,7 @@ static inline bool __has_cursum_space(struct f2fs_journal *journal,
 #define F2FS_IOC_GET_PIN_FILE		_IOR(F2FS_IOCTL_MAGIC, 14, __u32)
 #define F2FS_IOC_PRECACHE_EXTENTS	_IO(F2FS_IOCTL_MAGIC, 15)
 #define F2FS_IOC_RESIZE_FS		_IOW(F2FS_IOCTL_MAGIC, 16, __u64)
+#define F2FS_IOC_GET_COMPRESS_BLOCKS	_IOR(F2FS_IOCTL_MAGIC, 17, __u64)
 
 #define F2FS_IOC_SET_ENCRYPTION_POLICY	FS_IOC_SET_ENCRYPTION_POLICY
 #define F2FS_IOC_GET_ENCRYPTION_POLICY	FS_IOC_GET_ENCRYPTION_POLICY
@@ -620,6 +640,9 @@ enum {
 /* number of extent info in extent cache we try to shrink */
 #define EXTENT_CACHE_SHRINK_NUMBER	128
 
+/* files up to this many blocks get their extents precached at open */
+#define DEF_PRECACHE_EXTENT_BLOCKS	1024
+
 struct rb_entry {
 	struct rb_node rb_node;		/* rb node located in rb-tree */
 	unsigned int ofs;		/* start offset of the entry */
@@ -767,6 +790,12 @@ struct f2fs_inode_info {
 	int i_inline_xattr_size;	/* inline xattr size */
 	struct timespec i_crtime;	/* inode creation time */
 	struct timespec i_disk_time[4];	/* inode disk times */
+
+	/* for file compress */
+	atomic_t i_compr_blocks;		/* # of blocks saved by compression */
+	unsigned char i_compress_algorithm;	/* algorithm type */
+	unsigned char i_log_cluster_size;	/* log of cluster size */
+	unsigned int i_cluster_size;		/* cluster size */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
@@ -963,6 +992,27 @@ struct flush_cmd_control {
 	struct llist_node *dispatch_list;	/* list for command dispatch */
 };
 
+/* for the checkpoint merge thread */
+struct ckpt_req {
+	struct completion wait;		/* completion for checkpoint done */
+	struct llist_node llnode;	/* llist_node to be linked in wait queue */
+	int ret;			/* return code of checkpoint */
+	ktime_t queue_time;		/* request queued time */
+};
+
+struct ckpt_req_control {
+	struct task_struct *f2fs_issue_ckpt;	/* checkpoint task */
+	wait_queue_head_t ckpt_wait_queue;	/* waiting queue for wake-up */
+	atomic_t issued_ckpt;		/* # of actually issued ckpts */
+	atomic_t total_ckpt;		/* # of total ckpt requests */
+	atomic_t queued_ckpt;		/* # of queued ckpt requests */
+	struct llist_head issue_list;	/* list for command issue */
+	spinlock_t stat_lock;		/* lock for below wait time stats */
+	unsigned int cur_time;		/* avg wait in msec of the last ckpt */
+	unsigned int peak_time;		/* peak wait in msec until now */
+	unsigned long long total_time;	/* total wait in msec until now */
+};
+
 struct f2fs_sm_info {
 	struct sit_info *sit_info;		/* whole segment information */
 	struct free_segmap_info *free_info;	/* free segment information */
@@ -1260,6 +1310,7 @@ struct f2fs_sb_info {
 	struct rw_semaphore node_write;		/* locking node writes */
 	struct rw_semaphore node_change;	/* locking node change */
 	wait_queue_head_t cp_wait;
+	struct ckpt_req_control cprc_info;	/* for checkpoint merge */
 	unsigned long last_time[MAX_TIME];	/* to store time in jiffies */
 	long interval_time[MAX_TIME];		/* to store thresholds */
 
@@ -1287,6 +1338,8 @@ struct f2fs_sb_info {
 	struct list_head zombie_list;		/* extent zombie tree list */
 	atomic_t total_zombie_tree;		/* extent zombie tree count */
 	atomic_t total_ext_node;		/* extent info count */
+	unsigned int max_extent_node;		/* extent node budget, 0: by ram_thresh */
+	unsigned int precache_extent_blocks;	/* precache small files at open */
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
@@ -1349,6 +1402,10 @@ struct f2fs_sb_info {
 
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
+	unsigned int gc_prefetch_workers;	/* prefetch ahead of rapid GC */
+	unsigned int gc_prefetch_latency;	/* ms per section to back off */
+	/* pick LFS victims from the victim index instead of searching */
+	unsigned int gc_victim_index;
 	/* migration granularity of garbage collection, unit: segment */
 	unsigned int migration_granularity;
 
@@ -1385,6 +1442,15 @@ struct f2fs_sb_info {
 	unsigned long long write_iostat[NR_IO_TYPE];
 	bool iostat_enable;
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	/* For compression statistics, since mount */
+	atomic64_t compr_written_block;		/* # of compressed blocks written */
+	atomic64_t compr_saved_block;		/* # of blocks saved by writes */
+	atomic64_t decompr_clusters;		/* # of clusters decompressed */
+	atomic64_t decompr_time;		/* time spent decompressing, in ns */
+	atomic_t compr_inode;			/* # of compressed inodes in memory */
+#endif
+
 	/* For sysfs suppport */
 	struct kobject s_kobj;
 	struct completion s_kobj_unregister;
@@ -2417,6 +2483,7 @@ static inline void f2fs_change_bit(unsigned int nr, char *addr)
 /*
  * On-disk inode flags (f2fs_inode::i_flags)
  */
+#define F2FS_COMPR_FL			0x00000004 /* Compress file */
 #define F2FS_SYNC_FL			0x00000008 /* Synchronous updates */
 #define F2FS_IMMUTABLE_FL		0x00000010 /* Immutable file */
 #define F2FS_APPEND_FL			0x00000020 /* writes to file may only append */
@@ -2478,6 +2545,8 @@ enum {
 	FI_PROJ_INHERIT,	/* indicate file inherits projectid */
 	FI_PIN_FILE,		/* indicate file should not be gced */
 	FI_ATOMIC_REVOKE_REQUEST, /* request to drop atomic data */
+	FI_COMPRESSED_FILE,	/* indicate file's data can be compressed */
+	FI_EXTENT_PRECACHED,	/* extents were precached at open */
 };
 
 static inline void __mark_inode_dirty_flag(struct inode *inode,
@@ -2649,12 +2718,18 @@ static inline unsigned int addrs_per_inode(struct inode *inode)
 {
 	unsigned int addrs = CUR_ADDRS_PER_INODE(inode) -
 				get_inline_xattr_addrs(inode);
-	return ALIGN_DOWN(addrs, 1);
+
+	if (!is_inode_flag_set(inode, FI_COMPRESSED_FILE))
+		return addrs;
+	/* keep clusters from straddling node blocks */
+	return ALIGN_DOWN(addrs, F2FS_I(inode)->i_cluster_size);
 }
 
 static inline unsigned int addrs_per_block(struct inode *inode)
 {
-	return ALIGN_DOWN(DEF_ADDRS_PER_BLOCK, 1);
+	if (!is_inode_flag_set(inode, FI_COMPRESSED_FILE))
+		return DEF_ADDRS_PER_BLOCK;
+	return ALIGN_DOWN(DEF_ADDRS_PER_BLOCK, F2FS_I(inode)->i_cluster_size);
 }
 
 static inline void *inline_xattr_addr(struct inode *inode, struct page *page)
@@ -2817,6 +2892,10 @@ static inline bool f2fs_may_extent_tree(struct inode *inode)
 	if (list_empty(&sbi->s_list))
 		return false;
 
+	/* a compressed cluster has no block for most of its pages */
+	if (F2FS_I(inode)->i_flags & F2FS_COMPR_FL)
+		return false;
+
 	return S_ISREG(inode->i_mode);
 }
 
@@ -2947,7 +3026,8 @@ static inline void verify_blkaddr(struct f2fs_sb_info *sbi,
 
 static inline bool __is_valid_data_blkaddr(block_t blkaddr)
 {
-	if (blkaddr == NEW_ADDR || blkaddr == NULL_ADDR)
+	if (blkaddr == NEW_ADDR || blkaddr == NULL_ADDR ||
+			blkaddr == COMPRESS_ADDR)
 		return false;
 	return true;
 }
@@ -3237,6 +3317,10 @@ int f2fs_sync_dirty_inodes(struct f2fs_sb_info *sbi, enum inode_type type);
 void f2fs_wait_on_all_pages_writeback(struct f2fs_sb_info *sbi);
 int f2fs_write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc);
 void f2fs_init_ino_entry_info(struct f2fs_sb_info *sbi);
+int f2fs_issue_checkpoint(struct f2fs_sb_info *sbi);
+int f2fs_start_ckpt_thread(struct f2fs_sb_info *sbi);
+void f2fs_stop_ckpt_thread(struct f2fs_sb_info *sbi);
+void f2fs_init_ckpt_req_control(struct f2fs_sb_info *sbi);
 int __init f2fs_create_checkpoint_caches(void);
 void f2fs_destroy_checkpoint_caches(void);
 
@@ -3259,6 +3343,10 @@ int f2fs_target_device_index(struct f2fs_sb_info *sbi, block_t blkaddr);
 void f2fs_set_data_blkaddr(struct dnode_of_data *dn);
 void f2fs_update_data_blkaddr(struct dnode_of_data *dn, block_t blkaddr);
 int f2fs_reserve_new_blocks(struct dnode_of_data *dn, blkcnt_t count);
+int f2fs_write_single_data_page(struct page *page, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type);
 int f2fs_reserve_new_block(struct dnode_of_data *dn);
 int f2fs_get_block(struct dnode_of_data *dn, pgoff_t index);
 int f2fs_preallocate_blocks(struct kiocb *iocb, struct iov_iter *from);
@@ -3333,11 +3421,18 @@ struct f2fs_stat_info {
 	int nr_rd_data, nr_rd_node, nr_rd_meta;
 	int nr_dio_read, nr_dio_write;
 	unsigned int io_skip_bggc, other_skip_bggc;
+	unsigned long long victim_lookups, victim_scanned, victim_vblocks;
+	unsigned long long gc_prefetch_secs, gc_prefetch_time;
+	unsigned int gc_prefetch_active;
 	int nr_flushing, nr_flushed, flush_list_empty;
 	int nr_discarding, nr_discarded;
 	int nr_discard_cmd;
 	unsigned int undiscard_blks;
+	int nr_discard_interrupted, nr_discard_collided;
+	unsigned int discard_avg_lat, discard_max_lat;
 	int inline_xattr, inline_inode, inline_dir, append, update, orphans;
+	int compr_inode;
+	unsigned long long compr_saved_block;
 	int aw_cnt, max_aw_cnt, vw_cnt, max_vw_cnt;
 	unsigned int valid_count, valid_node_count, valid_inode_count, discard_blks;
 	unsigned int bimodal, avg_vblocks;
@@ -3625,6 +3720,17 @@ static inline bool f2fs_encrypted_file(struct inode *inode)
 	return f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode);
 }
 
+/*
+ * Contents of such files are encrypted by the inline crypto engine as the
+ * bios reach the disk, with the disk address as IV, so their pages go to the
+ * disk as they are and must not be moved around without the page cache.
+ */
+static inline bool f2fs_hw_encrypted_file(struct inode *inode)
+{
+	return f2fs_encrypted_file(inode) &&
+		fscrypt_using_hardware_encryption(inode);
+}
+
 static inline void f2fs_set_encrypted_inode(struct inode *inode)
 {
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
@@ -3633,13 +3739,143 @@ static inline void f2fs_set_encrypted_inode(struct inode *inode)
 #endif
 }
 
+/*
+ * compression support
+ */
+enum compress_algorithm_type {
+	COMPRESS_LZO,		/* reserved, not supported */
+	COMPRESS_LZ4,
+	COMPRESS_ZSTD,
+	COMPRESS_MAX,
+};
+
+#define MIN_COMPRESS_LOG_SIZE		2
+#define MAX_COMPRESS_LOG_SIZE		8
+#define F2FS_COMPRESSED_PAGE_MAGIC	0xF5F2C000
+
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+/* for reading one compressed cluster, see f2fs_read_compressed_cluster() */
+struct decompress_io_ctx {
+	u32 magic;			/* magic number to indicate page is compressed */
+	struct inode *inode;		/* inode the context belong to */
+	pgoff_t cluster_idx;		/* index of the first page in cluster */
+	unsigned int cluster_size;	/* page count in cluster */
+	struct page **rpages;		/* pages to fill, NULL if not wanted */
+	struct page *caller_page;	/* rpage the caller holds a reference to */
+	struct page **cpages;		/* pages storing compressed data */
+	block_t *cblkaddrs;		/* block address of each cpage */
+	unsigned int nr_cpages;		/* compressed page count */
+	atomic_t pending_pages;		/* in-flight compressed page count */
+	bool failed;			/* some compressed pages failed to read */
+	bool sync;			/* rpages stay locked, caller waits on done */
+	int err;			/* result for a sync caller */
+	struct completion done;		/* for a sync caller */
+};
+
+static inline bool f2fs_compressed_file(struct inode *inode)
+{
+	return S_ISREG(inode->i_mode) &&
+		is_inode_flag_set(inode, FI_COMPRESSED_FILE);
+}
+
+#define stat_inc_compr_inode(inode)					\
+	(atomic_inc(&F2FS_I_SB(inode)->compr_inode))
+#define stat_dec_compr_inode(inode)					\
+	(atomic_dec(&F2FS_I_SB(inode)->compr_inode))
+
+bool f2fs_is_compressed_page(struct page *page);
+bool f2fs_compress_algorithm_supported(unsigned char algorithm);
+bool f2fs_may_compress(struct inode *inode);
+void f2fs_set_compress_context(struct inode *inode);
+void f2fs_clear_compress_context(struct inode *inode);
+int f2fs_read_compressed_cluster(struct inode *inode, struct page *page,
+							bool is_readahead);
+void f2fs_end_read_compressed_page(struct page *page, bool failed);
+int f2fs_write_compressed_cluster(struct page *page, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type);
+struct page *f2fs_compress_control_page(struct page *page);
+void f2fs_compress_write_end_io(struct bio *bio, struct page *page);
+void f2fs_i_compr_blocks_update(struct inode *inode, int diff);
+int f2fs_truncate_partial_cluster(struct inode *inode, u64 from);
+void f2fs_submit_compressed_read(struct decompress_io_ctx *dic,
+							bool is_readahead);
+#else
+static inline bool f2fs_compressed_file(struct inode *inode)
+{
+	return false;
+}
+
+#define stat_inc_compr_inode(inode)			do { } while (0)
+#define stat_dec_compr_inode(inode)			do { } while (0)
+
+static inline bool f2fs_is_compressed_page(struct page *page)
+{
+	return false;
+}
+
+static inline bool f2fs_compress_algorithm_supported(unsigned char algorithm)
+{
+	return false;
+}
+
+static inline bool f2fs_may_compress(struct inode *inode)
+{
+	return false;
+}
+
+static inline void f2fs_set_compress_context(struct inode *inode) { }
+static inline void f2fs_clear_compress_context(struct inode *inode) { }
+
+static inline int f2fs_read_compressed_cluster(struct inode *inode,
+					struct page *page, bool is_readahead)
+{
+	return 0;
+}
+
+static inline void f2fs_end_read_compressed_page(struct page *page,
+							bool failed)
+{
+	WARN_ON_ONCE(1);
+}
+
+static inline int f2fs_write_compressed_cluster(struct page *page,
+				bool *submitted, struct bio **bio,
+				sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline struct page *f2fs_compress_control_page(struct page *page)
+{
+	WARN_ON_ONCE(1);
+	return ERR_PTR(-EINVAL);
+}
+
+static inline void f2fs_compress_write_end_io(struct bio *bio,
+							struct page *page)
+{
+	WARN_ON_ONCE(1);
+}
+
+static inline void f2fs_i_compr_blocks_update(struct inode *inode, int diff) { }
+
+static inline int f2fs_truncate_partial_cluster(struct inode *inode, u64 from)
+{
+	return 0;
+}
+#endif
+
 /*
  * Returns true if the reads of the inode's data need to undergo some
  * postprocessing step, like decryption or authenticity verification.
  */
 static inline bool f2fs_post_read_required(struct inode *inode)
 {
-	return f2fs_encrypted_file(inode);
+	return f2fs_encrypted_file(inode) || f2fs_compressed_file(inode);
 }
 
 #define F2FS_FEATURE_FUNCS(name, flagname) \
@@ -3658,6 +3894,7 @@ F2FS_FEATURE_FUNCS(quota_ino, QUOTA_INO);
 F2FS_FEATURE_FUNCS(inode_crtime, INODE_CRTIME);
 F2FS_FEATURE_FUNCS(lost_found, LOST_FOUND);
 F2FS_FEATURE_FUNCS(sb_chksum, SB_CHKSUM);
+F2FS_FEATURE_FUNCS(compression, COMPRESSION);
 
 #ifdef CONFIG_BLK_DEV_ZONED
 static inline bool f2fs_blkz_is_seq(struct f2fs_sb_info *sbi, int devi,
@@ -3770,7 +4007,7 @@ static inline bool f2fs_force_buffered_io(struct inode *inode,
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	int rw = iov_iter_rw(iter);
 
-	if (f2fs_post_read_required(inode))
+	if (f2fs_post_read_required(inode) && !f2fs_hw_encrypted_file(inode))
 		return true;
 	if (f2fs_is_multi_device(sbi))
 		return true;
@@ -468,6 +468,10 @@ static loff_t f2fs_llseek(struct file *file, loff_t offset, int whence)
 	case SEEK_HOLE:
 		if (offset < 0)
 			return -ENXIO;
+		/* extents of compressed clusters don't match file offsets */
+		if (f2fs_compressed_file(inode))
+			return generic_file_llseek_size(file, offset, whence,
+						maxbytes, i_size_read(inode));
 		return f2fs_seek_block(file, offset, whence);
 	}
 
@@ -501,7 +505,25 @@ static int f2fs_file_open(struct inode *inode, struct file *filp)
 
 	filp->f_mode |= FMODE_NOWAIT;
 
-	return dquot_file_open(inode, filp);
+	err = dquot_file_open(inode, filp);
+	if (err)
+		return err;
+
+	/*
+	 * Small files are cheap to map in full, and are then read without
+	 * any node page lookup for as long as their extents stay cached.
+	 */
+	if (S_ISREG(inode->i_mode) && (filp->f_mode & FMODE_READ) &&
+			f2fs_may_extent_tree(inode) &&
+			!f2fs_has_inline_data(inode) &&
+			!is_inode_flag_set(inode, FI_EXTENT_PRECACHED) &&
+			inode->i_blocks >> (F2FS_BLKSIZE_BITS - 9) <=
+				F2FS_I_SB(inode)->precache_extent_blocks) {
+		set_inode_flag(inode, FI_EXTENT_PRECACHED);
+		f2fs_precache_extents(inode);
+	}
+
+	return 0;
 }
 
 void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
@@ -509,6 +531,7 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 	struct f2fs_sb_info *sbi = F2FS_I_SB(dn->inode);
 	struct f2fs_node *raw_node;
 	int nr_free = 0, ofs = dn->ofs_in_node, len = count;
+	int compr_saved = 0;
 	__le32 *addr;
 	int base = 0;
 
@@ -527,6 +550,18 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 		dn->data_blkaddr = NULL_ADDR;
 		f2fs_set_data_blkaddr(dn);
 
+		/* compressed clusters only go away as a whole, no block here */
+		if (blkaddr == COMPRESS_ADDR) {
+			int cluster_size = F2FS_I(dn->inode)->i_cluster_size;
+			int i;
+
+			for (i = 1; i < cluster_size && i < count; i++)
+				if (!__is_valid_data_blkaddr(le32_to_cpu(addr[i])))
+					break;
+			compr_saved += cluster_size - i + 1;
+			continue;
+		}
+
 		if (__is_valid_data_blkaddr(blkaddr) &&
 			!f2fs_is_valid_blkaddr(sbi, blkaddr,
 					DATA_GENERIC_ENHANCE))
@@ -549,6 +584,7 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 		f2fs_update_extent_cache_range(dn, fofs, 0, len);
 		dec_valid_block_count(sbi, dn->inode, nr_free);
 	}
+	f2fs_i_compr_blocks_update(dn->inode, -compr_saved);
 	dn->ofs_in_node = ofs;
 
 	f2fs_update_time(sbi, REQ_TIME);
@@ -606,6 +642,13 @@ int f2fs_truncate_blocks(struct inode *inode, u64 from, bool lock)
 
 	trace_f2fs_truncate_blocks_enter(inode, from);
 
+	/* writeback of the cluster needs f2fs_lock_op, see below */
+	if (lock && f2fs_compressed_file(inode)) {
+		err = f2fs_truncate_partial_cluster(inode, from);
+		if (err)
+			return err;
+	}
+
 	free_from = (pgoff_t)F2FS_BLK_ALIGN(from);
 
 	if (free_from >= sbi->max_file_blocks)
@@ -1586,6 +1629,9 @@ static long f2fs_fallocate(struct file *file, int mode,
 		(mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE)))
 		return -EOPNOTSUPP;
 
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE |
 			FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_ZERO_RANGE |
 			FALLOC_FL_INSERT_RANGE))
@@ -1668,6 +1714,29 @@ static int f2fs_setflags_common(struct inode *inode, u32 iflags, u32 mask)
 	if (IS_NOQUOTA(inode))
 		return -EPERM;
 
+	if ((iflags ^ fi->i_flags) & F2FS_COMPR_FL) {
+		int err;
+
+		if (!f2fs_sb_has_compression(F2FS_I_SB(inode)))
+			return -EOPNOTSUPP;
+		if (!S_ISREG(inode->i_mode))
+			goto set_flags;
+		/* only empty files switch, there is no data to convert */
+		if (inode->i_size || F2FS_HAS_BLOCKS(inode))
+			return -EINVAL;
+
+		if (iflags & F2FS_COMPR_FL) {
+			if (!f2fs_may_compress(inode))
+				return -EINVAL;
+			err = f2fs_convert_inline_inode(inode);
+			if (err)
+				return err;
+			f2fs_set_compress_context(inode);
+		} else {
+			f2fs_clear_compress_context(inode);
+		}
+	}
+set_flags:
 	fi->i_flags = iflags | (fi->i_flags & ~mask);
 
 	if (fi->i_flags & F2FS_PROJINHERIT_FL)
@@ -1694,6 +1763,7 @@ static const struct {
 	u32 iflag;
 	u32 fsflag;
 } f2fs_fsflags_map[] = {
+	{ F2FS_COMPR_FL,	FS_COMPR_FL },
 	{ F2FS_SYNC_FL,		FS_SYNC_FL },
 	{ F2FS_IMMUTABLE_FL,	FS_IMMUTABLE_FL },
 	{ F2FS_APPEND_FL,	FS_APPEND_FL },
@@ -1705,6 +1775,7 @@ static const struct {
 };
 
 #define F2FS_GETTABLE_FS_FL (		\
+		FS_COMPR_FL |		\
 		FS_SYNC_FL |		\
 		FS_IMMUTABLE_FL |	\
 		FS_APPEND_FL |		\
@@ -1718,6 +1789,7 @@ static const struct {
 		FS_NOCOW_FL)
 
 #define F2FS_SETTABLE_FS_FL (		\
+		FS_COMPR_FL |		\
 		FS_SYNC_FL |		\
 		FS_IMMUTABLE_FL |	\
 		FS_APPEND_FL |		\
@@ -1831,6 +1903,9 @@ static int f2fs_ioc_start_atomic_write(struct file *filp)
 	if (!S_ISREG(inode->i_mode))
 		return -EINVAL;
 
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	ret = mnt_want_write_file(filp);
 	if (ret)
 		return ret;
@@ -1935,6 +2010,9 @@ static int f2fs_ioc_start_volatile_write(struct file *filp)
 	if (!S_ISREG(inode->i_mode))
 		return -EINVAL;
 
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	ret = mnt_want_write_file(filp);
 	if (ret)
 		return ret;
@@ -2466,6 +2544,9 @@ static int f2fs_ioc_defragment(struct file *filp, unsigned long arg)
 	if (!S_ISREG(inode->i_mode) || f2fs_is_atomic_file(inode))
 		return -EINVAL;
 
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	if (f2fs_readonly(sbi->sb))
 		return -EROFS;
 
@@ -2522,6 +2603,9 @@ static int f2fs_move_file_range(struct file *file_in, loff_t pos_in,
 	if (f2fs_encrypted_inode(src) || f2fs_encrypted_inode(dst))
 		return -EOPNOTSUPP;
 
+	if (f2fs_compressed_file(src) || f2fs_compressed_file(dst))
+		return -EOPNOTSUPP;
+
 	if (src == dst) {
 		if (pos_in == pos_out)
 			return 0;
@@ -2756,7 +2840,7 @@ static int f2fs_ioc_set_pin_file(struct file *filp, unsigned long arg)
 	if (get_user(pin, (__u32 __user *)arg))
 		return -EFAULT;
 
-	if (!S_ISREG(inode->i_mode))
+	if (!S_ISREG(inode->i_mode) || f2fs_compressed_file(inode))
 		return -EINVAL;
 
 	if (f2fs_readonly(F2FS_I_SB(inode)->sb))
@@ -2866,6 +2950,21 @@ static int f2fs_ioc_resize_fs(struct file *filp, unsigned long arg)
 	return ret;
 }
 
+static int f2fs_get_compress_blocks(struct file *filp, unsigned long arg)
+{
+	struct inode *inode = file_inode(filp);
+	__u64 blocks;
+
+	if (!f2fs_sb_has_compression(F2FS_I_SB(inode)))
+		return -EOPNOTSUPP;
+
+	if (!f2fs_compressed_file(inode))
+		return -EINVAL;
+
+	blocks = atomic_read(&F2FS_I(inode)->i_compr_blocks);
+	return put_user(blocks, (u64 __user *)arg);
+}
+
 long f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	if (unlikely(f2fs_cp_error(F2FS_I_SB(file_inode(filp)))))
@@ -2920,6 +3019,8 @@ long f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return f2fs_ioc_precache_extents(filp, arg);
 	case F2FS_IOC_RESIZE_FS:
 		return f2fs_ioc_resize_fs(filp, arg);
+	case F2FS_IOC_GET_COMPRESS_BLOCKS:
+		return f2fs_get_compress_blocks(filp, arg);
 	default:
 		return -ENOTTY;
 	}
@@ -2955,7 +3056,9 @@ static ssize_t f2fs_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 		size_t target_size = 0;
 		int err;
 
-		if (iov_iter_fault_in_readable(from, iov_iter_count(from)))
+		/* compressed clusters get their blocks at writeback */
+		if (iov_iter_fault_in_readable(from, iov_iter_count(from)) ||
+				f2fs_compressed_file(inode))
 			set_inode_flag(inode, FI_NO_PREALLOC);
 
 		if ((iocb->ki_flags & IOCB_NOWAIT)) {
@@ -3037,6 +3140,7 @@ long f2fs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case F2FS_IOC_SET_PIN_FILE:
 	case F2FS_IOC_PRECACHE_EXTENTS:
 	case F2FS_IOC_RESIZE_FS:
+	case F2FS_IOC_GET_COMPRESS_BLOCKS:
 		break;
 	default:
 		return -ENOIOCTLCMD;
@@ -50,6 +50,8 @@ static inline void rapid_gc_set_wakelock(void)
 	mutex_unlock(&gc_wakelock_mutex);
 }
 
+static void gc_queue_prefetch(struct f2fs_sb_info *sbi);
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
@@ -144,6 +146,9 @@ static int gc_thread_func(void *data)
 do_gc:
 		stat_inc_bggc_count(sbi);
 
+		if (sbi->rapid_gc)
+			gc_queue_prefetch(sbi);
+
 		/* if return value is not zero, no victim was selected */
 		if (f2fs_gc(sbi, sbi->rapid_gc || test_opt(sbi, FORCE_FG_GC), true, NULL_SEGNO)) {
 			wait_ms = gc_th->no_gc_sleep_time;
@@ -197,14 +202,26 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	sbi->gc_mode = GC_NORMAL;
 	gc_th->gc_wake= 0;
 
+	/* rapid GC still works without it, only slower */
+	gc_th->prefetch_wq = alloc_workqueue("f2fs_gc_ra-%u:%u",
+				WQ_UNBOUND | WQ_FREEZABLE,
+				MAX_GC_PREFETCH_WORKERS, MAJOR(dev), MINOR(dev));
+	atomic_set(&gc_th->prefetch_pending, 0);
+	gc_th->prefetch_active = MAX_GC_PREFETCH_WORKERS;
+	atomic64_set(&gc_th->prefetch_sections, 0);
+	atomic64_set(&gc_th->prefetch_time, 0);
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	sbi->gc_thread->f2fs_gc_task = kthread_run(gc_thread_func, sbi,
 			"f2fs_gc-%u:%u", MAJOR(dev), MINOR(dev));
 	if (IS_ERR(gc_th->f2fs_gc_task)) {
 		err = PTR_ERR(gc_th->f2fs_gc_task);
+		if (gc_th->prefetch_wq)
+			destroy_workqueue(gc_th->prefetch_wq);
 		kvfree(gc_th);
 		sbi->gc_thread = NULL;
+		goto out;
 	}
 	set_task_ioprio(sbi->gc_thread->f2fs_gc_task,
 			IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
@@ -219,6 +236,8 @@ void f2fs_stop_gc_thread(struct f2fs_sb_info *sbi)
 	if (!gc_th)
 		return;
 	kthread_stop(gc_th->f2fs_gc_task);
+	if (gc_th->prefetch_wq)
+		destroy_workqueue(gc_th->prefetch_wq);
 	kvfree(gc_th);
 	sbi->gc_mode = GC_NORMAL;
 	sbi->gc_thread = NULL;
@@ -482,6 +501,73 @@ static unsigned int count_bits(const unsigned long *addr,
 	return sum;
 }
 
+/* Whether the index may pick @secno, same checks as the linear search */
+static unsigned int victim_index_usable(struct f2fs_sb_info *sbi,
+					unsigned int secno, int gc_type)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int start = GET_SEG_FROM_SEC(sbi, secno);
+	unsigned int end = start + sbi->segs_per_sec;
+	unsigned int segno;
+
+	segno = find_next_bit(dirty_i->dirty_segmap[DIRTY], end, start);
+	if (segno >= end)
+		return NULL_SEGNO;
+	if (sec_usage_check(sbi, secno))
+		return NULL_SEGNO;
+	/* Don't touch checkpointed data */
+	if (unlikely(is_sbi_flag_set(sbi, SBI_CP_DISABLED) &&
+				get_ckpt_valid_blocks(sbi, segno)))
+		return NULL_SEGNO;
+	if (gc_type == BG_GC && test_bit(secno, dirty_i->victim_secmap))
+		return NULL_SEGNO;
+	return segno;
+}
+
+/*
+ * LFS victim from the victim index. Greedy takes the first usable section
+ * of the lowest bucket, or the best of that bucket when buckets span more
+ * than one valid block count. Buckets are in age order, so cost-benefit
+ * only needs the first usable section of each bucket.
+ */
+static void get_victim_by_index(struct f2fs_sb_info *sbi, int gc_type,
+				struct victim_sel_policy *p)
+{
+	struct victim_index *vi = DIRTY_I(sbi)->vindex;
+	unsigned int bucket, secno, segno;
+	unsigned long long scanned = 0;
+	struct list_head *pos;
+	unsigned long cost;
+
+	spin_lock(&vi->lock);
+	for_each_set_bit(bucket, vi->bucket_map, vi->nr_buckets) {
+		list_for_each(pos, &vi->buckets[bucket]) {
+			secno = pos - vi->nodes;
+			scanned++;
+
+			segno = victim_index_usable(sbi, secno, gc_type);
+			if (segno == NULL_SEGNO)
+				continue;
+
+			cost = get_gc_cost(sbi, segno, p);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+			if (p->gc_mode == GC_CB || !vi->shift)
+				break;
+		}
+		if (p->gc_mode == GC_GREEDY && p->min_segno != NULL_SEGNO)
+			break;
+	}
+
+	vi->lookups++;
+	vi->scanned += scanned;
+	if (p->min_segno != NULL_SEGNO)
+		vi->vblocks += get_valid_blocks(sbi, p->min_segno, true);
+	spin_unlock(&vi->lock);
+}
+
 /*
  * This function is called from two paths.
  * One is garbage collection and the other is SSR segment selection.
@@ -542,6 +628,14 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS && sbi->gc_victim_index &&
+			dirty_i->vindex) {
+		get_victim_by_index(sbi, gc_type, &p);
+		if (p.min_segno != NULL_SEGNO)
+			goto got_it;
+		goto out;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -1145,6 +1239,16 @@ out:
 	return err;
 }
 
+/*
+ * Data which needs post-read processing is copied block by block through
+ * META_MAPPING, except the inline encrypted one whose IV is its address.
+ */
+static bool gc_moves_raw_blocks(struct inode *inode)
+{
+	return f2fs_post_read_required(inode) &&
+		!f2fs_hw_encrypted_file(inode);
+}
+
 /*
  * This function tries to get parent node of victim data block, and identifies
  * data block validity. If the block is valid, copy that with cold status and
@@ -1216,10 +1320,23 @@ next_step:
 				continue;
 			}
 
+			/*
+			 * Blocks encrypted inline can't be moved as they are,
+			 * nor be read back without their key.
+			 */
+			if (f2fs_encrypted_file(inode) &&
+				!f2fs_hw_encrypted_file(inode) &&
+				fscrypt_policy_uses_hardware_encryption(inode)) {
+				up_write(&F2FS_I(inode)->i_gc_rwsem[WRITE]);
+				iput(inode);
+				sbi->skipped_gc_rwsem++;
+				continue;
+			}
+
 			start_bidx = f2fs_start_bidx_of_node(nofs, inode) +
 								ofs_in_node;
 
-			if (f2fs_post_read_required(inode)) {
+			if (gc_moves_raw_blocks(inode)) {
 				int err = ra_data_block(inode, start_bidx);
 
 				up_write(&F2FS_I(inode)->i_gc_rwsem[WRITE]);
@@ -1268,7 +1385,7 @@ next_step:
 
 			start_bidx = f2fs_start_bidx_of_node(nofs, inode)
 								+ ofs_in_node;
-			if (f2fs_post_read_required(inode))
+			if (gc_moves_raw_blocks(inode))
 				err = move_data_block(inode, start_bidx,
 							gc_type, segno, off);
 			else
@@ -1276,7 +1393,7 @@ next_step:
 								segno, off);
 
 			if (!err && (gc_type == FG_GC ||
-					f2fs_post_read_required(inode)))
+					gc_moves_raw_blocks(inode)))
 				submitted++;
 
 			if (locked) {
@@ -1412,6 +1529,234 @@ skip:
 	return seg_freed;
 }
 
+/*
+ * Sections are still migrated one at a time under gc_mutex, since they all
+ * go to the same current segments. What rapid GC waits on is the reads, so
+ * while the device is idle and charging, workers read the summaries, node
+ * and data blocks of the next victims in the background, each its own
+ * section. Fewer of them run once a section takes longer than the latency
+ * target, as the queue is then deep enough already.
+ */
+static bool gc_prefetch_stopped(struct f2fs_sb_info *sbi)
+{
+	return !READ_ONCE(sbi->rapid_gc) || f2fs_cp_error(sbi);
+}
+
+static void gc_prefetch_data_segment(struct f2fs_sb_info *sbi,
+				struct f2fs_summary *sum, unsigned int segno)
+{
+	block_t start_addr = START_BLOCK(sbi, segno);
+	struct f2fs_summary *entry;
+	int off, phase;
+
+	for (phase = 0; phase < 4; phase++) {
+		for (off = 0, entry = sum; off < sbi->blocks_per_seg;
+							off++, entry++) {
+			nid_t nid = le32_to_cpu(entry->nid);
+			struct node_info dni;
+			unsigned int nofs;
+			struct inode *inode;
+			block_t start_bidx;
+			int err;
+
+			if (gc_prefetch_stopped(sbi))
+				return;
+			if (check_valid_map(sbi, segno, off) == 0)
+				continue;
+
+			if (phase == 0) {
+				f2fs_ra_meta_pages(sbi, NAT_BLOCK_OFFSET(nid),
+							1, META_NAT, true);
+				continue;
+			}
+			if (phase == 1) {
+				f2fs_ra_node_page(sbi, nid);
+				continue;
+			}
+			if (!is_alive(sbi, entry, &dni, start_addr + off,
+								&nofs))
+				continue;
+			if (phase == 2) {
+				f2fs_ra_node_page(sbi, dni.ino);
+				continue;
+			}
+
+			inode = f2fs_iget(sbi->sb, dni.ino);
+			if (IS_ERR(inode))
+				continue;
+			if (is_bad_inode(inode) || (f2fs_encrypted_file(inode) &&
+				!f2fs_hw_encrypted_file(inode) &&
+				fscrypt_policy_uses_hardware_encryption(inode)) ||
+				!down_write_trylock(
+					&F2FS_I(inode)->i_gc_rwsem[WRITE])) {
+				iput(inode);
+				continue;
+			}
+
+			start_bidx = f2fs_start_bidx_of_node(nofs, inode) +
+					le16_to_cpu(entry->ofs_in_node);
+			if (gc_moves_raw_blocks(inode)) {
+				err = ra_data_block(inode, start_bidx);
+			} else {
+				struct page *page;
+
+				page = f2fs_get_read_data_page(inode,
+						start_bidx, REQ_RAHEAD, true);
+				err = PTR_ERR_OR_ZERO(page);
+				if (!err)
+					f2fs_put_page(page, 0);
+			}
+			up_write(&F2FS_I(inode)->i_gc_rwsem[WRITE]);
+			iput(inode);
+		}
+	}
+}
+
+static void gc_prefetch_node_segment(struct f2fs_sb_info *sbi,
+				struct f2fs_summary *sum, unsigned int segno)
+{
+	struct f2fs_summary *entry;
+	int off;
+
+	for (off = 0, entry = sum; off < sbi->blocks_per_seg; off++, entry++) {
+		if (gc_prefetch_stopped(sbi))
+			return;
+		if (check_valid_map(sbi, segno, off) == 0)
+			continue;
+		f2fs_ra_node_page(sbi, le32_to_cpu(entry->nid));
+	}
+}
+
+static void gc_prefetch_section(struct f2fs_sb_info *sbi, unsigned int secno)
+{
+	unsigned int segno = GET_SEG_FROM_SEC(sbi, secno);
+	unsigned int end_segno = segno + sbi->segs_per_sec;
+	struct page *sum_page;
+	struct f2fs_summary_block *sum;
+	struct blk_plug plug;
+
+	f2fs_ra_meta_pages(sbi, GET_SUM_BLOCK(sbi, segno),
+				end_segno - segno, META_SSA, true);
+
+	blk_start_plug(&plug);
+	for (; segno < end_segno && !gc_prefetch_stopped(sbi); segno++) {
+		if (get_valid_blocks(sbi, segno, false) == 0)
+			continue;
+
+		sum_page = f2fs_get_sum_page(sbi, segno);
+		if (IS_ERR(sum_page))
+			break;
+		/* as in do_garbage_collect, sentry_lock nests outside it */
+		unlock_page(sum_page);
+
+		sum = page_address(sum_page);
+		if (GET_SUM_TYPE((&sum->footer)) == SUM_TYPE_NODE)
+			gc_prefetch_node_segment(sbi, sum->entries, segno);
+		else
+			gc_prefetch_data_segment(sbi, sum->entries, segno);
+		f2fs_put_page(sum_page, 0);
+	}
+	blk_finish_plug(&plug);
+}
+
+static void gc_prefetch_work_func(struct work_struct *work)
+{
+	struct gc_prefetch_work *pw = container_of(work,
+					struct gc_prefetch_work, work);
+	struct f2fs_sb_info *sbi = pw->sbi;
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	unsigned long start = jiffies;
+	unsigned int active, elapsed;
+
+	/* lets an unlinked inode be evicted by the final iput */
+	if (!sb_start_write_trylock(sbi->sb))
+		goto out;
+	gc_prefetch_section(sbi, pw->secno);
+	sb_end_write(sbi->sb);
+
+	elapsed = jiffies_to_msecs(jiffies - start);
+	atomic64_inc(&gc_th->prefetch_sections);
+	atomic64_add(elapsed, &gc_th->prefetch_time);
+
+	/* racy, but a lost update only delays the next adjustment */
+	active = READ_ONCE(gc_th->prefetch_active);
+	if (elapsed > sbi->gc_prefetch_latency)
+		active = max(active / 2, 1U);
+	else if (active < MAX_GC_PREFETCH_WORKERS)
+		active++;
+	WRITE_ONCE(gc_th->prefetch_active, active);
+out:
+	atomic_dec(&gc_th->prefetch_pending);
+}
+
+/*
+ * Pick the sections the victim index would hand out after the current one,
+ * so called with gc_mutex held before f2fs_gc takes the first itself.
+ */
+static unsigned int peek_victim_sections(struct f2fs_sb_info *sbi,
+				unsigned int *secnos, unsigned int nr)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	struct victim_index *vi = dirty_i->vindex;
+	unsigned int bucket, secno, found = 0;
+	bool skipped = false;
+	struct list_head *pos;
+
+	down_read(&SIT_I(sbi)->sentry_lock);
+	mutex_lock(&dirty_i->seglist_lock);
+	spin_lock(&vi->lock);
+	for_each_set_bit(bucket, vi->bucket_map, vi->nr_buckets) {
+		list_for_each(pos, &vi->buckets[bucket]) {
+			secno = pos - vi->nodes;
+			if (victim_index_usable(sbi, secno, FG_GC) ==
+								NULL_SEGNO)
+				continue;
+			if (!skipped) {
+				skipped = true;
+				continue;
+			}
+			secnos[found++] = secno;
+			if (found == nr)
+				goto out;
+		}
+	}
+out:
+	spin_unlock(&vi->lock);
+	mutex_unlock(&dirty_i->seglist_lock);
+	up_read(&SIT_I(sbi)->sentry_lock);
+	return found;
+}
+
+static void gc_queue_prefetch(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	unsigned int secnos[MAX_GC_PREFETCH_WORKERS];
+	unsigned int nr, i;
+
+	if (!gc_th->prefetch_wq || !DIRTY_I(sbi)->vindex ||
+			!sbi->gc_victim_index)
+		return;
+	/* the next batch once the previous one is done */
+	if (atomic_read(&gc_th->prefetch_pending))
+		return;
+
+	nr = min3(sbi->gc_prefetch_workers, READ_ONCE(gc_th->prefetch_active),
+					(unsigned int)MAX_GC_PREFETCH_WORKERS);
+	if (!nr)
+		return;
+
+	nr = peek_victim_sections(sbi, secnos, nr);
+	atomic_set(&gc_th->prefetch_pending, nr);
+	for (i = 0; i < nr; i++) {
+		struct gc_prefetch_work *pw = &gc_th->prefetch[i];
+
+		INIT_WORK(&pw->work, gc_prefetch_work_func);
+		pw->sbi = sbi;
+		pw->secno = secnos[i];
+		queue_work(gc_th->prefetch_wq, &pw->work);
+	}
+}
+
 int f2fs_gc(struct f2fs_sb_info *sbi, bool sync,
 			bool background, unsigned int segno)
 {
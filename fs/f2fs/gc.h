@@ -22,6 +22,17 @@
 /* Search max. number of dirty segments to select a victim segment */
 #define DEF_MAX_VICTIM_SEARCH 4096 /* covers 8GB */
 
+/* sections prefetched ahead of rapid GC, fewer while slower than latency */
+#define MAX_GC_PREFETCH_WORKERS		8
+#define DEF_GC_PREFETCH_WORKERS		4
+#define DEF_GC_PREFETCH_LATENCY		50	/* ms per section */
+
+struct gc_prefetch_work {
+	struct work_struct work;
+	struct f2fs_sb_info *sbi;
+	unsigned int secno;		/* section being prefetched */
+};
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -34,6 +45,14 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_wake;
+
+	/* for prefetching the next victims of rapid GC */
+	struct workqueue_struct *prefetch_wq;
+	struct gc_prefetch_work prefetch[MAX_GC_PREFETCH_WORKERS];
+	atomic_t prefetch_pending;		/* works not done yet */
+	unsigned int prefetch_active;		/* works allowed by latency */
+	atomic64_t prefetch_sections;		/* # of sections prefetched */
+	atomic64_t prefetch_time;		/* ms spent prefetching them */
 };
 
 struct gc_inode_list {
@@ -282,6 +282,24 @@ static bool sanity_check_inode(struct inode *inode, struct page *node_page)
 		return false;
 	}
 
+	if (f2fs_has_extra_attr(inode) && f2fs_sb_has_compression(sbi) &&
+			S_ISREG(inode->i_mode) && (fi->i_flags & F2FS_COMPR_FL) &&
+			F2FS_FITS_IN_INODE(F2FS_INODE(node_page), fi->i_extra_isize,
+						i_log_cluster_size)) {
+		struct f2fs_inode *ri = F2FS_INODE(node_page);
+
+		if (ri->i_compress_algorithm >= COMPRESS_MAX ||
+			ri->i_log_cluster_size < MIN_COMPRESS_LOG_SIZE ||
+			ri->i_log_cluster_size > MAX_COMPRESS_LOG_SIZE) {
+			set_sbi_flag(sbi, SBI_NEED_FSCK);
+			f2fs_warn(sbi, "%s: inode (ino=%lx) has unsupported compress algorithm: %u or log cluster size: %u, run fsck to fix",
+				  __func__, inode->i_ino,
+				  ri->i_compress_algorithm,
+				  ri->i_log_cluster_size);
+			return false;
+		}
+	}
+
 	return true;
 }
 
@@ -403,6 +421,19 @@ static int do_read_inode(struct inode *inode)
 		fi->i_crtime.tv_nsec = le32_to_cpu(ri->i_crtime_nsec);
 	}
 
+	if (f2fs_has_extra_attr(inode) && f2fs_sb_has_compression(sbi) &&
+			S_ISREG(inode->i_mode) && (fi->i_flags & F2FS_COMPR_FL) &&
+			F2FS_FITS_IN_INODE(ri, fi->i_extra_isize,
+						i_log_cluster_size)) {
+		atomic_set(&fi->i_compr_blocks,
+				le64_to_cpu(ri->i_compr_blocks));
+		fi->i_compress_algorithm = ri->i_compress_algorithm;
+		fi->i_log_cluster_size = ri->i_log_cluster_size;
+		fi->i_cluster_size = 1 << fi->i_log_cluster_size;
+		set_inode_flag(inode, FI_COMPRESSED_FILE);
+		stat_inc_compr_inode(inode);
+	}
+
 	F2FS_I(inode)->i_disk_time[0] = inode->i_atime;
 	F2FS_I(inode)->i_disk_time[1] = inode->i_ctime;
 	F2FS_I(inode)->i_disk_time[2] = inode->i_mtime;
@@ -565,6 +596,17 @@ void f2fs_update_inode(struct inode *inode, struct page *node_page)
 			ri->i_crtime_nsec =
 				cpu_to_le32(F2FS_I(inode)->i_crtime.tv_nsec);
 		}
+
+		if (f2fs_sb_has_compression(F2FS_I_SB(inode)) &&
+			F2FS_FITS_IN_INODE(ri, F2FS_I(inode)->i_extra_isize,
+							i_log_cluster_size)) {
+			ri->i_compr_blocks = cpu_to_le64(
+				atomic_read(&F2FS_I(inode)->i_compr_blocks));
+			ri->i_compress_algorithm =
+				F2FS_I(inode)->i_compress_algorithm;
+			ri->i_log_cluster_size =
+				F2FS_I(inode)->i_log_cluster_size;
+		}
 	}
 
 	__set_inode_rdev(inode, ri);
@@ -643,6 +685,9 @@ void f2fs_evict_inode(struct inode *inode)
 	trace_f2fs_evict_inode(inode);
 	truncate_inode_pages_final(&inode->i_data);
 
+	if (f2fs_compressed_file(inode))
+		stat_dec_compr_inode(inode);
+
 	if (inode->i_ino == F2FS_NODE_INO(sbi) ||
 			inode->i_ino == F2FS_META_INO(sbi))
 		goto out_clear;
@@ -85,6 +85,10 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 		F2FS_I(inode)->i_extra_isize = F2FS_TOTAL_EXTRA_ATTR_SIZE;
 	}
 
+	/* files created in a compressed directory get compressed */
+	if ((F2FS_I(dir)->i_flags & F2FS_COMPR_FL) && f2fs_may_compress(inode))
+		f2fs_set_compress_context(inode);
+
 	if (test_opt(sbi, INLINE_XATTR))
 		set_inode_flag(inode, FI_INLINE_XATTR);
 
@@ -116,6 +120,10 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 	if (S_ISDIR(inode->i_mode))
 		F2FS_I(inode)->i_flags |= F2FS_INDEX_FL;
 
+	if (f2fs_compressed_file(inode) || (S_ISDIR(inode->i_mode) &&
+				(F2FS_I(dir)->i_flags & F2FS_COMPR_FL)))
+		F2FS_I(inode)->i_flags |= F2FS_COMPR_FL;
+
 	if (F2FS_I(inode)->i_flags & F2FS_PROJINHERIT_FL)
 		set_inode_flag(inode, FI_PROJ_INHERIT);
 
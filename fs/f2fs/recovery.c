@@ -577,6 +577,14 @@ retry_dn:
 			continue;
 		}
 
+		/* head of a compressed cluster, carries no block */
+		if (dest == COMPRESS_ADDR) {
+			f2fs_truncate_data_blocks_range(&dn, 1);
+			dn.data_blkaddr = COMPRESS_ADDR;
+			f2fs_set_data_blkaddr(&dn);
+			continue;
+		}
+
 		if (!file_keep_isize(inode) &&
 			(i_size_read(inode) <= ((loff_t)start << PAGE_SHIFT)))
 			f2fs_i_size_write(inode,
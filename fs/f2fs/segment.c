@@ -940,6 +940,7 @@ static struct discard_cmd *__create_discard_cmd(struct f2fs_sb_info *sbi,
 	dc->state = D_PREP;
 	dc->queued = 0;
 	dc->error = 0;
+	dc->lat = 0;
 	init_completion(&dc->wait);
 	list_add_tail(&dc->list, pend_list);
 	spin_lock_init(&dc->lock);
@@ -972,6 +973,12 @@ static void __detach_discard_cmd(struct discard_cmd_control *dcc,
 	if (dc->state == D_DONE)
 		atomic_sub(dc->queued, &dcc->queued_discard);
 
+	if (dc->lat) {
+		dcc->discard_lat_total += dc->lat;
+		dcc->discard_lat_max = max(dcc->discard_lat_max, dc->lat);
+		dcc->discard_lat_cnt++;
+	}
+
 	list_del(&dc->list);
 	rb_erase(&dc->rb_node, &dcc->root);
 	dcc->undiscard_blks -= dc->len;
@@ -1019,6 +1026,7 @@ static void f2fs_submit_discard_endio(struct bio *bio)
 	dc->bio_ref--;
 	if (!dc->bio_ref && dc->state == D_SUBMIT) {
 		dc->state = D_DONE;
+		dc->lat = ktime_us_delta(ktime_get(), dc->submit_time);
 		complete_all(&dc->wait);
 	}
 	spin_unlock_irqrestore(&dc->lock, flags);
@@ -1133,6 +1141,63 @@ static void __check_sit_bitmap(struct f2fs_sb_info *sbi,
 #endif
 }
 
+/*
+ * f2fs' own I/O is tracked by is_idle(), but the disk may also be used by
+ * other partitions. Count it busy while it has requests in flight other
+ * than our queued discards, and idle only once that stopped for the idle
+ * interval of DISCARD_TIME.
+ */
+static bool __disk_is_idle(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+	unsigned int inflight = 0;
+	int i;
+
+	for (i = 0; i < sbi->s_ndevs; i++)
+		inflight += part_in_flight(&FDEV(i).bdev->bd_disk->part0);
+	if (!sbi->s_ndevs)
+		inflight = part_in_flight(&sbi->sb->s_bdev->bd_disk->part0);
+
+	if (inflight > atomic_read(&dcc->queued_discard)) {
+		dcc->disk_busy_stamp = jiffies;
+		return false;
+	}
+
+	return time_after(jiffies, dcc->disk_busy_stamp +
+				sbi->interval_time[DISCARD_TIME] * HZ);
+}
+
+static bool __discard_is_idle(struct f2fs_sb_info *sbi)
+{
+	return is_idle(sbi, DISCARD_TIME) &&
+		(sbi->gc_mode == GC_URGENT || __disk_is_idle(sbi));
+}
+
+/*
+ * Issue more per round, and come back sooner, as undiscarded blocks pile
+ * up or free sections run low, so that the idle windows get used before GC
+ * and the FTL need the space instead of one late burst of discards.
+ */
+static void __adjust_bg_discard_policy(struct f2fs_sb_info *sbi,
+				struct discard_policy *dpolicy)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+	unsigned int pend_segs = dcc->undiscard_blks >> sbi->log_blocks_per_seg;
+	unsigned int scale;
+
+	scale = min(1 + pend_segs / DEF_DISCARD_SCALE_SEGS,
+					(unsigned int)DEF_MAX_DISCARD_SCALE);
+	if (free_sections(sbi) < 2 * reserved_sections(sbi))
+		scale = DEF_MAX_DISCARD_SCALE;
+
+	dpolicy->max_requests = DEF_MAX_DISCARD_REQUEST * scale;
+	dpolicy->min_interval = max_t(unsigned int, 1,
+				DEF_MIN_DISCARD_ISSUE_TIME / scale);
+	dpolicy->mid_interval = DEF_MID_DISCARD_ISSUE_TIME <<
+				min_t(unsigned int, dcc->backoff,
+					DEF_MAX_DISCARD_BACKOFF);
+}
+
 static void __init_discard_policy(struct f2fs_sb_info *sbi,
 				struct discard_policy *dpolicy,
 				int discard_type, unsigned int granularity)
@@ -1158,6 +1223,7 @@ static void __init_discard_policy(struct f2fs_sb_info *sbi,
 			dpolicy->granularity = 1;
 			dpolicy->max_interval = DEF_MAX_DISCARD_URGENT_ISSUE_TIME;
 		}
+		__adjust_bg_discard_policy(sbi, dpolicy);
 	} else if (discard_type == DPOLICY_FORCE) {
 		dpolicy->min_interval = 1;
 		dpolicy->mid_interval = DEF_MID_DISCARD_ISSUE_TIME;
@@ -1257,6 +1323,8 @@ submit:
 		dc->bio_ref++;
 		spin_unlock_irqrestore(&dc->lock, flags);
 
+		if (!dc->queued)
+			dc->submit_time = ktime_get();
 		atomic_inc(&dcc->queued_discard);
 		dc->queued++;
 		list_move_tail(&dc->list, wait_list);
@@ -1494,7 +1562,7 @@ static unsigned int __issue_discard_cmd_orderly(struct f2fs_sb_info *sbi,
 		if (dc->state != D_PREP)
 			goto next;
 
-		if (dpolicy->io_aware && !is_idle(sbi, DISCARD_TIME)) {
+		if (dpolicy->io_aware && !__discard_is_idle(sbi)) {
 			io_interrupted = true;
 			break;
 		}
@@ -1565,7 +1633,7 @@ static int __issue_discard_cmd(struct f2fs_sb_info *sbi,
 				break;
 
 			if (dpolicy->io_aware && i < dpolicy->io_aware_gran &&
-						!is_idle(sbi, DISCARD_TIME)) {
+						!__discard_is_idle(sbi)) {
 				io_interrupted = true;
 				break;
 			}
@@ -1799,11 +1867,15 @@ static int issue_discard_thread(void *data)
 		if (issued > 0) {
 			__wait_all_discard_cmd(sbi, &dpolicy);
 			wait_ms = dpolicy.min_interval;
+			dcc->backoff = 0;
 		} else if (issued == -1){
+			atomic_inc(&dcc->discard_interrupted);
+			dcc->backoff++;
 			wait_ms = f2fs_time_to_wait(sbi, DISCARD_TIME);
 			if (!wait_ms)
 				wait_ms = dpolicy.mid_interval;
 		} else {
+			dcc->backoff = 0;
 			wait_ms = dpolicy.max_interval;
 		}
 
@@ -2123,6 +2195,9 @@ static int create_discard_cmd_control(struct f2fs_sb_info *sbi)
 	dcc->next_pos = 0;
 	dcc->root = RB_ROOT;
 	dcc->rbtree_check = false;
+	dcc->disk_busy_stamp = jiffies;
+	atomic_set(&dcc->discard_interrupted, 0);
+	atomic_set(&dcc->discard_collided, 0);
 
 	init_waitqueue_head(&dcc->discard_wait_queue);
 	SM_I(sbi)->dcc_info = dcc;
@@ -2173,6 +2248,38 @@ static void __set_sit_entry_type(struct f2fs_sb_info *sbi, int type,
 		__mark_sit_entry_dirty(sbi, segno);
 }
 
+/*
+ * Move @secno to the tail of the bucket of its valid blocks, the section
+ * having just been written to or invalidated, or drop it once empty.
+ */
+static void update_victim_index(struct f2fs_sb_info *sbi, unsigned int secno)
+{
+	struct victim_index *vi = DIRTY_I(sbi)->vindex;
+	unsigned int vblocks, bucket, old;
+
+	if (!vi)
+		return;
+
+	vblocks = get_valid_blocks(sbi, GET_SEG_FROM_SEC(sbi, secno), true);
+	bucket = vblocks ? min(vblocks >> vi->shift, vi->nr_buckets - 1) :
+			   VICTIM_INDEX_NONE;
+
+	spin_lock(&vi->lock);
+	old = vi->bucket_of[secno];
+	if (bucket == VICTIM_INDEX_NONE)
+		list_del_init(&vi->nodes[secno]);
+	else
+		list_move_tail(&vi->nodes[secno], &vi->buckets[bucket]);
+	vi->bucket_of[secno] = bucket;
+
+	if (old != VICTIM_INDEX_NONE && old != bucket &&
+			list_empty(&vi->buckets[old]))
+		clear_bit(old, vi->bucket_map);
+	if (bucket != VICTIM_INDEX_NONE)
+		set_bit(bucket, vi->bucket_map);
+	spin_unlock(&vi->lock);
+}
+
 static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 {
 	struct seg_entry *se;
@@ -2270,6 +2377,9 @@ static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 
 	if (__is_large_section(sbi))
 		get_sec_entry(sbi, segno)->valid_blocks += del;
+
+	if (del)
+		update_victim_index(sbi, GET_SEC_FROM_SEG(sbi, segno));
 }
 
 void f2fs_invalidate_blocks(struct f2fs_sb_info *sbi, block_t addr)
@@ -4326,10 +4436,73 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+static int build_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct victim_index *vi;
+	unsigned int i, secno, shift = 0;
+
+	while ((BLKS_PER_SEC(sbi) >> shift) >= VICTIM_INDEX_MAX_BUCKETS)
+		shift++;
+
+	vi = f2fs_kzalloc(sbi, sizeof(struct victim_index), GFP_KERNEL);
+	if (!vi)
+		return -ENOMEM;
+
+	spin_lock_init(&vi->lock);
+	vi->shift = shift;
+	vi->nr_buckets = (BLKS_PER_SEC(sbi) >> shift) + 1;
+	vi->buckets = f2fs_kvzalloc(sbi, array_size(vi->nr_buckets,
+					sizeof(struct list_head)), GFP_KERNEL);
+	vi->bucket_map = f2fs_kvzalloc(sbi, f2fs_bitmap_size(vi->nr_buckets),
+					GFP_KERNEL);
+	vi->nodes = f2fs_kvzalloc(sbi, array_size(MAIN_SECS(sbi),
+					sizeof(struct list_head)), GFP_KERNEL);
+	vi->bucket_of = f2fs_kvzalloc(sbi, array_size(MAIN_SECS(sbi),
+					sizeof(unsigned int)), GFP_KERNEL);
+	if (!vi->buckets || !vi->bucket_map || !vi->nodes || !vi->bucket_of) {
+		kvfree(vi->buckets);
+		kvfree(vi->bucket_map);
+		kvfree(vi->nodes);
+		kvfree(vi->bucket_of);
+		kfree(vi);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < vi->nr_buckets; i++)
+		INIT_LIST_HEAD(&vi->buckets[i]);
+	for (secno = 0; secno < MAIN_SECS(sbi); secno++) {
+		INIT_LIST_HEAD(&vi->nodes[secno]);
+		vi->bucket_of[secno] = VICTIM_INDEX_NONE;
+	}
+
+	DIRTY_I(sbi)->vindex = vi;
+
+	/* sit entries are loaded, index the sections in use */
+	for (secno = 0; secno < MAIN_SECS(sbi); secno++)
+		update_victim_index(sbi, secno);
+	return 0;
+}
+
+static void destroy_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct victim_index *vi = DIRTY_I(sbi)->vindex;
+
+	if (!vi)
+		return;
+
+	DIRTY_I(sbi)->vindex = NULL;
+	kvfree(vi->buckets);
+	kvfree(vi->bucket_map);
+	kvfree(vi->nodes);
+	kvfree(vi->bucket_of);
+	kfree(vi);
+}
+
 static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
 	unsigned int bitmap_size, i;
+	int err;
 
 	/* allocate memory for dirty segments list information */
 	dirty_i = f2fs_kzalloc(sbi, sizeof(struct dirty_seglist_info),
@@ -4350,7 +4523,10 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 	}
 
 	init_dirty_segmap(sbi);
-	return init_victim_secmap(sbi);
+	err = init_victim_secmap(sbi);
+	if (err)
+		return err;
+	return build_victim_index(sbi);
 }
 
 static int sanity_check_curseg(struct f2fs_sb_info *sbi)
@@ -4521,6 +4697,7 @@ static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
 		discard_dirty_segmap(sbi, i);
 
 	destroy_victim_secmap(sbi);
+	destroy_victim_index(sbi);
 	SM_I(sbi)->dirty_info = NULL;
 	kvfree(dirty_i);
 }
@@ -271,12 +271,36 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/*
+ * Sections holding valid blocks, indexed for GC victim selection: one list
+ * per range of valid block counts, each list in the order its sections were
+ * last written to, i.e. oldest mtime first.
+ */
+#define VICTIM_INDEX_MAX_BUCKETS	1024
+#define VICTIM_INDEX_NONE		UINT_MAX
+
+struct victim_index {
+	spinlock_t lock;
+	unsigned int shift;		/* valid blocks to bucket */
+	unsigned int nr_buckets;
+	struct list_head *buckets;
+	unsigned long *bucket_map;	/* non empty buckets */
+	struct list_head *nodes;	/* entry of each section */
+	unsigned int *bucket_of;	/* bucket of each section */
+
+	/* victim quality stats */
+	unsigned long long lookups;	/* victim searches of the index */
+	unsigned long long scanned;	/* sections looked at for those */
+	unsigned long long vblocks;	/* valid blocks of the victims */
+};
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	struct victim_index *vindex;		/* GC victims by valid blocks */
 };
 
 /* victim selection function for cleaning and SSR */
@@ -78,6 +78,90 @@ static ssize_t unusable_show(struct f2fs_attr *a,
 		(unsigned long long)unusable);
 }
 
+static ssize_t cp_merge_issued_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		atomic_read(&sbi->cprc_info.issued_ckpt));
+}
+
+static ssize_t cp_merge_requests_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		atomic_read(&sbi->cprc_info.total_ckpt));
+}
+
+static ssize_t cp_merge_queued_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		atomic_read(&sbi->cprc_info.queued_ckpt));
+}
+
+static ssize_t cp_merge_avg_wait_ms_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	struct ckpt_req_control *cprc = &sbi->cprc_info;
+	unsigned int total = atomic_read(&cprc->total_ckpt);
+	unsigned long long avg = 0;
+
+	spin_lock(&cprc->stat_lock);
+	if (total)
+		avg = div_u64(cprc->total_time, total);
+	spin_unlock(&cprc->stat_lock);
+
+	return snprintf(buf, PAGE_SIZE, "%llu\n", avg);
+}
+
+static ssize_t cp_merge_cur_wait_ms_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		READ_ONCE(sbi->cprc_info.cur_time));
+}
+
+static ssize_t cp_merge_peak_wait_ms_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		READ_ONCE(sbi->cprc_info.peak_time));
+}
+
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+static ssize_t compr_written_block_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+		(unsigned long long)atomic64_read(&sbi->compr_written_block));
+}
+
+static ssize_t compr_saved_block_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+		(unsigned long long)atomic64_read(&sbi->compr_saved_block));
+}
+
+static ssize_t decompr_clusters_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+		(unsigned long long)atomic64_read(&sbi->decompr_clusters));
+}
+
+static ssize_t decompr_avg_us_show(struct f2fs_attr *a,
+		struct f2fs_sb_info *sbi, char *buf)
+{
+	u64 clusters = atomic64_read(&sbi->decompr_clusters);
+	u64 avg = 0;
+
+	if (clusters)
+		avg = div64_u64(atomic64_read(&sbi->decompr_time),
+					clusters * NSEC_PER_USEC);
+	return snprintf(buf, PAGE_SIZE, "%llu\n", (unsigned long long)avg);
+}
+#endif
 
 static ssize_t lifetime_write_kbytes_show(struct f2fs_attr *a,
 		struct f2fs_sb_info *sbi, char *buf)
@@ -131,6 +215,9 @@ static ssize_t features_show(struct f2fs_attr *a,
 	if (f2fs_sb_has_sb_chksum(sbi))
 		len += snprintf(buf + len, PAGE_SIZE - len, "%s%s",
 				len ? ", " : "", "sb_checksum");
+	if (f2fs_sb_has_compression(sbi))
+		len += snprintf(buf + len, PAGE_SIZE - len, "%s%s",
+				len ? ", " : "", "compression");
 	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
 	return len;
 }
@@ -267,6 +354,10 @@ out:
 	if (!strcmp(a->attr.name, "trim_sections"))
 		return -EINVAL;
 
+	if (!strcmp(a->attr.name, "gc_prefetch_workers") &&
+			t > MAX_GC_PREFETCH_WORKERS)
+		return -EINVAL;
+
 	if (!strcmp(a->attr.name, "gc_idle")) {
 		if (t == GC_IDLE_CB)
 			sbi->gc_mode = GC_IDLE_CB;
@@ -336,6 +427,7 @@ enum feat_id {
 	FEAT_INODE_CRTIME,
 	FEAT_LOST_FOUND,
 	FEAT_SB_CHECKSUM,
+	FEAT_COMPRESSION,
 };
 
 static ssize_t f2fs_feature_show(struct f2fs_attr *a,
@@ -353,6 +445,7 @@ static ssize_t f2fs_feature_show(struct f2fs_attr *a,
 	case FEAT_INODE_CRTIME:
 	case FEAT_LOST_FOUND:
 	case FEAT_SB_CHECKSUM:
+	case FEAT_COMPRESSION:
 		return snprintf(buf, PAGE_SIZE, "supported\n");
 	}
 	return 0;
@@ -397,6 +490,12 @@ F2FS_RW_ATTR(NM_INFO, f2fs_nm_info, ram_thresh, ram_thresh);
 F2FS_RW_ATTR(NM_INFO, f2fs_nm_info, ra_nid_pages, ra_nid_pages);
 F2FS_RW_ATTR(NM_INFO, f2fs_nm_info, dirty_nats_ratio, dirty_nats_ratio);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, max_victim_search, max_victim_search);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, max_extent_node, max_extent_node);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_prefetch_workers, gc_prefetch_workers);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_prefetch_latency, gc_prefetch_latency);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, precache_extent_blocks,
+					precache_extent_blocks);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_victim_index, gc_victim_index);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, migration_granularity, migration_granularity);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, dir_level, dir_level);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, idle_interval, interval_time[REQ_TIME]);
@@ -417,6 +516,18 @@ F2FS_GENERAL_RO_ATTR(lifetime_write_kbytes);
 F2FS_GENERAL_RO_ATTR(features);
 F2FS_GENERAL_RO_ATTR(current_reserved_blocks);
 F2FS_GENERAL_RO_ATTR(unusable);
+F2FS_GENERAL_RO_ATTR(cp_merge_issued);
+F2FS_GENERAL_RO_ATTR(cp_merge_requests);
+F2FS_GENERAL_RO_ATTR(cp_merge_queued);
+F2FS_GENERAL_RO_ATTR(cp_merge_avg_wait_ms);
+F2FS_GENERAL_RO_ATTR(cp_merge_cur_wait_ms);
+F2FS_GENERAL_RO_ATTR(cp_merge_peak_wait_ms);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+F2FS_GENERAL_RO_ATTR(compr_written_block);
+F2FS_GENERAL_RO_ATTR(compr_saved_block);
+F2FS_GENERAL_RO_ATTR(decompr_clusters);
+F2FS_GENERAL_RO_ATTR(decompr_avg_us);
+#endif
 
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
 F2FS_FEATURE_RO_ATTR(encryption, FEAT_CRYPTO);
@@ -433,6 +544,9 @@ F2FS_FEATURE_RO_ATTR(quota_ino, FEAT_QUOTA_INO);
 F2FS_FEATURE_RO_ATTR(inode_crtime, FEAT_INODE_CRTIME);
 F2FS_FEATURE_RO_ATTR(lost_found, FEAT_LOST_FOUND);
 F2FS_FEATURE_RO_ATTR(sb_checksum, FEAT_SB_CHECKSUM);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+F2FS_FEATURE_RO_ATTR(compression, FEAT_COMPRESSION);
+#endif
 
 #define ATTR_LIST(name) (&f2fs_attr_##name.attr)
 static struct attribute *f2fs_attrs[] = {
@@ -447,6 +561,11 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(min_hot_blocks),
 	ATTR_LIST(min_ssr_sections),
 	ATTR_LIST(max_victim_search),
+	ATTR_LIST(max_extent_node),
+	ATTR_LIST(gc_prefetch_workers),
+	ATTR_LIST(gc_prefetch_latency),
+	ATTR_LIST(precache_extent_blocks),
+	ATTR_LIST(gc_victim_index),
 	ATTR_LIST(migration_granularity),
 	ATTR_LIST(dir_level),
 	ATTR_LIST(ram_thresh),
@@ -469,6 +588,18 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(features),
 	ATTR_LIST(reserved_blocks),
 	ATTR_LIST(current_reserved_blocks),
+	ATTR_LIST(cp_merge_issued),
+	ATTR_LIST(cp_merge_requests),
+	ATTR_LIST(cp_merge_queued),
+	ATTR_LIST(cp_merge_avg_wait_ms),
+	ATTR_LIST(cp_merge_cur_wait_ms),
+	ATTR_LIST(cp_merge_peak_wait_ms),
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	ATTR_LIST(compr_written_block),
+	ATTR_LIST(compr_saved_block),
+	ATTR_LIST(decompr_clusters),
+	ATTR_LIST(decompr_avg_us),
+#endif
 	NULL,
 };
 
@@ -488,6 +619,9 @@ static struct attribute *f2fs_feat_attrs[] = {
 	ATTR_LIST(inode_crtime),
 	ATTR_LIST(lost_found),
 	ATTR_LIST(sb_checksum),
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	ATTR_LIST(compression),
+#endif
 	NULL,
 };
 
@@ -121,6 +121,68 @@ ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	return fuse_passthrough_read_write_iter(iocb, from, 1);
 }
 
+/*
+ * Map the lower file instead, so that faults are served by its vm_ops and
+ * page cache, with the lower file's readahead state and bdi, and stay
+ * coherent with passthrough read and write.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int ret;
+	struct fuse_file *ff = file->private_data;
+	struct file *passthrough_filp = ff->passthrough_filp;
+
+	if (!passthrough_filp->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	/* The daemon may have opened the lower file read only */
+	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE) &&
+	    !(passthrough_filp->f_mode & FMODE_WRITE))
+		return -EACCES;
+
+	vma->vm_file = get_file(passthrough_filp);
+	ret = passthrough_filp->f_op->mmap(passthrough_filp, vma);
+	if (ret) {
+		/* Drop the reference taken for the new vm_file */
+		fput(passthrough_filp);
+	} else {
+		/* Drop the reference of the previous vm_file */
+		fput(file);
+	}
+
+	fsstack_copy_attr_atime(file_inode(file), file_inode(passthrough_filp));
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe, size_t len,
+				     unsigned int flags)
+{
+	ssize_t ret_val;
+	struct fuse_file *ff = in->private_data;
+	struct file *passthrough_filp = ff->passthrough_filp;
+
+	if (!passthrough_filp->f_op->splice_read)
+		return -EINVAL;
+
+	/* lock passthrough file to prevent it from being released */
+	get_file(passthrough_filp);
+	ret_val = passthrough_filp->f_op->splice_read(passthrough_filp, ppos,
+						      pipe, len, flags);
+	if (ret_val >= 0)
+		fsstack_copy_attr_atime(file_inode(in),
+					file_inode(passthrough_filp));
+
+	/* unlock passthrough file */
+	fput(passthrough_filp);
+
+	return ret_val;
+}
+
 void fuse_passthrough_release(struct fuse_file *ff)
 {
 	if (!(ff->passthrough_filp))
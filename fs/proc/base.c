@@ -80,6 +80,7 @@
 #include <linux/poll.h>
 #include <linux/nsproxy.h>
 #include <linux/oom.h>
+#include <linux/simple_lmk.h>
 #include <linux/elf.h>
 #include <linux/pid_namespace.h>
 #include <linux/user_namespace.h>
@@ -92,6 +93,7 @@
 #include <asm/hardwall.h>
 #endif
 #include <trace/events/oom.h>
+#include <soc/qcom/kryo_task_counters.h>
 #include "internal.h"
 #include "fd.h"
 
@@ -1150,6 +1152,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		simple_lmk_adj_update(task->signal);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1239,6 +1243,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		simple_lmk_adj_update(task->signal);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -3144,6 +3150,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat",  S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_KRYO_TASK_COUNTERS
+	ONE("kryo_counters", S_IRUGO, proc_tgid_kryo_counters),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
@@ -3547,6 +3556,9 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat", S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_KRYO_TASK_COUNTERS
+	ONE("kryo_counters", S_IRUGO, proc_pid_kryo_counters),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
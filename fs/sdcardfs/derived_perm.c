@@ -20,6 +20,9 @@
 
 #include "sdcardfs.h"
 
+/* bumped whenever derived permissions may have changed */
+static atomic_t perms_generation = ATOMIC_INIT(0);
+
 /* copy derived state from parent inode */
 static void inherit_derived_state(struct inode *parent, struct inode *child)
 {
@@ -46,6 +49,7 @@ void setup_derived_state(struct inode *inode, perm_t perm, userid_t userid,
 	info->data->under_android = false;
 	info->data->under_cache = false;
 	info->data->under_obb = false;
+	info->data->generation = atomic_read(&perms_generation);
 }
 
 /* While renaming, there is a point where we want the path from dentry,
@@ -75,6 +79,7 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	 * of using the inode permissions.
 	 */
 
+	info->data->generation = atomic_read(&perms_generation);
 	inherit_derived_state(d_inode(parent), d_inode(dentry));
 
 	/* Files don't get special labels */
@@ -266,67 +271,49 @@ retry_deleg:
 	sdcardfs_put_lower_path(dentry, &path);
 }
 
-static int descendant_may_need_fixup(struct sdcardfs_inode_data *data,
-		struct limit_search *limit)
+static bool derived_perm_stale(struct dentry *dentry)
 {
-	if (data->perm == PERM_ROOT)
-		return (limit->flags & BY_USERID) ?
-				data->userid == limit->userid : 1;
-	if (data->perm == PERM_PRE_ROOT || data->perm == PERM_ANDROID)
-		return 1;
-	return 0;
-}
+	struct inode *inode = d_inode(dentry);
 
-static int needs_fixup(perm_t perm)
-{
-	if (perm == PERM_ANDROID_DATA || perm == PERM_ANDROID_OBB
-			|| perm == PERM_ANDROID_MEDIA)
-		return 1;
-	return 0;
+	if (IS_ROOT(dentry) || !inode)
+		return false;
+	return SDCARDFS_I(inode)->data->generation !=
+			atomic_read(&perms_generation);
 }
 
-static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit, int depth)
+/*
+ * Recompute the derived state of a dentry and of its ancestors if the
+ * package list changed since it was last derived. Path walks revalidate a
+ * parent before its children, so usually only the dentry itself is stale.
+ */
+void fixup_stale_perms(struct dentry *dentry)
 {
-	struct dentry *child;
-	struct sdcardfs_inode_info *info;
-
-	/*
-	 * All paths will terminate their recursion on hitting PERM_ANDROID_OBB,
-	 * PERM_ANDROID_MEDIA, or PERM_ANDROID_DATA. This happens at a depth of
-	 * at most 3.
-	 */
-	WARN(depth > 3, "%s: Max expected depth exceeded!\n", __func__);
-	spin_lock_nested(&dentry->d_lock, depth);
-	if (!d_inode(dentry)) {
-		spin_unlock(&dentry->d_lock);
-		return;
-	}
-	info = SDCARDFS_I(d_inode(dentry));
-
-	if (needs_fixup(info->data->perm)) {
-		list_for_each_entry(child, &dentry->d_subdirs, d_child) {
-			spin_lock_nested(&child->d_lock, depth + 1);
-			if (!(limit->flags & BY_NAME) || qstr_case_eq(&child->d_name, &limit->name)) {
-				if (d_inode(child)) {
-					get_derived_permission(dentry, child);
-					fixup_tmp_permissions(d_inode(child));
-					spin_unlock(&child->d_lock);
-					break;
-				}
-			}
-			spin_unlock(&child->d_lock);
-		}
-	} else if (descendant_may_need_fixup(info->data, limit)) {
-		list_for_each_entry(child, &dentry->d_subdirs, d_child) {
-			__fixup_perms_recursive(child, limit, depth + 1);
+	struct dentry *d, *parent;
+
+	while (derived_perm_stale(dentry)) {
+		/* Refresh the topmost stale ancestor first */
+		d = dget(dentry);
+		parent = dget_parent(d);
+		while (derived_perm_stale(parent)) {
+			dput(d);
+			d = parent;
+			parent = dget_parent(d);
 		}
+		get_derived_permission(parent, d);
+		fixup_tmp_permissions(d_inode(d));
+		dput(parent);
+		dput(d);
 	}
-	spin_unlock(&dentry->d_lock);
 }
 
-void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit)
+/*
+ * Called on package list changes. Instead of walking the dentry tree, mark
+ * all derived state out of date; it is recomputed on the next lookup or
+ * revalidation by fixup_stale_perms().
+ */
+void invalidate_derived_perms(void)
 {
-	__fixup_perms_recursive(dentry, limit, 0);
+	atomic_inc(&perms_generation);
 }
 
 /* main function for updating derived permission */
@@ -345,6 +332,7 @@ inline void update_derived_permission_lock(struct dentry *dentry)
 	if (!IS_ROOT(dentry)) {
 		parent = dget_parent(dentry);
 		if (parent) {
+			fixup_stale_perms(parent);
 			get_derived_permission(parent, dentry);
 			dput(parent);
 		}
@@ -20,6 +20,9 @@
 
 #include "sdcardfs.h"
 #include "linux/delay.h"
+#include <linux/ctype.h>
+#include <linux/hash.h>
+#include <linux/vmalloc.h>
 
 /* The dentry cache is just so we have properly sized dentries */
 static struct kmem_cache *sdcardfs_dentry_cachep;
@@ -220,36 +223,279 @@ int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
 	return PTR_ERR(ret_dentry);
 }
 
+/*
+ * Case-insensitive lookups that miss the exact-case lower lookup scan the
+ * whole lower directory. Remember the names seen by that scan by their
+ * casefolded hash, so that later misses in the same directory, including
+ * names that don't exist at all, are answered without another scan. The
+ * cache is dropped once the lower directory's mtime or ctime moves, so it
+ * also notices changes made directly on the lower filesystem.
+ */
+#define SDCARDFS_NAME_CACHE_MAX	16384	/* names, larger dirs aren't cached */
+
+struct sdcardfs_name_entry {
+	struct hlist_node hnode;
+	unsigned int hash;
+	unsigned int len;
+	char name[];
+};
+
+struct sdcardfs_name_cache {
+	struct inode *lower_dir;	/* not referenced, only compared */
+	struct timespec mtime;
+	struct timespec ctime;
+	unsigned int nr;
+	unsigned int bits;
+	struct hlist_head table[];
+};
+
+static atomic64_t name_cache_hits = ATOMIC64_INIT(0);
+static atomic64_t name_cache_negative = ATOMIC64_INIT(0);
+static atomic64_t name_cache_misses = ATOMIC64_INIT(0);
+static atomic64_t name_cache_stale = ATOMIC64_INIT(0);
+
+static unsigned int casefold_hash(const char *name, unsigned int len)
+{
+	unsigned long hash = init_name_hash();
+
+	while (len--)
+		hash = partial_name_hash(tolower(*name++), hash);
+	return end_name_hash(hash);
+}
+
+static void free_name_entries(struct hlist_head *head)
+{
+	struct sdcardfs_name_entry *entry;
+	struct hlist_node *tmp;
+
+	hlist_for_each_entry_safe(entry, tmp, head, hnode) {
+		hlist_del(&entry->hnode);
+		kfree(entry);
+	}
+}
+
+void sdcardfs_free_name_cache(struct sdcardfs_inode_info *info)
+{
+	struct sdcardfs_name_cache *cache = info->name_cache;
+	unsigned int i;
+
+	if (!cache)
+		return;
+	info->name_cache = NULL;
+	for (i = 0; i < (1U << cache->bits); i++)
+		free_name_entries(&cache->table[i]);
+	kvfree(cache);
+}
+
+static bool name_cache_valid(struct sdcardfs_name_cache *cache,
+				struct inode *lower_dir)
+{
+	return cache->lower_dir == lower_dir &&
+		timespec_equal(&cache->mtime, &lower_dir->i_mtime) &&
+		timespec_equal(&cache->ctime, &lower_dir->i_ctime);
+}
+
+static struct sdcardfs_name_entry *name_cache_find(
+		struct sdcardfs_name_cache *cache, const struct qstr *name)
+{
+	unsigned int hash = casefold_hash(name->name, name->len);
+	struct sdcardfs_name_entry *entry;
+	struct qstr candidate;
+
+	hlist_for_each_entry(entry, &cache->table[hash_32(hash, cache->bits)],
+									hnode) {
+		if (entry->hash != hash)
+			continue;
+		candidate = (struct qstr)QSTR_INIT(entry->name, entry->len);
+		if (qstr_case_eq(name, &candidate))
+			return entry;
+	}
+	return NULL;
+}
+
+/* Hash the names collected by the scan, NULL if they can't be kept */
+static struct sdcardfs_name_cache *build_name_cache(struct hlist_head *names,
+		unsigned int nr, struct inode *lower_dir,
+		struct timespec *mtime, struct timespec *ctime)
+{
+	struct sdcardfs_name_cache *cache;
+	struct sdcardfs_name_entry *entry;
+	struct hlist_node *tmp;
+	unsigned int bits, i;
+	size_t size;
+
+	bits = nr > 1 ? ilog2(roundup_pow_of_two(nr)) : 1;
+	size = sizeof(*cache) + (sizeof(struct hlist_head) << bits);
+	cache = kmalloc(size, GFP_KERNEL | __GFP_NOWARN);
+	if (!cache)
+		cache = vmalloc(size);
+	if (!cache)
+		return NULL;
+
+	cache->lower_dir = lower_dir;
+	cache->mtime = *mtime;
+	cache->ctime = *ctime;
+	cache->nr = nr;
+	cache->bits = bits;
+	for (i = 0; i < (1U << bits); i++)
+		INIT_HLIST_HEAD(&cache->table[i]);
+	hlist_for_each_entry_safe(entry, tmp, names, hnode) {
+		hlist_del(&entry->hnode);
+		hlist_add_head(&entry->hnode,
+				&cache->table[hash_32(entry->hash, bits)]);
+	}
+	return cache;
+}
+
+ssize_t sdcardfs_name_cache_stats(char *page)
+{
+	u64 hits = atomic64_read(&name_cache_hits);
+	u64 negative = atomic64_read(&name_cache_negative);
+	u64 misses = atomic64_read(&name_cache_misses);
+	u64 total = hits + negative + misses;
+
+	return scnprintf(page, PAGE_SIZE,
+			"hits: %llu\nnegative: %llu\nmisses: %llu\n"
+			"stale: %llu\nhit_rate: %llu%%\n",
+			hits, negative, misses,
+			(u64)atomic64_read(&name_cache_stale),
+			total ? div64_u64((hits + negative) * 100, total) : 0);
+}
+
 struct sdcardfs_name_data {
 	struct dir_context ctx;
 	const struct qstr *to_find;
 	char *name;
 	bool found;
+	/* names seen so far for the name cache, until it gives up */
+	struct hlist_head names;
+	unsigned int nr_names;
+	bool collect;
 };
 
+static void sdcardfs_collect_name(struct sdcardfs_name_data *buf,
+				const char *name, int namelen)
+{
+	struct sdcardfs_name_entry *entry;
+
+	if (buf->nr_names >= SDCARDFS_NAME_CACHE_MAX) {
+		buf->collect = false;
+		return;
+	}
+	entry = kmalloc(sizeof(*entry) + namelen, GFP_KERNEL);
+	if (!entry) {
+		buf->collect = false;
+		return;
+	}
+	entry->hash = casefold_hash(name, namelen);
+	entry->len = namelen;
+	memcpy(entry->name, name, namelen);
+	hlist_add_head(&entry->hnode, &buf->names);
+	buf->nr_names++;
+}
+
 static int sdcardfs_name_match(struct dir_context *ctx, const char *name,
 		int namelen, loff_t offset, u64 ino, unsigned int d_type)
 {
 	struct sdcardfs_name_data *buf = container_of(ctx, struct sdcardfs_name_data, ctx);
 	struct qstr candidate = QSTR_INIT(name, namelen);
 
-	if (qstr_case_eq(buf->to_find, &candidate)) {
+	if (buf->collect)
+		sdcardfs_collect_name(buf, name, namelen);
+
+	if (!buf->found && qstr_case_eq(buf->to_find, &candidate)) {
 		memcpy(buf->name, name, namelen);
 		buf->name[namelen] = 0;
 		buf->found = true;
+		/* keep going to see the rest of the names */
+		if (buf->collect)
+			return 0;
 		return 1;
 	}
 	return 0;
 }
 
+/*
+ * Find the lower name that matches @name but for case, through the name
+ * cache of @dir or by scanning the lower directory, which fills it.
+ * Called with @dir's i_mutex held, which also protects its name cache.
+ */
+static int sdcardfs_find_ci_name(struct inode *dir,
+		struct path *lower_parent_path, const struct qstr *name,
+		char *found_name)
+{
+	struct sdcardfs_inode_info *info = SDCARDFS_I(dir);
+	struct inode *lower_dir = d_inode(lower_parent_path->dentry);
+	const struct cred *cred = current_cred();
+	struct sdcardfs_name_entry *entry;
+	struct timespec start, mtime, ctime;
+	struct file *file;
+	int err;
+
+	struct sdcardfs_name_data buffer = {
+		.ctx.actor = sdcardfs_name_match,
+		.to_find = name,
+		.name = found_name,
+		.found = false,
+		.names = HLIST_HEAD_INIT,
+		.nr_names = 0,
+		.collect = true,
+	};
+
+	if (info->name_cache) {
+		if (name_cache_valid(info->name_cache, lower_dir)) {
+			entry = name_cache_find(info->name_cache, name);
+			if (!entry) {
+				atomic64_inc(&name_cache_negative);
+				return -ENOENT;
+			}
+			atomic64_inc(&name_cache_hits);
+			memcpy(found_name, entry->name, entry->len);
+			found_name[entry->len] = 0;
+			return 0;
+		}
+		atomic64_inc(&name_cache_stale);
+		sdcardfs_free_name_cache(info);
+	}
+	atomic64_inc(&name_cache_misses);
+
+	/*
+	 * A change within the current timestamp tick wouldn't move mtime, so
+	 * a directory changed since then is scanned but not cached.
+	 */
+	start = current_fs_time(lower_dir->i_sb);
+	mtime = lower_dir->i_mtime;
+	ctime = lower_dir->i_ctime;
+
+	file = dentry_open(lower_parent_path, O_RDONLY, cred);
+	if (IS_ERR(file)) {
+		err = PTR_ERR(file);
+		goto out;
+	}
+	err = iterate_dir(file, &buffer.ctx);
+	fput(file);
+	if (err)
+		goto out;
+
+	if (buffer.collect && timespec_compare(&mtime, &start) < 0 &&
+			timespec_compare(&ctime, &start) < 0)
+		info->name_cache = build_name_cache(&buffer.names,
+				buffer.nr_names, lower_dir, &mtime, &ctime);
+	err = buffer.found ? 0 : -ENOENT;
+out:
+	free_name_entries(&buffer.names);
+	return err;
+}
+
 /*
  * Main driver function for sdcardfs's lookup.
  *
  * Returns: NULL (ok), ERR_PTR if an error occurred.
  * Fills in lower_parent_path with <dentry,mnt> on success.
  */
-static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
-		unsigned int flags, struct path *lower_parent_path, userid_t id)
+static struct dentry *__sdcardfs_lookup(struct inode *dir,
+		struct dentry *dentry, unsigned int flags,
+		struct path *lower_parent_path, userid_t id)
 {
 	int err = 0;
 	struct vfsmount *lower_dir_mnt;
@@ -279,39 +525,20 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 				&lower_path);
 	/* check for other cases */
 	if (err == -ENOENT) {
-		struct file *file;
-		const struct cred *cred = current_cred();
+		char *found_name = __getname();
 
-		struct sdcardfs_name_data buffer = {
-			.ctx.actor = sdcardfs_name_match,
-			.to_find = name,
-			.name = __getname(),
-			.found = false,
-		};
-
-		if (!buffer.name) {
+		if (!found_name) {
 			err = -ENOMEM;
 			goto out;
 		}
-		file = dentry_open(lower_parent_path, O_RDONLY, cred);
-		if (IS_ERR(file)) {
-			err = PTR_ERR(file);
-			goto put_name;
-		}
-		err = iterate_dir(file, &buffer.ctx);
-		fput(file);
-		if (err)
-			goto put_name;
-
-		if (buffer.found)
+		err = sdcardfs_find_ci_name(dir, lower_parent_path, name,
+						found_name);
+		if (!err)
 			err = vfs_path_lookup(lower_dir_dentry,
 						lower_dir_mnt,
-						buffer.name, 0,
+						found_name, 0,
 						&lower_path);
-		else
-			err = -ENOENT;
-put_name:
-		__putname(buffer.name);
+		__putname(found_name);
 	}
 
 	/* no error: handle positive dentries */
@@ -442,7 +669,7 @@ struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 		goto out;
 	}
 
-	ret = __sdcardfs_lookup(dentry, flags, &lower_parent_path,
+	ret = __sdcardfs_lookup(dir, dentry, flags, &lower_parent_path,
 				SDCARDFS_I(dir)->data->userid);
 	if (IS_ERR(ret))
 		goto out;
@@ -452,6 +679,7 @@ struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 		fsstack_copy_attr_times(d_inode(dentry),
 					sdcardfs_lower_inode(d_inode(dentry)));
 		/* get derived permission */
+		fixup_stale_perms(parent);
 		get_derived_permission(parent, dentry);
 		fixup_tmp_permissions(d_inode(dentry));
 		fixup_lower_ownership(dentry, dentry->d_name.name);
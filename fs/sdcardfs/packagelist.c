@@ -249,46 +249,6 @@ static int insert_userid_exclude_entry_locked(const struct qstr *key, userid_t v
 	return 0;
 }
 
-static void fixup_all_perms_name(const struct qstr *key)
-{
-	struct sdcardfs_sb_info *sbinfo;
-	struct limit_search limit = {
-		.flags = BY_NAME,
-		.name = QSTR_INIT(key->name, key->len),
-	};
-	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
-		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
-	}
-}
-
-static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
-{
-	struct sdcardfs_sb_info *sbinfo;
-	struct limit_search limit = {
-		.flags = BY_NAME | BY_USERID,
-		.name = QSTR_INIT(key->name, key->len),
-		.userid = userid,
-	};
-	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
-		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
-	}
-}
-
-static void fixup_all_perms_userid(userid_t userid)
-{
-	struct sdcardfs_sb_info *sbinfo;
-	struct limit_search limit = {
-		.flags = BY_USERID,
-		.userid = userid,
-	};
-	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
-		if (sbinfo_has_sdcard_magic(sbinfo))
-			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
-	}
-}
-
 static int insert_packagelist_entry(const struct qstr *key, appid_t value)
 {
 	int err;
@@ -296,7 +256,7 @@ static int insert_packagelist_entry(const struct qstr *key, appid_t value)
 	mutex_lock(&sdcardfs_super_list_lock);
 	err = insert_packagelist_appid_entry_locked(key, value);
 	if (!err)
-		fixup_all_perms_name(key);
+		invalidate_derived_perms();
 	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
@@ -320,7 +280,7 @@ static int insert_userid_exclude_entry(const struct qstr *key, userid_t value)
 	mutex_lock(&sdcardfs_super_list_lock);
 	err = insert_userid_exclude_entry_locked(key, value);
 	if (!err)
-		fixup_all_perms_name_userid(key, value);
+		invalidate_derived_perms();
 	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
@@ -361,7 +321,7 @@ static void remove_packagelist_entry(const struct qstr *key)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_packagelist_entry_locked(key);
-	fixup_all_perms_name(key);
+	invalidate_derived_perms();
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
@@ -410,7 +370,7 @@ static void remove_userid_all_entry(userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_all_entry_locked(userid);
-	fixup_all_perms_userid(userid);
+	invalidate_derived_perms();
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
@@ -434,7 +394,7 @@ static void remove_userid_exclude_entry(const struct qstr *key, userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_exclude_entry_locked(key, userid);
-	fixup_all_perms_name_userid(key, userid);
+	invalidate_derived_perms();
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
@@ -801,9 +761,18 @@ static struct configfs_attribute packages_attr_packages_gid_list = {
 
 SDCARDFS_CONFIGFS_ATTR_WO(packages_, remove_userid);
 
+static ssize_t packages_name_cache_stats_show(struct config_item *item,
+					char *page)
+{
+	return sdcardfs_name_cache_stats(page);
+}
+
+SDCARDFS_CONFIGFS_ATTR_RO(packages_, name_cache_stats);
+
 static struct configfs_attribute *packages_attrs[] = {
 	&packages_attr_packages_gid_list,
 	&packages_attr_remove_userid,
+	&packages_attr_name_cache_stats,
 	NULL,
 };
 
@@ -150,6 +150,9 @@ extern struct inode *sdcardfs_iget(struct super_block *sb,
 				 struct inode *lower_inode, userid_t id);
 extern int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
 			    struct path *lower_path, userid_t id);
+struct sdcardfs_inode_info;
+extern void sdcardfs_free_name_cache(struct sdcardfs_inode_info *info);
+extern ssize_t sdcardfs_name_cache_stats(char *page);
 
 /* file private data */
 struct sdcardfs_file_info {
@@ -167,6 +170,8 @@ struct sdcardfs_inode_data {
 	bool under_android;
 	bool under_cache;
 	bool under_obb;
+	/* perms_generation this state was derived at, see derived_perm.c */
+	int generation;
 };
 
 /* sdcardfs inode data in memory */
@@ -179,6 +184,9 @@ struct sdcardfs_inode_info {
 	spinlock_t top_lock;
 	struct sdcardfs_inode_data *top_data;
 
+	/* case-insensitive names of the lower dir, see lookup.c */
+	struct sdcardfs_name_cache *name_cache;
+
 	struct inode vfs_inode;
 };
 
@@ -495,19 +503,12 @@ extern int packagelist_init(void);
 extern void packagelist_exit(void);
 
 /* for derived_perm.c */
-#define BY_NAME		(1 << 0)
-#define BY_USERID	(1 << 1)
-struct limit_search {
-	unsigned int flags;
-	struct qstr name;
-	userid_t userid;
-};
-
 extern void setup_derived_state(struct inode *inode, perm_t perm,
 			userid_t userid, uid_t uid);
 extern void get_derived_permission(struct dentry *parent, struct dentry *dentry);
 extern void get_derived_permission_new(struct dentry *parent, struct dentry *dentry, const struct qstr *name);
-extern void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit);
+extern void fixup_stale_perms(struct dentry *dentry);
+extern void invalidate_derived_perms(void);
 
 extern void update_derived_permission_lock(struct dentry *dentry);
 void fixup_lower_ownership(struct dentry *dentry, const char *name);
@@ -282,6 +282,15 @@ typedef struct __FS_INFO_T {
 	u32      map_clu;                // allocation bitmap start cluster
 	u32      map_sectors;            // num of allocation bitmap sectors
 	struct buffer_head **vol_amap;      // allocation bitmap
+	u32      *vol_amap_free;         // free clusters per bitmap sector (lazy)
+
+	/* allocation path metadata accesses */
+	struct {
+		u64 bmap_updates;        // bitmap sector writes
+		u64 fat_updates;         // FAT entries written while allocating
+		u64 bmap_searched;       // bitmap sectors searched for a free cluster
+		u64 bmap_skipped;        // full bitmap sectors skipped by vol_amap_free
+	} alloc_stat;
 
 	u16      **vol_utbl;               // upcase table
 
@@ -1085,6 +1085,7 @@ s32 load_alloc_bmp(struct super_block *sb)
 					return -ENOMEM;
 
 				sector = CLUS_TO_SECT(fsi, fsi->map_clu);
+				fsi->vol_amap_free = NULL;
 
 				/* trigger read amap ahead */
 				bdev_readahead(sb, sector, fsi->map_sectors);
@@ -1130,6 +1131,46 @@ void free_alloc_bmp(struct super_block *sb)
 	/* kfree(NULL) is safe */
 	kfree(fsi->vol_amap);
 	fsi->vol_amap = NULL;
+	kfree(fsi->vol_amap_free);
+	fsi->vol_amap_free = NULL;
+}
+
+/* number of valid cluster bits in bitmap sector "map_i" */
+static u32 amap_sect_bits(struct super_block *sb, u32 map_i)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	u32 bits = (u32)sb->s_blocksize << 3;
+	u32 total = fsi->num_clusters - CLUS_BASE;
+
+	return min(bits, total - map_i * bits);
+}
+
+/*
+ * Build the per bitmap sector free cluster counts on first use, so the
+ * allocator can skip full sectors. The bitmap sectors are already held
+ * in vol_amap, so this costs no I/O. On failure the plain scan is used.
+ */
+static u32 *get_amap_free(struct super_block *sb)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	u32 *amap_free;
+	u32 i, nbits;
+
+	if (fsi->vol_amap_free)
+		return fsi->vol_amap_free;
+
+	amap_free = kmalloc_array(fsi->map_sectors, sizeof(u32), GFP_NOFS);
+	if (!amap_free)
+		return NULL;
+
+	for (i = 0; i < fsi->map_sectors; i++) {
+		nbits = amap_sect_bits(sb, i);
+		amap_free[i] = nbits - bitmap_weight(
+			(unsigned long *)(fsi->vol_amap[i]->b_data), nbits);
+	}
+
+	fsi->vol_amap_free = amap_free;
+	return amap_free;
 }
 
 /* WARN :
@@ -1146,8 +1187,12 @@ static s32 set_alloc_bitmap(struct super_block *sb, u32 clu)
 	b = clu & (u32)((sb->s_blocksize << 3) - 1);
 
 	sector = CLUS_TO_SECT(fsi, fsi->map_clu) + i;
+	if (fsi->vol_amap_free &&
+	    !test_bit(b, (unsigned long *)(fsi->vol_amap[i]->b_data)))
+		fsi->vol_amap_free[i]--;
 	bitmap_set((unsigned long *)(fsi->vol_amap[i]->b_data), b, 1);
 
+	fsi->alloc_stat.bmap_updates++;
 	return write_sect(sb, sector, fsi->vol_amap[i], 0);
 } /* end of set_alloc_bitmap */
 
@@ -1169,8 +1214,12 @@ static s32 clr_alloc_bitmap(struct super_block *sb, u32 clu)
 
 	sector = CLUS_TO_SECT(fsi, fsi->map_clu) + i;
 
+	if (fsi->vol_amap_free &&
+	    test_bit(b, (unsigned long *)(fsi->vol_amap[i]->b_data)))
+		fsi->vol_amap_free[i]++;
 	bitmap_clear((unsigned long *)(fsi->vol_amap[i]->b_data), b, 1);
 
+	fsi->alloc_stat.bmap_updates++;
 	ret = write_sect(sb, sector, fsi->vol_amap[i], 0);
 
 	if (opts->discard) {
@@ -1200,6 +1249,35 @@ static u32 test_alloc_bitmap(struct super_block *sb, u32 clu)
 	u32 clu_base, clu_free;
 	u8 k, clu_mask;
 	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	u32 *amap_free = get_amap_free(sb);
+
+	if (amap_free) {
+		u32 bits = (u32)sb->s_blocksize << 3;
+
+		/* one extra round revisits the head of the first sector */
+		map_i = clu / bits;
+		map_b = clu % bits;
+		for (i = 0; i <= fsi->map_sectors; i++) {
+			if (amap_free[map_i]) {
+				u32 nbits = amap_sect_bits(sb, map_i);
+
+				fsi->alloc_stat.bmap_searched++;
+				map_b = find_next_zero_bit(
+					(unsigned long *)(fsi->vol_amap[map_i]->b_data),
+					nbits, map_b);
+				if (map_b < nbits)
+					return map_i * bits + map_b + CLUS_BASE;
+			} else {
+				fsi->alloc_stat.bmap_skipped++;
+			}
+
+			map_b = 0;
+			if ((++map_i) >= fsi->map_sectors)
+				map_i = 0;
+		}
+
+		return CLUS_EOF;
+	}
 
 	clu_base = (clu & ~(0x7)) + 2;
 	clu_mask = (1 << (clu - clu_base + 2)) - 1;
@@ -1247,9 +1325,13 @@ void sync_alloc_bmp(struct super_block *sb)
 
 static s32 exfat_chain_cont_cluster(struct super_block *sb, u32 chain, u32 len)
 {
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+
 	if (!len)
 		return 0;
 
+	fsi->alloc_stat.fat_updates += len;
+
 	while (len > 1) {
 		if (fat_ent_set(sb, chain, chain+1))
 			return -EIO;
@@ -1415,6 +1497,7 @@ static s32 exfat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p
 
 		/* update FAT table */
 		if (p_chain->flags == 0x01) {
+			fsi->alloc_stat.fat_updates++;
 			if (fat_ent_set(sb, new_clu, CLUS_EOF)) {
 				ret = -EIO;
 				goto error;
@@ -1424,6 +1507,7 @@ static s32 exfat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p
 		if (IS_CLUS_EOF(p_chain->dir)) {
 			p_chain->dir = new_clu;
 		} else if (p_chain->flags == 0x01) {
+			fsi->alloc_stat.fat_updates++;
 			if (fat_ent_set(sb, last_clu, new_clu)) {
 				ret = -EIO;
 				goto error;
@@ -4707,6 +4707,18 @@ static ssize_t fullau_show(struct sdfat_sb_info *sbi, char *buf)
 }
 SDFAT_ATTR(fullau, 0444, fullau_show, NULL);
 
+static ssize_t alloc_stat_show(struct sdfat_sb_info *sbi, char *buf)
+{
+	FS_INFO_T *fsi = &(sbi->fsi);
+
+	return snprintf(buf, PAGE_SIZE,
+		"bmap_updates %llu\nfat_updates %llu\n"
+		"bmap_searched %llu\nbmap_skipped %llu\n",
+		fsi->alloc_stat.bmap_updates, fsi->alloc_stat.fat_updates,
+		fsi->alloc_stat.bmap_searched, fsi->alloc_stat.bmap_skipped);
+}
+SDFAT_ATTR(alloc_stat, 0444, alloc_stat_show, NULL);
+
 static struct attribute *sdfat_attrs[] = {
 	&sdfat_attr_type.attr,
 	&sdfat_attr_eio.attr,
@@ -4714,6 +4726,7 @@ static struct attribute *sdfat_attrs[] = {
 	&sdfat_attr_totalau.attr,
 	&sdfat_attr_cleanau.attr,
 	&sdfat_attr_fullau.attr,
+	&sdfat_attr_alloc_stat.attr,
 	NULL,
 };
 
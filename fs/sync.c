@@ -16,6 +16,7 @@
 #include <linux/pagemap.h>
 #include <linux/quotaops.h>
 #include <linux/backing-dev.h>
+#include <linux/delayacct.h>
 #include "internal.h"
 
 bool fsync_enabled = true;
@@ -190,6 +191,8 @@ SYSCALL_DEFINE1(syncfs, int, fd)
 int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
 {
 	struct inode *inode = file->f_mapping->host;
+	bool outer;
+	int ret;
 
 	if (!fsync_enabled)
 		return 0;
@@ -202,7 +205,13 @@ int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
 		spin_unlock(&inode->i_lock);
 		mark_inode_dirty_sync(inode);
 	}
-	return file->f_op->fsync(file, start, end, datasync);
+
+	outer = delayacct_fsync_start();
+	ret = file->f_op->fsync(file, start, end, datasync);
+	if (outer)
+		delayacct_fsync_end();
+
+	return ret;
 }
 EXPORT_SYMBOL(vfs_fsync_range);
 
@@ -138,6 +138,9 @@ struct backing_dev_info {
 	struct list_head bdi_list;
 	unsigned long ra_pages;	/* max readahead in PAGE_CACHE_SIZE units */
 	unsigned long io_pages;	/* max allowed IO size */
+	unsigned int ra_adaptive; /* size windows by per-file hit ratio */
+	atomic_long_t ra_read;	/* pages read by readahead windows */
+	atomic_long_t ra_wasted; /* ... of which never accessed */
 	unsigned int capabilities; /* Device capabilities */
 	congested_fn *congested_fn; /* Function pointer if device is md/dm */
 	void *congested_data;	/* Pointer to aux data for congested func */
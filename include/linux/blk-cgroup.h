@@ -681,6 +681,11 @@ static inline bool blk_throtl_bio(struct request_queue *q, struct blkcg_gq *blkg
 				  struct bio *bio) { return false; }
 #endif
 
+#ifdef CONFIG_BLK_CGROUP_IOLATENCY
+extern void blk_iolatency_throttle(struct request_queue *q,
+				   struct blkcg_gq *blkg, struct bio *bio);
+#endif
+
 static inline bool blkcg_bio_issue_check(struct request_queue *q,
 					 struct bio *bio)
 {
@@ -707,9 +712,17 @@ static inline bool blkcg_bio_issue_check(struct request_queue *q,
 		blkg_rwstat_add(&blkg->stat_bytes, bio->bi_rw,
 				bio->bi_iter.bi_size);
 		blkg_rwstat_add(&blkg->stat_ios, bio->bi_rw, 1);
+#ifdef CONFIG_BLK_CGROUP_IOLATENCY
+		blkg_get(blkg);
+#endif
 	}
 
 	rcu_read_unlock();
+#ifdef CONFIG_BLK_CGROUP_IOLATENCY
+	/* may sleep, outside of the rcu read section */
+	if (!throtl)
+		blk_iolatency_throttle(q, blkg, bio);
+#endif
 	return !throtl;
 }
 
@@ -62,6 +62,8 @@ struct blk_mq_hw_ctx {
 
 	unsigned long		poll_invoked;
 	unsigned long		poll_success;
+
+	void			*sched_data;
 };
 
 struct blk_mq_tag_set {
@@ -147,6 +149,34 @@ struct blk_mq_ops {
 	exit_request_fn		*exit_request;
 };
 
+/*
+ * Dispatch ordering for blk-mq queues. The requests pulled from the
+ * software queues on a hardware queue run are handed to the scheduler,
+ * which then gives them back one at a time for as long as the driver
+ * accepts them. A scheduler does not hold requests back on an idle queue,
+ * it only decides the order. All hooks may run concurrently on several
+ * CPUs for the same hardware queue and can't sleep.
+ */
+struct blk_mq_sched_ops {
+	/* allocate and free hctx->sched_data, the scheduler is empty on exit */
+	int (*init_hctx)(struct blk_mq_hw_ctx *);
+	void (*exit_hctx)(struct blk_mq_hw_ctx *);
+
+	/* take all the requests on the list */
+	void (*insert_requests)(struct blk_mq_hw_ctx *, struct list_head *);
+
+	/* next request to issue, NULL if there are none */
+	struct request *(*dispatch_request)(struct blk_mq_hw_ctx *);
+	bool (*has_work)(struct blk_mq_hw_ctx *);
+
+	const char		*name;
+	struct module		*owner;
+	struct list_head	list;
+};
+
+int blk_mq_sched_register(struct blk_mq_sched_ops *ops);
+void blk_mq_sched_unregister(struct blk_mq_sched_ops *ops);
+
 enum {
 	BLK_MQ_RQ_QUEUE_OK	= 0,	/* queued fine */
 	BLK_MQ_RQ_QUEUE_BUSY	= 1,	/* requeue IO for later */
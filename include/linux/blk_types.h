@@ -92,6 +92,11 @@ struct bio {
 	 */
 	struct io_context	*bi_ioc;
 	struct cgroup_subsys_state *bi_css;
+#endif
+#ifdef CONFIG_BLK_CGROUP_IOLATENCY
+	/* group accounted by blk-iolatency and when, until completion */
+	struct blkcg_gq		*bi_iolat_blkg;
+	u64			bi_iolat_start;
 #endif
 	union {
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
@@ -220,6 +225,7 @@ enum rq_flag_bits {
 	__REQ_MQ_INFLIGHT,	/* track inflight for MQ */
 	__REQ_NO_TIMEOUT,	/* requests may never expire */
 	__REQ_URGENT,		/* urgent request */
+	__REQ_POLLED,		/* blk_poll() already waited on this one */
 	__REQ_NR_BITS,		/* stops here */
 };
 
@@ -233,6 +239,7 @@ enum rq_flag_bits {
 #define REQ_DISCARD		(1ULL << __REQ_DISCARD)
 #define REQ_WRITE_SAME		(1ULL << __REQ_WRITE_SAME)
 #define REQ_URGENT		(1ULL << __REQ_URGENT)
+#define REQ_POLLED		(1ULL << __REQ_POLLED)
 #define REQ_NOIDLE		(1ULL << __REQ_NOIDLE)
 #define REQ_INTEGRITY		(1ULL << __REQ_INTEGRITY)
 
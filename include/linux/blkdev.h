@@ -152,6 +152,7 @@ struct request {
 	struct gendisk *rq_disk;
 	struct hd_struct *part;
 	unsigned long start_time;
+	ktime_t poll_start;		/* first blk_poll() on it */
 #ifdef CONFIG_BLK_CGROUP
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
@@ -240,6 +241,17 @@ enum blk_queue_state {
 	Queue_up,
 };
 
+/*
+ * Completion time of polled requests, by size starting at 4k and doubling
+ * with each bucket.
+ */
+#define BLK_POLL_STAT_BUCKETS	6
+
+struct blk_poll_stat {
+	u64		mean_ns;
+	unsigned long	nr;
+};
+
 struct blk_queue_tag {
 	struct request **tag_index;	/* map of busy tags */
 	unsigned long *tag_map;		/* bit map of free/busy tags */
@@ -315,6 +327,7 @@ struct request_queue {
 	lld_busy_fn		*lld_busy_fn;
 
 	struct blk_mq_ops	*mq_ops;
+	struct blk_mq_sched_ops	*mq_sched;
 
 	unsigned int		*mq_map;
 
@@ -326,6 +339,14 @@ struct request_queue {
 	struct blk_mq_hw_ctx	**queue_hw_ctx;
 	unsigned int		nr_hw_queues;
 
+	/*
+	 * Hybrid polling: -1 spins right away, 0 sleeps for half the mean
+	 * completion time of the request size first, otherwise the fixed
+	 * number of ns to sleep.
+	 */
+	int			poll_nsec;
+	struct blk_poll_stat	poll_stat[BLK_POLL_STAT_BUCKETS];
+
 	/*
 	 * Dispatch queue sorting
 	 */
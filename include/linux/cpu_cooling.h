@@ -67,6 +67,10 @@ of_cpufreq_power_cooling_register(struct device_node *np,
 				  const struct cpumask *clip_cpus,
 				  u32 capacitance,
 				  get_static_t plat_static_func);
+
+struct thermal_cooling_device *
+of_cpufreq_energy_cooling_register(struct device_node *np,
+				   const struct cpumask *clip_cpus);
 #else
 static inline struct thermal_cooling_device *
 of_cpufreq_cooling_register(struct device_node *np,
@@ -83,6 +87,13 @@ of_cpufreq_power_cooling_register(struct device_node *np,
 {
 	return NULL;
 }
+
+static inline struct thermal_cooling_device *
+of_cpufreq_energy_cooling_register(struct device_node *np,
+				   const struct cpumask *clip_cpus)
+{
+	return ERR_PTR(-ENOSYS);
+}
 #endif
 
 /**
@@ -121,6 +132,13 @@ of_cpufreq_power_cooling_register(struct device_node *np,
 	return NULL;
 }
 
+static inline struct thermal_cooling_device *
+of_cpufreq_energy_cooling_register(struct device_node *np,
+				   const struct cpumask *clip_cpus)
+{
+	return ERR_PTR(-ENOSYS);
+}
+
 static inline struct thermal_cooling_device *
 cpufreq_platform_cooling_register(const struct cpumask *clip_cpus,
 					struct cpu_cooling_ops *ops)
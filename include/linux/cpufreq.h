@@ -182,6 +182,8 @@ int cpufreq_update_policy(unsigned int cpu);
 bool have_governor_per_policy(void);
 bool cpufreq_driver_is_slow(void);
 struct kobject *get_governor_parent_kobj(struct cpufreq_policy *policy);
+void cpufreq_update_thermal_cap(const struct cpumask *cpus,
+				unsigned long max_freq);
 #else
 static inline unsigned int cpufreq_get(unsigned int cpu)
 {
@@ -196,6 +198,8 @@ static inline unsigned int cpufreq_quick_get_max(unsigned int cpu)
 	return 0;
 }
 static inline void disable_cpufreq(void) { }
+static inline void cpufreq_update_thermal_cap(const struct cpumask *cpus,
+					      unsigned long max_freq) { }
 #endif
 
 /*********************************************************************
@@ -535,6 +539,13 @@ extern struct cpufreq_governor cpufreq_gov_schedutil;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_schedutil)
 #endif
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL
+void sugov_set_input_boost(int cpu, unsigned int freq, unsigned long expires);
+#else
+static inline void sugov_set_input_boost(int cpu, unsigned int freq,
+					 unsigned long expires) {}
+#endif
+
 static inline void cpufreq_policy_apply_limits(struct cpufreq_policy *policy)
 {
 	if (policy->max < policy->cur)
@@ -27,6 +27,7 @@
  */
 #define DELAYACCT_PF_SWAPIN	0x00000001	/* I am doing a swapin */
 #define DELAYACCT_PF_BLKIO	0x00000002	/* I am waiting on IO */
+#define DELAYACCT_PF_FSYNC	0x00000004	/* I am in fsync */
 
 #ifdef CONFIG_TASK_DELAY_ACCT
 
@@ -41,6 +42,10 @@ extern int __delayacct_add_tsk(struct taskstats *, struct task_struct *);
 extern __u64 __delayacct_blkio_ticks(struct task_struct *);
 extern void __delayacct_freepages_start(void);
 extern void __delayacct_freepages_end(void);
+extern void __delayacct_io_wait_start(void);
+extern void __delayacct_io_wait_end(int kind);
+extern void __delayacct_fsync_start(void);
+extern void __delayacct_fsync_end(void);
 
 static inline int delayacct_is_task_waiting_on_io(struct task_struct *p)
 {
@@ -121,6 +126,37 @@ static inline void delayacct_freepages_end(void)
 		__delayacct_freepages_end();
 }
 
+static inline void delayacct_io_wait_start(void)
+{
+	if (current->delays)
+		__delayacct_io_wait_start();
+}
+
+/* @kind is one of TASKSTATS_IO_READ or TASKSTATS_IO_WRITE */
+static inline void delayacct_io_wait_end(int kind)
+{
+	if (current->delays)
+		__delayacct_io_wait_end(kind);
+}
+
+/*
+ * Returns true if this is the outermost fsync of the task, which then
+ * has to be ended with delayacct_fsync_end().
+ */
+static inline bool delayacct_fsync_start(void)
+{
+	if (!current->delays || (current->delays->flags & DELAYACCT_PF_FSYNC))
+		return false;
+	__delayacct_fsync_start();
+	return true;
+}
+
+static inline void delayacct_fsync_end(void)
+{
+	if (current->delays)
+		__delayacct_fsync_end();
+}
+
 #else
 static inline void delayacct_set_flag(int flag)
 {}
@@ -147,6 +183,14 @@ static inline void delayacct_freepages_start(void)
 {}
 static inline void delayacct_freepages_end(void)
 {}
+static inline void delayacct_io_wait_start(void)
+{}
+static inline void delayacct_io_wait_end(int kind)
+{}
+static inline bool delayacct_fsync_start(void)
+{ return false; }
+static inline void delayacct_fsync_end(void)
+{}
 
 #endif /* CONFIG_TASK_DELAY_ACCT */
 
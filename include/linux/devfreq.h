@@ -20,6 +20,7 @@
 #define DEVFREQ_NAME_LEN 16
 
 struct devfreq;
+struct thermal_cooling_device;
 
 /**
  * struct devfreq_dev_status - Data given from devfreq user device to
@@ -148,6 +149,7 @@ struct devfreq_governor {
  * @trans_table:	Statistics of devfreq transitions
  * @time_in_state:	Statistics of devfreq states
  * @last_stat_updated:	The last time stat updated
+ * @cdev:	cooling device registered for the device from DT, if any
  *
  * This structure stores the devfreq information for a give device.
  *
@@ -187,6 +189,8 @@ struct devfreq {
 	unsigned long last_stat_updated;
 
 	bool dev_suspended;
+
+	struct thermal_cooling_device *cdev;
 };
 
 #if defined(CONFIG_PM_DEVFREQ)
@@ -15,6 +15,7 @@ enum df_device {
 #ifdef CONFIG_DEVFREQ_BOOST
 void devfreq_boost_kick(enum df_device device);
 void devfreq_boost_kick_max(enum df_device device, unsigned int duration_ms);
+void devfreq_boost_frame(unsigned int frame_us, unsigned int period_us);
 void devfreq_register_boost_device(enum df_device device, struct devfreq *df);
 #else
 static inline
@@ -26,6 +27,10 @@ void devfreq_boost_kick_max(enum df_device device, unsigned int duration_ms)
 {
 }
 static inline
+void devfreq_boost_frame(unsigned int frame_us, unsigned int period_us)
+{
+}
+static inline
 void devfreq_register_boost_device(enum df_device device, struct devfreq *df)
 {
 }
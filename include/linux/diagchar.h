@@ -936,4 +936,30 @@ static const uint32_t log_code_last_tbl[] = {
 #define LOG_SIZE_TO_ITEMS(size)		((8*size) - 7)
 #define EVENT_COUNT_TO_BYTES(count)	((count/8) + 1)
 
+/*
+ * Memory device ring, mapped by mmap() on the diag node once the client
+ * is in memory device mode. The mapping is one header page followed by
+ * a power of two sized data area. The kernel appends records at head,
+ * the client consumes them and advances tail; both are free running
+ * byte counts. Records are 8 byte aligned and never wrap: a record with
+ * len DIAG_MD_RING_WRAP means the rest of the area is unused and the
+ * next one starts at offset 0. poll() reports POLLIN once watermark
+ * bytes are pending or the oldest pending record is a few ms old.
+ */
+#define DIAG_MD_RING_WRAP	0xFFFFFFFF
+
+struct diag_md_ring_hdr {
+	uint32_t size;		/* bytes in the data area */
+	uint32_t data_offset;	/* data area offset within the mapping */
+	uint32_t head;		/* written by the kernel */
+	uint32_t tail;		/* written by the client */
+	uint32_t watermark;	/* client set wakeup threshold, in bytes */
+	uint32_t dropped;	/* packets lost to a full ring */
+};
+
+struct diag_md_ring_rec {
+	uint32_t len;		/* payload bytes, or DIAG_MD_RING_WRAP */
+	int32_t token;		/* remote proc token, 0 for local data */
+};
+
 #endif
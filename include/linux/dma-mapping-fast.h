@@ -17,6 +17,29 @@
 #include <linux/io-pgtable-fast.h>
 
 struct dma_iommu_mapping;
+struct dentry;
+
+#define FAST_IOVA_CACHE_ORDERS	3
+#define FAST_IOVA_MAG_SIZE	16
+
+/* iovas of one size, all still set in the mapping bitmap */
+struct dma_fast_smmu_mag {
+	unsigned int	nr;
+	dma_addr_t	iovas[FAST_IOVA_MAG_SIZE];
+};
+
+/*
+ * Per-cpu iova cache. @clean holds iovas taken from the bitmap and not
+ * used yet, @dirty holds unmapped iovas waiting to be freed back to the
+ * bitmap in a batch.
+ */
+struct dma_fast_smmu_cache {
+	spinlock_t	lock;
+	struct dma_fast_smmu_mag clean[FAST_IOVA_CACHE_ORDERS];
+	struct dma_fast_smmu_mag dirty[FAST_IOVA_CACHE_ORDERS];
+	unsigned long	hits;
+	unsigned long	misses;
+};
 
 struct dma_fast_smmu_mapping {
 	struct device		*dev;
@@ -38,6 +61,11 @@ struct dma_fast_smmu_mapping {
 	struct notifier_block notifier;
 
 	int		is_smmu_pt_coherent;
+
+	struct dma_fast_smmu_cache __percpu *caches;
+	atomic_long_t	lock_contended;
+	unsigned long	stale_tlb_flushes;
+	struct dentry	*debugfs;
 };
 
 #ifdef CONFIG_IOMMU_IO_PGTABLE_FAST
@@ -40,6 +40,7 @@ static inline bool freezing(struct task_struct *p)
 
 /* Takes and releases task alloc lock using task_lock() */
 extern void __thaw_task(struct task_struct *t);
+extern void thaw_tasks(struct task_struct **tasks, int nr);
 
 extern bool __refrigerator(bool check_kthr_stop);
 extern int freeze_processes(void);
@@ -67,6 +68,7 @@ static inline bool try_to_freeze(void)
 }
 
 extern bool freeze_task(struct task_struct *p);
+extern int freeze_tasks(struct task_struct **tasks, int nr);
 extern bool set_freezable(void);
 
 #ifdef CONFIG_CGROUP_FREEZER
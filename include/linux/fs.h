@@ -896,6 +896,10 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	unsigned int hits;		/* window pages accessed so far */
+	unsigned int nr_read;		/* window pages read from disk */
+	unsigned int waste_pct;		/* decaying % of unused readahead */
 };
 
 /*
@@ -907,6 +911,15 @@ static inline int ra_has_index(struct file_ra_state *ra, pgoff_t index)
 		index <  ra->start + ra->size);
 }
 
+/*
+ * Note a page cache hit at @index, for the readahead hit ratio.
+ */
+static inline void ra_note_hit(struct file_ra_state *ra, pgoff_t index)
+{
+	if (ra_has_index(ra, index) && ra->hits < ra->size)
+		ra->hits++;
+}
+
 struct file {
 	union {
 		struct llist_node	fu_llist;
@@ -104,6 +104,23 @@ static inline void fscrypt_put_encryption_info(struct inode *inode,
 	return;
 }
 
+static inline bool fscrypt_using_hardware_encryption(const struct inode *inode)
+{
+	return false;
+}
+
+static inline bool fscrypt_policy_uses_hardware_encryption(struct inode *inode)
+{
+	return false;
+}
+
+static inline int fscrypt_is_ice_encryption_info_equal(
+					const struct inode *inode1,
+					const struct inode *inode2)
+{
+	return 1;
+}
+
  /* fname.c */
 static inline int fscrypt_setup_filename(struct inode *dir,
 					 const struct qstr *iname,
@@ -83,6 +83,21 @@ extern int fscrypt_inherit_context(struct inode *, struct inode *,
 /* keyinfo.c */
 extern int fscrypt_get_encryption_info(struct inode *);
 extern void fscrypt_put_encryption_info(struct inode *, struct fscrypt_info *);
+extern bool fscrypt_using_hardware_encryption(const struct inode *);
+extern bool fscrypt_policy_uses_hardware_encryption(struct inode *);
+
+/* fscrypt_ice.c */
+#ifdef CONFIG_FS_ENCRYPTION_ICE
+extern int fscrypt_is_ice_encryption_info_equal(const struct inode *,
+						const struct inode *);
+#else
+static inline int fscrypt_is_ice_encryption_info_equal(
+					const struct inode *inode1,
+					const struct inode *inode2)
+{
+	return 1;
+}
+#endif
 
 /* fname.c */
 extern int fscrypt_setup_filename(struct inode *, const struct qstr *,
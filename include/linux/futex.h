@@ -77,6 +77,10 @@ void futex_exit_recursive(struct task_struct *tsk);
 void futex_exit_release(struct task_struct *tsk);
 void futex_exec_release(struct task_struct *tsk);
 
+extern int sysctl_futex_private_hash_threads;
+void futex_private_hash_check(struct mm_struct *mm, int nr_threads);
+void futex_private_hash_free(struct mm_struct *mm);
+
 long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	      u32 __user *uaddr2, u32 val2, u32 val3);
 #else
@@ -84,5 +88,8 @@ static inline void futex_init_task(struct task_struct *tsk) { }
 static inline void futex_exit_recursive(struct task_struct *tsk) { }
 static inline void futex_exit_release(struct task_struct *tsk) { }
 static inline void futex_exec_release(struct task_struct *tsk) { }
+static inline void futex_private_hash_check(struct mm_struct *mm,
+					    int nr_threads) { }
+static inline void futex_private_hash_free(struct mm_struct *mm) { }
 #endif
 #endif
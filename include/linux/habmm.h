@@ -340,6 +340,66 @@ int32_t habmm_import(int32_t handle, void **buff_shared, uint32_t size_bytes,
 int32_t habmm_unimport(int32_t handle, uint32_t export_id, void *buff_shared,
 		uint32_t flags);
 
+/*
+ * Buffer pool descriptor: names size bytes at offset within a buffer the
+ * sender exported with habmm_export() and the receiver already imported
+ * with habmm_import(). cookie is passed through untouched.
+ */
+struct habmm_pool_desc {
+	uint32_t export_id;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t cookie;
+};
+
+#define HABMM_POOL_BATCH_MAX 64
+
+/*
+ * Description:
+ *
+ * Pass buffer pool descriptors to the remote side. The exports stay in place,
+ * only the descriptors go through the channel, all of them in one message
+ * with a single notification of the remote VM. A channel carrying pool
+ * descriptors should not be used for habmm_socket_send() messages too.
+ * Supported only for kernel clients.
+ *
+ * Params:
+ *
+ * in handle - communication channel created by habmm_socket_open
+ * in descs - descriptors of ranges within exports on this channel
+ * in count - number of descriptors, at most HABMM_POOL_BATCH_MAX
+ * in flags - HABMM_SOCKET_SEND_FLAGS_NON_BLOCKING
+ *
+ * Return:
+ * status (success/failure/disconnected)
+ *
+ */
+int32_t habmm_pool_send(int32_t handle, struct habmm_pool_desc *descs,
+		uint32_t count, uint32_t flags);
+
+/*
+ * Description:
+ *
+ * Receive one batch of buffer pool descriptors and resolve them against the
+ * imports on this channel.
+ *
+ * Params:
+ *
+ * in handle - communication channel created by habmm_socket_open
+ * out descs - received descriptors
+ * in/out count - size of descs (and bufs) in entries, returns the number of
+ *                descriptors received, or needed on -EOVERFLOW
+ * out bufs - optional, kernel address of each descriptor's payload
+ * in timeout - timeout value, currently not used
+ * in flags - HABMM_SOCKET_RECV_FLAGS_NON_BLOCKING
+ *
+ * Return:
+ * status (success/failure/timeout/disconnected)
+ *
+ */
+int32_t habmm_pool_recv(int32_t handle, struct habmm_pool_desc *descs,
+		uint32_t *count, void **bufs, uint32_t timeout, uint32_t flags);
+
 /*
  * Description:
  *
@@ -22,6 +22,7 @@
 #include <linux/msm_ipc.h>
 #include <linux/device.h>
 #include <linux/kref.h>
+#include <linux/rcupdate.h>
 
 /* Maximum Wakeup Source Name Size */
 #define MAX_WS_NAME_SZ 32
@@ -145,7 +146,11 @@ struct msm_ipc_port {
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
 	uint32_t last_served_svc_id;
+	uint32_t rx_lat_cnt;
+	uint32_t rx_lat_max_us;
+	u64 rx_lat_sum_us;
 	void *priv;
+	struct rcu_head rcu;
 };
 
 #ifdef CONFIG_IPC_ROUTER
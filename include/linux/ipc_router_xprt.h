@@ -21,6 +21,7 @@
 #include <linux/msm_ipc.h>
 #include <linux/ipc_router.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 
 #define IPC_ROUTER_XPRT_EVENT_DATA  1
 #define IPC_ROUTER_XPRT_EVENT_OPEN  2
@@ -110,6 +111,7 @@ struct rr_packet {
 	uint32_t length;
 	struct kref ref;
 	bool ws_need;
+	ktime_t rx_ts;
 };
 
 /**
@@ -0,0 +1,29 @@
+#ifndef _LINUX_LAUNCH_PREFETCH_H
+#define _LINUX_LAUNCH_PREFETCH_H
+
+#include <linux/types.h>
+
+struct file;
+struct mm_struct;
+struct vm_area_struct;
+
+#ifdef CONFIG_LAUNCH_PREFETCH
+void launch_prefetch_exec(struct file *exe);
+void launch_prefetch_fault(struct vm_area_struct *vma, pgoff_t pgoff);
+void launch_prefetch_mm_exit(struct mm_struct *mm);
+#else
+static inline void launch_prefetch_exec(struct file *exe)
+{
+}
+
+static inline void launch_prefetch_fault(struct vm_area_struct *vma,
+					 pgoff_t pgoff)
+{
+}
+
+static inline void launch_prefetch_mm_exit(struct mm_struct *mm)
+{
+}
+#endif
+
+#endif /* _LINUX_LAUNCH_PREFETCH_H */
@@ -292,6 +292,16 @@ int LZ4_decompress_fast(const char *source, char *dest, int originalSize);
 int LZ4_decompress_safe(const char *source, char *dest, int compressedSize,
 	int maxDecompressedSize);
 
+/**
+ * LZ4_decompress_safe_generic() - LZ4_decompress_safe() without arch fast path
+ *
+ * Same as LZ4_decompress_safe(), always using the portable C decoder even
+ * when an architecture specific one is available. Meant for comparing
+ * the two.
+ */
+int LZ4_decompress_safe_generic(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize);
+
 /**
  * LZ4_decompress_safe_partial() - Decompress a block of size 'compressedSize'
  *	at position 'source' into buffer 'dest'
@@ -63,6 +63,18 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_PGPGOUT,	/* # of pages paged out */
 	MEM_CGROUP_EVENTS_PGFAULT,	/* # of page-faults */
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	/* # of major page-faults */
+	MEM_CGROUP_EVENTS_WORKINGSET_REFAULT,	/* refaults of evicted pages */
+	MEM_CGROUP_EVENTS_WORKINGSET_ACTIVATE,	/* refaults activated */
+	/*
+	 * Refault distance histogram, in percent of the active file list
+	 * the distance is compared against for activation.
+	 */
+	MEM_CGROUP_EVENTS_REFAULT_DIST_25,
+	MEM_CGROUP_EVENTS_REFAULT_DIST_50,
+	MEM_CGROUP_EVENTS_REFAULT_DIST_100,
+	MEM_CGROUP_EVENTS_REFAULT_DIST_200,
+	MEM_CGROUP_EVENTS_REFAULT_DIST_400,
+	MEM_CGROUP_EVENTS_REFAULT_DIST_MORE,
 	MEM_CGROUP_EVENTS_NSTATS,
 	/* default hierarchy events */
 	MEMCG_LOW = MEM_CGROUP_EVENTS_NSTATS,
@@ -72,6 +84,19 @@ enum mem_cgroup_events_index {
 	MEMCG_NR_EVENTS,
 };
 
+/*
+ * Reclaim priority classes, ordered from the first to be reclaimed to the
+ * last. Global reclaim and kswapd work through the classes in this order
+ * and may stop before reaching the more protected ones.
+ */
+enum mem_cgroup_reclaim_class {
+	MEMCG_RECLAIM_CACHED,
+	MEMCG_RECLAIM_DEFAULT,
+	MEMCG_RECLAIM_VISIBLE,
+	MEMCG_RECLAIM_FOREGROUND,
+	NR_MEMCG_RECLAIM_CLASSES,
+};
+
 /*
  * Per memcg event counter is incremented at every pagein/pageout. With THP,
  * it will be incremated by the number of pages. This counter is used for
@@ -218,6 +243,8 @@ struct mem_cgroup {
 	int		under_oom;
 
 	int	swappiness;
+	/* enum mem_cgroup_reclaim_class */
+	int	reclaim_class;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -299,6 +326,19 @@ static inline void mem_cgroup_events(struct mem_cgroup *memcg,
 	cgroup_file_notify(&memcg->events_file);
 }
 
+/*
+ * Count an event against the memcg @page is charged to. Unlike
+ * mem_cgroup_events(), this doesn't notify memory.events watchers.
+ */
+static inline void mem_cgroup_page_event(struct page *page,
+					 enum mem_cgroup_events_index idx)
+{
+	struct mem_cgroup *memcg = page->mem_cgroup;
+
+	if (memcg)
+		this_cpu_inc(memcg->stat->events[idx]);
+}
+
 bool mem_cgroup_low(struct mem_cgroup *root, struct mem_cgroup *memcg);
 
 int mem_cgroup_try_charge(struct page *page, struct mm_struct *mm,
@@ -360,6 +400,22 @@ static inline bool mem_cgroup_disabled(void)
 	return !cgroup_subsys_enabled(memory_cgrp_subsys);
 }
 
+/* Number of memcgs with a reclaim class other than the default */
+extern atomic_t memcg_reclaim_classes_used;
+
+static inline bool mem_cgroup_reclaim_classes_enabled(void)
+{
+	return atomic_read(&memcg_reclaim_classes_used) > 0;
+}
+
+static inline int mem_cgroup_reclaim_class(struct mem_cgroup *memcg)
+{
+	if (mem_cgroup_disabled() || !memcg)
+		return MEMCG_RECLAIM_DEFAULT;
+
+	return READ_ONCE(memcg->reclaim_class);
+}
+
 /*
  * For memory reclaim.
  */
@@ -513,12 +569,27 @@ static inline void mem_cgroup_events(struct mem_cgroup *memcg,
 {
 }
 
+static inline void mem_cgroup_page_event(struct page *page,
+					 enum mem_cgroup_events_index idx)
+{
+}
+
 static inline bool mem_cgroup_low(struct mem_cgroup *root,
 				  struct mem_cgroup *memcg)
 {
 	return false;
 }
 
+static inline bool mem_cgroup_reclaim_classes_enabled(void)
+{
+	return false;
+}
+
+static inline int mem_cgroup_reclaim_class(struct mem_cgroup *memcg)
+{
+	return MEMCG_RECLAIM_DEFAULT;
+}
+
 static inline int mem_cgroup_try_charge(struct page *page, struct mm_struct *mm,
 					gfp_t gfp_mask,
 					struct mem_cgroup **memcgp)
@@ -531,6 +531,14 @@ struct mm_struct {
 #ifdef CONFIG_MSM_APP_SETTINGS
 	int app_setting;
 #endif
+#ifdef CONFIG_LAUNCH_PREFETCH
+	/* see mm/launch_prefetch.c */
+	struct launch_record *launch_rec;
+#endif
+#ifdef CONFIG_FUTEX
+	/* see kernel/futex.c */
+	struct futex_private_hash *futex_hash;
+#endif
 
 	struct work_struct async_put_work;
 };
@@ -143,6 +143,8 @@ extern int mmc_cmdq_discard_queue(struct mmc_host *host, u32 tasks);
 extern int mmc_cmdq_halt(struct mmc_host *host, bool enable);
 extern int mmc_cmdq_halt_on_empty_queue(struct mmc_host *host);
 extern void mmc_cmdq_post_req(struct mmc_host *host, int tag, int err);
+extern void mmc_cmdq_account_lat(struct mmc_host *host,
+				 struct mmc_cmdq_req *cmdq_req);
 extern int mmc_cmdq_start_req(struct mmc_host *host,
 			      struct mmc_cmdq_req *cmdq_req);
 extern int mmc_cmdq_prepare_flush(struct mmc_command *cmd);
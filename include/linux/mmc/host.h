@@ -216,6 +216,39 @@ struct mmc_cmdq_req {
 	bool			skip_err_handling;
 	int			tag; /* used for command queuing */
 	u8			ctx_id;
+	/* doorbell and completion interrupt times, for cmdq_lat */
+	ktime_t			doorbell;
+	ktime_t			complete;
+};
+
+/*
+ * Always-on CMDQ latency histograms, split by direction and request size.
+ * Stages are queue (handed to the host driver until the doorbell),
+ * device (doorbell until the completion interrupt) and completion
+ * (interrupt until the request is post processed). Bucket i counts
+ * latencies below 2^i us, the last one everything above.
+ */
+enum mmc_cmdq_lat_stage {
+	MMC_CMDQ_LAT_QUEUE,
+	MMC_CMDQ_LAT_DEVICE,
+	MMC_CMDQ_LAT_COMPLETION,
+	MMC_CMDQ_LAT_STAGES,
+};
+
+enum mmc_cmdq_lat_size {
+	MMC_CMDQ_LAT_4K,
+	MMC_CMDQ_LAT_16K,
+	MMC_CMDQ_LAT_64K,
+	MMC_CMDQ_LAT_LARGE,
+	MMC_CMDQ_LAT_SIZES,
+};
+
+#define MMC_CMDQ_LAT_BUCKETS	24
+
+struct mmc_cmdq_lat_stats {
+	spinlock_t lock;
+	u32 hist[2][MMC_CMDQ_LAT_SIZES][MMC_CMDQ_LAT_STAGES]
+		[MMC_CMDQ_LAT_BUCKETS];
 };
 
 struct mmc_async_req {
@@ -591,6 +624,7 @@ struct mmc_host {
 	int num_cq_slots;
 	int dcmd_cq_slot;
 	bool			cmdq_thist_enabled;
+	struct mmc_cmdq_lat_stats	cmdq_lat;
 	/*
 	 * several cmdq supporting host controllers are extensions
 	 * of legacy controllers. This variable can be used to store
@@ -276,6 +276,16 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/*
+	 * Orders 1..PAGE_ALLOC_COSTLY_ORDER are cached separately so that
+	 * they can not crowd out order-0 pages. The counters are in base
+	 * pages, hhigh == 0 disables the high-order lists.
+	 */
+	int hcount;
+	int hhigh;
+	int hbatch;
+	struct list_head hlists[PAGE_ALLOC_COSTLY_ORDER][MIGRATE_PCPTYPES];
 };
 
 struct per_cpu_pageset {
@@ -864,6 +874,8 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *, int,
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES-1];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
+int percpu_highorder_pagelist_ratio_sysctl_handler(struct ctl_table *, int,
+					void __user *, size_t *, loff_t *);
 int percpu_pagelist_fraction_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 int sysctl_min_unmapped_ratio_sysctl_handler(struct ctl_table *, int,
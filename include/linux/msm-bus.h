@@ -66,6 +66,18 @@ struct msm_bus_scale_pdata {
 	unsigned int active_only;
 };
 
+/*
+ * Vote statistics kept by the adhoc arbiter for every client: number of
+ * update requests, total and worst time spent arbitrating them, and the
+ * registration time to turn the count into a vote rate.
+ */
+struct msm_bus_vote_stats {
+	u64 num_votes;
+	u64 arb_ns;
+	u64 max_arb_ns;
+	unsigned long reg_jiffies;
+};
+
 struct msm_bus_client_handle {
 	char *name;
 	int mas;
@@ -77,6 +89,8 @@ struct msm_bus_client_handle {
 	u64 cur_slp_ib;
 	u64 cur_slp_ab;
 	bool active_only;
+	struct msm_bus_vote_stats stats;
+	struct list_head link;
 };
 
 /* Scaling APIs */
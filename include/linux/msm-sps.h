@@ -1003,6 +1003,55 @@ int sps_register_event(struct sps_pipe *h, struct sps_register_event *reg);
 int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 		     void *user, u32 flags);
 
+/**
+ * Perform a batch of DMA transfers on an SPS connection end point
+ *
+ * This function submits count single buffer transfers, each with its own
+ * flags and user pointer, and notifies the hardware once for the whole
+ * batch. The I/O vectors are given in the same form as for sps_transfer(),
+ * and each flags field takes the same values as for sps_transfer_one().
+ *
+ * The batch is rejected up front if the descriptor FIFO does not have
+ * room for all of it.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of count I/O vectors
+ *
+ * @user - array of count user pointers returned as part of the event
+ *  payloads, or NULL
+ *
+ * @count - number of transfers
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_transfer_multi(struct sps_pipe *h, struct sps_iovec *iovec,
+		       void **user, u32 count);
+
+/**
+ * Configure interrupt coalescing on an SPS connection end point
+ *
+ * With coalescing, only every count-th descriptor requesting an INT
+ * (DESC_DONE) interrupt gets one. The descriptors in between are
+ * reported together with it, or timeout_us after their submission,
+ * whichever comes first. EOT interrupts are not affected.
+ *
+ * A producer pipe reports the descriptors in between only if they
+ * were given a user pointer. A consumer pipe reports all of them.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @count - descriptors per interrupt, 0 or 1 to disable coalescing
+ *
+ * @timeout_us - completion poll delay in microseconds, must be non zero
+ *  when coalescing is enabled
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_set_irq_coalescing(struct sps_pipe *h, u32 count, u32 timeout_us);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -1492,6 +1541,19 @@ static inline int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr,
 	return -EPERM;
 }
 
+static inline int sps_transfer_multi(struct sps_pipe *h,
+				     struct sps_iovec *iovec, void **user,
+				     u32 count)
+{
+	return -EPERM;
+}
+
+static inline int sps_set_irq_coalescing(struct sps_pipe *h, u32 count,
+					 u32 timeout_us)
+{
+	return -EPERM;
+}
+
 static inline int sps_get_event(struct sps_pipe *h,
 				struct sps_event_notify *event)
 {
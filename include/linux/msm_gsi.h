@@ -988,6 +988,25 @@ int gsi_set_channel_cfg(unsigned long chan_hdl, struct gsi_chan_props *props,
 int gsi_poll_channel(unsigned long chan_hdl,
 		struct gsi_chan_xfer_notify *notify);
 
+/**
+ * gsi_poll_channel_multi - Peripheral should call this function to query
+ * for a batch of completed transfer descriptors. The event ring read
+ * pointer is read once and the event doorbell rung once per call.
+ *
+ * @chan_hdl:     Client handle previously obtained from
+ *                gsi_alloc_channel
+ * @expected_num: Size of the @notify array
+ * @actual_num:   Number of completed transfers filled in @notify
+ * @notify:       Information about the completed transfers if any
+ *
+ * @Return gsi_status. If no transfers completed, a channel in poll mode
+ * gets GSI_STATUS_AGAIN while its recent completion rate says it should
+ * keep polling, and GSI_STATUS_POLL_EMPTY once the client should move it
+ * back to callback mode with gsi_config_channel_mode.
+ */
+int gsi_poll_channel_multi(unsigned long chan_hdl, uint16_t expected_num,
+		uint16_t *actual_num, struct gsi_chan_xfer_notify *notify);
+
 /**
  * gsi_config_channel_mode - Peripheral should call this function
  * to configure the channel mode.
@@ -1222,6 +1241,13 @@ static inline int gsi_poll_channel(unsigned long chan_hdl,
 	return -GSI_STATUS_UNSUPPORTED_OP;
 }
 
+static inline int gsi_poll_channel_multi(unsigned long chan_hdl,
+		uint16_t expected_num, uint16_t *actual_num,
+		struct gsi_chan_xfer_notify *notify)
+{
+	return -GSI_STATUS_UNSUPPORTED_OP;
+}
+
 static inline int gsi_config_channel_mode(unsigned long chan_hdl,
 		enum gsi_chan_mode mode)
 {
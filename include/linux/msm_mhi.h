@@ -315,6 +315,23 @@ int mhi_poll_inbound(struct mhi_client_handle *client_handle,
  */
 int mhi_get_max_desc(struct mhi_client_handle *client_handle);
 
+/**
+ * mhi_set_db_burst - Defer channel doorbell writes and ring them in batches
+ * @client_handle  Pointer to client handle previously obtained from
+ *                      mhi_open_channel.
+ * @max_pending    Ring the doorbell once this many buffers are queued,
+ *                 0 or 1 rings it for every buffer (the default).
+ * @timeout_us     Ring the doorbell for a partial batch after this long,
+ *                 at most 1000us.
+ *
+ * Only for hardware channels that do not use the device burst mode. The
+ * setting is cleared when the channel is closed.
+ *
+ * @Return errno
+ */
+int mhi_set_db_burst(struct mhi_client_handle *client_handle,
+		     u32 max_pending, u32 timeout_us);
+
 /* following APIs meant to be used by rmnet interface only */
 int mhi_set_lpm(struct mhi_client_handle *client_handle, bool enable_lpm);
 int mhi_get_epid(struct mhi_client_handle *mhi_handle);
@@ -392,6 +409,12 @@ static inline int mhi_get_max_desc(struct mhi_client_handle *client_handle)
 	return -EINVAL;
 };
 
+static inline int mhi_set_db_burst(struct mhi_client_handle *client_handle,
+				   u32 max_pending, u32 timeout_us)
+{
+	return -EINVAL;
+};
+
 static inline int mhi_set_lpm(struct mhi_client_handle *client_handle,
 			      bool enable_lpm)
 {
@@ -321,6 +321,7 @@ struct napi_struct {
 	struct list_head	dev_list;
 	struct hlist_node	napi_hash_node;
 	unsigned int		napi_id;
+	struct task_struct	*thread;
 };
 
 enum {
@@ -328,6 +329,8 @@ enum {
 	NAPI_STATE_DISABLE,	/* Disable pending */
 	NAPI_STATE_NPSVC,	/* Netpoll - don't dequeue from poll_list */
 	NAPI_STATE_HASHED,	/* In NAPI hash */
+	NAPI_STATE_THREADED,	/* Polled by its own kthread */
+	NAPI_STATE_SCHED_THREADED, /* Scheduled on its kthread */
 };
 
 enum gro_result {
@@ -1451,6 +1454,9 @@ enum netdev_priv_flags {
  *				allocated at register_netdev() time
  *	@real_num_rx_queues: 	Number of RX queues currently active in device
  *
+ *	@gro_flush_timeout:	GRO flush timeout in ns, 0 to flush at once
+ *	@threaded:	NAPI instances are polled by their own kthreads
+ *			instead of from NET_RX softirq
  *	@rx_handler:		handler for received packets
  *	@rx_handler_data: 	XXX: need comments on this one
  *	@ingress_queue:		XXX: need comments on this one
@@ -1691,6 +1697,7 @@ struct net_device {
 #endif
 
 	unsigned long		gro_flush_timeout;
+	bool			threaded;
 	rx_handler_func_t __rcu	*rx_handler;
 	void __rcu		*rx_handler_data;
 
@@ -3131,6 +3138,7 @@ int dev_get_phys_port_id(struct net_device *dev,
 int dev_get_phys_port_name(struct net_device *dev,
 			   char *name, size_t len);
 int dev_change_proto_down(struct net_device *dev, bool proto_down);
+int dev_set_threaded(struct net_device *dev, bool threaded);
 struct sk_buff *validate_xmit_skb_list(struct sk_buff *skb, struct net_device *dev);
 struct sk_buff *dev_hard_start_xmit(struct sk_buff *skb, struct net_device *dev,
 				    struct netdev_queue *txq, int *ret);
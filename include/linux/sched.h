@@ -53,6 +53,7 @@ struct sched_param {
 #include <linux/hrtimer.h>
 #include <linux/kcov.h>
 #include <linux/task_io_accounting.h>
+#include <linux/taskstats.h>
 #include <linux/latencytop.h>
 #include <linux/cred.h>
 #include <linux/llist.h>
@@ -170,6 +171,7 @@ extern int nr_threads;
 DECLARE_PER_CPU(unsigned long, process_counts);
 extern int nr_processes(void);
 extern unsigned long nr_running(void);
+extern unsigned long nr_running_active_cpus(const struct cpumask *cpus);
 extern bool single_task_running(void);
 extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
@@ -607,6 +609,7 @@ static inline int get_dumpable(struct mm_struct *mm)
 
 #define MMF_HAS_UPROBES		19	/* has uprobes */
 #define MMF_RECALC_UPROBES	20	/* MMF_HAS_UPROBES can be wrong */
+#define MMF_LAZY_FORK		21	/* see PR_SET_LAZY_FORK */
 
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
 
@@ -907,6 +910,10 @@ struct signal_struct {
 	short oom_score_adj;		/* OOM kill score adjustment */
 	short oom_score_adj_min;	/* OOM kill score adjustment min value.
 					 * Only settable by CAP_SYS_RESOURCE. */
+#ifdef CONFIG_ANDROID_SIMPLE_LMK
+	struct hlist_node simple_lmk_node;	/* oom_score_adj bucket */
+	short simple_lmk_adj;		/* adj of the bucket it's in */
+#endif
 
 	struct mutex cred_guard_mutex;	/* guard against foreign influences on
 					 * credential calculations
@@ -1039,6 +1046,13 @@ struct task_delay_info {
 	u64 freepages_start;
 	u64 freepages_delay;	/* wait for memory reclaim */
 	u32 freepages_count;	/* total count of memory reclaim */
+
+	/* page I/O and fsync waits, indexed by TASKSTATS_IO_* */
+	u64 io_wait_start;
+	u64 fsync_start;
+	u64 io_wait_delay[TASKSTATS_IO_NR];
+	u32 io_wait_count[TASKSTATS_IO_NR];
+	u32 io_wait_hist[TASKSTATS_IO_NR][TASKSTATS_IO_HIST_NR];
 };
 #endif	/* CONFIG_TASK_DELAY_ACCT */
 
@@ -1181,11 +1195,20 @@ struct idle_state {
 	unsigned long power;	 /* power consumption in this idle state */
 };
 
+#define SGE_CAP_LUT_SHIFT	5
+#define SGE_CAP_LUT_SIZE	((SCHED_CAPACITY_SCALE >> SGE_CAP_LUT_SHIFT) + 1)
+
 struct sched_group_energy {
 	unsigned int nr_idle_states;	/* number of idle states */
 	struct idle_state *idle_states;	/* ptr to idle state array */
 	unsigned int nr_cap_states;	/* number of capacity states */
 	struct capacity_state *cap_states; /* ptr to capacity state array */
+	/*
+	 * First capacity state able to serve the utilization at the start of
+	 * each SGE_CAP_LUT_SHIFT bucket, precomputed from cap_states. An all
+	 * zero table is valid and just makes lookups scan from state 0.
+	 */
+	u8 cap_idx_lut[SGE_CAP_LUT_SIZE];
 };
 
 unsigned long capacity_curr_of(int cpu);
@@ -1214,6 +1237,7 @@ struct eas_stats {
 	u64 secb_no_nrg_sav;
 	u64 secb_nrg_sav;
 	u64 secb_count;
+	u64 secb_cycles;
 
 	/* find_best_target() stats */
 	u64 fbt_attempts;
@@ -1720,6 +1744,12 @@ struct task_struct {
 	u64 cpu_cycles;
 	u64 last_sleep_ts;
 #endif
+#ifdef CONFIG_KRYO_TASK_COUNTERS
+	/* PMU counts while running, see drivers/soc/qcom/kryo_task_counters.c */
+	u64 kryo_counts[4];
+#endif
+	/* rq clock at the last wakeup, cleared once the task runs */
+	u64 sched_wakeup_ts;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group *sched_task_group;
 #endif
@@ -1801,6 +1831,7 @@ struct task_struct {
 	unsigned			sched_remote_wakeup:1;
 	unsigned in_execve:1; /* bit to tell LSMs we're in execve */
 	unsigned in_iowait:1;
+	unsigned in_memstall:1; /* accounted in vmpressure stall time */
 #ifdef CONFIG_MEMCG
 	unsigned memcg_may_oom:1;
 #endif
@@ -2173,9 +2204,6 @@ struct task_struct {
 	unsigned long	task_state_change;
 #endif
 	int pagefault_disabled;
-#ifdef CONFIG_ANDROID_SIMPLE_LMK
-	struct task_struct		*simple_lmk_next;
-#endif
 /* CPU-specific state of this task */
 	struct thread_struct thread;
 /*
@@ -2725,6 +2753,15 @@ static inline void sched_set_cluster_dstate(const cpumask_t *cluster_cpus,
 }
 #endif /* CONFIG_SCHED_HMP */
 
+#ifdef CONFIG_CGROUP_SCHEDTUNE
+extern bool schedtune_task_boosted(struct task_struct *p);
+#else
+static inline bool schedtune_task_boosted(struct task_struct *p)
+{
+	return false;
+}
+#endif /* CONFIG_CGROUP_SCHEDTUNE */
+
 #ifdef CONFIG_NO_HZ_COMMON
 void calc_load_enter_idle(void);
 void calc_load_exit_idle(void);
@@ -3686,6 +3723,19 @@ struct migration_notify_data {
 
 extern struct atomic_notifier_head load_alert_notifier_head;
 
+/*
+ * Sent with the rq lock held each time a CPU rolls over to a new window.
+ * Callbacks must be cheap and must not wake up tasks directly.
+ */
+struct sched_window_stats {
+	int cpu;
+	u64 window_start;
+	u32 window_size;
+	u64 prev_busy;
+};
+
+extern struct atomic_notifier_head sched_window_notifier_head;
+
 extern long sched_setaffinity(pid_t pid, const struct cpumask *new_mask);
 extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
 
@@ -17,8 +17,10 @@
 #ifdef CONFIG_SCHED_CORE_CTL
 void core_ctl_check(u64 wallclock);
 int core_ctl_set_boost(bool boost);
+void core_ctl_check_nr_running(int cpu);
 #else
 static inline void core_ctl_check(u64 wallclock) {}
+static inline void core_ctl_check_nr_running(int cpu) {}
 static inline int core_ctl_set_boost(bool boost)
 {
 	return 0;
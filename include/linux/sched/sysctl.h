@@ -41,6 +41,7 @@ extern unsigned int sysctl_sched_wakeup_granularity;
 extern unsigned int sysctl_sched_child_runs_first;
 extern unsigned int sysctl_sched_sync_hint_enable;
 extern unsigned int sysctl_sched_cstate_aware;
+extern unsigned int sysctl_sched_rt_capacity_aware;
 
 #ifdef CONFIG_SCHED_HMP
 
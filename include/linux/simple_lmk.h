@@ -6,10 +6,14 @@
 #define _SIMPLE_LMK_H_
 
 struct mm_struct;
+struct signal_struct;
 
 #ifdef CONFIG_ANDROID_SIMPLE_LMK
 void simple_lmk_decide_reclaim(int kswapd_priority);
 void simple_lmk_mm_freed(struct mm_struct *mm);
+void simple_lmk_signal_add(struct signal_struct *sig);
+void simple_lmk_signal_del(struct signal_struct *sig);
+void simple_lmk_adj_update(struct signal_struct *sig);
 #else
 static inline void simple_lmk_decide_reclaim(int kswapd_priority)
 {
@@ -17,6 +21,15 @@ static inline void simple_lmk_decide_reclaim(int kswapd_priority)
 static inline void simple_lmk_mm_freed(struct mm_struct *mm)
 {
 }
+static inline void simple_lmk_signal_add(struct signal_struct *sig)
+{
+}
+static inline void simple_lmk_signal_del(struct signal_struct *sig)
+{
+}
+static inline void simple_lmk_adj_update(struct signal_struct *sig)
+{
+}
 #endif
 
 #endif /* _SIMPLE_LMK_H_ */
@@ -251,11 +251,16 @@ struct swap_info_struct {
 	struct swap_cluster_info discard_cluster_tail; /* list tail of discard clusters */
 	unsigned int write_pending;
 	unsigned int max_writes;
+	/* Adaptive swap_ratio state, see mm/swap_ratio.c */
+	unsigned int read_lat_us;	/* swap-in latency average */
+	unsigned int write_lat_us;	/* swap-out latency average */
+	unsigned long cap_window;	/* start of slow write cap window */
+	unsigned int cap_writes;	/* slots handed out in that window */
 };
 
 /* linux/mm/workingset.c */
 void *workingset_eviction(struct address_space *mapping, struct page *page);
-bool workingset_refault(void *shadow);
+bool workingset_refault(struct page *page, void *shadow);
 void workingset_activation(struct page *page);
 extern struct list_lru workingset_shadow_nodes;
 
@@ -335,8 +340,15 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 						unsigned long *nr_scanned);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
 extern int vm_swappiness;
+
+/* vm.lru_aging_mode */
+#define LRU_AGING_CLASSIC	0	/* rmap walk per active page */
+#define LRU_AGING_WALK		1	/* batched page table walks */
+extern int sysctl_lru_aging_mode;
 extern int sysctl_swap_ratio;
 extern int sysctl_swap_ratio_enable;
+extern int sysctl_swap_ratio_adaptive;
+extern int sysctl_swap_ratio_slow_cap;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern unsigned long vm_total_pages;
 
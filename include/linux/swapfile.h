@@ -14,6 +14,9 @@ extern int try_to_unuse(unsigned int, bool, unsigned long);
 extern int swap_ratio(struct swap_info_struct **si);
 extern void setup_swap_ratio(struct swap_info_struct *p, int prio);
 extern bool is_swap_ratio_group(int prio);
+extern unsigned long swap_ratio_io_start(void);
+extern void swap_ratio_io_done(struct swap_info_struct *si, int rw,
+			       unsigned long start);
 extern unsigned long generic_max_swapfile_size(void);
 extern unsigned long max_swapfile_size(void);
 
@@ -110,6 +110,8 @@ struct test_debug {
  *			verify the data
  * @req_id:		A unique ID to identify a test request
  *			to ease the debugging of the test cases
+ * @dispatch_time:	Time the request was dispatched to the
+ *			driver, for latency measurements
  */
 struct test_request {
 	struct list_head queuelist;
@@ -121,6 +123,7 @@ struct test_request {
 	int is_err_expected;
 	int wr_rd_data_pattern;
 	int req_id;
+	ktime_t dispatch_time;
 };
 
 /**
@@ -37,7 +37,19 @@ enum vm_event_item { PGPGIN, PGPGOUT, PGPGOUTCLEAN, PSWPIN, PSWPOUT,
 		PGINODESTEAL, SLABS_SCANNED, KSWAPD_INODESTEAL,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		KSWAPD_EXEC_MS,
+		LRU_WALK_GEN, LRU_WALK_MM, LRU_WALK_MM_SKIPPED,
+		LRU_WALK_PTE_SCANNED, LRU_WALK_PTE_YOUNG,
+		LRU_WALK_ACTIVATE, LRU_WALK_ROTATED,
+		/* in enum mem_cgroup_reclaim_class order */
+		PGSCAN_CLASS_CACHED, PGSCAN_CLASS_DEFAULT,
+		PGSCAN_CLASS_VISIBLE, PGSCAN_CLASS_FOREGROUND,
+		PGSTEAL_CLASS_CACHED, PGSTEAL_CLASS_DEFAULT,
+		PGSTEAL_CLASS_VISIBLE, PGSTEAL_CLASS_FOREGROUND,
+		RECLAIM_CLASS_FOREGROUND_SKIPPED,
 		DROP_PAGECACHE, DROP_SLAB,
+		VMAP_PURGE_BG, VMAP_PURGE_SYNC, VMAP_PURGE_AREAS,
+		VMAP_PURGE_PAGES, VMAP_PURGE_FLUSH_PAGES,
 #ifdef CONFIG_NUMA_BALANCING
 		NUMA_PTE_UPDATES,
 		NUMA_HUGE_PTE_UPDATES,
@@ -53,6 +65,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PGPGOUTCLEAN, PSWPIN, PSWPOUT,
 		COMPACTISOLATED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
 		KCOMPACTD_WAKE,
+		COMPACT_PROACTIVE_RUN, COMPACT_PROACTIVE_SUCCESS,
+		COMPACT_PROACTIVE_THROTTLED,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -64,6 +78,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PGPGOUTCLEAN, PSWPIN, PSWPOUT,
 		UNEVICTABLE_PGMUNLOCKED,
 		UNEVICTABLE_PGCLEARED,	/* on COW, page truncate */
 		UNEVICTABLE_PGSTRANDED,	/* unable to isolate on unlock */
+		LAZY_FORK_PTE_SKIPPED,	/* page tables left to faults on fork */
+		LAZY_FORK_PTE_COPIED,
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 		THP_FAULT_ALLOC,
 		THP_FAULT_FALLBACK,
@@ -9,6 +9,25 @@
 #include <linux/cgroup.h>
 #include <linux/eventfd.h>
 
+enum vmpressure_stall_states {
+	VMPRESSURE_STALL_SOME,	/* at least one task stalled on memory */
+	VMPRESSURE_STALL_FULL,	/* no runnable task left doing work */
+	NR_VMPRESSURE_STALL,
+};
+
+/* Time based memory stall accounting, see vmpressure_memstall_enter() */
+struct vmpressure_stall {
+	spinlock_t lock;
+	unsigned int nr_stalled;
+	bool state[NR_VMPRESSURE_STALL];
+	u64 state_start[NR_VMPRESSURE_STALL];
+	u64 total[NR_VMPRESSURE_STALL];
+
+	/* Poll triggers, checked while tasks are stalled */
+	struct list_head triggers;
+	struct delayed_work poll_work;
+};
+
 struct vmpressure {
 	unsigned long scanned;
 	unsigned long reclaimed;
@@ -25,9 +44,15 @@ struct vmpressure {
 
 	atomic_long_t users;
 	rwlock_t users_lock;
+
+	struct vmpressure_stall memstall;
 };
 
 struct mem_cgroup;
+struct seq_file;
+struct file;
+struct poll_table_struct;
+struct vmpressure_trigger;
 
 extern int vmpressure_notifier_register(struct notifier_block *nb);
 extern int vmpressure_notifier_unregister(struct notifier_block *nb);
@@ -39,6 +64,23 @@ extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio,
 extern bool vmpressure_inc_users(int order);
 extern void vmpressure_dec_users(void);
 
+/* Filled in by vmpressure_memstall_enter(), handed back to _leave() */
+struct memstall_cookie {
+	struct mem_cgroup *memcg;
+	bool nested;
+};
+
+extern void vmpressure_memstall_enter(struct memstall_cookie *cookie);
+extern void vmpressure_memstall_leave(struct memstall_cookie *cookie);
+
+extern int vmpressure_stall_show(struct seq_file *m, struct vmpressure *vmpr);
+extern struct vmpressure_trigger *
+vmpressure_trigger_create(struct vmpressure *vmpr, char *buf);
+extern void vmpressure_trigger_destroy(struct vmpressure_trigger *t);
+extern unsigned int vmpressure_trigger_poll(struct vmpressure_trigger *t,
+					    struct file *file,
+					    struct poll_table_struct *wait);
+
 #ifdef CONFIG_MEMCG
 extern void vmpressure_init(struct vmpressure *vmpr);
 extern void vmpressure_cleanup(struct vmpressure *vmpr);
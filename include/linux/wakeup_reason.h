@@ -18,15 +18,22 @@
 #ifndef _LINUX_WAKEUP_REASON_H
 #define _LINUX_WAKEUP_REASON_H
 
+#include <linux/types.h>
+
 #define MAX_SUSPEND_ABORT_LEN 256
 
+struct device;
+
 void log_wakeup_reason(int irq);
 int check_wakeup_reason(int irq);
 
 #ifdef CONFIG_SUSPEND
 void log_suspend_abort_reason(const char *fmt, ...);
+void log_device_resume_time(struct device *dev, const char *info, s64 usecs);
 #else
 static inline void log_suspend_abort_reason(const char *fmt, ...) { }
+static inline void log_device_resume_time(struct device *dev,
+					  const char *info, s64 usecs) { }
 #endif
 
 #endif /* _LINUX_WAKEUP_REASON_H */
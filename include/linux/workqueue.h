@@ -123,14 +123,16 @@ struct delayed_work {
  * A struct for workqueue attributes.  This can be used to change
  * attributes of an unbound workqueue.
  *
- * Unlike other fields, ->no_numa isn't a property of a worker_pool.  It
- * only modifies how apply_workqueue_attrs() select pools and thus doesn't
- * participate in pool hash calculations or equality comparisons.
+ * Unlike other fields, ->no_numa and ->cluster aren't properties of a
+ * worker_pool.  They only modify how apply_workqueue_attrs() select pools
+ * and thus don't participate in pool hash calculations or equality
+ * comparisons.
  */
 struct workqueue_attrs {
 	int			nice;		/* nice level */
 	cpumask_var_t		cpumask;	/* allowed CPUs */
 	bool			no_numa;	/* disable NUMA affinity */
+	bool			cluster;	/* prefer the queueing cluster */
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
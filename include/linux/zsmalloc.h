@@ -46,6 +46,8 @@ void zs_destroy_pool(struct zs_pool *pool);
 
 unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t flags);
 void zs_free(struct zs_pool *pool, unsigned long obj);
+void zs_free_bulk(struct zs_pool *pool, unsigned long *handles,
+		unsigned int nr);
 
 size_t zs_huge_class_size(struct zs_pool *pool);
 
@@ -69,6 +69,7 @@ struct msm_smem {
 	enum hal_buffer buffer_type;
 	struct dma_mapping_info mapping_info;
 	unsigned int offset;
+	bool pooled;
 };
 
 enum smem_cache_ops {
@@ -126,6 +126,16 @@ struct scsi_host_template {
 	 */
 	int (* queuecommand)(struct Scsi_Host *, struct scsi_cmnd *);
 
+	/*
+	 * Used by scsi-mq queues with io_poll enabled to look for the
+	 * completion of the command with the given block layer tag without
+	 * waiting for its interrupt. Returns 1 if the command is done, 0 if
+	 * it is still outstanding and a negative errno to stop polling.
+	 *
+	 * STATUS: OPTIONAL
+	 */
+	int (* mq_poll)(struct Scsi_Host *, unsigned int tag);
+
 	/*
 	 * This is an error handling strategy routine.  You don't need to
 	 * define one of these if you don't want to - there is a default
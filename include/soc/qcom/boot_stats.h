@@ -35,8 +35,14 @@ int boot_stats_init(void);
 int boot_stats_exit(void);
 unsigned long long int msm_timer_get_sclk_ticks(void);
 phys_addr_t msm_timer_get_pa(void);
+void boot_stats_subsys(const char *name, const char * const *stages,
+		const u64 *ms, int nr);
 #else
 static inline int boot_stats_init(void) { return 0; }
+static inline void boot_stats_subsys(const char *name,
+		const char * const *stages, const u64 *ms, int nr)
+{
+}
 static inline unsigned long long int msm_timer_get_sclk_ticks(void)
 {
 	return 0;
@@ -34,10 +34,19 @@ enum {
  *
  * Used to define the glink_open_config::options field which is passed into
  * glink_open().
+ *
+ * GLINK_OPT_RX_INTENT_POOL makes the core keep RX intents queued on the
+ * channel, sized from the packets received so far. Packets received in
+ * those intents are notified with a NULL pkt_priv.
+ *
+ * GLINK_OPT_LOW_LATENCY makes transports signal the remote side for every
+ * packet on the channel, bypassing any interrupt coalescing.
  */
 enum {
 	GLINK_OPT_INITIAL_XPORT = BIT(0),
 	GLINK_OPT_RX_INTENT_NOTIF = BIT(1),
+	GLINK_OPT_RX_INTENT_POOL = BIT(2),
+	GLINK_OPT_LOW_LATENCY = BIT(3),
 };
 
 /**
@@ -16,5 +16,11 @@
 int irq_blacklist_on(void);
 int irq_blacklist_off(void);
 
+#ifdef CONFIG_QCOM_IRQ_HELPER
+void irq_placement_kick(void);
+#else
+static inline void irq_placement_kick(void) { }
+#endif
+
 #endif
 
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SOC_QCOM_KRYO_TASK_COUNTERS_H
+#define __SOC_QCOM_KRYO_TASK_COUNTERS_H
+
+/* must match the size of task_struct::kryo_counts */
+#define KRYO_TC_NR_EVENTS	4
+
+struct seq_file;
+struct pid_namespace;
+struct pid;
+struct task_struct;
+
+#ifdef CONFIG_KRYO_TASK_COUNTERS
+int proc_pid_kryo_counters(struct seq_file *m, struct pid_namespace *ns,
+			   struct pid *pid, struct task_struct *task);
+int proc_tgid_kryo_counters(struct seq_file *m, struct pid_namespace *ns,
+			    struct pid *pid, struct task_struct *task);
+#endif
+
+#endif
@@ -49,6 +49,8 @@ void lpm_stats_cluster_exit(struct lpm_stats *stats, uint32_t index,
 				bool success);
 void lpm_stats_cpu_enter(uint32_t index, uint64_t time);
 void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success);
+void lpm_stats_cpu_residency(uint32_t index, uint32_t target_us,
+				int64_t exit_latency);
 void lpm_stats_suspend_enter(void);
 void lpm_stats_suspend_exit(void);
 #else
@@ -82,6 +84,12 @@ static inline void lpm_stats_cpu_exit(uint32_t index, bool success,
 	return;
 }
 
+static inline void lpm_stats_cpu_residency(uint32_t index,
+					uint32_t target_us, int64_t exit_latency)
+{
+	return;
+}
+
 static inline void lpm_stats_suspend_enter(void)
 {
 	return;
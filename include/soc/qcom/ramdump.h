@@ -13,6 +13,8 @@
 #ifndef _RAMDUMP_HEADER
 #define _RAMDUMP_HEADER
 
+#include <linux/types.h>
+
 struct device;
 
 struct ramdump_segment {
@@ -22,6 +24,23 @@ struct ramdump_segment {
 	unsigned long size;
 };
 
+/*
+ * With the ramdump "compress" parameter set, ELF ramdumps keep the ELF
+ * and program headers of an uncompressed dump, but the segment data
+ * after them is a sequence of blocks, each a struct ramdump_lz4_block
+ * followed by comp_len bytes. The blocks decode to raw_len bytes each,
+ * which appended in order give back the uncompressed file. A block with
+ * comp_len equal to raw_len is stored, everything else is LZ4.
+ */
+#define RAMDUMP_LZ4_MAGIC	0x345a4c52	/* "RLZ4" */
+
+struct ramdump_lz4_block {
+	__le32 magic;
+	__le32 comp_len;
+	__le32 raw_len;
+	__le32 reserved;
+};
+
 #ifdef CONFIG_MSM_SUBSYSTEM_RESTART
 extern void *create_ramdump_device(const char *dev_name, struct device *parent);
 extern void destroy_ramdump_device(void *dev);
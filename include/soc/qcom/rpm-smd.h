@@ -31,6 +31,15 @@ struct msm_rpm_kvp {
 	uint32_t length;
 	uint8_t *data;
 };
+
+/* One resource update for msm_rpm_send_messages() */
+struct msm_rpm_message {
+	enum msm_rpm_set set;
+	uint32_t rsc_type;
+	uint32_t rsc_id;
+	struct msm_rpm_kvp *kvp;
+	int nelems;
+};
 #ifdef CONFIG_MSM_RPM_SMD
 /**
  * msm_rpm_request() - Creates a parent element to identify the
@@ -142,6 +151,19 @@ void *msm_rpm_send_request_noack(struct msm_rpm_request *handle);
  */
 int msm_rpm_send_request_noirq(struct msm_rpm_request *handle);
 
+/**
+ * msm_rpm_send_request_batch() - Send several RPM requests and wait for all
+ * of the acknowledgments. All messages are written to the RPM before the
+ * first wait, so the batch costs a single round trip instead of one per
+ * request.
+ *
+ * @handles: array of msm_rpm_request pointers for the resources modified.
+ * @count: number of requests in the array.
+ *
+ * returns 0 on success or the first error reported for the batch.
+ */
+int msm_rpm_send_request_batch(struct msm_rpm_request **handles, int count);
+
 /**
  * msm_rpm_wait_for_ack() - A blocking call that waits for acknowledgment of
  * a message from RPM.
@@ -179,6 +201,19 @@ int msm_rpm_wait_for_ack_noirq(uint32_t msg_id);
 int msm_rpm_send_message(enum msm_rpm_set set, uint32_t rsc_type,
 		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems);
 
+/**
+ * msm_rpm_send_messages() - Wrapper function for clients to send a batch of
+ * resource updates given as an array of messages. Updates to the same
+ * resource and set are merged into one RPM message, and all messages are
+ * sent with msm_rpm_send_request_batch().
+ *
+ * @msgs: array of resource updates.
+ * @count: number of updates in the array.
+ *
+ * returns  0 on success and errno on failure.
+ */
+int msm_rpm_send_messages(struct msm_rpm_message *msgs, int count);
+
 /**
  * msm_rpm_send_message_noack() -Wrapper function for clients to send data
  * given an array of key value pairs without waiting for ack.
@@ -271,12 +306,24 @@ static inline void *msm_rpm_send_request_noack(struct msm_rpm_request *handle)
 	return NULL;
 }
 
+static inline int msm_rpm_send_request_batch(struct msm_rpm_request **handles,
+		int count)
+{
+	return 0;
+}
+
 static inline int msm_rpm_send_message(enum msm_rpm_set set, uint32_t rsc_type,
 		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems)
 {
 	return 0;
 }
 
+static inline int msm_rpm_send_messages(struct msm_rpm_message *msgs,
+		int count)
+{
+	return 0;
+}
+
 static inline int msm_rpm_send_message_noirq(enum msm_rpm_set set,
 		uint32_t rsc_type, uint32_t rsc_id, struct msm_rpm_kvp *kvp,
 		int nelems)
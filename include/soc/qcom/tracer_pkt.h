@@ -67,6 +67,15 @@ int tracer_pkt_set_event_cfg(void *data, uint16_t client_event_cfg,
  */
 int tracer_pkt_log_event(void *data, uint32_t event_id);
 
+/**
+ * tracer_pkt_get_base_ts() - get the time the tracer packet was initialized
+ * @data:	Pointer to the buffer containing tracer packet.
+ *
+ * Return: the base timestamp in arch timer ticks, 0 if @data is not a
+ *	   tracer packet.
+ */
+u64 tracer_pkt_get_base_ts(void *data);
+
 /**
  * tracer_pkt_calc_hex_dump_size() - calculate the hex dump size of a tracer
  *				     packet
@@ -115,6 +124,11 @@ static inline int tracer_pkt_log_event(void *data, uint32_t event_id)
 	return -EOPNOTSUPP;
 }
 
+static inline u64 tracer_pkt_get_base_ts(void *data)
+{
+	return 0;
+}
+
 static inline size_t tracer_pkt_calc_hex_dump_size(void *data, size_t data_len)
 {
 	return -EOPNOTSUPP;
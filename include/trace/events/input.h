@@ -0,0 +1,41 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM input
+
+#if !defined(_TRACE_INPUT_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_INPUT_H
+
+#include <linux/input.h>
+#include <linux/ktime.h>
+#include <linux/tracepoint.h>
+
+/*
+ * One event batch, terminated by SYN_REPORT, handed to the handlers.
+ * The timestamp is CLOCK_MONOTONIC taken just before evdev stamps the
+ * same batch, so it can be matched against what userspace reads.
+ */
+TRACE_EVENT(input_frame,
+
+	TP_PROTO(struct input_dev *dev, unsigned int count, ktime_t ts),
+
+	TP_ARGS(dev, count, ts),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name ? dev->name : "")
+		__field(unsigned int, count)
+		__field(s64, ts)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name ? dev->name : "");
+		__entry->count = count;
+		__entry->ts = ktime_to_ns(ts);
+	),
+
+	TP_printk("dev=%s count=%u ts=%lld",
+		__get_str(name), __entry->count, __entry->ts)
+);
+
+#endif /* _TRACE_INPUT_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
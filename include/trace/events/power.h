@@ -778,6 +778,40 @@ TRACE_EVENT(memlat_dev_update,
 		__entry->vote)
 );
 
+TRACE_EVENT(memlat_dev_decision,
+
+	TP_PROTO(const char *name, unsigned long target, unsigned long vote,
+		 unsigned long mbps, bool burst, bool bw_bound),
+
+	TP_ARGS(name, target, vote, mbps, burst, bw_bound),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned long, target)
+		__field(unsigned long, vote)
+		__field(unsigned long, mbps)
+		__field(bool, burst)
+		__field(bool, bw_bound)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->target = target;
+		__entry->vote = vote;
+		__entry->mbps = mbps;
+		__entry->burst = burst;
+		__entry->bw_bound = bw_bound;
+	),
+
+	TP_printk("dev: %s, target=%lu, vote=%lu, mbps=%lu, burst=%d, bw_bound=%d",
+		__get_str(name),
+		__entry->target,
+		__entry->vote,
+		__entry->mbps,
+		__entry->burst,
+		__entry->bw_bound)
+);
+
 DECLARE_EVENT_CLASS(kpm_module,
 
 	TP_PROTO(unsigned int managed_cpus, unsigned int max_cpus),
@@ -1775,6 +1775,45 @@ TRACE_EVENT(sched_find_best_target,
 		__entry->target)
 );
 
+/*
+ * Tracepoint for capacity aware RT task placement
+ */
+TRACE_EVENT(sched_rt_capacity_placement,
+
+	TP_PROTO(struct task_struct *tsk, unsigned long demand, int prev_cpu,
+		 int target, unsigned long capacity, int idle_idx, bool fits),
+
+	TP_ARGS(tsk, demand, prev_cpu, target, capacity, idle_idx, fits),
+
+	TP_STRUCT__entry(
+		__array( char,		comm,	TASK_COMM_LEN	)
+		__field( pid_t,		pid			)
+		__field( unsigned long,	demand			)
+		__field( int,		prev_cpu		)
+		__field( int,		target			)
+		__field( unsigned long,	capacity		)
+		__field( int,		idle_idx		)
+		__field( bool,		fits			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, tsk->comm, TASK_COMM_LEN);
+		__entry->pid		= tsk->pid;
+		__entry->demand		= demand;
+		__entry->prev_cpu	= prev_cpu;
+		__entry->target		= target;
+		__entry->capacity	= capacity;
+		__entry->idle_idx	= idle_idx;
+		__entry->fits		= fits;
+	),
+
+	TP_printk("pid=%d comm=%s demand=%lu prev_cpu=%d target=%d "
+		  "capacity=%lu idle_idx=%d fits=%d",
+		__entry->pid, __entry->comm, __entry->demand,
+		__entry->prev_cpu, __entry->target, __entry->capacity,
+		__entry->idle_idx, __entry->fits)
+);
+
 /*
  * Tracepoint for accounting sched group energy
  */
@@ -206,6 +206,13 @@ struct prctl_mm_map {
 #define PR_SET_VMA		0x53564d41
 # define PR_SET_VMA_ANON_NAME		0
 
+/*
+ * Leave page tables that only map page cache pages out of children
+ * forked from this process, they are refilled by faults. Not inherited.
+ */
+#define PR_SET_LAZY_FORK	0x4c5a4653
+#define PR_GET_LAZY_FORK	0x4c5a4647
+
 /* Per task speculation control */
 #define PR_GET_SPECULATION_CTRL		52
 #define PR_SET_SPECULATION_CTRL		53
@@ -33,10 +33,18 @@
  */
 
 
-#define TASKSTATS_VERSION	8
+#define TASKSTATS_VERSION	9
 #define TS_COMM_LEN		32	/* should be >= TASK_COMM_LEN
 					 * in linux/sched.h */
 
+/* Kinds of I/O wait in io_wait_* */
+#define TASKSTATS_IO_READ	0	/* page waiting to be read in */
+#define TASKSTATS_IO_WRITE	1	/* page waiting for writeback */
+#define TASKSTATS_IO_FSYNC	2	/* whole fsync/fdatasync call */
+#define TASKSTATS_IO_NR		3
+
+#define TASKSTATS_IO_HIST_NR	24
+
 struct taskstats {
 
 	/* The version number of this struct. This field is always set to
@@ -163,6 +171,17 @@ struct taskstats {
 	/* Delay waiting for memory reclaim */
 	__u64	freepages_count;
 	__u64	freepages_delay_total;
+
+	/* Version 8 ends here */
+
+	/* Delay waiting for page I/O and fsync, indexed by TASKSTATS_IO_* */
+	__u64	io_wait_count[TASKSTATS_IO_NR];
+	__u64	io_wait_delay_total[TASKSTATS_IO_NR];
+	/*
+	 * Bucket 0 counts waits under 1us, bucket n waits of [2^(n-1), 2^n)
+	 * us and the last bucket everything longer.
+	 */
+	__u32	io_wait_hist[TASKSTATS_IO_NR][TASKSTATS_IO_HIST_NR];
 };
 
 
@@ -0,0 +1,55 @@
+#ifndef _UAPI_TRACE_MMAP_H_
+#define _UAPI_TRACE_MMAP_H_
+
+#include <linux/types.h>
+
+/**
+ * struct trace_buffer_meta - Ring buffer meta page, shared with userspace
+ * @meta_page_size:	Size of this meta page.
+ * @meta_struct_len:	Size of this structure.
+ * @subbuf_size:	Size of each sub-buffer, including its header.
+ * @nr_subbufs:		Number of sub-buffers mapped after the meta page.
+ * @reader.lost_events:	Events lost before the current reader sub-buffer.
+ * @reader.id:		Index of the reader sub-buffer in the mapping.
+ * @reader.read:	Offset in the reader sub-buffer data of the first
+ *			event handed out by the last GET_READER.
+ * @reader.read_end:	Offset in the reader sub-buffer data after the last
+ *			event handed out by the last GET_READER.
+ * @entries:		Events in the ring buffer, read or not.
+ * @overrun:		Events lost to the writer overwriting them.
+ * @read:		Events consumed, through the mapping or otherwise.
+ *
+ * The mapping is this page followed by @nr_subbufs pages, each starting
+ * with the ring buffer page header described in events/header_page.
+ * Offsets above are relative to the data that follows that header.
+ */
+struct trace_buffer_meta {
+	__u32	meta_page_size;
+	__u32	meta_struct_len;
+
+	__u32	subbuf_size;
+	__u32	nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+		__u32	read_end;
+		__u32	__reserved;
+	} reader;
+
+	__u64	entries;
+	__u64	overrun;
+	__u64	read;
+};
+
+/*
+ * Hand the events committed on the reader sub-buffer since the last call
+ * to the caller, swapping in the next sub-buffer from the ring if the
+ * current one was fully consumed, and update the meta page. The caller
+ * reads [reader.read, reader.read_end) of sub-buffer reader.id; an empty
+ * range means there is nothing to read, poll() the file to wait.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER	_IO('R', 0x20)
+
+#endif /* _UAPI_TRACE_MMAP_H_ */
@@ -34,8 +34,24 @@ struct msm_buf_mngr_main_cont_info {
 	int32_t cont_fd;
 };
 
+enum msm_camera_buf_mngr_batch_cmd {
+	MSM_CAMERA_BUF_MNGR_BATCH_GET,
+	MSM_CAMERA_BUF_MNGR_BATCH_PUT,
+	MSM_CAMERA_BUF_MNGR_BATCH_DONE,
+	MSM_CAMERA_BUF_MNGR_BATCH_CMD_MAX,
+};
+
+#define MSM_CAMERA_BUF_MNGR_BATCH_MAX 8
+
+struct msm_buf_mngr_batch_info {
+	enum msm_camera_buf_mngr_batch_cmd cmd;
+	uint32_t num_bufs;
+	struct msm_buf_mngr_info bufs[MSM_CAMERA_BUF_MNGR_BATCH_MAX];
+};
+
 #define MSM_CAMERA_BUF_MNGR_IOCTL_ID_BASE 0
 #define MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX 1
+#define MSM_CAMERA_BUF_MNGR_IOCTL_ID_BATCH 2
 
 #define VIDIOC_MSM_BUF_MNGR_GET_BUF \
 	_IOWR('V', BASE_VIDIOC_PRIVATE + 33, struct msm_buf_mngr_info)
@@ -29,14 +29,6 @@
 
 struct msm_vfe_cfg_cmd_list;
 
-struct isp_kstate {
-	uint32_t kernel_sofid;
-	uint32_t drop_reconfig;
-	uint32_t vfeid;
-	uint32_t dual_cam_drop_detected;
-	uint32_t dual_cam_drop;
-};
-
 enum ISP_START_PIXEL_PATTERN {
 	ISP_BAYER_RGRGRG,
 	ISP_BAYER_GRGRGR,
@@ -121,6 +113,45 @@ enum msm_isp_stats_type {
 	MSM_ISP_STATS_MAX    /* MAX */
 };
 
+#define MSM_ISP_STATS_RING_SIZE 32
+
+/*
+ * One entry per stats done irq, written by the kernel into the shared
+ * isp_kstate page when stats_ring_enable is set.
+ * @frame_id: pix frame id the stats belong to
+ * @stats_mask: stats types done (enum msm_isp_stats_type)
+ * @ts_sec, @ts_usec: monotonic buffer timestamp
+ * @stats_buf_idxs: done buffer index per stats type in stats_mask
+ * @pd_stats_idx: pd buffer index, 0xF if none
+ */
+struct msm_isp_stats_ring_entry {
+	uint32_t frame_id;
+	uint32_t stats_mask;
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint8_t stats_buf_idxs[MSM_ISP_STATS_MAX];
+	uint8_t pd_stats_idx;
+};
+
+/*
+ * Page shared with the camera process through mmap of the vfe node.
+ * @stats_ring_enable: set by userspace to have all stats of a frame
+ * reported with a single ISP_EVENT_COMP_STATS_NOTIFY and recorded in
+ * stats_ring, entry (stats_ring_head - 1) % MSM_ISP_STATS_RING_SIZE
+ * being the latest one.
+ * @stats_ring_head: number of entries written, updated after the entry
+ */
+struct isp_kstate {
+	uint32_t kernel_sofid;
+	uint32_t drop_reconfig;
+	uint32_t vfeid;
+	uint32_t dual_cam_drop_detected;
+	uint32_t dual_cam_drop;
+	uint32_t stats_ring_enable;
+	uint32_t stats_ring_head;
+	struct msm_isp_stats_ring_entry stats_ring[MSM_ISP_STATS_RING_SIZE];
+};
+
 /*
  * @stats_type_mask: Stats type mask (enum msm_isp_stats_type).
  * @stream_src_mask: Stream src mask (enum msm_vfe_axi_stream_src)
@@ -22,6 +22,7 @@
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
 #include <linux/mutex.h>
+#include <linux/ktime.h>
 
 /*
  * A cgroup is freezing if any FREEZING flags are set.  FREEZING_SELF is
@@ -43,8 +44,20 @@ enum freezer_state_flags {
 struct freezer {
 	struct cgroup_subsys_state	css;
 	unsigned int			state;
+
+	/* latency stats, see freezer_stats_show() */
+	ktime_t				freeze_start;
+	u64				freeze_count;
+	u64				freeze_last_ns;
+	u64				freeze_max_ns;
+	u64				thaw_count;
+	u64				thaw_last_ns;
+	u64				thaw_max_ns;
 };
 
+/* tasks handed to freeze_tasks() and thaw_tasks() at a time */
+#define FREEZER_BATCH	32
+
 static DEFINE_MUTEX(freezer_mutex);
 
 static inline struct freezer *css_freezer(struct cgroup_subsys_state *css)
@@ -284,6 +297,14 @@ static void update_if_frozen(struct cgroup_subsys_state *css)
 	}
 
 	freezer->state |= CGROUP_FROZEN;
+	if (freezer->freeze_start) {
+		u64 ns = ktime_to_ns(ktime_sub(ktime_get(),
+					       freezer->freeze_start));
+
+		freezer->freeze_last_ns = ns;
+		freezer->freeze_max_ns = max(freezer->freeze_max_ns, ns);
+		freezer->freeze_start = 0;
+	}
 out_iter_end:
 	css_task_iter_end(&it);
 }
@@ -315,26 +336,53 @@ static int freezer_read(struct seq_file *m, void *v)
 	return 0;
 }
 
-static void freeze_cgroup(struct freezer *freezer)
+/*
+ * Walk the tasks of @freezer and freeze or thaw them FREEZER_BATCH at a
+ * time, so freezer_lock is taken once per batch rather than per task.
+ */
+static void freezer_apply_tasks(struct freezer *freezer, bool freeze)
 {
+	struct task_struct *batch[FREEZER_BATCH];
 	struct css_task_iter it;
 	struct task_struct *task;
+	int i, nr = 0;
 
 	css_task_iter_start(&freezer->css, &it);
-	while ((task = css_task_iter_next(&it)))
-		freeze_task(task);
+	do {
+		task = css_task_iter_next(&it);
+		if (task) {
+			get_task_struct(task);
+			batch[nr++] = task;
+		}
+		if (nr == FREEZER_BATCH || (!task && nr)) {
+			if (freeze)
+				freeze_tasks(batch, nr);
+			else
+				thaw_tasks(batch, nr);
+			for (i = 0; i < nr; i++)
+				put_task_struct(batch[i]);
+			nr = 0;
+		}
+	} while (task);
 	css_task_iter_end(&it);
 }
 
+static void freeze_cgroup(struct freezer *freezer)
+{
+	freezer_apply_tasks(freezer, true);
+}
+
 static void unfreeze_cgroup(struct freezer *freezer)
 {
-	struct css_task_iter it;
-	struct task_struct *task;
+	ktime_t start = ktime_get();
+	u64 ns;
 
-	css_task_iter_start(&freezer->css, &it);
-	while ((task = css_task_iter_next(&it)))
-		__thaw_task(task);
-	css_task_iter_end(&it);
+	freezer_apply_tasks(freezer, false);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	freezer->thaw_count++;
+	freezer->thaw_last_ns = ns;
+	freezer->thaw_max_ns = max(freezer->thaw_max_ns, ns);
 }
 
 /**
@@ -356,8 +404,11 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 		return;
 
 	if (freeze) {
-		if (!(freezer->state & CGROUP_FREEZING))
+		if (!(freezer->state & CGROUP_FREEZING)) {
 			atomic_inc(&system_freezing_cnt);
+			freezer->freeze_start = ktime_get();
+			freezer->freeze_count++;
+		}
 		freezer->state |= state;
 		freeze_cgroup(freezer);
 	} else {
@@ -369,6 +420,7 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 			if (was_freezing)
 				atomic_dec(&system_freezing_cnt);
 			freezer->state &= ~CGROUP_FROZEN;
+			freezer->freeze_start = 0;
 			unfreeze_cgroup(freezer);
 		}
 	}
@@ -385,13 +437,29 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 static void freezer_change_state(struct freezer *freezer, bool freeze)
 {
 	struct cgroup_subsys_state *pos;
+	bool has_children;
+
+	mutex_lock(&freezer_mutex);
+
+	/*
+	 * An app cgroup usually has no children. New children inherit the
+	 * state in freezer_css_online() under freezer_mutex, so with none
+	 * linked yet there is nothing to walk.
+	 */
+	rcu_read_lock();
+	has_children = css_next_child(NULL, &freezer->css);
+	rcu_read_unlock();
+	if (!has_children) {
+		freezer_apply_state(freezer, freeze, CGROUP_FREEZING_SELF);
+		mutex_unlock(&freezer_mutex);
+		return;
+	}
 
 	/*
 	 * Update all its descendants in pre-order traversal.  Each
 	 * descendant will try to inherit its parent's FREEZING state as
 	 * CGROUP_FREEZING_PARENT.
 	 */
-	mutex_lock(&freezer_mutex);
 	rcu_read_lock();
 	css_for_each_descendant_pre(pos, &freezer->css) {
 		struct freezer *pos_f = css_freezer(pos);
@@ -450,6 +518,30 @@ static u64 freezer_parent_freezing_read(struct cgroup_subsys_state *css,
 	return (bool)(freezer->state & CGROUP_FREEZING_PARENT);
 }
 
+/*
+ * freeze: transitions to freezing, and the time from that to FROZEN as
+ * seen by the first read of freezer.state that finds every task frozen.
+ * thaw: transitions to thawed, and the time taken to wake the tasks.
+ */
+static int freezer_stats_show(struct seq_file *m, void *v)
+{
+	struct freezer *freezer = css_freezer(seq_css(m));
+
+	mutex_lock(&freezer_mutex);
+	seq_printf(m, "freeze_count %llu\n", freezer->freeze_count);
+	seq_printf(m, "freeze_last_us %llu\n",
+		   div_u64(freezer->freeze_last_ns, NSEC_PER_USEC));
+	seq_printf(m, "freeze_max_us %llu\n",
+		   div_u64(freezer->freeze_max_ns, NSEC_PER_USEC));
+	seq_printf(m, "thaw_count %llu\n", freezer->thaw_count);
+	seq_printf(m, "thaw_last_us %llu\n",
+		   div_u64(freezer->thaw_last_ns, NSEC_PER_USEC));
+	seq_printf(m, "thaw_max_us %llu\n",
+		   div_u64(freezer->thaw_max_ns, NSEC_PER_USEC));
+	mutex_unlock(&freezer_mutex);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
@@ -467,6 +559,11 @@ static struct cftype files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.read_u64 = freezer_parent_freezing_read,
 	},
+	{
+		.name = "stats",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = freezer_stats_show,
+	},
 	{ }	/* terminate */
 };
 
@@ -19,6 +19,7 @@
 #include <linux/time.h>
 #include <linux/sysctl.h>
 #include <linux/delayacct.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 
 int delayacct_on __read_mostly = 1;	/* Delay accounting turned on/off */
@@ -85,6 +86,7 @@ int __delayacct_add_tsk(struct taskstats *d, struct task_struct *tsk)
 	cputime_t utime, stime, stimescaled, utimescaled;
 	unsigned long long t2, t3;
 	unsigned long flags, t1;
+	int i, j;
 	s64 tmp;
 
 	task_cputime(tsk, &utime, &stime);
@@ -127,6 +129,14 @@ int __delayacct_add_tsk(struct taskstats *d, struct task_struct *tsk)
 	d->blkio_count += tsk->delays->blkio_count;
 	d->swapin_count += tsk->delays->swapin_count;
 	d->freepages_count += tsk->delays->freepages_count;
+	for (i = 0; i < TASKSTATS_IO_NR; i++) {
+		tmp = d->io_wait_delay_total[i] + tsk->delays->io_wait_delay[i];
+		d->io_wait_delay_total[i] =
+			(tmp < d->io_wait_delay_total[i]) ? 0 : tmp;
+		d->io_wait_count[i] += tsk->delays->io_wait_count[i];
+		for (j = 0; j < TASKSTATS_IO_HIST_NR; j++)
+			d->io_wait_hist[i][j] += tsk->delays->io_wait_hist[i][j];
+	}
 	spin_unlock_irqrestore(&tsk->delays->lock, flags);
 
 	return 0;
@@ -156,3 +166,50 @@ void __delayacct_freepages_end(void)
 			&current->delays->freepages_count);
 }
 
+/*
+ * Like delayacct_end(), for the TASKSTATS_IO_* wait of @kind, also
+ * counting the wait in its log2 microsecond histogram bucket.
+ */
+static void delayacct_io_end(u64 *start, int kind)
+{
+	s64 ns = ktime_get_ns() - *start;
+	struct task_delay_info *delays = current->delays;
+	unsigned long flags, us;
+	int bucket = 0;
+
+	if (ns <= 0)
+		return;
+
+	us = div_u64(ns, NSEC_PER_USEC);
+	if (us)
+		bucket = min_t(int, ilog2(us) + 1, TASKSTATS_IO_HIST_NR - 1);
+
+	spin_lock_irqsave(&delays->lock, flags);
+	delays->io_wait_delay[kind] += ns;
+	delays->io_wait_count[kind]++;
+	delays->io_wait_hist[kind][bucket]++;
+	spin_unlock_irqrestore(&delays->lock, flags);
+}
+
+void __delayacct_io_wait_start(void)
+{
+	current->delays->io_wait_start = ktime_get_ns();
+}
+
+void __delayacct_io_wait_end(int kind)
+{
+	delayacct_io_end(&current->delays->io_wait_start, kind);
+}
+
+void __delayacct_fsync_start(void)
+{
+	current->delays->flags |= DELAYACCT_PF_FSYNC;
+	current->delays->fsync_start = ktime_get_ns();
+}
+
+void __delayacct_fsync_end(void)
+{
+	current->delays->flags &= ~DELAYACCT_PF_FSYNC;
+	delayacct_io_end(&current->delays->fsync_start, TASKSTATS_IO_FSYNC);
+}
+
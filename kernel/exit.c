@@ -53,6 +53,7 @@
 #include <linux/writeback.h>
 #include <linux/shm.h>
 #include <linux/kcov.h>
+#include <linux/simple_lmk.h>
 
 #include "sched/tune.h"
 
@@ -72,6 +73,7 @@ static void __unhash_process(struct task_struct *p, bool group_dead)
 		detach_pid(p, PIDTYPE_SID);
 
 		list_del_rcu(&p->tasks);
+		simple_lmk_signal_del(p->signal);
 		list_del_init(&p->sibling);
 		__this_cpu_dec(process_counts);
 	}
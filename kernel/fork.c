@@ -83,6 +83,7 @@
 #include <linux/cpufreq_times.h>
 #include <linux/devfreq_boost.h>
 #include <linux/simple_lmk.h>
+#include <linux/launch_prefetch.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -631,6 +632,12 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 #if defined(CONFIG_TRANSPARENT_HUGEPAGE) && !USE_SPLIT_PMD_PTLOCKS
 	mm->pmd_huge_pte = NULL;
 #endif
+#ifdef CONFIG_LAUNCH_PREFETCH
+	mm->launch_rec = NULL;
+#endif
+#ifdef CONFIG_FUTEX
+	mm->futex_hash = NULL;
+#endif
 
 	if (current->mm) {
 		mm->flags = current->mm->flags & MMF_INIT_MASK;
@@ -707,6 +714,7 @@ void __mmdrop(struct mm_struct *mm)
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
 	check_mm(mm);
+	futex_private_hash_free(mm);
 	put_user_ns(mm->user_ns);
 	free_mm(mm);
 }
@@ -722,6 +730,7 @@ static inline void __mmput(struct mm_struct *mm)
 	khugepaged_exit(mm); /* must run before exit_mmap */
 	exit_mmap(mm);
 	simple_lmk_mm_freed(mm);
+	launch_prefetch_mm_exit(mm);
 	set_mm_exe_file(mm, NULL);
 	if (!list_empty(&mm->mmlist)) {
 		spin_lock(&mmlist_lock);
@@ -1221,6 +1230,9 @@ static int copy_signal(unsigned long clone_flags, struct task_struct *tsk)
 
 	sig->oom_score_adj = current->signal->oom_score_adj;
 	sig->oom_score_adj_min = current->signal->oom_score_adj_min;
+#ifdef CONFIG_ANDROID_SIMPLE_LMK
+	INIT_HLIST_NODE(&sig->simple_lmk_node);
+#endif
 
 	sig->has_child_subreaper = current->signal->has_child_subreaper ||
 				   current->signal->is_child_subreaper;
@@ -1531,6 +1543,9 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	p->utime = p->stime = p->gtime = 0;
 	p->utimescaled = p->stimescaled = 0;
 	prev_cputime_init(&p->prev_cputime);
+#ifdef CONFIG_KRYO_TASK_COUNTERS
+	memset(p->kryo_counts, 0, sizeof(p->kryo_counts));
+#endif
 
 #ifdef CONFIG_VIRT_CPU_ACCOUNTING_GEN
 	seqlock_init(&p->vtime_seqlock);
@@ -1667,6 +1682,9 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	p->plug = NULL;
 #endif
 	futex_init_task(p);
+	if ((clone_flags & CLONE_THREAD) && current->mm)
+		futex_private_hash_check(current->mm,
+					 get_nr_threads(current) + 1);
 
 	/*
 	 * sigaltstack should be cleared when sharing the same VM
@@ -1788,6 +1806,7 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 			p->signal->tty = tty_kref_get(current->signal->tty);
 			list_add_tail(&p->sibling, &p->real_parent->children);
 			list_add_tail_rcu(&p->tasks, &init_task.tasks);
+			simple_lmk_signal_add(p->signal);
 			attach_pid(p, PIDTYPE_PGID);
 			attach_pid(p, PIDTYPE_SID);
 			__this_cpu_inc(process_counts);
@@ -156,6 +156,55 @@ void __thaw_task(struct task_struct *p)
 	spin_unlock_irqrestore(&freezer_lock, flags);
 }
 
+/**
+ * freeze_tasks - freeze_task() a batch of tasks
+ * @tasks: tasks to freeze, the caller holds references
+ * @nr: number of tasks in @tasks
+ *
+ * Same as calling freeze_task() on each of @tasks but freezer_lock is only
+ * taken once for the whole batch.
+ *
+ * Return: the number of tasks woken up to freeze.
+ */
+int freeze_tasks(struct task_struct **tasks, int nr)
+{
+	unsigned long flags;
+	int i, woken = 0;
+
+	spin_lock_irqsave(&freezer_lock, flags);
+	for (i = 0; i < nr; i++) {
+		struct task_struct *p = tasks[i];
+
+		if (freezer_should_skip(p) || !freezing(p) || frozen(p))
+			continue;
+
+		if (!(p->flags & PF_KTHREAD))
+			fake_signal_wake_up(p);
+		else
+			wake_up_state(p, TASK_INTERRUPTIBLE);
+		woken++;
+	}
+	spin_unlock_irqrestore(&freezer_lock, flags);
+	return woken;
+}
+
+/**
+ * thaw_tasks - __thaw_task() a batch of tasks
+ * @tasks: tasks to thaw, the caller holds references
+ * @nr: number of tasks in @tasks
+ */
+void thaw_tasks(struct task_struct **tasks, int nr)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&freezer_lock, flags);
+	for (i = 0; i < nr; i++)
+		if (frozen(tasks[i]))
+			wake_up_process(tasks[i]);
+	spin_unlock_irqrestore(&freezer_lock, flags);
+}
+
 /**
  * set_freezable - make %current freezable
  *
@@ -393,6 +393,162 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+/*
+ * Once a process has enough threads, its FUTEX_PRIVATE_FLAG futexes are
+ * hashed into a table of its own, so unrelated processes no longer share
+ * hash bucket locks and cachelines with it. Only the non-PI operations use
+ * it: PI futexes and requeue-PI waiters always stay on the global table,
+ * which keeps futex_requeue() and the PI state handling unchanged.
+ *
+ * The table is installed with the waiters already queued on the global
+ * table for this mm, so those are migrated over while ->migrating is set.
+ * Lookups wait for the migration to finish, and any operation that hashed
+ * to the global table before the table was published notices it under the
+ * bucket lock (futex_hb_stale()) and retries.
+ */
+struct futex_private_hash {
+	unsigned long hashsize;
+	int migrating;
+	struct futex_hash_bucket queues[];
+};
+
+/* Number of threads at which a process gets its own table, 0 disables */
+int sysctl_futex_private_hash_threads __read_mostly;
+
+static inline bool futex_key_is_private(union futex_key *key)
+{
+	return !(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED));
+}
+
+static inline bool futex_hb_is_global(struct futex_hash_bucket *hb)
+{
+	return hb >= futex_queues && hb < futex_queues + futex_hashsize;
+}
+
+static struct futex_hash_bucket *
+__hash_futex_private(struct futex_private_hash *ph, union futex_key *key)
+{
+	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
+			  key->both.offset);
+
+	return &ph->queues[hash & (ph->hashsize - 1)];
+}
+
+/*
+ * Like hash_futex(), but private keys hash into the per-mm table when the
+ * process has one. Used by the non-PI operations only.
+ */
+static struct futex_hash_bucket *hash_futex_mm(union futex_key *key)
+{
+	struct futex_private_hash *ph;
+
+	if (!futex_key_is_private(key))
+		return hash_futex(key);
+
+	ph = READ_ONCE(key->private.mm->futex_hash);
+	if (!ph)
+		return hash_futex(key);
+
+	while (smp_load_acquire(&ph->migrating))
+		cpu_relax();
+
+	return __hash_futex_private(ph, key);
+}
+
+/*
+ * Must be called with hb->lock held, where hb was returned by
+ * hash_futex_mm(). Returns true if the per-mm table was installed in the
+ * meantime, in which case the caller has to unlock and hash again.
+ */
+static inline bool futex_hb_stale(union futex_key *key,
+				  struct futex_hash_bucket *hb)
+{
+	return futex_key_is_private(key) &&
+	       READ_ONCE(key->private.mm->futex_hash) &&
+	       futex_hb_is_global(hb);
+}
+
+static void futex_private_hash_install(struct mm_struct *mm)
+{
+	unsigned long i, hashsize = roundup_pow_of_two(16 * num_possible_cpus());
+	struct futex_private_hash *ph;
+
+	ph = kzalloc(sizeof(*ph) + hashsize * sizeof(ph->queues[0]),
+		     GFP_KERNEL | __GFP_NOWARN);
+	if (!ph)
+		return;
+
+	ph->hashsize = hashsize;
+	ph->migrating = 1;
+	for (i = 0; i < hashsize; i++) {
+		atomic_set(&ph->queues[i].waiters, 0);
+		plist_head_init(&ph->queues[i].chain);
+		spin_lock_init(&ph->queues[i].lock);
+	}
+
+	/* Implies a full barrier, pairs with MB (A) in hb_waiters_inc() */
+	if (cmpxchg(&mm->futex_hash, NULL, ph)) {
+		kfree(ph);
+		return;
+	}
+
+	/*
+	 * Lookups spin while we migrate, so do not get preempted. A bucket
+	 * without waiters can be skipped: anybody queueing there from now on
+	 * sees the new table under the bucket lock and moves over by itself.
+	 */
+	preempt_disable();
+	for (i = 0; i < futex_hashsize; i++) {
+		struct futex_hash_bucket *hb = &futex_queues[i];
+		struct futex_q *this, *next;
+
+		if (!hb_waiters_pending(hb))
+			continue;
+
+		spin_lock(&hb->lock);
+		plist_for_each_entry_safe(this, next, &hb->chain, list) {
+			struct futex_hash_bucket *dst;
+
+			if (!futex_key_is_private(&this->key) ||
+			    this->key.private.mm != mm ||
+			    this->pi_state || this->rt_waiter)
+				continue;
+
+			dst = __hash_futex_private(ph, &this->key);
+			spin_lock_nested(&dst->lock, SINGLE_DEPTH_NESTING);
+			plist_del(&this->list, &hb->chain);
+			hb_waiters_dec(hb);
+			hb_waiters_inc(dst);
+			plist_add(&this->list, &dst->chain);
+			this->lock_ptr = &dst->lock;
+			spin_unlock(&dst->lock);
+		}
+		spin_unlock(&hb->lock);
+	}
+	smp_store_release(&ph->migrating, 0);
+	preempt_enable();
+}
+
+/*
+ * Called from copy_process() before a new thread is added to @mm, with
+ * @nr_threads being the thread count including the new one.
+ */
+void futex_private_hash_check(struct mm_struct *mm, int nr_threads)
+{
+	int threshold = READ_ONCE(sysctl_futex_private_hash_threads);
+
+	if (!threshold || nr_threads < threshold || READ_ONCE(mm->futex_hash))
+		return;
+
+	futex_private_hash_install(mm);
+}
+
+void futex_private_hash_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+	mm->futex_hash = NULL;
+}
+
 /*
  * Return 1 if two futex_keys are equal, 0 otherwise.
  */
@@ -1659,13 +1815,18 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	if (unlikely(ret != 0))
 		goto out;
 
-	hb = hash_futex(&key);
+retry_hash:
+	hb = hash_futex_mm(&key);
 
 	/* Make sure we really have tasks to wakeup */
 	if (!hb_waiters_pending(hb))
 		goto out_put_key;
 
 	spin_lock(&hb->lock);
+	if (unlikely(futex_hb_stale(&key, hb))) {
+		spin_unlock(&hb->lock);
+		goto retry_hash;
+	}
 
 	plist_for_each_entry_safe(this, next, &hb->chain, list) {
 		if (match_futex (&this->key, &key)) {
@@ -1761,11 +1922,18 @@ retry:
 	if (unlikely(ret != 0))
 		goto out_put_key1;
 
-	hb1 = hash_futex(&key1);
-	hb2 = hash_futex(&key2);
+	hb1 = hash_futex_mm(&key1);
+	hb2 = hash_futex_mm(&key2);
 
 retry_private:
 	double_lock_hb(hb1, hb2);
+	if (unlikely(futex_hb_stale(&key1, hb1) ||
+		     futex_hb_stale(&key2, hb2))) {
+		double_unlock_hb(hb1, hb2);
+		hb1 = hash_futex_mm(&key1);
+		hb2 = hash_futex_mm(&key2);
+		goto retry_private;
+	}
 	op_ret = futex_atomic_op_inuser(op, uaddr2);
 	if (unlikely(op_ret < 0)) {
 
@@ -2047,13 +2215,27 @@ retry:
 		goto out_put_keys;
 	}
 
-	hb1 = hash_futex(&key1);
-	hb2 = hash_futex(&key2);
+	if (requeue_pi) {
+		hb1 = hash_futex(&key1);
+		hb2 = hash_futex(&key2);
+	} else {
+		hb1 = hash_futex_mm(&key1);
+		hb2 = hash_futex_mm(&key2);
+	}
 
 retry_private:
 	hb_waiters_inc(hb2);
 	double_lock_hb(hb1, hb2);
 
+	if (unlikely(!requeue_pi && (futex_hb_stale(&key1, hb1) ||
+				     futex_hb_stale(&key2, hb2)))) {
+		double_unlock_hb(hb1, hb2);
+		hb_waiters_dec(hb2);
+		hb1 = hash_futex_mm(&key1);
+		hb2 = hash_futex_mm(&key2);
+		goto retry_private;
+	}
+
 	if (likely(cmpval != NULL)) {
 		u32 curval;
 
@@ -2247,14 +2429,10 @@ out:
 	return ret ? ret : task_count;
 }
 
-/* The key must be already stored in q->key. */
-static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
+static inline struct futex_hash_bucket *
+__queue_lock(struct futex_q *q, struct futex_hash_bucket *hb)
 	__acquires(&hb->lock)
 {
-	struct futex_hash_bucket *hb;
-
-	hb = hash_futex(&q->key);
-
 	/*
 	 * Increment the counter before taking the lock so that
 	 * a potential waker won't miss a to-be-slept task that is
@@ -2271,6 +2449,13 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	return hb;
 }
 
+/* The key must be already stored in q->key. */
+static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
+	__acquires(&hb->lock)
+{
+	return __queue_lock(q, hash_futex(&q->key));
+}
+
 static inline void
 queue_unlock(struct futex_hash_bucket *hb)
 	__releases(&hb->lock)
@@ -2279,6 +2464,23 @@ queue_unlock(struct futex_hash_bucket *hb)
 	hb_waiters_dec(hb);
 }
 
+/*
+ * Same as queue_lock(), but for the non-PI waiters which use the per-mm
+ * private hash when there is one.
+ */
+static struct futex_hash_bucket *queue_lock_mm(struct futex_q *q)
+	__acquires(&hb->lock)
+{
+	struct futex_hash_bucket *hb;
+
+	for (;;) {
+		hb = __queue_lock(q, hash_futex_mm(&q->key));
+		if (likely(!futex_hb_stale(&q->key, hb)))
+			return hb;
+		queue_unlock(hb);
+	}
+}
+
 static inline void __queue_me(struct futex_q *q, struct futex_hash_bucket *hb)
 {
 	int prio;
@@ -2697,7 +2899,8 @@ retry:
 		return ret;
 
 retry_private:
-	*hb = queue_lock(q);
+	/* Requeue-PI waiters stay on the global hash, see hash_futex_mm() */
+	*hb = q->rt_waiter ? queue_lock(q) : queue_lock_mm(q);
 
 	ret = get_futex_value_locked(&uval, uaddr);
 
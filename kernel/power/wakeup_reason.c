@@ -26,6 +26,8 @@
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
+#include <linux/device.h>
+#include <linux/kernel_stat.h>
 
 
 #define MAX_WAKEUP_REASON_IRQS 32
@@ -36,6 +38,34 @@ static char abort_reason[MAX_SUSPEND_ABORT_LEN];
 static struct kobject *wakeup_reason;
 static DEFINE_SPINLOCK(resume_reason_lock);
 
+/* The slowest device resume callbacks of the last resume, slowest first */
+#define MAX_RESUME_DEVICES 10
+struct resume_device_time {
+	char name[48];
+	const char *info;
+	s64 usecs;
+};
+static struct resume_device_time resume_devices[MAX_RESUME_DEVICES];
+static int resume_device_count;
+
+/*
+ * CPU time spent between a resume and the following suspend, charged to
+ * the first wakeup irq of that resume (-1 when there was none, including
+ * aborted suspends).
+ */
+#define MAX_WAKEUP_COST_SOURCES 32
+struct wakeup_cost {
+	int irq;
+	unsigned int count;
+	u64 busy_ms;
+	u64 awake_ms;
+};
+static struct wakeup_cost wakeup_costs[MAX_WAKEUP_COST_SOURCES];
+static int wakeup_cost_count;
+static int cost_irq;
+static bool cost_pending;
+static u64 cost_busy_start; /* cputime64 of all cpus after last resume */
+
 static ktime_t last_monotime; /* monotonic time before last suspend */
 static ktime_t curr_monotime; /* monotonic time after last suspend */
 static ktime_t last_stime; /* monotonic boottime offset before last suspend */
@@ -92,12 +122,59 @@ static ssize_t last_suspend_time_show(struct kobject *kobj,
 				sleep_time.tv_sec, sleep_time.tv_nsec);
 }
 
+/* One line per device: "<usecs> <phase/callback type> <driver> <device>" */
+static ssize_t last_resume_devices_show(struct kobject *kobj,
+			struct kobj_attribute *attr, char *buf)
+{
+	int i, buf_offset = 0;
+
+	spin_lock(&resume_reason_lock);
+	for (i = 0; i < resume_device_count; i++)
+		buf_offset += scnprintf(buf + buf_offset, PAGE_SIZE - buf_offset,
+				"%lld %s%s\n", resume_devices[i].usecs,
+				resume_devices[i].info ?: "",
+				resume_devices[i].name);
+	spin_unlock(&resume_reason_lock);
+	return buf_offset;
+}
+
+/* One line per wakeup irq: "<irq> <name> <count> <busy_ms> <awake_ms>" */
+static ssize_t wakeup_cost_show(struct kobject *kobj,
+			struct kobj_attribute *attr, char *buf)
+{
+	int i, buf_offset = 0;
+	struct irq_desc *desc;
+	const char *name;
+
+	spin_lock(&resume_reason_lock);
+	for (i = 0; i < wakeup_cost_count; i++) {
+		struct wakeup_cost *wc = &wakeup_costs[i];
+
+		name = "unknown";
+		if (wc->irq >= 0) {
+			desc = irq_to_desc(wc->irq);
+			if (desc && desc->action && desc->action->name)
+				name = desc->action->name;
+		}
+		buf_offset += scnprintf(buf + buf_offset, PAGE_SIZE - buf_offset,
+				"%d %s %u %llu %llu\n", wc->irq, name,
+				wc->count, wc->busy_ms, wc->awake_ms);
+	}
+	spin_unlock(&resume_reason_lock);
+	return buf_offset;
+}
+
 static struct kobj_attribute resume_reason = __ATTR_RO(last_resume_reason);
 static struct kobj_attribute suspend_time = __ATTR_RO(last_suspend_time);
+static struct kobj_attribute resume_devices_attr =
+	__ATTR_RO(last_resume_devices);
+static struct kobj_attribute wakeup_cost_attr = __ATTR_RO(wakeup_cost);
 
 static struct attribute *attrs[] = {
 	&resume_reason.attr,
 	&suspend_time.attr,
+	&resume_devices_attr.attr,
+	&wakeup_cost_attr.attr,
 	NULL,
 };
 static struct attribute_group attr_group = {
@@ -164,15 +241,101 @@ void log_suspend_abort_reason(const char *fmt, ...)
 	spin_unlock(&resume_reason_lock);
 }
 
+/*
+ * Called by the PM core after each device resume callback, keeps the
+ * MAX_RESUME_DEVICES slowest ones for last_resume_devices.
+ */
+void log_device_resume_time(struct device *dev, const char *info, s64 usecs)
+{
+	int i;
+
+	spin_lock(&resume_reason_lock);
+	if (resume_device_count == MAX_RESUME_DEVICES &&
+	    usecs <= resume_devices[MAX_RESUME_DEVICES - 1].usecs) {
+		spin_unlock(&resume_reason_lock);
+		return;
+	}
+
+	if (resume_device_count < MAX_RESUME_DEVICES)
+		resume_device_count++;
+	for (i = resume_device_count - 1;
+	     i > 0 && resume_devices[i - 1].usecs < usecs; i--)
+		resume_devices[i] = resume_devices[i - 1];
+
+	snprintf(resume_devices[i].name, sizeof(resume_devices[i].name),
+		 "%s %s", dev_driver_string(dev), dev_name(dev));
+	resume_devices[i].info = info;
+	resume_devices[i].usecs = usecs;
+	spin_unlock(&resume_reason_lock);
+}
+
+static u64 cpu_busy_cputime(void)
+{
+	u64 busy = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+
+		busy += cpustat[CPUTIME_USER] + cpustat[CPUTIME_NICE] +
+			cpustat[CPUTIME_SYSTEM] + cpustat[CPUTIME_IRQ] +
+			cpustat[CPUTIME_SOFTIRQ] + cpustat[CPUTIME_STEAL];
+	}
+	return busy;
+}
+
+/* Charge the time since the last resume to the irq that caused it */
+static void account_wakeup_cost(void)
+{
+	u64 busy, awake;
+	int i;
+
+	if (!cost_pending)
+		return;
+	cost_pending = false;
+
+	busy = cputime64_to_clock_t(cpu_busy_cputime() - cost_busy_start) *
+		(MSEC_PER_SEC / USER_HZ);
+	awake = ktime_to_ms(ktime_sub(ktime_get(), curr_monotime));
+
+	spin_lock(&resume_reason_lock);
+	for (i = 0; i < wakeup_cost_count; i++)
+		if (wakeup_costs[i].irq == cost_irq)
+			break;
+	if (i == wakeup_cost_count) {
+		if (wakeup_cost_count == MAX_WAKEUP_COST_SOURCES) {
+			/* Table full, fold into the "unknown" source */
+			cost_irq = -1;
+			for (i = 0; i < wakeup_cost_count; i++)
+				if (wakeup_costs[i].irq == -1)
+					break;
+			if (i == wakeup_cost_count)
+				i = wakeup_cost_count - 1;
+		} else {
+			wakeup_cost_count++;
+		}
+		if (wakeup_costs[i].irq != cost_irq) {
+			memset(&wakeup_costs[i], 0, sizeof(wakeup_costs[i]));
+			wakeup_costs[i].irq = cost_irq;
+		}
+	}
+	wakeup_costs[i].count++;
+	wakeup_costs[i].busy_ms += busy;
+	wakeup_costs[i].awake_ms += awake;
+	spin_unlock(&resume_reason_lock);
+}
+
 /* Detects a suspend and clears all the previous wake up reasons*/
 static int wakeup_reason_pm_event(struct notifier_block *notifier,
 		unsigned long pm_event, void *unused)
 {
 	switch (pm_event) {
 	case PM_SUSPEND_PREPARE:
+		account_wakeup_cost();
 		spin_lock(&resume_reason_lock);
 		irqcount = 0;
 		suspend_abort = false;
+		resume_device_count = 0;
 		spin_unlock(&resume_reason_lock);
 		/* monotonic time since boot */
 		last_monotime = ktime_get();
@@ -184,6 +347,11 @@ static int wakeup_reason_pm_event(struct notifier_block *notifier,
 		curr_monotime = ktime_get();
 		/* monotonic time since boot including the time spent in suspend */
 		curr_stime = ktime_get_boottime();
+		spin_lock(&resume_reason_lock);
+		cost_irq = (!suspend_abort && irqcount) ? irq_list[0] : -1;
+		spin_unlock(&resume_reason_lock);
+		cost_busy_start = cpu_busy_cputime();
+		cost_pending = true;
 		break;
 	default:
 		break;
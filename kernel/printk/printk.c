@@ -46,6 +46,7 @@
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -1671,6 +1672,8 @@ static size_t cont_print_text(char *text, size_t size)
 	return textlen;
 }
 
+static bool printk_defer_console(int level);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1825,7 +1828,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && !printk_defer_console(level)) {
 		lockdep_off();
 		/*
 		 * Disable preemption to avoid being preempted while holding
@@ -2753,13 +2756,41 @@ late_initcall(printk_late_init);
 
 static DEFINE_PER_CPU(int, printk_pending);
 
+/*
+ * With printk.console_kthread set, console output is written by a
+ * dedicated kthread instead of the context that called printk(), so a
+ * driver flooding the log from an IRQ handler only pays for storing the
+ * message. EMERG/ALERT messages, oopses and early boot or shutdown still
+ * print synchronously.
+ */
+static bool console_kthread;
+module_param(console_kthread, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(console_kthread, "write console output from a kthread");
+
+static struct task_struct *console_thread;
+static int console_thread_pending;
+
+static bool console_thread_active(void)
+{
+	return READ_ONCE(console_kthread) && console_thread &&
+		!oops_in_progress && system_state == SYSTEM_RUNNING;
+}
+
+static void wake_console_thread(void)
+{
+	WRITE_ONCE(console_thread_pending, 1);
+	wake_up_process(console_thread);
+}
+
 static void wake_up_klogd_work_func(struct irq_work *irq_work)
 {
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (console_thread_active())
+			wake_console_thread();
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2772,6 +2803,49 @@ static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
 	.flags = IRQ_WORK_LAZY,
 };
 
+static bool printk_defer_console(int level)
+{
+	if (level <= LOGLEVEL_ALERT || !console_thread_active())
+		return false;
+
+	/* The wakeup goes through irq_work: we may be under any lock here */
+	preempt_disable();
+	this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	preempt_enable();
+	return true;
+}
+
+static int console_thread_fn(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!xchg(&console_thread_pending, 0)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init console_thread_init(void)
+{
+	struct task_struct *p;
+
+	p = kthread_run(console_thread_fn, NULL, "printk");
+	if (IS_ERR(p)) {
+		pr_err("printk: cannot start console thread\n");
+		return PTR_ERR(p);
+	}
+	console_thread = p;
+	return 0;
+}
+late_initcall(console_thread_init);
+
 void wake_up_klogd(void)
 {
 	preempt_disable();
@@ -957,6 +957,7 @@ void activate_task(struct rq *rq, struct task_struct *p, int flags)
 		rq->nr_uninterruptible--;
 
 	enqueue_task(rq, p, flags);
+	core_ctl_check_nr_running(cpu_of(rq));
 }
 
 void deactivate_task(struct rq *rq, struct task_struct *p, int flags)
@@ -1887,6 +1888,7 @@ static void ttwu_do_wakeup(struct rq *rq, struct task_struct *p, int wake_flags,
 	check_preempt_curr(rq, p, wake_flags);
 
 	p->state = TASK_RUNNING;
+	p->sched_wakeup_ts = rq_clock(rq);
 	trace_sched_wakeup(p);
 
 #ifdef CONFIG_SMP
@@ -3111,6 +3113,22 @@ unsigned long nr_running(void)
 	return sum;
 }
 
+/*
+ * Lockless sum of nr_running over the online, non-isolated CPUs in @cpus.
+ */
+unsigned long nr_running_active_cpus(const struct cpumask *cpus)
+{
+	unsigned long sum = 0;
+	int i;
+
+	for_each_cpu_and(i, cpus, cpu_online_mask) {
+		if (!cpu_isolated(i))
+			sum += READ_ONCE(cpu_rq(i)->nr_running);
+	}
+
+	return sum;
+}
+
 /*
  * Check if only the current task is running on the cpu.
  *
@@ -3685,6 +3703,9 @@ static void __sched notrace __schedule(bool preempt)
 	clear_tsk_need_resched(prev);
 	clear_preempt_need_resched();
 
+	if (next->sched_wakeup_ts)
+		sched_lat_hist_record(rq, next);
+
 	BUG_ON(task_cpu(next) != cpu_of(rq));
 
 	wallclock = sched_ktime_clock();
@@ -8689,6 +8710,7 @@ void __init sched_init(void)
 		rq->online = 0;
 		rq->idle_stamp = 0;
 		rq->avg_idle = 2*sysctl_sched_migration_cost;
+		rq->idle_depth = -1;
 #ifdef CONFIG_SCHED_HMP
 		cpumask_set_cpu(i, &rq->freq_domain_cpumask);
 		rq->hmp_stats.cumulative_runnable_avg = 0;
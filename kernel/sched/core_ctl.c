@@ -20,12 +20,21 @@
 #include <linux/kthread.h>
 #include <linux/sched.h>
 #include <linux/sched/rt.h>
+#include <linux/irq_work.h>
+#include <soc/qcom/irq-helper.h>
 
 #include <trace/events/sched.h>
 
 #define MAX_CPUS_PER_CLUSTER 4
 #define MAX_CLUSTERS 2
 
+struct isolation_stats {
+	u64 count;
+	u64 last_ns;
+	u64 max_ns;
+	u64 total_ns;
+};
+
 struct cluster_data {
 	bool inited;
 	unsigned int min_cpus;
@@ -51,6 +60,10 @@ struct cluster_data {
 	struct task_struct *core_ctl_thread;
 	unsigned int first_cpu;
 	unsigned int boost;
+	unsigned int fast_unisolate_nr;
+	struct irq_work fast_unisolate_work;
+	struct isolation_stats isolate_stats;
+	struct isolation_stats unisolate_stats;
 	struct kobject kobj;
 };
 
@@ -270,6 +283,55 @@ static ssize_t show_enable(const struct cluster_data *state, char *buf)
 	return scnprintf(buf, PAGE_SIZE, "%u\n", state->enable);
 }
 
+static ssize_t store_fast_unisolate_nr(struct cluster_data *state,
+					const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	WRITE_ONCE(state->fast_unisolate_nr, val);
+
+	return count;
+}
+
+static ssize_t show_fast_unisolate_nr(const struct cluster_data *state,
+				      char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->fast_unisolate_nr);
+}
+
+static ssize_t show_isolation_stats(const struct isolation_stats *stats,
+				    char *buf)
+{
+	struct isolation_stats s;
+	unsigned long flags;
+
+	spin_lock_irqsave(&state_lock, flags);
+	s = *stats;
+	spin_unlock_irqrestore(&state_lock, flags);
+
+	return snprintf(buf, PAGE_SIZE,
+			"count=%llu last_us=%llu max_us=%llu avg_us=%llu\n",
+			s.count, div64_u64(s.last_ns, NSEC_PER_USEC),
+			div64_u64(s.max_ns, NSEC_PER_USEC),
+			s.count ? div64_u64(s.total_ns,
+					    s.count * NSEC_PER_USEC) : 0);
+}
+
+static ssize_t show_isolate_latency(const struct cluster_data *state,
+				    char *buf)
+{
+	return show_isolation_stats(&state->isolate_stats, buf);
+}
+
+static ssize_t show_unisolate_latency(const struct cluster_data *state,
+				      char *buf)
+{
+	return show_isolation_stats(&state->unisolate_stats, buf);
+}
+
 static ssize_t show_need_cpus(const struct cluster_data *state, char *buf)
 {
 	return snprintf(buf, PAGE_SIZE, "%u\n", state->need_cpus);
@@ -399,6 +461,9 @@ core_ctl_attr_ro(active_cpus);
 core_ctl_attr_ro(global_state);
 core_ctl_attr_rw(not_preferred);
 core_ctl_attr_rw(enable);
+core_ctl_attr_rw(fast_unisolate_nr);
+core_ctl_attr_ro(isolate_latency);
+core_ctl_attr_ro(unisolate_latency);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -413,6 +478,9 @@ static struct attribute *default_attrs[] = {
 	&active_cpus.attr,
 	&global_state.attr,
 	&not_preferred.attr,
+	&fast_unisolate_nr.attr,
+	&isolate_latency.attr,
+	&unisolate_latency.attr,
 	NULL
 };
 
@@ -727,6 +795,77 @@ void core_ctl_check(u64 wallclock)
 	}
 }
 
+/*
+ * Fast unisolate: the regular evaluation only runs from the timer CPU's
+ * tick every rq_avg_period_ms and then waits for the core_ctl thread. When
+ * the active CPUs of a cluster are clearly oversubscribed that round trip
+ * is too slow, so the enqueue path raises the need directly and kicks the
+ * thread from irq_work (the rq lock is held, so no direct wakeup here).
+ */
+static void core_ctl_fast_unisolate(struct irq_work *work)
+{
+	struct cluster_data *cluster = container_of(work, struct cluster_data,
+						    fast_unisolate_work);
+	unsigned int nr, thres, need, old_need;
+	unsigned long flags;
+	bool wake = false;
+
+	spin_lock_irqsave(&state_lock, flags);
+	thres = cluster->fast_unisolate_nr;
+	if (!thres || !cluster->nr_isolated_cpus) {
+		spin_unlock_irqrestore(&state_lock, flags);
+		return;
+	}
+
+	nr = nr_running_active_cpus(&cluster->cpu_mask);
+	old_need = cluster->need_cpus;
+	need = apply_limits(cluster, max(old_need, DIV_ROUND_UP(nr, thres)));
+	if (need > cluster->active_cpus) {
+		cluster->need_cpus = need;
+		cluster->need_ts = ktime_to_ms(ktime_get());
+		wake = true;
+	}
+	trace_core_ctl_eval_need(cluster->first_cpu, old_need, need, wake);
+	spin_unlock_irqrestore(&state_lock, flags);
+
+	if (wake)
+		wake_up_core_ctl_thread(cluster);
+}
+
+/*
+ * Called with @cpu's rq lock held after a task was enqueued. Only lockless
+ * reads are done here; the decision is made in core_ctl_fast_unisolate().
+ */
+void core_ctl_check_nr_running(int cpu)
+{
+	struct cluster_data *cluster = per_cpu(cpu_state, cpu).cluster;
+	unsigned int thres;
+
+	if (unlikely(!cluster || !cluster->inited))
+		return;
+
+	thres = READ_ONCE(cluster->fast_unisolate_nr);
+	if (!thres || !READ_ONCE(cluster->nr_isolated_cpus))
+		return;
+
+	if (nr_running_active_cpus(&cluster->cpu_mask) >
+	    thres * READ_ONCE(cluster->active_cpus))
+		irq_work_queue(&cluster->fast_unisolate_work);
+}
+
+static void account_isolation(struct isolation_stats *stats, u64 start)
+{
+	u64 delta = sched_clock() - start;
+	unsigned long flags;
+
+	spin_lock_irqsave(&state_lock, flags);
+	stats->count++;
+	stats->last_ns = delta;
+	stats->max_ns = max(stats->max_ns, delta);
+	stats->total_ns += delta;
+	spin_unlock_irqrestore(&state_lock, flags);
+}
+
 static void move_cpu_lru(struct cpu_data *cpu_data)
 {
 	unsigned long flags;
@@ -743,6 +882,7 @@ static void try_to_isolate(struct cluster_data *cluster, unsigned int need)
 	unsigned long flags;
 	unsigned int num_cpus = cluster->num_cpus;
 	unsigned int nr_isolated = 0;
+	u64 start;
 
 	/*
 	 * Protect against entry being removed (and added at tail) by other
@@ -764,7 +904,9 @@ static void try_to_isolate(struct cluster_data *cluster, unsigned int need)
 		spin_unlock_irqrestore(&state_lock, flags);
 
 		pr_debug("Trying to isolate CPU%u\n", c->cpu);
+		start = sched_clock();
 		if (!sched_isolate_cpu(c->cpu)) {
+			account_isolation(&cluster->isolate_stats, start);
 			c->isolated_by_us = true;
 			move_cpu_lru(c);
 			nr_isolated++;
@@ -799,7 +941,9 @@ static void try_to_isolate(struct cluster_data *cluster, unsigned int need)
 		spin_unlock_irqrestore(&state_lock, flags);
 
 		pr_debug("Trying to isolate CPU%u\n", c->cpu);
+		start = sched_clock();
 		if (!sched_isolate_cpu(c->cpu)) {
+			account_isolation(&cluster->isolate_stats, start);
 			c->isolated_by_us = true;
 			move_cpu_lru(c);
 			nr_isolated++;
@@ -821,6 +965,7 @@ static void __try_to_unisolate(struct cluster_data *cluster,
 	unsigned long flags;
 	unsigned int num_cpus = cluster->num_cpus;
 	unsigned int nr_unisolated = 0;
+	u64 start;
 
 	/*
 	 * Protect against entry being removed (and added at tail) by other
@@ -842,7 +987,9 @@ static void __try_to_unisolate(struct cluster_data *cluster,
 		spin_unlock_irqrestore(&state_lock, flags);
 
 		pr_debug("Trying to unisolate CPU%u\n", c->cpu);
+		start = sched_clock();
 		if (!sched_unisolate_cpu(c->cpu)) {
+			account_isolation(&cluster->unisolate_stats, start);
 			c->isolated_by_us = false;
 			move_cpu_lru(c);
 			nr_unisolated++;
@@ -883,6 +1030,7 @@ static void __ref do_core_ctl(struct cluster_data *cluster)
 			try_to_isolate(cluster, need);
 		else if (cluster->active_cpus < need)
 			try_to_unisolate(cluster, need);
+		irq_placement_kick();
 	}
 }
 
@@ -1069,6 +1217,7 @@ static int cluster_init(const struct cpumask *mask)
 	cluster->enable = true;
 	INIT_LIST_HEAD(&cluster->lru);
 	spin_lock_init(&cluster->pending_lock);
+	init_irq_work(&cluster->fast_unisolate_work, core_ctl_fast_unisolate);
 
 	for_each_cpu(cpu, mask) {
 		pr_info("Init CPU%u state\n", cpu);
@@ -28,12 +28,18 @@ unsigned long boosted_cpu_util(int cpu);
 #define cpufreq_disable_fast_switch(x)
 #define LATENCY_MULTIPLIER			(1000)
 #define SUGOV_KTHREAD_PRIORITY	50
+#define DEFAULT_HISPEED_LOAD	90
+/* Roughly one frame at 60fps: how long an idle exit may trigger hispeed */
+#define SUGOV_HISPEED_WINDOW_NS	(17 * NSEC_PER_MSEC)
 
 struct sugov_tunables {
 	struct gov_attr_set attr_set;
 	unsigned int up_rate_limit_us;
 	unsigned int down_rate_limit_us;
 	bool iowait_boost_enable;
+	bool pred_load;
+	unsigned int hispeed_load;
+	unsigned int hispeed_freq;
 };
 
 struct sugov_policy {
@@ -59,6 +65,10 @@ struct sugov_policy {
 	bool work_in_progress;
 
 	bool need_freq_update;
+
+	/* Time the policy last left idle, for the hispeed jump */
+	u64 idle_exit_time;
+	bool hispeed_pending;
 };
 
 struct sugov_cpu {
@@ -85,6 +95,17 @@ struct sugov_cpu {
 static DEFINE_PER_CPU(struct sugov_cpu, sugov_cpu);
 static DEFINE_PER_CPU(struct sugov_tunables *, cached_tunables);
 
+/*
+ * Frequency floor requested by input boost, valid until @expires (jiffies).
+ * Kept outside of sugov_cpu so that it survives governor restarts.
+ */
+struct sugov_input_boost {
+	unsigned int freq;
+	unsigned long expires;
+};
+
+static DEFINE_PER_CPU(struct sugov_input_boost, sugov_input_boost);
+
 /************************ Governor internals ***********************/
 
 static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
@@ -192,6 +213,44 @@ static unsigned int get_next_freq(struct sugov_policy *sg_policy,
 	return cpufreq_driver_resolve_freq(policy, freq);
 }
 
+/*
+ * Like the interactive governor's go_hispeed_load: on the first frame after
+ * the policy was idle, go straight to at least hispeed_freq if the load is
+ * already high, instead of ramping up over several rate limit periods.
+ */
+static unsigned int sugov_hispeed_freq(struct sugov_policy *sg_policy,
+				       u64 time, unsigned long util,
+				       unsigned long max, unsigned int next_f)
+{
+	struct sugov_tunables *tunables = sg_policy->tunables;
+	unsigned int hispeed_freq = READ_ONCE(tunables->hispeed_freq);
+
+	if (!sg_policy->hispeed_pending)
+		return next_f;
+
+	if (time - sg_policy->idle_exit_time > SUGOV_HISPEED_WINDOW_NS) {
+		sg_policy->hispeed_pending = false;
+		return next_f;
+	}
+
+	if (!hispeed_freq || next_f >= hispeed_freq)
+		return next_f;
+
+	if (util * 100 < max * READ_ONCE(tunables->hispeed_load))
+		return next_f;
+
+	sg_policy->hispeed_pending = false;
+	sg_policy->cached_raw_freq = 0;
+	return cpufreq_driver_resolve_freq(sg_policy->policy, hispeed_freq);
+}
+
+static inline void sugov_mark_idle_exit(struct sugov_policy *sg_policy,
+					u64 time)
+{
+	sg_policy->idle_exit_time = time;
+	sg_policy->hispeed_pending = true;
+}
+
 static inline bool use_pelt(void)
 {
 #ifdef CONFIG_SCHED_WALT
@@ -201,14 +260,58 @@ static inline bool use_pelt(void)
 #endif
 }
 
+void sugov_set_input_boost(int cpu, unsigned int freq, unsigned long expires)
+{
+	struct sugov_input_boost *ib = &per_cpu(sugov_input_boost, cpu);
+
+	WRITE_ONCE(ib->expires, expires);
+	WRITE_ONCE(ib->freq, freq);
+}
+EXPORT_SYMBOL_GPL(sugov_set_input_boost);
+
+/*
+ * Convert an active input boost frequency floor into the utilization that
+ * makes get_next_freq() select at least that frequency.
+ */
+static unsigned long sugov_input_boost_util(int cpu, unsigned long max_cap)
+{
+	struct sugov_input_boost *ib = &per_cpu(sugov_input_boost, cpu);
+	struct cpufreq_policy *policy = per_cpu(sugov_cpu, cpu).sg_policy->policy;
+	unsigned int freq = READ_ONCE(ib->freq);
+	unsigned int base;
+
+	if (!freq || time_after_eq(jiffies, READ_ONCE(ib->expires)))
+		return 0;
+
+	base = arch_scale_freq_invariant() ? policy->cpuinfo.max_freq :
+					     policy->cur;
+	if (!base)
+		return 0;
+
+	return DIV_ROUND_UP((u64)freq * max_cap * 4, (u64)base * 5);
+}
+
 static void sugov_get_util(unsigned long *util, unsigned long *max, u64 time, int cpu)
 {
+	struct sugov_tunables *tunables = per_cpu(sugov_cpu, cpu).sg_policy->tunables;
 	struct rq *rq = cpu_rq(cpu);
 	unsigned long max_cap, rt;
 	s64 delta;
 
 	max_cap = arch_scale_cpu_capacity(NULL, cpu);
 
+	/*
+	 * Window based load already accounts for RT time, and reacts within
+	 * one window to tasks predicted to burst.
+	 */
+	if (READ_ONCE(tunables->pred_load)) {
+		*util = schedtune_cpu_util_clamp(cpu, cpu_util_freq_pred(cpu));
+		*util = max(*util, sugov_input_boost_util(cpu, max_cap));
+		*util = min(*util, max_cap);
+		*max = max_cap;
+		return;
+	}
+
 	sched_avg_update(rq);
 	delta = time - rq->age_stamp;
 	if (unlikely(delta < 0))
@@ -220,6 +323,8 @@ static void sugov_get_util(unsigned long *util, unsigned long *max, u64 time, in
 	if (use_pelt())
 		*util = *util + rt;
 
+	*util = schedtune_cpu_util_clamp(cpu, *util);
+	*util = max(*util, sugov_input_boost_util(cpu, max_cap));
 	*util = min(*util, max_cap);
 	*max = max_cap;
 }
@@ -310,6 +415,8 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 
 	flags &= ~SCHED_CPUFREQ_RT;
 	sugov_set_iowait_boost(sg_cpu, time, flags);
+	if (time - sg_cpu->last_update > TICK_NSEC)
+		sugov_mark_idle_exit(sg_policy, time);
 	sg_cpu->last_update = time;
 
 	/*
@@ -330,6 +437,7 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 		sugov_get_util(&util, &max, time, sg_cpu->cpu);
 		sugov_iowait_boost(sg_cpu, &util, &max);
 		next_f = get_next_freq(sg_policy, util, max);
+		next_f = sugov_hispeed_freq(sg_policy, time, util, max, next_f);
 		/*
 		 * Do not reduce the frequency if the CPU has not been idle
 		 * recently, as the reduction is likely to be premature then.
@@ -382,7 +490,26 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 		sugov_iowait_boost(j_sg_cpu, &util, &max);
 	}
 
-	return get_next_freq(sg_policy, util, max);
+	return sugov_hispeed_freq(sg_policy, time, util, max,
+				  get_next_freq(sg_policy, util, max));
+}
+
+/*
+ * The policy is leaving idle if none of its CPUs has updated its
+ * utilization within the last tick.
+ */
+static bool sugov_policy_was_idle(struct sugov_policy *sg_policy, u64 time)
+{
+	unsigned int j;
+
+	for_each_cpu(j, sg_policy->policy->cpus) {
+		struct sugov_cpu *j_sg_cpu = &per_cpu(sugov_cpu, j);
+
+		if (time - j_sg_cpu->last_update <= TICK_NSEC)
+			return false;
+	}
+
+	return true;
 }
 
 static void sugov_update_shared(struct update_util_data *hook, u64 time,
@@ -404,6 +531,8 @@ static void sugov_update_shared(struct update_util_data *hook, u64 time,
 	sg_cpu->flags = flags;
 
 	sugov_set_iowait_boost(sg_cpu, time, flags);
+	if (sugov_policy_was_idle(sg_policy, time))
+		sugov_mark_idle_exit(sg_policy, time);
 	sg_cpu->last_update = time;
 
 	if (sugov_should_update_freq(sg_policy, time)) {
@@ -562,14 +691,83 @@ static ssize_t iowait_boost_enable_store(struct gov_attr_set *attr_set,
 	return count;
 }
 
+static ssize_t pred_load_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->pred_load);
+}
+
+static ssize_t pred_load_store(struct gov_attr_set *attr_set,
+			       const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	bool enable;
+
+	if (kstrtobool(buf, &enable))
+		return -EINVAL;
+
+	tunables->pred_load = enable;
+
+	return count;
+}
+
+static ssize_t hispeed_load_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->hispeed_load);
+}
+
+static ssize_t hispeed_load_store(struct gov_attr_set *attr_set,
+				  const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	unsigned int load;
+
+	if (kstrtouint(buf, 10, &load) || load > 100)
+		return -EINVAL;
+
+	tunables->hispeed_load = load;
+
+	return count;
+}
+
+static ssize_t hispeed_freq_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->hispeed_freq);
+}
+
+static ssize_t hispeed_freq_store(struct gov_attr_set *attr_set,
+				  const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	unsigned int freq;
+
+	if (kstrtouint(buf, 10, &freq))
+		return -EINVAL;
+
+	tunables->hispeed_freq = freq;
+
+	return count;
+}
+
 static struct governor_attr up_rate_limit_us = __ATTR_RW(up_rate_limit_us);
 static struct governor_attr down_rate_limit_us = __ATTR_RW(down_rate_limit_us);
 static struct governor_attr iowait_boost_enable = __ATTR_RW(iowait_boost_enable);
+static struct governor_attr pred_load = __ATTR_RW(pred_load);
+static struct governor_attr hispeed_load = __ATTR_RW(hispeed_load);
+static struct governor_attr hispeed_freq = __ATTR_RW(hispeed_freq);
 
 static struct attribute *sugov_attributes[] = {
 	&up_rate_limit_us.attr,
 	&down_rate_limit_us.attr,
 	&iowait_boost_enable.attr,
+	&pred_load.attr,
+	&hispeed_load.attr,
+	&hispeed_freq.attr,
 	NULL
 };
 
@@ -685,6 +883,9 @@ static void sugov_tunables_save(struct cpufreq_policy *policy,
 
 	cached->up_rate_limit_us = tunables->up_rate_limit_us;
 	cached->down_rate_limit_us = tunables->down_rate_limit_us;
+	cached->pred_load = tunables->pred_load;
+	cached->hispeed_load = tunables->hispeed_load;
+	cached->hispeed_freq = tunables->hispeed_freq;
 }
 
 static void sugov_tunables_free(struct sugov_tunables *tunables)
@@ -707,6 +908,9 @@ static void sugov_tunables_restore(struct cpufreq_policy *policy)
 
 	tunables->up_rate_limit_us = cached->up_rate_limit_us;
 	tunables->down_rate_limit_us = cached->down_rate_limit_us;
+	tunables->pred_load = cached->pred_load;
+	tunables->hispeed_load = cached->hispeed_load;
+	tunables->hispeed_freq = cached->hispeed_freq;
 	sg_policy->up_rate_delay_ns =
 		tunables->up_rate_limit_us * NSEC_PER_USEC;
 	sg_policy->down_rate_delay_ns =
@@ -772,6 +976,7 @@ static int sugov_init(struct cpufreq_policy *policy)
                 }
 	}
 	tunables->iowait_boost_enable = policy->iowait_boost_enable;
+	tunables->hispeed_load = DEFAULT_HISPEED_LOAD;
 
 	policy->governor_data = sg_policy;
 	sg_policy->tunables = tunables;
@@ -847,6 +1052,7 @@ static int sugov_start(struct cpufreq_policy *policy)
 	sg_policy->work_in_progress = false;
 	sg_policy->need_freq_update = false;
 	sg_policy->cached_raw_freq = 0;
+	sg_policy->hispeed_pending = false;
 
 	for_each_cpu(cpu, policy->cpus) {
 		struct sugov_cpu *sg_cpu = &per_cpu(sugov_cpu, cpu);
@@ -49,6 +49,28 @@ static void free_resources(void)
 	}
 }
 
+/*
+ * Precompute the capacity -> capacity state lookup used on every energy
+ * aware wakeup, so that find_new_capacity() only has to finish the search
+ * inside one bucket instead of walking all the capacity states.
+ */
+static void build_cap_idx_lut(struct sched_group_energy *sge)
+{
+	int bucket, idx = 0;
+
+	if (sge->nr_cap_states > U8_MAX + 1)
+		return;
+
+	for (bucket = 0; bucket < SGE_CAP_LUT_SIZE; bucket++) {
+		unsigned long util = bucket << SGE_CAP_LUT_SHIFT;
+
+		while (idx < sge->nr_cap_states - 1 &&
+		       sge->cap_states[idx].cap < util)
+			idx++;
+		sge->cap_idx_lut[bucket] = idx;
+	}
+}
+
 void init_sched_energy_costs(void)
 {
 	struct device_node *cn, *cp;
@@ -104,6 +126,7 @@ void init_sched_energy_costs(void)
 
 			sge->nr_cap_states = nstates;
 			sge->cap_states = cap_states;
+			build_cap_idx_lut(sge);
 
 			prop = of_find_property(cp, "idle-cost-data", NULL);
 			if (!prop || !prop->value) {
@@ -6723,6 +6723,8 @@ struct energy_env {
 	int			energy;
 	int			payoff;
 	struct task_struct	*task;
+	/* cpu_util_wake() of each CPU, taken once per wakeup, or NULL */
+	const unsigned long	*util_snap;
 	struct {
 		int before;
 		int after;
@@ -6738,6 +6740,37 @@ struct energy_env {
 
 static int cpu_util_wake(int cpu, struct task_struct *p);
 
+/*
+ * Wakeups on systems with up to this many CPUs snapshot the utilization of
+ * every CPU once, instead of calling cpu_util_wake() for each CPU of each
+ * group visited by the before/after energy walks of every candidate.
+ */
+#define EENV_SNAPSHOT_CPUS	16
+
+/*
+ * Utilization of a CPU as seen by the energy model: its utilization
+ * without the waking task, plus the task if the CPU is the target.
+ */
+static inline unsigned long eenv_cpu_util(struct energy_env *eenv, int cpu)
+{
+	unsigned long util;
+
+	if (eenv->util_snap && cpu < EENV_SNAPSHOT_CPUS)
+		util = eenv->util_snap[cpu];
+	else
+		util = cpu_util_wake(cpu, eenv->task);
+
+	/*
+	 * If we are looking at the target CPU specified by the eenv,
+	 * then we should add the (estimated) utilization of the task
+	 * assuming we will wake it up on that CPU.
+	 */
+	if (unlikely(cpu == eenv->trg_cpu))
+		util += eenv->util_delta;
+
+	return util;
+}
+
 /*
  * __cpu_norm_util() returns the cpu util relative to a specific capacity,
  * i.e. it's busy ratio, in the range [0..SCHED_LOAD_SCALE], which is useful for
@@ -6768,15 +6801,7 @@ static unsigned long group_max_util(struct energy_env *eenv)
 	int cpu;
 
 	for_each_cpu(cpu, sched_group_cpus(eenv->sg_cap)) {
-		util = cpu_util_wake(cpu, eenv->task);
-
-		/*
-		 * If we are looking at the target CPU specified by the eenv,
-		 * then we should add the (estimated) utilization of the task
-		 * assuming we will wake it up on that CPU.
-		 */
-		if (unlikely(cpu == eenv->trg_cpu))
-			util += eenv->util_delta;
+		util = eenv_cpu_util(eenv, cpu);
 
 		max_util = max(max_util, util);
 
@@ -6822,15 +6847,7 @@ long group_norm_util(struct energy_env *eenv, struct sched_group *sg)
 	int cpu;
 
 	for_each_cpu(cpu, sched_group_cpus(sg)) {
-		util = cpu_util_wake(cpu, eenv->task);
-
-		/*
-		 * If we are looking at the target CPU specified by the eenv,
-		 * then we should add the (estimated) utilization of the task
-		 * assuming we will wake it up on that CPU.
-		 */
-		if (unlikely(cpu == eenv->trg_cpu))
-			util += eenv->util_delta;
+		util = eenv_cpu_util(eenv, cpu);
 
 		util_sum += __cpu_norm_util(util, capacity);
 	}
@@ -6844,16 +6861,21 @@ static int find_new_capacity(struct energy_env *eenv,
 	int idx, max_idx = sge->nr_cap_states - 1;
 	unsigned long util = group_max_util(eenv);
 
-	/* default is max_cap if we don't find a match */
-	eenv->cap_idx = max_idx;
-
-	for (idx = 0; idx < sge->nr_cap_states; idx++) {
-		if (sge->cap_states[idx].cap >= util) {
-			eenv->cap_idx = idx;
-			break;
-		}
-	}
+	/*
+	 * Start from the precomputed state for util's bucket and finish the
+	 * search from there. Walking back as well keeps the result exact if
+	 * cap_states was changed through the sched_domain sysctls. Default
+	 * is max_cap if we don't find a match.
+	 */
+	idx = sge->cap_idx_lut[min_t(unsigned long, util, SCHED_CAPACITY_SCALE)
+			       >> SGE_CAP_LUT_SHIFT];
+	idx = min(idx, max_idx);
+	while (idx < max_idx && sge->cap_states[idx].cap < util)
+		idx++;
+	while (idx > 0 && sge->cap_states[idx - 1].cap >= util)
+		idx--;
 
+	eenv->cap_idx = idx;
 	return eenv->cap_idx;
 }
 
@@ -6883,11 +6905,8 @@ static int group_idle_state(struct energy_env *eenv, struct sched_group *sg)
 	 * Try to estimate if a deeper idle state is
 	 * achievable when we move the task.
 	 */
-	for_each_cpu(i, sched_group_cpus(sg)) {
-		grp_util += cpu_util_wake(i, eenv->task);
-		if (unlikely(i == eenv->trg_cpu))
-			grp_util += eenv->util_delta;
-	}
+	for_each_cpu(i, sched_group_cpus(sg))
+		grp_util += eenv_cpu_util(eenv, i);
 
 	if (grp_util <=
 		((long)sg->sgc->max_capacity * (int)sg->group_weight)) {
@@ -7081,6 +7100,7 @@ static inline int __energy_diff(struct energy_env *eenv)
 		.nrg		= { 0, 0, 0, 0},
 		.cap		= { 0, 0, 0 },
 		.task		= eenv->task,
+		.util_snap	= eenv->util_snap,
 	};
 
 	if (eenv->src_cpu == eenv->dst_cpu)
@@ -7702,6 +7722,31 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 			!(p->flags & PF_WAKE_UP_IDLE))
 		return target;
 
+	/*
+	 * The idle masks of the cluster already know the shallowest idle
+	 * CPU, so only fall back to the scan below if they have none that
+	 * fits.
+	 */
+	if (sysctl_sched_cstate_aware) {
+		unsigned long new_usage = boosted_task_util(p);
+		int i, depth;
+
+		if (cpumask_test_cpu(target, tsk_cpus_allowed(p)) &&
+		    idle_cpu(target) && new_usage <= capacity_curr_of(target)) {
+			schedstat_inc(p, se.statistics.nr_wakeups_sis_suff_cap);
+			schedstat_inc(this_rq(), eas_stats.sis_suff_cap);
+			goto done;
+		}
+
+		i = sched_cluster_idle_cpu(target, tsk_cpus_allowed(p), &depth);
+		if (i >= 0 && idle_cpu(i) && new_usage <= capacity_orig_of(i)) {
+			schedstat_inc(p, se.statistics.nr_wakeups_sis_idle_cpu);
+			schedstat_inc(this_rq(), eas_stats.sis_idle_cpu);
+			target = i;
+			goto done;
+		}
+	}
+
 	/*
 	 * Otherwise, iterate the domains and find an elegible idle cpu.
 	 */
@@ -7803,10 +7848,61 @@ static int start_cpu(bool boosted)
 	return boosted ? rd->max_cap_orig_cpu : rd->min_cap_orig_cpu;
 }
 
+/*
+ * Fast path of find_best_target() for latency sensitive tasks: pick the
+ * shallowest idle CPU of each cluster from the cluster idle masks and keep
+ * the one with the biggest (boosted) or smallest capacity, as case A.1
+ * below would, without scanning every CPU. Returns -1 if no cluster has an
+ * advertised idle CPU the task fits on.
+ */
+static int fbt_cluster_idle_cpu(struct task_struct *p, struct sched_domain *sd,
+				bool boosted, unsigned long min_util,
+				unsigned long task_util)
+{
+	unsigned long target_capacity = boosted ? 0 : ULONG_MAX;
+	int best_depth = INT_MAX;
+	int best_cpu = -1;
+	struct sched_group *sg = sd->groups;
+	struct cpumask cpus;
+
+	do {
+		unsigned long capacity_orig, new_util;
+		int i, depth;
+
+		cpumask_and(&cpus, sched_group_cpus(sg), tsk_cpus_allowed(p));
+		cpumask_and(&cpus, &cpus, cpu_online_mask);
+
+		i = sched_cluster_idle_cpu(group_first_cpu(sg), &cpus, &depth);
+		if (i < 0 || !idle_cpu(i) || walt_cpu_high_irqload(i))
+			continue;
+
+		capacity_orig = capacity_orig_of(i);
+		new_util = max(min_util, cpu_util_wake(i, p) + task_util);
+		if (new_util > capacity_orig)
+			continue;
+
+		if (capacity_orig == target_capacity && depth >= best_depth)
+			continue;
+		if (capacity_orig != target_capacity &&
+		    (boosted ? capacity_orig < target_capacity :
+			       capacity_orig > target_capacity))
+			continue;
+
+		target_capacity = capacity_orig;
+		best_depth = depth;
+		best_cpu = i;
+	} while (sg = sg->next, sg != sd->groups);
+
+	return best_cpu;
+}
+
 static inline int find_best_target(struct task_struct *p, int *backup_cpu,
 				   bool boosted, bool prefer_idle)
 {
-	unsigned long min_util = boosted_task_util(p);
+	unsigned long min_util = schedtune_task_util_clamp(p,
+						boosted_task_util(p));
+	unsigned long task_util_clamped = schedtune_task_util_clamp(p,
+						task_util_pred(p));
 	unsigned long target_capacity = ULONG_MAX;
 	unsigned long min_wake_util = ULONG_MAX;
 	unsigned long target_max_spare_cap = 0;
@@ -7853,6 +7949,20 @@ static inline int find_best_target(struct task_struct *p, int *backup_cpu,
 		return -1;
 	}
 
+	if (prefer_idle) {
+		best_idle_cpu = fbt_cluster_idle_cpu(p, sd, boosted, min_util,
+						     task_util_clamped);
+		if (best_idle_cpu >= 0) {
+			schedstat_inc(p, se.statistics.nr_wakeups_fbt_pref_idle);
+			schedstat_inc(this_rq(), eas_stats.fbt_pref_idle);
+			trace_sched_find_best_target(p, prefer_idle, min_util,
+						     cpu, best_idle_cpu,
+						     best_active_cpu,
+						     best_idle_cpu);
+			return best_idle_cpu;
+		}
+	}
+
 	/* Scan CPUs in all SDs */
 	sg = sd->groups;
 	do {
@@ -7873,7 +7983,7 @@ static inline int find_best_target(struct task_struct *p, int *backup_cpu,
 			 * accounting. However, the blocked utilization may be zero.
 			 */
 			wake_util = cpu_util_wake(i, p);
-			new_util = wake_util + task_util(p);
+			new_util = wake_util + task_util_clamped;
 
 			/*
 			 * Ensure minimum capacity to grant the required boost.
@@ -8182,6 +8292,8 @@ cpu_is_in_target_set(struct task_struct *p, int cpu)
 
 static int select_energy_cpu_brute(struct task_struct *p, int prev_cpu, int sync)
 {
+	unsigned long util_snap[EENV_SNAPSHOT_CPUS];
+	cycles_t start = get_cycles();
 	bool boosted, prefer_idle;
 	struct sched_domain *sd;
 	int target_cpu;
@@ -8259,6 +8371,19 @@ static int select_energy_cpu_brute(struct task_struct *p, int prev_cpu, int sync
 			goto unlock;
 		}
 
+		/*
+		 * Both energy_diff() calls below only move the task between
+		 * CPUs, so the utilization of every CPU without the task can
+		 * be read once and shared by all their group walks.
+		 */
+		if (nr_cpu_ids <= EENV_SNAPSHOT_CPUS) {
+			int i;
+
+			for_each_possible_cpu(i)
+				util_snap[i] = cpu_util_wake(i, p);
+			eenv.util_snap = util_snap;
+		}
+
 		target_cpu = next_cpu;
 		if (energy_diff(&eenv) >= 0) {
 			/* No energy saving for target_cpu, try backup */
@@ -8285,6 +8410,7 @@ static int select_energy_cpu_brute(struct task_struct *p, int prev_cpu, int sync
 
 unlock:
 	rcu_read_unlock();
+	schedstat_add(this_rq(), eas_stats.secb_cycles, get_cycles() - start);
 
 	return target_cpu;
 }
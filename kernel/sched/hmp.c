@@ -2240,6 +2240,22 @@ static void rollover_task_window(struct task_struct *p, bool full_window)
 	}
 }
 
+ATOMIC_NOTIFIER_HEAD(sched_window_notifier_head);
+EXPORT_SYMBOL_GPL(sched_window_notifier_head);
+
+static void notify_window_rollover(struct rq *rq)
+{
+	struct sched_window_stats stats;
+
+	stats.cpu = cpu_of(rq);
+	stats.window_start = rq->window_start;
+	stats.window_size = sched_ravg_window;
+	stats.prev_busy = rq->prev_runnable_sum +
+			  rq->grp_time.prev_runnable_sum;
+
+	atomic_notifier_call_chain(&sched_window_notifier_head, 0, &stats);
+}
+
 static void rollover_cpu_window(struct rq *rq, bool full_window)
 {
 	u64 curr_sum = rq->curr_runnable_sum;
@@ -2307,6 +2323,7 @@ static void update_cpu_busy_time(struct task_struct *p, struct rq *rq,
 	if (p_is_curr_task && new_window) {
 		rollover_cpu_window(rq, full_window);
 		rollover_top_tasks(rq, full_window);
+		notify_window_rollover(rq);
 	}
 
 	if (!account_busy_for_cpu_time(rq, p, irqtime, event))
@@ -15,6 +15,72 @@
 
 #include "sched.h"
 
+#ifdef CONFIG_SMP
+DEFINE_PER_CPU(struct sched_idle_masks, sched_idle_masks);
+
+/*
+ * Move the current CPU to @depth in the idle masks of its cluster, or out
+ * of them for a negative @depth. The new bit is set before the old one is
+ * cleared so that readers never see an idle CPU vanish. The masks used are
+ * remembered, so a cluster leader change across hotplug leaves no stale
+ * bits behind.
+ */
+static void sched_idle_set_depth(int depth)
+{
+	struct rq *rq = this_rq();
+	int cpu = cpu_of(rq);
+	int old_depth = rq->idle_depth;
+	int old_llc = rq->idle_depth_llc;
+
+	if (depth == old_depth)
+		return;
+
+	if (depth >= 0) {
+		int llc = per_cpu(sd_llc_id, cpu);
+
+		cpumask_set_cpu(cpu, &per_cpu(sched_idle_masks, llc).depth[depth]);
+		rq->idle_depth_llc = llc;
+	}
+
+	if (old_depth >= 0)
+		cpumask_clear_cpu(cpu,
+			&per_cpu(sched_idle_masks, old_llc).depth[old_depth]);
+
+	rq->idle_depth = depth;
+}
+
+/**
+ * sched_cluster_idle_cpu - Find the shallowest idle CPU of a cluster.
+ * @cpu: Any CPU of the cluster.
+ * @cpus: CPUs to consider.
+ * @depth: Set to the idle depth of the returned CPU.
+ *
+ * Only reads the idle masks of the cluster, so the result is a hint: the
+ * caller still has to check idle_cpu() before relying on it.
+ *
+ * Returns a CPU of @cpus or -1 if none of them is advertised idle.
+ */
+int sched_cluster_idle_cpu(int cpu, const struct cpumask *cpus, int *depth)
+{
+	struct sched_idle_masks *masks;
+	int d, i;
+
+	masks = &per_cpu(sched_idle_masks, per_cpu(sd_llc_id, cpu));
+
+	for (d = 0; d < SCHED_IDLE_DEPTHS; d++) {
+		i = cpumask_first_and(&masks->depth[d], cpus);
+		if (i < nr_cpu_ids) {
+			*depth = d;
+			return i;
+		}
+	}
+
+	return -1;
+}
+#else
+static inline void sched_idle_set_depth(int depth) { }
+#endif
+
 /**
  * sched_idle_set_state - Record idle state for the current CPU.
  * @idle_state: State to record.
@@ -23,6 +89,13 @@ void sched_idle_set_state(struct cpuidle_state *idle_state, int index)
 {
 	idle_set_state(this_rq(), idle_state);
 	idle_set_state_idx(this_rq(), index);
+
+#ifdef CONFIG_SMP
+	/* Only advertise CPUs which are in the idle loop */
+	if (this_rq()->idle_depth >= 0)
+		sched_idle_set_depth(index < 0 ? 0 :
+				     min(index + 1, SCHED_IDLE_DEPTHS - 1));
+#endif
 }
 
 static int __read_mostly cpu_idle_force_poll;
@@ -226,12 +299,14 @@ static void cpu_idle_loop(void)
 
 		__current_set_polling();
 		tick_nohz_idle_enter();
+		sched_idle_set_depth(0);
 
 		while (!need_resched()) {
 			check_pgt_cache();
 			rmb();
 
 			if (cpu_is_offline(cpu)) {
+				sched_idle_set_depth(-1);
 				rcu_cpu_notify(NULL, CPU_DYING_IDLE,
 					       (void *)(long)cpu);
 				smp_mb(); /* all activity before dead. */
@@ -268,6 +343,7 @@ static void cpu_idle_loop(void)
 		 * not have had an IPI to fold the state for us.
 		 */
 		preempt_set_need_resched();
+		sched_idle_set_depth(-1);
 		tick_nohz_idle_exit();
 		__current_clr_polling();
 
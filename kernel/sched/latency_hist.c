@@ -0,0 +1,131 @@
+/*
+ * Scheduler wakeup latency histograms
+ *
+ * For every task wakeup, the time from the wakeup to the task being picked
+ * to run is accounted in a per-CPU log2 histogram, split by the schedtune
+ * group of the task. /proc/sched_latency_hist reports them summed per
+ * cluster; writing to it resets all histograms.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/topology.h>
+
+#include "sched.h"
+#include "tune.h"
+
+DEFINE_PER_CPU(struct sched_lat_hist, sched_lat_hist);
+
+/* Called with rq->lock held when @p, woken up earlier, is picked to run */
+void sched_lat_hist_record(struct rq *rq, struct task_struct *p)
+{
+	struct sched_lat_hist *h = this_cpu_ptr(&sched_lat_hist);
+	s64 delta = rq_clock(rq) - p->sched_wakeup_ts;
+	int grp = schedtune_task_group_idx(p);
+	int idx = 0;
+
+	p->sched_wakeup_ts = 0;
+
+	if (delta >= NSEC_PER_USEC)
+		idx = min_t(int, fls64(div_u64(delta, NSEC_PER_USEC)),
+			    SCHED_LAT_HIST_BUCKETS - 1);
+	if (grp >= SCHED_LAT_HIST_GROUPS)
+		grp = SCHED_LAT_HIST_GROUPS - 1;
+
+	h->bucket[grp][idx]++;
+}
+
+static void sched_lat_hist_show_cluster(struct seq_file *m,
+					const struct cpumask *cpus)
+{
+	u64 sum[SCHED_LAT_HIST_BUCKETS];
+	int cpu, grp, i;
+
+	seq_printf(m, "cluster %d cpus %*pbl\n",
+		   topology_physical_package_id(cpumask_first(cpus)),
+		   cpumask_pr_args(cpus));
+
+	for (grp = 0; grp < SCHED_LAT_HIST_GROUPS; grp++) {
+		u64 total = 0;
+
+		memset(sum, 0, sizeof(sum));
+		for_each_cpu(cpu, cpus) {
+			struct sched_lat_hist *h = &per_cpu(sched_lat_hist, cpu);
+
+			for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+				sum[i] += READ_ONCE(h->bucket[grp][i]);
+		}
+		for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+			total += sum[i];
+		if (!total)
+			continue;
+
+		seq_printf(m, "  group %d:", grp);
+		for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+			seq_printf(m, " %llu", sum[i]);
+		seq_putc(m, '\n');
+	}
+}
+
+static int sched_lat_hist_show(struct seq_file *m, void *v)
+{
+	cpumask_var_t done;
+	int cpu, i;
+
+	if (!zalloc_cpumask_var(&done, GFP_KERNEL))
+		return -ENOMEM;
+
+	/* Bucket i counts latencies in [2^(i-1), 2^i) us, bucket 0 is < 1us */
+	seq_puts(m, "buckets(us): <1");
+	for (i = 1; i < SCHED_LAT_HIST_BUCKETS - 1; i++)
+		seq_printf(m, " <%lu", 1UL << i);
+	seq_printf(m, " >=%lu\n", 1UL << (SCHED_LAT_HIST_BUCKETS - 2));
+
+	for_each_possible_cpu(cpu) {
+		const struct cpumask *cluster = topology_core_cpumask(cpu);
+
+		if (cpumask_test_cpu(cpu, done))
+			continue;
+		cpumask_or(done, done, cluster);
+		sched_lat_hist_show_cluster(m, cluster);
+	}
+
+	free_cpumask_var(done);
+	return 0;
+}
+
+static int sched_lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sched_lat_hist_show, NULL);
+}
+
+static ssize_t sched_lat_hist_write(struct file *file, const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(sched_lat_hist, cpu), 0,
+		       sizeof(struct sched_lat_hist));
+
+	return count;
+}
+
+static const struct file_operations sched_lat_hist_fops = {
+	.open		= sched_lat_hist_open,
+	.read		= seq_read,
+	.write		= sched_lat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init sched_lat_hist_init(void)
+{
+	proc_create("sched_latency_hist", 0644, NULL, &sched_lat_hist_fops);
+	return 0;
+}
+subsys_initcall(sched_lat_hist_init);
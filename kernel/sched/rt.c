@@ -16,6 +16,13 @@
 int sched_rr_timeslice = RR_TIMESLICE;
 int sysctl_sched_rr_timeslice = (MSEC_PER_SEC / HZ) * RR_TIMESLICE;
 
+/*
+ * When set, RT tasks are placed on the lowest capacity CPUs that fit their
+ * demand, preferring CPUs in the shallowest idle state, instead of on any
+ * of the lowest priority CPUs.
+ */
+unsigned int sysctl_sched_rt_capacity_aware;
+
 static int do_sched_rt_period_timer(struct rt_bandwidth *rt_b, int overrun);
 
 struct rt_bandwidth def_rt_bandwidth;
@@ -1551,6 +1558,90 @@ static void yield_task_rt(struct rq *rq)
 #ifdef CONFIG_SMP
 static int find_lowest_rq(struct task_struct *task);
 
+/* Window based demand of an RT task, in capacity units */
+static inline unsigned long rt_task_demand(struct task_struct *p)
+{
+#ifdef CONFIG_SCHED_HMP
+	return div64_u64((u64)p->ravg.demand << SCHED_CAPACITY_SHIFT,
+			 sched_ravg_window);
+#else
+	return task_util(p);
+#endif
+}
+
+/*
+ * Pick among the lowest priority CPUs in @lowest_mask, in order of
+ * preference:
+ * - a CPU the task fits on over one it does not,
+ * - the smallest capacity among fitting CPUs, the biggest otherwise,
+ * - an idle CPU in the shallowest idle state over deeper or busy ones,
+ * - the least utilized CPU, then the CPU the task last ran on.
+ */
+static int find_lowest_rq_capacity(struct task_struct *task,
+				   struct cpumask *lowest_mask)
+{
+	unsigned long demand = rt_task_demand(task);
+	unsigned long best_cap = 0, best_util = ULONG_MAX;
+	int best_idle_idx = INT_MAX;
+	int prev_cpu = task_cpu(task);
+	bool best_fits = false;
+	int best_cpu = -1;
+	int i;
+
+	rcu_read_lock();
+	for_each_cpu(i, lowest_mask) {
+		unsigned long cap = capacity_orig_of(i);
+		unsigned long util = cpu_util(i);
+		bool fits = demand * capacity_margin <= cap * 1024;
+		int idle_idx = INT_MAX;
+
+		if (cpu_isolated(i))
+			continue;
+
+		if (idle_cpu(i))
+			idle_idx = idle_get_state_idx(cpu_rq(i));
+
+		if (best_cpu != -1) {
+			if (fits != best_fits) {
+				if (!fits)
+					continue;
+				goto select;
+			}
+			if (cap != best_cap) {
+				if (fits ? cap > best_cap : cap < best_cap)
+					continue;
+				goto select;
+			}
+			if (idle_idx != best_idle_idx) {
+				if (idle_idx > best_idle_idx)
+					continue;
+				goto select;
+			}
+			if (util != best_util) {
+				if (util > best_util)
+					continue;
+				goto select;
+			}
+			if (i != prev_cpu)
+				continue;
+		}
+select:
+		best_cpu = i;
+		best_fits = fits;
+		best_cap = cap;
+		best_idle_idx = idle_idx;
+		best_util = util;
+	}
+	rcu_read_unlock();
+
+	if (best_cpu != -1)
+		trace_sched_rt_capacity_placement(task, demand, prev_cpu,
+						  best_cpu, best_cap,
+						  best_idle_idx, best_fits);
+
+	return best_cpu;
+}
+
 #ifdef CONFIG_SCHED_HMP
 static int
 select_task_rq_rt_hmp(struct task_struct *p, int cpu, int sd_flag, int flags)
@@ -1918,6 +2009,9 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return best_cpu; /* No targets found */
 
+	if (sysctl_sched_rt_capacity_aware && !boost_on_big)
+		return find_lowest_rq_capacity(task, lowest_mask);
+
 	pack_task = is_short_burst_task(task);
 
 	/*
@@ -2012,6 +2106,9 @@ static int find_lowest_rq(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return -1; /* No targets found */
 
+	if (sysctl_sched_rt_capacity_aware)
+		return find_lowest_rq_capacity(task, lowest_mask);
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
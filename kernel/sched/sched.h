@@ -828,6 +828,7 @@ struct rq {
 
 #ifdef CONFIG_SCHED_WALT
 	u64 cumulative_runnable_avg;
+	u64 cumulative_pred_demand;
 	u64 window_start;
 	u64 curr_runnable_sum;
 	u64 prev_runnable_sum;
@@ -884,6 +885,13 @@ struct rq {
 
 #ifdef CONFIG_SMP
 	struct llist_head wake_list;
+
+	/*
+	 * Depth this CPU is advertised at in the idle masks of its cluster
+	 * (-1 when not idle), and which cluster's masks those are.
+	 */
+	int idle_depth;
+	int idle_depth_llc;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -939,6 +947,17 @@ static inline void rq_clock_skip_update(struct rq *rq, bool skip)
 		rq->clock_skip_update &= ~RQCF_REQ_SKIP;
 }
 
+/* Wakeup to run latency histograms, see latency_hist.c */
+#define SCHED_LAT_HIST_BUCKETS	24
+#define SCHED_LAT_HIST_GROUPS	8
+
+struct sched_lat_hist {
+	u32 bucket[SCHED_LAT_HIST_GROUPS][SCHED_LAT_HIST_BUCKETS];
+};
+
+DECLARE_PER_CPU(struct sched_lat_hist, sched_lat_hist);
+extern void sched_lat_hist_record(struct rq *rq, struct task_struct *p);
+
 #ifdef CONFIG_NUMA
 enum numa_topology_type {
 	NUMA_DIRECT,
@@ -1042,6 +1061,23 @@ DECLARE_PER_CPU(struct sched_domain *, sd_asym);
 DECLARE_PER_CPU(struct sched_domain *, sd_ea);
 DECLARE_PER_CPU(struct sched_domain *, sd_scs);
 
+/*
+ * Per cluster (LLC) masks of idle CPUs by idle depth, kept in the per-cpu
+ * area of the first CPU of the cluster and maintained by each CPU from its
+ * idle loop. Depth 0 is idle but in no cpuidle state, depth d is cpuidle
+ * state d - 1; deeper states share the last mask.
+ */
+#define SCHED_IDLE_DEPTHS	4
+
+struct sched_idle_masks {
+	struct cpumask depth[SCHED_IDLE_DEPTHS];
+};
+
+DECLARE_PER_CPU(struct sched_idle_masks, sched_idle_masks);
+
+extern int sched_cluster_idle_cpu(int cpu, const struct cpumask *cpus,
+				  int *depth);
+
 struct sched_group_capacity {
 	atomic_t ref;
 	/*
@@ -2423,9 +2459,12 @@ static inline unsigned long capacity_orig_of(int cpu)
 	return cpu_rq(cpu)->cpu_capacity_orig;
 }
 
+extern unsigned int capacity_margin;
+
 extern unsigned int sysctl_sched_use_walt_cpu_util;
 extern unsigned int walt_ravg_window;
 extern bool walt_disabled;
+extern bool walt_pred_demand;
 
 
 static inline unsigned long task_util(struct task_struct *p)
@@ -2439,6 +2478,24 @@ static inline unsigned long task_util(struct task_struct *p)
 	return READ_ONCE(p->se.avg.util_avg);
 }
 
+/*
+ * Like task_util(), but with WALT the predicted busy time of the current
+ * window is taken into account, so that a task entering a periodic burst
+ * is placed as if the burst had already happened.
+ */
+static inline unsigned long task_util_pred(struct task_struct *p)
+{
+#ifdef CONFIG_SCHED_WALT
+	if (!walt_disabled && sysctl_sched_use_walt_task_util &&
+	    walt_pred_demand) {
+		unsigned long demand = max(p->ravg.demand,
+					   p->ravg.pred_demand);
+		return (demand << 10) / walt_ravg_window;
+	}
+#endif
+	return task_util(p);
+}
+
 /*
  * cpu_util returns the amount of capacity of a CPU that is used by CFS
  * tasks. The unit of the return value must be the one of capacity so we can
@@ -2500,13 +2557,49 @@ static inline unsigned long cpu_util_freq(int cpu)
 	}
 
 #ifdef CONFIG_SCHED_WALT
-	if (!walt_disabled && sysctl_sched_use_walt_cpu_util)
-		util = div64_u64(cpu_rq(cpu)->prev_runnable_sum,
-				 walt_ravg_window >> SCHED_LOAD_SHIFT);
+	if (!walt_disabled && sysctl_sched_use_walt_cpu_util) {
+		struct rq *rq = cpu_rq(cpu);
+		u64 busy = rq->prev_runnable_sum;
+
+		/* Runnable tasks predicted to need more than last window */
+		if (walt_pred_demand)
+			busy = max(busy, rq->cumulative_pred_demand);
+		util = div64_u64(busy, walt_ravg_window >> SCHED_LOAD_SHIFT);
+	}
 #endif
 	return (util >= capacity) ? capacity : util;
 }
 
+/*
+ * Window based frequency demand of a CPU: the larger of the busy time seen
+ * in the last complete window, the busy time accumulated so far in the
+ * current one and the predicted demand of the tasks runnable on it. Falls
+ * back to cpu_util_freq() when no window statistics are maintained.
+ */
+static inline unsigned long cpu_util_freq_pred(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long capacity = capacity_orig_of(cpu);
+	unsigned long util;
+	u64 busy, window;
+
+#if defined(CONFIG_SCHED_WALT)
+	if (walt_disabled)
+		return cpu_util_freq(cpu);
+	busy = max(rq->prev_runnable_sum, rq->cumulative_pred_demand);
+	window = walt_ravg_window;
+#elif defined(CONFIG_SCHED_HMP)
+	busy = max(rq->prev_runnable_sum, rq->hmp_stats.pred_demands_sum);
+	window = sched_ravg_window;
+#else
+	return cpu_util_freq(cpu);
+#endif
+	busy = max(busy, READ_ONCE(rq->curr_runnable_sum));
+	util = div64_u64(busy, window >> SCHED_LOAD_SHIFT);
+
+	return (util >= capacity) ? capacity : util;
+}
+
 #endif
 
 #ifdef CONFIG_SCHED_HMP
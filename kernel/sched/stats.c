@@ -10,7 +10,7 @@
  * bump this up when changing the output format or the meaning of an existing
  * format, so that tools can adapt (or abort)
  */
-#define SCHEDSTAT_VERSION 15
+#define SCHEDSTAT_VERSION 16
 
 #ifdef CONFIG_SMP
 static inline void show_easstat(struct seq_file *seq, struct eas_stats *stats)
@@ -20,10 +20,10 @@ static inline void show_easstat(struct seq_file *seq, struct eas_stats *stats)
 	    stats->sis_attempts, stats->sis_idle, stats->sis_cache_affine,
 	    stats->sis_suff_cap, stats->sis_idle_cpu, stats->sis_count);
 
-	seq_printf(seq, "%llu %llu %llu %llu %llu %llu %llu ",
+	seq_printf(seq, "%llu %llu %llu %llu %llu %llu %llu %llu ",
 	    stats->secb_attempts, stats->secb_sync, stats->secb_idle_bt,
 	    stats->secb_insuff_cap, stats->secb_no_nrg_sav,
-	    stats->secb_nrg_sav, stats->secb_count);
+	    stats->secb_nrg_sav, stats->secb_count, stats->secb_cycles);
 
 	seq_printf(seq, "%llu %llu %llu %llu %llu ",
 	    stats->fbt_attempts, stats->fbt_no_cpu, stats->fbt_no_sd,
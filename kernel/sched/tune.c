@@ -157,6 +157,13 @@ struct schedtune {
 	/* Hint to bias scheduling of tasks on that SchedTune CGroup
 	 * towards idle CPUs */
 	int prefer_idle;
+
+	/*
+	 * Utilization floor and ceiling, in percent of SCHED_CAPACITY_SCALE,
+	 * for tasks on that SchedTune CGroup
+	 */
+	int util_min;
+	int util_max;
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -196,6 +203,8 @@ root_schedtune = {
 	.perf_boost_idx = 0,
 	.perf_constrain_idx = 0,
 	.prefer_idle = 0,
+	.util_min = 0,
+	.util_max = 100,
 };
 
 int
@@ -260,9 +269,18 @@ struct boost_groups {
 	/* Maximum boost value for all RUNNABLE tasks on a CPU */
 	bool idle;
 	int boost_max;
+	/*
+	 * Utilization clamps for the CPU: the maximum of the floors and of
+	 * the ceilings of the boost groups which have RUNNABLE tasks on it
+	 */
+	unsigned long util_min;
+	unsigned long util_max;
 	struct {
 		/* The boost for tasks on that boost group */
 		int boost;
+		/* The utilization clamps, in capacity units */
+		unsigned long util_min;
+		unsigned long util_max;
 		/* Count of RUNNABLE tasks on that boost group */
 		unsigned tasks;
 	} group[BOOSTGROUPS_COUNT];
@@ -388,6 +406,34 @@ static inline void init_sched_boost(struct schedtune *st) { }
 
 #endif /* CONFIG_SCHED_HMP */
 
+static void
+schedtune_cpu_update_clamps(struct boost_groups *bg)
+{
+	unsigned long util_min = 0, util_max = 0;
+	bool active = false;
+	int idx;
+
+	/*
+	 * Unlike boost, clamps only come from groups with RUNNABLE tasks
+	 * here, the root group included: a CPU running only capped tasks
+	 * must not be held at full capacity by an empty root group.
+	 */
+	for (idx = 0; idx < BOOSTGROUPS_COUNT; ++idx) {
+		if (bg->group[idx].tasks == 0)
+			continue;
+
+		util_min = max(util_min, bg->group[idx].util_min);
+		util_max = max(util_max, bg->group[idx].util_max);
+		active = true;
+	}
+
+	if (!active)
+		util_max = SCHED_CAPACITY_SCALE;
+
+	WRITE_ONCE(bg->util_min, util_min);
+	WRITE_ONCE(bg->util_max, util_max);
+}
+
 static void
 schedtune_cpu_update(int cpu)
 {
@@ -414,6 +460,8 @@ schedtune_cpu_update(int cpu)
 	 * task stacking and frequency spikes.*/
 	boost_max = max(boost_max, 0);
 	bg->boost_max = boost_max;
+
+	schedtune_cpu_update_clamps(bg);
 }
 
 static int
@@ -459,6 +507,24 @@ schedtune_boostgroup_update(int idx, int boost)
 	return 0;
 }
 
+static void
+schedtune_clampgroup_update(int idx, int util_min, int util_max)
+{
+	struct boost_groups *bg;
+	unsigned long irq_flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		bg = &per_cpu(cpu_boost_groups, cpu);
+
+		raw_spin_lock_irqsave(&bg->lock, irq_flags);
+		bg->group[idx].util_min = util_min * SCHED_CAPACITY_SCALE / 100;
+		bg->group[idx].util_max = util_max * SCHED_CAPACITY_SCALE / 100;
+		schedtune_cpu_update_clamps(bg);
+		raw_spin_unlock_irqrestore(&bg->lock, irq_flags);
+	}
+}
+
 #define ENQUEUE_TASK  1
 #define DEQUEUE_TASK -1
 
@@ -695,6 +761,55 @@ int schedtune_task_boost(struct task_struct *p)
 	return task_boost;
 }
 
+int schedtune_task_group_idx(struct task_struct *p)
+{
+	int idx;
+
+	if (!unlikely(schedtune_initialized))
+		return 0;
+
+	rcu_read_lock();
+	idx = task_schedtune(p)->idx;
+	rcu_read_unlock();
+
+	return idx;
+}
+
+/*
+ * Clamp a CPU utilization, e.g. for frequency selection, to the floor and
+ * ceiling of the groups with RUNNABLE tasks on that CPU.
+ */
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+
+	if (!unlikely(schedtune_initialized))
+		return util;
+
+	util = max(util, READ_ONCE(bg->util_min));
+	return min(util, READ_ONCE(bg->util_max));
+}
+
+/* Clamp a task utilization to the floor and ceiling of its group */
+unsigned long schedtune_task_util_clamp(struct task_struct *p,
+					unsigned long util)
+{
+	struct schedtune *st;
+	int util_min, util_max;
+
+	if (!unlikely(schedtune_initialized))
+		return util;
+
+	rcu_read_lock();
+	st = task_schedtune(p);
+	util_min = st->util_min;
+	util_max = st->util_max;
+	rcu_read_unlock();
+
+	util = max(util, (unsigned long)util_min * SCHED_CAPACITY_SCALE / 100);
+	return min(util, (unsigned long)util_max * SCHED_CAPACITY_SCALE / 100);
+}
+
 int schedtune_prefer_idle(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -712,6 +827,17 @@ int schedtune_prefer_idle(struct task_struct *p)
 	return prefer_idle;
 }
 
+/*
+ * Whether @p runs in a boosted or prefer_idle group, i.e. it is part of
+ * what the user is currently interacting with (top-app on Android).
+ * Meant for drivers which want to favour latency for such tasks.
+ */
+bool schedtune_task_boosted(struct task_struct *p)
+{
+	return schedtune_task_boost(p) > 0 || schedtune_prefer_idle(p);
+}
+EXPORT_SYMBOL_GPL(schedtune_task_boosted);
+
 static u64
 prefer_idle_read(struct cgroup_subsys_state *css, struct cftype *cft)
 {
@@ -730,6 +856,68 @@ prefer_idle_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+static DEFINE_MUTEX(util_clamp_mutex);
+
+static u64
+util_min_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_min;
+}
+
+static int
+util_min_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_min)
+{
+	struct schedtune *st = css_st(css);
+	int ret = 0;
+
+	if (util_min > 100)
+		return -EINVAL;
+
+	mutex_lock(&util_clamp_mutex);
+	if (util_min > st->util_max) {
+		ret = -EINVAL;
+		goto out;
+	}
+	st->util_min = util_min;
+	schedtune_clampgroup_update(st->idx, st->util_min, st->util_max);
+out:
+	mutex_unlock(&util_clamp_mutex);
+	return ret;
+}
+
+static u64
+util_max_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_max;
+}
+
+static int
+util_max_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_max)
+{
+	struct schedtune *st = css_st(css);
+	int ret = 0;
+
+	if (util_max > 100)
+		return -EINVAL;
+
+	mutex_lock(&util_clamp_mutex);
+	if (util_max < st->util_min) {
+		ret = -EINVAL;
+		goto out;
+	}
+	st->util_max = util_max;
+	schedtune_clampgroup_update(st->idx, st->util_min, st->util_max);
+out:
+	mutex_unlock(&util_clamp_mutex);
+	return ret;
+}
+
 static s64
 boost_read(struct cgroup_subsys_state *css, struct cftype *cft)
 {
@@ -802,6 +990,16 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "util.min",
+		.read_u64 = util_min_read,
+		.write_u64 = util_min_write,
+	},
+	{
+		.name = "util.max",
+		.read_u64 = util_max_read,
+		.write_u64 = util_max_write,
+	},
 #ifdef CONFIG_SCHED_HMP
 	{
 		.name = "sched_boost_no_override",
@@ -835,6 +1033,8 @@ schedtune_boostgroup_init(struct schedtune *st)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		bg->group[st->idx].boost = 0;
+		bg->group[st->idx].util_min = 0;
+		bg->group[st->idx].util_max = SCHED_CAPACITY_SCALE;
 		bg->group[st->idx].tasks = 0;
 	}
 
@@ -872,6 +1072,7 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 
 	/* Initialize per CPUs boost group support */
 	st->idx = idx;
+	st->util_max = 100;
 	init_sched_boost(st);
 	if (schedtune_boostgroup_init(st))
 		goto release;
@@ -889,6 +1090,7 @@ schedtune_boostgroup_release(struct schedtune *st)
 {
 	/* Reset this boost group */
 	schedtune_boostgroup_update(st->idx, 0);
+	schedtune_clampgroup_update(st->idx, 0, 100);
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = NULL;
@@ -925,6 +1127,8 @@ schedtune_init_cgroups(void)
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		memset(bg, 0, sizeof(struct boost_groups));
 		raw_spin_lock_init(&bg->lock);
+		bg->util_max = SCHED_CAPACITY_SCALE;
+		bg->group[0].util_max = SCHED_CAPACITY_SCALE;
 	}
 
 	pr_info("schedtune: configured to support %d boost groups\n",
@@ -44,6 +44,9 @@ unsigned int sysctl_sched_walt_init_task_load_pct = 15;
 /* true -> use PELT based load stats, false -> use window-based load stats */
 bool __read_mostly walt_disabled = false;
 
+/* Feed bucket based busy time prediction into placement and frequency */
+bool __read_mostly walt_pred_demand = true;
+
 /*
  * Window size (in ns). Adjust for the tick size so that the window
  * rollover occurs just before the tick boundary.
@@ -74,6 +77,7 @@ walt_inc_cumulative_runnable_avg(struct rq *rq,
 				 struct task_struct *p)
 {
 	rq->cumulative_runnable_avg += p->ravg.demand;
+	rq->cumulative_pred_demand += p->ravg.pred_demand;
 
 	/*
 	 * Add a task's contribution to the cumulative window demand when
@@ -92,6 +96,8 @@ walt_dec_cumulative_runnable_avg(struct rq *rq,
 {
 	rq->cumulative_runnable_avg -= p->ravg.demand;
 	BUG_ON((s64)rq->cumulative_runnable_avg < 0);
+	rq->cumulative_pred_demand -= p->ravg.pred_demand;
+	BUG_ON((s64)rq->cumulative_pred_demand < 0);
 
 	/*
 	 * on_rq will be 1 for sleeping tasks. So check if the task
@@ -104,7 +110,8 @@ walt_dec_cumulative_runnable_avg(struct rq *rq,
 
 static void
 fixup_cumulative_runnable_avg(struct rq *rq,
-			      struct task_struct *p, u64 new_task_load)
+			      struct task_struct *p, u64 new_task_load,
+			      u32 new_pred_demand)
 {
 	s64 task_load_delta = (s64)new_task_load - task_load(p);
 
@@ -113,6 +120,10 @@ fixup_cumulative_runnable_avg(struct rq *rq,
 		panic("cra less than zero: tld: %lld, task_load(p) = %u\n",
 			task_load_delta, task_load(p));
 
+	rq->cumulative_pred_demand += (s64)new_pred_demand -
+				      p->ravg.pred_demand;
+	BUG_ON((s64)rq->cumulative_pred_demand < 0);
+
 	fixup_cum_window_demand(rq, task_load_delta);
 }
 
@@ -199,6 +210,13 @@ static int __init set_walt_ravg_window(char *str)
 
 early_param("walt_ravg_window", set_walt_ravg_window);
 
+static int __init set_walt_pred_demand(char *str)
+{
+	return strtobool(str, &walt_pred_demand);
+}
+
+early_param("walt_pred_demand", set_walt_pred_demand);
+
 static void
 update_window_start(struct rq *rq, u64 wallclock)
 {
@@ -554,6 +572,195 @@ static int account_busy_for_task_demand(struct task_struct *p, int event)
 	return 1;
 }
 
+#define WALT_NEW_TASK_WINDOWS	5
+
+#define INC_STEP 8
+#define DEC_STEP 2
+#define CONSISTENT_THRES 16
+#define INC_STEP_BIG 16
+
+static inline bool is_new_task(struct task_struct *p)
+{
+	return p->ravg.active_windows < WALT_NEW_TASK_WINDOWS;
+}
+
+/*
+ * bucket_increase - update the count of all buckets
+ *
+ * @buckets: array of buckets tracking busy time of a task
+ * @idx: the index of bucket to be incremented
+ *
+ * Each time a complete window finishes, count of bucket that runtime
+ * falls in (@idx) is incremented. Counts of all other buckets are
+ * decayed. The rate of increase and decay could be different based
+ * on current count in the bucket.
+ */
+static inline void bucket_increase(u8 *buckets, int idx)
+{
+	int i, step;
+
+	for (i = 0; i < NUM_BUSY_BUCKETS; i++) {
+		if (idx != i) {
+			if (buckets[i] > DEC_STEP)
+				buckets[i] -= DEC_STEP;
+			else
+				buckets[i] = 0;
+		} else {
+			step = buckets[i] >= CONSISTENT_THRES ?
+						INC_STEP_BIG : INC_STEP;
+			if (buckets[i] > U8_MAX - step)
+				buckets[i] = U8_MAX;
+			else
+				buckets[i] += step;
+		}
+	}
+}
+
+static inline int busy_to_bucket(u32 normalized_rt)
+{
+	int bidx;
+
+	bidx = mult_frac(normalized_rt, NUM_BUSY_BUCKETS, walt_ravg_window);
+	bidx = min(bidx, NUM_BUSY_BUCKETS - 1);
+
+	/*
+	 * Combine lowest two buckets. The lowest frequency falls into
+	 * 2nd bucket and thus keep predicting lowest bucket is not
+	 * useful.
+	 */
+	if (!bidx)
+		bidx++;
+
+	return bidx;
+}
+
+/*
+ * get_pred_busy - calculate predicted demand for a task
+ *
+ * @p: task whose prediction is being updated
+ * @start: starting bucket. returned prediction should not be lower than
+ *         this bucket.
+ * @runtime: runtime of the task. returned prediction should not be lower
+ *           than this runtime.
+ *
+ * Searches the buckets that represent busy time equal to or bigger than
+ * @runtime for the first one in use. The latest historical busy time
+ * that falls into that bucket is returned, or the middle of the bucket
+ * when there is none.
+ */
+static u32 get_pred_busy(struct task_struct *p, int start, u32 runtime)
+{
+	int i;
+	u8 *buckets = p->ravg.busy_buckets;
+	u32 *hist = p->ravg.sum_history;
+	u32 dmin, dmax;
+	int first = NUM_BUSY_BUCKETS, final;
+	u32 ret = runtime;
+
+	/* skip prediction for new tasks due to lack of history */
+	if (unlikely(is_new_task(p)))
+		return ret;
+
+	/* find minimal bucket index to pick */
+	for (i = start; i < NUM_BUSY_BUCKETS; i++) {
+		if (buckets[i]) {
+			first = i;
+			break;
+		}
+	}
+	/* if no higher buckets are filled, predict runtime */
+	if (first >= NUM_BUSY_BUCKETS)
+		return ret;
+
+	/* compute the bucket for prediction */
+	final = first;
+
+	/* determine demand range for the predicted bucket */
+	if (final < 2) {
+		/* lowest two buckets are combined */
+		dmin = 0;
+		final = 1;
+	} else {
+		dmin = mult_frac(final, walt_ravg_window, NUM_BUSY_BUCKETS);
+	}
+	dmax = mult_frac(final + 1, walt_ravg_window, NUM_BUSY_BUCKETS);
+
+	/*
+	 * search through runtime history and return first runtime that falls
+	 * into the range of predicted bucket.
+	 */
+	for (i = 0; i < walt_ravg_hist_size; i++) {
+		if (hist[i] >= dmin && hist[i] < dmax) {
+			ret = hist[i];
+			break;
+		}
+	}
+	/* no historical runtime within bucket found, use average of the bin */
+	if (ret < dmin)
+		ret = (dmin + dmax) / 2;
+	/*
+	 * when updating in middle of a window, runtime could be higher
+	 * than all recorded history. Always predict at least runtime.
+	 */
+	return max(runtime, ret);
+}
+
+static inline u32 predict_and_update_buckets(struct task_struct *p,
+					     u32 runtime)
+{
+	int bidx;
+	u32 pred_demand;
+
+	bidx = busy_to_bucket(runtime);
+	pred_demand = get_pred_busy(p, bidx, runtime);
+	bucket_increase(p->ravg.busy_buckets, bidx);
+
+	return pred_demand;
+}
+
+/*
+ * The prediction is made at window roll-over. If the busy time of the
+ * current window already exceeds it, raise it right away so that a burst
+ * gets its capacity before the window closes.
+ */
+static void update_task_pred_demand(struct rq *rq, struct task_struct *p,
+				    int event)
+{
+	u32 new;
+
+	if (is_idle_task(p) || exiting_task(p))
+		return;
+
+	if (event != PUT_PREV_TASK && event != TASK_UPDATE &&
+			(!walt_freq_account_wait_time ||
+			 (event != TASK_MIGRATE &&
+			 event != PICK_NEXT_TASK)))
+		return;
+
+	/*
+	 * TASK_UPDATE can be called on sleeping task, when its moved between
+	 * related groups
+	 */
+	if (event == TASK_UPDATE) {
+		if (!p->on_rq && !walt_freq_account_wait_time)
+			return;
+	}
+
+	if (p->ravg.pred_demand >= p->ravg.curr_window)
+		return;
+
+	new = get_pred_busy(p, busy_to_bucket(p->ravg.curr_window),
+			    p->ravg.curr_window);
+	if (p->ravg.pred_demand >= new)
+		return;
+
+	if (task_on_rq_queued(p) && (!task_has_dl_policy(p) ||
+				!p->dl.dl_throttled))
+		fixup_cumulative_runnable_avg(rq, p, p->ravg.demand, new);
+
+	p->ravg.pred_demand = new;
+}
+
 /*
  * Called when new window is starting for a task, to record cpu usage over
  * recently concluded window(s). Normally 'samples' should be 1. It can be > 1
@@ -565,7 +772,7 @@ static void update_history(struct rq *rq, struct task_struct *p,
 {
 	u32 *hist = &p->ravg.sum_history[0];
 	int ridx, widx;
-	u32 max = 0, avg, demand;
+	u32 max = 0, avg, demand, pred_demand;
 	u64 sum = 0;
 
 	/* Ignore windows where task had no activity */
@@ -602,6 +809,7 @@ static void update_history(struct rq *rq, struct task_struct *p,
 		else
 			demand = max(avg, runtime);
 	}
+	pred_demand = predict_and_update_buckets(p, runtime);
 
 	/*
 	 * A throttled deadline sched class task gets dequeued without
@@ -617,12 +825,14 @@ static void update_history(struct rq *rq, struct task_struct *p,
 	 */
 	if (!task_has_dl_policy(p) || !p->dl.dl_throttled) {
 		if (task_on_rq_queued(p))
-			fixup_cumulative_runnable_avg(rq, p, demand);
+			fixup_cumulative_runnable_avg(rq, p, demand,
+						      pred_demand);
 		else if (rq->curr == p)
 			fixup_cum_window_demand(rq, demand);
 	}
 
 	p->ravg.demand = demand;
+	p->ravg.pred_demand = pred_demand;
 
 done:
 	trace_walt_update_history(rq, p, runtime, samples, event);
@@ -756,6 +966,7 @@ void walt_update_task_ravg(struct task_struct *p, struct rq *rq,
 
 	update_task_demand(p, rq, event, wallclock);
 	update_cpu_busy_time(p, rq, event, wallclock, irqtime);
+	update_task_pred_demand(rq, p, event);
 
 done:
 	trace_walt_update_task_ravg(p, rq, event, wallclock, irqtime);
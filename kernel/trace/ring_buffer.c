@@ -22,6 +22,10 @@
 #include <linux/hash.h>
 #include <linux/list.h>
 #include <linux/cpu.h>
+#include <linux/highmem.h>
+#include <linux/mm.h>
+
+#include <uapi/linux/trace_mmap.h>
 
 #include <asm/local.h>
 
@@ -302,6 +306,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* index in the user mapping */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -470,6 +475,12 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user mapping, see ring_buffer_map() */
+	struct mutex			mapping_lock;
+	unsigned int			mapped;
+	struct trace_buffer_meta	*meta_page;
+	unsigned long			*subbuf_ids;
 };
 
 struct ring_buffer {
@@ -1230,6 +1241,7 @@ rb_allocate_cpu_buffer(struct ring_buffer *buffer, long nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -4441,6 +4453,12 @@ int ring_buffer_swap_cpu(struct ring_buffer *buffer_a,
 	cpu_buffer_a = buffer_a->buffers[cpu];
 	cpu_buffer_b = buffer_b->buffers[cpu];
 
+	/* the mapping points at the pages of this buffer */
+	ret = -EBUSY;
+	if (READ_ONCE(cpu_buffer_a->mapped) || READ_ONCE(cpu_buffer_b->mapped))
+		goto out;
+	ret = -EINVAL;
+
 	/* At least make sure the two buffers are somewhat the same */
 	if (cpu_buffer_a->nr_pages != cpu_buffer_b->nr_pages)
 		goto out;
@@ -4606,6 +4624,10 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 
 	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 
+	/* swapping the reader page out would break the user mapping */
+	if (cpu_buffer->mapped)
+		goto out_unlock;
+
 	reader = rb_get_reader_page(cpu_buffer);
 	if (!reader)
 		goto out_unlock;
@@ -4735,6 +4757,243 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+}
+
+/*
+ * Number the reader page 0 and the ring pages from 1 in list order, and
+ * fill the meta page. Called with the reader_lock held, which keeps the
+ * set of pages stable as only readers swap pages in and out of the ring.
+ */
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	struct list_head *p = cpu_buffer->pages;
+	struct buffer_page *bpage;
+	unsigned id = 0;
+
+	cpu_buffer->reader_page->id = id;
+	cpu_buffer->subbuf_ids[id++] =
+		(unsigned long)cpu_buffer->reader_page->page;
+	do {
+		bpage = list_entry(p, struct buffer_page, list);
+		if (WARN_ON(id > cpu_buffer->nr_pages))
+			break;
+		bpage->id = id;
+		cpu_buffer->subbuf_ids[id++] = (unsigned long)bpage->page;
+		p = rb_list_head(p->next);
+	} while (p != cpu_buffer->pages);
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = id;
+	meta->reader.id = cpu_buffer->reader_page->id;
+	meta->reader.read = cpu_buffer->reader_page->read;
+	meta->reader.read_end = cpu_buffer->reader_page->read;
+	rb_update_meta_page(cpu_buffer);
+}
+
+static int rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+		      struct vm_area_struct *vma)
+{
+	unsigned long nr_pages = vma_pages(vma);
+	unsigned long i;
+	int ret;
+
+	if (vma->vm_pgoff ||
+	    nr_pages > cpu_buffer->meta_page->nr_subbufs + 1)
+		return -EINVAL;
+
+	ret = vm_insert_page(vma, vma->vm_start,
+			     virt_to_page(cpu_buffer->meta_page));
+	for (i = 1; i < nr_pages && !ret; i++)
+		ret = vm_insert_page(vma, vma->vm_start + i * PAGE_SIZE,
+			virt_to_page((void *)cpu_buffer->subbuf_ids[i - 1]));
+	return ret;
+}
+
+/**
+ * ring_buffer_map - map a per cpu buffer into user space
+ * @buffer: the ring buffer
+ * @cpu: the cpu buffer to map
+ * @vma: the read only vma to map it into
+ *
+ * Maps the meta page followed by every page of the cpu buffer, reader
+ * page first. While a cpu buffer is mapped it can not be resized or
+ * swapped, and ring_buffer_read_page() fails for it, as either would
+ * replace pages userspace has mapped. Every successful call must be
+ * paired with ring_buffer_unmap() once the vma is gone.
+ */
+int ring_buffer_map(struct ring_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		/* wait out a resize in progress and keep new ones away */
+		mutex_lock(&buffer->mutex);
+		atomic_inc(&buffer->resize_disabled);
+		mutex_unlock(&buffer->mutex);
+
+		cpu_buffer->meta_page = (void *)get_zeroed_page(GFP_KERNEL);
+		cpu_buffer->subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1,
+					sizeof(*cpu_buffer->subbuf_ids),
+					GFP_KERNEL);
+		if (!cpu_buffer->meta_page || !cpu_buffer->subbuf_ids) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+		rb_setup_ids_meta_page(cpu_buffer);
+		cpu_buffer->mapped = 1;
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+	} else {
+		cpu_buffer->mapped++;
+	}
+
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	ret = rb_map_vma(cpu_buffer, vma);
+	if (ret) {
+		/* the caller will not unmap what failed to map */
+		mutex_unlock(&cpu_buffer->mapping_lock);
+		ring_buffer_unmap(buffer, cpu);
+		return ret;
+	}
+
+	mutex_unlock(&cpu_buffer->mapping_lock);
+	return 0;
+
+ err:
+	free_page((unsigned long)cpu_buffer->meta_page);
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->meta_page = NULL;
+	cpu_buffer->subbuf_ids = NULL;
+	atomic_dec(&buffer->resize_disabled);
+	mutex_unlock(&cpu_buffer->mapping_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map);
+
+/**
+ * ring_buffer_unmap - drop a mapping taken by ring_buffer_map()
+ * @buffer: the ring buffer
+ * @cpu: the mapped cpu buffer
+ *
+ * Must only be called after the vma is gone: the pages stay in the ring
+ * buffer, but the meta page is freed with the last mapping.
+ */
+int ring_buffer_unmap(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		ret = -ENODEV;
+	} else if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+	} else {
+		raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+		cpu_buffer->mapped = 0;
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+		free_page((unsigned long)cpu_buffer->meta_page);
+		kfree(cpu_buffer->subbuf_ids);
+		cpu_buffer->meta_page = NULL;
+		cpu_buffer->subbuf_ids = NULL;
+		atomic_dec(&buffer->resize_disabled);
+	}
+
+	mutex_unlock(&cpu_buffer->mapping_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unmap);
+
+/**
+ * ring_buffer_map_get_reader - hand the next events to the mapping
+ * @buffer: the ring buffer
+ * @cpu: the mapped cpu buffer
+ *
+ * If everything on the reader page was handed out already, swap in the
+ * next page from the ring. Then consume what is committed on the reader
+ * page and record the range in the meta page, see TRACE_MMAP_IOCTL_GET_READER.
+ */
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page *reader;
+	unsigned long flags;
+	unsigned read;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	/* mapped can only go 1 -> 0 while holding the reader_lock */
+	if (!cpu_buffer->mapped) {
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+		return -ENODEV;
+	}
+	meta = cpu_buffer->meta_page;
+
+	/* swaps in the next page only if this one is fully consumed */
+	rb_get_reader_page(cpu_buffer);
+	reader = cpu_buffer->reader_page;
+
+	if (meta->reader.id != reader->id) {
+		meta->reader.lost_events = cpu_buffer->lost_events;
+		cpu_buffer->lost_events = 0;
+	}
+
+	read = reader->read;
+	while (reader->read < rb_page_size(reader))
+		rb_advance_reader(cpu_buffer);
+
+	meta->reader.id = reader->id;
+	meta->reader.read = read;
+	meta->reader.read_end = reader->read;
+	rb_update_meta_page(cpu_buffer);
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	flush_dcache_page(virt_to_page(reader->page));
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_get_reader);
+
 #ifdef CONFIG_HOTPLUG_CPU
 static int rb_cpu_notify(struct notifier_block *self,
 			 unsigned long action, void *hcpu)
@@ -43,6 +43,7 @@
 #include <linux/fs.h>
 #include <linux/sched/rt.h>
 #include <linux/coresight-stm.h>
+#include <uapi/linux/trace_mmap.h>
 
 #include "trace.h"
 #include "trace_output.h"
@@ -5500,6 +5501,7 @@ struct ftrace_buffer_info {
 	struct trace_iterator	iter;
 	void			*spare;
 	unsigned int		read;
+	atomic_t		mapped;
 };
 
 #ifdef CONFIG_TRACER_SNAPSHOT
@@ -5825,6 +5827,10 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 		return -EBUSY;
 #endif
 
+	/* the mapping owns the reader page */
+	if (atomic_read(&info->mapped))
+		return -EBUSY;
+
 	if (!info->spare)
 		info->spare = ring_buffer_alloc_read_page(iter->trace_buffer->buffer,
 							  iter->cpu_file);
@@ -5879,6 +5885,11 @@ static int tracing_buffers_release(struct inode *inode, struct file *file)
 {
 	struct ftrace_buffer_info *info = file->private_data;
 	struct trace_iterator *iter = &info->iter;
+	int mapped;
+
+	/* the vmas hold the file, so they are all gone by now */
+	for (mapped = atomic_read(&info->mapped); mapped; mapped--)
+		ring_buffer_unmap(iter->trace_buffer->buffer, iter->cpu_file);
 
 	mutex_lock(&trace_types_lock);
 
@@ -5978,6 +5989,9 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 		return -EBUSY;
 #endif
 
+	if (atomic_read(&info->mapped))
+		return -EBUSY;
+
 	if (*ppos & (PAGE_SIZE - 1))
 		return -EINVAL;
 
@@ -6059,12 +6073,52 @@ out:
 	return ret;
 }
 
+/*
+ * Map the meta page and all pages of the cpu buffer read only. Events are
+ * then consumed with TRACE_MMAP_IOCTL_GET_READER, see trace_mmap.h, and
+ * read() and splice() on this file fail with -EBUSY until it is closed.
+ */
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	if (iter->cpu_file == RING_BUFFER_ALL_CPUS)
+		return -EINVAL;
+
+	ret = ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file, vma);
+	if (ret)
+		return ret;
+
+	atomic_inc(&info->mapped);
+	return 0;
+}
+
+static long tracing_buffers_ioctl(struct file *filp, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOTTY;
+
+	if (!atomic_read(&info->mapped))
+		return -ENODEV;
+
+	return ring_buffer_map_get_reader(iter->trace_buffer->buffer,
+					  iter->cpu_file);
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.mmap		= tracing_buffers_mmap,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
 	.llseek		= no_llseek,
 };
 
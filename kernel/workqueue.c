@@ -50,6 +50,7 @@
 #include <linux/uaccess.h>
 #include <linux/bug.h>
 #include <linux/delay.h>
+#include <linux/topology.h>
 
 #include "workqueue_internal.h"
 
@@ -277,7 +278,11 @@ struct workqueue_struct {
 	/* hot fields used during command issue, aligned to cacheline */
 	unsigned int		flags ____cacheline_aligned; /* WQ: WQ_* flags */
 	struct pool_workqueue __percpu *cpu_pwqs; /* I: per-cpu pwqs */
-	struct pool_workqueue __rcu *numa_pwq_tbl[]; /* PWR: unbound pwqs indexed by node */
+	/*
+	 * PWR: unbound pwqs indexed by node, followed by nr_cpu_ids unbound
+	 * pwqs indexed by cluster, see wq_cluster_pwq_tbl().
+	 */
+	struct pool_workqueue __rcu *numa_pwq_tbl[];
 };
 
 static struct kmem_cache *pwq_cache;
@@ -586,6 +591,58 @@ static struct pool_workqueue *unbound_pwq_by_node(struct workqueue_struct *wq,
 	return rcu_dereference_raw(wq->numa_pwq_tbl[node]);
 }
 
+/*
+ * Cluster pwqs live right after the per-node ones.  They are only
+ * populated while ->unbound_attrs->cluster is set.
+ */
+static inline struct pool_workqueue __rcu **
+wq_cluster_pwq_tbl(struct workqueue_struct *wq)
+{
+	return &wq->numa_pwq_tbl[nr_node_ids];
+}
+
+static inline int wq_cluster_id(int cpu)
+{
+	int id = topology_physical_package_id(cpu);
+
+	return id >= 0 && id < nr_cpu_ids ? id : -1;
+}
+
+/**
+ * unbound_pwq_by_cluster - return the cluster pool_workqueue for a CPU
+ * @wq: the target workqueue
+ * @cpu: the queueing CPU
+ *
+ * Same locking rules as unbound_pwq_by_node().
+ *
+ * Return: The pwq covering @cpu's cluster, or %NULL if @wq doesn't use
+ * cluster affinity or that pwq is saturated, in which case the work
+ * spills over to the pwq of the node.
+ */
+static struct pool_workqueue *unbound_pwq_by_cluster(struct workqueue_struct *wq,
+						     int cpu)
+{
+	struct pool_workqueue *pwq;
+	int id = wq_cluster_id(cpu);
+
+	assert_rcu_or_wq_mutex_or_pool_mutex(wq);
+
+	if (id < 0)
+		return NULL;
+
+	pwq = rcu_dereference_raw(wq_cluster_pwq_tbl(wq)[id]);
+	if (!pwq)
+		return NULL;
+
+	/* would be delayed, or has to wait for a worker: spill */
+	if (READ_ONCE(pwq->nr_active) >= READ_ONCE(pwq->max_active) ||
+	    (!READ_ONCE(pwq->pool->nr_idle) &&
+	     !list_empty(&pwq->pool->worklist)))
+		return NULL;
+
+	return pwq;
+}
+
 static unsigned int work_color_to_flags(int color)
 {
 	return color << WORK_STRUCT_COLOR_SHIFT;
@@ -1373,10 +1430,13 @@ retry:
 		cpu = raw_smp_processor_id();
 
 	/* pwq which will be used unless @work is executing elsewhere */
-	if (!(wq->flags & WQ_UNBOUND))
+	if (!(wq->flags & WQ_UNBOUND)) {
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
-	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+	} else {
+		pwq = unbound_pwq_by_cluster(wq, cpu);
+		if (!pwq)
+			pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+	}
 
 	/*
 	 * If @work was previously on a different pool, it might still be
@@ -3089,6 +3149,7 @@ static void copy_workqueue_attrs(struct workqueue_attrs *to,
 	 * get_unbound_pool() explicitly clears ->no_numa after copying.
 	 */
 	to->no_numa = from->no_numa;
+	to->cluster = from->cluster;
 }
 
 /* hash value of the content of @attr */
@@ -3297,6 +3358,7 @@ static struct worker_pool *get_unbound_pool(const struct workqueue_attrs *attrs)
 	 * 'struct workqueue_attrs' comments for detail.
 	 */
 	pool->attrs->no_numa = false;
+	pool->attrs->cluster = false;
 
 	if (worker_pool_assign_id(pool) < 0)
 		goto fail;
@@ -3545,6 +3607,7 @@ struct apply_wqattrs_ctx {
 	struct workqueue_attrs	*attrs;		/* attrs to apply */
 	struct list_head	list;		/* queued for batching commit */
 	struct pool_workqueue	*dfl_pwq;
+	struct pool_workqueue	**cluster_tbl;	/* nr_cpu_ids, by cluster */
 	struct pool_workqueue	*pwq_tbl[];
 };
 
@@ -3556,6 +3619,11 @@ static void apply_wqattrs_cleanup(struct apply_wqattrs_ctx *ctx)
 
 		for_each_node(node)
 			put_pwq_unlocked(ctx->pwq_tbl[node]);
+		if (ctx->cluster_tbl) {
+			for (node = 0; node < nr_cpu_ids; node++)
+				put_pwq_unlocked(ctx->cluster_tbl[node]);
+			kfree(ctx->cluster_tbl);
+		}
 		put_pwq_unlocked(ctx->dfl_pwq);
 
 		free_workqueue_attrs(ctx->attrs);
@@ -3571,16 +3639,20 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 {
 	struct apply_wqattrs_ctx *ctx;
 	struct workqueue_attrs *new_attrs, *tmp_attrs;
-	int node;
+	int node, cpu;
 
 	lockdep_assert_held(&wq_pool_mutex);
 
 	ctx = kzalloc(sizeof(*ctx) + nr_node_ids * sizeof(ctx->pwq_tbl[0]),
 		      GFP_KERNEL);
+	if (ctx)
+		ctx->cluster_tbl = kcalloc(nr_cpu_ids,
+					   sizeof(ctx->cluster_tbl[0]),
+					   GFP_KERNEL);
 
 	new_attrs = alloc_workqueue_attrs(GFP_KERNEL);
 	tmp_attrs = alloc_workqueue_attrs(GFP_KERNEL);
-	if (!ctx || !new_attrs || !tmp_attrs)
+	if (!ctx || !ctx->cluster_tbl || !new_attrs || !tmp_attrs)
 		goto out_free;
 
 	/*
@@ -3620,6 +3692,28 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 		}
 	}
 
+	/*
+	 * One pwq per cluster, restricted to the cluster's CPUs.  Clusters
+	 * which the cpumask doesn't cover, or covers entirely, are left
+	 * empty and use the per-node pwqs.
+	 */
+	for_each_possible_cpu(cpu) {
+		int id = wq_cluster_id(cpu);
+
+		if (!attrs->cluster || id < 0 || ctx->cluster_tbl[id])
+			continue;
+
+		cpumask_and(tmp_attrs->cpumask, new_attrs->cpumask,
+			    topology_core_cpumask(cpu));
+		if (cpumask_empty(tmp_attrs->cpumask) ||
+		    cpumask_equal(tmp_attrs->cpumask, new_attrs->cpumask))
+			continue;
+
+		ctx->cluster_tbl[id] = alloc_unbound_pwq(wq, tmp_attrs);
+		if (!ctx->cluster_tbl[id])
+			goto out_free;
+	}
+
 	/* save the user configured attrs and sanitize it. */
 	copy_workqueue_attrs(new_attrs, attrs);
 	cpumask_and(new_attrs->cpumask, new_attrs->cpumask, cpu_possible_mask);
@@ -3651,6 +3745,16 @@ static void apply_wqattrs_commit(struct apply_wqattrs_ctx *ctx)
 		ctx->pwq_tbl[node] = numa_pwq_tbl_install(ctx->wq, node,
 							  ctx->pwq_tbl[node]);
 
+	for (node = 0; node < nr_cpu_ids; node++) {
+		struct pool_workqueue __rcu **tbl = wq_cluster_pwq_tbl(ctx->wq);
+		struct pool_workqueue *old_pwq = rcu_access_pointer(tbl[node]);
+
+		if (ctx->cluster_tbl[node])
+			link_pwq(ctx->cluster_tbl[node]);
+		rcu_assign_pointer(tbl[node], ctx->cluster_tbl[node]);
+		ctx->cluster_tbl[node] = old_pwq;
+	}
+
 	/* @dfl_pwq might not have been used, ensure it's linked */
 	link_pwq(ctx->dfl_pwq);
 	swap(ctx->wq->dfl_pwq, ctx->dfl_pwq);
@@ -3889,7 +3993,8 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 
 	/* allocate wq and format name */
 	if (flags & WQ_UNBOUND)
-		tbl_size = nr_node_ids * sizeof(wq->numa_pwq_tbl[0]);
+		tbl_size = (nr_node_ids + nr_cpu_ids) *
+			sizeof(wq->numa_pwq_tbl[0]);
 
 	wq = kzalloc(sizeof(*wq) + tbl_size, GFP_KERNEL);
 	if (!wq)
@@ -4060,6 +4165,12 @@ void destroy_workqueue(struct workqueue_struct *wq)
 			put_pwq_unlocked(pwq);
 		}
 
+		for (node = 0; node < nr_cpu_ids; node++) {
+			pwq = rcu_access_pointer(wq_cluster_pwq_tbl(wq)[node]);
+			RCU_INIT_POINTER(wq_cluster_pwq_tbl(wq)[node], NULL);
+			put_pwq_unlocked(pwq);
+		}
+
 		/*
 		 * Put dfl_pwq.  @wq may be freed any time after dfl_pwq is
 		 * put.  Don't access it afterwards.
@@ -5147,11 +5258,52 @@ out_unlock:
 	return ret ?: count;
 }
 
+static ssize_t wq_cluster_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int written;
+
+	mutex_lock(&wq->mutex);
+	written = scnprintf(buf, PAGE_SIZE, "%d\n",
+			    wq->unbound_attrs->cluster);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_cluster_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int v, ret = -ENOMEM;
+
+	apply_wqattrs_lock();
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		goto out_unlock;
+
+	ret = -EINVAL;
+	if (sscanf(buf, "%d", &v) == 1) {
+		attrs->cluster = !!v;
+		ret = apply_workqueue_attrs_locked(wq, attrs);
+	}
+
+out_unlock:
+	apply_wqattrs_unlock();
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
+	__ATTR(cluster, 0644, wq_cluster_show, wq_cluster_store),
 	__ATTR_NULL,
 };
 
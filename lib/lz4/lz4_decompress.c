@@ -39,6 +39,9 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <asm/unaligned.h>
+#ifdef CONFIG_LZ4_NEON
+#include <asm/neon.h>
+#endif
 
 /*-*****************************
  *	Decompression functions
@@ -446,7 +449,7 @@ _output_error:
 	return (int) (-(((const char *)ip) - src)) - 1;
 }
 
-int LZ4_decompress_safe(const char *source, char *dest,
+int LZ4_decompress_safe_generic(const char *source, char *dest,
 	int compressedSize, int maxDecompressedSize)
 {
 	return LZ4_decompress_generic(source, dest,
@@ -496,6 +499,60 @@ static int LZ4_decompress_safe_withSmallPrefix(const char *source, char *dest,
 				      (BYTE *)dest - prefixSize, NULL, 0);
 }
 
+#ifdef CONFIG_LZ4_NEON
+static bool neon = true;
+module_param(neon, bool, 0644);
+MODULE_PARM_DESC(neon, "Use the NEON fast path of LZ4_decompress_safe()");
+
+/*
+ * The NEON loop may write and read up to 15 bytes past the limits it
+ * is given, and leaves the last sequences, with their end of block
+ * rules, to the generic decoder.
+ */
+#define LZ4_NEON_MARGIN		32
+#define LZ4_NEON_MIN_SIZE	(4 * LZ4_NEON_MARGIN)
+
+asmlinkage void lz4_decompress_neon(BYTE **op, const BYTE *dst,
+				    const BYTE *oend, const BYTE **ip,
+				    const BYTE *iend);
+
+static int LZ4_decompress_safe_neon(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	const BYTE *ip = (const BYTE *)source;
+	BYTE *op = (BYTE *)dest;
+	int ret;
+
+	kernel_neon_begin_partial(1);
+	lz4_decompress_neon(&op, (BYTE *)dest,
+			    (BYTE *)dest + maxDecompressedSize - LZ4_NEON_MARGIN,
+			    &ip, ip + compressedSize - LZ4_NEON_MARGIN);
+	kernel_neon_end();
+
+	ret = LZ4_decompress_safe_withSmallPrefix((const char *)ip,
+			(char *)op, source + compressedSize - (const char *)ip,
+			dest + maxDecompressedSize - (char *)op,
+			op - (BYTE *)dest);
+	if (ret < 0)
+		return ret - ((const char *)ip - source);
+	return ret + ((char *)op - dest);
+}
+#endif
+
+int LZ4_decompress_safe(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+#ifdef CONFIG_LZ4_NEON
+	if (neon && cpu_has_neon() &&
+	    compressedSize >= LZ4_NEON_MIN_SIZE &&
+	    maxDecompressedSize >= LZ4_NEON_MIN_SIZE)
+		return LZ4_decompress_safe_neon(source, dest, compressedSize,
+						maxDecompressedSize);
+#endif
+	return LZ4_decompress_safe_generic(source, dest, compressedSize,
+					   maxDecompressedSize);
+}
+
 int LZ4_decompress_safe_forceExtDict(const char *source, char *dest,
 				     int compressedSize, int maxOutputSize,
 				     const void *dictStart, size_t dictSize)
@@ -696,6 +753,7 @@ int LZ4_decompress_fast_usingDict(const char *source, char *dest,
 
 #ifndef STATIC
 EXPORT_SYMBOL(LZ4_decompress_safe);
+EXPORT_SYMBOL(LZ4_decompress_safe_generic);
 EXPORT_SYMBOL(LZ4_decompress_safe_partial);
 EXPORT_SYMBOL(LZ4_decompress_fast);
 EXPORT_SYMBOL(LZ4_setStreamDecode);
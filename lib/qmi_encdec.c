@@ -18,7 +18,15 @@
 #include <linux/errno.h>
 #include <linux/io.h>
 #include <linux/string.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/qmi_encdec.h>
+#include <asm/sections.h>
+#include <asm/timex.h>
 
 #include "qmi_encdec_priv.h"
 
@@ -216,6 +224,417 @@ bool qmi_verify_max_msg_len(struct msg_desc *desc)
 	return true;
 }
 
+/*
+ * Compiled messages: the first time a message's ei_array is seen, its
+ * elements are flattened into a table of TLVs, each a list of copy runs
+ * between the C structure and the wire. Messages made only of fixed
+ * size elements, optionally behind an OPT_FLAG, are then encoded and
+ * decoded from the table instead of walking ei_array element by
+ * element. Anything with variable length arrays or strings keeps the
+ * interpreter, but still gets an entry for the per message statistics.
+ */
+#define QMI_PROG_MAX_TLVS	32
+#define QMI_PROG_MAX_RUNS	64
+#define QMI_PROG_NO_TLV		0xFF
+#define QMI_PROG_HASH_BITS	6
+
+struct qmi_prog_run {
+	uint32_t offset;
+	uint32_t len;
+};
+
+struct qmi_prog_tlv {
+	uint8_t type;
+	uint8_t opt;
+	uint16_t len;
+	uint32_t flag_offset;
+	uint16_t first_run;
+	uint16_t nruns;
+};
+
+struct qmi_prog {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	struct elem_info *ei_array;
+	uint16_t msg_id;
+
+	/* statistics, updated without locking */
+	u64 enc_cnt;
+	u64 enc_cycles;
+	u64 dec_cnt;
+	u64 dec_cycles;
+	u64 dec_slow;
+
+	int ntlvs; /* 0 if the message is not compiled */
+	uint8_t *tlv_map;
+	struct qmi_prog_tlv *tlvs;
+	struct qmi_prog_run *runs;
+	char data[];
+};
+
+struct qmi_prog_build {
+	int ntlvs;
+	int nruns;
+	struct qmi_prog_tlv tlvs[QMI_PROG_MAX_TLVS];
+	struct qmi_prog_run runs[QMI_PROG_MAX_RUNS];
+};
+
+static bool fast_path = true;
+module_param(fast_path, bool, 0644);
+MODULE_PARM_DESC(fast_path, "Use compiled tables for fixed size messages");
+
+static DEFINE_HASHTABLE(qmi_prog_table, QMI_PROG_HASH_BITS);
+static DEFINE_SPINLOCK(qmi_prog_lock);
+
+static int qmi_prog_add_run(struct qmi_prog_build *b, uint32_t offset,
+			    uint32_t len)
+{
+	struct qmi_prog_run *run;
+
+	if (!len)
+		return 0;
+
+	/* merge with the previous run when the C layout is contiguous */
+	if (b->nruns > b->tlvs[b->ntlvs].first_run) {
+		run = &b->runs[b->nruns - 1];
+		if (run->offset + run->len == offset) {
+			run->len += len;
+			return 0;
+		}
+	}
+
+	if (b->nruns == QMI_PROG_MAX_RUNS)
+		return -E2BIG;
+
+	run = &b->runs[b->nruns++];
+	run->offset = offset;
+	run->len = len;
+	return 0;
+}
+
+/*
+ * Flatten one element, at C offset base, into copy runs. Returns the
+ * number of wire bytes, or < 0 if the element is not of fixed size.
+ */
+static int qmi_prog_add_elem(struct qmi_prog_build *b,
+			     struct elem_info *ei, uint32_t base)
+{
+	struct elem_info *temp_ei;
+	uint32_t i, n;
+	int rc, len = 0;
+
+	if (ei->is_array == NO_ARRAY)
+		n = 1;
+	else if (ei->is_array == STATIC_ARRAY)
+		n = ei->elem_len;
+	else
+		return -EINVAL;
+
+	switch (ei->data_type) {
+	case QMI_UNSIGNED_1_BYTE:
+	case QMI_UNSIGNED_2_BYTE:
+	case QMI_UNSIGNED_4_BYTE:
+	case QMI_UNSIGNED_8_BYTE:
+	case QMI_SIGNED_2_BYTE_ENUM:
+	case QMI_SIGNED_4_BYTE_ENUM:
+		rc = qmi_prog_add_run(b, base + ei->offset,
+				      n * ei->elem_size);
+		return rc ? rc : n * ei->elem_size;
+
+	case QMI_STRUCT:
+		for (i = 0; i < n; i++) {
+			temp_ei = ei->ei_array;
+			for (; temp_ei->data_type != QMI_EOTI; temp_ei++) {
+				rc = qmi_prog_add_elem(b, temp_ei, base +
+						ei->offset + i * ei->elem_size);
+				if (rc < 0)
+					return rc;
+				len += rc;
+			}
+		}
+		return len;
+
+	default:
+		return -EINVAL;
+	}
+}
+
+static int qmi_prog_compile(struct qmi_prog_build *b,
+			    struct elem_info *ei_array)
+{
+	struct elem_info *temp_ei = ei_array;
+	struct qmi_prog_tlv *tlv;
+	int rc;
+
+	while (temp_ei->data_type != QMI_EOTI) {
+		if (b->ntlvs == QMI_PROG_MAX_TLVS)
+			return -E2BIG;
+
+		tlv = &b->tlvs[b->ntlvs];
+		if (temp_ei->data_type == QMI_OPT_FLAG) {
+			tlv->opt = 1;
+			tlv->flag_offset = temp_ei->offset;
+			temp_ei++;
+		}
+
+		tlv->type = temp_ei->tlv_type;
+		tlv->first_run = b->nruns;
+		rc = qmi_prog_add_elem(b, temp_ei, 0);
+		if (rc < 0 || rc > U16_MAX)
+			return -EINVAL;
+		tlv->len = rc;
+		tlv->nruns = b->nruns - tlv->first_run;
+		temp_ei++;
+
+		/* a TLV made of several elements is variable, e.g. DATA_LEN */
+		if (temp_ei->data_type != QMI_EOTI &&
+		    temp_ei->tlv_type == tlv->type)
+			return -EINVAL;
+		b->ntlvs++;
+	}
+
+	return 0;
+}
+
+/* Only tables which live as long as the kernel or their module are cached */
+static bool qmi_prog_cacheable(struct elem_info *ei_array)
+{
+	unsigned long addr = (unsigned long)ei_array;
+
+	return core_kernel_data(addr) || is_module_address(addr) ||
+		(addr >= (unsigned long)__start_rodata &&
+		 addr < (unsigned long)__end_rodata);
+}
+
+static struct qmi_prog *qmi_prog_lookup(struct elem_info *ei_array)
+{
+	struct qmi_prog *prog;
+
+	hash_for_each_possible_rcu(qmi_prog_table, prog, node,
+				   (unsigned long)ei_array)
+		if (prog->ei_array == ei_array)
+			return prog;
+	return NULL;
+}
+
+/*
+ * Find the compiled form of desc, compiling it on first use. Called
+ * under rcu_read_lock(), returns NULL if nothing could be allocated.
+ */
+static struct qmi_prog *qmi_prog_get(struct msg_desc *desc)
+{
+	struct qmi_prog_build *b;
+	struct qmi_prog *prog, *old;
+	unsigned long flags;
+	size_t size;
+	int i;
+
+	prog = qmi_prog_lookup(desc->ei_array);
+	if (prog || !qmi_prog_cacheable(desc->ei_array))
+		return prog;
+
+	b = kzalloc(sizeof(*b), GFP_ATOMIC);
+	if (!b)
+		return NULL;
+	if (qmi_prog_compile(b, desc->ei_array))
+		b->ntlvs = 0;
+
+	size = sizeof(*prog);
+	if (b->ntlvs)
+		size += 256 + b->ntlvs * sizeof(*b->tlvs) +
+			b->nruns * sizeof(*b->runs);
+	prog = kzalloc(size, GFP_ATOMIC);
+	if (!prog) {
+		kfree(b);
+		return NULL;
+	}
+
+	prog->ei_array = desc->ei_array;
+	prog->msg_id = desc->msg_id;
+	prog->ntlvs = b->ntlvs;
+	if (prog->ntlvs) {
+		prog->tlvs = (struct qmi_prog_tlv *)prog->data;
+		prog->runs = (struct qmi_prog_run *)(prog->tlvs + b->ntlvs);
+		prog->tlv_map = (uint8_t *)(prog->runs + b->nruns);
+		memcpy(prog->tlvs, b->tlvs, b->ntlvs * sizeof(*b->tlvs));
+		memcpy(prog->runs, b->runs, b->nruns * sizeof(*b->runs));
+		memset(prog->tlv_map, QMI_PROG_NO_TLV, 256);
+		for (i = 0; i < prog->ntlvs; i++)
+			prog->tlv_map[prog->tlvs[i].type] = i;
+	}
+	kfree(b);
+
+	spin_lock_irqsave(&qmi_prog_lock, flags);
+	old = qmi_prog_lookup(desc->ei_array);
+	if (!old)
+		hash_add_rcu(qmi_prog_table, &prog->node,
+			     (unsigned long)prog->ei_array);
+	spin_unlock_irqrestore(&qmi_prog_lock, flags);
+
+	if (old) {
+		kfree(prog);
+		prog = old;
+	}
+	return prog;
+}
+
+static int qmi_prog_encode(struct qmi_prog *prog, uint8_t *buf_dst,
+			   uint8_t *in_c_struct, uint32_t out_buf_len)
+{
+	struct qmi_prog_tlv *tlv;
+	struct qmi_prog_run *run;
+	uint32_t encoded_bytes = 0;
+	int i, j;
+
+	for (i = 0; i < prog->ntlvs; i++) {
+		tlv = &prog->tlvs[i];
+		if (tlv->opt && !in_c_struct[tlv->flag_offset])
+			continue;
+
+		if (encoded_bytes + TLV_TYPE_SIZE + TLV_LEN_SIZE + tlv->len >
+		    out_buf_len) {
+			pr_err("%s: Too Small Buffer @TLV:%d\n",
+				__func__, tlv->type);
+			return -ETOOSMALL;
+		}
+
+		QMI_ENCDEC_ENCODE_TLV(tlv->type, tlv->len, buf_dst);
+		run = &prog->runs[tlv->first_run];
+		for (j = 0; j < tlv->nruns; j++, run++) {
+			memcpy(buf_dst, in_c_struct + run->offset, run->len);
+			buf_dst += run->len;
+		}
+		encoded_bytes += TLV_TYPE_SIZE + TLV_LEN_SIZE + tlv->len;
+	}
+
+	return encoded_bytes;
+}
+
+/*
+ * Returns -EAGAIN for anything unexpected, leaving the interpreter to
+ * decode the message and report the error.
+ */
+static int qmi_prog_decode(struct qmi_prog *prog, uint8_t *out_c_struct,
+			   uint8_t *buf_src, uint32_t in_buf_len)
+{
+	uint8_t *end = buf_src + in_buf_len;
+	struct qmi_prog_tlv *tlv;
+	struct qmi_prog_run *run;
+	uint32_t tlv_type, tlv_len;
+	int j;
+
+	while (buf_src < end) {
+		if (end - buf_src < TLV_TYPE_SIZE + TLV_LEN_SIZE)
+			return -EAGAIN;
+		QMI_ENCDEC_DECODE_TLV(&tlv_type, &tlv_len, buf_src);
+		buf_src++;
+		if (tlv_len > end - buf_src)
+			return -EAGAIN;
+
+		if (prog->tlv_map[tlv_type] == QMI_PROG_NO_TLV) {
+			if (tlv_type < OPTIONAL_TLV_TYPE_START)
+				return -EAGAIN;
+			buf_src += tlv_len;
+			continue;
+		}
+
+		tlv = &prog->tlvs[prog->tlv_map[tlv_type]];
+		if (tlv_len != tlv->len)
+			return -EAGAIN;
+		if (tlv->opt)
+			out_c_struct[tlv->flag_offset] = 1;
+
+		run = &prog->runs[tlv->first_run];
+		for (j = 0; j < tlv->nruns; j++, run++) {
+			memcpy(out_c_struct + run->offset, buf_src, run->len);
+			buf_src += run->len;
+		}
+	}
+
+	return in_buf_len;
+}
+
+static int qmi_prog_module_notify(struct notifier_block *nb,
+				  unsigned long action, void *data)
+{
+	struct module *mod = data;
+	struct qmi_prog *prog;
+	struct hlist_node *tmp;
+	unsigned long flags;
+	int bkt;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&qmi_prog_lock, flags);
+	hash_for_each_safe(qmi_prog_table, bkt, tmp, prog, node) {
+		if (within_module((unsigned long)prog->ei_array, mod)) {
+			hash_del_rcu(&prog->node);
+			kfree_rcu(prog, rcu);
+		}
+	}
+	spin_unlock_irqrestore(&qmi_prog_lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block qmi_prog_module_nb = {
+	.notifier_call = qmi_prog_module_notify,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static int qmi_prog_stats_show(struct seq_file *s, void *unused)
+{
+	struct qmi_prog *prog;
+	int bkt;
+
+	seq_puts(s, "msg_id  tlvs  enc  enc_cycles  dec  dec_cycles  dec_slow\n");
+	rcu_read_lock();
+	hash_for_each_rcu(qmi_prog_table, bkt, prog, node)
+		seq_printf(s, "0x%04x  %4d  %llu  %llu  %llu  %llu  %llu\n",
+			   prog->msg_id, prog->ntlvs,
+			   prog->enc_cnt, prog->enc_cnt ?
+			   div64_u64(prog->enc_cycles, prog->enc_cnt) : 0,
+			   prog->dec_cnt, prog->dec_cnt ?
+			   div64_u64(prog->dec_cycles, prog->dec_cnt) : 0,
+			   prog->dec_slow);
+	rcu_read_unlock();
+	return 0;
+}
+
+static int qmi_prog_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qmi_prog_stats_show, NULL);
+}
+
+static const struct file_operations qmi_prog_stats_fops = {
+	.open = qmi_prog_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qmi_prog_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("qmi_encdec", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return;
+	debugfs_create_file("msg_stats", 0444, dir, NULL,
+			    &qmi_prog_stats_fops);
+}
+#else
+static inline void qmi_prog_debugfs_init(void) { }
+#endif
+
+static int __init qmi_encdec_init(void)
+{
+	qmi_prog_debugfs_init();
+	return register_module_notifier(&qmi_prog_module_nb);
+}
+late_initcall(qmi_encdec_init);
+
 /**
  * qmi_kernel_encode() - Encode to QMI message wire format
  * @desc: Pointer to structure descriptor.
@@ -231,6 +650,8 @@ int qmi_kernel_encode(struct msg_desc *desc,
 {
 	int enc_level = 1;
 	int ret, calc_max_msg_len, calc_min_msg_len;
+	struct qmi_prog *prog;
+	cycles_t start;
 
 	if (!desc)
 		return -EINVAL;
@@ -257,8 +678,21 @@ int qmi_kernel_encode(struct msg_desc *desc,
 	if (desc->max_msg_len < out_buf_len)
 		return -ETOOSMALL;
 
-	ret = _qmi_kernel_encode(desc->ei_array, out_buf,
-				 in_c_struct, out_buf_len, enc_level);
+	start = get_cycles();
+	rcu_read_lock();
+	prog = qmi_prog_get(desc);
+	if (prog && prog->ntlvs && fast_path)
+		ret = qmi_prog_encode(prog, out_buf, in_c_struct,
+				      out_buf_len);
+	else
+		ret = _qmi_kernel_encode(desc->ei_array, out_buf,
+					 in_c_struct, out_buf_len, enc_level);
+	if (prog) {
+		prog->enc_cnt++;
+		prog->enc_cycles += get_cycles() - start;
+	}
+	rcu_read_unlock();
+
 	if (ret == -ETOOSMALL) {
 		calc_max_msg_len = qmi_calc_max_msg_len(desc->ei_array, 1);
 		pr_err("%s: Calc. len %d != Out buf len %d\n",
@@ -579,7 +1013,9 @@ int qmi_kernel_decode(struct msg_desc *desc, void *out_c_struct,
 		      void *in_buf, uint32_t in_buf_len)
 {
 	int dec_level = 1;
-	int rc = 0;
+	int rc = -EAGAIN;
+	struct qmi_prog *prog;
+	cycles_t start;
 
 	if (!desc || !desc->ei_array)
 		return -EINVAL;
@@ -590,8 +1026,23 @@ int qmi_kernel_decode(struct msg_desc *desc, void *out_c_struct,
 	if (desc->max_msg_len < in_buf_len)
 		return -EINVAL;
 
-	rc = _qmi_kernel_decode(desc->ei_array, out_c_struct,
-				in_buf, in_buf_len, dec_level);
+	start = get_cycles();
+	rcu_read_lock();
+	prog = qmi_prog_get(desc);
+	if (prog && prog->ntlvs && fast_path)
+		rc = qmi_prog_decode(prog, out_c_struct, in_buf, in_buf_len);
+	if (rc == -EAGAIN) {
+		if (prog && prog->ntlvs && fast_path)
+			prog->dec_slow++;
+		rc = _qmi_kernel_decode(desc->ei_array, out_c_struct,
+					in_buf, in_buf_len, dec_level);
+	}
+	if (prog) {
+		prog->dec_cnt++;
+		prog->dec_cycles += get_cycles() - start;
+	}
+	rcu_read_unlock();
+
 	if (rc < 0)
 		return rc;
 	else
@@ -0,0 +1,180 @@
+/*
+ * LZ4 benchmark: times LZ4_decompress_safe() against the generic C
+ * decoder on page sized blocks, and checks both give back the input.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int nr_pages = 256;
+module_param(nr_pages, uint, 0444);
+MODULE_PARM_DESC(nr_pages, "Number of distinct pages to compress");
+
+static unsigned int loops = 16;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Number of passes over all pages per decoder");
+
+struct lz4_page {
+	char *comp;
+	int comp_len;
+};
+
+/*
+ * Something like anonymous memory: runs of zeroes, repeated words and
+ * short strings, and some incompressible bytes.
+ */
+static void test_lz4_fill(u8 *buf, size_t len, struct rnd_state *rnd)
+{
+	static const char * const words[] = {
+		"android", "surfaceflinger", "0x0000ffff", "com.example.app",
+		"\x7f\x45\x4c\x46", "ActivityManager", "null", "binder",
+	};
+	size_t pos = 0;
+
+	while (pos < len) {
+		u32 r = prandom_u32_state(rnd);
+		size_t n = min_t(size_t, len - pos, (r >> 8) % 64 + 1);
+		const char *w;
+
+		switch (r & 3) {
+		case 0:
+			memset(buf + pos, 0, n);
+			break;
+		case 1:
+			w = words[(r >> 16) % ARRAY_SIZE(words)];
+			n = min(n, strlen(w));
+			memcpy(buf + pos, w, n);
+			break;
+		case 2:
+			memset(buf + pos, r >> 24, n);
+			break;
+		default:
+			n = min_t(size_t, n, 8);
+			prandom_bytes_state(rnd, buf + pos, n);
+			break;
+		}
+		pos += n;
+	}
+}
+
+static u64 test_lz4_run(const char *name, struct lz4_page *pages,
+			const u8 *orig, u8 *out,
+			int (*decompress)(const char *, char *, int, int))
+{
+	ktime_t start;
+	u64 ns, bytes;
+	unsigned int i, l;
+	int ret;
+
+	start = ktime_get();
+	for (l = 0; l < loops; l++) {
+		for (i = 0; i < nr_pages; i++) {
+			ret = decompress(pages[i].comp, out, pages[i].comp_len,
+					 PAGE_SIZE);
+			if (ret != PAGE_SIZE ||
+			    memcmp(out, orig + i * PAGE_SIZE, PAGE_SIZE)) {
+				pr_err("%s: page %u decoded wrong, ret %d\n",
+				       name, i, ret);
+				return 0;
+			}
+		}
+		cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	bytes = (u64)loops * nr_pages * PAGE_SIZE;
+
+	pr_info("%-8s %6llu ns/page %6llu MB/s\n", name,
+		div64_u64(ns, (u64)loops * nr_pages),
+		ns ? div64_u64(bytes * 1000, ns) : 0);
+	return ns;
+}
+
+static int __init test_lz4_init(void)
+{
+	struct lz4_page *pages;
+	struct rnd_state rnd;
+	u8 *orig, *out;
+	void *wrkmem;
+	u64 comp_bytes = 0, ns, generic_ns, default_ns;
+	unsigned int i;
+	ktime_t start;
+	int ret = -ENOMEM;
+
+	if (!nr_pages || !loops)
+		return -EINVAL;
+
+	orig = vmalloc(nr_pages * PAGE_SIZE);
+	out = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	wrkmem = kmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	pages = kcalloc(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!orig || !out || !wrkmem || !pages)
+		goto out;
+
+	prandom_seed_state(&rnd, 4);
+	test_lz4_fill(orig, nr_pages * PAGE_SIZE, &rnd);
+
+	start = ktime_get();
+	for (i = 0; i < nr_pages; i++) {
+		pages[i].comp = kmalloc(LZ4_COMPRESSBOUND(PAGE_SIZE),
+					GFP_KERNEL);
+		if (!pages[i].comp)
+			goto out;
+		pages[i].comp_len = LZ4_compress_default(
+			(const char *)orig + i * PAGE_SIZE, pages[i].comp,
+			PAGE_SIZE, LZ4_COMPRESSBOUND(PAGE_SIZE), wrkmem);
+		if (pages[i].comp_len <= 0) {
+			pr_err("failed to compress page %u\n", i);
+			ret = -EINVAL;
+			goto out;
+		}
+		comp_bytes += pages[i].comp_len;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	pr_info("compress %6llu ns/page, ratio %llu%%\n",
+		div64_u64(ns, nr_pages),
+		div64_u64(comp_bytes * 100, (u64)nr_pages * PAGE_SIZE));
+
+	ret = -EINVAL;
+	generic_ns = test_lz4_run("generic", pages, orig, out,
+				  LZ4_decompress_safe_generic);
+	default_ns = test_lz4_run("default", pages, orig, out,
+				  LZ4_decompress_safe);
+	if (!generic_ns || !default_ns)
+		goto out;
+
+	pr_info("default decoder takes %llu%% of the generic time\n",
+		div64_u64(default_ns * 100, generic_ns));
+	ret = 0;
+out:
+	if (pages)
+		for (i = 0; i < nr_pages; i++)
+			kfree(pages[i].comp);
+	kfree(pages);
+	kfree(wrkmem);
+	kfree(out);
+	vfree(orig);
+	return ret;
+}
+
+static void __exit test_lz4_exit(void)
+{
+}
+
+module_init(test_lz4_init);
+module_exit(test_lz4_exit);
+
+MODULE_DESCRIPTION("LZ4 decompression benchmark");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,134 @@
+/*
+ * memcpy benchmark: times memcpy(), copy_to_user() and copy_from_user()
+ * over a range of sizes, to compare the architecture's copy loops.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define TEST_MEMCPY_MAX		(1024 * 1024)
+
+static unsigned int total_mb = 256;
+module_param(total_mb, uint, 0444);
+MODULE_PARM_DESC(total_mb, "Megabytes copied for each size and copy type");
+
+static const size_t test_memcpy_sizes[] = {
+	64, 256, 1024, 4096, 16384, 65536, 262144, TEST_MEMCPY_MAX,
+};
+
+enum test_memcpy_type {
+	TEST_MEMCPY,
+	TEST_COPY_TO_USER,
+	TEST_COPY_FROM_USER,
+	TEST_MEMCPY_NR_TYPES,
+};
+
+static const char * const test_memcpy_names[] = {
+	[TEST_MEMCPY]		= "memcpy",
+	[TEST_COPY_TO_USER]	= "copy_to_user",
+	[TEST_COPY_FROM_USER]	= "copy_from_user",
+};
+
+static int test_memcpy_run(enum test_memcpy_type type, size_t size,
+			   char *kbuf, char __user *ubuf)
+{
+	size_t span = 2 * TEST_MEMCPY_MAX - size;
+	unsigned long iters, i, left = 0;
+	size_t off = 0;
+	ktime_t start;
+	u64 ns;
+
+	iters = max_t(unsigned long, (u64)total_mb * SZ_1M / size, 1);
+
+	start = ktime_get();
+	for (i = 0; i < iters; i++) {
+		/* walk the buffers so the large sizes do not just hit L2 */
+		switch (type) {
+		case TEST_MEMCPY:
+			memcpy(kbuf + 2 * TEST_MEMCPY_MAX + off, kbuf + off,
+			       size);
+			break;
+		case TEST_COPY_TO_USER:
+			left |= copy_to_user(ubuf + off, kbuf + off, size);
+			break;
+		default:
+			left |= copy_from_user(kbuf + off, ubuf + off, size);
+			break;
+		}
+		off += size;
+		if (off > span)
+			off = 0;
+		if (!(i & 1023))
+			cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (left) {
+		pr_err("%s: %zu byte copies faulted\n",
+		       test_memcpy_names[type], size);
+		return -EFAULT;
+	}
+
+	pr_info("%-14s %7zu bytes %8llu ns/copy %6llu MB/s\n",
+		test_memcpy_names[type], size, div64_u64(ns, iters),
+		ns ? div64_u64((u64)iters * size * 1000, ns) : 0);
+	return 0;
+}
+
+static int __init test_memcpy_init(void)
+{
+	unsigned long user_addr;
+	char *kbuf;
+	int type, i, ret = 0;
+
+	if (!total_mb)
+		return -EINVAL;
+
+	/* source and destination halves for memcpy */
+	kbuf = vmalloc(4 * TEST_MEMCPY_MAX);
+	if (!kbuf)
+		return -ENOMEM;
+	memset(kbuf, 0x5a, 4 * TEST_MEMCPY_MAX);
+
+	user_addr = vm_mmap(NULL, 0, 2 * TEST_MEMCPY_MAX,
+			    PROT_READ | PROT_WRITE,
+			    MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (user_addr >= (unsigned long)(TASK_SIZE)) {
+		pr_warn("failed to allocate user memory\n");
+		vfree(kbuf);
+		return -ENOMEM;
+	}
+
+	for (type = 0; type < TEST_MEMCPY_NR_TYPES && !ret; type++)
+		for (i = 0; i < ARRAY_SIZE(test_memcpy_sizes) && !ret; i++)
+			ret = test_memcpy_run(type, test_memcpy_sizes[i], kbuf,
+					      (char __user *)user_addr);
+
+	vm_munmap(user_addr, 2 * TEST_MEMCPY_MAX);
+	vfree(kbuf);
+	return ret;
+}
+
+static void __exit test_memcpy_exit(void)
+{
+}
+
+module_init(test_memcpy_init);
+module_exit(test_memcpy_exit);
+
+MODULE_DESCRIPTION("memcpy and user copy benchmark");
+MODULE_LICENSE("GPL v2");
@@ -210,6 +210,35 @@ static ssize_t max_ratio_store(struct device *dev,
 }
 BDI_SHOW(max_ratio, bdi->max_ratio)
 
+static ssize_t read_ahead_adaptive_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	bool enable;
+	ssize_t ret;
+
+	ret = kstrtobool(buf, &enable);
+	if (ret < 0)
+		return ret;
+
+	bdi->ra_adaptive = enable;
+
+	return count;
+}
+BDI_SHOW(read_ahead_adaptive, bdi->ra_adaptive)
+
+static ssize_t read_ahead_stat_show(struct device *dev,
+				    struct device_attribute *attr,
+				    char *page)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+
+	return snprintf(page, PAGE_SIZE-1, "read_kb %ld\nwasted_kb %ld\n",
+			K(atomic_long_read(&bdi->ra_read)),
+			K(atomic_long_read(&bdi->ra_wasted)));
+}
+static DEVICE_ATTR_RO(read_ahead_stat);
+
 static ssize_t stable_pages_required_show(struct device *dev,
 					  struct device_attribute *attr,
 					  char *page)
@@ -226,6 +255,8 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_min_ratio.attr,
 	&dev_attr_max_ratio.attr,
 	&dev_attr_stable_pages_required.attr,
+	&dev_attr_read_ahead_adaptive.attr,
+	&dev_attr_read_ahead_stat.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(bdi_dev);
@@ -36,6 +36,8 @@
 #include <linux/highmem.h>
 #include <linux/io.h>
 #include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 #include <trace/events/cma.h>
 
 #include "cma.h"
@@ -89,9 +91,88 @@ static void cma_clear_bitmap(struct cma *cma, unsigned long pfn,
 
 	mutex_lock(&cma->lock);
 	bitmap_clear(cma->bitmap, bitmap_no, bitmap_count);
+	if (bitmap_no < cma->free_hint)
+		cma->free_hint = bitmap_no;
 	mutex_unlock(&cma->lock);
 }
 
+/*
+ * Large ranges are isolated and migrated in pieces by several workers at
+ * once. Each piece is aligned to MAX_ORDER and pageblock boundaries so
+ * that alloc_contig_range() never has to touch a neighbour's pageblocks.
+ */
+#define CMA_MAX_MIGRATE_WORKERS	8
+
+struct cma_migrate_work {
+	struct work_struct work;
+	unsigned long start;
+	unsigned long end;
+	int ret;
+};
+
+static void cma_migrate_workfn(struct work_struct *work)
+{
+	struct cma_migrate_work *mw;
+
+	mw = container_of(work, struct cma_migrate_work, work);
+	mw->ret = alloc_contig_range(mw->start, mw->end, MIGRATE_CMA);
+}
+
+/*
+ * Called with cma_mutex held, so no other CMA allocation competes with
+ * the workers for the same pageblocks.
+ */
+static int cma_migrate_range(unsigned long pfn, unsigned long count)
+{
+	unsigned long align = max_t(unsigned long, MAX_ORDER_NR_PAGES,
+				    pageblock_nr_pages);
+	unsigned long end = pfn + count, piece, start;
+	struct cma_migrate_work *works;
+	int nr, i, ret = 0;
+
+	nr = min_t(int, num_online_cpus(), CMA_MAX_MIGRATE_WORKERS);
+	nr = min_t(unsigned long, nr, count / align);
+	if (nr < 2)
+		return alloc_contig_range(pfn, end, MIGRATE_CMA);
+
+	works = kcalloc(nr, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return alloc_contig_range(pfn, end, MIGRATE_CMA);
+
+	piece = ALIGN(DIV_ROUND_UP(count, nr), align);
+	start = pfn;
+	for (i = 0; i < nr; i++) {
+		works[i].start = start;
+		works[i].end = min(ALIGN(pfn + (i + 1) * piece, align), end);
+		if (works[i].end <= works[i].start)
+			works[i].end = works[i].start;
+		start = works[i].end;
+		INIT_WORK(&works[i].work, cma_migrate_workfn);
+		if (i && works[i].end > works[i].start)
+			queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	cma_migrate_workfn(&works[0].work);
+	for (i = 1; i < nr; i++)
+		flush_work(&works[i].work);
+
+	for (i = 0; i < nr; i++) {
+		if (works[i].ret) {
+			ret = works[i].ret;
+			break;
+		}
+	}
+	if (ret) {
+		for (i = 0; i < nr; i++)
+			if (!works[i].ret && works[i].end > works[i].start)
+				free_contig_range(works[i].start,
+					works[i].end - works[i].start);
+	}
+
+	kfree(works);
+	return ret;
+}
+
 static int __init cma_activate_area(struct cma *cma)
 {
 	int bitmap_size = BITS_TO_LONGS(cma_bitmap_maxno(cma)) * sizeof(long);
@@ -387,7 +468,9 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 	unsigned long pfn = -1;
 	unsigned long start = 0;
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
+	unsigned long busy_retries = 0;
 	struct page *page = NULL;
+	u64 alloc_start;
 	int ret;
 	int retry_after_sleep = 0;
 
@@ -410,8 +493,11 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 	if (bitmap_count > bitmap_maxno)
 		return NULL;
 
+	alloc_start = local_clock();
 	for (;;) {
 		mutex_lock(&cma->lock);
+		/* Everything below the hint is known to be in use */
+		start = max(start, cma->free_hint);
 		bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
 				bitmap_maxno, start, bitmap_count, mask,
 				offset);
@@ -436,6 +522,9 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 			}
 		}
 		bitmap_set(cma->bitmap, bitmap_no, bitmap_count);
+		if (bitmap_no <= cma->free_hint)
+			cma->free_hint = find_next_zero_bit(cma->bitmap,
+					bitmap_maxno, cma->free_hint);
 		/*
 		 * It's safe to drop the lock here. We've marked this region for
 		 * our exclusive use. If the migration fails we will take the
@@ -445,7 +534,7 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
 		mutex_lock(&cma_mutex);
-		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
+		ret = cma_migrate_range(pfn, count);
 		mutex_unlock(&cma_mutex);
 		if (ret == 0) {
 			page = pfn_to_page(pfn);
@@ -460,10 +549,13 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align)
 			 __func__, pfn_to_page(pfn));
 
 		trace_cma_alloc_busy_retry(pfn, pfn_to_page(pfn), count, align);
+		busy_retries++;
 		/* try again with a bit different memory target */
 		start = bitmap_no + mask + 1;
 	}
 
+	cma_account_alloc(cma, page != NULL, busy_retries,
+			  local_clock() - alloc_start);
 	trace_cma_alloc(pfn, page, count, align);
 
 	pr_debug("%s(): returned %p\n", __func__, page);
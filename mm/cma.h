@@ -7,9 +7,18 @@ struct cma {
 	unsigned long   *bitmap;
 	unsigned int order_per_bit; /* Order of pages represented by one bit */
 	struct mutex    lock;
+	/* No bit below this one is clear, searches may start here */
+	unsigned long	free_hint;
 #ifdef CONFIG_CMA_DEBUGFS
 	struct hlist_head mem_head;
 	spinlock_t mem_head_lock;
+	/* Allocation statistics, protected by @lock */
+	unsigned long	nr_alloc_success;
+	unsigned long	nr_alloc_fail;
+	unsigned long	nr_busy_retry;
+	unsigned long	alloc_us_total;
+	unsigned long	alloc_us_max;
+	unsigned long	alloc_us_last;
 #endif
 };
 
@@ -21,4 +30,29 @@ static inline unsigned long cma_bitmap_maxno(struct cma *cma)
 	return cma->count >> cma->order_per_bit;
 }
 
+#ifdef CONFIG_CMA_DEBUGFS
+static inline void cma_account_alloc(struct cma *cma, bool success,
+				     unsigned long retries, u64 ns)
+{
+	unsigned long us = div_u64(ns, NSEC_PER_USEC);
+
+	mutex_lock(&cma->lock);
+	if (success)
+		cma->nr_alloc_success++;
+	else
+		cma->nr_alloc_fail++;
+	cma->nr_busy_retry += retries;
+	cma->alloc_us_total += us;
+	cma->alloc_us_last = us;
+	if (us > cma->alloc_us_max)
+		cma->alloc_us_max = us;
+	mutex_unlock(&cma->lock);
+}
+#else
+static inline void cma_account_alloc(struct cma *cma, bool success,
+				     unsigned long retries, u64 ns)
+{
+}
+#endif
+
 #endif
@@ -185,6 +185,18 @@ static void cma_debugfs_add_one(struct cma *cma, int idx)
 				&cma->order_per_bit, &cma_debugfs_fops);
 	debugfs_create_file("used", S_IRUGO, tmp, cma, &cma_used_fops);
 	debugfs_create_file("maxchunk", S_IRUGO, tmp, cma, &cma_maxchunk_fops);
+	debugfs_create_file("alloc_success", S_IRUGO, tmp,
+				&cma->nr_alloc_success, &cma_debugfs_fops);
+	debugfs_create_file("alloc_fail", S_IRUGO, tmp,
+				&cma->nr_alloc_fail, &cma_debugfs_fops);
+	debugfs_create_file("alloc_busy_retry", S_IRUGO, tmp,
+				&cma->nr_busy_retry, &cma_debugfs_fops);
+	debugfs_create_file("alloc_us_total", S_IRUGO, tmp,
+				&cma->alloc_us_total, &cma_debugfs_fops);
+	debugfs_create_file("alloc_us_max", S_IRUGO, tmp,
+				&cma->alloc_us_max, &cma_debugfs_fops);
+	debugfs_create_file("alloc_us_last", S_IRUGO, tmp,
+				&cma->alloc_us_last, &cma_debugfs_fops);
 
 	u32s = DIV_ROUND_UP(cma_bitmap_maxno(cma), BITS_PER_BYTE * sizeof(u32));
 	debugfs_create_u32_array("bitmap", S_IRUGO, tmp, (u32*)cma->bitmap, u32s);
@@ -1280,6 +1280,37 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return cc->nr_migratepages ? ISOLATE_SUCCESS : ISOLATE_NONE;
 }
 
+/*
+ * Proactive compaction: while the system is idle, kcompactd compacts every
+ * zone whose extfrag_for_order() for sysctl_compaction_proactive_order is
+ * above sysctl_compaction_proactive_score, until it drops by a quarter below
+ * the score again. A score of 0 disables it.
+ */
+int sysctl_compaction_proactive_score __read_mostly;
+int sysctl_compaction_proactive_order __read_mostly = 4;
+
+/* Bumped on sysctl writes so that a sleeping kcompactd re-reads them */
+static unsigned int proactive_gen;
+
+#define PROACTIVE_INTERVAL_MSEC	500
+#define PROACTIVE_MAX_BACKOFF	4
+
+static inline int proactive_low_score(int score)
+{
+	return score - score / 4;
+}
+
+/*
+ * Proactive compaction must not compete with real work: back off while
+ * more than half of the online CPUs have something to run.
+ */
+static bool proactive_cpu_busy(void)
+{
+	return nr_running() > max(1U, num_online_cpus() / 2);
+}
+
+static inline bool kcompactd_work_requested(pg_data_t *pgdat);
+
 /*
  * order == -1 is expected when compacting via
  * /proc/sys/vm/compact_memory
@@ -1315,6 +1346,20 @@ static int __compact_finished(struct zone *zone, struct compact_control *cc,
 		return COMPACT_COMPLETE;
 	}
 
+	if (cc->proactive_compaction) {
+		int score = READ_ONCE(sysctl_compaction_proactive_score);
+
+		if (extfrag_for_order(zone,
+			READ_ONCE(sysctl_compaction_proactive_order)) <=
+		    proactive_low_score(score))
+			return COMPACT_PARTIAL;
+
+		/* Let reactive work or other tasks have the CPU */
+		if (kcompactd_work_requested(zone->zone_pgdat) ||
+		    proactive_cpu_busy())
+			return COMPACT_PARTIAL;
+	}
+
 	if (is_via_compact_memory(cc->order))
 		return COMPACT_CONTINUE;
 
@@ -1820,6 +1865,23 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+int sysctl_compaction_proactive_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	pg_data_t *pgdat;
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!write || ret)
+		return ret;
+
+	WRITE_ONCE(proactive_gen, proactive_gen + 1);
+	for_each_online_pgdat(pgdat)
+		wake_up_interruptible(&pgdat->kcompactd_wait);
+
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 static ssize_t sysfs_compact_node(struct device *dev,
 			struct device_attribute *attr,
@@ -1946,6 +2008,66 @@ static void kcompactd_do_work(pg_data_t *pgdat)
 		pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
 }
 
+/*
+ * Compact the zones of @pgdat that are above the proactive score. Returns
+ * true if fragmentation was reduced, so that the caller can back off when
+ * compaction stops making progress.
+ */
+static bool kcompactd_do_proactive_work(pg_data_t *pgdat)
+{
+	int score = READ_ONCE(sysctl_compaction_proactive_score);
+	unsigned int order = READ_ONCE(sysctl_compaction_proactive_order);
+	bool progress = false;
+	int zoneid;
+
+	if (!score)
+		return false;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.order = -1,
+			.mode = MIGRATE_SYNC_LIGHT,
+			.ignore_skip_hint = true,
+			.proactive_compaction = true,
+			.classzone_idx = zoneid,
+		};
+		unsigned int before, after;
+
+		if (!populated_zone(zone))
+			continue;
+
+		before = extfrag_for_order(zone, order);
+		if (before <= score)
+			continue;
+
+		if (proactive_cpu_busy()) {
+			count_vm_event(COMPACT_PROACTIVE_THROTTLED);
+			return false;
+		}
+
+		if (kthread_should_stop())
+			return false;
+
+		count_vm_event(COMPACT_PROACTIVE_RUN);
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		after = extfrag_for_order(zone, order);
+		if (after < before)
+			progress = true;
+		if (after <= score)
+			count_vm_event(COMPACT_PROACTIVE_SUCCESS);
+	}
+
+	return progress;
+}
+
 void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
 {
 	if (!order)
@@ -1976,6 +2098,7 @@ static int kcompactd(void *p)
 {
 	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
+	unsigned int backoff = 0;
 
 	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
 
@@ -1988,11 +2111,28 @@ static int kcompactd(void *p)
 	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
 
 	while (!kthread_should_stop()) {
+		unsigned int gen = READ_ONCE(proactive_gen);
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (READ_ONCE(sysctl_compaction_proactive_score))
+			timeout = msecs_to_jiffies(PROACTIVE_INTERVAL_MSEC)
+								<< backoff;
+
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
-		wait_event_freezable(pgdat->kcompactd_wait,
-				kcompactd_work_requested(pgdat));
+		if (!wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat) ||
+				READ_ONCE(proactive_gen) != gen, timeout)) {
+			if (kcompactd_do_proactive_work(pgdat))
+				backoff = 0;
+			else if (backoff < PROACTIVE_MAX_BACKOFF)
+				backoff++;
+			continue;
+		}
 
-		kcompactd_do_work(pgdat);
+		if (READ_ONCE(proactive_gen) != gen)
+			backoff = 0;
+		if (kcompactd_work_requested(pgdat))
+			kcompactd_do_work(pgdat);
 	}
 
 	return 0;
@@ -34,6 +34,8 @@
 #include <linux/memcontrol.h>
 #include <linux/cleancache.h>
 #include <linux/rmap.h>
+#include <linux/delayacct.h>
+#include <linux/launch_prefetch.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -701,7 +703,7 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 		 * recently, in which case it should be activated like
 		 * any other repeatedly accessed page.
 		 */
-		if (shadow && workingset_refault(shadow)) {
+		if (shadow && workingset_refault(page, shadow)) {
 			SetPageActive(page);
 			workingset_activation(page);
 		} else
@@ -751,25 +753,39 @@ wait_queue_head_t *page_waitqueue(struct page *page)
 }
 EXPORT_SYMBOL(page_waitqueue);
 
+/* Classifies a page wait for delay accounting */
+static inline int page_wait_kind(int bit_nr)
+{
+	return bit_nr == PG_writeback ? TASKSTATS_IO_WRITE : TASKSTATS_IO_READ;
+}
+
 void wait_on_page_bit(struct page *page, int bit_nr)
 {
 	DEFINE_WAIT_BIT(wait, &page->flags, bit_nr);
 
-	if (test_bit(bit_nr, &page->flags))
+	if (test_bit(bit_nr, &page->flags)) {
+		delayacct_io_wait_start();
 		__wait_on_bit(page_waitqueue(page), &wait, bit_wait_io,
 							TASK_UNINTERRUPTIBLE);
+		delayacct_io_wait_end(page_wait_kind(bit_nr));
+	}
 }
 EXPORT_SYMBOL(wait_on_page_bit);
 
 int wait_on_page_bit_killable(struct page *page, int bit_nr)
 {
 	DEFINE_WAIT_BIT(wait, &page->flags, bit_nr);
+	int ret;
 
 	if (!test_bit(bit_nr, &page->flags))
 		return 0;
 
-	return __wait_on_bit(page_waitqueue(page), &wait,
-			     bit_wait_io, TASK_KILLABLE);
+	delayacct_io_wait_start();
+	ret = __wait_on_bit(page_waitqueue(page), &wait,
+			    bit_wait_io, TASK_KILLABLE);
+	delayacct_io_wait_end(page_wait_kind(bit_nr));
+
+	return ret;
 }
 
 int wait_on_page_bit_killable_timeout(struct page *page,
@@ -897,9 +913,15 @@ int __lock_page_killable(struct page *page)
 {
 	struct page *page_head = compound_head(page);
 	DEFINE_WAIT_BIT(wait, &page_head->flags, PG_locked);
+	int ret;
 
-	return __wait_on_bit_lock(page_waitqueue(page_head), &wait,
+	/* the read path waits here for the page to be read in */
+	delayacct_io_wait_start();
+	ret = __wait_on_bit_lock(page_waitqueue(page_head), &wait,
 					bit_wait_io, TASK_KILLABLE);
+	delayacct_io_wait_end(TASKSTATS_IO_READ);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(__lock_page_killable);
 
@@ -1594,6 +1616,7 @@ find_page:
 			if (unlikely(page == NULL))
 				goto no_cached_page;
 		}
+		ra_note_hit(ra, index);
 		if (PageReadahead(page)) {
 			page_cache_async_readahead(mapping,
 					ra, filp, page,
@@ -1917,9 +1940,10 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	/*
 	 * mmap read-around
 	 */
-	ra->start = max_t(long, 0, offset - ra->ra_pages / 2);
-	ra->size = ra->ra_pages;
-	ra->async_size = ra->ra_pages / 4;
+	ra_retire_window(mapping, ra);
+	ra->size = ra_adapt_max(mapping, ra, ra->ra_pages);
+	ra->start = max_t(long, 0, offset - ra->size / 2);
+	ra->async_size = ra->size / 4;
 	ra_submit(ra, mapping, file);
 }
 
@@ -1994,9 +2018,11 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		 * We found the page, so try async readahead before
 		 * waiting for the lock.
 		 */
+		ra_note_hit(ra, offset);
 		do_async_mmap_readahead(vma, ra, file, page, offset);
 	} else if (!page) {
 		/* No page in the page cache at all */
+		launch_prefetch_fault(vma, offset);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -2146,6 +2172,7 @@ repeat:
 
 		if (file->f_ra.mmap_miss > 0)
 			file->f_ra.mmap_miss--;
+		ra_note_hit(&file->f_ra, page->index);
 		addr = address + (page->index - vmf->pgoff) * PAGE_SIZE;
 		do_set_pte(vma, addr, page, pte, false, false);
 		unlock_page(page);
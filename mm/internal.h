@@ -49,11 +49,21 @@ extern int __do_page_cache_readahead(struct address_space *mapping,
 /*
  * Submit IO for the read-ahead request in file_ra_state.
  */
+void ra_account_window(struct address_space *mapping,
+		struct file_ra_state *ra, int nr_read);
+void ra_retire_window(struct address_space *mapping,
+		struct file_ra_state *ra);
+unsigned long ra_adapt_max(struct address_space *mapping,
+		struct file_ra_state *ra, unsigned long max);
+
 static inline unsigned long ra_submit(struct file_ra_state *ra,
 		struct address_space *mapping, struct file *filp)
 {
-	return __do_page_cache_readahead(mapping, filp,
+	int nr_read = __do_page_cache_readahead(mapping, filp,
 					ra->start, ra->size, ra->async_size);
+
+	ra_account_window(mapping, ra, nr_read);
+	return nr_read;
 }
 
 /*
@@ -234,6 +244,7 @@ struct compact_control {
 	enum migrate_mode mode;		/* Async or sync migration mode */
 	bool ignore_skip_hint;		/* Scan blocks even if marked skip */
 	bool direct_compaction;		/* False from kcompactd or /proc/... */
+	bool proactive_compaction;	/* kcompactd keeping extfrag low */
 	int order;			/* order a direct compactor needs */
 	const gfp_t gfp_mask;		/* gfp mask of a direct compactor */
 	const int alloc_flags;		/* alloc flags of a direct compactor */
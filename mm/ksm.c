@@ -23,7 +23,7 @@
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
 #include <linux/spinlock.h>
-#include <linux/jhash.h>
+#include <linux/xxhash.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
@@ -155,6 +155,7 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @oldsample: previous checksum of a few cachelines of that page
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -170,6 +171,7 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned int oldsample;		/* when unstable */
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -227,6 +229,18 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
+/*
+ * When non-zero, ksmd scans for up to this percentage of one CPU instead of
+ * ksm_thread_pages_to_scan pages per batch.
+ */
+static unsigned int ksm_max_cpu_percent;
+
+/* Pages found volatile by the sampled checksum alone */
+static unsigned long ksm_sample_rejects;
+
+/* Pages whose full checksum was calculated */
+static unsigned long ksm_full_checksums;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -851,11 +865,35 @@ static u32 calc_checksum(struct page *page)
 {
 	u32 checksum;
 	void *addr = kmap_atomic(page);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+#if BITS_PER_LONG == 64
+	checksum = xxh64(addr, PAGE_SIZE, 0);
+#else
+	checksum = xxh32(addr, PAGE_SIZE, 0);
+#endif
 	kunmap_atomic(addr);
 	return checksum;
 }
 
+#define KSM_SAMPLE_LINES	4
+
+/*
+ * Checksum of KSM_SAMPLE_LINES cachelines spread over the page: pages that
+ * are written to between two scans almost always change one of them, and
+ * this is a lot cheaper than calc_checksum().
+ */
+static u32 calc_sample(struct page *page)
+{
+	u32 sample = 0;
+	char *addr = kmap_atomic(page);
+	int i;
+
+	for (i = 0; i < KSM_SAMPLE_LINES; i++)
+		sample = xxh32(addr + i * (PAGE_SIZE / KSM_SAMPLE_LINES) +
+			       i * L1_CACHE_BYTES, L1_CACHE_BYTES, sample);
+	kunmap_atomic(addr);
+	return sample;
+}
+
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
 	char *addr1, *addr2;
@@ -1504,12 +1542,27 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * we calculated it, this page is changing frequently: therefore we
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
+	 *
+	 * Check a sample of the page first, and only hash all of it when
+	 * the sample did not change. The full checksum of a page whose
+	 * sample just became stable is not known yet, so it is accepted
+	 * on the sample alone.
 	 */
+	checksum = calc_sample(page);
+	if (rmap_item->oldsample != checksum) {
+		rmap_item->oldsample = checksum;
+		rmap_item->oldchecksum = 0;
+		ksm_sample_rejects++;
+		return;
+	}
+
 	checksum = calc_checksum(page);
-	if (rmap_item->oldchecksum != checksum) {
+	ksm_full_checksums++;
+	if (rmap_item->oldchecksum && rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
 	}
+	rmap_item->oldchecksum = checksum;
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1757,8 +1810,10 @@ next_mm:
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
+ *
+ * Returns false if there was nothing left to scan.
  */
-static void ksm_do_scan(unsigned int scan_npages)
+static bool ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
@@ -1767,10 +1822,31 @@ static void ksm_do_scan(unsigned int scan_npages)
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			return false;
 		cmp_and_merge_page(page, rmap_item);
 		put_page(page);
 	}
+	return true;
+}
+
+#define KSM_BUDGET_BATCH	32
+
+/*
+ * Scan for as long as ksm_max_cpu_percent allows, given that ksmd then
+ * sleeps for ksm_thread_sleep_millisecs. The CPU time is checked every
+ * KSM_BUDGET_BATCH pages.
+ */
+static void ksm_do_scan_budget(unsigned int percent)
+{
+	u64 budget = div_u64((u64)ksm_thread_sleep_millisecs * NSEC_PER_MSEC *
+			     percent, 100 - percent);
+	u64 start = task_sched_runtime(current);
+
+	do {
+		if (!ksm_do_scan(KSM_BUDGET_BATCH))
+			break;
+	} while (task_sched_runtime(current) - start < budget &&
+		 likely(!freezing(current)));
 }
 
 static void process_timeout(unsigned long __data)
@@ -1821,8 +1897,14 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			unsigned int percent = READ_ONCE(ksm_max_cpu_percent);
+
+			if (percent)
+				ksm_do_scan_budget(percent);
+			else
+				ksm_do_scan(ksm_thread_pages_to_scan);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -2237,6 +2319,29 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t max_cpu_percent_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_max_cpu_percent);
+}
+
+static ssize_t max_cpu_percent_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned int percent;
+	int err;
+
+	err = kstrtouint(buf, 10, &percent);
+	if (err || percent > 99)
+		return -EINVAL;
+
+	ksm_max_cpu_percent = percent;
+
+	return count;
+}
+KSM_ATTR(max_cpu_percent);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -2408,15 +2513,32 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t sample_rejects_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_sample_rejects);
+}
+KSM_ATTR_RO(sample_rejects);
+
+static ssize_t full_checksums_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_full_checksums);
+}
+KSM_ATTR_RO(full_checksums);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&max_cpu_percent_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&sample_rejects_attr.attr,
+	&full_checksums_attr.attr,
 	&deferred_timer_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
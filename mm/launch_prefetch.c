@@ -0,0 +1,425 @@
+/*
+ * Record and replay of the page cache misses of an application launch.
+ *
+ * A binary is tagged by writing its path to
+ * /sys/kernel/mm/launch_prefetch/tag. The next time it is exec'ed, the
+ * major page faults on file mappings of the new mm are recorded for
+ * record_ms, as runs of (file, pgoff, nr) so that a launch fits in a
+ * few kilobytes. Every later exec of the binary queues asynchronous
+ * readahead of the recorded runs, under one block plug, so the I/O is
+ * issued ahead of and in larger chunks than the faults that would
+ * otherwise trigger it one at a time.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/kref.h>
+#include <linux/blkdev.h>
+#include <linux/workqueue.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/launch_prefetch.h>
+
+#define LP_MAX_RECORDS	32
+#define LP_MAX_FILES	128
+#define LP_MAX_RUNS	8192
+
+struct lp_run {
+	u32 pgoff;
+	u16 file;
+	u16 nr;
+};
+
+struct launch_record {
+	struct list_head node;
+	struct kref kref;
+	struct inode *inode;		/* the tagged binary */
+
+	spinlock_t lock;		/* protects the fields below */
+	struct mm_struct *rec_mm;	/* mm being recorded */
+	unsigned long rec_start;
+	bool recording;
+	bool ready;
+	struct file *files[LP_MAX_FILES];
+	unsigned int nr_files;
+	struct lp_run *runs;
+	unsigned int nr_runs;
+	unsigned long nr_pages;
+
+	unsigned long replays;
+	struct work_struct replay_work;
+};
+
+static bool enabled;
+static unsigned int record_ms = 10000;
+module_param(record_ms, uint, 0644);
+
+static LIST_HEAD(lp_records);
+static unsigned int lp_nr_records;
+static DEFINE_MUTEX(lp_lock);
+
+static atomic_long_t lp_replays;
+static atomic_long_t lp_pages_prefetched;
+
+static void lp_release(struct kref *kref)
+{
+	struct launch_record *rec = container_of(kref, struct launch_record,
+						 kref);
+	unsigned int i;
+
+	for (i = 0; i < rec->nr_files; i++)
+		fput(rec->files[i]);
+	vfree(rec->runs);
+	iput(rec->inode);
+	kfree(rec);
+}
+
+static void lp_replay_work(struct work_struct *work)
+{
+	struct launch_record *rec = container_of(work, struct launch_record,
+						 replay_work);
+	struct blk_plug plug;
+	unsigned int i;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < rec->nr_runs; i++) {
+		struct lp_run *run = &rec->runs[i];
+		struct file *file = rec->files[run->file];
+
+		force_page_cache_readahead(file->f_mapping, file,
+					   run->pgoff, run->nr);
+		cond_resched();
+	}
+	blk_finish_plug(&plug);
+
+	rec->replays++;
+	atomic_long_inc(&lp_replays);
+	atomic_long_add(rec->nr_pages, &lp_pages_prefetched);
+}
+
+/* Caller holds lp_lock */
+static struct launch_record *lp_find(struct inode *inode)
+{
+	struct launch_record *rec;
+
+	list_for_each_entry(rec, &lp_records, node)
+		if (rec->inode == inode)
+			return rec;
+	return NULL;
+}
+
+static bool lp_record_expired(struct launch_record *rec)
+{
+	return time_after(jiffies, rec->rec_start +
+			  msecs_to_jiffies(READ_ONCE(record_ms)));
+}
+
+/* Caller holds rec->lock */
+static void lp_finish_recording(struct launch_record *rec)
+{
+	rec->recording = false;
+	rec->ready = rec->nr_runs > 0;
+}
+
+void launch_prefetch_exec(struct file *exe)
+{
+	struct launch_record *rec;
+	struct lp_run *runs;
+
+	if (!READ_ONCE(enabled) || !READ_ONCE(lp_nr_records))
+		return;
+
+	mutex_lock(&lp_lock);
+	rec = lp_find(file_inode(exe));
+	if (!rec)
+		goto unlock;
+
+	spin_lock(&rec->lock);
+	if (rec->recording && lp_record_expired(rec))
+		lp_finish_recording(rec);
+	spin_unlock(&rec->lock);
+
+	if (rec->ready) {
+		queue_work(system_unbound_wq, &rec->replay_work);
+		goto unlock;
+	}
+
+	/* Already recording another instance */
+	if (rec->rec_mm)
+		goto unlock;
+
+	runs = vmalloc(LP_MAX_RUNS * sizeof(*runs));
+	if (!runs)
+		goto unlock;
+
+	spin_lock(&rec->lock);
+	rec->runs = runs;
+	rec->rec_mm = current->mm;
+	rec->rec_start = jiffies;
+	rec->recording = true;
+	spin_unlock(&rec->lock);
+
+	kref_get(&rec->kref);
+	current->mm->launch_rec = rec;
+unlock:
+	mutex_unlock(&lp_lock);
+}
+
+static int lp_file_index(struct launch_record *rec, struct file *file)
+{
+	unsigned int i;
+
+	for (i = 0; i < rec->nr_files; i++)
+		if (rec->files[i]->f_mapping == file->f_mapping)
+			return i;
+
+	if (rec->nr_files == LP_MAX_FILES)
+		return -ENOSPC;
+
+	rec->files[rec->nr_files] = get_file(file);
+	return rec->nr_files++;
+}
+
+/*
+ * Called from filemap_fault() when the faulting page is not cached.
+ */
+void launch_prefetch_fault(struct vm_area_struct *vma, pgoff_t pgoff)
+{
+	struct launch_record *rec = vma->vm_mm->launch_rec;
+	struct lp_run *last;
+	int idx;
+
+	if (likely(!rec) || pgoff > U32_MAX)
+		return;
+
+	spin_lock(&rec->lock);
+	if (!rec->recording)
+		goto unlock;
+
+	if (lp_record_expired(rec) || rec->nr_runs == LP_MAX_RUNS) {
+		lp_finish_recording(rec);
+		goto unlock;
+	}
+
+	idx = lp_file_index(rec, vma->vm_file);
+	if (idx < 0)
+		goto unlock;
+
+	last = rec->nr_runs ? &rec->runs[rec->nr_runs - 1] : NULL;
+	if (last && last->file == idx && pgoff == last->pgoff + last->nr &&
+	    last->nr < U16_MAX) {
+		last->nr++;
+	} else {
+		struct lp_run *run = &rec->runs[rec->nr_runs++];
+
+		run->pgoff = pgoff;
+		run->file = idx;
+		run->nr = 1;
+	}
+	rec->nr_pages++;
+unlock:
+	spin_unlock(&rec->lock);
+}
+
+void launch_prefetch_mm_exit(struct mm_struct *mm)
+{
+	struct launch_record *rec = mm->launch_rec;
+
+	if (!rec)
+		return;
+
+	spin_lock(&rec->lock);
+	if (rec->recording)
+		lp_finish_recording(rec);
+	rec->rec_mm = NULL;
+	spin_unlock(&rec->lock);
+
+	mm->launch_rec = NULL;
+	kref_put(&rec->kref, lp_release);
+}
+
+static int lp_lookup_inode(const char *buf, size_t count, struct inode **inode)
+{
+	struct path path;
+	char *name;
+	int err;
+
+	name = kstrndup(buf, count, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	err = kern_path(strim(name), LOOKUP_FOLLOW, &path);
+	kfree(name);
+	if (err)
+		return err;
+
+	*inode = d_inode(path.dentry);
+	if (S_ISREG((*inode)->i_mode))
+		ihold(*inode);
+	else
+		err = -EINVAL;
+	path_put(&path);
+
+	return err;
+}
+
+static ssize_t tag_store(struct kobject *kobj, struct kobj_attribute *attr,
+			 const char *buf, size_t count)
+{
+	struct launch_record *rec;
+	struct inode *inode;
+	int err;
+
+	err = lp_lookup_inode(buf, count, &inode);
+	if (err)
+		return err;
+
+	mutex_lock(&lp_lock);
+	if (lp_find(inode)) {
+		err = -EEXIST;
+		goto out;
+	}
+	if (lp_nr_records == LP_MAX_RECORDS) {
+		err = -ENOSPC;
+		goto out;
+	}
+
+	rec = kzalloc(sizeof(*rec), GFP_KERNEL);
+	if (!rec) {
+		err = -ENOMEM;
+		goto out;
+	}
+	kref_init(&rec->kref);
+	spin_lock_init(&rec->lock);
+	INIT_WORK(&rec->replay_work, lp_replay_work);
+	rec->inode = inode;
+	list_add(&rec->node, &lp_records);
+	WRITE_ONCE(lp_nr_records, lp_nr_records + 1);
+	inode = NULL;
+out:
+	mutex_unlock(&lp_lock);
+	if (inode)
+		iput(inode);
+	return err ? err : count;
+}
+
+static struct kobj_attribute tag_attr = __ATTR_WO(tag);
+
+static ssize_t forget_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct launch_record *rec;
+	struct inode *inode;
+	int err;
+
+	err = lp_lookup_inode(buf, count, &inode);
+	if (err)
+		return err;
+
+	mutex_lock(&lp_lock);
+	rec = lp_find(inode);
+	if (rec) {
+		list_del(&rec->node);
+		WRITE_ONCE(lp_nr_records, lp_nr_records - 1);
+	}
+	mutex_unlock(&lp_lock);
+	iput(inode);
+
+	if (!rec)
+		return -ENOENT;
+
+	cancel_work_sync(&rec->replay_work);
+	/* A process still being recorded holds its own reference */
+	kref_put(&rec->kref, lp_release);
+	return count;
+}
+
+static struct kobj_attribute forget_attr = __ATTR_WO(forget);
+
+static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr,
+			    char *buf)
+{
+	return sprintf(buf, "%d\n", enabled);
+}
+
+static ssize_t enabled_store(struct kobject *kobj, struct kobj_attribute *attr,
+			     const char *buf, size_t count)
+{
+	int err = kstrtobool(buf, &enabled);
+
+	return err ? err : count;
+}
+
+static struct kobj_attribute enabled_attr = __ATTR_RW(enabled);
+
+static ssize_t records_show(struct kobject *kobj, struct kobj_attribute *attr,
+			    char *buf)
+{
+	struct launch_record *rec;
+	ssize_t len = 0;
+
+	mutex_lock(&lp_lock);
+	list_for_each_entry(rec, &lp_records, node) {
+		spin_lock(&rec->lock);
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%u:%u %lu %s files %u runs %u pages %lu replays %lu\n",
+				 MAJOR(rec->inode->i_sb->s_dev),
+				 MINOR(rec->inode->i_sb->s_dev),
+				 rec->inode->i_ino,
+				 rec->ready ? "ready" :
+				 rec->recording ? "recording" : "tagged",
+				 rec->nr_files, rec->nr_runs, rec->nr_pages,
+				 rec->replays);
+		spin_unlock(&rec->lock);
+	}
+	mutex_unlock(&lp_lock);
+
+	return len;
+}
+
+static struct kobj_attribute records_attr = __ATTR_RO(records);
+
+static ssize_t stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	return sprintf(buf, "replays %lu\npages_prefetched %lu\n",
+		       atomic_long_read(&lp_replays),
+		       atomic_long_read(&lp_pages_prefetched));
+}
+
+static struct kobj_attribute stats_attr = __ATTR_RO(stats);
+
+static struct attribute *lp_attrs[] = {
+	&enabled_attr.attr,
+	&tag_attr.attr,
+	&forget_attr.attr,
+	&records_attr.attr,
+	&stats_attr.attr,
+	NULL,
+};
+
+static struct attribute_group lp_attr_group = {
+	.attrs = lp_attrs,
+	.name = "launch_prefetch",
+};
+
+static int __init launch_prefetch_init(void)
+{
+	int err;
+
+	err = sysfs_create_group(mm_kobj, &lp_attr_group);
+	if (err)
+		pr_err("launch_prefetch: register sysfs failed\n");
+	return err;
+}
+late_initcall(launch_prefetch_init);
@@ -102,6 +102,14 @@ static const char * const mem_cgroup_events_names[] = {
 	"pgpgout",
 	"pgfault",
 	"pgmajfault",
+	"workingset_refault",
+	"workingset_activate",
+	"workingset_refault_distance_25",
+	"workingset_refault_distance_50",
+	"workingset_refault_distance_100",
+	"workingset_refault_distance_200",
+	"workingset_refault_distance_400",
+	"workingset_refault_distance_more",
 };
 
 static const char * const mem_cgroup_lru_names[] = {
@@ -3283,6 +3291,56 @@ static int mem_cgroup_swappiness_write(struct cgroup_subsys_state *css,
 	return 0;
 }
 
+atomic_t memcg_reclaim_classes_used = ATOMIC_INIT(0);
+
+static const char * const memcg_reclaim_class_names[] = {
+	[MEMCG_RECLAIM_CACHED]		= "cached",
+	[MEMCG_RECLAIM_DEFAULT]		= "default",
+	[MEMCG_RECLAIM_VISIBLE]		= "visible",
+	[MEMCG_RECLAIM_FOREGROUND]	= "foreground",
+};
+
+static void mem_cgroup_set_reclaim_class(struct mem_cgroup *memcg, int class)
+{
+	int old = xchg(&memcg->reclaim_class, class);
+
+	if (old == MEMCG_RECLAIM_DEFAULT && class != MEMCG_RECLAIM_DEFAULT)
+		atomic_inc(&memcg_reclaim_classes_used);
+	else if (old != MEMCG_RECLAIM_DEFAULT && class == MEMCG_RECLAIM_DEFAULT)
+		atomic_dec(&memcg_reclaim_classes_used);
+}
+
+static int mem_cgroup_reclaim_class_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(seq_css(m));
+
+	seq_printf(m, "%s\n",
+		   memcg_reclaim_class_names[mem_cgroup_reclaim_class(memcg)]);
+	return 0;
+}
+
+static ssize_t mem_cgroup_reclaim_class_write(struct kernfs_open_file *of,
+					      char *buf, size_t nbytes,
+					      loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	int class;
+
+	/* The root group holds the kernel and system daemons */
+	if (mem_cgroup_is_root(memcg))
+		return -EINVAL;
+
+	buf = strstrip(buf);
+	for (class = 0; class < NR_MEMCG_RECLAIM_CLASSES; class++) {
+		if (!strcmp(buf, memcg_reclaim_class_names[class])) {
+			mem_cgroup_set_reclaim_class(memcg, class);
+			return nbytes;
+		}
+	}
+
+	return -EINVAL;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -3635,6 +3693,44 @@ static int mem_cgroup_oom_control_write(struct cgroup_subsys_state *css,
 	return 0;
 }
 
+static int mem_cgroup_pressure_read(struct seq_file *sf, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(seq_css(sf));
+
+	return vmpressure_stall_show(sf, memcg_to_vmpressure(memcg));
+}
+
+static ssize_t mem_cgroup_pressure_write(struct kernfs_open_file *of,
+					 char *buf, size_t nbytes, loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	struct vmpressure_trigger *t;
+
+	/* Writes are serialized by kernfs, one trigger per open file */
+	if (of->priv)
+		return -EBUSY;
+
+	t = vmpressure_trigger_create(memcg_to_vmpressure(memcg),
+				      strstrip(buf));
+	if (IS_ERR(t))
+		return PTR_ERR(t);
+
+	smp_store_release(&of->priv, t);
+	return nbytes;
+}
+
+static unsigned int mem_cgroup_pressure_poll(struct kernfs_open_file *of,
+					     struct poll_table_struct *pt)
+{
+	return vmpressure_trigger_poll(smp_load_acquire(&of->priv),
+				       of->file, pt);
+}
+
+static void mem_cgroup_pressure_release(struct kernfs_open_file *of)
+{
+	vmpressure_trigger_destroy(of->priv);
+}
+
 #ifdef CONFIG_MEMCG_KMEM
 static int memcg_init_kmem(struct mem_cgroup *memcg, struct cgroup_subsys *ss)
 {
@@ -4087,6 +4183,12 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "reclaim_class",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = mem_cgroup_reclaim_class_show,
+		.write = mem_cgroup_reclaim_class_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4101,6 +4203,13 @@ static struct cftype mem_cgroup_legacy_files[] = {
 	{
 		.name = "pressure_level",
 	},
+	{
+		.name = "pressure",
+		.seq_show = mem_cgroup_pressure_read,
+		.write = mem_cgroup_pressure_write,
+		.poll = mem_cgroup_pressure_poll,
+		.release = mem_cgroup_pressure_release,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -4342,6 +4451,7 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	memcg->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&memcg->oom_notify);
 	memcg->move_charge_at_immigrate = 0;
+	memcg->reclaim_class = MEMCG_RECLAIM_DEFAULT;
 	mutex_init(&memcg->thresholds_lock);
 	spin_lock_init(&memcg->move_lock);
 	vmpressure_init(&memcg->vmpressure);
@@ -4460,6 +4570,7 @@ static void mem_cgroup_css_free(struct cgroup_subsys_state *css)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_css(css);
 
+	mem_cgroup_set_reclaim_class(memcg, MEMCG_RECLAIM_DEFAULT);
 	memcg_destroy_kmem(memcg);
 	__mem_cgroup_free(memcg);
 }
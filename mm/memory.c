@@ -979,12 +979,51 @@ again:
 	return 0;
 }
 
+/*
+ * With MMF_LAZY_FORK, a page table of a private file mapping that maps
+ * nothing but page cache pages is not copied to the child: the child's
+ * faults find the very same pages in the page cache. Tables holding
+ * anonymous (COW) pages, swap or migration entries are copied as usual.
+ * The parent's mmap_sem is held for write, so no new ptes show up here.
+ */
+static bool pte_range_refaultable(struct mm_struct *src_mm, pmd_t *src_pmd,
+				  struct vm_area_struct *vma,
+				  unsigned long addr, unsigned long end)
+{
+	pte_t *orig_pte, *pte;
+	spinlock_t *ptl;
+	bool ret = true;
+
+	orig_pte = pte = pte_offset_map_lock(src_mm, src_pmd, addr, &ptl);
+	do {
+		pte_t ptent = *pte;
+		struct page *page;
+
+		if (pte_none(ptent))
+			continue;
+		if (!pte_present(ptent)) {
+			ret = false;
+			break;
+		}
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || PageAnon(page)) {
+			ret = false;
+			break;
+		}
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap_unlock(orig_pte, ptl);
+
+	return ret;
+}
+
 static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		pud_t *dst_pud, pud_t *src_pud, struct vm_area_struct *vma,
 		unsigned long addr, unsigned long end)
 {
 	pmd_t *src_pmd, *dst_pmd;
 	unsigned long next;
+	bool lazy = test_bit(MMF_LAZY_FORK, &src_mm->flags) && vma->vm_file &&
+		!(vma->vm_flags & (VM_SHARED | VM_PFNMAP | VM_MIXEDMAP));
 
 	dst_pmd = pmd_alloc(dst_mm, dst_pud, addr);
 	if (!dst_pmd)
@@ -1005,6 +1044,14 @@ static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src
 		}
 		if (pmd_none_or_clear_bad(src_pmd))
 			continue;
+		if (lazy) {
+			if (pte_range_refaultable(src_mm, src_pmd, vma,
+						  addr, next)) {
+				count_vm_event(LAZY_FORK_PTE_SKIPPED);
+				continue;
+			}
+			count_vm_event(LAZY_FORK_PTE_COPIED);
+		}
 		if (copy_pte_range(dst_mm, src_mm, dst_pmd, src_pmd,
 						vma, addr, next))
 			return -ENOMEM;
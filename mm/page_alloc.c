@@ -119,6 +119,8 @@ unsigned long totalreserve_pages __read_mostly;
 unsigned long totalcma_pages __read_mostly;
 
 int percpu_pagelist_fraction;
+/* Size of the high-order pcp lists, in percent of the order-0 high/batch */
+int percpu_highorder_pagelist_ratio = 50;
 gfp_t gfp_allowed_mask __read_mostly = GFP_BOOT_MASK;
 
 /*
@@ -917,6 +919,89 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Frees at least count base pages from the high-order pcp lists, taking one
+ * page from each non-empty list in turn. Returns the number of base pages
+ * actually freed, which can exceed count by up to one high-order page.
+ */
+static int free_pcppages_bulk_high(struct zone *zone, int count,
+					struct per_cpu_pages *pcp)
+{
+	int freed = 0;
+	unsigned long nr_scanned;
+
+	spin_lock(&zone->lock);
+	nr_scanned = zone_page_state(zone, NR_PAGES_SCANNED);
+	if (nr_scanned)
+		__mod_zone_page_state(zone, NR_PAGES_SCANNED, -nr_scanned);
+
+	count = min(pcp->hcount, count);
+	while (freed < count) {
+		unsigned int order;
+		int migratetype;
+
+		for (order = 1; order <= PAGE_ALLOC_COSTLY_ORDER; order++) {
+			for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+			     migratetype++) {
+				struct list_head *list;
+				struct page *page;
+				int mt;
+
+				list = &pcp->hlists[order - 1][migratetype];
+				if (list_empty(list))
+					continue;
+
+				page = list_last_entry(list, struct page, lru);
+				list_del(&page->lru);
+
+				mt = get_pcppage_migratetype(page);
+				VM_BUG_ON_PAGE(is_migrate_isolate(mt), page);
+				if (unlikely(has_isolate_pageblock(zone)))
+					mt = get_pageblock_migratetype(page);
+
+				__free_one_page(page, page_to_pfn(page), zone,
+						order, mt);
+				trace_mm_page_pcpu_drain(page, order, mt);
+				freed += 1 << order;
+			}
+		}
+	}
+	spin_unlock(&zone->lock);
+	return freed;
+}
+
+/*
+ * Queue a page of order 1..PAGE_ALLOC_COSTLY_ORDER on this CPU's high-order
+ * pcp list. Must be called with interrupts disabled. Returns false when the
+ * page has to go straight back to the buddy allocator.
+ */
+static bool free_pcp_highorder(struct zone *zone, struct page *page,
+			       unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	if (!order || order > PAGE_ALLOC_COSTLY_ORDER)
+		return false;
+
+	if (migratetype >= MIGRATE_PCPTYPES) {
+		if (unlikely(is_migrate_isolate(migratetype)))
+			return false;
+		migratetype = MIGRATE_MOVABLE;
+	}
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (!pcp->hhigh)
+		return false;
+
+	set_pcppage_migratetype(page, migratetype);
+	list_add(&page->lru, &pcp->hlists[order - 1][migratetype]);
+	pcp->hcount += 1 << order;
+	if (pcp->hcount >= pcp->hhigh)
+		pcp->hcount -= free_pcppages_bulk_high(zone,
+						READ_ONCE(pcp->hbatch), pcp);
+	return true;
+}
+
 static void free_one_page(struct zone *zone,
 				struct page *page, unsigned long pfn,
 				unsigned int order,
@@ -1087,7 +1172,8 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	migratetype = get_pfnblock_migratetype(page, pfn);
 	local_irq_save(flags);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, pfn, order, migratetype);
+	if (!free_pcp_highorder(page_zone(page), page, order, migratetype))
+		free_one_page(page_zone(page), page, pfn, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -2006,16 +2092,24 @@ static struct list_head *get_populated_pcp_list(struct zone *zone,
 			unsigned int order, struct per_cpu_pages *pcp,
 			int migratetype, int cold)
 {
-	struct list_head *list = &pcp->lists[migratetype];
-
-	if (list_empty(list)) {
-		pcp->count += rmqueue_bulk(zone, order,
-				pcp->batch, list,
-				migratetype, cold);
+	struct list_head *list;
 
+	if (order) {
+		list = &pcp->hlists[order - 1][migratetype];
 		if (list_empty(list))
-			list = NULL;
+			pcp->hcount += rmqueue_bulk(zone, order,
+				max(READ_ONCE(pcp->hbatch) >> order, 1),
+				list, migratetype, cold) << order;
+	} else {
+		list = &pcp->lists[migratetype];
+		if (list_empty(list))
+			pcp->count += rmqueue_bulk(zone, order,
+					pcp->batch, list,
+					migratetype, cold);
 	}
+
+	if (list_empty(list))
+		list = NULL;
 	return list;
 }
 
@@ -2040,6 +2134,9 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 		free_pcppages_bulk(zone, to_drain, pcp);
 		pcp->count -= to_drain;
 	}
+	to_drain = min(pcp->hcount, READ_ONCE(pcp->hbatch));
+	if (to_drain > 0)
+		pcp->hcount -= free_pcppages_bulk_high(zone, to_drain, pcp);
 	local_irq_restore(flags);
 }
 #endif
@@ -2065,6 +2162,10 @@ static void drain_pages_zone(unsigned int cpu, struct zone *zone)
 		free_pcppages_bulk(zone, pcp->count, pcp);
 		pcp->count = 0;
 	}
+	if (pcp->hcount) {
+		free_pcppages_bulk_high(zone, pcp->hcount, pcp);
+		pcp->hcount = 0;
+	}
 	local_irq_restore(flags);
 }
 
@@ -2135,12 +2236,12 @@ void drain_all_pages(struct zone *zone)
 
 		if (zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count)
+			if (pcp->pcp.count || pcp->pcp.hcount)
 				has_pcps = true;
 		} else {
 			for_each_populated_zone(z) {
 				pcp = per_cpu_ptr(z->pageset, cpu);
-				if (pcp->pcp.count) {
+				if (pcp->pcp.count || pcp->pcp.hcount) {
 					has_pcps = true;
 					break;
 				}
@@ -2328,7 +2429,47 @@ int __isolate_free_page(struct page *page, unsigned int order)
 }
 
 /*
- * Allocate a page from the given zone. Use pcplists for order-0 allocations.
+ * Take a page of order 1..PAGE_ALLOC_COSTLY_ORDER from this CPU's high-order
+ * pcp lists, refilling them from the buddy allocator if needed. Must be
+ * called with interrupts disabled.
+ */
+static struct page *rmqueue_pcp_highorder(struct zone *zone,
+			unsigned int order, gfp_t gfp_flags, int migratetype,
+			bool cold)
+{
+	struct per_cpu_pages *pcp;
+	struct list_head *list = NULL;
+	struct page *page;
+
+	if (order > PAGE_ALLOC_COSTLY_ORDER)
+		return NULL;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (!pcp->hhigh)
+		return NULL;
+
+	if (migratetype == MIGRATE_MOVABLE && gfp_flags & __GFP_CMA)
+		list = get_populated_pcp_list(zone, order, pcp,
+				get_cma_migrate_type(), cold);
+	if (list == NULL)
+		list = get_populated_pcp_list(zone, order, pcp,
+				migratetype, cold);
+	if (list == NULL)
+		return NULL;
+
+	if (cold)
+		page = list_last_entry(list, struct page, lru);
+	else
+		page = list_first_entry(list, struct page, lru);
+
+	list_del(&page->lru);
+	pcp->hcount -= 1 << order;
+	return page;
+}
+
+/*
+ * Allocate a page from the given zone. Use pcplists for allocations up to
+ * PAGE_ALLOC_COSTLY_ORDER.
  */
 static inline
 struct page *buffered_rmqueue(struct zone *preferred_zone,
@@ -2386,8 +2527,13 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
+		local_irq_save(flags);
+		page = rmqueue_pcp_highorder(zone, order, gfp_flags,
+					     migratetype, cold);
+		if (page)
+			goto allocated;
 
+		spin_lock(&zone->lock);
 		page = NULL;
 		if (alloc_flags & ALLOC_HARDER) {
 			page = __rmqueue_smallest(zone, order, MIGRATE_HIGHATOMIC);
@@ -2408,6 +2554,7 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 					  get_pcppage_migratetype(page));
 	}
 
+allocated:
 	__mod_zone_page_state(zone, NR_ALLOC_BATCH, -(1 << order));
 	if (atomic_long_read(&zone->vm_stat[NR_ALLOC_BATCH]) <= 0 &&
 	    !test_bit(ZONE_FAIR_DEPLETED, &zone->flags))
@@ -2923,15 +3070,18 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 		bool *deferred_compaction)
 {
 	unsigned long compact_result;
+	struct memstall_cookie memstall;
 	struct page *page;
 
 	if (!order)
 		return NULL;
 
+	vmpressure_memstall_enter(&memstall);
 	current->flags |= PF_MEMALLOC;
 	compact_result = try_to_compact_pages(gfp_mask, order, alloc_flags, ac,
 						mode, contended_compaction);
 	current->flags &= ~PF_MEMALLOC;
+	vmpressure_memstall_leave(&memstall);
 
 	switch (compact_result) {
 	case COMPACT_DEFERRED:
@@ -2988,12 +3138,14 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 					const struct alloc_context *ac)
 {
 	struct reclaim_state reclaim_state;
+	struct memstall_cookie memstall;
 	int progress;
 
 	cond_resched();
 
 	/* We now go into synchronous reclaim */
 	cpuset_memory_pressure_bump();
+	vmpressure_memstall_enter(&memstall);
 	current->flags |= PF_MEMALLOC;
 	lockdep_set_current_reclaim_state(gfp_mask);
 	reclaim_state.reclaimed_slab = 0;
@@ -3005,6 +3157,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
 	current->flags &= ~PF_MEMALLOC;
+	vmpressure_memstall_leave(&memstall);
 
 	cond_resched();
 
@@ -3934,7 +4087,8 @@ void show_free_areas(unsigned int filter)
 			continue;
 
 		for_each_online_cpu(cpu)
-			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count +
+				per_cpu_ptr(zone->pageset, cpu)->pcp.hcount;
 	}
 
 	printk("active_anon:%lu inactive_anon:%lu isolated_anon:%lu\n"
@@ -3971,7 +4125,8 @@ void show_free_areas(unsigned int filter)
 
 		free_pcp = 0;
 		for_each_online_cpu(cpu)
-			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count +
+				per_cpu_ptr(zone->pageset, cpu)->pcp.hcount;
 
 		show_node(zone);
 		printk("%s"
@@ -4839,15 +4994,27 @@ static int zone_batchsize(struct zone *zone)
 static void pageset_update(struct per_cpu_pages *pcp, unsigned long high,
 		unsigned long batch)
 {
+	unsigned long ratio = READ_ONCE(percpu_highorder_pagelist_ratio);
+	unsigned long hhigh = high * ratio / 100;
+	unsigned long hbatch = max(batch * ratio / 100,
+				   1UL << PAGE_ALLOC_COSTLY_ORDER);
+
+	/* Too small to save any zone->lock round trips */
+	if (hhigh < 2 * hbatch)
+		hhigh = 0;
+
        /* start with a fail safe value for batch */
 	pcp->batch = 1;
+	pcp->hbatch = 1 << PAGE_ALLOC_COSTLY_ORDER;
 	smp_wmb();
 
        /* Update high, then batch, in order */
 	pcp->high = high;
+	pcp->hhigh = hhigh;
 	smp_wmb();
 
 	pcp->batch = batch;
+	pcp->hbatch = hbatch;
 }
 
 /* a companion to pageset_set_high() */
@@ -4859,7 +5026,7 @@ static void pageset_set_batch(struct per_cpu_pageset *p, unsigned long batch)
 static void pageset_init(struct per_cpu_pageset *p)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -4867,6 +5034,12 @@ static void pageset_init(struct per_cpu_pageset *p)
 	pcp->count = 0;
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+
+	pcp->hcount = 0;
+	for (order = 0; order < PAGE_ALLOC_COSTLY_ORDER; order++)
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++)
+			INIT_LIST_HEAD(&pcp->hlists[order][migratetype]);
 }
 
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
@@ -6542,6 +6715,41 @@ out:
 	return ret;
 }
 
+/*
+ * percpu_highorder_pagelist_ratio - sizes the per cpu lists for orders
+ * 1..PAGE_ALLOC_COSTLY_ORDER as a percentage of the order-0 pcp->high and
+ * pcp->batch. 0 disables them and returns their pages to the buddy allocator.
+ */
+int percpu_highorder_pagelist_ratio_sysctl_handler(struct ctl_table *table,
+	int write, void __user *buffer, size_t *length, loff_t *ppos)
+{
+	struct zone *zone;
+	int old_ratio;
+	int ret;
+
+	mutex_lock(&pcp_batch_high_lock);
+	old_ratio = percpu_highorder_pagelist_ratio;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!write || ret < 0)
+		goto out;
+
+	if (percpu_highorder_pagelist_ratio == old_ratio)
+		goto out;
+
+	for_each_populated_zone(zone) {
+		unsigned int cpu;
+
+		for_each_possible_cpu(cpu)
+			pageset_set_high_and_batch(zone,
+					per_cpu_ptr(zone->pageset, cpu));
+	}
+	drain_all_pages(NULL);
+out:
+	mutex_unlock(&pcp_batch_high_lock);
+	return ret;
+}
+
 #ifdef CONFIG_NUMA
 int hashdist = HASHDIST_DEFAULT;
 
@@ -17,6 +17,7 @@
 #include <linux/swap.h>
 #include <linux/bio.h>
 #include <linux/swapops.h>
+#include <linux/swapfile.h>
 #include <linux/buffer_head.h>
 #include <linux/writeback.h>
 #include <linux/frontswap.h>
@@ -44,6 +45,11 @@ void end_swap_bio_write(struct bio *bio)
 {
 	struct page *page = bio->bi_io_vec[0].bv_page;
 
+	/* bi_private carries the swap_ratio_io_start() stamp, if any */
+	if (bio->bi_private && PageSwapCache(page))
+		swap_ratio_io_done(page_swap_info(page), WRITE,
+				   (unsigned long)bio->bi_private);
+
 	if (bio->bi_error) {
 		SetPageError(page);
 		/*
@@ -81,6 +87,10 @@ static void end_swap_bio_read(struct bio *bio)
 
 	SetPageUptodate(page);
 
+	if (bio->bi_private && PageSwapCache(page))
+		swap_ratio_io_done(page_swap_info(page), READ,
+				   (unsigned long)bio->bi_private);
+
 	/*
 	 * There is no guarantee that the page is in swap cache - the software
 	 * suspend code (at least) uses end_swap_bio_read() against a non-
@@ -249,6 +259,7 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 	struct bio *bio;
 	int ret, rw = WRITE;
 	struct swap_info_struct *sis = page_swap_info(page);
+	unsigned long start;
 
 	if (sis->flags & SWP_FILE) {
 		struct kiocb kiocb;
@@ -291,9 +302,11 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 		return ret;
 	}
 
+	start = swap_ratio_io_start();
 	ret = bdev_write_page(sis->bdev, map_swap_page(page, &sis->bdev),
 			      page, wbc);
 	if (!ret) {
+		swap_ratio_io_done(sis, WRITE, start);
 		count_vm_event(PSWPOUT);
 		return 0;
 	}
@@ -306,6 +319,7 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 		ret = -ENOMEM;
 		goto out;
 	}
+	bio->bi_private = (void *)start;
 	if (wbc->sync_mode == WB_SYNC_ALL)
 		rw |= REQ_SYNC;
 	count_vm_event(PSWPOUT);
@@ -321,6 +335,7 @@ int swap_readpage(struct page *page)
 	struct bio *bio;
 	int ret = 0;
 	struct swap_info_struct *sis = page_swap_info(page);
+	unsigned long start;
 
 	VM_BUG_ON_PAGE(!PageLocked(page), page);
 	VM_BUG_ON_PAGE(PageUptodate(page), page);
@@ -340,8 +355,10 @@ int swap_readpage(struct page *page)
 		return ret;
 	}
 
+	start = swap_ratio_io_start();
 	ret = bdev_read_page(sis->bdev, map_swap_page(page, &sis->bdev), page);
 	if (!ret) {
+		swap_ratio_io_done(sis, READ, start);
 		count_vm_event(PSWPIN);
 		return 0;
 	}
@@ -353,6 +370,7 @@ int swap_readpage(struct page *page)
 		ret = -ENOMEM;
 		goto out;
 	}
+	bio->bi_private = (void *)start;
 	count_vm_event(PSWPIN);
 	submit_bio(READ, bio);
 out:
@@ -20,6 +20,10 @@
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
 #include <linux/vmpressure.h>
+#include <linux/memcontrol.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/process_reclaim.h>
@@ -71,18 +75,72 @@ static atomic_t skip_reclaim = ATOMIC_INIT(0);
 /* Not atomic since only a single instance of swap_fn run at a time */
 static int monitor_eff;
 
+/*
+ * Candidates are ranked by oom_score_adj bucket first, so that e.g. all
+ * cached apps (900-999) are reclaimed before a large previous app, and by
+ * anon size within a bucket.
+ */
+static int adj_bucket_size = 100;
+module_param_named(adj_bucket_size, adj_bucket_size, int, S_IRUGO | S_IWUSR);
+
+/* Upper bound on tasks reclaimed concurrently */
+static int reclaim_workers = 4;
+module_param_named(reclaim_workers, reclaim_workers, int, S_IRUGO);
+
+/* Statistics of the last pass */
+static int last_pass_tasks;
+module_param_named(last_pass_tasks, last_pass_tasks, int, S_IRUGO);
+static int last_pass_reclaimed;
+module_param_named(last_pass_reclaimed, last_pass_reclaimed, int, S_IRUGO);
+static unsigned int last_pass_us;
+module_param_named(last_pass_us, last_pass_us, uint, S_IRUGO);
+/* Workingset refaults between the end of the last pass and this one */
+static unsigned long last_pass_refaults;
+module_param_named(last_pass_refaults, last_pass_refaults, ulong, S_IRUGO);
+static unsigned long total_reclaimed_pages;
+module_param_named(total_reclaimed, total_reclaimed_pages, ulong, S_IRUGO);
+
+static struct workqueue_struct *reclaim_wq;
+static unsigned long pass_end_refaults;
+
+struct reclaim_pass {
+	atomic_t nr_scanned;
+	atomic_t nr_reclaimed;
+	atomic_t pending;
+	struct completion done;
+	int total_sz;
+};
+
 struct selected_task {
 	struct task_struct *p;
 	int tasksize;
 	short oom_score_adj;
+	int nr_to_reclaim;
+	struct reclaim_pass *pass;
+	struct work_struct work;
 };
 
+/* Too big for the stack, and swap_fn never runs concurrently with itself */
+static struct selected_task selected[MAX_SWAP_TASKS];
+
+static int adj_bucket(short oom_score_adj)
+{
+	int size = READ_ONCE(adj_bucket_size);
+
+	return size > 0 ? oom_score_adj / size : 0;
+}
+
 int selected_cmp(const void *a, const void *b)
 {
 	const struct selected_task *x = a;
 	const struct selected_task *y = b;
+	int bx = adj_bucket(x->oom_score_adj);
+	int by = adj_bucket(y->oom_score_adj);
 	int ret;
 
+	if (bx != by)
+		return bx < by ? -1 : 1;
+
 	ret = x->tasksize < y->tasksize ? -1 : 1;
 
 	return ret;
@@ -107,13 +165,41 @@ static int test_task_flag(struct task_struct *p, int flag)
 	return 0;
 }
 
-static void swap_fn(struct work_struct *work)
+/* Leave tasks of memcgs that are within their memory.low alone */
+static bool task_memcg_protected(struct task_struct *p)
 {
-	struct task_struct *tsk;
+#ifdef CONFIG_MEMCG
+	return mem_cgroup_low(NULL, mem_cgroup_from_task(p));
+#else
+	return false;
+#endif
+}
+
+static void reclaim_work_fn(struct work_struct *work)
+{
+	struct selected_task *s = container_of(work, struct selected_task,
+					       work);
+	struct reclaim_pass *pass = s->pass;
 	struct reclaim_param rp;
 
-	/* Pick the best MAX_SWAP_TASKS tasks in terms of anon size */
-	struct selected_task selected[MAX_SWAP_TASKS] = {{0, 0, 0},};
+	rp = reclaim_task_anon(s->p, s->nr_to_reclaim);
+
+	trace_process_reclaim(s->tasksize, s->oom_score_adj, rp.nr_scanned,
+			rp.nr_reclaimed, per_swap_size, pass->total_sz,
+			s->nr_to_reclaim);
+	atomic_add(rp.nr_scanned, &pass->nr_scanned);
+	atomic_add(rp.nr_reclaimed, &pass->nr_reclaimed);
+	put_task_struct(s->p);
+
+	if (atomic_dec_and_test(&pass->pending))
+		complete(&pass->done);
+}
+
+static void swap_fn(struct work_struct *work)
+{
+	struct task_struct *tsk;
+	struct reclaim_pass pass;
+	struct selected_task cand;
 	int si = 0;
 	int i;
 	int tasksize;
@@ -122,6 +208,11 @@ static void swap_fn(struct work_struct *work)
 	int total_reclaimed = 0;
 	int nr_to_reclaim;
 	int efficiency;
+	unsigned long refaults;
+	ktime_t start;
+
+	/* Pick the best MAX_SWAP_TASKS tasks in terms of bucket and size */
+	memset(selected, 0, sizeof(selected));
 
 	rcu_read_lock();
 	for_each_process(tsk) {
@@ -139,7 +230,8 @@ static void swap_fn(struct work_struct *work)
 			continue;
 
 		oom_score_adj = p->signal->oom_score_adj;
-		if (oom_score_adj < min_score_adj) {
+		if (oom_score_adj < min_score_adj ||
+		    task_memcg_protected(p)) {
 			task_unlock(p);
 			continue;
 		}
@@ -150,11 +242,15 @@ static void swap_fn(struct work_struct *work)
 		if (tasksize <= 0)
 			continue;
 
+		cand.p = p;
+		cand.oom_score_adj = oom_score_adj;
+		cand.tasksize = tasksize;
+
 		if (si == MAX_SWAP_TASKS) {
 			sort(&selected[0], MAX_SWAP_TASKS,
 					sizeof(struct selected_task),
 					&selected_cmp, NULL);
-			if (tasksize < selected[0].tasksize)
+			if (selected_cmp(&cand, &selected[0]) < 0)
 				continue;
 			selected[0].p = p;
 			selected[0].oom_score_adj = oom_score_adj;
@@ -181,23 +277,42 @@ static void swap_fn(struct work_struct *work)
 
 	rcu_read_unlock();
 
-	while (si--) {
+	refaults = global_page_state(WORKINGSET_REFAULT);
+	if (pass_end_refaults)
+		last_pass_refaults = refaults - pass_end_refaults;
+
+	start = ktime_get();
+	atomic_set(&pass.nr_scanned, 0);
+	atomic_set(&pass.nr_reclaimed, 0);
+	atomic_set(&pass.pending, si);
+	init_completion(&pass.done);
+	pass.total_sz = total_sz;
+
+	for (i = 0; i < si; i++) {
 		nr_to_reclaim =
-			(selected[si].tasksize * per_swap_size) / total_sz;
+			(selected[i].tasksize * per_swap_size) / total_sz;
 		/* scan atleast a page */
 		if (!nr_to_reclaim)
 			nr_to_reclaim = 1;
 
-		rp = reclaim_task_anon(selected[si].p, nr_to_reclaim);
-
-		trace_process_reclaim(selected[si].tasksize,
-				selected[si].oom_score_adj, rp.nr_scanned,
-				rp.nr_reclaimed, per_swap_size, total_sz,
-				nr_to_reclaim);
-		total_scan += rp.nr_scanned;
-		total_reclaimed += rp.nr_reclaimed;
-		put_task_struct(selected[si].p);
+		selected[i].nr_to_reclaim = nr_to_reclaim;
+		selected[i].pass = &pass;
+		INIT_WORK(&selected[i].work, reclaim_work_fn);
+		if (reclaim_wq)
+			queue_work(reclaim_wq, &selected[i].work);
+		else
+			reclaim_work_fn(&selected[i].work);
 	}
+	wait_for_completion(&pass.done);
+
+	total_scan = atomic_read(&pass.nr_scanned);
+	total_reclaimed = atomic_read(&pass.nr_reclaimed);
+
+	last_pass_tasks = si;
+	last_pass_reclaimed = total_reclaimed;
+	last_pass_us = ktime_us_delta(ktime_get(), start);
+	total_reclaimed_pages += total_reclaimed;
+	pass_end_refaults = global_page_state(WORKINGSET_REFAULT);
 
 	if (total_scan) {
 		efficiency = (total_reclaimed * 100) / total_scan;
@@ -243,6 +358,9 @@ static struct notifier_block vmpr_nb = {
 
 static int __init process_reclaim_init(void)
 {
+	/* Not fatal, tasks are then reclaimed one after another */
+	reclaim_wq = alloc_workqueue("process_reclaim", WQ_UNBOUND,
+				     max(reclaim_workers, 1));
 	vmpressure_notifier_register(&vmpr_nb);
 	return 0;
 }
@@ -250,6 +368,9 @@ static int __init process_reclaim_init(void)
 static void __exit process_reclaim_exit(void)
 {
 	vmpressure_notifier_unregister(&vmpr_nb);
+	flush_work(&swap_work);
+	if (reclaim_wq)
+		destroy_workqueue(reclaim_wq);
 }
 
 module_init(process_reclaim_init);
@@ -281,6 +281,58 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
 	return min(newsize, max);
 }
 
+/*
+ * Readahead hit ratio.
+ *
+ * ra->hits counts page cache hits inside the current window. When a window
+ * is replaced by one that does not continue it, the pages it read that were
+ * never hit are accounted as wasted to the bdi, and fold into the per-file
+ * ra->waste_pct. A window that a sequential stream runs into was used and
+ * decays waste_pct. With bdi->ra_adaptive set, waste_pct scales the maximum
+ * window of the file down, to no less than an eighth of ra_pages, and lets
+ * it grow back as the file is read sequentially again.
+ */
+void ra_account_window(struct address_space *mapping,
+		struct file_ra_state *ra, int nr_read)
+{
+	ra->hits = 0;
+	ra->nr_read = max(nr_read, 0);
+	if (nr_read > 0)
+		atomic_long_add(nr_read, &inode_to_bdi(mapping->host)->ra_read);
+}
+
+void ra_retire_window(struct address_space *mapping,
+		struct file_ra_state *ra)
+{
+	unsigned int wasted;
+
+	if (!ra->nr_read)
+		return;
+
+	wasted = min(ra->size - min(ra->hits, ra->size), ra->nr_read);
+	if (wasted)
+		atomic_long_add(wasted,
+				&inode_to_bdi(mapping->host)->ra_wasted);
+	ra->waste_pct = (ra->waste_pct * 3 + wasted * 100 / ra->nr_read) / 4;
+	ra->nr_read = 0;
+}
+
+static void ra_window_used(struct file_ra_state *ra)
+{
+	ra->waste_pct -= ra->waste_pct / 4;
+}
+
+unsigned long ra_adapt_max(struct address_space *mapping,
+		struct file_ra_state *ra, unsigned long max)
+{
+	unsigned long floor = max(max >> 3, 1UL);
+
+	if (!inode_to_bdi(mapping->host)->ra_adaptive)
+		return max;
+
+	return max(max * (100 - min(ra->waste_pct, 100U)) / 100, floor);
+}
+
 /*
  * On-demand readahead design.
  *
@@ -365,6 +417,7 @@ static int try_context_readahead(struct address_space *mapping,
 	if (size >= offset)
 		size <<= 1;
 
+	ra_retire_window(mapping, ra);
 	ra->start = offset;
 	ra->size = min(size + req_size, max);
 	ra->async_size = 1;
@@ -382,7 +435,7 @@ ondemand_readahead(struct address_space *mapping,
 		   unsigned long req_size)
 {
 	struct backing_dev_info *bdi = inode_to_bdi(mapping->host);
-	unsigned long max_pages = ra->ra_pages;
+	unsigned long max_pages = ra_adapt_max(mapping, ra, ra->ra_pages);
 	unsigned long add_pages;
 	pgoff_t prev_offset;
 
@@ -405,6 +458,7 @@ ondemand_readahead(struct address_space *mapping,
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		ra_window_used(ra);
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
@@ -427,6 +481,7 @@ ondemand_readahead(struct address_space *mapping,
 		if (!start || start - offset > max_pages)
 			return 0;
 
+		ra_window_used(ra);
 		ra->start = start;
 		ra->size = start - offset;	/* old async_size */
 		ra->size += req_size;
@@ -464,6 +519,7 @@ ondemand_readahead(struct address_space *mapping,
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
+	ra_retire_window(mapping, ra);
 	ra->start = offset;
 	ra->size = get_init_ra_size(req_size, max_pages);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
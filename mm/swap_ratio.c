@@ -14,6 +14,8 @@
 #include <linux/mm_types.h>
 #include <linux/swapfile.h>
 #include <linux/swap.h>
+#include <linux/ktime.h>
+#include <linux/jiffies.h>
 
 #define SWAP_RATIO_GROUP_START (SWAP_FLAG_PRIO_MASK - 9) /* 32758 */
 #define SWAP_RATIO_GROUP_END (SWAP_FLAG_PRIO_MASK) /* 32767 */
@@ -30,6 +32,98 @@ int sysctl_swap_ratio = 100;
 /* Enable the swap ratio feature */
 int sysctl_swap_ratio_enable;
 
+/*
+ * Derive the ratio from measured device latencies instead of using
+ * sysctl_swap_ratio, which then only applies until both devices have
+ * completed some I/O.
+ */
+int sysctl_swap_ratio_adaptive;
+
+/* Limit on writes to the slow device in KB/s, 0 for none */
+int sysctl_swap_ratio_slow_cap;
+
+static bool swap_ratio_tracking(void)
+{
+	return sysctl_swap_ratio_enable && sysctl_swap_ratio_adaptive;
+}
+
+/*
+ * Returns a timestamp to hand to swap_ratio_io_done(), or 0 if latencies
+ * aren't being tracked.
+ */
+unsigned long swap_ratio_io_start(void)
+{
+	if (!swap_ratio_tracking())
+		return 0;
+
+	return (unsigned long)ktime_to_us(ktime_get()) ?: 1;
+}
+
+void swap_ratio_io_done(struct swap_info_struct *si, int rw,
+			unsigned long start)
+{
+	unsigned int *avg = rw == READ ? &si->read_lat_us : &si->write_lat_us;
+	unsigned long lat;
+	unsigned int old;
+
+	if (!start || !is_swap_ratio_group(si->prio))
+		return;
+
+	lat = (unsigned long)ktime_to_us(ktime_get()) - start;
+	lat = min_t(unsigned long, lat, USEC_PER_SEC);
+
+	/* Lockless, a sample lost to a racing update doesn't matter */
+	old = READ_ONCE(*avg);
+	WRITE_ONCE(*avg, old ? (old * 7 + lat) / 8 : lat);
+}
+
+/*
+ * Share of writes for the fast device such that each device gets writes
+ * in inverse proportion to its cost, the worse of its average read and
+ * write latencies. Swap-in time is what refaulting tasks wait on; write
+ * latency reacts sooner when the slow device is busy with other I/O.
+ */
+static int adaptive_ratio(struct swap_info_struct *fast,
+			  struct swap_info_struct *slow, int ratio)
+{
+	unsigned long fast_cost, slow_cost;
+
+	fast_cost = max(READ_ONCE(fast->read_lat_us),
+			READ_ONCE(fast->write_lat_us));
+	slow_cost = max(READ_ONCE(slow->read_lat_us),
+			READ_ONCE(slow->write_lat_us));
+
+	/* Nothing measured yet */
+	if (!fast_cost || !slow_cost)
+		return ratio;
+
+	return slow_cost * 100 / (fast_cost + slow_cost);
+}
+
+/*
+ * Caller must hold slow->lock. Returns true if the slow device already got
+ * its share of sysctl_swap_ratio_slow_cap for the current second, and
+ * otherwise accounts one more slot to it.
+ */
+static bool slow_write_capped(struct swap_info_struct *slow)
+{
+	unsigned int cap = sysctl_swap_ratio_slow_cap;
+
+	if (!cap)
+		return false;
+
+	if (time_after(jiffies, slow->cap_window + HZ)) {
+		slow->cap_window = jiffies;
+		slow->cap_writes = 0;
+	}
+
+	if (slow->cap_writes >= cap >> (PAGE_SHIFT - 10))
+		return true;
+
+	slow->cap_writes++;
+	return false;
+}
+
 static bool is_same_group(struct swap_info_struct *a,
 		struct swap_info_struct *b)
 {
@@ -60,6 +154,9 @@ static int calculate_write_pending(struct swap_info_struct *si,
 	if ((n->flags & SWP_FAST) || !is_same_group(si, n))
 		return -ENODEV;
 
+	if (sysctl_swap_ratio_adaptive)
+		ratio = adaptive_ratio(si, n, ratio);
+
 	si->max_writes = ratio ? SWAP_FAST_WRITES : 0;
 	n->max_writes  = ratio ? (SWAP_FAST_WRITES * 100) /
 			ratio - SWAP_FAST_WRITES : SWAP_SLOW_WRITES;
@@ -104,7 +201,7 @@ static int swap_ratio_slow(struct swap_info_struct **si)
 			if ((n->flags & SWP_FAST) || !is_same_group(*si, n)) {
 				/* Should never happen */
 				ret = -ENODEV;
-			} else if (n->write_pending) {
+			} else if (n->write_pending && !slow_write_capped(n)) {
 				/*
 				 * Requeue fast device, since there are pending
 				 * writes for slow device.
@@ -141,7 +238,7 @@ static int swap_ratio_slow(struct swap_info_struct **si)
 			*si = n;
 			goto skip;
 		} else {
-			if ((*si)->write_pending) {
+			if ((*si)->write_pending && !slow_write_capped(*si)) {
 				(*si)->write_pending--;
 			} else {
 				if (0 > calculate_write_pending(n, *si)) {
@@ -30,6 +30,7 @@
 #include <linux/compiler.h>
 #include <linux/llist.h>
 #include <linux/bitops.h>
+#include <linux/workqueue.h>
 
 #include <asm/uaccess.h>
 #include <asm/tlbflush.h>
@@ -279,7 +280,8 @@ EXPORT_SYMBOL(vmalloc_to_pfn);
 static DEFINE_SPINLOCK(vmap_area_lock);
 /* Export for kexec only */
 LIST_HEAD(vmap_area_list);
-static LLIST_HEAD(vmap_purge_list);
+/* Lazily freed areas, queued on the CPU that freed them */
+static DEFINE_PER_CPU(struct llist_head, vmap_purge_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 
 /* The vmap cache globals are protected by vmap_area_lock */
@@ -650,7 +652,29 @@ static void purge_fragmented_blocks_allcpus(void);
  */
 void set_iounmap_nonlazy(void)
 {
-	atomic_set(&vmap_lazy_nr, lazy_max_pages()+1);
+	atomic_set(&vmap_lazy_nr, 2 * lazy_max_pages() + 1);
+}
+
+/*
+ * Take the lazily-freed areas off every CPU's list and chain them into
+ * a single list.
+ */
+static struct llist_node *vmap_purge_list_del_all(void)
+{
+	struct llist_node *valist = NULL, *list, *tail;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		list = llist_del_all(per_cpu_ptr(&vmap_purge_list, cpu));
+		if (!list)
+			continue;
+		for (tail = list; tail->next; tail = tail->next)
+			;
+		tail->next = valist;
+		valist = list;
+	}
+
+	return valist;
 }
 
 /*
@@ -661,23 +685,24 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	struct llist_node *valist;
 	struct vmap_area *va;
 	struct vmap_area *n_va;
-	bool do_free = false;
+	unsigned long nr_areas = 0, nr_pages = 0;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
-	valist = llist_del_all(&vmap_purge_list);
+	valist = vmap_purge_list_del_all();
 	llist_for_each_entry(va, valist, purge_list) {
 		if (va->va_start < start)
 			start = va->va_start;
 		if (va->va_end > end)
 			end = va->va_end;
-		do_free = true;
+		nr_areas++;
 	}
 
-	if (!do_free)
+	if (!nr_areas)
 		return false;
 
 	flush_tlb_kernel_range(start, end);
+	count_vm_events(VMAP_PURGE_FLUSH_PAGES, (end - start) >> PAGE_SHIFT);
 
 	spin_lock(&vmap_area_lock);
 	llist_for_each_entry_safe(va, n_va, valist, purge_list) {
@@ -685,12 +710,32 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 
 		__free_vmap_area(va);
 		atomic_sub(nr, &vmap_lazy_nr);
+		nr_pages += nr;
 		cond_resched_lock(&vmap_area_lock);
 	}
 	spin_unlock(&vmap_area_lock);
+
+	count_vm_events(VMAP_PURGE_AREAS, nr_areas);
+	count_vm_events(VMAP_PURGE_PAGES, nr_pages);
 	return true;
 }
 
+/*
+ * Once more than lazy_max_pages() are pending, the purge is handed to
+ * a worker so that the CPU doing vunmap() does not take the TLB flush.
+ * Only when the backlog grows past twice that does the caller purge
+ * synchronously to keep the address space from running out.
+ */
+static void vmap_purge_workfn(struct work_struct *work)
+{
+	mutex_lock(&vmap_purge_lock);
+	if (__purge_vmap_area_lazy(ULONG_MAX, 0))
+		count_vm_event(VMAP_PURGE_BG);
+	mutex_unlock(&vmap_purge_lock);
+}
+
+static DECLARE_WORK(vmap_purge_work, vmap_purge_workfn);
+
 /*
  * Kick off a purge of the outstanding lazy areas. Don't bother if somebody
  * is already purging.
@@ -698,7 +743,8 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 static void try_purge_vmap_area_lazy(void)
 {
 	if (mutex_trylock(&vmap_purge_lock)) {
-		__purge_vmap_area_lazy(ULONG_MAX, 0);
+		if (__purge_vmap_area_lazy(ULONG_MAX, 0))
+			count_vm_event(VMAP_PURGE_SYNC);
 		mutex_unlock(&vmap_purge_lock);
 	}
 }
@@ -710,7 +756,8 @@ static void purge_vmap_area_lazy(void)
 {
 	mutex_lock(&vmap_purge_lock);
 	purge_fragmented_blocks_allcpus();
-	__purge_vmap_area_lazy(ULONG_MAX, 0);
+	if (__purge_vmap_area_lazy(ULONG_MAX, 0))
+		count_vm_event(VMAP_PURGE_SYNC);
 	mutex_unlock(&vmap_purge_lock);
 }
 
@@ -721,15 +768,23 @@ static void purge_vmap_area_lazy(void)
  */
 static void free_vmap_area_noflush(struct vmap_area *va)
 {
+	unsigned long max_lazy;
 	int nr_lazy;
 
 	nr_lazy = atomic_add_return((va->va_end - va->va_start) >> PAGE_SHIFT,
 				    &vmap_lazy_nr);
 
 	/* After this point, we may free va at any time */
-	llist_add(&va->purge_list, &vmap_purge_list);
+	llist_add(&va->purge_list, raw_cpu_ptr(&vmap_purge_list));
 
-	if (unlikely(nr_lazy > lazy_max_pages()))
+	max_lazy = lazy_max_pages();
+	if (likely(nr_lazy <= max_lazy))
+		return;
+
+	/* Workqueues are not up yet during early boot */
+	if (nr_lazy <= 2 * max_lazy && system_unbound_wq)
+		queue_work(system_unbound_wq, &vmap_purge_work);
+	else
 		try_purge_vmap_area_lazy();
 }
 
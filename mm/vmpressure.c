@@ -25,6 +25,10 @@
 #include <linux/notifier.h>
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -445,6 +449,333 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio, int order)
 	__vmpressure(gfp, memcg, true, 0, 0);
 }
 
+/*
+ * Time based stall accounting. The scanned/reclaimed ratio above says how
+ * hard reclaim works, not what it costs the tasks waiting on it. Tasks in
+ * direct reclaim or compaction are accounted between
+ * vmpressure_memstall_enter() and _leave(), against the global state and
+ * their memcg hierarchy, and the time during which at least one task
+ * ("some"), or every runnable task ("full"), was stalled is summed up.
+ *
+ * Userspace reads the totals from /proc/pressure/memory or a memcg's
+ * memory.pressure file, and may write "<some|full> <stall us> <window us>"
+ * to it to be woken with POLLPRI when stall time within a window exceeds
+ * the threshold.
+ */
+#define VMPRESSURE_STALL_POLL	(HZ / 20)
+#define VMPRESSURE_WINDOW_MIN	(500 * NSEC_PER_MSEC)
+#define VMPRESSURE_WINDOW_MAX	(10 * NSEC_PER_SEC)
+
+static bool vmpressure_stall_ready;
+
+static const char * const vmpressure_str_stall[] = {
+	[VMPRESSURE_STALL_SOME] = "some",
+	[VMPRESSURE_STALL_FULL] = "full",
+};
+
+struct vmpressure_trigger {
+	struct vmpressure_stall *ms;
+	struct list_head node;
+	enum vmpressure_stall_states state;
+	u64 threshold;
+	u64 window;
+	u64 win_start;
+	u64 win_total;
+	u64 prev_growth;
+	u64 last_event;
+	atomic_t event;
+	wait_queue_head_t wait;
+};
+
+static u64 memstall_total(struct vmpressure_stall *ms, int state, u64 now)
+{
+	u64 total = ms->total[state];
+
+	if (ms->state[state])
+		total += now - ms->state_start[state];
+	return total;
+}
+
+/* Called with ms->lock held */
+static void memstall_update(struct vmpressure_stall *ms, u64 now)
+{
+	bool state[NR_VMPRESSURE_STALL];
+	int i;
+
+	state[VMPRESSURE_STALL_SOME] = ms->nr_stalled > 0;
+	/*
+	 * What every other task is doing isn't tracked, so "full" is taken
+	 * as no more tasks being runnable in the system than are stalled
+	 * on this group. It is re-evaluated on every stall transition and
+	 * poll tick only.
+	 */
+	state[VMPRESSURE_STALL_FULL] = ms->nr_stalled &&
+				       ms->nr_stalled >= nr_running();
+
+	for (i = 0; i < NR_VMPRESSURE_STALL; i++) {
+		if (state[i] == ms->state[i])
+			continue;
+		if (state[i])
+			ms->state_start[i] = now;
+		else
+			ms->total[i] += now - ms->state_start[i];
+		ms->state[i] = state[i];
+	}
+}
+
+/* Called with ms->lock held */
+static void memstall_check_triggers(struct vmpressure_stall *ms, u64 now)
+{
+	struct vmpressure_trigger *t;
+
+	list_for_each_entry(t, &ms->triggers, node) {
+		u64 total = memstall_total(ms, t->state, now);
+		u64 elapsed = now - t->win_start;
+		u64 growth;
+
+		if (elapsed >= t->window) {
+			/* A stale window says nothing about the last one */
+			if (elapsed < 2 * t->window)
+				t->prev_growth = total - t->win_total;
+			else
+				t->prev_growth = 0;
+			t->win_start = now;
+			t->win_total = total;
+			elapsed = 0;
+		}
+
+		/*
+		 * Count the part of the previous window the current one
+		 * doesn't cover yet, so that a stall straddling a window
+		 * boundary isn't missed.
+		 */
+		growth = total - t->win_total;
+		growth += div64_u64(t->prev_growth *
+				    div_u64(t->window - elapsed, NSEC_PER_USEC),
+				    div_u64(t->window, NSEC_PER_USEC));
+		if (growth < t->threshold)
+			continue;
+
+		/* At most one event per window */
+		if (now < t->last_event + t->window)
+			continue;
+
+		t->last_event = now;
+		atomic_set(&t->event, 1);
+		wake_up_interruptible(&t->wait);
+	}
+}
+
+static void memstall_change(struct vmpressure *vmpr, int delta)
+{
+	struct vmpressure_stall *ms = &vmpr->memstall;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+
+	spin_lock_irqsave(&ms->lock, flags);
+	ms->nr_stalled += delta;
+	memstall_update(ms, now);
+	if (!list_empty(&ms->triggers)) {
+		memstall_check_triggers(ms, now);
+		if (ms->nr_stalled)
+			schedule_delayed_work(&ms->poll_work,
+					      VMPRESSURE_STALL_POLL);
+	}
+	spin_unlock_irqrestore(&ms->lock, flags);
+}
+
+/* Catches stalls that last long enough to exceed a trigger on their own */
+static void memstall_poll_fn(struct work_struct *work)
+{
+	struct vmpressure_stall *ms = container_of(to_delayed_work(work),
+					struct vmpressure_stall, poll_work);
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+
+	spin_lock_irqsave(&ms->lock, flags);
+	memstall_update(ms, now);
+	memstall_check_triggers(ms, now);
+	if (ms->nr_stalled && !list_empty(&ms->triggers))
+		schedule_delayed_work(&ms->poll_work, VMPRESSURE_STALL_POLL);
+	spin_unlock_irqrestore(&ms->lock, flags);
+}
+
+static void memstall_account(struct mem_cgroup *memcg, int delta)
+{
+	memstall_change(&global_vmpressure, delta);
+#ifdef CONFIG_MEMCG
+	for (; memcg; memcg = parent_mem_cgroup(memcg))
+		memstall_change(memcg_to_vmpressure(memcg), delta);
+#endif
+}
+
+/**
+ * vmpressure_memstall_enter() - Mark current as stalled on memory
+ * @cookie:	state to hand back to vmpressure_memstall_leave()
+ *
+ * To be called by a task before it does reclaim or compaction on behalf of
+ * its own allocation. Nested calls are only accounted once.
+ */
+void vmpressure_memstall_enter(struct memstall_cookie *cookie)
+{
+	cookie->memcg = NULL;
+	cookie->nested = current->in_memstall || !vmpressure_stall_ready;
+	if (cookie->nested)
+		return;
+
+	current->in_memstall = 1;
+#ifdef CONFIG_MEMCG
+	if (!mem_cgroup_disabled()) {
+		struct mem_cgroup *memcg;
+
+		rcu_read_lock();
+		memcg = mem_cgroup_from_task(current);
+		if (memcg && css_tryget(&memcg->css))
+			cookie->memcg = memcg;
+		rcu_read_unlock();
+	}
+#endif
+	memstall_account(cookie->memcg, 1);
+}
+
+/**
+ * vmpressure_memstall_leave() - End a stall started by _enter()
+ * @cookie:	state filled in by vmpressure_memstall_enter()
+ */
+void vmpressure_memstall_leave(struct memstall_cookie *cookie)
+{
+	if (cookie->nested)
+		return;
+
+	memstall_account(cookie->memcg, -1);
+#ifdef CONFIG_MEMCG
+	if (cookie->memcg)
+		css_put(&cookie->memcg->css);
+#endif
+	current->in_memstall = 0;
+}
+
+/**
+ * vmpressure_stall_show() - Print the stall totals of a vmpressure group
+ * @m:		seq_file to print to
+ * @vmpr:	group to report on
+ *
+ * Totals are in microseconds.
+ */
+int vmpressure_stall_show(struct seq_file *m, struct vmpressure *vmpr)
+{
+	struct vmpressure_stall *ms = &vmpr->memstall;
+	u64 total[NR_VMPRESSURE_STALL];
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+	int i;
+
+	spin_lock_irqsave(&ms->lock, flags);
+	for (i = 0; i < NR_VMPRESSURE_STALL; i++)
+		total[i] = memstall_total(ms, i, now);
+	spin_unlock_irqrestore(&ms->lock, flags);
+
+	for (i = 0; i < NR_VMPRESSURE_STALL; i++)
+		seq_printf(m, "%s total=%llu\n", vmpressure_str_stall[i],
+			   div_u64(total[i], NSEC_PER_USEC));
+	return 0;
+}
+
+/**
+ * vmpressure_trigger_create() - Set up a stall time trigger
+ * @vmpr:	group to watch
+ * @buf:	"<some|full> <stall us> <window us>"
+ *
+ * Returns the new trigger or an ERR_PTR().
+ */
+struct vmpressure_trigger *vmpressure_trigger_create(struct vmpressure *vmpr,
+						     char *buf)
+{
+	struct vmpressure_stall *ms = &vmpr->memstall;
+	struct vmpressure_trigger *t;
+	enum vmpressure_stall_states state;
+	unsigned int threshold_us, window_us;
+	unsigned long flags;
+	u64 now;
+
+	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
+		state = VMPRESSURE_STALL_SOME;
+	else if (sscanf(buf, "full %u %u", &threshold_us, &window_us) == 2)
+		state = VMPRESSURE_STALL_FULL;
+	else
+		return ERR_PTR(-EINVAL);
+
+	if ((u64)window_us * NSEC_PER_USEC < VMPRESSURE_WINDOW_MIN ||
+	    (u64)window_us * NSEC_PER_USEC > VMPRESSURE_WINDOW_MAX)
+		return ERR_PTR(-EINVAL);
+
+	if (!threshold_us || threshold_us > window_us)
+		return ERR_PTR(-EINVAL);
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return ERR_PTR(-ENOMEM);
+
+	t->ms = ms;
+	t->state = state;
+	t->threshold = (u64)threshold_us * NSEC_PER_USEC;
+	t->window = (u64)window_us * NSEC_PER_USEC;
+	atomic_set(&t->event, 0);
+	init_waitqueue_head(&t->wait);
+
+	spin_lock_irqsave(&ms->lock, flags);
+	now = ktime_get_ns();
+	t->win_start = now;
+	t->win_total = memstall_total(ms, state, now);
+	list_add(&t->node, &ms->triggers);
+	if (ms->nr_stalled)
+		schedule_delayed_work(&ms->poll_work, VMPRESSURE_STALL_POLL);
+	spin_unlock_irqrestore(&ms->lock, flags);
+
+	return t;
+}
+
+/**
+ * vmpressure_trigger_destroy() - Remove a trigger set up by _create()
+ * @t:		trigger, may be NULL
+ */
+void vmpressure_trigger_destroy(struct vmpressure_trigger *t)
+{
+	struct vmpressure_stall *ms;
+	unsigned long flags;
+
+	if (!t)
+		return;
+
+	ms = t->ms;
+	spin_lock_irqsave(&ms->lock, flags);
+	list_del(&t->node);
+	spin_unlock_irqrestore(&ms->lock, flags);
+	kfree(t);
+}
+
+/**
+ * vmpressure_trigger_poll() - poll() method for files carrying a trigger
+ * @t:		trigger of the file, or NULL if none was written yet
+ * @file:	file being polled
+ * @wait:	poll table
+ */
+unsigned int vmpressure_trigger_poll(struct vmpressure_trigger *t,
+				     struct file *file,
+				     struct poll_table_struct *wait)
+{
+	unsigned int ret = DEFAULT_POLLMASK;
+
+	if (!t)
+		return ret | POLLERR | POLLPRI;
+
+	poll_wait(file, &t->wait, wait);
+	if (atomic_cmpxchg(&t->event, 1, 0) == 1)
+		ret |= POLLPRI;
+
+	return ret;
+}
+
 /**
  * vmpressure_register_event() - Bind vmpressure notifications to an eventfd
  * @memcg:	memcg that is interested in vmpressure notifications
@@ -535,6 +866,10 @@ void vmpressure_init(struct vmpressure *vmpr)
 	INIT_WORK(&vmpr->work, vmpressure_work_fn);
 	atomic_long_set(&vmpr->users, 0);
 	rwlock_init(&vmpr->users_lock);
+
+	spin_lock_init(&vmpr->memstall.lock);
+	INIT_LIST_HEAD(&vmpr->memstall.triggers);
+	INIT_DELAYED_WORK(&vmpr->memstall.poll_work, memstall_poll_fn);
 }
 
 /**
@@ -551,11 +886,100 @@ void vmpressure_cleanup(struct vmpressure *vmpr)
 	 * goes away.
 	 */
 	flush_work(&vmpr->work);
+	cancel_delayed_work_sync(&vmpr->memstall.poll_work);
+}
+
+#ifdef CONFIG_PROC_FS
+static DEFINE_MUTEX(memory_pressure_lock);
+
+static int memory_pressure_show(struct seq_file *m, void *v)
+{
+	return vmpressure_stall_show(m, &global_vmpressure);
+}
+
+static int memory_pressure_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, memory_pressure_show, NULL);
+}
+
+static ssize_t memory_pressure_write(struct file *file,
+				     const char __user *user_buf,
+				     size_t nbytes, loff_t *ppos)
+{
+	struct seq_file *seq = file->private_data;
+	struct vmpressure_trigger *t;
+	char buf[32];
+	size_t len;
+
+	if (!nbytes)
+		return -EINVAL;
+
+	len = min(nbytes, sizeof(buf) - 1);
+	if (copy_from_user(buf, user_buf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	mutex_lock(&memory_pressure_lock);
+	/* One trigger per open file */
+	if (seq->private) {
+		mutex_unlock(&memory_pressure_lock);
+		return -EBUSY;
+	}
+
+	t = vmpressure_trigger_create(&global_vmpressure, strstrip(buf));
+	if (IS_ERR(t)) {
+		mutex_unlock(&memory_pressure_lock);
+		return PTR_ERR(t);
+	}
+	smp_store_release(&seq->private, t);
+	mutex_unlock(&memory_pressure_lock);
+
+	return nbytes;
 }
 
+static unsigned int memory_pressure_poll(struct file *file, poll_table *wait)
+{
+	struct seq_file *seq = file->private_data;
+
+	return vmpressure_trigger_poll(smp_load_acquire(&seq->private),
+				       file, wait);
+}
+
+static int memory_pressure_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+
+	vmpressure_trigger_destroy(seq->private);
+	return single_release(inode, file);
+}
+
+static const struct file_operations memory_pressure_fops = {
+	.open		= memory_pressure_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.write		= memory_pressure_write,
+	.poll		= memory_pressure_poll,
+	.release	= memory_pressure_release,
+};
+
+static void __init memory_pressure_proc_init(void)
+{
+	if (!proc_mkdir("pressure", NULL))
+		return;
+	proc_create("pressure/memory", S_IRUGO | S_IWUSR, NULL,
+		    &memory_pressure_fops);
+}
+#else
+static inline void memory_pressure_proc_init(void)
+{
+}
+#endif
+
 static int __init vmpressure_global_init(void)
 {
 	vmpressure_init(&global_vmpressure);
+	vmpressure_stall_ready = true;
+	memory_pressure_proc_init();
 	return 0;
 }
 late_initcall(vmpressure_global_init);
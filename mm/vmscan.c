@@ -47,6 +47,7 @@
 #include <linux/prefetch.h>
 #include <linux/printk.h>
 #include <linux/simple_lmk.h>
+#include <linux/pid_namespace.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -1905,6 +1906,163 @@ static void move_active_pages_to_lru(struct lruvec *lruvec,
 		__count_vm_events(PGDEACTIVATE, pgmoved);
 }
 
+/*
+ * Page table walk aging.
+ *
+ * With vm.lru_aging_mode = LRU_AGING_WALK, the accessed bits of mapped pages
+ * are harvested by walking process page tables in batches rather than by an
+ * rmap walk for every page that shrink_active_list() looks at. A young
+ * inactive page is activated, a young active page gets PG_referenced and is
+ * rotated by the next shrink_active_list(). Unreferenced pages, anon or file,
+ * are deactivated. Each pass over all processes is a generation; a new
+ * generation is started at most every LRU_WALK_GEN_INTERVAL.
+ */
+int sysctl_lru_aging_mode __read_mostly = LRU_AGING_CLASSIC;
+
+#define LRU_WALK_BATCH		16
+#define LRU_WALK_GEN_INTERVAL	(HZ / 2)
+
+static DEFINE_MUTEX(lru_walk_lock);
+static int lru_walk_next_pid;
+static unsigned long lru_walk_gen_start;
+
+static inline bool lru_aging_walk(void)
+{
+	return READ_ONCE(sysctl_lru_aging_mode) == LRU_AGING_WALK;
+}
+
+static void lru_walk_young(struct page *page)
+{
+	count_vm_event(LRU_WALK_PTE_YOUNG);
+	if (PageActive(page)) {
+		SetPageReferenced(page);
+	} else if (PageLRU(page) && !PageUnevictable(page)) {
+		activate_page(page);
+		count_vm_event(LRU_WALK_ACTIVATE);
+	}
+}
+
+static int lru_walk_pmd_range(pmd_t *pmd, unsigned long addr,
+			      unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->vma;
+	unsigned long nr_scanned = 0;
+	spinlock_t *ptl;
+	pte_t *pte, *orig_pte;
+
+	if (pmd_trans_huge_lock(pmd, vma, &ptl) == 1) {
+		count_vm_event(LRU_WALK_PTE_SCANNED);
+		if (pmdp_test_and_clear_young(vma, addr, pmd))
+			lru_walk_young(pmd_page(*pmd));
+		spin_unlock(ptl);
+		return 0;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		struct page *page;
+
+		if (!pte_present(*pte))
+			continue;
+
+		nr_scanned++;
+		if (!ptep_test_and_clear_young(vma, addr, pte))
+			continue;
+
+		page = vm_normal_page(vma, addr, *pte);
+		if (page)
+			lru_walk_young(page);
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	count_vm_events(LRU_WALK_PTE_SCANNED, nr_scanned);
+	cond_resched();
+	return 0;
+}
+
+static int lru_walk_test_walk(unsigned long start, unsigned long end,
+			      struct mm_walk *walk)
+{
+	/* mlocked pages are unevictable, special mappings have no LRU pages */
+	return !!(walk->vma->vm_flags & (VM_LOCKED | VM_SPECIAL));
+}
+
+static void lru_walk_mm(struct mm_struct *mm)
+{
+	struct mm_walk walk = {
+		.pmd_entry = lru_walk_pmd_range,
+		.test_walk = lru_walk_test_walk,
+		.mm = mm,
+	};
+
+	/* Do not stall reclaim behind a faulting or mapping process */
+	if (!down_read_trylock(&mm->mmap_sem)) {
+		count_vm_event(LRU_WALK_MM_SKIPPED);
+		return;
+	}
+	walk_page_range(0, mm->highest_vm_end, &walk);
+	up_read(&mm->mmap_sem);
+	count_vm_event(LRU_WALK_MM);
+}
+
+/*
+ * Walk the next LRU_WALK_BATCH processes, in pid order, of the current
+ * generation. Only one reclaimer walks at a time; the others carry on with
+ * whatever aging information is already there.
+ */
+static void lru_walk_age(void)
+{
+	struct mm_struct *mms[LRU_WALK_BATCH];
+	int nr = 0, i;
+	int pid;
+
+	if (!mutex_trylock(&lru_walk_lock))
+		return;
+
+	pid = lru_walk_next_pid;
+	if (!pid) {
+		if (lru_walk_gen_start &&
+		    time_before(jiffies, lru_walk_gen_start +
+				LRU_WALK_GEN_INTERVAL))
+			goto unlock;
+		lru_walk_gen_start = jiffies;
+		count_vm_event(LRU_WALK_GEN);
+	}
+
+	rcu_read_lock();
+	while (nr < LRU_WALK_BATCH) {
+		struct pid *p = find_ge_pid(pid + 1, &init_pid_ns);
+		struct task_struct *task;
+		struct mm_struct *mm;
+
+		if (!p) {
+			pid = 0;
+			break;
+		}
+		pid = pid_nr(p);
+
+		task = pid_task(p, PIDTYPE_PID);
+		if (!task || !thread_group_leader(task))
+			continue;
+
+		mm = get_task_mm(task);
+		if (mm)
+			mms[nr++] = mm;
+	}
+	rcu_read_unlock();
+	lru_walk_next_pid = pid;
+
+	for (i = 0; i < nr; i++) {
+		lru_walk_mm(mms[i]);
+		mmput(mms[i]);
+	}
+unlock:
+	mutex_unlock(&lru_walk_lock);
+}
+
 static void shrink_active_list(unsigned long nr_to_scan,
 			       struct lruvec *lruvec,
 			       struct scan_control *sc,
@@ -1922,6 +2080,10 @@ static void shrink_active_list(unsigned long nr_to_scan,
 	isolate_mode_t isolate_mode = 0;
 	int file = is_file_lru(lru);
 	struct zone *zone = lruvec_zone(lruvec);
+	bool walk = lru_aging_walk();
+
+	if (walk)
+		lru_walk_age();
 
 	lru_add_drain();
 
@@ -1962,7 +2124,18 @@ static void shrink_active_list(unsigned long nr_to_scan,
 			}
 		}
 
-		if (page_referenced(page, 0, sc->target_mem_cgroup,
+		if (walk) {
+			/*
+			 * The page table walk already moved the accessed bits
+			 * of mapped pages to PG_referenced, no rmap walk.
+			 */
+			if (TestClearPageReferenced(page)) {
+				nr_rotated += hpage_nr_pages(page);
+				count_vm_event(LRU_WALK_ROTATED);
+				list_add(&page->lru, &l_active);
+				continue;
+			}
+		} else if (page_referenced(page, 0, sc->target_mem_cgroup,
 				    &vm_flags)) {
 			nr_rotated += hpage_nr_pages(page);
 			/*
@@ -2512,6 +2685,110 @@ static inline bool should_continue_reclaim(struct zone *zone,
 	}
 }
 
+/*
+ * Swappiness and scan priority adjustments for the memcg reclaim classes.
+ * Cached apps have their anon pages pushed out to swap more eagerly and
+ * are scanned at twice the rate; the visible and foreground classes lean
+ * towards dropping file pages instead. A swappiness of 0 is honoured.
+ */
+static const int reclaim_class_swappiness_bias[NR_MEMCG_RECLAIM_CLASSES] = {
+	[MEMCG_RECLAIM_CACHED]		= 60,
+	[MEMCG_RECLAIM_DEFAULT]		= 0,
+	[MEMCG_RECLAIM_VISIBLE]		= -20,
+	[MEMCG_RECLAIM_FOREGROUND]	= -40,
+};
+
+/*
+ * The foreground class is left alone while the other classes are still
+ * giving up pages, until reclaim priority drops to this level.
+ */
+#define RECLAIM_CLASS_FOREGROUND_PRIORITY	(DEF_PRIORITY - 2)
+
+static int reclaim_class_swappiness(int class, int swappiness)
+{
+	if (!swappiness)
+		return 0;
+
+	return clamp(swappiness + reclaim_class_swappiness_bias[class], 1, 180);
+}
+
+/*
+ * Shrink the lruvecs of @zone in the hierarchy below sc->target_mem_cgroup.
+ * When @class is non-negative, only memcgs of that reclaim class are
+ * visited. @reclaim may be NULL to walk the whole hierarchy from the start.
+ */
+static void shrink_zone_memcgs(struct zone *zone, struct scan_control *sc,
+			       bool is_classzone,
+			       struct mem_cgroup_reclaim_cookie *reclaim,
+			       int class, unsigned long *zone_lru_pages)
+{
+	struct mem_cgroup *root = sc->target_mem_cgroup;
+	struct mem_cgroup *memcg;
+
+	memcg = mem_cgroup_iter(root, NULL, reclaim);
+	do {
+		unsigned long lru_pages;
+		unsigned long scanned, reclaimed;
+		struct lruvec *lruvec;
+		int swappiness, memcg_class, priority;
+
+		memcg_class = mem_cgroup_reclaim_class(memcg);
+		if (class >= 0 && memcg_class != class)
+			continue;
+
+		if (mem_cgroup_low(root, memcg)) {
+			if (!sc->may_thrash)
+				continue;
+			mem_cgroup_events(memcg, MEMCG_LOW, 1);
+		}
+
+		lruvec = mem_cgroup_zone_lruvec(zone, memcg);
+		swappiness = mem_cgroup_swappiness(memcg);
+		scanned = sc->nr_scanned;
+		reclaimed = sc->nr_reclaimed;
+		priority = sc->priority;
+
+		if (class >= 0) {
+			swappiness = reclaim_class_swappiness(memcg_class,
+							      swappiness);
+			if (memcg_class == MEMCG_RECLAIM_CACHED && priority)
+				sc->priority--;
+		}
+
+		shrink_lruvec(lruvec, swappiness, sc, &lru_pages);
+		*zone_lru_pages += lru_pages;
+		sc->priority = priority;
+
+		if (class >= 0) {
+			count_vm_events(PGSCAN_CLASS_CACHED + memcg_class,
+					sc->nr_scanned - scanned);
+			count_vm_events(PGSTEAL_CLASS_CACHED + memcg_class,
+					sc->nr_reclaimed - reclaimed);
+		}
+
+		if (memcg && is_classzone)
+			shrink_slab(sc->gfp_mask, zone_to_nid(zone),
+				    memcg, sc->nr_scanned - scanned,
+				    lru_pages);
+
+		/*
+		 * Direct reclaim and kswapd have to scan all memory
+		 * cgroups to fulfill the overall scan target for the
+		 * zone.
+		 *
+		 * Limit reclaim, on the other hand, only cares about
+		 * nr_to_reclaim pages to be reclaimed and it will
+		 * retry with decreasing priority if one round over the
+		 * whole hierarchy is not sufficient.
+		 */
+		if (!global_reclaim(sc) &&
+				sc->nr_reclaimed >= sc->nr_to_reclaim) {
+			mem_cgroup_iter_break(root, memcg);
+			break;
+		}
+	} while ((memcg = mem_cgroup_iter(root, memcg, reclaim)));
+}
+
 static bool shrink_zone(struct zone *zone, struct scan_control *sc,
 			bool is_classzone)
 {
@@ -2520,58 +2797,41 @@ static bool shrink_zone(struct zone *zone, struct scan_control *sc,
 	bool reclaimable = false;
 
 	do {
-		struct mem_cgroup *root = sc->target_mem_cgroup;
 		struct mem_cgroup_reclaim_cookie reclaim = {
 			.zone = zone,
 			.priority = sc->priority,
 		};
 		unsigned long zone_lru_pages = 0;
-		struct mem_cgroup *memcg;
+		int class;
 
 		nr_reclaimed = sc->nr_reclaimed;
 		nr_scanned = sc->nr_scanned;
 
-		memcg = mem_cgroup_iter(root, NULL, &reclaim);
-		do {
-			unsigned long lru_pages;
-			unsigned long scanned;
-			struct lruvec *lruvec;
-			int swappiness;
-
-			if (mem_cgroup_low(root, memcg)) {
-				if (!sc->may_thrash)
-					continue;
-				mem_cgroup_events(memcg, MEMCG_LOW, 1);
-			}
-
-			lruvec = mem_cgroup_zone_lruvec(zone, memcg);
-			swappiness = mem_cgroup_swappiness(memcg);
-			scanned = sc->nr_scanned;
-
-			shrink_lruvec(lruvec, swappiness, sc, &lru_pages);
-			zone_lru_pages += lru_pages;
-
-			if (memcg && is_classzone)
-				shrink_slab(sc->gfp_mask, zone_to_nid(zone),
-					    memcg, sc->nr_scanned - scanned,
-					    lru_pages);
-
+		if (global_reclaim(sc) && mem_cgroup_reclaim_classes_enabled()) {
 			/*
-			 * Direct reclaim and kswapd have to scan all memory
-			 * cgroups to fulfill the overall scan target for the
-			 * zone.
-			 *
-			 * Limit reclaim, on the other hand, only cares about
-			 * nr_to_reclaim pages to be reclaimed and it will
-			 * retry with decreasing priority if one round over the
-			 * whole hierarchy is not sufficient.
+			 * Work through the reclaim classes from cached to
+			 * foreground and stop as soon as the target is met.
+			 * Each class is walked from the top of the
+			 * hierarchy, the shared iterator would mix them up.
 			 */
-			if (!global_reclaim(sc) &&
-					sc->nr_reclaimed >= sc->nr_to_reclaim) {
-				mem_cgroup_iter_break(root, memcg);
-				break;
+			for (class = 0; class < NR_MEMCG_RECLAIM_CLASSES;
+			     class++) {
+				if (class == MEMCG_RECLAIM_FOREGROUND &&
+				    sc->priority > RECLAIM_CLASS_FOREGROUND_PRIORITY &&
+				    sc->nr_reclaimed > nr_reclaimed) {
+					count_vm_event(RECLAIM_CLASS_FOREGROUND_SKIPPED);
+					break;
+				}
+				shrink_zone_memcgs(zone, sc, is_classzone,
+						   NULL, class,
+						   &zone_lru_pages);
+				if (sc->nr_reclaimed >= sc->nr_to_reclaim)
+					break;
 			}
-		} while ((memcg = mem_cgroup_iter(root, memcg, &reclaim)));
+		} else {
+			shrink_zone_memcgs(zone, sc, is_classzone, &reclaim,
+					   -1, &zone_lru_pages);
+		}
 
 		/*
 		 * Shrink the slab caches in the same proportion that
@@ -3063,6 +3323,7 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 					   bool may_swap)
 {
 	struct zonelist *zonelist;
+	struct memstall_cookie memstall;
 	unsigned long nr_reclaimed;
 	int nid;
 	struct scan_control sc = {
@@ -3089,9 +3350,11 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 					    sc.may_writepage,
 					    sc.gfp_mask);
 
+	vmpressure_memstall_enter(&memstall);
 	current->flags |= PF_MEMALLOC;
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc);
 	current->flags &= ~PF_MEMALLOC;
+	vmpressure_memstall_leave(&memstall);
 
 	trace_mm_vmscan_memcg_reclaim_end(nr_reclaimed);
 
@@ -3548,6 +3811,7 @@ static int kswapd(void *p)
 	int balanced_classzone_idx;
 	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
+	u64 exec_ns = 0;
 
 	struct reclaim_state reclaim_state = {
 		.reclaimed_slab = 0,
@@ -3617,9 +3881,17 @@ static int kswapd(void *p)
 		 * after returning from the refrigerator
 		 */
 		if (!ret) {
+			u64 exec_start = task_sched_runtime(tsk);
+
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
 			balanced_classzone_idx = balance_pgdat(pgdat, order,
 								classzone_idx);
+
+			exec_ns += task_sched_runtime(tsk) - exec_start;
+			if (exec_ns >= NSEC_PER_MSEC)
+				count_vm_events(KSWAPD_EXEC_MS,
+					div64_u64_rem(exec_ns, NSEC_PER_MSEC,
+						      &exec_ns));
 		}
 	}
 
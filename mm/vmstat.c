@@ -495,7 +495,8 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 			 * if not then there is nothing to expire.
 			 */
 			if (!__this_cpu_read(p->expire) ||
-			       !__this_cpu_read(p->pcp.count))
+			       (!__this_cpu_read(p->pcp.count) &&
+				!__this_cpu_read(p->pcp.hcount)))
 				continue;
 
 			/*
@@ -509,7 +510,8 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 			if (__this_cpu_dec_return(p->expire))
 				continue;
 
-			if (__this_cpu_read(p->pcp.count)) {
+			if (__this_cpu_read(p->pcp.count) ||
+			    __this_cpu_read(p->pcp.hcount)) {
 				drain_zone_pages(zone, this_cpu_ptr(&p->pcp));
 				changes++;
 			}
@@ -695,6 +697,24 @@ int fragmentation_index(struct zone *zone, unsigned int order)
 	fill_contig_page_info(zone, order, &info);
 	return __fragmentation_index(order, &info);
 }
+
+/*
+ * Percentage of free memory that is unusable for an allocation of the
+ * given order. Unlike fragmentation_index() this is also meaningful while
+ * such an allocation would still succeed, so it can be used as a target.
+ */
+unsigned int extfrag_for_order(struct zone *zone, unsigned int order)
+{
+	struct contig_page_info info;
+
+	fill_contig_page_info(zone, order, &info);
+	if (!info.free_pages)
+		return 0;
+
+	return div_u64((info.free_pages -
+			(info.free_blocks_suitable << order)) * 100,
+			info.free_pages);
+}
 #endif
 
 #if defined(CONFIG_PROC_FS) || defined(CONFIG_SYSFS) || defined(CONFIG_NUMA)
@@ -808,8 +828,31 @@ const char * const vmstat_text[] = {
 
 	"pgrotated",
 
+	"kswapd_exec_ms",
+	"lru_walk_gen",
+	"lru_walk_mm",
+	"lru_walk_mm_skipped",
+	"lru_walk_pte_scanned",
+	"lru_walk_pte_young",
+	"lru_walk_activate",
+	"lru_walk_rotated",
+	"pgscan_class_cached",
+	"pgscan_class_default",
+	"pgscan_class_visible",
+	"pgscan_class_foreground",
+	"pgsteal_class_cached",
+	"pgsteal_class_default",
+	"pgsteal_class_visible",
+	"pgsteal_class_foreground",
+	"reclaim_class_foreground_skipped",
+
 	"drop_pagecache",
 	"drop_slab",
+	"vmap_purge_bg",
+	"vmap_purge_sync",
+	"vmap_purge_areas",
+	"vmap_purge_pages",
+	"vmap_purge_flush_pages",
 
 #ifdef CONFIG_NUMA_BALANCING
 	"numa_pte_updates",
@@ -830,6 +873,9 @@ const char * const vmstat_text[] = {
 	"compact_fail",
 	"compact_success",
 	"compact_daemon_wake",
+	"compact_proactive_run",
+	"compact_proactive_success",
+	"compact_proactive_throttled",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -843,6 +889,8 @@ const char * const vmstat_text[] = {
 	"unevictable_pgs_munlocked",
 	"unevictable_pgs_cleared",
 	"unevictable_pgs_stranded",
+	"lazy_fork_pte_skipped",
+	"lazy_fork_pte_copied",
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	"thp_fault_alloc",
@@ -1248,11 +1296,17 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              batch: %i"
+			   "\n        high-order count: %i"
+			   "\n        high-order high:  %i"
+			   "\n        high-order batch: %i",
 			   i,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
-			   pageset->pcp.batch);
+			   pageset->pcp.batch,
+			   pageset->pcp.hcount,
+			   pageset->pcp.hhigh,
+			   pageset->pcp.hbatch);
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -219,8 +219,32 @@ void *workingset_eviction(struct address_space *mapping, struct page *page)
 	return pack_shadow(eviction, zone);
 }
 
+static void workingset_memcg_account(struct page *page,
+				     unsigned long refault_distance,
+				     unsigned long active_file)
+{
+	enum mem_cgroup_events_index idx;
+
+	mem_cgroup_page_event(page, MEM_CGROUP_EVENTS_WORKINGSET_REFAULT);
+
+	if (refault_distance <= active_file / 4)
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_25;
+	else if (refault_distance <= active_file / 2)
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_50;
+	else if (refault_distance <= active_file)
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_100;
+	else if (refault_distance <= active_file * 2)
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_200;
+	else if (refault_distance <= active_file * 4)
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_400;
+	else
+		idx = MEM_CGROUP_EVENTS_REFAULT_DIST_MORE;
+	mem_cgroup_page_event(page, idx);
+}
+
 /**
  * workingset_refault - evaluate the refault of a previously evicted page
+ * @page: the page being faulted back in, already charged to its memcg
  * @shadow: shadow entry of the evicted page
  *
  * Calculates and evaluates the refault distance of the previously
@@ -228,16 +252,22 @@ void *workingset_eviction(struct address_space *mapping, struct page *page)
  *
  * Returns %true if the page should be activated, %false otherwise.
  */
-bool workingset_refault(void *shadow)
+bool workingset_refault(struct page *page, void *shadow)
 {
 	unsigned long refault_distance;
+	unsigned long active_file;
 	struct zone *zone;
 
 	unpack_shadow(shadow, &zone, &refault_distance);
 	inc_zone_state(zone, WORKINGSET_REFAULT);
 
-	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+	active_file = zone_page_state(zone, NR_ACTIVE_FILE);
+	workingset_memcg_account(page, refault_distance, active_file);
+
+	if (refault_distance <= active_file) {
 		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		mem_cgroup_page_event(page,
+				      MEM_CGROUP_EVENTS_WORKINGSET_ACTIVATE);
 		return true;
 	}
 	return false;
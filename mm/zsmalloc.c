@@ -50,6 +50,9 @@
 #include <linux/mount.h>
 #include <linux/migrate.h>
 #include <linux/pagemap.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/moduleparam.h>
 
 #define ZSPAGE_MAGIC	0x58
 
@@ -260,6 +263,12 @@ struct zs_pool {
 	 * and unregister_shrinker() will not Oops.
 	 */
 	bool shrinker_enabled;
+
+	/* Background compaction, see zs_compact_thread() */
+	struct task_struct *compact_task;
+	unsigned long bg_compact_runs;
+	unsigned long bg_compact_pages;
+	unsigned int bg_compact_waste;
 #ifdef CONFIG_ZSMALLOC_STAT
 	struct dentry *stat_dentry;
 #endif
@@ -309,6 +318,7 @@ static int zs_register_migration(struct zs_pool *pool);
 static void zs_unregister_migration(struct zs_pool *pool);
 static void migrate_lock_init(struct zspage *zspage);
 static void migrate_read_lock(struct zspage *zspage);
+static int migrate_read_trylock(struct zspage *zspage);
 static void migrate_read_unlock(struct zspage *zspage);
 static void kick_deferred_free(struct zs_pool *pool);
 static void init_deferred_free(struct zs_pool *pool);
@@ -320,6 +330,7 @@ static int zs_register_migration(struct zs_pool *pool) { return 0; }
 static void zs_unregister_migration(struct zs_pool *pool) {}
 static void migrate_lock_init(struct zspage *zspage) {}
 static void migrate_read_lock(struct zspage *zspage) {}
+static int migrate_read_trylock(struct zspage *zspage) { return 1; }
 static void migrate_read_unlock(struct zspage *zspage) {}
 static void kick_deferred_free(struct zs_pool *pool) {}
 static void init_deferred_free(struct zs_pool *pool) {}
@@ -677,6 +688,34 @@ static const struct file_operations zs_stat_size_ops = {
 	.release        = single_release,
 };
 
+static int zs_stats_compact_show(struct seq_file *s, void *v)
+{
+	struct zs_pool *pool = s->private;
+
+	seq_printf(s, "pages_compacted: %lu\n",
+		   atomic_long_read(&pool->stats.pages_compacted));
+	seq_printf(s, "bg_thread: %s\n", pool->compact_task ? "on" : "off");
+	seq_printf(s, "bg_runs: %lu\n", READ_ONCE(pool->bg_compact_runs));
+	seq_printf(s, "bg_pages_compacted: %lu\n",
+		   READ_ONCE(pool->bg_compact_pages));
+	seq_printf(s, "waste_percent: %u\n",
+		   READ_ONCE(pool->bg_compact_waste));
+
+	return 0;
+}
+
+static int zs_stats_compact_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zs_stats_compact_show, inode->i_private);
+}
+
+static const struct file_operations zs_stat_compact_ops = {
+	.open           = zs_stats_compact_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int zs_pool_stat_create(struct zs_pool *pool, const char *name)
 {
 	struct dentry *entry;
@@ -699,6 +738,14 @@ static int zs_pool_stat_create(struct zs_pool *pool, const char *name)
 		return -ENOMEM;
 	}
 
+	entry = debugfs_create_file("compaction", S_IFREG | S_IRUGO,
+			pool->stat_dentry, pool, &zs_stat_compact_ops);
+	if (!entry) {
+		pr_warn("%s: debugfs file entry <%s> creation failed\n",
+				name, "compaction");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -1690,6 +1737,108 @@ out:
 }
 EXPORT_SYMBOL_GPL(zs_free);
 
+static struct size_class *handle_to_class(struct zs_pool *pool,
+					unsigned long handle)
+{
+	struct zspage *zspage;
+	struct page *f_page;
+	unsigned int f_objidx;
+	int class_idx;
+	enum fullness_group fullness;
+
+	pin_tag(handle);
+	obj_to_location(handle_to_obj(handle), &f_page, &f_objidx);
+	zspage = get_zspage(f_page);
+	get_zspage_mapping(zspage, &class_idx, &fullness);
+	unpin_tag(handle);
+
+	/* Migration never moves an object to another class */
+	return pool->size_class[class_idx];
+}
+
+/*
+ * Free @handle with @class->lock already held. Returns false if the
+ * handle belongs to another class and was left alone.
+ */
+static bool zs_free_locked(struct zs_pool *pool, struct size_class *class,
+			unsigned long handle)
+{
+	struct zspage *zspage;
+	struct page *f_page;
+	unsigned long obj;
+	unsigned int f_objidx;
+	int class_idx;
+	enum fullness_group fullness;
+	bool isolated;
+
+	pin_tag(handle);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &f_page, &f_objidx);
+	zspage = get_zspage(f_page);
+
+	get_zspage_mapping(zspage, &class_idx, &fullness);
+	if (pool->size_class[class_idx] != class) {
+		unpin_tag(handle);
+		return false;
+	}
+
+	/*
+	 * zs_page_migrate() takes the zspage lock before class->lock, so
+	 * only try it here. On contention fall back to the ordinary path,
+	 * which waits for the migration with class->lock dropped.
+	 */
+	if (!migrate_read_trylock(zspage)) {
+		unpin_tag(handle);
+		spin_unlock(&class->lock);
+		zs_free(pool, handle);
+		spin_lock(&class->lock);
+		return true;
+	}
+
+	obj_free(class, obj);
+	fullness = fix_fullness_group(class, zspage);
+	isolated = is_zspage_isolated(zspage);
+	migrate_read_unlock(zspage);
+	/* If zspage is isolated, zs_page_putback will free the zspage */
+	if (fullness == ZS_EMPTY && likely(!isolated))
+		free_zspage(pool, class, zspage);
+
+	unpin_tag(handle);
+	cache_free_handle(pool, handle);
+	return true;
+}
+
+/**
+ * zs_free_bulk - free a batch of objects
+ * @pool: pool the objects were allocated from
+ * @handles: handles to free, zero entries are skipped
+ * @nr: number of entries in @handles
+ *
+ * Equivalent to calling zs_free() on every handle, but takes each size
+ * class lock once for all of its objects in the batch instead of once per
+ * object. The array is consumed: every entry is zero on return.
+ */
+void zs_free_bulk(struct zs_pool *pool, unsigned long *handles,
+		unsigned int nr)
+{
+	struct size_class *class;
+	unsigned int i, j;
+
+	for (i = 0; i < nr; i++) {
+		if (!handles[i])
+			continue;
+
+		class = handle_to_class(pool, handles[i]);
+		spin_lock(&class->lock);
+		for (j = i; j < nr; j++) {
+			if (handles[j] && zs_free_locked(pool, class, handles[j]))
+				handles[j] = 0;
+		}
+		spin_unlock(&class->lock);
+	}
+}
+EXPORT_SYMBOL_GPL(zs_free_bulk);
+
 static void zs_object_copy(struct size_class *class, unsigned long dst,
 				unsigned long src)
 {
@@ -1934,6 +2083,11 @@ static void migrate_read_lock(struct zspage *zspage)
 	read_lock(&zspage->lock);
 }
 
+static int migrate_read_trylock(struct zspage *zspage)
+{
+	return read_trylock(&zspage->lock);
+}
+
 static void migrate_read_unlock(struct zspage *zspage)
 {
 	read_unlock(&zspage->lock);
@@ -2378,14 +2532,11 @@ static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 	return pages_freed ? pages_freed : SHRINK_STOP;
 }
 
-static unsigned long zs_shrinker_count(struct shrinker *shrinker,
-		struct shrink_control *sc)
+static unsigned long zs_pool_can_compact(struct zs_pool *pool)
 {
 	int i;
 	struct size_class *class;
 	unsigned long pages_to_free = 0;
-	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
-			shrinker);
 
 	for (i = zs_size_classes - 1; i >= 0; i--) {
 		class = pool->size_class[i];
@@ -2400,6 +2551,102 @@ static unsigned long zs_shrinker_count(struct shrinker *shrinker,
 	return pages_to_free;
 }
 
+static unsigned long zs_shrinker_count(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
+			shrinker);
+
+	return zs_pool_can_compact(pool);
+}
+
+/*
+ * Background compaction. The shrinker only compacts under memory pressure,
+ * by which time the waste left behind by freed objects has already been
+ * paid for. Pools created while compact_ratio is non-zero get a thread
+ * that compacts once the pages reclaimable by compaction exceed that
+ * percentage of the pool, checked at most every compact_interval_ms.
+ */
+static unsigned int compact_ratio;
+module_param(compact_ratio, uint, 0644);
+MODULE_PARM_DESC(compact_ratio,
+	"Percent of pool pages freeable by compaction that triggers background compaction (0: off)");
+
+static unsigned int compact_interval_ms = 1000;
+module_param(compact_interval_ms, uint, 0644);
+MODULE_PARM_DESC(compact_interval_ms,
+	"Minimum interval between background compaction checks");
+
+static void zs_compact_check(struct zs_pool *pool)
+{
+	unsigned int ratio = READ_ONCE(compact_ratio);
+	unsigned long total, freeable, pages_freed;
+
+	total = zs_get_total_pages(pool);
+	if (!ratio || !total)
+		return;
+
+	freeable = zs_pool_can_compact(pool);
+	WRITE_ONCE(pool->bg_compact_waste, freeable * 100 / total);
+	if (freeable * 100 < (unsigned long)ratio * total)
+		return;
+
+	pages_freed = zs_compact(pool);
+	WRITE_ONCE(pool->bg_compact_runs, pool->bg_compact_runs + 1);
+	WRITE_ONCE(pool->bg_compact_pages,
+		   pool->bg_compact_pages + pages_freed);
+}
+
+static int zs_compact_thread(void *data)
+{
+	struct zs_pool *pool = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			freezable_schedule_timeout(msecs_to_jiffies(
+				max(READ_ONCE(compact_interval_ms), 10U)));
+		__set_current_state(TASK_RUNNING);
+
+		if (!kthread_should_stop())
+			zs_compact_check(pool);
+	}
+
+	return 0;
+}
+
+static void zs_compact_thread_start(struct zs_pool *pool)
+{
+	static const struct sched_param param = {
+		.sched_priority = 0,
+	};
+	struct task_struct *task;
+
+	if (!READ_ONCE(compact_ratio))
+		return;
+
+	task = kthread_create(zs_compact_thread, pool, "zs_compact/%s",
+			      pool->name);
+	if (IS_ERR(task)) {
+		pr_warn("%s: background compaction disabled\n", pool->name);
+		return;
+	}
+
+	/* Only ever run when the CPU would otherwise be idle */
+	sched_setscheduler_nocheck(task, SCHED_IDLE, &param);
+	pool->compact_task = task;
+	wake_up_process(task);
+}
+
+static void zs_compact_thread_stop(struct zs_pool *pool)
+{
+	if (pool->compact_task) {
+		kthread_stop(pool->compact_task);
+		pool->compact_task = NULL;
+	}
+}
+
 static void zs_unregister_shrinker(struct zs_pool *pool)
 {
 	if (pool->shrinker_enabled) {
@@ -2537,6 +2784,8 @@ struct zs_pool *zs_create_pool(const char *name)
 	 */
 	if (zs_register_shrinker(pool) == 0)
 		pool->shrinker_enabled = true;
+
+	zs_compact_thread_start(pool);
 	return pool;
 
 err:
@@ -2549,6 +2798,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	zs_compact_thread_stop(pool);
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
@@ -1179,6 +1179,7 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 	void (*data_ready)(struct sock *sk) = NULL;
 	struct sock *sk;
 	uint32_t pkt_type;
+	bool was_empty;
 
 	if (unlikely(!port_ptr || !pkt))
 		return -EINVAL;
@@ -1194,11 +1195,20 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 		}
 	}
 
+	temp_pkt->rx_ts = ktime_get();
 	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->ws_need)
 		__pm_stay_awake(port_ptr->port_rx_ws);
+	was_empty = list_empty(&port_ptr->port_rx_q);
 	list_add_tail(&temp_pkt->list, &port_ptr->port_rx_q);
-	wake_up(&port_ptr->port_rx_wait_q);
+	/*
+	 * Readers sleep only on an empty queue and waiters are woken all at
+	 * once, so a burst needs a single wakeup when the queue fills from
+	 * empty. Pairs with the barrier in prepare_to_wait().
+	 */
+	smp_mb();
+	if (was_empty && waitqueue_active(&port_ptr->port_rx_wait_q))
+		wake_up(&port_ptr->port_rx_wait_q);
 	notify = port_ptr->notify;
 	pkt_type = temp_pkt->hdr.type;
 	sk = (struct sock *)port_ptr->endpoint;
@@ -1308,7 +1318,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	down_write(&local_ports_lock_lhc2);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	up_write(&local_ports_lock_lhc2);
 }
 
@@ -1379,21 +1389,27 @@ struct msm_ipc_port *msm_ipc_router_create_raw_port(void *endpoint,
  *
  * @return: If port is found, a reference to the port is returned.
  *          Else NULL is returned.
+ *
+ * Runs on every incoming packet, so the lookup is done under RCU instead
+ * of local_ports_lock_lhc2; writers still serialize on the rwsem. A port
+ * found while it is being closed may already have dropped its last
+ * reference and is skipped.
  */
 static struct msm_ipc_port *ipc_router_get_port_ref(uint32_t port_id)
 {
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	down_read(&local_ports_lock_lhc2);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
 		if (port_ptr->this_port.port_id == port_id) {
-			kref_get(&port_ptr->ref);
-			up_read(&local_ports_lock_lhc2);
+			if (!kref_get_unless_zero(&port_ptr->ref))
+				break;
+			rcu_read_unlock();
 			return port_ptr;
 		}
 	}
-	up_read(&local_ports_lock_lhc2);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -1418,7 +1434,8 @@ void ipc_router_release_port(struct kref *ref)
 	wakeup_source_unregister(port_ptr->port_rx_ws);
 	if (port_ptr->endpoint)
 		sock_put(ipc_port_sk(port_ptr->endpoint));
-	kfree(port_ptr);
+	/* lookups under RCU may still be looking at the port */
+	kfree_rcu(port_ptr, rcu);
 }
 
 /**
@@ -3312,6 +3329,26 @@ static int msm_ipc_router_send_resume_tx(void *data)
 	return ret;
 }
 
+/**
+ * ipc_router_update_rx_lat() - Account the time a packet spent queued
+ * @port_ptr: Local port the packet was read from.
+ * @pkt: Packet being handed to the reader.
+ *
+ * Called with port_rx_q_lock_lhc3 held.
+ */
+static void ipc_router_update_rx_lat(struct msm_ipc_port *port_ptr,
+				     struct rr_packet *pkt)
+{
+	s64 lat_us = ktime_us_delta(ktime_get(), pkt->rx_ts);
+
+	if (lat_us < 0)
+		lat_us = 0;
+	port_ptr->rx_lat_cnt++;
+	port_ptr->rx_lat_sum_us += lat_us;
+	if (lat_us > port_ptr->rx_lat_max_us)
+		port_ptr->rx_lat_max_us = min_t(s64, lat_us, U32_MAX);
+}
+
 int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 			struct rr_packet **read_pkt,
 			size_t buf_len)
@@ -3336,6 +3373,7 @@ int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 	if (list_empty(&port_ptr->port_rx_q))
 		__pm_relax(port_ptr->port_rx_ws);
 	*read_pkt = pkt;
+	ipc_router_update_rx_lat(port_ptr, pkt);
 	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->hdr.control_flag & CONTROL_FLAG_CONFIRM_RX)
 		msm_ipc_router_send_resume_tx(&pkt->hdr);
@@ -3522,7 +3560,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 
 	if (port_ptr->type == SERVER_PORT || port_ptr->type == CLIENT_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 
 		mutex_lock(&port_ptr->port_lock_lhc3);
@@ -3557,7 +3595,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 		up_write(&control_ports_lock_lha5);
 	} else if (port_ptr->type == IRSC_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 		signal_irsc_completion();
 	}
@@ -3612,8 +3650,10 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	down_write(&local_ports_lock_lhc2);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	up_write(&local_ports_lock_lhc2);
+	/* no RCU lookup may still walk the entry once it is relinked */
+	synchronize_rcu();
 	port_ptr->type = CONTROL_PORT;
 	down_write(&control_ports_lock_lha5);
 	list_add_tail(&port_ptr->list, &control_ports);
@@ -3890,18 +3930,29 @@ static void dump_local_ports(struct seq_file *s)
 	int j;
 	struct msm_ipc_port *port_ptr;
 
-	seq_printf(s, "%-11s|%-11s|%-32s|%-11s|\n",
-		   "Node_id", "Port_id", "Wakelock", "Last SVCID");
-	seq_puts(s, "------------------------------------------------------------\n");
+	seq_printf(s, "%-11s|%-11s|%-32s|%-11s|%-11s|%-11s|%-11s|\n",
+		   "Node_id", "Port_id", "Wakelock", "Last SVCID",
+		   "Rx pkts", "Avg lat us", "Max lat us");
+	seq_puts(s, "------------------------------------------------------------------------------------------\n");
 	down_read(&local_ports_lock_lhc2);
 	for (j = 0; j < LP_HASH_SIZE; j++) {
 		list_for_each_entry(port_ptr, &local_ports[j], list) {
+			uint32_t cnt, avg_us, max_us;
+
+			mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+			cnt = port_ptr->rx_lat_cnt;
+			avg_us = cnt ? (uint32_t)div_u64(
+				port_ptr->rx_lat_sum_us, cnt) : 0;
+			max_us = port_ptr->rx_lat_max_us;
+			mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+
 			mutex_lock(&port_ptr->port_lock_lhc3);
-			seq_printf(s, "0x%08x |0x%08x |%-32s|0x%08x |\n",
+			seq_printf(s, "0x%08x |0x%08x |%-32s|0x%08x |%-11u|%-11u|%-11u|\n",
 				   port_ptr->this_port.node_id,
 				   port_ptr->this_port.port_id,
 				   port_ptr->rx_ws_name,
-				   port_ptr->last_served_svc_id);
+				   port_ptr->last_served_svc_id,
+				   cnt, avg_us, max_us);
 			mutex_unlock(&port_ptr->port_lock_lhc3);
 		}
 	}
@@ -0,0 +1,615 @@
+/*
+ * Software flow offload for forwarded IPv4 TCP and UDP connections.
+ *
+ * Once a forwarded connection is established, the headers it leaves
+ * with are learnt at POST_ROUTING, after SNAT and all the forward chains
+ * have run. Later packets of the same direction are matched against the
+ * learnt tuple at PRE_ROUTING, ahead of defrag and conntrack, rewritten
+ * in place and handed straight to the neighbour layer, skipping routing,
+ * the FORWARD chain and NAT altogether.
+ *
+ * The bypassed conntrack entry is kept alive from a periodic sync that
+ * pushes the flow counters into its accounting and pushes its timeout
+ * forward while the flow sees traffic. TCP packets carrying SYN, FIN or
+ * RST drop the flow and go the slow way, so conntrack still sees the
+ * connection close.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/jhash.h>
+#include <linux/workqueue.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/dst.h>
+#include <net/neighbour.h>
+#include <net/checksum.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_acct.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FLOW_HASH_BITS	10
+#define NF_FLOW_HASH_SIZE	(1 << NF_FLOW_HASH_BITS)
+
+static unsigned int max_flows __read_mostly = 4096;
+module_param(max_flows, uint, 0644);
+MODULE_PARM_DESC(max_flows, "Maximum number of offloaded flow directions");
+
+static unsigned int idle_timeout __read_mostly = 30;
+module_param(idle_timeout, uint, 0644);
+MODULE_PARM_DESC(idle_timeout,
+		 "Seconds without traffic before a flow goes back to conntrack");
+
+static bool enable __read_mostly = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Learn new flows and use the fast path");
+
+/* packets as they arrive, before any NAT */
+struct nf_flow_tuple {
+	__be32		saddr;
+	__be32		daddr;
+	__be16		sport;
+	__be16		dport;
+	u8		protonum;
+	int		iifindex;
+};
+
+struct nf_flow_entry {
+	struct hlist_node	hnode;
+	struct nf_flow_tuple	tuple;
+
+	/* headers as they leave, after NAT */
+	__be32			new_saddr;
+	__be32			new_daddr;
+	__be16			new_sport;
+	__be16			new_dport;
+
+	struct nf_conn		*ct;
+	enum ip_conntrack_dir	dir;
+	struct dst_entry	*dst;
+	unsigned long		ct_timeout;
+	unsigned long		last_used;
+
+	atomic64_t		packets;
+	atomic64_t		bytes;
+	u64			synced_packets;
+	u64			synced_bytes;
+
+	struct rcu_head		rcu;
+};
+
+static struct hlist_head nf_flow_hash[NF_FLOW_HASH_SIZE];
+static DEFINE_SPINLOCK(nf_flow_lock);
+static unsigned int nf_flow_count;
+static u32 nf_flow_hash_rnd __read_mostly;
+static struct delayed_work nf_flow_gc_work;
+
+static u32 nf_flow_hashfn(const struct nf_flow_tuple *t)
+{
+	return jhash_3words((__force u32)t->saddr, (__force u32)t->daddr,
+			    ((__force u32)t->sport << 16 |
+			     (__force u32)t->dport) ^ t->protonum ^ t->iifindex,
+			    nf_flow_hash_rnd) & (NF_FLOW_HASH_SIZE - 1);
+}
+
+static bool nf_flow_tuple_equal(const struct nf_flow_tuple *a,
+				const struct nf_flow_tuple *b)
+{
+	return a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->protonum == b->protonum && a->iifindex == b->iifindex;
+}
+
+static struct nf_flow_entry *nf_flow_lookup(const struct nf_flow_tuple *t)
+{
+	struct nf_flow_entry *flow;
+
+	hlist_for_each_entry_rcu(flow, &nf_flow_hash[nf_flow_hashfn(t)],
+				 hnode)
+		if (nf_flow_tuple_equal(&flow->tuple, t))
+			return flow;
+	return NULL;
+}
+
+static void nf_flow_sync(struct nf_flow_entry *flow)
+{
+	struct nf_conn *ct = flow->ct;
+	struct nf_conn_acct *acct;
+	u64 packets = atomic64_read(&flow->packets);
+	u64 bytes = atomic64_read(&flow->bytes);
+
+	if (packets == flow->synced_packets)
+		return;
+
+	acct = nf_conn_acct_find(ct);
+	if (acct) {
+		struct nf_conn_counter *counter = acct->counter;
+
+		atomic64_add(packets - flow->synced_packets,
+			     &counter[flow->dir].packets);
+		atomic64_add(bytes - flow->synced_bytes,
+			     &counter[flow->dir].bytes);
+	}
+	flow->synced_packets = packets;
+	flow->synced_bytes = bytes;
+
+	/* the timer is torn down once the entry dies, never set it again */
+	if (nf_ct_is_confirmed(ct) && !nf_ct_is_dying(ct) &&
+	    time_after(jiffies + flow->ct_timeout, ct->timeout.expires))
+		mod_timer_pending(&ct->timeout, jiffies + flow->ct_timeout);
+}
+
+static void nf_flow_free_rcu(struct rcu_head *head)
+{
+	struct nf_flow_entry *flow = container_of(head, struct nf_flow_entry,
+						  rcu);
+
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kfree(flow);
+}
+
+/* Called with nf_flow_lock held */
+static void nf_flow_remove(struct nf_flow_entry *flow)
+{
+	nf_flow_sync(flow);
+	hlist_del_rcu(&flow->hnode);
+	nf_flow_count--;
+	call_rcu(&flow->rcu, nf_flow_free_rcu);
+}
+
+static void nf_flow_remove_tuple(const struct nf_flow_tuple *t)
+{
+	struct nf_flow_entry *flow;
+
+	spin_lock_bh(&nf_flow_lock);
+	flow = nf_flow_lookup(t);
+	if (flow)
+		nf_flow_remove(flow);
+	spin_unlock_bh(&nf_flow_lock);
+}
+
+/*
+ * Pull both headers into the linear area and fill in the tuple. Anything
+ * the slow path has to look at more closely returns false: fragments,
+ * IP options, expiring TTLs and protocols other than TCP and UDP.
+ */
+static bool nf_flow_parse(struct sk_buff *skb, struct nf_flow_tuple *t,
+			  unsigned int *thoff)
+{
+	const struct iphdr *iph;
+	const __be16 *ports;
+	unsigned int hdrsize;
+
+	if (!pskb_may_pull(skb, sizeof(*iph)))
+		return false;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph) || iph->ttl <= 1)
+		return false;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(struct udphdr);
+		break;
+	default:
+		return false;
+	}
+
+	*thoff = sizeof(*iph);
+	if (!pskb_may_pull(skb, *thoff + hdrsize))
+		return false;
+
+	iph = ip_hdr(skb);
+	ports = (const __be16 *)(skb_network_header(skb) + *thoff);
+	t->saddr = iph->saddr;
+	t->daddr = iph->daddr;
+	t->sport = ports[0];
+	t->dport = ports[1];
+	t->protonum = iph->protocol;
+	t->iifindex = skb->dev->ifindex;
+	return true;
+}
+
+static void nf_flow_mangle_addr(struct sk_buff *skb, unsigned int thoff,
+				u8 protonum, __be32 *addr, __be32 new)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	struct udphdr *uh;
+	struct tcphdr *th;
+
+	if (*addr == new)
+		return;
+
+	switch (protonum) {
+	case IPPROTO_TCP:
+		th = (struct tcphdr *)(skb_network_header(skb) + thoff);
+		inet_proto_csum_replace4(&th->check, skb, *addr, new, true);
+		break;
+	case IPPROTO_UDP:
+		uh = (struct udphdr *)(skb_network_header(skb) + thoff);
+		if (!uh->check && skb->ip_summed != CHECKSUM_PARTIAL)
+			break;
+		inet_proto_csum_replace4(&uh->check, skb, *addr, new, true);
+		if (!uh->check)
+			uh->check = CSUM_MANGLED_0;
+		break;
+	}
+	csum_replace4(&iph->check, *addr, new);
+	*addr = new;
+}
+
+static void nf_flow_mangle_port(struct sk_buff *skb, unsigned int thoff,
+				u8 protonum, __be16 *port, __be16 new)
+{
+	struct udphdr *uh;
+	struct tcphdr *th;
+
+	if (*port == new)
+		return;
+
+	switch (protonum) {
+	case IPPROTO_TCP:
+		th = (struct tcphdr *)(skb_network_header(skb) + thoff);
+		inet_proto_csum_replace2(&th->check, skb, *port, new, false);
+		break;
+	case IPPROTO_UDP:
+		uh = (struct udphdr *)(skb_network_header(skb) + thoff);
+		if (!uh->check && skb->ip_summed != CHECKSUM_PARTIAL)
+			break;
+		inet_proto_csum_replace2(&uh->check, skb, *port, new, false);
+		if (!uh->check)
+			uh->check = CSUM_MANGLED_0;
+		break;
+	}
+	*port = new;
+}
+
+static unsigned int nf_flow_offload_in(void *priv, struct sk_buff *skb,
+				       const struct nf_hook_state *state)
+{
+	struct nf_flow_entry *flow;
+	struct nf_flow_tuple t;
+	struct net_device *outdev;
+	struct dst_entry *dst;
+	struct iphdr *iph;
+	__be16 *ports;
+	unsigned int thoff, mtu;
+	__be32 nexthop;
+
+	if (!enable || state->net != &init_net ||
+	    skb->pkt_type != PACKET_HOST || skb->nfct)
+		return NF_ACCEPT;
+
+	if (!nf_flow_parse(skb, &t, &thoff))
+		return NF_ACCEPT;
+
+	flow = nf_flow_lookup(&t);
+	if (!flow)
+		return NF_ACCEPT;
+
+	if (t.protonum == IPPROTO_TCP) {
+		const struct tcphdr *th = (const struct tcphdr *)
+			(skb_network_header(skb) + thoff);
+
+		if (th->syn || th->fin || th->rst) {
+			nf_flow_remove_tuple(&t);
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = flow->dst;
+	if (nf_ct_is_dying(flow->ct) ||
+	    (dst->obsolete && !dst_check(dst, 0))) {
+		nf_flow_remove_tuple(&t);
+		return NF_ACCEPT;
+	}
+
+	/* leave fragmentation and ICMP errors to ip_forward() */
+	mtu = dst_mtu(dst);
+	if (skb->len > mtu &&
+	    (!skb_is_gso(skb) || skb_gso_network_seglen(skb) > mtu))
+		return NF_ACCEPT;
+
+	if (!skb_make_writable(skb, thoff + (t.protonum == IPPROTO_TCP ?
+					     sizeof(struct tcphdr) :
+					     sizeof(struct udphdr))))
+		return NF_DROP;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+	nf_flow_mangle_addr(skb, thoff, t.protonum, &iph->saddr,
+			    flow->new_saddr);
+	nf_flow_mangle_addr(skb, thoff, t.protonum, &iph->daddr,
+			    flow->new_daddr);
+	nf_flow_mangle_port(skb, thoff, t.protonum, &ports[0],
+			    flow->new_sport);
+	nf_flow_mangle_port(skb, thoff, t.protonum, &ports[1],
+			    flow->new_dport);
+	ip_decrease_ttl(iph);
+
+	atomic64_inc(&flow->packets);
+	atomic64_add(skb->len, &flow->bytes);
+	if (flow->last_used != jiffies)
+		flow->last_used = jiffies;
+
+	outdev = dst->dev;
+	nexthop = rt_nexthop((struct rtable *)dst, iph->daddr);
+	memset(IPCB(skb), 0, sizeof(struct inet_skb_parm));
+	skb_dst_drop(skb);
+	skb_dst_set(skb, dst_clone(dst));
+	skb->dev = outdev;
+	skb->skb_iif = t.iifindex;
+
+	neigh_xmit(NEIGH_ARP_TABLE, outdev, &nexthop, skb);
+	return NF_STOLEN;
+}
+
+/*
+ * Only flows the slow path has already forwarded as established, with no
+ * helper or sequence adjustment in the way, can be taken over.
+ */
+static bool nf_flow_can_offload(const struct sk_buff *skb,
+				const struct nf_conn *ct,
+				enum ip_conntrack_info ctinfo)
+{
+	const struct dst_entry *dst = skb_dst(skb);
+
+	if (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY)
+		return false;
+	if (!test_bit(IPS_ASSURED_BIT, &ct->status) ||
+	    test_bit(IPS_SEQ_ADJUST_BIT, &ct->status) ||
+	    !nf_ct_is_confirmed((struct nf_conn *)ct) || nfct_help(ct))
+		return false;
+	if (nf_ct_protonum(ct) == IPPROTO_TCP &&
+	    ct->proto.tcp.state != TCP_CONNTRACK_ESTABLISHED)
+		return false;
+	if (!(IPCB(skb)->flags & IPSKB_FORWARDED) || !dst || dst_xfrm(dst))
+		return false;
+	return true;
+}
+
+static unsigned int nf_flow_offload_learn(void *priv, struct sk_buff *skb,
+					  const struct nf_hook_state *state)
+{
+	enum ip_conntrack_info ctinfo;
+	struct nf_flow_entry *flow;
+	struct nf_flow_tuple t;
+	const struct nf_conntrack_tuple *ct_tuple;
+	const struct iphdr *iph;
+	const __be16 *ports;
+	struct nf_conn *ct;
+	unsigned int thoff;
+
+	if (!enable || state->net != &init_net)
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || !nf_flow_can_offload(skb, ct, ctinfo))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph))
+		return NF_ACCEPT;
+	thoff = sizeof(*iph);
+	if (!pskb_may_pull(skb, thoff + 2 * sizeof(__be16)))
+		return NF_ACCEPT;
+	iph = ip_hdr(skb);
+	ports = (const __be16 *)(skb_network_header(skb) + thoff);
+
+	ct_tuple = &ct->tuplehash[CTINFO2DIR(ctinfo)].tuple;
+	t.saddr = ct_tuple->src.u3.ip;
+	t.daddr = ct_tuple->dst.u3.ip;
+	t.sport = ct_tuple->src.u.all;
+	t.dport = ct_tuple->dst.u.all;
+	t.protonum = ct_tuple->dst.protonum;
+	t.iifindex = skb->skb_iif;
+
+	rcu_read_lock();
+	flow = nf_flow_lookup(&t);
+	rcu_read_unlock();
+	if (flow || READ_ONCE(nf_flow_count) >= max_flows)
+		return NF_ACCEPT;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return NF_ACCEPT;
+
+	flow->tuple = t;
+	flow->new_saddr = iph->saddr;
+	flow->new_daddr = iph->daddr;
+	flow->new_sport = ports[0];
+	flow->new_dport = ports[1];
+	flow->dir = CTINFO2DIR(ctinfo);
+	flow->last_used = jiffies;
+	/* the established timeout the slow path just armed */
+	flow->ct_timeout = max_t(long, (long)(ct->timeout.expires - jiffies),
+				 HZ);
+	atomic64_set(&flow->packets, 0);
+	atomic64_set(&flow->bytes, 0);
+
+	spin_lock_bh(&nf_flow_lock);
+	if (nf_flow_lookup(&t) || nf_flow_count >= max_flows) {
+		spin_unlock_bh(&nf_flow_lock);
+		kfree(flow);
+		return NF_ACCEPT;
+	}
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+	flow->dst = dst_clone(skb_dst(skb));
+	hlist_add_head_rcu(&flow->hnode, &nf_flow_hash[nf_flow_hashfn(&t)]);
+	nf_flow_count++;
+	spin_unlock_bh(&nf_flow_lock);
+
+	return NF_ACCEPT;
+}
+
+static struct nf_hook_ops nf_flow_offload_ops[] __read_mostly = {
+	{
+		.hook		= nf_flow_offload_in,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG - 1,
+	},
+	{
+		.hook		= nf_flow_offload_learn,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_POST_ROUTING,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static void nf_flow_flush(const struct net_device *dev)
+{
+	struct nf_flow_entry *flow;
+	struct hlist_node *n;
+	unsigned int i;
+
+	spin_lock_bh(&nf_flow_lock);
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++)
+		hlist_for_each_entry_safe(flow, n, &nf_flow_hash[i], hnode)
+			if (!dev || flow->dst->dev == dev ||
+			    flow->tuple.iifindex == dev->ifindex)
+				nf_flow_remove(flow);
+	spin_unlock_bh(&nf_flow_lock);
+}
+
+static void nf_flow_gc(struct work_struct *work)
+{
+	unsigned long timeout = msecs_to_jiffies(idle_timeout * 1000);
+	struct nf_flow_entry *flow;
+	struct hlist_node *n;
+	unsigned int i;
+
+	spin_lock_bh(&nf_flow_lock);
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, &nf_flow_hash[i], hnode) {
+			if (!enable || nf_ct_is_dying(flow->ct) ||
+			    time_after(jiffies, flow->last_used + timeout))
+				nf_flow_remove(flow);
+			else
+				nf_flow_sync(flow);
+		}
+	}
+	spin_unlock_bh(&nf_flow_lock);
+
+	queue_delayed_work(system_power_efficient_wq, &nf_flow_gc_work, HZ);
+}
+
+static int nf_flow_netdev_event(struct notifier_block *this,
+				unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	if (event == NETDEV_DOWN || event == NETDEV_UNREGISTER)
+		nf_flow_flush(dev);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_flow_netdev_notifier = {
+	.notifier_call	= nf_flow_netdev_event,
+};
+
+static int nf_flow_seq_show(struct seq_file *m, void *v)
+{
+	struct nf_flow_entry *flow;
+	unsigned int i;
+
+	seq_printf(m, "flows %u/%u\n", READ_ONCE(nf_flow_count), max_flows);
+
+	rcu_read_lock();
+	for (i = 0; i < NF_FLOW_HASH_SIZE; i++)
+		hlist_for_each_entry_rcu(flow, &nf_flow_hash[i], hnode)
+			seq_printf(m, "%s iif=%d src=%pI4 dst=%pI4 sport=%u dport=%u -> src=%pI4 dst=%pI4 sport=%u dport=%u dev=%s packets=%llu bytes=%llu\n",
+				   flow->tuple.protonum == IPPROTO_TCP ?
+				   "tcp" : "udp", flow->tuple.iifindex,
+				   &flow->tuple.saddr, &flow->tuple.daddr,
+				   ntohs(flow->tuple.sport),
+				   ntohs(flow->tuple.dport),
+				   &flow->new_saddr, &flow->new_daddr,
+				   ntohs(flow->new_sport),
+				   ntohs(flow->new_dport),
+				   flow->dst->dev->name,
+				   (u64)atomic64_read(&flow->packets),
+				   (u64)atomic64_read(&flow->bytes));
+	rcu_read_unlock();
+	return 0;
+}
+
+static int nf_flow_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nf_flow_seq_show, NULL);
+}
+
+static const struct file_operations nf_flow_seq_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nf_flow_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init nf_flow_offload_init(void)
+{
+	int ret;
+
+	get_random_bytes(&nf_flow_hash_rnd, sizeof(nf_flow_hash_rnd));
+	INIT_DELAYED_WORK(&nf_flow_gc_work, nf_flow_gc);
+
+	if (!proc_create("nf_flow_offload", 0440, init_net.proc_net,
+			 &nf_flow_seq_fops))
+		return -ENOMEM;
+
+	ret = register_netdevice_notifier(&nf_flow_netdev_notifier);
+	if (ret < 0)
+		goto err_proc;
+
+	ret = nf_register_hooks(nf_flow_offload_ops,
+				ARRAY_SIZE(nf_flow_offload_ops));
+	if (ret < 0)
+		goto err_notifier;
+
+	queue_delayed_work(system_power_efficient_wq, &nf_flow_gc_work, HZ);
+	return 0;
+
+err_notifier:
+	unregister_netdevice_notifier(&nf_flow_netdev_notifier);
+err_proc:
+	remove_proc_entry("nf_flow_offload", init_net.proc_net);
+	return ret;
+}
+
+static void __exit nf_flow_offload_fini(void)
+{
+	nf_unregister_hooks(nf_flow_offload_ops,
+			    ARRAY_SIZE(nf_flow_offload_ops));
+	cancel_delayed_work_sync(&nf_flow_gc_work);
+	unregister_netdevice_notifier(&nf_flow_netdev_notifier);
+	remove_proc_entry("nf_flow_offload", init_net.proc_net);
+	nf_flow_flush(NULL);
+	rcu_barrier();
+}
+
+module_init(nf_flow_offload_init);
+module_exit(nf_flow_offload_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("IPv4 software flow offload for forwarded connections");
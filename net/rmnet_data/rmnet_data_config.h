@@ -64,6 +64,8 @@ struct rmnet_logical_ep_conf_s {
  * @tail_spacing: Guaranteed padding (bytes) when de-aggregating ingress frames
  * @agg_time: Wall clock time when aggregated frame was created
  * @agg_last: Last time the aggregation routing was invoked
+ * @agg_gap_avg: Moving average of the time between egress packets, in ns
+ * @agg_len_avg: Moving average of the egress packet length
  */
 struct rmnet_phys_ep_config {
 	struct net_device *dev;
@@ -86,6 +88,8 @@ struct rmnet_phys_ep_config {
 	uint8_t agg_count;
 	struct timespec agg_time;
 	struct timespec agg_last;
+	uint32_t agg_gap_avg;
+	uint32_t agg_len_avg;
 };
 
 int rmnet_config_init(void);
@@ -22,6 +22,9 @@
 #include <linux/netdev_features.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/smp.h>
+#include <net/ip.h>
 #include <net/rmnet_config.h>
 #include "rmnet_data_private.h"
 #include "rmnet_data_config.h"
@@ -67,6 +70,10 @@ unsigned int upper_byte_limit __read_mostly = 10500;
 module_param(upper_byte_limit, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(upper_byte_limit, "Upper byte limit");
 
+unsigned int deagg_steer_mask __read_mostly;
+module_param(deagg_steer_mask, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(deagg_steer_mask, "CPUs to spread deaggregated flows over");
+
 #define RMNET_DATA_IP_VERSION_4 0x40
 #define RMNET_DATA_IP_VERSION_6 0x60
 
@@ -431,6 +438,7 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 	uint16_t len;
 	int ckresult;
 
+	rmnet_stats_cpu_pkts();
 	if (RMNET_MAP_GET_CD_BIT(skb)) {
 		if (config->ingress_data_format
 		    & RMNET_INGRESS_FORMAT_MAP_COMMANDS)
@@ -468,8 +476,10 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 	if (config->ingress_data_format & RMNET_INGRESS_FORMAT_DEMUXING)
 		skb->dev = ep->egress_dev;
 
-	if ((config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_CKSUMV3) ||
-	    (config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_CKSUMV4)) {
+	/* Coalesced packets were validated segment by segment */
+	if (!skb_is_gso(skb) &&
+	    ((config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_CKSUMV3) ||
+	     (config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_CKSUMV4))) {
 		ckresult = rmnet_map_checksum_downlink_packet(skb);
 		trace_rmnet_map_checksum_downlink_packet(skb, ckresult);
 		rmnet_stats_dl_checksum(ckresult);
@@ -495,6 +505,245 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
 	return __rmnet_deliver_skb(skb, ep);
 }
 
+/* ***************** Deaggregation steering ********************************* */
+
+/**
+ * struct rmnet_map_steer_queue - Per CPU queue of deaggregated packets
+ * @skbs:       Packets waiting to go through _rmnet_map_ingress_handler()
+ * @napi:       Polls @skbs on the owning CPU
+ * @csd:        Schedules @napi from another CPU
+ *
+ * NAPI_STATE_SCHED in @napi is only set or cleared with the @skbs lock
+ * held, so whoever queues to an idle queue is the one to kick it.
+ */
+struct rmnet_map_steer_queue {
+	struct sk_buff_head skbs;
+	struct napi_struct napi;
+	struct call_single_data csd;
+};
+
+static DEFINE_PER_CPU(struct rmnet_map_steer_queue, rmnet_steer_queues);
+static struct net_device rmnet_steer_dev;
+
+/**
+ * rmnet_map_flow_hash() - Hash the addresses, protocol and ports of a packet
+ * @skb:        Deaggregated packet, still with its MAP header
+ *
+ * Fragments and unknown transports hash on addresses only, so all pieces
+ * of a flow end up on the same CPU.
+ *
+ * Return:
+ *      - Flow hash, 0 for packets that are not IP
+ */
+static u32 rmnet_map_flow_hash(struct sk_buff *skb)
+{
+	unsigned int off = sizeof(struct rmnet_map_header_s);
+	struct ipv6hdr *ip6h;
+	struct iphdr *ip4h;
+	u32 addrs, ports = 0;
+	u8 proto;
+
+	if (skb->len < off + sizeof(struct iphdr))
+		return 0;
+
+	switch (skb->data[off] & 0xF0) {
+	case RMNET_DATA_IP_VERSION_4:
+		ip4h = (struct iphdr *)(skb->data + off);
+		addrs = (__force u32)ip4h->saddr ^ (__force u32)ip4h->daddr;
+		proto = ip4h->protocol;
+		if (ip_is_fragment(ip4h))
+			proto = 0;
+		off += ip4h->ihl * 4;
+		break;
+	case RMNET_DATA_IP_VERSION_6:
+		if (skb->len < off + sizeof(struct ipv6hdr))
+			return 0;
+		ip6h = (struct ipv6hdr *)(skb->data + off);
+		addrs = (__force u32)ip6h->saddr.s6_addr32[3] ^
+			(__force u32)ip6h->daddr.s6_addr32[3] ^
+			(__force u32)ip6h->saddr.s6_addr32[2] ^
+			(__force u32)ip6h->daddr.s6_addr32[2];
+		proto = ip6h->nexthdr;
+		off += sizeof(struct ipv6hdr);
+		break;
+	default:
+		return 0;
+	}
+
+	if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) &&
+	    skb->len >= off + sizeof(ports))
+		ports = *(u32 *)(skb->data + off);
+
+	return jhash_3words(addrs, ports, proto, 0) ? : 1;
+}
+
+/**
+ * rmnet_map_steer_cpu() - Pick the CPU that handles a flow
+ * @hash:       Flow hash from rmnet_map_flow_hash()
+ *
+ * Return:
+ *      - CPU number from deagg_steer_mask that is online
+ *      - The current CPU if none are
+ */
+static int rmnet_map_steer_cpu(u32 hash)
+{
+	unsigned long mask = READ_ONCE(deagg_steer_mask) &
+			     cpumask_bits(cpu_online_mask)[0];
+	unsigned int n;
+	int cpu;
+
+	if (!mask)
+		return smp_processor_id();
+
+	n = reciprocal_scale(hash, hweight_long(mask));
+	for_each_set_bit(cpu, &mask, BITS_PER_LONG)
+		if (!n--)
+			break;
+
+	return cpu;
+}
+
+/**
+ * rmnet_map_steer_skb() - Queue a deaggregated packet on its flow's CPU
+ * @skb:        Deaggregated packet, still with its MAP header
+ * @kick:       CPUs whose queue has to be scheduled, updated
+ *
+ * Packets of one flow always go through the same queue, which keeps them
+ * in order.
+ */
+static void rmnet_map_steer_skb(struct sk_buff *skb, struct cpumask *kick)
+{
+	struct rmnet_map_steer_queue *q;
+	unsigned long flags;
+	u32 hash;
+	int cpu;
+
+	hash = rmnet_map_flow_hash(skb);
+	if (hash)
+		skb_set_hash(skb, hash, PKT_HASH_TYPE_L4);
+	cpu = rmnet_map_steer_cpu(hash);
+	q = &per_cpu(rmnet_steer_queues, cpu);
+
+	spin_lock_irqsave(&q->skbs.lock, flags);
+	if (unlikely(skb_queue_len(&q->skbs) >= netdev_max_backlog)) {
+		spin_unlock_irqrestore(&q->skbs.lock, flags);
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_DEAGG_STEER_DROP);
+		return;
+	}
+	dev_hold(skb->dev);
+	__skb_queue_tail(&q->skbs, skb);
+	if (!test_and_set_bit(NAPI_STATE_SCHED, &q->napi.state))
+		cpumask_set_cpu(cpu, kick);
+	spin_unlock_irqrestore(&q->skbs.lock, flags);
+}
+
+/**
+ * rmnet_map_steer_kick() - Schedule the queues filled from one frame
+ * @kick:       CPUs to schedule, from rmnet_map_steer_skb()
+ *
+ * A queue whose CPU went offline meanwhile is polled here instead.
+ */
+static void rmnet_map_steer_kick(struct cpumask *kick)
+{
+	struct rmnet_map_steer_queue *q;
+	int cpu, this_cpu = smp_processor_id();
+
+	for_each_cpu(cpu, kick) {
+		q = &per_cpu(rmnet_steer_queues, cpu);
+		if (cpu == this_cpu ||
+		    smp_call_function_single_async(cpu, &q->csd))
+			__napi_schedule(&q->napi);
+	}
+}
+
+static void rmnet_map_steer_ipi(void *data)
+{
+	struct rmnet_map_steer_queue *q = data;
+
+	__napi_schedule_irqoff(&q->napi);
+}
+
+static int rmnet_map_steer_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_map_steer_queue *q;
+	struct rmnet_phys_ep_config *config;
+	struct net_device *dev;
+	struct sk_buff *skb;
+	int work = 0;
+
+	q = container_of(napi, struct rmnet_map_steer_queue, napi);
+	while (work < budget) {
+		skb = skb_dequeue(&q->skbs);
+		if (!skb)
+			break;
+
+		/* Endpoint may have been unassociated while it was queued */
+		dev = skb->dev;
+		rcu_read_lock();
+		config = _rmnet_get_phys_ep_config(dev);
+		if (likely(config))
+			_rmnet_map_ingress_handler(skb, config);
+		else
+			kfree_skb(skb);
+		rcu_read_unlock();
+		dev_put(dev);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_gro_flush(napi, false);
+		spin_lock_irq(&q->skbs.lock);
+		if (skb_queue_empty(&q->skbs))
+			__napi_complete(napi);
+		else
+			work = budget;
+		spin_unlock_irq(&q->skbs.lock);
+	}
+
+	return work;
+}
+
+/**
+ * rmnet_map_steer_init() - Set up the per CPU deaggregation queues
+ */
+void rmnet_map_steer_init(void)
+{
+	struct rmnet_map_steer_queue *q;
+	int cpu;
+
+	init_dummy_netdev(&rmnet_steer_dev);
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(rmnet_steer_queues, cpu);
+		skb_queue_head_init(&q->skbs);
+		q->csd.func = rmnet_map_steer_ipi;
+		q->csd.info = q;
+		netif_napi_add(&rmnet_steer_dev, &q->napi,
+			       rmnet_map_steer_poll, NAPI_POLL_WEIGHT);
+		napi_enable(&q->napi);
+	}
+}
+
+/**
+ * rmnet_map_steer_exit() - Tear down the per CPU deaggregation queues
+ */
+void rmnet_map_steer_exit(void)
+{
+	struct rmnet_map_steer_queue *q;
+	struct sk_buff *skb;
+	int cpu;
+
+	deagg_steer_mask = 0;
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(rmnet_steer_queues, cpu);
+		napi_disable(&q->napi);
+		while ((skb = skb_dequeue(&q->skbs))) {
+			dev_put(skb->dev);
+			kfree_skb(skb);
+		}
+		netif_napi_del(&q->napi);
+	}
+}
+
 /**
  * rmnet_map_ingress_handler() - MAP ingress handler
  * @skb:        Packet being received
@@ -502,7 +751,8 @@ static rx_handler_result_t _rmnet_map_ingress_handler(struct sk_buff *skb,
  *
  * Called if and only if MAP is configured in the ingress device's ingress data
  * format. Deaggregation is done here, actual MAP processing is done in
- * _rmnet_map_ingress_handler().
+ * _rmnet_map_ingress_handler(). With deagg_steer_mask set, data packets are
+ * hashed by flow and processed on one of those CPUs instead.
  *
  * Return:
  *      - RX_HANDLER_CONSUMED for aggregated packets
@@ -513,14 +763,25 @@ static rx_handler_result_t rmnet_map_ingress_handler(struct sk_buff *skb,
 					   struct rmnet_phys_ep_config *config)
 {
 	struct sk_buff *skbn;
+	struct cpumask kick;
+	bool steer;
 	int rc, co = 0;
 
 	if (config->ingress_data_format & RMNET_INGRESS_FORMAT_DEAGGREGATION) {
 		trace_rmnet_start_deaggregation(skb);
-		while ((skbn = rmnet_map_deaggregate(skb, config)) != 0) {
-			_rmnet_map_ingress_handler(skbn, config);
+		steer = READ_ONCE(deagg_steer_mask) != 0;
+		if (steer)
+			cpumask_clear(&kick);
+		while ((skbn = rmnet_map_deaggregate_coalesce(skb, config))
+		       != 0) {
+			if (steer && !RMNET_MAP_GET_CD_BIT(skbn))
+				rmnet_map_steer_skb(skbn, &kick);
+			else
+				_rmnet_map_ingress_handler(skbn, config);
 			co++;
 		}
+		if (steer)
+			rmnet_map_steer_kick(&kick);
 		trace_rmnet_end_deaggregation(skb, co);
 		LOGD("De-aggregated %d packets", co);
 		rmnet_stats_deagg_pkts(co);
@@ -22,4 +22,7 @@ void rmnet_egress_handler(struct sk_buff *skb,
 
 rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb);
 
+void rmnet_map_steer_init(void);
+void rmnet_map_steer_exit(void);
+
 #endif /* _RMNET_DATA_HANDLERS_H_ */
@@ -18,9 +18,11 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/export.h>
+#include <linux/netdevice.h>
 #include "rmnet_data_private.h"
 #include "rmnet_data_config.h"
 #include "rmnet_data_vnd.h"
+#include "rmnet_data_handlers.h"
 
 /* ***************** Trace Points ******************************************* */
 #define CREATE_TRACE_POINTS
@@ -46,6 +48,7 @@ static int __init rmnet_init(void)
 {
 	rmnet_config_init();
 	rmnet_vnd_init();
+	rmnet_map_steer_init();
 
 	LOGL("%s", "RMNET Data driver loaded successfully");
 	return 0;
@@ -53,6 +56,7 @@ static int __init rmnet_init(void)
 
 static void __exit rmnet_exit(void)
 {
+	rmnet_map_steer_exit();
 	rmnet_config_exit();
 	rmnet_vnd_exit();
 }
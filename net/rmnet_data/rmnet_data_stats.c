@@ -48,11 +48,24 @@ unsigned long int deagg_count[RMNET_STATS_AGG_MAX];
 module_param_array(deagg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(deagg_count, "SKBs De-aggregated");
 
+static DEFINE_SPINLOCK(rmnet_coal_count);
+unsigned long int coal_count[RMNET_STATS_AGG_MAX];
+module_param_array(coal_count, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(coal_count, "Downlink SKBs built from several TCP segments");
+
 static DEFINE_SPINLOCK(rmnet_agg_count);
 unsigned long int agg_count[RMNET_STATS_AGG_MAX];
 module_param_array(agg_count, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(agg_count, "SKBs Aggregated");
 
+unsigned long int agg_send[RMNET_STATS_AGG_SEND_MAX];
+module_param_array(agg_send, ulong, 0, S_IRUGO);
+MODULE_PARM_DESC(agg_send, "Aggregated frames sent, by reason");
+
+unsigned long int agg_bytes;
+module_param(agg_bytes, ulong, S_IRUGO);
+MODULE_PARM_DESC(agg_bytes, "Bytes sent in aggregated frames");
+
 static DEFINE_SPINLOCK(rmnet_checksum_dl_stats);
 unsigned long int checksum_dl_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_dl_stats, ulong, 0, S_IRUGO);
@@ -63,6 +76,25 @@ unsigned long int checksum_ul_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_ul_stats, ulong, 0, S_IRUGO);
 MODULE_PARM_DESC(checksum_ul_stats, "Uplink Checksum Statistics");
 
+static DEFINE_PER_CPU(unsigned long int, cpu_pkts);
+
+static int rmnet_stats_cpu_pkts_get(char *buffer, const struct kernel_param *kp)
+{
+	int cpu, len = 0;
+
+	for_each_possible_cpu(cpu)
+		len += scnprintf(buffer + len, PAGE_SIZE - len, "%s%lu",
+				 len ? "," : "", per_cpu(cpu_pkts, cpu));
+
+	return len;
+}
+
+static const struct kernel_param_ops rmnet_stats_cpu_pkts_ops = {
+	.get = rmnet_stats_cpu_pkts_get,
+};
+module_param_cb(cpu_pkts, &rmnet_stats_cpu_pkts_ops, NULL, S_IRUGO);
+MODULE_PARM_DESC(cpu_pkts, "MAP packets processed on each CPU");
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason)
 {
 	unsigned long flags;
@@ -105,13 +137,23 @@ void rmnet_stats_queue_xmit(int rc, unsigned int reason)
 	spin_unlock_irqrestore(&rmnet_queue_xmit_lock, flags);
 }
 
-void rmnet_stats_agg_pkts(int aggcount)
+/*
+ * agg_bytes over agg_count[RMNET_STATS_AGG_BUFF] against the egress agg size
+ * tells how full the frames are, agg_send why they were sent.
+ */
+void rmnet_stats_agg_pkts(int aggcount, unsigned int bytes,
+			  unsigned int reason)
 {
 	unsigned long flags;
 
+	if (reason >= RMNET_STATS_AGG_SEND_MAX)
+		reason = RMNET_STATS_AGG_SEND_BYPASS;
+
 	spin_lock_irqsave(&rmnet_agg_count, flags);
 	agg_count[RMNET_STATS_AGG_BUFF]++;
 	agg_count[RMNET_STATS_AGG_PKT] += aggcount;
+	agg_send[reason]++;
+	agg_bytes += bytes;
 	spin_unlock_irqrestore(&rmnet_agg_count, flags);
 }
 
@@ -125,6 +167,22 @@ void rmnet_stats_deagg_pkts(int aggcount)
 	spin_unlock_irqrestore(&rmnet_deagg_count, flags);
 }
 
+void rmnet_stats_coal_pkts(int segs)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rmnet_coal_count, flags);
+	coal_count[RMNET_STATS_AGG_BUFF]++;
+	coal_count[RMNET_STATS_AGG_PKT] += segs;
+	spin_unlock_irqrestore(&rmnet_coal_count, flags);
+}
+
+/* Counted on the CPU doing the MAP processing, so no lock is needed */
+void rmnet_stats_cpu_pkts(void)
+{
+	this_cpu_inc(cpu_pkts);
+}
+
 void rmnet_stats_dl_checksum(unsigned int rc)
 {
 	unsigned long flags;
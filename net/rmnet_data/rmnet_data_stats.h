@@ -40,6 +40,7 @@ enum rmnet_skb_free_e {
 	RMNET_STATS_SKBFREE_DEAGG_DATA_LEN_0,
 	RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM,
 	RMNET_STATS_SKBFREE_MAPC_UNSUPPORTED,
+	RMNET_STATS_SKBFREE_DEAGG_STEER_DROP,
 	RMNET_STATS_SKBFREE_MAX
 };
 
@@ -53,10 +54,23 @@ enum rmnet_queue_xmit_e {
 	RMNET_STATS_QUEUE_XMIT_MAX
 };
 
+enum rmnet_agg_send_e {
+	RMNET_STATS_AGG_SEND_BYPASS,
+	RMNET_STATS_AGG_SEND_SMALL_PKT,
+	RMNET_STATS_AGG_SEND_FULL,
+	RMNET_STATS_AGG_SEND_TIME,
+	RMNET_STATS_AGG_SEND_IDLE,
+	RMNET_STATS_AGG_SEND_TIMEOUT,
+	RMNET_STATS_AGG_SEND_MAX
+};
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason);
 void rmnet_stats_queue_xmit(int rc, unsigned int reason);
 void rmnet_stats_deagg_pkts(int aggcount);
-void rmnet_stats_agg_pkts(int aggcount);
+void rmnet_stats_cpu_pkts(void);
+void rmnet_stats_coal_pkts(int segs);
+void rmnet_stats_agg_pkts(int aggcount, unsigned int bytes,
+			  unsigned int reason);
 void rmnet_stats_dl_checksum(unsigned int rc);
 void rmnet_stats_ul_checksum(unsigned int rc);
 #endif /* _RMNET_DATA_STATS_H_ */
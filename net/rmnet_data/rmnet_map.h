@@ -133,6 +133,8 @@ enum rmnet_map_agg_state_e {
 #define RMNET_MAP_ADD_PAD_BYTES       1
 
 uint8_t rmnet_map_demultiplex(struct sk_buff *skb);
+struct sk_buff *rmnet_map_deaggregate_coalesce(struct sk_buff *skb,
+					struct rmnet_phys_ep_config *config);
 struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 				      struct rmnet_phys_ep_config *config);
 
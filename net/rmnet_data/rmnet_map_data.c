@@ -31,6 +31,8 @@
 #include <net/ip.h>
 #include <net/checksum.h>
 #include <net/ip6_checksum.h>
+#include <net/ipv6.h>
+#include <net/tcp.h>
 #include <net/rmnet_config.h>
 #include "rmnet_data_config.h"
 #include "rmnet_map.h"
@@ -50,6 +52,10 @@ long agg_bypass_time __read_mostly = 10000000L;
 module_param(agg_bypass_time, long, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(agg_bypass_time, "Skip agg when apart spaced more than this");
 
+unsigned int agg_adaptive __read_mostly = 1;
+module_param(agg_adaptive, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(agg_adaptive, "Scale agg limits with the packet rate");
+
 
 struct agg_work {
 	struct delayed_work work;
@@ -153,7 +159,9 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 		return 0;
 	}
 
-	skbn = alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING, GFP_ATOMIC);
+	/* Runs from the RX softirq; take the head from the NAPI skb cache */
+	skbn = __alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING, GFP_ATOMIC,
+			   SKB_ALLOC_NAPI, NUMA_NO_NODE);
 	if (!skbn)
 		return 0;
 
@@ -199,7 +207,9 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
 	if (likely(config->agg_state == RMNET_MAP_TXFER_SCHEDULED)) {
 		/* Buffer may have already been shipped out */
 		if (likely(config->agg_skb)) {
-			rmnet_stats_agg_pkts(config->agg_count);
+			rmnet_stats_agg_pkts(config->agg_count,
+					     config->agg_skb->len,
+					     RMNET_STATS_AGG_SEND_TIMEOUT);
 			if (config->agg_count > 1)
 				LOGL("Agg count: %d", config->agg_count);
 			skb = config->agg_skb;
@@ -224,6 +234,113 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
 	kfree(work);
 }
 
+/**
+ * rmnet_map_is_small_pkt() - Checks for a packet that should not be held back
+ * @skb:        Packet with MAP header, about to be aggregated
+ * @config:     Physical endpoint configuration of the egress device
+ *
+ * TCP segments without payload, mostly ACKs, and DNS queries gate the
+ * traffic that follows them, and holding them saves almost nothing.
+ *
+ * Return:
+ *      - true for TCP segments without payload and UDP to port 53
+ *      - false for all other packets
+ */
+static bool rmnet_map_is_small_pkt(struct sk_buff *skb,
+				   struct rmnet_phys_ep_config *config)
+{
+	unsigned int off = sizeof(struct rmnet_map_header_s);
+	struct iphdr _ip4h, *ip4h;
+	struct ipv6hdr _ip6h, *ip6h;
+	struct tcphdr _th, *th;
+	struct udphdr _uh, *uh;
+	unsigned int len;
+	uint8_t proto;
+
+	if ((config->egress_data_format & RMNET_EGRESS_FORMAT_MAP_CKSUMV3) ||
+	    (config->egress_data_format & RMNET_EGRESS_FORMAT_MAP_CKSUMV4))
+		off += sizeof(struct rmnet_map_ul_checksum_header_s);
+
+	ip4h = skb_header_pointer(skb, off, sizeof(_ip4h), &_ip4h);
+	if (!ip4h)
+		return false;
+
+	switch (ip4h->version) {
+	case 4:
+		if (ip_is_fragment(ip4h))
+			return false;
+		proto = ip4h->protocol;
+		len = ntohs(ip4h->tot_len) - ip4h->ihl * 4;
+		off += ip4h->ihl * 4;
+		break;
+	case 6:
+		ip6h = skb_header_pointer(skb, off, sizeof(_ip6h), &_ip6h);
+		if (!ip6h)
+			return false;
+		proto = ip6h->nexthdr;
+		len = ntohs(ip6h->payload_len);
+		off += sizeof(struct ipv6hdr);
+		break;
+	default:
+		return false;
+	}
+
+	switch (proto) {
+	case IPPROTO_TCP:
+		th = skb_header_pointer(skb, off, sizeof(_th), &_th);
+		return th && len == th->doff * 4;
+	case IPPROTO_UDP:
+		uh = skb_header_pointer(skb, off, sizeof(_uh), &_uh);
+		return uh && uh->dest == htons(53);
+	default:
+		return false;
+	}
+}
+
+/**
+ * rmnet_map_agg_update_rate() - Tracks packet spacing and size
+ * @config:     Physical endpoint configuration of the egress device
+ * @gap:        Time since the previous packet, in ns
+ * @len:        Length of this packet
+ *
+ * Both are moving averages over roughly the last 8 packets.
+ */
+static void rmnet_map_agg_update_rate(struct rmnet_phys_ep_config *config,
+				      s64 gap, unsigned int len)
+{
+	gap = clamp_t(s64, gap, 0, NSEC_PER_SEC);
+	config->agg_gap_avg = ((u64)config->agg_gap_avg * 7 + gap) >> 3;
+	config->agg_len_avg = (config->agg_len_avg * 7 + len) >> 3;
+}
+
+/**
+ * rmnet_map_agg_time_limit() - Age at which the aggregated frame is sent
+ * @config:     Physical endpoint configuration of the egress device
+ *
+ * With adaptive aggregation this is the time the frame should take to
+ * fill at the recent packet rate, plus one packet gap for jitter, and
+ * never more than agg_time_limit.
+ *
+ * Return:
+ *      - Time limit in ns
+ */
+static s64 rmnet_map_agg_time_limit(struct rmnet_phys_ep_config *config)
+{
+	unsigned int room, pkts;
+	u64 fill;
+
+	if (!agg_adaptive)
+		return agg_time_limit;
+
+	room = config->egress_agg_size - config->agg_skb->len;
+	pkts = config->egress_agg_count - config->agg_count;
+	if (config->agg_len_avg)
+		pkts = min(pkts, room / config->agg_len_avg);
+	fill = (u64)config->agg_gap_avg * (pkts + 1);
+
+	return min_t(u64, fill, agg_time_limit);
+}
+
 /**
  * rmnet_map_aggregate() - Software aggregates multiple packets.
  * @skb:        current packet being transmitted
@@ -232,6 +349,10 @@ static void rmnet_map_flush_packet_queue(struct work_struct *work)
  * Aggregates multiple SKBs into a single large SKB for transmission. MAP
  * protocol is used to separate the packets in the buffer. This funcion consumes
  * the argument SKB and should not be further processed by any other function.
+ *
+ * With agg_adaptive set, small packets others wait on are sent right away,
+ * along with anything aggregated before them, and the frame is also sent
+ * once the next packet is not expected within agg_time_limit.
  */
 void rmnet_map_aggregate(struct sk_buff *skb,
 			 struct rmnet_phys_ep_config *config) {
@@ -240,6 +361,9 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	unsigned long flags;
 	struct sk_buff *agg_skb;
 	struct timespec diff, last;
+	unsigned int reason;
+	s64 elapsed, limit;
+	bool small, retry = false;
 	int size, rc, agg_count = 0;
 
 
@@ -252,23 +376,31 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 		return;
 	}
 
+	small = agg_adaptive && rmnet_map_is_small_pkt(skb, config);
+
 new_packet:
 	spin_lock_irqsave(&config->agg_lock, flags);
 
 	memcpy(&last, &(config->agg_last), sizeof(struct timespec));
 	getnstimeofday(&(config->agg_last));
+	diff = timespec_sub(config->agg_last, last);
+	if (!retry)
+		rmnet_map_agg_update_rate(config, timespec_to_ns(&diff),
+					  skb->len);
 
 	if (!config->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
 		 * sparse, don't aggregate. We will need to tune this later
 		 */
-		diff = timespec_sub(config->agg_last, last);
-
-		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time)) {
+		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time) ||
+		    small ||
+		    (agg_adaptive && config->agg_gap_avg > agg_time_limit)) {
 			spin_unlock_irqrestore(&config->agg_lock, flags);
 			LOGL("delta t: %ld.%09lu\tcount: bypass", diff.tv_sec,
 			     diff.tv_nsec);
-			rmnet_stats_agg_pkts(1);
+			rmnet_stats_agg_pkts(1, skb->len, small ?
+					     RMNET_STATS_AGG_SEND_SMALL_PKT :
+					     RMNET_STATS_AGG_SEND_BYPASS);
 			trace_rmnet_map_aggregate(skb, 0);
 			rc = dev_queue_xmit(skb);
 			rmnet_stats_queue_xmit(rc,
@@ -282,7 +414,8 @@ new_packet:
 			config->agg_count = 0;
 			memset(&(config->agg_time), 0, sizeof(struct timespec));
 			spin_unlock_irqrestore(&config->agg_lock, flags);
-			rmnet_stats_agg_pkts(1);
+			rmnet_stats_agg_pkts(1, skb->len,
+					     RMNET_STATS_AGG_SEND_BYPASS);
 			trace_rmnet_map_aggregate(skb, 0);
 			rc = dev_queue_xmit(skb);
 			rmnet_stats_queue_xmit(rc,
@@ -296,23 +429,28 @@ new_packet:
 		goto schedule;
 	}
 	diff = timespec_sub(config->agg_last, config->agg_time);
+	elapsed = timespec_to_ns(&diff);
+	limit = rmnet_map_agg_time_limit(config);
 
 	if (skb->len > (config->egress_agg_size - config->agg_skb->len)
 	    || (config->agg_count >= config->egress_agg_count)
-	    ||  (diff.tv_sec > 0) || (diff.tv_nsec > agg_time_limit)) {
-		rmnet_stats_agg_pkts(config->agg_count);
+	    || (elapsed > limit)) {
+		reason = elapsed > limit ? RMNET_STATS_AGG_SEND_TIME :
+			 RMNET_STATS_AGG_SEND_FULL;
 		agg_skb = config->agg_skb;
 		agg_count = config->agg_count;
 		config->agg_skb = 0;
 		config->agg_count = 0;
 		memset(&(config->agg_time), 0, sizeof(struct timespec));
 		spin_unlock_irqrestore(&config->agg_lock, flags);
+		rmnet_stats_agg_pkts(agg_count, agg_skb->len, reason);
 		LOGL("delta t: %ld.%09lu\tcount: %d", diff.tv_sec,
 		     diff.tv_nsec, agg_count);
 		trace_rmnet_map_aggregate(skb, agg_count);
 		rc = dev_queue_xmit(agg_skb);
 		rmnet_stats_queue_xmit(rc,
 					RMNET_STATS_QUEUE_XMIT_AGG_FILL_BUFFER);
+		retry = true;
 		goto new_packet;
 	}
 
@@ -321,6 +459,25 @@ new_packet:
 	config->agg_count++;
 	rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_AGG_INTO_BUFF);
 
+	/* The flush work finds the buffer gone and goes idle */
+	if (agg_adaptive &&
+	    (small || elapsed + config->agg_gap_avg > agg_time_limit)) {
+		reason = small ? RMNET_STATS_AGG_SEND_SMALL_PKT :
+			 RMNET_STATS_AGG_SEND_IDLE;
+		agg_skb = config->agg_skb;
+		agg_count = config->agg_count;
+		config->agg_skb = 0;
+		config->agg_count = 0;
+		memset(&(config->agg_time), 0, sizeof(struct timespec));
+		spin_unlock_irqrestore(&config->agg_lock, flags);
+		rmnet_stats_agg_pkts(agg_count, agg_skb->len, reason);
+		trace_rmnet_map_aggregate(agg_skb, agg_count);
+		rc = dev_queue_xmit(agg_skb);
+		rmnet_stats_queue_xmit(rc,
+					RMNET_STATS_QUEUE_XMIT_AGG_FILL_BUFFER);
+		return;
+	}
+
 schedule:
 	if (config->agg_state != RMNET_MAP_TXFER_SCHEDULED) {
 		work = kmalloc(sizeof(*work), GFP_ATOMIC);
@@ -755,3 +912,289 @@ sw_checksum:
 	ul_header->udp_ip4_ind = 0;
 	return ret;
 }
+
+/* ***************** Downlink Coalescing ************************************ */
+
+#define RMNET_MAP_COAL_MAX_SEGS 32
+
+unsigned int dl_coalesce_max __read_mostly;
+module_param(dl_coalesce_max, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dl_coalesce_max, "Max TCP segments merged per downlink skb");
+
+/**
+ * struct rmnet_map_coal_seg - One TCP segment inside an aggregated frame
+ * @ip:         Start of the IP header
+ * @ip_len:     Length of the IP packet
+ * @hdr_len:    Length of the IP and TCP headers
+ * @map_len:    Length of the MAP packet, header and trailer included
+ * @mux_id:     MAP mux ID of the packet
+ */
+struct rmnet_map_coal_seg {
+	unsigned char *ip;
+	unsigned int ip_len;
+	unsigned int hdr_len;
+	unsigned int map_len;
+	uint8_t mux_id;
+};
+
+/**
+ * rmnet_map_coal_parse() - Checks whether a MAP packet can be coalesced
+ * @data:       MAP header of the packet inside the aggregated frame
+ * @avail:      Bytes left in the aggregated frame
+ * @config:     Physical endpoint configuration of the ingress device
+ * @seg:        Filled in for packets that can be coalesced
+ *
+ * Only TCP data segments without IP options whose checksum hardware has
+ * validated qualify, since the merged packet cannot be checked anymore.
+ * Stats for the checksum validation are left to the caller.
+ *
+ * Return:
+ *      - true if the packet can be coalesced
+ *      - false otherwise
+ */
+static bool rmnet_map_coal_parse(unsigned char *data, unsigned int avail,
+				 struct rmnet_phys_ep_config *config,
+				 struct rmnet_map_coal_seg *seg)
+{
+	struct rmnet_map_header_s *maph = (struct rmnet_map_header_s *)data;
+	struct rmnet_map_dl_checksum_trailer_s *cksum_trailer;
+	struct ipv6hdr *ip6h;
+	struct iphdr *ip4h;
+	struct tcphdr *th;
+	unsigned int pkt_len, iphl;
+	int ckresult;
+
+	if (avail < sizeof(struct rmnet_map_header_s) || maph->cd_bit)
+		return false;
+
+	pkt_len = ntohs(maph->pkt_len);
+	seg->map_len = sizeof(struct rmnet_map_header_s) + pkt_len +
+		       sizeof(struct rmnet_map_dl_checksum_trailer_s);
+	if (seg->map_len > avail ||
+	    pkt_len < maph->pad_len + config->tail_spacing)
+		return false;
+
+	seg->ip = data + sizeof(struct rmnet_map_header_s);
+	seg->ip_len = pkt_len - maph->pad_len - config->tail_spacing;
+	seg->mux_id = maph->mux_id;
+	cksum_trailer = (struct rmnet_map_dl_checksum_trailer_s *)
+			(seg->ip + pkt_len);
+	if (!ntohs(cksum_trailer->valid))
+		return false;
+
+	switch (seg->ip[0] & 0xF0) {
+	case 0x40:
+		ip4h = (struct iphdr *)seg->ip;
+		if (seg->ip_len < sizeof(struct iphdr) || ip4h->ihl != 5 ||
+		    ip4h->protocol != IPPROTO_TCP ||
+		    ntohs(ip4h->tot_len) != seg->ip_len ||
+		    ip_fast_csum(ip4h, ip4h->ihl))
+			return false;
+		ckresult = rmnet_map_validate_ipv4_packet_checksum(seg->ip,
+								  cksum_trailer);
+		iphl = sizeof(struct iphdr);
+		break;
+	case 0x60:
+		ip6h = (struct ipv6hdr *)seg->ip;
+		if (seg->ip_len < sizeof(struct ipv6hdr) ||
+		    ip6h->nexthdr != IPPROTO_TCP ||
+		    ntohs(ip6h->payload_len) + sizeof(struct ipv6hdr) !=
+		    seg->ip_len)
+			return false;
+		ckresult = rmnet_map_validate_ipv6_packet_checksum(seg->ip,
+								  cksum_trailer);
+		iphl = sizeof(struct ipv6hdr);
+		break;
+	default:
+		return false;
+	}
+
+	if (ckresult != RMNET_MAP_CHECKSUM_OK ||
+	    seg->ip_len < iphl + sizeof(struct tcphdr))
+		return false;
+
+	th = (struct tcphdr *)(seg->ip + iphl);
+	seg->hdr_len = iphl + th->doff * 4;
+	if (th->doff < 5 || seg->hdr_len >= seg->ip_len)
+		return false;
+
+	/* Plain data segments only, with PSH allowed on the last one */
+	return (tcp_flag_word(th) & (TCP_FLAG_ACK | TCP_FLAG_URG |
+	       TCP_FLAG_RST | TCP_FLAG_SYN | TCP_FLAG_FIN | TCP_FLAG_CWR |
+	       TCP_FLAG_ECE)) == TCP_FLAG_ACK;
+}
+
+/**
+ * rmnet_map_coal_same_flow() - Checks if a segment directly follows another
+ * @first:      First segment of the packet being built
+ * @seg:        Candidate segment
+ * @seq:        Sequence number expected for @seg
+ *
+ * Like TCP GRO, the headers must match except for lengths, IPv4 ID and
+ * checksums, and the options must be the same.
+ */
+static bool rmnet_map_coal_same_flow(struct rmnet_map_coal_seg *first,
+				     struct rmnet_map_coal_seg *seg,
+				     uint32_t seq)
+{
+	struct tcphdr *th, *th2;
+	struct ipv6hdr *ip6h, *ip6h2;
+	struct iphdr *ip4h, *ip4h2;
+	unsigned int iphl;
+
+	if (seg->mux_id != first->mux_id || seg->hdr_len != first->hdr_len ||
+	    (seg->ip[0] & 0xF0) != (first->ip[0] & 0xF0))
+		return false;
+
+	if ((first->ip[0] & 0xF0) == 0x40) {
+		ip4h = (struct iphdr *)first->ip;
+		ip4h2 = (struct iphdr *)seg->ip;
+		if (ip4h->saddr != ip4h2->saddr || ip4h->daddr != ip4h2->daddr ||
+		    ip4h->tos != ip4h2->tos || ip4h->ttl != ip4h2->ttl)
+			return false;
+		iphl = sizeof(struct iphdr);
+	} else {
+		ip6h = (struct ipv6hdr *)first->ip;
+		ip6h2 = (struct ipv6hdr *)seg->ip;
+		if (ipv6_addr_cmp(&ip6h->saddr, &ip6h2->saddr) ||
+		    ipv6_addr_cmp(&ip6h->daddr, &ip6h2->daddr) ||
+		    ip6_flowinfo(ip6h) != ip6_flowinfo(ip6h2) ||
+		    ip6h->hop_limit != ip6h2->hop_limit)
+			return false;
+		iphl = sizeof(struct ipv6hdr);
+	}
+
+	th = (struct tcphdr *)(first->ip + iphl);
+	th2 = (struct tcphdr *)(seg->ip + iphl);
+	if (th->source != th2->source || th->dest != th2->dest ||
+	    ntohl(th2->seq) != seq || th->ack_seq != th2->ack_seq)
+		return false;
+
+	return !memcmp(th + 1, th2 + 1, th->doff * 4 - sizeof(struct tcphdr));
+}
+
+/**
+ * rmnet_map_deaggregate_coalesce() - Deaggregates one or more TCP segments
+ * @skb:        Source socket buffer containing multiple MAP frames
+ * @config:     Physical endpoint configuration of the ingress device
+ *
+ * Like rmnet_map_deaggregate(), but consecutive in-order segments of one
+ * TCP flow are copied into a single skb, and only one is allocated for
+ * them. The result is marked as a TCP GSO packet the way TCP GRO marks
+ * its packets, so it goes past GRO and can be segmented again when it is
+ * forwarded. It still carries a MAP header, but the per segment checksum
+ * trailers are gone, which is why it is only done once hardware has
+ * validated every segment.
+ *
+ * Return:
+ *     - Pointer to new skb
+ *     - 0 (null) if no more aggregated packets
+ */
+struct sk_buff *rmnet_map_deaggregate_coalesce(struct sk_buff *skb,
+					struct rmnet_phys_ep_config *config)
+{
+	struct rmnet_map_coal_seg segs[RMNET_MAP_COAL_MAX_SEGS];
+	unsigned int max_segs, nr_segs, off, total, mss, plen, iphl, i;
+	struct rmnet_map_header_s *maph;
+	struct sk_buff *skbn;
+	struct tcphdr *th;
+	struct iphdr *ip4h;
+	struct ipv6hdr *ip6h;
+	uint32_t seq;
+	bool psh;
+
+	max_segs = min_t(unsigned int, READ_ONCE(dl_coalesce_max),
+			 RMNET_MAP_COAL_MAX_SEGS);
+	if (max_segs < 2 ||
+	    !(config->ingress_data_format & (RMNET_INGRESS_FORMAT_MAP_CKSUMV3 |
+					     RMNET_INGRESS_FORMAT_MAP_CKSUMV4)) ||
+	    !rmnet_map_coal_parse(skb->data, skb->len, config, &segs[0]))
+		return rmnet_map_deaggregate(skb, config);
+
+	iphl = (segs[0].ip[0] & 0xF0) == 0x40 ? sizeof(struct iphdr) :
+						 sizeof(struct ipv6hdr);
+	th = (struct tcphdr *)(segs[0].ip + iphl);
+	mss = segs[0].ip_len - segs[0].hdr_len;
+	seq = ntohl(th->seq) + mss;
+	psh = th->psh;
+	off = segs[0].map_len;
+	total = segs[0].ip_len;
+
+	for (nr_segs = 1; nr_segs < max_segs && !psh; nr_segs++) {
+		struct rmnet_map_coal_seg *seg = &segs[nr_segs];
+
+		if (!rmnet_map_coal_parse(skb->data + off, skb->len - off,
+					  config, seg) ||
+		    !rmnet_map_coal_same_flow(&segs[0], seg, seq))
+			break;
+
+		plen = seg->ip_len - seg->hdr_len;
+		if (plen > mss || total + plen > IP_MAX_MTU)
+			break;
+
+		total += plen;
+		seq += plen;
+		off += seg->map_len;
+		psh = ((struct tcphdr *)(seg->ip + iphl))->psh;
+		if (plen < mss) {
+			nr_segs++;
+			break;
+		}
+	}
+
+	if (nr_segs == 1)
+		return rmnet_map_deaggregate(skb, config);
+
+	skbn = __alloc_skb(sizeof(struct rmnet_map_header_s) + total +
+			   config->tail_spacing + RMNET_MAP_DEAGGR_SPACING,
+			   GFP_ATOMIC, SKB_ALLOC_NAPI, NUMA_NO_NODE);
+	if (!skbn)
+		return rmnet_map_deaggregate(skb, config);
+
+	skbn->dev = skb->dev;
+	skb_reserve(skbn, RMNET_MAP_DEAGGR_HEADROOM);
+
+	maph = (struct rmnet_map_header_s *)
+	       skb_put(skbn, sizeof(struct rmnet_map_header_s));
+	memcpy(maph, skb->data, sizeof(struct rmnet_map_header_s));
+	maph->pad_len = 0;
+	maph->pkt_len = htons(total + config->tail_spacing);
+
+	skb_set_network_header(skbn, skbn->len);
+	memcpy(skb_put(skbn, segs[0].ip_len), segs[0].ip, segs[0].ip_len);
+	for (i = 1; i < nr_segs; i++) {
+		plen = segs[i].ip_len - segs[i].hdr_len;
+		memcpy(skb_put(skbn, plen), segs[i].ip + segs[i].hdr_len,
+		       plen);
+	}
+	memset(skb_put(skbn, config->tail_spacing), 0, config->tail_spacing);
+
+	th = (struct tcphdr *)(skb_network_header(skbn) + iphl);
+	th->psh = psh;
+	if (iphl == sizeof(struct iphdr)) {
+		ip4h = ip_hdr(skbn);
+		ip4h->tot_len = htons(total);
+		ip_send_check(ip4h);
+		th->check = ~tcp_v4_check(total - iphl, ip4h->saddr,
+					  ip4h->daddr, 0);
+		skb_shinfo(skbn)->gso_type = SKB_GSO_TCPV4;
+	} else {
+		ip6h = ipv6_hdr(skbn);
+		ip6h->payload_len = htons(total - iphl);
+		th->check = ~tcp_v6_check(total - iphl, &ip6h->saddr,
+					  &ip6h->daddr, 0);
+		skb_shinfo(skbn)->gso_type = SKB_GSO_TCPV6;
+	}
+	skbn->ip_summed = CHECKSUM_PARTIAL;
+	skbn->csum_start = (unsigned char *)th - skbn->head;
+	skbn->csum_offset = offsetof(struct tcphdr, check);
+	skb_shinfo(skbn)->gso_size = mss;
+	skb_shinfo(skbn)->gso_segs = nr_segs;
+
+	skb_pull(skb, off);
+	for (i = 0; i < nr_segs; i++)
+		rmnet_stats_dl_checksum(RMNET_MAP_CHECKSUM_OK);
+	rmnet_stats_coal_pkts(nr_segs);
+
+	return skbn;
+}
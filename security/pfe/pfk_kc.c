@@ -18,9 +18,11 @@
  * The purpose of the cache is to save access time to QSEE when loading keys.
  * Currently the cache is the same size as the total number of keys that can
  * be loaded to ICE. Since this number is relatively small, the algorithms for
- * cache eviction are simple, linear and based on last usage timestamp, i.e
- * the node that will be evicted is the one with the oldest timestamp.
- * Empty entries always have the oldest timestamp.
+ * cache eviction are simple and linear: the entries are kept on a list in
+ * least recently used order, lookups start from the most recently used entry
+ * so that the hot keys of file based encryption are found first, and the
+ * entry that will be evicted is the least recently used one that is not in
+ * use. Empty entries are always the least recently used ones.
  */
 
 #include <linux/module.h>
@@ -33,6 +35,9 @@
 #include <linux/slab.h>
 #include <linux/printk.h>
 #include <linux/sched.h>
+#include <linux/list.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "pfk_kc.h"
 #include "pfk_ice.h"
@@ -59,6 +64,27 @@ static unsigned long flags;
 static bool kc_ready;
 static char *s_type = "sdcc";
 
+/* entries in least recently used order, most recently used first */
+static LIST_HEAD(kc_lru);
+
+/**
+ * struct kc_stats - key cache statistics, protected by kc_lock
+ * @hit: key found loaded in ICE
+ * @miss: key had to be loaded to ICE
+ * @evict: a miss which replaced the key of another entry
+ * @defer: a miss deferred to a context which can do the SCM call
+ * @busy: a miss with all entries in use
+ */
+struct kc_stats {
+	u64 hit;
+	u64 miss;
+	u64 evict;
+	u64 defer;
+	u64 busy;
+};
+
+static struct kc_stats kc_stats;
+
 /**
  * enum pfk_kc_entry_state - state of the entry inside kc table
  *
@@ -97,7 +123,7 @@ struct kc_entry {
 	 unsigned char salt[PFK_MAX_SALT_SIZE];
 	 size_t salt_size;
 
-	 u64 time_stamp;
+	 struct list_head lru;
 	 u32 key_index;
 
 	 struct task_struct *thread_pending;
@@ -220,25 +246,6 @@ static void kc_entry_finish_invalidating(struct kc_entry *entry)
 	entry->state = FREE;
 }
 
-/**
- * kc_min_entry() - compare two entries to find one with minimal time
- * @a: ptr to the first entry. If NULL the other entry will be returned
- * @b: pointer to the second entry
- *
- * Return the entry which timestamp is the minimal, or b if a is NULL
- */
-static inline struct kc_entry *kc_min_entry(struct kc_entry *a,
-		struct kc_entry *b)
-{
-	if (!a)
-		return b;
-
-	if (time_before64(b->time_stamp, a->time_stamp))
-		return b;
-
-	return a;
-}
-
 /**
  * kc_entry_at_index() - return entry at specific index
  * @index: index of entry to be accessed
@@ -294,7 +301,7 @@ static struct kc_entry *kc_find_key_at_index(const unsigned char *key,
 }
 
 /**
- * kc_find_key() - find kc entry
+ * kc_find_key() - find kc entry, most recently used first
  * @key: key to look for
  * @key_size: the key size
  * @salt: salt to look for
@@ -306,17 +313,31 @@ static struct kc_entry *kc_find_key_at_index(const unsigned char *key,
 static struct kc_entry *kc_find_key(const unsigned char *key, size_t key_size,
 		const unsigned char *salt, size_t salt_size)
 {
-	int index = 0;
+	struct kc_entry *entry = NULL;
+
+	list_for_each_entry(entry, &kc_lru, lru) {
+		/* the remaining entries are empty */
+		if (!entry->key_size)
+			break;
+
+		if (entry->key_size != key_size ||
+		    entry->salt_size != salt_size)
+			continue;
+
+		if (0 == memcmp(entry->key, key, key_size) &&
+		    0 == memcmp(entry->salt, salt, salt_size))
+			return entry;
+	}
 
-	return kc_find_key_at_index(key, key_size, salt, salt_size, &index);
+	return NULL;
 }
 
 /**
- * kc_find_oldest_entry_non_locked() - finds the entry with minimal timestamp
+ * kc_find_oldest_entry_non_locked() - finds the least recently used entry
  * that is not locked
  *
- * Returns entry with minimal timestamp. Empty entries have timestamp
- * of 0, therefore they are returned first.
+ * Returns the least recently used entry. Empty entries are kept at the
+ * tail of the list, therefore they are returned first.
  * If all the entries are locked, will return NULL
  * Should be invoked under spin lock
  */
@@ -324,33 +345,31 @@ static struct kc_entry *kc_find_oldest_entry_non_locked(void)
 {
 	struct kc_entry *curr_min_entry = NULL;
 	struct kc_entry *entry = NULL;
-	int i = 0;
-
-	for (i = 0; i < PFK_KC_TABLE_SIZE; i++) {
-		entry = kc_entry_at_index(i);
 
+	list_for_each_entry_reverse(entry, &kc_lru, lru) {
 		if (entry->state == FREE)
 			return entry;
 
-		if (entry->state == INACTIVE)
-			curr_min_entry = kc_min_entry(curr_min_entry, entry);
+		if (entry->state == INACTIVE && !curr_min_entry)
+			curr_min_entry = entry;
 	}
 
 	return curr_min_entry;
 }
 
 /**
- * kc_update_timestamp() - updates timestamp of entry to current
+ * kc_update_timestamp() - mark entry as the most recently used one
  *
  * @entry: entry to update
  *
+ * Should be invoked under spinlock
  */
 static void kc_update_timestamp(struct kc_entry *entry)
 {
 	if (!entry)
 		return;
 
-	entry->time_stamp = get_jiffies_64();
+	list_move(&entry->lru, &kc_lru);
 }
 
 /**
@@ -371,7 +390,7 @@ static void kc_clear_entry(struct kc_entry *entry)
 	entry->key_size = 0;
 	entry->salt_size = 0;
 
-	entry->time_stamp = 0;
+	list_move_tail(&entry->lru, &kc_lru);
 	entry->scm_error = 0;
 }
 
@@ -402,6 +421,9 @@ static int kc_update_entry(struct kc_entry *entry, const unsigned char *key,
 	memcpy(entry->salt, salt, salt_size);
 	entry->salt_size = salt_size;
 
+	/* Keep it ahead of the empty entries so lookups can find it */
+	kc_update_timestamp(entry);
+
 	/* Mark entry as no longer free before releasing the lock */
 	entry->state = ACTIVE_ICE_PRELOAD;
 	kc_spin_unlock();
@@ -424,9 +446,14 @@ int pfk_kc_init(void)
 	struct kc_entry *entry = NULL;
 
 	kc_spin_lock();
+	INIT_LIST_HEAD(&kc_lru);
 	for (i = 0; i < PFK_KC_TABLE_SIZE; i++) {
 		entry = kc_entry_at_index(i);
 		entry->key_index = PFK_KC_STARTING_INDEX + i;
+		if (entry->key_size)
+			list_add(&entry->lru, &kc_lru);
+		else
+			list_add_tail(&entry->lru, &kc_lru);
 	}
 	kc_ready = true;
 	kc_spin_unlock();
@@ -501,6 +528,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	if (!entry) {
 		if (async) {
 			pr_debug("found empty entry, a separate task will populate it\n");
+			kc_stats.defer++;
 			kc_spin_unlock();
 			return -EAGAIN;
 		}
@@ -511,9 +539,13 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			 * return EBUSY to upper layers so that the
 			 * request will be rescheduled
 			 */
+			kc_stats.busy++;
 			kc_spin_unlock();
 			return -EBUSY;
 		}
+		kc_stats.miss++;
+		if (entry->state == INACTIVE)
+			kc_stats.evict++;
 	} else {
 		entry_exists = true;
 	}
@@ -524,6 +556,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	switch (entry->state) {
 	case (INACTIVE):
 		if (entry_exists) {
+			kc_stats.hit++;
 			kc_update_timestamp(entry);
 			entry->state = ACTIVE_ICE_LOADED;
 
@@ -563,6 +596,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 		ret = -EAGAIN;
 		break;
 	case (ACTIVE_ICE_LOADED):
+		kc_stats.hit++;
 		kc_update_timestamp(entry);
 
 		if (!strcmp(s_type, (char *)PFK_UFS)) {
@@ -882,13 +916,56 @@ static int pfk_kc_find_storage_type(char **device)
 	return -EINVAL;
 }
 
+static int kc_stats_show(struct seq_file *s, void *unused)
+{
+	struct kc_stats stats;
+	int loaded = 0;
+	int i;
+
+	kc_spin_lock();
+	stats = kc_stats;
+	for (i = 0; i < PFK_KC_TABLE_SIZE; i++)
+		if (kc_entry_at_index(i)->key_size)
+			loaded++;
+	kc_spin_unlock();
+
+	seq_printf(s, "hit: %llu\n", stats.hit);
+	seq_printf(s, "miss: %llu\n", stats.miss);
+	seq_printf(s, "evict: %llu\n", stats.evict);
+	seq_printf(s, "defer: %llu\n", stats.defer);
+	seq_printf(s, "busy: %llu\n", stats.busy);
+	seq_printf(s, "loaded: %d/%d\n", loaded, PFK_KC_TABLE_SIZE);
+
+	return 0;
+}
+
+static int kc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kc_stats_show, NULL);
+}
+
+static const struct file_operations kc_stats_fops = {
+	.open		= kc_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *kc_debugfs_root;
+
 static int __init pfk_kc_pre_init(void)
 {
+	kc_debugfs_root = debugfs_create_dir("pfk_kc", NULL);
+	if (!IS_ERR_OR_NULL(kc_debugfs_root))
+		debugfs_create_file("stats", S_IRUSR, kc_debugfs_root, NULL,
+				    &kc_stats_fops);
+
 	return pfk_kc_find_storage_type(&s_type);
 }
 
 static void __exit pfk_kc_exit(void)
 {
+	debugfs_remove_recursive(kc_debugfs_root);
 	s_type = NULL;
 }
 
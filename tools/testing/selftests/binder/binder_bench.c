@@ -0,0 +1,676 @@
+/*
+ * Binder transaction benchmark
+ *
+ * Forks a server process that becomes the context manager of a binder
+ * device and runs one looper thread per client thread, then times
+ * transactions from the client threads to handle 0: the round trip of
+ * sync transactions, the send of oneway ones, and the throughput of all
+ * threads together. Every payload size is run plain, with an fd to
+ * translate and with the payload in a scatter-gather buffer.
+ *
+ * The context manager of the device must be free, so either run it on a
+ * spare device (binder.devices=...) with -d, or with servicemanager
+ * stopped. With -p client and server thread N are both pinned to CPU N,
+ * otherwise the scheduler places them.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/android/binder.h>
+
+#include "../kselftest.h"
+
+#define BINDER_VM_SIZE		(1024 * 1024)
+#define MAX_THREADS		64
+#define MAX_SIZES		16
+#define MAX_PAYLOAD		(64 * 1024)
+#define ONEWAY_RETRIES		100000
+#define ALIGN8(x)		(((x) + 7) & ~(size_t)7)
+
+enum bench_mode {
+	MODE_SYNC,
+	MODE_ONEWAY,
+	NR_MODES,
+};
+
+enum bench_obj {
+	OBJ_NONE,
+	OBJ_FD,
+	OBJ_SG,
+	NR_OBJS,
+};
+
+static const char * const mode_names[] = {
+	[MODE_SYNC]	= "sync",
+	[MODE_ONEWAY]	= "oneway",
+};
+
+static const char * const obj_names[] = {
+	[OBJ_NONE]	= "none",
+	[OBJ_FD]	= "fd",
+	[OBJ_SG]	= "sg",
+};
+
+static const char *dev_name = "/dev/binder";
+static int nr_threads = 1;
+static int iterations = 10000;
+static int warmup = 100;
+static int pin;
+static int nr_cpus;
+static size_t sizes[MAX_SIZES] = { 0, 64, 256, 1024, 4096, 16384 };
+static int nr_sizes = 6;
+static unsigned int mode_mask = (1 << NR_MODES) - 1;
+static unsigned int obj_mask = (1 << NR_OBJS) - 1;
+
+/* parameters of the current run, read by the client threads */
+static enum bench_mode cur_mode;
+static enum bench_obj cur_obj;
+static size_t cur_size;
+static pthread_barrier_t start_barrier;
+static int binder_fd;
+
+struct client {
+	pthread_t thread;
+	int idx;
+	int pass_fd;
+	binder_uintptr_t reply_buf;
+	unsigned long retries;
+	uint64_t *lat;
+	uint8_t *data;
+	uint8_t *sg;
+	int failed;
+};
+
+struct cmd_buf {
+	uint8_t buf[256];
+	size_t len;
+};
+
+static void cmd_put(struct cmd_buf *c, const void *p, size_t len)
+{
+	memcpy(c->buf + c->len, p, len);
+	c->len += len;
+}
+
+static void cmd_put32(struct cmd_buf *c, uint32_t v)
+{
+	cmd_put(c, &v, sizeof(v));
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pin_thread(int idx)
+{
+	cpu_set_t set;
+
+	if (!pin)
+		return;
+
+	CPU_ZERO(&set);
+	CPU_SET(idx % nr_cpus, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+		fprintf(stderr, "failed to pin thread %d\n", idx);
+}
+
+static int binder_open(void)
+{
+	struct binder_version version;
+	int fd;
+
+	fd = open(dev_name, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "open %s: %s\n", dev_name, strerror(errno));
+		return -1;
+	}
+
+	if (ioctl(fd, BINDER_VERSION, &version) < 0 ||
+	    version.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION) {
+		fprintf(stderr, "binder protocol version mismatch\n");
+		close(fd);
+		return -1;
+	}
+
+	if (mmap(NULL, BINDER_VM_SIZE, PROT_READ, MAP_PRIVATE, fd, 0) ==
+	    MAP_FAILED) {
+		fprintf(stderr, "mmap %s: %s\n", dev_name, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* one BINDER_WRITE_READ, restarted with what is left after a signal */
+static int binder_rw(int fd, struct cmd_buf *wr, void *rbuf, size_t rsize,
+		     size_t *rlen)
+{
+	struct binder_write_read bwr = {
+		.write_buffer	= (uintptr_t)wr->buf,
+		.write_size	= wr->len,
+		.read_buffer	= (uintptr_t)rbuf,
+		.read_size	= rsize,
+	};
+	int ret;
+
+	do {
+		ret = ioctl(fd, BINDER_WRITE_READ, &bwr);
+	} while (ret < 0 && errno == EINTR);
+
+	wr->len = 0;
+	if (rlen)
+		*rlen = bwr.read_consumed;
+	return ret;
+}
+
+static void server_handle(struct cmd_buf *wr,
+			  const struct binder_transaction_data *tr)
+{
+	const binder_size_t *offs = (void *)(uintptr_t)tr->data.ptr.offsets;
+	const uint8_t *data = (void *)(uintptr_t)tr->data.ptr.buffer;
+	struct binder_transaction_data reply;
+	size_t i;
+
+	for (i = 0; i < tr->offsets_size / sizeof(*offs); i++) {
+		const struct binder_fd_object *obj = (void *)(data + offs[i]);
+
+		if (obj->hdr.type == BINDER_TYPE_FD)
+			close(obj->fd);
+	}
+
+	cmd_put32(wr, BC_FREE_BUFFER);
+	cmd_put(wr, &tr->data.ptr.buffer, sizeof(binder_uintptr_t));
+
+	if (tr->flags & TF_ONE_WAY)
+		return;
+
+	memset(&reply, 0, sizeof(reply));
+	cmd_put32(wr, BC_REPLY);
+	cmd_put(wr, &reply, sizeof(reply));
+}
+
+static void *server_thread(void *arg)
+{
+	int idx = (long)arg;
+	uint64_t rbuf[32];
+	struct cmd_buf wr = { .len = 0 };
+	size_t rlen;
+
+	pin_thread(idx);
+	cmd_put32(&wr, BC_ENTER_LOOPER);
+
+	for (;;) {
+		uint8_t *p = (uint8_t *)rbuf, *end;
+
+		if (binder_rw(binder_fd, &wr, rbuf, sizeof(rbuf), &rlen) < 0) {
+			perror("server BINDER_WRITE_READ");
+			exit(1);
+		}
+
+		for (end = p + rlen; p < end; ) {
+			uint32_t cmd = *(uint32_t *)p;
+			struct binder_ptr_cookie *pc;
+
+			p += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_OK:
+			case BR_SPAWN_LOOPER:
+			case BR_TRANSACTION_COMPLETE:
+				break;
+			case BR_INCREFS:
+			case BR_ACQUIRE:
+			case BR_RELEASE:
+			case BR_DECREFS:
+				pc = (void *)p;
+				p += sizeof(*pc);
+				if (cmd == BR_INCREFS || cmd == BR_ACQUIRE) {
+					cmd_put32(&wr, cmd == BR_INCREFS ?
+						  BC_INCREFS_DONE :
+						  BC_ACQUIRE_DONE);
+					cmd_put(&wr, pc, sizeof(*pc));
+				}
+				break;
+			case BR_TRANSACTION:
+				server_handle(&wr, (void *)p);
+				p += sizeof(struct binder_transaction_data);
+				break;
+			default:
+				fprintf(stderr, "server: unexpected return %#x\n",
+					cmd);
+				exit(1);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void server_main(int ready_fd)
+{
+	struct flat_binder_object obj = {
+		.flags = FLAT_BINDER_FLAG_ACCEPTS_FDS,
+	};
+	pthread_t thread;
+	char ok = 0;
+	long i;
+
+	binder_fd = binder_open();
+	if (binder_fd < 0)
+		goto out;
+
+	if (ioctl(binder_fd, BINDER_SET_CONTEXT_MGR_EXT, &obj) < 0) {
+		fprintf(stderr, "%s: context manager is taken (%s)\n",
+			dev_name, strerror(errno));
+		goto out;
+	}
+	ioctl(binder_fd, BINDER_SET_MAX_THREADS, &(uint32_t){ 0 });
+
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&thread, NULL, server_thread, (void *)i)) {
+			fprintf(stderr, "failed to start server threads\n");
+			goto out;
+		}
+	}
+	ok = 1;
+out:
+	if (write(ready_fd, &ok, 1) != 1 || !ok)
+		exit(1);
+	for (;;)
+		pause();
+}
+
+static void client_build(struct client *c, struct cmd_buf *wr)
+{
+	struct binder_transaction_data_sg trs;
+	struct binder_transaction_data *tr = &trs.transaction_data;
+	binder_size_t *off = (binder_size_t *)c->data;
+	uint8_t *data = c->data + sizeof(*off);
+	size_t obj_off = ALIGN8(cur_size);
+
+	if (c->reply_buf) {
+		cmd_put32(wr, BC_FREE_BUFFER);
+		cmd_put(wr, &c->reply_buf, sizeof(c->reply_buf));
+		c->reply_buf = 0;
+	}
+
+	memset(&trs, 0, sizeof(trs));
+	tr->target.handle = 0;
+	tr->code = 1;
+	if (cur_mode == MODE_ONEWAY)
+		tr->flags = TF_ONE_WAY;
+	tr->data.ptr.buffer = (uintptr_t)data;
+	tr->data.ptr.offsets = (uintptr_t)off;
+	tr->data_size = cur_size;
+
+	switch (cur_obj) {
+	case OBJ_FD: {
+		struct binder_fd_object *obj = (void *)(data + obj_off);
+
+		memset(obj, 0, sizeof(*obj));
+		obj->hdr.type = BINDER_TYPE_FD;
+		obj->fd = c->pass_fd;
+		*off = obj_off;
+		tr->offsets_size = sizeof(*off);
+		tr->data_size = obj_off + sizeof(*obj);
+		break;
+	}
+	case OBJ_SG: {
+		/* the payload travels in the sg buffer, not in the data */
+		struct binder_buffer_object *obj = (void *)data;
+
+		memset(obj, 0, sizeof(*obj));
+		obj->hdr.type = BINDER_TYPE_PTR;
+		obj->buffer = (uintptr_t)c->sg;
+		obj->length = cur_size;
+		*off = 0;
+		tr->offsets_size = sizeof(*off);
+		tr->data_size = sizeof(*obj);
+		trs.buffers_size = ALIGN8(cur_size);
+		cmd_put32(wr, BC_TRANSACTION_SG);
+		cmd_put(wr, &trs, sizeof(trs));
+		return;
+	}
+	default:
+		break;
+	}
+
+	cmd_put32(wr, BC_TRANSACTION);
+	cmd_put(wr, tr, sizeof(*tr));
+}
+
+/* returns 0 when done, 1 if a oneway call found no async space */
+static int client_txn(struct client *c)
+{
+	struct cmd_buf wr = { .len = 0 };
+	uint64_t rbuf[32];
+	size_t rlen;
+
+	client_build(c, &wr);
+
+	for (;;) {
+		uint8_t *p = (uint8_t *)rbuf, *end;
+
+		if (binder_rw(binder_fd, &wr, rbuf, sizeof(rbuf), &rlen) < 0) {
+			perror("client BINDER_WRITE_READ");
+			return -1;
+		}
+
+		for (end = p + rlen; p < end; ) {
+			uint32_t cmd = *(uint32_t *)p;
+			struct binder_transaction_data *tr;
+
+			p += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+				break;
+			case BR_TRANSACTION_COMPLETE:
+				if (cur_mode == MODE_ONEWAY)
+					return 0;
+				break;
+			case BR_REPLY:
+				tr = (void *)p;
+				c->reply_buf = tr->data.ptr.buffer;
+				return 0;
+			case BR_FAILED_REPLY:
+				if (cur_mode == MODE_ONEWAY)
+					return 1;
+				/* fall through */
+			default:
+				fprintf(stderr, "client: unexpected return %#x\n",
+					cmd);
+				return -1;
+			}
+		}
+	}
+}
+
+static void *client_thread(void *arg)
+{
+	struct client *c = arg;
+	struct cmd_buf wr = { .len = 0 };
+	int i, ret, tries;
+
+	pin_thread(c->idx);
+	pthread_barrier_wait(&start_barrier);
+
+	for (i = -warmup; i < iterations; i++) {
+		uint64_t start = now_ns();
+
+		tries = 0;
+		while ((ret = client_txn(c)) == 1) {
+			if (++tries > ONEWAY_RETRIES)
+				break;
+			c->retries++;
+			sched_yield();
+		}
+		if (ret) {
+			c->failed = 1;
+			break;
+		}
+		if (i >= 0)
+			c->lat[i] = now_ns() - start;
+	}
+
+	if (c->reply_buf) {
+		cmd_put32(&wr, BC_FREE_BUFFER);
+		cmd_put(&wr, &c->reply_buf, sizeof(c->reply_buf));
+		c->reply_buf = 0;
+		binder_rw(binder_fd, &wr, NULL, 0, NULL);
+	}
+	ioctl(binder_fd, BINDER_THREAD_EXIT, 0);
+
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int bench_run(struct client *clients, uint64_t *all)
+{
+	size_t n = (size_t)nr_threads * iterations;
+	unsigned long retries = 0;
+	uint64_t start, wall, sum = 0;
+	double secs, txns;
+	size_t i;
+	int t, failed = 0;
+
+	pthread_barrier_init(&start_barrier, NULL, nr_threads + 1);
+	for (t = 0; t < nr_threads; t++) {
+		clients[t].lat = all + (size_t)t * iterations;
+		clients[t].failed = 0;
+		clients[t].retries = 0;
+		if (pthread_create(&clients[t].thread, NULL, client_thread,
+				   &clients[t])) {
+			fprintf(stderr, "failed to start client threads\n");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now_ns();
+	for (t = 0; t < nr_threads; t++) {
+		pthread_join(clients[t].thread, NULL);
+		failed |= clients[t].failed;
+		retries += clients[t].retries;
+	}
+	wall = now_ns() - start;
+	pthread_barrier_destroy(&start_barrier);
+
+	if (failed) {
+		printf("%-6s %-4s %6zu bytes: FAIL\n", mode_names[cur_mode],
+		       obj_names[cur_obj], cur_size);
+		return -1;
+	}
+
+	qsort(all, n, sizeof(*all), cmp_u64);
+	for (i = 0; i < n; i++)
+		sum += all[i];
+	/* the wall time includes the warmup transactions */
+	secs = wall / 1e9;
+	txns = (double)nr_threads * (iterations + warmup);
+
+	printf("%-6s %-4s %6zu bytes: %8.0f txn/s %8.1f MB/s  "
+	       "us avg %7.1f p50 %7.1f p90 %7.1f p99 %7.1f max %8.1f",
+	       mode_names[cur_mode], obj_names[cur_obj], cur_size,
+	       txns / secs, txns * cur_size / secs / 1e6, sum / 1e3 / n,
+	       all[n / 2] / 1e3, all[n * 9 / 10] / 1e3,
+	       all[n * 99 / 100] / 1e3, all[n - 1] / 1e3);
+	if (retries)
+		printf(" retries %lu", retries);
+	printf("\n");
+
+	return 0;
+}
+
+static int parse_list(char *arg, const char * const *names, int nr,
+		      unsigned int *mask)
+{
+	char *tok;
+	int i;
+
+	*mask = 0;
+	for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+		for (i = 0; i < nr; i++)
+			if (!strcmp(tok, names[i]))
+				break;
+		if (i == nr)
+			return -1;
+		*mask |= 1 << i;
+	}
+
+	return *mask ? 0 : -1;
+}
+
+static int parse_sizes(char *arg)
+{
+	char *tok;
+
+	nr_sizes = 0;
+	for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+		if (nr_sizes == MAX_SIZES)
+			return -1;
+		sizes[nr_sizes] = strtoul(tok, NULL, 0);
+		if (sizes[nr_sizes] > MAX_PAYLOAD)
+			return -1;
+		nr_sizes++;
+	}
+
+	return nr_sizes ? 0 : -1;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d device] [-t threads] [-n iterations] [-w warmup]\n"
+		"          [-s size,...] [-m sync,oneway] [-o none,fd,sg] [-p]\n"
+		"  -t  client/server thread pairs (max %d)\n"
+		"  -s  payload sizes in bytes (max %d)\n"
+		"  -p  pin thread pair N to CPU N\n",
+		prog, MAX_THREADS, MAX_PAYLOAD);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct client clients[MAX_THREADS];
+	int ready[2], opt, s, t, ret = 0;
+	uint64_t *all;
+	pid_t server;
+	char ok = 0;
+
+	while ((opt = getopt(argc, argv, "d:t:n:w:s:m:o:ph")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev_name = optarg;
+			break;
+		case 't':
+			nr_threads = atoi(optarg);
+			if (nr_threads < 1 || nr_threads > MAX_THREADS)
+				usage(argv[0]);
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			if (iterations < 1)
+				usage(argv[0]);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			if (warmup < 0)
+				usage(argv[0]);
+			break;
+		case 's':
+			if (parse_sizes(optarg))
+				usage(argv[0]);
+			break;
+		case 'm':
+			if (parse_list(optarg, mode_names, NR_MODES,
+				       &mode_mask))
+				usage(argv[0]);
+			break;
+		case 'o':
+			if (parse_list(optarg, obj_names, NR_OBJS, &obj_mask))
+				usage(argv[0]);
+			break;
+		case 'p':
+			pin = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (access(dev_name, R_OK | W_OK)) {
+		printf("binder_bench: %s not available, skipping\n", dev_name);
+		return ksft_exit_skip();
+	}
+
+	if (pipe(ready)) {
+		perror("pipe");
+		return ksft_exit_fail();
+	}
+	server = fork();
+	if (server < 0) {
+		perror("fork");
+		return ksft_exit_fail();
+	}
+	if (!server)
+		server_main(ready[1]);
+
+	if (read(ready[0], &ok, 1) != 1 || !ok) {
+		waitpid(server, NULL, 0);
+		printf("binder_bench: no server on %s, skipping\n", dev_name);
+		return ksft_exit_skip();
+	}
+
+	binder_fd = binder_open();
+	all = calloc((size_t)nr_threads * iterations, sizeof(*all));
+	if (binder_fd < 0 || !all)
+		goto fail;
+
+	for (t = 0; t < nr_threads; t++) {
+		clients[t].idx = t;
+		clients[t].reply_buf = 0;
+		clients[t].pass_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		clients[t].data = aligned_alloc(8, ALIGN8(MAX_PAYLOAD) + 64);
+		clients[t].sg = aligned_alloc(8, MAX_PAYLOAD);
+		if (clients[t].pass_fd < 0 || !clients[t].data ||
+		    !clients[t].sg)
+			goto fail;
+		memset(clients[t].data, 0x5a, ALIGN8(MAX_PAYLOAD) + 64);
+		memset(clients[t].sg, 0xa5, MAX_PAYLOAD);
+	}
+
+	printf("binder_bench: %s, %d thread pairs, %s, %d iterations\n",
+	       dev_name, nr_threads, pin ? "pinned" : "unpinned", iterations);
+
+	for (cur_mode = 0; cur_mode < NR_MODES; cur_mode++) {
+		if (!(mode_mask & (1 << cur_mode)))
+			continue;
+		for (cur_obj = 0; cur_obj < NR_OBJS; cur_obj++) {
+			if (!(obj_mask & (1 << cur_obj)))
+				continue;
+			for (s = 0; s < nr_sizes; s++) {
+				cur_size = sizes[s];
+				ret |= bench_run(clients, all);
+			}
+		}
+	}
+
+	kill(server, SIGKILL);
+	waitpid(server, NULL, 0);
+	return ret ? ksft_exit_fail() : ksft_exit_pass();
+
+fail:
+	fprintf(stderr, "binder_bench: setup failed\n");
+	kill(server, SIGKILL);
+	waitpid(server, NULL, 0);
+	return ksft_exit_fail();
+}